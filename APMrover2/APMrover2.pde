@@ -72,9 +72,11 @@ version 2.1 of the License, or (at your option) any later version.
 #include <AP_Camera.h>		// Camera triggering
 #include <GCS_MAVLink.h>    // MAVLink GCS definitions
 #include <AP_Airspeed.h>    // needed for AHRS build
+#include <AP_BattMonitor.h> // Battery voltage and current
 #include <memcheck.h>
 #include <DataFlash.h>
 #include <AP_RCMapper.h>        // RC input mapping library
+#include <AP_MissionStore.h>    // packed mission storage
 #include <SITL.h>
 #include <AP_Scheduler.h>       // main loop scheduler
 #include <stdarg.h>
@@ -106,9 +108,15 @@ const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
 AP_Param param_loader(var_info, WP_START_BYTE);
 
 ////////////////////////////////////////////////////////////////////////////////
-// the rate we run the main loop at
+// the rate we run the main loop at, set from the LOOP_RATE parameter
 ////////////////////////////////////////////////////////////////////////////////
-static const AP_InertialSensor::Sample_rate ins_sample_rate = AP_InertialSensor::RATE_50HZ;
+static AP_InertialSensor::Sample_rate ins_sample_rate = AP_InertialSensor::RATE_50HZ;
+
+// milliseconds between main loops
+static uint8_t loop_period_ms = 20;
+
+// main loops per 20ms tick of the scheduler table
+static uint8_t loops_per_tick = 1;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Parameters
@@ -226,7 +234,13 @@ AP_InertialSensor_Oilpan ins( &adc );
   #error Unrecognised CONFIG_INS_TYPE setting.
 #endif // CONFIG_INS_TYPE
 
+#if AHRS_QUATERNION_ENABLED == ENABLED
+AP_AHRS_Quaternion ahrs(&ins, g_gps);
+#elif AP_AHRS_NAVEKF_AVAILABLE
+AP_AHRS_NavEKF ahrs(&ins, g_gps);       // EKF selected by AHRS_EKF_USE
+#else
 AP_AHRS_DCM ahrs(&ins, g_gps);
+#endif
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_AVR_SITL
 SITL sitl;
@@ -238,6 +252,10 @@ SITL sitl;
 //
 GCS_MAVLINK	gcs0;
 GCS_MAVLINK	gcs3;
+// passes on messages between the two links
+static MAVLink_routing mavlink_router;
+// texts waiting to go to the two links
+static MAVLink_statustext gcs_statustext;
 
 // a pin for reading the receiver RSSI voltage. The scaling by 0.25 
 // is to take the 0 to 1024 range down to an 8 bit range for MAVLink
@@ -248,6 +266,9 @@ AP_HAL::AnalogSource *vcc_pin;
 AP_HAL::AnalogSource * batt_volt_pin;
 AP_HAL::AnalogSource * batt_curr_pin;
 
+// samples the battery from the timer
+static AP_BattMonitor battery_monitor;
+
 ////////////////////////////////////////////////////////////////////////////////
 // SONAR selection
 ////////////////////////////////////////////////////////////////////////////////
@@ -264,7 +285,7 @@ static AP_Camera camera(&relay);
 #endif
 
 // The rover's current location
-static struct 	Location current_loc;
+static struct 	Position current_loc;
 
 
 // Camera/Antenna mount tracking and stabilisation stuff
@@ -376,9 +397,11 @@ static bool rtl_complete = false;
 
 // There may be two active commands in Auto mode.  
 // This indicates the active navigation command by index number
-static uint8_t	nav_command_index;					
+static uint16_t	nav_command_index;
 // This indicates the active non-navigation command by index number
-static uint8_t	non_nav_command_index;				
+static uint16_t	non_nav_command_index;
+// The mission commands, packed into the storage after the parameters
+static AP_MissionStore mission(MISSION_START_BYTE, MISSION_END_BYTE);
 // This is the command type (eg navigate to waypoint) of the active navigation command
 static uint8_t	nav_command_ID		= NO_COMMAND;	
 static uint8_t	non_nav_command_ID	= NO_COMMAND;	
@@ -435,7 +458,7 @@ static float	crosstrack_error;
 static bool ch7_flag;
 // This register tracks the current Mission Command index when writing
 // a mission using CH7 in flight
-static int8_t CH7_wp_index;
+static int16_t CH7_wp_index;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Battery Sensors
@@ -499,9 +522,9 @@ static struct 	Location home;
 // Flag for if we have g_gps lock and have set the home location
 static bool	home_is_set;
 // The location of the previous waypoint.  Used for track following and altitude ramp calculations
-static struct 	Location prev_WP;
+static struct 	Position prev_WP;
 // The location of the current/active waypoint.  Used for track following
-static struct 	Location next_WP;
+static struct 	Position next_WP;
 // The location of the active waypoint in Guided mode.
 static struct  	Location guided_WP;
 
@@ -554,7 +577,7 @@ static float 			load;
   scheduler table - all regular tasks apart from the fast_loop()
   should be listed here, along with how often they should be called
   (in 20ms units) and the maximum time they are expected to take (in
-  microseconds)
+  microseconds). The units stay 20ms whatever the loop rate
  */
 static const AP_Scheduler::Task scheduler_tasks[] PROGMEM = {
     { update_GPS,             5,   2500 },
@@ -562,6 +585,7 @@ static const AP_Scheduler::Task scheduler_tasks[] PROGMEM = {
     { update_compass,         5,   2000 },
     { update_commands,        5,   1000 },
     { update_logging,         5,   1000 },
+    { update_log_erase,       2,    200 },
     { read_battery,           5,   1000 },
     { read_receiver_rssi,     5,   1000 },
     { read_trim_switch,       5,   1000 },
@@ -589,11 +613,14 @@ void setup() {
     vcc_pin = hal.analogin->channel(ANALOG_INPUT_BOARD_VCC);
     batt_volt_pin = hal.analogin->channel(g.battery_volt_pin);
     batt_curr_pin = hal.analogin->channel(g.battery_curr_pin);
+    battery_monitor.init(batt_volt_pin, batt_curr_pin);
 
 	init_ardupilot();
 
     // initialise the main loop scheduler
     scheduler.init(&scheduler_tasks[0], sizeof(scheduler_tasks)/sizeof(scheduler_tasks[0]));
+    scheduler.set_loops_per_tick(loops_per_tick);
+    scheduler.set_loop_period(loop_period_ms * 1000UL);
 }
 
 /*
@@ -603,7 +630,7 @@ void loop()
 {
     uint32_t timer = millis();
 
-    // We want this to execute at 50Hz, but synchronised with the gyro/accel
+    // We want this to execute at the loop rate, but synchronised with the gyro/accel
     uint16_t num_samples = ins.num_samples_available();
     if (num_samples >= 1) {
 		delta_ms_fast_loop	= timer - fast_loopTimer;
@@ -622,17 +649,17 @@ void loop()
 		fast_loopTimeStamp = millis();
     } else {
         uint16_t dt = timer - fast_loopTimer;
-        if (dt < 20) {
-            uint16_t time_to_next_loop = 20 - dt;
+        if (dt < loop_period_ms) {
+            uint16_t time_to_next_loop = loop_period_ms - dt;
             scheduler.run(time_to_next_loop * 1000U);
         }
     }
 }
 
-// Main loop 50Hz
+// Main loop, at LOOP_RATE
 static void fast_loop()
 {
-	// This is the fast loop - we want it to execute at 50Hz if possible
+	// This is the fast loop - we want it to execute at the loop rate if possible
 	// -----------------------------------------------------------------
 	if (delta_ms_fast_loop > G_Dt_max)
 		G_Dt_max = delta_ms_fast_loop;
@@ -652,6 +679,8 @@ static void fast_loop()
 
 	ahrs.update();
 
+    update_ground_speed();
+
     read_sonars();
 
 	// uses the yaw from the DCM to give more accurate turns
@@ -675,6 +704,31 @@ static void fast_loop()
     gcs_data_stream_send();
 }
 
+/*
+  set the loop rate from the LOOP_RATE parameter, before the INS is
+  started. Only 50, 100 and 200Hz are supported
+ */
+static void init_loop_rate(void)
+{
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+    // the APM has no time to spare for a faster loop
+    g.loop_rate.set(50);
+#endif
+    if (g.loop_rate >= 200) {
+        ins_sample_rate = AP_InertialSensor::RATE_200HZ;
+        loop_period_ms = 5;
+        loops_per_tick = 4;
+    } else if (g.loop_rate >= 100) {
+        ins_sample_rate = AP_InertialSensor::RATE_100HZ;
+        loop_period_ms = 10;
+        loops_per_tick = 2;
+    } else {
+        ins_sample_rate = AP_InertialSensor::RATE_50HZ;
+        loop_period_ms = 20;
+        loops_per_tick = 1;
+    }
+}
+
 /*
   update camera mount - 50Hz
  */
@@ -736,6 +790,15 @@ static void update_logging(void)
 
     if (g.log_bitmask & MASK_LOG_NTUN)
         Log_Write_Nav_Tuning();
+
+#if AP_INERTIAL_SENSOR_BATCH
+    if (g.log_bitmask & MASK_LOG_IMU) {
+        AP_InertialSensor_Batch::result vibe;
+        if (ins.batch_update(vibe)) {
+            DataFlash.Log_Write_Vibe(vibe);
+        }
+    }
+#endif
 }
 
 
@@ -841,8 +904,6 @@ static void update_GPS(void)
 				ground_start_count = 0;
 			}
 		}
-        ground_speed   = g_gps->ground_speed_cm * 0.01;
-
 #if CAMERA == ENABLED
         if (camera.update_location(current_loc) == true) {
             do_take_picture();
@@ -851,6 +912,31 @@ static void update_GPS(void)
 	}
 }
 
+/*
+  estimate the ground speed on every loop. It follows the forward
+  acceleration, and is pulled towards the GPS ground speed over
+  SPEED_ESTIMATE_TC seconds, so the speed controller sees changes of
+  speed between GPS fixes and less of the GPS lag
+ */
+static void update_ground_speed(void)
+{
+    if (g_gps == NULL || g_gps->status() < GPS::GPS_OK_FIX_3D) {
+        // keep the last estimate until the GPS is back
+        return;
+    }
+    float gps_speed = g_gps->ground_speed_cm * 0.01f;
+
+    // the accelerometers measure the part of gravity along a slope
+    // as well as the vehicle's acceleration
+    float accel = ins.get_accel().x - GRAVITY_MSS * ahrs.get_trig().sin_pitch;
+
+    ground_speed += (accel + (gps_speed - ground_speed) * (1.0f / SPEED_ESTIMATE_TC)) * G_Dt;
+    if (ground_speed < 0) {
+        // the GPS speed has no direction, so neither does this
+        ground_speed = 0;
+    }
+}
+
 static void update_current_mode(void)
 { 
     switch (control_mode){
@@ -79,7 +79,7 @@ static NOINLINE void send_heartbeat(mavlink_channel_t chan)
     // indicate we have set a custom mode
     base_mode |= MAV_MODE_FLAG_CUSTOM_MODE_ENABLED;
 
-    mavlink_msg_heartbeat_send(
+    mavlink_msg_heartbeat_send_cached(
         chan,
         MAV_TYPE_GROUND_ROVER,
         MAV_AUTOPILOT_ARDUPILOTMEGA,
@@ -186,7 +186,7 @@ static NOINLINE void send_extended_status1(mavlink_channel_t chan, uint16_t pack
         battery_remaining = 150;
     }
 
-    mavlink_msg_sys_status_send(
+    mavlink_msg_sys_status_send_cached(
         chan,
         control_sensors_present,
         control_sensors_enabled,
@@ -455,11 +455,7 @@ static void NOINLINE send_current_waypoint(mavlink_channel_t chan)
 
 static void NOINLINE send_statustext(mavlink_channel_t chan)
 {
-    mavlink_statustext_t *s = (chan == MAVLINK_COMM_0?&gcs0.pending_status:&gcs3.pending_status);
-    mavlink_msg_statustext_send(
-        chan,
-        s->severity,
-        s->text);
+    gcs_statustext.send(chan);
 }
 
 // are we still delaying telemetry to try to avoid Xbee bricking?
@@ -588,6 +584,17 @@ static bool mavlink_try_send_message(mavlink_channel_t chan, enum ap_message id,
         }
         break;
 
+    case MSG_NEXT_LOG:
+#if LOGGING_ENABLED == ENABLED
+        CHECK_PAYLOAD_SIZE(LOG_DATA);
+        if (chan == MAVLINK_COMM_0) {
+            gcs0.queued_log_send();
+        } else if (gcs3.initialised) {
+            gcs3.queued_log_send();
+        }
+#endif
+        break;
+
     case MSG_STATUSTEXT:
         CHECK_PAYLOAD_SIZE(STATUSTEXT);
         send_statustext(chan);
@@ -613,6 +620,11 @@ static bool mavlink_try_send_message(mavlink_channel_t chan, enum ap_message id,
         send_rangefinder(chan);
         break;
 
+    case MSG_MEMCHECK:
+        CHECK_PAYLOAD_SIZE(DATA32);
+        memcheck_send_mavlink(chan);
+        break;
+
     case MSG_RETRY_DEFERRED:
         break; // just here to prevent a warning
 	}
@@ -648,7 +660,11 @@ static void mavlink_send_message(mavlink_channel_t chan, enum ap_message id, uin
     }
 
     if (id == MSG_RETRY_DEFERRED) {
-        return;
+        if (!gcs_statustext.pending(chan)) {
+            return;
+        }
+        // texts go one at a time, so keep asking while more are waiting
+        id = MSG_STATUSTEXT;
     }
 
     // this message id might already be deferred
@@ -685,15 +701,10 @@ void mavlink_send_text(mavlink_channel_t chan, gcs_severity severity, const char
         return;
     }
 
-    if (severity == SEVERITY_LOW) {
-        // send via the deferred queuing system
-        mavlink_statustext_t *s = (chan == MAVLINK_COMM_0?&gcs0.pending_status:&gcs3.pending_status);
-        s->severity = (uint8_t)severity;
-        strncpy((char *)s->text, str, sizeof(s->text));
+    // sent straight away if there is room, otherwise by the deferred
+    // message handling
+    if (gcs_statustext.queue(chan, (uint8_t)severity, str)) {
         mavlink_send_message(chan, MSG_STATUSTEXT, 0);
-    } else {
-        // send immediately
-        mavlink_msg_statustext_send(chan, severity, str);
     }
 }
 
@@ -714,7 +725,9 @@ const AP_Param::GroupInfo GCS_MAVLINK::var_info[] PROGMEM = {
 GCS_MAVLINK::GCS_MAVLINK() :
     packet_drops(0),
     waypoint_send_timeout(1000), // 1 second
-    waypoint_receive_timeout(1000) // 1 second
+    waypoint_receive_timeout(1000), // 1 second
+    _log_next_list_entry(0),
+    _log_num_data(0)
 {
 }
 
@@ -738,43 +751,29 @@ GCS_MAVLINK::update(void)
 {
     // receive new packets
     mavlink_message_t msg;
-    mavlink_status_t status;
-	status.packet_rx_drop_count = 0;
-
-    // process received bytes
-    while (comm_get_available(chan))
-    {
-        uint8_t c = comm_receive_ch(chan);
-
-#if CLI_ENABLED == ENABLED
-        /* allow CLI to be started by hitting enter 3 times, if no
-         *  heartbeat packets have been received */
-        if (mavlink_active == 0 && (millis() - _cli_timeout) < 20000 && 
-            comm_is_idle(chan)) {
-            if (c == '\n' || c == '\r') {
-                crlf_count++;
-            } else {
-                crlf_count = 0;
-            }
-            if (crlf_count == 3) {
-                run_cli(_port);
-            }
+    while (_parser.receive(_port, msg)) {
+        // we exclude radio packets to make it possible to use the
+        // CLI over the radio
+        if (msg.msgid != MAVLINK_MSG_ID_RADIO) {
+            mavlink_active = true;
         }
-#endif
-
-        // Try to get a new message
-        if (mavlink_parse_char(chan, c, &msg, &status)) {
-            // we exclude radio packets to make it possible to use the
-            // CLI over the radio
-            if (msg.msgid != MAVLINK_MSG_ID_RADIO) {
-                mavlink_active = true;
-            }
+        if (mavlink_router.check_and_forward(chan, &msg)) {
             handleMessage(&msg);
         }
     }
 
+#if CLI_ENABLED == ENABLED
+    /* allow CLI to be started by hitting enter 3 times, if no
+     *  heartbeat packets have been received */
+    if (mavlink_active == 0 && (millis() - _cli_timeout) < 20000 &&
+        _parser.crlf_count() >= 3) {
+        _parser.reset_crlf_count();
+        run_cli(_port);
+    }
+#endif
+
     // Update packet drops counter
-    packet_drops += status.packet_rx_drop_count;
+    packet_drops += _parser.take_errors();
 
     if (!waypoint_receiving) {
         return;
@@ -782,9 +781,12 @@ GCS_MAVLINK::update(void)
 
     uint32_t tnow = millis();
 
+    // the next item is only asked for once the storage can take it
+    // without stopping the main loop
     if (waypoint_receiving &&
         waypoint_request_i <= waypoint_request_last &&
-        tnow > waypoint_timelast_request + 500 + (stream_slowdown*20)) {
+        tnow > waypoint_timelast_request + 500 + (stream_slowdown*20) &&
+        hal.storage->write_space() >= AP_MISSIONSTORE_MAX_WRITE) {
         waypoint_timelast_request = tnow;
         send_message(MSG_NEXT_WAYPOINT);
     }
@@ -837,6 +839,13 @@ GCS_MAVLINK::data_stream_send(void)
         }
     }
 
+    if (_log_next_list_entry != 0 || _log_num_data != 0) {
+        // logs use what the link has spare, at the rate of the params
+        if (stream_trigger(STREAM_PARAMS)) {
+            send_message(MSG_NEXT_LOG);
+        }
+    }
+
     if (in_mavlink_delay) {
 #if HIL_MODE != HIL_MODE_DISABLED
         // in HIL we need to keep sending servo values to ensure
@@ -893,6 +902,7 @@ GCS_MAVLINK::data_stream_send(void)
         send_message(MSG_AHRS);
         send_message(MSG_HWSTATUS);
         send_message(MSG_RANGEFINDER);
+        send_message(MSG_MEMCHECK);
     }
 }
 
@@ -921,7 +931,8 @@ GCS_MAVLINK::send_text_P(gcs_severity severity, const prog_char_t *str)
 
 void GCS_MAVLINK::handleMessage(mavlink_message_t* msg)
 {
-    struct Location tell_command = {};                // command for telemetry
+    struct Location tell_command;                     // command for telemetry
+    memset(&tell_command, 0, sizeof(tell_command));
 
     switch (msg->msgid) {
 
@@ -1306,6 +1317,7 @@ void GCS_MAVLINK::handleMessage(mavlink_message_t* msg)
 
             // clear all commands
             g.command_total.set_and_save(0);
+            mission.truncate(1);
 
             // note that we don't send multiple acks, as otherwise a
             // GCS that is doing a clear followed by a set may see
@@ -1341,6 +1353,9 @@ void GCS_MAVLINK::handleMessage(mavlink_message_t* msg)
             }
             g.command_total.set_and_save(packet.count - 1);
 
+            // the new mission replaces all but home, so free its space
+            mission.truncate(1);
+
             waypoint_timelast_receive = millis();
             waypoint_timelast_request = 0;
             waypoint_receiving   = true;
@@ -1529,7 +1544,10 @@ void GCS_MAVLINK::handleMessage(mavlink_message_t* msg)
                     goto mission_failed;
                 }
 
-                set_cmd_with_index(tell_command, packet.seq);
+                if (!set_cmd_with_index(tell_command, packet.seq)) {
+                    result = MAV_MISSION_NO_SPACE;
+                    goto mission_failed;
+                }
 
 				// update waypoint receiving state machine
 				waypoint_timelast_receive = millis();
@@ -1670,6 +1688,23 @@ void GCS_MAVLINK::handleMessage(mavlink_message_t* msg)
             break;
         }
 
+    case MAVLINK_MSG_ID_DATA16:
+    case MAVLINK_MSG_ID_DATA32:
+    case MAVLINK_MSG_ID_DATA64:
+        {
+            // the type, len and data fields are laid out the same in all
+            // three, so the data can go to the GPS straight from the payload
+            const uint8_t *payload = (const uint8_t *)_MAV_PAYLOAD(msg);
+            if (payload[0] == MAVLINK_DATA_TYPE_GPS_INJECT && g_gps != NULL && msg->len > 2) {
+                uint8_t len = payload[1];
+                if (len > msg->len - 2) {
+                    len = msg->len - 2;
+                }
+                g_gps->inject_data(&payload[2], len);
+            }
+            break;
+        }
+
 #if HIL_MODE != HIL_MODE_DISABLED
 	case MAVLINK_MSG_ID_HIL_STATE:
 		{
@@ -1773,6 +1808,15 @@ void GCS_MAVLINK::handleMessage(mavlink_message_t* msg)
         }
         break;
 
+#if LOGGING_ENABLED == ENABLED
+    case MAVLINK_MSG_ID_LOG_REQUEST_LIST:
+    case MAVLINK_MSG_ID_LOG_REQUEST_DATA:
+    case MAVLINK_MSG_ID_LOG_ERASE:
+    case MAVLINK_MSG_ID_LOG_REQUEST_END:
+        handle_log_message(msg);
+        break;
+#endif
+
     } // end switch
 } // end handle mavlink
 
@@ -1803,17 +1847,24 @@ GCS_MAVLINK::queued_param_send()
         return;
     }
 
-    uint16_t bytes_allowed;
-    uint8_t count;
     uint32_t tnow = millis();
 
-    // use at most 30% of bandwidth on parameters. The constant 26 is
-    // 1/(1000 * 1/8 * 0.001 * 0.3)
-    bytes_allowed = g.serial3_baud * (tnow - _queued_parameter_send_time_ms) * 26;
-    if (bytes_allowed > comm_get_txspace(chan)) {
-        bytes_allowed = comm_get_txspace(chan);
+    // pack in as many parameters as fit in the free transmit space,
+    // leaving room for a heartbeat, but no faster than the link can
+    // drain them. serial3_baud is in units of 1000 baud, so the link
+    // moves serial3_baud/8 bytes per millisecond
+    uint32_t bytes_allowed = (uint32_t)g.serial3_baud * (tnow - _queued_parameter_send_time_ms) / 8;
+    uint16_t txspace = comm_get_txspace(chan);
+    const uint16_t reserve = MAVLINK_MSG_ID_HEARTBEAT_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+    txspace = (txspace > reserve) ? txspace - reserve : 0;
+    if (bytes_allowed > txspace) {
+        bytes_allowed = txspace;
+    }
+    uint16_t count = bytes_allowed / (MAVLINK_MSG_ID_PARAM_VALUE_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES);
+    if (count == 0) {
+        // let the budget build up
+        return;
     }
-    count = bytes_allowed / (MAVLINK_MSG_ID_PARAM_VALUE_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES);
 
     while (_queued_parameter != NULL && count--) {
     AP_Param      *vp;
@@ -1842,6 +1893,152 @@ GCS_MAVLINK::queued_param_send()
     _queued_parameter_send_time_ms = tnow;
 }
 
+#if LOGGING_ENABLED == ENABLED
+/**
+ * @brief Start, restart or stop a log transfer. There is no arming, so
+ * logs are only sent in MANUAL, as the flash reads would take time from
+ * the navigation code
+ */
+void GCS_MAVLINK::handle_log_message(mavlink_message_t *msg)
+{
+    if (control_mode != MANUAL) {
+        _log_next_list_entry = 0;
+        _log_num_data = 0;
+        return;
+    }
+
+    switch (msg->msgid) {
+    case MAVLINK_MSG_ID_LOG_REQUEST_LIST: {
+        mavlink_log_request_list_t packet;
+        mavlink_msg_log_request_list_decode(msg, &packet);
+        if (mavlink_check_target(packet.target_system, packet.target_component)) break;
+
+        _log_num_data = 0;
+        _log_num_logs = DataFlash.get_num_logs();
+        _log_last_log_num = DataFlash.find_last_log();
+        if (_log_num_logs == 0) {
+            mavlink_msg_log_entry_send(chan, 0, 0, 0, 0, 0);
+            break;
+        }
+        // the log ids are the log numbers
+        _log_next_list_entry = max(packet.start, (uint16_t)(_log_last_log_num - _log_num_logs + 1));
+        _log_last_list_entry = min(packet.end, _log_last_log_num);
+        if (_log_next_list_entry > _log_last_list_entry) {
+            _log_next_list_entry = 0;
+        }
+        _log_send_time_ms = millis();
+        break;
+    }
+
+    case MAVLINK_MSG_ID_LOG_REQUEST_DATA: {
+        mavlink_log_request_data_t packet;
+        mavlink_msg_log_request_data_decode(msg, &packet);
+        if (mavlink_check_target(packet.target_system, packet.target_component)) break;
+
+        _log_next_list_entry = 0;
+        if (packet.id != _log_num_data) {
+            uint16_t end_page;
+            _log_num_logs = DataFlash.get_num_logs();
+            _log_last_log_num = DataFlash.find_last_log();
+            if (packet.id > _log_last_log_num || packet.id + _log_num_logs <= _log_last_log_num) {
+                _log_num_data = 0;
+                break;
+            }
+            DataFlash.get_log_boundaries(packet.id, _log_data_page, end_page);
+            _log_num_data = packet.id;
+        }
+        // a new request replaces the one being sent, so the GCS can
+        // resume from where it got to, or fill in what it missed
+        _log_data_offset = packet.ofs;
+        _log_data_remaining = packet.count;
+        if (_log_data_remaining == 0) {
+            _log_num_data = 0;
+        }
+        _log_send_time_ms = millis();
+        break;
+    }
+
+    case MAVLINK_MSG_ID_LOG_ERASE: {
+        mavlink_log_erase_t packet;
+        mavlink_msg_log_erase_decode(msg, &packet);
+        if (mavlink_check_target(packet.target_system, packet.target_component)) break;
+
+        _log_next_list_entry = 0;
+        _log_num_data = 0;
+        in_mavlink_delay = true;
+        do_erase_logs();
+        in_mavlink_delay = false;
+        break;
+    }
+
+    case MAVLINK_MSG_ID_LOG_REQUEST_END: {
+        mavlink_log_request_end_t packet;
+        mavlink_msg_log_request_end_decode(msg, &packet);
+        if (mavlink_check_target(packet.target_system, packet.target_component)) break;
+
+        _log_next_list_entry = 0;
+        _log_num_data = 0;
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Send the next log entries or log data, called from deferred
+ * message handling code. Like the parameters this fills the
+ * free transmit space, no faster than the link drains it
+ */
+void
+GCS_MAVLINK::queued_log_send()
+{
+    uint32_t tnow = millis();
+    uint32_t bytes_allowed = (uint32_t)g.serial3_baud * (tnow - _log_send_time_ms) / 8;
+    uint16_t txspace = comm_get_txspace(chan);
+    const uint16_t reserve = MAVLINK_MSG_ID_HEARTBEAT_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+    txspace = (txspace > reserve) ? txspace - reserve : 0;
+    if (bytes_allowed > txspace) {
+        bytes_allowed = txspace;
+    }
+
+    if (_log_next_list_entry != 0) {
+        if (bytes_allowed < MAVLINK_MSG_ID_LOG_ENTRY_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES) {
+            return;
+        }
+        // one entry at a time, as finding a log's size can take a while
+        uint32_t size, time_utc;
+        DataFlash.get_log_info(_log_next_list_entry, size, time_utc);
+        mavlink_msg_log_entry_send(chan, _log_next_list_entry, _log_num_logs, _log_last_log_num, time_utc, size);
+        if (_log_next_list_entry == _log_last_list_entry) {
+            _log_next_list_entry = 0;
+        } else {
+            _log_next_list_entry++;
+        }
+        _log_send_time_ms = tnow;
+        return;
+    }
+
+    uint16_t count = bytes_allowed / (MAVLINK_MSG_ID_LOG_DATA_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES);
+    while (_log_num_data != 0 && count--) {
+        uint8_t data[MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN];
+        uint16_t len = min(_log_data_remaining, (uint32_t)sizeof(data));
+        int16_t ret = DataFlash.get_log_data(_log_num_data, _log_data_page, _log_data_offset, len, data);
+        if (ret < 0) {
+            // the backend is still reading it
+            break;
+        }
+        memset(&data[ret], 0, sizeof(data) - ret);
+        mavlink_msg_log_data_send(chan, _log_num_data, _log_data_offset, ret, data);
+        _log_data_offset += ret;
+        _log_data_remaining -= ret;
+        if (ret == 0 || _log_data_remaining == 0) {
+            // the end of the log, or of the request
+            _log_num_data = 0;
+        }
+        _log_send_time_ms = tnow;
+    }
+}
+#endif // LOGGING_ENABLED
+
 /**
 * @brief Send the next pending waypoint, called from deferred message
 * handling code
@@ -1939,22 +2136,18 @@ static void gcs_send_text_P(gcs_severity severity, const prog_char_t *str)
 
 /*
  *  send a low priority formatted message to the GCS
- *  only one fits in the queue, so if you send more than one before the
- *  last one gets into the serial buffer then the old one will be lost
  */
 void gcs_send_text_fmt(const prog_char_t *fmt, ...)
 {
+    char text[MAVLINK_STATUSTEXT_LEN];
     va_list arg_list;
-    gcs0.pending_status.severity = (uint8_t)SEVERITY_LOW;
     va_start(arg_list, fmt);
-    hal.util->vsnprintf_P((char *)gcs0.pending_status.text,
-            sizeof(gcs0.pending_status.text), fmt, arg_list);
+    hal.util->vsnprintf_P(text, sizeof(text), fmt, arg_list);
     va_end(arg_list);
-    DataFlash.Log_Write_Message(gcs0.pending_status.text);
-    gcs3.pending_status = gcs0.pending_status;
-    mavlink_send_message(MAVLINK_COMM_0, MSG_STATUSTEXT, 0);
+    DataFlash.Log_Write_Message(text);
+    mavlink_send_text(MAVLINK_COMM_0, SEVERITY_LOW, text);
     if (gcs3.initialised) {
-        mavlink_send_message(MAVLINK_COMM_1, MSG_STATUSTEXT, 0);
+        mavlink_send_text(MAVLINK_COMM_1, SEVERITY_LOW, text);
     }
 }
 
@@ -92,11 +92,26 @@ dump_log(uint8_t argc, const Menu::arg *argv)
 }
 
 
+static bool log_erase_running;
+
+// the erase carries on in the background from update_log_erase()
 static void do_erase_logs(void)
 {
 	cliSerial->printf_P(PSTR("\nErasing log...\n"));
-    DataFlash.EraseAll();
-	cliSerial->printf_P(PSTR("\nLog erased.\n"));
+    DataFlash.EraseStart();
+    log_erase_running = true;
+}
+
+static void update_log_erase(void)
+{
+    if (!log_erase_running) {
+        return;
+    }
+    DataFlash.EraseUpdate();
+    if (DataFlash.EraseProgress() == 100) {
+        log_erase_running = false;
+        cliSerial->printf_P(PSTR("\nLog erased.\n"));
+    }
 }
 
 static int8_t
@@ -104,6 +119,17 @@ erase_logs(uint8_t argc, const Menu::arg *argv)
 {
     in_mavlink_delay = true;
     do_erase_logs();
+    // nothing else runs from the CLI, so see the erase through
+    uint8_t last_progress = 0;
+    while (log_erase_running) {
+        update_log_erase();
+        uint8_t progress = DataFlash.EraseProgress();
+        if (progress >= last_progress + 10 && log_erase_running) {
+            cliSerial->printf_P(PSTR("%u%%\n"), (unsigned)progress);
+            last_progress = progress;
+        }
+        hal.scheduler->delay(1);
+    }
     in_mavlink_delay = false;
     return 0;
 }
@@ -194,12 +220,13 @@ static void Log_Write_Performance()
         i2c_lockup_count: hal.i2c->lockup_count()
     };
     DataFlash.WriteBlock(&pkt, sizeof(pkt));
+    DataFlash.Log_Write_Loop(scheduler);
 }
 
 struct PACKED log_Cmd {
     LOG_PACKET_HEADER;
-    uint8_t command_total;
-    uint8_t command_number;
+    uint16_t command_total;
+    uint16_t command_number;
     uint8_t waypoint_id;
     uint8_t waypoint_options;
     uint8_t waypoint_param1;
@@ -209,7 +236,7 @@ struct PACKED log_Cmd {
 };
 
 // Write a command processing packet. Total length : 19 bytes
-static void Log_Write_Cmd(uint8_t num, const struct Location *wp)
+static void Log_Write_Cmd(uint16_t num, const struct Location *wp)
 {
     struct log_Cmd pkt = {
         LOG_PACKET_HEADER_INIT(LOG_CMD_MSG),
@@ -255,7 +282,7 @@ static void Log_Write_Camera()
 struct PACKED log_Startup {
     LOG_PACKET_HEADER;
     uint8_t startup_type;
-    uint8_t command_total;
+    uint16_t command_total;
 };
 
 static void Log_Write_Startup(uint8_t type)
@@ -269,7 +296,7 @@ static void Log_Write_Startup(uint8_t type)
 
     // write all commands to the dataflash as well
     struct Location cmd;
-    for (uint8_t i = 0; i <= g.command_total; i++) {
+    for (uint16_t i = 0; i <= g.command_total; i++) {
         cmd = get_cmd_with_index(i);
         Log_Write_Cmd(i, &cmd);
     }
@@ -458,11 +485,11 @@ static const struct LogStructure log_structure[] PROGMEM = {
     { LOG_PERFORMANCE_MSG, sizeof(log_Performance), 
       "PM",  "IHhBBBhhhhB", "LTime,MLC,gDt,RNCnt,RNBl,GPScnt,GDx,GDy,GDz,PMT,I2CErr" },
     { LOG_CMD_MSG, sizeof(log_Cmd),                 
-      "CMD", "BBBBBeLL",   "CTot,CNum,CId,COpt,Prm1,Alt,Lat,Lng" },
+      "CMD", "HHBBBeLL",   "CTot,CNum,CId,COpt,Prm1,Alt,Lat,Lng" },
     { LOG_CAMERA_MSG, sizeof(log_Camera),                 
       "CAM", "ILLccC",   "GPSTime,Lat,Lng,Roll,Pitch,Yaw" },
     { LOG_STARTUP_MSG, sizeof(log_Startup),         
-      "STRT", "BB",         "SType,CTot" },
+      "STRT", "BH",         "SType,CTot" },
     { LOG_CTUN_MSG, sizeof(log_Control_Tuning),     
       "CTUN", "hcchf",      "Steer,Roll,Pitch,ThrOut,AccY" },
     { LOG_NTUN_MSG, sizeof(log_Nav_Tuning),         
@@ -504,11 +531,12 @@ static void start_logging()
 
 // dummy functions
 static void Log_Write_Startup(uint8_t type) {}
-static void Log_Write_Cmd(uint8_t num, const struct Location *wp) {}
+static void Log_Write_Cmd(uint16_t num, const struct Location *wp) {}
 static void Log_Write_Current() {}
 static void Log_Write_Nav_Tuning() {}
 static void Log_Write_Performance() {}
 static int8_t process_logs(uint8_t argc, const Menu::arg *argv) { return 0; }
+static void update_log_erase(void) {}
 static void Log_Write_Control_Tuning() {}
 static void Log_Write_Sonar() {}
 static void Log_Write_Mode() {}
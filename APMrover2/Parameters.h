@@ -34,6 +34,7 @@ public:
         k_param_initial_mode,
         k_param_scheduler,
         k_param_relay,
+        k_param_loop_rate,
 
         // IO pins
         k_param_rssi_pin = 20,
@@ -156,6 +157,7 @@ public:
         k_param_ins,
         k_param_compass,
         k_param_rcmap,
+        k_param_gps_auto,
 
         // 254,255: reserved
         };
@@ -175,6 +177,8 @@ public:
     AP_Int8     battery_volt_pin;
     AP_Int8     battery_curr_pin;
 
+    AP_Int16    loop_rate;
+
 	// Telemetry control
 	//
 	AP_Int16    sysid_this_mav;
@@ -259,8 +263,8 @@ public:
     
     // Waypoints
     //
-    AP_Int8     command_total;
-    AP_Int8     command_index;
+    AP_Int16    command_total;
+    AP_Int16    command_index;
     AP_Float    waypoint_radius;
 
     // PID controllers
@@ -12,6 +12,7 @@
 #define GSCALAR(v, name, def) { g.v.vtype, name, Parameters::k_param_ ## v, &g.v, {def_value:def} }
 #define GGROUP(v, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## v, &g.v, {group_info:class::var_info} }
 #define GOBJECT(v, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## v, &v, {group_info:class::var_info} }
+#define GOBJECTN(v, pname, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## pname, &v, {group_info:class::var_info} }
 
 const AP_Param::Info var_info[] PROGMEM = {
 	GSCALAR(format_version,         "FORMAT_VERSION",   1),
@@ -39,6 +40,14 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @User: Advanced
 	GSCALAR(initial_mode,        "INITIAL_MODE",     MANUAL),
 
+    // @Param: LOOP_RATE
+    // @DisplayName: Main loop rate
+    // @Description: The rate the steering and throttle controllers and the servo outputs run at. Faster rates cut the time from a sensor reading to the servo output on boards with the processing time to spare. The APM1 and APM2 always run at 50Hz. Takes effect after a reboot
+    // @Units: Hz
+    // @Values: 50:50Hz,100:100Hz,200:200Hz
+    // @User: Advanced
+    GSCALAR(loop_rate,           "LOOP_RATE",        50),
+
     // @Param: RSSI_PIN
     // @DisplayName: Receiver RSSI sensing pin
     // @Description: This selects an analog pin for the receiver RSSI voltage. It assumes the voltage is 5V for max rssi, 0V for minimum
@@ -446,6 +455,12 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @Path: ../libraries/AP_Compass/Compass.cpp
 	GOBJECT(compass,                "COMPASS_",	Compass),
 
+#if GPS_PROTOCOL == GPS_PROTOCOL_AUTO
+    // @Group: GPS_
+    // @Path: ../libraries/AP_GPS/AP_GPS_Auto.cpp
+    GOBJECTN(g_gps_driver, gps_auto, "GPS_", AP_GPS_Auto),
+#endif
+
     // @Group: SCHED_
     // @Path: ../libraries/AP_Scheduler/AP_Scheduler.cpp
     GOBJECT(scheduler, "SCHED_", AP_Scheduler),
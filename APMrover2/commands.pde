@@ -3,7 +3,7 @@
 /* Functions in this file:
 	void init_commands()
 	struct Location get_cmd_with_index(int i)
-	void set_cmd_with_index(struct Location temp, int i)
+	bool set_cmd_with_index(struct Location temp, int i)
 	void increment_cmd_index()
 	void decrement_cmd_index()
 	long read_alt_to_hold()
@@ -20,6 +20,7 @@ static void init_commands()
 	nav_command_ID	= NO_COMMAND;
 	non_nav_command_ID	= NO_COMMAND;
 	next_nav_command.id 	= CMD_BLANK;
+	mission.reset_jumps();
 }
 
 // Getters
@@ -27,32 +28,10 @@ static void init_commands()
 static struct Location get_cmd_with_index(int i)
 {
 	struct Location temp;
-	uint16_t mem;
 
-	// Find out proper location in memory by using the start_byte position + the index
-	// --------------------------------------------------------------------------------
-	if (i > g.command_total) {
+	if (i > g.command_total || !mission.read(i, temp)) {
 		memset(&temp, 0, sizeof(temp));
 		temp.id = CMD_BLANK;
-	}else{
-		// read WP position
-		mem = (WP_START_BYTE) + (i * WP_SIZE);
-		temp.id = hal.storage->read_byte(mem);
-
-		mem++;
-		temp.options = hal.storage->read_byte(mem);
-
-		mem++;
-		temp.p1 = hal.storage->read_byte(mem);
-
-		mem++;
-		temp.alt = (long)hal.storage->read_dword(mem);
-
-		mem += 4;
-		temp.lat = (long)hal.storage->read_dword(mem);
-
-		mem += 4;
-		temp.lng = (long)hal.storage->read_dword(mem);
 	}
 
 	// Add on home altitude if we are a nav command (or other command with altitude) and stored alt is relative
@@ -65,10 +44,9 @@ static struct Location get_cmd_with_index(int i)
 
 // Setters
 // -------
-static void set_cmd_with_index(struct Location temp, int i)
+static bool set_cmd_with_index(struct Location temp, int i)
 {
 	i = constrain_int16(i, 0, g.command_total.get());
-	uint16_t mem = WP_START_BYTE + (i * WP_SIZE);
 
 	// Set altitude options bitmask
 	// XXX What is this trying to do?
@@ -78,22 +56,7 @@ static void set_cmd_with_index(struct Location temp, int i)
 		temp.options = 0;
 	}
 
-	hal.storage->write_byte(mem, temp.id);
-
-    mem++;
-	hal.storage->write_byte(mem, temp.options);
-
-	mem++;
-	hal.storage->write_byte(mem, temp.p1);
-
-	mem++;
-	hal.storage->write_dword(mem, temp.alt);
-
-	mem += 4;
-	hal.storage->write_dword(mem, temp.lat);
-
-	mem += 4;
-	hal.storage->write_dword(mem, temp.lng);
+	return mission.write(i, temp);
 }
 
 /*
@@ -310,23 +310,27 @@ static bool verify_within_distance()
 static void do_jump()
 {
 	struct Location temp;
-	gcs_send_text_fmt(PSTR("In jump.  Jumps left: %i"),next_nonnav_command.lat);
-	if(next_nonnav_command.lat > 0) {
+	int16_t jumps = mission.jumps_left(g.command_index, next_nonnav_command.lat);
+	gcs_send_text_fmt(PSTR("In jump.  Jumps left: %i"),jumps);
+	if(jumps > 0) {
 
 		nav_command_ID		= NO_COMMAND;
 		next_nav_command.id = NO_COMMAND;
 		non_nav_command_ID 	= NO_COMMAND;
 		
-		temp 				= get_cmd_with_index(g.command_index);
-		temp.lat 			= next_nonnav_command.lat - 1;					// Decrement repeat counter
-
-		set_cmd_with_index(temp, g.command_index);
+		if (!mission.count_jump(g.command_index, next_nonnav_command.lat)) {
+			// no room to count it in RAM, so decrement the repeat counter
+			// in the command
+			temp 				= get_cmd_with_index(g.command_index);
+			temp.lat 			= jumps - 1;
+			set_cmd_with_index(temp, g.command_index);
+		}
 	gcs_send_text_fmt(PSTR("setting command index: %i"),next_nonnav_command.p1 - 1);
 		g.command_index.set_and_save(next_nonnav_command.p1 - 1);
 		nav_command_index 	= next_nonnav_command.p1 - 1;
 		next_WP = prev_WP;		// Need to back "next_WP" up as it was set to the next waypoint following the jump
 		process_next_command();
-	} else if (next_nonnav_command.lat == -1) {								// A repeat count of -1 = repeat forever
+	} else if (jumps == -1) {								// A repeat count of -1 = repeat forever
 		nav_command_ID 	= NO_COMMAND;
 		non_nav_command_ID 	= NO_COMMAND;
 	gcs_send_text_fmt(PSTR("setting command index: %i"),next_nonnav_command.p1 - 1);
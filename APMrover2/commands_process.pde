@@ -2,7 +2,7 @@
 
 // For changing active command mid-mission
 //----------------------------------------
-static void change_command(uint8_t cmd_index)
+static void change_command(uint16_t cmd_index)
 {
 	struct Location temp = get_cmd_with_index(cmd_index);
 
@@ -50,17 +50,14 @@ static void process_next_command()
 	// and loads conditional or immediate commands if applicable
 
 	struct Location temp;
-	uint8_t old_index = 0;
+	uint16_t old_index = 0;
 
 	// these are Navigation/Must commands
 	// ---------------------------------
 	if (nav_command_ID == NO_COMMAND){ // no current navigation command loaded
 		old_index = nav_command_index;
-		temp.id = MAV_CMD_NAV_LAST;
-		while(temp.id >= MAV_CMD_NAV_LAST && nav_command_index <= g.command_total) {
-			nav_command_index++;
-			temp = get_cmd_with_index(nav_command_index);
-		}
+		nav_command_index = mission.next_nav(nav_command_index + 1);
+		temp = get_cmd_with_index(nav_command_index);
 
 		gcs_send_text_fmt(PSTR("Nav command index updated to #%i"),nav_command_index);
 
@@ -73,6 +73,7 @@ static void read_trim_switch()
                     g.command_total = 0;
                     g.command_index =0;
                     nav_command_index = 0;
+                    mission.truncate(1);
                     if (channel_steer->control_in > 3000) {
 						// if roll is full right store the current location as home
                         init_home();
@@ -84,7 +85,10 @@ static void read_trim_switch()
                     // set the next_WP (home is stored at 0)
 
                     hal.console->printf_P(PSTR("Learning waypoint %u"), (unsigned)CH7_wp_index);        
-                    current_loc.id = MAV_CMD_NAV_WAYPOINT;  
+                    struct Location cmd;
+                    memset(&cmd, 0, sizeof(cmd));
+                    cmd.id = MAV_CMD_NAV_WAYPOINT;
+                    cmd.set_position(current_loc);
     
                     // store the index
                     g.command_total.set_and_save(CH7_wp_index);
@@ -93,7 +97,7 @@ static void read_trim_switch()
                     nav_command_index = 0;
                                    
                     // save command
-                    set_cmd_with_index(current_loc, CH7_wp_index);
+                    set_cmd_with_index(cmd, CH7_wp_index);
                                   
                     // increment index
                     CH7_wp_index++; 
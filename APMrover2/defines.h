@@ -104,11 +104,13 @@ enum ap_message {
     MSG_SERVO_OUT,
     MSG_NEXT_WAYPOINT,
     MSG_NEXT_PARAM,
+    MSG_NEXT_LOG,
     MSG_STATUSTEXT,
     MSG_AHRS,
     MSG_SIMSTATE,
     MSG_HWSTATUS,
     MSG_RANGEFINDER,
+    MSG_MEMCHECK,
     MSG_RETRY_DEFERRED // this must be last
 };
 
@@ -165,9 +167,6 @@ enum ap_message {
 #define	ALTITUDE_HISTORY_LENGTH 8	//Number of (time,altitude) points to regress a climb rate from
 
 
-#define BATTERY_VOLTAGE(x) (x->voltage_average()*g.volt_div_ratio)
-#define CURRENT_AMPS(x) (x->voltage_average()-CURR_AMPS_OFFSET)*g.curr_amp_per_volt
-
 #define RELAY_PIN 47
 
 
@@ -185,9 +184,19 @@ enum ap_message {
 #define EEPROM_MAX_ADDR		4096
 // parameters get the first 1KiB of EEPROM, remainder is for waypoints
 #define WP_START_BYTE 0x500 // where in memory home WP is stored + all other WP
-#define WP_SIZE 15
 
-#define MAX_WAYPOINTS  ((EEPROM_MAX_ADDR - WP_START_BYTE) / WP_SIZE) - 1 // - 1 to be safe
+// the mission goes after the parameters. The PX4 storage is 16k, so
+// there it goes in the space after the APM layout
+#if CONFIG_HAL_BOARD == HAL_BOARD_PX4
+ # define MISSION_START_BYTE EEPROM_MAX_ADDR
+ # define MISSION_END_BYTE   16384
+#else
+ # define MISSION_START_BYTE WP_START_BYTE
+ # define MISSION_END_BYTE   EEPROM_MAX_ADDR
+#endif
+
+// the most commands that can fit, if they are all short ones
+#define MAX_WAYPOINTS AP_MISSIONSTORE_MAX_COMMANDS(MISSION_START_BYTE, MISSION_END_BYTE)
 
 // convert a boolean (0 or 1) to a sign for multiplying (0 maps to 1, 1 maps to -1)
 #define BOOL_TO_SIGN(bvalue) ((bvalue)?-1:1)
@@ -21,24 +21,18 @@ static void read_battery(void)
 		return;
 	}
 	
-    if(g.battery_monitoring == 3 || g.battery_monitoring == 4) {
-        // this copes with changing the pin at runtime
-        batt_volt_pin->set_pin(g.battery_volt_pin);
-        battery_voltage1 = BATTERY_VOLTAGE(batt_volt_pin);
+    // the timer samples the battery and integrates the current
+    battery_monitor.set_config(g.battery_monitoring == 4,
+                               g.battery_volt_pin, g.volt_div_ratio,
+                               g.battery_curr_pin, g.curr_amp_per_volt, CURR_AMPS_OFFSET);
+    bool new_voltage = battery_monitor.read();
+    if ((g.battery_monitoring == 3 || g.battery_monitoring == 4) && new_voltage) {
+        battery_voltage1 = battery_monitor.voltage();
     }
 
     if (g.battery_monitoring == 4) {
-        static uint32_t last_time_ms;
-        uint32_t tnow = hal.scheduler->millis();
-        float dt = tnow - last_time_ms;
-        if (last_time_ms != 0 && dt < 2000) {
-            // this copes with changing the pin at runtime
-            batt_curr_pin->set_pin(g.battery_curr_pin);
-            current_amps1    = CURRENT_AMPS(batt_curr_pin);
-            // .0002778 is 1/3600 (conversion to hours)
-            current_total1   += current_amps1 * dt * 0.0002778f; 
-        }
-        last_time_ms = tnow;
+        current_amps1    = battery_monitor.current_amps();
+        current_total1   = battery_monitor.current_total_mah();
     }
 }
 
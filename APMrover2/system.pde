@@ -110,7 +110,7 @@ static void init_ardupilot()
 	// on the message set configured.
 	//
     // standard gps running
-    hal.uartB->begin(115200, 128, 16);
+    hal.uartB->begin(115200, 128, GPS_PORT_TX_BUFFER_SIZE);
 
 	cliSerial->printf_P(PSTR("\n\nInit " THISFIRMWARE
 						 "\n\nFree RAM: %u\n"),
@@ -122,6 +122,14 @@ static void init_ardupilot()
 	
     load_parameters();
 
+    // a mission stored in an older layout can't be read
+    if (!mission.init()) {
+        g.command_total.set_and_save(0);
+    }
+
+    // the INS sample rate follows the loop rate
+    init_loop_rate();
+
     set_control_channels();
 
     // after parameter load setup correct baud rate on uartA
@@ -154,6 +162,7 @@ static void init_ardupilot()
 
 #if LOGGING_ENABLED == ENABLED
 	DataFlash.Init(); 	// DataFlash log initialization
+    DataFlash.set_retention(LOG_RETAIN_LOGS, LOG_RETAIN_MB);
     if (!DataFlash.CardInserted()) {
         gcs_send_text_P(SEVERITY_LOW, PSTR("No dataflash card inserted"));
         g.log_bitmask.set(0);
@@ -250,6 +259,10 @@ static void init_ardupilot()
 	// set the correct flight mode
 	// ---------------------------
 	reset_control_switch();
+
+    // anything allocated from now on comes from the heap
+    arena_freeze();
+    cliSerial->printf_P(PSTR("Arena: %u/%u\n"), arena_used(), (unsigned)AP_ARENA_SIZE);
 }
 
 //********************************************************************************
@@ -444,6 +457,7 @@ static void resetPerfData(void) {
 	gps_fix_count 			= 0;
 	pmTest1					= 0;
 	perf_mon_timer 			= millis();
+	scheduler.reset_task_stats();
 }
 
 
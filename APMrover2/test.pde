@@ -279,7 +279,7 @@ test_wp(uint8_t argc, const Menu::arg *argv)
 	cliSerial->printf_P(PSTR("%u waypoints\n"), (unsigned)g.command_total);
 	cliSerial->printf_P(PSTR("Hit radius: %f\n"), g.waypoint_radius);
 
-	for(uint8_t i = 0; i <= g.command_total; i++){
+	for(uint16_t i = 0; i <= g.command_total; i++){
 		struct Location temp = get_cmd_with_index(i);
 		test_wp_print(&temp, i);
 	}
@@ -288,7 +288,7 @@ test_wp(uint8_t argc, const Menu::arg *argv)
 }
 
 static void
-test_wp_print(const struct Location *cmd, uint8_t wp_index)
+test_wp_print(const struct Location *cmd, uint16_t wp_index)
 {
 	cliSerial->printf_P(PSTR("command #: %d id:%d options:%d p1:%d p2:%ld p3:%ld p4:%ld \n"),
 		(int)wp_index,
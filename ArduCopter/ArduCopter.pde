@@ -86,6 +86,8 @@
 #include <AP_AHRS.h>
 #include <APM_PI.h>             // PI library
 #include <AC_PID.h>             // PID library
+#include <AC_PID_Q.h>           // fixed point PID library
+#include <AC_PID3.h>            // three axis PID library
 #include <RC_Channel.h>         // RC Channel Library
 #include <AP_Motors.h>          // AP Motors library
 #include <AP_RangeFinder.h>     // Range finder library
@@ -96,6 +98,7 @@
 #include <AP_Camera.h>          // Photo or video camera
 #include <AP_Mount.h>           // Camera/Antenna mount
 #include <AP_Airspeed.h>        // needed for AHRS build
+#include <AP_BattMonitor.h>     // Battery voltage and current
 #include <AP_InertialNav.h>     // ArduPilot Mega inertial navigation library
 #include <AC_WPNav.h>     		// ArduCopter waypoint navigation library
 #include <AP_Declination.h>     // ArduPilot Mega Declination Helper Library
@@ -104,6 +107,9 @@
 #include <SITL.h>               // software in the loop support
 #include <AP_Scheduler.h>       // main loop scheduler
 #include <AP_RCMapper.h>        // RC input mapping library
+#include <AP_MissionStore.h>    // packed mission storage
+#include <AP_Terrain.h>         // terrain heights from the GCS
+#include <AP_Rally.h>           // rally points to return to
 
 // AP_HAL to Arduino compatibility layer
 #include "compat.h"
@@ -166,6 +172,17 @@ static DataFlash_File DataFlash("/fs/microsd/APM/logs");
 static DataFlash_Empty DataFlash;
 #endif
 
+////////////////////////////////////////////////////////////////////////////////
+// Terrain
+////////////////////////////////////////////////////////////////////////////////
+#if AP_TERRAIN_AVAILABLE
+#if CONFIG_HAL_BOARD == HAL_BOARD_PX4
+static AP_Terrain terrain("/fs/microsd/APM/TERRAIN.DAT");
+#else
+static AP_Terrain terrain("terrain.dat");
+#endif
+#endif
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // the rate we run the main loop at
@@ -237,7 +254,17 @@ static AP_Compass_HMC5843 compass;
 
 // real GPS selection
  #if   GPS_PROTOCOL == GPS_PROTOCOL_AUTO
+  #if GPS2_ENABLED == ENABLED
+// each receiver has its own pointer, which detection fills in, and
+// g_gps points at the blend of the two
+static GPS         *g_gps1;
+static GPS         *g_gps2;
+AP_GPS_Auto     g_gps_driver(&g_gps1);
+AP_GPS_Auto     g_gps2_driver(&g_gps2);
+AP_GPS_Blend    g_gps_blend(&g_gps1, &g_gps2);
+  #else
 AP_GPS_Auto     g_gps_driver(&g_gps);
+  #endif
 
  #elif GPS_PROTOCOL == GPS_PROTOCOL_NMEA
 AP_GPS_NMEA     g_gps_driver;
@@ -263,6 +290,10 @@ AP_GPS_None     g_gps_driver;
 
  #if DMP_ENABLED == ENABLED && CONFIG_HAL_BOARD == HAL_BOARD_APM2
 static AP_AHRS_MPU6000  ahrs(&ins, g_gps);               // only works with APM2
+ #elif AHRS_QUATERNION_ENABLED == ENABLED
+static AP_AHRS_Quaternion ahrs(&ins, g_gps);
+ #elif AP_AHRS_NAVEKF_AVAILABLE
+static AP_AHRS_NavEKF ahrs(&ins, g_gps);                 // EKF selected by AHRS_EKF_USE
  #else
 static AP_AHRS_DCM ahrs(&ins, g_gps);
  #endif
@@ -307,6 +338,16 @@ static SITL sitl;
  #error Unrecognised HIL_MODE setting.
 #endif // HIL MODE
 
+#if COMPASS_CAL == ENABLED
+// background compass calibration, when COMPASS_LEARN is 2
+static CompassCalibrator compass_cal(compass);
+#endif
+
+#if AP_INERTIAL_SENSOR_ACCEL_CAL
+// background accel calibration, when INS_ACC_LEARN is 1
+static AP_InertialSensor_AccelCal accel_cal(ins);
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Optical flow sensor
 ////////////////////////////////////////////////////////////////////////////////
@@ -321,12 +362,16 @@ static AP_OpticalFlow optflow;
 ////////////////////////////////////////////////////////////////////////////////
 static GCS_MAVLINK gcs0;
 static GCS_MAVLINK gcs3;
+// passes on messages between the two links
+static MAVLink_routing mavlink_router;
+// texts waiting to go to the two links
+static MAVLink_statustext gcs_statustext;
 
 ////////////////////////////////////////////////////////////////////////////////
 // SONAR selection
 ////////////////////////////////////////////////////////////////////////////////
 //
-ModeFilterInt16_Size3 sonar_mode_filter(1);
+MedianFilterInt16_Size3 sonar_mode_filter(1);
 #if CONFIG_SONAR == ENABLED
 static AP_HAL::AnalogSource *sonar_analog_source;
 static AP_RangeFinder_MaxsonarXL *sonar;
@@ -448,9 +493,22 @@ static MOTOR_CLASS motors(&g.rc_1, &g.rc_2, &g.rc_3, &g.rc_4);
 ////////////////////////////////////////////////////////////////////////////////
 // PIDs
 ////////////////////////////////////////////////////////////////////////////////
-// This is a convienience accessor for the IMU roll rates. It's currently the raw IMU rates
-// and not the adjusted omega rates, but the name is stuck
-static Vector3f omega;
+#if RATE_PID_VECTOR == ENABLED && FRAME_CONFIG != HELI_FRAME
+// the roll, pitch and yaw rate controllers, with the gains of g.pid_rate_roll, pitch and yaw
+static AC_PID3 rate_pid3(g.pid_rate_roll, g.pid_rate_pitch, g.pid_rate_yaw);
+#endif
+// last target angles, the time they were set and the filtered feed forward rates
+// from them, for roll, pitch and yaw. Used by get_stabilize_rate_ff
+static int32_t stabilize_ff_target[3];
+static uint32_t stabilize_ff_last_ms[3];
+static float stabilize_ff_rate[3];
+#if STABILIZE_ATTITUDE_VECTOR == ENABLED
+// the target angles given to get_stabilize_roll, pitch and yaw on this loop,
+// and a bit for each axis that was given one
+static int32_t stabilize_target[3];
+static uint8_t stabilize_target_axes;
+#endif
+
 // This is used to hold radio tuning values for in-flight CH6 tuning
 float tuning_value;
 // used to limit the rate that the pid controller output is logged so that it doesn't negatively affect performance
@@ -476,12 +534,6 @@ static int8_t copter_leds_nav_blink;
 // 10^7 times Decimal GPS means 1 == 1cm
 // This approximation makes calculations integer and it's easy to read
 static const float t7 = 10000000.0;
-// We use atan2 and other trig techniques to calaculate angles
-// We need to scale the longitude up to make these calcs work
-// to account for decreasing distance between lines of longitude away from the equator
-static float scaleLongUp = 1;
-// Sometimes we need to remove the scaling for distance calcs
-static float scaleLongDown = 1;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Location & Navigation
@@ -496,39 +548,107 @@ static int32_t home_bearing;
 static int32_t home_distance;
 // distance between plane and next waypoint in cm.
 static uint32_t wp_distance;
-// navigation mode - options include NAV_NONE, NAV_LOITER, NAV_CIRCLE, NAV_WP
+// navigation mode - options include NAV_NONE, NAV_LOITER, NAV_CIRCLE, NAV_WP, NAV_FOLLOW
 static uint8_t nav_mode;
+// time in milliseconds the GCS last sent the position of the target we are following
+static uint32_t follow_target_ms;
 // Register containing the index of the current navigation command in the mission script
 static int16_t command_nav_index;
 // Register containing the index of the previous navigation command in the mission script
 // Used to manage the execution of conditional commands
-static uint8_t prev_nav_index;
+static int16_t prev_nav_index;
 // Register containing the index of the current conditional command in the mission script
-static uint8_t command_cond_index;
+static int16_t command_cond_index;
+// The mission commands, packed into the storage after the parameters
+static AP_MissionStore mission(MISSION_START_BYTE, MISSION_END_BYTE);
+// The rally points, stored after the mission
+static AP_Rally rally(RALLY_START_BYTE, MAX_RALLYPOINTS);
+// Decoded copies of the commands from the current nav command on, filled by the slow loop so the look-ahead
+// and the move to the next waypoint don't wait for storage.  Command i is held in slot i % CMD_CACHE_SIZE
+static struct Location cmd_cache[CMD_CACHE_SIZE];
+// position vector of each cached command
+static Vector3f cmd_cache_pos[CMD_CACHE_SIZE];
+// index + 1 of the command held in each slot, 0 if the slot is empty
+static uint8_t cmd_cache_index[CMD_CACHE_SIZE];
 // Used to track the required WP navigation information
 // options include
 // NAV_ALTITUDE - have we reached the desired altitude?
 // NAV_LOCATION - have we reached the desired location?
 // NAV_DELAY    - have we waited at the waypoint the desired time?
 static float lon_error, lat_error;      // Used to report how many cm we are from the next waypoint or loiter target position
-static int16_t control_roll;
-static int16_t control_pitch;
 static uint8_t rtl_state;               // records state of rtl (initial climb, returning home, etc)
+static Vector3f rtl_target;             // where rtl returns to in cm from home, at home or the nearest rally point. z is zero
 static uint8_t land_state;              // records state of land (flying to location, descending)
 
 ////////////////////////////////////////////////////////////////////////////////
-// Orientation
-////////////////////////////////////////////////////////////////////////////////
-// Convienience accessors for commonly used trig functions. These values are generated
-// by the DCM through a few simple equations. They are used throughout the code where cos and sin
-// would normally be used.
-// The cos values are defaulted to 1 to get a decent initial value for a level state
-static float cos_roll_x         = 1.0;
-static float cos_pitch_x        = 1.0;
-static float cos_yaw            = 1.0;
-static float sin_yaw;
-static float sin_roll;
-static float sin_pitch;
+// Fast loop state
+////////////////////////////////////////////////////////////////////////////////
+// Everything the 100Hz attitude loop reads and writes on each pass,
+// kept together so the loop works on a few cache lines rather than
+// variables scattered over RAM
+static struct Fast_Loop_State {
+    // This is a convienience accessor for the IMU roll rates. It's currently the raw IMU rates
+    // and not the adjusted omega rates, but the name is stuck
+    Vector3f omega;
+
+    // Convienience accessors for commonly used trig functions, worked out by the AHRS.
+    // The cos values are defaulted to 1 to get a decent initial value for a level state
+    float cos_roll_x;
+    float cos_pitch_x;
+    float cos_yaw;
+    float sin_yaw;
+    float sin_roll;
+    float sin_pitch;
+
+    // Rate contoller targets
+    uint8_t rate_targets_frame;         // indicates whether rate targets provided in earth or body frame
+    int32_t roll_rate_target_ef;
+    int32_t pitch_rate_target_ef;
+    int32_t yaw_rate_target_ef;
+    int32_t roll_rate_target_bf;        // body frame roll rate target
+    int32_t pitch_rate_target_bf;       // body frame pitch rate target
+    int32_t yaw_rate_target_bf;         // body frame yaw rate target
+
+    Fast_Loop_State() :
+        cos_roll_x(1.0f),
+        cos_pitch_x(1.0f),
+        cos_yaw(1.0f),
+        rate_targets_frame(EARTH_FRAME)
+    {}
+} fast;
+
+////////////////////////////////////////////////////////////////////////////////
+// Topics
+////////////////////////////////////////////////////////////////////////////////
+// The sensor samples and estimates of each loop, published for the GCS
+// and logging to read consistent copies of without reaching into the
+// libraries that made them
+struct ins_sample {
+    uint32_t time_ms;
+    Vector3f accel;                 // m/s/s
+    Vector3f gyro;                  // rad/s
+};
+
+struct attitude_estimate {
+    uint32_t time_ms;
+    float roll, pitch, yaw;         // radians
+    int32_t roll_sensor;            // centi-degrees
+    int32_t pitch_sensor;
+    int32_t yaw_sensor;
+    Vector3f omega;                 // rad/s
+};
+
+struct nav_estimate {
+    uint32_t time_ms;
+    Vector3f position;              // cm from home
+    Vector3f velocity;              // cm/s
+};
+
+static struct {
+    Topic<struct ins_sample>        ins;
+    Topic<struct attitude_estimate> attitude;
+    Topic<struct nav_estimate>      nav;
+} topics;
 
 ////////////////////////////////////////////////////////////////////////////////
 // SIMPLE Mode
@@ -541,17 +661,6 @@ static int32_t initial_simple_bearing;
 static int32_t initial_armed_bearing;
 
 
-////////////////////////////////////////////////////////////////////////////////
-// Rate contoller targets
-////////////////////////////////////////////////////////////////////////////////
-static uint8_t rate_targets_frame = EARTH_FRAME;    // indicates whether rate targets provided in earth or body frame
-static int32_t roll_rate_target_ef;
-static int32_t pitch_rate_target_ef;
-static int32_t yaw_rate_target_ef;
-static int32_t roll_rate_target_bf;     // body frame roll rate target
-static int32_t pitch_rate_target_bf;    // body frame pitch rate target
-static int32_t yaw_rate_target_bf;      // body frame yaw rate target
-
 ////////////////////////////////////////////////////////////////////////////////
 // Throttle variables
 ////////////////////////////////////////////////////////////////////////////////
@@ -579,6 +688,7 @@ static int32_t pitch_axis;
 // Circle Mode / Loiter control
 ////////////////////////////////////////////////////////////////////////////////
 Vector3f circle_center;     // circle position expressed in cm from home location.  x = lat, y = lon
+static Orbit circle_orbit;  // the target's offset from circle_center, moved round at the angular velocity
 // angle from the circle center to the copter's desired location.  Incremented at circle_rate / second
 static float circle_angle;
 // the total angle (in radians) travelled
@@ -618,13 +728,14 @@ static float current_total1;
 ////////////////////////////////////////////////////////////////////////////////
 // The (throttle) controller desired altitude in cm
 static float controller_desired_alt;
+// The cm the terrain below us is above the terrain at home when following the terrain
+static int32_t terrain_offset_cm;
 // The cm we are off in altitude from next_WP.alt – Positive value means we are below the WP
 static int32_t altitude_error;
 // The cm/s we are moving up or down based on filtered data - Positive = UP
 static int16_t climb_rate;
 // The altitude as reported by Sonar in cm – Values are 20 to 700 generally.
 static int16_t sonar_alt;
-static uint8_t sonar_alt_health;   // true if we can trust the altitude from the sonar
 // The altitude as reported by Baro in cm – Values can be quite high
 static int32_t baro_alt;
 
@@ -671,11 +782,15 @@ static struct   Location command_cond_queue;
 ////////////////////////////////////////////////////////////////////////////////
 // Navigation Roll/Pitch functions
 ////////////////////////////////////////////////////////////////////////////////
-// all angles are deg * 100 : target yaw angle
-// The Commanded ROll from the autopilot.
-static int32_t nav_roll;
-// The Commanded pitch from the autopilot. negative Pitch means go forward.
-static int32_t nav_pitch;
+// all angles are deg * 100. The angles the stabilize controllers are
+// steering to, read by the GCS and logs as a snapshot of the struct
+static struct Nav_State {
+    int32_t roll;               // The Commanded ROll from the autopilot.
+    int32_t pitch;              // The Commanded pitch from the autopilot. negative Pitch means go forward.
+    int32_t yaw;                // The Commanded Yaw from the autopilot.
+    int16_t control_roll;       // the pilot's roll and pitch, for reporting
+    int16_t control_pitch;
+} nav;
 
 // The Commanded ROll from the autopilot based on optical flow sensor.
 static int32_t of_roll;
@@ -696,8 +811,6 @@ static uint32_t throttle_integrator;
 ////////////////////////////////////////////////////////////////////////////////
 // Navigation Yaw control
 ////////////////////////////////////////////////////////////////////////////////
-// The Commanded Yaw from the autopilot.
-static int32_t nav_yaw;
 static uint8_t yaw_timer;
 // Yaw will point at this location if yaw_mode is set to YAW_LOOK_AT_LOCATION
 static Vector3f yaw_look_at_WP;
@@ -799,6 +912,9 @@ static AP_HAL::AnalogSource* batt_volt_analog_source;
 static AP_HAL::AnalogSource* batt_curr_analog_source;
 static AP_HAL::AnalogSource* board_vcc_analog_source;
 
+// samples the battery from the timer
+static AP_BattMonitor battery_monitor;
+
 
 #if CLI_ENABLED == ENABLED
     static int8_t   setup_show (uint8_t argc, const Menu::arg *argv);
@@ -844,6 +960,11 @@ AP_Param param_loader(var_info, WP_START_BYTE);
   (in 10ms units) and the maximum time they are expected to take (in
   microseconds)
  */
+#if SCHEDULER_OFFLOAD == ENABLED
+ # define SCHED_OFF_MAIN AP_SCHEDULER_FLAG_OFF_MAIN
+#else
+ # define SCHED_OFF_MAIN 0
+#endif
 static const AP_Scheduler::Task scheduler_tasks[] PROGMEM = {
     { update_GPS,            2,     900 },
     { update_navigation,     10,    500 },
@@ -854,11 +975,14 @@ static const AP_Scheduler::Task scheduler_tasks[] PROGMEM = {
     { slow_loop,            10,     500 },
     { gcs_check_input,	     2,     700 },
     { gcs_send_heartbeat,  100,     700 },
-    { gcs_data_stream_send,  2,    1500 },
+    { gcs_data_stream_send,  2,    1500, SCHED_OFF_MAIN },
     { gcs_send_deferred,     2,    1200 },
     { compass_accumulate,    2,     700 },
     { barometer_accumulate,  2,     900 },
     { super_slow_loop,     100,    1100 },
+    { update_log_erase,      5,     200 },
+    { update_terrain,       10,     600 },
+    { update_rally,         10,     500 },
     { perf_update,        1000,     500 }
 };
 
@@ -889,12 +1013,14 @@ void setup() {
     rssi_analog_source      = hal.analogin->channel(g.rssi_pin);
     batt_volt_analog_source = hal.analogin->channel(g.battery_volt_pin);
     batt_curr_analog_source = hal.analogin->channel(g.battery_curr_pin);
+    battery_monitor.init(batt_volt_analog_source, batt_curr_analog_source);
     board_vcc_analog_source = hal.analogin->channel(ANALOG_INPUT_BOARD_VCC);
 
     init_ardupilot();
 
     // initialise the main loop scheduler
     scheduler.init(&scheduler_tasks[0], sizeof(scheduler_tasks)/sizeof(scheduler_tasks[0]));
+    scheduler.set_loop_period(10000);
 }
 
 /*
@@ -915,17 +1041,78 @@ static void barometer_accumulate(void)
     barometer.accumulate();
 }
 
+/*
+  ask for the terrain on the way to the destination, and keep the height
+  of the terrain below us while following it
+ */
+static void update_terrain(void)
+{
+#if AP_TERRAIN_AVAILABLE
+    const Vector3f &dest = wp_nav.get_destination();
+    struct Location next_loc = current_loc;
+    if (ap.home_is_set) {
+        next_loc.lat = pv_get_lat(dest);
+        next_loc.lng = pv_get_lon(dest);
+    }
+    if (terrain.update(current_loc, next_loc)) {
+        gcs_send_message(MSG_TERRAIN);
+    }
+    float height;
+    if (!terrain.follow_enabled()) {
+        terrain_offset_cm = 0;
+    } else if (ap.home_is_set && terrain.height_above_home(current_loc, home, height)) {
+        terrain_offset_cm = height * 100;
+    }
+#endif
+}
+
+/*
+  rebuild the index of the rally points after they have changed
+ */
+static void update_rally(void)
+{
+    rally.update();
+}
+
 static void perf_update(void)
 {
-    if (g.log_bitmask & MASK_LOG_PM)
+    if (g.log_bitmask & MASK_LOG_PM) {
         Log_Write_Performance();
+        Log_Write_Sched();
+        Log_Write_Mem();
+    }
     if (scheduler.debug()) {
-        cliSerial->printf_P(PSTR("PERF: %u/%u %lu\n"), 
-                            (unsigned)perf_info_get_num_long_running(),
-                            (unsigned)perf_info_get_num_loops(),
-                            (unsigned long)perf_info_get_max_time());
+        const AP_Scheduler::LoopStats &ls = scheduler.loop_stats();
+        cliSerial->printf_P(PSTR("PERF: %u/%u %lu p50/95/99=%lu/%lu/%lu slack=%u/%u lat=%u/%u/%u p95=%u\n"), 
+                            (unsigned)ls.long_count,
+                            (unsigned)ls.count,
+                            (unsigned long)ls.max_micros,
+                            (unsigned long)scheduler.loop_percentile_micros(50),
+                            (unsigned long)scheduler.loop_percentile_micros(95),
+                            (unsigned long)scheduler.loop_percentile_micros(99),
+                            (unsigned)ls.min_slack_micros,
+                            (unsigned)scheduler.loop_mean_slack_micros(),
+                            (unsigned)perf_info_get_latency_min(),
+                            (unsigned)perf_info_get_latency_mean(),
+                            (unsigned)perf_info_get_latency_max(),
+                            (unsigned)perf_info_get_latency_percentile());
+    }
+    if (scheduler.debug() > 1) {
+        for (uint8_t i=0; i<scheduler.num_tasks(); i++) {
+            const AP_Scheduler::TaskStats *st = scheduler.task_stats(i);
+            cliSerial->printf_P(PSTR("TASK[%u]: n=%u t=%u/%u/%u p95=%u ovr=%u skip=%u\n"),
+                                (unsigned)i,
+                                (unsigned)st->run_count,
+                                (unsigned)st->min_time_micros,
+                                (unsigned)scheduler.task_mean_micros(i),
+                                (unsigned)st->max_time_micros,
+                                (unsigned)scheduler.task_learned_micros(i),
+                                (unsigned)st->overrun_count,
+                                (unsigned)st->skip_count);
+        }
     }
     perf_info_reset();
+    scheduler.reset_task_stats();
     gps_fix_count = 0;
     pmTest1 = 0;
 }
@@ -938,9 +1125,6 @@ void loop()
     // ----------------------------
     if (ins.num_samples_available() >= 2) {
 
-        // check loop time
-        perf_info_check_loop_time(timer - fast_loopTimer);
-
         G_Dt                            = (float)(timer - fast_loopTimer) / 1000000.f;                  // used by PI Loops
         fast_loopTimer          = timer;
 
@@ -959,6 +1143,15 @@ void loop()
             uint16_t time_to_next_loop = 10000 - dt;
             scheduler.run(time_to_next_loop);
         }
+
+        // sleep until the IMU has a new sample rather than spinning
+        // on num_samples_available(), so the CPU is free for the other
+        // threads and the fast loop starts as soon as the sample arrives.
+        // Boards which can't sleep return straight away
+        dt = micros() - fast_loopTimer;
+        if (dt < 10000 && ins.num_samples_available() < 2) {
+            hal.scheduler->wait_for_signal(10000 - dt);
+        }
     }
 }
 
@@ -997,6 +1190,19 @@ static void fast_loop()
     // --------------------
     read_inertia();
 
+    // loiter and waypoint velocity controllers, from the latest inertial nav velocity
+    wp_nav.update_velocity();
+
+#if CAMERA == ENABLED
+    // camera triggering by distance, from the inertial nav position
+    update_camera_trigger();
+#endif
+
+#if COMPANION_LINK == ENABLED
+    // state records for a companion computer
+    companion_send();
+#endif
+
     // optical flow
     // --------------------
 #if OPTFLOW == ENABLED
@@ -1101,6 +1307,11 @@ static void medium_loop()
         if(g.compass_enabled) {
             if (compass.read()) {
                 compass.null_offsets();
+#if COMPASS_CAL == ENABLED
+                if (compass._learn == 2) {
+                    compass_cal.new_sample();
+                }
+#endif
             }
             // log compass information
             if (motors.armed() && (g.log_bitmask & MASK_LOG_COMPASS)) {
@@ -1157,6 +1368,15 @@ static void medium_loop()
             }
             if (g.log_bitmask & MASK_LOG_MOTORS)
                 Log_Write_Motors();
+
+#if AP_INERTIAL_SENSOR_BATCH
+            if (g.log_bitmask & MASK_LOG_IMU) {
+                AP_InertialSensor_Batch::result vibe;
+                if (ins.batch_update(vibe)) {
+                    DataFlash.Log_Write_Vibe(vibe);
+                }
+            }
+#endif
         }
         break;
 
@@ -1254,6 +1474,9 @@ static void slow_loop()
         slow_loopCounter = 0;
         update_events();
 
+        // read ahead the mission commands we'll need next
+        update_cmd_cache();
+
         if(g.radio_tuning > 0)
             tuning();
 
@@ -1288,6 +1511,16 @@ static void super_slow_loop()
     // auto disarm checks
     auto_disarm_check();
 
+#if COMPASS_CAL == ENABLED
+    // run a slice of the background compass calibration
+    update_compass_cal();
+#endif
+
+#if AP_INERTIAL_SENSOR_ACCEL_CAL
+    // fit the accel calibration once every orientation has been seen
+    update_accel_cal();
+#endif
+
     // make it possible to change orientation at runtime - useful
     // during initial config
     if (!motors.armed()) {
@@ -1310,7 +1543,12 @@ static void update_optical_flow(void)
     // if new data has arrived, process it
     if( optflow.last_update != last_of_update ) {
         last_of_update = optflow.last_update;
-        optflow.update_position(ahrs.roll, ahrs.pitch, sin_yaw, cos_yaw, current_loc.alt);      // updates internal lon and lat with estimation based on optical flow
+        optflow.update_velocity(ahrs.roll, ahrs.pitch, current_loc.alt);      // updates body frame velocity over the ground
+
+        // the inertial nav uses the velocity alongside the gps
+        if( optflow.vel_ok ) {
+            inertial_nav.correct_with_flow(optflow.vel_forward, optflow.vel_right);
+        }
 
         // write to log at 5hz
         of_log_counter++;
@@ -1372,17 +1610,61 @@ static void update_GPS(void)
             }
         }
 
-#if CAMERA == ENABLED
-        if (camera.update_location(current_loc) == true) {
-            do_take_picture();
-        }
-#endif                
     }
 
     // check for loss of gps
     failsafe_gps_check();
 }
 
+#if CAMERA == ENABLED
+/*
+  trigger the camera by distance moved, on every loop. The picture is
+  logged with the position, attitude and time interpolated to the point
+  between the last loop and this one at which the trigger distance was
+  reached
+ */
+static void update_camera_trigger()
+{
+    static uint32_t last_time_ms;
+    static struct Location last_loc;
+    static int32_t last_roll_cd, last_pitch_cd, last_yaw_cd;
+
+    if (!inertial_nav.position_ok()) {
+        camera.reset_position();
+        return;
+    }
+
+    uint32_t now = millis();
+    struct Location loc;
+    loc.lat = inertial_nav.get_latitude();
+    loc.lng = inertial_nav.get_longitude();
+    loc.alt = inertial_nav.get_altitude();
+
+    Vector3f pos = inertial_nav.get_position();
+    float fraction;
+    if (camera.update_position(Vector2f(pos.x, pos.y), fraction)) {
+        camera.trigger_pic();
+        if (g.log_bitmask & MASK_LOG_CAMERA) {
+            struct Location shot_loc;
+            shot_loc.lat = last_loc.lat + (int32_t)((loc.lat - last_loc.lat) * fraction);
+            shot_loc.lng = last_loc.lng + (int32_t)((loc.lng - last_loc.lng) * fraction);
+            shot_loc.alt = last_loc.alt + (int32_t)((loc.alt - last_loc.alt) * fraction);
+            Log_Write_Camera(last_time_ms + (uint32_t)((now - last_time_ms) * fraction),
+                             shot_loc,
+                             last_roll_cd + (int32_t)(wrap_180_cd(ahrs.roll_sensor - last_roll_cd) * fraction),
+                             last_pitch_cd + (int32_t)((ahrs.pitch_sensor - last_pitch_cd) * fraction),
+                             wrap_360_cd(last_yaw_cd + (int32_t)(wrap_180_cd(ahrs.yaw_sensor - last_yaw_cd) * fraction)));
+        }
+    }
+
+    last_time_ms = now;
+    last_loc = loc;
+    last_roll_cd = ahrs.roll_sensor;
+    last_pitch_cd = ahrs.pitch_sensor;
+    last_yaw_cd = ahrs.yaw_sensor;
+}
+#endif
+
 // set_yaw_mode - update yaw mode and initialise any variables required
 bool set_yaw_mode(uint8_t new_yaw_mode)
 {
@@ -1437,7 +1719,7 @@ bool set_yaw_mode(uint8_t new_yaw_mode)
             yaw_initialised = true;
             break;
         case YAW_RESETTOARMEDYAW:
-            nav_yaw = ahrs.yaw_sensor; // store current yaw so we can start rotating back to correct one
+            nav.yaw = ahrs.yaw_sensor; // store current yaw so we can start rotating back to correct one
             yaw_initialised = true;
             break;
     }
@@ -1458,7 +1740,7 @@ void update_yaw_mode(void)
     switch(yaw_mode) {
 
     case YAW_HOLD:
-        // heading hold at heading held in nav_yaw but allow input from pilot
+        // heading hold at heading held in nav.yaw but allow input from pilot
         get_yaw_rate_stabilized_ef(g.rc_4.control_in);
         break;
 
@@ -1474,8 +1756,8 @@ void update_yaw_mode(void)
     case YAW_LOOK_AT_NEXT_WP:
         // point towards next waypoint (no pilot input accepted)
         // we don't use wp_bearing because we don't want the copter to turn too much during flight
-        nav_yaw = get_yaw_slew(nav_yaw, original_wp_bearing, AUTO_YAW_SLEW_RATE);
-        get_stabilize_yaw(nav_yaw);
+        nav.yaw = get_yaw_slew(nav.yaw, original_wp_bearing, AUTO_YAW_SLEW_RATE);
+        get_stabilize_yaw(nav.yaw);
 
         // if there is any pilot input, switch to YAW_HOLD mode for the next iteration
         if( g.rc_4.control_in != 0 ) {
@@ -1505,8 +1787,8 @@ void update_yaw_mode(void)
 
     case YAW_LOOK_AT_HOME:
         // keep heading always pointing at home with no pilot input allowed
-        nav_yaw = get_yaw_slew(nav_yaw, home_bearing, AUTO_YAW_SLEW_RATE);
-        get_stabilize_yaw(nav_yaw);
+        nav.yaw = get_yaw_slew(nav.yaw, home_bearing, AUTO_YAW_SLEW_RATE);
+        get_stabilize_yaw(nav.yaw);
 
         // if there is any pilot input, switch to YAW_HOLD mode for the next iteration
         if( g.rc_4.control_in != 0 ) {
@@ -1516,8 +1798,8 @@ void update_yaw_mode(void)
 
     case YAW_LOOK_AT_HEADING:
         // keep heading pointing in the direction held in yaw_look_at_heading with no pilot input allowed
-        nav_yaw = get_yaw_slew(nav_yaw, yaw_look_at_heading, yaw_look_at_heading_slew);
-        get_stabilize_yaw(nav_yaw);
+        nav.yaw = get_yaw_slew(nav.yaw, yaw_look_at_heading, yaw_look_at_heading_slew);
+        get_stabilize_yaw(nav.yaw);
         break;
 
 	case YAW_LOOK_AHEAD:
@@ -1529,15 +1811,15 @@ void update_yaw_mode(void)
     case YAW_TOY:
         // update to allow external roll/yaw mixing
         // keep heading always pointing at home with no pilot input allowed
-        nav_yaw = get_yaw_slew(nav_yaw, home_bearing, AUTO_YAW_SLEW_RATE);
-        get_stabilize_yaw(nav_yaw);
+        nav.yaw = get_yaw_slew(nav.yaw, home_bearing, AUTO_YAW_SLEW_RATE);
+        get_stabilize_yaw(nav.yaw);
         break;
 #endif
 
     case YAW_RESETTOARMEDYAW:
         // changes yaw to be same as when quad was armed
-        nav_yaw = get_yaw_slew(nav_yaw, initial_armed_bearing, AUTO_YAW_SLEW_RATE);
-        get_stabilize_yaw(nav_yaw);
+        nav.yaw = get_yaw_slew(nav.yaw, initial_armed_bearing, AUTO_YAW_SLEW_RATE);
+        get_stabilize_yaw(nav.yaw);
 
         // if there is any pilot input, switch to YAW_HOLD mode for the next iteration
         if( g.rc_4.control_in != 0 ) {
@@ -1619,8 +1901,8 @@ void update_roll_pitch_mode(void)
     switch(roll_pitch_mode) {
     case ROLL_PITCH_ACRO:
         // copy user input for reporting purposes
-        control_roll            = g.rc_1.control_in;
-        control_pitch           = g.rc_2.control_in;
+        nav.control_roll            = g.rc_1.control_in;
+        nav.control_pitch           = g.rc_2.control_in;
 
 #if FRAME_CONFIG == HELI_FRAME
 		if(g.axis_enabled) {
@@ -1655,25 +1937,25 @@ void update_roll_pitch_mode(void)
         }
 
         // copy control_roll and pitch for reporting purposes
-        control_roll            = g.rc_1.control_in;
-        control_pitch           = g.rc_2.control_in;
+        nav.control_roll            = g.rc_1.control_in;
+        nav.control_pitch           = g.rc_2.control_in;
 
         // pass desired roll, pitch to stabilize attitude controllers
-        get_stabilize_roll(control_roll);
-        get_stabilize_pitch(control_pitch);
+        get_stabilize_roll(nav.control_roll);
+        get_stabilize_pitch(nav.control_pitch);
 
         break;
 
     case ROLL_PITCH_AUTO:
         // copy latest output from nav controller to stabilize controller
-        nav_roll = wp_nav.get_desired_roll();
-        nav_pitch = wp_nav.get_desired_pitch();
-        get_stabilize_roll(nav_roll);
-        get_stabilize_pitch(nav_pitch);
+        nav.roll = wp_nav.get_desired_roll();
+        nav.pitch = wp_nav.get_desired_pitch();
+        get_stabilize_roll(nav.roll);
+        get_stabilize_pitch(nav.pitch);
 
         // user input, although ignored is put into control_roll and pitch for reporting purposes
-        control_roll = g.rc_1.control_in;
-        control_pitch = g.rc_2.control_in;
+        nav.control_roll = g.rc_1.control_in;
+        nav.control_pitch = g.rc_2.control_in;
         break;
 
     case ROLL_PITCH_STABLE_OF:
@@ -1683,12 +1965,12 @@ void update_roll_pitch_mode(void)
         }
 
         // copy pilot input to control_roll and pitch for reporting purposes
-        control_roll            = g.rc_1.control_in;
-        control_pitch           = g.rc_2.control_in;
+        nav.control_roll            = g.rc_1.control_in;
+        nav.control_pitch           = g.rc_2.control_in;
 
         // mix in user control with optical flow
-        get_stabilize_roll(get_of_roll(control_roll));
-        get_stabilize_pitch(get_of_pitch(control_pitch));
+        get_stabilize_roll(get_of_roll(nav.control_roll));
+        get_stabilize_pitch(get_of_pitch(nav.control_pitch));
         break;
 
     // THOR
@@ -1703,17 +1985,17 @@ void update_roll_pitch_mode(void)
             update_simple_mode();
         }
         // copy user input for reporting purposes
-        control_roll            = g.rc_1.control_in;
-        control_pitch           = g.rc_2.control_in;
+        nav.control_roll            = g.rc_1.control_in;
+        nav.control_pitch           = g.rc_2.control_in;
 
         // update loiter target from user controls - max velocity is 5.0 m/s
-        wp_nav.move_loiter_target(control_roll, control_pitch,0.01f);
+        wp_nav.move_loiter_target(nav.control_roll, nav.control_pitch,0.01f);
 
         // copy latest output from nav controller to stabilize controller
-        nav_roll = wp_nav.get_desired_roll();
-        nav_pitch = wp_nav.get_desired_pitch();
-        get_stabilize_roll(nav_roll);
-        get_stabilize_pitch(nav_pitch);
+        nav.roll = wp_nav.get_desired_roll();
+        nav.pitch = wp_nav.get_desired_pitch();
+        get_stabilize_roll(nav.roll);
+        get_stabilize_pitch(nav.pitch);
         break;
     }
 
@@ -1928,7 +2210,7 @@ void update_throttle_mode(void)
         if(ap.auto_armed) {
             // alt hold plus pilot input of climb rate
             pilot_climb_rate = get_pilot_desired_climb_rate(g.rc_3.control_in);
-            if( sonar_alt_health >= SONAR_ALT_HEALTH_MAX ) {
+            if( inertial_nav.range_ok() ) {
                 // if sonar is ok, use surface tracking
                 get_throttle_surface_tracking(pilot_climb_rate);    // this function calls set_target_alt_for_reporting for us
             }else{
@@ -1945,8 +2227,9 @@ void update_throttle_mode(void)
     case THROTTLE_AUTO:
         // auto pilot altitude controller with target altitude held in wp_nav.get_desired_alt()
         if(ap.auto_armed) {
-            get_throttle_althold_with_slew(wp_nav.get_desired_alt(), -wp_nav.get_descent_velocity(), wp_nav.get_climb_velocity());
-            set_target_alt_for_reporting(wp_nav.get_desired_alt()); // To-Do: return get_destination_alt if we are flying to a waypoint
+            // the slew smooths steps in the terrain below us
+            get_throttle_althold_with_slew(wp_nav.get_desired_alt() + terrain_offset_cm, -wp_nav.get_descent_velocity(), wp_nav.get_climb_velocity());
+            set_target_alt_for_reporting(wp_nav.get_desired_alt() + terrain_offset_cm); // To-Do: return get_destination_alt if we are flying to a waypoint
         }else{
             // pilot's throttle must be at zero so keep motors off
             set_throttle_out(0, false);
@@ -1984,38 +2267,55 @@ static void read_AHRS(void)
 #endif
 
     ahrs.update();
-    omega = ins.get_gyro();
+
+    // while disarmed we sit still on the ground, so keep tracking
+    // the gyro offsets as the board warms up
+    if (!motors.armed()) {
+        ins.refine_gyro_offsets();
+#if AP_INERTIAL_SENSOR_ACCEL_CAL
+        if (ins.accel_learn_enabled()) {
+            accel_cal.new_sample();
+        }
+#endif
+    }
+    fast.omega = ins.get_gyro();
 
 #if SECONDARY_DMP_ENABLED == ENABLED
     ahrs2.update();
 #endif
+
+    uint32_t now = millis();
+
+    struct ins_sample &sample = topics.ins.begin_publish();
+    sample.time_ms      = now;
+    sample.accel        = ins.get_accel();
+    sample.gyro         = fast.omega;
+    topics.ins.end_publish();
+
+    struct attitude_estimate &att = topics.attitude.begin_publish();
+    att.time_ms         = now;
+    att.roll            = ahrs.roll;
+    att.pitch           = ahrs.pitch;
+    att.yaw             = ahrs.yaw;
+    att.roll_sensor     = ahrs.roll_sensor;
+    att.pitch_sensor    = ahrs.pitch_sensor;
+    att.yaw_sensor      = ahrs.yaw_sensor;
+    att.omega           = fast.omega;
+    topics.attitude.end_publish();
 }
 
 static void update_trig(void){
-    Vector2f yawvector;
-    const Matrix3f &temp   = ahrs.get_dcm_matrix();
-
-    yawvector.x     = temp.a.x;     // sin
-    yawvector.y     = temp.b.x;         // cos
-    yawvector.normalize();
+    // the AHRS works these out from the DCM matrix on each update
+    const AP_AHRS::attitude_trig &trig = ahrs.get_trig();
 
-    cos_pitch_x     = safe_sqrt(1 - (temp.c.x * temp.c.x));     // level = 1
-    cos_roll_x      = temp.c.z / cos_pitch_x;                       // level = 1
-
-    cos_pitch_x     = constrain_float(cos_pitch_x, 0, 1.0);
-    // this relies on constrain_float() of infinity doing the right thing,
-    // which it does do in avr-libc
-    cos_roll_x      = constrain_float(cos_roll_x, -1.0, 1.0);
-
-    sin_yaw         = constrain_float(yawvector.y, -1.0, 1.0);
-    cos_yaw         = constrain_float(yawvector.x, -1.0, 1.0);
+    fast.cos_pitch_x     = trig.cos_pitch;                               // level = 1
+    fast.cos_roll_x      = trig.cos_roll;                                // level = 1
+    fast.cos_yaw         = trig.cos_yaw;
+    fast.sin_yaw         = trig.sin_yaw;
 
     // added to convert earth frame to body frame for rate controllers
-    sin_pitch       = -temp.c.x;
-    sin_roll        = temp.c.y / cos_pitch_x;
-
-    // update wp_nav controller with trig values
-    wp_nav.set_cos_sin_yaw(cos_yaw, sin_yaw, cos_pitch_x);
+    fast.sin_pitch       = trig.sin_pitch;
+    fast.sin_roll        = trig.sin_roll;
 
     //flat:
     // 0 ° = cos_yaw:  1.00, sin_yaw:  0.00,
@@ -2195,7 +2495,14 @@ static void tuning(){
         // set circle rate
         g.circle_rate.set(g.rc_6.control_in/25-20);     // allow approximately 45 degree turn rate in either direction
         break;
+
+    case CH6_STABILIZE_RATE_FF:
+        g.stabilize_rate_ff.set(tuning_value);
+        break;
     }
+
+    // let anything worked out from the tuned parameter see the change
+    AP_Param::notify_change();
 }
 
 AP_HAL_MAIN();
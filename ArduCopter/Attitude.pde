@@ -1,16 +1,62 @@
 /// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
 
+// get_stabilize_rate_ff - returns the feed forward rate for an axis (0 = roll,
+// 1 = pitch, 2 = yaw) from how fast its target angle is changing, so the rate
+// controller starts following a moving target before the angle error builds up
+static int32_t
+get_stabilize_rate_ff(uint8_t axis, int32_t target_angle)
+{
+    uint32_t now = millis();
+
+    if (g.stabilize_rate_ff == 0 || G_Dt <= 0 || now - stabilize_ff_last_ms[axis] > STABILIZE_RATE_FF_TIMEOUT_MS) {
+        // disabled, or the target hasn't been followed recently so it may jump
+        stabilize_ff_rate[axis] = 0;
+    }else{
+        float target_rate = wrap_180_cd(target_angle - stabilize_ff_target[axis]) / G_Dt;
+        float alpha = G_Dt / (G_Dt + 1.0f/(2.0f*PI*STABILIZE_RATE_FF_FILT_HZ));
+        stabilize_ff_rate[axis] += (target_rate - stabilize_ff_rate[axis]) * alpha;
+    }
+    stabilize_ff_target[axis] = target_angle;
+    stabilize_ff_last_ms[axis] = now;
+
+    int32_t ff = stabilize_ff_rate[axis] * g.stabilize_rate_ff;
+    return constrain_int32(ff, -STABILIZE_RATE_FF_MAX, STABILIZE_RATE_FF_MAX);
+}
+
 static void
 get_stabilize_roll(int32_t target_angle)
 {
+    // feed forward from the change in target
+    int32_t ff_rate = get_stabilize_rate_ff(0, target_angle);
+
+#if STABILIZE_ATTITUDE_VECTOR == ENABLED
+    // the error is found with the other axes by get_stabilize_attitude
+    stabilize_target[0] = target_angle;
+    stabilize_target_axes |= 1;
+    set_roll_rate_target(ff_rate, EARTH_FRAME);
+    return;
+#endif
+
     // angle error
-    target_angle = wrap_180_cd(target_angle - ahrs.roll_sensor);
+    int32_t angle_error = wrap_180_cd(target_angle - ahrs.roll_sensor);
 
     // limit the error we're feeding to the PID
-    target_angle = constrain_int32(target_angle, -4500, 4500);
+    angle_error = constrain_int32(angle_error, -4500, 4500);
 
     // convert to desired rate
-    int32_t target_rate = g.pi_stabilize_roll.kP() * target_angle;
+    int32_t p_rate = g.pi_stabilize_roll.kP() * angle_error;
+    int32_t target_rate = p_rate + ff_rate;
+
+#if LOGGING_ENABLED == ENABLED
+    // log feed forward against the P term if PID logging is on and we are tuning the feed forward
+    if( g.log_bitmask & MASK_LOG_PID && g.radio_tuning == CH6_STABILIZE_RATE_FF ) {
+        pid_log_counter++;                          // Note: get_stabilize_pitch pid logging relies on this function to update pid_log_counter
+        if( pid_log_counter >= 10 ) {               // (update rate / desired output rate) = (100hz / 10hz) = 10
+            pid_log_counter = 0;
+            Log_Write_PID(CH6_STABILIZE_RATE_FF, angle_error, p_rate, 0, ff_rate, target_rate, tuning_value);
+        }
+    }
+#endif
 
     // set targets for rate controller
     set_roll_rate_target(target_rate, EARTH_FRAME);
@@ -19,14 +65,34 @@ get_stabilize_roll(int32_t target_angle)
 static void
 get_stabilize_pitch(int32_t target_angle)
 {
+    // feed forward from the change in target
+    int32_t ff_rate = get_stabilize_rate_ff(1, target_angle);
+
+#if STABILIZE_ATTITUDE_VECTOR == ENABLED
+    stabilize_target[1] = target_angle;
+    stabilize_target_axes |= 2;
+    set_pitch_rate_target(ff_rate, EARTH_FRAME);
+    return;
+#endif
+
     // angle error
-    target_angle            = wrap_180_cd(target_angle - ahrs.pitch_sensor);
+    int32_t angle_error     = wrap_180_cd(target_angle - ahrs.pitch_sensor);
 
     // limit the error we're feeding to the PID
-    target_angle            = constrain_int32(target_angle, -4500, 4500);
+    angle_error             = constrain_int32(angle_error, -4500, 4500);
 
     // convert to desired rate
-    int32_t target_rate = g.pi_stabilize_pitch.kP() * target_angle;
+    int32_t p_rate = g.pi_stabilize_pitch.kP() * angle_error;
+    int32_t target_rate = p_rate + ff_rate;
+
+#if LOGGING_ENABLED == ENABLED
+    // log feed forward against the P term if PID logging is on and we are tuning the feed forward
+    if( g.log_bitmask & MASK_LOG_PID && g.radio_tuning == CH6_STABILIZE_RATE_FF ) {
+        if( pid_log_counter == 0 ) {               // relies on get_stabilize_roll having updated pid_log_counter
+            Log_Write_PID(CH6_STABILIZE_RATE_FF+100, angle_error, p_rate, 0, ff_rate, target_rate, tuning_value);
+        }
+    }
+#endif
 
     // set targets for rate controller
     set_pitch_rate_target(target_rate, EARTH_FRAME);
@@ -36,17 +102,27 @@ static void
 get_stabilize_yaw(int32_t target_angle)
 {
     int32_t target_rate;
+    int32_t p_rate, ff_rate;
     int32_t angle_error;
     int32_t output = 0;
 
+#if STABILIZE_ATTITUDE_VECTOR == ENABLED
+    stabilize_target[2] = target_angle;
+    stabilize_target_axes |= 4;
+    set_yaw_rate_target(get_stabilize_rate_ff(2, target_angle), EARTH_FRAME);
+    return;
+#endif
+
     // angle error
     angle_error = wrap_180_cd(target_angle - ahrs.yaw_sensor);
 
     // limit the error we're feeding to the PID
     angle_error = constrain_int32(angle_error, -4500, 4500);
 
-    // convert angle error to desired Rate:
-    target_rate = g.pi_stabilize_yaw.kP() * angle_error;
+    // convert angle error to desired Rate, plus the feed forward from the change in target
+    p_rate = g.pi_stabilize_yaw.kP() * angle_error;
+    ff_rate = get_stabilize_rate_ff(2, target_angle);
+    target_rate = p_rate + ff_rate;
 
     // do not use rate controllers for helicotpers with external gyros
 #if FRAME_CONFIG == HELI_FRAME
@@ -61,7 +137,7 @@ get_stabilize_yaw(int32_t target_angle)
         pid_log_counter++;
         if( pid_log_counter >= 10 ) {               // (update rate / desired output rate) = (100hz / 10hz) = 10
             pid_log_counter = 0;
-            Log_Write_PID(CH6_STABILIZE_YAW_KP, angle_error, target_rate, 0, 0, output, tuning_value);
+            Log_Write_PID(CH6_STABILIZE_YAW_KP, angle_error, p_rate, 0, ff_rate, output, tuning_value);
         }
     }
 #endif
@@ -70,6 +146,67 @@ get_stabilize_yaw(int32_t target_angle)
     set_yaw_rate_target(target_rate, EARTH_FRAME);
 }
 
+#if STABILIZE_ATTITUDE_VECTOR == ENABLED
+// get_stabilize_attitude - body frame rate targets from the rotation that takes
+// the attitude to the target attitude of get_stabilize_roll, pitch and yaw.  An
+// axis that wasn't given a target angle is held where it is, and follows its
+// earth frame rate target alone.  Unlike separate Euler angle errors this stays
+// right at large lean angles, and it needs no trig from the maths library
+static void
+get_stabilize_attitude(uint8_t target_axes)
+{
+    const float cd_to_rad = radians(0.01f);
+    float roll  = ((target_axes & 1) ? stabilize_target[0] : ahrs.roll_sensor) * cd_to_rad;
+    float pitch = ((target_axes & 2) ? stabilize_target[1] : ahrs.pitch_sensor) * cd_to_rad;
+    float yaw   = ((target_axes & 4) ? stabilize_target[2] : ahrs.yaw_sensor) * cd_to_rad;
+
+    float sr = fast_sin(roll),  cr = fast_cos(roll);
+    float sp = fast_sin(pitch), cp = fast_cos(pitch);
+    float sy = fast_sin(yaw),   cy = fast_cos(yaw);
+    Matrix3f target(cp * cy, (sr * sp * cy) - (cr * sy), (cr * sp * cy) + (sr * sy),
+                    cp * sy, (sr * sp * sy) + (cr * cy), (cr * sp * sy) - (sr * cy),
+                    -sp,     sr * cp,                    cr * cp);
+
+    // the rotation from the body to the target, in the body frame. Its
+    // antisymmetric part is the axis times the sine of the angle
+    Matrix3f e = ahrs.get_dcm_matrix().transposed() * target;
+    Vector3f axis_sin((e.c.y - e.b.z) * 0.5f, (e.a.z - e.c.x) * 0.5f, (e.b.x - e.a.y) * 0.5f);
+    float sin_sq = axis_sin.length_squared();
+    float scale = 1;
+    if (sin_sq > 1.0e-8f) {
+        float inv_sin = fast_inv_sqrt(sin_sq);
+        scale = fast_atan2(sin_sq * inv_sin, (e.a.x + e.b.y + e.c.z - 1) * 0.5f) * inv_sin;
+    }
+    Vector3f angle_error = axis_sin * (scale * degrees(100.0f));
+
+    // limit the error we're feeding to the PID
+    angle_error.x = constrain_float(angle_error.x, -4500, 4500);
+    angle_error.y = constrain_float(angle_error.y, -4500, 4500);
+    angle_error.z = constrain_float(angle_error.z, -4500, 4500);
+
+    // convert to desired rates, plus the earth frame feed forward and rate
+    // targets turned into the body frame
+    fast.roll_rate_target_bf  = g.pi_stabilize_roll.kP() * angle_error.x +
+                                fast.roll_rate_target_ef - fast.sin_pitch * fast.yaw_rate_target_ef;
+    fast.pitch_rate_target_bf = g.pi_stabilize_pitch.kP() * angle_error.y +
+                                fast.cos_roll_x * fast.pitch_rate_target_ef + fast.sin_roll * fast.cos_pitch_x * fast.yaw_rate_target_ef;
+    fast.yaw_rate_target_bf   = g.pi_stabilize_yaw.kP() * angle_error.z +
+                                fast.cos_pitch_x * fast.cos_roll_x * fast.yaw_rate_target_ef - fast.sin_roll * fast.pitch_rate_target_ef;
+
+#if LOGGING_ENABLED == ENABLED
+    // log the roll error and rate target if PID logging is on and we are tuning the feed forward
+    if( g.log_bitmask & MASK_LOG_PID && g.radio_tuning == CH6_STABILIZE_RATE_FF ) {
+        pid_log_counter++;
+        if( pid_log_counter >= 10 ) {               // (update rate / desired output rate) = (100hz / 10hz) = 10
+            pid_log_counter = 0;
+            Log_Write_PID(CH6_STABILIZE_RATE_FF, angle_error.x, g.pi_stabilize_roll.kP() * angle_error.x, 0,
+                          fast.roll_rate_target_ef, fast.roll_rate_target_bf, tuning_value);
+        }
+    }
+#endif
+}
+#endif // STABILIZE_ATTITUDE_VECTOR
+
 static void
 get_acro_roll(int32_t target_rate)
 {
@@ -105,7 +242,7 @@ get_roll_rate_stabilized_bf(int32_t stick_angle)
 
     // Scale pitch leveling by stick input
     if (!g.acro_trainer_enabled) {
-        roll_axis = (float)roll_axis*constrain_float((1-fabsf(stick_angle/4500.0)),0,1)*cos_pitch_x;
+        roll_axis = (float)roll_axis*constrain_float((1-fabsf(stick_angle/4500.0)),0,1)*fast.cos_pitch_x;
     }
 
 
@@ -117,7 +254,7 @@ get_roll_rate_stabilized_bf(int32_t stick_angle)
     int32_t correction_rate = g.pi_stabilize_roll.get_p(angle_error);
 
     // Calculate integrated body frame rate error
-    angle_error += (roll_axis - (omega.x * DEGX100)) * G_Dt;
+    angle_error += (roll_axis - (fast.omega.x * DEGX100)) * G_Dt;
 
     // don't let angle error grow too large
     angle_error = constrain_float(angle_error, - MAX_ROLL_OVERSHOOT, MAX_ROLL_OVERSHOOT);
@@ -157,7 +294,7 @@ get_pitch_rate_stabilized_bf(int32_t stick_angle)
     // scale pitch leveling by stick input
 
     if (!g.acro_trainer_enabled) {
-        pitch_axis = (float)pitch_axis*constrain_float((1-fabsf(stick_angle/4500.0)),0,1)*cos_pitch_x;
+        pitch_axis = (float)pitch_axis*constrain_float((1-fabsf(stick_angle/4500.0)),0,1)*fast.cos_pitch_x;
     }
 
     // convert the input to the desired body frame pitch rate
@@ -167,7 +304,7 @@ get_pitch_rate_stabilized_bf(int32_t stick_angle)
     int32_t correction_rate = g.pi_stabilize_pitch.get_p(angle_error);
 
     // Calculate integrated body frame rate error
-    angle_error += (pitch_axis - (omega.y * DEGX100)) * G_Dt;
+    angle_error += (pitch_axis - (fast.omega.y * DEGX100)) * G_Dt;
 
     // don't let angle error grow too large
     angle_error = constrain_float(angle_error, - MAX_PITCH_OVERSHOOT, MAX_PITCH_OVERSHOOT);
@@ -207,17 +344,17 @@ get_yaw_rate_stabilized_bf(int32_t stick_angle)
     // scale yaw leveling by stick input
 
     if (!g.acro_trainer_enabled) {
-        nav_yaw = (float)nav_yaw*constrain_float((1-fabsf(stick_angle/4500.0)),0,1)*cos_pitch_x;
+        nav.yaw = (float)nav.yaw*constrain_float((1-fabsf(stick_angle/4500.0)),0,1)*fast.cos_pitch_x;
     }
 
     // convert the input to the desired body frame yaw rate
-    nav_yaw += stick_angle * g.acro_p;
+    nav.yaw += stick_angle * g.acro_p;
 
     // add automatic correction
     int32_t correction_rate = g.pi_stabilize_yaw.get_p(angle_error);
 
     // Calculate integrated body frame rate error
-    angle_error += (nav_yaw - (omega.z * DEGX100)) * G_Dt;
+    angle_error += (nav.yaw - (fast.omega.z * DEGX100)) * G_Dt;
 
     // don't let angle error grow too large
     angle_error = constrain_float(angle_error, - MAX_YAW_OVERSHOOT, MAX_YAW_OVERSHOOT);
@@ -227,7 +364,7 @@ get_yaw_rate_stabilized_bf(int32_t stick_angle)
     }
 
     // set body frame targets for rate controller
-    set_yaw_rate_target(nav_yaw + correction_rate, BODY_FRAME);
+    set_yaw_rate_target(nav.yaw + correction_rate, BODY_FRAME);
 
     // add earth frame targets for rate controller
     set_yaw_rate_target(0, BODY_EARTH_FRAME);
@@ -244,11 +381,11 @@ get_yaw_rate_stabilized_ef(int32_t stick_angle)
     int32_t target_rate = stick_angle * g.acro_p;
 
     // convert the input to the desired yaw rate
-    nav_yaw += target_rate * G_Dt;
-    nav_yaw = wrap_360_cd(nav_yaw);
+    nav.yaw += target_rate * G_Dt;
+    nav.yaw = wrap_360_cd(nav.yaw);
 
     // calculate difference between desired heading and current heading
-    angle_error = wrap_180_cd(nav_yaw - ahrs.yaw_sensor);
+    angle_error = wrap_180_cd(nav.yaw - ahrs.yaw_sensor);
 
     // limit the maximum overshoot
     angle_error	= constrain_int32(angle_error, -MAX_YAW_OVERSHOOT, MAX_YAW_OVERSHOOT);
@@ -264,8 +401,8 @@ get_yaw_rate_stabilized_ef(int32_t stick_angle)
     }
 #endif // HELI_FRAME
 
-    // update nav_yaw to be within max_angle_overshoot of our current heading
-    nav_yaw = wrap_360_cd(angle_error + ahrs.yaw_sensor);
+    // update nav.yaw to be within max_angle_overshoot of our current heading
+    nav.yaw = wrap_360_cd(angle_error + ahrs.yaw_sensor);
 
     // set earth frame targets for rate controller
 	set_yaw_rate_target(g.pi_stabilize_yaw.get_p(angle_error)+target_rate, EARTH_FRAME);
@@ -273,31 +410,31 @@ get_yaw_rate_stabilized_ef(int32_t stick_angle)
 
 // set_roll_rate_target - to be called by upper controllers to set roll rate targets in the earth frame
 void set_roll_rate_target( int32_t desired_rate, uint8_t earth_or_body_frame ) {
-    rate_targets_frame = earth_or_body_frame;
+    fast.rate_targets_frame = earth_or_body_frame;
     if( earth_or_body_frame == BODY_FRAME ) {
-        roll_rate_target_bf = desired_rate;
+        fast.roll_rate_target_bf = desired_rate;
     }else{
-        roll_rate_target_ef = desired_rate;
+        fast.roll_rate_target_ef = desired_rate;
     }
 }
 
 // set_pitch_rate_target - to be called by upper controllers to set pitch rate targets in the earth frame
 void set_pitch_rate_target( int32_t desired_rate, uint8_t earth_or_body_frame ) {
-    rate_targets_frame = earth_or_body_frame;
+    fast.rate_targets_frame = earth_or_body_frame;
     if( earth_or_body_frame == BODY_FRAME ) {
-        pitch_rate_target_bf = desired_rate;
+        fast.pitch_rate_target_bf = desired_rate;
     }else{
-        pitch_rate_target_ef = desired_rate;
+        fast.pitch_rate_target_ef = desired_rate;
     }
 }
 
 // set_yaw_rate_target - to be called by upper controllers to set yaw rate targets in the earth frame
 void set_yaw_rate_target( int32_t desired_rate, uint8_t earth_or_body_frame ) {
-    rate_targets_frame = earth_or_body_frame;
+    fast.rate_targets_frame = earth_or_body_frame;
     if( earth_or_body_frame == BODY_FRAME ) {
-        yaw_rate_target_bf = desired_rate;
+        fast.yaw_rate_target_bf = desired_rate;
     }else{
-        yaw_rate_target_ef = desired_rate;
+        fast.yaw_rate_target_ef = desired_rate;
     }
 }
 
@@ -305,16 +442,24 @@ void set_yaw_rate_target( int32_t desired_rate, uint8_t earth_or_body_frame ) {
 void
 update_rate_contoller_targets()
 {
-    if( rate_targets_frame == EARTH_FRAME ) {
+#if STABILIZE_ATTITUDE_VECTOR == ENABLED
+    uint8_t target_axes = stabilize_target_axes;
+    stabilize_target_axes = 0;
+    if( fast.rate_targets_frame == EARTH_FRAME && target_axes != 0 ) {
+        get_stabilize_attitude(target_axes);
+        return;
+    }
+#endif
+    if( fast.rate_targets_frame == EARTH_FRAME ) {
         // convert earth frame rates to body frame rates
-        roll_rate_target_bf     = roll_rate_target_ef - sin_pitch * yaw_rate_target_ef;
-        pitch_rate_target_bf    = cos_roll_x  * pitch_rate_target_ef + sin_roll * cos_pitch_x * yaw_rate_target_ef;
-        yaw_rate_target_bf      = cos_pitch_x * cos_roll_x * yaw_rate_target_ef - sin_roll * pitch_rate_target_ef;
-    }else if( rate_targets_frame == BODY_EARTH_FRAME ) {
+        fast.roll_rate_target_bf     = fast.roll_rate_target_ef - fast.sin_pitch * fast.yaw_rate_target_ef;
+        fast.pitch_rate_target_bf    = fast.cos_roll_x  * fast.pitch_rate_target_ef + fast.sin_roll * fast.cos_pitch_x * fast.yaw_rate_target_ef;
+        fast.yaw_rate_target_bf      = fast.cos_pitch_x * fast.cos_roll_x * fast.yaw_rate_target_ef - fast.sin_roll * fast.pitch_rate_target_ef;
+    }else if( fast.rate_targets_frame == BODY_EARTH_FRAME ) {
         // add converted earth frame rates to body frame rates
-        roll_axis   = roll_rate_target_ef - sin_pitch * yaw_rate_target_ef;
-        pitch_axis  = cos_roll_x  * pitch_rate_target_ef + sin_roll * cos_pitch_x * yaw_rate_target_ef;
-        nav_yaw     = cos_pitch_x * cos_roll_x * yaw_rate_target_ef - sin_roll * pitch_rate_target_ef;
+        roll_axis   = fast.roll_rate_target_ef - fast.sin_pitch * fast.yaw_rate_target_ef;
+        pitch_axis  = fast.cos_roll_x  * fast.pitch_rate_target_ef + fast.sin_roll * fast.cos_pitch_x * fast.yaw_rate_target_ef;
+        nav.yaw     = fast.cos_pitch_x * fast.cos_roll_x * fast.yaw_rate_target_ef - fast.sin_roll * fast.pitch_rate_target_ef;
     }
 }
 
@@ -325,14 +470,17 @@ run_rate_controllers()
 {
 #if FRAME_CONFIG == HELI_FRAME          // helicopters only use rate controllers for yaw and only when not using an external gyro
     if(!motors.ext_gyro_enabled) {
-        heli_integrated_swash_controller(roll_rate_target_bf, pitch_rate_target_bf);
-        g.rc_4.servo_out = get_heli_rate_yaw(yaw_rate_target_bf);
+        heli_integrated_swash_controller(fast.roll_rate_target_bf, fast.pitch_rate_target_bf);
+        g.rc_4.servo_out = get_heli_rate_yaw(fast.yaw_rate_target_bf);
     }
+#elif RATE_PID_VECTOR == ENABLED
+    // call rate controllers, all axes in one pass
+    get_rate_rpy(fast.roll_rate_target_bf, fast.pitch_rate_target_bf, fast.yaw_rate_target_bf);
 #else
     // call rate controllers
-    g.rc_1.servo_out = get_rate_roll(roll_rate_target_bf);
-    g.rc_2.servo_out = get_rate_pitch(pitch_rate_target_bf);
-    g.rc_4.servo_out = get_rate_yaw(yaw_rate_target_bf);
+    g.rc_1.servo_out = get_rate_roll(fast.roll_rate_target_bf);
+    g.rc_2.servo_out = get_rate_pitch(fast.pitch_rate_target_bf);
+    g.rc_4.servo_out = get_rate_yaw(fast.yaw_rate_target_bf);
 #endif
 
     // run throttle controller if accel based throttle controller is enabled and active (active means it has been given a target)
@@ -360,8 +508,8 @@ static void heli_integrated_swash_controller(int32_t target_roll_rate, int32_t t
     int32_t         roll_output, pitch_output;                  // output from pid controller
     static bool     roll_pid_saturated, pitch_pid_saturated;    // tracker from last loop if the PID was saturated
     
-    current_roll_rate = (omega.x * DEGX100);                    // get current roll rate
-    current_pitch_rate = (omega.y * DEGX100);                   // get current pitch rate
+    current_roll_rate = (fast.omega.x * DEGX100);                    // get current roll rate
+    current_pitch_rate = (fast.omega.y * DEGX100);                   // get current pitch rate
 	
     roll_rate_error = target_roll_rate - current_roll_rate;
     pitch_rate_error = target_pitch_rate - current_pitch_rate;
@@ -435,7 +583,7 @@ get_heli_rate_yaw(int32_t target_rate)
     int32_t         output;
     static bool     pid_saturated;          // tracker from last loop if the PID was saturated
 
-    current_rate = (omega.z * DEGX100);                         // get current rate
+    current_rate = (fast.omega.z * DEGX100);                         // get current rate
 	
     // rate control
     rate_error = target_rate - current_rate;
@@ -479,6 +627,64 @@ get_heli_rate_yaw(int32_t target_rate)
 #endif // HELI_FRAME
 
 #if FRAME_CONFIG != HELI_FRAME
+#if RATE_PID_VECTOR == ENABLED
+// get_rate_rpy - the same as get_rate_roll, get_rate_pitch and
+// get_rate_yaw, with the three PIDs run together by rate_pid3
+static void
+get_rate_rpy(int32_t roll_target_rate, int32_t pitch_target_rate, int32_t yaw_target_rate)
+{
+    Vector3l rate_error;            // simply target_rate - current_rate
+    Vector3l output;                // output from pid controllers
+    uint8_t i_hold = 0;
+
+    // get current rates and errors
+    rate_error.x = roll_target_rate - (int32_t)(fast.omega.x * DEGX100);
+    rate_error.y = pitch_target_rate - (int32_t)(fast.omega.y * DEGX100);
+    rate_error.z = yaw_target_rate - (fast.omega.z * DEGX100);
+
+    // hold i terms when we've breached the limits, unless the I term will certainly reduce
+    if (motors.limit.roll_pitch) {
+        i_hold |= AC_PID3_X | AC_PID3_Y;
+    }
+    if (motors.limit.yaw) {
+        i_hold |= AC_PID3_Z;
+    }
+
+    output = rate_pid3.update(rate_error, G_Dt, i_hold);
+
+    // constrain output
+    output.x = constrain_int32(output.x, -5000, 5000);
+    output.y = constrain_int32(output.y, -5000, 5000);
+    output.z = constrain_int32(output.z, -4500, 4500);
+
+#if LOGGING_ENABLED == ENABLED
+    // log output if PID logging is on and we are tuning the rate P, I or D gains
+    if( g.log_bitmask & MASK_LOG_PID && (g.radio_tuning == CH6_RATE_ROLL_PITCH_KP || g.radio_tuning == CH6_RATE_ROLL_PITCH_KI || g.radio_tuning == CH6_RATE_ROLL_PITCH_KD) ) {
+        pid_log_counter++;
+        if( pid_log_counter >= 10 ) {               // (update rate / desired output rate) = (100hz / 10hz) = 10
+            pid_log_counter = 0;
+            Log_Write_PID(CH6_RATE_ROLL_PITCH_KP, rate_error.x, rate_pid3.get_p(0), rate_pid3.get_i(0), rate_pid3.get_d(0), output.x, tuning_value);
+            Log_Write_PID(CH6_RATE_ROLL_PITCH_KP+100, rate_error.y, rate_pid3.get_p(1), rate_pid3.get_i(1), rate_pid3.get_d(1), output.y, tuning_value);
+        }
+    }
+    // log output if PID loggins is on and we are tuning the yaw
+    if( g.log_bitmask & MASK_LOG_PID && g.radio_tuning == CH6_YAW_RATE_KP ) {
+        pid_log_counter++;
+        if( pid_log_counter >= 10 ) {               // (update rate / desired output rate) = (100hz / 10hz) = 10
+            pid_log_counter = 0;
+            Log_Write_PID(CH6_YAW_RATE_KP, rate_error.z, rate_pid3.get_p(2), rate_pid3.get_i(2), rate_pid3.get_d(2), output.z, tuning_value);
+        }
+    }
+#endif
+
+    // output control
+    g.rc_1.servo_out = output.x;
+    g.rc_2.servo_out = output.y;
+    g.rc_4.servo_out = output.z;
+}
+
+#else
+
 static int16_t
 get_rate_roll(int32_t target_rate)
 {
@@ -488,7 +694,7 @@ get_rate_roll(int32_t target_rate)
     int32_t output;                 // output from pid controller
 
     // get current rate
-    current_rate    = (omega.x * DEGX100);
+    current_rate    = (fast.omega.x * DEGX100);
 
     // call pid controller
     rate_error  = target_rate - current_rate;
@@ -532,7 +738,7 @@ get_rate_pitch(int32_t target_rate)
     int32_t output;                                                                     // output from pid controller
 
     // get current rate
-    current_rate    = (omega.y * DEGX100);
+    current_rate    = (fast.omega.y * DEGX100);
 
     // call pid controller
     rate_error      = target_rate - current_rate;
@@ -573,7 +779,7 @@ get_rate_yaw(int32_t target_rate)
     int32_t output;
 
     // rate control
-    rate_error              = target_rate - (omega.z * DEGX100);
+    rate_error              = target_rate - (fast.omega.z * DEGX100);
 
     // separately calculate p, i, d values for logging
     p = g.pid_rate_yaw.get_p(rate_error);
@@ -606,6 +812,7 @@ get_rate_yaw(int32_t target_rate)
     // constrain output
     return output;
 }
+#endif // RATE_PID_VECTOR
 #endif // !HELI_FRAME
 
 // calculate modified roll/pitch depending upon optical flow calculated position
@@ -620,10 +827,13 @@ get_of_roll(int32_t input_roll)
 
     // check if new optflow data available
     if( optflow.last_update != last_of_roll_update) {
+        float dt = min((optflow.last_update - last_of_roll_update) * 0.001f, 0.1f);
         last_of_roll_update = optflow.last_update;
 
-        // add new distance moved
-        tot_x_cm += optflow.x_cm;
+        // add the distance moved to the right, from the inertial nav
+        // velocity which the flow corrects
+        Vector3f vel = inertial_nav.get_velocity();
+        tot_x_cm += (vel.y * fast.cos_yaw - vel.x * fast.sin_yaw) * dt;
 
         // only stop roll if caller isn't modifying roll
         if( input_roll == 0 && current_loc.alt < 1500) {
@@ -673,10 +883,12 @@ get_of_pitch(int32_t input_pitch)
 
     // check if new optflow data available
     if( optflow.last_update != last_of_pitch_update ) {
+        float dt = min((optflow.last_update - last_of_pitch_update) * 0.001f, 0.1f);
         last_of_pitch_update = optflow.last_update;
 
-        // add new distance moved
-        tot_y_cm += optflow.y_cm;
+        // add the distance moved forward, from the inertial nav velocity
+        Vector3f vel = inertial_nav.get_velocity();
+        tot_y_cm += (vel.x * fast.cos_yaw + vel.y * fast.sin_yaw) * dt;
 
         // only stop roll if caller isn't modifying pitch
         if( input_pitch == 0 && current_loc.alt < 1500 ) {
@@ -727,7 +939,7 @@ static void get_circle_yaw()
     // if circle radius is zero do panorama
     if( g.circle_radius == 0 ) {
         // slew yaw towards circle angle
-        nav_yaw = get_yaw_slew(nav_yaw, ToDeg(circle_angle)*100, AUTO_YAW_SLEW_RATE);
+        nav.yaw = get_yaw_slew(nav.yaw, ToDeg(circle_angle)*100, AUTO_YAW_SLEW_RATE);
     }else{
         look_at_yaw_counter++;
         if( look_at_yaw_counter >= 10 ) {
@@ -735,11 +947,11 @@ static void get_circle_yaw()
             yaw_look_at_WP_bearing = pv_get_bearing_cd(inertial_nav.get_position(), yaw_look_at_WP);
         }
         // slew yaw
-        nav_yaw = get_yaw_slew(nav_yaw, yaw_look_at_WP_bearing, AUTO_YAW_SLEW_RATE);
+        nav.yaw = get_yaw_slew(nav.yaw, yaw_look_at_WP_bearing, AUTO_YAW_SLEW_RATE);
     }
 
     // call stabilize yaw controller
-    get_stabilize_yaw(nav_yaw);
+    get_stabilize_yaw(nav.yaw);
 }
 
 // get_look_at_yaw - updates bearing to location held in look_at_yaw_WP and calls stabilize yaw controller
@@ -755,20 +967,20 @@ static void get_look_at_yaw()
     }
 
     // slew yaw and call stabilize controller
-    nav_yaw = get_yaw_slew(nav_yaw, yaw_look_at_WP_bearing, AUTO_YAW_SLEW_RATE);
-    get_stabilize_yaw(nav_yaw);
+    nav.yaw = get_yaw_slew(nav.yaw, yaw_look_at_WP_bearing, AUTO_YAW_SLEW_RATE);
+    get_stabilize_yaw(nav.yaw);
 }
 
 static void get_look_ahead_yaw(int16_t pilot_yaw)
 {
     // Commanded Yaw to automatically look ahead.
     if (g_gps->fix && g_gps->ground_course_cd > YAW_LOOK_AHEAD_MIN_SPEED) {
-        nav_yaw = get_yaw_slew(nav_yaw, g_gps->ground_course_cd, AUTO_YAW_SLEW_RATE);
-        get_stabilize_yaw(wrap_360_cd(nav_yaw + pilot_yaw));   // Allow pilot to "skid" around corners up to 45 degrees
+        nav.yaw = get_yaw_slew(nav.yaw, g_gps->ground_course_cd, AUTO_YAW_SLEW_RATE);
+        get_stabilize_yaw(wrap_360_cd(nav.yaw + pilot_yaw));   // Allow pilot to "skid" around corners up to 45 degrees
     }else{
-        nav_yaw += pilot_yaw * g.acro_p * G_Dt;
-        nav_yaw = wrap_360_cd(nav_yaw);
-        get_stabilize_yaw(nav_yaw);
+        nav.yaw += pilot_yaw * g.acro_p * G_Dt;
+        nav.yaw = wrap_360_cd(nav.yaw);
+        get_stabilize_yaw(nav.yaw);
     }
 }
 
@@ -796,7 +1008,7 @@ static void update_throttle_cruise(int16_t throttle)
 // for traditional helicopters
 static int16_t get_angle_boost(int16_t throttle)
 {
-    float angle_boost_factor = cos_pitch_x * cos_roll_x;
+    float angle_boost_factor = fast.cos_pitch_x * fast.cos_roll_x;
     angle_boost_factor = 1.0f - constrain_float(angle_boost_factor, .5f, 1.0f);
     int16_t throttle_above_mid = max(throttle - motors.throttle_mid,0);
 
@@ -810,7 +1022,7 @@ static int16_t get_angle_boost(int16_t throttle)
 // throttle value should be 0 ~ 1000
 static int16_t get_angle_boost(int16_t throttle)
 {
-    float temp = cos_pitch_x * cos_roll_x;
+    float temp = fast.cos_pitch_x * fast.cos_roll_x;
     int16_t throttle_out;
 
     temp = constrain_float(temp, 0.5f, 1.0f);
@@ -1136,7 +1348,7 @@ static void
 get_throttle_land()
 {
     // if we are above 10m and the sonar does not sense anything perform regular alt hold descent
-    if (current_loc.alt >= LAND_START_ALT && !(g.sonar_enabled && sonar_alt_health >= SONAR_ALT_HEALTH_MAX)) {
+    if (current_loc.alt >= LAND_START_ALT && !inertial_nav.range_ok()) {
         get_throttle_althold_with_slew(LAND_START_ALT, -wp_nav.get_descent_velocity(), -abs(g.land_speed));
     }else{
         get_throttle_rate_stabilized(-abs(g.land_speed));
@@ -1170,23 +1382,25 @@ get_throttle_surface_tracking(int16_t target_rate)
     float distance_error;
     float sonar_induced_slew_rate;
 
+    // inertial nav's height above the ground, which has the sonar in it
+    float height = inertial_nav.get_height_above_ground();
     uint32_t now = millis();
 
     // reset target altitude if this controller has just been engaged
     if( now - last_call_ms > 200 ) {
-        target_sonar_alt = sonar_alt + controller_desired_alt - current_loc.alt;
+        target_sonar_alt = height + controller_desired_alt - current_loc.alt;
     }
     last_call_ms = now;
 
     target_sonar_alt += target_rate * 0.02f;
 
-    distance_error = (target_sonar_alt-sonar_alt);
+    distance_error = (target_sonar_alt-height);
     sonar_induced_slew_rate = constrain_float(fabsf(g.sonar_gain * distance_error),0,THR_SURFACE_TRACKING_VELZ_MAX);
 
     // do not let target altitude get too far from current altitude above ground
     // Note: the 750cm limit is perhaps too wide but is consistent with the regular althold limits and helps ensure a smooth transition
-    target_sonar_alt = constrain_float(target_sonar_alt,sonar_alt-750,sonar_alt+750);
-    controller_desired_alt = current_loc.alt+(target_sonar_alt-sonar_alt);
+    target_sonar_alt = constrain_float(target_sonar_alt,height-750,height+750);
+    controller_desired_alt = inertial_nav.get_ground_altitude() + target_sonar_alt;
 
     // update target altitude for reporting purposes
     set_target_alt_for_reporting(controller_desired_alt);
@@ -1213,6 +1427,9 @@ static void reset_rate_I()
     g.pid_rate_roll.reset_I();
     g.pid_rate_pitch.reset_I();
     g.pid_rate_yaw.reset_I();
+#if RATE_PID_VECTOR == ENABLED && FRAME_CONFIG != HELI_FRAME
+    rate_pid3.reset_I();
+#endif
 }
 
 static void reset_optflow_I(void)
@@ -102,6 +102,7 @@ public:
     void        data_stream_send(void);
     void        queued_param_send();
     void        queued_waypoint_send();
+    void        queued_log_send();
 
     static const struct AP_Param::GroupInfo        var_info[];
 
@@ -122,6 +123,10 @@ public:
     // see if we should send a stream now. Called at 50Hz
     bool        stream_trigger(enum streams stream_num);
 
+    // send the messages the streams have asked for, most important
+    // first, within the estimated capacity of the link. Called at 50Hz
+    void        stream_send_pending(void);
+
     // call to reset the timeout window for entering the cli
     void reset_cli_timeout();
 private:
@@ -140,6 +145,7 @@ private:
     uint16_t                    _queued_parameter_count; ///< saved count of
                                                          // parameters for
                                                          // queued send
+    uint32_t                    _queued_parameter_send_time_ms;
 
     /// Count the number of reportable parameters.
     ///
@@ -157,13 +163,27 @@ private:
     uint16_t                    _parameter_count;   ///< cache of reportable
                                                     // parameters
 
+    // log transfer. A LOG_REQUEST_LIST sends a LOG_ENTRY for each log
+    // from _log_next_list_entry to _log_last_list_entry, and a
+    // LOG_REQUEST_DATA sends _log_data_remaining bytes of log
+    // _log_num_data from _log_data_offset. The GCS asks again from
+    // the offset it has got to for anything it missed
+    void        handle_log_message(mavlink_message_t *msg);
+    uint16_t    _log_num_logs;
+    uint16_t    _log_last_log_num;
+    uint16_t    _log_next_list_entry;       // 0 when not listing
+    uint16_t    _log_last_list_entry;
+    uint16_t    _log_num_data;              // 0 when not sending data
+    uint16_t    _log_data_page;             // first page of the log
+    uint32_t    _log_data_offset;
+    uint32_t    _log_data_remaining;
+    uint32_t    _log_send_time_ms;
+
     mavlink_channel_t           chan;
     uint16_t                    packet_drops;
 
-#if CLI_ENABLED == ENABLED
-    // this allows us to detect the user wanting the CLI to start
-    uint8_t        crlf_count;
-#endif
+    // finds the messages in the bytes received
+    MAVLink_parser              _parser;
 
     // waypoints
     uint16_t        waypoint_request_i; // request index
@@ -196,6 +216,20 @@ private:
     // number of extra ticks to add to slow things down for the radio
     uint8_t         stream_slowdown;
 
+    // bitmask of the ap_message ids the streams want sent
+    uint32_t        stream_pending;
+
+    // time each message was last sent by stream_send_pending() in milliseconds
+    uint16_t        stream_last_sent[MSG_RETRY_DEFERRED];
+
+    // estimated bytes per second the link can carry, and the bytes
+    // we may still send before it is full
+    uint16_t        link_rate;
+    int16_t         link_budget;
+
+    // free space in the radio's transmit buffer in percent, from its RADIO messages
+    uint8_t         link_radio_txbuf;
+
     // millis value to calculate cli timeout relative to.
     // exists so we can separate the cli entry time from the system start time
     uint32_t _cli_timeout;
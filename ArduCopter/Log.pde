@@ -87,11 +87,26 @@ dump_log(uint8_t argc, const Menu::arg *argv)
     return (0);
 }
 
+static bool log_erase_running;
+
+// the erase carries on in the background from update_log_erase()
 static void do_erase_logs(void)
 {
 	gcs_send_text_P(SEVERITY_LOW, PSTR("Erasing logs\n"));
-    DataFlash.EraseAll();
-	gcs_send_text_P(SEVERITY_LOW, PSTR("Log erase complete\n"));
+    DataFlash.EraseStart();
+    log_erase_running = true;
+}
+
+static void update_log_erase(void)
+{
+    if (!log_erase_running) {
+        return;
+    }
+    DataFlash.EraseUpdate();
+    if (DataFlash.EraseProgress() == 100) {
+        log_erase_running = false;
+        gcs_send_text_P(SEVERITY_LOW, PSTR("Log erase complete\n"));
+    }
 }
 
 static int8_t
@@ -99,6 +114,17 @@ erase_logs(uint8_t argc, const Menu::arg *argv)
 {
     in_mavlink_delay = true;
     do_erase_logs();
+    // nothing else runs from the CLI, so see the erase through
+    uint8_t last_progress = 0;
+    while (log_erase_running) {
+        update_log_erase();
+        uint8_t progress = DataFlash.EraseProgress();
+        if (progress >= last_progress + 10 && log_erase_running) {
+            cliSerial->printf_P(PSTR("%u%%\n"), (unsigned)progress);
+            last_progress = progress;
+        }
+        hal.scheduler->delay(1);
+    }
     in_mavlink_delay = false;
     return 0;
 }
@@ -160,29 +186,26 @@ process_logs(uint8_t argc, const Menu::arg *argv)
     return 0;
 }
 
-struct PACKED log_Current {
-    LOG_PACKET_HEADER;
-    int16_t throttle_in;
-    uint32_t throttle_integrator;
-    int16_t battery_voltage;
-    int16_t current_amps;
-    uint16_t board_voltage;
-    float current_total;
-};
+#define LOG_CURRENT_FIELDS(F, S) \
+    F(h, throttle_in,         "Thr")     S \
+    F(I, throttle_integrator, "ThrInt")  S \
+    F(h, battery_voltage,     "Volt")    S \
+    F(h, current_amps,        "Curr")    S \
+    F(h, board_voltage,       "Vcc")     S \
+    F(f, current_total,       "CurrTot")
+LOG_MESSAGE_STRUCT(log_Current, LOG_CURRENT_FIELDS);
+LOG_MESSAGE_WRITER(log_write_current, LOG_CURRENT_MSG, log_Current, LOG_CURRENT_FIELDS)
 
 // Write an Current data packet
 static void Log_Write_Current()
 {
-    struct log_Current pkt = {
-        LOG_PACKET_HEADER_INIT(LOG_CURRENT_MSG),
-        throttle_in         : g.rc_3.control_in,
-        throttle_integrator : throttle_integrator,
-        battery_voltage     : (int16_t) (battery_voltage1 * 100.0f),
-        current_amps        : (int16_t) (current_amps1 * 100.0f),
-        board_voltage       : board_voltage(),
-        current_total       : current_total1
-    };
-    DataFlash.WriteBlock(&pkt, sizeof(pkt));
+    log_write_current(DataFlash,
+                      g.rc_3.control_in,
+                      throttle_integrator,
+                      (int16_t) (battery_voltage1 * 100.0f),
+                      (int16_t) (current_amps1 * 100.0f),
+                      board_voltage(),
+                      current_total1);
 }
 
 struct PACKED log_Motors {
@@ -248,8 +271,8 @@ struct PACKED log_Optflow {
     uint8_t surface_quality;
     int16_t x_cm;
     int16_t y_cm;
-    float   latitude;
-    float   longitude;
+    float   vel_forward;
+    float   vel_right;
     int32_t roll;
     int32_t pitch;
 };
@@ -265,8 +288,8 @@ static void Log_Write_Optflow()
         surface_quality : optflow.surface_quality,
         x_cm            : (int16_t) optflow.x_cm,
         y_cm            : (int16_t) optflow.y_cm,
-        latitude        : optflow.vlat,
-        longitude       : optflow.vlon,
+        vel_forward     : optflow.vel_forward,
+        vel_right       : optflow.vel_right,
         roll            : of_roll,
         pitch           : of_pitch
     };
@@ -387,6 +410,10 @@ struct PACKED log_Performance {
     uint32_t max_time;
     int16_t  pm_test;
     uint8_t i2c_lockup_count;
+    uint16_t latency_min;
+    uint16_t latency_mean;
+    uint16_t latency_max;
+    uint16_t latency_percentile;
 };
 
 // Write a performance monitoring packet
@@ -397,19 +424,68 @@ static void Log_Write_Performance()
         renorm_count     : ahrs.renorm_range_count,
         renorm_blowup    : ahrs.renorm_blowup_count,
         gps_fix_count    : gps_fix_count,
-        num_long_running : perf_info_get_num_long_running(),
-        num_loops        : perf_info_get_num_loops(),
-        max_time         : perf_info_get_max_time(),
+        num_long_running : scheduler.loop_stats().long_count,
+        num_loops        : scheduler.loop_stats().count,
+        max_time         : scheduler.loop_stats().max_micros,
         pm_test          : pmTest1,
-        i2c_lockup_count : hal.i2c->lockup_count()
+        i2c_lockup_count : hal.i2c->lockup_count(),
+        latency_min      : perf_info_get_latency_min(),
+        latency_mean     : perf_info_get_latency_mean(),
+        latency_max      : perf_info_get_latency_max(),
+        latency_percentile : perf_info_get_latency_percentile()
     };
     DataFlash.WriteBlock(&pkt, sizeof(pkt));
+    DataFlash.Log_Write_Loop(scheduler);
+}
+
+#define LOG_SCHED_FIELDS(F, S) \
+    F(B, task,          "Task") S \
+    F(H, run_count,     "Runs") S \
+    F(H, min_time,      "Min")  S \
+    F(H, mean_time,     "Mean") S \
+    F(H, max_time,      "Max")  S \
+    F(H, overrun_count, "Ovr")  S \
+    F(H, skip_count,    "Skip") S \
+    F(H, learned_time,  "P95")
+LOG_MESSAGE_STRUCT(log_Sched, LOG_SCHED_FIELDS);
+LOG_MESSAGE_WRITER(log_write_sched, LOG_SCHED_MSG, log_Sched, LOG_SCHED_FIELDS)
+
+// Write one scheduler task statistics packet per task
+static void Log_Write_Sched()
+{
+    for (uint8_t i=0; i<scheduler.num_tasks(); i++) {
+        const AP_Scheduler::TaskStats *st = scheduler.task_stats(i);
+        log_write_sched(DataFlash,
+                        i,
+                        st->run_count,
+                        st->min_time_micros,
+                        scheduler.task_mean_micros(i),
+                        st->max_time_micros,
+                        st->overrun_count,
+                        st->skip_count,
+                        scheduler.task_learned_micros(i));
+    }
+}
+
+struct PACKED log_Mem {
+    LOG_PACKET_HEADER;
+    struct memcheck_report report;
+};
+
+// Write a memory use packet
+static void Log_Write_Mem()
+{
+    struct log_Mem pkt = {
+        LOG_PACKET_HEADER_INIT(LOG_MEM_MSG)
+    };
+    memcheck_report(&pkt.report);
+    DataFlash.WriteBlock(&pkt, sizeof(pkt));
 }
 
 struct PACKED log_Cmd {
     LOG_PACKET_HEADER;
-    uint8_t command_total;
-    uint8_t command_number;
+    uint16_t command_total;
+    uint16_t command_number;
     uint8_t waypoint_id;
     uint8_t waypoint_options;
     uint8_t waypoint_param1;
@@ -419,7 +495,7 @@ struct PACKED log_Cmd {
 };
 
 // Write a command processing packet
-static void Log_Write_Cmd(uint8_t num, const struct Location *wp)
+static void Log_Write_Cmd(uint16_t num, const struct Location *wp)
 {
     struct log_Cmd pkt = {
         LOG_PACKET_HEADER_INIT(LOG_CMD_MSG),
@@ -435,31 +511,33 @@ static void Log_Write_Cmd(uint8_t num, const struct Location *wp)
     DataFlash.WriteBlock(&pkt, sizeof(pkt));
 }
 
-struct PACKED log_Attitude {
-    LOG_PACKET_HEADER;
-    int16_t roll_in;
-    int16_t roll;
-    int16_t pitch_in;
-    int16_t pitch;
-    int16_t yaw_in;
-    uint16_t yaw;
-    uint16_t nav_yaw;
-};
+#define LOG_ATTITUDE_FIELDS(F, S) \
+    F(c, roll_in,  "RollIn")  S \
+    F(c, roll,     "Roll")    S \
+    F(c, pitch_in, "PitchIn") S \
+    F(c, pitch,    "Pitch")   S \
+    F(c, yaw_in,   "YawIn")   S \
+    F(C, yaw,      "Yaw")     S \
+    F(C, nav_yaw,  "NavYaw")
+LOG_MESSAGE_STRUCT(log_Attitude, LOG_ATTITUDE_FIELDS);
+LOG_MESSAGE_WRITER(log_write_attitude, LOG_ATTITUDE_MSG, log_Attitude, LOG_ATTITUDE_FIELDS)
 
 // Write an attitude packet
 static void Log_Write_Attitude()
 {
-    struct log_Attitude pkt = {
-        LOG_PACKET_HEADER_INIT(LOG_ATTITUDE_MSG),
-        roll_in     : (int16_t)control_roll,
-        roll        : (int16_t)ahrs.roll_sensor,
-        pitch_in    : (int16_t)control_pitch,
-        pitch       : (int16_t)ahrs.pitch_sensor,
-        yaw_in      : (int16_t)g.rc_4.control_in,
-        yaw         : (uint16_t)ahrs.yaw_sensor,
-        nav_yaw     : (uint16_t)nav_yaw
-    };
-    DataFlash.WriteBlock(&pkt, sizeof(pkt));
+    const struct Nav_State targets = nav;
+    struct attitude_estimate att;
+    if (!topics.attitude.read(att)) {
+        return;
+    }
+    log_write_attitude(DataFlash,
+                       (int16_t)targets.control_roll,
+                       (int16_t)att.roll_sensor,
+                       (int16_t)targets.control_pitch,
+                       (int16_t)att.pitch_sensor,
+                       (int16_t)g.rc_4.control_in,
+                       (uint16_t)att.yaw_sensor,
+                       (uint16_t)targets.yaw);
 }
 
 struct PACKED log_INAV {
@@ -480,12 +558,16 @@ struct PACKED log_INAV {
 static void Log_Write_INAV()
 {
     Vector3f accel_corr = inertial_nav.accel_correction_ef;
+    struct nav_estimate est;
+    if (!topics.nav.read(est)) {
+        return;
+    }
 
     struct log_INAV pkt = {
         LOG_PACKET_HEADER_INIT(LOG_INAV_MSG),
         baro_alt            : (int16_t)baro_alt,                        // 1 barometer altitude
-        inav_alt            : (int16_t)inertial_nav.get_altitude(),     // 2 accel + baro filtered altitude
-        inav_climb_rate     : (int16_t)inertial_nav.get_velocity_z(),   // 3 accel + baro based climb rate
+        inav_alt            : (int16_t)est.position.z,                  // 2 accel + baro filtered altitude
+        inav_climb_rate     : (int16_t)est.velocity.z,                  // 3 accel + baro based climb rate
         accel_corr_x        : accel_corr.x,                             // 4 accel correction x-axis
         accel_corr_y        : accel_corr.y,                             // 5 accel correction y-axis
         accel_corr_z        : accel_corr.z,                             // 6 accel correction z-axis
@@ -704,45 +786,44 @@ struct PACKED log_Camera {
     uint16_t yaw;
 };
 
-// Write a Camera packet
-static void Log_Write_Camera()
+// Write a Camera packet, for a picture taken at time_ms in system
+// milliseconds. The GPS time is moved on from the last fix to then
+static void Log_Write_Camera(uint32_t time_ms, const struct Location &loc, int32_t roll_cd, int32_t pitch_cd, int32_t yaw_cd)
 {
 #if CAMERA == ENABLED
+    uint32_t gps_time = g_gps->time;
+    if (gps_time != 0) {
+        gps_time += time_ms - g_gps->last_fix_time;
+    }
     struct log_Camera pkt = {
         LOG_PACKET_HEADER_INIT(LOG_CAMERA_MSG),
-        gps_time    : g_gps->time,
-        latitude    : current_loc.lat,
-        longitude   : current_loc.lng,
-        altitude    : current_loc.alt,
-        roll        : (int16_t)ahrs.roll_sensor,
-        pitch       : (int16_t)ahrs.pitch_sensor,
-        yaw         : (uint16_t)ahrs.yaw_sensor
+        gps_time    : gps_time,
+        latitude    : loc.lat,
+        longitude   : loc.lng,
+        altitude    : loc.alt,
+        roll        : (int16_t)roll_cd,
+        pitch       : (int16_t)pitch_cd,
+        yaw         : (uint16_t)yaw_cd
     };
     DataFlash.WriteBlock(&pkt, sizeof(pkt));
 #endif
 }
 
-struct PACKED log_Error {
-    LOG_PACKET_HEADER;
-    uint8_t sub_system;
-    uint8_t error_code;
-};
+#define LOG_ERROR_FIELDS(F, S) \
+    F(B, sub_system, "Subsys") S \
+    F(B, error_code, "ECode")
+LOG_MESSAGE_STRUCT(log_Error, LOG_ERROR_FIELDS);
+LOG_MESSAGE_WRITER(log_write_error, LOG_ERROR_MSG, log_Error, LOG_ERROR_FIELDS)
 
 // Write an error packet
 static void Log_Write_Error(uint8_t sub_system, uint8_t error_code)
 {
-    struct log_Error pkt = {
-        LOG_PACKET_HEADER_INIT(LOG_ERROR_MSG),
-        sub_system    : sub_system,
-        error_code    : error_code,
-    };
-    DataFlash.WriteBlock(&pkt, sizeof(pkt));
+    log_write_error(DataFlash, sub_system, error_code);
 }
 
 static const struct LogStructure log_structure[] PROGMEM = {
     LOG_COMMON_STRUCTURES,
-    { LOG_CURRENT_MSG, sizeof(log_Current),             
-      "CURR", "hIhhhf",      "Thr,ThrInt,Volt,Curr,Vcc,CurrTot" },
+    { LOG_MESSAGE_STRUCTURE(LOG_CURRENT_MSG, log_Current, "CURR", LOG_CURRENT_FIELDS) },
 
 #if FRAME_CONFIG == OCTA_FRAME || FRAME_CONFIG == OCTA_QUAD_FRAME
     { LOG_MOTORS_MSG, sizeof(log_Motors),       
@@ -759,7 +840,7 @@ static const struct LogStructure log_structure[] PROGMEM = {
 #endif
 
     { LOG_OPTFLOW_MSG, sizeof(log_Optflow),       
-      "OF",   "hhBccffee",   "Dx,Dy,SQual,X,Y,Lat,Lng,Roll,Pitch" },
+      "OF",   "hhBccffee",   "Dx,Dy,SQual,X,Y,VelF,VelR,Roll,Pitch" },
     { LOG_NAV_TUNING_MSG, sizeof(log_Nav_Tuning),       
       "NTUN", "Ecffffffffee",    "WPDst,WPBrg,PErX,PErY,DVelX,DVelY,VelX,VelY,DAcX,DAcY,DRol,DPit" },
     { LOG_CONTROL_TUNING_MSG, sizeof(log_Control_Tuning),     
@@ -767,11 +848,10 @@ static const struct LogStructure log_structure[] PROGMEM = {
     { LOG_COMPASS_MSG, sizeof(log_Compass),             
       "MAG", "hhhhhhhhh",    "MagX,MagY,MagZ,OfsX,OfsY,OfsZ,MOfsX,MOfsY,MOfsZ" },
     { LOG_PERFORMANCE_MSG, sizeof(log_Performance), 
-      "PM",  "BBBHHIhB",       "RenCnt,RenBlw,FixCnt,NLon,NLoop,MaxT,PMT,I2CErr" },
+      "PM",  "BBBHHIhBHHHH",   "RenCnt,RenBlw,FixCnt,NLon,NLoop,MaxT,PMT,I2CErr,LatMin,LatMean,LatMax,Lat95" },
     { LOG_CMD_MSG, sizeof(log_Cmd),                 
-      "CMD", "BBBBBeLL",     "CTot,CNum,CId,COpt,Prm1,Alt,Lat,Lng" },
-    { LOG_ATTITUDE_MSG, sizeof(log_Attitude),       
-      "ATT", "cccccCC",      "RollIn,Roll,PitchIn,Pitch,YawIn,Yaw,NavYaw" },
+      "CMD", "HHBBBeLL",     "CTot,CNum,CId,COpt,Prm1,Alt,Lat,Lng" },
+    { LOG_MESSAGE_STRUCTURE(LOG_ATTITUDE_MSG, log_Attitude, "ATT", LOG_ATTITUDE_FIELDS) },
     { LOG_INAV_MSG, sizeof(log_INAV),       
       "INAV", "cccfffiiff",  "BAlt,IAlt,IClb,ACorrX,ACorrY,ACorrZ,GLat,GLng,ILat,ILng" },
     { LOG_MODE_MSG, sizeof(log_Mode),
@@ -796,8 +876,10 @@ static const struct LogStructure log_structure[] PROGMEM = {
       "DMP",   "ccccCC",     "DCMRoll,DMPRoll,DCMPtch,DMPPtch,DCMYaw,DMPYaw" },
     { LOG_CAMERA_MSG, sizeof(log_Camera),                 
       "CAM",   "ILLeccC",    "GPSTime,Lat,Lng,Alt,Roll,Pitch,Yaw" },
-    { LOG_ERROR_MSG, sizeof(log_Error),         
-      "ERR",   "BB",         "Subsys,ECode" },
+    { LOG_MESSAGE_STRUCTURE(LOG_ERROR_MSG, log_Error, "ERR", LOG_ERROR_FIELDS) },
+    { LOG_MESSAGE_STRUCTURE(LOG_SCHED_MSG, log_Sched, "SCHD", LOG_SCHED_FIELDS) },
+    { LOG_MEM_MSG, sizeof(log_Mem),
+      "MEM",   "HHIIIHHHHHHH", "Free,Stack,HUsed,HFree,HMax,HBlk,St0,St1,St2,St3,AUsed,ALate" },
 };
 
 // Read the DataFlash log memory
@@ -832,7 +914,7 @@ static void start_logging()
 #else // LOGGING_ENABLED
 
 static void Log_Write_Startup() {}
-static void Log_Write_Cmd(uint8_t num, const struct Location *wp) {}
+static void Log_Write_Cmd(uint16_t num, const struct Location *wp) {}
 static void Log_Write_Mode(uint8_t mode) {}
 static void Log_Write_IMU() {}
 static void Log_Write_GPS() {}
@@ -851,14 +933,17 @@ static void Log_Write_Nav_Tuning() {}
 static void Log_Write_Control_Tuning() {}
 static void Log_Write_Motors() {}
 static void Log_Write_Performance() {}
+static void Log_Write_Sched() {}
+static void Log_Write_Mem() {}
 static void Log_Write_PID(uint8_t pid_id, int32_t error, int32_t p, int32_t i, int32_t d, int32_t output, float gain) {}
 #if SECONDARY_DMP_ENABLED == ENABLED
 static void Log_Write_DMP() {}
 #endif
-static void Log_Write_Camera() {}
+static void Log_Write_Camera(uint32_t time_ms, const struct Location &loc, int32_t roll_cd, int32_t pitch_cd, int32_t yaw_cd) {}
 static void Log_Write_Error(uint8_t sub_system, uint8_t error_code) {}
 static int8_t process_logs(uint8_t argc, const Menu::arg *argv) {
     return 0;
 }
+static void update_log_erase(void) {}
 
 #endif // LOGGING_DISABLED
@@ -67,6 +67,10 @@ public:
         // relay object
         k_param_relay,
 
+        // GPS auto-detection
+        k_param_gps_auto,
+        k_param_gps2_auto,
+
         // Misc
         //
         k_param_log_bitmask = 20,
@@ -88,6 +92,7 @@ public:
         k_param_sonar_gain,
         k_param_ch8_option,
         k_param_arming_check_enabled,   // 32
+        k_param_stabilize_rate_ff,
 
         // 65: AP_Limits Library
         k_param_limits = 65,            // deprecated - remove
@@ -95,6 +100,8 @@ public:
         k_param_geofence_limit,         // deprecated - remove
         k_param_altitude_limit,         // deprecated - remove
         k_param_fence,                  // 69
+        k_param_terrain,                // 70
+        k_param_rally,                  // 71
 
         //
         // 80: Heli
@@ -126,6 +133,7 @@ public:
         k_param_sysid_my_gcs,
         k_param_serial3_baud,
         k_param_telem_delay,
+        k_param_companion_rate,
 
         //
         // 140: Sensor parameters
@@ -265,8 +273,11 @@ public:
     //
     AP_Int16        sysid_this_mav;
     AP_Int16        sysid_my_gcs;
-    AP_Int8         serial3_baud;
+    AP_Int16        serial3_baud;
     AP_Int8         telem_delay;
+#if COMPANION_LINK == ENABLED
+    AP_Int8         companion_rate;
+#endif
 
     AP_Int16        rtl_altitude;
     AP_Int8         sonar_enabled;
@@ -299,8 +310,8 @@ public:
 
     // Waypoints
     //
-    AP_Int8         command_total;
-    AP_Int8         command_index;
+    AP_Int16        command_total;
+    AP_Int16        command_index;
     AP_Int16        circle_radius;
     AP_Float        circle_rate;                // Circle mode's turn rate in deg/s.  positive to rotate clockwise, negative for counter clockwise
     AP_Int32        rtl_loiter_time;
@@ -381,10 +392,19 @@ public:
     AP_Int16                acro_balance_pitch;
     AP_Int8                 acro_trainer_enabled;
 
+    // Stabilize parameters
+    AP_Float                stabilize_rate_ff;
+
     // PI/D controllers
+#if RATE_PID_FIXED_POINT == ENABLED
+    AC_PID_Q                pid_rate_roll;
+    AC_PID_Q                pid_rate_pitch;
+    AC_PID_Q                pid_rate_yaw;
+#else
     AC_PID                  pid_rate_roll;
     AC_PID                  pid_rate_pitch;
     AC_PID                  pid_rate_yaw;
+#endif
     AC_PID                  pid_loiter_rate_lat;
     AC_PID                  pid_loiter_rate_lon;
 
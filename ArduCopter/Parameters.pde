@@ -12,6 +12,7 @@
 #define GSCALAR(v, name, def) { g.v.vtype, name, Parameters::k_param_ ## v, &g.v, {def_value : def} }
 #define GGROUP(v, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## v, &g.v, {group_info : class::var_info} }
 #define GOBJECT(v, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## v, &v, {group_info : class::var_info} }
+#define GOBJECTN(v, pname, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## pname, &v, {group_info : class::var_info} }
 
 const AP_Param::Info var_info[] PROGMEM = {
     // @Param: SYSID_SW_MREV
@@ -41,7 +42,7 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @Param: SERIAL3_BAUD
     // @DisplayName: Telemetry Baud Rate
     // @Description: The baud rate used on the telemetry port
-    // @Values: 1:1200,2:2400,4:4800,9:9600,19:19200,38:38400,57:57600,111:111100,115:115200
+    // @Values: 1:1200,2:2400,4:4800,9:9600,19:19200,38:38400,57:57600,111:111100,115:115200,230:230400,460:460800,500:500000,921:921600
     // @User: Standard
     GSCALAR(serial3_baud,   "SERIAL3_BAUD",     SERIAL3_BAUD/1000),
 
@@ -54,6 +55,17 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @Increment: 1
     GSCALAR(telem_delay,            "TELEM_DELAY",     0),
 
+#if COMPANION_LINK == ENABLED
+    // @Param: COMP_RATE
+    // @DisplayName: Companion state record rate
+    // @Description: The rate at which compact state records for a companion computer are sent on the telemetry port, alongside the MAVLink streams. Zero disables them. Rates above the 100Hz main loop rate are sent at 100Hz. Needs a fast telemetry baud rate, about 6000 bytes per second at 100Hz
+    // @Units: Hz
+    // @Range: 0 100
+    // @Increment: 1
+    // @User: Advanced
+    GSCALAR(companion_rate,         "COMP_RATE",       0),
+#endif
+
     // @Param: RTL_ALT
     // @DisplayName: RTL Altitude
     // @Description: The minimum altitude the model will move to before Returning to Launch.  Set to zero to return at current altitude.
@@ -378,7 +390,7 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @DisplayName: Channel 6 Tuning
     // @Description: Controls which parameters (normally PID gains) are being tuned with transmitter's channel 6 knob
     // @User: Standard
-    // @Values: 0:None,1:Stab Roll/Pitch kP,4:Rate Roll/Pitch kP,5:Rate Roll/Pitch kI,21:Rate Roll/Pitch kD,3:Stab Yaw kP,6:Rate Yaw kP,26:Rate Yaw kD,14:Altitude Hold kP,7:Throttle Rate kP,37:Throttle Rate kD,34:Throttle Accel kP,35:Throttle Accel kI,36:Throttle Accel kD,12:Loiter Pos kP,22:Loiter Rate kP,28:Loiter Rate kI,23:Loiter Rate kD,10:WP Speed,25:Acro kP,9:Relay On/Off,13:Heli Ext Gyro,17:OF Loiter kP,18:OF Loiter kI,19:OF Loiter kD,30:AHRS Yaw kP,31:AHRS kP,32:INAV_TC,38:Declination,39:Circle Rate
+    // @Values: 0:None,1:Stab Roll/Pitch kP,4:Rate Roll/Pitch kP,5:Rate Roll/Pitch kI,21:Rate Roll/Pitch kD,3:Stab Yaw kP,6:Rate Yaw kP,26:Rate Yaw kD,14:Altitude Hold kP,7:Throttle Rate kP,37:Throttle Rate kD,34:Throttle Accel kP,35:Throttle Accel kI,36:Throttle Accel kD,12:Loiter Pos kP,22:Loiter Rate kP,28:Loiter Rate kI,23:Loiter Rate kD,10:WP Speed,25:Acro kP,9:Relay On/Off,13:Heli Ext Gyro,17:OF Loiter kP,18:OF Loiter kI,19:OF Loiter kD,30:AHRS Yaw kP,31:AHRS kP,32:INAV_TC,38:Declination,39:Circle Rate,40:Stab Rate FF
     GSCALAR(radio_tuning, "TUNE",                   0),
 
     // @Param: TUNE_LOW
@@ -558,6 +570,14 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @User: Standard
     GSCALAR(copter_leds_mode,       "LED_MODE",         9),
 
+    // @Param: STB_RATE_FF
+    // @DisplayName: Stabilize rate feed forward
+    // @Description: Share of the rate at which the target roll, pitch and yaw angles are changing that is passed straight to the rate controllers, so they follow the target without waiting for an angle error to build up. 0 disables
+    // @Range: 0 1
+    // @Increment: 0.05
+    // @User: Advanced
+    GSCALAR(stabilize_rate_ff,      "STB_RATE_FF",      STABILIZE_RATE_FF),
+
     // PID controller
     //---------------
     // @Param: RATE_RLL_P
@@ -949,6 +969,18 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @Path: ../libraries/AP_Relay/AP_Relay.cpp
     GOBJECT(relay,                  "RELAY_", AP_Relay),
 
+#if GPS_PROTOCOL == GPS_PROTOCOL_AUTO
+    // @Group: GPS_
+    // @Path: ../libraries/AP_GPS/AP_GPS_Auto.cpp
+    GOBJECTN(g_gps_driver, gps_auto, "GPS_", AP_GPS_Auto),
+
+#if GPS2_ENABLED == ENABLED
+    // @Group: GPS2_
+    // @Path: ../libraries/AP_GPS/AP_GPS_Auto.cpp
+    GOBJECTN(g_gps2_driver, gps2_auto, "GPS2_", AP_GPS_Auto),
+#endif
+#endif
+
     // @Group: COMPASS_
     // @Path: ../libraries/AP_Compass/Compass.cpp
     GOBJECT(compass,        "COMPASS_", Compass),
@@ -1009,6 +1041,16 @@ const AP_Param::Info var_info[] PROGMEM = {
     GOBJECT(fence,      "FENCE_",   AC_Fence),
 #endif
 
+#if AP_TERRAIN_AVAILABLE
+    // @Group: TERRAIN_
+    // @Path: ../libraries/AP_Terrain/AP_Terrain.cpp
+    GOBJECT(terrain,    "TERRAIN_", AP_Terrain),
+#endif
+
+    // @Group: RALLY_
+    // @Path: ../libraries/AP_Rally/AP_Rally.cpp
+    GOBJECT(rally,      "RALLY_",   AP_Rally),
+
 #if FRAME_CONFIG ==     HELI_FRAME
     // @Group: H_
     // @Path: ../libraries/AP_Motors/AP_MotorsHeli.cpp
@@ -13,40 +13,67 @@ static void init_commands()
 // Getters
 // -------
 static struct Location get_cmd_with_index(int i)
+{
+    if (i >= 0 && i < g.command_total) {
+        uint8_t slot = i % CMD_CACHE_SIZE;
+        if (cmd_cache_index[slot] == i+1) {
+            return cmd_cache[slot];
+        }
+    }
+    return read_cmd_with_index(i);
+}
+
+// get_cmd_position - position vector of a command, from the cache if the command loc was read from is there
+static Vector3f get_cmd_position(int i, const struct Location &loc)
+{
+    if (i >= 0) {
+        uint8_t slot = i % CMD_CACHE_SIZE;
+        if (cmd_cache_index[slot] == i+1 && cmd_cache[slot].lat == loc.lat && cmd_cache[slot].lng == loc.lng && cmd_cache[slot].alt == loc.alt) {
+            return cmd_cache_pos[slot];
+        }
+    }
+    return pv_location_to_vector(loc);
+}
+
+// update_cmd_cache - reads the next missing command after the current nav command into the cache.
+// Only one is read each call so the slow loop isn't held up by storage
+static void update_cmd_cache()
+{
+    for (uint8_t k = 0; k < CMD_CACHE_SIZE; k++) {
+        int16_t i = command_nav_index + k;
+        if (i >= g.command_total) {
+            return;
+        }
+        uint8_t slot = i % CMD_CACHE_SIZE;
+        if (cmd_cache_index[slot] != i+1) {
+            cmd_cache[slot] = read_cmd_with_index(i);
+            cmd_cache_pos[slot] = pv_location_to_vector(cmd_cache[slot]);
+            cmd_cache_index[slot] = i+1;
+            return;
+        }
+    }
+}
+
+// clear_cmd_cache - empties the cache, for when home moves
+static void clear_cmd_cache()
+{
+    for (uint8_t k = 0; k < CMD_CACHE_SIZE; k++) {
+        cmd_cache_index[k] = 0;
+    }
+}
+
+// read_cmd_with_index - reads a command from storage
+static struct Location read_cmd_with_index(int i)
 {
     struct Location temp;
 
-    // Find out proper location in memory by using the start_byte position + the index
-    // --------------------------------------------------------------------------------
-    if (i >= g.command_total) {
+    if (i >= g.command_total || !mission.read(i, temp)) {
         // we do not have a valid command to load
         // return a WP with a "Blank" id
         temp.id = CMD_BLANK;
 
         // no reason to carry on
         return temp;
-
-    }else{
-        // we can load a command, we don't process it yet
-        // read WP position
-        uint16_t mem = (WP_START_BYTE) + (i * WP_SIZE);
-
-        temp.id = hal.storage->read_byte(mem);
-
-        mem++;
-        temp.options = hal.storage->read_byte(mem);
-
-        mem++;
-        temp.p1 = hal.storage->read_byte(mem);
-
-        mem++;
-        temp.alt = hal.storage->read_dword(mem);           // alt is stored in CM! Alt is stored relative!
-
-        mem += 4;
-        temp.lat = hal.storage->read_dword(mem);         // lat is stored in decimal * 10,000,000
-
-        mem += 4;
-        temp.lng = hal.storage->read_dword(mem);         // lon is stored in decimal * 10,000,000
     }
 
     // Add on home altitude if we are a nav command (or other command with altitude) and stored alt is relative
@@ -65,12 +92,15 @@ static struct Location get_cmd_with_index(int i)
 
 // Setters
 // -------
-static void set_cmd_with_index(struct Location temp, int i)
+static bool set_cmd_with_index(struct Location temp, int i)
 {
 
     i = constrain_int16(i, 0, g.command_total.get());
     //cliSerial->printf("set_command: %d with id: %d\n", i, temp.id);
 
+    // the cached copy is out of date
+    cmd_cache_index[i % CMD_CACHE_SIZE] = 0;
+
     // store home as 0 altitude!!!
     // Home is always a MAV_CMD_NAV_WAYPOINT (16)
     if (i == 0) {
@@ -78,28 +108,15 @@ static void set_cmd_with_index(struct Location temp, int i)
         temp.id = MAV_CMD_NAV_WAYPOINT;
     }
 
-    uint16_t mem = WP_START_BYTE + (i * WP_SIZE);
-
-    hal.storage->write_byte(mem, temp.id);
-
-    mem++;
-    hal.storage->write_byte(mem, temp.options);
-
-    mem++;
-    hal.storage->write_byte(mem, temp.p1);
-
-    mem++;
-    hal.storage->write_dword(mem, temp.alt);     // Alt is stored in CM!
-
-    mem += 4;
-    hal.storage->write_dword(mem, temp.lat);     // Lat is stored in decimal degrees * 10^7
-
-    mem += 4;
-    hal.storage->write_dword(mem, temp.lng);     // Long is stored in decimal degrees * 10^7
+    if (!mission.write(i, temp)) {
+        // out of storage
+        return false;
+    }
 
     // Make sure our WP_total
     if(g.command_total < (i+1))
         g.command_total.set_and_save(i+1);
+    return true;
 }
 
 static int32_t get_RTL_alt()
@@ -134,9 +151,8 @@ static void init_home()
     if (g.log_bitmask & MASK_LOG_CMD)
         Log_Write_Cmd(0, &home);
 
-    // update navigation scalers.  used to offset the shrinking longitude as we go towards the poles
-    scaleLongDown = longitude_scale(&home);
-    scaleLongUp   = 1.0f/scaleLongDown;
+    // relative commands and the position vectors of the cached commands all move with home
+    clear_cmd_cache();
 }
 
 
@@ -219,6 +219,15 @@ static void do_RTL(void)
     // set rtl state
     rtl_state = RTL_STATE_START;
 
+    // return to the nearest rally point if it is nearer than home
+    struct Position rally_loc;
+    rtl_target.zero();
+    if (ap.home_is_set && rally.find_nearest_rally_point(current_loc, home, rally_loc)) {
+        Vector2f ne = inertial_nav.get_frame().location_to_ne_cm(rally_loc);
+        rtl_target.x = ne.x;
+        rtl_target.y = ne.y;
+    }
+
     // verify_RTL will do the initialisation for us
     verify_RTL();
 }
@@ -266,7 +275,14 @@ static void do_nav_wp()
     set_nav_mode(NAV_WP);
 
     // Set wp navigation target
-    wp_nav.set_destination(pv_location_to_vector(command_nav_queue));
+    if (wp_nav.spline_enabled()) {
+        // fly a spline through the waypoints, stopping at this one if it has a delay or is the last
+        Vector3f next_wp;
+        bool stop = command_nav_queue.p1 != 0 || !get_next_nav_wp(next_wp);
+        wp_nav.set_spline_destination(get_cmd_position(command_nav_index, command_nav_queue), stop, next_wp);
+    }else{
+        wp_nav.set_destination(get_cmd_position(command_nav_index, command_nav_queue));
+    }
 
     // initialise original_wp_bearing which is used to check if we have missed the waypoint
     wp_bearing = wp_nav.get_bearing_to_destination();
@@ -599,8 +615,8 @@ static bool verify_RTL()
                 // point nose towards home (maybe)
                 set_yaw_mode(get_wp_yaw_mode(true));
 
-                // Set wp navigation target to above home
-                wp_nav.set_destination(Vector3f(0,0,get_RTL_alt()));
+                // Set wp navigation target to above home or the rally point
+                wp_nav.set_destination(Vector3f(rtl_target.x,rtl_target.y,get_RTL_alt()));
 
                 // initialise original_wp_bearing which is used to point the nose home
                 wp_bearing = wp_nav.get_bearing_to_destination();
@@ -616,8 +632,8 @@ static bool verify_RTL()
                 // set nav mode
                 set_nav_mode(NAV_WP);
 
-                // Set wp navigation target to above home
-                wp_nav.set_destination(Vector3f(0,0,get_RTL_alt()));
+                // Set wp navigation target to above home or the rally point
+                wp_nav.set_destination(Vector3f(rtl_target.x,rtl_target.y,get_RTL_alt()));
 
                 // initialise original_wp_bearing which is used to point the nose home
                 wp_bearing = wp_nav.get_bearing_to_destination();
@@ -662,7 +678,7 @@ static bool verify_RTL()
                     // switch into loiter nav mode
                     set_nav_mode(NAV_LOITER);
                     // override landing location (loiter defaults to a projection from current location)
-                    wp_nav.set_loiter_target(Vector3f(0,0,0));
+                    wp_nav.set_loiter_target(rtl_target);
 
                     // hold yaw while landing
                     set_yaw_mode(YAW_HOLD);
@@ -678,7 +694,7 @@ static bool verify_RTL()
                         // set navigation mode
                         set_nav_mode(NAV_WP);
                         // Set wp navigation alt target to rtl_alt_final
-                        wp_nav.set_destination(Vector3f(0,0,g.rtl_alt_final));
+                        wp_nav.set_destination(Vector3f(rtl_target.x,rtl_target.y,g.rtl_alt_final));
                     }
                     // update RTL state
                     rtl_state = RTL_STATE_FINAL_DESCENT;
@@ -753,7 +769,7 @@ static void do_yaw()
         yaw_look_at_heading = wrap_360_cd(command_cond_queue.alt * 100);
     }else{
         // relative angle
-        yaw_look_at_heading = wrap_360_cd(nav_yaw + command_cond_queue.alt * 100);
+        yaw_look_at_heading = wrap_360_cd(nav.yaw + command_cond_queue.alt * 100);
     }
 
     // get turn speed
@@ -761,7 +777,7 @@ static void do_yaw()
         // default to regular auto slew rate
         yaw_look_at_heading_slew = AUTO_YAW_SLEW_RATE;
     }else{
-        int32_t turn_rate = (wrap_180_cd(yaw_look_at_heading - nav_yaw) / 100) / command_cond_queue.lat;
+        int32_t turn_rate = (wrap_180_cd(yaw_look_at_heading - nav.yaw) / 100) / command_cond_queue.lat;
         yaw_look_at_heading_slew = constrain_int32(turn_rate, 1, 360);    // deg / sec
     }
 
@@ -837,6 +853,7 @@ static void do_guided(const struct Location *cmd)
     // set wp_nav's destination
     Vector3f pos = pv_location_to_vector(*cmd);
     wp_nav.set_destination(pos);
+    set_nav_mode(NAV_WP);
 
     // initialise wp_bearing for reporting purposes
     wp_bearing = wp_nav.get_bearing_to_destination();
@@ -859,31 +876,24 @@ static void do_change_speed()
 
 static void do_jump()
 {
-    // Used to track the state of the jump command in Mission scripting
-    // -10 is a value that means the register is unused
-    // when in use, it contains the current remaining jumps
-    static int8_t jump = -10;                                                                   // used to track loops in jump command
+    // the jumps left of each jump command are kept by the mission store,
+    // starting from the repeat count in the command
+    int16_t jumps = mission.jumps_left(command_cond_index, command_cond_queue.lat);
 
-    //cliSerial->printf("do Jump: %d\n", jump);
+    //cliSerial->printf("Jumps left: %d\n",jumps);
 
-    if(jump == -10) {
-        //cliSerial->printf("Fresh Jump\n");
-        // we use a locally stored index for jump
-        jump = command_cond_queue.lat;
-    }
-    //cliSerial->printf("Jumps left: %d\n",jump);
-
-    if(jump > 0) {
+    if(jumps > 0) {
         //cliSerial->printf("Do Jump to %d\n",command_cond_queue.p1);
-        jump--;
+        if (!mission.count_jump(command_cond_index, command_cond_queue.lat)) {
+            // no room to count it in RAM, so decrement the repeat counter
+            // in the command
+            struct Location temp = command_cond_queue;
+            temp.lat = jumps - 1;
+            set_cmd_with_index(temp, command_cond_index);
+        }
         change_command(command_cond_queue.p1);
 
-    } else if (jump == 0) {
-        //cliSerial->printf("Did last jump\n");
-        // we're done, move along
-        jump = -11;
-
-    } else if (jump == -1) {
+    } else if (jumps == -1) {
         //cliSerial->printf("jumpForever\n");
         // repeat forever
         change_command(command_cond_queue.p1);
@@ -899,6 +909,14 @@ static void do_set_home()
         home.lng        = command_cond_queue.lng;                                       // Lon * 10**7
         home.lat        = command_cond_queue.lat;                                       // Lat * 10**7
         home.alt        = 0;
+        // move the position vector frame to the new home without a jump
+        // in the position estimate or the navigation targets
+        Vector2f shift = inertial_nav.move_origin(home.lng, home.lat);
+        wp_nav.shift_origin(shift);
+#if AC_FENCE == ENABLED
+        fence.shift_origin(shift);
+#endif
+        clear_cmd_cache();
         //home_is_set 	= true;
         set_home_is_set(true);
     }
@@ -1035,7 +1053,7 @@ static void do_take_picture()
 #if CAMERA == ENABLED
     camera.trigger_pic();
     if (g.log_bitmask & MASK_LOG_CAMERA) {
-        Log_Write_Camera();
+        Log_Write_Camera(millis(), current_loc, ahrs.roll_sensor, ahrs.pitch_sensor, ahrs.yaw_sensor);
     }
 #endif
 }
@@ -2,7 +2,7 @@
 
 // For changing active command mid-mission
 //----------------------------------------
-static void change_command(uint8_t cmd_index)
+static void change_command(uint16_t cmd_index)
 {
     //cliSerial->printf("change_command: %d\n",cmd_index );
     // limit range
@@ -167,16 +167,30 @@ static void verify_commands(void)
 // Finds the next navgation command in EEPROM
 static int16_t find_next_nav_index(int16_t search_index)
 {
-    Location tmp;
-    while(search_index < g.command_total) {
-        tmp = get_cmd_with_index(search_index);
-        if(tmp.id <= MAV_CMD_NAV_LAST) {
-            return search_index;
-        }else{
-            search_index++;
-        }
+    if (search_index < 0) {
+        return -1;
+    }
+    uint16_t nav_index = mission.next_nav(search_index);
+    if (nav_index >= g.command_total) {
+        return -1;
+    }
+    return nav_index;
+}
+
+// get_next_nav_wp - finds the location of the waypoint after the current nav command, if the next nav command is one,
+// so the spline to the current waypoint can leave it heading the right way
+static bool get_next_nav_wp(Vector3f &next_wp)
+{
+    int16_t next_index = find_next_nav_index(command_nav_index + 1);
+    if(next_index == -1) {
+        return false;
+    }
+    struct Location next_cmd = get_cmd_with_index(next_index);
+    if(next_cmd.id != MAV_CMD_NAV_WAYPOINT) {
+        return false;
     }
-    return -1;
+    next_wp = get_cmd_position(next_index, next_cmd);
+    return true;
 }
 
 static void exit_mission()
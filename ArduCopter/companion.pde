@@ -0,0 +1,99 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+// compact state records for a companion computer on the telemetry port
+
+#if COMPANION_LINK == ENABLED
+
+/*
+  The records are sent between the MAVLink messages on the same port,
+  so the companion can still send MAVLink commands and turn the normal
+  streams down. A record starts with a magic byte that is never a
+  MAVLink start byte, and ends with the MAVLink CRC16 of the bytes
+  before it. Fields are little endian. Increase the version whenever
+  the layout changes
+ */
+#define COMPANION_MAGIC         0xC5
+#define COMPANION_VERSION       1
+
+// the records are sent from the 100Hz fast loop
+#define COMPANION_LOOP_RATE     100
+
+struct PACKED companion_record {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t length;             // of the whole record, including the crc
+    uint8_t seq;                // jumps when a record is dropped
+    uint32_t time_ms;
+    uint8_t flags;              // COMPANION_FLAG_*
+    float roll, pitch, yaw;     // radians
+    float gyro_x, gyro_y, gyro_z; // body rates in radians/second
+    float pos_x, pos_y, pos_z;  // inertial nav position from home in cm, north, east, up
+    float vel_x, vel_y, vel_z;  // inertial nav velocity in cm/s, north, east, up
+    uint16_t crc;
+};
+
+#define COMPANION_FLAG_ARMED        (1<<0)
+#define COMPANION_FLAG_POSITION_OK  (1<<1)
+
+static uint8_t companion_seq;
+static uint8_t companion_counter;
+
+// companion_send - send a state record if one is due and it fits
+// called from the fast loop, after the inertial nav update
+static void companion_send()
+{
+    if (g.companion_rate <= 0 || !gcs3.initialised) {
+        return;
+    }
+
+    uint8_t divider = COMPANION_LOOP_RATE / constrain_int16(g.companion_rate, 1, COMPANION_LOOP_RATE);
+    if (++companion_counter < divider) {
+        return;
+    }
+    companion_counter = 0;
+
+    // the sequence number moves on whether or not the record is sent,
+    // so the companion can count the drops
+    uint8_t seq = companion_seq++;
+
+    struct companion_record rec;
+    if (hal.uartC->txspace() < sizeof(rec)) {
+        // never block the fast loop
+        return;
+    }
+
+    const Vector3f gyro = ahrs.get_gyro();
+    const Vector3f pos = inertial_nav.get_position();
+    const Vector3f vel = inertial_nav.get_velocity();
+
+    rec.magic = COMPANION_MAGIC;
+    rec.version = COMPANION_VERSION;
+    rec.length = sizeof(rec);
+    rec.seq = seq;
+    rec.time_ms = millis();
+    rec.flags = 0;
+    if (motors.armed()) {
+        rec.flags |= COMPANION_FLAG_ARMED;
+    }
+    if (inertial_nav.position_ok()) {
+        rec.flags |= COMPANION_FLAG_POSITION_OK;
+    }
+    rec.roll = ahrs.roll;
+    rec.pitch = ahrs.pitch;
+    rec.yaw = ahrs.yaw;
+    rec.gyro_x = gyro.x;
+    rec.gyro_y = gyro.y;
+    rec.gyro_z = gyro.z;
+    rec.pos_x = pos.x;
+    rec.pos_y = pos.y;
+    rec.pos_z = pos.z;
+    rec.vel_x = vel.x;
+    rec.vel_y = vel.y;
+    rec.vel_z = vel.z;
+    rec.crc = crc_calculate((const uint8_t *)&rec, sizeof(rec) - sizeof(rec.crc));
+
+    // one write, so the UART driver can copy the record in one go
+    hal.uartC->write((const uint8_t *)&rec, sizeof(rec));
+}
+
+#endif // COMPANION_LINK == ENABLED
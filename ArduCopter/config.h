@@ -289,10 +289,6 @@
  # define CONFIG_SONAR ENABLED
 #endif
 
-#ifndef SONAR_ALT_HEALTH_MAX
- # define SONAR_ALT_HEALTH_MAX 3            // number of good reads that indicates a healthy sonar
-#endif
-
 #ifndef SONAR_GAIN_DEFAULT
  # define SONAR_GAIN_DEFAULT 0.2            // gain for controlling how quickly sonar range adjusts target altitude (lower means slower reaction)
 #endif
@@ -324,6 +320,8 @@
 
  # undef GPS_PROTOCOL
  # define GPS_PROTOCOL GPS_PROTOCOL_NONE
+ # undef GPS2_ENABLED
+ # define GPS2_ENABLED DISABLED
 
  #undef CONFIG_SONAR
  #define CONFIG_SONAR DISABLED
@@ -337,6 +335,15 @@
  # define GPS_PROTOCOL           GPS_PROTOCOL_AUTO
 #endif
 
+// a second GPS on uartC, blended with the first. The port is given up
+// by the telemetry and companion links on boards that use it for them
+#ifndef GPS2_ENABLED
+ # define GPS2_ENABLED           DISABLED
+#endif
+#if GPS2_ENABLED == ENABLED && GPS_PROTOCOL != GPS_PROTOCOL_AUTO
+ # error GPS2_ENABLED needs GPS_PROTOCOL_AUTO
+#endif
+
 
 #ifndef MAV_SYSTEM_ID
  # define MAV_SYSTEM_ID          1
@@ -353,6 +360,19 @@
  # define SERIAL3_BAUD                    57600
 #endif
 
+// companion computer state records on the telemetry port. Not on
+// APM1/APM2, where the telemetry port is shared with USB
+#ifndef COMPANION_LINK
+ #if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2 || GPS2_ENABLED == ENABLED
+  # define COMPANION_LINK                 DISABLED
+ #else
+  # define COMPANION_LINK                 ENABLED
+ #endif
+#endif
+#if COMPANION_LINK == ENABLED && GPS2_ENABLED == ENABLED
+ # error the companion link and GPS2 both need uartC
+#endif
+
 
 //////////////////////////////////////////////////////////////////////////////
 // Battery monitoring
@@ -424,6 +444,18 @@
  #endif
 #endif
 
+// background compass calibration when COMPASS_LEARN is 2, see CompassCalibrator.h
+#ifndef COMPASS_CAL
+ #if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+  # define COMPASS_CAL                  DISABLED
+ #else
+  # define COMPASS_CAL                  ENABLED
+ #endif
+#endif
+#ifndef COMPASS_CAL_BUDGET_US
+ # define COMPASS_CAL_BUDGET_US         500         // time in microseconds the calibration may take of each super slow loop
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 //  OPTICAL_FLOW
 #if defined( __AVR_ATmega2560__ )       // determines if optical flow code is included
@@ -647,6 +679,11 @@
  # define GUIDED_NAV           	    NAV_WP
 #endif
 
+// how long the target being followed in guided mode is flown to at its last velocity before we stop and loiter
+#ifndef FOLLOW_TARGET_TIMEOUT_MS
+ # define FOLLOW_TARGET_TIMEOUT_MS  2000
+#endif
+
 // LOITER Mode
 #ifndef LOITER_YAW
  # define LOITER_YAW             	YAW_HOLD
@@ -780,6 +817,29 @@
  # define STABILIZE_YAW_IMAX        8.0f            // degrees * 100
 #endif
 
+// Stabilize rate feed forward
+#ifndef STABILIZE_RATE_FF
+ # define STABILIZE_RATE_FF         0.0f            // share of the target angle's rate of change added to the rate target, 0 disables
+#endif
+#ifndef STABILIZE_RATE_FF_FILT_HZ
+ # define STABILIZE_RATE_FF_FILT_HZ 5.0f            // low pass filter on the feed forward, as nav targets change in steps
+#endif
+#ifndef STABILIZE_RATE_FF_MAX
+ # define STABILIZE_RATE_FF_MAX     9000            // maximum feed forward in centi-degrees per second
+#endif
+#ifndef STABILIZE_RATE_FF_TIMEOUT_MS
+ # define STABILIZE_RATE_FF_TIMEOUT_MS  100         // restart the feed forward if the target wasn't updated for this long
+#endif
+
+// stabilize roll, pitch and yaw together from the one rotation between the
+// attitude and the target attitude, rather than an Euler angle error on each axis
+#ifndef STABILIZE_ATTITUDE_VECTOR
+ # define STABILIZE_ATTITUDE_VECTOR DISABLED
+#endif
+#if STABILIZE_ATTITUDE_VECTOR == ENABLED && FRAME_CONFIG == HELI_FRAME
+#error STABILIZE_ATTITUDE_VECTOR is not supported on helicopters
+#endif
+
 #ifndef YAW_LOOK_AHEAD_MIN_SPEED
  # define YAW_LOOK_AHEAD_MIN_SPEED  1000             // minimum ground speed in cm/s required before copter is aimed at ground course
 #endif
@@ -792,6 +852,23 @@
 #ifndef MAX_INPUT_ROLL_ANGLE
  # define MAX_INPUT_ROLL_ANGLE      4500
 #endif
+
+// run the rate PIDs in fixed point, see AC_PID_Q.h for how closely it follows the float PIDs
+#ifndef RATE_PID_FIXED_POINT
+ # define RATE_PID_FIXED_POINT      DISABLED
+#endif
+
+// run the roll, pitch and yaw rate PIDs together in one pass, see AC_PID3.h
+#ifndef RATE_PID_VECTOR
+ #if CONFIG_HAL_BOARD == HAL_BOARD_PX4
+  # define RATE_PID_VECTOR          ENABLED
+ #else
+  # define RATE_PID_VECTOR          DISABLED
+ #endif
+#endif
+#if RATE_PID_VECTOR == ENABLED && RATE_PID_FIXED_POINT == ENABLED
+#error RATE_PID_VECTOR and RATE_PID_FIXED_POINT cannot both be enabled
+#endif
 #ifndef MAX_INPUT_PITCH_ANGLE
  # define MAX_INPUT_PITCH_ANGLE     4500
 #endif
@@ -973,6 +1050,21 @@
  # define LOGGING_ENABLED                ENABLED
 #endif
 
+// logs kept on the SD card of a PX4. The oldest are deleted before
+// each new log to keep within these, 0 for no limit
+#ifndef LOG_RETAIN_LOGS
+ # define LOG_RETAIN_LOGS               0
+#endif
+#ifndef LOG_RETAIN_MB
+ # define LOG_RETAIN_MB                 512
+#endif
+
+// delta compress log records on APM1/APM2 dataflash chips, so longer
+// flights fit. Costs about 200 bytes of RAM
+#ifndef LOG_COMPRESSION
+ # define LOG_COMPRESSION               DISABLED
+#endif
+
 
 #ifndef LOG_ATTITUDE_FAST
  # define LOG_ATTITUDE_FAST             DISABLED
@@ -1068,12 +1160,26 @@
   #  define CLI_ENABLED           ENABLED
 #endif
 
-// experimental mpu6000 DMP code
+// attitude from the mpu6000 DMP, with the DCM drift correction. Saves
+// CPU on the APM2, where it is the only board it works on
 #ifndef DMP_ENABLED
  # define DMP_ENABLED DISABLED
 #endif
 
-// experimental mpu6000 DMP code
+// experimental: keep the attitude as a quaternion rather than a DCM
+// matrix. Drift correction is the same as for DCM
+#ifndef AHRS_QUATERNION_ENABLED
+ # define AHRS_QUATERNION_ENABLED DISABLED
+#endif
+
+// experimental: let the HAL worker thread run the telemetry stream
+// task. Other main loop code still sends text messages on the same
+// links, so only enable this for testing
+#ifndef SCHEDULER_OFFLOAD
+ # define SCHEDULER_OFFLOAD DISABLED
+#endif
+
+// run the DMP attitude alongside the main ahrs, logged for comparison
 #ifndef SECONDARY_DMP_ENABLED
  # define SECONDARY_DMP_ENABLED DISABLED
 #endif
@@ -157,6 +157,7 @@ static void do_aux_switch_function(int8_t ch_function, bool ch_flag)
                 if(control_mode == AUTO) {
                     aux_switch_wp_index = 0;
                     g.command_total.set_and_save(1);
+                    mission.truncate(1);
                     set_mode(RTL);  // if by chance we are unable to switch to RTL we just stay in AUTO and hope the GPS failsafe will take-over
                     return;
                 }
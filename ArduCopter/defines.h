@@ -167,6 +167,7 @@
 #define CH6_INAV_TC                     32  // inertial navigation baro/accel and gps/accel time constant (1.5 = strong baro/gps correction on accel estimatehas very strong does not correct accel estimate, 7 = very weak correction)
 #define CH6_DECLINATION                 38  // compass declination in radians
 #define CH6_CIRCLE_RATE                 39  // circle turn rate in degrees (hard coded to about 45 degrees in either direction)
+#define CH6_STABILIZE_RATE_FF           40  // share of the target angle's rate of change fed forward to the rate controllers
 
 
 // Commands - Note that APM now uses a subset of the MAVLink protocol
@@ -181,6 +182,7 @@
 #define NAV_CIRCLE      1
 #define NAV_LOITER      2
 #define NAV_WP          3
+#define NAV_FOLLOW      4   // loiter controller tracking a target streamed by the GCS in guided mode
 
 // Yaw behaviours during missions - possible values for WP_YAW_BEHAVIOR parameter
 #define WP_YAW_BEHAVIOR_NONE                          0   // auto pilot will never control yaw during missions or rtl (except for DO_CONDITIONAL_YAW command received)
@@ -242,11 +244,14 @@ enum ap_message {
     MSG_SERVO_OUT,
     MSG_NEXT_WAYPOINT,
     MSG_NEXT_PARAM,
+    MSG_NEXT_LOG,
     MSG_STATUSTEXT,
     MSG_LIMITS_STATUS,
     MSG_AHRS,
     MSG_SIMSTATE,
     MSG_HWSTATUS,
+    MSG_MEMCHECK,
+    MSG_TERRAIN,
     MSG_RETRY_DEFERRED // this must be last
 };
 
@@ -275,6 +280,8 @@ enum ap_message {
 #define LOG_DATA_INT32_MSG              0x16
 #define LOG_DATA_UINT32_MSG             0x17
 #define LOG_DATA_FLOAT_MSG              0x18
+#define LOG_SCHED_MSG                   0x19
+#define LOG_MEM_MSG                     0x1A
 #define LOG_INDEX_MSG                   0xF0
 #define MAX_NUM_LOGS                    50
 
@@ -315,10 +322,7 @@ enum ap_message {
 #define DATA_SET_SIMPLE_ON              26
 #define DATA_SET_SIMPLE_OFF             27
 
-// battery monitoring macros
-#define BATTERY_VOLTAGE(x) (x->voltage_average()*g.volt_div_ratio)
-#define CURRENT_AMPS(x) (x->voltage_average()-CURR_AMPS_OFFSET)*g.curr_amp_per_volt
-
+// battery monitoring
 #define BATT_MONITOR_DISABLED               0
 #define BATT_MONITOR_VOLTAGE_ONLY           3
 #define BATT_MONITOR_VOLTAGE_AND_CURRENT    4
@@ -377,18 +381,34 @@ enum ap_message {
 // parameters get the first 1536 bytes of EEPROM, remainder is for waypoints
 #define WP_START_BYTE 0x600 // where in memory home WP is stored + all other
                             // WP
-#define WP_SIZE 15
+#define CMD_CACHE_SIZE 3    // decoded commands kept from the current nav command on
 
 // fence points are stored at the end of the EEPROM
 #define MAX_FENCEPOINTS 6
 #define FENCE_WP_SIZE sizeof(Vector2l)
 #define FENCE_START_BYTE (EEPROM_MAX_ADDR-(MAX_FENCEPOINTS*FENCE_WP_SIZE))
 
-#define MAX_WAYPOINTS  ((FENCE_START_BYTE - WP_START_BYTE) / WP_SIZE) - 1 // -
-                                                                          // 1
-                                                                          // to
-                                                                          // be
-                                                                          // safe
+// rally points are stored below the fence, or at the end of the 16k
+// of PX4 storage, which has room for many more
+#if CONFIG_HAL_BOARD == HAL_BOARD_PX4
+ # define MAX_RALLYPOINTS   200
+ # define RALLY_START_BYTE  (16384 - AP_RALLY_STORAGE_SIZE(MAX_RALLYPOINTS))
+#else
+ # define MAX_RALLYPOINTS   10
+ # define RALLY_START_BYTE  (FENCE_START_BYTE - AP_RALLY_STORAGE_SIZE(MAX_RALLYPOINTS))
+#endif
+
+// the mission goes between the parameters and the rally points. The
+// PX4 storage is 16k, so there it goes in the space after the APM layout
+#if CONFIG_HAL_BOARD == HAL_BOARD_PX4
+ # define MISSION_START_BYTE EEPROM_MAX_ADDR
+#else
+ # define MISSION_START_BYTE WP_START_BYTE
+#endif
+#define MISSION_END_BYTE RALLY_START_BYTE
+
+// the most commands that can fit, if they are all short ones
+#define MAX_WAYPOINTS AP_MISSIONSTORE_MAX_COMMANDS(MISSION_START_BYTE, MISSION_END_BYTE)
 
 // mark a function as not to be inlined
 #define NOINLINE __attribute__((noinline))
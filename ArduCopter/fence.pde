@@ -11,6 +11,8 @@ uint8_t lim_state = 0, lim_old_state = 0;
 void fence_check()
 {
     uint8_t new_breaches; // the type of fence that has been breached
+    uint8_t new_pre_breaches; // the type of fence we would breach if we braked now
+    Vector3f stopping_point;
     uint8_t orig_breaches = fence.get_breaches();
 
     // return immediately if motors are not armed
@@ -61,6 +63,25 @@ void fence_check()
         Log_Write_Error(ERROR_SUBSYSTEM_FAILSAFE_FENCE, new_breaches);
     }
 
+    // give fence library the point we would stop at if we braked now
+    // wp_nav only projects the stopping point horizontally so add the height we would gain while slowing to a hover
+    wp_nav.get_stopping_point(inertial_nav.get_position(), inertial_nav.get_velocity(), stopping_point);
+    float climb_rate = inertial_nav.get_velocity().z;
+    if (climb_rate > 0) {
+        stopping_point.z += climb_rate * climb_rate / (2.0f * ALT_HOLD_ACCEL_MAX);
+    }
+    fence.set_stopping_point(stopping_point);
+
+    // check for a predicted breach
+    new_pre_breaches = fence.check_stopping_point();
+
+    // brake by holding position if we would otherwise cross the fence
+    if (new_pre_breaches != AC_FENCE_TYPE_NONE && new_breaches == AC_FENCE_TYPE_NONE && fence.get_action() != AC_FENCE_ACTION_REPORT_ONLY && GPS_ok()) {
+        if (control_mode != LOITER && control_mode != RTL && control_mode != LAND) {
+            set_mode(LOITER);
+        }
+    }
+
     // record clearing of breach
     if(orig_breaches != AC_FENCE_TYPE_NONE && fence.get_breaches() == AC_FENCE_TYPE_NONE) {
         Log_Write_Error(ERROR_SUBSYSTEM_FAILSAFE_FENCE, ERROR_CODE_ERROR_RESOLVED);
@@ -77,7 +98,7 @@ static void fence_send_mavlink_status(mavlink_channel_t chan)
         if ((breaches & AC_FENCE_TYPE_ALT_MAX) != 0) {
             mavlink_breach_type = FENCE_BREACH_MAXALT;
         }
-        if ((breaches & AC_FENCE_TYPE_CIRCLE) != 0) {
+        if ((breaches & (AC_FENCE_TYPE_CIRCLE | AC_FENCE_TYPE_POLYGON)) != 0) {
             mavlink_breach_type = FENCE_BREACH_BOUNDARY;
         }
 
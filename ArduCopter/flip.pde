@@ -34,7 +34,7 @@ void roll_flip()
     case 0:
         if (roll < 4500) {
             // Roll control
-			roll_rate_target_bf     = 40000 * flip_dir;
+			fast.roll_rate_target_bf     = 40000 * flip_dir;
 		    if(ap.manual_throttle){
     		    // increase throttle right before flip
                 set_throttle_out(g.rc_3.control_in + AAP_THR_INC, false);
@@ -47,9 +47,9 @@ void roll_flip()
     case 1:
         if((roll >= 4500) || (roll < -9000)) {
 		    #if FRAME_CONFIG == HELI_FRAME
-				roll_rate_target_bf = 40000 * flip_dir;
+				fast.roll_rate_target_bf = 40000 * flip_dir;
 		    #else
-			    roll_rate_target_bf = 40000 * flip_dir;
+			    fast.roll_rate_target_bf = 40000 * flip_dir;
 		    #endif
 		    // decrease throttle while inverted
 		    if(ap.manual_throttle){
@@ -5,9 +5,19 @@ static void read_inertia()
 {
     static uint8_t log_counter_inav = 0;
 
+#if HIL_MODE != HIL_MODE_ATTITUDE
+    update_sonar();
+#endif
+
     // inertial altitude estimates
     inertial_nav.update(G_Dt);
 
+    struct nav_estimate &est = topics.nav.begin_publish();
+    est.time_ms     = millis();
+    est.position    = inertial_nav.get_position();
+    est.velocity    = inertial_nav.get_velocity();
+    topics.nav.end_publish();
+
     if( motors.armed() && (g.log_bitmask & MASK_LOG_INAV) ) {
         log_counter_inav++;
         if( log_counter_inav >= 10 ) {
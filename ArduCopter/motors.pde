@@ -384,6 +384,10 @@ set_servos_4()
     // To-Do: implement improved stability patch for tri so that we do not need to limit throttle input to motors
     g.rc_3.servo_out = min(g.rc_3.servo_out, 800);
 #endif
+    motors.set_sample_time(ins.get_last_sample_time_micros());
     motors.output();
+    if (motors.armed()) {
+        perf_info_check_latency(motors.get_output_latency());
+    }
 }
 
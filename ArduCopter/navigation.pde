@@ -56,7 +56,7 @@ static void calc_distance_and_bearing()
     Vector3f curr = inertial_nav.get_position();
     
     // get target from loiter or wpinav controller
-    if( nav_mode == NAV_LOITER || nav_mode == NAV_CIRCLE ) {
+    if( nav_mode == NAV_LOITER || nav_mode == NAV_CIRCLE || nav_mode == NAV_FOLLOW ) {
         wp_distance = wp_nav.get_distance_to_target();
         wp_bearing = wp_nav.get_bearing_to_target();
     }else if( nav_mode == NAV_WP ) {
@@ -133,6 +133,12 @@ static bool set_nav_mode(uint8_t new_nav_mode)
         case NAV_WP:
             nav_initialised = true;
             break;
+
+        case NAV_FOLLOW:
+            // start from where we are, the target's position replaces it
+            wp_nav.init_loiter_target(inertial_nav.get_position(), inertial_nav.get_velocity());
+            nav_initialised = true;
+            break;
     }
 
     // if initialisation has been successful update the yaw mode
@@ -167,6 +173,14 @@ static void update_nav_mode()
             // call waypoint controller
             wp_nav.update_wpnav();
             break;
+
+        case NAV_FOLLOW:
+            // loiter at where the target has gone since it was last sent, until it hasn't been for a while
+            if (millis() - follow_target_ms > FOLLOW_TARGET_TIMEOUT_MS) {
+                set_nav_mode(NAV_LOITER);
+            }
+            wp_nav.update_loiter();
+            break;
     }
 
     // log to dataflash
@@ -197,8 +211,8 @@ static void reset_nav_params(void)
     // Will be set by nav or loiter controllers
     lon_error                       = 0;
     lat_error                       = 0;
-    nav_roll 						= 0;
-    nav_pitch 						= 0;
+    nav.roll 						= 0;
+    nav.pitch 						= 0;
 }
 
 // get_yaw_slew - reduces rate of change of yaw to a maximum
@@ -221,17 +235,19 @@ circle_set_center(const Vector3f current_position, float heading_in_radians)
     float cir_radius = g.circle_radius * 100;
 
     // set circle center to circle_radius ahead of current position
-    circle_center.x = current_position.x + cir_radius * cos_yaw;
-    circle_center.y = current_position.y + cir_radius * sin_yaw;
+    circle_center.x = current_position.x + cir_radius * fast.cos_yaw;
+    circle_center.y = current_position.y + cir_radius * fast.sin_yaw;
 
     // if we are doing a panorama set the circle_angle to the current heading
     if( g.circle_radius <= 0 ) {
         circle_angle = heading_in_radians;
+        circle_orbit.start(0, circle_angle);
         circle_angular_velocity_max = ToRad(g.circle_rate);
         circle_angular_acceleration = circle_angular_velocity_max;  // reach maximum yaw velocity in 1 second
     }else{
         // set starting angle to current heading - 180 degrees
         circle_angle = wrap_PI(heading_in_radians-PI);
+        circle_orbit.start(cir_radius, circle_angle);
 
         // calculate max velocity based on waypoint speed ensuring we do not use more than half our max acceleration for accelerating towards the center of the circle
         max_velocity = min(wp_nav.get_horizontal_velocity(), safe_sqrt(0.5f*wp_nav.get_waypoint_acceleration()*g.circle_radius*100.0f)); 
@@ -284,9 +300,17 @@ update_circle(float dt)
 
     // if the circle_radius is zero we are doing panorama so no need to update loiter target
     if( g.circle_radius != 0.0 ) {
-        // calculate target position
-        circle_target.x = circle_center.x + cir_radius * cosf(-circle_angle);
-        circle_target.y = circle_center.y - cir_radius * sinf(-circle_angle);
+        // calculate target position, rotating it on round the circle
+        if (circle_orbit.radius() == 0) {
+            // started as a panorama
+            circle_orbit.start(cir_radius, circle_angle);
+        }else{
+            circle_orbit.set_radius(cir_radius);
+            circle_orbit.advance(circle_angular_velocity * dt);
+        }
+        const Vector2f &offset = circle_orbit.offset();
+        circle_target.x = circle_center.x + offset.x;
+        circle_target.y = circle_center.y + offset.y;
         circle_target.z = wp_nav.get_desired_alt();
 
         // re-use loiter position controller
@@ -2,49 +2,86 @@
 //
 //  high level performance monitoring
 //
-//  we measure the main loop time
+//  we measure the latency from the capture of the IMU samples to the
+//  motor outputs worked out from them. The main loop time is kept by
+//  the scheduler
 //
 
-#define PERF_INFO_OVERTIME_THRESHOLD_MICROS 10500
+// the latencies are counted in buckets for the percentile, the last
+// one taking everything longer
+#define PERF_INFO_LATENCY_BUCKET_MICROS 250
+#define PERF_INFO_LATENCY_BUCKETS       40
+#define PERF_INFO_LATENCY_PERCENTILE    95
 
-uint16_t perf_info_loop_count;
-uint32_t perf_info_max_time;
-uint16_t perf_info_long_running;
+uint16_t perf_info_latency_count;
+uint32_t perf_info_latency_sum;
+uint16_t perf_info_latency_min;
+uint16_t perf_info_latency_max;
+uint16_t perf_info_latency_hist[PERF_INFO_LATENCY_BUCKETS];
 
-// perf_info_reset - reset all records of loop time to zero
+// perf_info_reset - reset all records of latency to zero
 void perf_info_reset()
 {
-    perf_info_loop_count = 0;
-    perf_info_max_time = 0;
-    perf_info_long_running = 0;
+    perf_info_latency_count = 0;
+    perf_info_latency_sum = 0;
+    perf_info_latency_min = 0;
+    perf_info_latency_max = 0;
+    memset(perf_info_latency_hist, 0, sizeof(perf_info_latency_hist));
 }
 
-// perf_info_check_loop_time - check latest loop time vs min, max and overtime threshold
-void perf_info_check_loop_time(uint32_t time_in_micros)
+// perf_info_check_latency - record the latency of a motor output in microseconds
+void perf_info_check_latency(uint32_t latency_micros)
 {
-    perf_info_loop_count++;
-    if( time_in_micros > perf_info_max_time) {
-        perf_info_max_time = time_in_micros;
+    uint16_t latency = min(latency_micros, 0xFFFFUL);
+    if (perf_info_latency_count == 0xFFFF) {
+        return;
     }
-    if( time_in_micros > PERF_INFO_OVERTIME_THRESHOLD_MICROS ) {
-        perf_info_long_running++;
+    if (perf_info_latency_count == 0 || latency < perf_info_latency_min) {
+        perf_info_latency_min = latency;
     }
+    if (latency > perf_info_latency_max) {
+        perf_info_latency_max = latency;
+    }
+    perf_info_latency_count++;
+    perf_info_latency_sum += latency;
+    uint8_t bucket = min(latency / PERF_INFO_LATENCY_BUCKET_MICROS, PERF_INFO_LATENCY_BUCKETS-1);
+    perf_info_latency_hist[bucket]++;
 }
 
-// perf_info_get_long_running_percentage - get number of long running loops as a percentage of the total number of loops
-uint16_t perf_info_get_num_loops()
+// perf_info_get_latency_min, _mean and _max - latency stats in microseconds
+uint16_t perf_info_get_latency_min()
 {
-    return perf_info_loop_count;
+    return perf_info_latency_min;
 }
 
-// perf_info_get_max_time - return maximum loop time (in microseconds)
-uint32_t perf_info_get_max_time()
+uint16_t perf_info_get_latency_mean()
 {
-    return perf_info_max_time;
+    if (perf_info_latency_count == 0) {
+        return 0;
+    }
+    return perf_info_latency_sum / perf_info_latency_count;
 }
 
-// perf_info_get_num_long_running - get number of long running loops
-uint16_t perf_info_get_num_long_running()
+uint16_t perf_info_get_latency_max()
 {
-    return perf_info_long_running;
+    return perf_info_latency_max;
+}
+
+// perf_info_get_latency_percentile - the latency in microseconds that
+// PERF_INFO_LATENCY_PERCENTILE percent of outputs were within, to the
+// top of its bucket
+uint16_t perf_info_get_latency_percentile()
+{
+    uint32_t target = ((uint32_t)perf_info_latency_count * PERF_INFO_LATENCY_PERCENTILE + 99) / 100;
+    uint32_t total = 0;
+    if (target == 0) {
+        return 0;
+    }
+    for (uint8_t i=0; i<PERF_INFO_LATENCY_BUCKETS-1; i++) {
+        total += perf_info_latency_hist[i];
+        if (total >= target) {
+            return min((i+1) * PERF_INFO_LATENCY_BUCKET_MICROS, perf_info_latency_max);
+        }
+    }
+    return perf_info_latency_max;
 }
\ No newline at end of file
@@ -2,7 +2,8 @@
 
 // position_vector.pde related utility functions
 
-// position vectors are Vector2f
+// position vectors are Vector2f, in inertial nav's frame which is
+// centred on home
 //    .x = latitude from home in cm
 //    .y = longitude from home in cm
 //    .z = altitude above home in cm
@@ -10,27 +11,29 @@
 // pv_latlon_to_vector - convert lat/lon coordinates to a position vector
 const Vector3f pv_latlon_to_vector(int32_t lat, int32_t lon, int32_t alt)
 {
-    Vector3f tmp((lat-home.lat) * LATLON_TO_CM, (lon-home.lng) * LATLON_TO_CM * scaleLongDown, alt);
+    Vector2f ne = inertial_nav.get_frame().location_to_ne_cm(lat, lon);
+    Vector3f tmp(ne.x, ne.y, alt);
     return tmp;
 }
 
 // pv_latlon_to_vector - convert lat/lon coordinates to a position vector
 const Vector3f pv_location_to_vector(Location loc)
 {
-    Vector3f tmp((loc.lat-home.lat) * LATLON_TO_CM, (loc.lng-home.lng) * LATLON_TO_CM * scaleLongDown, loc.alt);
+    Vector2f ne = inertial_nav.get_frame().location_to_ne_cm(loc);
+    Vector3f tmp(ne.x, ne.y, loc.alt);
     return tmp;
 }
 
 // pv_get_lon - extract latitude from position vector
 const int32_t pv_get_lat(const Vector3f pos_vec)
 {
-    return home.lat + (int32_t)(pos_vec.x / LATLON_TO_CM);
+    return inertial_nav.get_frame().ne_cm_to_lat(Vector2f(pos_vec.x, pos_vec.y));
 }
 
 // pv_get_lon - extract longitude from position vector
 const int32_t pv_get_lon(const Vector3f pos_vec)
 {
-    return home.lng + (int32_t)(pos_vec.y / LATLON_TO_CM * scaleLongUp);
+    return inertial_nav.get_frame().ne_cm_to_lng(Vector2f(pos_vec.x, pos_vec.y));
 }
 
 // pv_get_horizontal_distance_cm - return distance between two positions in cm
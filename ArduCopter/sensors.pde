@@ -11,6 +11,7 @@ static void init_sonar(void)
   #else
     sonar->calculate_scaler(g.sonar_type, 5.0f);
   #endif
+    sonar->start_timer();
 }
  #endif
 
@@ -21,6 +22,23 @@ static void init_barometer(void)
     gcs_send_text_P(SEVERITY_LOW, PSTR("barometer calibration complete"));
 }
 
+// start calibrating the barometer at startup. The calibration goes on
+// in mavlink_delay_cb() while the gyros are calibrated, and
+// finish_barometer() waits for whatever is left of it
+static void start_barometer(void)
+{
+    gcs_send_text_P(SEVERITY_LOW, PSTR("Calibrating barometer"));
+    barometer.start_calibration();
+}
+
+static void finish_barometer(void)
+{
+    while (!barometer.update_calibration()) {
+        delay(10);
+    }
+    gcs_send_text_P(SEVERITY_LOW, PSTR("barometer calibration complete"));
+}
+
 // return barometric altitude in centimeters
 static int32_t read_barometer(void)
 {
@@ -28,39 +46,32 @@ static int32_t read_barometer(void)
     return barometer.get_altitude() * 100.0f;
 }
 
-// return sonar altitude in centimeters
+// return the latest sonar reading in centimeters
 static int16_t read_sonar(void)
 {
 #if CONFIG_SONAR == ENABLED
     // exit immediately if sonar is disabled
     if( !g.sonar_enabled ) {
-        sonar_alt_health = 0;
         return 0;
     }
-
-    int16_t temp_alt = sonar->read();
-
-    if (temp_alt >= sonar->min_distance && temp_alt <= sonar->max_distance * 0.70f) {
-        if ( sonar_alt_health < SONAR_ALT_HEALTH_MAX ) {
-            sonar_alt_health++;
-        }
-    }else{
-        sonar_alt_health = 0;
-    }
-
- #if SONAR_TILT_CORRECTION == 1
-    // correct alt for angle of the sonar
-    float temp = cos_pitch_x * cos_roll_x;
-    temp = max(temp, 0.707f);
-    temp_alt = (float)temp_alt * temp;
- #endif
-
-    return temp_alt;
+    return sonar->read();
 #else
     return 0;
 #endif
 }
 
+// pass each new sonar reading from the timer process to inertial nav,
+// which decides when the sonar can be trusted over the baro
+static void update_sonar(void)
+{
+#if CONFIG_SONAR == ENABLED
+    int dist;
+    if( g.sonar_enabled && sonar->new_reading(dist) ) {
+        inertial_nav.correct_with_range(dist, dist >= sonar->min_distance && dist <= sonar->max_distance * 0.70f);
+    }
+#endif
+}
+
 
 #endif // HIL_MODE != HIL_MODE_ATTITUDE
 
@@ -78,6 +89,32 @@ static void init_compass()
 #endif
 }
 
+#if COMPASS_CAL == ENABLED
+// update_compass_cal - runs a slice of the fit, reporting the fits that
+// set the offsets
+static void update_compass_cal()
+{
+    if (g.compass_enabled && compass._learn == 2 && compass_cal.update(COMPASS_CAL_BUDGET_US)) {
+        gcs_send_text_fmt(PSTR("Compass cal fitness %.1f"), compass_cal.get_fitness());
+    }
+}
+#endif
+
+#if AP_INERTIAL_SENSOR_ACCEL_CAL
+// update_accel_cal - fits and saves the accel calibration when the
+// vehicle has rested in all six orientations since the last fit
+static void update_accel_cal()
+{
+    if (motors.armed() || !ins.accel_learn_enabled()) {
+        accel_cal.reset();
+        return;
+    }
+    if (accel_cal.update()) {
+        gcs_send_text_fmt(PSTR("Accel cal fitness %.2f"), accel_cal.get_fitness());
+    }
+}
+#endif
+
 static void init_optflow()
 {
 #if OPTFLOW == ENABLED
@@ -112,22 +149,25 @@ static void read_battery(void)
         return;
     }
 
+    // the timer samples the battery and integrates the current, so
+    // this only takes its latest values
+    battery_monitor.set_config(g.battery_monitoring == BATT_MONITOR_VOLTAGE_AND_CURRENT,
+                               g.battery_volt_pin, g.volt_div_ratio,
+                               g.battery_curr_pin, g.curr_amp_per_volt, CURR_AMPS_OFFSET);
+    bool new_voltage = battery_monitor.read();
     if(g.battery_monitoring == BATT_MONITOR_VOLTAGE_ONLY || g.battery_monitoring == BATT_MONITOR_VOLTAGE_AND_CURRENT) {
-        batt_volt_analog_source->set_pin(g.battery_volt_pin);
-        battery_voltage1 = BATTERY_VOLTAGE(batt_volt_analog_source);
+        if (new_voltage) {
+            battery_voltage1 = battery_monitor.voltage();
+
+            // let the motors make up for the battery sagging
+            motors.set_voltage(battery_voltage1);
+        }
     }
     if(g.battery_monitoring == BATT_MONITOR_VOLTAGE_AND_CURRENT) {
-        static uint32_t last_time_ms;
-        uint32_t tnow = hal.scheduler->millis();
-        float dt_millis = tnow - last_time_ms;
-        current_amps1    = CURRENT_AMPS(batt_curr_analog_source);
-        if (last_time_ms != 0 && dt_millis < 2000) {
-            batt_curr_analog_source->set_pin(g.battery_curr_pin);
-            current_total1   += current_amps1 * 1000 * dt_millis * (1.0f/1000) * (1.0f/3600); //amps * amps to milliamps * milliseconds * milliseconds to seconds * seconds to hours
-        }
+        current_amps1    = battery_monitor.current_amps();
+        current_total1   = battery_monitor.current_total_mah();
         // update compass with current value
         compass.set_current(current_amps1);
-        last_time_ms = tnow;
     }
 
     // check for low voltage or current if the low voltage check hasn't already been triggered
@@ -111,7 +111,7 @@ static void init_ardupilot()
 #if GPS_PROTOCOL != GPS_PROTOCOL_IMU
     // standard gps running. Note that we need a 256 byte buffer for some
     // GPS types (eg. UBLOX)
-    hal.uartB->begin(38400, 256, 16);
+    hal.uartB->begin(38400, 256, GPS_PORT_TX_BUFFER_SIZE);
 #endif
 
     cliSerial->printf_P(PSTR("\n\nInit " THISFIRMWARE
@@ -142,8 +142,14 @@ static void init_ardupilot()
     // load parameters from EEPROM
     load_parameters();
 
+    // a mission stored in an older layout can't be read
+    if (!mission.init()) {
+        g.command_total.set_and_save(0);
+    }
+
 #if HIL_MODE != HIL_MODE_ATTITUDE
     barometer.init();
+    ahrs.set_barometer(&barometer);
 #endif
 
     // init the GCS
@@ -162,8 +168,16 @@ static void init_ardupilot()
     }
 #else
     // we have a 2nd serial port for telemetry
+#if COMPANION_LINK == ENABLED
+    if (g.companion_rate > 0) {
+        // room for a few state records on top of the MAVLink messages
+        hal.uartC->begin(map_baudrate(g.serial3_baud, SERIAL3_BAUD), 128, 512);
+    } else
+#endif
+#if GPS2_ENABLED != ENABLED
     hal.uartC->begin(map_baudrate(g.serial3_baud, SERIAL3_BAUD), 128, 128);
     gcs3.init(hal.uartC);
+#endif
 #endif
 
     // identify ourselves correctly with the ground station
@@ -172,6 +186,10 @@ static void init_ardupilot()
 
 #if LOGGING_ENABLED == ENABLED
     DataFlash.Init();
+    DataFlash.set_retention(LOG_RETAIN_LOGS, LOG_RETAIN_MB);
+ #if LOG_COMPRESSION == ENABLED
+    DataFlash.set_compression(true);
+ #endif
     if (!DataFlash.CardInserted()) {
         gcs_send_text_P(SEVERITY_LOW, PSTR("No dataflash inserted"));
         g.log_bitmask.set(0);
@@ -182,6 +200,10 @@ static void init_ardupilot()
     }
 #endif
 
+#if AP_TERRAIN_AVAILABLE
+    terrain.init();
+#endif
+
 #if FRAME_CONFIG == HELI_FRAME
     motors.servo_manual = false;
     motors.init_swash();              // heli initialisation
@@ -204,9 +226,18 @@ static void init_ardupilot()
 #endif // HIL_MODE
 
     // Do GPS init
+#if GPS2_ENABLED == ENABLED
+    g_gps1 = &g_gps_driver;
+    g_gps1->init(hal.uartB, GPS::GPS_ENGINE_AIRBORNE_1G);
+    g_gps2 = &g_gps2_driver;
+    g_gps2->init(hal.uartC, GPS::GPS_ENGINE_AIRBORNE_1G);
+    g_gps = &g_gps_blend;
+    g_gps->init(NULL, GPS::GPS_ENGINE_AIRBORNE_1G);
+#else
     g_gps = &g_gps_driver;
     // GPS Initialization
     g_gps->init(hal.uartB, GPS::GPS_ENGINE_AIRBORNE_1G);
+#endif
 
     if(g.compass_enabled)
         init_compass();
@@ -241,9 +272,9 @@ static void init_ardupilot()
 #endif
 
 #if HIL_MODE != HIL_MODE_ATTITUDE
-    // read Baro pressure at ground
+    // read Baro pressure at ground, while the gyros are calibrated
     //-----------------------------
-    init_barometer();
+    start_barometer();
 #endif
 
     // initialise sonar
@@ -267,10 +298,18 @@ static void init_ardupilot()
 
     startup_ground();
 
+#if HIL_MODE != HIL_MODE_ATTITUDE
+    finish_barometer();
+#endif
+
 #if LOGGING_ENABLED == ENABLED
     Log_Write_Startup();
 #endif
 
+    // anything allocated from now on comes from the heap
+    arena_freeze();
+    cliSerial->printf_P(PSTR("\nArena: %u/%u\n"), arena_used(), (unsigned)AP_ARENA_SIZE);
+
     cliSerial->print_P(PSTR("\nReady to FLY "));
 }
 
@@ -298,7 +337,7 @@ static void startup_ground(void)
     ahrs.set_fast_gains(true);
 
 #if SECONDARY_DMP_ENABLED == ENABLED
-    ahrs2.init(&timer_scheduler);
+    ahrs2.init();
     ahrs2.set_as_secondary(true);
     ahrs2.set_fast_gains(true);
 #endif
@@ -368,7 +407,7 @@ static bool set_mode(uint8_t mode)
             if(g.axis_enabled){
                 roll_axis   = 0;
                 pitch_axis  = 0;
-                nav_yaw     = 0;
+                nav.yaw     = 0;
             }
             break;
 
@@ -400,6 +439,7 @@ static bool set_mode(uint8_t mode)
                 ap.manual_attitude = false;
                 // roll-pitch, throttle and yaw modes will all be set by the first nav command
                 init_commands();            // clear the command queues. will be reloaded when "run_autopilot" calls "update_commands" function
+                mission.reset_jumps();
             }
             break;
 
@@ -575,6 +615,10 @@ static uint32_t map_baudrate(int8_t rate, uint32_t default_baud)
     case 57:   return 57600;
     case 111:  return 111100;
     case 115:  return 115200;
+    case 230:  return 230400;
+    case 460:  return 460800;
+    case 500:  return 500000;
+    case 921:  return 921600;
     }
     //cliSerial->println_P(PSTR("Invalid SERIAL3_BAUD"));
     return default_baud;
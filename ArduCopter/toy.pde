@@ -104,15 +104,15 @@ void roll_pitch_toy()
         get_acro_yaw(0);
         yaw_timer--;
 
-        if((yaw_timer == 0) || (fabsf(omega.z) < 0.17f)) {
+        if((yaw_timer == 0) || (fabsf(fast.omega.z) < 0.17f)) {
             ap_system.yaw_stopped = true;
-            nav_yaw = ahrs.yaw_sensor;
+            nav.yaw = ahrs.yaw_sensor;
         }
     }else{
         if(motors.armed() == false || g.rc_3.control_in == 0)
-            nav_yaw = ahrs.yaw_sensor;
+            nav.yaw = ahrs.yaw_sensor;
 
-        get_stabilize_yaw(nav_yaw);
+        get_stabilize_yaw(nav.yaw);
     }
 #endif
 
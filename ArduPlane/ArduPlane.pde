@@ -52,11 +52,12 @@
 #include <AP_Relay.h>       // APM relay
 #include <AP_Camera.h>          // Photo or video camera
 #include <AP_Airspeed.h>
-#include <memcheck.h>
+#include <AP_BattMonitor.h> // Battery voltage and current
 
 #include <APM_OBC.h>
 #include <APM_Control.h>
 #include <GCS_MAVLink.h>    // MAVLink GCS definitions
+#include <memcheck.h>       // after GCS_MAVLink for memcheck_send_mavlink()
 #include <AP_Mount.h>           // Camera/Antenna mount
 #include <AP_Declination.h> // ArduPilot Mega Declination Helper Library
 #include <DataFlash.h>
@@ -66,6 +67,9 @@
 #include <AP_Navigation.h>
 #include <AP_L1_Control.h>
 #include <AP_RCMapper.h>        // RC input mapping library
+#include <AP_MissionStore.h>    // packed mission storage
+#include <AP_Terrain.h>         // terrain heights from the GCS
+#include <AP_Rally.h>           // rally points to return to
 
 #include <AP_SpdHgtControl.h>
 #include <AP_TECS.h>
@@ -103,9 +107,15 @@ APM_OBC obc;
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////
-// the rate we run the main loop at
+// the rate we run the main loop at, set from the LOOP_RATE parameter
 ////////////////////////////////////////////////////////////////////////////////
-static const AP_InertialSensor::Sample_rate ins_sample_rate = AP_InertialSensor::RATE_50HZ;
+static AP_InertialSensor::Sample_rate ins_sample_rate = AP_InertialSensor::RATE_50HZ;
+
+// milliseconds between main loops
+static uint8_t loop_period_ms = 20;
+
+// main loops per 20ms tick of the scheduler table
+static uint8_t loops_per_tick = 1;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Parameters
@@ -152,6 +162,17 @@ DataFlash_Empty DataFlash;
 #endif
 #endif
 
+////////////////////////////////////////////////////////////////////////////////
+// Terrain
+////////////////////////////////////////////////////////////////////////////////
+#if AP_TERRAIN_AVAILABLE
+#if CONFIG_HAL_BOARD == HAL_BOARD_PX4
+static AP_Terrain terrain("/fs/microsd/APM/TERRAIN.DAT");
+#else
+static AP_Terrain terrain("terrain.dat");
+#endif
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Sensors
 ////////////////////////////////////////////////////////////////////////////////
@@ -244,7 +265,13 @@ AP_InertialSensor_Oilpan ins( &apm1_adc );
   #error Unrecognised CONFIG_INS_TYPE setting.
 #endif // CONFIG_INS_TYPE
 
+#if AHRS_QUATERNION_ENABLED == ENABLED
+AP_AHRS_Quaternion ahrs(&ins, g_gps);
+#elif AP_AHRS_NAVEKF_AVAILABLE
+AP_AHRS_NavEKF ahrs(&ins, g_gps);       // EKF selected by AHRS_EKF_USE
+#else
 AP_AHRS_DCM ahrs(&ins, g_gps);
+#endif
 
 static AP_L1_Control L1_controller(&ahrs);
 static AP_TECS TECS_controller(&ahrs, aparm);
@@ -262,6 +289,10 @@ static bool training_manual_pitch; // user has manual pitch control
 ////////////////////////////////////////////////////////////////////////////////
 static GCS_MAVLINK gcs0;
 static GCS_MAVLINK gcs3;
+// passes on messages between the two links
+static MAVLink_routing mavlink_router;
+// texts waiting to go to the two links
+static MAVLink_statustext gcs_statustext;
 
 // selected navigation controller
 static AP_Navigation *nav_controller = &L1_controller;
@@ -281,6 +312,9 @@ static AP_HAL::AnalogSource *vcc_pin;
 static AP_HAL::AnalogSource * batt_volt_pin;
 static AP_HAL::AnalogSource * batt_curr_pin;
 
+// samples the battery from the timer
+static AP_BattMonitor battery_monitor;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Relay
 ////////////////////////////////////////////////////////////////////////////////
@@ -411,9 +445,13 @@ static int32_t hold_course_cd                 = -1;              // deg * 100 di
 
 // There may be two active commands in Auto mode.
 // This indicates the active navigation command by index number
-static uint8_t nav_command_index;
+static uint16_t nav_command_index;
 // This indicates the active non-navigation command by index number
-static uint8_t non_nav_command_index;
+static uint16_t non_nav_command_index;
+// The mission commands, packed into the storage after the parameters
+static AP_MissionStore mission(MISSION_START_BYTE, MISSION_END_BYTE);
+// The rally points, stored after the mission
+static AP_Rally rally(RALLY_START_BYTE, MAX_RALLYPOINTS);
 // This is the command type (eg navigate to waypoint) of the active navigation command
 static uint8_t nav_command_ID          = NO_COMMAND;
 static uint8_t non_nav_command_ID      = NO_COMMAND;
@@ -463,8 +501,6 @@ static struct {
     float current_total_mah;
     // true when a low battery event has happened
     bool low_batttery;
-    // time when current was last read
-    uint32_t last_time_ms;
 } battery;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -609,11 +645,15 @@ static struct   Location home;
 // Flag for if we have g_gps lock and have set the home location
 static bool home_is_set;
 // The location of the previous waypoint.  Used for track following and altitude ramp calculations
-static struct   Location prev_WP;
+static struct   Position prev_WP;
 // The plane's current location
-static struct   Location current_loc;
+static struct   Position current_loc;
 // The location of the current/active waypoint.  Used for altitude ramp, track following and loiter calculations.
-static struct   Location next_WP;
+static struct   Position next_WP;
+// The mission command ids of prev_WP and next_WP, which only hold the
+// points. 0 for a point that is not a command, such as current_loc
+static uint8_t prev_WP_id;
+static uint8_t next_WP_id;
 // The location of the active waypoint in Guided mode.
 static struct   Location guided_WP;
 // The location structure information from the Nav command being processed
@@ -628,6 +668,9 @@ static struct   Location next_nonnav_command;
 static int32_t target_altitude_cm;
 // Altitude difference between previous and current waypoint.  Centimeters
 static int32_t offset_altitude_cm;
+// Height of the terrain below the plane above the terrain at home when
+// following the terrain, else zero.  Centimeters
+static int32_t terrain_offset_cm;
 
 ////////////////////////////////////////////////////////////////////////////////
 // INS variables
@@ -691,13 +734,10 @@ AP_Mount camera_mount2(&current_loc, g_gps, &ahrs, 1);
   scheduler table - all regular tasks apart from the fast_loop()
   should be listed here, along with how often they should be called
   (in 20ms units) and the maximum time they are expected to take (in
-  microseconds)
+  microseconds). The units stay 20ms whatever the loop rate, as the
+  scheduler is told how many loops make a tick
  */
 static const AP_Scheduler::Task scheduler_tasks[] PROGMEM = {
-    { update_speed_height,    1,    900 },
-    { update_flight_mode,     1,   1000 },
-    { stabilize,              1,   3200 },
-    { set_servos,             1,   1100 },
     { read_control_switch,    7,   1000 },
     { update_GPS,             5,   4000 },
     { navigate,               5,   4800 },
@@ -716,10 +756,13 @@ static const AP_Scheduler::Task scheduler_tasks[] PROGMEM = {
     { compass_accumulate,     1,   1500 },
     { barometer_accumulate,   1,    900 },
     { one_second_loop,       50,   3900 },
-    { airspeed_ratio_update, 50,   1000 },
+    { airspeed_ratio_update, 50,   4000 },
     { update_logging,         5,   1000 },
+    { update_log_erase,       2,    200 },
     { read_receiver_rssi,     5,   1000 },
     { check_long_failsafe,   15,   1000 },
+    { update_terrain,        10,   1500 },
+    { update_rally,           5,   1000 },
 };
 
 // setup the var_info table
@@ -741,17 +784,20 @@ void setup() {
 
     batt_volt_pin = hal.analogin->channel(g.battery_volt_pin);
     batt_curr_pin = hal.analogin->channel(g.battery_curr_pin);
+    battery_monitor.init(batt_volt_pin, batt_curr_pin);
    
     init_ardupilot();
 
     // initialise the main loop scheduler
     scheduler.init(&scheduler_tasks[0], sizeof(scheduler_tasks)/sizeof(scheduler_tasks[0]));
+    scheduler.set_loops_per_tick(loops_per_tick);
+    scheduler.set_loop_period(loop_period_ms * 1000UL);
 }
 
 void loop()
 {
     uint32_t timer = millis();
-    // We want this to execute at 50Hz, but synchronised with the gyro/accel
+    // We want this to execute at the loop rate, but synchronised with the gyro/accel
     uint16_t num_samples = ins.num_samples_available();
     if (num_samples >= 1) {
         delta_ms_fast_loop      = timer - fast_loopTimer_ms;
@@ -771,20 +817,20 @@ void loop()
         fast_loopTimeStamp_ms = millis();
     } else {
         uint16_t dt = timer - fast_loopTimer_ms;
-        // we use 19 not 20 here to ensure we run the next loop on
-        // time - it means we spin for 5% of the time when waiting for
-        // the next sample from the IMU
-        if (dt < 19) {
-            uint16_t time_to_next_loop = 19 - dt;
+        // we stop 1ms short of the loop period to ensure we run the
+        // next loop on time - at 50Hz it means we spin for 5% of the
+        // time when waiting for the next sample from the IMU
+        if (dt < loop_period_ms - 1) {
+            uint16_t time_to_next_loop = loop_period_ms - 1 - dt;
             scheduler.run(time_to_next_loop * 1000U);
         }
     }
 }
 
-// Main loop 50Hz
+// Main loop, at LOOP_RATE
 static void fast_loop()
 {
-    // This is the fast loop - we want it to execute at 50Hz if possible
+    // This is the fast loop - we want it to execute at the loop rate if possible
     // -----------------------------------------------------------------
     if (delta_ms_fast_loop > G_Dt_max)
         G_Dt_max = delta_ms_fast_loop;
@@ -813,15 +859,49 @@ static void fast_loop()
 
     if (g.log_bitmask & MASK_LOG_IMU)
         Log_Write_IMU();
+
+    // the controllers run on every loop, so faster loops give lower
+    // latency control. They all work from the time since their last
+    // update, so don't depend on the loop rate
+    update_speed_height();
+    update_flight_mode();
+    stabilize();
+    set_servos();
+}
+
+/*
+  set the loop rate from the LOOP_RATE parameter, before the INS is
+  started. Only 50, 100 and 200Hz are supported
+ */
+static void init_loop_rate(void)
+{
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+    // the task time allowances are for the APM running at 50Hz, it
+    // has no time for a faster loop
+    g.loop_rate.set(50);
+#endif
+    if (g.loop_rate >= 200) {
+        ins_sample_rate = AP_InertialSensor::RATE_200HZ;
+        loop_period_ms = 5;
+        loops_per_tick = 4;
+    } else if (g.loop_rate >= 100) {
+        ins_sample_rate = AP_InertialSensor::RATE_100HZ;
+        loop_period_ms = 10;
+        loops_per_tick = 2;
+    } else {
+        ins_sample_rate = AP_InertialSensor::RATE_50HZ;
+        loop_period_ms = 20;
+        loops_per_tick = 1;
+    }
 }
 
 /*
-  update 50Hz speed/height controller
+  update the speed/height controller's height filter, on every loop
  */
 static void update_speed_height(void)
 {
     if (auto_throttle_mode && !throttle_suppressed) {
-	    // Call TECS 50Hz update
+	    // Call TECS 50Hz update, which uses the actual time step
         SpdHgt_Controller->update_50hz(relative_altitude());
     }
 }
@@ -892,6 +972,15 @@ static void update_logging(void)
     
     if (g.log_bitmask & MASK_LOG_NTUN)
         Log_Write_Nav_Tuning();
+
+#if AP_INERTIAL_SENSOR_BATCH
+    if (g.log_bitmask & MASK_LOG_IMU) {
+        AP_InertialSensor_Batch::result vibe;
+        if (ins.batch_update(vibe)) {
+            DataFlash.Log_Write_Vibe(vibe);
+        }
+    }
+#endif
 }
 
 /*
@@ -908,6 +997,34 @@ static void obc_fs_check(void)
 }
 
 
+/*
+  ask for the terrain along the mission, and keep the height of the
+  terrain below us while following it
+ */
+static void update_terrain(void)
+{
+#if AP_TERRAIN_AVAILABLE
+    if (terrain.update(current_loc, next_WP)) {
+        gcs_send_message(MSG_TERRAIN);
+    }
+    float height;
+    if (!terrain.follow_enabled()) {
+        terrain_offset_cm = 0;
+    } else if (home_is_set && terrain.height_above_home(current_loc, home, height)) {
+        terrain_offset_cm = height * 100;
+    }
+    // otherwise hold the last known height until the terrain arrives
+#endif
+}
+
+/*
+  rebuild the index of the rally points after they have changed
+ */
+static void update_rally(void)
+{
+    rally.update();
+}
+
 /*
   update aux servo mappings
  */
@@ -967,16 +1084,28 @@ static void one_second_loop()
 }
 
 /*
-  once a second update the airspeed calibration ratio
+  keep a sample for the airspeed calibration each time the airspeed
+  is read
  */
-static void airspeed_ratio_update(void)
+static void airspeed_calibration_sample(void)
 {
-    if (!airspeed.enabled() ||
+    if (g_gps == NULL ||
         g_gps->status() < GPS::GPS_OK_FIX_3D ||
         g_gps->ground_speed_cm < 400) {
         return;
     }
-    airspeed.update_calibration(g_gps->velocity_vector());
+    airspeed.add_calibration_sample(g_gps->velocity_vector());
+}
+
+/*
+  once a second update the airspeed calibration ratio from the samples
+ */
+static void airspeed_ratio_update(void)
+{
+    if (!airspeed.enabled()) {
+        return;
+    }
+    airspeed.update_calibration();
 }
 
 
@@ -785,12 +785,10 @@ static void set_servos(void)
         channel_output_mixer(g.elevon_output, channel_pitch->radio_out, channel_roll->radio_out);
     }
 
-    // send values to the PWM timers for output
+    // send values to the PWM timers for output, all at once when the
+    // main channels are pushed
     // ----------------------------------------
-    channel_roll->output();
-    channel_pitch->output();
-    channel_throttle->output();
-    channel_rudder->output();
+    hal.rcout->cork();
     // Route configurable aux. functions to their respective servos
     g.rc_5.output_ch(CH_5);
     g.rc_6.output_ch(CH_6);
@@ -806,6 +804,8 @@ static void set_servos(void)
  #if CONFIG_HAL_BOARD == HAL_BOARD_PX4
     g.rc_12.output_ch(CH_12);
  # endif
+    RC_Channel *const channels[] = { channel_roll, channel_pitch, channel_throttle, channel_rudder };
+    RC_Channel::output_all(channels, sizeof(channels)/sizeof(channels[0]));
 }
 
 static bool demoing_servos;
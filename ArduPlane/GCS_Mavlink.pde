@@ -12,6 +12,11 @@ static bool	gcs_out_of_time;
 // check if a message will fit in the payload space available
 #define CHECK_PAYLOAD_SIZE(id) if (payload_space < MAVLINK_MSG_ID_ ## id ## _LEN) return false
 
+// link rate estimates in bytes per second. The default suits a 57600 baud radio
+#define LINK_RATE_MIN       500
+#define LINK_RATE_DEFAULT   5760
+#define LINK_RATE_MAX       11520
+
 /*
  *  !!NOTE!!
  *
@@ -95,7 +100,7 @@ static NOINLINE void send_heartbeat(mavlink_channel_t chan)
     // indicate we have set a custom mode
     base_mode |= MAV_MODE_FLAG_CUSTOM_MODE_ENABLED;
 
-    mavlink_msg_heartbeat_send(
+    mavlink_msg_heartbeat_send_cached(
         chan,
         MAV_TYPE_FIXED_WING,
         MAV_AUTOPILOT_ARDUPILOTMEGA,
@@ -216,7 +221,7 @@ static NOINLINE void send_extended_status1(mavlink_channel_t chan, uint16_t pack
     uint16_t battery_current = -1;
     uint8_t battery_remaining = -1;
 
-    if (battery.last_time_ms != 0) {
+    if (g.battery_monitoring == 4) {
         if (g.pack_capacity != 0) {
             battery_remaining = (100.0 * (g.pack_capacity - battery.current_total_mah) / g.pack_capacity);
         }
@@ -230,7 +235,7 @@ static NOINLINE void send_extended_status1(mavlink_channel_t chan, uint16_t pack
         battery_remaining = 150;
     }
 
-    mavlink_msg_sys_status_send(
+    mavlink_msg_sys_status_send_cached(
         chan,
         control_sensors_present,
         control_sensors_enabled,
@@ -501,11 +506,7 @@ static void NOINLINE send_current_waypoint(mavlink_channel_t chan)
 
 static void NOINLINE send_statustext(mavlink_channel_t chan)
 {
-    mavlink_statustext_t *s = (chan == MAVLINK_COMM_0?&gcs0.pending_status:&gcs3.pending_status);
-    mavlink_msg_statustext_send(
-        chan,
-        s->severity,
-        s->text);
+    gcs_statustext.send(chan);
 }
 
 // are we still delaying telemetry to try to avoid Xbee bricking?
@@ -647,6 +648,17 @@ static bool mavlink_try_send_message(mavlink_channel_t chan, enum ap_message id,
         }
         break;
 
+    case MSG_NEXT_LOG:
+#if LOGGING_ENABLED == ENABLED
+        CHECK_PAYLOAD_SIZE(LOG_DATA);
+        if (chan == MAVLINK_COMM_0) {
+            gcs0.queued_log_send();
+        } else if (gcs3.initialised) {
+            gcs3.queued_log_send();
+        }
+#endif
+        break;
+
     case MSG_STATUSTEXT:
         CHECK_PAYLOAD_SIZE(STATUSTEXT);
         send_statustext(chan);
@@ -679,6 +691,18 @@ static bool mavlink_try_send_message(mavlink_channel_t chan, enum ap_message id,
         send_wind(chan);
         break;
 
+    case MSG_MEMCHECK:
+        CHECK_PAYLOAD_SIZE(DATA32);
+        memcheck_send_mavlink(chan);
+        break;
+
+    case MSG_TERRAIN:
+#if AP_TERRAIN_AVAILABLE
+        CHECK_PAYLOAD_SIZE(DATA16);
+        terrain.send_request(chan);
+#endif
+        break;
+
     case MSG_RETRY_DEFERRED:
         break; // just here to prevent a warning
     }
@@ -686,62 +710,99 @@ static bool mavlink_try_send_message(mavlink_channel_t chan, enum ap_message id,
 }
 
 
-#define MAX_DEFERRED_MESSAGES MSG_RETRY_DEFERRED
+#define MAVLINK_MESSAGE(id, msg, min_rate) { id, min_rate, MAVLINK_MSG_ID_ ## msg ## _LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES }
+
+// every ap_message, most important first, with the rate in Hz streamed
+// messages are kept to when the link is congested (0 for none) and
+// their length on the link
+static const struct mavlink_message_info {
+    uint8_t id;
+    uint8_t min_rate;
+    uint8_t length;
+} mavlink_messages[] PROGMEM = {
+    MAVLINK_MESSAGE(MSG_HEARTBEAT,               HEARTBEAT,              0),
+    MAVLINK_MESSAGE(MSG_STATUSTEXT,              STATUSTEXT,             0),
+    MAVLINK_MESSAGE(MSG_NEXT_WAYPOINT,           MISSION_REQUEST,        0),
+    MAVLINK_MESSAGE(MSG_NEXT_PARAM,              PARAM_VALUE,            0),
+    MAVLINK_MESSAGE(MSG_NEXT_LOG,                LOG_DATA,               0),
+    MAVLINK_MESSAGE(MSG_ATTITUDE,                ATTITUDE,               4),
+    MAVLINK_MESSAGE(MSG_LOCATION,                GLOBAL_POSITION_INT,    2),
+    MAVLINK_MESSAGE(MSG_EXTENDED_STATUS1,        SYS_STATUS,             1),
+    MAVLINK_MESSAGE(MSG_VFR_HUD,                 VFR_HUD,                1),
+    MAVLINK_MESSAGE(MSG_GPS_RAW,                 GPS_RAW_INT,            1),
+    MAVLINK_MESSAGE(MSG_FENCE_STATUS,            FENCE_STATUS ,          1),
+    MAVLINK_MESSAGE(MSG_CURRENT_WAYPOINT,        MISSION_CURRENT,        0),
+    MAVLINK_MESSAGE(MSG_NAV_CONTROLLER_OUTPUT,   NAV_CONTROLLER_OUTPUT,  0),
+    MAVLINK_MESSAGE(MSG_RADIO_IN,                RC_CHANNELS_RAW,        0),
+    MAVLINK_MESSAGE(MSG_RADIO_OUT,               SERVO_OUTPUT_RAW,       0),
+    MAVLINK_MESSAGE(MSG_SERVO_OUT,               RC_CHANNELS_SCALED,     0),
+    MAVLINK_MESSAGE(MSG_AHRS,                    AHRS,                   0),
+    MAVLINK_MESSAGE(MSG_HWSTATUS,                HWSTATUS,               0),
+    MAVLINK_MESSAGE(MSG_WIND,                    WIND,                   0),
+    MAVLINK_MESSAGE(MSG_EXTENDED_STATUS2,        MEMINFO,                0),
+    MAVLINK_MESSAGE(MSG_MEMCHECK,                DATA32,                 0),
+    MAVLINK_MESSAGE(MSG_TERRAIN,                 DATA16,                 0),
+    MAVLINK_MESSAGE(MSG_RAW_IMU1,                RAW_IMU,                0),
+    MAVLINK_MESSAGE(MSG_RAW_IMU2,                SCALED_PRESSURE,        0),
+    MAVLINK_MESSAGE(MSG_RAW_IMU3,                SENSOR_OFFSETS,         0),
+    MAVLINK_MESSAGE(MSG_SIMSTATE,                SIMSTATE,               0),
+};
+
+// deferred messages older than this many 16ms ticks are dropped
+#define MAVLINK_DEFER_TIMEOUT_TICKS 64
+
+// the messages waiting for space on each channel. Deferring a message
+// that is already waiting just leaves it waiting, so only the latest
+// data is sent
 static struct mavlink_queue {
-    enum ap_message deferred_messages[MAX_DEFERRED_MESSAGES];
-    uint8_t next_deferred_message;
-    uint8_t num_deferred_messages;
+    uint32_t deferred;                          // bitmask of deferred ap_message ids
+    uint8_t deferred_tick[MSG_RETRY_DEFERRED];  // when each was deferred, in 16ms ticks
 } mavlink_queue[2];
 
 // send a message using mavlink
 static void mavlink_send_message(mavlink_channel_t chan, enum ap_message id, uint16_t packet_drops)
 {
-    uint8_t i, nextid;
     struct mavlink_queue *q = &mavlink_queue[(uint8_t)chan];
+    uint8_t tick = millis() >> 4;
 
-    // see if we can send the deferred messages, if any
-    while (q->num_deferred_messages != 0) {
-        if (!mavlink_try_send_message(chan,
-                                      q->deferred_messages[q->next_deferred_message],
-                                      packet_drops)) {
-            break;
-        }
-        q->next_deferred_message++;
-        if (q->next_deferred_message == MAX_DEFERRED_MESSAGES) {
-            q->next_deferred_message = 0;
-        }
-        q->num_deferred_messages--;
+    if (id != MSG_RETRY_DEFERRED && (q->deferred & (1UL<<id)) == 0) {
+        q->deferred |= (1UL<<id);
+        q->deferred_tick[id] = tick;
     }
-
-    if (id == MSG_RETRY_DEFERRED) {
+    if ((q->deferred & (1UL<<MSG_STATUSTEXT)) == 0 && gcs_statustext.pending(chan)) {
+        // texts go one at a time, so keep asking while more are waiting
+        q->deferred |= (1UL<<MSG_STATUSTEXT);
+        q->deferred_tick[MSG_STATUSTEXT] = tick;
+    }
+    if (q->deferred == 0) {
         return;
     }
 
-    // this message id might already be deferred
-    for (i=0, nextid = q->next_deferred_message; i < q->num_deferred_messages; i++) {
-        if (q->deferred_messages[nextid] == id) {
-            // its already deferred, discard
-            return;
+    // send what fits in the tx space, most important first, asking
+    // for the space only once
+    int16_t space = comm_get_txspace(chan);
+    for (uint8_t i=0; i<sizeof(mavlink_messages)/sizeof(mavlink_messages[0]) && q->deferred != 0; i++) {
+        uint8_t msg_id = pgm_read_byte(&mavlink_messages[i].id);
+        uint32_t bit = 1UL<<msg_id;
+        if ((q->deferred & bit) == 0) {
+            continue;
         }
-        nextid++;
-        if (nextid == MAX_DEFERRED_MESSAGES) {
-            nextid = 0;
+        if ((uint8_t)(tick - q->deferred_tick[msg_id]) > MAVLINK_DEFER_TIMEOUT_TICKS) {
+            // too old to be of use
+            q->deferred &= ~bit;
+            continue;
         }
-    }
-
-    if (q->num_deferred_messages != 0 ||
-        !mavlink_try_send_message(chan, id, packet_drops)) {
-        // can't send it now, so defer it
-        if (q->num_deferred_messages == MAX_DEFERRED_MESSAGES) {
-            // the defer buffer is full, discard
-            return;
+        uint8_t length = pgm_read_byte(&mavlink_messages[i].length);
+        if (length > space) {
+            // a shorter, less important message may still fit
+            continue;
         }
-        nextid = q->next_deferred_message + q->num_deferred_messages;
-        if (nextid >= MAX_DEFERRED_MESSAGES) {
-            nextid -= MAX_DEFERRED_MESSAGES;
+        if (!mavlink_try_send_message(chan, (enum ap_message)msg_id, packet_drops)) {
+            // out of time or telemetry delayed
+            break;
         }
-        q->deferred_messages[nextid] = id;
-        q->num_deferred_messages++;
+        space -= length;
+        q->deferred &= ~bit;
     }
 }
 
@@ -751,15 +812,10 @@ void mavlink_send_text(mavlink_channel_t chan, gcs_severity severity, const char
         return;
     }
 
-    if (severity == SEVERITY_LOW) {
-        // send via the deferred queuing system
-        mavlink_statustext_t *s = (chan == MAVLINK_COMM_0?&gcs0.pending_status:&gcs3.pending_status);
-        s->severity = (uint8_t)severity;
-        strncpy((char *)s->text, str, sizeof(s->text));
+    // sent straight away if there is room, otherwise by the deferred
+    // message handling
+    if (gcs_statustext.queue(chan, (uint8_t)severity, str)) {
         mavlink_send_message(chan, MSG_STATUSTEXT, 0);
-    } else {
-        // send immediately
-        mavlink_msg_statustext_send(chan, severity, str);
     }
 }
 
@@ -854,7 +910,13 @@ const AP_Param::GroupInfo GCS_MAVLINK::var_info[] PROGMEM = {
 GCS_MAVLINK::GCS_MAVLINK() :
     packet_drops(0),
     waypoint_send_timeout(1000), // 1 second
-    waypoint_receive_timeout(1000) // 1 second
+    waypoint_receive_timeout(1000), // 1 second
+    stream_pending(0),
+    link_rate(LINK_RATE_DEFAULT),
+    link_budget(0),
+    link_radio_txbuf(100),
+    _log_next_list_entry(0),
+    _log_num_data(0)
 {
     AP_Param::setup_object_defaults(this, var_info);
 }
@@ -879,44 +941,29 @@ GCS_MAVLINK::update(void)
 {
     // receive new packets
     mavlink_message_t msg;
-    mavlink_status_t status;
-    status.packet_rx_drop_count = 0;
-
-    // process received bytes
-    uint16_t nbytes = comm_get_available(chan);
-    for (uint16_t i=0; i<nbytes; i++)
-    {
-        uint8_t c = comm_receive_ch(chan);
-
-#if CLI_ENABLED == ENABLED
-        /* allow CLI to be started by hitting enter 3 times, if no
-         *  heartbeat packets have been received */
-        if (mavlink_active == 0 && (millis() - _cli_timeout) < 20000 && 
-            comm_is_idle(chan)) {
-            if (c == '\n' || c == '\r') {
-                crlf_count++;
-            } else {
-                crlf_count = 0;
-            }
-            if (crlf_count == 3) {
-                run_cli(_port);
-            }
+    while (_parser.receive(_port, msg)) {
+        // we exclude radio packets to make it possible to use the
+        // CLI over the radio
+        if (msg.msgid != MAVLINK_MSG_ID_RADIO) {
+            mavlink_active = true;
         }
-#endif
-
-        // Try to get a new message
-        if (mavlink_parse_char(chan, c, &msg, &status)) {
-            // we exclude radio packets to make it possible to use the
-            // CLI over the radio
-            if (msg.msgid != MAVLINK_MSG_ID_RADIO) {
-                mavlink_active = true;
-            }
+        if (mavlink_router.check_and_forward(chan, &msg)) {
             handleMessage(&msg);
         }
     }
 
+#if CLI_ENABLED == ENABLED
+    /* allow CLI to be started by hitting enter 3 times, if no
+     *  heartbeat packets have been received */
+    if (mavlink_active == 0 && (millis() - _cli_timeout) < 20000 &&
+        _parser.crlf_count() >= 3) {
+        _parser.reset_crlf_count();
+        run_cli(_port);
+    }
+#endif
+
     // Update packet drops counter
-    packet_drops += status.packet_rx_drop_count;
+    packet_drops += _parser.take_errors();
 
     if (!waypoint_receiving) {
         return;
@@ -924,9 +971,12 @@ GCS_MAVLINK::update(void)
 
     uint32_t tnow = millis();
 
+    // the next item is only asked for once the storage can take it
+    // without stopping the main loop
     if (waypoint_receiving &&
         waypoint_request_i <= waypoint_request_last &&
-        tnow > waypoint_timelast_request + 500 + (stream_slowdown*20)) {
+        tnow > waypoint_timelast_request + 500 + (stream_slowdown*20) &&
+        hal.storage->write_space() >= AP_MISSIONSTORE_MAX_WRITE) {
         waypoint_timelast_request = tnow;
         send_message(MSG_NEXT_WAYPOINT);
     }
@@ -960,7 +1010,8 @@ bool GCS_MAVLINK::stream_trigger(enum streams stream_num)
         if (rate > 50) {
             rate = 50;
         }
-        stream_ticks[stream_num] = (50 / rate) + stream_slowdown;
+        // slowing down for the link is left to stream_send_pending()
+        stream_ticks[stream_num] = (50 / rate);
         return true;
     }
 
@@ -983,6 +1034,13 @@ GCS_MAVLINK::data_stream_send(void)
         }
     }
 
+    if (_log_next_list_entry != 0 || _log_num_data != 0) {
+        // logs use what the link has spare, at the rate of the params
+        if (stream_trigger(STREAM_PARAMS)) {
+            send_message(MSG_NEXT_LOG);
+        }
+    }
+
     if (gcs_out_of_time) return;
 
     if (in_mavlink_delay) {
@@ -1001,64 +1059,94 @@ GCS_MAVLINK::data_stream_send(void)
         return;
     }
 
-    if (gcs_out_of_time) return;
-
     if (stream_trigger(STREAM_RAW_SENSORS)) {
-        send_message(MSG_RAW_IMU1);
-        send_message(MSG_RAW_IMU2);
-        send_message(MSG_RAW_IMU3);
+        stream_pending |= (1UL<<MSG_RAW_IMU1) | (1UL<<MSG_RAW_IMU2) | (1UL<<MSG_RAW_IMU3);
     }
 
-    if (gcs_out_of_time) return;
-
     if (stream_trigger(STREAM_EXTENDED_STATUS)) {
-        send_message(MSG_EXTENDED_STATUS1);
-        send_message(MSG_EXTENDED_STATUS2);
-        send_message(MSG_CURRENT_WAYPOINT);
-        send_message(MSG_GPS_RAW);            // TODO - remove this message after location message is working
-        send_message(MSG_NAV_CONTROLLER_OUTPUT);
-        send_message(MSG_FENCE_STATUS);
+        stream_pending |= (1UL<<MSG_EXTENDED_STATUS1) | (1UL<<MSG_EXTENDED_STATUS2) |
+                          (1UL<<MSG_CURRENT_WAYPOINT) | (1UL<<MSG_GPS_RAW) |
+                          (1UL<<MSG_NAV_CONTROLLER_OUTPUT) | (1UL<<MSG_FENCE_STATUS);
     }
 
-    if (gcs_out_of_time) return;
-
     if (stream_trigger(STREAM_POSITION)) {
-        // sent with GPS read
-        send_message(MSG_LOCATION);
+        stream_pending |= (1UL<<MSG_LOCATION);
     }
 
-    if (gcs_out_of_time) return;
-
     if (stream_trigger(STREAM_RAW_CONTROLLER)) {
-        send_message(MSG_SERVO_OUT);
+        stream_pending |= (1UL<<MSG_SERVO_OUT);
     }
 
-    if (gcs_out_of_time) return;
-
     if (stream_trigger(STREAM_RC_CHANNELS)) {
-        send_message(MSG_RADIO_OUT);
-        send_message(MSG_RADIO_IN);
+        stream_pending |= (1UL<<MSG_RADIO_OUT) | (1UL<<MSG_RADIO_IN);
     }
 
-    if (gcs_out_of_time) return;
-
     if (stream_trigger(STREAM_EXTRA1)) {
-        send_message(MSG_ATTITUDE);
-        send_message(MSG_SIMSTATE);
+        stream_pending |= (1UL<<MSG_ATTITUDE) | (1UL<<MSG_SIMSTATE);
     }
 
-    if (gcs_out_of_time) return;
-
     if (stream_trigger(STREAM_EXTRA2)) {
-        send_message(MSG_VFR_HUD);
+        stream_pending |= (1UL<<MSG_VFR_HUD);
     }
 
-    if (gcs_out_of_time) return;
-
     if (stream_trigger(STREAM_EXTRA3)) {
-        send_message(MSG_AHRS);
-        send_message(MSG_HWSTATUS);
-        send_message(MSG_WIND);
+        stream_pending |= (1UL<<MSG_AHRS) | (1UL<<MSG_HWSTATUS) | (1UL<<MSG_WIND) |
+                          (1UL<<MSG_MEMCHECK);
+    }
+
+    stream_send_pending();
+}
+
+void
+GCS_MAVLINK::stream_send_pending(void)
+{
+    uint16_t tnow = millis();
+    bool link_full = false;
+    int16_t space = comm_get_txspace(chan);
+
+    // the budget grows at the estimated link rate, allowing a burst of 200ms
+    link_budget = min(link_budget + link_rate / 50, link_rate / 5);
+
+    // starved messages go first, then the rest in order of importance.
+    // A message still pending when the stream asks again is only sent once
+    for (uint8_t pass=0; pass<2 && stream_pending != 0 && !link_full; pass++) {
+        for (uint8_t i=0; i<sizeof(mavlink_messages)/sizeof(mavlink_messages[0]); i++) {
+            uint8_t id = pgm_read_byte(&mavlink_messages[i].id);
+            if ((stream_pending & (1UL<<id)) == 0) {
+                continue;
+            }
+            if (pass == 0) {
+                uint8_t min_rate = pgm_read_byte(&mavlink_messages[i].min_rate);
+                if (min_rate == 0 || (uint16_t)(tnow - stream_last_sent[id]) < 1000 / min_rate) {
+                    continue;
+                }
+            }
+            uint8_t length = pgm_read_byte(&mavlink_messages[i].length);
+            if (length > link_budget) {
+                // we are sending as fast as we think the link can go,
+                // so try it a little faster unless the radio is struggling
+                if (link_radio_txbuf >= 50 && link_rate < LINK_RATE_MAX) {
+                    link_rate += max(link_rate / 64, 1);
+                }
+                link_full = true;
+                break;
+            }
+            if (space < length) {
+                // the serial buffer is filling, so the link is slower than we thought
+                link_rate = max(link_rate - link_rate / 4, LINK_RATE_MIN);
+                link_full = true;
+                break;
+            }
+            if (!mavlink_try_send_message(chan, (enum ap_message)id, packet_drops)) {
+                // out of time or telemetry delayed
+                link_full = true;
+                break;
+            }
+            link_budget -= length;
+            space -= length;
+            stream_pending &= ~(1UL<<id);
+            stream_last_sent[id] = tnow;
+        }
     }
 }
 
@@ -1085,9 +1173,43 @@ GCS_MAVLINK::send_text_P(gcs_severity severity, const prog_char_t *str)
     mavlink_send_text(chan, severity, (const char *)m.text);
 }
 
+#if HIL_MODE == HIL_MODE_SENSORS
+/*
+  raw simulated sensors from the data of a DATA32 or DATA64, copied
+  straight into the HIL drivers without a MAVLink message of their own
+ */
+static void handle_hil_sensors(const uint8_t *data, uint8_t len)
+{
+    struct mavlink_hil_sensors pkt;
+    if (len < MAVLINK_HIL_SENSORS_GPS_OFS) {
+        return;
+    }
+    memcpy(&pkt, data, min(len, sizeof(pkt)));
+
+    ins.set_gyro(Vector3f(pkt.gyro[0], pkt.gyro[1], pkt.gyro[2]) * 0.001f);
+    ins.set_accel(Vector3f(pkt.accel[0], pkt.accel[1], pkt.accel[2]) * 0.01f);
+    compass.setHIL(Vector3f(pkt.mag[0], pkt.mag[1], pkt.mag[2]));
+    barometer.setHIL(pkt.baro_alt_cm * 0.01f);
+    airspeed.disable();
+
+    if (len < sizeof(pkt)) {
+        // no GPS fix in this one
+        return;
+    }
+    float vel = pythagorous2(pkt.vel_north, pkt.vel_east);
+    float cog = wrap_360_cd(ToDeg(atan2f(pkt.vel_east, pkt.vel_north)) * 100);
+    if (g_gps != NULL) {
+        g_gps->setHIL(pkt.time_ms,
+                      pkt.lat*1.0e-7f, pkt.lng*1.0e-7f, pkt.gps_alt_cm*0.01f,
+                      vel*0.01f, cog*0.01f, 0, 10);
+    }
+}
+#endif
+
 void GCS_MAVLINK::handleMessage(mavlink_message_t* msg)
 {
-    struct Location tell_command = {};                // command for telemetry
+    struct Location tell_command;                     // command for telemetry
+    memset(&tell_command, 0, sizeof(tell_command));
 
     switch (msg->msgid) {
 
@@ -1492,6 +1614,7 @@ void GCS_MAVLINK::handleMessage(mavlink_message_t* msg)
 
         // clear all commands
         g.command_total.set_and_save(0);
+        mission.truncate(1);
 
         // note that we don't send multiple acks, as otherwise a
         // GCS that is doing a clear followed by a set may see
@@ -1527,6 +1650,9 @@ void GCS_MAVLINK::handleMessage(mavlink_message_t* msg)
         }
         g.command_total.set_and_save(packet.count - 1);
 
+        // the new mission replaces all but home, so free its space
+        mission.truncate(1);
+
         waypoint_timelast_receive = millis();
         waypoint_timelast_request = 0;
         waypoint_receiving   = true;
@@ -1745,7 +1871,10 @@ void GCS_MAVLINK::handleMessage(mavlink_message_t* msg)
                 goto mission_failed;
             }
 
-            set_cmd_with_index(tell_command, packet.seq);
+            if (!set_cmd_with_index(tell_command, packet.seq)) {
+                result = MAV_MISSION_NO_SPACE;
+                goto mission_failed;
+            }
 
             // update waypoint receiving state machine
             waypoint_timelast_receive = millis();
@@ -1778,21 +1907,20 @@ mission_failed:
     }
 
 #if GEOFENCE_ENABLED == ENABLED
-    // receive a fence point from GCS and store in EEPROM
+    // receive a fence point from GCS. The fence in use stays in force
+    // until all the points of the new one have arrived
     case MAVLINK_MSG_ID_FENCE_POINT: {
         mavlink_fence_point_t packet;
         mavlink_msg_fence_point_decode(msg, &packet);
         if (mavlink_check_target(packet.target_system, packet.target_component))
             break;
-        if (g.fence_action != FENCE_ACTION_NONE) {
-            send_text_P(SEVERITY_LOW,PSTR("fencing must be disabled"));
-        } else if (packet.count != g.fence_total) {
+        if (packet.count != g.fence_total) {
             send_text_P(SEVERITY_LOW,PSTR("bad fence point"));
         } else {
             Vector2l point;
             point.x = packet.lat*1.0e7;
             point.y = packet.lng*1.0e7;
-            set_fence_point_with_index(point, packet.idx);
+            geofence_stage_point(point, packet.idx, packet.count);
         }
         break;
     }
@@ -1814,6 +1942,45 @@ mission_failed:
     }
 #endif // GEOFENCE_ENABLED
 
+    // receive a rally point from GCS and store in EEPROM
+    case MAVLINK_MSG_ID_RALLY_POINT: {
+        mavlink_rally_point_t packet;
+        mavlink_msg_rally_point_decode(msg, &packet);
+        if (mavlink_check_target(packet.target_system, packet.target_component))
+            break;
+        if (packet.idx >= rally.get_rally_total() ||
+            packet.count != rally.get_rally_total()) {
+            send_text_P(SEVERITY_LOW,PSTR("bad rally point"));
+        } else {
+            struct RallyLocation rally_point;
+            rally_point.lat = packet.lat;
+            rally_point.lng = packet.lng;
+            rally_point.alt = packet.alt;
+            rally_point.break_alt = packet.break_alt;
+            rally_point.land_dir = packet.land_dir;
+            rally_point.flags = packet.flags;
+            rally.set_rally_point_with_index(packet.idx, rally_point);
+        }
+        break;
+    }
+
+    // send a rally point to GCS
+    case MAVLINK_MSG_ID_RALLY_FETCH_POINT: {
+        mavlink_rally_fetch_point_t packet;
+        mavlink_msg_rally_fetch_point_decode(msg, &packet);
+        if (mavlink_check_target(packet.target_system, packet.target_component))
+            break;
+        struct RallyLocation rally_point;
+        if (!rally.get_rally_point_with_index(packet.idx, rally_point)) {
+            send_text_P(SEVERITY_LOW,PSTR("bad rally point"));
+        } else {
+            mavlink_msg_rally_point_send(chan, msg->sysid, msg->compid, packet.idx, rally.get_rally_total(),
+                                         rally_point.lat, rally_point.lng, rally_point.alt,
+                                         rally_point.break_alt, rally_point.land_dir, rally_point.flags);
+        }
+        break;
+    }
+
     case MAVLINK_MSG_ID_PARAM_SET:
     {
         AP_Param                  *vp;
@@ -1924,6 +2091,37 @@ mission_failed:
         break;
     }
 
+    case MAVLINK_MSG_ID_DATA16:
+    case MAVLINK_MSG_ID_DATA32:
+    case MAVLINK_MSG_ID_DATA64:
+    case MAVLINK_MSG_ID_DATA96:
+    {
+        // the type, len and data fields are laid out the same in all
+        // four, so the data can be passed on straight from the payload
+        const uint8_t *payload = (const uint8_t *)_MAV_PAYLOAD(msg);
+        if (msg->len <= 2) {
+            break;
+        }
+        uint8_t len = payload[1];
+        if (len > msg->len - 2) {
+            len = msg->len - 2;
+        }
+        if (payload[0] == MAVLINK_DATA_TYPE_GPS_INJECT && g_gps != NULL) {
+            g_gps->inject_data(&payload[2], len);
+        }
+#if AP_TERRAIN_AVAILABLE
+        if (payload[0] == MAVLINK_DATA_TYPE_TERRAIN) {
+            terrain.handle_data(&payload[2], len);
+        }
+#endif
+#if HIL_MODE == HIL_MODE_SENSORS
+        if (payload[0] == MAVLINK_DATA_TYPE_HIL_SENSORS) {
+            handle_hil_sensors(&payload[2], len);
+        }
+#endif
+        break;
+    }
+
 #if HIL_MODE != HIL_MODE_DISABLED
     case MAVLINK_MSG_ID_HIL_STATE:
     {
@@ -2003,6 +2201,13 @@ mission_failed:
         // use the state of the transmit buffer in the radio to
         // control the stream rate, giving us adaptive software
         // flow control
+        link_radio_txbuf = packet.txbuf;
+        if (packet.txbuf < 20) {
+            link_rate = max(link_rate - link_rate / 4, LINK_RATE_MIN);
+        } else if (packet.txbuf < 50) {
+            link_rate = max(link_rate - link_rate / 16, LINK_RATE_MIN);
+        }
+        // and also slow down the mission transfers
         if (packet.txbuf < 20 && stream_slowdown < 100) {
             // we are very low on space - slow down a lot
             stream_slowdown += 3;
@@ -2031,6 +2236,15 @@ mission_failed:
         }
         break;
 
+#if LOGGING_ENABLED == ENABLED
+    case MAVLINK_MSG_ID_LOG_REQUEST_LIST:
+    case MAVLINK_MSG_ID_LOG_REQUEST_DATA:
+    case MAVLINK_MSG_ID_LOG_ERASE:
+    case MAVLINK_MSG_ID_LOG_REQUEST_END:
+        handle_log_message(msg);
+        break;
+#endif
+
     } // end switch
 } // end handle mavlink
 
@@ -2061,17 +2275,24 @@ GCS_MAVLINK::queued_param_send()
         return;
     }
 
-    uint16_t bytes_allowed;
-    uint8_t count;
     uint32_t tnow = millis();
 
-    // use at most 30% of bandwidth on parameters. The constant 26 is
-    // 1/(1000 * 1/8 * 0.001 * 0.3)
-    bytes_allowed = g.serial3_baud * (tnow - _queued_parameter_send_time_ms) * 26;
-    if (bytes_allowed > comm_get_txspace(chan)) {
-        bytes_allowed = comm_get_txspace(chan);
+    // pack in as many parameters as fit in the free transmit space,
+    // leaving room for a heartbeat, but no faster than the link can
+    // drain them. serial3_baud is in units of 1000 baud, so the link
+    // moves serial3_baud/8 bytes per millisecond
+    uint32_t bytes_allowed = (uint32_t)g.serial3_baud * (tnow - _queued_parameter_send_time_ms) / 8;
+    uint16_t txspace = comm_get_txspace(chan);
+    const uint16_t reserve = MAVLINK_MSG_ID_HEARTBEAT_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+    txspace = (txspace > reserve) ? txspace - reserve : 0;
+    if (bytes_allowed > txspace) {
+        bytes_allowed = txspace;
+    }
+    uint16_t count = bytes_allowed / (MAVLINK_MSG_ID_PARAM_VALUE_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES);
+    if (count == 0) {
+        // let the budget build up
+        return;
     }
-    count = bytes_allowed / (MAVLINK_MSG_ID_PARAM_VALUE_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES);
 
     while (_queued_parameter != NULL && count--) {
         AP_Param      *vp;
@@ -2100,6 +2321,152 @@ GCS_MAVLINK::queued_param_send()
     _queued_parameter_send_time_ms = tnow;
 }
 
+#if LOGGING_ENABLED == ENABLED
+/**
+ * @brief Start, restart or stop a log transfer. There is no arming, so
+ * logs are only sent in MANUAL, as the flash reads would take time from
+ * the navigation code
+ */
+void GCS_MAVLINK::handle_log_message(mavlink_message_t *msg)
+{
+    if (control_mode != MANUAL) {
+        _log_next_list_entry = 0;
+        _log_num_data = 0;
+        return;
+    }
+
+    switch (msg->msgid) {
+    case MAVLINK_MSG_ID_LOG_REQUEST_LIST: {
+        mavlink_log_request_list_t packet;
+        mavlink_msg_log_request_list_decode(msg, &packet);
+        if (mavlink_check_target(packet.target_system, packet.target_component)) break;
+
+        _log_num_data = 0;
+        _log_num_logs = DataFlash.get_num_logs();
+        _log_last_log_num = DataFlash.find_last_log();
+        if (_log_num_logs == 0) {
+            mavlink_msg_log_entry_send(chan, 0, 0, 0, 0, 0);
+            break;
+        }
+        // the log ids are the log numbers
+        _log_next_list_entry = max(packet.start, (uint16_t)(_log_last_log_num - _log_num_logs + 1));
+        _log_last_list_entry = min(packet.end, _log_last_log_num);
+        if (_log_next_list_entry > _log_last_list_entry) {
+            _log_next_list_entry = 0;
+        }
+        _log_send_time_ms = millis();
+        break;
+    }
+
+    case MAVLINK_MSG_ID_LOG_REQUEST_DATA: {
+        mavlink_log_request_data_t packet;
+        mavlink_msg_log_request_data_decode(msg, &packet);
+        if (mavlink_check_target(packet.target_system, packet.target_component)) break;
+
+        _log_next_list_entry = 0;
+        if (packet.id != _log_num_data) {
+            uint16_t end_page;
+            _log_num_logs = DataFlash.get_num_logs();
+            _log_last_log_num = DataFlash.find_last_log();
+            if (packet.id > _log_last_log_num || packet.id + _log_num_logs <= _log_last_log_num) {
+                _log_num_data = 0;
+                break;
+            }
+            DataFlash.get_log_boundaries(packet.id, _log_data_page, end_page);
+            _log_num_data = packet.id;
+        }
+        // a new request replaces the one being sent, so the GCS can
+        // resume from where it got to, or fill in what it missed
+        _log_data_offset = packet.ofs;
+        _log_data_remaining = packet.count;
+        if (_log_data_remaining == 0) {
+            _log_num_data = 0;
+        }
+        _log_send_time_ms = millis();
+        break;
+    }
+
+    case MAVLINK_MSG_ID_LOG_ERASE: {
+        mavlink_log_erase_t packet;
+        mavlink_msg_log_erase_decode(msg, &packet);
+        if (mavlink_check_target(packet.target_system, packet.target_component)) break;
+
+        _log_next_list_entry = 0;
+        _log_num_data = 0;
+        in_mavlink_delay = true;
+        do_erase_logs();
+        in_mavlink_delay = false;
+        break;
+    }
+
+    case MAVLINK_MSG_ID_LOG_REQUEST_END: {
+        mavlink_log_request_end_t packet;
+        mavlink_msg_log_request_end_decode(msg, &packet);
+        if (mavlink_check_target(packet.target_system, packet.target_component)) break;
+
+        _log_next_list_entry = 0;
+        _log_num_data = 0;
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Send the next log entries or log data, called from deferred
+ * message handling code. Like the parameters this fills the
+ * free transmit space, no faster than the link drains it
+ */
+void
+GCS_MAVLINK::queued_log_send()
+{
+    uint32_t tnow = millis();
+    uint32_t bytes_allowed = (uint32_t)g.serial3_baud * (tnow - _log_send_time_ms) / 8;
+    uint16_t txspace = comm_get_txspace(chan);
+    const uint16_t reserve = MAVLINK_MSG_ID_HEARTBEAT_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+    txspace = (txspace > reserve) ? txspace - reserve : 0;
+    if (bytes_allowed > txspace) {
+        bytes_allowed = txspace;
+    }
+
+    if (_log_next_list_entry != 0) {
+        if (bytes_allowed < MAVLINK_MSG_ID_LOG_ENTRY_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES) {
+            return;
+        }
+        // one entry at a time, as finding a log's size can take a while
+        uint32_t size, time_utc;
+        DataFlash.get_log_info(_log_next_list_entry, size, time_utc);
+        mavlink_msg_log_entry_send(chan, _log_next_list_entry, _log_num_logs, _log_last_log_num, time_utc, size);
+        if (_log_next_list_entry == _log_last_list_entry) {
+            _log_next_list_entry = 0;
+        } else {
+            _log_next_list_entry++;
+        }
+        _log_send_time_ms = tnow;
+        return;
+    }
+
+    uint16_t count = bytes_allowed / (MAVLINK_MSG_ID_LOG_DATA_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES);
+    while (_log_num_data != 0 && count--) {
+        uint8_t data[MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN];
+        uint16_t len = min(_log_data_remaining, (uint32_t)sizeof(data));
+        int16_t ret = DataFlash.get_log_data(_log_num_data, _log_data_page, _log_data_offset, len, data);
+        if (ret < 0) {
+            // the backend is still reading it
+            break;
+        }
+        memset(&data[ret], 0, sizeof(data) - ret);
+        mavlink_msg_log_data_send(chan, _log_num_data, _log_data_offset, ret, data);
+        _log_data_offset += ret;
+        _log_data_remaining -= ret;
+        if (ret == 0 || _log_data_remaining == 0) {
+            // the end of the log, or of the request
+            _log_num_data = 0;
+        }
+        _log_send_time_ms = tnow;
+    }
+}
+#endif // LOGGING_ENABLED
+
 /**
  * @brief Send the next pending waypoint, called from deferred message
  * handling code
@@ -2148,6 +2515,9 @@ static void mavlink_delay_cb()
         last_5s = tnow;
         gcs_send_text_P(SEVERITY_LOW, PSTR("Initialising APM..."));
     }
+    // a barometer calibration started at startup goes on in the
+    // delays of the rest of it
+    barometer.update_calibration();
     check_usb_mux();
 
     in_mavlink_delay = false;
@@ -2199,24 +2569,20 @@ static void gcs_send_text_P(gcs_severity severity, const prog_char_t *str)
 
 /*
  *  send a low priority formatted message to the GCS
- *  only one fits in the queue, so if you send more than one before the
- *  last one gets into the serial buffer then the old one will be lost
  */
 void gcs_send_text_fmt(const prog_char_t *fmt, ...)
 {
+    char text[MAVLINK_STATUSTEXT_LEN];
     va_list arg_list;
-    gcs0.pending_status.severity = (uint8_t)SEVERITY_LOW;
     va_start(arg_list, fmt);
-    hal.util->vsnprintf_P((char *)gcs0.pending_status.text,
-            sizeof(gcs0.pending_status.text), fmt, arg_list);
+    hal.util->vsnprintf_P(text, sizeof(text), fmt, arg_list);
     va_end(arg_list);
 #if LOGGING_ENABLED == ENABLED
-    DataFlash.Log_Write_Message(gcs0.pending_status.text);
+    DataFlash.Log_Write_Message(text);
 #endif
-    gcs3.pending_status = gcs0.pending_status;
-    mavlink_send_message(MAVLINK_COMM_0, MSG_STATUSTEXT, 0);
+    mavlink_send_text(MAVLINK_COMM_0, SEVERITY_LOW, text);
     if (gcs3.initialised) {
-        mavlink_send_message(MAVLINK_COMM_1, MSG_STATUSTEXT, 0);
+        mavlink_send_text(MAVLINK_COMM_1, SEVERITY_LOW, text);
     }
 }
 
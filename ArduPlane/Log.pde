@@ -91,11 +91,26 @@ dump_log(uint8_t argc, const Menu::arg *argv)
     return 0;
 }
 
+static bool log_erase_running;
+
+// the erase carries on in the background from update_log_erase()
 static void do_erase_logs(void)
 {
     gcs_send_text_P(SEVERITY_LOW, PSTR("Erasing logs"));
-    DataFlash.EraseAll();
-    gcs_send_text_P(SEVERITY_LOW, PSTR("Log erase complete"));
+    DataFlash.EraseStart();
+    log_erase_running = true;
+}
+
+static void update_log_erase(void)
+{
+    if (!log_erase_running) {
+        return;
+    }
+    DataFlash.EraseUpdate();
+    if (DataFlash.EraseProgress() == 100) {
+        log_erase_running = false;
+        gcs_send_text_P(SEVERITY_LOW, PSTR("Log erase complete"));
+    }
 }
 
 static int8_t
@@ -103,6 +118,17 @@ erase_logs(uint8_t argc, const Menu::arg *argv)
 {
     in_mavlink_delay = true;
     do_erase_logs();
+    // nothing else runs from the CLI, so see the erase through
+    uint8_t last_progress = 0;
+    while (log_erase_running) {
+        update_log_erase();
+        uint8_t progress = DataFlash.EraseProgress();
+        if (progress >= last_progress + 10 && log_erase_running) {
+            cliSerial->printf_P(PSTR("%u%%\n"), (unsigned)progress);
+            last_progress = progress;
+        }
+        hal.scheduler->delay(1);
+    }
     in_mavlink_delay = false;
     return 0;
 }
@@ -210,12 +236,13 @@ static void Log_Write_Performance()
         i2c_lockup_count: hal.i2c->lockup_count()
     };
     DataFlash.WriteBlock(&pkt, sizeof(pkt));
+    DataFlash.Log_Write_Loop(scheduler);
 }
 
 struct PACKED log_Cmd {
     LOG_PACKET_HEADER;
-    uint8_t command_total;
-    uint8_t command_number;
+    uint16_t command_total;
+    uint16_t command_number;
     uint8_t waypoint_id;
     uint8_t waypoint_options;
     uint8_t waypoint_param1;
@@ -225,7 +252,7 @@ struct PACKED log_Cmd {
 };
 
 // Write a command processing packet. Total length : 19 bytes
-static void Log_Write_Cmd(uint8_t num, const struct Location *wp)
+static void Log_Write_Cmd(uint16_t num, const struct Location *wp)
 {
     struct log_Cmd pkt = {
         LOG_PACKET_HEADER_INIT(LOG_CMD_MSG),
@@ -273,7 +300,7 @@ static void Log_Write_Camera()
 struct PACKED log_Startup {
     LOG_PACKET_HEADER;
     uint8_t startup_type;
-    uint8_t command_total;
+    uint16_t command_total;
 };
 
 static void Log_Write_Startup(uint8_t type)
@@ -287,7 +314,7 @@ static void Log_Write_Startup(uint8_t type)
 
     // write all commands to the dataflash as well
     struct Location cmd;
-    for (uint8_t i = 0; i <= g.command_total; i++) {
+    for (uint16_t i = 0; i <= g.command_total; i++) {
         cmd = get_cmd_with_index(i);
         Log_Write_Cmd(i, &cmd);
     }
@@ -442,11 +469,11 @@ static const struct LogStructure log_structure[] PROGMEM = {
     { LOG_PERFORMANCE_MSG, sizeof(log_Performance), 
       "PM",  "IHhBBBhhhhB", "LTime,MLC,gDt,RNCnt,RNBl,GPScnt,GDx,GDy,GDz,I2CErr" },
     { LOG_CMD_MSG, sizeof(log_Cmd),                 
-      "CMD", "BBBBBeLL",   "CTot,CNum,CId,COpt,Prm1,Alt,Lat,Lng" },
+      "CMD", "HHBBBeLL",   "CTot,CNum,CId,COpt,Prm1,Alt,Lat,Lng" },
     { LOG_CAMERA_MSG, sizeof(log_Camera),                 
       "CAM", "ILLeccC",   "GPSTime,Lat,Lng,Alt,Roll,Pitch,Yaw" },
     { LOG_STARTUP_MSG, sizeof(log_Startup),         
-      "STRT", "BB",         "SType,CTot" },
+      "STRT", "BH",         "SType,CTot" },
     { LOG_CTUN_MSG, sizeof(log_Control_Tuning),     
       "CTUN", "cccchhf",    "NavRoll,Roll,NavPitch,Pitch,ThrOut,RdrOut,AccY" },
     { LOG_NTUN_MSG, sizeof(log_Nav_Tuning),         
@@ -486,7 +513,7 @@ static void start_logging()
 
 // dummy functions
 static void Log_Write_Startup(uint8_t type) {}
-static void Log_Write_Cmd(uint8_t num, const struct Location *wp) {}
+static void Log_Write_Cmd(uint16_t num, const struct Location *wp) {}
 static void Log_Write_Current() {}
 static void Log_Write_Nav_Tuning() {}
 static void Log_Write_TECS_Tuning() {}
@@ -502,6 +529,7 @@ static void Log_Write_IMU() {}
 static int8_t process_logs(uint8_t argc, const Menu::arg *argv) {
     return 0;
 }
+static void update_log_erase(void) {}
 
 
 #endif // LOGGING_ENABLED
@@ -92,6 +92,7 @@ public:
         k_param_relay,
         k_param_takeoff_throttle_delay,
         k_param_skip_gyro_cal,
+        k_param_loop_rate,
 
         // 110: Telemetry control
         //
@@ -132,6 +133,7 @@ public:
         k_param_barometer,   // barometer ground calibration
         k_param_airspeed,  // AP_Airspeed parameters
         k_param_curr_amp_offset,
+        k_param_gps_auto,
 
         //
         // 150: Navigation parameters
@@ -238,6 +240,8 @@ public:
         k_param_L1_controller,
         k_param_rcmap,
         k_param_TECS_controller,
+        k_param_terrain,
+        k_param_rally,
 
         //
         // 240: PID Controllers
@@ -281,6 +285,7 @@ public:
 
     // skip gyro calibration
     AP_Int8  skip_gyro_cal;
+    AP_Int16 loop_rate;
 
     // Estimation
     //
@@ -290,8 +295,8 @@ public:
     // Waypoints
     //
     AP_Int8 waypoint_mode;
-    AP_Int8 command_total;
-    AP_Int8 command_index;
+    AP_Int16 command_total;
+    AP_Int16 command_index;
     AP_Int16 waypoint_radius;
     AP_Int16 loiter_radius;
 
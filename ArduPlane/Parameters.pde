@@ -9,6 +9,7 @@
 #define ASCALAR(v, name, def) { aparm.v.vtype, name, Parameters::k_param_ ## v, &aparm.v, {def_value : def} }
 #define GGROUP(v, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## v, &g.v, {group_info : class::var_info} }
 #define GOBJECT(v, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## v, &v, {group_info : class::var_info} }
+#define GOBJECTN(v, pname, name, class) { AP_PARAM_GROUP, name, Parameters::k_param_ ## pname, &v, {group_info : class::var_info} }
 
 const AP_Param::Info var_info[] PROGMEM = {
     GSCALAR(format_version,         "FORMAT_VERSION", 0),
@@ -81,6 +82,14 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @User: Advanced
     GSCALAR(skip_gyro_cal,           "SKIP_GYRO_CAL",   0),
 
+    // @Param: LOOP_RATE
+    // @DisplayName: Main loop rate
+    // @Description: The rate the attitude, speed and height controllers and the servo outputs run at. Faster rates give lower latency control on boards with the processing time to spare. The APM1 and APM2 always run at 50Hz. Takes effect after a reboot
+    // @Units: Hz
+    // @Values: 50:50Hz,100:100Hz,200:200Hz
+    // @User: Advanced
+    GSCALAR(loop_rate,               "LOOP_RATE",       50),
+
     // @Param: TKOFF_THR_MINSPD
     // @DisplayName: Takeoff throttle min speed
     // @Description: Minimum GPS ground speed in m/s used by the speed check that un-suppresses throttle in auto-takeoff. This can be be used for catapult launches where you want the motor to engage only after the plane leaves the catapult, but it is preferable to use the TKOFF_THR_MINACC and TKOFF_THR_DELAY parameters for cvatapult launches due to the errors associated with GPS measurements. For hand launches with a pusher prop it is strongly advised that this parameter be set to a value no less than 4 m/s to provide additional protection against premature motor start. Note that the GPS velocity will lag the real velocity by about 0.5 seconds. The ground speed check is delayed by the TKOFF_THR_DELAY parameter.
@@ -738,6 +747,12 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @Path: ../libraries/AP_Baro/AP_Baro.cpp
     GOBJECT(barometer, "GND_", AP_Baro),
 
+#if GPS_PROTOCOL == GPS_PROTOCOL_AUTO
+    // @Group: GPS_
+    // @Path: ../libraries/AP_GPS/AP_GPS_Auto.cpp
+    GOBJECTN(g_gps_driver, gps_auto, "GPS_", AP_GPS_Auto),
+#endif
+
 #if CAMERA == ENABLED
     // @Group: CAM_
     // @Path: ../libraries/AP_Camera/AP_Camera.cpp
@@ -877,6 +892,16 @@ const AP_Param::Info var_info[] PROGMEM = {
     GOBJECT(obc,  "FS_", APM_OBC),
 #endif
 
+#if AP_TERRAIN_AVAILABLE
+    // @Group: TERRAIN_
+    // @Path: ../libraries/AP_Terrain/AP_Terrain.cpp
+    GOBJECT(terrain,                "TERRAIN_", AP_Terrain),
+#endif
+
+    // @Group: RALLY_
+    // @Path: ../libraries/AP_Rally/AP_Rally.cpp
+    GOBJECT(rally,                  "RALLY_",   AP_Rally),
+
     AP_VAREND
 };
 
@@ -10,6 +10,7 @@ static void init_commands()
     non_nav_command_ID      = NO_COMMAND;
     next_nav_command.id     = CMD_BLANK;
     nav_command_index = 0;
+    mission.reset_jumps();
 }
 
 static void update_auto()
@@ -38,32 +39,10 @@ static void update_auto()
 static struct Location get_cmd_with_index_raw(int16_t i)
 {
     struct Location temp;
-    uint16_t mem;
 
-    // Find out proper location in memory by using the start_byte position + the index
-    // --------------------------------------------------------------------------------
-    if (i > g.command_total) {
+    if (i > g.command_total || !mission.read(i, temp)) {
         memset(&temp, 0, sizeof(temp));
         temp.id = CMD_BLANK;
-    }else{
-        // read WP position
-        mem = (WP_START_BYTE) + (i * WP_SIZE);
-        temp.id = hal.storage->read_byte(mem);
-
-        mem++;
-        temp.options = hal.storage->read_byte(mem);
-
-        mem++;
-        temp.p1 = hal.storage->read_byte(mem);
-
-        mem++;
-        temp.alt = hal.storage->read_dword(mem);
-
-        mem += 4;
-        temp.lat = hal.storage->read_dword(mem);
-
-        mem += 4;
-        temp.lng = hal.storage->read_dword(mem);
     }
 
     return temp;
@@ -90,10 +69,9 @@ static struct Location get_cmd_with_index(int16_t i)
 
 // Setters
 // -------
-static void set_cmd_with_index(struct Location temp, int16_t i)
+static bool set_cmd_with_index(struct Location temp, int16_t i)
 {
     i = constrain_int16(i, 0, g.command_total.get());
-    uint16_t mem = WP_START_BYTE + (i * WP_SIZE);
 
     // force home wp to absolute height
     if (i == 0) {
@@ -102,22 +80,7 @@ static void set_cmd_with_index(struct Location temp, int16_t i)
     // zero unused bits
     temp.options &= (MASK_OPTIONS_RELATIVE_ALT | MASK_OPTIONS_LOITER_DIRECTION);
 
-    hal.storage->write_byte(mem, temp.id);
-
-    mem++;
-    hal.storage->write_byte(mem, temp.options);
-
-    mem++;
-    hal.storage->write_byte(mem, temp.p1);
-
-    mem++;
-    hal.storage->write_dword(mem, temp.alt);
-
-    mem += 4;
-    hal.storage->write_dword(mem, temp.lat);
-
-    mem += 4;
-    hal.storage->write_dword(mem, temp.lng);
+    return mission.write(i, temp);
 }
 
 static int32_t read_alt_to_hold()
@@ -138,10 +101,12 @@ static void set_next_WP(const struct Location *wp)
     // copy the current WP into the OldWP slot
     // ---------------------------------------
     prev_WP = next_WP;
+    prev_WP_id = next_WP_id;
 
     // Load the next_WP slot
     // ---------------------
     next_WP = *wp;
+    next_WP_id = wp->id;
 
     // if lat and lon is zero, then use current lat/lon
     // this allows a mission to contain a "loiter on the spot"
@@ -164,6 +129,7 @@ static void set_next_WP(const struct Location *wp)
     if (location_passed_point(current_loc, prev_WP, next_WP)) {
         gcs_send_text_P(SEVERITY_LOW, PSTR("Resetting prev_WP"));
         prev_WP = current_loc;
+        prev_WP_id = 0;
     }
 
     // used to control FBW and limit the rate of climb
@@ -189,10 +155,12 @@ static void set_guided_WP(void)
     // copy the current location into the OldWP slot
     // ---------------------------------------
     prev_WP = current_loc;
+    prev_WP_id = 0;
 
     // Load the next_WP slot
     // ---------------------
     next_WP = guided_WP;
+    next_WP_id = guided_WP.id;
 
     // used to control FBW and limit the rate of climb
     // -----------------------------------------------
@@ -234,6 +202,7 @@ void init_home()
     // Save prev loc
     // -------------
     next_WP = prev_WP = home;
+    next_WP_id = prev_WP_id = home.id;
 
     // Load home for a default guided_WP
     // -------------
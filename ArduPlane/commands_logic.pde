@@ -233,7 +233,9 @@ static void do_RTL(void)
 {
     control_mode    = RTL;
     prev_WP = current_loc;
+    prev_WP_id = 0;
     next_WP = home;
+    next_WP_id = home.id;
 
     if (g.loiter_radius < 0) {
         loiter.direction = -1;
@@ -246,6 +248,10 @@ static void do_RTL(void)
     // -------------------------
     next_WP.alt = read_alt_to_hold();
 
+    // or loiter over the nearest rally point, at its altitude, if
+    // that is nearer than home
+    rally.find_nearest_rally_point(current_loc, home, next_WP);
+
     setup_glide_slope();
 
     if (g.log_bitmask & MASK_LOG_MODE)
@@ -330,6 +336,7 @@ static bool verify_takeoff()
         hold_course_cd = -1;
         takeoff_complete = true;
         next_WP = prev_WP = current_loc;
+        next_WP_id = prev_WP_id = 0;
         return true;
     } else {
         return false;
@@ -525,11 +532,13 @@ static void do_loiter_at_location()
         loiter.direction = 1;
     }
     next_WP = current_loc;
+    next_WP_id = 0;
 }
 
 static void do_jump()
 {
-    if (next_nonnav_command.lat == 0) {
+    int16_t jumps = mission.jumps_left(g.command_index, next_nonnav_command.lat);
+    if (jumps == 0) {
         // the jump counter has reached zero - ignore
         gcs_send_text_fmt(PSTR("Jumps left: 0 - skipping"));
         return;
@@ -540,14 +549,15 @@ static void do_jump()
     }
 
     struct Location temp;
-    temp = get_cmd_with_index(g.command_index);
 
     gcs_send_text_fmt(PSTR("Jump to WP %u. Jumps left: %d"),
                       (unsigned)next_nonnav_command.p1,
-                      (int)next_nonnav_command.lat);
-    if (next_nonnav_command.lat > 0) {
-        // Decrement repeat counter
-        temp.lat                        = next_nonnav_command.lat - 1;                                          
+                      (int)jumps);
+    if (jumps > 0 && !mission.count_jump(g.command_index, next_nonnav_command.lat)) {
+        // no room to count it in RAM, so decrement the repeat counter
+        // in the command
+        temp                            = get_cmd_with_index(g.command_index);
+        temp.lat                        = jumps - 1;
         set_cmd_with_index(temp, g.command_index);
     }
 
@@ -560,6 +570,7 @@ static void do_jump()
     nav_command_index       = next_nonnav_command.p1;
     // Need to back "next_WP" up as it was set to the next waypoint following the jump
     next_WP = prev_WP;
+    next_WP_id = prev_WP_id;
 
     temp = get_cmd_with_index(g.command_index);
 
@@ -593,6 +604,8 @@ static void do_change_speed()
     if (next_nonnav_command.lat > 0) {
         gcs_send_text_fmt(PSTR("Set throttle %u"), (unsigned)next_nonnav_command.lat);
         aparm.throttle_cruise.set(next_nonnav_command.lat);
+        // the speed/height controller works its gains out from it
+        AP_Param::notify_change();
     }
 }
 
@@ -2,7 +2,7 @@
 
 // For changing active command mid-mission
 //----------------------------------------
-void change_command(uint8_t cmd_index)
+void change_command(uint16_t cmd_index)
 {
     struct Location temp;
 
@@ -58,16 +58,13 @@ static void process_next_command()
     // and loads conditional or immediate commands if applicable
 
     struct Location temp;
-    uint8_t old_index = nav_command_index;
+    uint16_t old_index = nav_command_index;
 
     // these are Navigation/Must commands
     // ---------------------------------
     if (nav_command_ID == NO_COMMAND) {    // no current navigation command loaded
-        temp.id = MAV_CMD_NAV_LAST;
-        while(temp.id >= MAV_CMD_NAV_LAST && nav_command_index <= g.command_total) {
-            nav_command_index++;
-            temp = get_cmd_with_index(nav_command_index);
-        }
+        nav_command_index = mission.next_nav(nav_command_index + 1);
+        temp = get_cmd_with_index(nav_command_index);
 
         gcs_send_text_fmt(PSTR("Nav command index updated to #%i"),nav_command_index);
 
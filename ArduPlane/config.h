@@ -625,6 +625,15 @@
  # define LOGGING_ENABLED                ENABLED
 #endif
 
+// logs kept on the SD card of a PX4. The oldest are deleted before
+// each new log to keep within these, 0 for no limit
+#ifndef LOG_RETAIN_LOGS
+ # define LOG_RETAIN_LOGS               0
+#endif
+#ifndef LOG_RETAIN_MB
+ # define LOG_RETAIN_MB                 512
+#endif
+
 #define DEFAULT_LOG_BITMASK     \
     MASK_LOG_ATTITUDE_MED | \
     MASK_LOG_GPS | \
@@ -710,3 +719,9 @@
  # define SERIAL_BUFSIZE 256
 #endif
 
+// experimental: keep the attitude as a quaternion rather than a DCM
+// matrix. Drift correction is the same as for DCM
+#ifndef AHRS_QUATERNION_ENABLED
+ # define AHRS_QUATERNION_ENABLED DISABLED
+#endif
+
@@ -39,12 +39,14 @@ static void read_control_switch()
 
         oldSwitchPosition = switchPosition;
         prev_WP = current_loc;
+        prev_WP_id = 0;
     }
 
     if (g.reset_mission_chan != 0 &&
         hal.rcin->read(g.reset_mission_chan-1) > RESET_SWITCH_CHAN_PWM) {
         // reset to first waypoint in mission
         prev_WP = current_loc;
+        prev_WP_id = 0;
         change_command(0);
     }
 
@@ -133,12 +133,15 @@ enum ap_message {
     MSG_SERVO_OUT,
     MSG_NEXT_WAYPOINT,
     MSG_NEXT_PARAM,
+    MSG_NEXT_LOG,
     MSG_STATUSTEXT,
     MSG_FENCE_STATUS,
     MSG_AHRS,
     MSG_SIMSTATE,
     MSG_HWSTATUS,
     MSG_WIND,
+    MSG_MEMCHECK,
+    MSG_TERRAIN,
     MSG_RETRY_DEFERRED // this must be last
 };
 
@@ -200,9 +203,6 @@ enum log_messages {
                                         // regress a climb rate from
 
 
-#define BATTERY_VOLTAGE(x) (x->voltage_average()*g.volt_div_ratio)
-#define CURRENT_AMPS(x) (x->voltage_average()-g.curr_amp_offset)*g.curr_amp_per_volt
-
 #define AN4                     4
 #define AN5                     5
 
@@ -216,18 +216,33 @@ enum log_messages {
 // parameters get the first 1280 bytes of EEPROM, remainder is for waypoints
 #define WP_START_BYTE 0x500 // where in memory home WP is stored + all other
                             // WP
-#define WP_SIZE 15
 
 // fence points are stored at the end of the EEPROM
 #define MAX_FENCEPOINTS 20
 #define FENCE_WP_SIZE sizeof(Vector2l)
 #define FENCE_START_BYTE (EEPROM_MAX_ADDR-(MAX_FENCEPOINTS*FENCE_WP_SIZE))
 
-#define MAX_WAYPOINTS  ((FENCE_START_BYTE - WP_START_BYTE) / WP_SIZE) - 1 // -
-                                                                          // 1
-                                                                          // to
-                                                                          // be
-                                                                          // safe
+// rally points are stored below the fence, or at the end of the 16k
+// of PX4 storage, which has room for many more
+#if CONFIG_HAL_BOARD == HAL_BOARD_PX4
+ # define MAX_RALLYPOINTS   200
+ # define RALLY_START_BYTE  (16384 - AP_RALLY_STORAGE_SIZE(MAX_RALLYPOINTS))
+#else
+ # define MAX_RALLYPOINTS   10
+ # define RALLY_START_BYTE  (FENCE_START_BYTE - AP_RALLY_STORAGE_SIZE(MAX_RALLYPOINTS))
+#endif
+
+// the mission goes between the parameters and the rally points. The
+// PX4 storage is 16k, so there it goes in the space after the APM layout
+#if CONFIG_HAL_BOARD == HAL_BOARD_PX4
+ # define MISSION_START_BYTE EEPROM_MAX_ADDR
+#else
+ # define MISSION_START_BYTE WP_START_BYTE
+#endif
+#define MISSION_END_BYTE RALLY_START_BYTE
+
+// the most commands that can fit, if they are all short ones
+#define MAX_WAYPOINTS AP_MISSIONSTORE_MAX_COMMANDS(MISSION_START_BYTE, MISSION_END_BYTE)
 
 // convert a boolean (0 or 1) to a sign for multiplying (0 maps to 1, 1 maps
 // to -1)
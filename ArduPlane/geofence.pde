@@ -6,27 +6,55 @@
 
 #if GEOFENCE_ENABLED == ENABLED
 
+/*
+ *  a fence boundary. Point 0 is the return point, and the rest are
+ *  the polygon, which is prepared for quick tests
+ */
+struct geofence_boundary {
+    uint8_t num_points;
+    Vector2l points[MAX_FENCEPOINTS];
+    PolygonFence polygon;
+};
+
 /*
  *  The state of geo-fencing. This structure is dynamically allocated
  *  the first time it is used. This means we only pay for the pointer
  *  and not the structure on systems where geo-fencing is not being
  *  used.
  *
- *  We store a copy of the boundary in memory as we need to access it
- *  very quickly at runtime
+ *  We keep the boundary in memory as we need to access it very
+ *  quickly at runtime. There are two: the active one, which is
+ *  checked, and the one a fence being uploaded by the GCS is staged
+ *  in. Once all the points of an upload have arrived it is checked
+ *  and prepared, and only then does it become the active one, so the
+ *  old fence stays in force until then. The points are written to
+ *  the storage after that, as fast as it can take them.
  */
 static struct geofence_state {
-    uint8_t num_points;
     bool boundary_uptodate;
     bool fence_triggered;
     uint16_t breach_count;
     uint8_t breach_type;
     uint32_t breach_time;
     uint8_t old_switch_position;
-    /* point 0 is the return point */
-    Vector2l boundary[MAX_FENCEPOINTS];
+    struct geofence_boundary boundaries[2];
+    uint8_t active;
+    /* the points the upload has, and a bit for each received */
+    uint8_t staged_count;
+    uint32_t staged_mask;
+    /* the next point of the active boundary to store */
+    uint8_t commit_next;
 } *geofence_state;
 
+static struct geofence_boundary &geofence_active(void)
+{
+    return geofence_state->boundaries[geofence_state->active];
+}
+
+static struct geofence_boundary &geofence_staging(void)
+{
+    return geofence_state->boundaries[geofence_state->active ^ 1];
+}
 
 /*
  *  fence boundaries fetch/store
@@ -40,6 +68,13 @@ static Vector2l get_fence_point_with_index(unsigned i)
         return Vector2l(0,0);
     }
 
+    // the active fence may be newer than the storage
+    if (geofence_state != NULL &&
+        geofence_state->boundary_uptodate &&
+        i < geofence_active().num_points) {
+        return geofence_active().points[i];
+    }
+
     // read fence point
     mem = FENCE_START_BYTE + (i * FENCE_WP_SIZE);
     ret.x = hal.storage->read_dword(mem);
@@ -49,44 +84,112 @@ static Vector2l get_fence_point_with_index(unsigned i)
     return ret;
 }
 
-// save a fence point
-static void set_fence_point_with_index(Vector2l &point, unsigned i)
+/*
+ *  store the points of the active fence that aren't yet, as many as
+ *  the storage can take without waiting
+ */
+static void geofence_commit(void)
 {
-    uint16_t mem;
-
-    if (i >= (unsigned)g.fence_total.get()) {
-        // not allowed
+    if (geofence_state == NULL) {
         return;
     }
+    const struct geofence_boundary &b = geofence_active();
+    while (geofence_state->commit_next < b.num_points &&
+           hal.storage->write_space() >= FENCE_WP_SIZE) {
+        uint8_t i = geofence_state->commit_next++;
+        hal.storage->write_block(FENCE_START_BYTE + (i * FENCE_WP_SIZE),
+                                 &b.points[i], FENCE_WP_SIZE);
+    }
+}
 
-    mem = FENCE_START_BYTE + (i * FENCE_WP_SIZE);
+static bool geofence_alloc(void)
+{
+    if (geofence_state != NULL) {
+        return true;
+    }
+    if (memcheck_available_memory() < 512 + sizeof(struct geofence_state)) {
+        // too risky to enable as we could run out of stack
+        return false;
+    }
+    geofence_state = (struct geofence_state *)calloc(1, sizeof(struct geofence_state));
+    return geofence_state != NULL;
+}
 
-    hal.storage->write_dword(mem, point.x);
-    mem += sizeof(uint32_t);
-    hal.storage->write_dword(mem, point.y);
+/*
+ *  check the staged boundary, and make it the active one if it will
+ *  do. The active one is left alone if not
+ */
+static bool geofence_swap(void)
+{
+    struct geofence_boundary &b = geofence_staging();
 
-    if (geofence_state != NULL) {
-        geofence_state->boundary_uptodate = false;
+    if (b.num_points < 1) {
+        return false;
     }
+    if (!Polygon_complete(&b.points[1], b.num_points-1)) {
+        // first point and last point must be the same
+        return false;
+    }
+    if (Polygon_outside(b.points[0], &b.points[1], b.num_points-1)) {
+        // return point needs to be inside the fence
+        return false;
+    }
+
+    b.polygon.set(&b.points[1], b.num_points-1);
+    geofence_state->active ^= 1;
+    geofence_state->boundary_uptodate = true;
+    geofence_state->fence_triggered = false;
+    return true;
+}
+
+/*
+ *  take a point of a fence being uploaded. The fence replaces the
+ *  active one once all of its points have arrived, in any order
+ */
+static void geofence_stage_point(const Vector2l &point, uint8_t i, uint8_t count)
+{
+    if (i >= count || count > MAX_FENCEPOINTS || !geofence_alloc()) {
+        gcs_send_text_P(SEVERITY_LOW,PSTR("bad fence point"));
+        return;
+    }
+    if (count != geofence_state->staged_count) {
+        // a new upload
+        geofence_state->staged_count = count;
+        geofence_state->staged_mask = 0;
+    }
+
+    struct geofence_boundary &b = geofence_staging();
+    b.points[i] = point;
+    geofence_state->staged_mask |= 1UL << i;
+    if (geofence_state->staged_mask != (1UL << count) - 1) {
+        return;
+    }
+
+    // the upload is complete
+    b.num_points = count;
+    geofence_state->staged_count = 0;
+    geofence_state->staged_mask = 0;
+    if (!geofence_swap()) {
+        gcs_send_text_P(SEVERITY_HIGH,PSTR("geo-fence rejected"));
+        return;
+    }
+    geofence_state->commit_next = 0;
+    geofence_commit();
+
+    gcs_send_text_P(SEVERITY_LOW,PSTR("geo-fence loaded"));
+    gcs_send_message(MSG_FENCE_STATUS);
 }
 
 /*
- *  allocate and fill the geofence state structure
+ *  allocate the geofence state structure and load the stored fence
  */
 static void geofence_load(void)
 {
     uint8_t i;
 
-    if (geofence_state == NULL) {
-        if (memcheck_available_memory() < 512 + sizeof(struct geofence_state)) {
-            // too risky to enable as we could run out of stack
-            goto failed;
-        }
-        geofence_state = (struct geofence_state *)calloc(1, sizeof(struct geofence_state));
-        if (geofence_state == NULL) {
-            // not much we can do here except disable it
-            goto failed;
-        }
+    if (!geofence_alloc()) {
+        // not much we can do here except disable it
+        goto failed;
     }
 
     if (g.fence_total <= 0) {
@@ -94,22 +197,19 @@ static void geofence_load(void)
         return;
     }
 
+    if (g.fence_total > MAX_FENCEPOINTS) {
+        goto failed;
+    }
     for (i=0; i<g.fence_total; i++) {
-        geofence_state->boundary[i] = get_fence_point_with_index(i);
+        geofence_staging().points[i] = get_fence_point_with_index(i);
     }
-    geofence_state->num_points = i;
+    geofence_staging().num_points = i;
 
-    if (!Polygon_complete(&geofence_state->boundary[1], geofence_state->num_points-1)) {
-        // first point and last point must be the same
-        goto failed;
-    }
-    if (Polygon_outside(geofence_state->boundary[0], &geofence_state->boundary[1], geofence_state->num_points-1)) {
-        // return point needs to be inside the fence
+    if (!geofence_swap()) {
         goto failed;
     }
-
-    geofence_state->boundary_uptodate = true;
-    geofence_state->fence_triggered = false;
+    // it came from the storage
+    geofence_state->commit_next = i;
 
     gcs_send_text_P(SEVERITY_LOW,PSTR("geo-fence loaded"));
     gcs_send_message(MSG_FENCE_STATUS);
@@ -176,6 +276,9 @@ static bool geofence_check_maxalt(void)
  */
 static void geofence_check(bool altitude_check_only)
 {
+    // finish storing a fence uploaded while the storage was busy
+    geofence_commit();
+
     if (!geofence_enabled()) {
         // switch back to the chosen control mode if still in
         // GUIDED to the return point
@@ -186,8 +289,8 @@ static void geofence_check(bool altitude_check_only)
             g.fence_total >= 5 &&
             geofence_state->boundary_uptodate &&
             geofence_state->old_switch_position == oldSwitchPosition &&
-            guided_WP.lat == geofence_state->boundary[0].x &&
-            guided_WP.lng == geofence_state->boundary[0].y) {
+            guided_WP.lat == geofence_active().points[0].x &&
+            guided_WP.lng == geofence_active().points[0].y) {
             geofence_state->old_switch_position = 0;
             reset_control_switch();
         }
@@ -217,7 +320,7 @@ static void geofence_check(bool altitude_check_only)
         Vector2l location;
         location.x = loc.lat;
         location.y = loc.lng;
-        outside = Polygon_outside(location, &geofence_state->boundary[1], geofence_state->num_points-1);
+        outside = geofence_active().polygon.outside(location);
         if (outside) {
             breach_type = FENCE_BREACH_BOUNDARY;
         }
@@ -275,8 +378,8 @@ static void geofence_check(bool altitude_check_only)
         guided_WP.id = 0;
         guided_WP.p1  = 0;
         guided_WP.options = 0;
-        guided_WP.lat = geofence_state->boundary[0].x;
-        guided_WP.lng = geofence_state->boundary[0].y;
+        guided_WP.lat = geofence_active().points[0].x;
+        guided_WP.lng = geofence_active().points[0].y;
 
         geofence_state->old_switch_position = oldSwitchPosition;
 
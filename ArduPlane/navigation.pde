@@ -136,7 +136,7 @@ static void calc_altitude_error()
     if (nav_controller->reached_loiter_target()) {
         // once we reach a loiter target then lock to the final
         // altitude target
-        target_altitude_cm = next_WP.alt;
+        target_altitude_cm = next_WP.alt + terrain_offset_cm;
     } else if (offset_altitude_cm != 0) {
         // control climb/descent rate
         target_altitude_cm = next_WP.alt - (offset_altitude_cm*((float)(wp_distance-30) / (float)(wp_totalDistance-30)));
@@ -147,8 +147,9 @@ static void calc_altitude_error()
         }else{
             target_altitude_cm = constrain_int32(target_altitude_cm, prev_WP.alt, next_WP.alt);
         }
+        target_altitude_cm += terrain_offset_cm;
     } else if (non_nav_command_ID != MAV_CMD_CONDITION_CHANGE_ALT) {
-        target_altitude_cm = next_WP.alt;
+        target_altitude_cm = next_WP.alt + terrain_offset_cm;
     }
 
     altitude_error_cm       = target_altitude_cm - adjusted_altitude_cm();
@@ -182,9 +183,11 @@ static void update_cruise()
         cruise_state.lock_timer_ms = 0;
         cruise_state.locked_heading_cd = g_gps->ground_course_cd;
         prev_WP = current_loc;
+        prev_WP_id = 0;
     }
     if (cruise_state.locked_heading) {
         next_WP = prev_WP;
+        next_WP_id = prev_WP_id;
         // always look 1km ahead
         location_update(&next_WP, 
                         cruise_state.locked_heading_cd*0.01f, 
@@ -255,9 +258,9 @@ static void setup_glide_slope(void)
         break;
 
     case AUTO:
-        if (prev_WP.id != MAV_CMD_NAV_TAKEOFF && 
+        if (prev_WP_id != MAV_CMD_NAV_TAKEOFF && 
             prev_WP.alt != home.alt && 
-            (next_WP.id == MAV_CMD_NAV_WAYPOINT || next_WP.id == MAV_CMD_NAV_LAND)) {
+            (next_WP_id == MAV_CMD_NAV_WAYPOINT || next_WP_id == MAV_CMD_NAV_LAND)) {
             offset_altitude_cm = next_WP.alt - prev_WP.alt;
         } else {
             offset_altitude_cm = 0;        
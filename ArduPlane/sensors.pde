@@ -15,10 +15,33 @@ static void init_barometer(void)
     gcs_send_text_P(SEVERITY_LOW, PSTR("barometer calibration complete"));
 }
 
+// start calibrating the barometer at startup. The calibration goes on
+// in mavlink_delay_cb() while the INS is calibrated, and
+// finish_barometer() waits for whatever is left of it
+static void start_barometer(void)
+{
+    gcs_send_text_P(SEVERITY_LOW, PSTR("Calibrating barometer"));
+    barometer.start_calibration();
+}
+
+static void finish_barometer(void)
+{
+    while (!barometer.update_calibration()) {
+        delay(10);
+    }
+
+    // filter at 100ms sampling, with 0.7Hz cutoff frequency
+    altitude_filter.set_cutoff_frequency(0.1, 0.7);
+
+    gcs_send_text_P(SEVERITY_LOW, PSTR("barometer calibration complete"));
+}
+
 // read the barometer and return the updated altitude in centimeters
 // above the calibration altitude
 static int32_t read_barometer(void)
 {
+    // the climb rate filter follows the acceleration between barometer samples
+    barometer.set_vertical_accel(-(ahrs.get_accel_ef().z + GRAVITY_MSS));
     barometer.read();
     return altitude_filter.apply(barometer.get_altitude() * 100.0);
 }
@@ -28,6 +51,7 @@ static void read_airspeed(void)
 {
     if (airspeed.enabled()) {
         airspeed.read();
+        airspeed_calibration_sample();
         calc_airspeed_errors();
     }
 }
@@ -45,23 +69,18 @@ static void read_battery(void)
         return;
     }
 
-    if(g.battery_monitoring == 3 || g.battery_monitoring == 4) {
-        // this copes with changing the pin at runtime
-        batt_volt_pin->set_pin(g.battery_volt_pin);
-        battery.voltage = BATTERY_VOLTAGE(batt_volt_pin);
+    // the timer samples the battery and integrates the current
+    battery_monitor.set_config(g.battery_monitoring == 4,
+                               g.battery_volt_pin, g.volt_div_ratio,
+                               g.battery_curr_pin, g.curr_amp_per_volt, g.curr_amp_offset);
+    bool new_voltage = battery_monitor.read();
+    if ((g.battery_monitoring == 3 || g.battery_monitoring == 4) && new_voltage) {
+        battery.voltage = battery_monitor.voltage();
     }
 
     if (g.battery_monitoring == 4) {
-        uint32_t tnow = hal.scheduler->millis();
-        float dt = tnow - battery.last_time_ms;
-        // this copes with changing the pin at runtime
-        batt_curr_pin->set_pin(g.battery_curr_pin);
-        battery.current_amps = CURRENT_AMPS(batt_curr_pin);
-        if (battery.last_time_ms != 0 && dt < 2000) {
-            // .0002778 is 1/3600 (conversion to hours)
-            battery.current_total_mah += battery.current_amps * dt * 0.0002778f; 
-        }
-        battery.last_time_ms = tnow;
+        battery.current_amps = battery_monitor.current_amps();
+        battery.current_total_mah = battery_monitor.current_total_mah();
     }
 
     if (battery.voltage != 0 && 
@@ -98,7 +98,7 @@ static void init_ardupilot()
     // GPS serial port.
     //
     // standard gps running
-    hal.uartB->begin(38400, 256, 16);
+    hal.uartB->begin(38400, 256, GPS_PORT_TX_BUFFER_SIZE);
 
     cliSerial->printf_P(PSTR("\n\nInit " THISFIRMWARE
                          "\n\nFree RAM: %u\n"),
@@ -110,6 +110,14 @@ static void init_ardupilot()
     //
     load_parameters();
 
+    // a mission stored in an older layout can't be read
+    if (!mission.init()) {
+        g.command_total.set_and_save(0);
+    }
+
+    // the INS sample rate follows the loop rate
+    init_loop_rate();
+
     set_control_channels();
 
     // reset the uartA baud rate after parameter load
@@ -121,6 +129,7 @@ static void init_ardupilot()
 
     // init baro before we start the GCS, so that the CLI baro test works
     barometer.init();
+    ahrs.set_barometer(&barometer);
 
     // init the GCS
     gcs0.init(hal.uartA);
@@ -145,6 +154,7 @@ static void init_ardupilot()
 
 #if LOGGING_ENABLED == ENABLED
     DataFlash.Init();
+    DataFlash.set_retention(LOG_RETAIN_LOGS, LOG_RETAIN_MB);
     if (!DataFlash.CardInserted()) {
         gcs_send_text_P(SEVERITY_LOW, PSTR("No dataflash card inserted"));
         g.log_bitmask.set(0);
@@ -158,6 +168,10 @@ static void init_ardupilot()
     }
 #endif
 
+#if AP_TERRAIN_AVAILABLE
+    terrain.init();
+#endif
+
  #if CONFIG_HAL_BOARD == HAL_BOARD_APM1
     apm1_adc.Init();      // APM ADC library initialization
  #endif
@@ -228,6 +242,10 @@ static void init_ardupilot()
     // set the correct flight mode
     // ---------------------------
     reset_control_switch();
+
+    // anything allocated from now on comes from the heap
+    arena_freeze();
+    cliSerial->printf_P(PSTR("Arena: %u/%u\n"), arena_used(), (unsigned)AP_ARENA_SIZE);
 }
 
 //********************************************************************************
@@ -335,11 +353,13 @@ static void set_mode(enum FlightMode mode)
 
     case AUTO:
         prev_WP = current_loc;
+        prev_WP_id = 0;
         update_auto();
         break;
 
     case RTL:
         prev_WP = current_loc;
+        prev_WP_id = 0;
         do_RTL();
         break;
 
@@ -353,6 +373,7 @@ static void set_mode(enum FlightMode mode)
 
     default:
         prev_WP = current_loc;
+        prev_WP_id = 0;
         do_RTL();
         break;
     }
@@ -439,6 +460,10 @@ static void startup_INS_ground(bool do_accel_init)
     }
 #endif
 
+    // read Baro pressure at ground, while the INS is calibrated
+    //-----------------------------
+    start_barometer();
+
     AP_InertialSensor::Start_style style;
     if (g.skip_gyro_cal && !do_accel_init) {
         style = AP_InertialSensor::WARM_START;
@@ -471,9 +496,7 @@ static void startup_INS_ground(bool do_accel_init)
     }
     ahrs.reset();
 
-    // read Baro pressure at ground
-    //-----------------------------
-    init_barometer();
+    finish_barometer();
 
     if (airspeed.enabled()) {
         // initialize airspeed sensor
@@ -526,6 +549,7 @@ static void resetPerfData(void) {
     ahrs.renorm_blowup_count = 0;
     gps_fix_count                   = 0;
     perf_mon_timer                  = millis();
+    scheduler.reset_task_stats();
 }
 
 
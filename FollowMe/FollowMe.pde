@@ -22,6 +22,9 @@
 #define CONFIG_FOLLOWME_SENDS_HEARTBEAT 1
 /* Does the hal console tunnel over mavlink? Requires patched MAVProxy. */
 #define CONFIG_FOLLOWME_MAVCONSOLE 0
+/* Our system id. The vehicle only follows the target from the one in its
+ * SYSID_MYGCS parameter, 255 unless changed. */
+#define CONFIG_FOLLOWME_SYSID 255
 
 const AP_HAL::HAL& hal = AP_HAL_AVR_APM2;
 
@@ -60,6 +63,7 @@ void setup(void) {
     mavlink_comm_0_port = hal.uartA;
     /* Setup GCS_Mavlink library's comm 1 port to UART2 (accessible on APM2) */
     mavlink_comm_1_port = hal.uartC;
+    mavlink_system.sysid = CONFIG_FOLLOWME_SYSID;
     
 #if CONFIG_FOLLOWME_SENDS_HEARTBEAT
     simplegcs_send_heartbeat(downstream_channel);
@@ -2,6 +2,7 @@
 #include "state.h"
 #include <AP_HAL.h>
 #include <GCS_MAVLink.h>
+#include <AP_Math.h>
 
 extern const AP_HAL::HAL& hal;
 extern mavlink_channel_t upstream_channel;
@@ -84,7 +85,7 @@ void FMStateMachine::on_loop(GPS* gps) {
   }
 
   if (_guiding) {
-    _send_guide();
+    _send_target();
   }
 }
 
@@ -124,15 +125,18 @@ bool FMStateMachine::_check_guide_valid() {
 void FMStateMachine::_update_local_gps(GPS* gps) {
   /* Cause an on_fault_cancel if when local gps has transitioned form 
    * valid to invalid. */
-  if (_local_gps_valid && !(gps->status() == GPS::GPS_OK)) {
+  if (_local_gps_valid && !(gps->status() == GPS::GPS_OK_FIX_3D)) {
     _on_fault_cancel();
   } 
 
-  _local_gps_valid = (gps->status() == GPS::GPS_OK);
+  _local_gps_valid = (gps->status() == GPS::GPS_OK_FIX_3D);
   if (gps->new_data) {
     _local_gps_lat      = gps->latitude;
     _local_gps_lon      = gps->longitude;
-    _local_gps_altitude = gps->altitude;
+    _local_gps_altitude = gps->altitude_cm;
+    _local_gps_vel_north = gps->velocity_north();
+    _local_gps_vel_east = gps->velocity_east();
+    _local_gps_fix_millis = gps->last_fix_time;
     gps->new_data = false;
   }
 }
@@ -193,6 +197,37 @@ void FMStateMachine::_send_guide() {
       );
 }
 
+void FMStateMachine::_send_target() {
+  /* Send where the last fix has got to by now at its velocity, which the
+   * vehicle carries on at until the next one. However often the GPS
+   * updates, the vehicle doesn't fall a whole fix behind. Don't guess
+   * for long if the fixes stop. */
+  uint32_t age_millis = hal.scheduler->millis() - _local_gps_fix_millis;
+  if (age_millis > 1000) {
+    age_millis = 1000;
+  }
+  float age = (float) age_millis / 1000.0f;
+
+  struct Position pos;
+  pos.lat = _local_gps_lat + _offs_lat;
+  pos.lng = _local_gps_lon + _offs_lon;
+  pos.alt = _local_gps_altitude;
+  location_offset(&pos, _local_gps_vel_north * age, _local_gps_vel_east * age);
+
+  mavlink_msg_global_position_int_send(
+      upstream_channel, /* mavlink_channel_t chan */
+      hal.scheduler->millis(), /* uint32_t time_boot_ms */
+      pos.lat, /* int32_t lat: deg * 10,000,000 */
+      pos.lng, /* int32_t lon: deg * 10,000,000 */
+      pos.alt * 10, /* int32_t alt: mm */
+      _offs_altitude * 10, /* int32_t relative_alt: mm. assume above ground, as for guide. */
+      (int16_t) (_local_gps_vel_north * 100), /* int16_t vx: cm/s north */
+      (int16_t) (_local_gps_vel_east * 100), /* int16_t vy: cm/s east */
+      0, /* int16_t vz: the vehicle holds its height above us */
+      65535 /* uint16_t hdg: unknown */
+      );
+}
+
 void FMStateMachine::_send_loiter() {
   hal.console->println_P(PSTR("FollowMe: Sending loiter cmd packet"));
   mavlink_msg_command_long_send(
@@ -11,7 +11,8 @@ class FMStateMachine {
 public:
   FMStateMachine() :
     _last_run_millis(0),
-    _loop_period(500),
+    /* While guiding, the target is sent this often */
+    _loop_period(100),
     _last_vehicle_hb_millis(0),
     _vehicle_mode(MODE_NUM_MODES),
     _vehicle_armed(false),
@@ -40,6 +41,10 @@ private:
   /* _send_guide: Send a guide waypoint packet upstream. */
   void _send_guide();
 
+  /* _send_target: Send our position and velocity upstream for the
+   * vehicle to follow in guided mode. */
+  void _send_target();
+
   /* _send_loiter: Send a setmode loiter packet upstream. */
   void _send_loiter();
 
@@ -78,6 +83,9 @@ private:
   int32_t _local_gps_lat;
   int32_t _local_gps_lon;
   int32_t _local_gps_altitude;
+  float _local_gps_vel_north; /* m/s */
+  float _local_gps_vel_east;
+  uint32_t _local_gps_fix_millis;
 
   int32_t _offs_lat;
   int32_t _offs_lon;
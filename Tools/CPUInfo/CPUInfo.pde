@@ -3,12 +3,25 @@
 /*
   test CPU speed
   Andrew Tridgell September 2011
+
+  Also times the HAL drivers, so boards can be compared and HAL
+  regressions caught between builds. Each result is printed on its own
+  line as
+
+      name value unit
+
+  and every other line starts with '#', so the output of two runs can
+  be diffed or read straight into a script.
+
+  The storage test writes back the bytes it has just read, and the
+  DataFlash test writes a log, so run it on a bench board
 */
 
 #include <AP_HAL.h>
 #include <AP_HAL_AVR.h>
 #include <AP_HAL_AVR_SITL.h>
 #include <AP_HAL_PX4.h>
+#include <AP_HAL_SMACCM.h>
 #include <AP_HAL_Empty.h>
 #include <AP_Common.h>
 #include <AP_Baro.h>
@@ -21,26 +34,108 @@
 #include <AP_Param.h>
 #include <AP_Progmem.h>
 #include <AP_Math.h>
+#include <AP_Airspeed.h>
+#include <AP_AHRS.h>
+#include <AP_ADC_AnalogSource.h>
+#include <AP_InertialSensor.h>
+#include <AP_GPS.h>
+#include <DataFlash.h>
+#include <AP_Scheduler.h>
 
 const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
 
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM2
+DataFlash_APM2 DataFlash;
+#elif CONFIG_HAL_BOARD == HAL_BOARD_APM1
+DataFlash_APM1 DataFlash;
+#elif CONFIG_HAL_BOARD == HAL_BOARD_AVR_SITL
+DataFlash_SITL DataFlash;
+#elif CONFIG_HAL_BOARD == HAL_BOARD_PX4
+DataFlash_File DataFlash("/fs/microsd/APM/logs");
+#else
+DataFlash_Empty DataFlash;
+#endif
+
+// the DataFlash test record
+#define LOG_TEST_MSG 1
+#define LOG_TEST_FIELDS(F, S) \
+    F(I, time_us, "TimeUS") S \
+    F(f, v1, "V1") S \
+    F(f, v2, "V2") S \
+    F(f, v3, "V3") S \
+    F(i, l1, "L1")
+LOG_MESSAGE_STRUCT(log_Test, LOG_TEST_FIELDS);
+LOG_MESSAGE_WRITER(log_write_test, LOG_TEST_MSG, log_Test, LOG_TEST_FIELDS)
+
+static const struct LogStructure log_structure[] PROGMEM = {
+    LOG_COMMON_STRUCTURES,
+    { LOG_MESSAGE_STRUCTURE(LOG_TEST_MSG, log_Test, "TEST", LOG_TEST_FIELDS) }
+};
+
+static bool dataflash_ok;
+
+static void report(const char *name, float value, const char *unit)
+{
+	hal.console->printf("%-20s %12.2f %s\n", name, value, unit);
+}
+
+/*
+  the timer process records the gaps between its calls
+ */
+static volatile uint32_t timer_last_us;
+static volatile uint32_t timer_min_us;
+static volatile uint32_t timer_max_us;
+static volatile uint32_t timer_sum_us;
+static volatile uint32_t timer_count;
+
+static void timer_reset(void)
+{
+	hal.scheduler->suspend_timer_procs();
+	timer_last_us = 0;
+	timer_min_us = 0xFFFFFFFF;
+	timer_max_us = 0;
+	timer_sum_us = 0;
+	timer_count = 0;
+	hal.scheduler->resume_timer_procs();
+}
+
+static void timer_proc(uint32_t now)
+{
+	if (timer_last_us != 0) {
+		uint32_t dt = now - timer_last_us;
+		if (dt < timer_min_us) timer_min_us = dt;
+		if (dt > timer_max_us) timer_max_us = dt;
+		timer_sum_us += dt;
+		timer_count++;
+	}
+	timer_last_us = now;
+}
+
 void setup() {
+	timer_reset();
+	hal.scheduler->register_timer_process(timer_proc);
+
+	DataFlash.Init();
+	if (DataFlash.CardInserted() && !DataFlash.NeedErase()) {
+		DataFlash.StartNewLog(sizeof(log_structure)/sizeof(log_structure[0]), log_structure);
+		dataflash_ok = true;
+	}
 }
 
 static void show_sizes(void)
 {
-	hal.console->println("Type sizes:");
-	hal.console->printf("char      : %d\n", sizeof(char));
-	hal.console->printf("short     : %d\n", sizeof(short));
-	hal.console->printf("int       : %d\n", sizeof(int));
-	hal.console->printf("long      : %d\n", sizeof(long));
-	hal.console->printf("long long : %d\n", sizeof(long long));
-	hal.console->printf("bool      : %d\n", sizeof(bool));
-	hal.console->printf("void*     : %d\n", sizeof(void *));
-
-	hal.console->printf("printing NaN: %f\n", sqrt(-1.0f));
-	hal.console->printf("printing +Inf: %f\n", 1.0f/0.0f);
-	hal.console->printf("printing -Inf: %f\n", -1.0f/0.0f);
+	hal.console->println("# Type sizes:");
+	report("sizeof(char)",      sizeof(char),      "bytes");
+	report("sizeof(short)",     sizeof(short),     "bytes");
+	report("sizeof(int)",       sizeof(int),       "bytes");
+	report("sizeof(long)",      sizeof(long),      "bytes");
+	report("sizeof(long long)", sizeof(long long), "bytes");
+	report("sizeof(bool)",      sizeof(bool),      "bytes");
+	report("sizeof(void*)",     sizeof(void *),    "bytes");
+
+	hal.console->printf("# printing NaN: %f\n", sqrt(-1.0f));
+	hal.console->printf("# printing +Inf: %f\n", 1.0f/0.0f);
+	hal.console->printf("# printing -Inf: %f\n", -1.0f/0.0f);
 }
 
 #define TENTIMES(x) do { x; x; x; x; x; x; x; x; x; x; } while (0)
@@ -53,7 +148,7 @@ static void show_sizes(void)
 		FIFTYTIMES(op);				\
 	} \
 	us_end = hal.scheduler->micros(); \
-	hal.console->printf("%-10s %7.2f usec/call\n", name, double(us_end-us_start)/(count*50.0)); \
+	report(name, double(us_end-us_start)/(count*50.0), "usec/call"); \
 } while (0)
 
 volatile float v_f = 1.0;
@@ -86,8 +181,8 @@ static void show_timings(void)
 	v_out_8 = 1+(hal.scheduler->micros() % 3);
 
 
-	hal.console->println("Operation timings:");
-	hal.console->println("Note: timings for some operations are very data dependent");
+	hal.console->println("# Operation timings:");
+	hal.console->println("# Note: timings for some operations are very data dependent");
 
 	TIMEIT("nop", asm volatile("nop"::), 255);
 
@@ -112,6 +207,8 @@ static void show_timings(void)
 	TIMEIT("asin()", v_out = asinf(v_f * 0.2), 20);
 	TIMEIT("atan2()", v_out = atan2f(v_f * 0.2, v_f * 0.3), 20);
 	TIMEIT("sqrt()",v_out = sqrtf(v_f), 20);
+	TIMEIT("fast_sin()", v_out = fast_sin(v_f), 20);
+	TIMEIT("fast_atan2()", v_out = fast_atan2(v_f * 0.2, v_f * 0.3), 20);
 
 	TIMEIT("iadd8", v_out_8 += v_8, 100);
 	TIMEIT("isub8", v_out_8 -= v_8, 100);
@@ -138,11 +235,184 @@ static void show_timings(void)
 	TIMEIT("delay(1)", hal.scheduler->delay(1), 5);
 }
 
+/*
+  SPI transactions to each device, as register reads that leave it as
+  it was
+ */
+struct spi_test {
+	enum AP_HAL::SPIDevice device;
+	const char *name;
+	uint8_t len;
+	uint8_t tx[4];
+};
+
+static const struct spi_test spi_tests[] = {
+	{ AP_HAL::SPIDevice_MPU6000,   "spi.mpu6000",   2, { 0x80 | 0x75 } },  // WHO_AM_I
+	{ AP_HAL::SPIDevice_MS5611,    "spi.ms5611",    4, { 0x00 } },         // ADC read
+	{ AP_HAL::SPIDevice_Dataflash, "spi.dataflash", 2, { 0xD7 } },         // status
+};
+
+static void show_spi(void)
+{
+	hal.console->println("# SPI transactions:");
+	for (uint8_t t=0; t<sizeof(spi_tests)/sizeof(spi_tests[0]); t++) {
+		const struct spi_test &test = spi_tests[t];
+		AP_HAL::SPIDeviceDriver *dev = hal.spi->device(test.device);
+		if (dev == NULL) {
+			hal.console->printf("# %s: no device\n", test.name);
+			continue;
+		}
+		AP_HAL::Semaphore *sem = dev->get_semaphore();
+		if (sem != NULL && !sem->take(10)) {
+			hal.console->printf("# %s: busy\n", test.name);
+			continue;
+		}
+		uint8_t rx[4];
+		uint32_t us_start = hal.scheduler->micros();
+		for (uint8_t i=0; i<100; i++) {
+			dev->transaction(test.tx, rx, test.len);
+		}
+		uint32_t us_end = hal.scheduler->micros();
+		if (sem != NULL) {
+			sem->give();
+		}
+		report(test.name, (us_end - us_start) / 100.0f, "usec/transaction");
+	}
+}
+
+/*
+  I2C register reads from the compass, which every board has
+ */
+#define HMC5883_ADDRESS 0x1E
+#define HMC5883_ID_A    10
+
+static void show_i2c(void)
+{
+	hal.console->println("# I2C transactions:");
+	AP_HAL::Semaphore *sem = hal.i2c->get_semaphore();
+	if (sem != NULL && !sem->take(10)) {
+		hal.console->println("# i2c: busy");
+		return;
+	}
+	uint8_t errors = 0;
+	uint8_t i;
+	uint32_t us_start = hal.scheduler->micros();
+	for (i=0; i<20; i++) {
+		uint8_t v;
+		if (hal.i2c->readRegister(HMC5883_ADDRESS, HMC5883_ID_A, &v) != 0) {
+			// no point waiting out more timeouts
+			errors++;
+			i++;
+			break;
+		}
+	}
+	uint32_t us_end = hal.scheduler->micros();
+	if (sem != NULL) {
+		sem->give();
+	}
+	report("i2c.hmc5883", (us_end - us_start) / (float)i, "usec/read");
+	report("i2c.errors", errors, "count");
+}
+
+/*
+  console throughput, writing a line of dots
+ */
+static void show_uart(void)
+{
+	hal.console->println("# UART throughput:");
+	hal.console->print("# ");
+	uint32_t us_start = hal.scheduler->micros();
+	for (uint16_t i=0; i<256; i++) {
+		hal.console->write('.');
+	}
+	uint32_t us_end = hal.scheduler->micros();
+	hal.console->println("");
+	report("uart.console", 256 * 1.0e6f / (us_end - us_start), "bytes/sec");
+}
+
+/*
+  storage block reads, and writes of the same bytes back
+ */
+#define STORAGE_TEST_ADDRESS 4000
+#define STORAGE_TEST_SIZE    64
+
+static void show_storage(void)
+{
+	uint8_t buf[STORAGE_TEST_SIZE];
+
+	hal.console->println("# Storage:");
+	uint32_t us_start = hal.scheduler->micros();
+	for (uint8_t i=0; i<20; i++) {
+		hal.storage->read_block(buf, STORAGE_TEST_ADDRESS, sizeof(buf));
+	}
+	uint32_t us_end = hal.scheduler->micros();
+	report("storage.read", (us_end - us_start) / 20.0f, "usec/64 bytes");
+
+	us_start = hal.scheduler->micros();
+	for (uint8_t i=0; i<5; i++) {
+		hal.storage->write_block(STORAGE_TEST_ADDRESS, buf, sizeof(buf));
+	}
+	us_end = hal.scheduler->micros();
+	report("storage.write", (us_end - us_start) / 5.0f, "usec/64 bytes");
+}
+
+/*
+  log writes, as fast as the DataFlash backend takes them
+ */
+static void show_dataflash(void)
+{
+	hal.console->println("# DataFlash:");
+	if (!dataflash_ok) {
+		hal.console->println("# dataflash: not available or needs erasing");
+		return;
+	}
+	uint16_t i;
+	uint32_t us_start = hal.scheduler->micros();
+	for (i=0; i<200; i++) {
+		log_write_test(DataFlash, hal.scheduler->micros(), v_f, v_f * 2, v_f * 3, i);
+	}
+	uint32_t us_end = hal.scheduler->micros();
+	report("dataflash.write", i * sizeof(struct log_Test) * 1.0e6f / (us_end - us_start), "bytes/sec");
+}
+
+/*
+  the gaps between timer process calls over a second
+ */
+static void show_timer(void)
+{
+	hal.console->println("# Timer process:");
+	timer_reset();
+	hal.scheduler->delay(1000);
+
+	hal.scheduler->suspend_timer_procs();
+	uint32_t count = timer_count;
+	uint32_t min_us = timer_min_us;
+	uint32_t max_us = timer_max_us;
+	uint32_t sum_us = timer_sum_us;
+	hal.scheduler->resume_timer_procs();
+
+	if (count == 0) {
+		hal.console->println("# timer: no calls");
+		return;
+	}
+	report("timer.calls", count, "per sec");
+	report("timer.mean", sum_us / (float)count, "usec");
+	report("timer.min", min_us, "usec");
+	report("timer.max", max_us, "usec");
+}
+
 void loop()
 {
+	hal.console->printf("# CPUInfo on %s\n", HAL_BOARD_NAME);
 	show_sizes();
-	hal.console->println("");
 	show_timings();
+	show_spi();
+	show_i2c();
+	show_uart();
+	show_storage();
+	show_dataflash();
+	show_timer();
+	hal.console->println("# end");
 	hal.console->println("");
 	hal.scheduler->delay(3000);
 }
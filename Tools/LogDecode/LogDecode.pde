@@ -0,0 +1,114 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Decode a whole binary DataFlash log into a table per message type
+// and write them out for analysis. Build with "make sitl" and run as
+//
+//   LogDecode.elf -C
+//
+// The log is log.bin, or the file named by $LOGDECODE_LOG. The tables
+// go to the directory named by $LOGDECODE_DIR, or the current one, as
+// NAME.csv files, or as NAME.col files of raw columns if
+// $LOGDECODE_FORMAT is "col". See LogDecoder.h for the layout of those
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+#include <AP_Math.h>
+#include <AP_HAL.h>
+#include <AP_ADC.h>
+#include <AP_Declination.h>
+#include <AP_ADC_AnalogSource.h>
+#include <Filter.h>
+#include <AP_Buffer.h>
+#include <AP_Airspeed.h>
+#include <DataFlash.h>
+#include <GCS_MAVLink.h>
+#include <AP_GPS.h>
+#include <AP_AHRS.h>
+#include <SITL.h>
+#include <AP_Compass.h>
+#include <AP_Baro.h>
+#include <AP_InertialSensor.h>
+#include <AP_Scheduler.h>
+#include "LogDecoder.h"
+
+#include <AP_HAL_AVR.h>
+#include <AP_HAL_AVR_SITL.h>
+#include <AP_HAL_Empty.h>
+
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+#if CONFIG_HAL_BOARD != HAL_BOARD_AVR_SITL
+ # error "LogDecode only runs on SITL"
+#endif
+
+static LogDecoder decoder;
+
+// the console is on uartA, which is buffered, so send what is
+// waiting before exiting
+static void finish(int status)
+{
+    hal.uartA->flush();
+    exit(status);
+}
+
+static uint64_t wall_usec(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+void setup()
+{
+    const char *filename = getenv("LOGDECODE_LOG");
+    if (filename == NULL) {
+        filename = "log.bin";
+    }
+
+    if (!decoder.open_log(filename)) {
+        hal.console->printf_P(PSTR("Unable to open %s\n"), filename);
+        finish(1);
+    }
+    hal.console->printf_P(PSTR("Decoding %s, %lu bytes\n"),
+                          filename, (unsigned long)decoder.log_size());
+}
+
+void loop()
+{
+    const char *dir = getenv("LOGDECODE_DIR");
+    if (dir == NULL) {
+        dir = ".";
+    }
+    const char *format = getenv("LOGDECODE_FORMAT");
+    bool columns = format != NULL && strcmp(format, "col") == 0;
+
+    uint64_t start_usec = wall_usec();
+    decoder.decode();
+    uint64_t decode_usec = wall_usec() - start_usec;
+
+    for (uint8_t i=0; i<decoder.table_count(); i++) {
+        const char *name = decoder.table_name(i);
+        hal.console->printf_P(PSTR("%-4s %lu\n"), name, (unsigned long)decoder.row_count(name));
+    }
+    hal.console->printf_P(PSTR("%lu messages in %.3fs, %lu bytes skipped\n"),
+                          (unsigned long)decoder.message_count(),
+                          decode_usec * 1.0e-6f,
+                          (unsigned long)decoder.skipped_bytes());
+
+    start_usec = wall_usec();
+    bool ok = columns ? decoder.write_columns(dir) : decoder.write_csv(dir);
+    if (!ok) {
+        hal.console->printf_P(PSTR("Unable to write to %s\n"), dir);
+        finish(1);
+    }
+    hal.console->printf_P(PSTR("written to %s in %.3fs\n"),
+                          dir, (wall_usec() - start_usec) * 1.0e-6f);
+    finish(0);
+}
+
+AP_HAL_MAIN();
@@ -0,0 +1,506 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <DataFlash.h>
+#include "LogDecoder.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// head1, head2 and msgid, before the body of each record
+#define LOGDECODE_HEADER_LEN 3
+
+// rows allocated for a type when its first record is found
+#define LOGDECODE_INITIAL_ROWS 1024
+
+LogDecoder::LogDecoder(void) :
+    _fd(-1),
+    _log(NULL),
+    _size(0),
+    _messages(0),
+    _skipped(0),
+    _time_us(0)
+{
+    memset(_tables, 0, sizeof(_tables));
+}
+
+LogDecoder::~LogDecoder(void)
+{
+    for (uint16_t i=0; i<256; i++) {
+        _free_table(_tables[i]);
+    }
+    if (_log != NULL) {
+        munmap((void *)_log, _size);
+    }
+    if (_fd != -1) {
+        close(_fd);
+    }
+}
+
+bool LogDecoder::open_log(const char *filename)
+{
+    _fd = open(filename, O_RDONLY);
+    if (_fd == -1) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(_fd, &st) != 0 || st.st_size == 0) {
+        return false;
+    }
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    // the log is read once from start to end
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    _log = (const uint8_t *)p;
+    _size = st.st_size;
+    return true;
+}
+
+/*
+  set up the table of a type from its FMT message. A type seen again
+  with the same layout keeps its rows, so logs joined end to end
+  decode as one
+ */
+void LogDecoder::_add_format(const struct log_Format &f)
+{
+    struct table *t = _tables[f.type];
+    if (t != NULL) {
+        if (memcmp(&t->format, &f, sizeof(f)) == 0) {
+            return;
+        }
+        _free_table(t);
+        _tables[f.type] = NULL;
+    }
+    if (f.length < LOGDECODE_HEADER_LEN) {
+        return;
+    }
+
+    t = (struct table *)calloc(1, sizeof(*t));
+    if (t == NULL) {
+        return;
+    }
+    memcpy(&t->format, &f, sizeof(f));
+    t->body_len = f.length - LOGDECODE_HEADER_LEN;
+    memcpy(t->name, f.name, sizeof(f.name));
+    t->name[sizeof(f.name)] = 0;
+    t->timed = log_header_length(f) > LOGDECODE_HEADER_LEN;
+
+    // the labels are a comma separated list, one per field
+    const char *label = f.labels;
+    const char *labels_end = f.labels + strnlen(f.labels, sizeof(f.labels));
+    uint8_t ofs = log_header_length(f) - LOGDECODE_HEADER_LEN;
+    for (uint8_t i=0; i<sizeof(f.format) && f.format[i] != 0; i++) {
+        struct column &col = t->columns[i];
+        col.type = f.format[i];
+        col.size = log_field_size(col.type);
+        col.offset = ofs;
+        if (col.size == 0 || ofs + col.size > t->body_len) {
+            // a format character this build doesn't know, so the
+            // fields after it can't be found
+            break;
+        }
+        ofs += col.size;
+
+        const char *comma = (const char *)memchr(label, ',', labels_end - label);
+        const char *end = comma != NULL ? comma : labels_end;
+        uint8_t n = end - label;
+        if (n >= sizeof(t->labels[i])) {
+            n = sizeof(t->labels[i]) - 1;
+        }
+        memcpy(t->labels[i], label, n);
+        t->labels[i][n] = 0;
+        label = comma != NULL ? comma + 1 : labels_end;
+
+        t->num_columns = i + 1;
+    }
+    _tables[f.type] = t;
+}
+
+void LogDecoder::_free_table(struct table *t)
+{
+    if (t == NULL) {
+        return;
+    }
+    for (uint8_t c=0; c<t->num_columns; c++) {
+        free(t->columns[c].data);
+    }
+    free(t->times);
+    free(t);
+}
+
+/*
+  add a row to a table, scattering the fields of the record body to
+  their columns
+ */
+void LogDecoder::_append(struct table *t, const uint8_t *body)
+{
+    memcpy(t->last, body, t->body_len);
+    t->have_last = true;
+
+    if (t->timed) {
+        // the clock moves on even if the row can't be stored
+        uint16_t delta;
+        memcpy(&delta, body, sizeof(delta));
+        if (t->format.type == LOG_TIME_MSG && t->body_len >= sizeof(delta) + sizeof(_time_us)) {
+            memcpy(&_time_us, &body[sizeof(delta)], sizeof(_time_us));
+        } else {
+            _time_us += delta;
+        }
+    }
+
+    if (t->count == t->capacity) {
+        uint32_t capacity = t->capacity == 0 ? LOGDECODE_INITIAL_ROWS : t->capacity * 2;
+        for (uint8_t c=0; c<t->num_columns; c++) {
+            struct column &col = t->columns[c];
+            uint8_t *data = (uint8_t *)realloc(col.data, (size_t)capacity * col.size);
+            if (data == NULL) {
+                return;
+            }
+            col.data = data;
+        }
+        if (t->timed) {
+            uint32_t *times = (uint32_t *)realloc(t->times, (size_t)capacity * sizeof(uint32_t));
+            if (times == NULL) {
+                return;
+            }
+            t->times = times;
+        }
+        t->capacity = capacity;
+    }
+    for (uint8_t c=0; c<t->num_columns; c++) {
+        const struct column &col = t->columns[c];
+        memcpy(&col.data[(size_t)t->count * col.size], &body[col.offset], col.size);
+    }
+    if (t->timed) {
+        t->times[t->count] = _time_us;
+    }
+    t->count++;
+}
+
+/*
+  expand a delta record at ofs, see DataFlash_Block::_write_delta().
+  Returns the offset after it, or 0 if it runs past the end of the log
+ */
+size_t LogDecoder::_decode_delta(struct table *t, size_t ofs)
+{
+    uint8_t len = t->body_len;
+    uint8_t nbitmap = (len+7)/8;
+    const uint8_t *bitmap = &_log[ofs + LOGDECODE_HEADER_LEN];
+    size_t next = ofs + LOGDECODE_HEADER_LEN + nbitmap;
+    if (next > _size) {
+        return 0;
+    }
+    uint8_t body[256];
+    memcpy(body, t->last, len);
+    for (uint8_t i=0; i<len; i++) {
+        if (bitmap[i/8] & (1U<<(i&7))) {
+            if (next >= _size) {
+                return 0;
+            }
+            body[i] ^= _log[next++];
+        }
+    }
+    if (t->have_last) {
+        _append(t, body);
+        _messages++;
+    }
+    // otherwise the reference was lost, and the type resumes at its
+    // next plain record
+    return next;
+}
+
+void LogDecoder::decode(void)
+{
+    size_t ofs = 0;
+    while (ofs + LOGDECODE_HEADER_LEN <= _size) {
+        const uint8_t *p = &_log[ofs];
+        if (p[0] != HEAD_BYTE1 || (p[1] != HEAD_BYTE2 && p[1] != HEAD_BYTE2_DELTA)) {
+            // lost sync, hunt for the next header
+            const uint8_t *head = (const uint8_t *)memchr(p + 1, HEAD_BYTE1, _size - ofs - 1);
+            size_t skip = head != NULL ? (size_t)(head - p) : _size - ofs;
+            _skipped += skip;
+            ofs += skip;
+            continue;
+        }
+        uint8_t msgid = p[2];
+
+        if (p[1] == HEAD_BYTE2 && msgid == LOG_FORMAT_MSG) {
+            if (ofs + sizeof(struct log_Format) > _size) {
+                break;
+            }
+            struct log_Format f;
+            memcpy(&f, p, sizeof(f));
+            _add_format(f);
+            ofs += sizeof(f);
+            continue;
+        }
+
+        struct table *t = _tables[msgid];
+        if (t == NULL) {
+            // no FMT seen for it, so its length is unknown
+            _skipped++;
+            ofs++;
+            continue;
+        }
+
+        if (p[1] == HEAD_BYTE2_DELTA) {
+            size_t next = _decode_delta(t, ofs);
+            if (next == 0) {
+                break;
+            }
+            ofs = next;
+            continue;
+        }
+
+        if (ofs + t->format.length > _size) {
+            break;
+        }
+        _append(t, p + LOGDECODE_HEADER_LEN);
+        _messages++;
+        ofs += t->format.length;
+    }
+}
+
+const struct LogDecoder::table *LogDecoder::_find_table(const char *name) const
+{
+    for (uint16_t i=0; i<256; i++) {
+        if (_tables[i] != NULL && strcmp(_tables[i]->name, name) == 0) {
+            return _tables[i];
+        }
+    }
+    return NULL;
+}
+
+uint32_t LogDecoder::row_count(const char *name) const
+{
+    const struct table *t = _find_table(name);
+    return t != NULL ? t->count : 0;
+}
+
+const void *LogDecoder::column(const char *name, const char *label, char &type) const
+{
+    const struct table *t = _find_table(name);
+    if (t == NULL) {
+        return NULL;
+    }
+    for (uint8_t c=0; c<t->num_columns; c++) {
+        if (strcmp(t->labels[c], label) == 0) {
+            type = t->columns[c].type;
+            return t->columns[c].data;
+        }
+    }
+    return NULL;
+}
+
+const uint32_t *LogDecoder::times(const char *name) const
+{
+    const struct table *t = _find_table(name);
+    if (t == NULL || !t->timed) {
+        return NULL;
+    }
+    return t->times;
+}
+
+uint8_t LogDecoder::table_count(void) const
+{
+    uint8_t n = 0;
+    for (uint16_t i=0; i<256; i++) {
+        if (_tables[i] != NULL && _tables[i]->count != 0) {
+            n++;
+        }
+    }
+    return n;
+}
+
+const char *LogDecoder::table_name(uint8_t i) const
+{
+    for (uint16_t m=0; m<256; m++) {
+        if (_tables[m] != NULL && _tables[m]->count != 0) {
+            if (i == 0) {
+                return _tables[m]->name;
+            }
+            i--;
+        }
+    }
+    return NULL;
+}
+
+FILE *LogDecoder::_open_output(const char *dir, const struct table *t, const char *ext) const
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.%s", dir, t->name, ext);
+    FILE *f = fopen(path, "wb");
+    if (f != NULL) {
+        setvbuf(f, NULL, _IOFBF, 1<<16);
+    }
+    return f;
+}
+
+/*
+  print a value as the log dump of DataFlash does
+ */
+void LogDecoder::_write_value(FILE *f, char type, const uint8_t *v) const
+{
+    switch (type) {
+    case 'b':
+        fprintf(f, "%d", (int)(int8_t)v[0]);
+        break;
+    case 'B':
+    case 'M':
+        fprintf(f, "%u", (unsigned)v[0]);
+        break;
+    case 'h': {
+        int16_t x;
+        memcpy(&x, v, sizeof(x));
+        fprintf(f, "%d", (int)x);
+        break;
+    }
+    case 'H': {
+        uint16_t x;
+        memcpy(&x, v, sizeof(x));
+        fprintf(f, "%u", (unsigned)x);
+        break;
+    }
+    case 'i': {
+        int32_t x;
+        memcpy(&x, v, sizeof(x));
+        fprintf(f, "%ld", (long)x);
+        break;
+    }
+    case 'I': {
+        uint32_t x;
+        memcpy(&x, v, sizeof(x));
+        fprintf(f, "%lu", (unsigned long)x);
+        break;
+    }
+    case 'f': {
+        float x;
+        memcpy(&x, v, sizeof(x));
+        fprintf(f, "%f", x);
+        break;
+    }
+    case 'c': {
+        int16_t x;
+        memcpy(&x, v, sizeof(x));
+        fprintf(f, "%.2f", 0.01f*x);
+        break;
+    }
+    case 'C': {
+        uint16_t x;
+        memcpy(&x, v, sizeof(x));
+        fprintf(f, "%.2f", 0.01f*x);
+        break;
+    }
+    case 'e': {
+        int32_t x;
+        memcpy(&x, v, sizeof(x));
+        fprintf(f, "%.2f", 0.01f*x);
+        break;
+    }
+    case 'E': {
+        uint32_t x;
+        memcpy(&x, v, sizeof(x));
+        fprintf(f, "%.2f", 0.01f*x);
+        break;
+    }
+    case 'L': {
+        int32_t x;
+        memcpy(&x, v, sizeof(x));
+        fprintf(f, "%.7f", x * 1.0e-7);
+        break;
+    }
+    case 'n':
+    case 'N':
+    case 'Z': {
+        char s[65];
+        uint8_t len = log_field_size(type);
+        memcpy(s, v, len);
+        s[len] = 0;
+        fputs(s, f);
+        break;
+    }
+    case 'a': {
+        // the array as one field, its values separated by spaces
+        for (uint8_t i=0; i<LOG_ARRAY_VALUES; i++) {
+            int16_t x;
+            memcpy(&x, &v[i*sizeof(x)], sizeof(x));
+            fprintf(f, i == 0 ? "%d" : " %d", (int)x);
+        }
+        break;
+    }
+    }
+}
+
+bool LogDecoder::write_csv(const char *dir) const
+{
+    for (uint16_t i=0; i<256; i++) {
+        const struct table *t = _tables[i];
+        if (t == NULL || t->count == 0) {
+            continue;
+        }
+        FILE *f = _open_output(dir, t, "csv");
+        if (f == NULL) {
+            return false;
+        }
+        if (t->timed) {
+            fputs("LogTimeUS,", f);
+        }
+        for (uint8_t c=0; c<t->num_columns; c++) {
+            fprintf(f, c == 0 ? "%s" : ",%s", t->labels[c]);
+        }
+        fputc('\n', f);
+        for (uint32_t r=0; r<t->count; r++) {
+            if (t->timed) {
+                fprintf(f, "%lu,", (unsigned long)t->times[r]);
+            }
+            for (uint8_t c=0; c<t->num_columns; c++) {
+                const struct column &col = t->columns[c];
+                if (c != 0) {
+                    fputc(',', f);
+                }
+                _write_value(f, col.type, &col.data[(size_t)r * col.size]);
+            }
+            fputc('\n', f);
+        }
+        if (fclose(f) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LogDecoder::write_columns(const char *dir) const
+{
+    for (uint16_t i=0; i<256; i++) {
+        const struct table *t = _tables[i];
+        if (t == NULL || t->count == 0) {
+            continue;
+        }
+        FILE *f = _open_output(dir, t, "col");
+        if (f == NULL) {
+            return false;
+        }
+        uint32_t flags = t->timed ? LOGDECODE_COLUMN_TIME : 0;
+        bool ok = fwrite(LOGDECODE_COLUMN_MAGIC, 4, 1, f) == 1 &&
+            fwrite(&t->count, sizeof(t->count), 1, f) == 1 &&
+            fwrite(&flags, sizeof(flags), 1, f) == 1 &&
+            fwrite(&t->format, sizeof(t->format), 1, f) == 1;
+        for (uint8_t c=0; ok && c<t->num_columns; c++) {
+            const struct column &col = t->columns[c];
+            ok = fwrite(col.data, col.size, t->count, f) == t->count;
+        }
+        if (ok && t->timed) {
+            ok = fwrite(t->times, sizeof(uint32_t), t->count, f) == t->count;
+        }
+        if (fclose(f) != 0 || !ok) {
+            return false;
+        }
+    }
+    return true;
+}
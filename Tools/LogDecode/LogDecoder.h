@@ -0,0 +1,118 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+  decoder of whole binary DataFlash logs into a table per message
+  type, for analysis off the vehicle. The log is mapped into memory
+  and read in one pass, learning the layout of each type from its FMT
+  message as it goes. Each field of a type becomes a column of values
+  at their logged width, so a column can be handed to a plotting or
+  numerical tool as one array.
+
+  Delta records, as written by DataFlash_Block, are expanded against
+  the last record of the same type. Types with header timestamps get
+  a column of the time of each record, LogTimeUS.
+ */
+
+#ifndef __LOGDECODER_H__
+#define __LOGDECODER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <DataFlash.h>
+
+/*
+  The columnar export writes a NAME.col file per type. It starts with
+  a header of
+
+    char     magic[4];          // "APLC"
+    uint32_t count;             // rows
+    uint32_t flags;             // LOGDECODE_COLUMN_*
+    struct log_Format format;   // the FMT message of the type
+
+  followed by a column per character of format.format, in order, each
+  of count values of log_field_size() bytes, little endian and scaled
+  as logged. The columns stop at the first format character that
+  log_field_size() doesn't know. With LOGDECODE_COLUMN_TIME the last
+  column is the uint32_t time of each record in microseconds
+ */
+#define LOGDECODE_COLUMN_MAGIC "APLC"
+#define LOGDECODE_COLUMN_TIME  1
+
+class LogDecoder
+{
+public:
+    LogDecoder(void);
+    ~LogDecoder(void);
+
+    bool open_log(const char *filename);
+
+    // read the whole log into the tables
+    void decode(void);
+
+    // write a file per message type with any rows into dir. Returns
+    // false if a file couldn't be written
+    bool write_csv(const char *dir) const;
+    bool write_columns(const char *dir) const;
+
+    // what decode() found
+    uint32_t message_count(void) const { return _messages; }
+    uint32_t skipped_bytes(void) const { return _skipped; }
+    size_t log_size(void) const { return _size; }
+
+    // the rows of a type, 0 if it wasn't in the log
+    uint32_t row_count(const char *name) const;
+
+    // a column of a type by its label, with its format character so
+    // the caller knows the type of the values
+    const void *column(const char *name, const char *label, char &type) const;
+
+    // the times of the rows of a type in microseconds, NULL if its
+    // records have no header timestamps
+    const uint32_t *times(const char *name) const;
+
+    // the number of types with rows, and the name of the i'th
+    uint8_t table_count(void) const;
+    const char *table_name(uint8_t i) const;
+
+private:
+    struct column {
+        char type;
+        uint8_t offset;         // in the record after the header
+        uint8_t size;
+        uint8_t *data;
+    };
+
+    struct table {
+        struct log_Format format;
+        uint8_t body_len;
+        bool timed;             // has a time_delta after the header
+        char name[5];
+        uint8_t num_columns;
+        struct column columns[16];
+        char labels[16][17];
+        uint32_t *times;
+        uint32_t count;
+        uint32_t capacity;
+        bool have_last;
+        uint8_t last[256];      // the reference for delta records
+    };
+
+    struct table *_tables[256];
+
+    int _fd;
+    const uint8_t *_log;
+    size_t _size;
+    uint32_t _messages;
+    uint32_t _skipped;
+    uint32_t _time_us;          // of the last timestamped record
+
+    void _add_format(const struct log_Format &f);
+    void _free_table(struct table *t);
+    void _append(struct table *t, const uint8_t *body);
+    size_t _decode_delta(struct table *t, size_t ofs);
+    const struct table *_find_table(const char *name) const;
+    void _write_value(FILE *f, char type, const uint8_t *v) const;
+    FILE *_open_output(const char *dir, const struct table *t, const char *ext) const;
+};
+
+#endif // __LOGDECODER_H__
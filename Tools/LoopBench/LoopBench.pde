@@ -0,0 +1,192 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Timings of the functions that dominate the main loops, run on canned
+// sensor data so every build and board runs the same code paths. Each
+// result is one line of
+//
+//   BENCH name calls total_us ns_per_call
+//
+// which Tools/scripts/loop_bench.py collects, from SITL or from an
+// APM2 build under simavr, and compares against earlier commits
+//
+
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+#include <AP_Math.h>
+#include <AP_HAL.h>
+#include <AP_ADC.h>
+#include <AP_ADC_AnalogSource.h>
+#include <AP_Declination.h>
+#include <Filter.h>
+#include <AP_Buffer.h>
+#include <AP_Airspeed.h>
+#include <DataFlash.h>
+#include <AP_Scheduler.h>
+#include <GCS_MAVLink.h>
+#include <AP_GPS.h>
+#include <AP_AHRS.h>
+#include <SITL.h>
+#include <AP_Compass.h>
+#include <AP_Baro.h>
+#include <AP_InertialSensor.h>
+#include <AP_InertialNav.h>
+#include <AC_PID.h>
+#include <APM_PI.h>
+#include <AC_WPNav.h>
+#include <RC_Channel.h>
+#include <AP_Curve.h>
+#include <AP_Motors.h>
+#include <AP_SpdHgtControl.h>
+#include <AP_TECS.h>
+
+#include <AP_HAL_AVR.h>
+#include <AP_HAL_AVR_SITL.h>
+#include <AP_HAL_PX4.h>
+#include <AP_HAL_Empty.h>
+
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+// calls per timing. Enough to make the 4us resolution of micros() on
+// AVR small, few enough to finish quickly under simavr
+#define NUM_CALLS 200
+
+// the stub and HIL drivers on every board, so the inputs are canned
+static AP_InertialSensor_Stub ins;
+static GPS *g_gps;
+static AP_GPS_HIL g_gps_driver;
+static AP_AHRS_DCM ahrs(&ins, g_gps);
+static AP_Compass_HIL compass;
+static AP_Baro_HIL barometer;
+static AP_InertialNav inertial_nav(&ahrs, &ins, &barometer, &g_gps);
+
+static APM_PI pi_loiter_lat(1.0f, 0, 0);
+static APM_PI pi_loiter_lon(1.0f, 0, 0);
+static AC_PID pid_loiter_rate_lat(1.0f, 0.5f, 0, 400);
+static AC_PID pid_loiter_rate_lon(1.0f, 0.5f, 0, 400);
+static AC_WPNav wp_nav(&inertial_nav, &ahrs, &pi_loiter_lat, &pi_loiter_lon,
+                       &pid_loiter_rate_lat, &pid_loiter_rate_lon);
+
+static RC_Channel rc1(0), rc2(1), rc3(2), rc4(3);
+static AP_MotorsQuad motors(&rc1, &rc2, &rc3, &rc4);
+
+static AP_SpdHgtControl::AircraftParameters aparm;
+static AP_TECS tecs(&ahrs, aparm);
+
+static uint16_t step;
+
+// a slow coning motion with some vibration on the accels, so the
+// estimators do real work on every call
+static void canned_imu(void)
+{
+    float t = step * 0.01f;
+    ins.set_gyro(Vector3f(0.2f * sinf(t), 0.2f * cosf(t), 0.05f));
+    ins.set_accel(Vector3f(0.3f * sinf(7 * t), 0.3f * cosf(5 * t), -GRAVITY_MSS));
+    step++;
+}
+
+static void run_ahrs(void)
+{
+    canned_imu();
+    ahrs.update();
+}
+
+static void run_inertial_nav(void)
+{
+    canned_imu();
+    inertial_nav.update(0.01f);
+}
+
+static void run_loiter(void)
+{
+    wp_nav.update_loiter();
+    wp_nav.update_velocity();
+}
+
+static void run_motors(void)
+{
+    rc1.servo_out = (step & 0xFF) * 10 - 1280;
+    rc2.servo_out = 1280 - (step & 0xFF) * 10;
+    rc3.servo_out = 500;
+    rc4.servo_out = (step & 0x7F) * 10 - 640;
+    step++;
+    motors.output();
+}
+
+static void run_tecs(void)
+{
+    tecs.update_50hz(100.0f);
+    tecs.update_pitch_throttle(12000, 1500, false, 0, 0, 100.0f);
+}
+
+static void bench(const prog_char_t *name, void (*fn)(void))
+{
+    // once outside the timing, to settle any first call paths
+    fn();
+
+    uint32_t t0 = hal.scheduler->micros();
+    for (uint16_t i=0; i<NUM_CALLS; i++) {
+        fn();
+    }
+    uint32_t us = hal.scheduler->micros() - t0;
+    hal.console->printf_P(PSTR("BENCH %S %u %lu %.1f\n"),
+                          name, (unsigned)NUM_CALLS, (unsigned long)us,
+                          us * 1000.0f / NUM_CALLS);
+}
+
+void setup(void)
+{
+    hal.console->println_P(PSTR("main loop benchmarks"));
+
+    ins.init(AP_InertialSensor::WARM_START, AP_InertialSensor::RATE_100HZ, NULL);
+    ahrs.init();
+    compass.init();
+    compass.setHIL(0, 0, 0);
+    compass.read();
+    ahrs.set_compass(&compass);
+    barometer.init();
+    barometer.setHIL(100);
+    barometer.read();
+
+    // a 3D fix, so inertial nav runs its horizontal corrections
+    g_gps = &g_gps_driver;
+    g_gps->init(NULL);
+    g_gps_driver.setHIL(0, -35.362938f, 149.165085f, 684, 5, 90, 5, 10);
+    g_gps->update();
+    inertial_nav.init();
+    inertial_nav.set_current_position(g_gps->longitude, g_gps->latitude);
+
+    wp_nav.init_loiter_target(Vector3f(1000, -500, 1000), Vector3f(100, 50, 0));
+
+    rc3.radio_min = 1000;
+    rc3.radio_max = 2000;
+    motors.set_update_rate(490);
+    motors.set_frame_orientation(AP_MOTORS_X_FRAME);
+    motors.set_min_throttle(130);
+    motors.set_max_throttle(850);
+    motors.Init();
+    motors.enable();
+    motors.armed(true);
+
+    aparm.throttle_min.set(0);
+    aparm.throttle_max.set(75);
+    aparm.throttle_slewrate.set(100);
+    aparm.throttle_cruise.set(45);
+    aparm.airspeed_min.set(9);
+    aparm.airspeed_max.set(22);
+    aparm.pitch_limit_max_cd.set(2000);
+    aparm.pitch_limit_min_cd.set(-2500);
+}
+
+void loop(void)
+{
+    bench(PSTR("ahrs_dcm_update"), run_ahrs);
+    bench(PSTR("inertial_nav_update"), run_inertial_nav);
+    bench(PSTR("wpnav_update_loiter"), run_loiter);
+    bench(PSTR("motors_output_armed"), run_motors);
+    bench(PSTR("tecs_update"), run_tecs);
+    hal.console->println_P(PSTR("BENCH DONE"));
+    hal.scheduler->delay(1000);
+}
+
+AP_HAL_MAIN();
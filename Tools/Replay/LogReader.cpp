@@ -0,0 +1,234 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <DataFlash.h>
+#include "LogReader.h"
+#include <string.h>
+
+LogReader::LogReader(void) :
+    _fd(NULL),
+    _time_us(0),
+    _have_time(false)
+{
+    memset(_formats, 0, sizeof(_formats));
+    memset(_msg, 0, sizeof(_msg));
+}
+
+bool LogReader::open_log(const char *filename)
+{
+    _fd = fopen(filename, "rb");
+    return _fd != NULL;
+}
+
+bool LogReader::next_message(void)
+{
+    if (_fd == NULL) {
+        return false;
+    }
+
+    while (true) {
+        int c = fgetc(_fd);
+        if (c == EOF) {
+            return false;
+        }
+        if (c != HEAD_BYTE1) {
+            continue;
+        }
+        c = fgetc(_fd);
+        if (c != HEAD_BYTE2) {
+            // a delta compressed record only comes from a block
+            // backend, so treat it like any other loss of sync
+            if (c != EOF) {
+                ungetc(c, _fd);
+            }
+            continue;
+        }
+        c = fgetc(_fd);
+        if (c == EOF) {
+            return false;
+        }
+        uint8_t msgid = c;
+
+        if (msgid == LOG_FORMAT_MSG) {
+            struct log_Format f;
+            if (fread(&f.type, sizeof(f) - 3, 1, _fd) != 1) {
+                return false;
+            }
+            struct format &fmt = _formats[f.type];
+            fmt.valid = true;
+            fmt.length = f.length;
+            fmt.header_length = log_header_length(f);
+            memcpy(fmt.name, f.name, sizeof(f.name));
+            fmt.name[sizeof(f.name)] = 0;
+            memcpy(fmt.format, f.format, sizeof(f.format));
+            fmt.format[sizeof(f.format)] = 0;
+            memcpy(fmt.labels, f.labels, sizeof(f.labels));
+            fmt.labels[sizeof(f.labels)] = 0;
+            continue;
+        }
+
+        const struct format &fmt = _formats[msgid];
+        if (!fmt.valid || fmt.length < 3) {
+            // no FMT seen for it, so its length is unknown. Hunt for
+            // the next header
+            continue;
+        }
+        _msg[0] = HEAD_BYTE1;
+        _msg[1] = HEAD_BYTE2;
+        _msg[2] = msgid;
+        if (fread(&_msg[3], fmt.length - 3, 1, _fd) != 1) {
+            return false;
+        }
+        if (fmt.header_length == 5) {
+            // the time_delta, or the absolute time of a TIME record
+            int32_t time_us;
+            if (msgid == LOG_TIME_MSG && get_int32("TimeUS", time_us)) {
+                _time_us = time_us;
+                _have_time = true;
+            } else {
+                uint16_t delta;
+                memcpy(&delta, &_msg[3], sizeof(delta));
+                _time_us += delta;
+            }
+        }
+        return true;
+    }
+}
+
+bool LogReader::get_time_us(uint32_t &time_us) const
+{
+    time_us = _time_us;
+    return _have_time && _formats[_msg[2]].header_length == 5;
+}
+
+const char *LogReader::msg_name(void) const
+{
+    return _formats[_msg[2]].name;
+}
+
+bool LogReader::_find_field(const char *label, uint8_t &ofs, char &type) const
+{
+    const struct format &fmt = _formats[_msg[2]];
+    const char *labels = fmt.labels;
+    uint8_t label_len = strlen(label);
+
+    ofs = fmt.header_length;
+    for (uint8_t i=0; fmt.format[i] != 0; i++) {
+        const char *comma = strchr(labels, ',');
+        uint8_t len = comma ? comma - labels : strlen(labels);
+        if (len == label_len && strncmp(labels, label, len) == 0) {
+            type = fmt.format[i];
+            return ofs + log_field_size(type) <= fmt.length;
+        }
+        ofs += log_field_size(fmt.format[i]);
+        if (comma == NULL) {
+            break;
+        }
+        labels = comma + 1;
+    }
+    return false;
+}
+
+bool LogReader::get_int32(const char *label, int32_t &value) const
+{
+    uint8_t ofs;
+    char type;
+    if (!_find_field(label, ofs, type)) {
+        return false;
+    }
+    const uint8_t *p = &_msg[ofs];
+    switch (type) {
+    case 'b':
+        value = (int8_t)p[0];
+        return true;
+    case 'B':
+    case 'M':
+        value = p[0];
+        return true;
+    case 'h':
+    case 'c': {
+        int16_t v;
+        memcpy(&v, p, sizeof(v));
+        value = v;
+        return true;
+    }
+    case 'H':
+    case 'C': {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        value = v;
+        return true;
+    }
+    case 'i':
+    case 'I':
+    case 'e':
+    case 'E':
+    case 'L':
+        memcpy(&value, p, sizeof(value));
+        return true;
+    case 'f': {
+        float v;
+        memcpy(&v, p, sizeof(v));
+        value = v;
+        return true;
+    }
+    }
+    return false;
+}
+
+bool LogReader::get_float(const char *label, float &value) const
+{
+    uint8_t ofs;
+    char type;
+    if (!_find_field(label, ofs, type)) {
+        return false;
+    }
+    if (type == 'f') {
+        memcpy(&value, &_msg[ofs], sizeof(value));
+        return true;
+    }
+    int32_t v;
+    if (!get_int32(label, v)) {
+        return false;
+    }
+    switch (type) {
+    case 'c':
+    case 'e':
+        value = v * 0.01f;
+        break;
+    case 'C':
+    case 'E':
+        value = (uint32_t)v * 0.01f;
+        break;
+    case 'I':
+        value = (uint32_t)v;
+        break;
+    case 'L':
+        value = v * 1.0e-7f;
+        break;
+    default:
+        value = v;
+        break;
+    }
+    return true;
+}
+
+bool LogReader::get_string(const char *label, char *s, uint8_t size) const
+{
+    uint8_t ofs;
+    char type;
+    if (size == 0 || !_find_field(label, ofs, type)) {
+        return false;
+    }
+    if (type != 'n' && type != 'N' && type != 'Z') {
+        return false;
+    }
+    uint8_t len = log_field_size(type);
+    if (len > size - 1) {
+        len = size - 1;
+    }
+    memcpy(s, &_msg[ofs], len);
+    s[len] = 0;
+    return true;
+}
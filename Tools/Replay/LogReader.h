@@ -0,0 +1,58 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+  reader for binary DataFlash logs, as written to logs/*.bin by
+  DataFlash_File. The FMT messages at the start of the log say how to
+  decode the rest, so fields are found by their label
+ */
+
+#ifndef __LOGREADER_H__
+#define __LOGREADER_H__
+
+#include <stdio.h>
+#include <DataFlash.h>
+
+class LogReader
+{
+public:
+    LogReader(void);
+
+    bool open_log(const char *filename);
+
+    // read the next message other than a FMT. Returns false at the
+    // end of the log
+    bool next_message(void);
+
+    // the name of the current message, such as "IMU"
+    const char *msg_name(void) const;
+
+    // a field of the current message by its label. get_float()
+    // applies the scaling of the c, C, e and E formats, get_int32()
+    // gives the raw integer, which keeps the precision of L
+    bool get_float(const char *label, float &value) const;
+    bool get_int32(const char *label, int32_t &value) const;
+    bool get_string(const char *label, char *s, uint8_t size) const;
+
+    // the time of the current message in microseconds, from the
+    // header timestamps. False if the log doesn't have them
+    bool get_time_us(uint32_t &time_us) const;
+
+private:
+    struct format {
+        bool valid;
+        uint8_t length;
+        uint8_t header_length;
+        char name[5];
+        char format[17];
+        char labels[65];
+    } _formats[256];
+
+    FILE *_fd;
+    uint8_t _msg[256];
+    uint32_t _time_us;
+    bool _have_time;
+
+    // offset and format character of a field in the current message
+    bool _find_field(const char *label, uint8_t &ofs, char &type) const;
+};
+
+#endif // __LOGREADER_H__
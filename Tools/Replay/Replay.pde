@@ -0,0 +1,355 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Replay the sensor data of a DataFlash log through AP_AHRS_DCM and
+// AP_InertialNav, as fast as the host allows. The same log always
+// gives the same result, so it can be used to benchmark and regression
+// test the estimators. Build with "make sitl" and run as
+//
+//   Replay.elf -F -C
+//
+// -F gives a simulated clock that only moves as the log is stepped,
+// and -C puts the results on the console.
+// The log is log.bin, or the file named by $REPLAY_LOG
+//
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+#include <AP_Math.h>
+#include <AP_HAL.h>
+#include <AP_ADC.h>
+#include <AP_Declination.h>
+#include <AP_ADC_AnalogSource.h>
+#include <Filter.h>
+#include <AP_Buffer.h>
+#include <AP_Airspeed.h>
+#include <DataFlash.h>
+#include <GCS_MAVLink.h>
+#include <AP_GPS.h>
+#include <AP_AHRS.h>
+#include <SITL.h>
+#include <AP_Compass.h>
+#include <AP_Baro.h>
+#include <AP_InertialSensor.h>
+#include <AP_InertialNav.h>
+#include <AP_Scheduler.h>
+#include "LogReader.h"
+
+#include <AP_HAL_AVR.h>
+#include <AP_HAL_AVR_SITL.h>
+#include <AP_HAL_Empty.h>
+
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+#if CONFIG_HAL_BOARD != HAL_BOARD_AVR_SITL
+ # error "Replay only runs on SITL"
+#endif
+
+// the rate IMU messages were logged at, the copter fast loop
+#ifndef REPLAY_IMU_RATE_HZ
+ # define REPLAY_IMU_RATE_HZ 100
+#endif
+
+enum {
+    k_param_ins = 1,
+    k_param_ahrs,
+    k_param_compass,
+    k_param_barometer,
+    k_param_inertial_nav
+};
+
+// this must be the first AP_Param variable declared, so its
+// constructor runs before the others
+extern const AP_Param::Info var_info[];
+static AP_Param param_loader(var_info, 4096);
+
+static AP_InertialSensor_Stub ins;
+static GPS *g_gps;
+static AP_GPS_HIL g_gps_driver;
+static AP_AHRS_DCM ahrs(&ins, g_gps);
+static AP_Compass_HIL compass;
+static AP_Baro_HIL barometer;
+static AP_InertialNav inertial_nav(&ahrs, &ins, &barometer, &g_gps);
+
+// the objects are in the parameter table so the PARM messages of the
+// log can set them up as they were in flight
+const AP_Param::Info var_info[] PROGMEM = {
+    { AP_PARAM_GROUP, "INS_",     k_param_ins,          &ins,          { group_info : AP_InertialSensor::var_info } },
+    { AP_PARAM_GROUP, "AHRS_",    k_param_ahrs,         &ahrs,         { group_info : AP_AHRS::var_info } },
+    { AP_PARAM_GROUP, "COMPASS_", k_param_compass,      &compass,      { group_info : Compass::var_info } },
+    { AP_PARAM_GROUP, "GND_",     k_param_barometer,    &barometer,    { group_info : AP_Baro::var_info } },
+    { AP_PARAM_GROUP, "INAV_",    k_param_inertial_nav, &inertial_nav, { group_info : AP_InertialNav::var_info } },
+    AP_VAREND
+};
+
+static LogReader reader;
+
+static bool have_position;
+static uint32_t imu_count;
+static uint32_t att_count;
+static float roll_err_sq, pitch_err_sq, yaw_err_sq;
+static uint64_t ahrs_usec, inav_usec;
+static uint64_t flight_usec;
+static uint32_t last_imu_us;
+static bool have_imu_time;
+
+// the replay runs on a simulated clock, so time it with the host's
+static uint64_t wall_usec(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static void set_parameter(void)
+{
+    char name[AP_MAX_NAME_SIZE+1];
+    float value;
+    enum ap_var_type type;
+
+    if (!reader.get_string("Name", name, sizeof(name)) ||
+        !reader.get_float("Value", value)) {
+        return;
+    }
+    AP_Param *vp = AP_Param::find(name, &type);
+    if (vp == NULL) {
+        // a parameter of the vehicle, not of the estimators
+        return;
+    }
+    switch (type) {
+    case AP_PARAM_INT8:
+        ((AP_Int8 *)vp)->set(value);
+        break;
+    case AP_PARAM_INT16:
+        ((AP_Int16 *)vp)->set(value);
+        break;
+    case AP_PARAM_INT32:
+        ((AP_Int32 *)vp)->set(value);
+        break;
+    case AP_PARAM_FLOAT:
+        ((AP_Float *)vp)->set(value);
+        break;
+    default:
+        break;
+    }
+}
+
+static void replay_imu(void)
+{
+    Vector3f gyro, accel;
+
+    if (!reader.get_float("GyrX", gyro.x) ||
+        !reader.get_float("GyrY", gyro.y) ||
+        !reader.get_float("GyrZ", gyro.z) ||
+        !reader.get_float("AccX", accel.x) ||
+        !reader.get_float("AccY", accel.y) ||
+        !reader.get_float("AccZ", accel.z)) {
+        return;
+    }
+
+    // step the clock by the time since the last IMU message from the
+    // header timestamps, or by the period they were logged at if the
+    // log has none
+    uint32_t step_us = 1000000UL / REPLAY_IMU_RATE_HZ;
+    uint32_t time_us;
+    if (reader.get_time_us(time_us)) {
+        if (have_imu_time && time_us - last_imu_us < 1000000UL) {
+            step_us = time_us - last_imu_us;
+        }
+        last_imu_us = time_us;
+        have_imu_time = true;
+    }
+    hal.scheduler->delay_microseconds(step_us);
+    flight_usec += step_us;
+
+    ins.set_gyro(gyro);
+    ins.set_accel(accel);
+
+    uint64_t t0 = wall_usec();
+    ahrs.update();
+    uint64_t t1 = wall_usec();
+    inertial_nav.update(ins.get_delta_time());
+    inav_usec += wall_usec() - t1;
+    ahrs_usec += t1 - t0;
+    imu_count++;
+}
+
+static void replay_gps(void)
+{
+    int32_t status, gps_time, num_sats, lat, lng, alt, spd, gcrs;
+
+    if (!reader.get_int32("Status", status) ||
+        !reader.get_int32("Time", gps_time) ||
+        !reader.get_int32("NSats", num_sats) ||
+        !reader.get_int32("Lat", lat) ||
+        !reader.get_int32("Lng", lng) ||
+        !reader.get_int32("Alt", alt) ||
+        !reader.get_int32("Spd", spd) ||
+        !reader.get_int32("GCrs", gcrs)) {
+        return;
+    }
+    if (status < GPS::GPS_OK_FIX_2D) {
+        return;
+    }
+    g_gps_driver.setHIL(gps_time, lat*1.0e-7f, lng*1.0e-7f, alt*0.01f,
+                        spd*0.01f, gcrs*0.01f, 0, num_sats);
+    // setHIL() goes through float degrees, which costs decimeters
+    g_gps_driver.latitude = lat;
+    g_gps_driver.longitude = lng;
+    g_gps->update();
+
+    if (!have_position) {
+        // as ArduCopter does when it sets home
+        inertial_nav.set_current_position(lng, lat);
+        have_position = true;
+    }
+}
+
+static void replay_baro(void)
+{
+    float bar_alt;
+    if (reader.get_float("BarAlt", bar_alt)) {
+        // in cm above the ground pressure, which setup() puts at 0
+        barometer.setHIL(bar_alt * 0.01f);
+        barometer.read();
+    }
+}
+
+static void replay_compass(void)
+{
+    int32_t mag_x, mag_y, mag_z, ofs_x, ofs_y, ofs_z;
+    if (!reader.get_int32("MagX", mag_x) ||
+        !reader.get_int32("MagY", mag_y) ||
+        !reader.get_int32("MagZ", mag_z) ||
+        !reader.get_int32("OfsX", ofs_x) ||
+        !reader.get_int32("OfsY", ofs_y) ||
+        !reader.get_int32("OfsZ", ofs_z)) {
+        return;
+    }
+    // the logged field has the offsets and motor compensation in it,
+    // and read() adds the offsets back
+    compass.setHIL(Vector3f(mag_x - ofs_x, mag_y - ofs_y, mag_z - ofs_z));
+    compass.read();
+}
+
+static void check_attitude(void)
+{
+    int32_t roll, pitch, yaw;
+    if (!reader.get_int32("Roll", roll) ||
+        !reader.get_int32("Pitch", pitch) ||
+        !reader.get_int32("Yaw", yaw)) {
+        return;
+    }
+    float roll_err = (ahrs.roll_sensor - roll) * 0.01f;
+    float pitch_err = (ahrs.pitch_sensor - pitch) * 0.01f;
+    float yaw_err = wrap_180_cd(ahrs.yaw_sensor - yaw) * 0.01f;
+    roll_err_sq += roll_err * roll_err;
+    pitch_err_sq += pitch_err * pitch_err;
+    yaw_err_sq += yaw_err * yaw_err;
+    att_count++;
+}
+
+static void replay_message(void)
+{
+    const char *name = reader.msg_name();
+
+    if (strcmp(name, "IMU") == 0) {
+        replay_imu();
+    } else if (strcmp(name, "GPS") == 0) {
+        replay_gps();
+    } else if (strcmp(name, "CTUN") == 0) {
+        replay_baro();
+    } else if (strcmp(name, "MAG") == 0) {
+        replay_compass();
+    } else if (strcmp(name, "ATT") == 0) {
+        check_attitude();
+    } else if (strcmp(name, "PARM") == 0) {
+        set_parameter();
+    }
+}
+
+void setup()
+{
+    const char *filename = getenv("REPLAY_LOG");
+    if (filename == NULL) {
+        filename = "log.bin";
+    }
+
+    hal.console->printf_P(PSTR("Replaying %s\n"), filename);
+
+    if (!reader.open_log(filename)) {
+        hal.console->printf_P(PSTR("Unable to open %s\n"), filename);
+        hal.uartA->flush();
+        exit(1);
+    }
+
+    AP_Param::setup_sketch_defaults();
+
+    // the parameters come first in the log. Apply them before the
+    // sensors start so they see the settings of the flight
+    while (reader.next_message() && strcmp(reader.msg_name(), "PARM") == 0) {
+        set_parameter();
+    }
+
+    ins.init(AP_InertialSensor::WARM_START, AP_InertialSensor::RATE_100HZ, NULL);
+    ahrs.init();
+    compass.init();
+    ahrs.set_compass(&compass);
+    g_gps = &g_gps_driver;
+    g_gps->init(NULL);
+    barometer.init();
+
+    // BarAlt is logged relative to the ground, so put the ground
+    // pressure at an altitude of 0
+    barometer.setHIL(0);
+    barometer.read();
+    enum ap_var_type type;
+    AP_Float *ground_pressure = (AP_Float *)AP_Param::find("GND_ABS_PRESS", &type);
+    AP_Float *ground_temperature = (AP_Float *)AP_Param::find("GND_TEMP", &type);
+    if (ground_pressure != NULL && ground_temperature != NULL) {
+        ground_pressure->set(barometer.get_pressure());
+        ground_temperature->set(barometer.get_temperature());
+    }
+
+    inertial_nav.init();
+}
+
+void loop()
+{
+    uint64_t start_usec = wall_usec();
+
+    // the first message after the parameters has already been read
+    do {
+        replay_message();
+    } while (reader.next_message());
+
+    uint64_t total_usec = wall_usec() - start_usec;
+
+    hal.console->printf_P(PSTR("%lu IMU samples, %.1fs of flight in %.3fs\n"),
+                          (unsigned long)imu_count,
+                          flight_usec * 1.0e-6f,
+                          total_usec * 1.0e-6f);
+    if (imu_count != 0) {
+        hal.console->printf_P(PSTR("ahrs.update %.2fus inertial_nav.update %.2fus\n"),
+                              ahrs_usec / (float)imu_count,
+                              inav_usec / (float)imu_count);
+    }
+    if (att_count != 0) {
+        hal.console->printf_P(PSTR("attitude RMS error against the log: roll %.2f pitch %.2f yaw %.2f degrees\n"),
+                              sqrtf(roll_err_sq / att_count),
+                              sqrtf(pitch_err_sq / att_count),
+                              sqrtf(yaw_err_sq / att_count));
+    }
+    hal.console->printf_P(PSTR("final position %.2f %.2f alt %.2fm\n"),
+                          inertial_nav.get_latitude_diff(),
+                          inertial_nav.get_longitude_diff(),
+                          inertial_nav.get_altitude() * 0.01f);
+    // the console is on uartA, which is buffered, so send the results
+    // before exiting
+    hal.uartA->flush();
+    exit(0);
+}
+
+AP_HAL_MAIN();
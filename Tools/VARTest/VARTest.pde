@@ -39,6 +39,7 @@
 #include <AP_Mount.h>           // Camera/Antenna mount
 #include <AP_Declination.h> // ArduPilot Mega Declination Helper Library
 #include <DataFlash.h>
+#include <AP_Scheduler.h>
 #include <SITL.h>
 
 #include "config.h"
@@ -158,7 +158,7 @@ parser.add_option("--timeout", default=3000, type='int', help='maximum runtime i
 
 opts, args = parser.parse_args()
 
-import  arducopter, arduplane, apmrover2
+import  arducopter, arduplane, apmrover2, perf_gate
 
 steps = [
     'prerequesites',
@@ -188,6 +188,8 @@ steps = [
     'fly.CopterAVC',
     'logs.CopterAVC',
 
+    'perf.gate',
+
     'convertgpx',
     ]
 
@@ -268,6 +270,9 @@ def run_step(step):
     if step == 'drive.APMrover2':
         return apmrover2.drive_APMrover2(viewerip=opts.viewerip, map=opts.map)
 
+    if step == 'perf.gate':
+        return perf_gate.run_gate(perf_gate.default_options())
+
     if step == 'build.All':
         return build_all()
 
@@ -0,0 +1,246 @@
+#!/usr/bin/env python
+# batch Monte-Carlo runs of ArduCopter in lockstep SITL
+#
+# Each run starts a headless SITL instance with the built in copter
+# model, loads ArduCopter.parm plus a random draw of the swept
+# parameters, flies a mission and records how well it went. Runs go
+# in parallel on separate instance ports, and the results are written
+# as one line per run to a CSV summary.
+#
+# example:
+#   batch_sitl.py --runs=64 --parallel=8 --seed=1 \
+#       --sweep SIM_GYR_RND=0:60 --sweep SIM_WIND_SPD=0,5,10 \
+#       --fault SIM_GPS_DISABLE=1@90 --summary=gyro_wind.csv
+
+import os, sys, time, math, random, csv, traceback
+import optparse, multiprocessing
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.realpath(__file__)), 'pysim'))
+
+# cope with the mavlink package not being installed, and just being a git tree
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.realpath(__file__)), '..', '..', '..', 'mavlink'))
+
+import util
+from common import load_parm_file, set_param, upload_mission, rc_override
+from pymavlink import mavutil
+
+testdir = os.path.dirname(os.path.realpath(__file__))
+
+HOME = '-35.362938,149.165085,584,270'
+
+# PWM of the six positions of the flight mode switch on channel 5, as
+# set up by ArduCopter.parm
+SWITCH_STABILIZE = 1815
+SWITCH_AUTO      = 1555
+
+summary_fields = [ 'run', 'result', 'sim_seconds', 'wall_seconds',
+                   'xtrack_rms', 'xtrack_max', 'alt_error_max',
+                   'fence_breaches', 'load_mean', 'load_max',
+                   'waypoint_reached' ]
+
+
+def parse_sweep(sweeps):
+    '''parse NAME=MIN:MAX and NAME=A,B,C sweep specifications'''
+    ret = []
+    for s in sweeps:
+        (name, spec) = s.split('=', 1)
+        if ':' in spec:
+            (vmin, vmax) = spec.split(':')
+            ret.append((name, 'range', (float(vmin), float(vmax))))
+        else:
+            ret.append((name, 'choice', [float(v) for v in spec.split(',')]))
+    return ret
+
+
+def parse_faults(faults):
+    '''parse NAME=VALUE@SECONDS fault specifications'''
+    ret = []
+    for f in faults:
+        (setting, t) = f.split('@')
+        (name, value) = setting.split('=')
+        ret.append((float(t), name, float(value)))
+    ret.sort()
+    return ret
+
+
+def draw_params(sweep, rng):
+    '''draw one set of parameters from the sweep'''
+    params = {}
+    for (name, kind, spec) in sweep:
+        if kind == 'range':
+            params[name] = rng.uniform(spec[0], spec[1])
+        else:
+            params[name] = rng.choice(spec)
+    return params
+
+
+def fly_run(run, instance, opts, params, faults):
+    '''fly one run, returning a dictionary of metrics'''
+    ret = { 'run' : run, 'result' : 'FAIL', 'waypoint_reached' : 0 }
+    wall_start = time.time()
+    logfile = open(os.path.join(opts.dir, 'run%04u.log' % run), 'w')
+
+    os.chdir(opts.dir)
+    sil = util.start_SIL('ArduCopter', wipe=True, height=584,
+                         lockstep_rate=opts.rate if not opts.realtime else None,
+                         instance=instance, model=opts.frame, home=HOME,
+                         logfile=logfile)
+    try:
+        mav = mavutil.mavlink_connection('tcp:127.0.0.1:%u' % (5760 + 10*instance),
+                                         robust_parsing=True)
+        mav.wait_heartbeat()
+        mav.mav.request_data_stream_send(mav.target_system, mav.target_component,
+                                         mavutil.mavlink.MAV_DATA_STREAM_ALL, opts.streamrate, 1)
+
+        for (name, value) in params.items():
+            if not set_param(mav, name, value):
+                ret['result'] = 'PARAM %s' % name
+                return ret
+
+        num_wp = upload_mission(mav, opts.mission)
+        if num_wp == 0:
+            ret['result'] = 'MISSION'
+            return ret
+
+        # arm in stabilize with throttle down and full right yaw
+        rc = [1500] * 8
+        rc[2] = 1000
+        rc[3] = 2000
+        rc[4] = SWITCH_STABILIZE
+        rc_override(mav, rc)
+        mav.motors_armed_wait()
+        rc[3] = 1500
+        rc[2] = 1500
+        rc[4] = SWITCH_AUTO
+        rc_override(mav, rc)
+
+        xtrack_sum = 0.0
+        xtrack_count = 0
+        xtrack_max = 0.0
+        alt_error_max = 0.0
+        load_sum = 0.0
+        load_count = 0
+        load_max = 0.0
+        breaches = 0
+        start_ms = None
+        now_s = 0
+        pending = faults[:]
+
+        while True:
+            m = mav.recv_match(blocking=True, timeout=30)
+            if m is None:
+                ret['result'] = 'NO DATA'
+                break
+            t = m.get_type()
+            if t == 'ATTITUDE':
+                # the firmware clock, simulated time in lockstep
+                if start_ms is None:
+                    start_ms = m.time_boot_ms
+                now_s = (m.time_boot_ms - start_ms) * 0.001
+                while pending and pending[0][0] <= now_s:
+                    (ft, name, value) = pending.pop(0)
+                    set_param(mav, name, value)
+                if now_s > opts.timeout:
+                    ret['result'] = 'TIMEOUT'
+                    break
+            elif t == 'NAV_CONTROLLER_OUTPUT':
+                xtrack_sum += m.xtrack_error**2
+                xtrack_count += 1
+                xtrack_max = max(xtrack_max, abs(m.xtrack_error))
+                alt_error_max = max(alt_error_max, abs(m.alt_error))
+            elif t == 'SYS_STATUS':
+                # in 0.1% units
+                load_sum += m.load * 0.1
+                load_count += 1
+                load_max = max(load_max, m.load * 0.1)
+            elif t == 'FENCE_STATUS':
+                breaches = max(breaches, m.breach_count)
+            elif t == 'MISSION_CURRENT':
+                ret['waypoint_reached'] = max(ret['waypoint_reached'], m.seq)
+            elif t == 'HEARTBEAT' and m.type != mavutil.mavlink.MAV_TYPE_GCS:
+                if not (m.base_mode & mavutil.mavlink.MAV_MODE_FLAG_SAFETY_ARMED):
+                    # landed and disarmed at the end of the mission
+                    ret['result'] = 'OK' if ret['waypoint_reached'] >= num_wp-1 else 'DISARMED'
+                    break
+
+        ret['sim_seconds'] = '%.1f' % now_s
+        if xtrack_count:
+            ret['xtrack_rms'] = '%.2f' % math.sqrt(xtrack_sum / xtrack_count)
+        ret['xtrack_max'] = '%.2f' % xtrack_max
+        ret['alt_error_max'] = '%.2f' % alt_error_max
+        ret['fence_breaches'] = breaches
+        if load_count:
+            ret['load_mean'] = '%.1f' % (load_sum / load_count)
+        ret['load_max'] = '%.1f' % load_max
+    except Exception, msg:
+        traceback.print_exc(file=logfile)
+        ret['result'] = 'EXCEPTION'
+    finally:
+        util.pexpect_close(sil)
+        ret['wall_seconds'] = '%.1f' % (time.time() - wall_start)
+        logfile.close()
+    return ret
+
+
+def worker(args):
+    (run, opts, params, faults) = args
+    # each pool process keeps to its own instance, so ports and
+    # eeprom files never clash
+    instance = multiprocessing.current_process()._identity[0]
+    ret = fly_run(run, instance, opts, params, faults)
+    ret.update(params)
+    print("run %u: %s" % (run, ret['result']))
+    return ret
+
+
+parser = optparse.OptionParser("batch_sitl.py [options]")
+parser.add_option("--runs", type='int', default=16, help="number of runs")
+parser.add_option("--parallel", type='int', default=multiprocessing.cpu_count(), help="runs at a time")
+parser.add_option("--seed", type='int', default=0, help="random seed for the parameter draws")
+parser.add_option("--sweep", action='append', default=[], help="NAME=MIN:MAX or NAME=A,B,C, drawn per run")
+parser.add_option("--fault", action='append', default=[], help="NAME=VALUE@SECONDS, set that many simulated seconds into the mission")
+parser.add_option("--param", action='append', default=[], help="NAME=VALUE, set for every run")
+parser.add_option("--mission", default=os.path.join(testdir, 'copter_mission.txt'), help="mission to fly")
+parser.add_option("--frame", default='+', help="copter frame for the built in model")
+parser.add_option("--rate", type='int', default=400, help="lockstep frame rate")
+parser.add_option("--streamrate", type='int', default=5, help="MAVLink stream rate")
+parser.add_option("--timeout", type='int', default=600, help="simulated seconds before a run is abandoned")
+parser.add_option("--realtime", action='store_true', default=False, help="run in realtime instead of lockstep, so load figures are meaningful")
+parser.add_option("--dir", default=util.reltopdir('../buildlogs/batch'), help="directory for instances and logs")
+parser.add_option("--summary", default='batch_summary.csv', help="CSV summary file, in --dir")
+
+(opts, args) = parser.parse_args()
+
+# the runs change into it, so it must not be relative
+opts.dir = os.path.abspath(opts.dir)
+util.mkdir_p(opts.dir)
+
+base_params = load_parm_file(os.path.join(testdir, 'ArduCopter.parm'))
+for p in opts.param:
+    (name, value) = p.split('=')
+    base_params[name] = float(value)
+
+sweep = parse_sweep(opts.sweep)
+faults = parse_faults(opts.fault)
+rng = random.Random(opts.seed)
+
+jobs = []
+for run in range(opts.runs):
+    params = base_params.copy()
+    draw = draw_params(sweep, rng)
+    params.update(draw)
+    jobs.append((run, opts, params, faults))
+
+pool = multiprocessing.Pool(opts.parallel)
+results = pool.map(worker, jobs, chunksize=1)
+
+sweep_names = [s[0] for s in sweep]
+f = open(os.path.join(opts.dir, opts.summary), 'w')
+w = csv.DictWriter(f, summary_fields + sweep_names, extrasaction='ignore')
+w.writerow(dict(zip(summary_fields + sweep_names, summary_fields + sweep_names)))
+for r in results:
+    w.writerow(r)
+f.close()
+
+ok = len([r for r in results if r['result'] == 'OK'])
+print("%u/%u runs OK, summary in %s" % (ok, len(results), os.path.join(opts.dir, opts.summary)))
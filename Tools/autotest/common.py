@@ -1,5 +1,5 @@
 import util, pexpect, time, math
-from pymavlink import mavwp
+from pymavlink import mavwp, mavutil
 
 # a list of pexpect objects to read while waiting for
 # messages. This keeps the output to stdout flowing
@@ -223,3 +223,45 @@ def mission_count(filename):
     wploader.load(filename)
     num_wp = wploader.count()
     return num_wp
+
+def load_parm_file(filename):
+    '''read a .parm file into a dictionary'''
+    params = {}
+    for line in open(filename):
+        line = line.split('#')[0].strip()
+        if not line:
+            continue
+        a = line.split()
+        params[a[0]] = float(a[1])
+    return params
+
+def set_param(mav, name, value, retries=3):
+    '''set a parameter and wait for it to be echoed back'''
+    for i in range(retries):
+        mav.mav.param_set_send(mav.target_system, mav.target_component, name, value,
+                               mavutil.mavlink.MAV_PARAM_TYPE_REAL32)
+        m = mav.recv_match(type='PARAM_VALUE', blocking=True, timeout=5)
+        while m is not None and m.param_id.rstrip('\x00') != name:
+            m = mav.recv_match(type='PARAM_VALUE', blocking=True, timeout=5)
+        if m is not None:
+            return True
+    return False
+
+def upload_mission(mav, filename):
+    '''upload a mission with the MISSION_COUNT/MISSION_REQUEST handshake'''
+    wploader = mavwp.MAVWPLoader()
+    wploader.load(filename)
+    mav.mav.mission_count_send(mav.target_system, mav.target_component, wploader.count())
+    while True:
+        m = mav.recv_match(type=['MISSION_REQUEST', 'MISSION_ACK'], blocking=True, timeout=10)
+        if m is None:
+            return 0
+        if m.get_type() == 'MISSION_ACK':
+            return wploader.count()
+        wp = wploader.wp(m.seq)
+        wp.target_system = mav.target_system
+        wp.target_component = mav.target_component
+        mav.mav.send(wp)
+
+def rc_override(mav, rc):
+    mav.mav.rc_channels_override_send(mav.target_system, mav.target_component, *rc)
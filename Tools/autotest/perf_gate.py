@@ -0,0 +1,284 @@
+#!/usr/bin/env python
+# performance gate: fly a set of SITL scenarios in parallel, and compare
+# how they went against stored baselines
+#
+# Each scenario is a vehicle, a built in simulator model and a mission.
+# They run at the same time on separate instance ports, in lockstep, so
+# the simulated clock only moves as fast as the firmware gets through
+# its loops and the results don't depend on the load of the machine.
+# For each one the time to complete the mission, the wall clock cost of
+# a main loop and the tracking error are recorded.
+#
+# The baselines are kept in perf_baseline.json, and a scenario is
+# flagged when a figure is worse than its baseline by more than the
+# tolerance for it. Make new baselines with --save-baseline once a
+# change is known to be good.
+#
+# ArduPlane has no built in simulator model, so it is not covered.
+#
+# example:
+#   perf_gate.py --parallel=4
+#   perf_gate.py --scenario=copter-* --save-baseline
+
+import os, sys, time, math, json, fnmatch, traceback
+import optparse, multiprocessing
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.realpath(__file__)), 'pysim'))
+
+# cope with the mavlink package not being installed, and just being a git tree
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.realpath(__file__)), '..', '..', '..', 'mavlink'))
+
+import util
+from common import load_parm_file, set_param, upload_mission, rc_override
+from pymavlink import mavutil
+
+testdir = os.path.dirname(os.path.realpath(__file__))
+
+COPTER_HOME = '-35.362938,149.165085,584,270'
+ROVER_HOME  = '40.071374969556928,-105.22978898137808,1583.702759,246'
+
+# PWM of flight mode switch positions
+SWITCH_STABILIZE = 1815
+SWITCH_AUTO      = 1555
+
+# the rover's HOLD mode, which it goes into at the end of a mission
+ROVER_MODE_HOLD = 4
+
+
+class Scenario(object):
+    '''a vehicle flying a mission on a built in model'''
+    def __init__(self, name, atype, model, home, parm, mission,
+                 mode_channel, loop_rate, params={}):
+        self.name = name
+        self.atype = atype
+        self.model = model
+        self.home = home
+        self.parm = parm
+        self.mission = mission
+        self.mode_channel = mode_channel
+        self.loop_rate = loop_rate
+        self.params = params
+
+scenarios = [
+    Scenario('copter-quad',  'ArduCopter', '+',          COPTER_HOME, 'ArduCopter.parm', 'copter_mission.txt', 5, 100),
+    Scenario('copter-x',     'ArduCopter', 'x',          COPTER_HOME, 'ArduCopter.parm', 'copter_mission.txt', 5, 100,
+             { 'FRAME' : 1 }),
+    Scenario('copter-hexa',  'ArduCopter', 'hexa',       COPTER_HOME, 'ArduCopter.parm', 'copter_mission.txt', 5, 100),
+    Scenario('rover',        'APMrover2',  'rover',      ROVER_HOME,  'Rover.parm',      'rover1.txt',         8, 50),
+    Scenario('rover-skid',   'APMrover2',  'rover-skid', ROVER_HOME,  'Rover.parm',      'rover1.txt',         8, 50,
+             { 'SKID_STEER_OUT' : 1 }),
+    ]
+
+# the figures compared against the baseline, all of them worse when
+# higher: a regression is more than the baseline times (1 + relative)
+# plus absolute
+tolerances = {
+    'sim_seconds'   : (0.10, 5.0),
+    'loop_us'       : (0.25, 10.0),
+    'xtrack_rms'    : (0.25, 0.2),
+    'xtrack_max'    : (0.25, 0.5),
+    'alt_error_max' : (0.25, 0.5),
+    }
+
+def fly_scenario(s, instance, opts):
+    '''fly one scenario, returning a dictionary of figures'''
+    ret = { 'scenario' : s.name, 'result' : 'FAIL', 'waypoint_reached' : 0 }
+    wall_start = time.time()
+    logfile = open(os.path.join(opts.dir, '%s.log' % s.name), 'w')
+
+    os.chdir(opts.dir)
+    sil = util.start_SIL(s.atype, wipe=True, height=float(s.home.split(',')[2]),
+                         lockstep_rate=opts.rate, instance=instance,
+                         model=s.model, home=s.home, logfile=logfile)
+    try:
+        mav = mavutil.mavlink_connection('tcp:127.0.0.1:%u' % (5760 + 10*instance),
+                                         robust_parsing=True)
+        mav.wait_heartbeat()
+        mav.mav.request_data_stream_send(mav.target_system, mav.target_component,
+                                         mavutil.mavlink.MAV_DATA_STREAM_ALL, opts.streamrate, 1)
+
+        params = load_parm_file(os.path.join(testdir, s.parm))
+        params.update(s.params)
+        for (name, value) in params.items():
+            if not set_param(mav, name, value):
+                ret['result'] = 'PARAM %s' % name
+                return ret
+
+        num_wp = upload_mission(mav, os.path.join(testdir, s.mission))
+        if num_wp == 0:
+            ret['result'] = 'MISSION'
+            return ret
+
+        rc = [1500] * 8
+        if s.atype == 'ArduCopter':
+            # arm in stabilize with throttle down and full right yaw
+            rc[2] = 1000
+            rc[3] = 2000
+            rc[s.mode_channel-1] = SWITCH_STABILIZE
+            rc_override(mav, rc)
+            mav.motors_armed_wait()
+            rc[3] = 1500
+            rc[2] = 1500
+        rc[s.mode_channel-1] = SWITCH_AUTO
+        rc_override(mav, rc)
+
+        xtrack_sum = 0.0
+        xtrack_count = 0
+        xtrack_max = 0.0
+        alt_error_max = 0.0
+        start_ms = None
+        sim_start_wall = None
+        now_s = 0
+        auto_seen = False
+
+        while True:
+            m = mav.recv_match(blocking=True, timeout=30)
+            if m is None:
+                ret['result'] = 'NO DATA'
+                break
+            t = m.get_type()
+            if t == 'ATTITUDE':
+                # the firmware clock, simulated time in lockstep
+                if start_ms is None:
+                    start_ms = m.time_boot_ms
+                    sim_start_wall = time.time()
+                now_s = (m.time_boot_ms - start_ms) * 0.001
+                if now_s > opts.timeout:
+                    ret['result'] = 'TIMEOUT'
+                    break
+            elif t == 'NAV_CONTROLLER_OUTPUT':
+                xtrack_sum += m.xtrack_error**2
+                xtrack_count += 1
+                xtrack_max = max(xtrack_max, abs(m.xtrack_error))
+                alt_error_max = max(alt_error_max, abs(m.alt_error))
+            elif t == 'MISSION_CURRENT':
+                ret['waypoint_reached'] = max(ret['waypoint_reached'], m.seq)
+            elif t == 'HEARTBEAT' and m.type != mavutil.mavlink.MAV_TYPE_GCS:
+                if s.atype == 'ArduCopter':
+                    if not (m.base_mode & mavutil.mavlink.MAV_MODE_FLAG_SAFETY_ARMED):
+                        # landed and disarmed at the end of the mission
+                        break
+                elif m.custom_mode == ROVER_MODE_HOLD:
+                    if auto_seen:
+                        # holding at the end of the mission
+                        break
+                else:
+                    auto_seen = True
+
+        if ret['result'] == 'FAIL':
+            ret['result'] = 'OK' if ret['waypoint_reached'] >= num_wp-1 else 'INCOMPLETE'
+        ret['sim_seconds'] = '%.1f' % now_s
+        if sim_start_wall is not None and now_s > 0:
+            # the wall clock time of each main loop, as the lockstep
+            # simulation runs as fast as the firmware allows
+            loops = now_s * s.loop_rate
+            ret['loop_us'] = '%.1f' % ((time.time() - sim_start_wall) * 1.0e6 / loops)
+        if xtrack_count:
+            ret['xtrack_rms'] = '%.2f' % math.sqrt(xtrack_sum / xtrack_count)
+        ret['xtrack_max'] = '%.2f' % xtrack_max
+        ret['alt_error_max'] = '%.2f' % alt_error_max
+    except Exception, msg:
+        traceback.print_exc(file=logfile)
+        ret['result'] = 'EXCEPTION'
+    finally:
+        util.pexpect_close(sil)
+        ret['wall_seconds'] = '%.1f' % (time.time() - wall_start)
+        logfile.close()
+    return ret
+
+
+def worker(args):
+    (s, opts) = args
+    # each pool process keeps to its own instance, so ports and
+    # eeprom files never clash
+    instance = multiprocessing.current_process()._identity[0]
+    ret = fly_scenario(s, instance, opts)
+    print("%s: %s in %s simulated seconds" % (s.name, ret['result'], ret.get('sim_seconds', '-')))
+    return ret
+
+
+def compare(result, baseline):
+    '''the figures of a result that are worse than its baseline'''
+    regressions = []
+    for (name, (relative, absolute)) in tolerances.items():
+        if name not in result or name not in baseline:
+            continue
+        limit = float(baseline[name]) * (1 + relative) + absolute
+        if float(result[name]) > limit:
+            regressions.append('%s %s > %.2f (baseline %s)' % (name, result[name], limit, baseline[name]))
+    return regressions
+
+
+def run_gate(opts):
+    '''fly the chosen scenarios and check them. Returns True if they all
+    completed without a regression'''
+    opts.dir = os.path.abspath(opts.dir)
+    util.mkdir_p(opts.dir)
+
+    chosen = [s for s in scenarios if fnmatch.fnmatch(s.name, opts.scenario)]
+    pool = multiprocessing.Pool(min(opts.parallel, len(chosen)))
+    results = pool.map(worker, [(s, opts) for s in chosen], chunksize=1)
+    pool.close()
+
+    baselines = {}
+    if os.path.exists(opts.baseline):
+        baselines = json.load(open(opts.baseline))
+
+    ok = True
+    for r in results:
+        if r['result'] != 'OK':
+            print("FAILED %s: %s" % (r['scenario'], r['result']))
+            ok = False
+            continue
+        if r['scenario'] not in baselines:
+            print("%s: no baseline" % r['scenario'])
+            continue
+        regressions = compare(r, baselines[r['scenario']])
+        for reg in regressions:
+            print("REGRESSION %s: %s" % (r['scenario'], reg))
+        if regressions:
+            ok = False
+
+    f = open(os.path.join(opts.dir, opts.summary), 'w')
+    json.dump(results, f, indent=4, sort_keys=True)
+    f.close()
+
+    if opts.save_baseline:
+        for r in results:
+            if r['result'] == 'OK':
+                baselines[r['scenario']] = dict([(k, r[k]) for k in tolerances.keys() if k in r])
+        f = open(opts.baseline, 'w')
+        json.dump(baselines, f, indent=4, sort_keys=True)
+        f.write('\n')
+        f.close()
+        print("Saved baselines in %s" % opts.baseline)
+
+    return ok
+
+
+def default_options():
+    '''the options as the command line leaves them, for autotest'''
+    (opts, args) = parser.parse_args([])
+    return opts
+
+
+parser = optparse.OptionParser("perf_gate.py [options]")
+parser.add_option("--scenario", default='*', help="scenarios to fly, as a wildcard")
+parser.add_option("--list", action='store_true', default=False, help="list the scenarios")
+parser.add_option("--parallel", type='int', default=multiprocessing.cpu_count(), help="scenarios at a time")
+parser.add_option("--rate", type='int', default=400, help="lockstep frame rate")
+parser.add_option("--streamrate", type='int', default=5, help="MAVLink stream rate")
+parser.add_option("--timeout", type='int', default=900, help="simulated seconds before a scenario is abandoned")
+parser.add_option("--baseline", default=os.path.join(testdir, 'perf_baseline.json'), help="baseline file")
+parser.add_option("--save-baseline", action='store_true', default=False, help="store the figures of the scenarios that completed as their baselines")
+parser.add_option("--dir", default=util.reltopdir('../buildlogs/perf'), help="directory for instances and logs")
+parser.add_option("--summary", default='perf_summary.json', help="summary file, in --dir")
+
+if __name__ == '__main__':
+    (opts, args) = parser.parse_args()
+    if opts.list:
+        for s in scenarios:
+            print(s.name)
+        sys.exit(0)
+    if not run_gate(opts):
+        sys.exit(1)
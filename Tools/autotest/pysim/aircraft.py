@@ -1,4 +1,4 @@
-import math, util, rotmat
+import math, util, rotmat, time
 from rotmat import Vector3, Matrix3
 
 class Aircraft(object):
@@ -28,6 +28,16 @@ class Aircraft(object):
 
         self.wind = util.Wind('0,0,0')
 
+        # in lockstep mode the caller steps this clock, otherwise
+        # the models follow the wall clock
+        self.time_now = None
+
+    def get_time(self):
+        '''return the current time in seconds'''
+        if self.time_now is not None:
+            return self.time_now
+        return time.time()
+
     def on_ground(self, position=None):
         '''return true if we are on the ground'''
         if position is None:
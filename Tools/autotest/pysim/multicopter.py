@@ -106,7 +106,7 @@ class MultiCopter(Aircraft):
         m = self.motor_speed
 
         # how much time has passed?
-        t = time.time()
+        t = self.get_time()
         delta_time = t - self.last_time
         self.last_time = t
 
@@ -76,7 +76,7 @@ class Rover(Aircraft):
             throttle = state.throttle
 
         # how much time has passed?
-        t = time.time()
+        t = self.get_time()
         delta_time = t - self.last_time
         self.last_time = t
 
@@ -80,6 +80,14 @@ def sim_recv(m):
     
 
 
+def sim_wait(m):
+    '''wait for control information from SITL, using the latest if
+    several have arrived'''
+    select.select([sim_in], [], [])
+    while select.select([sim_in], [], [], 0)[0]:
+        sim_recv(m)
+
+
 def interpret_address(addrstr):
     '''interpret a IP:port string'''
     a = addrstr.split(':')
@@ -97,6 +105,7 @@ parser.add_option("--home", dest="home",  type='string', default=None, help="hom
 parser.add_option("--rate", dest="rate", type='int', help="SIM update rate", default=400)
 parser.add_option("--wind", dest="wind", help="Simulate wind (speed,direction,turbulance)", default='0,0,0')
 parser.add_option("--frame", dest="frame", help="frame type (+,X,octo)", default='+')
+parser.add_option("--lockstep", action='store_true', default=False, help="step once per SITL output, for SITL started with -L at the same rate")
 
 (opts, args) = parser.parse_args()
 
@@ -166,9 +175,18 @@ print("Starting at lat=%f lon=%f alt=%.1f heading=%.1f" % (
 frame_time = 1.0/opts.rate
 sleep_overhead = 0
 
+if opts.lockstep:
+    a.time_now = 0
+    a.last_time = 0
+
 while True:
     frame_start = time.time()
-    sim_recv(m)
+    if opts.lockstep:
+        # one step of the model per frame of SITL, as fast as it goes
+        sim_wait(m)
+        a.time_now += frame_time
+    else:
+        sim_recv(m)
 
     m2 = m[:]
 
@@ -185,7 +203,7 @@ while True:
         lastt = t
         frame_count = 0
     frame_end = time.time()
-    if frame_end - frame_start < frame_time:
+    if not opts.lockstep and frame_end - frame_start < frame_time:
         dt = frame_time - (frame_end - frame_start)
         dt -= sleep_overhead
         if dt > 0:
@@ -55,6 +55,14 @@ def sim_recv(state):
     
 
 
+def sim_wait(state):
+    '''wait for control information from SITL, using the latest if
+    several have arrived'''
+    select.select([sim_in], [], [])
+    while select.select([sim_in], [], [], 0)[0]:
+        sim_recv(state)
+
+
 def interpret_address(addrstr):
     '''interpret a IP:port string'''
     a = addrstr.split(':')
@@ -77,6 +85,7 @@ parser.add_option("--simout", dest="simout",  help="SIM output (IP:port)",
 parser.add_option("--home", dest="home",  type='string', default=None, help="home lat,lng,alt,hdg (required)")
 parser.add_option("--rate", dest="rate", type='int', help="SIM update rate", default=100)
 parser.add_option("--skid-steering", action='store_true', default=False, help="Use skid steering")
+parser.add_option("--lockstep", action='store_true', default=False, help="step once per SITL output, for SITL started with -L at the same rate")
 
 (opts, args) = parser.parse_args()
 
@@ -131,14 +140,23 @@ print("Starting at lat=%f lon=%f alt=%f heading=%.1f" % (
 frame_time = 1.0/opts.rate
 sleep_overhead = 0
 
+if opts.lockstep:
+    a.time_now = 0
+    a.last_time = 0
+
 while True:
     frame_start = time.time()
-    sim_recv(state)
+    if opts.lockstep:
+        # one step of the model per frame of SITL, as fast as it goes
+        sim_wait(state)
+        a.time_now += frame_time
+    else:
+        sim_recv(state)
     a.update(state)
     sim_send(a)
     t = time.time()
     frame_end = time.time()
-    if frame_end - frame_start < frame_time:
+    if not opts.lockstep and frame_end - frame_start < frame_time:
         dt = frame_time - (frame_end - frame_start)
         dt -= sleep_overhead
         if dt > 0:
@@ -116,7 +116,8 @@ def pexpect_drain(p):
     except pexpect.TIMEOUT:
         pass
 
-def start_SIL(atype, valgrind=False, wipe=False, height=None):
+def start_SIL(atype, valgrind=False, wipe=False, height=None, lockstep_rate=None, instance=0,
+              model=None, home=None, logfile=sys.stdout):
     '''launch a SIL instance'''
     import pexpect
     cmd=""
@@ -130,7 +131,19 @@ def start_SIL(atype, valgrind=False, wipe=False, height=None):
         cmd += ' -w'
     if height is not None:
         cmd += ' -H %u' % height
-    ret = pexpect.spawn(cmd, logfile=sys.stdout, timeout=5)
+    if lockstep_rate is not None:
+        # pair with a simulator run with --lockstep --rate=lockstep_rate
+        cmd += ' -L -r %u' % lockstep_rate
+    if instance != 0:
+        # ports offset by 10*instance, pass the simulator
+        # --simin/--simout to match
+        cmd += ' -I %u' % instance
+    if model is not None:
+        # built in simulator, no pysim needed
+        cmd += ' -M %s' % model
+        if home is not None:
+            cmd += ' -O %s' % home
+    ret = pexpect.spawn(cmd, logfile=logfile, timeout=5)
     ret.delaybeforesend = 0
     pexpect_autoclose(ret)
     ret.expect('Waiting for connection')
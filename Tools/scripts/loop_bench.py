@@ -0,0 +1,164 @@
+#!/usr/bin/env python
+
+''' build and run the Tools/LoopBench sketch, or another sketch
+printing BENCH lines such as the AP_Math benchmark example, natively in
+SITL or as an APM2 build under simavr, and keep its results in a CSV
+history so that a slower commit shows up before it flies
+
+example:
+  loop_bench.py --board=apm2
+  loop_bench.py --board=sitl --threshold=10
+  loop_bench.py --sketch=libraries/AP_Math/examples/benchmark
+'''
+
+import sys, os, time, re, select, subprocess, csv
+
+from optparse import OptionParser
+parser = OptionParser("loop_bench.py [options]")
+parser.add_option("--sketch", default='Tools/LoopBench', help="sketch directory, relative to the top of the tree")
+parser.add_option("--board", default='sitl', help="sitl for native timings, apm2 to run under simavr")
+parser.add_option("--passes", type='int', default=5, help="passes over the benchmarks, the fastest is kept")
+parser.add_option("--timeout", type='int', default=600, help="seconds to wait for the passes")
+parser.add_option("--history", default=None, help="CSV history file")
+parser.add_option("--threshold", type='float', default=5, help="percentage slowdown reported as a regression")
+parser.add_option("--no-build", action='store_true', default=False, help="use the existing build")
+
+(opts, args) = parser.parse_args()
+
+topdir = os.path.realpath(os.path.join(os.path.dirname(os.path.realpath(__file__)), '..', '..'))
+sketchdir = os.path.join(topdir, opts.sketch)
+sketch = os.path.basename(os.path.normpath(sketchdir))
+elf = '/tmp/%s.build/%s.elf' % (sketch, sketch)
+
+# the APM2 runs at 16MHz, so its times are cycle counts
+CPU_MHZ = { 'apm2' : 16 }
+
+if opts.history is None:
+    opts.history = os.path.join(topdir, '..', 'buildlogs', 'bench_%s.csv' % sketch)
+
+history_fields = [ 'commit', 'date', 'board', 'name', 'ns_per_call', 'cycles_per_call' ]
+
+bench_line = re.compile(r"BENCH (\w+) (\d+) (\d+) ([\d.]+)")
+
+
+def git_commit():
+    '''short hash of HEAD, marked if the tree has changes'''
+    try:
+        rev = subprocess.check_output(['git', 'rev-parse', '--short', 'HEAD'], cwd=topdir).strip()
+        if subprocess.call(['git', 'diff', '--quiet', 'HEAD'], cwd=topdir) != 0:
+            rev += '-dirty'
+        return rev
+    except Exception:
+        return 'unknown'
+
+
+def build():
+    target = opts.board
+    print("Building %s for %s" % (sketch, target))
+    if subprocess.call(['make', target], cwd=sketchdir) != 0:
+        print("Build failed")
+        sys.exit(1)
+
+
+def run():
+    '''run the benchmarks, returning the fastest ns per call of each'''
+    if opts.board == 'sitl':
+        cmd = [elf, '-C']
+    else:
+        cmd = ['simavr', '-m', 'atmega2560', '-f', '16000000', elf]
+    p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    results = {}
+    passes = 0
+    output = ''
+    tstart = time.time()
+    try:
+        while passes < opts.passes:
+            if time.time() - tstart > opts.timeout:
+                print("Timed out after %u passes" % passes)
+                break
+            (r, w, x) = select.select([p.stdout], [], [], 1)
+            if not r:
+                continue
+            data = os.read(p.stdout.fileno(), 4096)
+            if not data:
+                break
+            output += data
+            lines = output.split('\n')
+            output = lines.pop()
+            for line in lines:
+                if line.find('BENCH DONE') != -1:
+                    passes += 1
+                    continue
+                m = bench_line.search(line)
+                if m is None:
+                    continue
+                name = m.group(1)
+                ns = float(m.group(4))
+                if name not in results or ns < results[name]:
+                    results[name] = ns
+    finally:
+        p.kill()
+        p.wait()
+    return results
+
+
+def load_history():
+    if not os.path.exists(opts.history):
+        return []
+    return list(csv.DictReader(open(opts.history)))
+
+
+def save_history(commit, results):
+    new_file = not os.path.exists(opts.history)
+    d = os.path.dirname(opts.history)
+    if d and not os.path.isdir(d):
+        os.makedirs(d)
+    f = open(opts.history, 'a')
+    w = csv.DictWriter(f, history_fields)
+    if new_file:
+        w.writerow(dict(zip(history_fields, history_fields)))
+    date = time.strftime('%Y-%m-%d %H:%M:%S')
+    for name in sorted(results.keys()):
+        ns = results[name]
+        cycles = ''
+        if opts.board in CPU_MHZ:
+            cycles = '%.0f' % (ns * CPU_MHZ[opts.board] * 0.001)
+        w.writerow({ 'commit' : commit, 'date' : date, 'board' : opts.board, 'name' : name,
+                     'ns_per_call' : '%.1f' % ns, 'cycles_per_call' : cycles })
+    f.close()
+
+
+if not opts.no_build:
+    build()
+
+commit = git_commit()
+results = run()
+if not results:
+    print("No results")
+    sys.exit(1)
+
+# the latest result of an earlier commit for each benchmark
+previous = {}
+for row in load_history():
+    if row['board'] == opts.board and row['commit'] != commit:
+        previous[row['name']] = row
+
+regressions = 0
+print("%-28s %12s %12s %8s" % ('benchmark', 'ns/call', 'previous', 'change'))
+for name in sorted(results.keys()):
+    ns = results[name]
+    line = "%-28s %12.1f" % (name, ns)
+    if name in previous and float(previous[name]['ns_per_call']) > 0:
+        old = float(previous[name]['ns_per_call'])
+        change = 100.0 * (ns - old) / old
+        line += " %12.1f %+7.1f%%" % (old, change)
+        if change > opts.threshold:
+            line += "  REGRESSION since %s" % previous[name]['commit']
+            regressions += 1
+    if opts.board in CPU_MHZ:
+        line += "  %.0f cycles" % (ns * CPU_MHZ[opts.board] * 0.001)
+    print(line)
+
+save_history(commit, results)
+
+sys.exit(1 if regressions else 0)
@@ -0,0 +1,108 @@
+#!/usr/bin/env python
+
+''' a table of the static RAM (.data and .bss) each library of a sketch
+uses, from the linker map file, and what is left of the board's RAM
+for the heap and stack
+
+example:
+  ram_budget.py /tmp/ArduCopter.build/ArduCopter.map
+  ram_budget.py --ram=8192 --top=10 /tmp/ArduPlane.build/ArduPlane.map
+'''
+
+import sys, os, re
+
+from optparse import OptionParser
+parser = OptionParser("ram_budget.py [options] <mapfile>")
+parser.add_option("--ram", type='int', default=8192, help="RAM size of the board in bytes, 0 for none")
+parser.add_option("--top", type='int', default=0, help="only show the largest N entries")
+
+(opts, args) = parser.parse_args()
+
+if len(args) != 1:
+    parser.print_help()
+    sys.exit(1)
+
+mapfile = args[0]
+sketch = os.path.splitext(os.path.basename(mapfile))[0]
+
+# an input section, either on one line or with its address, size and
+# object on the next line when the name is long
+section_re = re.compile(r'^ (\.data|\.bss|\.noinit|COMMON)(\.\S*)?(\s+0x[0-9a-f]+\s+0x([0-9a-f]+)\s+(\S+))?\s*$')
+detail_re = re.compile(r'^\s+0x[0-9a-f]+\s+0x([0-9a-f]+)\s+(\S+)\s*$')
+
+
+def subsystem(obj):
+    '''the library or sketch an object file belongs to'''
+    m = re.search(r'/libraries/([^/]+)/', obj)
+    if m:
+        return m.group(1)
+    name = os.path.basename(obj)
+    m = re.match(r'(.*\.a)\(', name)
+    if m:
+        # a member of a system library
+        return m.group(1)
+    if obj.find('.build/') != -1:
+        # the sketch and the .cpp files in its directory
+        return sketch
+    return name
+
+
+def parse(f):
+    '''sum the sizes of the RAM input sections of each subsystem'''
+    table = {}
+    in_map = False
+    pending = None
+    for line in f:
+        if not in_map:
+            # the discarded input sections come before the memory map
+            if line.startswith('Linker script and memory map'):
+                in_map = True
+            continue
+        if pending is not None:
+            m = detail_re.match(line)
+            if m:
+                add(table, pending, int(m.group(1), 16), m.group(2))
+            pending = None
+            continue
+        m = section_re.match(line)
+        if m is None:
+            continue
+        kind = 'bss' if m.group(1) in ['.bss', 'COMMON', '.noinit'] else 'data'
+        if m.group(3) is None:
+            pending = kind
+        else:
+            add(table, kind, int(m.group(4), 16), m.group(5))
+    return table
+
+
+def add(table, kind, size, obj):
+    if size == 0:
+        return
+    s = subsystem(obj)
+    if s not in table:
+        table[s] = { 'data' : 0, 'bss' : 0 }
+    table[s][kind] += size
+
+
+table = parse(open(mapfile))
+names = sorted(table.keys(), key=lambda s: -(table[s]['data'] + table[s]['bss']))
+total_data = sum([table[s]['data'] for s in names])
+total_bss = sum([table[s]['bss'] for s in names])
+total = total_data + total_bss
+
+print("%-32s %7s %7s %7s %6s" % ('subsystem', 'data', 'bss', 'total', 'share'))
+shown = names
+if opts.top:
+    shown = names[:opts.top]
+for s in shown:
+    t = table[s]['data'] + table[s]['bss']
+    print("%-32s %7u %7u %7u %5.1f%%" % (s, table[s]['data'], table[s]['bss'], t,
+                                        100.0 * t / total if total else 0))
+if len(shown) < len(names):
+    print("%-32s %7s %7s %7u" % ('(%u more)' % (len(names) - len(shown)), '', '',
+                                sum([table[s]['data'] + table[s]['bss'] for s in names[len(shown):]])))
+print("%-32s %7u %7u %7u" % ('total', total_data, total_bss, total))
+if opts.ram:
+    print("%-32s %23d" % ('left for heap and stack of %u' % opts.ram, opts.ram - total))
+    if total > opts.ram:
+        sys.exit(1)
@@ -15,7 +15,7 @@ const AP_Param::GroupInfo AC_Fence::var_info[] PROGMEM = {
     // @Param: TYPE
     // @DisplayName: Fence Type
     // @Description: Enabled fence types held as bitmask
-    // @Values: 0:None,1:Altitude,2:Circle,3:Altitude and Circle
+    // @Values: 0:None,1:Altitude,2:Circle,3:Altitude and Circle,4:Polygon,5:Altitude and Polygon,6:Circle and Polygon,7:All
     // @User: Standard
     AP_GROUPINFO("TYPE",        1,  AC_Fence,   _enabled_fences,  AC_FENCE_TYPE_ALT_MAX | AC_FENCE_TYPE_CIRCLE),
 
@@ -42,6 +42,13 @@ const AP_Param::GroupInfo AC_Fence::var_info[] PROGMEM = {
     // @Range: 0 10000
     // @User: Standard
     AP_GROUPINFO("RADIUS",      4,  AC_Fence,   _circle_radius, AC_FENCE_CIRCLE_RADIUS_DEFAULT),
+
+    // @Param: PREDICT
+    // @DisplayName: Fence breach prediction
+    // @Description: Checks where the vehicle would stop if it braked now against the fences, so the vehicle can brake before it crosses them
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("PREDICT",     5,  AC_Fence,   _predict,       0),
     
     AP_GROUPEND
 };
@@ -53,7 +60,11 @@ AC_Fence::AC_Fence(AP_InertialNav* inav) :
     _circle_radius_backup(0),
     _alt_max_breach_distance(0),
     _circle_breach_distance(0),
+    _polygon_breach_distance(0),
+    _polygon_backup_distance(0),
     _home_distance(0),
+    _stopping_point_valid(false),
+    _pre_breached_fences(AC_FENCE_TYPE_NONE),
     _breached_fences(AC_FENCE_TYPE_NONE),
     _breach_time(0),
     _breach_count(0)
@@ -67,6 +78,10 @@ AC_Fence::AC_Fence(AP_InertialNav* inav) :
     if (_circle_radius < 0) {
         _circle_radius.set_and_save(AC_FENCE_CIRCLE_RADIUS_DEFAULT);
     }
+
+#if AC_FENCE_ZONES_AVAILABLE
+    clear_zones();
+#endif
 }
 
 /// get_enabled_fences - returns bitmask of enabled fences
@@ -93,7 +108,7 @@ bool AC_Fence::pre_arm_check() const
     }
 
     // if we have horizontal limits enabled, check inertial nav position is ok
-    if ((_enabled_fences & AC_FENCE_TYPE_CIRCLE)!=0 && !_inav->position_ok()) {
+    if ((_enabled_fences & (AC_FENCE_TYPE_CIRCLE | AC_FENCE_TYPE_POLYGON))!=0 && !_inav->position_ok()) {
         return false;
     }
 
@@ -172,11 +187,88 @@ uint8_t AC_Fence::check_fence()
         }
     }
 
+#if AC_FENCE_ZONES_AVAILABLE
+    // polygon fence check
+    if ((_enabled_fences & AC_FENCE_TYPE_POLYGON) != 0 && _num_zones > 0) {
+
+        // get current horizontal position in cm from home
+        const Vector3f &curr_pos = _inav->get_position();
+        Vector2l position(curr_pos.x, curr_pos.y);
+        float breach_distance;
+
+        // check if we are outside an inclusion zone or inside an exclusion zone
+        if (check_zones(position, breach_distance)) {
+
+            // record distance into the breached zone
+            _polygon_breach_distance = breach_distance;
+
+            // check for a new breach or a breach of the backup fence
+            if ((_breached_fences & AC_FENCE_TYPE_POLYGON) == 0 || (_polygon_backup_distance != 0 && breach_distance >= _polygon_backup_distance)) {
+
+                // record that we have breached a zone
+                record_breach(AC_FENCE_TYPE_POLYGON);
+                ret = ret | AC_FENCE_TYPE_POLYGON;
+
+                // create a backup fence 20m further on
+                _polygon_backup_distance = breach_distance + AC_FENCE_POLYGON_BACKUP_DISTANCE;
+            }
+        }else{
+            // clear polygon breach if present
+            if ((_breached_fences & AC_FENCE_TYPE_POLYGON) != 0) {
+                clear_breach(AC_FENCE_TYPE_POLYGON);
+                _polygon_backup_distance = 0;
+                _polygon_breach_distance = 0;
+            }
+        }
+    }
+#endif
+
     // return any new breaches that have occurred
     return ret;
 
-    // To-Do: add min alt and polygon check
-    //outside = Polygon_outside(location, &geofence_state->boundary[1], geofence_state->num_points-1);
+    // To-Do: add min alt check
+}
+
+/// check_stopping_point - returns the fence types the vehicle would breach if it braked now but has not yet breached (if any)
+///     only new pre-breaches are returned.  requires PREDICT to be enabled and set_stopping_point to have been called
+uint8_t AC_Fence::check_stopping_point()
+{
+    uint8_t pre_breaches = AC_FENCE_TYPE_NONE;
+
+    // return immediately if disabled
+    if (!_enabled || _enabled_fences == AC_FENCE_TYPE_NONE || !_predict || !_stopping_point_valid) {
+        _pre_breached_fences = AC_FENCE_TYPE_NONE;
+        return AC_FENCE_TYPE_NONE;
+    }
+
+    // altitude fence check
+    if ((_enabled_fences & AC_FENCE_TYPE_ALT_MAX) != 0 && _stopping_point.z * 0.01f >= _alt_max) {
+        pre_breaches |= AC_FENCE_TYPE_ALT_MAX;
+    }
+
+    // circle fence check
+    if ((_enabled_fences & AC_FENCE_TYPE_CIRCLE) != 0 && pythagorous2(_stopping_point.x, _stopping_point.y) * 0.01f >= _circle_radius) {
+        pre_breaches |= AC_FENCE_TYPE_CIRCLE;
+    }
+
+#if AC_FENCE_ZONES_AVAILABLE
+    // polygon fence check using the same zone index as check_fence
+    if ((_enabled_fences & AC_FENCE_TYPE_POLYGON) != 0 && _num_zones > 0) {
+        Vector2l stopping_point(_stopping_point.x, _stopping_point.y);
+        float breach_distance;
+        if (check_zones(stopping_point, breach_distance)) {
+            pre_breaches |= AC_FENCE_TYPE_POLYGON;
+        }
+    }
+#endif
+
+    // fences already breached are dealt with by check_fence
+    pre_breaches &= ~_breached_fences;
+
+    // return only the pre-breaches that are new
+    uint8_t ret = pre_breaches & ~_pre_breached_fences;
+    _pre_breached_fences = pre_breaches;
+    return ret;
 }
 
 /// record_breach - update breach bitmask, time and count
@@ -211,17 +303,199 @@ void AC_Fence::clear_breach(uint8_t fence_type)
 /// get_breach_distance - returns distance in meters outside of the given fence
 float AC_Fence::get_breach_distance(uint8_t fence_type) const
 {
-    switch (fence_type) {
-        case AC_FENCE_TYPE_ALT_MAX:
-            return _alt_max_breach_distance;
-            break;
-        case AC_FENCE_TYPE_CIRCLE:
-            return _circle_breach_distance;
-            break;
-        case AC_FENCE_TYPE_ALT_MAX | AC_FENCE_TYPE_CIRCLE:
-            return max(_alt_max_breach_distance,_circle_breach_distance);
-    }
-
-    // we don't recognise the fence type so just return 0
-    return 0;
-}
\ No newline at end of file
+    // return the largest distance of the given fences.  0 if we don't recognise the fence type
+    float ret = 0;
+
+    if ((fence_type & AC_FENCE_TYPE_ALT_MAX) != 0) {
+        ret = max(ret, _alt_max_breach_distance);
+    }
+    if ((fence_type & AC_FENCE_TYPE_CIRCLE) != 0) {
+        ret = max(ret, _circle_breach_distance);
+    }
+    if ((fence_type & AC_FENCE_TYPE_POLYGON) != 0) {
+        ret = max(ret, _polygon_breach_distance);
+    }
+
+    return ret;
+}
+
+/// shift_origin - move the zones and stopping point by the shift returned when inertial nav's origin was moved
+void AC_Fence::shift_origin(const Vector2f &shift)
+{
+    _stopping_point.x -= shift.x;
+    _stopping_point.y -= shift.y;
+
+#if AC_FENCE_ZONES_AVAILABLE
+    // the zones are held in whole cm
+    int32_t shift_x = shift.x + (shift.x >= 0 ? 0.5f : -0.5f);
+    int32_t shift_y = shift.y + (shift.y >= 0 ? 0.5f : -0.5f);
+    for (uint16_t i=0; i<_num_zone_points; i++) {
+        _zone_points[i].x -= shift_x;
+        _zone_points[i].y -= shift_y;
+    }
+    for (uint8_t i=0; i<_num_zones; i++) {
+        _zones[i].polygon.set(&_zone_points[_zones[i].start], _zones[i].num_points);
+    }
+    build_zone_grid();
+#endif
+}
+
+#if AC_FENCE_ZONES_AVAILABLE
+///
+/// zone store
+///
+
+/// clear_zones - remove all inclusion and exclusion zones
+void AC_Fence::clear_zones()
+{
+    _num_zones = 0;
+    _num_zone_points = 0;
+    _inclusion_zones = 0;
+    build_zone_grid();
+
+    // a breach of a zone we no longer have is cleared by the next check_fence
+}
+
+/// add_zone - add an inclusion or exclusion zone.  points are the polygon's vertices in cm north and east of home (i.e. the inertial nav frame)
+///     the polygon need not be closed.  returns false if the store is full or there are fewer than 3 points
+bool AC_Fence::add_zone(uint8_t zone_type, const Vector2l *points, uint8_t num_points)
+{
+    if (num_points < 3 || _num_zones >= AC_FENCE_ZONES_MAX || _num_zone_points + num_points > AC_FENCE_ZONE_POINTS_MAX) {
+        return false;
+    }
+
+    // copy the vertices into the store
+    Zone &zone = _zones[_num_zones];
+    zone.start = _num_zone_points;
+    zone.num_points = num_points;
+    zone.type = zone_type;
+    for (uint8_t i=0; i<num_points; i++) {
+        _zone_points[_num_zone_points++] = points[i];
+    }
+    zone.polygon.set(&_zone_points[zone.start], num_points);
+
+    if (zone_type == AC_FENCE_ZONE_INCLUSION) {
+        _inclusion_zones |= 1UL << _num_zones;
+    }
+    _num_zones++;
+
+    build_zone_grid();
+    return true;
+}
+
+/// build_zone_grid - rebuild the grid index from the zones' bounding boxes
+void AC_Fence::build_zone_grid()
+{
+    uint8_t i, x, y;
+
+    memset(_grid, 0, sizeof(_grid));
+    if (_num_zones == 0) {
+        return;
+    }
+
+    // the grid covers all the zones' bounding boxes
+    _grid_min = _zones[0].polygon.get_min();
+    Vector2l grid_max = _zones[0].polygon.get_max();
+    for (i=1; i<_num_zones; i++) {
+        const Vector2l &zmin = _zones[i].polygon.get_min();
+        const Vector2l &zmax = _zones[i].polygon.get_max();
+        _grid_min.x = min(_grid_min.x, zmin.x);
+        _grid_min.y = min(_grid_min.y, zmin.y);
+        grid_max.x = max(grid_max.x, zmax.x);
+        grid_max.y = max(grid_max.y, zmax.y);
+    }
+
+    // round the cell size up so the last cell reaches grid_max
+    _grid_cell_size.x = (grid_max.x - _grid_min.x) / AC_FENCE_ZONE_GRID_SIZE + 1;
+    _grid_cell_size.y = (grid_max.y - _grid_min.y) / AC_FENCE_ZONE_GRID_SIZE + 1;
+
+    // mark each zone in the cells its bounding box overlaps
+    for (i=0; i<_num_zones; i++) {
+        const Vector2l &zmin = _zones[i].polygon.get_min();
+        const Vector2l &zmax = _zones[i].polygon.get_max();
+        uint8_t x_low = (zmin.x - _grid_min.x) / _grid_cell_size.x;
+        uint8_t x_high = (zmax.x - _grid_min.x) / _grid_cell_size.x;
+        uint8_t y_low = (zmin.y - _grid_min.y) / _grid_cell_size.y;
+        uint8_t y_high = (zmax.y - _grid_min.y) / _grid_cell_size.y;
+        for (x=x_low; x<=x_high; x++) {
+            for (y=y_low; y<=y_high; y++) {
+                _grid[x][y] |= 1UL << i;
+            }
+        }
+    }
+}
+
+/// check_zones - returns true if position (in cm from home) is outside an inclusion zone or inside an exclusion zone
+///     the breach distance in meters is written to breach_distance
+bool AC_Fence::check_zones(const Vector2l &position, float &breach_distance)
+{
+    // find the zones whose bounding box may hold the position
+    uint32_t nearby_zones = 0;
+    int32_t dx = position.x - _grid_min.x;
+    int32_t dy = position.y - _grid_min.y;
+    if (dx >= 0 && dy >= 0) {
+        int32_t x = dx / _grid_cell_size.x;
+        int32_t y = dy / _grid_cell_size.y;
+        if (x < AC_FENCE_ZONE_GRID_SIZE && y < AC_FENCE_ZONE_GRID_SIZE) {
+            nearby_zones = _grid[x][y];
+        }
+    }
+
+    // we must be outside any inclusion zone which is not nearby
+    uint32_t breached_zones = _inclusion_zones & ~nearby_zones;
+
+    // test the nearby zones properly
+    for (uint8_t i=0; i<_num_zones; i++) {
+        uint32_t bit = 1UL << i;
+        if ((nearby_zones & bit) == 0) {
+            continue;
+        }
+        bool outside = _zones[i].polygon.outside(position);
+        if (outside == (_zones[i].type == AC_FENCE_ZONE_INCLUSION)) {
+            breached_zones |= bit;
+        }
+    }
+
+    if (breached_zones == 0) {
+        return false;
+    }
+
+    // report the furthest we are into any breached zone.  This is only done while breached so can afford to look at every edge
+    float ret = 0;
+    for (uint8_t i=0; i<_num_zones; i++) {
+        if ((breached_zones & (1UL << i)) != 0) {
+            ret = max(ret, zone_edge_distance(i, position));
+        }
+    }
+    breach_distance = ret * 0.01f;
+    return true;
+}
+
+/// zone_edge_distance - returns distance in cm from position to the nearest edge of a zone
+float AC_Fence::zone_edge_distance(uint8_t zone, const Vector2l &position) const
+{
+    const Vector2l *V = &_zone_points[_zones[zone].start];
+    uint8_t n = _zones[zone].num_points;
+    float ret = -1;
+
+    for (uint8_t i=0, j=n-1; i<n; j=i++) {
+        // edge from V[j] to V[i], and position, relative to V[j]
+        float ex = V[i].x - V[j].x;
+        float ey = V[i].y - V[j].y;
+        float px = position.x - V[j].x;
+        float py = position.y - V[j].y;
+
+        // nearest point on the edge as a fraction of the way along it
+        float len_sq = ex*ex + ey*ey;
+        float t = 0;
+        if (len_sq > 0) {
+            t = constrain_float((px*ex + py*ey) / len_sq, 0.0f, 1.0f);
+        }
+        float dist = pythagorous2(px - t*ex, py - t*ey);
+        if (ret < 0 || dist < ret) {
+            ret = dist;
+        }
+    }
+    return ret;
+}
+#endif // AC_FENCE_ZONES_AVAILABLE
\ No newline at end of file
@@ -12,6 +12,7 @@
 #define AC_FENCE_TYPE_NONE                          0       // fence disabled
 #define AC_FENCE_TYPE_ALT_MAX                       1       // high alt fence which usually initiates an RTL
 #define AC_FENCE_TYPE_CIRCLE                        2       // circular horizontal fence (usually initiates an RTL)
+#define AC_FENCE_TYPE_POLYGON                       4       // inclusion polygons and exclusion zones held in the zone store
 
 // valid actions should a fence be breached
 #define AC_FENCE_ACTION_REPORT_ONLY                 0       // report to GCS that boundary has been breached but take no further action
@@ -22,6 +23,25 @@
 #define AC_FENCE_CIRCLE_RADIUS_DEFAULT              150.0f  // default circular fence radius is 150m
 #define AC_FENCE_ALT_MAX_BACKUP_DISTANCE            20.0f   // after fence is broken we recreate the fence 20m further up
 #define AC_FENCE_CIRCLE_RADIUS_BACKUP_DISTANCE      20.0f   // after fence is broken we recreate the fence 20m further out
+#define AC_FENCE_POLYGON_BACKUP_DISTANCE            20.0f   // after a zone is broken we refire the breach each 20m further in or out
+
+// the zone store needs more memory than the APM1/APM2 can spare
+#ifndef AC_FENCE_ZONES_AVAILABLE
+ #if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+  #define AC_FENCE_ZONES_AVAILABLE 0
+ #else
+  #define AC_FENCE_ZONES_AVAILABLE 1
+ #endif
+#endif
+
+// zone types
+#define AC_FENCE_ZONE_INCLUSION                     0       // vehicle must stay inside the polygon
+#define AC_FENCE_ZONE_EXCLUSION                     1       // vehicle must stay outside the polygon (i.e. a no-fly area)
+
+// zone store sizes. Zones are held as a bitmask in the grid cells so there can be no more than 32
+#define AC_FENCE_ZONES_MAX                          32      // maximum number of zones
+#define AC_FENCE_ZONE_POINTS_MAX                    256     // maximum number of vertices over all zones
+#define AC_FENCE_ZONE_GRID_SIZE                     8       // zones' bounding boxes are indexed by a grid of 8 x 8 cells
 
 // give up distance
 #define AC_FENCE_GIVE_UP_DISTANCE                   100.0f  // distance outside the fence at which we should give up and just land.  Note: this is not used by library directly but is intended to be used by the main code
@@ -64,6 +84,13 @@ public:
     /// get_breach_distance - returns distance in meters outside of the given fence
     float get_breach_distance(uint8_t fence_type) const;
 
+    /// check_stopping_point - returns the fence types the vehicle would breach if it braked now but has not yet breached (if any)
+    ///     only new pre-breaches are returned.  requires PREDICT to be enabled and set_stopping_point to have been called
+    uint8_t check_stopping_point();
+
+    /// get_pre_breaches - returns bit mask of the fence types the stopping point is beyond
+    uint8_t get_pre_breaches() const { return _pre_breached_fences; }
+
     /// get_action - getter for user requested action on limit breach
     uint8_t get_action() const { return _action.get(); }
     
@@ -74,6 +101,28 @@ public:
     /// set_home_distance - update vehicle's distance from home in meters - required for circular horizontal fence monitoring
     void set_home_distance(float distance) { _home_distance = distance; }
 
+    /// set_stopping_point - update the point in cm from home at which the vehicle would come to rest if it braked now - required for predictive fence monitoring
+    void set_stopping_point(const Vector3f &stopping_point) { _stopping_point = stopping_point; _stopping_point_valid = true; }
+
+    /// shift_origin - move the zones and stopping point by the shift returned when inertial nav's origin was moved, so they stay at the same locations
+    void shift_origin(const Vector2f &shift);
+
+#if AC_FENCE_ZONES_AVAILABLE
+    ///
+    /// zone store for the polygon fence
+    ///
+
+    /// clear_zones - remove all inclusion and exclusion zones
+    void clear_zones();
+
+    /// add_zone - add an inclusion or exclusion zone.  points are the polygon's vertices in cm north and east of home (i.e. the inertial nav frame)
+    ///     the polygon need not be closed.  returns false if the store is full or there are fewer than 3 points
+    bool add_zone(uint8_t zone_type, const Vector2l *points, uint8_t num_points);
+
+    /// get_num_zones - returns number of zones in the store
+    uint8_t get_num_zones() const { return _num_zones; }
+#endif
+
     static const struct AP_Param::GroupInfo var_info[];
 
 private:
@@ -84,6 +133,18 @@ private:
     /// clear_breach - update breach bitmask, time and count
     void clear_breach(uint8_t fence_type);
 
+#if AC_FENCE_ZONES_AVAILABLE
+    /// check_zones - returns true if position (in cm from home) is outside an inclusion zone or inside an exclusion zone
+    ///     the breach distance in meters is written to breach_distance
+    bool check_zones(const Vector2l &position, float &breach_distance);
+
+    /// build_zone_grid - rebuild the grid index from the zones' bounding boxes
+    void build_zone_grid();
+
+    /// zone_edge_distance - returns distance in cm from position to the nearest edge of a zone
+    float zone_edge_distance(uint8_t zone, const Vector2l &position) const;
+#endif
+
     // pointers to other objects we depend upon
     AP_InertialNav* _inav;
     GPS**           _gps_ptr;              // pointer to pointer to gps
@@ -94,6 +155,7 @@ private:
     AP_Int8         _action;                // recovery action specified by user
     AP_Float        _alt_max;               // altitude upper limit in meters
     AP_Float        _circle_radius;         // circle fence radius in meters
+    AP_Int8         _predict;               // look ahead to the stopping point and report pre-breaches
 
     // backup fences
     float           _alt_max_backup;        // backup altitude upper limit in meters used to refire the breach if the vehicle continues to move further away
@@ -102,9 +164,33 @@ private:
     // breach distances
     float           _alt_max_breach_distance;   // distance above the altitude max
     float           _circle_breach_distance;    // distance above the altitude max
+    float           _polygon_breach_distance;   // distance outside an inclusion zone or inside an exclusion zone
+    float           _polygon_backup_distance;   // breach distance at which the polygon breach is refired
+
+#if AC_FENCE_ZONES_AVAILABLE
+    // zone store.  each zone's vertices are held contiguously in _zone_points
+    struct Zone {
+        PolygonFence    polygon;            // point in polygon test with cached edges
+        uint16_t        start;              // index of first vertex in _zone_points
+        uint8_t         num_points;         // number of vertices
+        uint8_t         type;               // AC_FENCE_ZONE_INCLUSION or AC_FENCE_ZONE_EXCLUSION
+    } _zones[AC_FENCE_ZONES_MAX];
+    Vector2l        _zone_points[AC_FENCE_ZONE_POINTS_MAX];
+    uint16_t        _num_zone_points;       // number of vertices used in _zone_points
+    uint8_t         _num_zones;             // number of zones in the store
+    uint32_t        _inclusion_zones;       // bitmask of the inclusion zones
+
+    // grid index over the union of the zones' bounding boxes.  each cell holds a bitmask of the zones whose bounding box overlaps it
+    Vector2l        _grid_min;              // south west corner of the grid in cm from home
+    Vector2l        _grid_cell_size;        // size of a grid cell in cm
+    uint32_t        _grid[AC_FENCE_ZONE_GRID_SIZE][AC_FENCE_ZONE_GRID_SIZE];
+#endif
 
     // other internal variables
     float           _home_distance;         // distance from home in meters (provided by main code)
+    Vector3f        _stopping_point;        // stopping point in cm from home (provided by main code)
+    bool            _stopping_point_valid;  // true once the main code has provided a stopping point
+    uint8_t         _pre_breached_fences;   // bitmask of the fence types the stopping point is beyond
 
     // breach information
     uint8_t         _breached_fences;       // bitmask holding the fence type that was breached (i.e. AC_FENCE_TYPE_ALT_MIN, AC_FENCE_TYPE_CIRCLE)
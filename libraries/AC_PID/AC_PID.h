@@ -122,7 +122,9 @@ public:
 
     static const struct AP_Param::GroupInfo        var_info[];
 
-private:
+protected:
+    friend class AC_PID3;
+
     AP_Float        _kp;
     AP_Float        _ki;
     AP_Float        _kd;
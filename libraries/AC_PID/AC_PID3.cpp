@@ -0,0 +1,89 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AC_PID3.cpp
+/// @brief	Three axis PID
+
+#include "AC_PID3.h"
+
+AC_PID3::AC_PID3(const AC_PID &x, const AC_PID &y, const AC_PID &z) :
+    _derivative_valid(0)
+{
+    _pid[0] = &x;
+    _pid[1] = &y;
+    _pid[2] = &z;
+    for (uint8_t n=0; n<3; n++) {
+        _integrator[n] = 0;
+        _last_input[n] = 0;
+        _last_derivative[n] = 0;
+        _p[n] = _i[n] = _d[n] = 0;
+    }
+}
+
+Vector3l AC_PID3::update(const Vector3l &error, float dt, uint8_t i_hold)
+{
+    const int32_t err[3] = { error.x, error.y, error.z };
+    int32_t out[3];
+
+    // the dt dependent parts of the derivative and its filter, shared by all axes
+    float inv_dt = 0, alpha = 0;
+    if (dt != 0) {
+        inv_dt = 1.0f / dt;
+        alpha = dt / (AC_PID::_filter + dt);
+    }
+
+    for (uint8_t n=0; n<3; n++) {
+        const AC_PID &pid = *_pid[n];
+        const uint8_t bit = 1<<n;
+
+        // p term
+        _p[n] = (float)err[n] * pid._kp;
+
+        // i term, held while the output is limited unless it will shrink
+        _i[n] = _integrator[n];
+        if (!(i_hold & bit) || (_i[n]>0 && err[n]<0) || (_i[n]<0 && err[n]>0)) {
+            _i[n] = 0;
+            if (pid._ki != 0 && dt != 0) {
+                _integrator[n] += ((float)err[n] * pid._ki) * dt;
+                _integrator[n] = constrain_float(_integrator[n], -pid._imax, pid._imax);
+                _i[n] = _integrator[n];
+            }
+        }
+
+        // d term
+        _d[n] = 0;
+        if (pid._kd != 0 && dt != 0) {
+            float derivative;
+            if (!(_derivative_valid & bit)) {
+                // we've just done a reset, suppress the first derivative
+                // term as we don't want a sudden change in input to cause
+                // a large D output change
+                derivative = 0;
+                _last_derivative[n] = 0;
+                _derivative_valid |= bit;
+            } else {
+                derivative = (err[n] - _last_input[n]) * inv_dt;
+            }
+
+            // discrete low pass filter, cuts out the
+            // high frequency noise that can drive the controller crazy
+            derivative = _last_derivative[n] + alpha * (derivative - _last_derivative[n]);
+
+            _last_input[n] = err[n];
+            _last_derivative[n] = derivative;
+            _d[n] = pid._kd * derivative;
+        }
+
+        out[n] = _p[n] + _i[n] + _d[n];
+    }
+
+    return Vector3l(out[0], out[1], out[2]);
+}
+
+void AC_PID3::reset_I()
+{
+    for (uint8_t n=0; n<3; n++) {
+        _integrator[n] = 0;
+    }
+    // mark derivatives as invalid
+    _derivative_valid = 0;
+}
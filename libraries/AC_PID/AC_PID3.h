@@ -0,0 +1,63 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AC_PID3.h
+/// @brief	Three axis PID, running roll, pitch and yaw in one pass.
+
+#ifndef __AC_PID3_H__
+#define __AC_PID3_H__
+
+#include <AP_Math.h>
+#include "AC_PID.h"
+
+// bits of the i_hold mask passed to update(), and of the axes
+#define AC_PID3_X           (1<<0)
+#define AC_PID3_Y           (1<<1)
+#define AC_PID3_Z           (1<<2)
+
+/// @class	AC_PID3
+/// @brief	Runs the same calculation as AC_PID::get_p, get_i and get_d on
+///         x, y and z together. The gains come from three AC_PID objects,
+///         so the parameters don't change, but the integrator and
+///         derivative state of all three axes is held here side by side,
+///         and the dt dependent work is done once per update instead of
+///         once per axis.
+class AC_PID3 {
+public:
+
+    /// @param  x, y, z     the PIDs to take the gains of for each axis
+    AC_PID3(const AC_PID &x, const AC_PID &y, const AC_PID &z);
+
+    /// Iterate the PIDs, return the new control values
+    ///
+    /// @param error    The measured error values
+    /// @param dt       The time delta in seconds
+    /// @param i_hold   AC_PID3_X, _Y and _Z bits for the axes whose integrator
+    ///                 may only shrink, for when the output is limited
+    ///
+    /// @returns        The sum of the P, I and D terms of each axis.
+    ///
+    Vector3l        update(const Vector3l &error, float dt, uint8_t i_hold);
+
+    /// Reset the integrators and the derivative filters
+    void            reset_I();
+
+    /// the terms of the last update of an axis, 0 to 2, for logging
+    int32_t         get_p(uint8_t axis) const { return _p[axis]; }
+    int32_t         get_i(uint8_t axis) const { return _i[axis]; }
+    int32_t         get_d(uint8_t axis) const { return _d[axis]; }
+
+private:
+    const AC_PID *  _pid[3];
+
+    // the state of each axis, one array per field
+    float           _integrator[3];                             ///< integrator values
+    int32_t         _last_input[3];                             ///< last inputs for derivative
+    float           _last_derivative[3];                        ///< last derivatives for low-pass filter
+    uint8_t         _derivative_valid;                          ///< a bit per axis, clear after a reset
+
+    int32_t         _p[3];
+    int32_t         _i[3];
+    int32_t         _d[3];
+};
+
+#endif // __AC_PID3_H__
@@ -0,0 +1,167 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AC_PID_Q.cpp
+/// @brief	Fixed point version of AC_PID
+
+#include <AP_Math.h>
+#include "AC_PID_Q.h"
+
+// set_coefficient - finds the largest shift which keeps the gain's
+// mantissa within AC_PID_Q_MANTISSA_MAX, so it keeps 15 bits of precision
+void AC_PID_Q::set_coefficient(struct coefficient &c, float gain)
+{
+    float a = fabsf(gain);
+    uint8_t shift = 0;
+
+    if (a > AC_PID_Q_MANTISSA_MAX) {
+        a = AC_PID_Q_MANTISSA_MAX;
+    }
+    while (a != 0 && shift < 30 && a * 2 <= AC_PID_Q_MANTISSA_MAX) {
+        a *= 2;
+        shift++;
+    }
+
+    c.mul = a + 0.5f;
+    if (gain < 0) {
+        c.mul = -c.mul;
+    }
+    c.shift = shift;
+}
+
+// apply - multiplies x by a coefficient, truncating towards zero like
+// the float to integer conversion in AC_PID
+int32_t AC_PID_Q::apply(const struct coefficient &c, int32_t x)
+{
+    x = constrain_int32(x, -AC_PID_Q_INPUT_MAX, AC_PID_Q_INPUT_MAX);
+    int32_t p = x * c.mul;
+    if (p < 0) {
+        return -((-p) >> c.shift);
+    }
+    return p >> c.shift;
+}
+
+// check_dt - recalculates the dt scaled coefficients when dt moves out
+// of the band around the dt they were last calculated for. The loop
+// time jitters a little, so without the band they would be
+// recalculated on every call
+void AC_PID_Q::check_dt(float dt)
+{
+    if (dt >= _dt_low && dt <= _dt_high) {
+        return;
+    }
+    _dt = dt;
+    _dt_low = dt * (1.0f - AC_PID_Q_DT_BAND);
+    _dt_high = dt * (1.0f + AC_PID_Q_DT_BAND);
+    calc_i();
+    calc_d();
+}
+
+void AC_PID_Q::calc_i()
+{
+    _ki_cache = _ki;
+    set_coefficient(_i, _ki_cache * _dt * (1L<<AC_PID_Q_I_SHIFT));
+}
+
+void AC_PID_Q::calc_d()
+{
+    _kd_cache = _kd;
+    set_coefficient(_d, _kd_cache / _dt);
+    _alpha = (_dt / (_filter + _dt)) * (1<<AC_PID_Q_ALPHA_SHIFT) + 0.5f;
+}
+
+int32_t AC_PID_Q::get_p(int32_t error)
+{
+    if (_kp != _kp_cache) {
+        _kp_cache = _kp;
+        set_coefficient(_p, _kp_cache);
+    }
+    return apply(_p, error);
+}
+
+int32_t AC_PID_Q::get_i(int32_t error, float dt)
+{
+    if((_ki != 0) && (dt != 0)) {
+        check_dt(dt);
+        if (_ki != _ki_cache) {
+            calc_i();
+        }
+        int32_t imax = (int32_t)_imax << AC_PID_Q_I_SHIFT;
+        _integrator_q += apply(_i, error);
+        _integrator_q = constrain_int32(_integrator_q, -imax, imax);
+        return _integrator_q / (1L<<AC_PID_Q_I_SHIFT);
+    }
+    return 0;
+}
+
+// This is an integrator which tends to decay to zero naturally
+// if the error is zero.
+
+int32_t AC_PID_Q::get_leaky_i(int32_t error, float dt, float leak_rate)
+{
+    if((_ki != 0) && (dt != 0)) {
+        check_dt(dt);
+        if (_ki != _ki_cache) {
+            calc_i();
+        }
+        if (leak_rate != _leak_cache) {
+            _leak_cache = leak_rate;
+            set_coefficient(_leak, _leak_cache);
+        }
+        // the integrator is too wide for apply(), and this is only
+        // used by helis, so take the slower 64 bit multiply
+        int32_t imax = (int32_t)_imax << AC_PID_Q_I_SHIFT;
+        _integrator_q -= ((int64_t)_integrator_q * _leak.mul) >> _leak.shift;
+        _integrator_q += apply(_i, error);
+        _integrator_q = constrain_int32(_integrator_q, -imax, imax);
+        return _integrator_q / (1L<<AC_PID_Q_I_SHIFT);
+    }
+    return 0;
+}
+
+int32_t AC_PID_Q::get_d(int32_t input, float dt)
+{
+    if ((_kd != 0) && (dt != 0)) {
+        check_dt(dt);
+        if (_kd != _kd_cache) {
+            calc_d();
+        }
+
+        if (!_derivative_valid) {
+            // we've just done a reset, suppress the first derivative
+            // term as we don't want a sudden change in input to cause
+            // a large D output change
+            _derivative_q = 0;
+            _derivative_valid = true;
+        } else {
+            // the filter works on the change in input per call, and
+            // the division by dt is folded into the kd coefficient.
+            // The filter step is rounded so it doesn't drift
+            int32_t change = input - _last_input;
+            change = constrain_int32(change, -AC_PID_Q_INPUT_MAX, AC_PID_Q_INPUT_MAX);
+            _derivative_q += ((change - _derivative_q) * _alpha + (1<<(AC_PID_Q_ALPHA_SHIFT-1))) >> AC_PID_Q_ALPHA_SHIFT;
+        }
+
+        _last_input = input;
+
+        return apply(_d, _derivative_q);
+    }
+    return 0;
+}
+
+int32_t AC_PID_Q::get_pi(int32_t error, float dt)
+{
+    return get_p(error) + get_i(error, dt);
+}
+
+int32_t AC_PID_Q::get_pid(int32_t error, float dt)
+{
+    return get_p(error) + get_i(error, dt) + get_d(error, dt);
+}
+
+void
+AC_PID_Q::reset_I()
+{
+    _integrator_q = 0;
+    // mark derivative as invalid
+    _derivative_valid = false;
+}
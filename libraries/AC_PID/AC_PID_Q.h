@@ -0,0 +1,107 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AC_PID_Q.h
+/// @brief	Fixed point version of AC_PID, for the rate loops on boards
+///         without a floating point unit.
+
+#ifndef __AC_PID_Q_H__
+#define __AC_PID_Q_H__
+
+#include "AC_PID.h"
+
+#define AC_PID_Q_MANTISSA_MAX   32767       // coefficients are a Q15 mantissa and a shift
+#define AC_PID_Q_INPUT_MAX      65535       // inputs are clamped to this so the products fit in 32 bits
+#define AC_PID_Q_I_SHIFT        15          // fraction bits of the integrator
+#define AC_PID_Q_ALPHA_SHIFT    10          // fraction bits of the derivative filter coefficient
+#define AC_PID_Q_DT_BAND        0.015625f   // dt may drift this fraction before the coefficients are recalculated
+
+/// @class	AC_PID_Q
+/// @brief	AC_PID with the same parameters and interface, calculated in
+///         fixed point from coefficients that are only recalculated when
+///         the gains or dt change.
+///
+/// Compared with AC_PID on the same inputs:
+///  - the P term is within 1 of AC_PID
+///  - the I and D terms use a dt within AC_PID_Q_DT_BAND of the one
+///    passed, so differ from AC_PID by at most that fraction, plus 1
+///  - errors, and changes of the D input in one call, beyond
+///    +-AC_PID_Q_INPUT_MAX are clamped. Both are far past where the rate
+///    loop outputs saturate.
+///
+class AC_PID_Q : public AC_PID {
+public:
+
+    AC_PID_Q(
+        const float &   initial_p = 0.0,
+        const float &   initial_i = 0.0,
+        const float &   initial_d = 0.0,
+        const int16_t & initial_imax = 0.0) :
+        AC_PID(initial_p, initial_i, initial_d, initial_imax),
+        _kp_cache(0),
+        _ki_cache(0),
+        _kd_cache(0),
+        _leak_cache(0),
+        _dt(0),
+        _dt_low(0),
+        _dt_high(0),
+        _alpha(0),
+        _integrator_q(0),
+        _derivative_q(0),
+        _derivative_valid(false)
+    {
+        _p.mul = _i.mul = _d.mul = _leak.mul = 0;
+        _p.shift = _i.shift = _d.shift = _leak.shift = 0;
+    }
+
+    /// the same as the AC_PID methods, see AC_PID.h
+    int32_t         get_pid(int32_t error, float dt);
+    int32_t         get_pi(int32_t error, float dt);
+    int32_t         get_p(int32_t error);
+    int32_t         get_i(int32_t error, float dt);
+    int32_t         get_d(int32_t input, float dt);
+    int32_t         get_leaky_i(int32_t error, float dt, float leak_rate);
+
+    void            reset_I();
+
+    float           get_integrator() const {
+        return (float)_integrator_q / (1L<<AC_PID_Q_I_SHIFT);
+    }
+    void            set_integrator(float i) {
+        _integrator_q = i * (1L<<AC_PID_Q_I_SHIFT);
+    }
+
+private:
+    /// a gain as a Q15 mantissa and the shift which scales it
+    struct coefficient {
+        int16_t     mul;
+        uint8_t     shift;
+    };
+
+    static void     set_coefficient(struct coefficient &c, float gain);
+    static int32_t  apply(const struct coefficient &c, int32_t x);
+
+    void            check_dt(float dt);
+    void            calc_i();
+    void            calc_d();
+
+    // the gains and dt the coefficients were calculated from
+    float           _kp_cache;
+    float           _ki_cache;
+    float           _kd_cache;
+    float           _leak_cache;
+    float           _dt;
+    float           _dt_low;
+    float           _dt_high;
+
+    struct coefficient _p;                                      ///< kp
+    struct coefficient _i;                                      ///< ki * dt, scaled to the integrator
+    struct coefficient _d;                                      ///< kd / dt
+    struct coefficient _leak;                                   ///< integrator leak rate
+    int16_t         _alpha;                                     ///< derivative low pass filter coefficient
+
+    int32_t         _integrator_q;                              ///< integrator, AC_PID_Q_I_SHIFT fraction bits
+    int32_t         _derivative_q;                              ///< filtered input change per call
+    bool            _derivative_valid;                          ///< false after a reset
+};
+
+#endif // __AC_PID_Q_H__
@@ -61,6 +61,31 @@ const AP_Param::GroupInfo AC_WPNav::var_info[] PROGMEM = {
     // @User: Standard
     AP_GROUPINFO("ACCEL",       5, AC_WPNav, _wp_accel_cms, WPNAV_ACCELERATION),
 
+    // @Param: JERK
+    // @DisplayName: Waypoint Jerk
+    // @Description: Defines how quickly the acceleration of the intermediate target along the track may change during missions, so it starts and stops smoothly. 0 moves the target with the leash length and constant acceleration instead
+    // @Units: cm/s/s/s
+    // @Range: 0 5000
+    // @Increment: 50
+    // @User: Advanced
+    AP_GROUPINFO("JERK",        6, AC_WPNav, _wp_jerk_cms, WPNAV_JERK),
+
+    // @Param: SPLINE
+    // @DisplayName: Waypoint Spline
+    // @Description: Fly the waypoints of missions as a smooth curve through them instead of straight lines between them. Waypoints with a delay are still stopped at. The intermediate target follows the JERK speed profile along the curve, with the default jerk if JERK is 0
+    // @Values: 0:Straight,1:Spline
+    // @User: Advanced
+    AP_GROUPINFO("SPLINE",      7, AC_WPNav, _wp_spline, WPNAV_SPLINE),
+
+    // @Param: VEL_RATE
+    // @DisplayName: Velocity controller rate
+    // @Description: Rate the loiter and waypoint velocity and acceleration controllers run at, between the updates of the position controller. Rounded to a whole number of main loops
+    // @Units: Hz
+    // @Range: 10 100
+    // @Increment: 10
+    // @User: Advanced
+    AP_GROUPINFO("VEL_RATE",    8, AC_WPNav, _vel_rate_hz, WPNAV_VEL_RATE),
+
     AP_GROUPEND
 };
 
@@ -77,9 +102,9 @@ AC_WPNav::AC_WPNav(AP_InertialNav* inav, AP_AHRS* ahrs, APM_PI* pid_pos_lat, APM
     _pid_rate_lon(pid_rate_lon),
     _loiter_last_update(0),
     _wpnav_last_update(0),
-    _cos_yaw(1.0),
-    _sin_yaw(0.0),
-    _cos_pitch(1.0),
+    _pos_last_update(0),
+    _vel_next_us(0),
+    _vel_last_update_us(0),
     _althold_kP(WPNAV_ALT_HOLD_P),
     _desired_roll(0),
     _desired_pitch(0),
@@ -88,6 +113,7 @@ AC_WPNav::AC_WPNav(AP_InertialNav* inav, AP_AHRS* ahrs, APM_PI* pid_pos_lat, APM
     _pilot_vel_right_cms(0),
     _target_vel(0,0,0),
     _vel_last(0,0,0),
+    _accel_ff(0,0),
     _loiter_leash(WPNAV_MIN_LEASH_LENGTH),
     _loiter_accel_cms(WPNAV_LOITER_ACCEL_MAX),
     _wp_leash_xy(WPNAV_MIN_LEASH_LENGTH),
@@ -95,12 +121,27 @@ AC_WPNav::AC_WPNav(AP_InertialNav* inav, AP_AHRS* ahrs, APM_PI* pid_pos_lat, APM
     _track_accel(0),
     _track_speed(0),
     _track_leash_length(0),
+    _spline_chord(0),
+    _spline_walked(0),
+    _spline_step(0),
+    _spline_steps(0),
     dist_error(0,0),
     desired_vel(0,0),
     desired_accel(0,0)
 {
     AP_Param::setup_object_defaults(this, var_info);
 
+    // no speed profile until a destination is set
+    for (uint8_t i=0; i<WPNAV_SCURVE_SEGMENTS; i++) {
+        _scurve_time[i] = 0;
+        _scurve_jerk[i] = 0;
+    }
+    _scurve.seg = WPNAV_SCURVE_SEGMENTS;
+    _scurve.time = 0;
+    _scurve.pos = 0;
+    _scurve.vel = 0;
+    _scurve.accel = 0;
+
     // calculate loiter leash
     calculate_loiter_leash_length();
 }
@@ -150,6 +191,24 @@ void AC_WPNav::set_loiter_target(const Vector3f& position)
     _target = position;
     _target_vel.x = 0;
     _target_vel.y = 0;
+    _flags.moving_target = false;
+}
+
+/// set_moving_target - set loiter target in cm from home, moving at velocity in cm/s
+void AC_WPNav::set_moving_target(const Vector3f& position, const Vector3f& velocity)
+{
+    _target = position;
+    _target_vel.x = velocity.x;
+    _target_vel.y = velocity.y;
+
+    // fly no faster than loiter would let the pilot
+    float vel_total = safe_sqrt(_target_vel.x*_target_vel.x + _target_vel.y*_target_vel.y);
+    if (vel_total > _loiter_speed_cms && vel_total > 0.0f) {
+        _target_vel.x = _loiter_speed_cms * _target_vel.x/vel_total;
+        _target_vel.y = _loiter_speed_cms * _target_vel.y/vel_total;
+    }
+    _flags.moving_target = true;
+    constrain_loiter_target();
 }
 
 /// init_loiter_target - set initial loiter target based on current position and velocity
@@ -160,6 +219,7 @@ void AC_WPNav::init_loiter_target(const Vector3f& position, const Vector3f& velo
     _target.y = position.y;
     _target_vel.x = velocity.x;
     _target_vel.y = velocity.y;
+    _flags.moving_target = false;
 
     // initialise desired roll and pitch to current roll and pitch.  This avoids a random twitch between now and when the loiter controller is first run
     _desired_roll = constrain_int32(_ahrs->roll_sensor,-MAX_LEAN_ANGLE,MAX_LEAN_ANGLE);
@@ -198,9 +258,18 @@ void AC_WPNav::translate_loiter_target_movements(float nav_dt)
         _loiter_speed_cms = 100.0f;
     }
 
+    // a moving target carries on at its own velocity between updates
+    if (_flags.moving_target) {
+        _target.x += _target_vel.x * nav_dt;
+        _target.y += _target_vel.y * nav_dt;
+        constrain_loiter_target();
+        return;
+    }
+
     // rotate pilot input to lat/lon frame
-    target_vel_adj.x = (_pilot_vel_forward_cms*_cos_yaw - _pilot_vel_right_cms*_sin_yaw);
-    target_vel_adj.y = (_pilot_vel_forward_cms*_sin_yaw + _pilot_vel_right_cms*_cos_yaw);
+    const AP_AHRS::attitude_trig &trig = _ahrs->get_trig();
+    target_vel_adj.x = (_pilot_vel_forward_cms*trig.cos_yaw - _pilot_vel_right_cms*trig.sin_yaw);
+    target_vel_adj.y = (_pilot_vel_forward_cms*trig.sin_yaw + _pilot_vel_right_cms*trig.cos_yaw);
 
     // add desired change in velocity to current target velocit
     _target_vel.x += target_vel_adj.x*nav_dt;
@@ -231,7 +300,12 @@ void AC_WPNav::translate_loiter_target_movements(float nav_dt)
     _target.x += _target_vel.x * nav_dt;
     _target.y += _target_vel.y * nav_dt;
 
-    // constrain target position to within reasonable distance of current location
+    constrain_loiter_target();
+}
+
+/// constrain_loiter_target - keep loiter target within leash of current location
+void AC_WPNav::constrain_loiter_target()
+{
     Vector3f curr_pos = _inav->get_position();
     Vector3f distance_err = _target - curr_pos;
     float distance = safe_sqrt(distance_err.x*distance_err.x + distance_err.y*distance_err.y);
@@ -253,7 +327,7 @@ int32_t AC_WPNav::get_bearing_to_target() const
     return get_bearing_cd(_inav->get_position(), _target);
 }
 
-/// update_loiter - run the loiter controller - should be called at 10hz
+/// update_loiter - run the loiter position controller - should be called at 10hz
 void AC_WPNav::update_loiter()
 {
     uint32_t now = hal.scheduler->millis();
@@ -266,6 +340,11 @@ void AC_WPNav::update_loiter()
         reset_I();
     }
 
+    // the leash follows the loiter speed and gains if they have been changed
+    if (_loiter_leash_params != AP_Param::change_count()) {
+        calculate_loiter_leash_length();
+    }
+
     // translate any adjustments from pilot to loiter target
     translate_loiter_target_movements(dt);
 
@@ -276,6 +355,8 @@ void AC_WPNav::update_loiter()
 /// calculate_loiter_leash_length - calculates the maximum distance in cm that the target position may be from the current location
 void AC_WPNav::calculate_loiter_leash_length()
 {
+    _loiter_leash_params = AP_Param::change_count();
+
     // get loiter position P
     float kP = _pid_pos_lat->kP();
 
@@ -362,8 +443,12 @@ void AC_WPNav::set_origin_and_destination(const Vector3f& origin, const Vector3f
     float speed_along_track = curr_vel.x * _pos_delta_unit.x + curr_vel.y * _pos_delta_unit.y + curr_vel.z * _pos_delta_unit.z;
     _limited_speed_xy_cms = constrain_float(speed_along_track,0,_wp_speed_cms);
 
-    // default waypoint back to slow
+    // default waypoint back to slow, along a straight track
     _flags.fast_waypoint = false;
+    _flags.spline = false;
+
+    // plan the intermediate target's speed along the track from the current speed
+    calculate_scurve(_limited_speed_xy_cms);
 
     // initialise desired roll and pitch to current roll and pitch.  This avoids a random twitch between now and when the wpnav controller is first run
     _desired_roll = constrain_int32(_ahrs->roll_sensor,-MAX_LEAN_ANGLE,MAX_LEAN_ANGLE);
@@ -374,6 +459,50 @@ void AC_WPNav::set_origin_and_destination(const Vector3f& origin, const Vector3f
     _target_vel.y = 0;
 }
 
+/// shift_origin - move the targets by the shift returned when inertial nav's origin was moved.
+///     the track's direction, length and progress along it are unchanged
+void AC_WPNav::shift_origin(const Vector2f &shift)
+{
+    Vector3f shift3(shift.x, shift.y, 0);
+    _target -= shift3;
+    _origin -= shift3;
+    _destination -= shift3;
+    _spline_point -= shift3;
+}
+
+/// set_spline_destination - set destination using cm from home, flying a spline from the origin
+void AC_WPNav::set_spline_destination(const Vector3f& destination, bool stop_at_destination, const Vector3f& next_destination)
+{
+    Vector3f origin;
+    Vector3f m0;
+
+    if( _flags.reached_destination && ((hal.scheduler->millis() - _wpnav_last_update) < 1000) ) {
+        // carry on from the previous waypoint, leaving it the way a spline to it arrived so there is no corner
+        origin = _destination;
+        if (_flags.spline) {
+            m0 = _spline_tangent;
+        }else{
+            m0 = destination - origin;
+        }
+    }else{
+        // otherwise start from the stopping point, heading straight for the destination
+        get_stopping_point(_inav->get_position(), _inav->get_velocity(), origin);
+        m0 = destination - origin;
+    }
+
+    set_origin_and_destination(origin, destination);
+
+    // the tangent at the destination points from the origin to the next destination, as in a Catmull-Rom spline,
+    // which makes the curve through the waypoints smooth
+    Vector3f m1;
+    if (stop_at_destination) {
+        m1 = destination - origin;
+    }else{
+        m1 = (next_destination - origin) * 0.5f;
+    }
+    calculate_spline(m0, m1);
+}
+
 /// advance_target_along_track - move target location along track from origin to destination
 void AC_WPNav::advance_target_along_track(float dt)
 {
@@ -387,6 +516,25 @@ void AC_WPNav::advance_target_along_track(float dt)
     Vector3f curr_pos = _inav->get_position();
     Vector3f curr_delta = curr_pos - _origin;
 
+    if (_flags.spline) {
+        // follow the speed profile along the spline, holding it while the target is at the end of the leash
+        Vector3f target_error = _target - curr_pos;
+        if (pythagorous2(target_error.x, target_error.y) <= _wp_leash_xy && fabsf(target_error.z) <= _wp_leash_z) {
+            track_desired_temp = advance_scurve(dt);
+            if (_scurve.seg >= WPNAV_SCURVE_SEGMENTS) {
+                // the profile's length is an estimate of the curve's, so finish the curve with the profile
+                track_desired_temp = _track_length;
+            }
+            _track_desired = max(_track_desired, min(track_desired_temp, _track_length));
+            _target = advance_spline(_track_desired);
+            if (_spline_step >= _spline_steps) {
+                _track_desired = _track_length;
+            }
+        }
+        update_reached_destination(curr_pos);
+        return;
+    }
+
     // calculate how far along the track we are
     track_covered = curr_delta.x * _pos_delta_unit.x + curr_delta.y * _pos_delta_unit.y + curr_delta.z * _pos_delta_unit.z;
 
@@ -407,43 +555,53 @@ void AC_WPNav::advance_target_along_track(float dt)
         track_desired_max = track_covered + track_extra_max;
     }
 
-    // get current velocity
-    Vector3f curr_vel = _inav->get_velocity();
-    // get speed along track
-    float speed_along_track = curr_vel.x * _pos_delta_unit.x + curr_vel.y * _pos_delta_unit.y + curr_vel.z * _pos_delta_unit.z;
-
-    // calculate point at which velocity switches from linear to sqrt
-    float linear_velocity = _wp_speed_cms;
-    float kP = _pid_pos_lat->kP();
-    if (kP >= 0.0f) {   // avoid divide by zero
-        linear_velocity = _track_accel/kP;
-    }
-
-    // let the limited_speed_xy_cms be some range above or below current velocity along track
-    if (speed_along_track < -linear_velocity) {
-        // we are travelling fast in the opposite direction of travel to the waypoint so do not move the intermediate point
-        _limited_speed_xy_cms = 0;
-    }else{
-        // increase intermediate target point's velocity if not yet at target speed (we will limit it below)
-        if(dt > 0) {
-            if(track_desired_max > _track_desired) {
-                _limited_speed_xy_cms += 2.0 * _track_accel * dt;
-            }else{
-                // do nothing, velocity stays constant
-                _track_desired = track_desired_max;
-            }
+    if (_wp_jerk_cms > 0) {
+        // follow the speed profile, holding it while the target is at the end of the leash
+        struct scurve_state last = _scurve;
+        track_desired_temp = advance_scurve(dt);
+        if (track_desired_temp > track_desired_max && track_desired_temp > _track_desired) {
+            _scurve = last;
+            track_desired_temp = _track_desired;
         }
-        // do not go over top speed
-        if(_limited_speed_xy_cms > _track_speed) {
-            _limited_speed_xy_cms = _track_speed;
+    }else{
+        // get current velocity
+        Vector3f curr_vel = _inav->get_velocity();
+        // get speed along track
+        float speed_along_track = curr_vel.x * _pos_delta_unit.x + curr_vel.y * _pos_delta_unit.y + curr_vel.z * _pos_delta_unit.z;
+
+        // calculate point at which velocity switches from linear to sqrt
+        float linear_velocity = _wp_speed_cms;
+        float kP = _pid_pos_lat->kP();
+        if (kP >= 0.0f) {   // avoid divide by zero
+            linear_velocity = _track_accel/kP;
         }
-        // if our current velocity is within the linear velocity range limit the intermediate point's velocity to be no more than the linear_velocity above or below our current velocity
-        if (fabsf(speed_along_track) < linear_velocity) {
-            _limited_speed_xy_cms = constrain_float(_limited_speed_xy_cms,speed_along_track-linear_velocity,speed_along_track+linear_velocity);
+
+        // let the limited_speed_xy_cms be some range above or below current velocity along track
+        if (speed_along_track < -linear_velocity) {
+            // we are travelling fast in the opposite direction of travel to the waypoint so do not move the intermediate point
+            _limited_speed_xy_cms = 0;
+        }else{
+            // increase intermediate target point's velocity if not yet at target speed (we will limit it below)
+            if(dt > 0) {
+                if(track_desired_max > _track_desired) {
+                    _limited_speed_xy_cms += 2.0 * _track_accel * dt;
+                }else{
+                    // do nothing, velocity stays constant
+                    _track_desired = track_desired_max;
+                }
+            }
+            // do not go over top speed
+            if(_limited_speed_xy_cms > _track_speed) {
+                _limited_speed_xy_cms = _track_speed;
+            }
+            // if our current velocity is within the linear velocity range limit the intermediate point's velocity to be no more than the linear_velocity above or below our current velocity
+            if (fabsf(speed_along_track) < linear_velocity) {
+                _limited_speed_xy_cms = constrain_float(_limited_speed_xy_cms,speed_along_track-linear_velocity,speed_along_track+linear_velocity);
+            }
         }
+        // advance the current target
+        track_desired_temp += _limited_speed_xy_cms * dt;
     }
-    // advance the current target
-    track_desired_temp += _limited_speed_xy_cms * dt;
 
     // do not let desired point go past the end of the segment
     track_desired_temp = constrain_float(track_desired_temp, 0, _track_length);
@@ -452,6 +610,12 @@ void AC_WPNav::advance_target_along_track(float dt)
     // recalculate the desired position
     _target = _origin + _pos_delta_unit * _track_desired;
 
+    update_reached_destination(curr_pos);
+}
+
+/// update_reached_destination - sets the reached_destination flag once the intermediate target is at the destination
+void AC_WPNav::update_reached_destination(const Vector3f& curr_pos)
+{
     // check if we've reached the waypoint
     if( !_flags.reached_destination ) {
         if( _track_desired >= _track_length ) {
@@ -469,6 +633,20 @@ void AC_WPNav::advance_target_along_track(float dt)
     }
 }
 
+/// set_fast_waypoint - set to true to ignore the waypoint radius and consider the waypoint 'reached' the moment the intermediate point reaches it
+void AC_WPNav::set_fast_waypoint(bool fast)
+{
+    if (fast == _flags.fast_waypoint) {
+        return;
+    }
+    _flags.fast_waypoint = fast;
+
+    // replan the speed profile for the new end speed if the target hasn't started along it yet
+    if (_scurve.seg == 0 && _scurve.time == 0) {
+        calculate_scurve(_scurve.vel);
+    }
+}
+
 /// get_distance_to_destination - get horizontal distance to destination in cm
 float AC_WPNav::get_distance_to_destination()
 {
@@ -483,7 +661,7 @@ int32_t AC_WPNav::get_bearing_to_destination()
     return get_bearing_cd(_inav->get_position(), _destination);
 }
 
-/// update_wpnav - run the wp controller - should be called at 10hz
+/// update_wpnav - run the wp position controller - should be called at 10hz
 void AC_WPNav::update_wpnav()
 {
     uint32_t now = hal.scheduler->millis();
@@ -503,12 +681,43 @@ void AC_WPNav::update_wpnav()
     get_loiter_position_to_velocity(dt, _wp_speed_cms);
 }
 
+/// update_velocity - run the velocity and acceleration controllers on the latest velocity from the position controller
+void AC_WPNav::update_velocity()
+{
+    // nothing to do unless a position controller is running
+    if (_pos_last_update == 0 || hal.scheduler->millis() - _pos_last_update > WPNAV_VEL_TIMEOUT_MS) {
+        return;
+    }
+
+    // keep to the rate on average, with calls a little early taken as on time as the main loop jitters
+    uint32_t now = hal.scheduler->micros();
+    if ((int32_t)(now - _vel_next_us) < -WPNAV_VEL_JITTER_US) {
+        return;
+    }
+    uint32_t period_us = 1000000UL / constrain_int16(_vel_rate_hz, 1, 100);
+    _vel_next_us += period_us;
+    if ((int32_t)(now - _vel_next_us) > 0) {
+        // fallen behind, so start again from now
+        _vel_next_us = now + period_us;
+    }
+
+    float dt = (now - _vel_last_update_us) * 1.0e-6f;
+    _vel_last_update_us = now;
+
+    // catch if we've just been started
+    if (dt >= 1.0f) {
+        dt = 0.0f;
+    }
+
+    get_loiter_velocity_to_acceleration(dt);
+}
+
 ///
 /// shared methods
 ///
 
 /// get_loiter_position_to_velocity - loiter position controller
-///     converts desired position held in _target vector to desired velocity
+///     converts desired position held in _target vector to desired velocity, and the feed forward acceleration to reach it
 void AC_WPNav::get_loiter_position_to_velocity(float dt, float max_speed_cms)
 {
     Vector3f curr = _inav->get_position();
@@ -555,35 +764,39 @@ void AC_WPNav::get_loiter_position_to_velocity(float dt, float max_speed_cms)
         desired_vel.y += _target_vel.y;
     }
 
-    // call velocity to acceleration controller
-    get_loiter_velocity_to_acceleration(desired_vel.x, desired_vel.y, dt);
+    // the feed forward acceleration is the change in velocity asked for over the position controller's period.  Taking
+    // it here rather than in the faster velocity controller keeps each step in the velocity from becoming a larger spike
+    if( dt == 0.0 ) {
+        _accel_ff.x = 0;
+        _accel_ff.y = 0;
+    } else {
+        _accel_ff.x = (desired_vel.x - _vel_last.x)/dt;
+        _accel_ff.y = (desired_vel.y - _vel_last.y)/dt;
+    }
+
+    // store this iteration's velocities for the next iteration
+    _vel_last.x = desired_vel.x;
+    _vel_last.y = desired_vel.y;
+
+    // run the velocity controller on the new velocity at the next main loop
+    _pos_last_update = hal.scheduler->millis();
+    _vel_next_us = hal.scheduler->micros();
 }
 
 /// get_loiter_velocity_to_acceleration - loiter velocity controller
 ///    converts desired velocities in lat/lon directions to accelerations in lat/lon frame
-void AC_WPNav::get_loiter_velocity_to_acceleration(float vel_lat, float vel_lon, float dt)
+void AC_WPNav::get_loiter_velocity_to_acceleration(float dt)
 {
     Vector3f vel_curr = _inav->get_velocity();  // current velocity in cm/s
     Vector3f vel_error;                         // The velocity error in cm/s.
     float accel_total;                          // total acceleration in cm/s/s
 
-    // reset last velocity if this controller has just been engaged or dt is zero
-    if( dt == 0.0 ) {
-        desired_accel.x = 0;
-        desired_accel.y = 0;
-    } else {
-        // feed forward desired acceleration calculation
-        desired_accel.x = (vel_lat - _vel_last.x)/dt;
-        desired_accel.y = (vel_lon - _vel_last.y)/dt;
-    }
-
-    // store this iteration's velocities for the next iteration
-    _vel_last.x = vel_lat;
-    _vel_last.y = vel_lon;
+    // feed forward acceleration from the position controller
+    desired_accel = _accel_ff;
 
     // calculate velocity error
-    vel_error.x = vel_lat - vel_curr.x;
-    vel_error.y = vel_lon - vel_curr.y;
+    vel_error.x = desired_vel.x - vel_curr.x;
+    vel_error.y = desired_vel.y - vel_curr.y;
 
     // combine feed foward accel with PID outpu from velocity error
     desired_accel.x += _pid_rate_lat->get_pid(vel_error.x, dt);
@@ -604,26 +817,30 @@ void AC_WPNav::get_loiter_velocity_to_acceleration(float vel_lat, float vel_lon,
 ///    converts desired accelerations provided in lat/lon frame to roll/pitch angles
 void AC_WPNav::get_loiter_acceleration_to_lean_angles(float accel_lat, float accel_lon)
 {
-    float z_accel_meas = -GRAVITY_MSS * 100;    // gravity in cm/s/s
-    float accel_forward;
-    float accel_right;
+    // the lean for an acceleration is atan(accel/gravity), so the rotation's terms are scaled by 1/gravity up front
+    const float accel_to_tan = 1.0f / (GRAVITY_MSS * 100.0f);
+    float tan_forward;
+    float tan_right;
 
     // To-Do: add 1hz filter to accel_lat, accel_lon
 
-    // rotate accelerations into body forward-right frame
-    accel_forward = accel_lat*_cos_yaw + accel_lon*_sin_yaw;
-    accel_right = -accel_lat*_sin_yaw + accel_lon*_cos_yaw;
+    // rotate accelerations into body forward-right frame, using the ahrs's cached yaw trig
+    const AP_AHRS::attitude_trig &trig = _ahrs->get_trig();
+    float cos_yaw = trig.cos_yaw * accel_to_tan;
+    float sin_yaw = trig.sin_yaw * accel_to_tan;
+    tan_forward = accel_lat*cos_yaw + accel_lon*sin_yaw;
+    tan_right = -accel_lat*sin_yaw + accel_lon*cos_yaw;
 
     // update angle targets that will be passed to stabilize controller
-    _desired_roll = constrain_float(fast_atan(accel_right*_cos_pitch/(-z_accel_meas))*(18000/M_PI), -MAX_LEAN_ANGLE, MAX_LEAN_ANGLE);
-    _desired_pitch = constrain_float(fast_atan(-accel_forward/(-z_accel_meas))*(18000/M_PI), -MAX_LEAN_ANGLE, MAX_LEAN_ANGLE);
+    _desired_roll = constrain_float(RadiansToCentiDegrees(fast_atan(tan_right*trig.cos_pitch)), -MAX_LEAN_ANGLE, MAX_LEAN_ANGLE);
+    _desired_pitch = constrain_float(RadiansToCentiDegrees(fast_atan(-tan_forward)), -MAX_LEAN_ANGLE, MAX_LEAN_ANGLE);
 }
 
 // get_bearing_cd - return bearing in centi-degrees between two positions
 // To-Do: move this to math library
 float AC_WPNav::get_bearing_cd(const Vector3f &origin, const Vector3f &destination) const
 {
-    float bearing = 9000 + atan2f(-(destination.x-origin.x), destination.y-origin.y) * 5729.57795f;
+    float bearing = 9000 + fast_atan2(-(destination.x-origin.x), destination.y-origin.y) * 5729.57795f;
     if (bearing < 0) {
         bearing += 36000;
     }
@@ -716,3 +933,204 @@ void AC_WPNav::calculate_wp_leash_length(bool climb)
         _track_leash_length = min(_wp_leash_z/pos_delta_unit_z, _wp_leash_xy/pos_delta_unit_xy);
     }
 }
+
+/// scurve_phase - times of the constant jerk and constant acceleration parts of a jerk limited change in speed.
+///     the acceleration ramps up for jerk_time, holds for accel_time, and ramps down for jerk_time
+void AC_WPNav::scurve_phase(float speed_change, float accel_max, float jerk, float &jerk_time, float &accel_time)
+{
+    if (speed_change >= accel_max * accel_max / jerk) {
+        // reaches the maximum acceleration
+        jerk_time = accel_max / jerk;
+        accel_time = speed_change / accel_max - jerk_time;
+    }else{
+        // the acceleration ramps straight back down again
+        jerk_time = safe_sqrt(speed_change / jerk);
+        accel_time = 0;
+    }
+}
+
+/// scurve_phase_distance - distance covered by a jerk limited change in speed between speed_a and speed_b
+float AC_WPNav::scurve_phase_distance(float speed_a, float speed_b, float accel_max, float jerk)
+{
+    float jerk_time, accel_time;
+    scurve_phase(fabsf(speed_b - speed_a), accel_max, jerk, jerk_time, accel_time);
+
+    // the speed profile is symmetric so the average speed is half way between
+    return (speed_a + speed_b) * 0.5f * (2.0f*jerk_time + accel_time);
+}
+
+/// calculate_scurve - plans the jerk limited speed profile of the intermediate target along the track,
+///     from speed_start to a stop at the destination, or to cruise speed if it is a fast waypoint
+void AC_WPNav::calculate_scurve(float speed_start)
+{
+    float jerk = _wp_jerk_cms;
+    if (jerk <= 0 && _flags.spline) {
+        // splines have no leash based target to fall back on
+        jerk = WPNAV_JERK;
+    }
+    float accel = 2.0f * _track_accel;      // the leash based target accelerates at twice the track acceleration too
+    float speed_max = _track_speed;
+
+    for (uint8_t i=0; i<WPNAV_SCURVE_SEGMENTS; i++) {
+        _scurve_time[i] = 0;
+        _scurve_jerk[i] = 0;
+    }
+    speed_start = constrain_float(speed_start, 0, speed_max);
+    _scurve.seg = 0;
+    _scurve.time = 0;
+    _scurve.pos = 0;
+    _scurve.vel = speed_start;
+    _scurve.accel = 0;
+
+    if (jerk <= 0 || accel <= 0 || speed_max <= 0 || _track_length <= 0) {
+        // nothing to plan, the target holds at the start of the track
+        _scurve.vel = 0;
+        return;
+    }
+
+    float speed_end = _flags.fast_waypoint ? speed_max : 0;
+
+    // find the fastest cruise speed which leaves room to slow down for the destination
+    float speed_cruise = speed_max;
+    if (scurve_phase_distance(speed_start, speed_cruise, accel, jerk) + scurve_phase_distance(speed_cruise, speed_end, accel, jerk) > _track_length) {
+        float low = max(speed_start, speed_end);
+        float high = speed_max;
+        if (scurve_phase_distance(speed_start, low, accel, jerk) + scurve_phase_distance(low, speed_end, accel, jerk) > _track_length) {
+            // too fast to stop in time, the target will stop at the destination and the position controller will brake
+            high = low;
+        }
+        for (uint8_t i=0; i<WPNAV_SCURVE_ITERATIONS; i++) {
+            float mid = (low + high) * 0.5f;
+            if (scurve_phase_distance(speed_start, mid, accel, jerk) + scurve_phase_distance(mid, speed_end, accel, jerk) > _track_length) {
+                high = mid;
+            }else{
+                low = mid;
+            }
+        }
+        speed_cruise = low;
+    }
+
+    // speed up (or slow down) to cruise speed, cruise, then slow down for the destination
+    float jerk_time, accel_time;
+    float jerk_start = speed_cruise >= speed_start ? jerk : -jerk;
+    float jerk_end = speed_end >= speed_cruise ? jerk : -jerk;
+
+    scurve_phase(fabsf(speed_cruise - speed_start), accel, jerk, jerk_time, accel_time);
+    _scurve_time[0] = jerk_time;    _scurve_jerk[0] = jerk_start;
+    _scurve_time[1] = accel_time;
+    _scurve_time[2] = jerk_time;    _scurve_jerk[2] = -jerk_start;
+
+    scurve_phase(fabsf(speed_end - speed_cruise), accel, jerk, jerk_time, accel_time);
+    _scurve_time[4] = jerk_time;    _scurve_jerk[4] = jerk_end;
+    _scurve_time[5] = accel_time;
+    _scurve_time[6] = jerk_time;    _scurve_jerk[6] = -jerk_end;
+
+    float distance = scurve_phase_distance(speed_start, speed_cruise, accel, jerk) + scurve_phase_distance(speed_cruise, speed_end, accel, jerk);
+    if (speed_cruise > 0 && distance < _track_length) {
+        _scurve_time[3] = (_track_length - distance) / speed_cruise;
+    }
+}
+
+/// advance_scurve - moves along the speed profile by dt and returns the distance along the track
+float AC_WPNav::advance_scurve(float dt)
+{
+    // move the start of segment state past any segments that finish within dt
+    while (_scurve.seg < WPNAV_SCURVE_SEGMENTS && _scurve.time + dt >= _scurve_time[_scurve.seg]) {
+        float t = _scurve_time[_scurve.seg];
+        float j = _scurve_jerk[_scurve.seg];
+        dt -= t - _scurve.time;
+        _scurve.pos += ((j*t/6.0f + _scurve.accel*0.5f)*t + _scurve.vel)*t;
+        _scurve.vel += (j*t*0.5f + _scurve.accel)*t;
+        _scurve.accel += j*t;
+        _scurve.time = 0;
+        _scurve.seg++;
+    }
+    if (_scurve.seg >= WPNAV_SCURVE_SEGMENTS) {
+        // finished, carry on at the end speed
+        _scurve.accel = 0;
+    }
+    _scurve.time += dt;
+
+    // position within the current segment
+    float t = _scurve.time;
+    float j = _scurve.seg < WPNAV_SCURVE_SEGMENTS ? _scurve_jerk[_scurve.seg] : 0;
+    return _scurve.pos + ((j*t/6.0f + _scurve.accel*0.5f)*t + _scurve.vel)*t;
+}
+
+/// calculate_spline - sets up the forward differences of the spline from the origin to the destination, with tangents m0 and m1.
+///     the curve is the cubic Hermite segment P(u) = ((a*u + b)*u + m0)*u + origin for u from 0 to 1, and is evaluated at equal
+///     steps of u, so each update only adds the differences up rather than evaluating the cubic
+void AC_WPNav::calculate_spline(Vector3f m0, Vector3f m1)
+{
+    Vector3f chord = _destination - _origin;
+    float chord_length = chord.length();
+
+    // keep the tangents in proportion to the segment, long ones make the curve loop
+    float tangent_max = chord_length * WPNAV_SPLINE_TANGENT_MAX;
+    float m0_length = m0.length();
+    float m1_length = m1.length();
+    if (m0_length > tangent_max) {
+        m0 *= tangent_max / m0_length;
+    }
+    if (m1_length > tangent_max) {
+        m1 *= tangent_max / m1_length;
+    }
+    _spline_tangent = m1;
+
+    Vector3f a = chord * -2.0f + m0 + m1;
+    Vector3f b = chord * 3.0f - m0 * 2.0f - m1;
+
+    // measure the curve along a few chords, which is close enough to the length along the fine ones to plan the speed profile
+    float h = 1.0f / WPNAV_SPLINE_LENGTH_STEPS;
+    float h2 = h * h;
+    float h3 = h2 * h;
+    Vector3f delta1 = a * h3 + b * h2 + m0 * h;
+    Vector3f delta2 = a * (6.0f * h3) + b * (2.0f * h2);
+    Vector3f delta3 = a * (6.0f * h3);
+    float length = 0;
+    for (uint8_t i=0; i<WPNAV_SPLINE_LENGTH_STEPS; i++) {
+        length += delta1.length();
+        delta1 += delta2;
+        delta2 += delta3;
+    }
+
+    _spline_steps = constrain_float(length / WPNAV_SPLINE_STEP, WPNAV_SPLINE_STEPS_MIN, WPNAV_SPLINE_STEPS_MAX);
+    h = 1.0f / _spline_steps;
+    h2 = h * h;
+    h3 = h2 * h;
+    _spline_point = _origin;
+    _spline_delta1 = a * h3 + b * h2 + m0 * h;
+    _spline_delta2 = a * (6.0f * h3) + b * (2.0f * h2);
+    _spline_delta3 = a * (6.0f * h3);
+    _spline_chord = _spline_delta1.length();
+    _spline_walked = 0;
+    _spline_step = 0;
+
+    // plan the speed profile along the curve rather than the straight track
+    _flags.spline = true;
+    _track_length = length;
+    calculate_scurve(_limited_speed_xy_cms);
+}
+
+/// advance_spline - walks the spline's chords up to distance along it, and returns the point there
+Vector3f AC_WPNav::advance_spline(float distance)
+{
+    while (_spline_step < _spline_steps && _spline_walked + _spline_chord <= distance) {
+        _spline_walked += _spline_chord;
+        _spline_point += _spline_delta1;
+        _spline_delta1 += _spline_delta2;
+        _spline_delta2 += _spline_delta3;
+        _spline_step++;
+        _spline_chord = _spline_delta1.length();
+    }
+
+    if (_spline_step >= _spline_steps) {
+        // the destination itself, rather than the sum of the differences
+        return _destination;
+    }
+    if (_spline_chord <= 0) {
+        return _spline_point;
+    }
+    // interpolate along the current chord
+    return _spline_point + _spline_delta1 * ((distance - _spline_walked) / _spline_chord);
+}
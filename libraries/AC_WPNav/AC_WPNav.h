@@ -4,6 +4,7 @@
 
 #include <inttypes.h>
 #include <AP_Common.h>
+#include <AP_HAL.h>
 #include <AP_Param.h>
 #include <AP_Math.h>
 #include <AC_PID.h>             // PID library
@@ -35,6 +36,26 @@
 
 #define WPNAV_MIN_LEASH_LENGTH          100.0f      // minimum leash lengths in cm
 
+#define WPNAV_JERK                      500.0f      // default jerk in cm/s/s/s of the intermediate target along the track, 0 to use the leash based target
+#define WPNAV_SCURVE_SEGMENTS           7           // constant jerk segments in a track's speed profile
+#define WPNAV_SCURVE_ITERATIONS         12          // bisection steps to find the cruise speed of a short track
+
+#define WPNAV_SPLINE                    0           // default for flying the waypoints of missions as a spline through them
+#define WPNAV_SPLINE_STEP               200.0f      // length in cm of the chords the spline is evaluated at
+#define WPNAV_SPLINE_STEPS_MIN          8           // fewest chords a spline segment is split into
+#define WPNAV_SPLINE_STEPS_MAX          255         // most chords a spline segment is split into
+#define WPNAV_SPLINE_LENGTH_STEPS       16          // chords a spline segment is measured along
+#define WPNAV_SPLINE_TANGENT_MAX        2.0f        // tangents are limited to this many times the segment's length so short segments don't loop
+
+// rate of the velocity and acceleration loops, which run from the main loop between the updates of the position loop
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+ #define WPNAV_VEL_RATE                 10          // default rate in hz, the same as the position loop so the cpu load is unchanged
+#else
+ #define WPNAV_VEL_RATE                 50          // default rate in hz
+#endif
+#define WPNAV_VEL_JITTER_US             500         // a velocity loop call this early is taken as on time
+#define WPNAV_VEL_TIMEOUT_MS            1000        // the velocity loop stops when the position loop hasn't run for this long
+
 class AC_WPNav
 {
 public:
@@ -55,6 +76,10 @@ public:
     /// init_loiter_target - set initial loiter target based on current position and velocity
     void init_loiter_target(const Vector3f& position, const Vector3f& velocity);
 
+    /// set_moving_target - set loiter target in cm from home, moving at velocity in cm/s.  The target keeps moving at that
+    ///     velocity until the next call, which is fed forward to the position controller in place of pilot input
+    void set_moving_target(const Vector3f& position, const Vector3f& velocity);
+
     /// move_loiter_target - move destination using pilot input
     void move_loiter_target(float control_roll, float control_pitch, float dt);
 
@@ -64,7 +89,7 @@ public:
     /// get_bearing_to_target - get bearing to loiter target in centi-degrees
     int32_t get_bearing_to_target() const;
 
-    /// update_loiter - run the loiter controller - should be called at 10hz
+    /// update_loiter - run the loiter position controller - should be called at 10hz, or at the gps rate
     void update_loiter();
 
     /// get_stopping_point - returns vector to stopping point based on a horizontal position and velocity
@@ -83,6 +108,16 @@ public:
     /// set_origin_and_destination - set origin and destination waypoints using position vectors (distance from home in cm)
     void set_origin_and_destination(const Vector3f& origin, const Vector3f& destination);
 
+    /// shift_origin - move the targets by the shift returned when inertial nav's origin was moved, so they stay at the same locations
+    void shift_origin(const Vector2f &shift);
+
+    /// set_spline_destination - set destination using position vectors (distance from home in cm), flying a spline from the origin.
+    ///     unless stop_at_destination is set the spline leaves the destination heading towards next_destination
+    void set_spline_destination(const Vector3f& destination, bool stop_at_destination, const Vector3f& next_destination);
+
+    /// spline_enabled - true if missions should fly their waypoints as a spline
+    bool spline_enabled() const { return _wp_spline != 0; }
+
     /// advance_target_along_track - move target location along track from origin to destination
     void advance_target_along_track(float dt);
 
@@ -96,11 +131,16 @@ public:
     bool reached_destination() const { return _flags.reached_destination; }
 
     /// set_fast_waypoint - set to true to ignore the waypoint radius and consider the waypoint 'reached' the moment the intermediate point reaches it
-    void set_fast_waypoint(bool fast) { _flags.fast_waypoint = fast; }
+    ///     the intermediate point then doesn't slow down for the waypoint, so call this straight after setting the destination
+    void set_fast_waypoint(bool fast);
 
-    /// update_wp - update waypoint controller
+    /// update_wp - update waypoint position controller - should be called at 10hz, or at the gps rate
     void update_wpnav();
 
+    /// update_velocity - run the velocity and acceleration controllers, which turn the velocity asked for by the loiter or
+    ///     waypoint position controller into lean angles.  Call from the main loop; they run at the VEL_RATE parameter's rate
+    void update_velocity();
+
     ///
     /// shared methods
     ///
@@ -115,13 +155,6 @@ public:
     /// set_desired_alt - set desired altitude (in cm above home)
     void set_desired_alt(float desired_alt) { _target.z = desired_alt; }
 
-    /// set_cos_sin_yaw - short-cut to save on calculations to convert from roll-pitch frame to lat-lon frame
-    void set_cos_sin_yaw(float cos_yaw, float sin_yaw, float cos_pitch) {
-        _cos_yaw = cos_yaw;
-        _sin_yaw = sin_yaw;
-        _cos_pitch = cos_pitch;
-    }
-
     /// set_althold_kP - pass in alt hold controller's P gain
     void set_althold_kP(float kP) { if(kP>0.0) _althold_kP = kP; }
 
@@ -150,18 +183,23 @@ protected:
     struct wpnav_flags {
         uint8_t reached_destination     : 1;    // true if we have reached the destination
         uint8_t fast_waypoint           : 1;    // true if we should ignore the waypoint radius and consider the waypoint complete once the intermediate target has reached the waypoint
+        uint8_t spline                  : 1;    // true if the track from origin to destination is a spline
+        uint8_t moving_target           : 1;    // true if the loiter target moves on its own rather than by pilot input
     } _flags;
 
     /// translate_loiter_target_movements - consumes adjustments created by move_loiter_target
     void translate_loiter_target_movements(float nav_dt);
 
+    /// constrain_loiter_target - keep loiter target within leash of current location
+    void constrain_loiter_target();
+
     /// get_loiter_position_to_velocity - loiter position controller
-    ///     converts desired position held in _target vector to desired velocity
+    ///     converts desired position held in _target vector to desired velocity, and the feed forward acceleration to reach it
     void get_loiter_position_to_velocity(float dt, float max_speed_cms);
 
     /// get_loiter_velocity_to_acceleration - loiter velocity controller
     ///    converts desired velocities in lat/lon directions to accelerations in lat/lon frame
-    void get_loiter_velocity_to_acceleration(float vel_lat_cms, float vel_lon_cms, float dt);
+    void get_loiter_velocity_to_acceleration(float dt);
 
     /// get_loiter_acceleration_to_lean_angles - loiter acceleration controller
     ///    converts desired accelerations provided in lat/lon frame to roll/pitch angles
@@ -180,6 +218,28 @@ protected:
     ///    set climb param to true if track climbs vertically, false if descending
     void calculate_wp_leash_length(bool climb);
 
+    /// calculate_scurve - plans the jerk limited speed profile of the intermediate target along the track,
+    ///     from speed_start to a stop at the destination, or to cruise speed if it is a fast waypoint
+    void calculate_scurve(float speed_start);
+
+    /// scurve_phase - times of the constant jerk and constant acceleration parts of a jerk limited change in speed
+    static void scurve_phase(float speed_change, float accel_max, float jerk, float &jerk_time, float &accel_time);
+
+    /// scurve_phase_distance - distance covered by a jerk limited change in speed between speed_a and speed_b
+    static float scurve_phase_distance(float speed_a, float speed_b, float accel_max, float jerk);
+
+    /// update_reached_destination - sets the reached_destination flag once the intermediate target is at the destination
+    void update_reached_destination(const Vector3f& curr_pos);
+
+    /// advance_scurve - moves along the speed profile by dt and returns the distance along the track
+    float advance_scurve(float dt);
+
+    /// calculate_spline - sets up the forward differences of the spline from the origin to the destination, with tangents m0 and m1
+    void calculate_spline(Vector3f m0, Vector3f m1);
+
+    /// advance_spline - walks the spline's chords up to distance along it, and returns the point there
+    Vector3f advance_spline(float distance);
+
     // pointers to inertial nav and ahrs libraries
     AP_InertialNav*	_inav;
     AP_AHRS*        _ahrs;
@@ -199,9 +259,10 @@ protected:
     AP_Float    _wp_accel_cms;          // acceleration in cm/s/s during missions
     uint32_t	_loiter_last_update;    // time of last update_loiter call
     uint32_t	_wpnav_last_update;     // time of last update_wpnav call
-    float       _cos_yaw;               // short-cut to save on calcs required to convert roll-pitch frame to lat-lon frame
-    float       _sin_yaw;
-    float       _cos_pitch;
+    uint32_t    _pos_last_update;       // time of the last run of either position controller
+    AP_Int8     _vel_rate_hz;           // rate of the velocity and acceleration controllers in hz
+    uint32_t    _vel_next_us;           // time the velocity controller is due to run next
+    uint32_t    _vel_last_update_us;    // time the velocity controller last ran
     float       _althold_kP;            // alt hold's P gain
 
     // output from controller
@@ -214,7 +275,9 @@ protected:
     int16_t     _pilot_vel_right_cms;   // pilot's desired velocity right (body-frame)
     Vector3f    _target_vel;            // pilot's latest desired velocity in earth-frame
     Vector3f    _vel_last;              // previous iterations velocity in cm/s
+    Vector2f    _accel_ff;              // feed forward acceleration in cm/s/s to the position controller's latest velocity
     float       _loiter_leash;          // loiter's horizontal leash length in cm.  used to stop the pilot from pushing the target location too far from the current location
+    uint16_t    _loiter_leash_params;   // AP_Param::change_count() when the loiter leash was calculated
     float       _loiter_accel_cms;      // loiter's acceleration in cm/s/s
 
     // waypoint controller internal variables
@@ -230,17 +293,35 @@ protected:
     float       _track_accel;           // acceleration along track
     float       _track_speed;           // speed in cm/s along track
     float       _track_leash_length;    // leash length along track
+    AP_Float    _wp_jerk_cms;           // jerk in cm/s/s/s of the intermediate target, 0 to use the leash based target
+
+    // jerk limited speed profile along the track, calculated by calculate_scurve
+    float       _scurve_time[WPNAV_SCURVE_SEGMENTS];    // duration of each segment in seconds
+    float       _scurve_jerk[WPNAV_SCURVE_SEGMENTS];    // jerk of each segment in cm/s/s/s
+    struct scurve_state {
+        uint8_t seg;                    // current segment, WPNAV_SCURVE_SEGMENTS once the profile is finished
+        float   time;                   // time into the current segment
+        float   pos;                    // distance along the track at the start of the current segment
+        float   vel;                    // speed at the start of the current segment
+        float   accel;                  // acceleration at the start of the current segment
+    } _scurve;
+
+    // spline track, evaluated by forward differences at WPNAV_SPLINE_STEP spaced chords
+    AP_Int8     _wp_spline;             // 1 to fly the waypoints of missions as a spline
+    Vector3f    _spline_tangent;        // tangent at the destination, the start tangent of a spline continuing from it
+    Vector3f    _spline_point;          // start of the current chord
+    Vector3f    _spline_delta1;         // first forward difference, the current chord
+    Vector3f    _spline_delta2;         // second forward difference
+    Vector3f    _spline_delta3;         // third forward difference, constant along the segment
+    float       _spline_chord;          // length of the current chord
+    float       _spline_walked;         // distance along the spline to the start of the current chord
+    uint8_t     _spline_step;           // index of the current chord
+    uint8_t     _spline_steps;          // number of chords in the segment
 
 public:
     // for logging purposes
     Vector2f dist_error;                // distance error calculated by loiter controller
     Vector2f desired_vel;               // loiter controller desired velocity
     Vector2f desired_accel;             // the resulting desired acceleration
-
-    // To-Do: add split of fast (100hz for accel->angle) and slow (10hz for navigation)
-    /// update - run the loiter and wpnav controllers - should be called at 100hz
-    //void update_100hz(void);
-    /// update - run the loiter and wpnav controllers - should be called at 10hz
-    //void update_10hz(void);
 };
 #endif	// AC_WPNAV_H
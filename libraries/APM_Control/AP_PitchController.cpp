@@ -98,16 +98,16 @@ const AP_Param::GroupInfo AP_PitchController::var_info[] PROGMEM = {
 */
 int32_t AP_PitchController::_get_rate_out(float desired_rate, float scaler, bool stabilize, float aspeed)
 {
-	uint32_t tnow = hal.scheduler->millis();
+	uint32_t tnow = hal.scheduler->micros();
 	uint32_t dt = tnow - _last_t;
 	
-	if (_last_t == 0 || dt > 1000) {
+	if (_last_t == 0 || dt > 1000000) {
 		dt = 0;
 	}
 	_last_t = tnow;
 	
 	if(_ahrs == NULL) return 0;
-	float delta_time    = (float)dt * 0.001f;
+	float delta_time    = (float)dt * 1.0e-6f;
 	
 	// Get body rate vector (radians/sec)
 	float omega_y = _ahrs->get_gyro().y;
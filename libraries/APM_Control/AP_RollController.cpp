@@ -75,9 +75,11 @@ const AP_Param::GroupInfo AP_RollController::var_info[] PROGMEM = {
 */
 int32_t AP_RollController::_get_rate_out(float desired_rate, float scaler, bool stabilize)
 {
-	uint32_t tnow = hal.scheduler->millis();
+	// in microseconds, so the time step is still accurate when the
+	// control loop runs at 100 or 200Hz
+	uint32_t tnow = hal.scheduler->micros();
 	uint32_t dt = tnow - _last_t;
-	if (_last_t == 0 || dt > 1000) {
+	if (_last_t == 0 || dt > 1000000) {
 		dt = 0;
 	}
 	_last_t = tnow;
@@ -92,7 +94,7 @@ int32_t AP_RollController::_get_rate_out(float desired_rate, float scaler, bool
     // No conversion is required for K_D
 	float ki_rate = _K_I * _tau;
 	float kp_ff = max((_K_P - _K_I * _tau) * _tau  - _K_D , 0)/_ahrs->get_EAS2TAS();
-	float delta_time    = (float)dt * 0.001f;
+	float delta_time    = (float)dt * 1.0e-6f;
 	
 	// Limit the demanded roll rate
 	if (_max_rate && desired_rate < -_max_rate) {
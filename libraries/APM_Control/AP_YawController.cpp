@@ -64,9 +64,9 @@ const AP_Param::GroupInfo AP_YawController::var_info[] PROGMEM = {
 
 int32_t AP_YawController::get_servo_out(float scaler, bool stabilize)
 {
-	uint32_t tnow = hal.scheduler->millis();
+	uint32_t tnow = hal.scheduler->micros();
 	uint32_t dt = tnow - _last_t;
-	if (_last_t == 0 || dt > 1000) {
+	if (_last_t == 0 || dt > 1000000) {
 		dt = 0;
 	}
 	_last_t = tnow;
@@ -80,7 +80,7 @@ int32_t AP_YawController::get_servo_out(float scaler, bool stabilize)
         aspd_min = 1;
     }
 	
-	float delta_time = (float) dt / 1000.0f;
+	float delta_time = (float)dt * 1.0e-6f;
 	
 	// Calculate yaw rate required to keep up with a constant height coordinated turn
 	float aspeed;
@@ -108,9 +108,10 @@ int32_t AP_YawController::get_servo_out(float scaler, bool stabilize)
 	
 	// Apply a high-pass filter to the rate to washout any steady state error
 	// due to bias errors in rate_offset
-	// Use a cut-off frequency of omega = 0.2 rad/sec
-	// Could make this adjustable by replacing 0.9960080 with (1 - omega * dt)
-	float rate_hp_out = 0.9960080f * _last_rate_hp_out + rate_hp_in - _last_rate_hp_in;
+	// Use a cut-off frequency of omega = 0.2 rad/sec. The coefficient
+	// is (1 - omega * dt), which is 0.9960080 at 50Hz
+	float hp_coef = max(1.0f - 0.1996f * delta_time, 0);
+	float rate_hp_out = hp_coef * _last_rate_hp_out + rate_hp_in - _last_rate_hp_in;
 	_last_rate_hp_out = rate_hp_out;
 	_last_rate_hp_in = rate_hp_in;
 
@@ -44,6 +44,16 @@ public:
 
     virtual uint16_t        num_samples_available(const uint8_t *channel_numbers) = 0;
 
+    /* set the rate in Hz one channel is sampled at. Each sample is the
+     * average of the conversions since the last, and while a rate is
+     * set Ch() returns the latest sample. 0 goes back to averaging
+     * since the last call of Ch() */
+    virtual void            set_sample_rate(uint8_t ch_num, uint16_t rate_hz) = 0;
+
+    /* true once for each sample of a channel, with the system time in
+     * milliseconds it was completed */
+    virtual bool            sample_ready(uint8_t ch_num, uint32_t &time_ms) = 0;
+
 private:
 };
 
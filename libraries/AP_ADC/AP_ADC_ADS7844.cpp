@@ -65,6 +65,17 @@ static volatile uint32_t _sum[8];
 // how many values we've accumulated since last read
 static volatile uint16_t _count[8];
 
+// the decimating filter for channels with a sample rate. Conversions
+// are made at 1kHz, so the period is counted in conversions. The sum
+// and count of each sample are kept so the division is left to Ch()
+static uint16_t _sample_period[8];          // 0 for no sample rate
+static uint32_t _dec_sum[8];
+static uint16_t _dec_count[8];
+static volatile uint32_t _sample_sum[8];
+static volatile uint16_t _sample_count[8];
+static volatile uint32_t _sample_time_ms[8];
+static volatile uint8_t _sample_ready;      // bitmask of channels with a new sample
+
 // variables to calculate time period over which a group of samples were
 // collected
 // time we start collecting sample (reset on update)
@@ -97,6 +108,7 @@ void AP_ADC_ADS7844::read(uint32_t tnow)
     uint8_t rx[17];
     _spi->transaction(adc_cmd, rx, 17);
 
+    uint32_t now_ms = hal.scheduler->millis();
     for (ch = 0; ch < 8; ch++) {
         uint16_t v = (rx[2*ch+1] << 8) | rx[2*ch+2];
         if (v & 0x8007) {
@@ -115,6 +127,21 @@ void AP_ADC_ADS7844::read(uint32_t tnow)
             _count[ch] = 1;
         }
         _sum[ch] += (v >> 3);
+
+        if (_sample_period[ch] != 0) {
+            _dec_sum[ch] += (v >> 3);
+            if (++_dec_count[ch] >= _sample_period[ch]) {
+                _sample_sum[ch] = _dec_sum[ch];
+                _sample_count[ch] = _dec_count[ch];
+                _sample_time_ms[ch] = now_ms;
+                _sample_ready |= (1U << ch);
+                _dec_sum[ch] = 0;
+                _dec_count[ch] = 0;
+            }
+        } else {
+            _sample_time_ms[ch] = now_ms;
+            _sample_ready |= (1U << ch);
+        }
     }
 
     _spi_sem->give();
@@ -171,12 +198,69 @@ void AP_ADC_ADS7844::Init()
 
 }
 
+/*
+  samples may be read from another timer process, which can't suspend
+  the timer processes and doesn't need to, as they don't interrupt
+  each other
+ */
+static bool lock_samples(void)
+{
+    if (hal.scheduler->in_timerprocess()) {
+        return false;
+    }
+    hal.scheduler->suspend_timer_procs();
+    return true;
+}
+
+static void unlock_samples(bool locked)
+{
+    if (locked) {
+        hal.scheduler->resume_timer_procs();
+    }
+}
+
+void AP_ADC_ADS7844::set_sample_rate(uint8_t ch_num, uint16_t rate_hz)
+{
+    hal.scheduler->suspend_timer_procs();
+    _sample_period[ch_num] = rate_hz ? 1000 / rate_hz : 0;
+    _dec_sum[ch_num] = 0;
+    _dec_count[ch_num] = 0;
+    _sample_count[ch_num] = 0;
+    _sample_ready &= ~(1U << ch_num);
+    hal.scheduler->resume_timer_procs();
+}
+
+bool AP_ADC_ADS7844::sample_ready(uint8_t ch_num, uint32_t &time_ms)
+{
+    if ((_sample_ready & (1U << ch_num)) == 0) {
+        return false;
+    }
+    bool locked = lock_samples();
+    time_ms = _sample_time_ms[ch_num];
+    _sample_ready &= ~(1U << ch_num);
+    unlock_samples(locked);
+    return true;
+}
+
 // Read one channel value
 float AP_ADC_ADS7844::Ch(uint8_t ch_num)
 {
     uint16_t count;
     uint32_t sum;
 
+    if (_sample_period[ch_num] != 0) {
+        // the latest sample, or the average so far until there is one
+        bool locked = lock_samples();
+        count = _sample_count[ch_num];
+        sum   = _sample_sum[ch_num];
+        if (count == 0) {
+            count = _count[ch_num];
+            sum   = _sum[ch_num];
+        }
+        unlock_samples(locked);
+        return count ? ((float)sum)/count : 0;
+    }
+
     // ensure we have at least one value
     while (_count[ch_num] == 0) /* noop */;
 
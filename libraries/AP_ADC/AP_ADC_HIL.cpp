@@ -77,3 +77,9 @@ uint16_t AP_ADC_HIL::num_samples_available(const uint8_t *channel_numbers)
 {
     return _count;
 }
+
+bool AP_ADC_HIL::sample_ready(uint8_t ch_num, uint32_t &time_ms)
+{
+    time_ms = hal.scheduler->millis();
+    return true;
+}
@@ -44,6 +44,10 @@ public:
     // Get minimum number of samples read from the sensors
     uint16_t        num_samples_available(const uint8_t *channel_numbers);
 
+    // the values come from the GCS, so every read is a sample
+    void            set_sample_rate(uint8_t ch_num, uint16_t rate_hz) {}
+    bool            sample_ready(uint8_t ch_num, uint32_t &time_ms);
+
 private:
 
     ///
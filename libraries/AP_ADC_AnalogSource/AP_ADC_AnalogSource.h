@@ -21,6 +21,9 @@ public:
     void set_stop_pin(uint8_t p) {}
     void set_settle_time(uint16_t settle_time_ms) {}
 
+    void set_sample_rate(uint16_t rate_hz) { _adc->set_sample_rate(_ch, rate_hz); }
+    bool sample_ready(uint32_t &time_ms) { return _adc->sample_ready(_ch, time_ms); }
+
 private:
     AP_ADC *        _adc;
     uint8_t         _ch;
@@ -97,6 +97,15 @@ const AP_Param::GroupInfo AP_AHRS::var_info[] PROGMEM = {
     // @User: Advanced
     AP_GROUPINFO("GPS_MINSATS", 11, AP_AHRS, _gps_minsats, 6),
 
+#if AP_AHRS_NAVEKF_AVAILABLE
+    // @Param: EKF_USE
+    // @DisplayName: Use NavEKF Kalman filter for attitude and position estimation
+    // @Description: This enables the navigation EKF. It runs alongside DCM and is used for attitude, position and wind once it has started, which needs a 3D GPS fix. If it stops, for example after losing GPS for 10 seconds, DCM is used until it restarts. A reboot is not needed to change this
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("EKF_USE",  12, AP_AHRS, _ekf_use, 0),
+#endif
+
     AP_GROUPEND
 };
 
@@ -159,7 +168,7 @@ Vector2f AP_AHRS::groundspeed_vector(void)
     if (gotAirspeed) {
 	    Vector3f wind = wind_estimate();
 	    Vector2f wind2d = Vector2f(wind.x, wind.y);
-	    Vector2f airspeed_vector = Vector2f(cosf(yaw), sinf(yaw)) * airspeed;
+	    Vector2f airspeed_vector = Vector2f(_trig.cos_yaw, _trig.sin_yaw) * airspeed;
 	    gndVelADS = airspeed_vector - wind2d;
     }
     
@@ -203,7 +212,7 @@ Vector2f AP_AHRS::groundspeed_vector(void)
 /*
   get position projected by groundspeed and heading
  */
-bool AP_AHRS::get_projected_position(struct Location *loc)
+bool AP_AHRS::get_projected_position(struct Position *loc)
 {
         if (!get_position(loc)) {
 		return false;
@@ -211,3 +220,37 @@ bool AP_AHRS::get_projected_position(struct Location *loc)
         location_update(loc, degrees(yaw), _gps->ground_speed_cm * 0.01 * _gps->get_lag());
         return true;
 }
+
+/*
+  calculate the sines and cosines of the euler angles directly from
+  the DCM matrix. Only the roll and yaw terms need a division, and
+  cos(pitch) is never negative as pitch is limited to +-90 degrees
+ */
+void AP_AHRS::update_trig(void)
+{
+    const Matrix3f &m = get_dcm_matrix();
+    Vector2f yawvector(m.a.x, m.b.x);
+
+    _trig.cos_pitch = constrain_float(safe_sqrt(1 - (m.c.x * m.c.x)), 0, 1.0f);
+    _trig.sin_pitch = -m.c.x;
+
+    if (_trig.cos_pitch > 0) {
+        _trig.cos_roll = constrain_float(m.c.z / _trig.cos_pitch, -1.0f, 1.0f);
+        _trig.sin_roll = constrain_float(m.c.y / _trig.cos_pitch, -1.0f, 1.0f);
+    } else {
+        // roll is undefined pointing straight up or down
+        _trig.cos_roll = 1;
+        _trig.sin_roll = 0;
+    }
+
+    // the yaw vector has length cos(pitch), so normalise it rather
+    // than dividing each term
+    yawvector.normalize();
+    if (yawvector.is_inf() || yawvector.is_nan()) {
+        _trig.cos_yaw = 1;
+        _trig.sin_yaw = 0;
+    } else {
+        _trig.cos_yaw = constrain_float(yawvector.x, -1.0f, 1.0f);
+        _trig.sin_yaw = constrain_float(yawvector.y, -1.0f, 1.0f);
+    }
+}
@@ -22,6 +22,23 @@
 
 #define AP_AHRS_TRIM_LIMIT 10.0f        // maximum trim angle in degrees
 
+// the navigation EKF needs more memory and CPU than the AVR boards have
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+#define AP_AHRS_NAVEKF_AVAILABLE 0
+#else
+#define AP_AHRS_NAVEKF_AVAILABLE 1
+#endif
+
+// the AVR boards have no FPU, so DCM keeps its matrix in fixed point
+// there. _dcm_matrix is then a float copy for everyone else to read
+#ifndef AP_AHRS_DCM_FIXED
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+#define AP_AHRS_DCM_FIXED 1
+#else
+#define AP_AHRS_DCM_FIXED 0
+#endif
+#endif
+
 class AP_AHRS
 {
 public:
@@ -42,6 +59,10 @@ public:
 
         // enable centrifugal correction by default
         _flags.correct_centrifugal = true;
+
+        // level until the first update
+        _trig.cos_roll = _trig.cos_pitch = _trig.cos_yaw = 1;
+        _trig.sin_roll = _trig.sin_pitch = _trig.sin_yaw = 0;
     }
 
     // init sets up INS board orientation
@@ -77,6 +98,10 @@ public:
         _airspeed = airspeed;
     }
 
+    void set_barometer(AP_Baro *baro) {
+        _baro = baro;
+    }
+
     AP_InertialSensor* get_ins() const {
 	    return _ins;
     }
@@ -97,6 +122,18 @@ public:
     int32_t pitch_sensor;
     int32_t yaw_sensor;
 
+    // sines and cosines of the Euler angles, taken from the DCM
+    // matrix once per update so callers don't need any trig
+    struct attitude_trig {
+        float cos_roll;
+        float sin_roll;
+        float cos_pitch;
+        float sin_pitch;
+        float cos_yaw;
+        float sin_yaw;
+    };
+    const struct attitude_trig &get_trig(void) const { return _trig; }
+
     // return a smoothed and corrected gyro vector
     virtual const Vector3f get_gyro(void) const = 0;
 
@@ -127,8 +164,8 @@ public:
     // get our current position, either from GPS or via
     // dead-reckoning. Return true if a position is available,
     // otherwise false. This only updates the lat and lng fields
-    // of the Location
-    virtual bool get_position(struct Location *loc) {
+    // of the Position
+    virtual bool get_position(struct Position *loc) {
         if (!_gps || _gps->status() <= GPS::NO_FIX) {
             return false;
         }
@@ -139,7 +176,7 @@ public:
 
     // get our projected position, based on our GPS position plus
     // heading and ground speed
-    bool get_projected_position(struct Location *loc);
+    bool get_projected_position(struct Position *loc);
 
     // return a wind estimation vector, in m/s
     virtual Vector3f wind_estimate(void) {
@@ -214,12 +251,19 @@ public:
     AP_Float gps_gain;
 
 protected:
+    // recalculate _trig from the DCM matrix. Called by subclasses
+    // at the end of each update
+    void update_trig(void);
+
     // settable parameters
     AP_Float beta;
     AP_Int8 _gps_use;
     AP_Int8 _wind_max;
     AP_Int8 _board_orientation;
     AP_Int8 _gps_minsats;
+#if AP_AHRS_NAVEKF_AVAILABLE
+    AP_Int8 _ekf_use;
+#endif
 
     // flags structure
     struct ahrs_flags {
@@ -236,6 +280,9 @@ protected:
     // pointer to airspeed object, if available
     AP_Airspeed     * _airspeed;
 
+    // pointer to barometer object, if available
+    AP_Baro         * _baro;
+
     // time in microseconds of last compass update
     uint32_t _compass_last_update;
 
@@ -254,6 +301,9 @@ protected:
     // accelerometer values in the earth frame in m/s/s
     Vector3f        _accel_ef;
 
+    // cached attitude trig
+    struct attitude_trig _trig;
+
 	// Declare filter states for HPF and LPF used by complementary
 	// filter in AP_AHRS::groundspeed_vector
 	Vector2f _lp; // ground vector low-pass filter
@@ -262,6 +312,9 @@ protected:
 };
 
 #include <AP_AHRS_DCM.h>
+#include <AP_AHRS_Quaternion.h>
+#include <AP_NavEKF.h>
+#include <AP_AHRS_NavEKF.h>
 #include <AP_AHRS_MPU6000.h>
 #include <AP_AHRS_HIL.h>
 
@@ -32,16 +32,31 @@ extern const AP_HAL::HAL& hal;
 // http://gentlenav.googlecode.com/files/fastRotations.pdf
 #define SPIN_RATE_LIMIT 20
 
+// wind estimation. Fixes are forgotten over about WIND_MEMORY seconds.
+// The variances are in (m/s)^2
+#define WIND_MEMORY                 30.0f
+#define WIND_VARIANCE_INIT          25.0f   // of each wind component when starting
+#define WIND_AIRSPEED_VARIANCE_INIT 100.0f
+#define WIND_VELOCITY_NOISE         1.0f    // of the GPS velocity, including sideslip
+#define WIND_AIRSPEED_NOISE         4.0f    // of an airspeed sensor
+
 
 // run a full DCM update round
 void
 AP_AHRS_DCM::update(void)
 {
-    float delta_t;
-
     // tell the IMU to grab some data
     _ins->update();
 
+    update_attitude();
+}
+
+// update the attitude from the INS data of the last _ins->update()
+void
+AP_AHRS_DCM::update_attitude(void)
+{
+    float delta_t;
+
     // ask the IMU how much time this sensor reading represents
     delta_t = _ins->get_delta_time();
 
@@ -72,6 +87,9 @@ AP_AHRS_DCM::update(void)
 
     // Calculate pitch, roll, yaw for stabilization and navigation
     euler_angles();
+
+    // and their sines and cosines
+    update_trig();
 }
 
 // update the DCM matrix using only the gyros
@@ -85,7 +103,20 @@ AP_AHRS_DCM::matrix_update(float _G_Dt)
     // value
     _omega = _gyro_vector + _omega_I;
 
-    _dcm_matrix.rotate((_omega + _omega_P + _omega_yaw_P) * _G_Dt);
+    // if the IMU integrated its samples then use that rotation, which
+    // keeps the motion between updates that the averaged gyro loses
+    Vector3f delta_angle;
+    if (_ins->get_delta_angle(delta_angle)) {
+        delta_angle.multiply_add(_omega_I, _G_Dt);
+    } else {
+        delta_angle = _omega * _G_Dt;
+    }
+    delta_angle.multiply_add(_omega_P, _G_Dt).multiply_add(_omega_yaw_P, _G_Dt);
+#if AP_AHRS_DCM_FIXED
+    _dcm_fixed.rotate(to_fixed<30>(delta_angle));
+#else
+    _dcm_matrix.rotate(delta_angle);
+#endif
 }
 
 
@@ -106,13 +137,23 @@ AP_AHRS_DCM::reset(bool recover_eulers)
     // attitude then calculate the dcm matrix from the current
     // roll/pitch/yaw values
     if (recover_eulers && !isnan(roll) && !isnan(pitch) && !isnan(yaw)) {
-        _dcm_matrix.from_euler(roll, pitch, yaw);
+        attitude_from_euler(roll, pitch, yaw);
     } else {
         // otherwise make it flat
-        _dcm_matrix.from_euler(0, 0, 0);
+        attitude_from_euler(0, 0, 0);
     }
 }
 
+// set the attitude from euler angles
+void
+AP_AHRS_DCM::attitude_from_euler(float _roll, float _pitch, float _yaw)
+{
+    _dcm_matrix.from_euler(_roll, _pitch, _yaw);
+#if AP_AHRS_DCM_FIXED
+    _dcm_fixed = to_fixed(_dcm_matrix);
+#endif
+}
+
 /*
  *  check the DCM matrix for pathological values
  */
@@ -147,6 +188,12 @@ AP_AHRS_DCM::check_matrix(void)
     }
 }
 
+// rows whose squared length is within this of 1 are renormalised with
+// the taylor expansion of 1/sqrt(x) about 1, (3-x)/2. The error of
+// that is 3/8 of the squared length error, so at most 6e-5 here, and
+// it is removed on the next call
+#define RENORM_TAYLOR_LIMIT (1.0f/64)
+
 // renormalise one vector component of the DCM matrix
 // this will return false if renormalization fails
 bool
@@ -159,20 +206,30 @@ AP_AHRS_DCM::renorm(Vector3f const &a, Vector3f &result)
     // using the renormalization technique from the DCM IMU paper
     // (see equations 18 to 21).
 
-    // For APM we don't bother with the taylor expansion
-    // optimisation from the paper as on our 2560 CPU the cost of
-    // the sqrt() is 44 microseconds, and the small time saving of
-    // the taylor expansion is not worth the potential of
-    // additional error buildup.
+    // At normal update rates the rows only drift from unit length
+    // by a few parts per million, so the taylor expansion from the
+    // paper saves the sqrt() and divide, which cost over 80
+    // microseconds for the three rows on the 2560.
 
     // Note that we can get significant renormalisation values
     // when we have a larger delta_t due to a glitch eleswhere in
     // APM, such as a I2c timeout or a set of EEPROM writes. While
     // we would like to avoid these if possible, if it does happen
     // we don't want to compound the error by making DCM less
-    // accurate.
+    // accurate, so those take the exact path.
+
+    float length_sq = a * a;
+    if (fabsf(length_sq - 1.0f) < RENORM_TAYLOR_LIMIT) {
+        renorm_val = 0.5f * (3.0f - length_sq);
+        renorm_taylor_count++;
+        _renorm_val_sum += renorm_val;
+        _renorm_val_count++;
+        result = a * renorm_val;
+        return true;
+    }
 
-    renorm_val = 1.0f / a.length();
+    renorm_exact_count++;
+    renorm_val = 1.0f / safe_sqrt(length_sq);
 
     // keep the average for reporting
     _renorm_val_sum += renorm_val;
@@ -197,6 +254,58 @@ AP_AHRS_DCM::renorm(Vector3f const &a, Vector3f &result)
     return true;
 }
 
+#if AP_AHRS_DCM_FIXED
+// the fixed point renormalisation uses the same taylor expansion as
+// the float path, over the same range. Anything further out takes the
+// float path, which then does it exactly
+#define RENORM_FIXED_LIMIT Fixed28(RENORM_TAYLOR_LIMIT)
+#define RENORM_FIXED_MAX_ELEMENT Fixed30(1.5f)
+
+typedef Fixed<28> Fixed28;
+
+static bool
+renorm_fixed_in_range(const Fixed30 &v)
+{
+    return v < RENORM_FIXED_MAX_ELEMENT && v > -RENORM_FIXED_MAX_ELEMENT;
+}
+
+bool
+AP_AHRS_DCM::renorm(Vector3q30 const &a, Vector3q30 &result)
+{
+    Fixed28 error = RENORM_FIXED_LIMIT;
+
+    // the squared length is formed in Q4.28, which can't overflow
+    // once any element beyond 1.5 has been sent down the float path
+    if (renorm_fixed_in_range(a.x) &&
+        renorm_fixed_in_range(a.y) &&
+        renorm_fixed_in_range(a.z)) {
+        error = a.x * Fixed28::from_raw(a.x.raw() >> 2) +
+                a.y * Fixed28::from_raw(a.y.raw() >> 2) +
+                a.z * Fixed28::from_raw(a.z.raw() >> 2) - Fixed28(1);
+    }
+
+    if (!(error < RENORM_FIXED_LIMIT && error > -RENORM_FIXED_LIMIT)) {
+        Vector3f renormed;
+        if (!renorm(to_float(a), renormed)) {
+            return false;
+        }
+        result = to_fixed<30>(renormed);
+        return true;
+    }
+
+    // 1 - error/2, with error converted to Q2.30
+    Fixed30 renorm_val = Fixed30(1) - Fixed30::from_raw(error.raw() << 1);
+    renorm_taylor_count++;
+
+    // keep the average for reporting
+    _renorm_val_sum += renorm_val.to_float();
+    _renorm_val_count++;
+
+    result = a * renorm_val;
+    return true;
+}
+#endif
+
 /*************************************************
  *  Direction Cosine Matrix IMU: Theory
  *  William Premerlani and Paul Bizard
@@ -210,6 +319,24 @@ AP_AHRS_DCM::renorm(Vector3f const &a, Vector3f &result)
 void
 AP_AHRS_DCM::normalize(void)
 {
+#if AP_AHRS_DCM_FIXED
+    Fixed30 error_fixed;
+    Vector3q30 t0_fixed, t1_fixed, t2_fixed;
+
+    // the same steps as below, but in fixed point
+    error_fixed = (_dcm_fixed.a * _dcm_fixed.b) >> 1;
+
+    t0_fixed = _dcm_fixed.a - (_dcm_fixed.b * error_fixed);
+    t1_fixed = _dcm_fixed.b - (_dcm_fixed.a * error_fixed);
+    t2_fixed = t0_fixed % t1_fixed;
+
+    if (!renorm(t0_fixed, _dcm_fixed.a) ||
+        !renorm(t1_fixed, _dcm_fixed.b) ||
+        !renorm(t2_fixed, _dcm_fixed.c)) {
+        reset(true);
+    }
+    _dcm_matrix = to_float(_dcm_fixed);
+#else
     float error;
     Vector3f t0, t1, t2;
 
@@ -226,6 +353,7 @@ AP_AHRS_DCM::normalize(void)
         // to last euler angles
         reset(true);
     }
+#endif
 }
 
 
@@ -234,12 +362,9 @@ AP_AHRS_DCM::normalize(void)
 float
 AP_AHRS_DCM::yaw_error_compass(void)
 {
-    Vector3f mag = Vector3f(_compass->mag_x, _compass->mag_y, _compass->mag_z);
     // get the mag vector in the earth frame
-    Vector2f rb = _dcm_matrix.mulXY(mag);
-
-    rb.normalize();
-    if (rb.is_inf()) {
+    Vector2f rb;
+    if (!_compass->calculate_earth_field(_dcm_matrix, rb)) {
         // not a valid vector
         return 0.0;
     }
@@ -291,7 +416,7 @@ bool AP_AHRS_DCM::use_compass(void) const
         // we don't have any alterative to the compass
         return true;
     }
-    if (_gps->ground_speed_cm < GPS_SPEED_MIN) {
+    if (_gps_fix.ground_speed_cm < GPS_SPEED_MIN) {
         // we are not going fast enough to use the GPS
         return true;
     }
@@ -300,8 +425,8 @@ bool AP_AHRS_DCM::use_compass(void) const
     // degrees and the estimated wind speed is less than 80% of the
     // ground speed, then switch to GPS navigation. This will help
     // prevent flyaways with very bad compass offsets
-    int32_t error = abs(wrap_180_cd(yaw_sensor - _gps->ground_course_cd));
-    if (error > 4500 && _wind.length() < _gps->ground_speed_cm*0.008f) {
+    int32_t error = abs(wrap_180_cd(yaw_sensor - _gps_fix.ground_course_cd));
+    if (error > 4500 && _wind.length() < _gps_fix.ground_speed_cm*0.008f) {
         // start using the GPS for heading
         return false;
     }
@@ -324,15 +449,16 @@ AP_AHRS_DCM::drift_correction_yaw(void)
         /*
           we are using compass for yaw
          */
-        if (_compass->last_update != _compass_last_update) {
-            yaw_deltat = (_compass->last_update - _compass_last_update) * 1.0e-6f;
-            _compass_last_update = _compass->last_update;
+        uint32_t sample_us = _compass->get_last_sample_time_micros();
+        if (sample_us != _compass_last_update) {
+            yaw_deltat = (sample_us - _compass_last_update) * 1.0e-6f;
+            _compass_last_update = sample_us;
             // we force an additional compass read()
             // here. This has the effect of throwing away
             // the first compass value, which can be bad
             if (!_flags.have_initial_yaw && _compass->read()) {
                 float heading = _compass->calculate_heading(_dcm_matrix);
-                _dcm_matrix.from_euler(roll, pitch, heading);
+                attitude_from_euler(roll, pitch, heading);
                 _omega_yaw_P.zero();
                 _flags.have_initial_yaw = true;
             }
@@ -343,12 +469,12 @@ AP_AHRS_DCM::drift_correction_yaw(void)
         /*
           we are using GPS for yaw
          */
-        if (_gps->last_fix_time != _gps_last_update &&
-            _gps->ground_speed_cm >= GPS_SPEED_MIN) {
-            yaw_deltat = (_gps->last_fix_time - _gps_last_update) * 1.0e-3f;
-            _gps_last_update = _gps->last_fix_time;
+        if (_gps_fix.sample_time_us != _gps_last_update &&
+            _gps_fix.ground_speed_cm >= GPS_SPEED_MIN) {
+            yaw_deltat = (_gps_fix.sample_time_us - _gps_last_update) * 1.0e-6f;
+            _gps_last_update = _gps_fix.sample_time_us;
             new_value = true;
-            float gps_course_rad = ToRad(_gps->ground_course_cd * 0.01f);
+            float gps_course_rad = ToRad(_gps_fix.ground_course_cd * 0.01f);
             float yaw_error_rad = gps_course_rad - yaw;
             yaw_error = sinf(yaw_error_rad);
 
@@ -370,9 +496,9 @@ AP_AHRS_DCM::drift_correction_yaw(void)
             */
             if (!_flags.have_initial_yaw || 
                 yaw_deltat > 20 ||
-                (_gps->ground_speed_cm >= 3*GPS_SPEED_MIN && fabsf(yaw_error_rad) >= 1.047f)) {
+                (_gps_fix.ground_speed_cm >= 3*GPS_SPEED_MIN && fabsf(yaw_error_rad) >= 1.047f)) {
                 // reset DCM matrix based on current yaw
-                _dcm_matrix.from_euler(roll, pitch, gps_course_rad);
+                attitude_from_euler(roll, pitch, gps_course_rad);
                 _omega_yaw_P.zero();
                 _flags.have_initial_yaw = true;
                 yaw_error = 0;
@@ -431,30 +557,43 @@ AP_AHRS_DCM::drift_correction_yaw(void)
 void
 AP_AHRS_DCM::drift_correction(float deltat)
 {
-    Matrix3f temp_dcm = _dcm_matrix;
     Vector3f velocity;
     uint32_t last_correction_time;
 
+    // all the corrections use the same fix, taken in one piece
+    if (_gps) {
+        _gps->get_fix(_gps_fix);
+    }
+
     // perform yaw drift correction if we have a new yaw reference
     // vector
     drift_correction_yaw();
 
     // apply trim
+#if AP_AHRS_DCM_FIXED
+    Matrix3q30 temp_dcm = _dcm_fixed;
+    temp_dcm.rotateXY(to_fixed<30>(_trim));
+
+    // rotate accelerometer values into the earth frame
+    _accel_ef = to_float(fixed_mul(temp_dcm, to_fixed<16>(_accel_vector)));
+#else
+    Matrix3f temp_dcm = _dcm_matrix;
     temp_dcm.rotateXY(_trim);
 
     // rotate accelerometer values into the earth frame
     _accel_ef = temp_dcm * _accel_vector;
+#endif
 
     // integrate the accel vector in the earth frame between GPS readings
-    _ra_sum += _accel_ef * deltat;
+    _ra_sum.multiply_add(_accel_ef, deltat);
 
     // keep a sum of the deltat values, so we know how much time
     // we have integrated over
     _ra_deltat += deltat;
 
     if (!have_gps() || 
-        _gps->status() < GPS::GPS_OK_FIX_3D || 
-        _gps->num_sats < _gps_minsats) {
+        _gps_fix.status < GPS::GPS_OK_FIX_3D || 
+        _gps_fix.num_sats < _gps_minsats) {
         // no GPS, or not a good lock. From experience we need at
         // least 6 satellites to get a really reliable velocity number
         // from the GPS.
@@ -482,12 +621,12 @@ AP_AHRS_DCM::drift_correction(float deltat)
         last_correction_time = hal.scheduler->millis();
         _have_gps_lock = false;
     } else {
-        if (_gps->last_fix_time == _ra_sum_start) {
+        if (_gps_fix.fix_time_ms == _ra_sum_start) {
             // we don't have a new GPS fix - nothing more to do
             return;
         }
-        velocity = Vector3f(_gps->velocity_north(), _gps->velocity_east(), _gps->velocity_down());
-        last_correction_time = _gps->last_fix_time;
+        velocity = _gps_fix.velocity;
+        last_correction_time = _gps_fix.fix_time_ms;
         if (_have_gps_lock == false) {
             // if we didn't have GPS lock in the last drift
             // correction interval then set the velocities equal
@@ -503,8 +642,8 @@ AP_AHRS_DCM::drift_correction(float deltat)
 
     if (have_gps()) {
         // use GPS for positioning with any fix, even a 2D fix
-        _last_lat = _gps->latitude;
-        _last_lng = _gps->longitude;
+        _last_lat = _gps_fix.latitude;
+        _last_lng = _gps_fix.longitude;
         _position_offset_north = 0;
         _position_offset_east = 0;
 
@@ -605,13 +744,13 @@ AP_AHRS_DCM::drift_correction(float deltat)
     // we now want to calculate _omega_P and _omega_I. The
     // _omega_P value is what drags us quickly to the
     // accelerometer reading.
-    _omega_P = error * _P_gain(spin_rate) * _kp;
+    _omega_P = error * (_P_gain(spin_rate) * _kp);
     if (_flags.fast_ground_gains) {
         _omega_P *= 8;
     }
 
     if (_flags.fly_forward && _gps && _gps->status() >= GPS::GPS_OK_FIX_2D && 
-        _gps->ground_speed_cm < GPS_SPEED_MIN && 
+        _gps_fix.ground_speed_cm < GPS_SPEED_MIN && 
         _accel_vector.x >= 7 &&
 	    pitch_sensor > -3000 && pitch_sensor < 3000) {
             // assume we are in a launch acceleration, and reduce the
@@ -655,65 +794,69 @@ AP_AHRS_DCM::drift_correction(float deltat)
 }
 
 
-// update our wind speed estimate
+/*
+  update our wind speed estimate
+
+  The horizontal ground velocity is the airspeed along the fuselage
+  plus the wind, which is linear in the three unknowns: the north and
+  east wind and the airspeed. They are found by recursive least
+  squares, taking in each GPS fix as it comes, so every part of a turn
+  improves the estimate and a few turns are enough. An airspeed sensor
+  in use is a direct measurement of the third unknown.
+ */
 void AP_AHRS_DCM::estimate_wind(Vector3f &velocity)
 {
     if (!_flags.wind_estimation) {
         return;
     }
 
-    // this is based on the wind speed estimation code from MatrixPilot by
-    // Bill Premerlani. Adaption for ArduPilot by Jon Challinger
-    // See http://gentlenav.googlecode.com/files/WindEstimation.pdf
     Vector3f fuselageDirection = _dcm_matrix.colx();
-    Vector3f fuselageDirectionDiff = fuselageDirection - _last_fuse;
     uint32_t now = hal.scheduler->millis();
 
-    // scrap our data and start over if we're taking too long to get a direction change
-    if (now - _last_wind_time > 10000) {
+    if (!_wind_started || now - _last_wind_time > 10000) {
+        // start again from the wind we have, taking what is left of
+        // the ground speed to be the airspeed
+        _wind_state = Vector3f(_wind.x, _wind.y,
+                               pythagorous2(velocity.x - _wind.x, velocity.y - _wind.y));
+        _wind_P = Matrix3f(WIND_VARIANCE_INIT, 0, 0,
+                           0, WIND_VARIANCE_INIT, 0,
+                           0, 0, WIND_AIRSPEED_VARIANCE_INIT);
+        _wind_started = true;
         _last_wind_time = now;
-        _last_fuse = fuselageDirection;
-        _last_vel = velocity;
         return;
     }
 
-    float diff_length = fuselageDirectionDiff.length();
-    if (diff_length > 0.2f) {
-        // when turning, use the attitude response to estimate
-        // wind speed
-        float V;
-        Vector3f velocityDiff = velocity - _last_vel;
-
-        // estimate airspeed it using equation 6
-        V = velocityDiff.length() / diff_length;
-
-        _last_fuse = fuselageDirection;
-        _last_vel = velocity;
-
-        Vector3f fuselageDirectionSum = fuselageDirection + _last_fuse;
-        Vector3f velocitySum = velocity + _last_vel;
-
-        float theta = atan2f(velocityDiff.y, velocityDiff.x) - atan2f(fuselageDirectionDiff.y, fuselageDirectionDiff.x);
-        float sintheta = sinf(theta);
-        float costheta = cosf(theta);
+    // fade out older fixes, so the estimate follows a changing wind
+    // and airspeed. Not once the variances are back at their starting
+    // size, so they can't grow without limit in straight flight
+    float dt = (now - _last_wind_time) * 0.001f;
+    _last_wind_time = now;
+    if (_wind_P.a.x + _wind_P.b.y + _wind_P.c.z < 2*WIND_VARIANCE_INIT + WIND_AIRSPEED_VARIANCE_INIT) {
+        _wind_P *= 1.0f + dt * (1.0f / WIND_MEMORY);
+    }
 
-        Vector3f wind = Vector3f();
-        wind.x = velocitySum.x - V * (costheta * fuselageDirectionSum.x - sintheta * fuselageDirectionSum.y);
-        wind.y = velocitySum.y - V * (sintheta * fuselageDirectionSum.x + costheta * fuselageDirectionSum.y);
-        wind.z = velocitySum.z - V * fuselageDirectionSum.z;
-        wind *= 0.5f;
+    wind_update(Vector3f(1, 0, fuselageDirection.x), velocity.x, WIND_VELOCITY_NOISE);
+    wind_update(Vector3f(0, 1, fuselageDirection.y), velocity.y, WIND_VELOCITY_NOISE);
+    if (_airspeed && _airspeed->use()) {
+        wind_update(Vector3f(0, 0, 1), _airspeed->get_airspeed() * get_EAS2TAS(), WIND_AIRSPEED_NOISE);
+    }
 
-        if (wind.length() < _wind.length() + 20) {
-            _wind = _wind * 0.95f + wind * 0.05f;
-        }
+    _wind.x = _wind_state.x;
+    _wind.y = _wind_state.y;
+    _wind.z = 0;
+}
 
-        _last_wind_time = now;
-    } else if (now - _last_wind_time > 2000 && _airspeed && _airspeed->use()) {
-        // when flying straight use airspeed to get wind estimate if available
-        Vector3f airspeed = _dcm_matrix.colx() * _airspeed->get_airspeed();
-        Vector3f wind = velocity - (airspeed * get_EAS2TAS());
-        _wind = _wind * 0.92f + wind * 0.08f;
-    }    
+// take in one measurement, h * state, of the wind estimate
+void AP_AHRS_DCM::wind_update(const Vector3f &h, float measurement, float noise)
+{
+    Vector3f Ph = _wind_P * h;
+    Vector3f gain = Ph / (noise + h * Ph);
+    _wind_state.multiply_add(gain, measurement - h * _wind_state);
+
+    // P -= gain * Ph', which keeps it symmetric
+    _wind_P.a.multiply_add(Ph, -gain.x);
+    _wind_P.b.multiply_add(Ph, -gain.y);
+    _wind_P.c.multiply_add(Ph, -gain.z);
 }
 
 
@@ -723,7 +866,11 @@ void AP_AHRS_DCM::estimate_wind(Vector3f &velocity)
 void
 AP_AHRS_DCM::euler_angles(void)
 {
-    _dcm_matrix.to_euler(&roll, &pitch, &yaw);
+    // as Matrix3::to_euler(), but fast_atan2() is accurate to a
+    // thousandth of a degree, which is plenty for control
+    pitch = -safe_asin(_dcm_matrix.c.x);
+    roll  = fast_atan2(_dcm_matrix.c.y, _dcm_matrix.c.z);
+    yaw   = fast_atan2(_dcm_matrix.b.x, _dcm_matrix.a.x);
 
     roll_sensor     = degrees(roll)  * 100;
     pitch_sensor    = degrees(pitch) * 100;
@@ -765,7 +912,7 @@ float AP_AHRS_DCM::get_error_yaw(void)
 
 // return our current position estimate using
 // dead-reckoning or GPS
-bool AP_AHRS_DCM::get_position(struct Location *loc)
+bool AP_AHRS_DCM::get_position(struct Position *loc)
 {
     if (!_have_position) {
         return false;
@@ -16,10 +16,16 @@ public:
     // Constructors
     AP_AHRS_DCM(AP_InertialSensor *ins, GPS *&gps) :
         AP_AHRS(ins, gps),
+        renorm_taylor_count(0),
+        renorm_exact_count(0),
         _last_declination(0),
+        _wind_started(false),
         _mag_earth(1,0)
     {
         _dcm_matrix.identity();
+#if AP_AHRS_DCM_FIXED
+        _dcm_fixed.identity();
+#endif
 
         // these are experimentally derived from the simulator
         // with large drift levels
@@ -44,42 +50,71 @@ public:
     void            update(void);
     void            reset(bool recover_eulers = false);
 
+    // the rest of update() once the INS has been updated, for an
+    // ahrs that shares its INS with another
+    void            update_attitude(void);
+
     // dead-reckoning support
-    bool get_position(struct Location *loc);
+    bool get_position(struct Position *loc);
 
     // status reporting
     float           get_error_rp(void);
     float           get_error_yaw(void);
 
+    // rows renormalised with the taylor expansion and exactly. The
+    // exact path is only taken for large errors, so a rising count
+    // of it is a sign of timing trouble
+    uint32_t renorm_taylor_count;
+    uint32_t renorm_exact_count;
+
     // return a wind estimation vector, in m/s
     Vector3f wind_estimate(void) {
         return _wind;
     }
 
+    // variance of the wind estimate in (m/s)^2, north and east
+    // added. It only gets small once the vehicle has turned
+    float wind_variance(void) const {
+        return _wind_P.a.x + _wind_P.b.y;
+    }
+
     // return an airspeed estimate if available. return true
     // if we have an estimate
     bool airspeed_estimate(float *airspeed_ret);
 
     bool            use_compass(void) const;
 
-private:
+protected:
     float _ki;
     float _ki_yaw;
 
-    // Methods
-    void            matrix_update(float _G_Dt);
-    void            normalize(void);
-    void            check_matrix(void);
+    // Methods. The attitude representation is only touched by the
+    // first four, so a subclass can keep attitude in another form
+    // as long as it keeps _dcm_matrix up to date
+    virtual void    matrix_update(float _G_Dt) HOT_FUNC;
+    virtual void    normalize(void);
+    virtual void    check_matrix(void);
+    virtual void    attitude_from_euler(float _roll, float _pitch, float _yaw);
     bool            renorm(Vector3f const &a, Vector3f &result);
+#if AP_AHRS_DCM_FIXED
+    bool            renorm(Vector3q30 const &a, Vector3q30 &result);
+#endif
     void            drift_correction(float deltat);
     void            drift_correction_yaw(void);
     float           yaw_error_compass();
     void            euler_angles(void);
     void            estimate_wind(Vector3f &velocity);
+    void            wind_update(const Vector3f &h, float measurement, float noise);
     bool            have_gps(void) const;
 
     // primary representation of attitude
     Matrix3f _dcm_matrix;
+#if AP_AHRS_DCM_FIXED
+    // the working copy, which matrix_update() and normalize() update
+    // and copy to _dcm_matrix. A subclass keeping attitude in another
+    // form must update it too, as drift_correction() reads it
+    Matrix3q30 _dcm_fixed;
+#endif
 
     Vector3f _gyro_vector;                      // Store the gyros turn rate in a vector
     Vector3f _accel_vector;                     // current accel vector
@@ -104,9 +139,12 @@ private:
     uint16_t _error_yaw_count;
     float _error_yaw_last;
 
-    // time in millis when we last got a GPS heading
+    // sample time in micros of the last GPS heading
     uint32_t _gps_last_update;
 
+    // the GPS solution for this update
+    GPS::Fix _gps_fix;
+
     // state of accel drift correction
     Vector3f _ra_sum;
     Vector3f _last_velocity;
@@ -131,9 +169,11 @@ private:
     // whether we have a position estimate
     bool _have_position;
 
-    // support for wind estimation
-    Vector3f _last_fuse;
-    Vector3f _last_vel;
+    // support for wind estimation. The state is the north and east
+    // wind and the airspeed along the fuselage, with its covariance
+    Vector3f _wind_state;
+    Matrix3f _wind_P;
+    bool _wind_started;
     uint32_t _last_wind_time;
     float _last_airspeed;
 
@@ -28,4 +28,6 @@ AP_AHRS_HIL::setHil(float _roll, float _pitch, float _yaw,
     yaw_sensor   = ToDeg(yaw)*100;
 
     _dcm_matrix.from_euler(roll, pitch, yaw);
+
+    update_trig();
 }
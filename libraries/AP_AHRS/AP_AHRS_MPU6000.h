@@ -1,8 +1,22 @@
 #ifndef __AP_AHRS_MPU6000_H__
 #define __AP_AHRS_MPU6000_H__
 /*
- *  DCM based AHRS (Attitude Heading Reference System) interface for
- *  ArduPilot
+ *  AHRS (Attitude Heading Reference System) using the attitude the
+ *  MPU6000's DMP works out for ArduPilot
+ *
+ *  The DMP integrates the gyros at 200Hz on the sensor, and the timer
+ *  process reads its quaternion from the FIFO. Each update turns our
+ *  attitude by the rotation the DMP has seen since the last one, in
+ *  place of integrating the gyros, and then applies the drift
+ *  correction of AP_AHRS_DCM. That takes roll and pitch from the
+ *  accelerometers corrected for the centrifugal acceleration the GPS
+ *  shows, and yaw from the compass or GPS. The DMP's own accelerometer
+ *  fusion knows nothing of the GPS, so it is turned off rather than
+ *  left to pull against that.
+ *
+ *  Only the APM2 has the MPU6000, and the DMP is not available with
+ *  MPU6000_FIFO_MODE. Without it the gyros are integrated as by
+ *  AP_AHRS_Quaternion
  *
  *  This library is free software; you can redistribute it and/or
  *  modify it under the terms of the GNU Lesser General Public
@@ -10,108 +24,41 @@
  *  version 2.1 of the License, or (at your option) any later version.
  */
 
-// Rate of the gyro bias from gravity correction (200Hz/4) => 50Hz
-#define GYRO_BIAS_FROM_GRAVITY_RATE 4
-// Initial value to detect that compass correction is not initialized
-#define HEADING_UNKNOWN -9999
-
-// max rate of gyro drift in gyro_LSB_units/s (16.4LSB = 1deg/s)
-// 0.5 corresponds to 0.03 degrees/s/s;
-static const float _MPU6000_gyro_drift_rate = 0.5;
-
-class AP_AHRS_MPU6000 : public AP_AHRS
+class AP_AHRS_MPU6000 : public AP_AHRS_Quaternion
 {
 public:
     // Constructors
     AP_AHRS_MPU6000(AP_InertialSensor_MPU6000 *mpu6000, GPS *&gps) :
-        AP_AHRS(mpu6000, gps),
-        // ki and ki_yaw are experimentally derived from the simulator
-        _ki(0.0087),
-        _ki_yaw(0.01),
+        AP_AHRS_Quaternion(mpu6000, gps),
         _mpu6000(mpu6000),
-        // dmp related variable initialisation
-        _compass_bias_time(0),
-        _gyro_bias_from_gravity_gain(0.008)
+        _have_dmp_attitude(false),
+        _secondary_ahrs(false)
     {
-        _dcm_matrix.identity();
     }
 
     // initialisation routine to start MPU6000's dmp
     void init();
 
-    // return the smoothed gyro vector corrected for drift
-    const Vector3f get_gyro(void) const {
-        return _ins->get_gyro();
-    }
-
-    const Matrix3f &get_dcm_matrix(void) const {
-        return _dcm_matrix;
-    }
-
-    // return the current drift correction integrator value
-    const Vector3f &get_gyro_drift(void) const {
-        return _omega_I;
-    }
-
     // Methods
     void update(void);
-    void reset(bool recover_eulers = false);
 
     // push offsets down from IMU to INS (required so MPU6000 can perform it's
     // own attitude estimation)
     void push_offsets_to_ins();
-    void push_gains_to_dmp();
 
-    // status reporting
-    float get_error_rp(void);
-    float get_error_yaw(void);
-
-    // set_as_secondary - avoid running some steps twice (imu updates) if
-    // this is a secondary ahrs
+    // set_as_secondary - leave updating the INS to the primary ahrs
     void set_as_secondary(bool secondary) {
         _secondary_ahrs = secondary;
     }
 
 private:
-    float _ki;
-    float _ki_yaw;
-    AP_InertialSensor_MPU6000 *_mpu6000;
-
-    // Methods
-    void drift_correction(float deltat);
-
-    // Compass correction variables. TO-DO: move or replace?
-    // TO-DO: move wrap_PI to standard AP_AHRS methods
-    float wrap_PI(float angle_in_radians);
-    long _compass_bias_time;
+    void matrix_update(float _G_Dt);
 
-    void  drift_correction_yaw(void);
-    float yaw_error_compass();
-    void  euler_angles(void);
-
-    Vector3f _accel_filtered;
-    int16_t _accel_filtered_samples;
-
-    // bias_tracking
-    float _gyro_bias[3];
-
-    // bias correction algorithm gain
-    float _gyro_bias_from_gravity_gain;
-    uint8_t _gyro_bias_from_gravity_counter;
-
-    // primary representation of attitude
-    Matrix3f _dcm_matrix;
-    // current accel vector
-    Vector3f _accel_vector;
-    // Omega Integrator correction
-    Vector3f _omega_I;
-    Vector3f _omega_I_sum;
-    float _omega_I_sum_time;
+    AP_InertialSensor_MPU6000 *_mpu6000;
 
-    // state to support status reporting
-    float _error_yaw_sum;
-    uint16_t _error_yaw_count;
-    float _error_yaw_last;
+    // the DMP's attitude at the last update that had one
+    Quaternion _dmp_attitude;
+    bool _have_dmp_attitude;
 
     bool _secondary_ahrs;
 };
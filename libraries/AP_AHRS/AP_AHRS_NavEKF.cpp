@@ -0,0 +1,216 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+ *       AP_AHRS_NavEKF.cpp
+ *
+ *       AHRS system using the navigation EKF, with DCM as a fallback
+ *
+ *       This library is free software; you can redistribute it and/or
+ *       modify it under the terms of the GNU Lesser General Public License
+ *       as published by the Free Software Foundation; either version 2.1
+ *       of the License, or (at your option) any later version.
+ */
+#include <AP_AHRS.h>
+#include <AP_HAL.h>
+
+#if AP_AHRS_NAVEKF_AVAILABLE
+
+extern const AP_HAL::HAL& hal;
+
+// stop the EKF if it has had no GPS fix for this long
+#define NAVEKF_GPS_TIMEOUT_MS 10000
+
+// the airspeed sensor is read at 10Hz by the vehicles
+#define NAVEKF_AIRSPEED_INTERVAL_MS 100
+
+// don't fuse airspeed below this, in m/s
+#define NAVEKF_AIRSPEED_MIN 5.0f
+
+void
+AP_AHRS_NavEKF::update(void)
+{
+    // DCM runs all the time, to start the EKF from and to fall back to
+    AP_AHRS_DCM::update();
+
+    if (!_ekf_use) {
+        if (_ekf_active) {
+            _ekf_active = false;
+            _ekf.reset();
+        }
+        return;
+    }
+
+    float delta_t = _ins->get_delta_time();
+    if (delta_t > 0.2f || delta_t <= 0) {
+        // DCM discards these too
+        return;
+    }
+
+    if (!_ekf_active) {
+        start_ekf();
+        return;
+    }
+
+    update_ekf(delta_t);
+
+    if (using_ekf()) {
+        _ekf.get_dcm_matrix(_ekf_dcm);
+        _ekf_drift = -_ekf.get_gyro_bias();
+
+        _ekf_dcm.to_euler(&roll, &pitch, &yaw);
+        roll_sensor     = degrees(roll)  * 100;
+        pitch_sensor    = degrees(pitch) * 100;
+        yaw_sensor      = degrees(yaw)   * 100;
+        if (yaw_sensor < 0)
+            yaw_sensor += 36000;
+
+        _accel_ef = _ekf_dcm * _ins->get_accel();
+        update_trig();
+    }
+}
+
+// start the EKF from the DCM attitude once there is a good GPS fix
+void
+AP_AHRS_NavEKF::start_ekf(void)
+{
+    if (!_gps || _gps->status() < GPS::GPS_OK_FIX_3D ||
+        _gps->num_sats < _gps_minsats || !yaw_initialised()) {
+        return;
+    }
+
+    _origin.lat = _gps->latitude;
+    _origin.lng = _gps->longitude;
+    if (_baro != NULL && _baro->healthy) {
+        _hgt_origin = _baro->get_altitude();
+    } else {
+        _hgt_origin = _gps->altitude_cm * 0.01f;
+    }
+
+    // the DCM drift is added to the gyros, the EKF bias subtracted
+    _ekf.init(roll, pitch, yaw, _gps->velocity_vector(), -AP_AHRS_DCM::get_gyro_drift());
+    _ekf.get_dcm_matrix(_ekf_dcm);
+    _ekf_drift = AP_AHRS_DCM::get_gyro_drift();
+
+    _last_gps_fix = _gps->last_fix_time;
+    _last_ekf_gps_ms = hal.scheduler->millis();
+    _ekf_active = true;
+}
+
+// run one prediction and fuse whatever new measurements there are
+void
+AP_AHRS_NavEKF::update_ekf(float delta_t)
+{
+    Vector3f delta_angle, delta_velocity, accel;
+    if (!_ins->get_delta_angle(delta_angle)) {
+        delta_angle = _ins->get_gyro() * delta_t;
+    }
+    if (_ins->get_delta_velocity(delta_velocity)) {
+        accel = delta_velocity / delta_t;
+    } else {
+        accel = _ins->get_accel();
+    }
+    _ekf.predict(delta_angle, accel, delta_t);
+
+    uint32_t now = hal.scheduler->millis();
+    bool have_baro = _baro != NULL && _baro->healthy;
+
+    if (_gps && _gps->status() >= GPS::GPS_OK_FIX_3D &&
+        _gps->last_fix_time != _last_gps_fix) {
+        _last_gps_fix = _gps->last_fix_time;
+        _last_ekf_gps_ms = now;
+
+        _ekf.fuse_velocity(_gps->velocity_vector(), _gps->have_raw_velocity());
+        _ekf.fuse_position_ne((_gps->latitude - _origin.lat) * LATLON_TO_M,
+                              (_gps->longitude - _origin.lng) * LATLON_TO_M * longitude_scale(&_origin));
+        if (!have_baro) {
+            _ekf.fuse_height(_gps->altitude_cm * 0.01f - _hgt_origin);
+        }
+    }
+
+    if (have_baro && _baro->get_last_update() != _last_baro_ms) {
+        _last_baro_ms = _baro->get_last_update();
+        _ekf.fuse_height(_baro->get_altitude() - _hgt_origin);
+    }
+
+    if (use_compass() && _compass->last_update != _last_compass_us) {
+        _last_compass_us = _compass->last_update;
+        Matrix3f m;
+        _ekf.get_dcm_matrix(m);
+        _ekf.fuse_heading(_compass->calculate_heading(m));
+    }
+
+    if (_flags.fly_forward && airspeed_sensor_enabled() &&
+        now - _last_airspeed_ms >= NAVEKF_AIRSPEED_INTERVAL_MS) {
+        _last_airspeed_ms = now;
+        float tas = _airspeed->get_airspeed() * get_EAS2TAS();
+        if (tas > NAVEKF_AIRSPEED_MIN) {
+            _ekf.fuse_airspeed(tas);
+        }
+    }
+
+    if (!_ekf.healthy() || now - _last_ekf_gps_ms > NAVEKF_GPS_TIMEOUT_MS) {
+        // without GPS the position is soon useless, and the
+        // innovations on its return would be rejected. Start again
+        // when the fix comes back
+        _ekf_active = false;
+        _ekf.reset();
+    }
+}
+
+void
+AP_AHRS_NavEKF::reset(bool recover_eulers)
+{
+    AP_AHRS_DCM::reset(recover_eulers);
+    _ekf_active = false;
+    _ekf.reset();
+}
+
+bool AP_AHRS_NavEKF::using_ekf(void) const
+{
+    return _ekf_use && _ekf_active && _ekf.healthy();
+}
+
+const Vector3f AP_AHRS_NavEKF::get_gyro(void) const
+{
+    if (!using_ekf()) {
+        return AP_AHRS_DCM::get_gyro();
+    }
+    return _ins->get_gyro() + _ekf_drift;
+}
+
+const Vector3f &AP_AHRS_NavEKF::get_gyro_drift(void) const
+{
+    if (!using_ekf()) {
+        return AP_AHRS_DCM::get_gyro_drift();
+    }
+    return _ekf_drift;
+}
+
+const Matrix3f &AP_AHRS_NavEKF::get_dcm_matrix(void) const
+{
+    if (!using_ekf()) {
+        return AP_AHRS_DCM::get_dcm_matrix();
+    }
+    return _ekf_dcm;
+}
+
+bool AP_AHRS_NavEKF::get_position(struct Position *loc)
+{
+    if (!using_ekf()) {
+        return AP_AHRS_DCM::get_position(loc);
+    }
+    const Vector3f &pos = _ekf.get_position();
+    loc->lat = _origin.lat;
+    loc->lng = _origin.lng;
+    location_offset(loc, pos.x, pos.y);
+    return true;
+}
+
+Vector3f AP_AHRS_NavEKF::wind_estimate(void)
+{
+    if (!using_ekf()) {
+        return AP_AHRS_DCM::wind_estimate();
+    }
+    return _ekf.get_wind();
+}
+
+#endif // AP_AHRS_NAVEKF_AVAILABLE
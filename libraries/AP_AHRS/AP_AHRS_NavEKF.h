@@ -0,0 +1,78 @@
+#ifndef __AP_AHRS_NAVEKF_H__
+#define __AP_AHRS_NAVEKF_H__
+/*
+ *  AHRS that runs the navigation EKF alongside DCM
+ *
+ *  DCM always runs. It provides the attitude the EKF starts from, and
+ *  it is what callers see unless AHRS_EKF_USE is set and the EKF is
+ *  healthy. If the EKF loses GPS for long enough for its position to
+ *  become meaningless it is stopped and the outputs fall back to DCM
+ *  until it can be restarted
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ */
+
+#if AP_AHRS_NAVEKF_AVAILABLE
+
+class AP_AHRS_NavEKF : public AP_AHRS_DCM
+{
+public:
+    // Constructors
+    AP_AHRS_NavEKF(AP_InertialSensor *ins, GPS *&gps) :
+        AP_AHRS_DCM(ins, gps),
+        _ekf_active(false),
+        _last_gps_fix(0),
+        _last_baro_ms(0),
+        _last_compass_us(0),
+        _last_ekf_gps_ms(0),
+        _last_airspeed_ms(0),
+        _hgt_origin(0)
+    {
+    }
+
+    // Methods
+    void            update(void);
+    void            reset(bool recover_eulers = false);
+
+    const Vector3f  get_gyro(void) const;
+    const Vector3f &get_gyro_drift(void) const;
+    const Matrix3f &get_dcm_matrix(void) const;
+
+    bool            get_position(struct Position *loc);
+    Vector3f        wind_estimate(void);
+
+    // true if the outputs currently come from the EKF
+    bool            using_ekf(void) const;
+
+    // access to the filter itself, for logging
+    const AP_NavEKF &get_ekf(void) const { return _ekf; }
+
+private:
+    void            start_ekf(void);
+    void            update_ekf(float delta_t);
+
+    AP_NavEKF       _ekf;
+    bool            _ekf_active;
+
+    // copies of the EKF outputs in the forms the interface returns
+    Matrix3f        _ekf_dcm;
+    Vector3f        _ekf_drift;
+
+    // times of the last measurements fused
+    uint32_t        _last_gps_fix;
+    uint32_t        _last_baro_ms;
+    uint32_t        _last_compass_us;
+    uint32_t        _last_ekf_gps_ms;
+    uint32_t        _last_airspeed_ms;
+
+    // the EKF position is relative to this point
+    struct Position _origin;
+    float           _hgt_origin;
+};
+
+#endif // AP_AHRS_NAVEKF_AVAILABLE
+
+#endif // __AP_AHRS_NAVEKF_H__
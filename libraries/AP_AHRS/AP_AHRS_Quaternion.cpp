@@ -0,0 +1,73 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+ *       AP_AHRS_Quaternion.cpp
+ *
+ *       AHRS system using a quaternion for attitude and the DCM drift
+ *       correction
+ *
+ *       This library is free software; you can redistribute it and/or
+ *       modify it under the terms of the GNU Lesser General Public License
+ *       as published by the Free Software Foundation; either version 2.1
+ *       of the License, or (at your option) any later version.
+ */
+#include <AP_AHRS.h>
+
+// update the quaternion using only the gyros
+void
+AP_AHRS_Quaternion::matrix_update(float _G_Dt)
+{
+    // as for DCM, the P terms are kept out of _omega so they don't
+    // feed back into the spin rate used by _P_gain()
+    _omega = _gyro_vector + _omega_I;
+
+    Vector3f delta_angle;
+    if (!_ins->get_delta_angle(delta_angle)) {
+        delta_angle = _gyro_vector * _G_Dt;
+    }
+    _quat.rotate(delta_angle + (_omega_I + _omega_P + _omega_yaw_P) * _G_Dt);
+}
+
+// renormalise the quaternion and rebuild the DCM matrix from it
+void
+AP_AHRS_Quaternion::normalize(void)
+{
+    float len = _quat.length();
+
+    if (!(len < 2.0f && len > 0.5f)) {
+        // far larger than integration error alone can explain
+        renorm_range_count++;
+        if (!(len < 1.0e6f && len > 1.0e-6f)) {
+            renorm_blowup_count++;
+            reset(true);
+            return;
+        }
+    }
+
+    _quat.normalize();
+    _quat.rotation_matrix(_dcm_matrix);
+#if AP_AHRS_DCM_FIXED
+    _dcm_fixed = to_fixed(_dcm_matrix);
+#endif
+}
+
+// check the quaternion for pathological values. A unit quaternion
+// can't produce an out of range matrix, so only NaN is checked
+void
+AP_AHRS_Quaternion::check_matrix(void)
+{
+    if (_quat.is_nan()) {
+        renorm_blowup_count++;
+        reset(true);
+    }
+}
+
+// set the attitude from euler angles
+void
+AP_AHRS_Quaternion::attitude_from_euler(float _roll, float _pitch, float _yaw)
+{
+    _quat.from_euler(_roll, _pitch, _yaw);
+    _quat.rotation_matrix(_dcm_matrix);
+#if AP_AHRS_DCM_FIXED
+    _dcm_fixed = to_fixed(_dcm_matrix);
+#endif
+}
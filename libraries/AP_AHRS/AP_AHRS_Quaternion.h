@@ -0,0 +1,45 @@
+#ifndef __AP_AHRS_QUATERNION_H__
+#define __AP_AHRS_QUATERNION_H__
+/*
+ *  Quaternion based AHRS (Attitude Heading Reference System) for
+ *  ArduPilot
+ *
+ *  This uses the same drift correction as AP_AHRS_DCM, but keeps the
+ *  attitude as a quaternion. Integrating a rotation and renormalising
+ *  a quaternion is much cheaper than the matrix equivalent, and a
+ *  unit quaternion always gives an orthonormal matrix, so there is no
+ *  renormalisation of the matrix to go wrong
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ */
+
+class AP_AHRS_Quaternion : public AP_AHRS_DCM
+{
+public:
+    // Constructors
+    AP_AHRS_Quaternion(AP_InertialSensor *ins, GPS *&gps) :
+        AP_AHRS_DCM(ins, gps)
+    {
+    }
+
+    // return the attitude as a quaternion
+    const Quaternion &get_quaternion(void) const {
+        return _quat;
+    }
+
+protected:
+    // the DCM matrix is derived from _quat once per update, in
+    // normalize(), as the drift correction that follows needs it
+    void            matrix_update(float _G_Dt);
+    void            normalize(void);
+    void            check_matrix(void);
+    void            attitude_from_euler(float _roll, float _pitch, float _yaw);
+
+    // primary representation of attitude
+    Quaternion _quat;
+};
+
+#endif // __AP_AHRS_QUATERNION_H__
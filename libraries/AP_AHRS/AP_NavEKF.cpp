@@ -0,0 +1,338 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+ *       AP_NavEKF.cpp
+ *
+ *       error state extended Kalman filter for attitude, velocity,
+ *       position, gyro bias and wind
+ *
+ *       This library is free software; you can redistribute it and/or
+ *       modify it under the terms of the GNU Lesser General Public License
+ *       as published by the Free Software Foundation; either version 2.1
+ *       of the License, or (at your option) any later version.
+ */
+#include <AP_AHRS.h>
+
+#if AP_AHRS_NAVEKF_AVAILABLE
+
+// state indexes
+#define STATE_ATT   0
+#define STATE_VEL   3
+#define STATE_POS   6
+#define STATE_BIAS  9
+#define STATE_WIND  12
+
+// process noise
+#define NOISE_GYRO          0.015f      // rad/s
+#define NOISE_ACCEL         0.35f       // m/s/s
+#define NOISE_GYRO_BIAS     1.0e-5f     // rad/s/s
+#define NOISE_WIND          0.1f        // m/s/s
+
+// measurement noise, one sigma
+#define SIGMA_VEL_NE        0.3f        // m/s
+#define SIGMA_VEL_D         0.5f        // m/s
+#define SIGMA_POS_NE        2.5f        // m
+#define SIGMA_HEIGHT        1.5f        // m
+#define SIGMA_HEADING       0.1f        // rad
+#define SIGMA_AIRSPEED      1.4f        // m/s
+
+// innovations beyond this many standard deviations are rejected
+#define INNOVATION_GATE     5.0f
+
+// initial uncertainty, one sigma
+#define INIT_SIGMA_TILT     0.1f        // rad
+#define INIT_SIGMA_YAW      0.3f        // rad
+#define INIT_SIGMA_VEL      0.5f        // m/s
+#define INIT_SIGMA_POS      3.0f        // m
+#define INIT_SIGMA_BIAS     0.01f       // rad/s
+#define INIT_SIGMA_WIND     4.0f        // m/s
+
+AP_NavEKF::AP_NavEKF() :
+    _initialised(false)
+{
+}
+
+void AP_NavEKF::init(float roll, float pitch, float yaw, const Vector3f &velocity, const Vector3f &gyro_bias)
+{
+    _quat.from_euler(roll, pitch, yaw);
+    _velocity = velocity;
+    _position.zero();
+    _gyro_bias = gyro_bias;
+    _wind = Vector2f(0, 0);
+
+    memset(_P, 0, sizeof(_P));
+    P(0,0) = P(1,1) = sq(INIT_SIGMA_TILT);
+    P(2,2) = sq(INIT_SIGMA_YAW);
+    for (uint8_t i=0; i<3; i++) {
+        P(STATE_VEL+i,  STATE_VEL+i)  = sq(INIT_SIGMA_VEL);
+        P(STATE_POS+i,  STATE_POS+i)  = sq(INIT_SIGMA_POS);
+        P(STATE_BIAS+i, STATE_BIAS+i) = sq(INIT_SIGMA_BIAS);
+    }
+    P(STATE_WIND,   STATE_WIND)   = sq(INIT_SIGMA_WIND);
+    P(STATE_WIND+1, STATE_WIND+1) = sq(INIT_SIGMA_WIND);
+
+    _initialised = true;
+}
+
+/*
+  propagate the state and covariance.
+
+  With R the body to earth rotation and f the specific force in the
+  earth frame, the error dynamics are
+
+     d(att)/dt  = -R * bias
+     d(vel)/dt  = -f x att
+     d(pos)/dt  = vel
+
+  so the state transition matrix is F = I + A*dt where A has only
+  those three 3x3 blocks. F*P*F' = P + dt*(A*P + (A*P)') + dt^2*A*P*A'
+  is evaluated block by block. A*P has only nine non-zero rows, and
+  A*P*A' is confined to the first nine rows and columns
+ */
+void AP_NavEKF::predict(const Vector3f &delta_angle, const Vector3f &accel, float dt)
+{
+    if (!_initialised || dt <= 0) {
+        return;
+    }
+
+    Matrix3f R;
+    _quat.rotation_matrix(R);
+
+    // specific force and acceleration in the earth frame
+    Vector3f f = R * accel;
+    Vector3f a = f + Vector3f(0, 0, GRAVITY_MSS);
+
+    // full state
+    _position += _velocity * dt + a * (0.5f * dt * dt);
+    _velocity += a * dt;
+    _quat.rotate(delta_angle - _gyro_bias * dt);
+    _quat.normalize();
+
+    // M = A*P, rows 0 to 8. Row k of A*P is built from column k of A
+    // applied to each column of P
+    float M[9][NAVEKF_NSTATES];
+    for (uint8_t j=0; j<NAVEKF_NSTATES; j++) {
+        Vector3f p_att(P(0,j), P(1,j), P(2,j));
+        Vector3f p_vel(P(3,j), P(4,j), P(5,j));
+        Vector3f p_bias(P(9,j), P(10,j), P(11,j));
+        Vector3f m_att = -(R * p_bias);
+        Vector3f m_vel = -(f % p_att);
+        M[0][j] = m_att.x; M[1][j] = m_att.y; M[2][j] = m_att.z;
+        M[3][j] = m_vel.x; M[4][j] = m_vel.y; M[5][j] = m_vel.z;
+        M[6][j] = p_vel.x; M[7][j] = p_vel.y; M[8][j] = p_vel.z;
+    }
+
+    // A*P*A' = M*A'. Element (i,j) is row j of A applied to row i
+    // of M, so only j < 9 is non-zero
+    float dt2 = dt * dt;
+    for (uint8_t i=0; i<9; i++) {
+        Vector3f m_att(M[i][0], M[i][1], M[i][2]);
+        Vector3f m_vel(M[i][3], M[i][4], M[i][5]);
+        Vector3f m_bias(M[i][9], M[i][10], M[i][11]);
+        float ama[9];
+        Vector3f t = -(R * m_bias);
+        ama[0] = t.x; ama[1] = t.y; ama[2] = t.z;
+        t = -(f % m_att);
+        ama[3] = t.x; ama[4] = t.y; ama[5] = t.z;
+        ama[6] = m_vel.x; ama[7] = m_vel.y; ama[8] = m_vel.z;
+        for (uint8_t j=i; j<9; j++) {
+            P(i,j) += dt2 * ama[j];
+        }
+    }
+
+    // first order terms, upper triangle only
+    for (uint8_t i=0; i<NAVEKF_NSTATES; i++) {
+        for (uint8_t j=i; j<NAVEKF_NSTATES; j++) {
+            float sum = 0;
+            if (i < 9) {
+                sum += M[i][j];
+            }
+            if (j < 9) {
+                sum += M[j][i];
+            }
+            if (sum != 0) {
+                P(i,j) += dt * sum;
+            }
+        }
+    }
+
+    // process noise
+    float q_att  = sq(NOISE_GYRO * dt);
+    float q_vel  = sq(NOISE_ACCEL * dt);
+    float q_bias = sq(NOISE_GYRO_BIAS * dt);
+    float q_wind = sq(NOISE_WIND * dt);
+    for (uint8_t i=0; i<3; i++) {
+        P(STATE_ATT+i,  STATE_ATT+i)  += q_att;
+        P(STATE_VEL+i,  STATE_VEL+i)  += q_vel;
+        P(STATE_BIAS+i, STATE_BIAS+i) += q_bias;
+    }
+    P(STATE_WIND,   STATE_WIND)   += q_wind;
+    P(STATE_WIND+1, STATE_WIND+1) += q_wind;
+
+    _constrain_variances();
+}
+
+/*
+  fuse one scalar measurement. H is the observation row, most of
+  which is zero, and innovation is measured minus predicted
+ */
+bool AP_NavEKF::_fuse(const float *H, float innovation, float variance)
+{
+    float PHt[NAVEKF_NSTATES];
+    for (uint8_t i=0; i<NAVEKF_NSTATES; i++) {
+        float sum = 0;
+        for (uint8_t k=0; k<NAVEKF_NSTATES; k++) {
+            if (H[k] != 0) {
+                sum += P(i,k) * H[k];
+            }
+        }
+        PHt[i] = sum;
+    }
+
+    float S = variance;
+    for (uint8_t k=0; k<NAVEKF_NSTATES; k++) {
+        S += H[k] * PHt[k];
+    }
+    if (!(S > 0) || sq(innovation) > sq(INNOVATION_GATE) * S) {
+        return false;
+    }
+
+    float dx[NAVEKF_NSTATES];
+    float inv_S = 1.0f / S;
+    for (uint8_t i=0; i<NAVEKF_NSTATES; i++) {
+        float K = PHt[i] * inv_S;
+        dx[i] = K * innovation;
+        for (uint8_t j=i; j<NAVEKF_NSTATES; j++) {
+            P(i,j) -= K * PHt[j];
+        }
+    }
+    _constrain_variances();
+    _correct(dx);
+    return true;
+}
+
+// fold the error state estimate into the full state
+void AP_NavEKF::_correct(const float *dx)
+{
+    // the attitude error is in the earth frame, and
+    // Quaternion::rotate() takes a body frame rotation
+    Matrix3f R;
+    _quat.rotation_matrix(R);
+    _quat.rotate(R.mul_transpose(Vector3f(dx[0], dx[1], dx[2])));
+    _quat.normalize();
+
+    _velocity  += Vector3f(dx[3], dx[4], dx[5]);
+    _position  += Vector3f(dx[6], dx[7], dx[8]);
+    _gyro_bias += Vector3f(dx[9], dx[10], dx[11]);
+    _wind      += Vector2f(dx[12], dx[13]);
+}
+
+void AP_NavEKF::_constrain_variances(void)
+{
+    for (uint8_t i=0; i<NAVEKF_NSTATES; i++) {
+        float &v = P(i,i);
+        if (!(v > 1.0e-9f)) {
+            v = 1.0e-9f;
+        } else if (v > 1.0e6f) {
+            v = 1.0e6f;
+        }
+    }
+}
+
+// fuse a direct measurement of one state
+bool AP_NavEKF::_fuse_state(uint8_t state, float innovation, float variance)
+{
+    float H[NAVEKF_NSTATES];
+    memset(H, 0, sizeof(H));
+    H[state] = 1;
+    return _fuse(H, innovation, variance);
+}
+
+bool AP_NavEKF::fuse_velocity(const Vector3f &velocity, bool use_down)
+{
+    // each fusion corrects the state, so the next innovation must be
+    // taken from the corrected velocity
+    bool ret = _fuse_state(STATE_VEL, velocity.x - _velocity.x, sq(SIGMA_VEL_NE));
+    ret &= _fuse_state(STATE_VEL+1, velocity.y - _velocity.y, sq(SIGMA_VEL_NE));
+    if (use_down) {
+        ret &= _fuse_state(STATE_VEL+2, velocity.z - _velocity.z, sq(SIGMA_VEL_D));
+    }
+    return ret;
+}
+
+bool AP_NavEKF::fuse_position_ne(float north, float east)
+{
+    bool ret = _fuse_state(STATE_POS, north - _position.x, sq(SIGMA_POS_NE));
+    ret &= _fuse_state(STATE_POS+1, east - _position.y, sq(SIGMA_POS_NE));
+    return ret;
+}
+
+// height is positive up from the origin
+bool AP_NavEKF::fuse_height(float height)
+{
+    return _fuse_state(STATE_POS+2, -height - _position.z, sq(SIGMA_HEIGHT));
+}
+
+/*
+  fuse a yaw measurement. With yaw = atan2(R.b.x, R.a.x), a small
+  earth frame rotation e changes yaw by
+     e.z - R.c.x * (R.a.x*e.x + R.b.x*e.y) / (R.a.x^2 + R.b.x^2)
+ */
+bool AP_NavEKF::fuse_heading(float yaw)
+{
+    Matrix3f R;
+    _quat.rotation_matrix(R);
+    float h = sq(R.a.x) + sq(R.b.x);
+    if (h < 0.01f) {
+        // pointing straight up or down, yaw is meaningless
+        return false;
+    }
+    float H[NAVEKF_NSTATES];
+    memset(H, 0, sizeof(H));
+    H[STATE_ATT]   = -R.c.x * R.a.x / h;
+    H[STATE_ATT+1] = -R.c.x * R.b.x / h;
+    H[STATE_ATT+2] = 1;
+    float innovation = wrap_PI(yaw - atan2f(R.b.x, R.a.x));
+    return _fuse(H, innovation, sq(SIGMA_HEADING));
+}
+
+// true airspeed is |velocity - wind|, with no vertical wind
+bool AP_NavEKF::fuse_airspeed(float true_airspeed)
+{
+    Vector3f rel(_velocity.x - _wind.x, _velocity.y - _wind.y, _velocity.z);
+    float predicted = rel.length();
+    if (predicted < 1.0f) {
+        return false;
+    }
+    float H[NAVEKF_NSTATES];
+    memset(H, 0, sizeof(H));
+    H[STATE_VEL]    = rel.x / predicted;
+    H[STATE_VEL+1]  = rel.y / predicted;
+    H[STATE_VEL+2]  = rel.z / predicted;
+    H[STATE_WIND]   = -H[STATE_VEL];
+    H[STATE_WIND+1] = -H[STATE_VEL+1];
+    return _fuse(H, true_airspeed - predicted, sq(SIGMA_AIRSPEED));
+}
+
+bool AP_NavEKF::healthy(void) const
+{
+    if (!_initialised) {
+        return false;
+    }
+    Quaternion q = _quat;
+    if (q.is_nan() || _velocity.is_nan() || _position.is_nan()) {
+        return false;
+    }
+    for (uint8_t i=0; i<NAVEKF_NSTATES; i++) {
+        if (isnan(P(i,i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float AP_NavEKF::get_position_sigma(void) const
+{
+    return safe_sqrt(P(STATE_POS,STATE_POS) + P(STATE_POS+1,STATE_POS+1));
+}
+
+#endif // AP_AHRS_NAVEKF_AVAILABLE
@@ -0,0 +1,109 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#ifndef __AP_NAVEKF_H__
+#define __AP_NAVEKF_H__
+/*
+ *  extended Kalman filter for attitude, velocity and position
+ *
+ *  This is an error state filter. The full state (attitude
+ *  quaternion, NED velocity and position, gyro bias and horizontal
+ *  wind) is propagated directly from the IMU, and the filter
+ *  estimates the small errors in it, which are folded back into the
+ *  full state after each measurement. The 14 error states are
+ *
+ *     0-2   attitude error in the earth frame (radians)
+ *     3-5   velocity error NED (m/s)
+ *     6-8   position error NED (m)
+ *     9-11  gyro bias (rad/s)
+ *     12-13 wind north and east (m/s)
+ *
+ *  The covariance matrix is symmetric, so only its upper triangle is
+ *  stored. The state transition matrix is the identity plus a handful
+ *  of 3x3 blocks, and the prediction step is written out in terms of
+ *  those blocks rather than as general matrix products. Measurements
+ *  are fused one scalar at a time, which needs no matrix inversion.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ */
+
+#include <AP_Math.h>
+
+#define NAVEKF_NSTATES 14
+
+// packed upper triangle of the covariance matrix
+#define NAVEKF_NCOV (NAVEKF_NSTATES*(NAVEKF_NSTATES+1)/2)
+
+class AP_NavEKF
+{
+public:
+    AP_NavEKF();
+
+    // start the filter at the given attitude and velocity, at the
+    // position origin
+    void init(float roll, float pitch, float yaw, const Vector3f &velocity, const Vector3f &gyro_bias);
+
+    // stop the filter. It must be re-initialised before use
+    void reset(void) { _initialised = false; }
+
+    // propagate the state and covariance using a body frame rotation
+    // over the time step and the mean specific force in m/s/s
+    void predict(const Vector3f &delta_angle, const Vector3f &accel, float dt);
+
+    // measurement updates. Each returns false if the measurement was
+    // rejected by the innovation consistency check
+    bool fuse_velocity(const Vector3f &velocity, bool use_down);
+    bool fuse_position_ne(float north, float east);
+    bool fuse_height(float height);
+    bool fuse_heading(float yaw);
+    bool fuse_airspeed(float true_airspeed);
+
+    // true if the filter is running and the state is numerically sane
+    bool healthy(void) const;
+
+    // outputs
+    const Quaternion &get_quaternion(void) const { return _quat; }
+    void get_dcm_matrix(Matrix3f &m) const { Quaternion q = _quat; q.rotation_matrix(m); }
+    const Vector3f &get_velocity(void) const { return _velocity; }
+    const Vector3f &get_position(void) const { return _position; }
+    const Vector3f &get_gyro_bias(void) const { return _gyro_bias; }
+    Vector3f get_wind(void) const { return Vector3f(_wind.x, _wind.y, 0); }
+
+    // one sigma position uncertainty, for health reporting
+    float get_position_sigma(void) const;
+
+private:
+    // covariance access. Only the i <= j half is stored
+    static uint8_t _index(uint8_t i, uint8_t j) {
+        if (i > j) {
+            uint8_t t = i; i = j; j = t;
+        }
+        return i*NAVEKF_NSTATES - (i*(i-1))/2 + (j-i);
+    }
+    float &P(uint8_t i, uint8_t j) { return _P[_index(i,j)]; }
+    float P(uint8_t i, uint8_t j) const { return _P[_index(i,j)]; }
+
+    // fuse one scalar measurement with observation vector H
+    bool _fuse(const float *H, float innovation, float variance);
+    bool _fuse_state(uint8_t state, float innovation, float variance);
+
+    // fold the estimated error states into the full state
+    void _correct(const float *dx);
+
+    // keep the diagonal within sane limits
+    void _constrain_variances(void);
+
+    bool _initialised;
+
+    Quaternion _quat;               // body to earth rotation
+    Vector3f _velocity;             // NED m/s
+    Vector3f _position;             // NED m from the origin
+    Vector3f _gyro_bias;            // rad/s
+    Vector2f _wind;                 // NE m/s
+
+    float _P[NAVEKF_NCOV];
+};
+
+#endif // __AP_NAVEKF_H__
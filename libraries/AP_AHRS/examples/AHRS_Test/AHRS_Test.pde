@@ -46,6 +46,7 @@ AP_GPS_Auto g_gps_driver(&g_gps);
 
 // choose which AHRS system to use
 AP_AHRS_DCM  ahrs(&ins, g_gps);
+//AP_AHRS_Quaternion  ahrs(&ins, g_gps);
 //AP_AHRS_MPU6000  ahrs(&ins, g_gps);		// only works with APM2
 
 AP_Baro_HIL barometer;
@@ -104,6 +105,7 @@ void setup(void)
 void loop(void)
 {
     static uint16_t counter;
+    static uint32_t update_us;
     static uint32_t last_t, last_print, last_compass;
     uint32_t now = hal.scheduler->micros();
     float heading = 0;
@@ -124,14 +126,19 @@ void loop(void)
 #endif
     }
 
+    // time the update for comparing AHRS backends. This includes
+    // reading the IMU
+    uint32_t t0 = hal.scheduler->micros();
     ahrs.update();
+    update_us += hal.scheduler->micros() - t0;
     counter++;
 
     if (now - last_print >= 100000 /* 100ms : 10hz */) {
         Vector3f drift  = ahrs.get_gyro_drift();
         hal.console->printf_P(
                 PSTR("r:%4.1f  p:%4.1f y:%4.1f "
-                    "drift=(%5.1f %5.1f %5.1f) hdg=%.1f rate=%.1f\n"),
+                    "drift=(%5.1f %5.1f %5.1f) hdg=%.1f rate=%.1f "
+                    "update=%luus renorm=%lu/%lu\n"),
                         ToDeg(ahrs.roll),
                         ToDeg(ahrs.pitch),
                         ToDeg(ahrs.yaw),
@@ -139,9 +146,13 @@ void loop(void)
                         ToDeg(drift.y),
                         ToDeg(drift.z),
                         compass.use_for_yaw() ? ToDeg(heading) : 0.0,
-                        (1.0e6*counter)/(now-last_print));
+                        (1.0e6*counter)/(now-last_print),
+                        (unsigned long)(update_us/counter),
+                        (unsigned long)ahrs.renorm_taylor_count,
+                        (unsigned long)ahrs.renorm_exact_count);
         last_print = now;
         counter = 0;
+        update_us = 0;
     }
 }
 
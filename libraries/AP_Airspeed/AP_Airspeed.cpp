@@ -87,6 +87,10 @@ const AP_Param::GroupInfo AP_Airspeed::var_info[] PROGMEM = {
  */
 #define SCALING_OLD_CALIBRATION 819 // 4095/5
 
+// rate of the averaged samples of an analog sensor, which is faster
+// than the fastest caller of read()
+#define AIRSPEED_SAMPLE_RATE_HZ 20
+
 void AP_Airspeed::init()
 {
     _last_pressure = 0;
@@ -107,10 +111,12 @@ void AP_Airspeed::init()
 #if CONFIG_HAL_BOARD == HAL_BOARD_APM1
     if (_pin == 64) {
         _source = new AP_ADC_AnalogSource( &apm1_adc, 7, 1.0f);
+        _source->set_sample_rate(AIRSPEED_SAMPLE_RATE_HZ);
         return;
     }
 #endif
     _source = hal.analogin->channel(_pin);
+    _source->set_sample_rate(AIRSPEED_SAMPLE_RATE_HZ);
 
     _calibration.init(_ratio);
     _last_saved_ratio = _ratio;
@@ -175,9 +181,15 @@ void AP_Airspeed::calibrate()
 void AP_Airspeed::read(void)
 {
     float airspeed_pressure;
+    uint32_t sample_ms;
     if (!_enable) {
         return;
     }
+    if (_source != NULL && !_source->sample_ready(sample_ms)) {
+        // no new average since the last read, so filtering the
+        // same one again would only add lag
+        return;
+    }
     float raw               = get_pressure();
     airspeed_pressure       = max(raw - _offset, 0);
     _raw_airspeed           = sqrtf(airspeed_pressure * _ratio);
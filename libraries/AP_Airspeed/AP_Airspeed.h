@@ -7,6 +7,12 @@
 #include <AP_HAL.h>
 #include <AP_Param.h>
 
+// the number of samples kept for the calibration between updates,
+// enough for a second of them at the airspeed read rate
+#ifndef AIRSPEED_CAL_BATCH
+# define AIRSPEED_CAL_BATCH 10
+#endif
+
 class Airspeed_Calibration {
 public:
     // constructor
@@ -15,17 +21,35 @@ public:
     // initialise the calibration
     void init(float initial_ratio);
 
-    // take current airspeed in m/s and ground speed vector and return
-    // new scaling factor
-    float update(float airspeed, const Vector3f &vg);
+    // keep an airspeed in m/s and ground speed vector for the next
+    // update. Samples beyond the batch are dropped
+    void add_sample(float airspeed, const Vector3f &vg);
+
+    // fuse the kept samples and return the new scaling factor. Needs
+    // to be called once a second
+    float update(void);
 
 private:
-    // state of kalman filter for airspeed ratio estimation
-    Matrix3f P; // covarience matrix
+    // a sample, in cm/s
+    struct sample {
+        int16_t tas;
+        int16_t vx, vy, vz;
+    };
+
+    void add_noise(uint8_t k, float q);
+    void fuse(float airspeed, const Vector3f &vg);
+
+    // state of kalman filter for airspeed ratio estimation. The
+    // covariance is kept factorised as U*D*U' with U unit upper
+    // triangular, which stays symmetric and positive in float
+    float U[3][3];
+    float D[3];
     const float Q0; // process noise matrix top left and middle element
     const float Q1; // process noise matrix bottom right element
     Vector3f state; // state vector
-    const float DT; // time delta
+
+    struct sample samples[AIRSPEED_CAL_BATCH];
+    uint8_t num_samples;
 };
 
 class AP_Airspeed
@@ -109,8 +133,12 @@ public:
         return _EAS2TAS;
     }
 
-    // update airspeed ratio calibration
-    void update_calibration(Vector3f vground);
+    // keep a sample for the airspeed ratio calibration, at the
+    // airspeed read rate
+    void add_calibration_sample(const Vector3f &vground);
+
+    // update airspeed ratio calibration from the samples
+    void update_calibration(void);
 
     static const struct AP_Param::GroupInfo var_info[];
 
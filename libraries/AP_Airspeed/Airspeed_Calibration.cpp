@@ -15,14 +15,16 @@ extern const AP_HAL::HAL& hal;
 
 // constructor - fill in all the initial values
 Airspeed_Calibration::Airspeed_Calibration() :
-    P(100,   0,         0,
-      0,   100,         0,
-      0,     0,  0.000001f),
     Q0(0.01f),
     Q1(0.000001f),
     state(0, 0, 0),
-    DT(1)
+    num_samples(0)
 {
+    memset(U, 0, sizeof(U));
+    U[0][0] = U[1][1] = U[2][2] = 1;
+    D[0] = 100;
+    D[1] = 100;
+    D[2] = 0.000001f;
 }
 
 /*
@@ -33,22 +35,47 @@ void Airspeed_Calibration::init(float initial_ratio)
     state.z = 1.0 / sqrtf(initial_ratio);
 }
 
+void Airspeed_Calibration::add_sample(float airspeed, const Vector3f &vg)
+{
+    if (num_samples == AIRSPEED_CAL_BATCH) {
+        return;
+    }
+    struct sample &s = samples[num_samples++];
+    s.tas = constrain_float(airspeed * 100, 0, 32767);
+    s.vx  = constrain_float(vg.x * 100, -32767, 32767);
+    s.vy  = constrain_float(vg.y * 100, -32767, 32767);
+    s.vz  = constrain_float(vg.z * 100, -32767, 32767);
+}
+
 /*
-  update the state of the airspeed calibration - needs to be called
-  once a second
+  add q to element k of the diagonal of the covariance, as the Agee-Turner
+  rank one update of U and D with the unit vector along k
+ */
+void Airspeed_Calibration::add_noise(uint8_t k, float q)
+{
+    float a[3] = { 0, 0, 0 };
+    a[k] = 1;
+    for (uint8_t j=2; j>0; j--) {
+        float s = a[j];
+        float d = D[j] + q*s*s;
+        float b = q / d;
+        float beta = s * b;
+        q = b * D[j];
+        D[j] = d;
+        for (uint8_t i=0; i<j; i++) {
+            a[i] -= s * U[i][j];
+            U[i][j] += beta * a[i];
+        }
+    }
+    D[0] += q * a[0] * a[0];
+}
 
-  On an AVR2560 this costs 1.9 milliseconds per call
+/*
+  fuse one airspeed measurement, with the Bierman update of U and D. This
+  needs no square root, and D can only shrink towards zero, never past it
  */
-float Airspeed_Calibration::update(float airspeed, const Vector3f &vg)
+void Airspeed_Calibration::fuse(float airspeed, const Vector3f &vg)
 {
-    // Perform the covariance prediction
-    // Q is a diagonal matrix so only need to add three terms in
-    // C code implementation
-    // P = P + Q;
-    P.a.x += Q0;
-    P.b.y += Q0;
-    P.c.z += Q1;
-    
     // Perform the predicted measurement using the current state estimates
     // No state prediction required because states are assumed to be time
     // invariant plus process noise
@@ -60,55 +87,81 @@ float Airspeed_Calibration::update(float airspeed, const Vector3f &vg)
     float SH1 = sq(vg.y - state.y) + sq(vg.x - state.x);
     if (SH1 < 0.000001f) {
         // avoid division by a small number
-        return state.z;
+        return;
     }
-    float SH2 = 1/sqrt(SH1);
+    float SH2 = 1/sqrtf(SH1);
 
     // observation Jacobian
-    Vector3f H_TAS(
-        -(state.z*SH2*(2*vg.x - 2*state.x))/2,
-        -(state.z*SH2*(2*vg.y - 2*state.y))/2,
-        1/SH2);
-    
-    // Calculate the fusion innovaton covariance assuming a TAS measurement
-    // noise of 1.0 m/s
-    // S = H_TAS*P*H_TAS' + 1.0; % [1 x 3] * [3 x 3] * [3 x 1] + [1 x 1]
-    Vector3f PH = P * H_TAS;
-    float S = H_TAS * PH + 1.0f;
-    
-    // Calculate the Kalman gain
-    // [3 x 3] * [3 x 1] / [1 x 1]
-    Vector3f KG = PH / S; 
-    
+    float H_TAS[3] = {
+        -state.z*SH2*(vg.x - state.x),
+        -state.z*SH2*(vg.y - state.y),
+        1/SH2 };
+
+    // f = U'*H_TAS' and v = D*f
+    float f[3], v[3];
+    for (uint8_t j=0; j<3; j++) {
+        f[j] = H_TAS[j];
+        for (uint8_t i=0; i<j; i++) {
+            f[j] += U[i][j] * H_TAS[i];
+        }
+        v[j] = D[j] * f[j];
+    }
+
+    // update U and D a column at a time, accumulating the unscaled
+    // Kalman gain in KG, with the innovation covariance starting from
+    // a TAS measurement noise of 1.0 m/s
+    float alpha = 1.0f;
+    float KG[3];
+    for (uint8_t j=0; j<3; j++) {
+        float beta = alpha;
+        alpha += f[j] * v[j];
+        float lambda = -f[j] / beta;
+        D[j] *= beta / alpha;
+        for (uint8_t i=0; i<j; i++) {
+            float Uij = U[i][j];
+            U[i][j] = Uij + KG[i] * lambda;
+            KG[i] += Uij * v[j];
+        }
+        KG[j] = v[j];
+    }
+
     // Update the states
-    state += KG*(TAS_mea - TAS_pred); // [3 x 1] + [3 x 1] * [1 x 1]
-    
-    // Update the covariance matrix
-    Vector3f HP2 = H_TAS * P;
-    P -= KG.mul_rowcol(HP2);
-    
-    // force symmetry on the covariance matrix - necessary due to rounding
-    // errors
-	float P12 = 0.5f * (P.a.y + P.b.x);
-	float P13 = 0.5f * (P.a.z + P.c.x);
-	float P23 = 0.5f * (P.b.z + P.c.y);
-	P.a.y = P.b.x = P12;
-	P.a.z = P.c.x = P13;
-	P.b.z = P.c.y = P23;
-
-    // Constrain diagonals to be non-negative - protects against rounding errors
-    P.a.x = max(P.a.x, 0.0f);
-    P.b.y = max(P.b.y, 0.0f);
-    P.c.z = max(P.c.z, 0.0f);
+    float innovation = (TAS_mea - TAS_pred) / alpha;
+    state.x += KG[0] * innovation;
+    state.y += KG[1] * innovation;
+    state.z += KG[2] * innovation;
+}
+
+/*
+  update the state of the airspeed calibration from the samples kept
+  since the last update - needs to be called once a second
+ */
+float Airspeed_Calibration::update(void)
+{
+    if (num_samples == 0) {
+        return state.z;
+    }
+
+    // Perform the covariance prediction
+    // Q is a diagonal matrix so only need to add three terms
+    add_noise(0, Q0);
+    add_noise(1, Q0);
+    add_noise(2, Q1);
+
+    for (uint8_t i=0; i<num_samples; i++) {
+        const struct sample &s = samples[i];
+        fuse(s.tas * 0.01f, Vector3f(s.vx, s.vy, s.vz) * 0.01f);
+    }
+    num_samples = 0;
 
     return state.z;
 }
 
 
 /*
-  called once a second to do calibration update
+  called at the airspeed read rate to keep a sample for the calibration
  */
-void AP_Airspeed::update_calibration(Vector3f vground)
+void AP_Airspeed::add_calibration_sample(const Vector3f &vground)
 {
     if (!_autocal) {
         // auto-calibration not enabled
@@ -116,7 +169,19 @@ void AP_Airspeed::update_calibration(Vector3f vground)
     }
     // calculate true airspeed, assuming a airspeed ratio of 1.0
     float true_airspeed = sqrtf(get_differential_pressure()) * _EAS2TAS;
-    float ratio = _calibration.update(true_airspeed, vground);
+    _calibration.add_sample(true_airspeed, vground);
+}
+
+/*
+  called once a second to do calibration update
+ */
+void AP_Airspeed::update_calibration(void)
+{
+    if (!_autocal) {
+        // auto-calibration not enabled
+        return;
+    }
+    float ratio = _calibration.update();
     if (isnan(ratio) || isinf(ratio)) {
         return;
     }
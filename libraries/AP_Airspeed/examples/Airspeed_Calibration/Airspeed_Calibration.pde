@@ -36,8 +36,11 @@ void setup()
 
 void loop(void)
 {
+    for (uint8_t i=0; i<AIRSPEED_CAL_BATCH; i++) {
+        acal.add_sample(15, Vector3f(10,20,13));
+    }
     uint32_t tstart = hal.scheduler->micros();
-    acal.update(15, Vector3f(10,20,13));
+    acal.update();
     hal.console->printf_P(PSTR("update took %u usec\n"),
                           hal.scheduler->micros() - tstart);
     hal.scheduler->delay(1000);
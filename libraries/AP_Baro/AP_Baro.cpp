@@ -15,6 +15,67 @@
 
 extern const AP_HAL::HAL& hal;
 
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+// on AVR the altitude comes from a table of the exact calculation
+// below, per kelvin of ground temperature, against the ratio of the
+// pressure to the ground pressure. Interpolated linearly it is within
+// 5cm of the calculation up to 5500m above the ground
+#define BARO_ALT_TABLE_MIN      0.5f        // lowest pressure ratio in the table
+#define BARO_ALT_TABLE_STEPS    256         // entries per unit of pressure ratio
+#define BARO_ALT_TABLE_SIZE     145         // up to a ratio of 1.0625, 500m below the ground
+
+static const float altitude_table[BARO_ALT_TABLE_SIZE] PROGMEM = {
+    19.0079499f, 18.8081575f, 18.6096153f, 18.4123060f, 18.2162125f,
+    18.0213183f, 17.8276071f, 17.6350629f, 17.4436701f, 17.2534136f,
+    17.0642782f, 16.8762495f, 16.6893128f, 16.5034543f, 16.3186602f,
+    16.1349168f, 15.9522109f, 15.7705295f, 15.5898599f, 15.4101896f,
+    15.2315062f, 15.0537979f, 14.8770526f, 14.7012590f, 14.5264055f,
+    14.3524810f, 14.1794746f, 14.0073755f, 13.8361731f, 13.6658571f,
+    13.4964172f, 13.3278435f, 13.1601262f, 12.9932554f, 12.8272219f,
+    12.6620162f, 12.4976292f, 12.3340518f, 12.1712752f, 12.0092907f,
+    11.8480897f, 11.6876639f, 11.5280049f, 11.3691045f, 11.2109549f,
+    11.0535480f, 10.8968761f, 10.7409317f, 10.5857072f, 10.4311952f,
+    10.2773885f, 10.1242798f, 9.9718622f, 9.8201288f, 9.6690726f,
+    9.5186870f, 9.3689654f, 9.2199012f, 9.0714881f, 8.9237197f,
+    8.7765897f, 8.6300921f, 8.4842208f, 8.3389699f, 8.1943334f,
+    8.0503057f, 7.9068810f, 7.7640537f, 7.6218182f, 7.4801691f,
+    7.3391011f, 7.1986089f, 7.0586871f, 6.9193307f, 6.7805346f,
+    6.6422937f, 6.5046032f, 6.3674582f, 6.2308537f, 6.0947852f,
+    5.9592480f, 5.8242373f, 5.6897488f, 5.5557778f, 5.4223199f,
+    5.2893709f, 5.1569263f, 5.0249819f, 4.8935335f, 4.7625769f,
+    4.6321081f, 4.5021231f, 4.3726177f, 4.2435882f, 4.1150305f,
+    3.9869409f, 3.8593156f, 3.7321508f, 3.6054428f, 3.4791880f,
+    3.3533828f, 3.2280236f, 3.1031069f, 2.9786291f, 2.8545870f,
+    2.7309770f, 2.6077959f, 2.4850403f, 2.3627070f, 2.2407927f,
+    2.1192942f, 1.9982083f, 1.8775321f, 1.7572623f, 1.6373959f,
+    1.5179299f, 1.3988614f, 1.2801873f, 1.1619048f, 1.0440111f,
+    0.9265031f, 0.8093783f, 0.6926337f, 0.5762666f, 0.4602743f,
+    0.3446542f, 0.2294035f, 0.1145196f, 0.0000000f, -0.1141580f,
+    -0.2279568f, -0.3413991f, -0.4544872f, -0.5672237f, -0.6796110f,
+    -0.7916514f, -0.9033474f, -1.0147014f, -1.1257156f, -1.2363924f,
+    -1.3467340f, -1.4567428f, -1.5664209f, -1.6757706f, -1.7847940f,
+};
+#endif
+
+// altitude in meters per kelvin of ground temperature at a ratio of
+// pressure to ground pressure
+static float altitude_per_kelvin(float scaling)
+{
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+    float steps = (scaling - BARO_ALT_TABLE_MIN) * BARO_ALT_TABLE_STEPS;
+    if (steps >= 0 && steps < BARO_ALT_TABLE_SIZE - 1) {
+        uint8_t i = steps;
+        float a0 = pgm_read_float(&altitude_table[i]);
+        float a1 = pgm_read_float(&altitude_table[i + 1]);
+        return a0 + (a1 - a0) * (steps - i);
+    }
+    // outside the table use the calculation
+#endif
+    // This is an exact calculation that is within +-2.5m of the standard atmosphere tables
+    // in the troposphere (up to 11,000 m amsl).
+    return 153.8462f * (1.0f - expf(0.190259f * logf(scaling)));
+}
+
 // table of user settable parameters
 const AP_Param::GroupInfo AP_Baro::var_info[] PROGMEM = {
     // NOTE: Index numbers 0 and 1 were for the old integer
@@ -47,64 +108,70 @@ const AP_Param::GroupInfo AP_Baro::var_info[] PROGMEM = {
 // the altitude() or climb_rate() interfaces can be used
 void AP_Baro::calibrate()
 {
-    float ground_pressure = 0;
-    float ground_temperature = 0;
+    start_calibration();
+    while (!update_calibration()) {
+        hal.scheduler->delay(10);
+    }
+}
 
+// start a calibration which update_calibration() carries out
+void AP_Baro::start_calibration()
+{
     // reset the altitude offset when we calibrate. The altitude
     // offset is supposed to be for within a flight
     _alt_offset.set_and_save(0);
 
-    {
-        uint32_t tstart = hal.scheduler->millis();
-        while (ground_pressure == 0 || !healthy) {
-            read();         // Get initial data from absolute pressure sensor
-            if (hal.scheduler->millis() - tstart > 500) {
-                hal.scheduler->panic(PSTR("PANIC: AP_Baro::read unsuccessful "
-                        "for more than 500ms in AP_Baro::calibrate [1]\r\n"));
-            }
-            ground_pressure         = get_pressure();
-            ground_temperature      = get_temperature();
-            hal.scheduler->delay(20);
-        }
+    _cal_samples = 0;
+    _cal_last_ms = 0;
+    _cal_fail_ms = 0;
+    _calibrating = true;
+}
+
+// take the next sample of the calibration if it is due. The first
+// healthy reading is followed by AP_BARO_CAL_SETTLE readings 100ms
+// apart to let the barometer settle, as the MS5611 reads quite a long
+// way off for the first second, leading to about 1m of error if we
+// don't wait. The ground values are then averaged over
+// AP_BARO_CAL_AVERAGE more
+bool AP_Baro::update_calibration()
+{
+    if (!_calibrating) {
+        return true;
     }
-    // let the barometer settle for a full second after startup
-    // the MS5611 reads quite a long way off for the first second,
-    // leading to about 1m of error if we don't wait
-    for (uint8_t i = 0; i < 10; i++) {
-        uint32_t tstart = hal.scheduler->millis();
-        do {
-            read();
-            if (hal.scheduler->millis() - tstart > 500) {
-                hal.scheduler->panic(PSTR("PANIC: AP_Baro::read unsuccessful "
-                        "for more than 500ms in AP_Baro::calibrate [2]\r\n"));
-            }
-        } while (!healthy);
-        ground_pressure     = get_pressure();
-        ground_temperature  = get_temperature();
-
-        hal.scheduler->delay(100);
+    uint32_t now = hal.scheduler->millis();
+    if (_cal_samples != 0 && now - _cal_last_ms < 100) {
+        return false;
     }
 
-    // now average over 5 values for the ground pressure and
-    // temperature settings
-    for (uint16_t i = 0; i < 5; i++) {
-        uint32_t tstart = hal.scheduler->millis();
-        do {
-            read();
-            if (hal.scheduler->millis() - tstart > 500) {
-                hal.scheduler->panic(PSTR("PANIC: AP_Baro::read unsuccessful "
-                        "for more than 500ms in AP_Baro::calibrate [3]\r\n"));
-            }
-        } while (!healthy);
-        ground_pressure = (ground_pressure * 0.8f) + (get_pressure() * 0.2f);
-        ground_temperature = (ground_temperature * 0.8f) + 
-            (get_temperature() * 0.2f);
+    read();
+    if (!healthy || get_pressure() == 0) {
+        if (_cal_fail_ms == 0) {
+            _cal_fail_ms = now;
+        } else if (now - _cal_fail_ms > 500) {
+            hal.scheduler->panic(PSTR("PANIC: AP_Baro::read unsuccessful "
+                    "for more than 500ms in AP_Baro::calibrate\r\n"));
+        }
+        return false;
+    }
+    _cal_fail_ms = 0;
+    _cal_last_ms = now;
 
-        hal.scheduler->delay(100);
+    if (_cal_samples <= AP_BARO_CAL_SETTLE) {
+        _cal_pressure    = get_pressure();
+        _cal_temperature = get_temperature();
+    } else {
+        _cal_pressure    = (_cal_pressure * 0.8f) + (get_pressure() * 0.2f);
+        _cal_temperature = (_cal_temperature * 0.8f) +
+            (get_temperature() * 0.2f);
+    }
+    if (++_cal_samples <= AP_BARO_CAL_SETTLE + AP_BARO_CAL_AVERAGE) {
+        return false;
     }
 
-    _ground_pressure.set_and_save(ground_pressure);
-    _ground_temperature.set_and_save(ground_temperature / 10.0f);
+    _ground_pressure.set_and_save(_cal_pressure);
+    _ground_temperature.set_and_save(_cal_temperature / 10.0f);
+    _calibrating = false;
+    return true;
 }
 
 // return current altitude estimate relative to time that calibrate()
@@ -112,33 +179,20 @@ void AP_Baro::calibrate()
 // note that this relies on read() being called regularly to get new data
 float AP_Baro::get_altitude(void)
 {
-    float scaling, temp;
-
     if (_last_altitude_t == _last_update) {
         // no new information
         return _altitude + _alt_offset;
     }
 
+    update_ground_reference();
 
-#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
-    // on AVR use a less exact, but faster, calculation
-    scaling                                 = (float)_ground_pressure / (float)get_pressure();
-    temp                                    = ((float)_ground_temperature) + 273.15f;
-    _altitude = logf(scaling) * temp * 29.271267f;
-#else
-    // on faster CPUs use a more exact calculation
-    scaling                                 = (float)get_pressure() / (float)_ground_pressure;
-    temp                                    = ((float)_ground_temperature) + 273.15f;
-
-    // This is an exact calculation that is within +-2.5m of the standard atmosphere tables
-    // in the troposphere (up to 11,000 m amsl).
-	_altitude = 153.8462f * temp * (1.0f - expf(0.190259f * logf(scaling)));
-#endif
+    float scaling = get_pressure() * _ground_pressure_inv;
+    _altitude = altitude_per_kelvin(scaling) * _ground_temperature_k;
 
     _last_altitude_t = _last_update;
 
     // ensure the climb rate filter is updated
-    _climb_rate_filter.update(_altitude, _last_update);
+    update_climb_rate();
 
     return _altitude + _alt_offset;
 }
@@ -148,24 +202,63 @@ float AP_Baro::get_altitude(void)
 // assumes standard atmosphere lapse rate
 float AP_Baro::get_EAS2TAS(void)
 {
-    if ((abs(_altitude - _last_altitude_EAS2TAS) < 100.0f) && (_EAS2TAS != 0.0f)) {
+    update_ground_reference();
+
+    if ((fabsf(_altitude - _last_altitude_EAS2TAS) < 100.0f) && (_EAS2TAS != 0.0f)) {
         // not enough change to require re-calculating
         return _EAS2TAS;
     }
 
-    float tempK = ((float)_ground_temperature) + 273.15f - 0.0065f * _altitude;
+    float tempK = _ground_temperature_k - 0.0065f * _altitude;
     _EAS2TAS = safe_sqrt(1.225f / ((float)get_pressure() / (287.26f * tempK)));
     _last_altitude_EAS2TAS = _altitude;
     return _EAS2TAS;
 }
 
+// update_ground_reference - recalculates the values derived from the
+// ground pressure and temperature when calibrate() or a parameter
+// change has moved them
+void AP_Baro::update_ground_reference(void)
+{
+    if (_ground_pressure == _ref_ground_pressure && _ground_temperature == _ref_ground_temperature) {
+        return;
+    }
+    _ref_ground_pressure = _ground_pressure;
+    _ref_ground_temperature = _ground_temperature;
+
+    _ground_pressure_inv = _ref_ground_pressure != 0 ? 1.0f / _ref_ground_pressure : 0;
+    _ground_temperature_k = _ref_ground_temperature + 273.15f;
+
+    // the scale factor depends on the ground temperature too
+    _EAS2TAS = 0;
+}
+
 // return current climb_rate estimeate relative to time that calibrate()
 // was called. Returns climb rate in meters/s, positive means up
 // note that this relies on read() being called regularly to get new data
 float AP_Baro::get_climb_rate(void)
 {
-    // we use a 7 point derivative filter on the climb rate. This seems
-    // to produce somewhat reasonable results on real hardware
-    return _climb_rate_filter.slope() * 1.0e3f;
+    return _climb_rate;
+}
+
+// update_climb_rate - runs the complementary filter with the new
+// altitude. The altitude error corrects the filtered altitude and
+// climb rate, which otherwise follow the acceleration. The gains make
+// the filter critically damped at AP_BARO_CLIMB_OMEGA
+void AP_Baro::update_climb_rate(void)
+{
+    float dt = (_last_sample_us - _climb_last_update) * 1.0e-6f;
+    _climb_last_update = _last_sample_us;
+
+    if (dt <= 0 || dt > 1.0f) {
+        // first altitude, or we haven't been read for a long time
+        _climb_alt = _altitude;
+        _climb_rate = 0;
+        return;
+    }
+
+    float alt_error = _altitude - _climb_alt;
+    _climb_rate += (_accel_up + alt_error * (AP_BARO_CLIMB_OMEGA * AP_BARO_CLIMB_OMEGA)) * dt;
+    _climb_alt += (_climb_rate + alt_error * (2.0f * AP_BARO_CLIMB_OMEGA)) * dt;
 }
 
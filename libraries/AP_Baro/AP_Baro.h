@@ -5,14 +5,23 @@
 
 #include <AP_Param.h>
 #include <Filter.h>
-#include <DerivativeFilter.h>
+
+// crossover frequency in rad/s of the climb rate filter. Slower changes
+// come from the barometer and faster ones from the acceleration
+#define AP_BARO_CLIMB_OMEGA     1.5f
+
+// readings of a calibration that are thrown away while the sensor
+// settles, then averaged for the ground pressure and temperature
+#define AP_BARO_CAL_SETTLE      10
+#define AP_BARO_CAL_AVERAGE     5
 
 class AP_Baro
 {
 public:
     bool                    healthy;
 
-    AP_Baro() {
+    AP_Baro() :
+        _calibrating(false) {
 		AP_Param::setup_object_defaults(this, var_info);
     }
 
@@ -32,6 +41,14 @@ public:
     // the callback is a delay() like routine
     void        calibrate();
 
+    // start calibrating without waiting for it, so the calibration
+    // can go on while the rest of the startup runs.
+    // update_calibration() must then be called regularly, which
+    // returns true once the calibration is done
+    void        start_calibration();
+    bool        update_calibration();
+    bool        calibrating() const { return _calibrating; }
+
     // get current altitude in meters relative to altitude at the time
     // of the last calibrate() call
     float        get_altitude(void);
@@ -49,6 +66,11 @@ public:
     // going up
     float           get_climb_rate(void);
 
+    // set the vertical acceleration in m/s/s, positive up, which the
+    // climb rate filter fuses with the altitude. Without it the climb
+    // rate lags the altitude by about 2/AP_BARO_CLIMB_OMEGA seconds
+    void            set_vertical_accel(float accel) { _accel_up = accel; }
+
     // the ground values are only valid after calibration
     float           get_ground_temperature(void) {
         return _ground_temperature.get();
@@ -60,13 +82,24 @@ public:
     // get last time sample was taken
     uint32_t        get_last_update() { return _last_update; };
 
+    // micros() time the newest pressure sample in the last read() was
+    // taken by the sensor
+    uint32_t        get_last_sample_time_micros() const { return _last_sample_us; }
+
     static const struct AP_Param::GroupInfo        var_info[];
 
 protected:
     uint32_t                            _last_update;
+    uint32_t                            _last_sample_us;
     uint8_t                             _pressure_samples;
 
 private:
+    // recalculate the values derived from the ground pressure and temperature if they have changed
+    void                                update_ground_reference(void);
+
+    // update the climb rate filter with a new altitude
+    void                                update_climb_rate(void);
+
     AP_Float                            _ground_temperature;
     AP_Float                            _ground_pressure;
     AP_Int8                             _alt_offset;
@@ -74,7 +107,22 @@ private:
     float                               _last_altitude_EAS2TAS;
     float                               _EAS2TAS;
     uint32_t                            _last_altitude_t;
-    DerivativeFilterFloat_Size7         _climb_rate_filter;
+    float                               _ref_ground_pressure;       // ground pressure the values below were calculated for
+    float                               _ref_ground_temperature;    // ground temperature the values below were calculated for
+    float                               _ground_pressure_inv;       // 1 / ground pressure
+    float                               _ground_temperature_k;      // ground temperature in kelvin
+    // second order complementary filter of altitude and vertical acceleration
+    float                               _accel_up;                  // vertical acceleration in m/s/s
+    float                               _climb_alt;                 // filtered altitude in meters
+    float                               _climb_rate;                // climb rate in m/s
+    uint32_t                            _climb_last_update;         // _last_sample_us of the altitude last filtered
+    // calibration in progress
+    bool                                _calibrating;
+    uint8_t                             _cal_samples;               // healthy readings taken
+    uint32_t                            _cal_last_ms;               // time of the last of them
+    uint32_t                            _cal_fail_ms;               // time the readings became unhealthy, or 0
+    float                               _cal_pressure;
+    float                               _cal_temperature;
 };
 
 #include "AP_Baro_MS5611.h"
@@ -111,6 +111,7 @@ void AP_Baro_BMP085::accumulate(void)
     } else {
         ReadPress();
         Calculate();
+        _sample_us = hal.scheduler->micros();
     }
     BMP085_State++;
     if (BMP085_State == 5) {
@@ -132,6 +133,7 @@ uint8_t AP_Baro_BMP085::read()
         return 0;
     }
     _last_update = hal.scheduler->millis();
+    _last_sample_us = _sample_us;
 
     Temp = _temp_sum / _count;
     Press = _press_sum / _count;
@@ -31,6 +31,7 @@ private:
     float		    _temp_sum;
     float			_press_sum;
     uint8_t			_count;
+    uint32_t        _sample_us;                     // time of the newest pressure in the sums
     float           Temp;
     float           Press;
     
@@ -87,6 +87,7 @@ void AP_Baro_HIL::setHIL(float altitude_msl)
 
     healthy = true;
     _last_update = hal.scheduler->millis();
+    _last_sample_us = hal.scheduler->micros();
 }
 
 float AP_Baro_HIL::get_pressure() {
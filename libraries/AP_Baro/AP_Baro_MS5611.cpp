@@ -46,8 +46,35 @@ extern const AP_HAL::HAL& hal;
 #define CMD_MS5611_PROM_C5 0xAA
 #define CMD_MS5611_PROM_C6 0xAC
 #define CMD_MS5611_PROM_CRC 0xAE
-#define CMD_CONVERT_D1_OSR4096 0x48   // Maximum resolution (oversampling)
-#define CMD_CONVERT_D2_OSR4096 0x58   // Maximum resolution (oversampling)
+
+// the conversion commands for the oversampling ratio, and the longest a
+// conversion takes in microseconds
+#if MS5611_OSR == 4096
+# define CMD_MS5611_OSR         0x08
+# define MS5611_CONVERSION_US   9040
+#elif MS5611_OSR == 2048
+# define CMD_MS5611_OSR         0x06
+# define MS5611_CONVERSION_US   4540
+#elif MS5611_OSR == 1024
+# define CMD_MS5611_OSR         0x04
+# define MS5611_CONVERSION_US   2280
+#elif MS5611_OSR == 512
+# define CMD_MS5611_OSR         0x02
+# define MS5611_CONVERSION_US   1170
+#elif MS5611_OSR == 256
+# define CMD_MS5611_OSR         0x00
+# define MS5611_CONVERSION_US   600
+#else
+# error Unsupported MS5611_OSR
+#endif
+#define CMD_CONVERT_D1 (0x40 + CMD_MS5611_OSR)
+#define CMD_CONVERT_D2 (0x50 + CMD_MS5611_OSR)
+
+// time between reads of the conversions. The timer process fires every
+// 1000us so 500us less than the period gives exactly the target rate,
+// but the conversion must have finished
+#define MS5611_PERIOD_US        (1000000UL / MS5611_CONVERSION_HZ - 500)
+#define MS5611_INTERVAL_US      (MS5611_PERIOD_US > MS5611_CONVERSION_US ? MS5611_PERIOD_US : MS5611_CONVERSION_US)
 
 uint32_t volatile AP_Baro_MS5611::_s_D1;
 uint32_t volatile AP_Baro_MS5611::_s_D2;
@@ -56,6 +83,7 @@ uint8_t volatile AP_Baro_MS5611::_d2_count;
 uint8_t AP_Baro_MS5611::_state;
 uint32_t AP_Baro_MS5611::_timer;
 bool volatile AP_Baro_MS5611::_updated;
+volatile uint32_t AP_Baro_MS5611::_sample_us;
 
 AP_Baro_MS5611_Serial* AP_Baro_MS5611::_serial = NULL;
 AP_Baro_MS5611_SPI AP_Baro_MS5611::spi;
@@ -243,7 +271,7 @@ bool AP_Baro_MS5611::init()
 
 
     //Send a command to read Temp first
-    _serial->write(CMD_CONVERT_D2_OSR4096);
+    _serial->write(CMD_CONVERT_D2);
     _timer = hal.scheduler->micros();
     _state = 0;
     Temp=0;
@@ -254,7 +282,9 @@ bool AP_Baro_MS5611::init()
     _d1_count = 0;
     _d2_count = 0;
 
-    hal.scheduler->register_timer_process( AP_Baro_MS5611::_update );
+    // it only needs a turn every conversion, and shares the SPI bus
+    // with the IMU on APM2
+    hal.scheduler->register_slow_process( AP_Baro_MS5611::_update, MS5611_INTERVAL_US );
     _serial->sem_give();
 
     // wait for at least one value to be read
@@ -275,14 +305,12 @@ bool AP_Baro_MS5611::init()
 
 
 // Read the sensor. This is a state machine
-// We read one time Temperature (state=1) and then 4 times Pressure (states 2-5)
+// We read one time Temperature (state=0) and then MS5611_D1_PER_D2 times Pressure
 // temperature does not change so quickly...
 void AP_Baro_MS5611::_update(uint32_t tnow)
 {
-    // Throttle read rate to 100hz maximum.
-    // note we use 9500us here not 10000us
-    // the read rate will end up at exactly 100hz because the Periodic Timer fires at 1khz
-    if (tnow - _timer < 9500) {
+    // Throttle read rate to MS5611_CONVERSION_HZ maximum.
+    if (tnow - _timer < MS5611_INTERVAL_US) {
         return;
     }
 
@@ -302,7 +330,7 @@ void AP_Baro_MS5611::_update(uint32_t tnow)
             _d2_count = 16;
         }
         _state++;
-        _serial->write(CMD_CONVERT_D1_OSR4096);      // Command to read pressure
+        _serial->write(CMD_CONVERT_D1);      // Command to read pressure
     } else {
         _s_D1 += _serial->read_adc();
         _d1_count++;
@@ -315,12 +343,13 @@ void AP_Baro_MS5611::_update(uint32_t tnow)
         }
         _state++;
         // Now a new reading exists
+        _sample_us = tnow;
         _updated = true;
-        if (_state == 5) {
-            _serial->write(CMD_CONVERT_D2_OSR4096); // Command to read temperature
+        if (_state > MS5611_D1_PER_D2) {
+            _serial->write(CMD_CONVERT_D2); // Command to read temperature
             _state = 0;
         } else {
-            _serial->write(CMD_CONVERT_D1_OSR4096); // Command to read pressure
+            _serial->write(CMD_CONVERT_D1); // Command to read pressure
         }
     }
 
@@ -341,21 +370,23 @@ uint8_t AP_Baro_MS5611::read()
         sD2 = _s_D2; _s_D2 = 0;
         d1count = _d1_count; _d1_count = 0;
         d2count = _d2_count; _d2_count = 0;
+        _last_sample_us = _sample_us;
         _updated = false;
         hal.scheduler->resume_timer_procs();
 
+        // the averages are rounded, and the pressure keeps some
+        // fraction bits for the precision the oversampling gives
         if (d1count != 0) {
-            D1 = ((float)sD1) / d1count;
+            D1 = ((((uint64_t)sD1) << MS5611_D1_FRAC_BITS) + d1count/2) / d1count;
         }
         if (d2count != 0) {
-            D2 = ((float)sD2) / d2count;
+            D2 = (sD2 + d2count/2) / d2count;
         }
         _pressure_samples = d1count;
-        _raw_press = D1;
+        _raw_press = D1 >> MS5611_D1_FRAC_BITS;
         _raw_temp = D2;
-    }
-    _calculate();
-    if (updated) {
+
+        _calculate();
         _last_update = hal.scheduler->millis();
     }
     return updated ? 1 : 0;
@@ -364,57 +395,34 @@ uint8_t AP_Baro_MS5611::read()
 // Calculate Temperature and compensated Pressure in real units (Celsius degrees*100, mbar*100).
 void AP_Baro_MS5611::_calculate()
 {
-    float dT;
-    float TEMP;
-    float OFF;
-    float SENS;
-    float P;
-
-    // Formulas from manufacturer datasheet
-    // sub -20c temperature compensation is not included
-
-    // we do the calculations using floating point
-    // as this is much faster on an AVR2560, and also allows
-    // us to take advantage of the averaging of D1 and D1 over
-    // multiple samples, giving us more precision
-    dT = D2-(((uint32_t)C5)<<8);
-    TEMP = (dT * C6)/8388608;
-    OFF = C2 * 65536.0f + (C4 * dT) / 128;
-    SENS = C1 * 32768.0f + (C3 * dT) / 256;
-
-    if (TEMP < 0) {
+    // Formulas from manufacturer datasheet, in the integer widths it
+    // gives, including the second order compensation below 20 and -15
+    // degrees C. The pressure conversion has fraction bits, which are
+    // carried through to the pressure
+    int32_t dT = (int32_t)D2 - (((int32_t)C5) << 8);
+    int32_t TEMP = 2000 + ((int64_t)dT * C6) / 8388608;
+    int64_t OFF = ((int64_t)C2 << 16) + ((int64_t)C4 * dT) / 128;
+    int64_t SENS = ((int64_t)C1 << 15) + ((int64_t)C3 * dT) / 256;
+
+    if (TEMP < 2000) {
         // second order temperature compensation when under 20 degrees C
-        float T2 = (dT*dT) / 0x80000000;
-        float Aux = TEMP*TEMP;
-        float OFF2 = 2.5f*Aux;
-        float SENS2 = 1.25f*Aux;
+        int32_t T2 = ((int64_t)dT * dT) / 0x80000000LL;
+        int64_t Aux = (int64_t)(TEMP - 2000) * (TEMP - 2000);
+        int64_t OFF2 = 5 * Aux / 2;
+        int64_t SENS2 = 5 * Aux / 4;
+        if (TEMP < -1500) {
+            // and again under -15 degrees C
+            Aux = (int64_t)(TEMP + 1500) * (TEMP + 1500);
+            OFF2 += 7 * Aux;
+            SENS2 += 11 * Aux / 2;
+        }
         TEMP = TEMP - T2;
         OFF = OFF - OFF2;
         SENS = SENS - SENS2;
     }
 
-    P = (D1*SENS/2097152 - OFF)/32768;
-    Temp = TEMP + 2000;
-    Press = P;
+    // P = (D1 * SENS / 2^21 - OFF) / 2^15, with D1 scaled up by its fraction bits
+    int64_t P = ((int64_t)D1 * SENS) / 2097152 - (OFF << MS5611_D1_FRAC_BITS);
+    Temp = TEMP;
+    Press = P * (1.0f / (32768UL << MS5611_D1_FRAC_BITS));
 }
-
-float AP_Baro_MS5611::get_pressure()
-{
-    return Press;
-}
-
-float AP_Baro_MS5611::get_temperature()
-{
-    // callers want the temperature in 0.1C units
-    return Temp/10;
-}
-
-int32_t AP_Baro_MS5611::get_raw_pressure() {
-    return _raw_press;
-}
-
-int32_t AP_Baro_MS5611::get_raw_temp() {
-    return _raw_temp;
-}
-
-
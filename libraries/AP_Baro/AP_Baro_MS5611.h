@@ -6,6 +6,27 @@
 #include <AP_HAL.h>
 #include "AP_Baro.h"
 
+// oversampling ratio of the conversions, 256, 512, 1024, 2048 or 4096.
+// Higher ratios are less noisy but take longer
+#ifndef MS5611_OSR
+# define MS5611_OSR             4096
+#endif
+
+// conversions to aim for each second. It is slower if the conversions
+// at the oversampling ratio take too long for it
+#ifndef MS5611_CONVERSION_HZ
+# define MS5611_CONVERSION_HZ   100
+#endif
+
+// pressure conversions for each temperature conversion, as the
+// temperature changes much more slowly
+#ifndef MS5611_D1_PER_D2
+# define MS5611_D1_PER_D2       4
+#endif
+
+// fraction bits kept when averaging the pressure conversions
+#define MS5611_D1_FRAC_BITS     4
+
 /** Abstract serial device driver for MS5611. */
 class AP_Baro_MS5611_Serial
 {
@@ -93,6 +114,7 @@ private:
     static void                     _update(uint32_t );
     /* Asynchronous state: */
     static volatile bool            _updated;
+    static volatile uint32_t        _sample_us;     // time of the newest pressure in the sums
     static volatile uint8_t         _d1_count;
     static volatile uint8_t         _d2_count;
     static volatile uint32_t        _s_D1, _s_D2;
@@ -109,7 +131,8 @@ private:
     int32_t                         _raw_temp;
     // Internal calibration registers
     uint16_t                        C1,C2,C3,C4,C5,C6;
-    float                           D1,D2;
+    uint32_t                        D1;                 // average pressure conversion, MS5611_D1_FRAC_BITS fraction bits
+    uint32_t                        D2;                 // average temperature conversion
 
 };
 
@@ -10,35 +10,55 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
 
 #include <drivers/drv_baro.h>
 #include <drivers/drv_hrt.h>
 
 extern const AP_HAL::HAL& hal;
 
-float AP_Baro_PX4::_pressure_sum;
-float AP_Baro_PX4::_temperature_sum;
-uint32_t AP_Baro_PX4::_sum_count;
+uint8_t AP_Baro_PX4::_num_instances;
+float AP_Baro_PX4::_pressure_sum[BARO_PX4_MAX_INSTANCES];
+float AP_Baro_PX4::_temperature_sum[BARO_PX4_MAX_INSTANCES];
+uint32_t AP_Baro_PX4::_sum_count[BARO_PX4_MAX_INSTANCES];
 uint32_t AP_Baro_PX4::_last_timer;
-uint64_t AP_Baro_PX4::_last_timestamp;
-int AP_Baro_PX4::_baro_fd;
+uint64_t AP_Baro_PX4::_last_timestamp[BARO_PX4_MAX_INSTANCES];
+int AP_Baro_PX4::_baro_fd[BARO_PX4_MAX_INSTANCES];
+SensorVote AP_Baro_PX4::_vote(BARO_PX4_ERROR_MAX, BARO_PX4_TIMEOUT_US);
+
+// the first instance is required, the others are used if present
+static const char *baro_device_path[BARO_PX4_MAX_INSTANCES] = {
+    BARO_DEVICE_PATH, BARO_DEVICE_PATH "1", BARO_DEVICE_PATH "2"
+};
 
 // Public Methods //////////////////////////////////////////////////////////////
 bool AP_Baro_PX4::init(void)
 {
-    if (_baro_fd <= 0) {
-        _baro_fd = open(BARO_DEVICE_PATH, O_RDONLY);
-        if (_baro_fd < 0) {
+    if (_baro_fd[0] <= 0) {
+        _baro_fd[0] = open(BARO_DEVICE_PATH, O_RDONLY);
+        if (_baro_fd[0] < 0) {
             hal.scheduler->panic("Unable to open " BARO_DEVICE_PATH);
         }
 
-        /* set the driver to poll at 150Hz */
-        ioctl(_baro_fd, SENSORIOCSPOLLRATE, SENSOR_POLLRATE_MAX);
+        // any spares
+        for (_num_instances=1; _num_instances<BARO_PX4_MAX_INSTANCES; _num_instances++) {
+            _baro_fd[_num_instances] = open(baro_device_path[_num_instances], O_RDONLY);
+            if (_baro_fd[_num_instances] < 0) {
+                break;
+            }
+        }
+
+        for (uint8_t i=0; i<_num_instances; i++) {
+            /* set the driver to poll at 150Hz */
+            ioctl(_baro_fd[i], SENSORIOCSPOLLRATE, SENSOR_POLLRATE_MAX);
 
-        // average over up to 10 samples
-        ioctl(_baro_fd, SENSORIOCSQUEUEDEPTH, 10);
+            // average over up to 10 samples
+            ioctl(_baro_fd[i], SENSORIOCSQUEUEDEPTH, 10);
+        }
 
-        hal.scheduler->register_timer_process(_baro_timer);
+        _vote.set_count(_num_instances, hal.scheduler->micros());
+
+        hal.scheduler->register_slow_process(_baro_timer, 10000);
 
         // give the timer a chance to run and gather one sample
         hal.scheduler->delay(40);
@@ -55,21 +75,26 @@ uint8_t AP_Baro_PX4::read(void)
     // try to accumulate one more sample, so we have the latest data
     _accumulate();
 
-    // consider the baro healthy if we got a reading in the last 0.2s
-    healthy = (hrt_absolute_time() - _last_timestamp < 200000);
-    if (!healthy || _sum_count == 0) {
+    // use the primary, and consider the baro healthy if it got a
+    // reading in the last 0.2s
+    uint8_t p = _vote.primary();
+    healthy = (hrt_absolute_time() - _last_timestamp[p] < 200000);
+    if (!healthy || _sum_count[p] == 0) {
         hal.scheduler->resume_timer_procs();
         return healthy;
     }
 
-
-    _pressure    = (_pressure_sum / _sum_count) * 100.0f;
-    _temperature = (_temperature_sum / _sum_count) * 10.0f;
-    _pressure_samples = _sum_count;
-    _last_update = (uint32_t)_last_timestamp/1000;
-    _pressure_sum = 0;
-    _temperature_sum = 0;
-    _sum_count = 0;
+    _pressure    = (_pressure_sum[p] / _sum_count[p]) * 100.0f;
+    _temperature = (_temperature_sum[p] / _sum_count[p]) * 10.0f;
+    _pressure_samples = _sum_count[p];
+    _last_update = (uint32_t)_last_timestamp[p]/1000;
+    // micros() counts from the sketch start, so go by the age of the sample
+    _last_sample_us = hal.scheduler->micros() - (uint32_t)(hrt_absolute_time() - _last_timestamp[p]);
+    for (uint8_t i=0; i<_num_instances; i++) {
+        _pressure_sum[i] = 0;
+        _temperature_sum[i] = 0;
+        _sum_count[i] = 0;
+    }
 
     hal.scheduler->resume_timer_procs();
 
@@ -80,13 +105,34 @@ uint8_t AP_Baro_PX4::read(void)
 void AP_Baro_PX4::_accumulate(void)
 {
     struct baro_report baro_report;
-    while (::read(_baro_fd, &baro_report, sizeof(baro_report)) == sizeof(baro_report) &&
-           baro_report.timestamp != _last_timestamp) {
-		_pressure_sum += baro_report.pressure; // Pressure in mbar
-		_temperature_sum += baro_report.temperature; // degrees celcius
-        _sum_count++;
-        _last_timestamp = baro_report.timestamp;
+    uint32_t now = hal.scheduler->micros();
+
+    // only read the instances which have reports queued
+    struct pollfd fds[BARO_PX4_MAX_INSTANCES];
+    for (uint8_t i=0; i<_num_instances; i++) {
+        fds[i].fd = _baro_fd[i];
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+    if (::poll(fds, _num_instances, 0) <= 0) {
+        _vote.update(now);
+        return;
+    }
+
+    for (uint8_t i=0; i<_num_instances; i++) {
+        if (!(fds[i].revents & POLLIN)) {
+            continue;
+        }
+        while (::read(_baro_fd[i], &baro_report, sizeof(baro_report)) == sizeof(baro_report) &&
+               baro_report.timestamp != _last_timestamp[i]) {
+            _pressure_sum[i] += baro_report.pressure; // Pressure in mbar
+            _temperature_sum[i] += baro_report.temperature; // degrees celcius
+            _sum_count[i]++;
+            _last_timestamp[i] = baro_report.timestamp;
+            _vote.sample(i, Vector3f(baro_report.pressure, 0, 0), now);
+        }
     }
+    _vote.update(now);
 }
 
 void AP_Baro_PX4::_baro_timer(uint32_t now)
@@ -3,8 +3,15 @@
 #ifndef __AP_BARO_PX4_H__
 #define __AP_BARO_PX4_H__
 
+#include <AP_Math.h>
 #include "AP_Baro.h"
 
+// the most baros used, the largest difference between them which is
+// still agreement, in mbar, and the longest gap between samples
+#define BARO_PX4_MAX_INSTANCES      3
+#define BARO_PX4_ERROR_MAX          2.0f
+#define BARO_PX4_TIMEOUT_US         100000
+
 class AP_Baro_PX4 : public AP_Baro
 {
 public:
@@ -18,14 +25,18 @@ public:
 private:
     float _temperature;
     float _pressure;
-    static float _pressure_sum;
-    static float _temperature_sum;
-    static uint32_t _sum_count;
+    // the timer accumulates every instance, so a backup is up to date
+    // the moment it becomes the primary
+    static uint8_t _num_instances;
+    static float _pressure_sum[BARO_PX4_MAX_INSTANCES];
+    static float _temperature_sum[BARO_PX4_MAX_INSTANCES];
+    static uint32_t _sum_count[BARO_PX4_MAX_INSTANCES];
     static void _accumulate(void);
     static void _baro_timer(uint32_t now);
-    static uint64_t _last_timestamp;
-    // baro driver handle
-    static int _baro_fd;
+    static uint64_t _last_timestamp[BARO_PX4_MAX_INSTANCES];
+    static SensorVote _vote;
+    // baro driver handles
+    static int _baro_fd[BARO_PX4_MAX_INSTANCES];
     static uint32_t _last_timer;
 };
 
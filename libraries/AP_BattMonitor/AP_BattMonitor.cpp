@@ -0,0 +1,145 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_BattMonitor.cpp
+/// @brief	Battery voltage and current, sampled and integrated in the timer
+
+#include <AP_Math.h>
+#include "AP_BattMonitor.h"
+
+extern const AP_HAL::HAL& hal;
+
+// how much a resistance estimate is trusted when the current has
+// changed by its largest value seen
+#define AP_BATT_RES_GAIN 0.1f
+
+AP_BattMonitor *AP_BattMonitor::_instance;
+
+AP_BattMonitor::AP_BattMonitor() :
+    _volt_source(NULL),
+    _curr_source(NULL),
+    _measure_current(false),
+    _volt_multiplier(1),
+    _amp_per_volt(1),
+    _amp_offset(0),
+    _voltage(0),
+    _resting_voltage(0),
+    _current_amps(0),
+    _current_total_mah(0),
+    _new_voltage(false),
+    _t_voltage(0),
+    _t_current_amps(0),
+    _t_current_total_mah(0),
+    _last_current_ms(0),
+    _voltage_filt(0),
+    _current_filt(0),
+    _current_max(0),
+    _resistance(0)
+{
+}
+
+void AP_BattMonitor::init(AP_HAL::AnalogSource *volt_source, AP_HAL::AnalogSource *curr_source)
+{
+    _volt_source = volt_source;
+    _curr_source = curr_source;
+    _volt_source->set_sample_rate(AP_BATT_SAMPLE_RATE_HZ);
+    _curr_source->set_sample_rate(AP_BATT_SAMPLE_RATE_HZ);
+    _instance = this;
+    hal.scheduler->register_timer_process(_timer);
+}
+
+void AP_BattMonitor::set_config(bool measure_current,
+                                uint8_t volt_pin, float volt_multiplier,
+                                uint8_t curr_pin, float amp_per_volt, float amp_offset)
+{
+    // this copes with changing the pins at runtime
+    _volt_source->set_pin(volt_pin);
+    _curr_source->set_pin(curr_pin);
+    if (measure_current != _measure_current ||
+        volt_multiplier != _volt_multiplier ||
+        amp_per_volt != _amp_per_volt ||
+        amp_offset != _amp_offset) {
+        hal.scheduler->suspend_timer_procs();
+        _measure_current = measure_current;
+        _volt_multiplier = volt_multiplier;
+        _amp_per_volt = amp_per_volt;
+        _amp_offset = amp_offset;
+        // a voltage sampled with the old scaling isn't given out
+        _new_voltage = false;
+        hal.scheduler->resume_timer_procs();
+    }
+}
+
+bool AP_BattMonitor::read(void)
+{
+    hal.scheduler->suspend_timer_procs();
+    bool new_voltage = _new_voltage;
+    _new_voltage = false;
+    if (new_voltage) {
+        _voltage = _t_voltage;
+    }
+    _current_amps = _t_current_amps;
+    _current_total_mah = _t_current_total_mah;
+    _resting_voltage = _voltage + _current_amps * _resistance;
+    hal.scheduler->resume_timer_procs();
+    return new_voltage;
+}
+
+/*
+  estimate the resistance from the sag of the latest voltage from the
+  filtered one against the rise in current, then move the filters on
+ */
+void AP_BattMonitor::_update_resistance(float dt)
+{
+    if (_t_voltage <= 0) {
+        return;
+    }
+    if (_voltage_filt == 0) {
+        _voltage_filt = _t_voltage;
+        _current_filt = _t_current_amps;
+        return;
+    }
+    if (_t_current_amps > _current_max) {
+        _current_max = _t_current_amps;
+    }
+    float current_change = _t_current_amps - _current_filt;
+    if (_current_max > 0 && current_change != 0) {
+        float resistance = (_voltage_filt - _t_voltage) / current_change;
+        if (resistance > 0) {
+            float gain = AP_BATT_RES_GAIN * min(fabsf(current_change) / _current_max, 1.0f);
+            _resistance += gain * (resistance - _resistance);
+        }
+    }
+    float alpha = dt / (AP_BATT_SAG_TC + dt);
+    _voltage_filt += alpha * (_t_voltage - _voltage_filt);
+    _current_filt += alpha * (_t_current_amps - _current_filt);
+}
+
+/*
+  called at 1kHz. Each sample is taken once, as soon as the source
+  has made it
+ */
+void AP_BattMonitor::_timer(uint32_t now_us)
+{
+    AP_BattMonitor *b = _instance;
+    uint32_t sample_ms;
+    if (b->_volt_source->sample_ready(sample_ms)) {
+        b->_t_voltage = b->_volt_source->voltage_average() * b->_volt_multiplier;
+        b->_new_voltage = true;
+    }
+    if (!b->_measure_current) {
+        b->_last_current_ms = 0;
+        return;
+    }
+    if (b->_curr_source->sample_ready(sample_ms)) {
+        b->_t_current_amps = (b->_curr_source->voltage_average() - b->_amp_offset) * b->_amp_per_volt;
+        uint32_t dt_ms = sample_ms - b->_last_current_ms;
+        if (b->_last_current_ms != 0 && dt_ms < 2000) {
+            // the sample is the average current since the last, so
+            // this is the charge used in between. 0.0002778 is 1/3600,
+            // from milliseconds to hours
+            b->_t_current_total_mah += b->_t_current_amps * dt_ms * 0.0002778f;
+            b->_update_resistance(dt_ms * 0.001f);
+        }
+        b->_last_current_ms = sample_ms;
+    }
+}
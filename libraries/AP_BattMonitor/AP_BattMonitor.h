@@ -0,0 +1,109 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_BattMonitor.h
+/// @brief	Battery voltage and current, sampled and integrated in the timer
+
+#ifndef __AP_BATTMONITOR_H__
+#define __AP_BATTMONITOR_H__
+
+#include <AP_Common.h>
+#include <AP_HAL.h>
+
+// the rate the voltage and current are sampled at. Each sample is the
+// average of every conversion made since the last, so the consumed
+// charge is right at any rate, and a faster one follows the sag of
+// the voltage under load more closely
+#ifndef AP_BATT_SAMPLE_RATE_HZ
+# if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+#  define AP_BATT_SAMPLE_RATE_HZ 20
+# else
+#  define AP_BATT_SAMPLE_RATE_HZ 50
+# endif
+#endif
+
+// the time constant in seconds of the filtered voltage and current
+// the sag is measured against
+#define AP_BATT_SAG_TC 0.5f
+
+/*
+  The voltage and current are sampled by the timer process, which adds
+  each current sample to the consumed charge over the time since the
+  one before, however late the vehicle reads them.
+
+  The resting voltage is the voltage less the sag under the present
+  current, from the internal resistance of the battery. That is
+  estimated from how far the voltage drops from its filtered value as
+  the current rises above its own, trusting each estimate more the
+  bigger the change in current was. Only one monitor can be sampled
+  this way.
+ */
+class AP_BattMonitor
+{
+public:
+    AP_BattMonitor();
+
+    /// start sampling the sources from the timer
+    ///
+    /// @param	volt_source, curr_source	the battery voltage and current
+    ///
+    void init(AP_HAL::AnalogSource *volt_source, AP_HAL::AnalogSource *curr_source);
+
+    /// the pins and scaling from the parameters, which can be changed
+    /// at runtime. The current is only sampled when measure_current is set
+    ///
+    void set_config(bool measure_current,
+                    uint8_t volt_pin, float volt_multiplier,
+                    uint8_t curr_pin, float amp_per_volt, float amp_offset);
+
+    /// take the latest values from the timer. The voltage is kept until
+    /// there is a sample with the present configuration
+    ///
+    /// @returns true if there has been a new voltage sample since the
+    ///          last call
+    ///
+    bool read(void);
+
+    float voltage(void) const { return _voltage; }
+    float resting_voltage(void) const { return _resting_voltage; }
+    float current_amps(void) const { return _current_amps; }
+    float current_total_mah(void) const { return _current_total_mah; }
+
+    /// the estimated internal resistance in ohms
+    float resistance(void) const { return _resistance; }
+
+private:
+    static void _timer(uint32_t now_us);
+    void _update_resistance(float dt);
+
+    static AP_BattMonitor *_instance;
+
+    AP_HAL::AnalogSource *_volt_source;
+    AP_HAL::AnalogSource *_curr_source;
+
+    // configuration, only changed with the timer suspended
+    bool    _measure_current;
+    float   _volt_multiplier;
+    float   _amp_per_volt;
+    float   _amp_offset;
+
+    // the values as read()
+    float   _voltage;
+    float   _resting_voltage;
+    float   _current_amps;
+    float   _current_total_mah;
+
+    // the timer's own state
+    volatile bool _new_voltage;
+    float   _t_voltage;
+    float   _t_current_amps;
+    float   _t_current_total_mah;
+    uint32_t _last_current_ms;
+
+    // filtered values and the resistance estimate
+    float   _voltage_filt;
+    float   _current_filt;
+    float   _current_max;
+    float   _resistance;
+};
+
+#endif // __AP_BATTMONITOR_H__
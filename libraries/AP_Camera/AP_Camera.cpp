@@ -42,7 +42,7 @@ const AP_Param::GroupInfo AP_Camera::var_info[] PROGMEM = {
 
     // @Param: TRIGG_DIST
     // @DisplayName: Camera trigger distance
-    // @Description: Distance in meters between camera triggers. If this value is non-zero then the camera will trigger whenever the GPS position changes by this number of meters regardless of what mode the APM is in
+    // @Description: Distance in meters between camera triggers. If this value is non-zero then the camera will trigger whenever the position changes by this number of meters regardless of what mode the APM is in
     // @User: Standard
     // @Range: 0 1000
     AP_GROUPINFO("TRIGG_DIST",  4, AP_Camera, _trigg_dist, 0),
@@ -164,7 +164,7 @@ AP_Camera::control_msg(mavlink_message_t* msg)
     The caller is responsible for taking the picture based on the return value of this function.
     The caller is also responsible for logging the details about the photo
 */
-bool AP_Camera::update_location(const struct Location &loc)
+bool AP_Camera::update_location(const struct Position &loc)
 {
     if (_trigg_dist == 0.0f) {
         return false;
@@ -184,3 +184,41 @@ bool AP_Camera::update_location(const struct Location &loc)
     _last_location = loc;
     return true;
 }
+
+/*  update position, for triggering by distance moved at the main loop rate
+    This function returns true if a picture should be taken, and like
+    update_location() the caller takes and logs the picture.
+    The next trigger is measured from the point the trigger distance was
+    reached between the two positions, rather than from this position, so
+    the pictures are spaced by the trigger distance whatever the loop rate
+*/
+bool AP_Camera::update_position(const Vector2f &pos_cm, float &fraction)
+{
+    if (_trigg_dist == 0.0f) {
+        _have_position = false;
+        return false;
+    }
+    if (!_have_position) {
+        _last_trigger_pos = pos_cm;
+        _last_pos = pos_cm;
+        _have_position = true;
+        return false;
+    }
+
+    float trigg_dist_cm = _trigg_dist * 100.0f;
+    float dist = (pos_cm - _last_trigger_pos).length();
+    if (dist < trigg_dist_cm) {
+        _last_pos = pos_cm;
+        return false;
+    }
+
+    float last_dist = (_last_pos - _last_trigger_pos).length();
+    if (dist > last_dist) {
+        fraction = constrain_float((trigg_dist_cm - last_dist) / (dist - last_dist), 0.0f, 1.0f);
+    } else {
+        fraction = 1.0f;
+    }
+    _last_trigger_pos = _last_pos + (pos_cm - _last_pos) * fraction;
+    _last_pos = pos_cm;
+    return true;
+}
@@ -8,6 +8,7 @@
 
 #include <AP_Param.h>
 #include <AP_Common.h>
+#include <AP_Math.h>
 #include <GCS_MAVLink.h>
 #include <AP_Relay.h>
 
@@ -30,7 +31,8 @@ public:
     ///
     AP_Camera(AP_Relay *obj_relay) :
         _trigger_counter(0),            // count of number of cycles shutter has been held open
-        _thr_pic_counter(0)             // timer variable for throttle_pic
+        _thr_pic_counter(0),            // timer variable for throttle_pic
+        _have_position(false)
     {
 		AP_Param::setup_object_defaults(this, var_info);
         _apm_relay = obj_relay;
@@ -48,7 +50,18 @@ public:
     void            control_msg(mavlink_message_t* msg);
 
     // Update location of vehicle and return true if a picture should be taken
-    bool update_location(const struct Location &loc);
+    bool update_location(const struct Position &loc);
+
+    // Update the position of the vehicle in cm north and east of a
+    // fixed origin such as home, and return true if a picture should
+    // be taken. This is cheap enough to call on every main loop.
+    // fraction is set to how far from the previous position to this
+    // one the trigger distance was reached, for working out where and
+    // when the picture was taken
+    bool update_position(const Vector2f &pos_cm, float &fraction);
+
+    // forget the position, when it can't be trusted
+    void reset_position() { _have_position = false; }
 
     static const struct AP_Param::GroupInfo        var_info[];
 
@@ -68,7 +81,12 @@ private:
     void            transistor_pic();   // hacked the circuit to run a transistor? use this trigger to send output.
 
     AP_Float        _trigg_dist;     // distance between trigger points (meters)
-    struct Location _last_location;
+    struct Position _last_location;
+
+    // for update_position(), in cm from its origin
+    Vector2f        _last_trigger_pos;  // where the last picture was taken
+    Vector2f        _last_pos;          // the previous position
+    bool            _have_position;
 
 };
 
@@ -78,15 +78,29 @@
 
 //@{
 
-struct Location {
-    uint8_t id;                                                 ///< command id
-    uint8_t options;                                    ///< options bitmask (1<<0 = relative altitude)
-    uint8_t p1;                                                 ///< param 1
+/// A point in space, which is all navigation needs. 12 bytes with no
+/// padding
+struct Position {
     int32_t alt;                                        ///< param 2 - Altitude in centimeters (meters * 100)
     int32_t lat;                                        ///< param 3 - Lattitude * 10**7
     int32_t lng;                                        ///< param 4 - Longitude * 10**7
 };
 
+/// A mission command. It can be used wherever a Position is expected,
+/// and copying it to a Position keeps only the point
+struct Location : public Position {
+    uint8_t id;                                                 ///< command id
+    uint8_t options;                                    ///< options bitmask (1<<0 = relative altitude)
+    uint8_t p1;                                                 ///< param 1
+
+    /// set the point, keeping the command fields
+    void set_position(const struct Position &pos) {
+        alt = pos.alt;
+        lat = pos.lat;
+        lng = pos.lng;
+    }
+};
+
 //@}
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -116,4 +130,32 @@ struct Location {
 #define AP_PRODUCT_ID_APM2_REV_D8       0x58    // APM2 with MPU6000_REV_D8
 #define AP_PRODUCT_ID_APM2_REV_D9       0x59    // APM2 with MPU6000_REV_D9
 
+////////////////////////////////////////////////////////////////////////////////
+/// @name	Arena
+///
+/// On AVR, new and the UART buffers take memory from a fixed region
+/// in .bss rather than the heap. Nothing in it is ever freed, so there
+/// is no fragmentation or malloc bookkeeping, and the memory left after
+/// setup is known at link time. Once init is done arena_freeze() is
+/// called, and any allocation after that, or one that doesn't fit,
+/// comes from the heap and is counted by arena_late_allocs() so it
+/// can be reported. On other boards these are plain calloc() and free()
+//@{
+
+#ifndef AP_ARENA_SIZE
+ #if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+  # define AP_ARENA_SIZE 1536
+ #else
+  # define AP_ARENA_SIZE 0
+ #endif
+#endif
+
+void *arena_alloc(size_t size);         // zeroed, like calloc()
+void arena_free(void *ptr);             // only frees memory from the heap
+void arena_freeze(void);
+uint16_t arena_used(void);              // bytes of the arena handed out
+uint16_t arena_late_allocs(void);
+
+//@}
+
 #endif // _AP_COMMON_H
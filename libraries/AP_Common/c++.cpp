@@ -7,18 +7,77 @@
 // easily fragmented.
 
 #include <AP_HAL.h>
+#include <AP_Common.h>
 #include <stdlib.h>
 
+#if AP_ARENA_SIZE > 0
+static uint8_t  arena[AP_ARENA_SIZE];
+static uint16_t arena_top;
+static bool     arena_frozen;
+static uint16_t arena_late;
+
+void *arena_alloc(size_t size)
+{
+    if (!arena_frozen && size <= (size_t)(AP_ARENA_SIZE - arena_top)) {
+        // .bss starts zeroed and nothing is given out twice
+        void *ret = &arena[arena_top];
+        arena_top += size;
+        return ret;
+    }
+    if (arena_late < 0xFFFF) {
+        arena_late++;
+    }
+    return calloc(size, 1);
+}
+
+void arena_free(void *ptr)
+{
+    if (ptr >= (void *)&arena[0] && ptr < (void *)&arena[AP_ARENA_SIZE]) {
+        return;
+    }
+    free(ptr);
+}
+
+void arena_freeze(void)
+{
+    arena_frozen = true;
+}
+
+uint16_t arena_used(void)
+{
+    return arena_top;
+}
+
+uint16_t arena_late_allocs(void)
+{
+    return arena_late;
+}
+#else
+void *arena_alloc(size_t size)
+{
+    return calloc(size, 1);
+}
+
+void arena_free(void *ptr)
+{
+    free(ptr);
+}
+
+void arena_freeze(void) {}
+uint16_t arena_used(void) { return 0; }
+uint16_t arena_late_allocs(void) { return 0; }
+#endif // AP_ARENA_SIZE
+
 #if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2 || CONFIG_HAL_BOARD == HAL_BOARD_SMACCM
 
 void * operator new(size_t size)
 {
-    return(calloc(size, 1));
+    return arena_alloc(size);
 }
 
 void operator delete(void *p)
 {
-    if (p) free(p);
+    if (p) arena_free(p);
 }
 
 extern "C" void __cxa_pure_virtual(){
@@ -27,12 +86,12 @@ extern "C" void __cxa_pure_virtual(){
 
 void * operator new[](size_t size)
 {
-    return(calloc(size, 1));
+    return arena_alloc(size);
 }
 
 void operator delete[](void * ptr)
 {
-    if (ptr) free(ptr);
+    if (ptr) arena_free(ptr);
 }
 
 __extension__ typedef int __guard __attribute__((mode (__DI__)));
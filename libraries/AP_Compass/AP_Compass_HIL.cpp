@@ -42,22 +42,18 @@ bool AP_Compass_HIL::read()
     // get offsets
     Vector3f ofs = _offset.get();
 
-    // apply motor compensation
-    if(_motor_comp_type != AP_COMPASS_MOT_COMP_DISABLED && _thr_or_curr != 0.0f) {
-        _motor_offset = _motor_compensation.get() * _thr_or_curr;
-    }else{
-        _motor_offset.x = 0;
-        _motor_offset.y = 0;
-        _motor_offset.z = 0;
-    }
-
-    // return last values provided by setHIL function
-    mag_x = _hil_mag.x + ofs.x + _motor_offset.x;
-    mag_y = _hil_mag.y + ofs.y + _motor_offset.y;
-    mag_z = _hil_mag.z + ofs.z + _motor_offset.z;
+    // return last values provided by setHIL function, with the motor
+    // compensation for the throttle or current when it was set
+    Vector3f field = _hil_mag + ofs;
+    _motor_sample(_hil_sample_us);
+    _apply_motor_compensation(field);
+    mag_x = field.x;
+    mag_y = field.y;
+    mag_z = field.z;
 
     // values set by setHIL function
     last_update = hal.scheduler->micros();      // record time of update
+    _last_sample_us = _hil_sample_us;
     return true;
 }
 
@@ -94,6 +90,17 @@ void AP_Compass_HIL::setHIL(float roll, float pitch, float yaw)
     // and add in AHRS_ORIENTATION setting
     _hil_mag.rotate(_board_orientation);
 
+    _hil_sample_us = hal.scheduler->micros();
+    healthy = true;
+}
+
+// Set the raw field directly. read() adds the offsets back, so
+// passing a logged field less the logged offsets reproduces it
+//
+void AP_Compass_HIL::setHIL(const Vector3f &mag)
+{
+    _hil_mag = mag;
+    _hil_sample_us = hal.scheduler->micros();
     healthy = true;
 }
 
@@ -11,10 +11,13 @@ public:
     bool        read(void);
     void        accumulate(void);
     void        setHIL(float roll, float pitch, float yaw);
+    // set the field before offsets are added, for replaying logs
+    void        setHIL(const Vector3f &mag);
 private:
     Vector3f    _hil_mag;
     Vector3f    _Bearth;
     float		_last_declination;
+    uint32_t    _hil_sample_us;         // when setHIL() was last called
     void        _setup_earth_field();
 };
 
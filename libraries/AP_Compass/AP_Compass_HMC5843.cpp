@@ -81,6 +81,12 @@ bool AP_Compass_HMC5843::read_raw()
         return false;
     }
 
+    return decode_raw(buff);
+}
+
+// decode_raw - sets _mag_N from the data registers
+bool AP_Compass_HMC5843::decode_raw(const uint8_t *buff)
+{
     int16_t rx, ry, rz;
     rx = (int16_t)(buff[0] << 8) | buff[1];
     if (product_id == AP_COMPASS_TYPE_HMC5883L) {
@@ -103,23 +109,45 @@ bool AP_Compass_HMC5843::read_raw()
 }
 
 
-// accumulate a reading from the magnetometer
+// accumulate a reading from the magnetometer. The read is queued on
+// the bus, and picked up by a later call once it has finished
 void AP_Compass_HMC5843::accumulate(void)
 {
-   uint32_t tnow = hal.scheduler->micros();
-   if (healthy && _accum_count != 0 && (tnow - _last_accum_time) < 13333) {
-	  // the compass gets new data at 75Hz
+   if (!_read_pending) {
+	  uint32_t tnow = hal.scheduler->micros();
+	  if (healthy && _accum_count != 0 && (tnow - _last_accum_time) < 13333) {
+		 // the compass gets new data at 75Hz
+		 return;
+	  }
+
+	  if (!_i2c_sem->take(5)) {
+		 // the bus is busy - try again later
+		 return;
+	  }
+	  // the semaphore is given back when the read has finished
+	  if (!hal.i2c->queueReadRegisters(COMPASS_ADDRESS, 0x03, 6, _buff, &_read_status)) {
+		 _i2c_sem->give();
+		 return;
+	  }
+	  _read_pending = true;
+	  _read_time = tnow;
+   }
+
+   hal.i2c->poll();
+   if (_read_status == AP_HAL::I2CDriver::TRANSFER_PENDING) {
 	  return;
    }
+   _read_pending = false;
 
-   if (!_i2c_sem->take(5)) {
-       // the bus is busy - try again later
-       return;
+   if (_read_status == AP_HAL::I2CDriver::TRANSFER_FAILED) {
+	  if (healthy) {
+		 hal.i2c->setHighSpeed(false);
+	  }
+	  healthy = false;
+	  return;
    }
-   bool result = read_raw();
-   _i2c_sem->give();
 
-   if (result) {
+   if (decode_raw(_buff)) {
 	  // the _mag_N values are in the range -2048 to 2047, so we can
 	  // accumulate up to 15 of them in an int16_t. Let's make it 14
 	  // for ease of calculation. We expect to do reads at 10Hz, and
@@ -129,13 +157,15 @@ void AP_Compass_HMC5843::accumulate(void)
 	  _mag_y_accum += _mag_y;
 	  _mag_z_accum += _mag_z;
 	  _accum_count++;
+	  _motor_sample(_read_time);
 	  if (_accum_count == 14) {
 		 _mag_x_accum /= 2;
 		 _mag_y_accum /= 2;
 		 _mag_z_accum /= 2;
 		 _accum_count = 7;
+		 _motor_samples_halve();
 	  }
-	  _last_accum_time = tnow;
+	  _last_accum_time = _read_time;
    }
 }
 
@@ -300,7 +330,11 @@ bool AP_Compass_HMC5843::read()
     }
 
 	if (_accum_count == 0) {
+	   // nothing collected yet, so wait for a reading
 	   accumulate();
+	   while (_read_pending) {
+		  accumulate();
+	   }
 	   if (!healthy || _accum_count == 0) {
 		  // try again in 1 second, and set I2c clock speed slower
 		  _retry_time = hal.scheduler->millis() + 1000;
@@ -312,6 +346,7 @@ bool AP_Compass_HMC5843::read()
 	mag_x = _mag_x_accum * calibration[0] / _accum_count;
 	mag_y = _mag_y_accum * calibration[1] / _accum_count;
 	mag_z = _mag_z_accum * calibration[2] / _accum_count;
+	_last_sample_us = _last_accum_time;
 	_accum_count = 0;
 	_mag_x_accum = _mag_y_accum = _mag_z_accum = 0;
 
@@ -335,15 +370,9 @@ bool AP_Compass_HMC5843::read()
 
     rot_mag += _offset.get();
 
-    // apply motor compensation
-    if(_motor_comp_type != AP_COMPASS_MOT_COMP_DISABLED && _thr_or_curr != 0.0f) {
-        _motor_offset = _motor_compensation.get() * _thr_or_curr;
-        rot_mag += _motor_offset;
-    }else{
-        _motor_offset.x = 0;
-        _motor_offset.y = 0;
-        _motor_offset.z = 0;
-    }
+    // apply motor compensation, for the throttle or current when
+    // each sample was taken
+    _apply_motor_compensation(rot_mag);
 
     mag_x = rot_mag.x;
     mag_y = rot_mag.y;
@@ -14,6 +14,7 @@ private:
     float               calibration[3];
     bool                _initialised;
     virtual bool        read_raw(void);
+    bool                decode_raw(const uint8_t *buff);
     uint8_t             _base_config;
     virtual bool        re_initialise(void);
     bool                read_register(uint8_t address, uint8_t *value);
@@ -30,8 +31,14 @@ private:
     uint8_t			    _accum_count;
     uint32_t            _last_accum_time;
 
+    // the queued read of the data registers, done in the background
+    uint8_t             _buff[6];
+    volatile uint8_t    _read_status;
+    bool                _read_pending;
+    uint32_t            _read_time;
+
 public:
-    AP_Compass_HMC5843() : Compass() {
+    AP_Compass_HMC5843() : Compass(), _read_pending(false) {
     }
     bool        init(void);
     bool        read(void);
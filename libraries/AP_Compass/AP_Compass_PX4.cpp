@@ -18,6 +18,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
 
 #include <drivers/drv_mag.h>
 #include <drivers/drv_hrt.h>
@@ -26,37 +27,58 @@
 
 extern const AP_HAL::HAL& hal;
 
-int AP_Compass_PX4::_mag_fd = -1;
-Vector3f AP_Compass_PX4::_sum;
-uint32_t AP_Compass_PX4::_count = 0;
+uint8_t AP_Compass_PX4::_num_instances;
+int AP_Compass_PX4::_mag_fd[COMPASS_PX4_MAX_INSTANCES] = { -1, -1, -1 };
+Vector3f AP_Compass_PX4::_sum[COMPASS_PX4_MAX_INSTANCES];
+uint32_t AP_Compass_PX4::_count[COMPASS_PX4_MAX_INSTANCES];
 uint32_t AP_Compass_PX4::_last_timer = 0;
-uint64_t AP_Compass_PX4::_last_timestamp = 0;
+uint64_t AP_Compass_PX4::_first_timestamp[COMPASS_PX4_MAX_INSTANCES];
+uint64_t AP_Compass_PX4::_last_timestamp[COMPASS_PX4_MAX_INSTANCES];
+// no difference between compasses counts as disagreement
+SensorVote AP_Compass_PX4::_vote(1.0e6f, COMPASS_PX4_TIMEOUT_US);
+
+// the first instance is required, the others are used if present
+static const char *mag_device_path[COMPASS_PX4_MAX_INSTANCES] = {
+    MAG_DEVICE_PATH, MAG_DEVICE_PATH "1", MAG_DEVICE_PATH "2"
+};
 
 
 // Public Methods //////////////////////////////////////////////////////////////
 
 bool AP_Compass_PX4::init(void)
 {
-	_mag_fd = open(MAG_DEVICE_PATH, O_RDONLY);
-	if (_mag_fd < 0) {
+	_mag_fd[0] = open(MAG_DEVICE_PATH, O_RDONLY);
+	if (_mag_fd[0] < 0) {
         hal.console->printf("Unable to open " MAG_DEVICE_PATH);
         return false;
 	}
 
-	/* set the mag internal poll rate to at least 150Hz */
-	ioctl(_mag_fd, MAGIOCSSAMPLERATE, 150);
+    // any spares
+    for (_num_instances=1; _num_instances<COMPASS_PX4_MAX_INSTANCES; _num_instances++) {
+        _mag_fd[_num_instances] = open(mag_device_path[_num_instances], O_RDONLY);
+        if (_mag_fd[_num_instances] < 0) {
+            break;
+        }
+    }
+
+    for (uint8_t i=0; i<_num_instances; i++) {
+        /* set the mag internal poll rate to at least 150Hz */
+        ioctl(_mag_fd[i], MAGIOCSSAMPLERATE, 150);
 
-	/* set the driver to poll at 150Hz */
-	ioctl(_mag_fd, SENSORIOCSPOLLRATE, 150);
+        /* set the driver to poll at 150Hz */
+        ioctl(_mag_fd[i], SENSORIOCSPOLLRATE, 150);
 
-    // average over up to 10 samples
-    ioctl(_mag_fd, SENSORIOCSQUEUEDEPTH, 10);
+        // average over up to 10 samples
+        ioctl(_mag_fd[i], SENSORIOCSQUEUEDEPTH, 10);
+
+        _count[i] = 0;
+        _sum[i].zero();
+    }
 
     healthy = false;
-    _count = 0;
-    _sum.zero();
+    _vote.set_count(_num_instances, hal.scheduler->micros());
 
-    hal.scheduler->register_timer_process(_compass_timer);
+    hal.scheduler->register_slow_process(_compass_timer, 10000);
 
     // give the timer a chance to run, and gather one sample
     hal.scheduler->delay(40);
@@ -71,47 +93,57 @@ bool AP_Compass_PX4::read(void)
     // try to accumulate one more sample, so we have the latest data
     _accumulate();
 
-    // consider the compass healthy if we got a reading in the last 0.2s
-    healthy = (hrt_absolute_time() - _last_timestamp < 200000);
-    if (!healthy || _count == 0) {
+    // use the primary, and consider the compass healthy if it got a
+    // reading in the last 0.2s
+    uint8_t p = _vote.primary();
+    healthy = (hrt_absolute_time() - _last_timestamp[p] < 200000);
+    if (!healthy || _count[p] == 0) {
         hal.scheduler->resume_timer_procs();
         return healthy;
     }
 
-    _sum /= _count;
-    _sum *= 1000;
+    Vector3f field = _sum[p] / _count[p];
+    field *= 1000;
 
     // apply default board orientation for this compass type. This is
     // a noop on most boards
-    _sum.rotate(MAG_BOARD_ORIENTATION);
+    field.rotate(MAG_BOARD_ORIENTATION);
 
     // add user selectable orientation
-    _sum.rotate((enum Rotation)_orientation.get());
+    field.rotate((enum Rotation)_orientation.get());
 
     // and add in AHRS_ORIENTATION setting
-    _sum.rotate(_board_orientation);
-    _sum += _offset.get();
-
-    // apply motor compensation
-    if (_motor_comp_type != AP_COMPASS_MOT_COMP_DISABLED && _thr_or_curr != 0.0f) {
-        _motor_offset = _motor_compensation.get() * _thr_or_curr;
-        _sum += _motor_offset;
-    } else {
-        _motor_offset.x = 0;
-        _motor_offset.y = 0;
-        _motor_offset.z = 0;
+    field.rotate(_board_orientation);
+    field += _offset.get();
+
+    // apply motor compensation for the throttle or current when each
+    // sample was taken. The timer only keeps the first and last
+    // times, and the driver samples evenly between them
+    uint32_t now_us = hal.scheduler->micros();
+    uint64_t now_hrt = hrt_absolute_time();
+    uint32_t first_us = now_us - (uint32_t)(now_hrt - _first_timestamp[p]);
+    uint32_t span_us = (uint32_t)(_last_timestamp[p] - _first_timestamp[p]);
+    uint8_t n = min(_count[p], COMPASS_PX4_MOT_SAMPLES);
+    for (uint8_t i=0; i<n; i++) {
+        _motor_sample(n > 1 ? first_us + span_us / (n - 1) * i : first_us);
     }
+    _apply_motor_compensation(field);
     
-    mag_x = _sum.x;
-    mag_y = _sum.y;
-    mag_z = _sum.z;
+    mag_x = field.x;
+    mag_y = field.y;
+    mag_z = field.z;
     
-    _sum.zero();
-    _count = 0;
+    for (uint8_t i=0; i<_num_instances; i++) {
+        _sum[i].zero();
+        _count[i] = 0;
+    }
+
+    // micros() counts from the sketch start, so go by the age of the sample
+    _last_sample_us = hal.scheduler->micros() - (uint32_t)(hrt_absolute_time() - _last_timestamp[p]);
 
     hal.scheduler->resume_timer_procs();
     
-    last_update = _last_timestamp;
+    last_update = _last_timestamp[p];
     
     return true;
 }
@@ -119,12 +151,36 @@ bool AP_Compass_PX4::read(void)
 void AP_Compass_PX4::_accumulate(void)
 {
     struct mag_report mag_report;
-    while (::read(_mag_fd, &mag_report, sizeof(mag_report)) == sizeof(mag_report) &&
-           mag_report.timestamp != _last_timestamp) {
-        _sum += Vector3f(mag_report.x, mag_report.y, mag_report.z);
-        _count++;
-        _last_timestamp = mag_report.timestamp;
+    uint32_t now = hal.scheduler->micros();
+
+    // only read the instances which have reports queued
+    struct pollfd fds[COMPASS_PX4_MAX_INSTANCES];
+    for (uint8_t i=0; i<_num_instances; i++) {
+        fds[i].fd = _mag_fd[i];
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+    if (::poll(fds, _num_instances, 0) <= 0) {
+        _vote.update(now);
+        return;
+    }
+
+    for (uint8_t i=0; i<_num_instances; i++) {
+        if (!(fds[i].revents & POLLIN)) {
+            continue;
+        }
+        while (::read(_mag_fd[i], &mag_report, sizeof(mag_report)) == sizeof(mag_report) &&
+               mag_report.timestamp != _last_timestamp[i]) {
+            if (_count[i] == 0) {
+                _first_timestamp[i] = mag_report.timestamp;
+            }
+            _sum[i] += Vector3f(mag_report.x, mag_report.y, mag_report.z);
+            _count[i]++;
+            _last_timestamp[i] = mag_report.timestamp;
+            _vote.sample(i, Vector3f(mag_report.x, mag_report.y, mag_report.z), now);
+        }
     }
+    _vote.update(now);
 }
 
 void AP_Compass_PX4::accumulate(void)
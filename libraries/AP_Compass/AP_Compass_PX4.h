@@ -5,6 +5,15 @@
 
 #include "Compass.h"
 
+// the most compasses used, and the longest gap between samples. The
+// offsets and orientation are those of the first compass, so the
+// others only take over when it stops, and are not voted on
+#define COMPASS_PX4_MAX_INSTANCES   3
+#define COMPASS_PX4_TIMEOUT_US      200000
+
+// the most sample times the motor compensation is found for in a read
+#define COMPASS_PX4_MOT_SAMPLES     10U
+
 class AP_Compass_PX4 : public Compass
 {
 public:
@@ -16,11 +25,16 @@ public:
     void        accumulate(void);
 
 private:
-    static int _mag_fd;
-    static Vector3f _sum;
-    static uint32_t _count;
+    // the timer accumulates every instance, so a backup is up to date
+    // the moment it becomes the primary
+    static uint8_t _num_instances;
+    static int _mag_fd[COMPASS_PX4_MAX_INSTANCES];
+    static Vector3f _sum[COMPASS_PX4_MAX_INSTANCES];
+    static uint32_t _count[COMPASS_PX4_MAX_INSTANCES];
     static uint32_t _last_timer;
-    static uint64_t _last_timestamp;
+    static uint64_t _first_timestamp[COMPASS_PX4_MAX_INSTANCES];
+    static uint64_t _last_timestamp[COMPASS_PX4_MAX_INSTANCES];
+    static SensorVote _vote;
     static void _accumulate(void);
     static void _compass_timer(uint32_t now);
 };
@@ -1,7 +1,10 @@
 /// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include <AP_HAL.h>
 #include <AP_Progmem.h>
 #include "Compass.h"
 
+extern const AP_HAL::HAL& hal;
+
 const AP_Param::GroupInfo Compass::var_info[] PROGMEM = {
     // index 0 was used for the old orientation matrix
 
@@ -35,8 +38,8 @@ const AP_Param::GroupInfo Compass::var_info[] PROGMEM = {
 
     // @Param: LEARN
     // @DisplayName: Learn compass offsets automatically
-    // @Description: Enable or disable the automatic learning of compass offsets
-    // @Values: 0:Disabled,1:Enabled
+    // @Description: Enable or disable the automatic learning of compass offsets. The background calibration fits a sphere to samples taken as the vehicle turns, where the vehicle supports it
+    // @Values: 0:Disabled,1:Enabled,2:Background calibration
     // @User: Advanced
     AP_GROUPINFO("LEARN",  3, Compass, _learn, 1), // true if learning calibration
 
@@ -91,6 +94,28 @@ const AP_Param::GroupInfo Compass::var_info[] PROGMEM = {
     // @Values: 0:None,1:Yaw45,2:Yaw90,3:Yaw135,4:Yaw180,5:Yaw225,6:Yaw270,7:Yaw315,8:Roll180,9:Roll180Yaw45,10:Roll180Yaw90,11:Roll180Yaw135,12:Pitch180,13:Roll180Yaw225,14:Roll180Yaw270,15:Roll180Yaw315,16:Roll90,17:Roll90Yaw45,18:Roll90Yaw90,19:Roll90Yaw135,20:Roll270,21:Roll270Yaw45,22:Roll270Yaw90,23:Roll270Yaw136,24:Pitch90,25:Pitch270
     AP_GROUPINFO("ORIENT", 8, Compass, _orientation, ROTATION_NONE),
 
+    // @Param: MOT2_X
+    // @DisplayName: Motor interference compensation squared for body frame X axis
+    // @Description: Multiplied by the square of the current throttle and added to the compass's x-axis values, for interference that grows faster than the throttle or current
+    // @Range: -1000 1000
+    // @Units: Offset per Amp squared or at Full Throttle
+    // @Increment: 1
+
+    // @Param: MOT2_Y
+    // @DisplayName: Motor interference compensation squared for body frame Y axis
+    // @Description: Multiplied by the square of the current throttle and added to the compass's y-axis values, for interference that grows faster than the throttle or current
+    // @Range: -1000 1000
+    // @Units: Offset per Amp squared or at Full Throttle
+    // @Increment: 1
+
+    // @Param: MOT2_Z
+    // @DisplayName: Motor interference compensation squared for body frame Z axis
+    // @Description: Multiplied by the square of the current throttle and added to the compass's z-axis values, for interference that grows faster than the throttle or current
+    // @Range: -1000 1000
+    // @Units: Offset per Amp squared or at Full Throttle
+    // @Increment: 1
+    AP_GROUPINFO("MOT2",   9, Compass, _motor_compensation2, 0),
+
     AP_GROUPEND
 };
 
@@ -100,7 +125,18 @@ const AP_Param::GroupInfo Compass::var_info[] PROGMEM = {
 //
 Compass::Compass(void) :
     product_id(AP_COMPASS_TYPE_UNKNOWN),
-    _null_init_done(false)
+    _null_init_done(false),
+    _last_sample_us(0),
+    _thr_or_curr(0),
+    _motor_history_next(0),
+    _motor_history_count(0),
+    _motor_sum(0),
+    _motor_sum_sq(0),
+    _motor_count(0),
+    _heading(0),
+    _heading_last_update(0),
+    _earth_field_valid(false),
+    _earth_field_last_update(0)
 {
     AP_Param::setup_object_defaults(this, var_info);
 }
@@ -142,6 +178,88 @@ Compass::save_motor_compensation()
 {
     _motor_comp_type.save();
     _motor_compensation.save();
+    _motor_compensation2.save();
+}
+
+void
+Compass::_set_thr_or_curr(float value)
+{
+    _thr_or_curr = value;
+    struct motor_history &h = _motor_history[_motor_history_next];
+    h.time_us = hal.scheduler->micros();
+    h.value = value;
+    _motor_history_next = (_motor_history_next + 1) % COMPASS_MOT_HISTORY;
+    if (_motor_history_count < COMPASS_MOT_HISTORY) {
+        _motor_history_count++;
+    }
+}
+
+// the newest value set at or before a time. A sample older than all
+// of them gets the oldest
+float
+Compass::_thr_or_curr_at(uint32_t time_us) const
+{
+    if (_motor_history_count == 0) {
+        return _thr_or_curr;
+    }
+    uint8_t i = _motor_history_next;
+    float value = 0;
+    for (uint8_t n=0; n<_motor_history_count; n++) {
+        i = (i + COMPASS_MOT_HISTORY - 1) % COMPASS_MOT_HISTORY;
+        value = _motor_history[i].value;
+        if ((int32_t)(time_us - _motor_history[i].time_us) >= 0) {
+            break;
+        }
+    }
+    return value;
+}
+
+void
+Compass::_motor_sample(uint32_t sample_us)
+{
+    if (_motor_comp_type == AP_COMPASS_MOT_COMP_DISABLED) {
+        return;
+    }
+    float x = _thr_or_curr_at(sample_us);
+    _motor_sum += x;
+    _motor_sum_sq += x * x;
+    _motor_count++;
+}
+
+void
+Compass::_motor_samples_halve(void)
+{
+    _motor_sum *= 0.5f;
+    _motor_sum_sq *= 0.5f;
+    _motor_count /= 2;
+}
+
+void
+Compass::_apply_motor_compensation(Vector3f &field)
+{
+    float x, x_sq;
+    if (_motor_count != 0) {
+        x = _motor_sum / _motor_count;
+        x_sq = _motor_sum_sq / _motor_count;
+    } else {
+        x = _thr_or_curr;
+        x_sq = x * x;
+    }
+    _motor_sum = _motor_sum_sq = 0;
+    _motor_count = 0;
+
+    if (_motor_comp_type != AP_COMPASS_MOT_COMP_DISABLED && x != 0.0f) {
+        const Vector3f &a = _motor_compensation.get();
+        const Vector3f &b = _motor_compensation2.get();
+        _motor_offset.x = a.x * x + b.x * x_sq;
+        _motor_offset.y = a.y * x + b.y * x_sq;
+        _motor_offset.z = a.z * x + b.z * x_sq;
+        field += _motor_offset;
+    } else {
+        _motor_offset.x = 0;
+        _motor_offset.y = 0;
+        _motor_offset.z = 0;
+    }
 }
 
 void
@@ -178,17 +296,27 @@ Compass::get_declination() const
 
 
 float
-Compass::calculate_heading(const Matrix3f &dcm_matrix) const
+Compass::calculate_heading(const Matrix3f &dcm_matrix)
 {
-    // Tilt compensated magnetic field Y component:
-    float headY = mag_y * dcm_matrix.c.z - mag_z * dcm_matrix.c.y;
-
-    // Tilt compensated magnetic field X component:
-    float headX = mag_x + dcm_matrix.c.x * (headY - mag_x * dcm_matrix.c.x);
+    // the heading only depends on the reading and the tilt, which
+    // is the bottom row of the rotation. The zero vector the cache
+    // starts with is never a row of a rotation
+    if (last_update != _heading_last_update || !(dcm_matrix.c == _heading_dcm_c)) {
+        _heading_last_update = last_update;
+        _heading_dcm_c = dcm_matrix.c;
+
+        // Tilt compensated magnetic field Y component:
+        float headY = mag_y * dcm_matrix.c.z - mag_z * dcm_matrix.c.y;
+
+        // Tilt compensated magnetic field X component:
+        float headX = mag_x + dcm_matrix.c.x * (headY - mag_x * dcm_matrix.c.x);
+
+        // magnetic heading
+        // 6/4/11 - added constrain to keep bad values from ruining DCM Yaw - Jason S.
+        _heading = constrain_float(atan2f(-headY,headX), -3.15f, 3.15f);
+    }
 
-    // magnetic heading
-    // 6/4/11 - added constrain to keep bad values from ruining DCM Yaw - Jason S.
-    float heading = constrain_float(atan2f(-headY,headX), -3.15f, 3.15f);
+    float heading = _heading;
 
     // Declination correction (if supplied)
     if( fabsf(_declination) > 0.0f )
@@ -203,6 +331,25 @@ Compass::calculate_heading(const Matrix3f &dcm_matrix) const
     return heading;
 }
 
+bool
+Compass::calculate_earth_field(const Matrix3f &dcm_matrix, Vector2f &field)
+{
+    if (last_update != _earth_field_last_update ||
+        !(dcm_matrix.a == _earth_field_dcm_a) || !(dcm_matrix.b == _earth_field_dcm_b)) {
+        _earth_field_last_update = last_update;
+        _earth_field_dcm_a = dcm_matrix.a;
+        _earth_field_dcm_b = dcm_matrix.b;
+
+        // get the mag vector in the earth frame
+        _earth_field = dcm_matrix.mulXY(Vector3f(mag_x, mag_y, mag_z));
+        _earth_field.normalize();
+        _earth_field_valid = !_earth_field.is_inf() && !_earth_field.is_nan();
+    }
+
+    field = _earth_field;
+    return _earth_field_valid;
+}
+
 
 /*
  *  this offset nulling algorithm is inspired by this paper from Bill Premerlani
@@ -227,8 +374,8 @@ Compass::calculate_heading(const Matrix3f &dcm_matrix) const
 void
 Compass::null_offsets(void)
 {
-    if (_learn == 0) {
-        // auto-calibration is disabled
+    if (_learn != 1) {
+        // auto-calibration is disabled, or done by CompassCalibrator
         return;
     }
 
@@ -20,6 +20,17 @@
 #define AP_COMPASS_MOT_COMP_THROTTLE    0x01
 #define AP_COMPASS_MOT_COMP_CURRENT     0x02
 
+// the throttle or current values kept, so each sample is compensated
+// with the one in effect when it was taken. They are set at up to
+// 100Hz and the compass is read at 10Hz
+#ifndef COMPASS_MOT_HISTORY
+# if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+#  define COMPASS_MOT_HISTORY 8
+# else
+#  define COMPASS_MOT_HISTORY 16
+# endif
+#endif
+
 // setup default mag orientation for each board type
 #if CONFIG_HAL_BOARD == HAL_BOARD_APM1
 # define MAG_BOARD_ORIENTATION ROTATION_ROLL_180
@@ -64,13 +75,32 @@ public:
     /// possible
     virtual void accumulate(void) = 0;
 
+    /// micros() time the newest sample in the last read() was taken
+    /// by the sensor. last_update is when read() ran
+    ///
+    uint32_t get_last_sample_time_micros(void) const { return _last_sample_us; }
+
     /// Calculate the tilt-compensated heading_ variables.
     ///
     /// @param dcm_matrix			The current orientation rotation matrix
     ///
     /// @returns heading in radians
     ///
-    float calculate_heading(const Matrix3f &dcm_matrix) const;
+    /// The heading is kept until there is a new reading or the tilt
+    /// changes, so repeated calls for the same sample are cheap.
+    ///
+    float calculate_heading(const Matrix3f &dcm_matrix);
+
+    /// The horizontal part of the field in the earth frame, normalised.
+    /// Its cross product with the expected field is the sine of the
+    /// heading error, so it gives the error without an atan2.
+    ///
+    /// @param dcm_matrix			The current orientation rotation matrix
+    /// @param field				The normalised field
+    ///
+    /// @returns false if the field has no horizontal part
+    ///
+    bool calculate_earth_field(const Matrix3f &dcm_matrix, Vector2f &field);
 
     /// Sets the compass offset x/y/z values.
     ///
@@ -138,7 +168,10 @@ public:
         if (_motor_comp_type <= AP_COMPASS_MOT_COMP_CURRENT && _motor_comp_type != (int8_t)comp_type) {
             _motor_comp_type = (int8_t)comp_type;
             _thr_or_curr = 0;                               // set current current or throttle to zero
+            _motor_history_count = 0;
+            _motor_count = 0;
             set_motor_compensation(Vector3f(0,0,0));        // clear out invalid compensation vector
+            _motor_compensation2.set(Vector3f(0,0,0));
         }
     }
 
@@ -174,7 +207,7 @@ public:
     /// @param thr_pct              throttle expressed as a percentage from 0 to 1.0
     void set_throttle(float thr_pct) {
         if(_motor_comp_type == AP_COMPASS_MOT_COMP_THROTTLE) {
-            _thr_or_curr = thr_pct;
+            _set_thr_or_curr(thr_pct);
         }
     }
 
@@ -182,7 +215,7 @@ public:
     /// @param amps                 current flowing to the motors expressed in amps
     void set_current(float amps) {
         if(_motor_comp_type == AP_COMPASS_MOT_COMP_CURRENT) {
-            _thr_or_curr = amps;
+            _set_thr_or_curr(amps);
         }
     }
 
@@ -200,6 +233,8 @@ protected:
 
     bool _null_init_done;                           ///< first-time-around flag used by offset nulling
 
+    uint32_t _last_sample_us;
+
     ///< used by offset correction
     static const uint8_t _mag_history_size = 20;
     uint8_t _mag_history_index;
@@ -208,10 +243,57 @@ protected:
     // motor compensation
     AP_Int8     _motor_comp_type;               // 0 = disabled, 1 = enabled for throttle, 2 = enabled for current
     AP_Vector3f _motor_compensation;            // factors multiplied by throttle and added to compass outputs
+    AP_Vector3f _motor_compensation2;           // factors multiplied by the square of the throttle or current
     Vector3f    _motor_offset;                  // latest compensation added to compass
     float       _thr_or_curr;                   // throttle expressed as a percentage from 0 ~ 1.0 or current expressed in amps
 
+    // the recent throttle or current values and the micros() time
+    // each was set, oldest first from _motor_history_next
+    struct motor_history {
+        uint32_t time_us;
+        float    value;
+    } _motor_history[COMPASS_MOT_HISTORY];
+    uint8_t     _motor_history_next;
+    uint8_t     _motor_history_count;
+
+    // the sums of the throttle or current, and its square, at the
+    // time of each sample accumulated since the last read. The
+    // compensation is linear in them, so their mean gives the mean of
+    // the compensation of each sample
+    float       _motor_sum;
+    float       _motor_sum_sq;
+    uint8_t     _motor_count;
+
+    void        _set_thr_or_curr(float value);
+    float       _thr_or_curr_at(uint32_t time_us) const;
+
+    /// add the throttle or current in effect at the micros() time a
+    /// sample was taken to the sums for the next read
+    void        _motor_sample(uint32_t sample_us);
+
+    /// halve the sums, for drivers that halve their own sums of samples
+    void        _motor_samples_halve(void);
+
+    /// add the compensation for the samples since the last call to
+    /// the field, and set _motor_offset to it. With no samples the
+    /// latest throttle or current is used
+    void        _apply_motor_compensation(Vector3f &field);
+
     // board orientation from AHRS
     enum Rotation _board_orientation;
+
+    // the last heading, without declination, kept against the reading
+    // and the tilt it was found from
+    float       _heading;
+    uint32_t    _heading_last_update;
+    Vector3f    _heading_dcm_c;
+
+    // the last earth frame field, kept against the reading and the
+    // rows of the rotation it was found from
+    Vector2f    _earth_field;
+    bool        _earth_field_valid;
+    uint32_t    _earth_field_last_update;
+    Vector3f    _earth_field_dcm_a;
+    Vector3f    _earth_field_dcm_b;
 };
 #endif
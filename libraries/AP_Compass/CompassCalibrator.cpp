@@ -0,0 +1,229 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	CompassCalibrator.cpp
+/// @brief	Background compass offset calibration
+
+#include <AP_HAL.h>
+#include "CompassCalibrator.h"
+
+extern const AP_HAL::HAL& hal;
+
+CompassCalibrator::CompassCalibrator(Compass &compass) :
+    _compass(compass),
+    _radius(0),
+    _fitness(0)
+{
+    reset();
+}
+
+void CompassCalibrator::reset()
+{
+    _state = CAL_COLLECTING;
+    _decimation = 0;
+    _sample_count = 0;
+    _sample_sum = Vector3l(0, 0, 0);
+    _sample_sum_sq = 0;
+}
+
+// new_sample - adds the latest reading to the sample set if it is far
+// enough from all the samples already there, so the set covers the
+// sphere rather than piling up wherever the vehicle spends its time
+void CompassCalibrator::new_sample()
+{
+    if (_state != CAL_COLLECTING) {
+        return;
+    }
+    if (++_decimation < COMPASS_CAL_DECIMATION) {
+        return;
+    }
+    _decimation = 0;
+
+    // the reading without the offsets, like the history of null_offsets()
+    const Vector3f &ofs = _compass.get_offsets();
+    Vector3i sample((_compass.mag_x+0.5f) - ofs.x, (_compass.mag_y+0.5f) - ofs.y, (_compass.mag_z+0.5f) - ofs.z);
+
+    // the separation is a fraction of the field, from the corrected
+    // reading, or the spread of the samples once there are a few, as
+    // the offsets may be far off. The check against every sample is
+    // done in integers
+    float field_sq = (float)_compass.mag_x*_compass.mag_x + (float)_compass.mag_y*_compass.mag_y + (float)_compass.mag_z*_compass.mag_z;
+    if (_sample_count >= 4) {
+        Vector3f mean = Vector3f(_sample_sum.x, _sample_sum.y, _sample_sum.z) / (float)_sample_count;
+        float spread_sq = _sample_sum_sq / _sample_count - mean.length_squared();
+        if (spread_sq < field_sq) {
+            field_sq = spread_sq;
+        }
+    }
+    int32_t min_sq = (int32_t)field_sq >> COMPASS_CAL_SEPARATION_SHIFT;
+    for (uint8_t i=0; i<_sample_count; i++) {
+        int32_t dx = (int32_t)sample.x - _sample[i].x;
+        int32_t dy = (int32_t)sample.y - _sample[i].y;
+        int32_t dz = (int32_t)sample.z - _sample[i].z;
+        if (dx*dx + dy*dy + dz*dz < min_sq) {
+            return;
+        }
+    }
+
+    _sample[_sample_count++] = sample;
+    _sample_sum.x += sample.x;
+    _sample_sum.y += sample.y;
+    _sample_sum.z += sample.z;
+    _sample_sum_sq += (float)sample.x*sample.x + (float)sample.y*sample.y + (float)sample.z*sample.z;
+
+    if (_sample_count == COMPASS_CAL_NUM_SAMPLES) {
+        start_fit();
+    }
+}
+
+// start_fit - starts from the mean of the samples, and their rms
+// distance from it
+void CompassCalibrator::start_fit()
+{
+    _centre = Vector3f(_sample_sum.x, _sample_sum.y, _sample_sum.z) / (float)_sample_count;
+    _radius = safe_sqrt(_sample_sum_sq / _sample_count - _centre.length_squared());
+    _lambda = COMPASS_CAL_LAMBDA_START;
+    _iteration = 0;
+
+    memset(_jtj, 0, sizeof(_jtj));
+    memset(_jtr, 0, sizeof(_jtr));
+    _rss = 0;
+    _index = 0;
+    _state = CAL_ACCUMULATE;
+}
+
+float CompassCalibrator::residual(uint8_t i, const Vector3f &centre, float radius, Vector3f &unit) const
+{
+    Vector3f delta = Vector3f(_sample[i].x, _sample[i].y, _sample[i].z) - centre;
+    float length = delta.length();
+    if (length > 0) {
+        unit = delta / length;
+    } else {
+        unit = Vector3f(0, 0, 0);
+    }
+    return length - radius;
+}
+
+// calc_trial - solves (J'J + lambda diag(J'J)) x = -J'r for the step
+// from the fit by gaussian elimination. J'J is positive definite so it
+// needs no pivoting
+void CompassCalibrator::calc_trial()
+{
+    float a[4][5];
+
+    for (uint8_t i=0; i<4; i++) {
+        for (uint8_t j=0; j<4; j++) {
+            a[i][j] = _jtj[i][j];
+        }
+        a[i][i] *= 1.0f + _lambda;
+        a[i][4] = -_jtr[i];
+    }
+    for (uint8_t k=0; k<4; k++) {
+        if (a[k][k] == 0) {
+            // no information about this unknown, so don't move it
+            a[k][4] = 0;
+            continue;
+        }
+        for (uint8_t i=k+1; i<4; i++) {
+            float f = a[i][k] / a[k][k];
+            for (uint8_t j=k; j<5; j++) {
+                a[i][j] -= f * a[k][j];
+            }
+        }
+    }
+    float x[4];
+    for (int8_t i=3; i>=0; i--) {
+        float sum = a[i][4];
+        for (uint8_t j=i+1; j<4; j++) {
+            sum -= a[i][j] * x[j];
+        }
+        x[i] = a[i][i] != 0 ? sum / a[i][i] : 0;
+    }
+
+    _trial_centre = _centre + Vector3f(x[0], x[1], x[2]);
+    _trial_radius = _radius + x[3];
+    _trial_rss = 0;
+    _index = 0;
+    _state = CAL_EVALUATE;
+}
+
+// update - works through the samples until the time runs out. A pass
+// over the samples either builds the normal equations at the fit, or
+// finds the residual of a trial step from it. Better trials become the
+// fit and shrink the damping, worse ones grow it and are tried again
+bool CompassCalibrator::update(uint16_t budget_us)
+{
+    uint32_t tstart = hal.scheduler->micros();
+
+    while (_state != CAL_COLLECTING && hal.scheduler->micros() - tstart < budget_us) {
+        Vector3f unit;
+
+        if (_state == CAL_ACCUMULATE) {
+            float r = residual(_index, _centre, _radius, unit);
+            // the derivatives of the residual by the centre and radius
+            float J[4] = { -unit.x, -unit.y, -unit.z, -1.0f };
+            for (uint8_t i=0; i<4; i++) {
+                for (uint8_t j=i; j<4; j++) {
+                    _jtj[i][j] += J[i] * J[j];
+                }
+                _jtr[i] += J[i] * r;
+            }
+            _rss += r * r;
+
+            if (++_index == _sample_count) {
+                for (uint8_t i=1; i<4; i++) {
+                    for (uint8_t j=0; j<i; j++) {
+                        _jtj[i][j] = _jtj[j][i];
+                    }
+                }
+                calc_trial();
+            }
+        } else {
+            float r = residual(_index, _trial_centre, _trial_radius, unit);
+            _trial_rss += r * r;
+
+            if (++_index == _sample_count) {
+                _iteration++;
+                if (_trial_rss < _rss) {
+                    bool converged = _rss - _trial_rss < _rss * 1.0e-4f;
+                    _centre = _trial_centre;
+                    _radius = _trial_radius;
+                    _rss = _trial_rss;
+                    _lambda *= 0.1f;
+                    if (converged || _iteration >= COMPASS_CAL_MAX_ITERATIONS) {
+                        return finish();
+                    }
+                    memset(_jtj, 0, sizeof(_jtj));
+                    memset(_jtr, 0, sizeof(_jtr));
+                    _rss = 0;
+                    _index = 0;
+                    _state = CAL_ACCUMULATE;
+                } else {
+                    if (_iteration >= COMPASS_CAL_MAX_ITERATIONS) {
+                        return finish();
+                    }
+                    _lambda *= 10.0f;
+                    calc_trial();
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// finish - applies the offsets if the fit is close and believable, and
+// starts collecting again either way
+bool CompassCalibrator::finish()
+{
+    _fitness = safe_sqrt(_rss / _sample_count);
+    reset();
+
+    if (_fitness > COMPASS_CAL_FITNESS_MAX ||
+        _radius < COMPASS_CAL_RADIUS_MIN || _radius > COMPASS_CAL_RADIUS_MAX ||
+        _centre.length() > COMPASS_CAL_OFFSET_MAX) {
+        return false;
+    }
+
+    // the offsets are added to the readings, so they are minus the centre
+    _compass.set_offsets(-_centre);
+    return true;
+}
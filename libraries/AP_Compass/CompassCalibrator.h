@@ -0,0 +1,111 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	CompassCalibrator.h
+/// @brief	Background compass offset calibration by fitting a sphere to
+///         samples of the field taken as the vehicle turns.
+
+#ifndef CompassCalibrator_h
+#define CompassCalibrator_h
+
+#include <AP_Math.h>
+#include "Compass.h"
+
+// samples kept for the fit
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+# define COMPASS_CAL_NUM_SAMPLES        30
+#else
+# define COMPASS_CAL_NUM_SAMPLES        60
+#endif
+
+#define COMPASS_CAL_DECIMATION          2       // only every 2nd compass reading is considered
+#define COMPASS_CAL_SEPARATION_SHIFT    4       // a sample must be 1/4 (the square root of 2^-4) of the field from the others, about 15 degrees
+#define COMPASS_CAL_MAX_ITERATIONS      20      // Levenberg-Marquardt steps of a fit
+#define COMPASS_CAL_LAMBDA_START        1.0f    // initial Levenberg-Marquardt damping
+#define COMPASS_CAL_FITNESS_MAX         8.0f    // largest rms residual of a fit whose offsets are applied
+#define COMPASS_CAL_RADIUS_MIN          150.0f  // smallest field length a fit may find
+#define COMPASS_CAL_RADIUS_MAX          950.0f  // largest field length a fit may find
+#define COMPASS_CAL_OFFSET_MAX          1000.0f // largest offsets a fit may find
+
+/// @class	CompassCalibrator
+/// @brief	Collects samples of the uncorrected field which are well spread
+///         over the sphere, then fits the sphere with Levenberg-Marquardt
+///         steps that are split into slices, so that no call to update()
+///         runs for longer than the time it is given. Good fits set the
+///         compass offsets, then collection starts again.
+class CompassCalibrator
+{
+public:
+    enum cal_state {
+        CAL_COLLECTING = 0,                 ///< waiting for well spread samples
+        CAL_ACCUMULATE,                     ///< building the normal equations at the current fit
+        CAL_EVALUATE,                       ///< finding the residual of a trial step
+    };
+
+    CompassCalibrator(Compass &compass);
+
+    /// Consider the compass's latest reading for the sample set. Call
+    /// after each successful Compass::read()
+    void            new_sample();
+
+    /// Run the fit for up to budget_us microseconds
+    ///
+    /// @returns    true if a fit finished and its offsets were applied
+    ///
+    bool            update(uint16_t budget_us);
+
+    /// Throw away the samples and the fit in progress
+    void            reset();
+
+    enum cal_state  get_state() const { return _state; }
+
+    /// samples collected, out of COMPASS_CAL_NUM_SAMPLES
+    uint8_t         get_sample_count() const { return _sample_count; }
+
+    /// rms residual in compass units of the last finished fit
+    float           get_fitness() const { return _fitness; }
+
+    /// the field length found by the last finished fit
+    float           get_radius() const { return _radius; }
+
+private:
+    /// residual of sample i from the sphere, and the unit vector from its centre to the sample
+    float           residual(uint8_t i, const Vector3f &centre, float radius, Vector3f &unit) const;
+
+    /// start the fit of a full sample set
+    void            start_fit();
+
+    /// solve the damped normal equations for a trial step
+    void            calc_trial();
+
+    /// finish the fit, applying the offsets if the fit is good
+    bool            finish();
+
+    Compass &       _compass;
+    enum cal_state  _state;
+    uint8_t         _decimation;
+
+    Vector3i        _sample[COMPASS_CAL_NUM_SAMPLES];
+    uint8_t         _sample_count;
+    Vector3l        _sample_sum;                        ///< for the initial centre
+    float           _sample_sum_sq;                     ///< for the initial radius
+
+    // the fit, as the sphere's centre in uncorrected compass units and
+    // its radius, and the trial step from it
+    Vector3f        _centre;
+    float           _radius;
+    Vector3f        _trial_centre;
+    float           _trial_radius;
+    float           _rss;                               ///< sum of squared residuals at the fit
+    float           _trial_rss;
+    float           _lambda;
+    uint8_t         _iteration;
+    uint8_t         _index;                             ///< next sample of the current pass
+
+    // normal equations J'J x = -J'r at the fit, the unknowns x, y, z, radius
+    float           _jtj[4][4];
+    float           _jtr[4];
+
+    float           _fitness;
+};
+
+#endif // CompassCalibrator_h
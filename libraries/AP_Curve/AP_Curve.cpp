@@ -21,6 +21,9 @@ void AP_Curve<T,SIZE>::clear() {
 		_slope[i] = 0.0;
 	}
 	_num_points = 0;
+	_increasing = true;
+	_uniform = true;
+	_inv_step = 0;
 }
 
 // add_point - adds a point to the curve
@@ -38,6 +41,16 @@ bool AP_Curve<T,SIZE>::add_point( T x, T y )
 		if( _num_points > 1 ) {
 			_slope[_num_points-2] = (float)(_y[_num_points-1] - _y[_num_points-2]) / (float)(_x[_num_points-1] - _x[_num_points-2]);
 			_slope[_num_points-1] = _slope[_num_points-2];	// the final slope is for interpolation beyond the end of the curve
+
+			// keep track of how the segment can be found
+			if( _x[_num_points-1] <= _x[_num_points-2] ) {
+				_increasing = false;
+			}
+			if( _num_points == 2 ) {
+				_inv_step = 1.0f / (float)(_x[1] - _x[0]);
+			}else if( _x[_num_points-1] - _x[_num_points-2] != _x[1] - _x[0] ) {
+				_uniform = false;
+			}
 		}
 		return true;
 	}else{
@@ -69,6 +82,11 @@ T AP_Curve<T,SIZE>::get_y( T x )
 	}
 
 	// deal with the normal case
+	if( _increasing ) {
+		i = segment(x);
+		result = _y[i] + (x - _x[i]) * _slope[i];
+		return result;
+	}
 	for( i=0; i<_num_points-1; i++ ) {
 		if( x >= _x[i] && x <= _x[i+1] ) {
 			result = _y[i] + (x - _x[i]) * _slope[i];
@@ -79,6 +97,41 @@ T AP_Curve<T,SIZE>::get_y( T x )
 	// we should never get here
 	return x;
 }
+
+// segment - returns the index of the first segment whose end is at or above x
+template <class T, uint8_t SIZE>
+uint8_t AP_Curve<T,SIZE>::segment( T x ) const
+{
+	uint8_t lo, hi;
+
+	if( _uniform ) {
+		// the index from the spacing, then a step either way for the rounding
+		lo = (float)(x - _x[0]) * _inv_step;
+		if( lo > _num_points-2 ) {
+			lo = _num_points-2;
+		}
+		while( lo > 0 && x <= _x[lo] ) {
+			lo--;
+		}
+		while( x > _x[lo+1] ) {
+			lo++;
+		}
+		return lo;
+	}
+
+	// binary search
+	lo = 0;
+	hi = _num_points-2;
+	while( lo < hi ) {
+		uint8_t mid = (lo + hi) / 2;
+		if( x <= _x[mid+1] ) {
+			hi = mid;
+		}else{
+			lo = mid + 1;
+		}
+	}
+	return lo;
+}
 // displays the contents of the curve (for debugging)
 template <class T, uint8_t SIZE>
 void AP_Curve<T,SIZE>::dump_curve(AP_HAL::BetterStream* s)
@@ -98,7 +151,11 @@ void AP_Curve<T,SIZE>::dump_curve(AP_HAL::BetterStream* s)
 template class AP_Curve<int16_t,3>;
 template class AP_Curve<int16_t,4>;
 template class AP_Curve<int16_t,5>;
+template class AP_Curve<int16_t,8>;
+template class AP_Curve<int16_t,16>;
 template class AP_Curve<uint16_t,3>;
 template class AP_Curve<uint16_t,4>;
 template class AP_Curve<uint16_t,5>;
+template class AP_Curve<uint16_t,8>;
+template class AP_Curve<uint16_t,16>;
 
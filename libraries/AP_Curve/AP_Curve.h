@@ -26,6 +26,8 @@ public:
     virtual bool add_point( T x, T y );
 
     // get_y - returns the point on the curve at the given pwm_value (i.e. the new modified pwm_value)
+    // the segment is found directly when the points are evenly spaced in x, and by a binary search
+    // when they are in increasing order
     virtual T get_y( T x );
 
     // displays the contents of the curve (for debugging)
@@ -37,6 +39,13 @@ protected:
     T           _y[SIZE];			// y values of each point on the curve
     float       _slope[SIZE];		// slope between any two points.  i.e. slope[0] is the slope between points 0 and 1
     bool        _constrained;       // if true, first and last points added will constrain the y values returned by get_y function
+    bool        _increasing;        // true if each point's x value is above the previous one
+    bool        _uniform;           // true if the points are also evenly spaced in x
+    float       _inv_step;          // 1 / the spacing of evenly spaced points
+
+    // segment - returns the index of the first segment whose end is at or above x,
+    // with x between the first and last points
+    uint8_t     segment( T x ) const;
 };
 
 
@@ -50,8 +59,12 @@ protected:
 typedef AP_Curve<int16_t,3> AP_CurveInt16_Size3;
 typedef AP_Curve<int16_t,4> AP_CurveInt16_Size4;
 typedef AP_Curve<int16_t,5> AP_CurveInt16_Size5;
+typedef AP_Curve<int16_t,8> AP_CurveInt16_Size8;
+typedef AP_Curve<int16_t,16> AP_CurveInt16_Size16;
 typedef AP_Curve<uint16_t,3> AP_CurveUInt16_Size3;
 typedef AP_Curve<uint16_t,4> AP_CurveUInt16_Size4;
 typedef AP_Curve<uint16_t,5> AP_CurveUInt16_Size5;
+typedef AP_Curve<uint16_t,8> AP_CurveUInt16_Size8;
+typedef AP_Curve<uint16_t,16> AP_CurveUInt16_Size16;
 
 #endif  // __AP_CURVE_H__
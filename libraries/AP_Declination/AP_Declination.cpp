@@ -16,6 +16,7 @@
 
 #include <AP_Common.h>
 #include <AP_Progmem.h>
+#include <AP_HAL.h>
 #include <AP_Math.h>
 #include <AP_Declination.h>
 #include <AP_Progmem.h>
@@ -107,10 +108,33 @@ static const row_value declination_values[] PROGMEM = \
 
 #define PGM_UINT8(p) pgm_read_byte_far(p)
 
+// where there is RAM to spare the whole grid is decoded on the first
+// lookup, so that a position in any cell costs the same
+#ifndef AP_DECLINATION_DECODED_GRID
+# if CONFIG_HAL_BOARD == HAL_BOARD_PX4 || CONFIG_HAL_BOARD == HAL_BOARD_AVR_SITL
+#  define AP_DECLINATION_DECODED_GRID 1
+# else
+#  define AP_DECLINATION_DECODED_GRID 0
+# endif
+#endif
+
+#if AP_DECLINATION_DECODED_GRID
+// 37 * 73 * 2 = 5402 bytes
+static int16_t decoded_grid[37][73];
+static bool decoded_grid_valid;
+#endif
+
+uint8_t AP_Declination::_cell_lat_index = 255;
+uint8_t AP_Declination::_cell_lon_index = 255;
+int16_t AP_Declination::_cell_sw;
+int16_t AP_Declination::_cell_se;
+int16_t AP_Declination::_cell_nw;
+int16_t AP_Declination::_cell_ne;
+
 float
 AP_Declination::get_declination(float lat, float lon)
 {
-    int16_t decSW, decSE, decNW, decNE, lonmin, latmin;
+    int16_t lonmin, latmin;
     uint8_t latmin_index,lonmin_index;
     float decmin, decmax;
 
@@ -118,23 +142,49 @@ AP_Declination::get_declination(float lat, float lon)
     lat = constrain_float(lat, -90, 90);
     lon = constrain_float(lon, -180, 180);
 
+    // the north and east edges belong to the cells below them, as
+    // there are no cells beyond them
     latmin = floorf(lat/5)*5;
     lonmin = floorf(lon/5)*5;
+    if (latmin > 85) latmin = 85;
+    if (lonmin > 175) lonmin = 175;
 
     latmin_index= (90+latmin)/5;
     lonmin_index= (180+lonmin)/5;
 
-    decSW = get_lookup_value(latmin_index, lonmin_index);
-    decSE = get_lookup_value(latmin_index, lonmin_index+1);
-    decNE = get_lookup_value(latmin_index+1, lonmin_index+1);
-    decNW = get_lookup_value(latmin_index+1, lonmin_index);
+    if (latmin_index != _cell_lat_index || lonmin_index != _cell_lon_index) {
+        _cell_sw = get_grid_value(latmin_index, lonmin_index);
+        _cell_se = get_grid_value(latmin_index, lonmin_index+1);
+        _cell_ne = get_grid_value(latmin_index+1, lonmin_index+1);
+        _cell_nw = get_grid_value(latmin_index+1, lonmin_index);
+        _cell_lat_index = latmin_index;
+        _cell_lon_index = lonmin_index;
+    }
 
     /* approximate declination within the grid using bilinear interpolation */
-    decmin = (lon - lonmin) / 5 * (decSE - decSW) + decSW;
-    decmax = (lon - lonmin) / 5 * (decNE - decNW) + decNW;
+    decmin = (lon - lonmin) / 5 * (_cell_se - _cell_sw) + _cell_sw;
+    decmax = (lon - lonmin) / 5 * (_cell_ne - _cell_nw) + _cell_nw;
     return (lat - latmin) / 5 * (decmax - decmin) + decmin;
 }
 
+int16_t
+AP_Declination::get_grid_value(uint8_t x, uint8_t y)
+{
+#if AP_DECLINATION_DECODED_GRID
+    if (!decoded_grid_valid) {
+        for (uint8_t i=0; i<37; i++) {
+            for (uint8_t j=0; j<73; j++) {
+                decoded_grid[i][j] = get_lookup_value(i, j);
+            }
+        }
+        decoded_grid_valid = true;
+    }
+    return decoded_grid[x][y];
+#else
+    return get_lookup_value(x, y);
+#endif
+}
+
 int16_t
 AP_Declination::get_lookup_value(uint8_t x, uint8_t y)
 {
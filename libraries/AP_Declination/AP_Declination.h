@@ -18,6 +18,13 @@ public:
     static float            get_declination(float lat, float lon);
 private:
     static int16_t          get_lookup_value(uint8_t x, uint8_t y);
+    static int16_t          get_grid_value(uint8_t x, uint8_t y);
+
+    // the corners of the last 5 degree cell, so that lookups near the
+    // same position don't decode the tables again
+    static uint8_t          _cell_lat_index;
+    static uint8_t          _cell_lon_index;
+    static int16_t          _cell_sw, _cell_se, _cell_nw, _cell_ne;
 };
 
 #endif // AP_Declination_h
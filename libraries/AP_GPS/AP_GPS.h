@@ -12,5 +12,6 @@
 #include "AP_GPS_None.h"
 #include "AP_GPS_Auto.h"
 #include "AP_GPS_HIL.h"
+#include "AP_GPS_Blend.h"
 
 
@@ -15,11 +15,35 @@ static const uint32_t baudrates[] PROGMEM = {38400U, 57600U, 9600U, 4800U};
 const prog_char AP_GPS_Auto::_mtk_set_binary[]   PROGMEM = MTK_SET_BINARY;
 const prog_char AP_GPS_Auto::_sirf_set_binary[]  PROGMEM = SIRF_SET_BINARY;
 
+const AP_Param::GroupInfo AP_GPS_Auto::var_info[] PROGMEM = {
+    // @Param: BAUD
+    // @DisplayName: GPS baud rate
+    // @Description: The baud rate the GPS was last detected at, which is tried first at startup. It is set when the GPS is detected, and 0 means it is not known.
+    // @Values: 0:Unknown,4800:4800,9600:9600,38400:38400,57600:57600
+    // @User: Advanced
+    AP_GROUPINFO("BAUD",     0, AP_GPS_Auto, _last_baudrate, 0),
+
+    // @Param: PROTOCOL
+    // @DisplayName: GPS protocol
+    // @Description: The protocol the GPS was last detected with. It is set when the GPS is detected. An NMEA GPS is only detected after 5 seconds of data, in case it is a binary GPS which booted in NMEA mode, unless it was an NMEA GPS last time.
+    // @Values: 0:Unknown,1:uBlox,2:MTK,3:MTK19,4:SIRF,5:NMEA
+    // @User: Advanced
+    AP_GROUPINFO("PROTOCOL", 1, AP_GPS_Auto, _last_protocol, PROTOCOL_UNKNOWN),
+
+    AP_GROUPEND
+};
+
+AP_GPS_Auto *AP_GPS_Auto::_detecting;
+AP_GPS_Auto *AP_GPS_Auto::_waiting;
 
 AP_GPS_Auto::AP_GPS_Auto(GPS **gps)  :
 	GPS(),
-    _gps(gps)
+    _gps(gps),
+    _last_baud_change_ms(0),
+    _detect_started_ms(0),
+    _last_baud(-1)
 {
+    AP_Param::setup_object_defaults(this, var_info);
 }
 
 // Do nothing at init time - it may be too early to try detecting the GPS
@@ -40,22 +64,37 @@ AP_GPS_Auto::init(AP_HAL::UARTDriver *s, enum GPS_Engine_Setting nav_setting)
 bool
 AP_GPS_Auto::read(void)
 {
-	static uint32_t last_baud_change_ms;
-	static uint8_t last_baud;
 	GPS *gps;
 	uint32_t now = hal.scheduler->millis();
 
-	if (now - last_baud_change_ms > 1200) {
+	if (_detecting == NULL) {
+		_detecting = this;
+	}
+	if (_detecting != this) {
+		// the other port has the detectors. What arrives here until
+		// our turn would only be stale
+		_waiting = this;
+		while (_port->available() > 0) {
+			_port->read();
+		}
+		return false;
+	}
+
+	if (now - _last_baud_change_ms > 1200) {
+		if (_waiting != NULL && _last_baud_change_ms != 0) {
+			// give the other port a turn, and start a new baud rate
+			// when we get it back
+			_detecting = _waiting;
+			_waiting = NULL;
+			_last_baud_change_ms = 0;
+			return false;
+		}
 		// its been more than 1.2 seconds without detection on this
 		// GPS - switch to another baud rate
-		_baudrate = pgm_read_dword(&baudrates[last_baud]);
+		_baudrate = _next_baudrate();
 		//hal.console->printf_P(PSTR("Setting GPS baudrate %u\n"), (unsigned)_baudrate);
-		_port->begin(_baudrate, 256, 16);		
-		last_baud++;
-		last_baud_change_ms = now;
-		if (last_baud == sizeof(baudrates) / sizeof(baudrates[0])) {
-			last_baud = 0;
-		}
+		_port->begin(_baudrate, 256, GPS_PORT_TX_BUFFER_SIZE);
+		_last_baud_change_ms = now;
 		// write config strings for the types of GPS we support
 		_send_progstr(_port, _mtk_set_binary, sizeof(_mtk_set_binary));
 		_send_progstr(_port, AP_GPS_UBLOX::_ublox_set_binary, AP_GPS_UBLOX::_ublox_set_binary_size);
@@ -69,22 +108,51 @@ AP_GPS_Auto::read(void)
 		gps->init(_port, _nav_setting);
 		hal.console->println_P(PSTR("OK"));
 		*_gps = gps;
+		_detecting = NULL;
+		if (_last_baudrate != (int32_t)_baudrate) {
+			_last_baudrate.set_and_save(_baudrate);
+		}
 		return true;
     }
     return false;
 }
 
+//
+// Pick the next baud rate to try, starting with the one the GPS was
+// last detected at, then going round the list
+//
+uint32_t
+AP_GPS_Auto::_next_baudrate(void)
+{
+	const uint8_t num_bauds = sizeof(baudrates) / sizeof(baudrates[0]);
+
+	if (_last_baud == -1) {
+		_last_baud = 0;
+		for (uint8_t i=0; i<num_bauds; i++) {
+			if (_last_baudrate == (int32_t)pgm_read_dword(&baudrates[i])) {
+				return _last_baudrate;
+			}
+		}
+	}
+	uint32_t baudrate = pgm_read_dword(&baudrates[_last_baud]);
+	_last_baud++;
+	if (_last_baud == num_bauds) {
+		_last_baud = 0;
+	}
+	return baudrate;
+}
+
 //
 // Perform one iteration of the auto-detection process.
 //
 GPS *
 AP_GPS_Auto::_detect(void)
 {
-	static uint32_t detect_started_ms;
 	GPS *new_gps = NULL;
+	uint8_t protocol = PROTOCOL_UNKNOWN;
 
-	if (detect_started_ms == 0 && _port->available() > 0) {
-		detect_started_ms = hal.scheduler->millis();
+	if (_detect_started_ms == 0 && _port->available() > 0) {
+		_detect_started_ms = hal.scheduler->millis();
 	}
 
 	while (_port->available() > 0 && new_gps == NULL) {
@@ -99,27 +167,34 @@ AP_GPS_Auto::_detect(void)
 		if (_baudrate >= 38400 && AP_GPS_UBLOX::_detect(data)) {
 			hal.console->print_P(PSTR(" ublox "));
 			new_gps = new AP_GPS_UBLOX();
+			protocol = PROTOCOL_UBLOX;
 		} 
 		else if (AP_GPS_MTK19::_detect(data)) {
 			hal.console->print_P(PSTR(" MTK19 "));
 			new_gps = new AP_GPS_MTK19();
+			protocol = PROTOCOL_MTK19;
 		} 
 		else if (AP_GPS_MTK::_detect(data)) {
 			hal.console->print_P(PSTR(" MTK "));
 			new_gps = new AP_GPS_MTK();
+			protocol = PROTOCOL_MTK;
 		}
 #if !defined( __AVR_ATmega1280__ )
 		// save a bit of code space on a 1280
 		else if (AP_GPS_SIRF::_detect(data)) {
 			hal.console->print_P(PSTR(" SIRF "));
 			new_gps = new AP_GPS_SIRF();
+			protocol = PROTOCOL_SIRF;
 		}
-		else if (hal.scheduler->millis() - detect_started_ms > 5000) {
+		else if (_last_protocol == PROTOCOL_NMEA ||
+				 hal.scheduler->millis() - _detect_started_ms > 5000) {
 			// prevent false detection of NMEA mode in
-			// a MTK or UBLOX which has booted in NMEA mode
+			// a MTK or UBLOX which has booted in NMEA mode,
+			// unless it was an NMEA GPS last time
 			if (AP_GPS_NMEA::_detect(data)) {
 				hal.console->print_P(PSTR(" NMEA "));
 				new_gps = new AP_GPS_NMEA();
+				protocol = PROTOCOL_NMEA;
 			}
 		}
 #endif
@@ -127,6 +202,9 @@ AP_GPS_Auto::_detect(void)
 
 	if (new_gps != NULL) {
 		new_gps->init(_port);
+		if (_last_protocol != protocol) {
+			_last_protocol.set_and_save(protocol);
+		}
 	}
 
 	return new_gps;
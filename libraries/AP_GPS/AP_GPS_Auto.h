@@ -7,6 +7,7 @@
 #define __AP_GPS_AUTO_H__
 
 #include <AP_HAL.h>
+#include <AP_Param.h>
 #include "GPS.h"
 
 class AP_GPS_Auto : public GPS
@@ -31,15 +32,49 @@ public:
     ///
     virtual bool        read(void);
 
+    /// the protocols that can be detected, as remembered in the
+    /// PROTOCOL parameter
+    enum Detected_Protocol {
+        PROTOCOL_UNKNOWN = 0,
+        PROTOCOL_UBLOX,
+        PROTOCOL_MTK,
+        PROTOCOL_MTK19,
+        PROTOCOL_SIRF,
+        PROTOCOL_NMEA
+    };
+
+    static const struct AP_Param::GroupInfo var_info[];
+
 private:
     /// global GPS driver pointer, updated by auto-detection
     ///
     GPS **     _gps;
 
+    /// the detectors of the drivers keep their state in statics, so
+    /// with two GPS ports only one of them is detected on at a time.
+    /// They take turns at each change of baud rate until one is found
+    ///
+    static AP_GPS_Auto *            _detecting;
+    static AP_GPS_Auto *            _waiting;
+
+    uint32_t                        _last_baud_change_ms;
+    uint32_t                        _detect_started_ms;
+    int8_t                          _last_baud;
+
     /// low-level auto-detect routine
     ///
     GPS *                           _detect(void);
 
+    /// the baud rate to try after _baudrate
+    ///
+    uint32_t                        _next_baudrate(void);
+
+    /// the baud rate and protocol the GPS was last detected with,
+    /// which are tried first after a reboot
+    ///
+    AP_Int32                        _last_baudrate;
+    AP_Int8                         _last_protocol;
+
     static const prog_char          _mtk_set_binary[];
     static const prog_char          _sirf_set_binary[];
 };
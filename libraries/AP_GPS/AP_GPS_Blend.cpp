@@ -0,0 +1,233 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_GPS_Blend.cpp
+/// @brief	Blending of the fixes of two GPS receivers.
+
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <AP_Math.h>
+#include "AP_GPS_Blend.h"
+
+extern const AP_HAL::HAL& hal;
+
+// the time constants in seconds of the offset of each receiver from
+// the blend, while both are used, and of its decay once one is left
+#define GPS_BLEND_OFFSET_TC 2.0f
+#define GPS_BLEND_DECAY_TC  10.0f
+
+// the hdop below which a receiver gets no more weight, in cm as
+// reported. Less is usually optimism
+#define GPS_BLEND_MIN_HDOP 50
+
+AP_GPS_Blend::AP_GPS_Blend(GPS **gps1, GPS **gps2) :
+    GPS(),
+    _source(),
+    _used(0),
+    _source_changes(0),
+    _last_blend_us(0),
+    _lag(1.0f)
+{
+    _source[0].gps = gps1;
+    _source[1].gps = gps2;
+    for (uint8_t i=0; i<2; i++) {
+        _source[i].interval_ms = 1000;
+        _source[i].lag = 1.0f;
+    }
+    _have_raw_velocity = true;
+}
+
+void
+AP_GPS_Blend::init(AP_HAL::UARTDriver *s, enum GPS_Engine_Setting nav_setting)
+{
+    _port = s;
+    _nav_setting = nav_setting;
+}
+
+bool
+AP_GPS_Blend::read(void)
+{
+    uint32_t now = hal.scheduler->millis();
+    bool new_message = false;
+    uint8_t new_fix = 0;
+
+    for (uint8_t i=0; i<2; i++) {
+        struct source &s = _source[i];
+        GPS *gps = *s.gps;
+        if (gps == NULL) {
+            continue;
+        }
+        gps->update();
+        if (gps->fix_sequence() == s.seq) {
+            continue;
+        }
+        uint32_t last_fix_ms = s.fix.fix_time_ms;
+        s.seq = gps->get_fix(s.fix);
+        s.lag = gps->get_lag();
+        new_message = true;
+        if (s.fix.fix_time_ms != last_fix_ms) {
+            if (last_fix_ms != 0) {
+                s.interval_ms = constrain_int32(s.fix.fix_time_ms - last_fix_ms, 50, 1000);
+            }
+            new_fix |= 1U << i;
+        }
+    }
+
+    // use the receivers with the best fix that haven't missed two
+    // fixes in a row
+    uint8_t best = NO_FIX;
+    uint8_t fresh = 0;
+    for (uint8_t i=0; i<2; i++) {
+        const struct source &s = _source[i];
+        if (s.fix.status >= GPS_OK_FIX_2D &&
+            now - s.fix.fix_time_ms <= 2 * (uint32_t)s.interval_ms) {
+            fresh |= 1U << i;
+            if (s.fix.status > best) {
+                best = s.fix.status;
+            }
+        }
+    }
+    uint8_t usable = 0;
+    for (uint8_t i=0; i<2; i++) {
+        if ((fresh & (1U << i)) && _source[i].fix.status == best) {
+            usable |= 1U << i;
+        }
+    }
+
+    if (usable == 0) {
+        if (!new_message) {
+            return false;
+        }
+        // receiving, but without a fix
+        fix = FIX_NONE;
+        num_sats = max(_source[0].fix.num_sats, _source[1].fix.num_sats);
+        hdop = min(_source[0].fix.hdop, _source[1].fix.hdop);
+        _used = 0;
+        return true;
+    }
+
+    if ((new_fix & usable) == 0) {
+        return false;
+    }
+
+    if (usable != _used && _used != 0) {
+        _source_changes++;
+    }
+    _used = usable;
+    fix = (best == GPS_OK_FIX_3D) ? FIX_3D : FIX_2D;
+    _blend(usable);
+    return true;
+}
+
+void
+AP_GPS_Blend::_blend(uint8_t usable)
+{
+    // the time each receiver measured its fix, and the newest of them
+    uint32_t measured_us[2];
+    uint8_t ref = 0xFF;
+    for (uint8_t i=0; i<2; i++) {
+        const struct source &s = _source[i];
+        measured_us[i] = s.fix.sample_time_us - (uint32_t)(s.lag * 1.0e6f);
+        if ((usable & (1U << i)) &&
+            (ref == 0xFF || (int32_t)(measured_us[i] - measured_us[ref]) > 0)) {
+            ref = i;
+        }
+    }
+    const struct Fix &r = _source[ref].fix;
+
+    // the fix is stamped with the time it is made, now, so everything
+    // is moved on to the time now less the lag of the newest
+    uint32_t target_us = hal.scheduler->micros() - (uint32_t)(_source[ref].lag * 1.0e6f);
+
+    struct Position loc;
+    loc.lat = r.latitude;
+    loc.lng = r.longitude;
+    loc.alt = r.altitude_cm;
+    float lng_scale = longitude_scale(&loc);
+    float m_to_latlon = 1.0f / LATLON_TO_M;
+
+    float total_weight = 0;
+    for (uint8_t i=0; i<2; i++) {
+        struct source &s = _source[i];
+        s.weight = 0;
+        if (usable & (1U << i)) {
+            // the variance of a fix goes with the square of the hdop,
+            // and down with the satellites it was made from
+            float h = max(s.fix.hdop, GPS_BLEND_MIN_HDOP) * 0.01f;
+            s.weight = max(s.fix.num_sats, 1) / (h * h);
+            total_weight += s.weight;
+        }
+    }
+
+    // the position of each receiver from the newest, moved to the
+    // target time
+    float north[2] = { 0, 0 }, east[2] = { 0, 0 }, alt[2] = { 0, 0 };
+    float raw_north = 0, raw_east = 0, raw_alt = 0;
+    float out_north = 0, out_east = 0, out_alt = 0;
+    Vector3f velocity;
+    for (uint8_t i=0; i<2; i++) {
+        struct source &s = _source[i];
+        if (s.weight == 0) {
+            continue;
+        }
+        s.weight /= total_weight;
+        float dt = constrain_float((int32_t)(target_us - measured_us[i]) * 1.0e-6f, 0, 1);
+        north[i] = (s.fix.latitude - r.latitude) * LATLON_TO_M + s.fix.velocity.x * dt;
+        east[i]  = (s.fix.longitude - r.longitude) * LATLON_TO_M * lng_scale + s.fix.velocity.y * dt;
+        alt[i]   = (s.fix.altitude_cm - r.altitude_cm) - s.fix.velocity.z * 100 * dt;
+
+        raw_north += s.weight * north[i];
+        raw_east  += s.weight * east[i];
+        raw_alt   += s.weight * alt[i];
+        out_north += s.weight * (north[i] + s.ofs_north);
+        out_east  += s.weight * (east[i] + s.ofs_east);
+        out_alt   += s.weight * (alt[i] + s.ofs_alt);
+        velocity  += s.fix.velocity * s.weight;
+    }
+
+    // move the offsets towards where the blend is from each receiver.
+    // With one receiver that is nowhere, so its offset decays
+    float dt = constrain_float((int32_t)(target_us - _last_blend_us) * 1.0e-6f, 0, 1);
+    float tc = (usable == 3) ? GPS_BLEND_OFFSET_TC : GPS_BLEND_DECAY_TC;
+    float alpha = dt / (tc + dt);
+    for (uint8_t i=0; i<2; i++) {
+        struct source &s = _source[i];
+        if (s.weight == 0) {
+            continue;
+        }
+        s.ofs_north += alpha * ((raw_north - north[i]) - s.ofs_north);
+        s.ofs_east  += alpha * ((raw_east - east[i]) - s.ofs_east);
+        s.ofs_alt   += alpha * ((raw_alt - alt[i]) - s.ofs_alt);
+    }
+    _last_blend_us = target_us;
+
+    // the offset is added as an integer, as a float sum would lose
+    // the last metre of the position
+    GPS *gps = *_source[ref].gps;
+    time             = r.time;
+    date             = gps->date;
+    _epoch           = gps->epoch();
+    latitude         = r.latitude + (int32_t)(out_north * m_to_latlon);
+    longitude        = r.longitude + (int32_t)(out_east * m_to_latlon / lng_scale);
+    altitude_cm      = r.altitude_cm + (int32_t)out_alt;
+    _vel_north       = velocity.x * 100;
+    _vel_east        = velocity.y * 100;
+    _vel_down        = velocity.z * 100;
+    ground_speed_cm  = pythagorous2(velocity.x, velocity.y) * 100;
+    ground_course_cd = wrap_360_cd(degrees(atan2f(velocity.y, velocity.x)) * 100);
+    speed_3d_cm      = velocity.length() * 100;
+    hdop             = min(_source[0].weight > 0 ? _source[0].fix.hdop : 9999,
+                           _source[1].weight > 0 ? _source[1].fix.hdop : 9999);
+    num_sats         = max(_source[0].fix.num_sats, _source[1].fix.num_sats);
+    _lag             = _source[ref].lag;
+}
+
+void
+AP_GPS_Blend::inject_data(const uint8_t *data, uint16_t len)
+{
+    for (uint8_t i=0; i<2; i++) {
+        GPS *gps = *_source[i].gps;
+        if (gps != NULL) {
+            gps->inject_data(data, len);
+        }
+    }
+}
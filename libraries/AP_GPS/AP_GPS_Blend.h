@@ -0,0 +1,72 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_GPS_Blend.h
+/// @brief	Two GPS receivers presented as one.
+
+#ifndef __AP_GPS_BLEND_H__
+#define __AP_GPS_BLEND_H__
+
+#include <AP_HAL.h>
+#include "GPS.h"
+
+/*
+  the fixes of two receivers, blended into one. Each time either has a
+  new fix, the latest of both are moved along their velocities to the
+  time of the blend less the lag of the newer one, and averaged
+  with weights from their hdop and satellite count. Only the receivers
+  with the best fix status are used, and a receiver whose fixes stop
+  is dropped once it has missed two, so the output moves to the other
+  one on the next fix.
+
+  The receivers don't agree exactly, so each keeps a slowly filtered
+  offset from the blend, which is added to its position. When one is
+  dropped the other carries on from where the blend was, and its
+  offset then decays, rather than the position jumping.
+ */
+class AP_GPS_Blend : public GPS
+{
+public:
+    /// @param	gps1, gps2	the pointers to the two receivers, as
+    ///						updated by AP_GPS_Auto when they are detected
+    ///
+    AP_GPS_Blend(GPS **gps1, GPS **gps2);
+
+    /// The receivers are initialised on their own ports before this
+    virtual void        init(AP_HAL::UARTDriver *s, enum GPS_Engine_Setting nav_setting = GPS_ENGINE_NONE);
+
+    /// Update both receivers, and blend any new fix
+    virtual bool        read(void);
+
+    /// the lag of the receiver the fix was moved to the time of
+    virtual float       get_lag() { return _lag; }
+
+    /// Injected data goes to both receivers
+    virtual void        inject_data(const uint8_t *data, uint16_t len);
+
+    /// the weight of each receiver in the last fix, 0 if it wasn't used
+    float               weight(uint8_t i) const { return _source[i].weight; }
+
+    /// the number of times the receivers used has changed
+    uint16_t            source_changes(void) const { return _source_changes; }
+
+private:
+    struct source {
+        GPS **gps;
+        struct Fix fix;
+        uint16_t seq;
+        uint16_t interval_ms;           // between its last two fixes
+        float lag;
+        float weight;
+        float ofs_north, ofs_east;      // offset from the blend in m
+        float ofs_alt;                  // and cm
+    } _source[2];
+
+    uint8_t _used;                      // bitmask of the receivers in the last fix
+    uint16_t _source_changes;
+    uint32_t _last_blend_us;
+    float _lag;
+
+    void _blend(uint8_t usable);
+};
+
+#endif // __AP_GPS_BLEND_H__
@@ -9,6 +9,7 @@
 //	version 2.1 of the License, or (at your option) any later version.
 //
 #include <stdint.h>
+#include <string.h>
 
 #include <AP_HAL.h>
 
@@ -49,155 +50,152 @@ AP_GPS_UBLOX::init(AP_HAL::UARTDriver *s, enum GPS_Engine_Setting nav_setting)
     _configure_gps();
 
     _nav_setting = nav_setting;
-	_step = 0;
+	_rx_count = 0;
+	_skip_count = 0;
+	_pvt_mode = false;
 	_new_position = false;
 	_new_speed = false;
 }
 
 // Process bytes available from the stream
 //
-// The stream is assumed to contain only messages we recognise.  If it
-// contains other messages, and those messages contain the preamble
-// bytes, it is possible for this code to fail to synchronise to the
-// stream immediately.  Without buffering the entire message and
-// re-processing it from the top, this is unavoidable. The parser
-// attempts to avoid this when possible.
+// The bytes are collected into _rxbuf, and whole frames are taken off
+// the front of it. Without a frame structure to sync to, a false
+// preamble inside another message costs us one byte of rescanning
+// rather than the rest of the stream
 //
 bool
 AP_GPS_UBLOX::read(void)
 {
-    uint8_t data;
-    int16_t numc;
     bool parsed = false;
+    int16_t numc = _port->available();
+
+    while (numc > 0) {
+        // drop the rest of a frame we can't hold
+        while (_skip_count > 0 && numc > 0) {
+            _port->read();
+            _skip_count--;
+            numc--;
+        }
 
-    numc = _port->available();
-    for (int16_t i = 0; i < numc; i++) {        // Process bytes received
+        // top up the buffer
+        while (numc > 0 && _rx_count < sizeof(_rxbuf)) {
+            _rxbuf[_rx_count++] = _port->read();
+            numc--;
+        }
 
-        // read the next byte
-        data = _port->read();
+        if (_parse_frames()) {
+            parsed = true;
+        }
+    }
+    return parsed;
+}
 
-	reset:
-        switch(_step) {
+// Private Methods /////////////////////////////////////////////////////////////
 
-        // Message preamble detection
-        //
-        // If we fail to match any of the expected bytes, we reset
-        // the state machine and re-consider the failed byte as
-        // the first byte of the preamble.  This improves our
-        // chances of recovering from a mismatch and makes it less
-        // likely that we will be fooled by the preamble appearing
-        // as data in some other message.
-        //
-        case 1:
-            if (PREAMBLE2 == data) {
-                _step++;
-                break;
-            }
-            _step = 0;
-            Debug("reset %u", __LINE__);
-        // FALLTHROUGH
-        case 0:
-            if(PREAMBLE1 == data)
-                _step++;
-            break;
+/*
+  parse the whole frames at the front of the receive buffer, and keep
+  any partial frame for next time. Returns true if a new fix was
+  completed. A full buffer always holds a whole frame, or the start of
+  one to skip, so this always makes room
+ */
+bool
+AP_GPS_UBLOX::_parse_frames(void)
+{
+    bool parsed = false;
+    uint8_t start = 0;
 
-        // Message header processing
-        //
-        // We sniff the class and message ID to decide whether we
-        // are going to gather the message bytes or just discard
-        // them.
-        //
-        // We always collect the length so that we can avoid being
-        // fooled by preamble bytes in messages.
-        //
-        case 2:
-            _step++;
-            _class = data;
-            _ck_b = _ck_a = data;                               // reset the checksum accumulators
+    while (start < _rx_count) {
+        // find the next preamble
+        const uint8_t *p = (const uint8_t *)memchr(&_rxbuf[start], PREAMBLE1, _rx_count - start);
+        if (p == NULL) {
+            start = _rx_count;
             break;
-        case 3:
-            _step++;
-            _ck_b += (_ck_a += data);                   // checksum byte
-            _msg_id = data;
-            break;
-        case 4:
-            _step++;
-            _ck_b += (_ck_a += data);                   // checksum byte
-            _payload_length = data;                             // payload length low byte
+        }
+        start = p - _rxbuf;
+        uint8_t avail = _rx_count - start;
+        if (avail < 2) {
             break;
-        case 5:
-            _step++;
-            _ck_b += (_ck_a += data);                   // checksum byte
-
-            _payload_length += (uint16_t)(data<<8);
-            if (_payload_length > 512) {
-                Debug("large payload %u", (unsigned)_payload_length);
-                // assume very large payloads are line noise
-                _payload_length = 0;
-                _step = 0;
-				goto reset;
-            }
-            _payload_counter = 0;                               // prepare to receive payload
+        }
+        if (_rxbuf[start+1] != PREAMBLE2) {
+            start++;
+            continue;
+        }
+        if (avail < sizeof(struct ubx_header)) {
             break;
+        }
 
-        // Receive message data
-        //
-        case 6:
-            _ck_b += (_ck_a += data);                   // checksum byte
-            if (_payload_counter < sizeof(_buffer)) {
-                _buffer.bytes[_payload_counter] = data;
-            }
-            if (++_payload_counter == _payload_length)
-                _step++;
+        uint16_t payload_length = _rxbuf[start+4] | ((uint16_t)_rxbuf[start+5] << 8);
+        if (payload_length > 512) {
+            // assume very large payloads are line noise
+            Debug("large payload %u", (unsigned)payload_length);
+            start++;
+            continue;
+        }
+        uint16_t frame_length = sizeof(struct ubx_header) + payload_length + 2;
+        if (frame_length > sizeof(_rxbuf)) {
+            // none of the messages we parse are this big
+            Debug("skipping 0x%02x 0x%02x", (unsigned)_rxbuf[start+2], (unsigned)_rxbuf[start+3]);
+            _skip_count = frame_length - avail;
+            start = _rx_count;
             break;
-
-        // Checksum and message processing
-        //
-        case 7:
-            _step++;
-            if (_ck_a != data) {
-                Debug("bad cka %x should be %x", data, _ck_a);
-                _step = 0;
-				goto reset;
-            }
+        }
+        if (avail < frame_length) {
             break;
-        case 8:
-            _step = 0;
-            if (_ck_b != data) {
-                Debug("bad ckb %x should be %x", data, _ck_b);
-                break;                                                  // bad checksum
-            }
+        }
 
-            if (_parse_gps()) {
-                parsed = true;
-            }
+        // the checksum covers the class, id, length and payload
+        uint8_t ck_a = 0, ck_b = 0;
+        _update_checksum(&_rxbuf[start+2], frame_length-4, ck_a, ck_b);
+        if (ck_a != _rxbuf[start+frame_length-2] ||
+            ck_b != _rxbuf[start+frame_length-1]) {
+            Debug("bad checksum %x %x", ck_a, ck_b);
+            start++;
+            continue;
         }
+
+        _class = _rxbuf[start+2];
+        _msg_id = _rxbuf[start+3];
+        if (_parse_gps(&_rxbuf[start+sizeof(struct ubx_header)], payload_length)) {
+            parsed = true;
+        }
+        start += frame_length;
+    }
+
+    if (start > 0) {
+        _rx_count -= start;
+        memmove(_rxbuf, &_rxbuf[start], _rx_count);
     }
     return parsed;
 }
 
-// Private Methods /////////////////////////////////////////////////////////////
-
 bool
-AP_GPS_UBLOX::_parse_gps(void)
+AP_GPS_UBLOX::_parse_gps(const uint8_t *payload, uint16_t length)
 {
+    // the structures are packed, so the payload needs no alignment
+    const union ubx_payload *msg = (const union ubx_payload *)payload;
+
     if (_class == CLASS_ACK) {
         Debug("ACK %u", (unsigned)_msg_id);
         return false;
     }
 
     if (_class == CLASS_CFG && _msg_id == MSG_CFG_NAV_SETTINGS) {
-		Debug("Got engine settings %u\n", (unsigned)_buffer.nav_settings.dynModel);
+        if (length < sizeof(msg->nav_settings)) {
+            return false;
+        }
+		Debug("Got engine settings %u\n", (unsigned)msg->nav_settings.dynModel);
         if (_nav_setting != GPS_ENGINE_NONE &&
-            _buffer.nav_settings.dynModel != _nav_setting) {
+            msg->nav_settings.dynModel != _nav_setting) {
             // we've received the current nav settings, change the engine
             // settings and send them back
             Debug("Changing engine setting from %u to %u\n",
-                  (unsigned)_buffer.nav_settings.dynModel, (unsigned)_nav_setting);
-            _buffer.nav_settings.dynModel = _nav_setting;
+                  (unsigned)msg->nav_settings.dynModel, (unsigned)_nav_setting);
+            struct ubx_cfg_nav_settings nav_settings = msg->nav_settings;
+            nav_settings.dynModel = _nav_setting;
             _send_message(CLASS_CFG, MSG_CFG_NAV_SETTINGS,
-                          &_buffer.nav_settings,
-                          sizeof(_buffer.nav_settings));
+                          &nav_settings,
+                          sizeof(nav_settings));
         }
         return false;
     }
@@ -215,24 +213,35 @@ AP_GPS_UBLOX::_parse_gps(void)
         return false;
     }
 
+    if (_pvt_mode && _msg_id != MSG_PVT) {
+        // left over from before we switched to NAV-PVT
+        return false;
+    }
+
     switch (_msg_id) {
     case MSG_POSLLH:
+        if (length < sizeof(msg->posllh)) {
+            return false;
+        }
         Debug("MSG_POSLLH next_fix=%u", next_fix);
-        time            = _buffer.posllh.time;
-        longitude       = _buffer.posllh.longitude;
-        latitude        = _buffer.posllh.latitude;
-        altitude_cm     = _buffer.posllh.altitude_msl / 10;
+        time            = msg->posllh.time;
+        longitude       = msg->posllh.longitude;
+        latitude        = msg->posllh.latitude;
+        altitude_cm     = msg->posllh.altitude_msl / 10;
         fix             = next_fix;
         _new_position = true;
         break;
     case MSG_STATUS:
+        if (length < sizeof(msg->status)) {
+            return false;
+        }
         Debug("MSG_STATUS fix_status=%u fix_type=%u",
-              _buffer.status.fix_status,
-              _buffer.status.fix_type);
-        if (_buffer.status.fix_status & NAV_STATUS_FIX_VALID) {
-            if( _buffer.status.fix_type == AP_GPS_UBLOX::FIX_3D) {
+              msg->status.fix_status,
+              msg->status.fix_type);
+        if (msg->status.fix_status & NAV_STATUS_FIX_VALID) {
+            if( msg->status.fix_type == AP_GPS_UBLOX::FIX_3D) {
                 next_fix = GPS::FIX_3D;
-            }else if (_buffer.status.fix_type == AP_GPS_UBLOX::FIX_2D) {
+            }else if (msg->status.fix_type == AP_GPS_UBLOX::FIX_2D) {
                 next_fix = GPS::FIX_2D;
             }else{
                 next_fix = GPS::FIX_NONE;
@@ -244,13 +253,16 @@ AP_GPS_UBLOX::_parse_gps(void)
         }
         break;
     case MSG_SOL:
+        if (length < sizeof(msg->solution)) {
+            return false;
+        }
         Debug("MSG_SOL fix_status=%u fix_type=%u",
-              _buffer.solution.fix_status,
-              _buffer.solution.fix_type);
-        if (_buffer.solution.fix_status & NAV_STATUS_FIX_VALID) {
-            if( _buffer.solution.fix_type == AP_GPS_UBLOX::FIX_3D) {
+              msg->solution.fix_status,
+              msg->solution.fix_type);
+        if (msg->solution.fix_status & NAV_STATUS_FIX_VALID) {
+            if( msg->solution.fix_type == AP_GPS_UBLOX::FIX_3D) {
                 next_fix = GPS::FIX_3D;
-            }else if (_buffer.solution.fix_type == AP_GPS_UBLOX::FIX_2D) {
+            }else if (msg->solution.fix_type == AP_GPS_UBLOX::FIX_2D) {
                 next_fix = GPS::FIX_2D;
             }else{
                 next_fix = GPS::FIX_NONE;
@@ -260,18 +272,56 @@ AP_GPS_UBLOX::_parse_gps(void)
             next_fix = GPS::FIX_NONE;
             fix = GPS::FIX_NONE;
         }
-        num_sats        = _buffer.solution.satellites;
-        hdop            = _buffer.solution.position_DOP;
+        num_sats        = msg->solution.satellites;
+        hdop            = msg->solution.position_DOP;
         break;
     case MSG_VELNED:
+        if (length < sizeof(msg->velned)) {
+            return false;
+        }
         Debug("MSG_VELNED");
-        speed_3d_cm     = _buffer.velned.speed_3d;                              // cm/s
-        ground_speed_cm = _buffer.velned.speed_2d;                         // cm/s
-        ground_course_cd = _buffer.velned.heading_2d / 1000;       // Heading 2D deg * 100000 rescaled to deg * 100
+        speed_3d_cm     = msg->velned.speed_3d;                              // cm/s
+        ground_speed_cm = msg->velned.speed_2d;                         // cm/s
+        ground_course_cd = msg->velned.heading_2d / 1000;       // Heading 2D deg * 100000 rescaled to deg * 100
         _have_raw_velocity = true;
-        _vel_north  = _buffer.velned.ned_north;
-        _vel_east   = _buffer.velned.ned_east;
-        _vel_down   = _buffer.velned.ned_down;
+        _vel_north  = msg->velned.ned_north;
+        _vel_east   = msg->velned.ned_east;
+        _vel_down   = msg->velned.ned_down;
+        _new_speed = true;
+        break;
+    case MSG_PVT:
+        if (length < sizeof(msg->pvt)) {
+            return false;
+        }
+        Debug("MSG_PVT fix_type=%u", msg->pvt.fix_type);
+        if (!_pvt_mode) {
+            _configure_pvt();
+        }
+        time            = msg->pvt.time;
+        longitude       = msg->pvt.longitude;
+        latitude        = msg->pvt.latitude;
+        altitude_cm     = msg->pvt.altitude_msl / 10;
+        if (!(msg->pvt.flags & NAV_STATUS_FIX_VALID)) {
+            fix = GPS::FIX_NONE;
+        } else if (msg->pvt.fix_type == AP_GPS_UBLOX::FIX_3D) {
+            fix = GPS::FIX_3D;
+        } else if (msg->pvt.fix_type == AP_GPS_UBLOX::FIX_2D) {
+            fix = GPS::FIX_2D;
+        } else {
+            fix = GPS::FIX_NONE;
+        }
+        next_fix        = fix;
+        num_sats        = msg->pvt.satellites;
+        hdop            = msg->pvt.position_DOP;
+        // NAV-PVT velocities are in mm/s
+        ground_speed_cm = msg->pvt.speed_2d / 10;
+        ground_course_cd = msg->pvt.heading_2d / 1000;
+        _have_raw_velocity = true;
+        _vel_north  = msg->pvt.ned_north / 10;
+        _vel_east   = msg->pvt.ned_east / 10;
+        _vel_down   = msg->pvt.ned_down / 10;
+        speed_3d_cm = pythagorous2(ground_speed_cm, _vel_down);
+        _new_position = true;
         _new_speed = true;
         break;
     default:
@@ -289,7 +339,7 @@ AP_GPS_UBLOX::_parse_gps(void)
         _new_speed = _new_position = false;
 		_fix_count++;
 		if (_fix_count == 100) {
-			// ask for nav settings every 20 seconds
+			// ask for nav settings every 100 fixes
 			Debug("Asking for engine setting\n");
 			_send_message(CLASS_CFG, MSG_CFG_NAV_SETTINGS, NULL, 0);
 		}
@@ -305,7 +355,7 @@ AP_GPS_UBLOX::_parse_gps(void)
  *  update checksum for a set of bytes
  */
 void
-AP_GPS_UBLOX::_update_checksum(uint8_t *data, uint8_t len, uint8_t &ck_a, uint8_t &ck_b)
+AP_GPS_UBLOX::_update_checksum(const uint8_t *data, uint16_t len, uint8_t &ck_a, uint8_t &ck_b)
 {
     while (len--) {
         ck_a += *data;
@@ -379,11 +429,13 @@ AP_GPS_UBLOX::_configure_gps(void)
     msg.timeref         = 0;     // UTC time
     _send_message(CLASS_CFG, MSG_CFG_RATE, &msg, sizeof(msg));
 
-    // ask for the messages we parse to be sent on every navigation solution
+    // ask for the messages we parse to be sent on every navigation
+    // solution. Receivers before the u-blox 7 reject NAV-PVT
     _configure_message_rate(CLASS_NAV, MSG_POSLLH, 1);
     _configure_message_rate(CLASS_NAV, MSG_STATUS, 1);
     _configure_message_rate(CLASS_NAV, MSG_SOL, 1);
     _configure_message_rate(CLASS_NAV, MSG_VELNED, 1);
+    _configure_message_rate(CLASS_NAV, MSG_PVT, 1);
 
     // ask for the current navigation settings
 	Debug("Asking for engine setting\n");
@@ -391,6 +443,29 @@ AP_GPS_UBLOX::_configure_gps(void)
 }
 
 
+/*
+ *  the receiver sends NAV-PVT, so turn off the separate messages it
+ *  replaces and speed up the fixes
+ */
+void
+AP_GPS_UBLOX::_configure_pvt(void)
+{
+    struct ubx_cfg_nav_rate msg;
+
+    Debug("Switching to NAV-PVT\n");
+    _pvt_mode = true;
+    _configure_message_rate(CLASS_NAV, MSG_POSLLH, 0);
+    _configure_message_rate(CLASS_NAV, MSG_STATUS, 0);
+    _configure_message_rate(CLASS_NAV, MSG_SOL, 0);
+    _configure_message_rate(CLASS_NAV, MSG_VELNED, 0);
+
+    msg.measure_rate_ms = UBLOX_PVT_MEASURE_RATE_MS;
+    msg.nav_rate        = 1;
+    msg.timeref         = 0;     // UTC time
+    _send_message(CLASS_CFG, MSG_CFG_RATE, &msg, sizeof(msg));
+}
+
+
 /*
   detect a Ublox GPS. Adds one byte, and returns true if the stream
   matches a UBlox
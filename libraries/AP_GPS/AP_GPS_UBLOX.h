@@ -30,16 +30,24 @@
  */
 #define UBLOX_SET_BINARY "\265\142\006\001\003\000\001\006\001\022\117$PUBX,41,1,0003,0001,38400,0*26\r\n"
 
+// receive buffer size. This must hold the largest whole frame we
+// parse, the 100 byte u-blox 8 NAV-PVT. Bigger frames are skipped
+#define UBLOX_RX_BUFFER_SIZE 100
+
+// measurement period once the receiver has shown it sends NAV-PVT,
+// which carries a whole fix in one message
+#define UBLOX_PVT_MEASURE_RATE_MS 100
+
 class AP_GPS_UBLOX : public GPS
 {
 public:
 	AP_GPS_UBLOX() :
 		GPS(),
-		_step(0),
+		_rx_count(0),
+		_skip_count(0),
 		_msg_id(0),
-		_payload_length(0),
-		_payload_counter(0),
 		_fix_count(0),
+		_pvt_mode(false),
 		_disable_counter(0),
 		next_fix(GPS::FIX_NONE)
 		{}
@@ -140,15 +148,51 @@ private:
         uint32_t speed_accuracy;
         uint32_t heading_accuracy;
     };
-    // Receive buffer
-    union PACKED {
+    // u-blox 7 and later. The u-blox 8 version adds 8 bytes at the end
+    struct PACKED ubx_nav_pvt {
+        uint32_t time;                                  // GPS msToW
+        uint16_t year;
+        uint8_t month, day, hour, min, sec;
+        uint8_t valid;
+        uint32_t time_accuracy;
+        int32_t time_nsec;
+        uint8_t fix_type;
+        uint8_t flags;
+        uint8_t res1;
+        uint8_t satellites;
+        int32_t longitude;
+        int32_t latitude;
+        int32_t altitude_ellipsoid;
+        int32_t altitude_msl;
+        uint32_t horizontal_accuracy;
+        uint32_t vertical_accuracy;
+        int32_t ned_north;                              // mm/s
+        int32_t ned_east;
+        int32_t ned_down;
+        int32_t speed_2d;
+        int32_t heading_2d;
+        uint32_t speed_accuracy;
+        uint32_t heading_accuracy;
+        uint16_t position_DOP;
+        uint16_t res2;
+        uint32_t res3;
+    };
+    // the payloads we parse
+    union PACKED ubx_payload {
         ubx_nav_posllh posllh;
         ubx_nav_status status;
         ubx_nav_solution solution;
         ubx_nav_velned velned;
+        ubx_nav_pvt pvt;
         ubx_cfg_nav_settings nav_settings;
-        uint8_t bytes[];
-    } _buffer;
+    };
+
+    // Receive buffer. Frames are parsed where they lie in it
+    uint8_t         _rxbuf[UBLOX_RX_BUFFER_SIZE];
+    uint8_t         _rx_count;
+
+    // bytes left of a frame too big for the buffer
+    uint16_t        _skip_count;
 
     enum ubs_protocol_bytes {
         PREAMBLE1 = 0xb5,
@@ -161,6 +205,7 @@ private:
         MSG_POSLLH = 0x2,
         MSG_STATUS = 0x3,
         MSG_SOL = 0x6,
+        MSG_PVT = 0x7,
         MSG_VELNED = 0x12,
         MSG_CFG_PRT = 0x00,
         MSG_CFG_RATE = 0x08,
@@ -179,20 +224,16 @@ private:
         NAV_STATUS_FIX_VALID = 1
     };
 
-    // Packet checksum accumulators
-    uint8_t         _ck_a;
-    uint8_t         _ck_b;
-
-    // State machine state
-    uint8_t         _step;
+    // class and id of the frame being parsed
     uint8_t         _msg_id;
-    uint16_t        _payload_length;
-    uint16_t        _payload_counter;
 
 	// 8 bit count of fix messages processed, used for periodic
 	// processing
     uint8_t			_fix_count;
 
+    // has the receiver sent NAV-PVT? We then use it alone
+    bool            _pvt_mode;
+
     uint8_t         _class;
 
     // do we have new position information?
@@ -204,14 +245,16 @@ private:
     uint8_t         _disable_counter;
 
     // Buffer parse & GPS state update
-    bool        _parse_gps();
+    bool        _parse_frames(void);
+    bool        _parse_gps(const uint8_t *payload, uint16_t length);
 
     // used to update fix between status and position packets
     Fix_Status  next_fix;
 
     void        _configure_message_rate(uint8_t msg_class, uint8_t msg_id, uint8_t rate);
     void        _configure_gps(void);
-    void        _update_checksum(uint8_t *data, uint8_t len, uint8_t &ck_a, uint8_t &ck_b);
+    void        _configure_pvt(void);
+    void        _update_checksum(const uint8_t *data, uint16_t len, uint8_t &ck_a, uint8_t &ck_b);
     void        _send_message(uint8_t msg_class, uint8_t msg_id, void *msg, uint8_t size);
 
 };
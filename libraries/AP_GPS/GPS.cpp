@@ -2,6 +2,7 @@
 
 
 
+#include <string.h>
 #include <AP_Common.h>
 #include <AP_Math.h>
 #include <AP_HAL.h>
@@ -27,12 +28,17 @@ GPS::GPS(void) :
 	last_fix_time(0),
 	_have_raw_velocity(false),
 	_idleTimer(0),
+	_last_sample_us(0),
 	_status(GPS::NO_FIX),
 	_last_ground_speed_cm(0),
 	_velocity_north(0),
 	_velocity_east(0),
-	_velocity_down(0)
+	_velocity_down(0),
+	_inject_sent(0),
+	_inject_dropped(0),
+	_fix_seq(0)
 {
+    memset(_fix, 0, sizeof(_fix));
 }
 
 void
@@ -41,6 +47,9 @@ GPS::update(void)
     bool result;
     uint32_t tnow;
 
+    // pass on any injected data
+    _send_injected();
+
     // call the GPS driver to process incoming data
     result = read();
 
@@ -68,6 +77,7 @@ GPS::update(void)
 
         valid_read = true;
         new_data = true;
+        _last_sample_us = hal.scheduler->micros();
 
         // reset the idle timer
         _idleTimer = tnow;
@@ -96,7 +106,82 @@ GPS::update(void)
 				_velocity_down  = 0;
             }
         }
+
+        _publish_fix();
+    }
+}
+
+// stop the compiler moving the copy of a solution across a sequence update
+#define GPS_FIX_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+void
+GPS::_publish_fix(void)
+{
+    uint16_t seq = _fix_seq + 1;
+    struct Fix &f = _fix[seq & 1];
+
+    f.fix_time_ms      = last_fix_time;
+    f.sample_time_us   = _last_sample_us;
+    f.time             = time;
+    f.latitude         = latitude;
+    f.longitude        = longitude;
+    f.altitude_cm      = altitude_cm;
+    f.ground_speed_cm  = ground_speed_cm;
+    f.ground_course_cd = ground_course_cd;
+    f.hdop             = hdop;
+    f.num_sats         = num_sats;
+    f.status           = _status;
+    f.velocity         = Vector3f(velocity_north(), velocity_east(), velocity_down());
+
+    GPS_FIX_BARRIER();
+    _fix_seq = seq;
+}
+
+uint16_t
+GPS::get_fix(struct Fix &fix) const
+{
+    uint16_t seq;
+    do {
+        seq = _fix_seq;
+        GPS_FIX_BARRIER();
+        fix = _fix[seq & 1];
+        GPS_FIX_BARRIER();
+        // a change means the parser may have been writing into what
+        // we copied, so try again
+    } while (seq != _fix_seq);
+    return seq;
+}
+
+void
+GPS::inject_data(const uint8_t *data, uint16_t len)
+{
+    if (_inject_buf.size() == 0 && !_inject_buf.set_size(GPS_INJECT_BUFFER_SIZE)) {
+        _inject_dropped += len;
+        return;
+    }
+    uint16_t n = _inject_buf.write(data, len);
+    _inject_dropped += len - n;
+}
+
+// send as much injected data as the port has room for, without blocking
+void
+GPS::_send_injected(void)
+{
+    uint16_t n;
+    const uint8_t *p = _inject_buf.readable_span(n);
+    if (n == 0 || _port == NULL) {
+        return;
+    }
+    int16_t space = _port->txspace();
+    if (space <= 0) {
+        return;
+    }
+    if (n > (uint16_t)space) {
+        n = space;
     }
+    n = _port->write(p, n);
+    _inject_buf.advance_read(n);
+    _inject_sent += n;
 }
 
 void
@@ -132,36 +217,65 @@ void GPS::_write_progstr_block(AP_HAL::UARTDriver *_fs, const prog_char *pstr, u
 // maximum number of pending progstrings
 #define PROGSTR_QUEUE_SIZE 3
 
+// GPS ports that can have strings pending at once, one per GPS
+#define PROGSTR_PORTS 2
+
 struct progstr_queue {
 	const prog_char *pstr;
 	uint8_t ofs, size;
 };
 
-static struct {
+static struct progstr_port {
     AP_HAL::UARTDriver *fs;
 	uint8_t queue_size;
 	uint8_t idx, next_idx;
 	struct progstr_queue queue[PROGSTR_QUEUE_SIZE];
-} progstr_state;
+} progstr_state[PROGSTR_PORTS];
+
+// the queue of a port, or a free one for it if add is set
+static struct progstr_port *progstr_find(AP_HAL::UARTDriver *fs, bool add)
+{
+	for (uint8_t i=0; i<PROGSTR_PORTS; i++) {
+		if (progstr_state[i].fs == fs) {
+			return &progstr_state[i];
+		}
+	}
+	if (add) {
+		for (uint8_t i=0; i<PROGSTR_PORTS; i++) {
+			if (progstr_state[i].fs == NULL) {
+				progstr_state[i].fs = fs;
+				return &progstr_state[i];
+			}
+		}
+	}
+	return NULL;
+}
 
 void GPS::_send_progstr(AP_HAL::UARTDriver *_fs, const prog_char *pstr, uint8_t size)
 {
-	progstr_state.fs = _fs;
-	struct progstr_queue *q = &progstr_state.queue[progstr_state.next_idx];
+	struct progstr_port *state = progstr_find(_fs, true);
+	if (state == NULL) {
+		return;
+	}
+	struct progstr_queue *q = &state->queue[state->next_idx];
 	q->pstr = pstr;
 	q->size = size;
 	q->ofs = 0;
-	progstr_state.next_idx++;
-	if (progstr_state.next_idx == PROGSTR_QUEUE_SIZE) {
-		progstr_state.next_idx = 0;
+	state->next_idx++;
+	if (state->next_idx == PROGSTR_QUEUE_SIZE) {
+		state->next_idx = 0;
 	}
 }
 
 void GPS::_update_progstr(void)
 {
-	struct progstr_queue *q = &progstr_state.queue[progstr_state.idx];
+	struct progstr_port *state = progstr_find(_port, false);
+	if (state == NULL) {
+		return;
+	}
+	struct progstr_queue *q = &state->queue[state->idx];
 	// quick return if nothing to do
-	if (q->size == 0 || progstr_state.fs->tx_pending()) {
+	if (q->size == 0 || state->fs->tx_pending()) {
 		return;
 	}
 	uint8_t nbytes = q->size - q->ofs;
@@ -169,13 +283,13 @@ void GPS::_update_progstr(void)
 		nbytes = 16;
 	}
 	//hal.console->printf_P(PSTR("writing %u bytes\n"), (unsigned)nbytes);
-	_write_progstr_block(progstr_state.fs, q->pstr+q->ofs, nbytes);
+	_write_progstr_block(state->fs, q->pstr+q->ofs, nbytes);
 	q->ofs += nbytes;
 	if (q->ofs == q->size) {
 		q->size = 0;
-		progstr_state.idx++;
-		if (progstr_state.idx == PROGSTR_QUEUE_SIZE) {
-			progstr_state.idx = 0;
+		state->idx++;
+		if (state->idx == PROGSTR_QUEUE_SIZE) {
+			state->idx = 0;
 		}
 	}
 }
@@ -12,6 +12,17 @@
 #include <AP_Progmem.h>
 #include <AP_Math.h>
 
+// the queue for data injected into the GPS, such as differential
+// corrections, and the transmit buffer to ask for on the GPS port.
+// The AVR boards have little RAM to spare
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+ # define GPS_INJECT_BUFFER_SIZE     128
+ # define GPS_PORT_TX_BUFFER_SIZE    16
+#else
+ # define GPS_INJECT_BUFFER_SIZE     1024
+ # define GPS_PORT_TX_BUFFER_SIZE    128
+#endif
+
 /// @class	GPS
 /// @brief	Abstract base class for GPS receiver drivers.
 class GPS
@@ -157,8 +168,53 @@ public:
 	// the time we last processed a message in milliseconds
 	uint32_t last_message_time_ms(void) { return _idleTimer; }
 
+    // the micros() time the last message was parsed. The receivers
+    // give no time of their own that is on our clock, so this is as
+    // close to the measurement as we can get
+    uint32_t get_last_sample_time_micros(void) const { return _last_sample_us; }
+
 	// return true if the GPS supports raw velocity values
+	bool have_raw_velocity(void) const { return _have_raw_velocity; }
+
+    /// A whole solution, as it was when the driver finished a message
+    struct Fix {
+        uint32_t fix_time_ms;           ///< system time of the last fix, as last_fix_time
+        uint32_t sample_time_us;        ///< micros() time the message was parsed
+        uint32_t time;                  ///< GPS time
+        int32_t latitude;               ///< degrees * 10,000,000
+        int32_t longitude;
+        int32_t altitude_cm;
+        uint32_t ground_speed_cm;
+        int32_t ground_course_cd;
+        int16_t hdop;
+        uint8_t num_sats;
+        GPS_Status status;
+        Vector3f velocity;              ///< NED in m/s, as velocity_north() etc
+    };
 
+    /// Copy the latest solution in one piece. The public fields above
+    /// are updated one at a time as a message is parsed, so they can be
+    /// seen half changed; this copy can't
+    ///
+    /// @returns            the sequence number of the solution, which
+    ///                     goes up by one with each message. A consumer
+    ///                     can keep it to tell whether the next is new
+    ///
+    uint16_t get_fix(struct Fix &fix) const;
+
+    /// sequence number of the latest solution
+    uint16_t fix_sequence(void) const { return _fix_seq; }
+
+    /// Queue data to be sent to the GPS unchanged, such as RTCM
+    /// differential corrections. The queue is allocated on first use,
+    /// and drained into the GPS port by ::update as the port has room.
+    /// Bytes that don't fit in the queue are dropped
+    ///
+    virtual void inject_data(const uint8_t *data, uint16_t len);
+
+    // injected bytes sent to the GPS, and dropped because the queue was full
+    uint32_t inject_bytes_sent(void) const { return _inject_sent; }
+    uint32_t inject_bytes_dropped(void) const { return _inject_dropped; }
 
 protected:
     AP_HAL::UARTDriver *_port;   ///< port the GPS is attached to
@@ -224,6 +280,7 @@ private:
     /// Last time that the GPS driver got a good packet from the GPS
     ///
     uint32_t _idleTimer;
+    uint32_t _last_sample_us;
 
     /// Our current status
     GPS_Status _status;
@@ -235,6 +292,24 @@ private:
     float _velocity_north;
     float _velocity_east;
     float _velocity_down;
+
+    // data waiting to be injected into the GPS
+    RingBuffer<uint8_t> _inject_buf;
+    uint32_t _inject_sent;
+    uint32_t _inject_dropped;
+
+    void _send_injected(void);
+
+    /*
+      the solution is published into the buffer that readers are not
+      told about, and then the sequence number is bumped to point them
+      at it. A reader checks the number didn't change while it copied,
+      so the parser can run in another thread without a lock
+     */
+    struct Fix _fix[2];
+    volatile uint16_t _fix_seq;
+
+    void _publish_fix(void);
 };
 
 #endif // __GPS_H__
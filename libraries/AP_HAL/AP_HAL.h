@@ -26,6 +26,8 @@
 #include "utility/Print.h"
 #include "utility/Stream.h"
 #include "utility/BetterStream.h"
+#include "utility/RingBuffer.h"
+#include "utility/Topic.h"
 
 /* HAL Class definition */
 #include "HAL.h"
@@ -11,6 +11,25 @@
  #define WARN_IF_UNUSED
 #endif
 
+/*
+  mark a function which runs every loop. On PX4 it is optimised
+  harder and grouped with the other hot functions in .text.hot, so they
+  share the flash accelerator's cache, and if the NuttX build copies
+  .ramfunc into SRAM it runs from there with no flash wait states. The
+  STM32F4 CCM RAM is on the data bus only, so it can't hold code. Other
+  boards ignore it
+ */
+#if defined(__GNUC__) && CONFIG_HAL_BOARD == HAL_BOARD_PX4
+ #include <nuttx/config.h>
+ #ifdef CONFIG_ARCH_RAMFUNCS
+  #define HOT_FUNC __attribute__ ((hot, section(".ramfunc")))
+ #else
+  #define HOT_FUNC __attribute__ ((hot))
+ #endif
+#else
+ #define HOT_FUNC
+#endif
+
 // use this to avoid issues between C++11 with NuttX and C++10 on
 // other platforms.
 #if !(defined(__GXX_EXPERIMENTAL_CXX0X__) || __cplusplus >= 201103L)
@@ -13,6 +13,7 @@ namespace AP_HAL {
 
     class SPIDeviceDriver;
     class SPIDeviceManager;
+    struct SPISegment;
 
     class AnalogSource;
     class AnalogIn;
@@ -36,6 +37,9 @@ namespace AP_HAL {
     typedef void(*Proc)(void);
     typedef void(*TimedProc)(uint32_t);
 
+    /* Completion callback for batched SPI transfers */
+    typedef void(*SPICompletionProc)(void *);
+
     /**
      * Global names for all of the existing SPI devices on all platforms.
      */
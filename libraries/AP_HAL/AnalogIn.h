@@ -31,6 +31,18 @@ public:
     // return a voltage from 0.0 to 5.0V, assuming a ratiometric
     // sensor
     virtual float voltage_average_ratiometric() = 0;
+
+    // set the rate in Hz samples are made at. Each sample is the
+    // average of the conversions made since the last one, and while a
+    // rate is set read_average() and the voltages give the latest
+    // sample rather than the average since they were last called. 0
+    // goes back to averaging since the last call
+    virtual void set_sample_rate(uint16_t rate_hz) = 0;
+
+    // true once for each sample made at the sample rate, with the
+    // system time in milliseconds it was completed. Without a rate set
+    // each conversion is a sample
+    virtual bool sample_ready(uint32_t &time_ms) = 0;
 };
 
 class AP_HAL::AnalogIn {
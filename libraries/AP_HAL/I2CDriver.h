@@ -5,9 +5,17 @@
 #include <stdint.h>
 
 #include "AP_HAL_Namespace.h"
+#include "Semaphores.h"
 
 class AP_HAL::I2CDriver {
 public:
+    /* the status of a queued transfer */
+    enum transfer_status {
+        TRANSFER_PENDING = 0,
+        TRANSFER_DONE,
+        TRANSFER_FAILED
+    };
+
     virtual void begin() = 0;
     virtual void end() = 0;
     virtual void setTimeout(uint16_t ms) = 0;
@@ -31,6 +39,32 @@ public:
     virtual uint8_t readRegisters(uint8_t addr, uint8_t reg,
                                   uint8_t len, uint8_t* data) = 0;
 
+    /* queued transfers, which return at once and are done in the
+     * background where the driver can. Take the bus semaphore before
+     * queueing: it is given back when the queue has finished. *status
+     * is TRANSFER_PENDING until the transfer has finished, and data
+     * must stay valid until then. Returns false, with the semaphore
+     * still taken, if the transfer couldn't be queued.
+     * The defaults do the transfer at once. */
+    virtual bool queueReadRegisters(uint8_t addr, uint8_t reg,
+                                    uint8_t len, uint8_t* data,
+                                    volatile uint8_t* status) {
+        *status = readRegisters(addr, reg, len, data) == 0 ?
+            TRANSFER_DONE : TRANSFER_FAILED;
+        get_semaphore()->give();
+        return true;
+    }
+    virtual bool queueWrite(uint8_t addr, uint8_t len, uint8_t* data,
+                            volatile uint8_t* status) {
+        *status = write(addr, len, data) == 0 ?
+            TRANSFER_DONE : TRANSFER_FAILED;
+        get_semaphore()->give();
+        return true;
+    }
+    /* poll: call while waiting for a queued transfer, to catch a bus
+     * lockup */
+    virtual void poll() {}
+
     virtual uint8_t lockup_count() = 0;
     virtual AP_HAL::Semaphore* get_semaphore() = 0;
 };
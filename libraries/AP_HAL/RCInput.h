@@ -31,6 +31,14 @@ public:
     /* Read an array of channels, return the valid count */
     virtual uint8_t read(uint16_t* periods, uint8_t len) = 0;
 
+    /**
+     * Return the time in microseconds, on the scheduler's micros()
+     * clock, at which the last complete frame was received. A new value
+     * means a new frame. 0 if no frame has been received, or if the
+     * implementation doesn't record it
+     */
+    virtual uint32_t last_frame_time_us() { return 0; }
+
     /**
      * Overrides: these are really grody and don't belong here but we need
      * them at the moment to make the port work.
@@ -41,6 +41,22 @@ public:
     virtual void     write(uint8_t ch, uint16_t period_us) = 0;
     virtual void     write(uint8_t ch, uint16_t* period_us, uint8_t len) = 0;
 
+    /* Hold back the writes that follow until push(), so a batch of
+     * channels such as all the motors of a frame changes together.
+     * Without cork() each write goes out as soon as the board can. */
+    virtual void     cork(void) {}
+
+    /* Send the writes held since cork() now, from the calling thread,
+     * rather than at the board's next output tick. */
+    virtual void     push(void) {}
+
+    /* Switch the channels in chmask to OneShot125: the pulse is 1/8 of
+     * the period_us written, and push() starts a new pulse at once
+     * instead of at the end of the current PWM period. A zero mask goes
+     * back to normal PWM. Returns false if the board can't do it, in
+     * which case the channels stay normal PWM. */
+    virtual bool     set_oneshot(uint32_t chmask) { return false; }
+
     /* Read back current output state, as either single channel or
      * array of channels. */
     virtual uint16_t read(uint8_t ch) = 0;
@@ -11,6 +11,16 @@ public:
     virtual AP_HAL::SPIDeviceDriver* device(enum AP_HAL::SPIDevice) = 0;
 };
 
+/**
+ * One part of a batched SPI transfer. tx may be NULL to clock out
+ * zeros, and rx may be NULL to discard the bytes read.
+ */
+struct AP_HAL::SPISegment {
+    const uint8_t *tx;
+    uint8_t *rx;
+    uint16_t len;
+};
+
 /**
  * We still need an abstraction for performing bulk
  * transfers to be portable to other platforms.
@@ -26,6 +36,35 @@ public:
     virtual void cs_release() = 0;
     virtual uint8_t transfer (uint8_t data) = 0;
     virtual void transfer (const uint8_t *data, uint16_t len) = 0;
+
+    /**
+     * Run a list of segments with chip select held across all of
+     * them, then call completion(arg) if it is not NULL. Returns
+     * false if the batch could not be started.
+     *
+     * With a completion callback a driver may finish the batch
+     * asynchronously, so the segment buffers must stay valid until
+     * the callback runs. With no callback it always returns with the
+     * batch complete. This default runs it synchronously a byte at a
+     * time.
+     */
+    virtual bool transfer_segments(const AP_HAL::SPISegment *segs, uint8_t nsegs,
+                                   AP_HAL::SPICompletionProc completion, void *arg) {
+        cs_assert();
+        for (uint8_t s = 0; s < nsegs; s++) {
+            for (uint16_t i = 0; i < segs[s].len; i++) {
+                uint8_t b = transfer(segs[s].tx ? segs[s].tx[i] : 0);
+                if (segs[s].rx != NULL) {
+                    segs[s].rx[i] = b;
+                }
+            }
+        }
+        cs_release();
+        if (completion != NULL) {
+            completion(arg);
+        }
+        return true;
+    }
 };
 
 #endif // __AP_HAL_SPI_DRIVER_H__
@@ -9,6 +9,66 @@
 
 class AP_HAL::Scheduler {
 public:
+    // execution time and period jitter of a timer process, in
+    // microseconds. The jitter is the difference between the time
+    // from one start of the process to the next and the timer tick
+    struct TimerProcStats {
+        AP_HAL::TimedProc proc;
+        uint32_t count;
+        uint32_t time_total;
+        uint16_t time_max;
+        uint16_t jitter_max;
+        uint32_t jitter_total;
+        uint32_t last_start;
+
+        // called by the scheduler after each run of the process
+        void update(uint32_t tstart, uint32_t tend, uint16_t period_us) {
+            uint32_t t = tend - tstart;
+            if (count != 0) {
+                uint32_t period = tstart - last_start;
+                uint32_t err = period > period_us ? period - period_us : period_us - period;
+                if (err > 0xFFFF) {
+                    err = 0xFFFF;
+                }
+                if (err > jitter_max) {
+                    jitter_max = err;
+                }
+                jitter_total += err;
+            }
+            if (t > 0xFFFF) {
+                t = 0xFFFF;
+            }
+            if (t > time_max) {
+                time_max = t;
+            }
+            time_total += t;
+            last_start = tstart;
+            count++;
+        }
+    };
+
+    // a timer process which only needs to run every period_us
+    struct SlowProc {
+        AP_HAL::TimedProc proc;
+        uint16_t period_us;
+        uint32_t last_run;
+    };
+
+    // run the first process which is due, looking from procs[next]
+    // round the n of them, so that a tick runs at most one and each
+    // gets its turn. Called by the boards that support slow processes
+    static void run_slow_procs(SlowProc *procs, uint8_t n, uint8_t &next, uint32_t tnow) {
+        for (uint8_t j = 0; j < n; j++) {
+            uint8_t i = next;
+            next = (i + 1 < n) ? i + 1 : 0;
+            if (tnow - procs[i].last_run >= procs[i].period_us) {
+                procs[i].last_run = tnow;
+                procs[i].proc(tnow);
+                return;
+            }
+        }
+    }
+
     Scheduler() {}
     virtual void     init(void* implspecific) = 0;
     virtual void     delay(uint16_t ms) = 0;
@@ -24,6 +84,34 @@ public:
     // register a low priority IO task
     virtual void     register_io_process(AP_HAL::TimedProc) = 0;
 
+    // register a timer task which only needs to run every period_us,
+    // such as a slow sensor. Boards run these after the timer tasks,
+    // one per tick at most, or on a lower priority thread, so they
+    // don't delay the fast sensors. Boards without support run it as
+    // a timer task, so it must still check the time itself
+    virtual void     register_slow_process(AP_HAL::TimedProc proc,
+                        uint16_t period_us) { register_timer_process(proc); }
+
+    // queue a procedure to run on a lower priority worker thread.
+    // *busy is cleared by the worker once the procedure has
+    // completed. Returns false if the board has no worker thread or
+    // its queue is full, in which case the caller should run the
+    // procedure itself. Must only be called from the main thread
+    virtual bool     queue_worker_proc(AP_HAL::Proc,
+                        volatile bool *busy) { return false; }
+
+    // wake the main thread from wait_for_signal(), from a timer process
+    // or interrupt. Drivers call this when they have new data the main
+    // loop waits for, such as an IMU sample
+    virtual void     signal_main() {}
+
+    // sleep the main thread until signal_main() is called, or for at
+    // most timeout_us. Returns true if it was signalled, which may have
+    // been before the call, so callers should check what they are
+    // waiting for again. Boards which can't sleep return false
+    // straight away, and the caller polls as before
+    virtual bool     wait_for_signal(uint16_t timeout_us) { return false; }
+
     // suspend and resume both timer and IO processes
     virtual void     suspend_timer_procs() = 0;
     virtual void     resume_timer_procs() = 0;
@@ -33,6 +121,19 @@ public:
     virtual void     register_timer_failsafe(AP_HAL::TimedProc,
                         uint32_t period_us) = 0;
 
+    // copy the stats of the i'th registered timer process since the
+    // last clear_timer_stats(). Returns false past the last process,
+    // or if the board keeps no stats
+    virtual bool     timer_proc_stats(uint8_t i,
+                        TimerProcStats &stats) { return false; }
+
+    // the number of timer ticks which came more than a tick late, or
+    // were dropped because the timer processes of the last tick were
+    // still running
+    virtual uint32_t timer_late_ticks() { return 0; }
+
+    virtual void     clear_timer_stats() {}
+
     virtual bool     system_initializing() = 0;
     virtual void     system_initialized() = 0;
 
@@ -17,6 +17,10 @@ public:
     virtual void write_word(uint16_t loc, uint16_t value) = 0;
     virtual void write_dword(uint16_t loc, uint32_t value) = 0;
     virtual void write_block(uint16_t dst, const void* src, size_t n) = 0;
+
+    /* the bytes that can be written without waiting for the storage,
+     * for callers that would rather wait than block */
+    virtual uint16_t write_space() { return 0xFFFF; }
 };
 
 #endif // __AP_HAL_STORAGE_H__
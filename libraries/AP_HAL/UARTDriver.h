@@ -38,6 +38,27 @@ public:
     virtual bool is_initialized() = 0;
     virtual void set_blocking_writes(bool blocking) = 0;
     virtual bool tx_pending() = 0;
+
+    /// Optional notification of received data
+    ///
+    /// Asks the port to call proc once at least min_bytes are waiting
+    /// to be read, or once the line has been idle for idle_us after
+    /// some bytes arrived, which usually marks the end of a frame.
+    ///
+    /// @note	proc runs in the driver's timer or IO context, not the
+    ///			main thread. It must be short and must not read the port;
+    ///			it should only set a flag for the code doing the parsing.
+    ///
+    /// @param	proc		Called when data is ready. NULL stops the calls.
+    /// @param	min_bytes	Bytes waiting that trigger the call.
+    /// @param	idle_us		Quiet time after the last byte that triggers the
+    ///						call. Ports that check once a millisecond round
+    ///						this up to the next millisecond.
+    ///
+    /// @return	false if the port has no notification support, in which
+    ///			case callers must keep polling available().
+    ///
+    virtual bool set_rx_notify(AP_HAL::Proc proc, uint16_t min_bytes, uint32_t idle_us) { return false; }
 };
 
 #endif // __AP_HAL_UART_DRIVER_H__
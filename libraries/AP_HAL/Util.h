@@ -25,6 +25,18 @@ public:
     // commands
     virtual bool run_debug_shell(AP_HAL::BetterStream *stream) = 0;
 
+    // the stack of a thread the HAL runs, in bytes. free is the part
+    // of the stack which has never been used
+    struct ThreadStack {
+        const char *name;
+        uint16_t size;
+        uint16_t free;
+    };
+
+    // get the stack of the i'th HAL thread. Returns false past the
+    // last thread, or on boards which can't measure their stacks
+    virtual bool thread_stack(uint8_t i, ThreadStack &stack) { return false; }
+
 };
 
 #endif // __AP_HAL_UTIL_H__
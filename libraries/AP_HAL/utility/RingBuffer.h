@@ -0,0 +1,217 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#ifndef __AP_HAL_UTILITY_RINGBUFFER_H__
+#define __AP_HAL_UTILITY_RINGBUFFER_H__
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+  A single producer, single consumer ring buffer.
+
+  One thread (or interrupt handler) may write while another reads
+  without any locking. The read index is only ever written by the
+  consumer and the write index only by the producer. The indices run
+  freely and are masked on use, so the buffer size is always a power
+  of two and the whole buffer can be filled.
+
+  The indices are 16 bit, so this relies on 16 bit loads and stores
+  being atomic. That holds on PX4 and SITL, but not on AVR.
+
+  Besides single element and bulk copies, the contiguous span calls
+  give direct access to the buffer memory so that data can be handed
+  to read()/write() system calls, or filled in place, without an
+  intermediate copy.
+ */
+
+// stop the compiler moving buffer accesses across an index update
+#define RINGBUFFER_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+template <typename T>
+class RingBuffer {
+public:
+    RingBuffer() :
+        _buf(NULL),
+        _mask(0),
+        _head(0),
+        _tail(0)
+    {}
+
+    ~RingBuffer() {
+        delete[] _buf;
+    }
+
+    // allocate the buffer, rounding size up to a power of two (at
+    // most 32768 elements). Does nothing if the rounded size is
+    // unchanged. Must not be called while either side is active
+    bool set_size(uint16_t size) {
+        uint32_t rounded = 1;
+        while (rounded < size) {
+            rounded <<= 1;
+        }
+        if (rounded > 0x8000) {
+            return false;
+        }
+        if (_buf != NULL && rounded == (uint32_t)_mask+1) {
+            return true;
+        }
+        delete[] _buf;
+        _buf = new T[rounded];
+        if (_buf == NULL) {
+            _mask = 0;
+            return false;
+        }
+        _mask = rounded - 1;
+        _head = _tail = 0;
+        return true;
+    }
+
+    // total number of elements the buffer holds, zero if unallocated
+    uint16_t size(void) const {
+        return _buf == NULL ? 0 : _mask + 1;
+    }
+
+    // discard all contents. Must not be called while either side is
+    // active
+    void clear(void) {
+        _head = _tail = 0;
+    }
+
+    // number of elements waiting to be read
+    uint16_t available(void) const {
+        return (uint16_t)(_tail - _head);
+    }
+
+    // number of elements that can be written
+    uint16_t space(void) const {
+        return size() - available();
+    }
+
+    bool empty(void) const {
+        return _head == _tail;
+    }
+
+    /*
+      producer side
+     */
+
+    // add one element, returning false if the buffer is full
+    bool push(const T &item) {
+        if (space() == 0) {
+            return false;
+        }
+        _buf[_tail & _mask] = item;
+        RINGBUFFER_BARRIER();
+        _tail++;
+        return true;
+    }
+
+    // add up to n elements, returning the number added
+    uint16_t write(const T *data, uint16_t n) {
+        uint16_t sp = space();
+        if (n > sp) {
+            n = sp;
+        }
+        uint16_t ofs = _tail & _mask;
+        uint16_t n1 = size() - ofs;
+        if (n1 > n) {
+            n1 = n;
+        }
+        memcpy(&_buf[ofs], data, n1 * sizeof(T));
+        if (n > n1) {
+            memcpy(&_buf[0], data + n1, (n - n1) * sizeof(T));
+        }
+        RINGBUFFER_BARRIER();
+        _tail += n;
+        return n;
+    }
+
+    // return a pointer to the largest contiguous free region, setting
+    // n to its length. Fill it and then call advance_write()
+    T *writable_span(uint16_t &n) {
+        uint16_t ofs = _tail & _mask;
+        n = size() - ofs;
+        uint16_t sp = space();
+        if (n > sp) {
+            n = sp;
+        }
+        return &_buf[ofs];
+    }
+
+    // mark n elements obtained with writable_span() as written
+    void advance_write(uint16_t n) {
+        RINGBUFFER_BARRIER();
+        _tail += n;
+    }
+
+    /*
+      consumer side
+     */
+
+    // remove one element, returning false if the buffer is empty
+    bool pop(T &item) {
+        if (empty()) {
+            return false;
+        }
+        item = _buf[_head & _mask];
+        RINGBUFFER_BARRIER();
+        _head++;
+        return true;
+    }
+
+    // copy up to n elements without removing them, returning the
+    // number copied
+    uint16_t peek(T *data, uint16_t n) const {
+        uint16_t avail = available();
+        if (n > avail) {
+            n = avail;
+        }
+        uint16_t ofs = _head & _mask;
+        uint16_t n1 = size() - ofs;
+        if (n1 > n) {
+            n1 = n;
+        }
+        memcpy(data, &_buf[ofs], n1 * sizeof(T));
+        if (n > n1) {
+            memcpy(data + n1, &_buf[0], (n - n1) * sizeof(T));
+        }
+        return n;
+    }
+
+    // remove up to n elements, returning the number removed
+    uint16_t read(T *data, uint16_t n) {
+        n = peek(data, n);
+        RINGBUFFER_BARRIER();
+        _head += n;
+        return n;
+    }
+
+    // return a pointer to the largest contiguous readable region,
+    // setting n to its length. Call advance_read() once consumed
+    const T *readable_span(uint16_t &n) const {
+        uint16_t ofs = _head & _mask;
+        n = size() - ofs;
+        uint16_t avail = available();
+        if (n > avail) {
+            n = avail;
+        }
+        return &_buf[ofs];
+    }
+
+    // discard n elements, normally after readable_span()
+    void advance_read(uint16_t n) {
+        RINGBUFFER_BARRIER();
+        _head += n;
+    }
+
+private:
+    T *_buf;
+    uint16_t _mask;
+
+    // _head is where the next element is read from, _tail is where
+    // the next element is written to
+    volatile uint16_t _head;
+    volatile uint16_t _tail;
+};
+
+#endif // __AP_HAL_UTILITY_RINGBUFFER_H__
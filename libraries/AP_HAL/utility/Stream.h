@@ -19,6 +19,18 @@ public:
      * -1 if nothing available, uint8_t value otherwise. */
     virtual int16_t read() = 0;
 
+    /* read up to count bytes into buffer, returning the number read.
+     * Drivers holding received bytes in a buffer copy them in bulk */
+    uint16_t read(uint8_t *buffer, uint16_t count) { return read_implementation(buffer, count); }
+    virtual uint16_t read_implementation(uint8_t *buffer, uint16_t count) {
+        uint16_t n = 0;
+        int16_t c;
+        while (n < count && (c = read()) != -1) {
+            buffer[n++] = (uint8_t)c;
+        }
+        return n;
+    }
+
 };
 
 #endif // __AP_HAL_UTILITY_STREAM_H__
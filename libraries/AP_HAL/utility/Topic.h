@@ -0,0 +1,106 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#ifndef __AP_HAL_UTILITY_TOPIC_H__
+#define __AP_HAL_UTILITY_TOPIC_H__
+
+#include <stdint.h>
+
+/*
+  The latest value of something one module produces and others read,
+  such as a sensor sample or an estimate, published without locking.
+
+  There is one publisher per topic, and any number of readers in any
+  thread. The value is double buffered: a publish fills the slot that
+  isn't the latest and then flips to it, so a reader can use the latest
+  slot in place and only has to start again if two publishes overtook
+  it. A sequence count, odd while a publish is under way, tells it
+  whether that happened.
+
+  As with RingBuffer the count is 16 bit, relying on 16 bit loads and
+  stores being atomic, which holds on PX4 and SITL. On AVR everything
+  that touches a topic runs from the main loop, so nothing overlaps.
+  Only a compiler barrier is used, which is enough on the single core
+  PX4 and with x86 keeping stores in order for SITL.
+ */
+
+#define TOPIC_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+template <typename T>
+class Topic {
+public:
+    Topic() :
+        _seq(0)
+    {}
+
+    /*
+      publisher side
+     */
+
+    // the slot to fill in place for the next value. Call end_publish()
+    // once it is complete
+    T &begin_publish(void) {
+        _seq++;
+        TOPIC_BARRIER();
+        return _slot[((_seq >> 1) + 1) & 1];
+    }
+
+    // make the value filled in since begin_publish() the latest
+    void end_publish(void) {
+        TOPIC_BARRIER();
+        _seq++;
+    }
+
+    void publish(const T &value) {
+        begin_publish() = value;
+        end_publish();
+    }
+
+    /*
+      reader side
+     */
+
+    // the number of values published so far, wrapping at 32768
+    uint16_t count(void) const {
+        return _seq >> 1;
+    }
+
+    // true if there have been publishes since count() returned last
+    bool updated(uint16_t last) const {
+        return count() != last;
+    }
+
+    // the latest value, in place. The contents are only known to be
+    // consistent if end_read() with the same seq then returns true
+    const T *begin_read(uint16_t &seq) const {
+        seq = _seq;
+        TOPIC_BARRIER();
+        return &_slot[(seq >> 1) & 1];
+    }
+
+    // true if the value from begin_read() wasn't overwritten while it
+    // was used
+    bool end_read(uint16_t seq) const {
+        TOPIC_BARRIER();
+        return (uint16_t)(_seq - (seq & ~1U)) <= 2;
+    }
+
+    // copy the latest value, returning false if the publisher kept
+    // overtaking the copy
+    bool read(T &value) const {
+        for (uint8_t tries=0; tries<4; tries++) {
+            uint16_t seq;
+            value = *begin_read(seq);
+            if (end_read(seq)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    // twice the number of publishes, plus one while one is under way
+    volatile uint16_t _seq;
+    T _slot[2];
+};
+
+#endif // __AP_HAL_UTILITY_TOPIC_H__
@@ -22,6 +22,8 @@ public:
     float voltage_average_ratiometric();
     void set_stop_pin(uint8_t p);
     void set_settle_time(uint16_t settle_time_ms);    
+    void set_sample_rate(uint16_t rate_hz);
+    bool sample_ready(uint32_t &time_ms);
 
     /* implementation specific interface: */
 
@@ -50,6 +52,18 @@ private:
     volatile uint16_t _latest;
     float _last_average;
 
+    /* the decimating filter, run from the interrupt when a sample rate is
+     * set: conversions are summed until the period is up, then the sum
+     * becomes the sample */
+    uint16_t _sample_period_ms;
+    uint32_t _dec_sum;
+    uint16_t _dec_count;
+    uint32_t _dec_start_ms;
+    volatile uint32_t _sample_sum;
+    volatile uint16_t _sample_count;
+    volatile uint32_t _sample_time_ms;
+    volatile bool _sample_ready;
+
     /* _pin designates the ADC input mux for the sample */
     uint8_t _pin;
 
@@ -17,7 +17,15 @@ ADCSource::ADCSource(uint8_t pin) :
     _last_average(0),
     _pin(ANALOG_INPUT_NONE),
     _stop_pin(ANALOG_INPUT_NONE),
-    _settle_time_ms(0)
+    _settle_time_ms(0),
+    _sample_period_ms(0),
+    _dec_sum(0),
+    _dec_count(0),
+    _dec_start_ms(0),
+    _sample_sum(0),
+    _sample_count(0),
+    _sample_time_ms(0),
+    _sample_ready(false)
 {
     set_pin(pin);
 }
@@ -89,6 +97,10 @@ void ADCSource::set_pin(uint8_t pin) {
         _sum_count = 0;
         _last_average = 0;
         _latest = 0;
+        _dec_sum = 0;
+        _dec_count = 0;
+        _sample_count = 0;
+        _sample_ready = false;
         _pin = pin;
         SREG = sreg;
     }
@@ -103,11 +115,49 @@ void ADCSource::set_settle_time(uint16_t settle_time_ms)
     _settle_time_ms = settle_time_ms;
 }
 
+void ADCSource::set_sample_rate(uint16_t rate_hz)
+{
+    uint8_t sreg = SREG;
+    cli();
+    _sample_period_ms = rate_hz ? 1000 / rate_hz : 0;
+    _dec_sum = 0;
+    _dec_count = 0;
+    _dec_start_ms = hal.scheduler->millis();
+    _sample_ready = false;
+    SREG = sreg;
+}
+
+bool ADCSource::sample_ready(uint32_t &time_ms)
+{
+    if (!_sample_ready) {
+        return false;
+    }
+    uint8_t sreg = SREG;
+    cli();
+    time_ms = _sample_time_ms;
+    _sample_ready = false;
+    SREG = sreg;
+    return true;
+}
+
 /* read_average is called from the normal thread (not an interrupt). */
 float ADCSource::_read_average() {
     uint16_t sum;
     uint8_t sum_count;
 
+    if (_sample_period_ms != 0) {
+        /* the latest sample from the decimating filter */
+        uint8_t sreg = SREG;
+        cli();
+        uint32_t sample_sum = _sample_sum;
+        uint16_t sample_count = _sample_count;
+        SREG = sreg;
+        if (sample_count != 0) {
+            _last_average = sample_sum / (float) sample_count;
+        }
+        return _last_average;
+    }
+
     if (_sum_count == 0) {
         // avoid blocking waiting for new samples
         return _last_average;
@@ -178,5 +228,25 @@ void ADCSource::new_sample(uint16_t sample) {
     } else {
         _sum_count++;
     }
+
+    uint32_t now = hal.scheduler->millis();
+    if (_sample_period_ms == 0) {
+        _sample_time_ms = now;
+        _sample_ready = true;
+        return;
+    }
+    _dec_sum += sample;
+    _dec_count++;
+    if (now - _dec_start_ms >= _sample_period_ms) {
+        /* the division is left to the reader, to keep it out of the
+         * interrupt */
+        _sample_sum = _dec_sum;
+        _sample_count = _dec_count;
+        _sample_time_ms = now;
+        _sample_ready = true;
+        _dec_sum = 0;
+        _dec_count = 0;
+        _dec_start_ms = now;
+    }
 }
 #endif
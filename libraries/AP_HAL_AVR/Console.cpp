@@ -5,8 +5,6 @@
 
 #include <limits.h>
 
-#include "utility/print_vprintf.h"
-
 #include "Console.h"
 using namespace AP_HAL_AVR;
 
@@ -57,11 +55,11 @@ void AVRConsoleDriver::_printf_P(const prog_char *fmt, ...) {
 }
 
 void AVRConsoleDriver::vprintf(const char *fmt, va_list ap){
-    print_vprintf((AP_HAL::Print*)this, 0, fmt, ap); 
+    _base_uart->vprintf(fmt, ap);
 }
 
 void AVRConsoleDriver::vprintf_P(const prog_char *fmt, va_list ap){
-    print_vprintf((AP_HAL::Print*)this, 1, fmt, ap); 
+    _base_uart->vprintf_P(fmt, ap);
 }
 
 // Stream method implementations /////////////////////////////////////////
@@ -97,6 +97,7 @@ void AVRI2CDriver::setHighSpeed(bool active) {
 }
 
 uint8_t AVRI2CDriver::write(uint8_t addr, uint8_t len, uint8_t* data){
+    _wait_idle();
     uint8_t stat = _start();
     if (stat) goto error;
     stat = _sendAddress(SLA_W(addr));
@@ -116,6 +117,7 @@ error:
 
 uint8_t AVRI2CDriver::writeRegisters(uint8_t addr, uint8_t reg,
                                     uint8_t len, uint8_t* data){
+    _wait_idle();
     uint8_t stat = _start();
     if (stat) goto error;
     stat = _sendAddress(SLA_W(addr));
@@ -143,6 +145,7 @@ uint8_t AVRI2CDriver::writeRegister(uint8_t addr, uint8_t reg, uint8_t val) {
 }
 
 uint8_t AVRI2CDriver::read(uint8_t addr, uint8_t len, uint8_t* data){
+    _wait_idle();
     uint8_t stat;
     if ( len == 0)
         len = 1;
@@ -172,6 +175,7 @@ error:
 
 uint8_t AVRI2CDriver::readRegisters(uint8_t addr, uint8_t reg,
                                     uint8_t len, uint8_t* data){
+    _wait_idle();
     uint8_t stat;
     if ( len == 0)
         len = 1;
@@ -256,6 +260,194 @@ uint8_t AVRI2CDriver::_receiveByte(bool ack) {
     return TWI_STATUS;
 }
 
+/*
+ * Queued transfers. The TWI interrupt moves each one along, and starts
+ * the next when it finishes. They are made holding the bus semaphore,
+ * which is given back when the queue empties.
+ */
+bool AVRI2CDriver::queueReadRegisters(uint8_t addr, uint8_t reg,
+                                      uint8_t len, uint8_t* data,
+                                      volatile uint8_t* status) {
+    struct transfer t;
+    t.addr = addr;
+    t.reg = reg;
+    t.len = len == 0 ? 1 : len;
+    t.has_reg = true;
+    t.read = true;
+    t.data = data;
+    t.status = status;
+    return _queue(t);
+}
+
+bool AVRI2CDriver::queueWrite(uint8_t addr, uint8_t len, uint8_t* data,
+                              volatile uint8_t* status) {
+    struct transfer t;
+    t.addr = addr;
+    t.reg = 0;
+    t.len = len;
+    t.has_reg = false;
+    t.read = false;
+    t.data = data;
+    t.status = status;
+    return _queue(t);
+}
+
+bool AVRI2CDriver::_queue(const struct transfer &t) {
+    // catch a lockup of the transfer in progress
+    poll();
+
+    uint8_t sreg = SREG;
+    cli();
+    if (_queue_count == AVRI2CDRIVER_QUEUE_SIZE) {
+        SREG = sreg;
+        return false;
+    }
+    _transfers[(_queue_head + _queue_count) % AVRI2CDRIVER_QUEUE_SIZE] = t;
+    *t.status = TRANSFER_PENDING;
+    if (_queue_count++ == 0) {
+        _begin_transfer();
+        // keep any stop still to be sent, which the start then follows
+        TWCR = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN) | _BV(TWIE) | (TWCR & _BV(TWSTO));
+    }
+    SREG = sreg;
+    return true;
+}
+
+void AVRI2CDriver::_begin_transfer() {
+    const struct transfer &t = _transfers[_queue_head];
+    _index = 0;
+    _reg_sent = false;
+    _reading = t.read && !t.has_reg;
+    _transfer_start_ms = hal.scheduler->millis();
+}
+
+void AVRI2CDriver::_finish_transfer(uint8_t status) {
+    *_transfers[_queue_head].status = status;
+    _queue_head = (_queue_head + 1) % AVRI2CDRIVER_QUEUE_SIZE;
+    _queue_count--;
+    if (_queue_count != 0) {
+        // a stop, then a start for the next transfer
+        _begin_transfer();
+        TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE) | _BV(TWSTO) | _BV(TWSTA);
+    } else {
+        TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+        _sem->give();
+    }
+}
+
+void AVRI2CDriver::poll() {
+    if (_queue_count == 0 || _timeoutDelay == 0) {
+        return;
+    }
+    uint8_t sreg = SREG;
+    cli();
+    if (_queue_count != 0 &&
+        hal.scheduler->millis() - _transfer_start_ms >= _timeoutDelay) {
+        _handleLockup();
+        while (_queue_count != 0) {
+            *_transfers[_queue_head].status = TRANSFER_FAILED;
+            _queue_head = (_queue_head + 1) % AVRI2CDRIVER_QUEUE_SIZE;
+            _queue_count--;
+        }
+        _sem->give();
+    }
+    SREG = sreg;
+}
+
+/* wait for the queue to finish before a blocking transfer. Queued
+ * transfers hold the bus semaphore, so this only waits for users which
+ * don't take it */
+void AVRI2CDriver::_wait_idle() {
+    if (_queue_count == 0 && !(TWCR & _BV(TWSTO))) {
+        return;
+    }
+    while (_queue_count != 0) {
+        poll();
+    }
+    _waitStop();
+}
+
+void AVRI2CDriver::_twi_isr() {
+    if (_queue_count == 0) {
+        // left over from a reset of the bus
+        switch(TWI_STATUS) {
+        case 0x20:
+        case 0x30:
+        case 0x48:
+            TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);  // send a stop
+            break;
+        case 0x38:
+        case 0x68:
+        case 0x78:
+        case 0xB0:
+            TWCR = 0;  //releases SDA and SCL lines to high impedance
+            TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA);  //reinitialize TWI
+            break;
+        }
+        return;
+    }
+
+    const struct transfer &t = _transfers[_queue_head];
+    const uint8_t next = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+
+    switch (TWI_STATUS) {
+    case START:
+    case REPEATED_START:
+        TWDR = _reading ? SLA_R(t.addr) : SLA_W(t.addr);
+        TWCR = next;
+        break;
+
+    case MT_SLA_ACK:
+    case MT_DATA_ACK:
+        if (t.has_reg && !_reg_sent) {
+            TWDR = t.reg;
+            _reg_sent = true;
+            TWCR = next;
+        } else if (t.read) {
+            // a repeated start for the read
+            _reading = true;
+            TWCR = next | _BV(TWSTA);
+        } else if (_index < t.len) {
+            TWDR = t.data[_index++];
+            TWCR = next;
+        } else {
+            _finish_transfer(TRANSFER_DONE);
+        }
+        break;
+
+    case MR_SLA_ACK:
+        // ack every byte but the last
+        TWCR = t.len > 1 ? next | _BV(TWEA) : next;
+        break;
+
+    case MR_DATA_ACK:
+        t.data[_index++] = TWDR;
+        TWCR = _index + 1 < t.len ? next | _BV(TWEA) : next;
+        break;
+
+    case MR_DATA_NACK:
+        t.data[_index++] = TWDR;
+        _finish_transfer(TRANSFER_DONE);
+        break;
+
+    case 0x20:
+    case 0x30:
+    case 0x48:
+        // not acknowledged. The stop is sent on finishing
+        _lockup_count++;
+        _finish_transfer(TRANSFER_FAILED);
+        break;
+
+    default:
+        // lost arbitration, or a bus error
+        TWCR = 0;
+        TWCR = _BV(TWEN) | _BV(TWEA);
+        _lockup_count++;
+        _finish_transfer(TRANSFER_FAILED);
+        break;
+    }
+}
+
 void AVRI2CDriver::_handleLockup() {
     TWCR = 0; /* Releases SDA and SCL lines to high impedance */
     TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA); /* Reinitialize TWI */
@@ -300,20 +492,7 @@ uint8_t AVRI2CDriver::_waitStop() {
 
 SIGNAL(TWI_vect)
 {
-    switch(TWI_STATUS) {
-    case 0x20:
-    case 0x30:
-    case 0x48:
-        TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);  // send a stop
-        break;
-    case 0x38:
-    case 0x68:
-    case 0x78:
-    case 0xB0:
-        TWCR = 0;  //releases SDA and SCL lines to high impedance
-        TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA);  //reinitialize TWI
-        break;
-    }
+    ((AVRI2CDriver *)hal.i2c)->_twi_isr();
 }
 
 #endif
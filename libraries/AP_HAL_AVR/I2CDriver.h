@@ -6,10 +6,14 @@
 #include "AP_HAL_AVR_Namespace.h"
 
 #define AVRI2CDRIVER_MAX_BUFFER_SIZE 32
+#define AVRI2CDRIVER_QUEUE_SIZE 4
 
 class AP_HAL_AVR::AVRI2CDriver : public AP_HAL::I2CDriver {
 public:
-    AVRI2CDriver(AP_HAL::Semaphore *sem) : _sem(sem) {}
+    AVRI2CDriver(AP_HAL::Semaphore *sem) :
+        _queue_head(0),
+        _queue_count(0),
+        _sem(sem) {}
 
     void begin();
     void end();
@@ -24,11 +28,45 @@ public:
     uint8_t readRegister(uint8_t addr, uint8_t reg, uint8_t* data);
     uint8_t readRegisters(uint8_t addr, uint8_t reg,
                           uint8_t len, uint8_t* data);
+    bool queueReadRegisters(uint8_t addr, uint8_t reg,
+                            uint8_t len, uint8_t* data,
+                            volatile uint8_t* status);
+    bool queueWrite(uint8_t addr, uint8_t len, uint8_t* data,
+                    volatile uint8_t* status);
+    void poll();
+
     uint8_t lockup_count() { return _lockup_count; }
 
     AP_HAL::Semaphore* get_semaphore() { return _sem; }
 
+    /* runs the queued transfers. For the TWI interrupt only */
+    void _twi_isr();
+
 private:
+    struct transfer {
+        uint8_t addr;
+        uint8_t reg;
+        uint8_t len;
+        bool has_reg:1;
+        bool read:1;
+        uint8_t *data;
+        volatile uint8_t *status;
+    };
+
+    bool    _queue(const struct transfer &t);
+    void    _begin_transfer();
+    void    _finish_transfer(uint8_t status);
+    void    _wait_idle();
+
+    // the queue, and the progress of the transfer at its head
+    struct transfer _transfers[AVRI2CDRIVER_QUEUE_SIZE];
+    volatile uint8_t _queue_head;
+    volatile uint8_t _queue_count;
+    volatile uint8_t _index;
+    volatile bool _reg_sent;
+    volatile bool _reading;
+    volatile uint32_t _transfer_start_ms;
+
     uint8_t _start();
     uint8_t _stop();
     uint8_t _sendAddress(uint8_t addr);
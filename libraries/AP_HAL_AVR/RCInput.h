@@ -37,6 +37,12 @@ public:
      */
     uint8_t  read(uint16_t* periods, uint8_t len);
 
+    /**
+     * last_frame_time_us():
+     * The micros() time of the end of the last complete PPM frame
+     */
+    uint32_t last_frame_time_us();
+
     /**
      * Overrides: these are really grody and don't belong here but we need
      * them at the moment to make the port work.
@@ -59,6 +65,7 @@ private:
     /* private variables to communicate with input capture isr */
     static volatile uint16_t _pulse_capt[AVR_RC_INPUT_NUM_CHANNELS];
     static volatile uint8_t  _valid_channels;
+    static volatile uint32_t _frame_time_us;
 
     /* override state */
     uint16_t _override[AVR_RC_INPUT_NUM_CHANNELS]; 
@@ -70,6 +77,7 @@ class AP_HAL_AVR::APM2RCInput : public AP_HAL::RCInput {
     uint8_t  valid_channels();
     uint16_t read(uint8_t ch);
     uint8_t  read(uint16_t* periods, uint8_t len);
+    uint32_t last_frame_time_us();
     bool set_overrides(int16_t *overrides, uint8_t len);
     bool set_override(uint8_t channel, int16_t override);
     void clear_overrides();
@@ -79,6 +87,7 @@ private:
     /* private variables to communicate with input capture isr */
     static volatile uint16_t _pulse_capt[AVR_RC_INPUT_NUM_CHANNELS];
     static volatile uint8_t  _valid_channels;
+    static volatile uint32_t _frame_time_us;
 
     /* override state */
     uint16_t _override[AVR_RC_INPUT_NUM_CHANNELS]; 
@@ -16,6 +16,7 @@ extern const HAL& hal;
 /* private variables to communicate with input capture isr */
 volatile uint16_t APM2RCInput::_pulse_capt[AVR_RC_INPUT_NUM_CHANNELS] = {0};  
 volatile uint8_t  APM2RCInput::_valid_channels = 0;
+volatile uint32_t APM2RCInput::_frame_time_us = 0;
 
 /* private callback for input capture ISR */
 void APM2RCInput::_timer5_capt_cb(void) {
@@ -35,6 +36,10 @@ void APM2RCInput::_timer5_capt_cb(void) {
         // sync pulse detected.  Pass through values if at least a minimum number of channels received
         if( channel_ctr >= AVR_RC_INPUT_MIN_CHANNELS ) {
             _valid_channels = channel_ctr;
+            if (channel_ctr < AVR_RC_INPUT_NUM_CHANNELS) {
+                // a short frame ends here, a full one ended on its last pulse
+                _frame_time_us = hal.scheduler->micros();
+            }
         }
         channel_ctr = 0;
     } else {
@@ -43,6 +48,7 @@ void APM2RCInput::_timer5_capt_cb(void) {
             channel_ctr++;
             if (channel_ctr == AVR_RC_INPUT_NUM_CHANNELS) {
                 _valid_channels = AVR_RC_INPUT_NUM_CHANNELS;
+                _frame_time_us = hal.scheduler->micros();
             }
         }
     }
@@ -79,6 +85,13 @@ void APM2RCInput::init(void* _isrregistry) {
 
 uint8_t APM2RCInput::valid_channels() { return _valid_channels; }
 
+uint32_t APM2RCInput::last_frame_time_us() {
+    cli();
+    uint32_t t = _frame_time_us;
+    sei();
+    return t;
+}
+
 /* constrain captured pulse to be between min and max pulsewidth. */
 static inline uint16_t constrain_pulse(uint16_t p) {
     if (p > RC_INPUT_MAX_PULSEWIDTH) return RC_INPUT_MAX_PULSEWIDTH;
@@ -5,6 +5,9 @@
 #include <AP_HAL.h>
 #include "AP_HAL_AVR_Namespace.h"
 
+/* CH_1 to CH_11 */
+#define AVR_RC_OUTPUT_NUM_CHANNELS 11
+
 class AP_HAL_AVR::APM1RCOutput : public AP_HAL::RCOutput {
 public:
     /* No init argument required */
@@ -31,8 +34,18 @@ public:
     uint16_t read(uint8_t ch);
     void     read(uint16_t* period_ms, uint8_t len);
 
+    /* Hold back writes until push(), which latches them together */
+    void     cork(void) { _corked = true; }
+    void     push(void);
+
 private:
     uint16_t _timer_period(uint16_t speed_hz);
+    void     _write_ocr(uint8_t ch, uint16_t pwm);
+
+    /* compare values written while corked, in timer units */
+    uint16_t _pending[AVR_RC_OUTPUT_NUM_CHANNELS];
+    uint16_t _pending_mask;
+    bool     _corked;
 };
 
 class AP_HAL_AVR::APM2RCOutput : public AP_HAL::RCOutput {
@@ -61,8 +74,23 @@ public:
     uint16_t read(uint8_t ch);
     void     read(uint16_t* period_us, uint8_t len);
 
+    /* Hold back writes until push(), which latches them together and
+     * starts the OneShot pulses */
+    void     cork(void) { _corked = true; }
+    void     push(void);
+    bool     set_oneshot(uint32_t chmask);
+
 private:
     uint16_t _timer_period(uint16_t speed_hz);
+    void     _write_ocr(uint8_t ch, uint16_t pwm);
+    uint16_t _read_ocr(uint8_t ch);
+
+    /* compare values written while corked, in timer units */
+    uint16_t _pending[AVR_RC_OUTPUT_NUM_CHANNELS];
+    uint16_t _pending_mask;
+    uint16_t _enabled_mask;
+    uint16_t _oneshot_mask;
+    bool     _corked;
 };
 
 #endif // __AP_HAL_AVR_RC_OUTPUT_H__
@@ -174,6 +174,18 @@ void APM1RCOutput::write(uint8_t ch, uint16_t period_us) {
     /* constrain, then scale from 1us resolution (input units)
      * to 0.5us (timer units) */
     uint16_t pwm = constrain_period(period_us) << 1;
+    if (_corked) {
+        if (ch < AVR_RC_OUTPUT_NUM_CHANNELS) {
+            _pending[ch] = pwm;
+            _pending_mask |= 1U << ch;
+        }
+        return;
+    }
+    _write_ocr(ch, pwm);
+}
+
+/* Set the compare register of a channel, in timer units */
+void APM1RCOutput::_write_ocr(uint8_t ch, uint16_t pwm) {
     switch(ch)
     {
     case 0:  OCR5B=pwm; break;  //ch1
@@ -196,6 +208,25 @@ void APM1RCOutput::write(uint8_t ch, uint16_t* period_us, uint8_t len) {
     }
 }
 
+/* Set all the compare registers written since cork() with interrupts
+ * off, so the channels pick up their new pulse widths together at the
+ * end of their current period. */
+void APM1RCOutput::push(void) {
+    if (!_corked) {
+        return;
+    }
+    _corked = false;
+    uint8_t oldSREG = SREG;
+    cli();
+    for (uint8_t ch = 0; ch < AVR_RC_OUTPUT_NUM_CHANNELS; ch++) {
+        if (_pending_mask & (1U << ch)) {
+            _write_ocr(ch, _pending[ch]);
+        }
+    }
+    _pending_mask = 0;
+    SREG = oldSREG;
+}
+
 
 /* Read back current output state, as either single channel or
  * array of channels. */
@@ -109,6 +109,9 @@ uint16_t APM2RCOutput::get_freq(uint8_t ch) {
 /* Output active/highZ control, either by single channel at a time
  * or a mask of channels */
 void APM2RCOutput::enable_ch(uint8_t ch) {
+    if (ch < AVR_RC_OUTPUT_NUM_CHANNELS) {
+        _enabled_mask |= 1U << ch;
+    }
     switch(ch) {
     case 0: TCCR1A |= (1<<COM1B1); break; // CH_1 : OC1B
     case 1: TCCR1A |= (1<<COM1A1); break; // CH_2 : OC1A
@@ -133,6 +136,9 @@ void APM2RCOutput::enable_mask(uint32_t chmask) {
 }
 
 void APM2RCOutput::disable_ch(uint8_t ch) {
+    if (ch < AVR_RC_OUTPUT_NUM_CHANNELS) {
+        _enabled_mask &= ~(1U << ch);
+    }
     switch(ch) {
     case 0: TCCR1A &= ~(1<<COM1B1); break; // CH_1 : OC1B
     case 1: TCCR1A &= ~(1<<COM1A1); break; // CH_2 : OC1A
@@ -162,11 +168,36 @@ static inline uint16_t constrain_period(uint16_t p) {
     return p;
 }
 
+/* The channels on TIMER1, TIMER4 and TIMER3, which can do OneShot.
+ * TIMER5 runs at the rate of the PPM input, so CH_10 and CH_11 can't */
+#define ONESHOT_TIMER1_MASK (_BV(CH_1) | _BV(CH_2))
+#define ONESHOT_TIMER4_MASK (_BV(CH_3) | _BV(CH_4) | _BV(CH_5))
+#define ONESHOT_TIMER3_MASK (_BV(CH_6) | _BV(CH_7) | _BV(CH_8))
+#define ONESHOT_CHANNEL_MASK \
+    (ONESHOT_TIMER1_MASK | ONESHOT_TIMER4_MASK | ONESHOT_TIMER3_MASK)
+
 /* Output, either single channel or bulk array of channels */
 void APM2RCOutput::write(uint8_t ch, uint16_t period_us) {
     /* constrain, then scale from 1us resolution (input units)
-     * to 0.5us (timer units) */
-    uint16_t pwm = constrain_period(period_us) << 1;
+     * to 0.5us (timer units), or to 1/8 of that for OneShot125 */
+    uint16_t pwm = constrain_period(period_us);
+    if (_oneshot_mask & (1U << ch)) {
+        pwm >>= 2;
+    } else {
+        pwm <<= 1;
+    }
+    if (_corked) {
+        if (ch < AVR_RC_OUTPUT_NUM_CHANNELS) {
+            _pending[ch] = pwm;
+            _pending_mask |= 1U << ch;
+        }
+        return;
+    }
+    _write_ocr(ch, pwm);
+}
+
+/* Set the compare register of a channel, in timer units */
+void APM2RCOutput::_write_ocr(uint8_t ch, uint16_t pwm) {
     switch(ch)
     {
     case 0:  OCR1B=pwm; break;  // out1
@@ -188,10 +219,99 @@ void APM2RCOutput::write(uint8_t ch, uint16_t* period_us, uint8_t len) {
     }
 }
 
+/* Restart the period of a timer, so the compare values just written
+ * go out now rather than at the end of the current period. This is
+ * only done once every pulse on the timer is over, as cutting one
+ * short would glitch the servo or ESC it drives. */
+static inline void retrigger(volatile uint16_t &tcnt, uint16_t icr,
+                             uint16_t longest) {
+    uint16_t now = tcnt;
+    if (now > longest && now < icr - 1) {
+        tcnt = icr - 1;
+    }
+}
+
+/* Set all the compare registers written since cork() with interrupts
+ * off, so the channels pick up their new pulse widths together, then
+ * start the OneShot pulses straight away. */
+void APM2RCOutput::push(void) {
+    if (!_corked) {
+        return;
+    }
+    _corked = false;
+    uint8_t oldSREG = SREG;
+    cli();
+    /* the longest pulse, old or new, on each OneShot timer */
+    uint16_t longest1 = 0, longest4 = 0, longest3 = 0;
+    for (uint8_t ch = 0; ch < AVR_RC_OUTPUT_NUM_CHANNELS; ch++) {
+        uint16_t bit = 1U << ch;
+        if (_oneshot_mask != 0 && (_enabled_mask & bit)) {
+            uint16_t pulse = _read_ocr(ch);
+            if ((_pending_mask & bit) && _pending[ch] > pulse) {
+                pulse = _pending[ch];
+            }
+            if ((bit & ONESHOT_TIMER1_MASK) && pulse > longest1) {
+                longest1 = pulse;
+            } else if ((bit & ONESHOT_TIMER4_MASK) && pulse > longest4) {
+                longest4 = pulse;
+            } else if ((bit & ONESHOT_TIMER3_MASK) && pulse > longest3) {
+                longest3 = pulse;
+            }
+        }
+        if (_pending_mask & bit) {
+            _write_ocr(ch, _pending[ch]);
+        }
+    }
+    _pending_mask = 0;
+    if (_oneshot_mask & ONESHOT_TIMER1_MASK) {
+        retrigger(TCNT1, ICR1, longest1);
+    }
+    if (_oneshot_mask & ONESHOT_TIMER4_MASK) {
+        retrigger(TCNT4, ICR4, longest4);
+    }
+    if (_oneshot_mask & ONESHOT_TIMER3_MASK) {
+        retrigger(TCNT3, ICR3, longest3);
+    }
+    SREG = oldSREG;
+}
+
+bool APM2RCOutput::set_oneshot(uint32_t chmask) {
+    if ((chmask & ~(uint32_t)ONESHOT_CHANNEL_MASK) != 0) {
+        return false;
+    }
+    /* rescale what the channels changing mode output now, so an ESC
+     * never sees a normal PWM pulse as a OneShot one or the other way
+     * round before the next write */
+    uint8_t oldSREG = SREG;
+    cli();
+    for (uint8_t ch = 0; ch < AVR_RC_OUTPUT_NUM_CHANNELS; ch++) {
+        uint16_t bit = 1U << ch;
+        if (((_oneshot_mask ^ chmask) & bit) == 0) {
+            continue;
+        }
+        uint16_t pwm = _read_ocr(ch);
+        if (pwm != 0xFFFF) {
+            _write_ocr(ch, (chmask & bit) ? (pwm >> 3) : (pwm << 3));
+        }
+    }
+    _oneshot_mask = chmask;
+    SREG = oldSREG;
+    return true;
+}
 
 /* Read back current output state, as either single channel or
  * array of channels. */
 uint16_t APM2RCOutput::read(uint8_t ch) {
+    uint16_t pwm = _read_ocr(ch);
+    /* scale from 0.5us resolution (timer units) to 1us units */
+    if (_oneshot_mask & (1U << ch)) {
+        return pwm << 2;
+    }
+    return pwm>>1;
+}
+
+/* Read the compare register of a channel, in timer units */
+uint16_t APM2RCOutput::_read_ocr(uint8_t ch) {
     uint16_t pwm=0;
     switch(ch) {
     case 0:  pwm=OCR1B; break;      // out1
@@ -205,9 +325,7 @@ uint16_t APM2RCOutput::read(uint8_t ch) {
     case 9:  pwm=OCR5B; break;      // out10
     case 10: pwm=OCR5C; break;      // out11
     }
-    /* scale from 0.5us resolution (timer units) to 1us units */
-    return pwm>>1;
-
+    return pwm;
 }
 
 void APM2RCOutput::read(uint16_t* period_us, uint8_t len) {
@@ -102,4 +102,35 @@ uint8_t AVRSPI0DeviceDriver::transfer(uint8_t data) {
     return _transfer(data);
 }
 
+/*
+  run a batch with chip select held across it, without the per byte
+  collision checks and call overhead of _transfer()
+ */
+bool AVRSPI0DeviceDriver::transfer_segments(const AP_HAL::SPISegment *segs, uint8_t nsegs,
+        AP_HAL::SPICompletionProc completion, void *arg) {
+    if (spi0_transferflag) {
+        hal.scheduler->panic(PSTR("PANIC: SPI0 transfer collision"));
+    }
+    spi0_transferflag = true;
+    _cs_assert();
+    for (uint8_t s = 0; s < nsegs; s++) {
+        const uint8_t *tx = segs[s].tx;
+        uint8_t *rx = segs[s].rx;
+        for (uint16_t i = 0; i < segs[s].len; i++) {
+            SPDR = tx ? tx[i] : 0;
+            while(!(SPSR & _BV(SPIF)));
+            uint8_t b = SPDR;
+            if (rx != NULL) {
+                rx[i] = b;
+            }
+        }
+    }
+    _cs_release();
+    spi0_transferflag = false;
+    if (completion != NULL) {
+        completion(arg);
+    }
+    return true;
+}
+
 #endif
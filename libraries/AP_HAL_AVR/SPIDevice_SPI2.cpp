@@ -69,18 +69,34 @@ inline uint8_t AVRSPI2DeviceDriver::_transfer(uint8_t data) {
     return UDR2;
 }
 
-void AVRSPI2DeviceDriver::transaction(const uint8_t *tx, uint8_t *rx,
-        uint16_t len) {
-    _cs_assert();
-    if (rx == NULL) {
-        for (uint16_t i = 0; i < len; i++) {
-            _transfer(tx[i]);
+/*
+  the USART transmit buffer is double buffered, so keep the next byte
+  queued while the current one shifts out. That removes the idle gap
+  _transfer() leaves between bytes
+ */
+void AVRSPI2DeviceDriver::_burst(const uint8_t *tx, uint8_t *rx, uint16_t len) {
+    if (len == 0) {
+        return;
+    }
+    while ( !( UCSR2A & _BV(UDRE2)) ) ;
+    UDR2 = tx ? tx[0] : 0;
+    for (uint16_t i = 0; i < len; i++) {
+        if (i+1 < len) {
+            while ( !( UCSR2A & _BV(UDRE2)) ) ;
+            UDR2 = tx ? tx[i+1] : 0;
         }
-    } else {
-        for (uint16_t i = 0; i < len; i++) {
-            rx[i] = _transfer(tx[i]);
+        while ( !(UCSR2A & _BV(RXC2)) ) ;
+        uint8_t b = UDR2;
+        if (rx != NULL) {
+            rx[i] = b;
         }
     }
+}
+
+void AVRSPI2DeviceDriver::transaction(const uint8_t *tx, uint8_t *rx,
+        uint16_t len) {
+    _cs_assert();
+    _burst(tx, rx, len);
     _cs_release();
 }
 
@@ -101,4 +117,17 @@ void AVRSPI2DeviceDriver::transfer(const uint8_t *data, uint16_t len) {
         _transfer(*data++);
 }
 
+bool AVRSPI2DeviceDriver::transfer_segments(const AP_HAL::SPISegment *segs, uint8_t nsegs,
+        AP_HAL::SPICompletionProc completion, void *arg) {
+    _cs_assert();
+    for (uint8_t s = 0; s < nsegs; s++) {
+        _burst(segs[s].tx, segs[s].rx, segs[s].len);
+    }
+    _cs_release();
+    if (completion != NULL) {
+        completion(arg);
+    }
+    return true;
+}
+
 #endif
@@ -90,16 +90,34 @@ void AVRSPI3DeviceDriver::_transfer(const uint8_t *data, uint16_t len) {
     }
 }
 
+/*
+  the USART transmit buffer is double buffered, so keep the next byte
+  queued while the current one shifts out. That removes the idle gap
+  _transfer() leaves between bytes
+ */
+void AVRSPI3DeviceDriver::_burst(const uint8_t *tx, uint8_t *rx, uint16_t len) {
+    if (len == 0) {
+        return;
+    }
+    while ( !( UCSR3A & _BV(UDRE3)) ) ;
+    UDR3 = tx ? tx[0] : 0;
+    for (uint16_t i = 0; i < len; i++) {
+        if (i+1 < len) {
+            while ( !( UCSR3A & _BV(UDRE3)) ) ;
+            UDR3 = tx ? tx[i+1] : 0;
+        }
+        while ( !(UCSR3A & _BV(RXC3)) ) ;
+        uint8_t b = UDR3;
+        if (rx != NULL) {
+            rx[i] = b;
+        }
+    }
+}
+
 void AVRSPI3DeviceDriver::transaction(const uint8_t *tx, uint8_t *rx,
         uint16_t len) {
     _cs_assert();
-    if (rx == NULL) {
-        _transfer(tx, len);
-    } else {
-        for (uint16_t i = 0; i < len; i++) {
-            rx[i] = _transfer(tx[i]);
-        }
-    }
+    _burst(tx, rx, len);
     _cs_release();
 }
 
@@ -119,4 +137,17 @@ void AVRSPI3DeviceDriver::transfer(const uint8_t *data, uint16_t len) {
     _transfer(data, len);
 }
 
+bool AVRSPI3DeviceDriver::transfer_segments(const AP_HAL::SPISegment *segs, uint8_t nsegs,
+        AP_HAL::SPICompletionProc completion, void *arg) {
+    _cs_assert();
+    for (uint8_t s = 0; s < nsegs; s++) {
+        _burst(segs[s].tx, segs[s].rx, segs[s].len);
+    }
+    _cs_release();
+    if (completion != NULL) {
+        completion(arg);
+    }
+    return true;
+}
+
 #endif
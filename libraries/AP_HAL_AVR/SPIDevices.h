@@ -27,6 +27,9 @@ public:
     uint8_t transfer(uint8_t data);
     void transfer(const uint8_t *data, uint16_t len);
 
+    bool transfer_segments(const AP_HAL::SPISegment *segs, uint8_t nsegs,
+                           AP_HAL::SPICompletionProc completion, void *arg);
+
 private:
     void _cs_assert();
     void _cs_release();
@@ -62,10 +65,14 @@ public:
     uint8_t transfer(uint8_t data);
     void transfer(const uint8_t *data, uint16_t len);
 
+    bool transfer_segments(const AP_HAL::SPISegment *segs, uint8_t nsegs,
+                           AP_HAL::SPICompletionProc completion, void *arg);
+
 private:
     void _cs_assert();
     void _cs_release();
     uint8_t _transfer(uint8_t data);
+    void _burst(const uint8_t *tx, uint8_t *rx, uint16_t len);
 
     static AP_HAL_AVR::AVRSemaphore _semaphore;
 
@@ -96,11 +103,15 @@ public:
     uint8_t transfer(uint8_t data);
     void transfer(const uint8_t *data, uint16_t len);
 
+    bool transfer_segments(const AP_HAL::SPISegment *segs, uint8_t nsegs,
+                           AP_HAL::SPICompletionProc completion, void *arg);
+
 private:
     void _cs_assert();
     void _cs_release();
     uint8_t _transfer(uint8_t data);
     void _transfer(const uint8_t *data, uint16_t size);
+    void _burst(const uint8_t *tx, uint8_t *rx, uint16_t len);
     static AP_HAL_AVR::AVRSemaphore _semaphore;
 
     AP_HAL_AVR::AVRDigitalSource *_cs_pin;
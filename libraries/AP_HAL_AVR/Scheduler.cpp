@@ -6,6 +6,8 @@
 #include <avr/io.h>
 #include <avr/wdt.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <string.h>
 
 #include "Scheduler.h"
 #include "utility/ISRRegistry.h"
@@ -17,6 +19,9 @@ extern const AP_HAL::HAL& hal;
  * 256-62 gives a 1kHz period. */
 #define RESET_TCNT2_VALUE (256 - 62)
 
+/* 62 counts of clk/256 at 16MHz */
+#define TIMER_TICK_US 992
+
 /* Static AVRScheduler variables: */
 AVRTimer AVRScheduler::_timer;
 
@@ -24,8 +29,15 @@ AP_HAL::TimedProc AVRScheduler::_failsafe = NULL;
 volatile bool AVRScheduler::_timer_suspended = false;
 volatile bool AVRScheduler::_timer_event_missed = false;
 volatile bool AVRScheduler::_in_timer_proc = false;
+volatile bool AVRScheduler::_main_signalled = false;
 AP_HAL::TimedProc AVRScheduler::_timer_proc[AVR_SCHEDULER_MAX_TIMER_PROCS] = {NULL};
 uint8_t AVRScheduler::_num_timer_procs = 0;
+AP_HAL::Scheduler::SlowProc AVRScheduler::_slow_proc[AVR_SCHEDULER_MAX_SLOW_PROCS];
+uint8_t AVRScheduler::_num_slow_procs = 0;
+uint8_t AVRScheduler::_next_slow_proc = 0;
+AP_HAL::Scheduler::TimerProcStats AVRScheduler::_timer_stats[AVR_SCHEDULER_MAX_TIMER_PROCS];
+volatile uint32_t AVRScheduler::_late_ticks = 0;
+uint32_t AVRScheduler::_last_tick_us = 0;
 
 
 AVRScheduler::AVRScheduler() :
@@ -113,6 +125,26 @@ void AVRScheduler::register_io_process(AP_HAL::TimedProc proc)
     // IO processes not supported on AVR
 }
 
+void AVRScheduler::register_slow_process(AP_HAL::TimedProc proc, uint16_t period_us) {
+    for (uint8_t i = 0; i < _num_slow_procs; i++) {
+        if (_slow_proc[i].proc == proc) {
+            return;
+        }
+    }
+
+    if (_num_slow_procs < AVR_SCHEDULER_MAX_SLOW_PROCS) {
+        /* as with the timer processes, the entry is only used once
+         * _num_slow_procs includes it */
+        _slow_proc[_num_slow_procs].proc = proc;
+        _slow_proc[_num_slow_procs].period_us = period_us;
+        _slow_proc[_num_slow_procs].last_run = 0;
+        uint8_t oldSREG = SREG;
+        cli();
+        _num_slow_procs++;
+        SREG = oldSREG;
+    }
+}
+
 void AVRScheduler::register_timer_failsafe(
         AP_HAL::TimedProc failsafe, uint32_t period_us) {
     /* XXX Assert period_us == 1000 */
@@ -135,6 +167,71 @@ bool AVRScheduler::in_timerprocess() {
     return _in_timer_proc;
 }
 
+void AVRScheduler::signal_main() {
+    _main_signalled = true;
+}
+
+/*
+  idle the CPU until the next interrupt, and check the signal after
+  each. The timer interrupt comes every millisecond so the timeout is
+  kept to within a tick. Interrupts are only enabled by the sei()
+  immediately before the sleep, and the instruction after a sei() is
+  always run before any interrupt, so a signal can't be missed between
+  the check and the sleep
+ */
+bool AVRScheduler::wait_for_signal(uint16_t timeout_us) {
+    if (_in_timer_proc) {
+        return false;
+    }
+    uint32_t tstart = micros();
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    for (;;) {
+        cli();
+        if (_main_signalled) {
+            _main_signalled = false;
+            sei();
+            return true;
+        }
+        if (micros() - tstart >= timeout_us) {
+            sei();
+            return false;
+        }
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+}
+
+bool AVRScheduler::timer_proc_stats(uint8_t i, TimerProcStats &stats) {
+    if (i >= _num_timer_procs) {
+        return false;
+    }
+    /* the stats are updated from the timer interrupt */
+    uint8_t oldSREG = SREG;
+    cli();
+    stats = _timer_stats[i];
+    SREG = oldSREG;
+    stats.proc = _timer_proc[i];
+    return true;
+}
+
+uint32_t AVRScheduler::timer_late_ticks() {
+    uint8_t oldSREG = SREG;
+    cli();
+    uint32_t ret = _late_ticks;
+    SREG = oldSREG;
+    return ret;
+}
+
+void AVRScheduler::clear_timer_stats() {
+    uint8_t oldSREG = SREG;
+    cli();
+    memset(_timer_stats, 0, sizeof(_timer_stats));
+    _late_ticks = 0;
+    SREG = oldSREG;
+}
+
 void AVRScheduler::_timer_isr_event() {
     // we enable the interrupt again immediately and also enable
     // interrupts. This allows other time critical interrupts to
@@ -152,6 +249,7 @@ void AVRScheduler::_run_timer_procs(bool called_from_isr) {
 
     uint32_t tnow = _timer.micros();
     if (_in_timer_proc) {
+        _late_ticks++;
         // the timer calls took longer than the period of the
         // timer. This is bad, and may indicate a serious
         // driver failure. We can't just call the drivers
@@ -170,13 +268,28 @@ void AVRScheduler::_run_timer_procs(bool called_from_isr) {
 
     _in_timer_proc = true;
 
+    if (called_from_isr) {
+        if (_last_tick_us != 0 && tnow - _last_tick_us > 2*TIMER_TICK_US) {
+            _late_ticks++;
+        }
+        _last_tick_us = tnow;
+    }
+
     if (!_timer_suspended) {
-        // now call the timer based drivers
+        // now call the timer based drivers, timing each one
+        uint32_t tstart = tnow;
         for (int i = 0; i < _num_timer_procs; i++) {
             if (_timer_proc[i] != NULL) {
                 _timer_proc[i](tnow);
+                uint32_t tend = _timer.micros();
+                _timer_stats[i].update(tstart, tend, TIMER_TICK_US);
+                tstart = tend;
             }
         }
+
+        // then one slow process, if one is due, so a slow bus adds at
+        // most one transfer to a tick, after the fast sensors
+        run_slow_procs(_slow_proc, _num_slow_procs, _next_slow_proc, tstart);
     } else if (called_from_isr) {
         _timer_event_missed = true;
     }
@@ -215,6 +328,9 @@ void AVRScheduler::panic(const prog_char_t* errormsg) {
 void AVRScheduler::reboot() {
     hal.uartA->println_P(PSTR("GOING DOWN FOR A REBOOT\r\n"));
     hal.scheduler->delay(100);
+    /* let the EEPROM ready interrupt finish the queued storage
+     * writes. It turns itself off when there are none left */
+    while (EECR & _BV(EERIE));
 #if CONFIG_HAL_BOARD == HAL_BOARD_APM2
     /* The APM2 bootloader will reset the watchdog shortly after
      * starting, so we can use the watchdog to force a reboot
@@ -6,6 +6,7 @@
 #include "AP_HAL_AVR_Namespace.h"
 
 #define AVR_SCHEDULER_MAX_TIMER_PROCS 4
+#define AVR_SCHEDULER_MAX_SLOW_PROCS 4
 
 /* Class for managing the AVR Timers: */
 class AP_HAL_AVR::AVRTimer {
@@ -33,13 +34,21 @@ public:
 
     void     register_timer_process(AP_HAL::TimedProc);
     void     register_io_process(AP_HAL::TimedProc);
+    void     register_slow_process(AP_HAL::TimedProc, uint16_t period_us);
     void     suspend_timer_procs();
     void     resume_timer_procs();
 
     bool     in_timerprocess();
 
+    void     signal_main();
+    bool     wait_for_signal(uint16_t timeout_us);
+
     void     register_timer_failsafe(AP_HAL::TimedProc, uint32_t period_us);
 
+    bool     timer_proc_stats(uint8_t i, TimerProcStats &stats);
+    uint32_t timer_late_ticks();
+    void     clear_timer_stats();
+
     bool     system_initializing();
     void     system_initialized();
 
@@ -50,6 +59,7 @@ private:
     static AVRTimer _timer;
 
     static volatile bool _in_timer_proc;
+    static volatile bool _main_signalled;
 
     AP_HAL::Proc _delay_cb;
     uint16_t _min_delay_cb_ms;
@@ -67,6 +77,14 @@ private:
     static AP_HAL::TimedProc _timer_proc[AVR_SCHEDULER_MAX_TIMER_PROCS];
     static uint8_t _num_timer_procs;
 
+    static SlowProc _slow_proc[AVR_SCHEDULER_MAX_SLOW_PROCS];
+    static uint8_t _num_slow_procs;
+    static uint8_t _next_slow_proc;
+
+    static TimerProcStats _timer_stats[AVR_SCHEDULER_MAX_TIMER_PROCS];
+    static volatile uint32_t _late_ticks;
+    static uint32_t _last_tick_us;
+
 };
 #endif // __AP_HAL_AVR_SCHEDULER_H__
 
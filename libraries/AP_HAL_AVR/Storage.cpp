@@ -2,30 +2,135 @@
 #if (CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2)
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include <avr/eeprom.h>
 #include "Storage.h"
 using namespace AP_HAL_AVR;
 
+volatile uint16_t AVREEPROMStorage::_queue_loc[AVR_STORAGE_QUEUE_SIZE];
+volatile uint8_t  AVREEPROMStorage::_queue_value[AVR_STORAGE_QUEUE_SIZE];
+volatile uint8_t  AVREEPROMStorage::_queue_head;
+volatile uint8_t  AVREEPROMStorage::_queue_count;
+
+/*
+  the interrupt shares the EEPROM address and data registers with the
+  reads, so it is held off while the queue or the EEPROM is in use
+ */
+static inline void ready_interrupt_off(void) {
+    uint8_t sreg = SREG;
+    cli();
+    EECR &= ~_BV(EERIE);
+    SREG = sreg;
+}
+
+static inline void ready_interrupt_on(void) {
+    uint8_t sreg = SREG;
+    cli();
+    EECR |= _BV(EERIE);
+    SREG = sreg;
+}
+
+extern "C" ISR(EE_READY_vect) {
+    AVREEPROMStorage::_write_next();
+}
+
+/*
+  the EEPROM must not be busy, and interrupts must be off, as setting
+  EEPE has to follow EEMPE within 4 cycles
+ */
+void AVREEPROMStorage::_write_next() {
+    if (_queue_count == 0) {
+        EECR &= ~_BV(EERIE);
+        return;
+    }
+    EEAR = _queue_loc[_queue_head];
+    EEDR = _queue_value[_queue_head];
+    EECR |= _BV(EEMPE);
+    EECR |= _BV(EEPE);
+    _queue_head = (_queue_head + 1) % AVR_STORAGE_QUEUE_SIZE;
+    _queue_count--;
+}
+
+/*
+  the newest queued value of loc, if there is one. The ready interrupt
+  must be off
+ */
+bool AVREEPROMStorage::_lookup(uint16_t loc, uint8_t &value) {
+    for (uint8_t i = _queue_count; i > 0; i--) {
+        uint8_t idx = (_queue_head + i - 1) % AVR_STORAGE_QUEUE_SIZE;
+        if (_queue_loc[idx] == loc) {
+            value = _queue_value[idx];
+            return true;
+        }
+    }
+    return false;
+}
+
 uint8_t AVREEPROMStorage::read_byte(uint16_t loc) {
-    return eeprom_read_byte((uint8_t*)loc);
+    uint8_t value;
+    read_block(&value, loc, sizeof(value));
+    return value;
 }
 
 uint16_t AVREEPROMStorage::read_word(uint16_t loc) {
-    return eeprom_read_word((uint16_t*)loc);
+    uint16_t value;
+    read_block(&value, loc, sizeof(value));
+    return value;
 }
 
 uint32_t AVREEPROMStorage::read_dword(uint16_t loc) {
-    return eeprom_read_dword((uint32_t*)loc);
+    uint32_t value;
+    read_block(&value, loc, sizeof(value));
+    return value;
 }
 
 void AVREEPROMStorage::read_block(void *dst, uint16_t src, size_t n) {
+    ready_interrupt_off();
     eeprom_read_block(dst,(const void*)src,n);
+    // then the queued writes in the block, oldest first
+    uint8_t *p = (uint8_t *)dst;
+    for (uint8_t i = 0; i < _queue_count; i++) {
+        uint8_t idx = (_queue_head + i) % AVR_STORAGE_QUEUE_SIZE;
+        uint16_t ofs = _queue_loc[idx] - src;
+        if (ofs < n) {
+            p[ofs] = _queue_value[idx];
+        }
+    }
+    if (_queue_count != 0) {
+        ready_interrupt_on();
+    }
 }
 
 void AVREEPROMStorage::write_byte(uint16_t loc, uint8_t value) {
-    uint8_t b = eeprom_read_byte((uint8_t*)loc);
-    if (b != value) {
-        eeprom_write_byte((uint8_t*)loc, value);
+    ready_interrupt_off();
+    uint8_t b;
+    if (!_lookup(loc, b)) {
+        b = eeprom_read_byte((uint8_t*)loc);
+    }
+    uint8_t tail = (_queue_head + _queue_count + AVR_STORAGE_QUEUE_SIZE - 1) % AVR_STORAGE_QUEUE_SIZE;
+    if (b == value) {
+        // already there, or on its way
+    } else if (_queue_count != 0 && _queue_loc[tail] == loc) {
+        // a rewrite of the newest queued byte replaces it, which keeps
+        // the queue in order, so a flag or counter written again and
+        // again costs one EEPROM write
+        _queue_value[tail] = value;
+    } else {
+        if (_queue_count == AVR_STORAGE_QUEUE_SIZE) {
+            // full, so wait to make room
+            eeprom_busy_wait();
+            uint8_t sreg = SREG;
+            cli();
+            _write_next();
+            SREG = sreg;
+        }
+        uint8_t idx = (_queue_head + _queue_count) % AVR_STORAGE_QUEUE_SIZE;
+        _queue_loc[idx] = loc;
+        _queue_value[idx] = value;
+        _queue_count++;
+    }
+    if (_queue_count != 0) {
+        ready_interrupt_on();
     }
 }
 
@@ -44,4 +149,8 @@ void AVREEPROMStorage::write_block(uint16_t dst, const void *src, size_t n) {
     }
 }
 
+uint16_t AVREEPROMStorage::write_space() {
+    return AVR_STORAGE_QUEUE_SIZE - _queue_count;
+}
+
 #endif
@@ -6,6 +6,13 @@
 #include <AP_HAL.h>
 #include "AP_HAL_AVR_Namespace.h"
 
+// bytes of writes held while the EEPROM is busy
+#define AVR_STORAGE_QUEUE_SIZE 40
+
+/* Writes are queued and written out by the EEPROM ready interrupt, a
+ * byte every 3.4ms, so saving parameters or a mission doesn't stop the
+ * caller. Reads see the queued values. Only when the queue is full
+ * does a write wait for the EEPROM. */
 class AP_HAL_AVR::AVREEPROMStorage : public AP_HAL::Storage {
 public:
     AVREEPROMStorage() {}
@@ -19,6 +26,20 @@ public:
     void write_word(uint16_t loc, uint16_t value);
     void write_dword(uint16_t loc, uint32_t value);
     void write_block(uint16_t dst, const void* src, size_t n);
+
+    uint16_t write_space();
+
+    /* start the next queued write. Called from the EEPROM ready
+     * interrupt */
+    static void _write_next();
+
+private:
+    static bool _lookup(uint16_t loc, uint8_t &value);
+
+    static volatile uint16_t _queue_loc[AVR_STORAGE_QUEUE_SIZE];
+    static volatile uint8_t  _queue_value[AVR_STORAGE_QUEUE_SIZE];
+    static volatile uint8_t  _queue_head;
+    static volatile uint8_t  _queue_count;
 };
 
 #endif // __AP_HAL_AVR_STORAGE_H__
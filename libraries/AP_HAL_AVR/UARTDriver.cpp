@@ -13,10 +13,12 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include <avr/pgmspace.h>
 
 #include <AP_HAL.h>
+#include <AP_Common.h>
 #include <AP_Math.h>
 
 #include "utility/print_vprintf.h"
@@ -150,6 +152,24 @@ int16_t AVRUARTDriver::read(void) {
 	return (c);
 }
 
+uint16_t AVRUARTDriver::read_implementation(uint8_t *buffer, uint16_t count) {
+	if (!_open) {
+		return 0;
+	}
+
+	// the interrupt only moves head, so the bytes up to a copy of it
+	// can be taken without disabling interrupts
+	uint8_t head = _rxBuffer->head;
+	uint8_t tail = _rxBuffer->tail;
+	uint16_t n = 0;
+	while (n < count && tail != head) {
+		buffer[n++] = _rxBuffer->bytes[tail];
+		tail = (tail + 1) & _rxBuffer->mask;
+	}
+	_rxBuffer->tail = tail;
+	return n;
+}
+
 void AVRUARTDriver::flush(void) {
 	// don't reverse this or there may be problems if the RX interrupt
 	// occurs after reading the value of _rxBuffer->head but before writing
@@ -197,6 +217,45 @@ size_t AVRUARTDriver::write(uint8_t c) {
 	return 1;
 }
 
+size_t AVRUARTDriver::write_implementation(const uint8_t *buffer, size_t size) {
+	if (!_open) // drop bytes if not open
+		return 0;
+
+	// copy as much as fits straight into the tx buffer. One slot is
+	// always left empty so that a full buffer can be told from an
+	// empty one
+	uint8_t head = _txBuffer->head;
+	uint8_t space = _txBuffer->mask - ((head - _txBuffer->tail) & _txBuffer->mask);
+	uint8_t n = size < space ? size : space;
+	for (uint8_t i = 0; i < n; ) {
+		// the part up to the end of the buffer, then the part from the start
+		uint16_t chunk = _txBuffer->mask + 1 - head;
+		if (chunk > n - i) {
+			chunk = n - i;
+		}
+		memcpy(&_txBuffer->bytes[head], &buffer[i], chunk);
+		head = (head + chunk) & _txBuffer->mask;
+		i += chunk;
+	}
+
+	// the interrupt handler only sees the new bytes once head moves
+	_txBuffer->head = head;
+	if (n != 0) {
+		// enable the data-ready interrupt, as it may be off if the buffer is empty
+		*_ucsrb |= _portTxBits;
+	}
+
+	// a blocking write waits for room for the rest a byte at a time, a
+	// non-blocking one drops it
+	size_t ret = n;
+	if (!_nonblocking_writes) {
+		while (ret < size) {
+			ret += write(buffer[ret]);
+		}
+	}
+	return ret;
+}
+
 // Buffer management ///////////////////////////////////////////////////////////
     
 
@@ -216,22 +275,22 @@ bool AVRUARTDriver::_allocBuffer(Buffer *buffer, uint16_t size)
 		;
 	mask = (1U << shift) - 1;
 
-	// If the descriptor already has a buffer allocated we need to take
-	// care of it.
+	// If the descriptor already has memory big enough, use it
 	if (buffer->bytes) {
-
-		// If the allocated buffer is already the correct size then
-		// we have nothing to do
-		if (buffer->mask == mask)
+		if (mask <= buffer->capacity) {
+			buffer->mask = mask;
 			return true;
+		}
 
-		// Dispose of the old buffer.
-		free(buffer->bytes);
+		// Dispose of the old buffer. This only gives memory back if
+		// it came from the heap
+		arena_free(buffer->bytes);
 	}
 	buffer->mask = mask;
+	buffer->capacity = mask;
 
 	// allocate memory for the buffer - if this fails, we fail.
-	buffer->bytes = (uint8_t *) malloc(buffer->mask + (size_t)1);
+	buffer->bytes = (uint8_t *) arena_alloc(buffer->mask + (size_t)1);
 
 	return (buffer->bytes != NULL);
 }
@@ -240,10 +299,6 @@ void AVRUARTDriver::_freeBuffer(Buffer *buffer)
 {
 	buffer->head = buffer->tail = 0;
 	buffer->mask = 0;
-	if (NULL != buffer->bytes) {
-		free(buffer->bytes);
-		buffer->bytes = NULL;
-	}
 }
 
 // BetterStream method implementations /////////////////////////////////////////
@@ -266,7 +321,7 @@ void AVRUARTDriver::printf(const char *fmt, ...) {
 }
 
 void AVRUARTDriver::vprintf(const char *fmt, va_list ap) {
-        print_vprintf((AP_HAL::Print*)this, 0, fmt, ap);
+        print_vprintf_buffered((AP_HAL::Print*)this, 0, fmt, ap);
 }
 
 void AVRUARTDriver::_printf_P(const prog_char *fmt, ...) {
@@ -277,7 +332,7 @@ void AVRUARTDriver::_printf_P(const prog_char *fmt, ...) {
 }
 
 void AVRUARTDriver::vprintf_P(const prog_char *fmt, va_list ap) {
-        print_vprintf((AP_HAL::Print*)this, 1, fmt, ap);
+        print_vprintf_buffered((AP_HAL::Print*)this, 1, fmt, ap);
 }
 
 #endif
@@ -55,9 +55,11 @@ public:
     int16_t available();
     int16_t txspace();
     int16_t read();
+    uint16_t read_implementation(uint8_t *buffer, uint16_t count);
 
     /* Implementations of Print virtual methods */
     size_t write(uint8_t c);
+    size_t write_implementation(const uint8_t *buffer, size_t size);
 
 	/// Transmit/receive buffer descriptor.
 	///
@@ -65,6 +67,7 @@ public:
 	struct Buffer {
 		volatile uint8_t head, tail;	///< head and tail pointers
 		uint8_t mask;					///< buffer size mask for pointer wrap
+		uint8_t capacity;				///< mask of the memory at bytes, which is kept
 		uint8_t *bytes;					///< pointer to allocated buffer
 	};
 private:
@@ -102,7 +105,8 @@ private:
 	///
 	static bool _allocBuffer(Buffer *buffer, uint16_t size);
 
-	/// Frees the allocated buffer in a descriptor
+	/// Empties the buffer in a descriptor. The memory stays with it,
+	/// as it comes from the arena and can't be given back
 	///
 	/// @param	buffer		The descriptor whose buffer should be freed.
 	///
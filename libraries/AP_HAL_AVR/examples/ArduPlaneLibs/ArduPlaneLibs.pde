@@ -24,6 +24,7 @@
 #include <memcheck.h>
 
 #include <DataFlash.h>
+#include <AP_Scheduler.h>
 #include <APM_Control.h>
 #include <AP_SpdHgtControl.h>
 #include <GCS_MAVLink.h>    // MAVLink GCS definitions
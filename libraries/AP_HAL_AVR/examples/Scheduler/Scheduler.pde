@@ -65,6 +65,19 @@ void setup_pin(int pin_num) {
     hal.gpio->write(pin_num,0);
 }
 
+void print_timer_stats() {
+    AP_HAL::Scheduler::TimerProcStats s;
+    for (uint8_t i = 0; hal.scheduler->timer_proc_stats(i, s); i++) {
+        hal.console->printf_P(PSTR("timer %u: %lu runs, time avg %lu max %u us, "
+                    "jitter avg %lu max %u us\r\n"),
+                (unsigned) i, s.count,
+                s.count ? s.time_total / s.count : 0UL, s.time_max,
+                s.count > 1 ? s.jitter_total / (s.count - 1) : 0UL, s.jitter_max);
+    }
+    hal.console->printf_P(PSTR("late ticks: %lu\r\n"),
+            hal.scheduler->timer_late_ticks());
+}
+
 void setup (void) {
     hal.console->printf_P(PSTR("Starting AP_HAL_AVR::Scheduler test\r\n"));
 
@@ -100,6 +113,8 @@ void setup (void) {
 
     hal.scheduler->delay(100);
 
+    print_timer_stats();
+
     hal.console->printf_P(PSTR("Test running a pathological timer process.\r\n"
                 "Failsafe should continue even as pathological process "
                 "dominates the processor."));
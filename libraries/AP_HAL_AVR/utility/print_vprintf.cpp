@@ -522,4 +522,34 @@ void print_vprintf (AP_HAL::Print *s, unsigned char in_progmem, const char *fmt,
         } /* for (;;) */
 }
 
+/* collects the output, and hands it on when full and at the end */
+class BlockPrinter : public AP_HAL::Print {
+public:
+        BlockPrinter(AP_HAL::Print *s) : _s(s), _n(0) {}
+        size_t write(uint8_t c) {
+                if (_n == sizeof(_buf)) {
+                        flush();
+                }
+                _buf[_n++] = c;
+                return 1;
+        }
+        void flush(void) {
+                if (_n != 0) {
+                        _s->write(_buf, _n);
+                        _n = 0;
+                }
+        }
+private:
+        AP_HAL::Print *_s;
+        uint8_t _n;
+        uint8_t _buf[PRINT_VPRINTF_BUFFER_SIZE];
+};
+
+void print_vprintf_buffered (AP_HAL::Print *s, unsigned char in_progmem, const char *fmt, va_list ap)
+{
+        BlockPrinter b(s);
+        print_vprintf(&b, in_progmem, fmt, ap);
+        b.flush();
+}
+
 #endif
@@ -7,5 +7,14 @@
 
 void print_vprintf (AP_HAL::Print *s, unsigned char in_progmem, const char *fmt, va_list ap);
 
+/* bytes of output print_vprintf_buffered() collects on the stack
+ * before passing them on */
+#define PRINT_VPRINTF_BUFFER_SIZE 32
+
+/* print_vprintf() into a buffer on the stack, which is written to s a
+ * block at a time, so a port takes one bulk write rather than a write
+ * per character */
+void print_vprintf_buffered (AP_HAL::Print *s, unsigned char in_progmem, const char *fmt, va_list ap);
+
 
 #endif //__AP_HAL_AVR_UTILITY_VPRINTF_H__
@@ -13,9 +13,25 @@ extern const AP_HAL::HAL& hal;
 
 ADCSource::ADCSource(SITL_State *sitlState, uint8_t pin) :
     _sitlState(sitlState),
-    _pin(pin)
+    _pin(pin),
+    _sample_period_ms(0),
+    _last_sample_ms(0)
 {}
 
+/*
+  the simulated values are read when asked for, so a sample is ready
+  whenever the period is up
+ */
+bool ADCSource::sample_ready(uint32_t &time_ms) {
+    uint32_t now = hal.scheduler->millis();
+    if (_last_sample_ms != 0 && now - _last_sample_ms < _sample_period_ms) {
+        return false;
+    }
+    _last_sample_ms = now;
+    time_ms = now;
+    return true;
+}
+
 float ADCSource::read_average() {
 	return read_latest();
 }
@@ -22,10 +22,14 @@ public:
     float voltage_average_ratiometric() { return voltage_average(); }
     void set_stop_pin(uint8_t pin) {}
     void set_settle_time(uint16_t settle_time_ms) {}
+    void set_sample_rate(uint16_t rate_hz) { _sample_period_ms = rate_hz ? 1000 / rate_hz : 0; }
+    bool sample_ready(uint32_t &time_ms);
 
 private:
     SITL_State *_sitlState;
     uint8_t _pin;
+    uint16_t _sample_period_ms;
+    uint32_t _last_sample_ms;
 };
 
 /* AVRAnalogIn : a concrete class providing the implementations of the 
@@ -15,6 +15,7 @@ public:
     uint8_t  valid_channels();
     uint16_t read(uint8_t ch);
     uint8_t read(uint16_t* periods, uint8_t len);
+    uint32_t last_frame_time_us() { return _sitlState->pwm_frame_time_us; }
 
     bool set_overrides(int16_t *overrides, uint8_t len);
     bool set_override(uint8_t channel, int16_t override);
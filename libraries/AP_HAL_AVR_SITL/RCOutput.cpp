@@ -29,12 +29,30 @@ void SITLRCOutput::disable_mask(uint32_t chmask)
 
 void SITLRCOutput::write(uint8_t ch, uint16_t period_us)
 {
-	_sitlState->pwm_output[ch] = period_us;
+	if (_corked) {
+		_pending[ch] = period_us;
+	} else {
+		_sitlState->pwm_output[ch] = period_us;
+	}
 }
 
 void SITLRCOutput::write(uint8_t ch, uint16_t* period_us, uint8_t len)
 {
-	memcpy(_sitlState->pwm_output+ch, period_us, len*sizeof(uint16_t));
+	memcpy((_corked?_pending:_sitlState->pwm_output)+ch, period_us, len*sizeof(uint16_t));
+}
+
+void SITLRCOutput::cork(void)
+{
+	memcpy(_pending, _sitlState->pwm_output, sizeof(_pending));
+	_corked = true;
+}
+
+void SITLRCOutput::push(void)
+{
+	if (_corked) {
+		memcpy(_sitlState->pwm_output, _pending, sizeof(_pending));
+		_corked = false;
+	}
 }
 
 uint16_t SITLRCOutput::read(uint8_t ch) {
@@ -6,11 +6,15 @@
 #if CONFIG_HAL_BOARD == HAL_BOARD_AVR_SITL
 #include <AP_HAL_AVR_SITL.h>
 
+// the size of SITL_State::pwm_output
+#define SITL_NUM_OUTPUT_CHANNELS 11
+
 class AVR_SITL::SITLRCOutput : public AP_HAL::RCOutput {
 public:
     SITLRCOutput(SITL_State *sitlState) {
 	    _sitlState = sitlState;
 	    _freq_hz = 50;
+	    _corked = false;
     }
     void     init(void* machtnichts);
     void     set_freq(uint32_t chmask, uint16_t freq_hz);
@@ -23,10 +27,17 @@ public:
     void     write(uint8_t ch, uint16_t* period_us, uint8_t len);
     uint16_t read(uint8_t ch);
     void     read(uint16_t* period_us, uint8_t len);
+    void     cork(void);
+    void     push(void);
 
 private:    
     SITL_State *_sitlState;
     uint16_t _freq_hz;
+
+    // the outputs written while corked, which the simulator doesn't
+    // see until push()
+    uint16_t _pending[SITL_NUM_OUTPUT_CHANNELS];
+    bool _corked;
 };
 
 #endif
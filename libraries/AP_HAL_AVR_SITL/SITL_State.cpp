@@ -18,8 +18,11 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <sys/select.h>
+#include <sys/stat.h>
 
 #include <AP_Param.h>
+#include <SIM_Multicopter.h>
+#include <SIM_Rover.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -31,6 +34,11 @@ struct sockaddr_in SITL_State::_rcout_addr;
 pid_t SITL_State::_parent_pid;
 uint32_t SITL_State::_update_count;
 bool SITL_State::_motors_on;
+bool SITL_State::_lockstep;
+bool SITL_State::_free_run;
+uint8_t SITL_State::_instance;
+Aircraft *SITL_State::_sim_model;
+uint64_t SITL_State::_sim_time_usec;
 uint16_t SITL_State::airspeed_pin_value;
 
 AP_Baro_HIL *SITL_State::_barometer;
@@ -43,6 +51,7 @@ SITL *SITL_State::_sitl;
 uint16_t SITL_State::pwm_output[11];
 uint16_t SITL_State::pwm_input[8];
 bool SITL_State::pwm_valid;
+uint32_t SITL_State::pwm_frame_time_us;
 
 // catch floating point exceptions
 void SITL_State::_sig_fpe(int signum)
@@ -58,22 +67,30 @@ void SITL_State::_usage(void)
 	fprintf(stdout, "\t-r RATE     set SITL framerate\n");
 	fprintf(stdout, "\t-H HEIGHT   initial barometric height\n");
 	fprintf(stdout, "\t-C          use console instead of TCP ports\n");
+	fprintf(stdout, "\t-U ADDR     serial ports as UDP to ADDR[:PORT], multicast or broadcast\n");
+	fprintf(stdout, "\t-L          lockstep with the simulator, one frame per packet at RATE\n");
+	fprintf(stdout, "\t-F          free running simulated clock with no simulator, for replay\n");
+	fprintf(stdout, "\t-I INSTANCE ports offset by 10*INSTANCE, files in directory instanceINSTANCE\n");
+	fprintf(stdout, "\t-M MODEL    built in simulator: +, x, y6, hexa, hexax, octa, octax, rover or rover-skid\n");
+	fprintf(stdout, "\t-O HOME     home for -M as lat,lng,alt,hdg\n");
 }
 
 void SITL_State::_parse_command_line(int argc, char * const argv[])
 {
 	int opt;
+	bool wipe = false;
+	const char *model = NULL;
+	const char *home = "-35.362938,149.165085,584,353";
 
 	signal(SIGFPE, _sig_fpe);
 
     setvbuf(stdout, (char *)0, _IONBF, 0);
     setvbuf(stderr, (char *)0, _IONBF, 0);
 
-	while ((opt = getopt(argc, argv, "swhr:H:C")) != -1) {
+	while ((opt = getopt(argc, argv, "swhr:H:CLFI:M:O:U:")) != -1) {
 		switch (opt) {
 		case 'w':
-			AP_Param::erase_all();
-			unlink("dataflash.bin");
+			wipe = true;
 			break;
 		case 'r':
 			_framerate = (unsigned)atoi(optarg);
@@ -84,12 +101,63 @@ void SITL_State::_parse_command_line(int argc, char * const argv[])
 		case 'C':
 			AVR_SITL::SITLUARTDriver::_console = true;
 			break;
+		case 'U':
+			AVR_SITL::SITLUARTDriver::_udp_address = optarg;
+			break;
+		case 'L':
+			_lockstep = true;
+			break;
+		case 'F':
+			_lockstep = true;
+			_free_run = true;
+			break;
+		case 'I':
+			_instance = (uint8_t)atoi(optarg);
+			break;
+		case 'M':
+			model = optarg;
+			break;
+		case 'O':
+			home = optarg;
+			break;
 		default:
 			_usage();
 			exit(1);
 		}
 	}
 
+	if (_instance != 0) {
+		// keep the eeprom, logs and other files of each instance apart
+		char dir[16];
+		snprintf(dir, sizeof(dir), "instance%u", (unsigned)_instance);
+		mkdir(dir, 0777);
+		if (chdir(dir) != 0) {
+			fprintf(stderr, "SITL: chdir %s failed - %s\n", dir, strerror(errno));
+			exit(1);
+		}
+	}
+
+	if (wipe) {
+		AP_Param::erase_all();
+		unlink("dataflash.bin");
+	}
+
+	if (model != NULL) {
+		if (strcmp(model, "rover") == 0) {
+			_sim_model = new Rover(home, false);
+		} else if (strcmp(model, "rover-skid") == 0) {
+			_sim_model = new Rover(home, true);
+		} else {
+			_sim_model = new MultiCopter(home, model);
+		}
+		fprintf(stdout, "Built in simulator '%s' at %s\n", model, home);
+	}
+
+	if (_free_run && _framerate == 0) {
+		// 1ms frames, so the sketch can step the clock finely
+		_framerate = 1000;
+	}
+
 	fprintf(stdout, "Starting sketch '%s'\n", SKETCH);
 
 	if (strcmp(SKETCH, "ArduCopter") == 0) {
@@ -124,10 +192,12 @@ void SITL_State::_sitl_setup(void)
 	_parent_pid = getppid();
 #endif
 	_rcout_addr.sin_family = AF_INET;
-	_rcout_addr.sin_port = htons(_rcout_port);
+	_rcout_addr.sin_port = htons(_rcout_port + port_offset());
 	inet_pton(AF_INET, "127.0.0.1", &_rcout_addr.sin_addr);
 
-	_setup_timer();
+	if (!_lockstep) {
+		_setup_timer();
+	}
 	_setup_fdm();
 	fprintf(stdout, "Starting SITL input\n");
 
@@ -160,7 +230,7 @@ void SITL_State::_setup_fdm(void)
 #ifdef HAVE_SOCK_SIN_LEN
 	sockaddr.sin_len = sizeof(sockaddr);
 #endif
-	sockaddr.sin_port = htons(_simin_port);
+	sockaddr.sin_port = htons(_simin_port + port_offset());
 	sockaddr.sin_family = AF_INET;
 
 	_sitl_fd = socket(AF_INET, SOCK_DGRAM, 0);
@@ -188,9 +258,6 @@ void SITL_State::_setup_fdm(void)
  */
 void SITL_State::_timer_handler(int signum)
 {
-	static uint32_t last_update_count;
-    static uint32_t last_pwm_input;
-
 	static bool in_timer;
 
 	if (in_timer || _scheduler->interrupts_are_blocked()){
@@ -218,30 +285,43 @@ void SITL_State::_timer_handler(int signum)
 	}
 #endif
 
-    // simulate RC input at 50Hz
-    if (hal.scheduler->millis() - last_pwm_input >= 20) {
-        last_pwm_input = hal.scheduler->millis();
-        pwm_valid = true;
-    }
-
 	/* check for packet from flight sim */
 	_fdm_input();
 
 	// send RC output to flight sim
 	_simulator_output();
 
+	_timer_tick();
+
+    _scheduler->sitl_end_atomic();
+	in_timer = false;
+}
+
+
+/*
+  one 1ms tick of the simulated hardware: feed the latest FDM state
+  to the sensors and run the APM timers
+ */
+void SITL_State::_timer_tick(void)
+{
+	static uint32_t last_update_count;
+    static uint32_t last_pwm_input;
+
+    // simulate RC input at 50Hz
+    if (hal.scheduler->millis() - last_pwm_input >= 20) {
+        last_pwm_input = hal.scheduler->millis();
+        pwm_valid = true;
+        pwm_frame_time_us = hal.scheduler->micros();
+    }
+
 	if (_update_count == 0 && _sitl != NULL) {
 		_update_gps(0, 0, 0, 0, 0, 0, false);
 		_scheduler->timer_event();
-        _scheduler->sitl_end_atomic();
-		in_timer = false;
 		return;
 	}
 
 	if (_update_count == last_update_count) {
 		_scheduler->timer_event();
-        _scheduler->sitl_end_atomic();
-		in_timer = false;
 		return;
 	}
 	last_update_count = _update_count;
@@ -262,9 +342,81 @@ void SITL_State::_timer_handler(int signum)
 	// trigger all APM timers. We do this last as it can re-enable
 	// interrupts, which can lead to recursion
 	_scheduler->timer_event();
+}
+
+
+/*
+  lockstep mode: wait for the next frame from the simulator, run the
+  timers over the frame period and send the servo outputs back. The
+  simulator steps once for each output it receives. A built in model
+  (-M) has nothing to wait for, it steps as the outputs are sent, and
+  a free running clock (-F) has no simulator at all
+ */
+void SITL_State::_lockstep_frame(void)
+{
+	uint32_t update_count = _update_count;
+
+	while (_sim_model == NULL && !_free_run && _update_count == update_count) {
+		struct timeval tv;
+		fd_set fds;
+
+		FD_ZERO(&fds);
+		FD_SET(_sitl_fd, &fds);
+		tv.tv_sec = 1;
+		tv.tv_usec = 0;
+		if (select(_sitl_fd+1, &fds, NULL, NULL, &tv) != 1) {
+#ifndef __CYGWIN__
+			/* make sure we die if our parent dies */
+			if (kill(_parent_pid, 0) != 0) {
+				exit(1);
+			}
+#endif
+			// the simulator may have started after us or lost our
+			// last output, so prod it again
+			_simulator_output();
+			continue;
+		}
+		_fdm_input();
+	}
+
+	uint64_t frame_end = _sim_time_usec + 1000000UL / _framerate;
 
+    _scheduler->sitl_begin_atomic();
+	while (_sim_time_usec < frame_end) {
+		// the same 1ms ticks as the timer in realtime mode
+		_sim_time_usec += 1000;
+		if (_sim_time_usec > frame_end) {
+			_sim_time_usec = frame_end;
+		}
+		_timer_tick();
+	}
     _scheduler->sitl_end_atomic();
-	in_timer = false;
+
+	_simulator_output();
+}
+
+
+/*
+  lockstep mode: process frames from the simulator until the clock
+  reaches the given time
+ */
+void SITL_State::wait_clock(uint64_t wait_time_usec)
+{
+	static bool in_wait;
+
+	if (in_wait) {
+		// a wait from within the timers of a frame can't wait for
+		// the simulator, so charge it to the clock directly
+		if (_sim_time_usec < wait_time_usec) {
+			_sim_time_usec = wait_time_usec;
+		}
+		return;
+	}
+	in_wait = true;
+	while (_sim_time_usec < wait_time_usec) {
+		_lockstep_frame();
+	}
+	in_wait = false;
 }
 
 
@@ -334,6 +486,7 @@ void SITL_State::_fdm_input(void)
 void SITL_State::_simulator_output(void)
 {
 	static uint32_t last_update;
+	static bool pwm_setup;
 	struct {
 		uint16_t pwm[11];
 		uint16_t speed, direction, turbulance;
@@ -343,7 +496,8 @@ void SITL_State::_simulator_output(void)
 	 * to change */
 	uint8_t i;
 
-	if (last_update == 0) {
+	if (!pwm_setup) {
+		pwm_setup = true;
 		for (i=0; i<11; i++) {
 			pwm_output[i] = 1000;
 		}
@@ -361,8 +515,10 @@ void SITL_State::_simulator_output(void)
         return;
     }
 
-	// output at chosen framerate
-	if (last_update != 0 && hal.scheduler->millis() - last_update < 1000/_framerate) {
+	// output at chosen framerate. In lockstep mode the frame loop
+	// sends once per frame
+	if (!_lockstep && last_update != 0 &&
+	    hal.scheduler->millis() - last_update < 1000/_framerate) {
 		return;
 	}
 	last_update = hal.scheduler->millis();
@@ -420,6 +576,20 @@ void SITL_State::_simulator_output(void)
 		control.speed = 0;
 	}
 
+	if (_sim_model != NULL) {
+		// step the built in model, in place of the round trip
+		// through an external simulator
+		Aircraft::sitl_input input;
+		memcpy(input.servos, control.pwm, sizeof(input.servos));
+		input.wind.speed = control.speed * 0.01f;
+		input.wind.direction = control.direction * 0.01f;
+		input.wind.turbulance = control.turbulance * 0.01f;
+		_sim_model->update(input);
+		_sim_model->fill_fdm(_sitl->state);
+		_update_count++;
+		return;
+	}
+
 	sendto(_sitl_fd, (void*)&control, sizeof(control), MSG_DONTWAIT, (const sockaddr *)&_rcout_addr, sizeof(_rcout_addr));
 }
 
@@ -474,7 +644,15 @@ void SITL_State::init(int argc, char * const argv[])
 	_parse_command_line(argc, argv);
 }
 
-// wait for serial input, or 100usec
+void SITL_State::uart_io(void)
+{
+    ((AVR_SITL::SITLUARTDriver*)hal.uartA)->_timer_tick();
+    ((AVR_SITL::SITLUARTDriver*)hal.uartB)->_timer_tick();
+    ((AVR_SITL::SITLUARTDriver*)hal.uartC)->_timer_tick();
+}
+
+// wait for serial input, or 100usec. In lockstep mode wait for the
+// next frame instead
 void SITL_State::loop_hook(void)
 {
     struct timeval tv;
@@ -498,10 +676,18 @@ void SITL_State::loop_hook(void)
         max_fd = max(fd, max_fd);
     }
     tv.tv_sec = 0;
-    tv.tv_usec = 100;
+    tv.tv_usec = _lockstep ? 0 : 100;
     fflush(stdout);
     fflush(stderr);
     select(max_fd+1, &fds, NULL, NULL, &tv);
+
+    uart_io();
+
+    if (_lockstep) {
+        // the main loop costs no simulated time, so give each pass a
+        // frame
+        wait_clock(_sim_time_usec + 1);
+    }
 }
 
 
@@ -20,6 +20,7 @@
 #include "../AP_InertialSensor/AP_InertialSensor.h"
 #include "../AP_Compass/AP_Compass.h"
 #include "../SITL/SITL.h"
+#include "../SITL/SIM_Aircraft.h"
 
 class HAL_AVR_SITL;
 
@@ -38,8 +39,22 @@ public:
     static uint16_t pwm_output[11];
     static uint16_t pwm_input[8];
     static bool pwm_valid;
+    static uint32_t pwm_frame_time_us;
     static void loop_hook(void);
 
+    // move data between the UART buffers and their sockets
+    static void uart_io(void);
+
+    // in lockstep mode the clock only moves on when a frame from the
+    // simulator has been processed
+    static bool lockstep(void) { return _lockstep; }
+    static uint64_t sim_time_usec(void) { return _sim_time_usec; }
+    static void wait_clock(uint64_t wait_time_usec);
+
+    // added to every TCP and UDP port, so several instances can run
+    // on one host
+    static uint16_t port_offset(void) { return _instance * 10; }
+
     // simulated airspeed
     static uint16_t airspeed_pin_value;
 
@@ -84,6 +99,8 @@ private:
 			    double xAccel, 	double yAccel, 	double zAccel,		// Local to plane
 			    float airspeed);
     static void _fdm_input(void);
+    static void _timer_tick(void);
+    static void _lockstep_frame(void);
     static void _simulator_output(void);
     static uint16_t _airspeed_sensor(float airspeed);
     static float _gyro_drift(void);
@@ -102,6 +119,11 @@ private:
     static pid_t _parent_pid;
     static uint32_t _update_count;
     static bool _motors_on;
+    static bool _lockstep;
+    static bool _free_run;
+    static uint8_t _instance;
+    static Aircraft *_sim_model;
+    static uint64_t _sim_time_usec;
 
     static AP_Baro_HIL *_barometer;
     static AP_InertialSensor_Stub *_ins;
@@ -5,8 +5,10 @@
 
 #include "AP_HAL_AVR_SITL.h"
 #include "Scheduler.h"
+#include "SITL_State.h"
 #include <sys/time.h>
 #include <unistd.h>
+#include <string.h>
 
 using namespace AVR_SITL;
 
@@ -20,11 +22,21 @@ volatile bool SITLScheduler::_timer_event_missed = false;
 AP_HAL::TimedProc SITLScheduler::_timer_proc[SITL_SCHEDULER_MAX_TIMER_PROCS] = {NULL};
 uint8_t SITLScheduler::_num_timer_procs = 0;
 bool SITLScheduler::_in_timer_proc = false;
+AP_HAL::Scheduler::TimerProcStats SITLScheduler::_timer_stats[SITL_SCHEDULER_MAX_TIMER_PROCS];
+uint32_t SITLScheduler::_late_ticks = 0;
+uint32_t SITLScheduler::_last_tick_us = 0;
+
+// the timer signal and simulator frames both come at 1kHz
+#define TIMER_TICK_US 1000
 
 AP_HAL::TimedProc SITLScheduler::_io_proc[SITL_SCHEDULER_MAX_TIMER_PROCS] = {NULL};
 uint8_t SITLScheduler::_num_io_procs = 0;
 bool SITLScheduler::_in_io_proc = false;
 
+AP_HAL::Scheduler::SlowProc SITLScheduler::_slow_proc[SITL_SCHEDULER_MAX_TIMER_PROCS];
+uint8_t SITLScheduler::_num_slow_procs = 0;
+uint8_t SITLScheduler::_next_slow_proc = 0;
+
 struct timeval SITLScheduler::_sketch_start_time;
 
 SITLScheduler::SITLScheduler()
@@ -37,6 +49,9 @@ void SITLScheduler::init(void *unused)
 
 uint32_t SITLScheduler::_micros() 
 {
+    if (SITL_State::lockstep()) {
+        return SITL_State::sim_time_usec();
+    }
 	struct timeval tp;
 	gettimeofday(&tp,NULL);
 	return 1.0e6*((tp.tv_sec + (tp.tv_usec*1.0e-6)) - 
@@ -51,6 +66,9 @@ uint32_t SITLScheduler::micros()
 
 uint32_t SITLScheduler::millis() 
 {
+    if (SITL_State::lockstep()) {
+        return SITL_State::sim_time_usec() / 1000;
+    }
 	struct timeval tp;
 	gettimeofday(&tp,NULL);
 	return 1.0e3*((tp.tv_sec + (tp.tv_usec*1.0e-6)) - 
@@ -60,6 +78,10 @@ uint32_t SITLScheduler::millis()
 
 void SITLScheduler::delay_microseconds(uint16_t usec) 
 {
+    if (SITL_State::lockstep()) {
+        SITL_State::wait_clock(SITL_State::sim_time_usec() + usec);
+        return;
+    }
 	uint32_t start = micros();
 	while (micros() - start < usec) {
 		usleep(usec - (micros() - start));
@@ -76,11 +98,17 @@ void SITLScheduler::delay(uint16_t ms)
             if (ms == 0) break;
             start += 1000;
         }
+        // the main loop isn't running the UARTs
+        SITL_State::uart_io();
         if (_min_delay_cb_ms <= ms) {
             if (_delay_cb) {
                 _delay_cb();
             }
         }
+        if (SITL_State::lockstep()) {
+            // the clock only moves on with frames from the simulator
+            SITL_State::wait_clock(SITL_State::sim_time_usec() + 1);
+        }
     }
 }
 
@@ -121,6 +149,22 @@ void SITLScheduler::register_io_process(AP_HAL::TimedProc proc)
 
 }
 
+void SITLScheduler::register_slow_process(AP_HAL::TimedProc proc, uint16_t period_us)
+{
+    for (uint8_t i = 0; i < _num_slow_procs; i++) {
+        if (_slow_proc[i].proc == proc) {
+            return;
+        }
+    }
+
+    if (_num_slow_procs < SITL_SCHEDULER_MAX_TIMER_PROCS) {
+        _slow_proc[_num_slow_procs].proc = proc;
+        _slow_proc[_num_slow_procs].period_us = period_us;
+        _slow_proc[_num_slow_procs].last_run = 0;
+        _num_slow_procs++;
+    }
+}
+
 void SITLScheduler::register_timer_failsafe(AP_HAL::TimedProc failsafe, uint32_t period_us) 
 {
     _failsafe = failsafe;
@@ -142,6 +186,20 @@ bool SITLScheduler::in_timerprocess() {
     return _in_timer_proc || _in_io_proc;
 }
 
+bool SITLScheduler::timer_proc_stats(uint8_t i, TimerProcStats &stats) {
+    if (i >= _num_timer_procs) {
+        return false;
+    }
+    stats = _timer_stats[i];
+    stats.proc = _timer_proc[i];
+    return true;
+}
+
+void SITLScheduler::clear_timer_stats() {
+    memset(_timer_stats, 0, sizeof(_timer_stats));
+    _late_ticks = 0;
+}
+
 bool SITLScheduler::system_initializing() {
     return !_initialized;
 }
@@ -170,6 +228,7 @@ void SITLScheduler::_run_timer_procs(bool called_from_isr)
 {
     uint32_t tnow = _micros();
     if (_in_timer_proc) {
+        _late_ticks++;
         // the timer calls took longer than the period of the
         // timer. This is bad, and may indicate a serious
         // driver failure. We can't just call the drivers
@@ -187,11 +246,22 @@ void SITLScheduler::_run_timer_procs(bool called_from_isr)
     }
     _in_timer_proc = true;
 
+    if (called_from_isr) {
+        if (_last_tick_us != 0 && tnow - _last_tick_us > 2*TIMER_TICK_US) {
+            _late_ticks++;
+        }
+        _last_tick_us = tnow;
+    }
+
     if (!_timer_suspended) {
-        // now call the timer based drivers
+        // now call the timer based drivers, timing each one
+        uint32_t tstart = tnow;
         for (int i = 0; i < _num_timer_procs; i++) {
             if (_timer_proc[i] != NULL) {
                 _timer_proc[i](tnow);
+                uint32_t tend = _micros();
+                _timer_stats[i].update(tstart, tend, TIMER_TICK_US);
+                tstart = tend;
             }
         }
     } else if (called_from_isr) {
@@ -221,6 +291,9 @@ void SITLScheduler::_run_io_procs(bool called_from_isr)
                 _io_proc[i](tnow);
             }
         }
+
+        // and at most one slow process, like the AVR timer
+        run_slow_procs(_slow_proc, _num_slow_procs, _next_slow_proc, tnow);
     } else if (called_from_isr) {
         _timer_event_missed = true;
     }
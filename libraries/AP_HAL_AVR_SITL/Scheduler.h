@@ -24,6 +24,7 @@ public:
 
     void     register_timer_process(AP_HAL::TimedProc);
     void     register_io_process(AP_HAL::TimedProc);
+    void     register_slow_process(AP_HAL::TimedProc, uint16_t period_us);
     void     suspend_timer_procs();
     void     resume_timer_procs();
 
@@ -31,6 +32,10 @@ public:
 
     void     register_timer_failsafe(AP_HAL::TimedProc, uint32_t period_us);
 
+    bool     timer_proc_stats(uint8_t i, TimerProcStats &stats);
+    uint32_t timer_late_ticks() { return _late_ticks; }
+    void     clear_timer_stats();
+
     bool     system_initializing();
     void     system_initialized();
 
@@ -62,6 +67,12 @@ private:
     static AP_HAL::TimedProc _io_proc[SITL_SCHEDULER_MAX_TIMER_PROCS];
     static uint8_t _num_timer_procs;
     static uint8_t _num_io_procs;
+    static SlowProc _slow_proc[SITL_SCHEDULER_MAX_TIMER_PROCS];
+    static uint8_t _num_slow_procs;
+    static uint8_t _next_slow_proc;
+    static TimerProcStats _timer_stats[SITL_SCHEDULER_MAX_TIMER_PROCS];
+    static uint32_t _late_ticks;
+    static uint32_t _last_tick_us;
     static bool    _in_timer_proc;
     static bool    _in_io_proc;
 
@@ -24,6 +24,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <arpa/inet.h>
 
 #include "print_vprintf.h"
 #include "UARTDriver.h"
@@ -32,6 +33,10 @@
 using namespace AVR_SITL;
 
 #define LISTEN_BASE_PORT 5760
+#define UDP_BASE_PORT    14550
+
+// the most sent or taken in per datagram in UDP mode
+#define UDP_DATAGRAM_SIZE 1472
 
 // On OSX, MSG_NOSIGNAL doesn't exist. The equivalent is to set SO_NOSIGPIPE
 // in setsockopt for the socket. However, if we just skip that, and don't use
@@ -42,6 +47,7 @@ using namespace AVR_SITL;
 #endif
 
 bool SITLUARTDriver::_console;
+const char *SITLUARTDriver::_udp_address;
 
 /* UARTDriver method implementations */
 
@@ -53,9 +59,15 @@ void SITLUARTDriver::begin(uint32_t baud, uint16_t rxSpace, uint16_t txSpace)
     if (rxSpace != 0) {
         _rxSpace = rxSpace;
     }
+    _readbuffer.set_size(max(_rxSpace, _max_buffer_size));
+    _writebuffer.set_size(max(_txSpace, _max_buffer_size));
     switch (_portNumber) {
     case 0:
-        _tcp_start_connection(true);
+        if (_udp_address != NULL && !_console) {
+            _udp_start_connection();
+        } else {
+            _tcp_start_connection(true);
+        }
         break;
 
     case 1:
@@ -65,7 +77,11 @@ void SITLUARTDriver::begin(uint32_t baud, uint16_t rxSpace, uint16_t txSpace)
         break;
         
     default:
-        _tcp_start_connection(false);
+        if (_udp_address != NULL && !_console) {
+            _udp_start_connection();
+        } else {
+            _tcp_start_connection(false);
+        }
         break;
     }
 }
@@ -81,90 +97,172 @@ int16_t SITLUARTDriver::available(void)
     if (!_connected) {
         return 0;
     }
-    
-    if (_select_check(_fd)) {
-#ifdef FIONREAD
-        // use FIONREAD to get exact value if possible
-        int num_ready;
-        if (ioctl(_fd, FIONREAD, &num_ready) == 0) {
-            if (num_ready > _rxSpace) {
-                return _rxSpace;
-            }
-            if (num_ready == 0) {
-                // EOF is reached
-                fprintf(stdout, "Closed connection on serial port %u\n", _portNumber);
-                close(_fd);
-                _connected = false;
-                return 0;
-            }
-            return num_ready;
-        }
-#endif
-        return 1; // best we can do is say 1 byte available
-    }
-    return 0;
+    return _readbuffer.available();
 }
 
-
-
 int16_t SITLUARTDriver::txspace(void) 
 {
-    // always claim there is space available
-    return _txSpace;
+    return _writebuffer.space();
 }
 
 int16_t SITLUARTDriver::read(void) 
 {
-    char c;
-
-    if (available() <= 0) {
+    uint8_t c;
+    if (!_readbuffer.pop(c)) {
         return -1;
     }
+    return c;
+}
 
-    if (_portNumber == 1) {
-        if (_sitlState->gps_read(_fd, &c, 1) == 1) {
-            return (uint8_t)c;
-        }
-        return -1;
-    }
-
-    if (_console) {
-        return ::read(0, &c, 1);
-    }
-
-    int n = recv(_fd, &c, 1, MSG_DONTWAIT | MSG_NOSIGNAL);
-    if (n <= 0) {
-        // the socket has reached EOF
-        close(_fd);
-        _connected = false;
-        fprintf(stdout, "Closed connection on serial port %u\n", _portNumber);
-        fflush(stdout);
-        return -1;
-    }
-    if (n == 1) {
-        return (uint8_t)c;
-    }
-    return -1;
+uint16_t SITLUARTDriver::read_implementation(uint8_t *buffer, uint16_t count)
+{
+    return _readbuffer.read(buffer, count);
 }
 
 void SITLUARTDriver::flush(void) 
 {
+    _flush_write_buffer();
 }
 
 size_t SITLUARTDriver::write(uint8_t c) 
 {
-    int flags = MSG_NOSIGNAL;
+    return write_implementation(&c, 1);
+}
+
+size_t SITLUARTDriver::write_implementation(const uint8_t *buffer, size_t size)
+{
     _check_connection();
     if (!_connected) {
         return 0;
     }
+    size_t written = 0;
+    while (written < size) {
+        uint16_t n = min(size - written, (size_t)0xFFFF);
+        uint16_t ret = _writebuffer.write(buffer + written, n);
+        written += ret;
+        if (ret == n) {
+            continue;
+        }
+        // full, so send some now. A non-blocking port loses what
+        // still doesn't fit
+        _flush_write_buffer();
+        if (!_connected || _writebuffer.space() == 0) {
+            break;
+        }
+    }
+    return written;
+}
+
+/*
+  called from SITL_State::uart_io() once per main loop, and during
+  delays
+ */
+void SITLUARTDriver::_timer_tick(void)
+{
+    _check_connection();
+    if (!_connected) {
+        return;
+    }
+    _flush_write_buffer();
+    _fill_read_buffer();
+}
+
+void SITLUARTDriver::_disconnect(void)
+{
+    close(_fd);
+    _fd = -1;
+    _connected = false;
+    _readbuffer.clear();
+    _writebuffer.clear();
+    fprintf(stdout, "Closed connection on serial port %u\n", _portNumber);
+    fflush(stdout);
+}
+
+/*
+  one read of everything waiting, as far as the buffer has room
+ */
+void SITLUARTDriver::_fill_read_buffer(void)
+{
+    uint16_t n;
+    uint8_t *p = _readbuffer.writable_span(n);
+    if (n == 0) {
+        return;
+    }
+
+    ssize_t ret;
+    if (_udp) {
+        // a datagram is taken whole, so it goes through a buffer big
+        // enough for it. What doesn't fit is lost, as with an overrun
+        // of a real port
+        uint8_t datagram[UDP_DATAGRAM_SIZE];
+        while (_readbuffer.space() != 0) {
+            ret = recv(_fd, datagram, sizeof(datagram), MSG_DONTWAIT);
+            if (ret <= 0) {
+                break;
+            }
+            _readbuffer.write(datagram, ret);
+        }
+        return;
+    } else if (_portNumber == 1) {
+        ret = _sitlState->gps_read(_fd, p, n);
+    } else if (_console) {
+        if (!_select_check(0)) {
+            return;
+        }
+        ret = ::read(0, p, n);
+    } else {
+        ret = recv(_fd, p, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (ret == 0 ||
+            (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            // the socket has reached EOF
+            _disconnect();
+            return;
+        }
+    }
+    if (ret > 0) {
+        _readbuffer.advance_write(ret);
+    }
+}
+
+/*
+  send what is waiting, in at most two calls when the data wraps
+  around the end of the buffer
+ */
+void SITLUARTDriver::_flush_write_buffer(void)
+{
+    int flags = MSG_NOSIGNAL;
     if (_nonblocking_writes) {
         flags |= MSG_DONTWAIT;
     }
-    if (_console) {
-        return ::write(_fd, &c, 1);
+    if (_udp) {
+        // one datagram for everything waiting, up to its size, even
+        // when it wraps around the end of the buffer
+        uint8_t datagram[UDP_DATAGRAM_SIZE];
+        while (!_writebuffer.empty()) {
+            uint16_t n = _writebuffer.read(datagram, sizeof(datagram));
+            sendto(_fd, datagram, n, flags,
+                   (const struct sockaddr *)&_udp_dest, sizeof(_udp_dest));
+        }
+        return;
+    }
+    while (_connected && !_writebuffer.empty()) {
+        uint16_t n;
+        const uint8_t *p = _writebuffer.readable_span(n);
+        ssize_t ret;
+        if (_console) {
+            ret = ::write(_fd, p, n);
+        } else {
+            ret = send(_fd, p, n, flags);
+        }
+        if (ret <= 0) {
+            return;
+        }
+        _writebuffer.advance_read(ret);
+        if (ret < n) {
+            // the socket is full
+            return;
+        }
     }
-    return send(_fd, &c, 1, flags);
 }
 
 // BetterStream method implementations /////////////////////////////////////////
@@ -236,7 +334,7 @@ void SITLUARTDriver::_tcp_start_connection(bool wait_for_connection)
 #ifdef HAVE_SOCK_SIN_LEN
             sockaddr.sin_len = sizeof(sockaddr);
 #endif
-            sockaddr.sin_port = htons(LISTEN_BASE_PORT + _portNumber);
+            sockaddr.sin_port = htons(LISTEN_BASE_PORT + _sitlState->port_offset() + _portNumber);
             sockaddr.sin_family = AF_INET;
 
             _listen_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -266,7 +364,8 @@ void SITLUARTDriver::_tcp_start_connection(bool wait_for_connection)
                 exit(1);
             }
 
-            fprintf(stderr, "Serial port %u on TCP port %u\n", _portNumber, LISTEN_BASE_PORT + _portNumber);
+            fprintf(stderr, "Serial port %u on TCP port %u\n", _portNumber,
+                    (unsigned)ntohs(sockaddr.sin_port));
             fflush(stdout);
         }
 
@@ -284,6 +383,73 @@ void SITLUARTDriver::_tcp_start_connection(bool wait_for_connection)
         }
 }
 
+/*
+  send the serial port to the -U address in datagrams, which may be a
+  multicast group or a broadcast address so that any number of
+  ground stations on the network can listen, from every vehicle of a
+  swarm at once. Serial port n goes to port PORT+n of it, PORT being
+  14550 unless given as ADDRESS:PORT. Instances are told apart by
+  their system ids, not their ports.
+
+  The socket is bound to a port of its own, so anyone can send to the
+  port from which the datagrams come, and we don't hear ourselves on
+  the group. There is nothing to wait for, so the port is connected
+  from the start
+ */
+void SITLUARTDriver::_udp_start_connection(void)
+{
+    if (_connected) {
+        return;
+    }
+
+    char host[64];
+    strncpy(host, _udp_address, sizeof(host)-1);
+    host[sizeof(host)-1] = 0;
+    uint16_t port = UDP_BASE_PORT;
+    char *colon = strchr(host, ':');
+    if (colon != NULL) {
+        *colon = 0;
+        port = (uint16_t)atoi(colon+1);
+    }
+
+    memset(&_udp_dest, 0, sizeof(_udp_dest));
+#ifdef HAVE_SOCK_SIN_LEN
+    _udp_dest.sin_len = sizeof(_udp_dest);
+#endif
+    _udp_dest.sin_family = AF_INET;
+    _udp_dest.sin_port = htons(port + _portNumber);
+    if (inet_pton(AF_INET, host, &_udp_dest.sin_addr) != 1) {
+        fprintf(stderr, "bad UDP address %s\n", _udp_address);
+        exit(1);
+    }
+
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd == -1) {
+        fprintf(stderr, "socket failed - %s\n", strerror(errno));
+        exit(1);
+    }
+
+    int one = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+    if (IN_MULTICAST(ntohl(_udp_dest.sin_addr.s_addr))) {
+        // ground stations on this machine hear the group too
+        unsigned char loop = 1;
+        setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    }
+
+    // the socket buffer holds what a slow loop leaves, so the ring
+    // buffers don't have to
+    int bufsize = 65536;
+    setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+    setsockopt(_fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+    _set_nonblocking(_fd);
+
+    _udp = true;
+    _connected = true;
+    fprintf(stderr, "Serial port %u on UDP %s:%u\n", _portNumber, host,
+            (unsigned)(port + _portNumber));
+}
+
 /*
   see if a new connection is coming in
  */
@@ -293,6 +459,10 @@ void SITLUARTDriver::_check_connection(void)
             // we only want 1 connection at a time
             return;
 	}
+	if (_listen_fd == -1) {
+            // not begun yet
+            return;
+	}
 	if (_select_check(_listen_fd)) {
             _fd = accept(_listen_fd, NULL, NULL);
             if (_fd != -1) {
@@ -300,6 +470,8 @@ void SITLUARTDriver::_check_connection(void)
                 _connected = true;
                 setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
                 setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                _readbuffer.clear();
+                _writebuffer.clear();
                 fprintf(stdout, "New connection on serial port %u\n", _portNumber);
             }
 	}
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdarg.h>
+#include <netinet/in.h>
 #include "AP_HAL_AVR_SITL_Namespace.h"
 
 class AVR_SITL::SITLUARTDriver : public AP_HAL::UARTDriver {
@@ -21,6 +22,7 @@ public:
         
         _fd = -1;
         _listen_fd = -1;
+        _udp = false;
 	}
 
     /* Implementations of UARTDriver virtual methods */
@@ -36,7 +38,7 @@ public:
     }
 
     bool tx_pending() {
-	    return false;
+	    return !_writebuffer.empty();
     }
 
     /* Implementations of BetterStream virtual methods */
@@ -53,25 +55,43 @@ public:
     int16_t available();
     int16_t txspace();
     int16_t read();
+    uint16_t read_implementation(uint8_t *buffer, uint16_t count);
 
     /* Implementations of Print virtual methods */
     size_t write(uint8_t c);
+    size_t write_implementation(const uint8_t *buffer, size_t size);
 
     // file descriptor, exposed so SITL_State::loop_hook() can use it
 	int _fd;
 
+    // send what has been written and take in what has arrived, with
+    // one system call each. Called from SITL_State::uart_io()
+    void _timer_tick(void);
+
 private:
     uint8_t _portNumber;
 	bool _connected; // true if a client has connected
 	int _listen_fd;  // socket we are listening on
 	int _serial_port;
 	static bool _console;
+	static const char *_udp_address; // from -U, NULL for TCP
 	bool _nonblocking_writes;
     uint16_t _rxSpace;
     uint16_t _txSpace;
 
+    // bytes are read from and written to these, and only moved to and
+    // from the file descriptor in bulk
+    RingBuffer<uint8_t> _readbuffer;
+    RingBuffer<uint8_t> _writebuffer;
+
     void _tcp_start_connection(bool wait_for_connection);
+    void _udp_start_connection(void);
+    bool _udp;                       // sending datagrams to _udp_dest
+    struct sockaddr_in _udp_dest;
     void _check_connection(void);
+    void _disconnect(void);
+    void _fill_read_buffer(void);
+    void _flush_write_buffer(void);
     static bool _select_check(int );
     static void _set_nonblocking(int );
 
@@ -81,10 +101,8 @@ private:
 	/// default transmit buffer size
 	static const uint16_t _default_tx_buffer_size = 16;
 
-	/// maxium tx/rx buffer size
-	/// @note if we could bring the max size down to 256, the mask and head/tail
-	///       pointers in the buffer could become uint8_t.
-	///
+	/// smallest size of the ring buffers. The socket or pipe holds
+	/// anything beyond this, so they only need to cover a loop
 	static const uint16_t _max_buffer_size = 512;
 
     SITL_State *_sitlState;
@@ -27,6 +27,11 @@ void EmptyAnalogSource::set_stop_pin(uint8_t p)
 void EmptyAnalogSource::set_settle_time(uint16_t settle_time_ms)
 {}
 
+bool EmptyAnalogSource::sample_ready(uint32_t &time_ms) {
+    // the value never changes
+    return false;
+}
+
 EmptyAnalogIn::EmptyAnalogIn()
 {}
 
@@ -14,6 +14,8 @@ public:
     void set_settle_time(uint16_t settle_time_ms);
     float voltage_average();
     float voltage_average_ratiometric() { return voltage_average(); }
+    void set_sample_rate(uint16_t rate_hz) {}
+    bool sample_ready(uint32_t &time_ms);
 private:
     float _v;
 };
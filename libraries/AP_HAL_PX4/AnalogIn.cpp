@@ -50,12 +50,22 @@ PX4AnalogSource::PX4AnalogSource(int16_t pin, float initial_value) :
     _value(initial_value),
     _latest_value(initial_value),
     _sum_count(0),
-    _sum_value(0)
+    _sum_value(0),
+    _sample_period_ms(0),
+    _dec_sum(0),
+    _dec_count(0),
+    _dec_start_ms(0),
+    _sample_value(initial_value),
+    _sample_time_ms(0),
+    _sample_ready(false)
 {
 }
 
 float PX4AnalogSource::read_average() 
 {
+    if (_sample_period_ms != 0) {
+        return _sample_value;
+    }
     if (_sum_count == 0) {
         return _value;
     }
@@ -100,9 +110,34 @@ void PX4AnalogSource::set_pin(uint8_t pin)
     _sum_count = 0;
     _latest_value = 0;
     _value = 0;
+    _dec_sum = 0;
+    _dec_count = 0;
+    _sample_value = 0;
+    _sample_ready = false;
     hal.scheduler->resume_timer_procs();
 }
 
+void PX4AnalogSource::set_sample_rate(uint16_t rate_hz)
+{
+    hal.scheduler->suspend_timer_procs();
+    _sample_period_ms = rate_hz ? 1000 / rate_hz : 0;
+    _dec_sum = 0;
+    _dec_count = 0;
+    _dec_start_ms = hal.scheduler->millis();
+    _sample_ready = false;
+    hal.scheduler->resume_timer_procs();
+}
+
+bool PX4AnalogSource::sample_ready(uint32_t &time_ms)
+{
+    if (!_sample_ready) {
+        return false;
+    }
+    time_ms = _sample_time_ms;
+    _sample_ready = false;
+    return true;
+}
+
 void PX4AnalogSource::_add_value(float v)
 {
     _latest_value = v;
@@ -112,6 +147,23 @@ void PX4AnalogSource::_add_value(float v)
         _sum_value /= 2;
         _sum_count /= 2;
     }
+
+    uint32_t now = hal.scheduler->millis();
+    if (_sample_period_ms == 0) {
+        _sample_time_ms = now;
+        _sample_ready = true;
+        return;
+    }
+    _dec_sum += v;
+    _dec_count++;
+    if (now - _dec_start_ms >= _sample_period_ms) {
+        _sample_value = _dec_sum / _dec_count;
+        _sample_time_ms = now;
+        _sample_ready = true;
+        _dec_sum = 0;
+        _dec_count = 0;
+        _dec_start_ms = now;
+    }
 }
 
 
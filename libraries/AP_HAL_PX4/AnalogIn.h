@@ -33,6 +33,9 @@ public:
     void set_stop_pin(uint8_t p) {}
     void set_settle_time(uint16_t settle_time_ms) {}
 
+    void set_sample_rate(uint16_t rate_hz);
+    bool sample_ready(uint32_t &time_ms);
+
 private:
     // what pin it is attached to
     int16_t _pin;
@@ -43,6 +46,15 @@ private:
     uint8_t _sum_count;
     float _sum_value;
     void _add_value(float v);
+
+    // decimating filter for the sample rate, run from the timer
+    uint16_t _sample_period_ms;
+    float _dec_sum;
+    uint16_t _dec_count;
+    uint32_t _dec_start_ms;
+    float _sample_value;
+    volatile uint32_t _sample_time_ms;
+    volatile bool _sample_ready;
 };
 
 class PX4::PX4AnalogIn : public AP_HAL::AnalogIn {
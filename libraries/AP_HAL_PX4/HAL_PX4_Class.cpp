@@ -110,6 +110,7 @@ static int main_loop(int argc, char **argv)
     extern void setup(void);
     extern void loop(void);
 
+    schedulerInstance.paint_stack(PX4_THREAD_MAIN, "main", APM_MAIN_STACK_SIZE);
 
     hal.uartA->begin(115200);
     hal.uartB->begin(38400);
@@ -230,7 +231,7 @@ void HAL_PX4::init(int argc, char * const argv[]) const
             daemon_task = task_spawn(SKETCHNAME,
                                      SCHED_FIFO,
                                      APM_MAIN_PRIORITY,
-                                     8192,
+                                     APM_MAIN_STACK_SIZE,
                                      main_loop,
                                      NULL);
             exit(0);
@@ -246,6 +247,9 @@ void HAL_PX4::init(int argc, char * const argv[]) const
                 printf("\t%s is exiting\n", SKETCHNAME);
             } else if (thread_running) {
                 printf("\t%s is running\n", SKETCHNAME);
+                uartADriver.print_stats("uartA");
+                uartBDriver.print_stats("uartB");
+                uartCDriver.print_stats("uartC");
             } else {
                 printf("\t%s is not started\n", SKETCHNAME);
             }
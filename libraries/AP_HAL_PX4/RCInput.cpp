@@ -12,6 +12,7 @@ extern const AP_HAL::HAL& hal;
 void PX4RCInput::init(void* unused)
 {
 	_perf_rcin = perf_alloc(PC_ELAPSED, "APM_rcin");
+	_last_frame_us = 0;
 	_rc_sub = orb_subscribe(ORB_ID(input_rc));
 	if (_rc_sub == -1) {
 		hal.scheduler->panic("Unable to subscribe to input_rc");		
@@ -89,6 +90,8 @@ void PX4RCInput::_timer_tick(void)
 	if (orb_check(_rc_sub, &rc_updated) == 0 && rc_updated) {
 		orb_copy(ORB_ID(input_rc), _rc_sub, &_rcin);
 		_last_input = _rcin.timestamp;
+		// the frame's hrt timestamp, on the micros() clock
+		_last_frame_us = hal.scheduler->micros() - (uint32_t)(hrt_absolute_time() - _rcin.timestamp);
 	} else if (hrt_absolute_time() - _last_input > 300000) {
 		// we've lost RC input, force channel 3 low
 		_rcin.values[2] = 900;
@@ -12,6 +12,7 @@ public:
     uint8_t  valid_channels();
     uint16_t read(uint8_t ch);
     uint8_t read(uint16_t* periods, uint8_t len);
+    uint32_t last_frame_time_us() { return _last_frame_us; }
 
     bool set_overrides(int16_t *overrides, uint8_t len);
     bool set_override(uint8_t channel, int16_t override);
@@ -26,6 +27,7 @@ private:
     int _rc_sub;
     uint64_t _last_read;
     uint64_t _last_input;
+    volatile uint32_t _last_frame_us;
     bool _override_valid;
     perf_counter_t _perf_rcin;
 };
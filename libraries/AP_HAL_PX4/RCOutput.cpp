@@ -165,7 +165,7 @@ void PX4RCOutput::write(uint8_t ch, uint16_t period_us)
 void PX4RCOutput::write(uint8_t ch, uint16_t* period_us, uint8_t len)
 {
     for (uint8_t i=0; i<len; i++) {
-        write(i, period_us[i]);
+        write(ch + i, period_us[i]);
     }
 }
 
@@ -184,6 +184,19 @@ void PX4RCOutput::read(uint16_t* period_us, uint8_t len)
     }
 }
 
+/*
+  send the corked writes from the caller's thread, which saves the
+  motors waiting up to a tick of the timer thread after the attitude
+  controller has run
+ */
+void PX4RCOutput::push(void)
+{
+    _corked = false;
+    if (_need_update) {
+        _send_outputs(hal.scheduler->micros());
+    }
+}
+
 void PX4RCOutput::_timer_tick(void)
 {
     uint32_t now = hal.scheduler->micros();
@@ -194,6 +207,17 @@ void PX4RCOutput::_timer_tick(void)
         _need_update = true;
     }
 
+    // a corked batch waits for push(), unless it has been held so
+    // long that the IO board could time out
+    if (_corked && now - _last_output <= 50000) {
+        return;
+    }
+
+    _send_outputs(now);
+}
+
+void PX4RCOutput::_send_outputs(uint32_t now)
+{
     if (_need_update && _pwm_fd != -1) {
         _need_update = false;
         perf_begin(_perf_rcout);
@@ -21,6 +21,8 @@ public:
     void     write(uint8_t ch, uint16_t* period_us, uint8_t len);
     uint16_t read(uint8_t ch);
     void     read(uint16_t* period_us, uint8_t len);
+    void     cork(void) { _corked = true; }
+    void     push(void);
 
     void _timer_tick(void);
 
@@ -31,11 +33,14 @@ private:
     uint16_t _period[PX4_NUM_OUTPUT_CHANNELS];
     volatile uint8_t _max_channel;
     volatile bool _need_update;
+    volatile bool _corked;
     perf_counter_t  _perf_rcout;
     uint32_t _last_output;
     unsigned _servo_count;
     unsigned _alt_servo_count;
     uint32_t _rate_mask;
+
+    void _send_outputs(uint32_t now);
 };
 
 #endif // __AP_HAL_PX4_RCOUTPUT_H__
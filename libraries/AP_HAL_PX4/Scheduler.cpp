@@ -15,6 +15,7 @@
 #include <nuttx/arch.h>
 #include <systemlib/systemlib.h>
 #include <poll.h>
+#include <string.h>
 
 #include "UARTDriver.h"
 #include "Storage.h"
@@ -27,22 +28,35 @@ extern const AP_HAL::HAL& hal;
 
 extern bool _px4_thread_should_exit;
 
+// the timer thread polls for 1ms between ticks
+#define TIMER_TICK_US 1000
+
+// the same sentinel as memcheck uses for the AVR stack
+#define STACK_SENTINEL 0x28021967
+
+// stack assumed to be in use above paint_stack() when it is called
+#define STACK_PAINT_MARGIN 512
+
 PX4Scheduler::PX4Scheduler() :
     _perf_timers(perf_alloc(PC_ELAPSED, "APM_timers")),
     _perf_io_timers(perf_alloc(PC_ELAPSED, "APM_IO_timers")),
-	_perf_delay(perf_alloc(PC_ELAPSED, "APM_delay"))
+    _perf_io_poll(perf_alloc(PC_ELAPSED, "APM_IO_poll")),
+	_perf_delay(perf_alloc(PC_ELAPSED, "APM_delay")),
+	_perf_worker(perf_alloc(PC_ELAPSED, "APM_worker"))
 {}
 
 void PX4Scheduler::init(void *unused) 
 {
     _sketch_start_time = hrt_absolute_time();
 
+    sem_init(&_main_signal, 0, 0);
+
     // setup the timer thread - this will call tasks at 1kHz
 	pthread_attr_t thread_attr;
 	struct sched_param param;
 
 	pthread_attr_init(&thread_attr);
-	pthread_attr_setstacksize(&thread_attr, 2048);
+	pthread_attr_setstacksize(&thread_attr, APM_TIMER_STACK_SIZE);
 
 	param.sched_priority = APM_TIMER_PRIORITY;
 	(void)pthread_attr_setschedparam(&thread_attr, &param);
@@ -52,13 +66,24 @@ void PX4Scheduler::init(void *unused)
 
     // the IO thread runs at lower priority
 	pthread_attr_init(&thread_attr);
-	pthread_attr_setstacksize(&thread_attr, 2048);
+	pthread_attr_setstacksize(&thread_attr, APM_IO_STACK_SIZE);
 
 	param.sched_priority = APM_IO_PRIORITY;
 	(void)pthread_attr_setschedparam(&thread_attr, &param);
     pthread_attr_setschedpolicy(&thread_attr, SCHED_FIFO);
 
 	pthread_create(&_io_thread_ctx, &thread_attr, (pthread_startroutine_t)&PX4::PX4Scheduler::_io_thread, this);
+
+    // the worker thread runs main loop tasks handed off by
+    // queue_worker_proc(), below the main and IO threads
+	pthread_attr_init(&thread_attr);
+	pthread_attr_setstacksize(&thread_attr, APM_WORKER_STACK_SIZE);
+
+	param.sched_priority = APM_WORKER_PRIORITY;
+	(void)pthread_attr_setschedparam(&thread_attr, &param);
+    pthread_attr_setschedpolicy(&thread_attr, SCHED_FIFO);
+
+	pthread_create(&_worker_thread_ctx, &thread_attr, (pthread_startroutine_t)&PX4::PX4Scheduler::_worker_thread, this);
 }
 
 uint32_t PX4Scheduler::micros() 
@@ -110,6 +135,31 @@ void PX4Scheduler::delay(uint16_t ms)
     }
 }
 
+void PX4Scheduler::signal_main(void)
+{
+    // keep the count at one at most, so a main loop that hasn't been
+    // waiting doesn't then return from several waits straight away
+    int value;
+    if (sem_getvalue(&_main_signal, &value) == 0 && value < 1) {
+        sem_post(&_main_signal);
+    }
+}
+
+bool PX4Scheduler::wait_for_signal(uint16_t timeout_us)
+{
+    if (_in_timer_proc) {
+        return false;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += timeout_us * 1000UL;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return sem_timedwait(&_main_signal, &ts) == 0;
+}
+
 void PX4Scheduler::register_delay_callback(AP_HAL::Proc proc,
                                             uint16_t min_time_ms) 
 {
@@ -149,11 +199,75 @@ void PX4Scheduler::register_io_process(AP_HAL::TimedProc proc)
     }
 }
 
+/*
+  slow processes run on the IO thread, so they never hold up the
+  timer thread's fast sensors
+ */
+void PX4Scheduler::register_slow_process(AP_HAL::TimedProc proc, uint16_t period_us)
+{
+    for (uint8_t i = 0; i < _num_slow_procs; i++) {
+        if (_slow_proc[i].proc == proc) {
+            return;
+        }
+    }
+
+    if (_num_slow_procs < PX4_SCHEDULER_MAX_TIMER_PROCS) {
+        _slow_proc[_num_slow_procs].proc = proc;
+        _slow_proc[_num_slow_procs].period_us = period_us;
+        _slow_proc[_num_slow_procs].last_run = 0;
+        // make sure the entry is visible before the IO thread can see it
+        __sync_synchronize();
+        _num_slow_procs++;
+    } else {
+        hal.console->printf("Out of slow processes\n");
+    }
+}
+
 void PX4Scheduler::register_timer_failsafe(AP_HAL::TimedProc failsafe, uint32_t period_us) 
 {
     _failsafe = failsafe;
 }
 
+/*
+  hand a procedure off to the worker thread. Only the main thread
+  may call this, which keeps the queue single producer
+ */
+bool PX4Scheduler::queue_worker_proc(AP_HAL::Proc proc, volatile bool *busy)
+{
+    uint8_t tail = _worker_tail;
+    uint8_t next = (tail + 1) & (PX4_SCHEDULER_WORKER_QUEUE_SIZE-1);
+    if (next == _worker_head) {
+        // queue full
+        return false;
+    }
+    _worker_queue[tail].proc = proc;
+    _worker_queue[tail].busy = busy;
+    // make sure the entry is visible before the worker can see it
+    __sync_synchronize();
+    _worker_tail = next;
+    return true;
+}
+
+/*
+  the stats are updated by the timer thread, so a copy taken while a
+  timer process runs may mix two runs
+ */
+bool PX4Scheduler::timer_proc_stats(uint8_t i, TimerProcStats &stats)
+{
+    if (i >= _num_timer_procs) {
+        return false;
+    }
+    stats = _timer_stats[i];
+    stats.proc = _timer_proc[i];
+    return true;
+}
+
+void PX4Scheduler::clear_timer_stats()
+{
+    memset(_timer_stats, 0, sizeof(_timer_stats));
+    _late_ticks = 0;
+}
+
 void PX4Scheduler::suspend_timer_procs() 
 {
     _timer_suspended = true;
@@ -177,15 +291,29 @@ void PX4Scheduler::_run_timers(bool called_from_timer_thread)
 {
     uint32_t tnow = micros();
     if (_in_timer_proc) {
+        if (called_from_timer_thread) {
+            _late_ticks++;
+        }
         return;
     }
     _in_timer_proc = true;
 
+    if (called_from_timer_thread) {
+        if (_last_tick_us != 0 && tnow - _last_tick_us > 2*TIMER_TICK_US) {
+            _late_ticks++;
+        }
+        _last_tick_us = tnow;
+    }
+
     if (!_timer_suspended) {
-        // now call the timer based drivers
+        // now call the timer based drivers, timing each one
+        uint32_t tstart = tnow;
         for (int i = 0; i < _num_timer_procs; i++) {
             if (_timer_proc[i] != NULL) {
                 _timer_proc[i](tnow);
+                uint32_t tend = micros();
+                _timer_stats[i].update(tstart, tend, TIMER_TICK_US);
+                tstart = tend;
             }
         }
     } else if (called_from_timer_thread) {
@@ -200,8 +328,46 @@ void PX4Scheduler::_run_timers(bool called_from_timer_thread)
     _in_timer_proc = false;
 }
 
+/*
+  paint from just below this function's frame to the bottom of the
+  stack. As paint_stack() calls nothing, the stack below it is unused
+ */
+__attribute__((noinline)) void PX4Scheduler::paint_stack(enum px4_thread thread, const char *name, uint16_t size)
+{
+    uint32_t marker;
+    uint32_t *high = (&marker) - 16;
+    uint32_t *low = high - (size - STACK_PAINT_MARGIN)/sizeof(uint32_t);
+    for (uint32_t *p = low; p < high; p++) {
+        *p = STACK_SENTINEL;
+    }
+    _stacks[thread].name = name;
+    _stacks[thread].size = size;
+    _stacks[thread].high = high;
+    _stacks[thread].low = low;
+}
+
+bool PX4Scheduler::thread_stack(uint8_t i, AP_HAL::Util::ThreadStack &stack)
+{
+    if (i >= PX4_THREAD_COUNT) {
+        return false;
+    }
+    stack.name = _stacks[i].name;
+    stack.size = _stacks[i].size;
+    stack.free = 0;
+    if (_stacks[i].low != NULL) {
+        const uint32_t *p = _stacks[i].low;
+        while (p < _stacks[i].high && *p == STACK_SENTINEL) {
+            p++;
+        }
+        stack.free = (p - _stacks[i].low) * sizeof(uint32_t);
+    }
+    return true;
+}
+
 void *PX4Scheduler::_timer_thread(void)
 {
+    paint_stack(PX4_THREAD_TIMER, "timer", APM_TIMER_STACK_SIZE);
+
     while (!_px4_thread_should_exit) {
         poll(NULL, 0, 1);
 
@@ -234,6 +400,9 @@ void PX4Scheduler::_run_io(void)
                 _io_proc[i](tnow);
             }
         }
+
+        // then the slow processes, one a tick at most
+        run_slow_procs(_slow_proc, _num_slow_procs, _next_slow_proc, tnow);
     }
 
     _in_io_proc = false;
@@ -241,13 +410,50 @@ void PX4Scheduler::_run_io(void)
 
 void *PX4Scheduler::_io_thread(void)
 {
+    paint_stack(PX4_THREAD_IO, "io", APM_IO_STACK_SIZE);
+
+    PX4UARTDriver *uarts[PX4_SCHEDULER_NUM_UARTS] = {
+        (PX4UARTDriver *)hal.uartA,
+        (PX4UARTDriver *)hal.uartB,
+        (PX4UARTDriver *)hal.uartC
+    };
+    struct pollfd fds[PX4_SCHEDULER_NUM_UARTS];
+
     while (!_px4_thread_should_exit) {
+        // sleep for the tick rather than until a port is ready, so a
+        // steady trickle of bytes doesn't wake the thread for each one
         poll(NULL, 0, 1);
 
-        // process any pending serial bytes
-        ((PX4UARTDriver *)hal.uartA)->_timer_tick();
-        ((PX4UARTDriver *)hal.uartB)->_timer_tick();
-        ((PX4UARTDriver *)hal.uartC)->_timer_tick();
+        // find which serial ports can move bytes with a single poll()
+        // of all that have something to do, then service just those
+        uint8_t nfds = 0;
+        short revents[PX4_SCHEDULER_NUM_UARTS];
+        int8_t fd_index[PX4_SCHEDULER_NUM_UARTS];
+        for (uint8_t i=0; i<PX4_SCHEDULER_NUM_UARTS; i++) {
+            revents[i] = 0;
+            fd_index[i] = -1;
+            short events = uarts[i]->_poll_events();
+            if (events != 0) {
+                fds[nfds].fd = uarts[i]->_get_fd();
+                fds[nfds].events = events;
+                fds[nfds].revents = 0;
+                fd_index[i] = nfds++;
+            }
+        }
+        if (nfds != 0) {
+            perf_begin(_perf_io_poll);
+            if (poll(fds, nfds, 0) > 0) {
+                for (uint8_t i=0; i<PX4_SCHEDULER_NUM_UARTS; i++) {
+                    if (fd_index[i] != -1) {
+                        revents[i] = fds[fd_index[i]].revents;
+                    }
+                }
+            }
+            perf_end(_perf_io_poll);
+        }
+        for (uint8_t i=0; i<PX4_SCHEDULER_NUM_UARTS; i++) {
+            uarts[i]->_timer_tick(revents[i]);
+        }
 
         // process any pending storage writes
         ((PX4Storage *)hal.storage)->_timer_tick();
@@ -260,6 +466,32 @@ void *PX4Scheduler::_io_thread(void)
     return NULL;
 }
 
+void *PX4Scheduler::_worker_thread(void)
+{
+    paint_stack(PX4_THREAD_WORKER, "worker", APM_WORKER_STACK_SIZE);
+
+    while (!_px4_thread_should_exit) {
+        uint8_t head = _worker_head;
+        if (head == _worker_tail) {
+            poll(NULL, 0, 1);
+            continue;
+        }
+        __sync_synchronize();
+        struct worker_entry &e = _worker_queue[head];
+
+        perf_begin(_perf_worker);
+        e.proc();
+        perf_end(_perf_worker);
+
+        if (e.busy != NULL) {
+            *e.busy = false;
+        }
+        __sync_synchronize();
+        _worker_head = (head + 1) & (PX4_SCHEDULER_WORKER_QUEUE_SIZE-1);
+    }
+    return NULL;
+}
+
 void PX4Scheduler::panic(const prog_char_t *errormsg) 
 {
     write(1, errormsg, strlen(errormsg));
@@ -8,16 +8,38 @@
 #include <sys/time.h>
 #include <signal.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <systemlib/perf_counter.h>
 
 #define PX4_SCHEDULER_MAX_TIMER_PROCS 8
 
+// the UARTs the IO thread services, uartA to uartC
+#define PX4_SCHEDULER_NUM_UARTS 3
+
+// size of the worker thread hand-off queue, must be a power of 2
+#define PX4_SCHEDULER_WORKER_QUEUE_SIZE 8
+
 #define APM_MAIN_PRIORITY    180
 #define APM_TIMER_PRIORITY   181
 #define APM_IO_PRIORITY       60
+#define APM_WORKER_PRIORITY   50
 #define APM_OVERTIME_PRIORITY 10
 #define APM_STARTUP_PRIORITY  10
 
+#define APM_MAIN_STACK_SIZE   8192
+#define APM_TIMER_STACK_SIZE  2048
+#define APM_IO_STACK_SIZE     2048
+#define APM_WORKER_STACK_SIZE 4096
+
+// the threads whose stacks thread_stack() measures
+enum px4_thread {
+    PX4_THREAD_MAIN = 0,
+    PX4_THREAD_TIMER,
+    PX4_THREAD_IO,
+    PX4_THREAD_WORKER,
+    PX4_THREAD_COUNT
+};
+
 /* Scheduler implementation: */
 class PX4::PX4Scheduler : public AP_HAL::Scheduler {
 public:
@@ -32,16 +54,28 @@ public:
     void     register_delay_callback(AP_HAL::Proc, uint16_t min_time_ms);
     void     register_timer_process(AP_HAL::TimedProc);
     void     register_io_process(AP_HAL::TimedProc);
+    void     register_slow_process(AP_HAL::TimedProc, uint16_t period_us);
     void     register_timer_failsafe(AP_HAL::TimedProc, uint32_t period_us);
+    bool     queue_worker_proc(AP_HAL::Proc, volatile bool *busy);
+    bool     timer_proc_stats(uint8_t i, TimerProcStats &stats);
+    uint32_t timer_late_ticks() { return _late_ticks; }
+    void     clear_timer_stats();
     void     suspend_timer_procs();
     void     resume_timer_procs();
     void     reboot();
     void     panic(const prog_char_t *errormsg);
 
     bool     in_timerprocess();
+    void     signal_main();
+    bool     wait_for_signal(uint16_t timeout_us);
     bool     system_initializing();
     void     system_initialized();
 
+    // fill the unused part of the calling thread's stack with a
+    // sentinel, so thread_stack() can find how much was ever used
+    void     paint_stack(enum px4_thread thread, const char *name, uint16_t size);
+    bool     thread_stack(uint8_t i, AP_HAL::Util::ThreadStack &stack);
+
 private:
     bool _initialized;
     AP_HAL::Proc _delay_cb;
@@ -56,24 +90,55 @@ private:
     uint8_t _num_timer_procs;
     volatile bool _in_timer_proc;
 
+    TimerProcStats _timer_stats[PX4_SCHEDULER_MAX_TIMER_PROCS];
+    volatile uint32_t _late_ticks;
+    uint32_t _last_tick_us;
+
     AP_HAL::TimedProc _io_proc[PX4_SCHEDULER_MAX_TIMER_PROCS];
     uint8_t _num_io_procs;
+    SlowProc _slow_proc[PX4_SCHEDULER_MAX_TIMER_PROCS];
+    volatile uint8_t _num_slow_procs;
+    uint8_t _next_slow_proc;
     volatile bool _in_io_proc;
 
     volatile bool _timer_event_missed;
 
+    // posted by signal_main(), waited on by wait_for_signal()
+    sem_t _main_signal;
+
+    // single producer (main thread), single consumer (worker thread)
+    // queue. _worker_tail is only written by the main thread and
+    // _worker_head only by the worker thread
+    struct worker_entry {
+        AP_HAL::Proc proc;
+        volatile bool *busy;
+    } _worker_queue[PX4_SCHEDULER_WORKER_QUEUE_SIZE];
+    volatile uint8_t _worker_head;
+    volatile uint8_t _worker_tail;
+
+    struct {
+        const char *name;
+        const uint32_t *low;    // lowest painted word
+        const uint32_t *high;   // above the highest painted word
+        uint16_t size;
+    } _stacks[PX4_THREAD_COUNT];
+
     pthread_t _timer_thread_ctx;
     pthread_t _io_thread_ctx;
+    pthread_t _worker_thread_ctx;
 
     void *_timer_thread(void);
     void *_io_thread(void);
+    void *_worker_thread(void);
 
     void _run_timers(bool called_from_timer_thread);
     void _run_io(void);
 
     perf_counter_t  _perf_timers;
     perf_counter_t  _perf_io_timers;
+    perf_counter_t  _perf_io_poll;
     perf_counter_t  _perf_delay;
+    perf_counter_t  _perf_worker;
 };
 #endif
 #endif // __AP_HAL_PX4_SCHEDULER_H__
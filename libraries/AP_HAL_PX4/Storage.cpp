@@ -13,17 +13,47 @@
 using namespace PX4;
 
 /*
-  This stores 'eeprom' data on the SD card, with a 4k size, and a
+  This stores 'eeprom' data on the SD card, with a 16k size, and a
   in-memory buffer. This keeps the latency down.
+
+  The file holds two copies of the image, each behind a header with a
+  sequence number and CRC. Changes are committed to the older copy
+  and its header is written last, so if power is lost part way
+  through a commit the newer copy is still intact. Writes are
+  coalesced until they go quiet, so a burst of parameter saves costs
+  a single commit and a single fsync.
  */
 
 // name the storage file after the sketch so you can use the same sd
 // card for ArduCopter and ArduPlane
 #define STORAGE_DIR "/fs/microsd/APM"
-#define STORAGE_FILE STORAGE_DIR "/" SKETCHNAME ".stg"
+#define STORAGE_FILE STORAGE_DIR "/" SKETCHNAME ".stj"
+
+// single image file used by older firmware, imported if there is no
+// journal yet
+#define STORAGE_FILE_OLD STORAGE_DIR "/" SKETCHNAME ".stg"
+
+#define STORAGE_MAGIC 0x4A545341 // "ASTJ"
+#define STORAGE_SLOT_SIZE (sizeof(struct slot_header) + PX4_STORAGE_SIZE)
 
 extern const AP_HAL::HAL& hal;
 
+/*
+  standard CRC32, bitwise to save flash. This only runs once per
+  commit
+ */
+uint32_t PX4Storage::_crc32(const uint8_t *data, uint16_t len)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	while (len--) {
+		crc ^= *data++;
+		for (uint8_t i=0; i<8; i++) {
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+		}
+	}
+	return ~crc;
+}
+
 void PX4Storage::_storage_create(void)
 {
 	mkdir(STORAGE_DIR, 0777);
@@ -32,14 +62,71 @@ void PX4Storage::_storage_create(void)
 	if (fd == -1) {
 		hal.scheduler->panic("Failed to create " STORAGE_FILE);
 	}
-	for (uint16_t loc=0; loc<sizeof(_buffer); loc += PX4_STORAGE_MAX_WRITE) {
-		if (write(fd, &_buffer[loc], PX4_STORAGE_MAX_WRITE) != PX4_STORAGE_MAX_WRITE) {
-			hal.scheduler->panic("Error filling " STORAGE_FILE);			
+	struct slot_header hdr;
+	hdr.magic = STORAGE_MAGIC;
+	hdr.crc = _crc32(_buffer, sizeof(_buffer));
+	hdr.reserved = 0;
+	for (uint8_t slot=0; slot<2; slot++) {
+		hdr.sequence = slot+1;
+		if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+			hal.scheduler->panic("Error filling " STORAGE_FILE);
+		}
+		for (uint16_t loc=0; loc<sizeof(_buffer); loc += PX4_STORAGE_MAX_WRITE) {
+			if (write(fd, &_buffer[loc], PX4_STORAGE_MAX_WRITE) != PX4_STORAGE_MAX_WRITE) {
+				hal.scheduler->panic("Error filling " STORAGE_FILE);
+			}
 		}
 	}
 	// ensure the directory is updated with the new size
 	fsync(fd);
 	close(fd);
+	_active_slot = 1;
+	_sequence = 2;
+	_slot_dirty[0] = _slot_dirty[1] = 0;
+}
+
+/*
+  read one slot of a journal of images of the given size, returning
+  true if it holds a valid image
+ */
+bool PX4Storage::_read_slot(int fd, uint8_t slot, uint8_t *data, uint16_t size, uint32_t &sequence)
+{
+	struct slot_header hdr;
+	off_t ofs = slot*(sizeof(hdr) + size);
+	if (lseek(fd, ofs, SEEK_SET) != ofs ||
+	    read(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+	    read(fd, data, size) != size) {
+		return false;
+	}
+	if (hdr.magic != STORAGE_MAGIC || hdr.crc != _crc32(data, size)) {
+		return false;
+	}
+	sequence = hdr.sequence;
+	return true;
+}
+
+/*
+  load the newer valid image of the journal into _buffer, with the
+  bytes beyond the image size zeroed
+ */
+bool PX4Storage::_read_journal(int fd, uint16_t size)
+{
+	uint32_t seq0 = 0, seq1 = 0;
+	memset(_buffer, 0, sizeof(_buffer));
+	memset(_commit_buffer, 0, sizeof(_commit_buffer));
+	bool valid0 = _read_slot(fd, 0, _buffer, size, seq0);
+	bool valid1 = _read_slot(fd, 1, _commit_buffer, size, seq1);
+	if (valid1 && (!valid0 || (int32_t)(seq1 - seq0) > 0)) {
+		memcpy(_buffer, _commit_buffer, sizeof(_buffer));
+		_active_slot = 1;
+		_sequence = seq1;
+	} else if (valid0) {
+		_active_slot = 0;
+		_sequence = seq0;
+	} else {
+		return false;
+	}
+	return true;
 }
 
 void PX4Storage::_storage_open(void)
@@ -49,26 +136,40 @@ void PX4Storage::_storage_open(void)
 	}
 
 	_dirty_mask = 0;
+	_committing = false;
 	int fd = open(STORAGE_FILE, O_RDONLY);
-	if (fd == -1) {
-		_storage_create();
-		fd = open(STORAGE_FILE, O_RDONLY);
-		if (fd == -1) {
-			hal.scheduler->panic("Failed to open " STORAGE_FILE);
+	if (fd != -1) {
+		if (_read_journal(fd, PX4_STORAGE_SIZE)) {
+			close(fd);
+			// the other slot may differ anywhere, so the first
+			// commit rewrites all of it
+			_slot_dirty[_active_slot] = 0;
+			_slot_dirty[_active_slot^1] = PX4_STORAGE_ALL_LINES;
+			_initialised = true;
+			return;
 		}
-	}
-	if (read(fd, _buffer, sizeof(_buffer)) != sizeof(_buffer)) {
+		bool old_journal = _read_journal(fd, PX4_STORAGE_SIZE_OLD);
 		close(fd);
-		_storage_create();
-		fd = open(STORAGE_FILE, O_RDONLY);
-		if (fd == -1) {
-			hal.scheduler->panic("Failed to open " STORAGE_FILE);
+		if (old_journal) {
+			// written by older firmware with smaller images,
+			// so write it out again at the new size
+			_storage_create();
+			_initialised = true;
+			return;
 		}
-		if (read(fd, _buffer, sizeof(_buffer)) != sizeof(_buffer)) {
-			hal.scheduler->panic("Failed to read " STORAGE_FILE);
+	}
+
+	// no usable journal. Import the old single image file if there
+	// is one, otherwise start empty
+	memset(_buffer, 0, sizeof(_buffer));
+	fd = open(STORAGE_FILE_OLD, O_RDONLY);
+	if (fd != -1) {
+		if (read(fd, _buffer, PX4_STORAGE_SIZE_OLD) != PX4_STORAGE_SIZE_OLD) {
+			memset(_buffer, 0, sizeof(_buffer));
 		}
+		close(fd);
 	}
-	close(fd);
+	_storage_create();
 	_initialised = true;
 }
 
@@ -81,10 +182,15 @@ void PX4Storage::_storage_open(void)
  */
 void PX4Storage::_mark_dirty(uint16_t loc, uint16_t length)
 {
+	uint32_t now = hal.scheduler->millis();
+	if (_dirty_mask == 0) {
+		_first_change_ms = now;
+	}
+	_last_change_ms = now;
 	uint16_t end = loc + length;
 	while (loc < end) {
 		uint8_t line = (loc >> PX4_STORAGE_LINE_SHIFT);
-		_dirty_mask |= 1 << line;
+		_dirty_mask |= 1U << line;
 		loc += PX4_STORAGE_LINE_SIZE;
 	}
 }
@@ -177,70 +283,126 @@ void PX4Storage::write_block(uint16_t loc, const void *src, size_t n)
 	}
 }
 
-void PX4Storage::_timer_tick(void)
+/*
+  write out the first run of lines that slot is missing. We don't
+  write more than PX4_STORAGE_MAX_WRITE bytes to keep the latency of
+  each call to a minimum
+ */
+bool PX4Storage::_write_lines(uint8_t slot)
 {
-	if (!_initialised || _dirty_mask == 0) {
-		return;
-	}
-	perf_begin(_perf_storage);
-
-	if (_fd == -1) {
-		_fd = open(STORAGE_FILE, O_WRONLY);
-		if (_fd == -1) {
-			perf_end(_perf_storage);
-			perf_count(_perf_errors);
-			return;	
-		}
-	}
-
-	// write out the first dirty set of lines. We don't write more
-	// than one to keep the latency of this call to a minimum
 	uint8_t i, n;
 	for (i=0; i<PX4_STORAGE_NUM_LINES; i++) {
-		if (_dirty_mask & (1<<i)) {
+		if (_slot_dirty[slot] & (1U<<i)) {
 			break;
 		}
 	}
 	if (i == PX4_STORAGE_NUM_LINES) {
 		// this shouldn't be possible
-		perf_end(_perf_storage);
-		perf_count(_perf_errors);
-		return;
+		_slot_dirty[slot] = 0;
+		return false;
 	}
 	uint32_t write_mask = (1U<<i);
 	// see how many lines to write
 	for (n=1; (i+n) < PX4_STORAGE_NUM_LINES && 
 		     n < (PX4_STORAGE_MAX_WRITE>>PX4_STORAGE_LINE_SHIFT); n++) {
-		if (!(_dirty_mask & (1<<(n+i)))) {
+		if (!(_slot_dirty[slot] & (1U<<(n+i)))) {
 			break;
 		}		
-		// mark that line clean
-		write_mask |= (1<<(n+i));
-	}
-
-	/*
-	  write the lines. This also updates _dirty_mask. Note that
-	  because this is a SCHED_FIFO thread it will not be preempted
-	  by the main task except during blocking calls. This means we
-	  don't need a semaphore around the _dirty_mask updates.
-	 */
-	if (lseek(_fd, i<<PX4_STORAGE_LINE_SHIFT, SEEK_SET) == (i<<PX4_STORAGE_LINE_SHIFT)) {
-		_dirty_mask &= ~write_mask;
-		if (write(_fd, &_buffer[i<<PX4_STORAGE_LINE_SHIFT], n<<PX4_STORAGE_LINE_SHIFT) != n<<PX4_STORAGE_LINE_SHIFT) {
-			// write error - likely EINTR
-			_dirty_mask |= write_mask;
-			close(_fd);
-			_fd = -1;
+		write_mask |= (1U<<(n+i));
+	}
+
+	off_t ofs = slot*STORAGE_SLOT_SIZE + sizeof(struct slot_header) + (i<<PX4_STORAGE_LINE_SHIFT);
+	if (lseek(_fd, ofs, SEEK_SET) != ofs ||
+	    write(_fd, &_commit_buffer[i<<PX4_STORAGE_LINE_SHIFT], n<<PX4_STORAGE_LINE_SHIFT) != n<<PX4_STORAGE_LINE_SHIFT) {
+		// write error - likely EINTR
+		return false;
+	}
+	_slot_dirty[slot] &= ~write_mask;
+	return true;
+}
+
+/*
+  complete a commit by writing the slot header and syncing. Until
+  the header lands the slot fails its CRC check, so the other slot
+  is used on the next boot
+ */
+bool PX4Storage::_write_header(uint8_t slot)
+{
+	struct slot_header hdr;
+	hdr.magic = STORAGE_MAGIC;
+	hdr.sequence = _sequence+1;
+	hdr.crc = _crc32(_commit_buffer, sizeof(_commit_buffer));
+	hdr.reserved = 0;
+	off_t ofs = slot*STORAGE_SLOT_SIZE;
+	if (lseek(_fd, ofs, SEEK_SET) != ofs ||
+	    write(_fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+	    fsync(_fd) != 0) {
+		return false;
+	}
+	_sequence = hdr.sequence;
+	_active_slot = slot;
+	return true;
+}
+
+void PX4Storage::_timer_tick(void)
+{
+	if (!_initialised) {
+		return;
+	}
+	if (!_committing) {
+		if (_dirty_mask == 0) {
+			return;
+		}
+		uint32_t now = hal.scheduler->millis();
+		if (now - _last_change_ms < PX4_STORAGE_COMMIT_QUIET_MS &&
+		    now - _first_change_ms < PX4_STORAGE_COMMIT_MAX_MS) {
+			// wait for more writes to coalesce
+			return;
+		}
+		/*
+		  take a snapshot to commit. _dirty_mask is cleared
+		  before the copy so a write that races with the copy
+		  is committed again next time. Note that because this
+		  is a SCHED_FIFO thread it will not be preempted by
+		  the main task except during blocking calls. This
+		  means we don't need a semaphore around the
+		  _dirty_mask updates.
+		 */
+		uint32_t mask = _dirty_mask;
+		_dirty_mask = 0;
+		memcpy(_commit_buffer, _buffer, sizeof(_buffer));
+		_slot_dirty[0] |= mask;
+		_slot_dirty[1] |= mask;
+		_committing = true;
+	}
+
+	perf_begin(_perf_storage);
+
+	if (_fd == -1) {
+		_fd = open(STORAGE_FILE, O_RDWR);
+		if (_fd == -1) {
+			perf_end(_perf_storage);
 			perf_count(_perf_errors);
+			return;	
 		}
-		if (_dirty_mask == 0) {
-			if (fsync(_fd) != 0) {
-				close(_fd);
-				_fd = -1;
-				perf_count(_perf_errors);
-			}
+	}
+
+	// always commit to the older slot
+	uint8_t slot = _active_slot ^ 1;
+	bool ok;
+	if (_slot_dirty[slot] != 0) {
+		ok = _write_lines(slot);
+	} else {
+		ok = _write_header(slot);
+		if (ok) {
+			_committing = false;
 		}
 	}
+	if (!ok) {
+		close(_fd);
+		_fd = -1;
+		perf_count(_perf_errors);
+	}
 	perf_end(_perf_storage);
 }
 
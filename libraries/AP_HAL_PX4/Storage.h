@@ -7,17 +7,33 @@
 #include "AP_HAL_PX4_Namespace.h"
 #include <systemlib/perf_counter.h>
 
-#define PX4_STORAGE_SIZE 4096
+#define PX4_STORAGE_SIZE 16384
 #define PX4_STORAGE_MAX_WRITE 512
 #define PX4_STORAGE_LINE_SHIFT 9
 #define PX4_STORAGE_LINE_SIZE (1<<PX4_STORAGE_LINE_SHIFT)
 #define PX4_STORAGE_NUM_LINES (PX4_STORAGE_SIZE/PX4_STORAGE_LINE_SIZE)
+#define PX4_STORAGE_ALL_LINES (0xFFFFFFFFU >> (32-PX4_STORAGE_NUM_LINES))
+
+// size of the image of older firmware, which is imported into the
+// start of the bigger one
+#define PX4_STORAGE_SIZE_OLD 4096
+
+// a commit is started once writes have been quiet for
+// PX4_STORAGE_COMMIT_QUIET_MS, or PX4_STORAGE_COMMIT_MAX_MS after the
+// first uncommitted write if they keep coming
+#define PX4_STORAGE_COMMIT_QUIET_MS 250
+#define PX4_STORAGE_COMMIT_MAX_MS   2000
 
 class PX4::PX4Storage : public AP_HAL::Storage {
 public:
     PX4Storage() :
 	_fd(-1),
 	_dirty_mask(0),
+	_first_change_ms(0),
+	_last_change_ms(0),
+	_committing(false),
+	_active_slot(0),
+	_sequence(0),
 	_perf_storage(perf_alloc(PC_ELAPSED, "APM_storage")),
 	_perf_errors(perf_alloc(PC_COUNT, "APM_storage_errors"))
 	{}
@@ -35,13 +51,38 @@ public:
     void _timer_tick(void);
 
 private:
+    // each of the two slots in the journal file is this header
+    // followed by a full image
+    struct slot_header {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t crc;
+        uint32_t reserved;
+    };
+
     int _fd;
     volatile bool _initialised;
     void _storage_create(void);
     void _storage_open(void);
+    bool _read_slot(int fd, uint8_t slot, uint8_t *data, uint16_t size, uint32_t &sequence);
+    bool _read_journal(int fd, uint16_t size);
+    bool _write_lines(uint8_t slot);
+    bool _write_header(uint8_t slot);
+    static uint32_t _crc32(const uint8_t *data, uint16_t len);
     void _mark_dirty(uint16_t loc, uint16_t length);
     uint8_t _buffer[PX4_STORAGE_SIZE];
+
+    // snapshot of _buffer being committed
+    uint8_t _commit_buffer[PX4_STORAGE_SIZE];
     volatile uint32_t _dirty_mask;
+    volatile uint32_t _first_change_ms;
+    volatile uint32_t _last_change_ms;
+
+    // lines each slot is missing relative to _commit_buffer
+    uint32_t _slot_dirty[2];
+    bool _committing;
+    uint8_t _active_slot;
+    uint32_t _sequence;
     perf_counter_t  _perf_storage;
     perf_counter_t  _perf_errors;
 };
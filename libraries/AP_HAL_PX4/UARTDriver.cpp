@@ -14,6 +14,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <termios.h>
+#include <poll.h>
 #include <drivers/drv_hrt.h>
 #include <assert.h>
 
@@ -23,8 +24,18 @@ extern const AP_HAL::HAL& hal;
 
 PX4UARTDriver::PX4UARTDriver(const char *devpath, const char *perf_name) :
 	_devpath(devpath),
-    _perf_uart(perf_alloc(PC_ELAPSED, perf_name))
-{}
+    _perf_uart(perf_alloc(PC_ELAPSED, perf_name)),
+    _perf_short_writes(NULL),
+    _total_written(0),
+    _rx_notify(NULL),
+    _rx_notify_pending(false)
+{
+    // the perf library keeps the name pointer, so this is never freed
+    char *short_name = NULL;
+    if (asprintf(&short_name, "%s_short", perf_name) > 0) {
+        _perf_short_writes = perf_alloc(PC_COUNT, short_name);
+    }
+}
 
 
 extern const AP_HAL::HAL& hal;
@@ -83,30 +94,18 @@ void PX4UARTDriver::begin(uint32_t b, uint16_t rxS, uint16_t txS)
     /*
       allocate the read buffer
      */
-	if (rxS != 0 && rxS != _readbuf_size) {
-		_readbuf_size = rxS;
-		if (_readbuf != NULL) {
-			free(_readbuf);
-		}
-		_readbuf = (uint8_t *)malloc(_readbuf_size);
-		_readbuf_head = 0;
-		_readbuf_tail = 0;
+	if (rxS != 0) {
+		_readbuf.set_size(rxS);
 	}
 
     /*
       allocate the write buffer
      */
-	if (txS != 0 && txS != _writebuf_size) {
-		_writebuf_size = txS;
-		if (_writebuf != NULL) {
-			free(_writebuf);
-		}
-		_writebuf = (uint8_t *)malloc(_writebuf_size+16);
-		_writebuf_head = 0;
-		_writebuf_tail = 0;
+	if (txS != 0) {
+		_writebuf.set_size(txS);
 	}
 
-    if (_writebuf_size != 0 && _readbuf_size != 0) {
+    if (_writebuf.size() != 0 && _readbuf.size() != 0) {
         _initialised = true;
     }
 }
@@ -126,6 +125,21 @@ void PX4UARTDriver::set_blocking_writes(bool blocking)
 }
 bool PX4UARTDriver::tx_pending() { return false; }
 
+/*
+  call proc from the IO thread when enough bytes have arrived, or the
+  line has gone quiet. The IO thread already polls the port every
+  millisecond, so this costs nothing extra
+ */
+bool PX4UARTDriver::set_rx_notify(AP_HAL::Proc proc, uint16_t min_bytes, uint32_t idle_us)
+{
+    _rx_notify = NULL;
+    _rx_notify_min_bytes = min_bytes;
+    _rx_notify_idle_us = idle_us;
+    _rx_notify_pending = false;
+    _rx_notify = proc;
+    return true;
+}
+
 /* PX4 implementations of BetterStream virtual methods */
 void PX4UARTDriver::print_P(const prog_char_t *pstr) {
 	print(pstr);
@@ -199,15 +213,6 @@ void PX4UARTDriver::_vprintf(const char *fmt, va_list ap)
 }
 
 
-/*
-  buffer handling macros
- */
-#define BUF_AVAILABLE(buf) ((buf##_head > (_tail=buf##_tail))? (buf##_size - buf##_head) + _tail: _tail - buf##_head)
-#define BUF_SPACE(buf) (((_head=buf##_head) > buf##_tail)?(_head - buf##_tail) - 1:((buf##_size - buf##_tail) + _head) - 1)
-#define BUF_EMPTY(buf) (buf##_head == buf##_tail)
-#define BUF_ADVANCETAIL(buf, n) buf##_tail = (buf##_tail + n) % buf##_size
-#define BUF_ADVANCEHEAD(buf, n) buf##_head = (buf##_head + n) % buf##_size
-
 /*
   return number of bytes available to be read from the buffer
  */
@@ -216,8 +221,7 @@ int16_t PX4UARTDriver::available()
 	if (!_initialised) {
 		return 0;
 	}
-    uint16_t _tail;
-    return BUF_AVAILABLE(_readbuf);
+    return _readbuf.available();
 }
 
 /*
@@ -228,8 +232,7 @@ int16_t PX4UARTDriver::txspace()
 	if (!_initialised) {
 		return 0;
 	}
-    uint16_t _head;
-    return BUF_SPACE(_writebuf);
+    return _writebuf.space();
 }
 
 /*
@@ -238,17 +241,26 @@ int16_t PX4UARTDriver::txspace()
 int16_t PX4UARTDriver::read() 
 { 
 	uint8_t c;
-	if (!_initialised || _readbuf == NULL) {
+	if (!_initialised) {
 		return -1;
 	}
-    if (BUF_EMPTY(_readbuf)) {
+    if (!_readbuf.pop(c)) {
         return -1;
     }
-    c = _readbuf[_readbuf_head];
-    BUF_ADVANCEHEAD(_readbuf, 1);
 	return c;
 }
 
+/*
+  read up to count bytes from the read buffer
+ */
+uint16_t PX4UARTDriver::read_implementation(uint8_t *buffer, uint16_t count)
+{
+	if (!_initialised) {
+		return 0;
+	}
+    return _readbuf.read(buffer, count);
+}
+
 /* 
    write one byte to the buffer
  */
@@ -261,23 +273,20 @@ size_t PX4UARTDriver::write(uint8_t c)
         // not allowed from timers
         return 0;
     }
-    uint16_t _head;
-
-    while (BUF_SPACE(_writebuf) == 0) {
+    while (_writebuf.space() == 0) {
         if (_nonblocking_writes) {
             return 0;
         }
         hal.scheduler->delay(1);
     }
-    _writebuf[_writebuf_tail] = c;
-    BUF_ADVANCETAIL(_writebuf, 1);
+    _writebuf.push(c);
     return 1;
 }
 
 /*
   write size bytes to the write buffer
  */
-size_t PX4UARTDriver::write(const uint8_t *buffer, size_t size)
+size_t PX4UARTDriver::write_implementation(const uint8_t *buffer, size_t size)
 {
 	if (!_initialised) {
 		return 0;
@@ -299,59 +308,47 @@ size_t PX4UARTDriver::write(const uint8_t *buffer, size_t size)
         return ret;
     }
 
-    uint16_t _head, space;
-    space = BUF_SPACE(_writebuf);
-    if (space == 0) {
-        return 0;
-    }
-    if (size > space) {
-        size = space;
-    }
-    if (_writebuf_tail < _head) {
-        // perform as single memcpy
-        assert(_writebuf_tail+size <= _writebuf_size);
-        memcpy(&_writebuf[_writebuf_tail], buffer, size);
-        BUF_ADVANCETAIL(_writebuf, size);
-        return size;
-    }
-
-    // perform as two memcpy calls
-    uint16_t n = _writebuf_size - _writebuf_tail;
-    if (n > size) n = size;
-    assert(_writebuf_tail+n <= _writebuf_size);
-    memcpy(&_writebuf[_writebuf_tail], buffer, n);
-    BUF_ADVANCETAIL(_writebuf, n);
-    buffer += n;
-    n = size - n;
-    if (n > 0) {
-        assert(_writebuf_tail+n <= _writebuf_size);
-        memcpy(&_writebuf[_writebuf_tail], buffer, n);
-        BUF_ADVANCETAIL(_writebuf, n);
-    }        
-    return size;
+    return _writebuf.write(buffer, size);
 }
 
 /*
-  try writing n bytes, handling an unresponsive port
+  try writing n bytes, handling an unresponsive port. The port is only
+  written if poll() says it is ready, but a port that isn't is still
+  checked for having stalled
  */
-int PX4UARTDriver::_write_fd(const uint8_t *buf, uint16_t n)
+int PX4UARTDriver::_write_fd(const uint8_t *buf, uint16_t n, bool ready)
 {
     int ret = 0;
 
-    // the FIONWRITE check is to cope with broken O_NONBLOCK behaviour
-    // in NuttX on ttyACM0
-    int nwrite = 0;
-    if (ioctl(_fd, FIONWRITE, (unsigned long)&nwrite) == 0) {
-        if (nwrite > n) {
-            nwrite = n;
-        }
-        if (nwrite > 0) {
-            ret = ::write(_fd, buf, nwrite);
+    // only offer the kernel what it has room for, so the write never
+    // blocks and is never cut short. This also copes with broken
+    // O_NONBLOCK behaviour in NuttX on ttyACM0. FIONSPACE is only in
+    // later versions of NuttX, earlier ones give the space with
+    // FIONWRITE
+    if (ready) {
+        int nwrite = 0;
+#ifdef FIONSPACE
+        int ioctl_ret = ioctl(_fd, FIONSPACE, (unsigned long)&nwrite);
+#else
+        int ioctl_ret = ioctl(_fd, FIONWRITE, (unsigned long)&nwrite);
+#endif
+        if (ioctl_ret == 0) {
+            if (nwrite > n) {
+                nwrite = n;
+            }
+            if (nwrite > 0) {
+                ret = ::write(_fd, buf, nwrite);
+            }
         }
     }
 
     if (ret > 0) {
-        BUF_ADVANCEHEAD(_writebuf, ret);
+        if (ret < n && _perf_short_writes != NULL) {
+            // the kernel buffer is full, the rest goes next tick
+            perf_count(_perf_short_writes);
+        }
+        _writebuf.advance_read(ret);
+        _total_written += ret;
         _last_write_time = hrt_absolute_time();
         return ret;
     }
@@ -384,12 +381,22 @@ int PX4UARTDriver::_write_fd(const uint8_t *buf, uint16_t n)
         // discarding bytes, even if this is a blocking port. This
         // prevents the ttyACM0 port blocking startup if the endpoint
         // is not connected
-        BUF_ADVANCEHEAD(_writebuf, n);
+        _writebuf.advance_read(n);
         return n;
     }
     return ret;
 }
 
+/*
+  print the transmit statistics. The time spent is in the perf
+  counter named after the port
+ */
+void PX4UARTDriver::print_stats(const char *name)
+{
+    printf("\t%s: %u bytes written, %u queued\n",
+           name, (unsigned)_total_written, (unsigned)_writebuf.available());
+}
+
 /*
   try reading n bytes, handling an unresponsive port
  */
@@ -409,18 +416,65 @@ int PX4UARTDriver::_read_fd(uint8_t *buf, uint16_t n)
         }
     }
     if (ret > 0) {
-        BUF_ADVANCETAIL(_readbuf, ret);
+        _readbuf.advance_write(ret);
     }
     return ret;
 }
 
 
+/*
+  call the received data notification if it is due. Called from the
+  IO thread after each read
+ */
+void PX4UARTDriver::_check_rx_notify(bool got_bytes)
+{
+    AP_HAL::Proc proc = _rx_notify;
+    if (proc == NULL) {
+        return;
+    }
+    uint64_t now = hrt_absolute_time();
+    if (got_bytes) {
+        _last_read_time = now;
+        if (_readbuf.available() >= _rx_notify_min_bytes) {
+            _rx_notify_pending = false;
+            proc();
+        } else {
+            _rx_notify_pending = true;
+        }
+    } else if (_rx_notify_pending && now - _last_read_time >= _rx_notify_idle_us) {
+        // end of a frame
+        _rx_notify_pending = false;
+        proc();
+    }
+}
+
+/*
+  the events to poll() the port for: input while there is room for it,
+  and output while there are bytes to send
+ */
+short PX4UARTDriver::_poll_events(void)
+{
+    if (!_initialised) {
+        return 0;
+    }
+    short events = 0;
+    if (_readbuf.space() != 0) {
+        events |= POLLIN;
+    }
+    if (_writebuf.available() != 0) {
+        events |= POLLOUT;
+    }
+    return events;
+}
+
 /*
   push any pending bytes to/from the serial port. This is called at
-  1kHz in the timer thread. Doing it this way reduces the system call
-  overhead in the main task enormously. 
+  1kHz in the IO thread, after one poll() of all the ports has said
+  which of them are ready. Doing it this way reduces the system call
+  overhead in the main task enormously, and an idle port costs no
+  system calls of its own at all.
  */
-void PX4UARTDriver::_timer_tick(void)
+void PX4UARTDriver::_timer_tick(short revents)
 {
     uint16_t n;
 
@@ -428,45 +482,39 @@ void PX4UARTDriver::_timer_tick(void)
 
     _in_timer = true;
 
-    // write any pending bytes
-    uint16_t _tail;
-    n = BUF_AVAILABLE(_writebuf);
+    // write any pending bytes, in at most two writes if the data
+    // wraps around the end of the buffer. A port that poll() doesn't
+    // find ready still has its stall check
+    bool ready = (revents & POLLOUT) != 0;
+    const uint8_t *wp = _writebuf.readable_span(n);
     if (n > 0) {
         perf_begin(_perf_uart);
-        if (_tail > _writebuf_head) {
-            // do as a single write
-            _write_fd(&_writebuf[_writebuf_head], n);
-        } else {
-            // split into two writes
-            uint16_t n1 = _writebuf_size - _writebuf_head;
-            int ret = _write_fd(&_writebuf[_writebuf_head], n1);
-            if (ret == n1 && n != n1) {
-                _write_fd(&_writebuf[_writebuf_head], n - n1);                
+        int ret = _write_fd(wp, n, ready);
+        if (ret == n) {
+            wp = _writebuf.readable_span(n);
+            if (n > 0) {
+                _write_fd(wp, n, ready);
             }
         }
         perf_end(_perf_uart);
     }
 
     // try to fill the read buffer
-    uint16_t _head;
-    n = BUF_SPACE(_readbuf);
-    if (n > 0) {
+    bool got_bytes = false;
+    uint8_t *rp = _readbuf.writable_span(n);
+    if (n > 0 && (revents & POLLIN)) {
         perf_begin(_perf_uart);
-        if (_readbuf_tail < _head) {
-            // one read will do
-            assert(_readbuf_tail+n <= _readbuf_size);
-            _read_fd(&_readbuf[_readbuf_tail], n);
-        } else {
-            uint16_t n1 = _readbuf_size - _readbuf_tail;
-            assert(_readbuf_tail+n1 <= _readbuf_size);
-            int ret = _read_fd(&_readbuf[_readbuf_tail], n1);
-            if (ret == n1 && n != n1) {
-                assert(_readbuf_tail+(n-n1) <= _readbuf_size);
-                _read_fd(&_readbuf[_readbuf_tail], n - n1);                
+        int ret = _read_fd(rp, n);
+        if (ret == n) {
+            rp = _readbuf.writable_span(n);
+            if (n > 0) {
+                _read_fd(rp, n);
             }
         }
+        got_bytes = (ret > 0);
         perf_end(_perf_uart);
     }
+    _check_rx_notify(got_bytes);
 
     _in_timer = false;
 }
@@ -16,6 +16,7 @@ public:
     bool is_initialized();
     void set_blocking_writes(bool blocking);
     bool tx_pending();
+    bool set_rx_notify(AP_HAL::Proc proc, uint16_t min_bytes, uint32_t idle_us);
 
     /* PX4 implementations of BetterStream virtual methods */
     void print_P(const prog_char_t *pstr);
@@ -30,10 +31,11 @@ public:
     int16_t available();
     int16_t txspace();
     int16_t read();
+    uint16_t read_implementation(uint8_t *buffer, uint16_t count);
 
     /* PX4 implementations of Print virtual methods */
     size_t write(uint8_t c);
-    size_t write(const uint8_t *buffer, size_t size);
+    size_t write_implementation(const uint8_t *buffer, size_t size);
 
     volatile bool _initialised;
     volatile bool _in_timer;
@@ -42,12 +44,20 @@ public:
 	    _devpath = path;
     }
 
-    void _timer_tick(void);
+    // the poll() events the IO thread is to wait for on the port, 0
+    // if it has nothing to do
+    short _poll_events(void);
+
+    // move bytes for the poll() events that have happened
+    void _timer_tick(short revents);
 
     int _get_fd(void) {
 	    return _fd;
     }
 
+    // print the transmit statistics for the status command
+    void print_stats(const char *name);
+
 private:
     const char *_devpath;
     int _fd;
@@ -57,24 +67,26 @@ private:
     bool _nonblocking_writes;
 
     // we use in-task ring buffers to reduce the system call cost
-    // of ::read() and ::write() in the main loop
-    uint8_t *_readbuf;
-    uint16_t _readbuf_size;
-
-    // _head is where the next available data is. _tail is where new
-    // data is put
-    volatile uint16_t _readbuf_head;
-    volatile uint16_t _readbuf_tail;
-
-    uint8_t *_writebuf;
-    uint16_t _writebuf_size;
-    volatile uint16_t _writebuf_head;
-    volatile uint16_t _writebuf_tail;
+    // of ::read() and ::write() in the main loop. The main thread
+    // consumes _readbuf and produces _writebuf, the IO thread does
+    // the opposite
+    RingBuffer<uint8_t> _readbuf;
+    RingBuffer<uint8_t> _writebuf;
     perf_counter_t  _perf_uart;
+    perf_counter_t  _perf_short_writes;
+    uint32_t _total_written;
 
-    int _write_fd(const uint8_t *buf, uint16_t n);
+    int _write_fd(const uint8_t *buf, uint16_t n, bool ready);
     int _read_fd(uint8_t *buf, uint16_t n);
     uint64_t _last_write_time;
+
+    // received data notification, see set_rx_notify()
+    volatile AP_HAL::Proc _rx_notify;
+    uint16_t _rx_notify_min_bytes;
+    uint32_t _rx_notify_idle_us;
+    uint64_t _last_read_time;
+    bool _rx_notify_pending;
+    void _check_rx_notify(bool got_bytes);
 };
 
 #endif // __AP_HAL_PX4_UARTDRIVER_H__
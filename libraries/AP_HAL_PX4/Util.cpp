@@ -9,6 +9,7 @@
 #include <apps/nsh.h>
 #include <fcntl.h>
 #include "UARTDriver.h"
+#include "Scheduler.h"
 
 extern const AP_HAL::HAL& hal;
 
@@ -107,4 +108,12 @@ bool PX4Util::run_debug_shell(AP_HAL::BetterStream *stream)
 	return true;
 }
 
+/*
+  the stacks of the HAL threads, painted by the scheduler
+ */
+bool PX4Util::thread_stack(uint8_t i, AP_HAL::Util::ThreadStack &stack)
+{
+    return ((PX4Scheduler *)hal.scheduler)->thread_stack(i, stack);
+}
+
 #endif // CONFIG_HAL_BOARD == HAL_BOARD_PX4
@@ -13,6 +13,7 @@ public:
     int vsnprintf_P(char* str, size_t size, const prog_char_t *format,
             va_list ap);
     bool run_debug_shell(AP_HAL::BetterStream *stream);
+    bool thread_stack(uint8_t i, AP_HAL::Util::ThreadStack &stack);
 };
 
 #endif // __AP_HAL_PX4_UTIL_H__
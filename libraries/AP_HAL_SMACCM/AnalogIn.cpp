@@ -23,6 +23,11 @@ float SMACCMAnalogSource::read_latest() {
 void SMACCMAnalogSource::set_pin(uint8_t p)
 {}
 
+bool SMACCMAnalogSource::sample_ready(uint32_t &time_ms) {
+    // the value never changes
+    return false;
+}
+
 
 SMACCMAnalogIn::SMACCMAnalogIn()
 {}
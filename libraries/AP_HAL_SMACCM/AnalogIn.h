@@ -12,6 +12,8 @@ public:
     void set_pin(uint8_t p);
     float voltage_average();
     float voltage_average_ratiometric() { return voltage_average(); }
+    void set_sample_rate(uint16_t rate_hz) {}
+    bool sample_ready(uint32_t &time_ms);
     void set_stop_pin(uint8_t p) {}
     void set_settle_time(uint16_t settle_time_ms) {}
 
@@ -15,6 +15,7 @@
 #include "SPIDriver.h"
 #include <FreeRTOS.h>
 #include <hwf4/spi.h>
+#include <string.h>
 
 using namespace SMACCM;
 
@@ -45,6 +46,49 @@ void SMACCMSPIDeviceDriver::transaction(const uint8_t *tx, uint8_t *rx, uint16_t
   }
 }
 
+// Gather the segments into one buffer so the whole batch goes out as
+// a single hwf4 transfer, which blocks this task rather than polling
+// the bus. cs_assert() and transfer() are not implemented here, so
+// the byte-at-a-time default would not work.
+bool SMACCMSPIDeviceDriver::transfer_segments(const AP_HAL::SPISegment *segs,
+                                              uint8_t nsegs,
+                                              AP_HAL::SPICompletionProc completion,
+                                              void *arg)
+{
+  uint8_t tx[SMACCM_SPI_MAX_BATCH];
+  uint8_t rx[SMACCM_SPI_MAX_BATCH];
+  uint16_t len = 0;
+
+  for (uint8_t s = 0; s < nsegs; s++) {
+    if (len + segs[s].len > SMACCM_SPI_MAX_BATCH) {
+      return false;
+    }
+    if (segs[s].tx != NULL) {
+      memcpy(&tx[len], segs[s].tx, segs[s].len);
+    } else {
+      memset(&tx[len], 0, segs[s].len);
+    }
+    len += segs[s].len;
+  }
+
+  if (spi_transfer(_bus, _device, 1000, tx, rx, len) < 0) {
+    hal.scheduler->panic("PANIC: SPI transaction timeout.");
+  }
+
+  len = 0;
+  for (uint8_t s = 0; s < nsegs; s++) {
+    if (segs[s].rx != NULL) {
+      memcpy(segs[s].rx, &rx[len], segs[s].len);
+    }
+    len += segs[s].len;
+  }
+
+  if (completion != NULL) {
+    completion(arg);
+  }
+  return true;
+}
+
 // XXX these methods are not implemented
 void SMACCMSPIDeviceDriver::cs_assert()
 {
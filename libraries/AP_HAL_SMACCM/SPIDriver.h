@@ -20,6 +20,9 @@
 
 #include <hwf4/spi.h>
 
+// largest batch transfer_segments() can send in one hwf4 transfer
+#define SMACCM_SPI_MAX_BATCH 64
+
 class SMACCM::SMACCMSPIDeviceDriver : public AP_HAL::SPIDeviceDriver {
 public:
     SMACCMSPIDeviceDriver(spi_bus *bus, spi_device *device);
@@ -31,6 +34,9 @@ public:
     void cs_release();
     uint8_t transfer (uint8_t data);
     void transfer (const uint8_t *data, uint16_t len);
+
+    bool transfer_segments(const AP_HAL::SPISegment *segs, uint8_t nsegs,
+                           AP_HAL::SPICompletionProc completion, void *arg);
 private:
     SMACCMSemaphore _semaphore;
     struct spi_bus *_bus;
@@ -21,8 +21,10 @@
 #include <FreeRTOS.h>
 #include <task.h>
 #include <semphr.h>
+#include <string.h>
 
 #include "Scheduler.h"
+#include "UARTDriver.h"
 
 using namespace SMACCM;
 
@@ -31,6 +33,9 @@ extern const AP_HAL::HAL& hal;
 /** Rate in milliseconds of timed process execution. (1kHz) */
 #define SCHEDULER_TICKS  (1 / (portTICK_RATE_MS))
 
+/** Period of timed process execution in microseconds. */
+#define SCHEDULER_PERIOD_US 1000
+
 /** Stack size of the scheduler thread. */
 #define SCHEDULER_STACK_SIZE 1536
 
@@ -46,12 +51,6 @@ extern const AP_HAL::HAL& hal;
 /** Priority of the delay callback task. */
 #define DELAY_CB_PRIORITY 0
 
-/**
- * Recursive mutex used to block "scheduler_task" during atomic
- * sections.
- */
-static xSemaphoreHandle g_atomic;
-
 /** High-priority thread managing timer procedures. */
 static void scheduler_task(void *arg)
 {
@@ -73,10 +72,7 @@ static void scheduler_task(void *arg)
       last_wake_time = now;
     } else {
       vTaskDelayUntil(&last_wake_time, SCHEDULER_TICKS);
-
-      xSemaphoreTakeRecursive(g_atomic, portMAX_DELAY);
       sched->run_callbacks();
-      xSemaphoreGiveRecursive(g_atomic);
     }
   }
 }
@@ -137,16 +133,16 @@ static void delay_cb_task(void *arg)
 
 SMACCMScheduler::SMACCMScheduler()
   : m_delay_cb(NULL), m_task(NULL), m_delay_cb_task(NULL),
-    m_failsafe_cb(NULL), m_num_procs(0), m_initializing(true)
+    m_failsafe_cb(NULL), m_late_ticks(0), m_num_procs(0),
+    m_suspended(false), m_in_timer_proc(false), m_initializing(true)
 {
+  memset(m_stats, 0, sizeof(m_stats));
 }
 
 void SMACCMScheduler::init(void *arg)
 {
   timer_init();
 
-  g_atomic = xSemaphoreCreateRecursiveMutex();
-
   vSemaphoreCreateBinary(g_delay_event);
   xSemaphoreTake(g_delay_event, portMAX_DELAY);
 
@@ -203,11 +199,11 @@ void SMACCMScheduler::register_timer_process(AP_HAL::TimedProc k)
       return;
   }
 
+  // The scheduler task reads the count without locking, so the new
+  // entry must be in place before the count includes it.
   if (m_num_procs < SMACCM_SCHEDULER_MAX_TIMER_PROCS) {
-    portENTER_CRITICAL();
     m_procs[m_num_procs] = k;
     ++m_num_procs;
-    portEXIT_CRITICAL();
   }
 }
 
@@ -216,14 +212,48 @@ void SMACCMScheduler::register_timer_failsafe(AP_HAL::TimedProc k, uint32_t)
   m_failsafe_cb = k;
 }
 
+bool SMACCMScheduler::timer_proc_stats(uint8_t i, TimerProcStats &stats)
+{
+  portENTER_CRITICAL();
+  bool ret = i < m_num_procs;
+  if (ret) {
+    stats = m_stats[i];
+    stats.proc = m_procs[i];
+  }
+  portEXIT_CRITICAL();
+  return ret;
+}
+
+uint32_t SMACCMScheduler::timer_late_ticks()
+{
+  portENTER_CRITICAL();
+  uint32_t ret = m_late_ticks;
+  portEXIT_CRITICAL();
+  return ret;
+}
+
+void SMACCMScheduler::clear_timer_stats()
+{
+  portENTER_CRITICAL();
+  memset(m_stats, 0, sizeof(m_stats));
+  m_late_ticks = 0;
+  portEXIT_CRITICAL();
+}
+
+// Timer procs are no longer serialized against the rest of the system
+// by one lock: drivers sharing a bus take its semaphore.  Suspending
+// just stops the scheduler task starting them, and waits for a run in
+// progress, which can only be seen here if a timer proc blocked.
 void SMACCMScheduler::suspend_timer_procs()
 {
-  xSemaphoreTakeRecursive(g_atomic, portMAX_DELAY);
+  m_suspended = true;
+  while (m_in_timer_proc && !in_timerprocess())
+    vTaskDelay(1);
 }
 
 void SMACCMScheduler::resume_timer_procs()
 {
-  xSemaphoreGiveRecursive(g_atomic);
+  m_suspended = false;
 }
 
 void SMACCMScheduler::begin_atomic()
@@ -238,9 +268,8 @@ void SMACCMScheduler::panic(const prog_char_t *errormsg)
 {
   hal.console->println_P(errormsg);
 
-  // Try to grab "g_atomic" to suspend timer processes, but with a
-  // timeout in case a timer proc is locked up.
-  xSemaphoreTakeRecursive(g_atomic, 10);
+  // Stop timer processes, without waiting in case one is locked up.
+  m_suspended = true;
 
   for(;;)
     ;
@@ -257,19 +286,38 @@ void SMACCMScheduler::run_callbacks()
   uint32_t now = micros();
 
   // Run timer processes if not suspended.
-  portENTER_CRITICAL();
-  uint8_t num_procs = m_num_procs;
-  portEXIT_CRITICAL();
-
-  for (int i = 0; i < num_procs; ++i) {
-    if (m_procs[i] != NULL) {
-      m_procs[i](now);
+  m_in_timer_proc = true;
+  if (!m_suspended) {
+    uint8_t num_procs = m_num_procs;
+
+    // Time each process, the end of one being the start of the next.
+    uint32_t start = now;
+    for (int i = 0; i < num_procs; ++i) {
+      if (m_procs[i] != NULL) {
+        m_procs[i](now);
+        uint32_t end = micros();
+        portENTER_CRITICAL();
+        m_stats[i].update(start, end, SCHEDULER_PERIOD_US);
+        portEXIT_CRITICAL();
+        start = end;
+      }
     }
   }
+  m_in_timer_proc = false;
+
+  // Check for received serial data to notify about.
+  ((SMACCMUARTDriver *)hal.uartA)->_timer_tick(now);
+  ((SMACCMUARTDriver *)hal.uartB)->_timer_tick(now);
+  ((SMACCMUARTDriver *)hal.uartC)->_timer_tick(now);
 }
 
 void SMACCMScheduler::run_failsafe_cb()
 {
+  // Only called when the scheduler task missed its deadline.
+  portENTER_CRITICAL();
+  ++m_late_ticks;
+  portEXIT_CRITICAL();
+
   if (m_failsafe_cb)
     m_failsafe_cb(micros());
 }
@@ -60,6 +60,21 @@ public:
    */
   void register_timer_failsafe(AP_HAL::TimedProc, uint32_t);
 
+  /**
+   * Copy the execution time and jitter stats of the i'th timer
+   * process.  Returns false past the last process.
+   */
+  bool timer_proc_stats(uint8_t i, TimerProcStats &stats);
+
+  /**
+   * Return the number of timer ticks which missed their deadline
+   * since the stats were cleared.
+   */
+  uint32_t timer_late_ticks();
+
+  /** Clear the timer process stats and late tick count. */
+  void clear_timer_stats();
+
   /**
    * Suspend execution of timed procedures.  Calls to this function do
    * not nest.
@@ -123,7 +138,11 @@ private:
   void *m_delay_cb_task;        /* opaque delay cb task handle */
   AP_HAL::TimedProc m_procs[SMACCM_SCHEDULER_MAX_TIMER_PROCS];
   AP_HAL::TimedProc m_failsafe_cb;
-  uint8_t m_num_procs;          /* number of entries in "m_procs" */
+  TimerProcStats m_stats[SMACCM_SCHEDULER_MAX_TIMER_PROCS];
+  uint32_t m_late_ticks;        /* ticks which missed their deadline */
+  volatile uint8_t m_num_procs; /* number of entries in "m_procs" */
+  volatile bool m_suspended;    /* true if timer procs are suspended */
+  volatile bool m_in_timer_proc; /* true while running timer procs */
   bool m_initializing;          /* true if initializing */
 };
 
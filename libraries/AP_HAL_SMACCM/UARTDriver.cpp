@@ -20,7 +20,8 @@ using namespace SMACCM;
 // like a very bad idea, since it will run somewhere in the startup
 // code before our clocks are all set up and such.
 SMACCMUARTDriver::SMACCMUARTDriver(struct usart *dev)
-  : m_dev(dev), m_initialized(false), m_blocking(true)
+  : m_dev(dev), m_initialized(false), m_blocking(true),
+    m_rx_notify(NULL), m_rx_last_available(0), m_rx_notify_pending(false)
 {
 }
 
@@ -71,6 +72,48 @@ bool SMACCMUARTDriver::tx_pending()
   return false;
 }
 
+// hwf4 has no receive callback, so the scheduler task watches the
+// receive queue every millisecond instead.  That is still far cheaper
+// than every parser polling from the main loop.
+bool SMACCMUARTDriver::set_rx_notify(AP_HAL::Proc proc, uint16_t min_bytes,
+                                     uint32_t idle_us)
+{
+  if (m_dev == NULL)
+    return false;
+
+  m_rx_notify = NULL;
+  m_rx_notify_min_bytes = min_bytes;
+  m_rx_notify_idle_us = idle_us;
+  m_rx_notify_pending = false;
+  m_rx_last_available = 0;
+  m_rx_notify = proc;
+  return true;
+}
+
+void SMACCMUARTDriver::_timer_tick(uint32_t now)
+{
+  AP_HAL::Proc proc = m_rx_notify;
+  if (proc == NULL || !m_initialized)
+    return;
+
+  uint16_t avail = (uint16_t)usart_available(m_dev);
+  if (avail > m_rx_last_available) {
+    // New bytes since the last tick.
+    m_rx_last_time = now;
+    if (avail >= m_rx_notify_min_bytes) {
+      m_rx_notify_pending = false;
+      proc();
+    } else {
+      m_rx_notify_pending = true;
+    }
+  } else if (m_rx_notify_pending && now - m_rx_last_time >= m_rx_notify_idle_us) {
+    // The line went quiet, the end of a frame.
+    m_rx_notify_pending = false;
+    proc();
+  }
+  m_rx_last_available = avail;
+}
+
 /* SMACCM implementations of BetterStream virtual methods */
 void SMACCMUARTDriver::print_P(const prog_char_t *pstr)
 {
@@ -22,6 +22,7 @@ public:
   bool is_initialized();
   void set_blocking_writes(bool blocking);
   bool tx_pending();
+  bool set_rx_notify(AP_HAL::Proc proc, uint16_t min_bytes, uint32_t idle_us);
 
   /* SMACCM implementations of BetterStream virtual methods */
   void print_P(const prog_char_t *pstr);
@@ -40,10 +41,22 @@ public:
   /* SMACCM implementations of Print virtual methods */
   size_t write(uint8_t c);
 
+  /* Check for received data to notify about.  Called from the
+   * scheduler task at 1kHz. */
+  void _timer_tick(uint32_t now);
+
 private:
   struct usart *m_dev;
   bool m_initialized;
   bool m_blocking;
+
+  /* Received data notification, see set_rx_notify(). */
+  volatile AP_HAL::Proc m_rx_notify;
+  uint16_t m_rx_notify_min_bytes;
+  uint32_t m_rx_notify_idle_us;
+  uint16_t m_rx_last_available;
+  uint32_t m_rx_last_time;
+  bool m_rx_notify_pending;
 };
 
 #endif // CONFIG_HAL_BOARD == HAL_BOARD_SMACCM
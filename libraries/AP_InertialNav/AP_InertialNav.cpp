@@ -54,10 +54,29 @@ void AP_InertialNav::update(float dt)
     accel_ef.z += GRAVITY_MSS;
     accel_ef *= 100;
 
-    // remove xy if not enabled
-    if( !_xy_enabled ) {
-        accel_ef.x = 0;
-        accel_ef.y = 0;
+    // only run the vertical filter if neither the gps nor optical flow can
+    // correct the horizontal estimate.  a short gps outage is ridden through
+    // on the accelerometers, but without a gps fitted or long after it has
+    // been lost the horizontal estimate is of no use
+    uint32_t now = hal.scheduler->millis();
+    bool flow_ok = _flow_last_update != 0 && now - _flow_last_update < AP_INTERTIALNAV_FLOW_TIMEOUT_MS;
+    bool gps_ok = _xy_enabled && _gps_last_update != 0 && now - _gps_last_update < AP_INTERTIALNAV_GPS_ABSENT_MS;
+    if( !gps_ok && !flow_ok ) {
+        if( !_z_only ) {
+            // stop reporting a stale horizontal velocity
+            _velocity.x = 0;
+            _velocity.y = 0;
+            _position_error.x = 0;
+            _position_error.y = 0;
+            _z_only = true;
+        }
+        update_z(-accel_ef.z, dt);
+        return;
+    }
+    if( _z_only ) {
+        // the horizontal estimate starts again, so its history is of no use
+        _hist_xy.clear();
+        _z_only = false;
     }
 
     //Convert North-East-Down to North-East-Up
@@ -73,16 +92,31 @@ void AP_InertialNav::update(float dt)
     _velocity.y += _position_error.y * tmp;
     _velocity.z += _position_error.z * _k2_z  * dt;
 
+    // optical flow measures velocity, so it corrects the velocity and
+    // accelerometer offsets directly
+    if( flow_ok ) {
+        float vel_error_x = _flow_velocity.x - _velocity.x;
+        float vel_error_y = _flow_velocity.y - _velocity.y;
+        tmp = _k2_flow * dt;
+        accel_correction_ef.x += vel_error_x * tmp;
+        accel_correction_ef.y += vel_error_y * tmp;
+        tmp = _k1_flow * dt;
+        _velocity.x += vel_error_x * tmp;
+        _velocity.y += vel_error_y * tmp;
+    }
+
     tmp = _k1_xy * dt;
     _position_correction.x += _position_error.x * tmp;
     _position_correction.y += _position_error.y * tmp;
     _position_correction.z += _position_error.z * _k1_z  * dt;
 
     // calculate velocity increase adding new acceleration from accelerometers
-    velocity_increase = (accel_ef + accel_correction_ef) * dt;
+    velocity_increase = accel_ef;
+    velocity_increase += accel_correction_ef;
+    velocity_increase *= dt;
 
     // calculate new estimate of position
-    _position_base += (_velocity + velocity_increase*0.5) * dt;
+    _position_base.multiply_add(_velocity, dt).multiply_add(velocity_increase, 0.5f * dt);
 
     // calculate new velocity
     _velocity += velocity_increase;
@@ -90,12 +124,9 @@ void AP_InertialNav::update(float dt)
     // store 3rd order estimate (i.e. estimated vertical position) for future use
     _hist_position_estimate_z.add(_position_base.z);
 
-    // store 3rd order estimate (i.e. horizontal position) for future use at 10hz
-    _historic_xy_counter++;
-    if( _historic_xy_counter >= AP_INTERTIALNAV_SAVE_POS_AFTER_ITERATIONS ) {
-        _historic_xy_counter = 0;
-        _hist_position_estimate_x.add(_position_base.x);
-        _hist_position_estimate_y.add(_position_base.y);
+    // store 3rd order estimate (i.e. horizontal position) and velocity for future use at 10hz
+    if( now - _hist_xy_last_save >= AP_INTERTIALNAV_SAVE_POS_INTERVAL_MS ) {
+        save_hist_xy(now);
     }
 }
 
@@ -113,36 +144,42 @@ void AP_InertialNav::set_time_constant_xy( float time_constant_in_seconds )
     }
 }
 
-// position_ok - return true if position has been initialised and have received gps data within 3 seconds
+// position_ok - return true if position has been initialised and the horizontal estimate is being corrected
 bool AP_InertialNav::position_ok() const
 {
-    return _xy_enabled;
+    return _xy_enabled && !_z_only;
 }
 
 // check_gps - check if new gps readings have arrived and use them to correct position estimates
 void AP_InertialNav::check_gps()
 {
-    uint32_t gps_time;
+    uint32_t fix_time;
     uint32_t now = hal.scheduler->millis();
+    GPS::Fix fix;
 
     if( _gps_ptr == NULL || *_gps_ptr == NULL )
         return;
 
-    // get time according to the gps
-    gps_time = (*_gps_ptr)->time;
+    // the system time the latest fix arrived. A change means a new fix,
+    // which we use on the first update after it arrives
+    (*_gps_ptr)->get_fix(fix);
+    fix_time = fix.fix_time_ms;
 
-    // compare gps time to previous reading
-    if( gps_time != _gps_last_time ) {
+    if( fix_time != _gps_last_update ) {
 
-        // calculate time since last gps reading
-        float dt = (float)(now - _gps_last_update) * 0.001f;
+        // calculate time between the fixes
+        float dt = (float)(fix_time - _gps_last_update) * 0.001f;
 
-        // call position correction method
-        correct_with_gps((*_gps_ptr)->longitude, (*_gps_ptr)->latitude, dt);
+        // call position correction method, or start the horizontal estimate
+        // again at the fix if it hasn't been running
+        if( _z_only && _xy_enabled ) {
+            reset_xy(fix.longitude, fix.latitude);
+        }else{
+            correct_with_gps(fix_time, fix.longitude, fix.latitude, dt);
+        }
 
-        // record gps time and system time of this update
-        _gps_last_time = gps_time;
-        _gps_last_update = now;
+        // record the system time of this update
+        _gps_last_update = fix_time;
     }
 
     // clear position error if GPS updates stop arriving
@@ -152,11 +189,13 @@ void AP_InertialNav::check_gps()
     }
 }
 
-// correct_with_gps - modifies accelerometer offsets using gps.  dt is time since last gps update
-void AP_InertialNav::correct_with_gps(int32_t lon, int32_t lat, float dt)
+// correct_with_gps - modifies accelerometer offsets using gps.  now is the system time the fix
+// arrived, dt is time since last gps update
+void AP_InertialNav::correct_with_gps(uint32_t now, int32_t lon, int32_t lat, float dt)
 {
     float x,y;
     float hist_position_base_x, hist_position_base_y;
+    uint32_t fix_time;
 
     // discard samples where dt is too large
     if( dt > 1.0f || dt == 0 || !_xy_enabled) {
@@ -164,24 +203,81 @@ void AP_InertialNav::correct_with_gps(int32_t lon, int32_t lat, float dt)
     }
 
     // calculate distance from base location
-    x = (float)(lat - _base_lat) * LATLON_TO_CM;
-    y = (float)(lon - _base_lon) * _lon_to_m_scaling;
-
-    // ublox gps positions are delayed by 400ms
-    // we store historical position at 10hz so 4 iterations ago
-    if( _hist_position_estimate_x.num_items() >= AP_INTERTIALNAV_GPS_LAG_IN_10HZ_INCREMENTS ) {
-        hist_position_base_x = _hist_position_estimate_x.peek(AP_INTERTIALNAV_GPS_LAG_IN_10HZ_INCREMENTS-1);
-        hist_position_base_y = _hist_position_estimate_y.peek(AP_INTERTIALNAV_GPS_LAG_IN_10HZ_INCREMENTS-1);
-    }else{
-        hist_position_base_x = _position_base.x;
-        hist_position_base_y = _position_base.y;
-    }
+    Vector2f ne = _frame.location_to_ne_cm(lat, lon);
+    x = ne.x;
+    y = ne.y;
+
+    // ublox gps positions are delayed so compare them with our estimate of
+    // where we were when the gps took the reading. The corrections since
+    // then apply to the historic and current estimates alike so the error
+    // is carried forward by simply adding the current correction
+    fix_time = now - AP_INTERTIALNAV_GPS_LAG_MS;
+    get_hist_position_base_xy(fix_time, hist_position_base_x, hist_position_base_y);
 
     // calculate error in position from gps with our historical estimate
     _position_error.x = x - (hist_position_base_x + _position_correction.x);
     _position_error.y = y - (hist_position_base_y + _position_correction.y);
 }
 
+// correct_with_flow - corrects the horizontal velocity and accelerometer
+// offsets with an optical flow velocity, forward and right in the body frame
+void AP_InertialNav::correct_with_flow(float vel_forward, float vel_right)
+{
+    // rotate to the earth frame using the ahrs's trig
+    const AP_AHRS::attitude_trig &trig = _ahrs->get_trig();
+    _flow_velocity.x = vel_forward * trig.cos_yaw - vel_right * trig.sin_yaw;
+    _flow_velocity.y = vel_forward * trig.sin_yaw + vel_right * trig.cos_yaw;
+    _flow_last_update = hal.scheduler->millis();
+}
+
+// save_hist_xy - store the current horizontal estimate for later comparison to gps
+void AP_InertialNav::save_hist_xy(uint32_t now)
+{
+    struct hist_xy hist;
+
+    hist.time_ms = (uint16_t)now;
+    hist.position_x = _position_base.x;
+    hist.position_y = _position_base.y;
+    hist.velocity_x = _velocity.x;
+    hist.velocity_y = _velocity.y;
+    _hist_xy.add(hist);
+
+    _hist_xy_last_save = now;
+}
+
+// get_hist_position_base_xy - estimate _position_base at a past system time.
+// The newest saved estimate from before that time is moved forward by its
+// own velocity, so the result is aligned to the millisecond rather than
+// to the nearest save.  Falls back to the oldest estimate if the history
+// does not reach back far enough, or to the current one if it is empty
+void AP_InertialNav::get_hist_position_base_xy(uint32_t time_ms, float &x, float &y) const
+{
+    uint8_t num_items = _hist_xy.num_items();
+    uint16_t t = (uint16_t)time_ms;
+
+    if( num_items == 0 ) {
+        x = _position_base.x;
+        y = _position_base.y;
+        return;
+    }
+
+    // search back from the newest item. 16 bit differences are safe
+    // because the history covers far less than a minute
+    struct hist_xy hist;
+    uint8_t i = num_items;
+    do {
+        i--;
+        hist = _hist_xy.peek(i);
+    } while( i > 0 && (int16_t)(t - hist.time_ms) < 0 );
+
+    float dt = (int16_t)(t - hist.time_ms) * 0.001f;
+    if( dt < 0 ) {
+        dt = 0;
+    }
+    x = hist.position_x + hist.velocity_x * dt;
+    y = hist.position_y + hist.velocity_y * dt;
+}
+
 // get accel based latitude
 int32_t AP_InertialNav::get_latitude() const
 {
@@ -190,7 +286,7 @@ int32_t AP_InertialNav::get_latitude() const
         return 0;
     }
 
-    return _base_lat + (int32_t)((_position_base.x + _position_correction.x)/LATLON_TO_CM);
+    return _frame.ne_cm_to_lat(Vector2f(_position_base.x + _position_correction.x, _position_base.y + _position_correction.y));
 }
 
 // get accel based longitude
@@ -201,21 +297,14 @@ int32_t AP_InertialNav::get_longitude() const
         return 0;
     }
 
-    return _base_lon + (int32_t)((_position_base.y+_position_correction.y) / _lon_to_m_scaling);
+    return _frame.ne_cm_to_lng(Vector2f(_position_base.x + _position_correction.x, _position_base.y + _position_correction.y));
 }
 
 // set_current_position - all internal calculations are recorded as the distances from this point
 void AP_InertialNav::set_current_position(int32_t lon, int32_t lat)
 {
-    // set base location
-    _base_lon = lon;
-    _base_lat = lat;
-
-    // set longitude to meters scaling to offset the shrinking longitude as we go towards the poles
-    Location temp_loc;
-    temp_loc.lat = lat;
-    temp_loc.lng = lon;
-    _lon_to_m_scaling = longitude_scale(&temp_loc) * LATLON_TO_CM;
+    // set base location.  this also updates the scaling used to offset the shrinking longitude as we go towards the poles
+    _frame.set_origin(lat, lon);
 
     // reset corrections to base position to zero
     _position_base.x = 0;
@@ -224,13 +313,40 @@ void AP_InertialNav::set_current_position(int32_t lon, int32_t lat)
     _position_correction.y = 0;
 
     // clear historic estimates
-    _hist_position_estimate_x.clear();
-    _hist_position_estimate_y.clear();
+    _hist_xy.clear();
 
     // set xy as enabled
     _xy_enabled = true;
 }
 
+// move_origin - moves the point positions are recorded from.  the
+// estimate and its history are shifted by the same amount, so there is
+// no step in the position or in the next gps correction
+Vector2f AP_InertialNav::move_origin(int32_t lon, int32_t lat)
+{
+    if( !_xy_enabled ) {
+        set_current_position(lon, lat);
+        return Vector2f(0,0);
+    }
+
+    Vector2f shift = _frame.rebase(lat, lon);
+
+    // the correction is only ever the difference between the gps and the
+    // accel based estimate, so it is the base that moves
+    _position_base.x -= shift.x;
+    _position_base.y -= shift.y;
+
+    uint8_t num_items = _hist_xy.num_items();
+    for( uint8_t i=0; i<num_items; i++ ) {
+        struct hist_xy hist = _hist_xy.get();
+        hist.position_x -= shift.x;
+        hist.position_y -= shift.y;
+        _hist_xy.add(hist);
+    }
+
+    return shift;
+}
+
 // get accel based latitude
 float AP_InertialNav::get_latitude_diff() const
 {
@@ -250,7 +366,7 @@ float AP_InertialNav::get_longitude_diff() const
         return 0;
     }
 
-    return (_position_base.y+_position_correction.y) / _lon_to_m_scaling;
+    return (_position_base.y+_position_correction.y) / LATLON_TO_CM * _frame.get_scale_up();
 }
 
 // get velocity in latitude & longitude directions
@@ -305,11 +421,15 @@ void AP_InertialNav::check_baro()
         return;
 
     // calculate time since last baro reading
-    baro_update_time = _baro->get_last_update();
+    baro_update_time = _baro->get_last_sample_time_micros();
     if( baro_update_time != _baro_last_update ) {
-        float dt = (float)(baro_update_time - _baro_last_update) * 0.001f;
-        // call correction method
-        correct_with_baro(_baro->get_altitude()*100, dt);
+        float dt = (float)(baro_update_time - _baro_last_update) * 1.0e-6f;
+        _baro_alt = _baro->get_altitude()*100;
+        // while the rangefinder corrects the altitude the baro reading is
+        // only used to follow the altitude of the ground below
+        if( !range_ok() ) {
+            correct_with_baro(_baro_alt, dt);
+        }
         _baro_last_update = baro_update_time;
     }
 }
@@ -344,6 +464,96 @@ void AP_InertialNav::correct_with_baro(float baro_alt, float dt)
     _position_error.z = baro_alt - (hist_position_base_z + _position_correction.z);
 }
 
+// correct_with_range - use a rangefinder reading in place of the baro.  the
+// altitude it gives is the ground altitude plus the reading, and the ground
+// altitude follows the baro slowly, so the rangefinder gives the short term
+// altitude and the baro stops it wandering.  a glitch or a step in the ground
+// hands back to the baro, and the ground altitude is found again from the
+// current estimate when the readings are good once more
+void AP_InertialNav::correct_with_range(float range_cm, bool valid)
+{
+    uint32_t now = hal.scheduler->millis();
+    float cos_tilt = _ahrs->get_dcm_matrix().c.z;
+
+    if( !valid || cos_tilt < AP_INTERTIALNAV_RANGE_COS_TILT_MIN ) {
+        _range_health = 0;
+        return;
+    }
+    if( now - _range_last_update >= AP_INTERTIALNAV_RANGE_TIMEOUT_MS ) {
+        // readings stopped for a while, so their health has to be shown again
+        _range_health = 0;
+    }
+
+    // vertical distance to the ground
+    float height = range_cm * cos_tilt;
+    float dt = (now - _range_last_update) * 0.001f;
+    bool was_ok = range_ok();
+
+    if( was_ok && fabsf(height - get_height_above_ground()) > AP_INTERTIALNAV_RANGE_GLITCH_CM ) {
+        _range_health = 0;
+        return;
+    }
+    _range_last_update = now;
+    if( _range_health < AP_INTERTIALNAV_RANGE_HEALTH_MAX ) {
+        _range_health++;
+    }
+    if( !range_ok() ) {
+        return;
+    }
+
+    if( !was_ok ) {
+        // taking over from the baro, so the altitude carries on from the estimate
+        _ground_alt = get_altitude() - height;
+    }else{
+        _ground_alt += (_baro_alt - height - _ground_alt) * dt / (AP_INTERTIALNAV_TC_GROUND + dt);
+    }
+
+    float hist_position_base_z;
+    if( _hist_position_estimate_z.num_items() >= AP_INTERTIALNAV_RANGE_LAG ) {
+        hist_position_base_z = _hist_position_estimate_z.peek(AP_INTERTIALNAV_RANGE_LAG-1);
+    }else{
+        hist_position_base_z = _position_base.z;
+    }
+    _position_error.z = _ground_alt + height - (hist_position_base_z + _position_correction.z);
+}
+
+bool AP_InertialNav::range_ok() const
+{
+    return _range_health >= AP_INTERTIALNAV_RANGE_HEALTH_MAX &&
+           hal.scheduler->millis() - _range_last_update < AP_INTERTIALNAV_RANGE_TIMEOUT_MS;
+}
+
+// update_z - the vertical part of update(), for when there is nothing to
+// correct the horizontal estimate.  accel_z is up, without gravity, in cm/s/s
+void AP_InertialNav::update_z(float accel_z, float dt)
+{
+    accel_correction_ef.z += _position_error.z * _k3_z * dt;
+    _velocity.z += _position_error.z * _k2_z * dt;
+    _position_correction.z += _position_error.z * _k1_z * dt;
+
+    float velocity_increase = (accel_z + accel_correction_ef.z) * dt;
+    _position_base.z += (_velocity.z + velocity_increase*0.5f) * dt;
+    _velocity.z += velocity_increase;
+
+    _hist_position_estimate_z.add(_position_base.z);
+}
+
+// reset_xy - restart the horizontal estimate at a gps fix.  the lag of the
+// fix is small next to the error of an estimate that has not been running
+void AP_InertialNav::reset_xy(int32_t lon, int32_t lat)
+{
+    Vector2f ne = _frame.location_to_ne_cm(lat, lon);
+    _position_base.x = ne.x;
+    _position_base.y = ne.y;
+    _position_correction.x = 0;
+    _position_correction.y = 0;
+    _position_error.x = 0;
+    _position_error.y = 0;
+    _velocity.x = (*_gps_ptr)->velocity_north() * 100;
+    _velocity.y = (*_gps_ptr)->velocity_east() * 100;
+    _hist_xy.clear();
+}
+
 // set_altitude - set base altitude estimate in cm
 void AP_InertialNav::set_altitude( float new_altitude)
 {
@@ -367,6 +577,15 @@ void AP_InertialNav::update_gains()
         _k3_xy = 1 / (_time_constant_xy*_time_constant_xy*_time_constant_xy);
     }
 
+    // optical flow corrects velocity, so its filter is second order with
+    // the same time constant
+    if( _time_constant_xy == 0 ) {
+        _k1_flow = _k2_flow = 0;
+    }else{
+        _k1_flow = 2 / _time_constant_xy;
+        _k2_flow = 1 / (_time_constant_xy*_time_constant_xy);
+    }
+
     // Z axis time constant
     if( _time_constant_z == 0 ) {
         _k1_z = _k2_z = _k3_z = 0;
@@ -13,9 +13,20 @@
 
 // #defines to control how often historical accel based positions are saved
 // so they can later be compared to laggy gps readings
-#define AP_INTERTIALNAV_SAVE_POS_AFTER_ITERATIONS   10
-#define AP_INTERTIALNAV_GPS_LAG_IN_10HZ_INCREMENTS  4       // must not be larger than size of _hist_position_estimate_x and _hist_position_estimate_y
+#define AP_INTERTIALNAV_SAVE_POS_INTERVAL_MS        100     // interval between saved horizontal positions and velocities
+#define AP_INTERTIALNAV_GPS_LAG_MS                  400     // ublox gps positions are delayed by this much
+#define AP_INTERTIALNAV_HIST_XY_SIZE                6       // must cover AP_INTERTIALNAV_GPS_LAG_MS at AP_INTERTIALNAV_SAVE_POS_INTERVAL_MS
 #define AP_INTERTIALNAV_GPS_TIMEOUT_MS              300     // timeout after which position error from GPS will fall to zero
+#define AP_INTERTIALNAV_FLOW_TIMEOUT_MS             200     // timeout after which optical flow velocities are no longer used
+#define AP_INTERTIALNAV_GPS_ABSENT_MS               5000    // time without a gps fix after which only the vertical filter is run
+
+// #defines to control how rangefinder readings are used
+#define AP_INTERTIALNAV_RANGE_HEALTH_MAX            3       // good readings in a row before the rangefinder takes over from the baro
+#define AP_INTERTIALNAV_RANGE_TIMEOUT_MS            250     // time without a good reading after which the baro takes over again
+#define AP_INTERTIALNAV_RANGE_GLITCH_CM             100     // a reading this far from the expected height above ground hands back to the baro
+#define AP_INTERTIALNAV_RANGE_COS_TILT_MIN          0.707f  // readings are not used when tilted more than 45 degrees
+#define AP_INTERTIALNAV_RANGE_LAG                   5       // rangefinder readings are delayed by about 5 iterations at 100hz
+#define AP_INTERTIALNAV_TC_GROUND                   5.0f    // time constant in seconds with which the ground altitude follows the baro
 
 /*
  * AP_InertialNav is an attempt to use accelerometers to augment other sensors to improve altitud e position hold
@@ -31,9 +42,15 @@ public:
         _baro(baro),
         _gps_ptr(gps_ptr),
         _xy_enabled(false),
+        _z_only(true),
         _gps_last_update(0),
-        _gps_last_time(0),
-        _baro_last_update(0)
+        _hist_xy_last_save(0),
+        _baro_last_update(0),
+        _baro_alt(0),
+        _range_health(0),
+        _range_last_update(0),
+        _ground_alt(0),
+        _flow_last_update(0)
         {
             AP_Param::setup_object_defaults(this, var_info);
         }
@@ -54,11 +71,22 @@ public:
     // altitude_ok, position_ok - true if inertial based altitude and position can be trusted
     bool        position_ok() const;
 
+    // vertical_only - true while neither the gps nor optical flow can correct the horizontal
+    // estimate, so only the altitude and climb rate are being updated
+    bool        vertical_only() const { return _z_only; }
+
     // check_gps - check if new gps readings have arrived and use them to correct position estimates
     void        check_gps();
 
-    // correct_with_gps - modifies accelerometer offsets using gps.  dt is time since last gps update
-    void        correct_with_gps(int32_t lon, int32_t lat, float dt);
+    // correct_with_gps - modifies accelerometer offsets using gps.  now is the system time the fix
+    // arrived, dt is time since last gps update
+    void        correct_with_gps(uint32_t now, int32_t lon, int32_t lat, float dt);
+
+    // correct_with_flow - corrects the horizontal velocity and accelerometer
+    // offsets with a velocity over the ground in cm/s measured by optical flow,
+    // forward and right in the body frame.  Used alongside the gps, and without
+    // it, as long as readings keep arriving
+    void        correct_with_flow(float vel_forward, float vel_right);
 
     // get_position - returns current position from home in cm
     Vector3f    get_position() const { return _position_base + _position_correction; }
@@ -70,6 +98,15 @@ public:
     // set_current_position - all internal calculations are recorded as the distances from this point
     void        set_current_position(int32_t lon, int32_t lat);
 
+    // move_origin - moves the point positions are recorded from without
+    // changing the estimate of where we are.  returns the shift in cm that
+    // other holders of positions in this frame must take away from them
+    Vector2f    move_origin(int32_t lon, int32_t lat);
+
+    // get_frame - the frame of the position estimates, for converting
+    // locations to and from them
+    const LocalFrame &get_frame() const { return _frame; }
+
     // get latitude & longitude positions from base location (in cm)
     float       get_latitude_diff() const;
     float       get_longitude_diff() const;
@@ -100,6 +137,22 @@ public:
     // correct_with_baro - modifies accelerometer offsets using barometer.  dt is time since last baro reading
     void        correct_with_baro(float baro_alt, float dt);
 
+    // correct_with_range - corrects the altitude with a rangefinder reading of the
+    // distance to the ground along the body's down axis in cm.  valid is false if the
+    // reading was outside the sensor's working range.  Once enough good readings have
+    // arrived the rangefinder corrects the altitude in place of the baro, which then
+    // only keeps track of the altitude of the ground below
+    void        correct_with_range(float range_cm, bool valid);
+
+    // range_ok - true if the altitude is being corrected by the rangefinder
+    bool        range_ok() const;
+
+    // get_ground_altitude - altitude of the ground below in cm, valid while range_ok()
+    float       get_ground_altitude() const { return _ground_alt; }
+
+    // get_height_above_ground - height above the ground below in cm, valid while range_ok()
+    float       get_height_above_ground() const { return get_altitude() - _ground_alt; }
+
     // get_altitude - get latest altitude estimate in cm
     float       get_altitude() const { return _position_base.z + _position_correction.z; }
     void        set_altitude( float new_altitude);
@@ -116,8 +169,30 @@ public:
 
 protected:
 
+    // historic horizontal estimate, saved so that a laggy gps reading can be
+    // compared with where we thought we were when the gps took it
+    struct hist_xy {
+        uint16_t    time_ms;                                // low 16 bits of the system time this was saved
+        float       position_x;                             // accel based position (i.e. _position_base) in cm
+        float       position_y;
+        float       velocity_x;                             // velocity in cm/s
+        float       velocity_y;
+    };
+
+    // save_hist_xy - store the current horizontal estimate for later comparison to gps
+    void                    save_hist_xy(uint32_t now);
+
+    // get_hist_position_base_xy - estimate _position_base at a past system time from the history
+    void                    get_hist_position_base_xy(uint32_t time_ms, float &x, float &y) const;
+
     void                    update_gains();             // update_gains - update gains from time constant (given in seconds)
 
+    // update_z - update the altitude and climb rate only, from the earth frame vertical acceleration in cm/s/s (up)
+    void                    update_z(float accel_z, float dt);
+
+    // reset_xy - restart the horizontal estimate at a gps fix, after running vertical only
+    void                    reset_xy(int32_t lon, int32_t lat);
+
     AP_AHRS*                _ahrs;                      // pointer to ahrs object
     AP_InertialSensor*      _ins;                       // pointer to inertial sensor
     AP_Baro*                _baro;                      // pointer to barometer
@@ -125,25 +200,30 @@ protected:
 
     // XY Axis specific variables
     bool                    _xy_enabled;                // xy position estimates enabled
+    bool                    _z_only;                    // true if only the vertical filter is being run
     AP_Float                _time_constant_xy;          // time constant for horizontal corrections
     float                   _k1_xy;                     // gain for horizontal position correction
     float                   _k2_xy;                     // gain for horizontal velocity correction
     float                   _k3_xy;                     // gain for horizontal accelerometer offset correction
-    uint32_t                _gps_last_update;           // system time of last gps update
-    uint32_t                _gps_last_time;             // time of last gps update according to the gps itself
-    uint8_t                 _historic_xy_counter;       // counter used to slow saving of position estimates for later comparison to gps
-    AP_BufferFloat_Size5    _hist_position_estimate_x;  // buffer of historic accel based position to account for lag
-    AP_BufferFloat_Size5    _hist_position_estimate_y;  // buffer of historic accel based position to account for lag
-    int32_t                 _base_lat;                  // base latitude
-    int32_t                 _base_lon;                  // base longitude
-    float                   _lon_to_m_scaling;          // conversion of longitude to meters
+    uint32_t                _gps_last_update;           // system time the last gps fix we used arrived
+    uint32_t                _hist_xy_last_save;         // system time the last horizontal estimate was saved
+    AP_Buffer<struct hist_xy, AP_INTERTIALNAV_HIST_XY_SIZE> _hist_xy;   // buffer of historic accel based positions and velocities to account for lag
+    LocalFrame              _frame;                     // origin of the position estimates
+    Vector2f                _flow_velocity;             // latest earth frame velocity from optical flow in cm/s
+    uint32_t                _flow_last_update;          // system time of the latest optical flow velocity
+    float                   _k1_flow;                   // gain for horizontal velocity correction from optical flow
+    float                   _k2_flow;                   // gain for horizontal accelerometer offset correction from optical flow
     
     // Z Axis specific variables
     AP_Float                _time_constant_z;           // time constant for vertical corrections
     float                   _k1_z;                      // gain for vertical position correction
     float                   _k2_z;                      // gain for vertical velocity correction
     float                   _k3_z;                      // gain for vertical accelerometer offset correction
-    uint32_t                _baro_last_update;           // time of last barometer update
+    uint32_t                _baro_last_update;           // sample time in micros of the last barometer reading
+    float                   _baro_alt;                  // latest baro altitude in cm
+    uint8_t                 _range_health;              // good rangefinder readings in a row, up to AP_INTERTIALNAV_RANGE_HEALTH_MAX
+    uint32_t                _range_last_update;         // system time of the latest good rangefinder reading
+    float                   _ground_alt;                // altitude of the ground below in cm, while the rangefinder is in use
     AP_BufferFloat_Size15   _hist_position_estimate_z;  // buffer of historic accel based altitudes to account for lag
 
     // general variables
@@ -89,12 +89,67 @@ const AP_Param::GroupInfo AP_InertialSensor::var_info[] PROGMEM = {
     // @User: Advanced
     AP_GROUPINFO("MPU6K_FILTER", 4, AP_InertialSensor, _mpu6000_filter,  0),
 
+#if AP_INERTIAL_SENSOR_FILTERS
+    // @Param: NOTCH_HZ
+    // @DisplayName: IMU notch filter frequency
+    // @Description: Centre frequency of a software notch filter applied to every raw gyro and accelerometer sample before averaging. Set this to the main vibration frequency of the motors or propellers. It must be below half the sensor sample rate to have any effect. 0 disables the notch
+    // @Units: Hz
+    // @Range: 0 500
+    // @User: Advanced
+    AP_GROUPINFO("NOTCH_HZ",    5, AP_InertialSensor, _notch_hz,     0),
+
+    // @Param: NOTCH_BW
+    // @DisplayName: IMU notch filter bandwidth
+    // @Description: Width of the band rejected by the software notch filter
+    // @Units: Hz
+    // @Range: 5 100
+    // @User: Advanced
+    AP_GROUPINFO("NOTCH_BW",    6, AP_InertialSensor, _notch_bw_hz,  20),
+
+    // @Param: LPF_HZ
+    // @DisplayName: IMU software low pass frequency
+    // @Description: Cutoff of a second order software low pass filter applied to every raw gyro and accelerometer sample before averaging, in addition to any MPU6K_FILTER. It must be below half the sensor sample rate to have any effect. 0 disables the filter
+    // @Units: Hz
+    // @Range: 0 500
+    // @User: Advanced
+    AP_GROUPINFO("LPF_HZ",      7, AP_InertialSensor, _lowpass_hz,   0),
+#endif
+
+#if AP_INERTIAL_SENSOR_ACCEL_CAL
+    // @Param: ACC_LEARN
+    // @DisplayName: Accelerometer background calibration
+    // @Description: Enable the background calibration of the accelerometer offsets and scaling. While disarmed the vehicle is averaged while it rests in each of the six positions of the manual calibration, in any order, and once all six are seen the fit is saved. Only where the vehicle supports it
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("ACC_LEARN",   8, AP_InertialSensor, _accel_learn,  0),
+#endif
+
+#if AP_INERTIAL_SENSOR_BATCH
+    // @Param: BATCH
+    // @DisplayName: IMU vibration analysis
+    // @Description: Sensor whose raw samples are captured at the full sensor rate and analysed with an FFT, logging the frequency and energy of the largest vibration on each axis. Needs IMU logging enabled
+    // @Values: 0:Disabled,1:Gyro,2:Accel
+    // @User: Advanced
+    AP_GROUPINFO("BATCH",       9, AP_InertialSensor, _batch_sensor, 0),
+#endif
+
+#if AP_INERTIAL_SENSOR_RAW_LOG
+    // @Param: RAW_LOG
+    // @DisplayName: IMU raw sample logging
+    // @Description: Log every raw gyro and accelerometer sample at the full sensor rate along with the IMU messages, as 16 bit counts in blocks of 32 samples with the time of the first and the interval between them. The size of a count is logged once in each log. Needs IMU logging enabled, and a log that can take around 13 bytes per sample
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("RAW_LOG",    10, AP_InertialSensor, _raw_log_enable, 0),
+#endif
+
     AP_GROUPEND
 };
 
 AP_InertialSensor::AP_InertialSensor() :
     _accel(),
-    _gyro()
+    _gyro(),
+    _have_deltas(false),
+    _last_sample_us(0)
 {
     AP_Param::setup_object_defaults(this, var_info);        
 }
@@ -117,6 +172,10 @@ AP_InertialSensor::init( Start_style style,
         // do cold-start calibration for gyro only
         _init_gyro(flash_leds_cb);
     }
+
+#if AP_INERTIAL_SENSOR_BATCH
+    hal.scheduler->register_io_process(_batch_io);
+#endif
 }
 
 // save parameters to eeprom
@@ -128,6 +187,61 @@ void AP_InertialSensor::_save_parameters()
     _gyro_offset.save();
 }
 
+// set the delta outputs from a driver's integrator. The offsets are
+// removed from the totals rather than from each sample, which only
+// differs in the tiny correction terms
+void AP_InertialSensor::_set_deltas(const AP_InertialSensor_Delta &delta)
+{
+    Vector3f accel_scale = _accel_scale.get();
+    float dt = delta.delta_time();
+
+    _delta_angle = delta.delta_angle();
+    _delta_angle.rotate(_board_orientation);
+    _delta_angle -= _gyro_offset.get() * dt;
+
+    _delta_velocity = delta.delta_velocity();
+    _delta_velocity.rotate(_board_orientation);
+    _delta_velocity.x *= accel_scale.x;
+    _delta_velocity.y *= accel_scale.y;
+    _delta_velocity.z *= accel_scale.z;
+    _delta_velocity -= _accel_offset.get() * dt;
+
+    _have_deltas = true;
+}
+
+#if AP_INERTIAL_SENSOR_BATCH
+AP_InertialSensor_Batch AP_InertialSensor::_batch;
+
+void AP_InertialSensor::_batch_io(uint32_t now)
+{
+    _batch.analyse();
+}
+
+bool AP_InertialSensor::batch_update(AP_InertialSensor_Batch::result &r)
+{
+    bool ret = _batch.get_result(r);
+    _batch.start(_batch_sensor);
+    return ret;
+}
+#endif
+
+#if AP_INERTIAL_SENSOR_RAW_LOG
+AP_InertialSensor_RawLog AP_InertialSensor::_raw_log;
+
+AP_InertialSensor_RawLog *AP_InertialSensor::raw_log(void)
+{
+    _raw_log.enable(_raw_log_enable != 0);
+    return _raw_log_enable != 0 ? &_raw_log : NULL;
+}
+#endif
+
+#if AP_INERTIAL_SENSOR_FILTERS
+void AP_InertialSensor::_configure_filters(AP_InertialSensor_Filters &filters, float sample_hz)
+{
+    filters.configure(sample_hz, _notch_hz, _notch_bw_hz, _lowpass_hz);
+}
+#endif
+
 void
 AP_InertialSensor::init_gyro(void (*flash_leds_cb)(bool on))
 {
@@ -140,9 +254,10 @@ AP_InertialSensor::init_gyro(void (*flash_leds_cb)(bool on))
 void
 AP_InertialSensor::_init_gyro(void (*flash_leds_cb)(bool on))
 {
-    Vector3f last_average, best_avg;
-    Vector3f ins_gyro;
-    float best_diff = 0;
+    AP_InertialSensor_GyroCal cal;
+    Vector3f best_mean;
+    float best_error = 0;
+    uint16_t i;
 
     // cold start
     hal.scheduler->delay(100);
@@ -151,73 +266,70 @@ AP_InertialSensor::_init_gyro(void (*flash_leds_cb)(bool on))
     // remove existing gyro offsets
     _gyro_offset = Vector3f(0,0,0);
 
-    for(int8_t c = 0; c < 25; c++) {
-        // Mostly we are just flashing the LED's here
-        // to tell the user to keep the IMU still
+    // let the sensor settle, and the user see the LEDs
+    for (i = 0; i < 5; i++) {
         FLASH_LEDS(true);
         hal.scheduler->delay(20);
-
         update();
-        ins_gyro = get_gyro();
-
         FLASH_LEDS(false);
         hal.scheduler->delay(20);
     }
 
-    // the strategy is to average 200 points over 1 second, then do it
-    // again and see if the 2nd average is within a small margin of
-    // the first
-
-    last_average.zero();
-
-    // we try to get a good calibration estimate for up to 10 seconds
-    // if the gyros are stable, we should get it in 2 seconds
-    for (int16_t j = 0; j <= 10; j++) {
-        Vector3f gyro_sum, gyro_avg, gyro_diff;
-        float diff_norm;
-        uint8_t i;
-
-        hal.console->printf_P(PSTR("*"));
-
-        gyro_sum.zero();
-        for (i=0; i<200; i++) {
-            update();
-            ins_gyro = get_gyro();
-            gyro_sum += ins_gyro;
-            if (i % 40 == 20) {
-                FLASH_LEDS(true);
-            } else if (i % 40 == 0) {
-                FLASH_LEDS(false);
-            }
-            hal.scheduler->delay(5);
+    // take samples until the mean is known to within 0.01 degrees/s,
+    // a quarter of the 0.1 bit we want the offset to be good to. A
+    // still board should get there in well under a second. If it is
+    // moved the estimate starts again, for up to 10 seconds
+    for (i = 0; i < 2000; i++) {
+        update();
+        if (!cal.add(get_gyro())) {
+            hal.console->printf_P(PSTR("*"));
         }
-        gyro_avg = gyro_sum / i;
-
-        gyro_diff = last_average - gyro_avg;
-        diff_norm = gyro_diff.length();
-
-        if (j == 0) {
-            best_diff = diff_norm;
-            best_avg = gyro_avg;
-        } else if (gyro_diff.length() < ToRad(0.04)) {
-            // we want the average to be within 0.1 bit, which is 0.04 degrees/s
-            last_average = (gyro_avg * 0.5) + (last_average * 0.5);
-            _gyro_offset = last_average;
-
-            // all done
+        if (cal.converged(ToRad(0.01f))) {
+            _gyro_offset = cal.mean();
             return;
-        } else if (diff_norm < best_diff) {
-            best_diff = diff_norm;
-            best_avg = (gyro_avg * 0.5) + (last_average * 0.5);
         }
-        last_average = gyro_avg;
+        if (cal.count() >= AP_GYROCAL_MIN_SAMPLES &&
+            (best_error == 0 || cal.max_error() < best_error)) {
+            best_error = cal.max_error();
+            best_mean = cal.mean();
+        }
+        if (i % 40 == 20) {
+            FLASH_LEDS(true);
+        } else if (i % 40 == 0) {
+            FLASH_LEDS(false);
+        }
+        hal.scheduler->delay(5);
     }
 
-    // we've kept the user waiting long enough - use the best pair we
-    // found so far
-    hal.console->printf_P(PSTR("\ngyro did not converge: diff=%f dps\n"), ToDeg(best_diff));
+    // we've kept the user waiting long enough - use the best estimate
+    // we found so far
+    hal.console->printf_P(PSTR("\ngyro did not converge: error=%f dps\n"), ToDeg(best_error));
 
-    _gyro_offset = best_avg;
+    _gyro_offset = best_error == 0 ? cal.mean() : best_mean;
+}
+
+/*
+  carry on the estimate of the gyro offsets while the vehicle is
+  still. The offsets only move once a much longer run of samples than
+  at startup agrees on them, and by no more than temperature drift
+  could explain, so a slow steady turn is not taken for an offset
+ */
+void
+AP_InertialSensor::refine_gyro_offsets(void)
+{
+    // the raw rates, before the current offsets were taken off
+    Vector3f offsets = _gyro_offset.get();
+    if (!_gyro_cal.add(_gyro + offsets)) {
+        return;
+    }
+    if (_gyro_cal.count() < 500 || !_gyro_cal.converged(ToRad(0.005f))) {
+        return;
+    }
+    Vector3f change = _gyro_cal.mean() - offsets;
+    if (change.length() < ToRad(0.5f)) {
+        _gyro_offset.set(_gyro_cal.mean());
+    }
+    _gyro_cal.reset();
 }
 
 
@@ -11,6 +11,53 @@
 #include <AP_HAL.h>
 #include <AP_Math.h>
 #include "AP_InertialSensor_UserInteract.h"
+#include "AP_InertialSensor_Delta.h"
+#include "AP_InertialSensor_Filters.h"
+#include "AP_InertialSensor_GyroCal.h"
+#include "AP_InertialSensor_AccelCal.h"
+#include "AP_InertialSensor_Batch.h"
+#include "AP_InertialSensor_RawLog.h"
+
+// integrating delta angles and velocities, and software filtering,
+// are floating point work on every sample, which is too much for the
+// timer interrupt on AVR
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+#define AP_INERTIAL_SENSOR_DELTAS 0
+#define AP_INERTIAL_SENSOR_FILTERS 0
+#else
+#define AP_INERTIAL_SENSOR_DELTAS 1
+#define AP_INERTIAL_SENSOR_FILTERS 1
+#endif
+
+// background accel calibration, see AP_InertialSensor_AccelCal.h
+#ifndef AP_INERTIAL_SENSOR_ACCEL_CAL
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+#define AP_INERTIAL_SENSOR_ACCEL_CAL 0
+#else
+#define AP_INERTIAL_SENSOR_ACCEL_CAL 1
+#endif
+#endif
+
+// capture and FFT of raw samples for vibration analysis, see
+// AP_InertialSensor_Batch.h. The buffer is too big for AVR
+#ifndef AP_INERTIAL_SENSOR_BATCH
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+#define AP_INERTIAL_SENSOR_BATCH 0
+#else
+#define AP_INERTIAL_SENSOR_BATCH 1
+#endif
+#endif
+
+// logging of every raw sample, see AP_InertialSensor_RawLog.h. The
+// AVR dataflash can't take the data rate
+#ifndef AP_INERTIAL_SENSOR_RAW_LOG
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+#define AP_INERTIAL_SENSOR_RAW_LOG 0
+#else
+#define AP_INERTIAL_SENSOR_RAW_LOG 1
+#endif
+#endif
+
 /* AP_InertialSensor is an abstraction for gyro and accel measurements
  * which are correctly aligned to the body axes and scaled to SI units.
  *
@@ -92,6 +139,12 @@ public:
     Vector3f get_gyro_offsets(void) { return _gyro_offset; }
     void     set_gyro_offsets(Vector3f offsets) { _gyro_offset.set(offsets); }
 
+    /// Refine the gyro offsets from the samples of the last ::update
+    /// while the vehicle is known to be still, such as when disarmed.
+    /// Offsets found this way are used but not saved
+    ///
+    void                refine_gyro_offsets(void);
+
     /// Fetch the current accelerometer values
     ///
     /// @returns	vector of current accelerations in m/s/s
@@ -106,6 +159,31 @@ public:
     // get accel scale
     Vector3f get_accel_scale() { return _accel_scale; }
 
+#if AP_INERTIAL_SENSOR_ACCEL_CAL
+    // true if the background accel calibration may set the calibration
+    bool accel_learn_enabled() const { return _accel_learn != 0; }
+#endif
+
+#if AP_INERTIAL_SENSOR_BATCH
+    /// Start a capture of raw samples of the sensor INS_BATCH asks for,
+    /// if none is in progress, and fetch the analysis of the last one.
+    /// Call at a few Hz
+    ///
+    /// @returns true if r was filled in with a new analysis
+    ///
+    bool batch_update(AP_InertialSensor_Batch::result &r);
+#endif
+
+#if AP_INERTIAL_SENSOR_RAW_LOG
+    /// The raw samples to log, if INS_RAW_LOG is set, starting or
+    /// stopping the capture to match it. Call at the loop rate while
+    /// IMU logging is on, and take the full blocks with peek() and pop()
+    ///
+    /// @returns NULL if the raw samples aren't to be logged
+    ///
+    AP_InertialSensor_RawLog *raw_log(void);
+#endif
+
     /* Update the sensor data, so that getters are nonblocking.
      * Returns a bool of whether data was updated or not.
      */
@@ -116,6 +194,29 @@ public:
      */
     virtual float get_delta_time() = 0;
 
+    /* get_last_sample_time_micros returns the micros() time the
+     * newest sample in the last ::update was captured
+     */
+    uint32_t get_last_sample_time_micros(void) const { return _last_sample_us; }
+
+    /* get_delta_angle returns the rotation in radians over the
+     * get_delta_time() period, integrated from the individual sensor
+     * samples with coning correction. get_delta_velocity returns the
+     * change in velocity in m/s over the same period, with sculling
+     * correction. Both are in the body frame at the start of the
+     * period. They return false if the driver does not integrate
+     * samples, in which case use get_gyro() and get_accel() times
+     * get_delta_time()
+     */
+    bool get_delta_angle(Vector3f &delta_angle) const {
+        delta_angle = _delta_angle;
+        return _have_deltas;
+    }
+    bool get_delta_velocity(Vector3f &delta_velocity) const {
+        delta_velocity = _delta_velocity;
+        return _have_deltas;
+    }
+
     // return the maximum gyro drift rate in radians/s/s. This
     // depends on what gyro chips are being used
     virtual float get_gyro_drift_rate(void) = 0;
@@ -127,11 +228,15 @@ public:
     static const struct AP_Param::GroupInfo var_info[];
 
     // set overall board orientation
+    enum Rotation get_board_orientation(void) const {
+        return _board_orientation;
+    }
     void set_board_orientation(enum Rotation orientation) {
         _board_orientation = orientation;
     }
 
 protected:
+    friend class AP_InertialSensor_AccelCal;
 
     // sensor specific init to be overwritten by descendant classes
     virtual uint16_t        _init_sensor( Sample_rate sample_rate ) = 0;
@@ -157,12 +262,43 @@ protected:
     // save parameters to eeprom
     void  _save_parameters();
 
+    // set the delta angle and velocity from a driver's integrator,
+    // applying board orientation and calibration the same way as
+    // for _gyro and _accel. Called from update()
+    void _set_deltas(const AP_InertialSensor_Delta &delta);
+
+#if AP_INERTIAL_SENSOR_FILTERS
+    // apply the filter parameters to a driver's per sample filters
+    void _configure_filters(AP_InertialSensor_Filters &filters, float sample_hz);
+#endif
+
+#if AP_INERTIAL_SENSOR_BATCH
+    // raw samples for vibration analysis, fed by the drivers' timer
+    // processes and analysed in the IO process
+    static AP_InertialSensor_Batch _batch;
+    static void _batch_io(uint32_t now);
+#endif
+
+#if AP_INERTIAL_SENSOR_RAW_LOG
+    // full rate samples for the log, fed by the drivers' timer
+    // processes
+    static AP_InertialSensor_RawLog _raw_log;
+#endif
+
     // Most recent accelerometer reading obtained by ::update
     Vector3f _accel;
 
     // Most recent gyro reading obtained by ::update
     Vector3f _gyro;
 
+    // integrated motion over the last ::update period
+    Vector3f _delta_angle;
+    Vector3f _delta_velocity;
+    bool _have_deltas;
+
+    // capture time of the newest sample obtained by ::update
+    uint32_t _last_sample_us;
+
     // product id
     AP_Int16 _product_id;
 
@@ -174,8 +310,30 @@ protected:
     // filtering frequency (0 means default)
     AP_Int8                 _mpu6000_filter;
 
+#if AP_INERTIAL_SENSOR_FILTERS
+    // software filters on raw samples (0 means disabled)
+    AP_Int16                _notch_hz;
+    AP_Int16                _notch_bw_hz;
+    AP_Int16                _lowpass_hz;
+#endif
+
+#if AP_INERTIAL_SENSOR_ACCEL_CAL
+    AP_Int8                 _accel_learn;
+#endif
+
+#if AP_INERTIAL_SENSOR_BATCH
+    AP_Int8                 _batch_sensor;
+#endif
+
+#if AP_INERTIAL_SENSOR_RAW_LOG
+    AP_Int8                 _raw_log_enable;
+#endif
+
     // board orientation from AHRS
     enum Rotation			_board_orientation;
+
+    // estimate for refine_gyro_offsets()
+    AP_InertialSensor_GyroCal _gyro_cal;
 };
 
 #include "AP_InertialSensor_Oilpan.h"
@@ -0,0 +1,131 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_InertialSensor_AccelCal.cpp
+/// @brief	Background accelerometer calibration
+
+#include "AP_InertialSensor.h"
+
+#if AP_INERTIAL_SENSOR_ACCEL_CAL
+
+AP_InertialSensor_AccelCal::AP_InertialSensor_AccelCal(AP_InertialSensor &ins) :
+    _ins(ins),
+    _fitness(0)
+{
+    reset();
+}
+
+void AP_InertialSensor_AccelCal::reset()
+{
+    for (uint8_t i=0; i<6; i++) {
+        _bin[i].sum.zero();
+        _bin[i].count = 0;
+    }
+    _still_count = 0;
+    _last_accel.zero();
+}
+
+uint8_t AP_InertialSensor_AccelCal::get_bins_full() const
+{
+    uint8_t full = 0;
+    for (uint8_t i=0; i<6; i++) {
+        if (_bin[i].count >= ACCEL_CAL_BIN_SAMPLES) {
+            full++;
+        }
+    }
+    return full;
+}
+
+// new_sample - adds the latest reading to the bin of its orientation
+// once the vehicle has been still for a while, and is sitting close to
+// one of the six orientations
+void AP_InertialSensor_AccelCal::new_sample()
+{
+    Vector3f accel = _ins.get_accel();
+    Vector3f change = accel - _last_accel;
+    _last_accel = accel;
+
+    if (_ins.get_gyro().length() > ACCEL_CAL_GYRO_MAX ||
+        fabsf(change.x) > ACCEL_CAL_ACCEL_CHANGE_MAX ||
+        fabsf(change.y) > ACCEL_CAL_ACCEL_CHANGE_MAX ||
+        fabsf(change.z) > ACCEL_CAL_ACCEL_CHANGE_MAX) {
+        _still_count = 0;
+        return;
+    }
+    if (_still_count < ACCEL_CAL_STILL_SAMPLES) {
+        _still_count++;
+        return;
+    }
+
+    // the orientation is the axis gravity is along, and which way.
+    // The bins are in the same order as the manual calibration's
+    // positions: level, left, right, nose down, nose up, back
+    float length = accel.length();
+    uint8_t b;
+    if (-accel.z > ACCEL_CAL_AXIS_MIN * length) {
+        b = 0;
+    } else if (accel.y > ACCEL_CAL_AXIS_MIN * length) {
+        b = 1;
+    } else if (-accel.y > ACCEL_CAL_AXIS_MIN * length) {
+        b = 2;
+    } else if (accel.x > ACCEL_CAL_AXIS_MIN * length) {
+        b = 3;
+    } else if (-accel.x > ACCEL_CAL_AXIS_MIN * length) {
+        b = 4;
+    } else if (accel.z > ACCEL_CAL_AXIS_MIN * length) {
+        b = 5;
+    } else {
+        return;
+    }
+    if (_bin[b].count >= ACCEL_CAL_BIN_SAMPLES) {
+        return;
+    }
+
+    // the reading without the calibration, as the manual calibration
+    // takes it
+    Vector3f offset = _ins.get_accel_offsets();
+    Vector3f scale = _ins.get_accel_scale();
+    _bin[b].sum += Vector3f((accel.x + offset.x) / scale.x,
+                            (accel.y + offset.y) / scale.y,
+                            (accel.z + offset.z) / scale.z);
+    _bin[b].count++;
+}
+
+bool AP_InertialSensor_AccelCal::update()
+{
+    if (get_bins_full() < 6) {
+        return false;
+    }
+
+    Vector3f samples[6];
+    for (uint8_t i=0; i<6; i++) {
+        samples[i] = _bin[i].sum / _bin[i].count;
+    }
+    reset();
+
+    Vector3f new_offsets, new_scaling;
+    if (!_ins._calibrate_accel(samples, new_offsets, new_scaling)) {
+        return false;
+    }
+
+    // six averages fix the six unknowns, so a fit that converged gives
+    // the same length of gravity in every orientation
+    float sum_sq = 0;
+    for (uint8_t i=0; i<6; i++) {
+        Vector3f corrected(samples[i].x * new_scaling.x - new_offsets.x,
+                           samples[i].y * new_scaling.y - new_offsets.y,
+                           samples[i].z * new_scaling.z - new_offsets.z);
+        float error = corrected.length() - GRAVITY_MSS;
+        sum_sq += error * error;
+    }
+    _fitness = safe_sqrt(sum_sq / 6);
+    if (_fitness > ACCEL_CAL_FITNESS_MAX) {
+        return false;
+    }
+
+    _ins.set_accel_offsets(new_offsets);
+    _ins._accel_scale.set(new_scaling);
+    _ins._save_parameters();
+    return true;
+}
+
+#endif // AP_INERTIAL_SENSOR_ACCEL_CAL
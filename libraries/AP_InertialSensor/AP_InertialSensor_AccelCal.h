@@ -0,0 +1,68 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_InertialSensor_AccelCal.h
+/// @brief	Background accelerometer calibration from the vehicle resting
+///         in each of the six orientations of the manual calibration.
+
+#ifndef __AP_INERTIAL_SENSOR_ACCELCAL_H__
+#define __AP_INERTIAL_SENSOR_ACCELCAL_H__
+
+#include <AP_Math.h>
+
+#define ACCEL_CAL_BIN_SAMPLES       50      // still samples averaged for each orientation
+#define ACCEL_CAL_STILL_SAMPLES     20      // quiet samples in a row before any is taken
+#define ACCEL_CAL_GYRO_MAX          ToRad(3.0f) // largest rate of a still sample, in radians/sec
+#define ACCEL_CAL_ACCEL_CHANGE_MAX  0.3f    // largest change from the last sample of a still one, in m/s/s
+#define ACCEL_CAL_AXIS_MIN          0.9f    // least fraction of gravity on the axis of an orientation
+#define ACCEL_CAL_FITNESS_MAX       0.2f    // largest rms error in the length of gravity of a fit that is applied, in m/s/s
+
+class AP_InertialSensor;
+
+/// @class	AP_InertialSensor_AccelCal
+/// @brief	Averages the uncorrected accelerometer over samples taken
+///         while the vehicle is still, in one bin for each of the six
+///         orientations with gravity along an axis. Once every bin is
+///         full the Gauss-Newton fit of the manual calibration is run
+///         on the six averages, and a good fit sets and saves the
+///         offsets and scaling. Then collection starts again.
+///
+///         The fit is linearised afresh on each of its steps, so the
+///         averages are what is kept rather than the normal equations.
+class AP_InertialSensor_AccelCal
+{
+public:
+    AP_InertialSensor_AccelCal(AP_InertialSensor &ins);
+
+    /// Consider the latest ::update of the sensor for the bins. Call
+    /// only while the vehicle is on the ground and disarmed
+    void            new_sample();
+
+    /// Run the fit if every bin is full
+    ///
+    /// @returns    true if a fit finished and its calibration was applied
+    ///
+    bool            update();
+
+    /// Throw away the samples
+    void            reset();
+
+    /// bins that are full, out of six
+    uint8_t         get_bins_full() const;
+
+    /// rms error in the length of gravity of the last fit, in m/s/s
+    float           get_fitness() const { return _fitness; }
+
+private:
+    struct bin {
+        Vector3f    sum;                // of uncorrected samples
+        uint8_t     count;
+    };
+
+    AP_InertialSensor & _ins;
+    struct bin      _bin[6];
+    Vector3f        _last_accel;
+    uint8_t         _still_count;
+    float           _fitness;
+};
+
+#endif // __AP_INERTIAL_SENSOR_ACCELCAL_H__
@@ -0,0 +1,155 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include "AP_InertialSensor.h"
+
+#if AP_INERTIAL_SENSOR_BATCH
+
+extern const AP_HAL::HAL& hal;
+
+AP_InertialSensor_Batch::AP_InertialSensor_Batch() :
+    _state(BATCH_IDLE),
+    _sensor(BATCH_NONE),
+    _count(0)
+{
+}
+
+void AP_InertialSensor_Batch::start(uint8_t sensor)
+{
+    if (_state != BATCH_IDLE ||
+        (sensor != BATCH_GYRO && sensor != BATCH_ACCEL)) {
+        return;
+    }
+    _sensor = sensor;
+    _count = 0;
+    _state = BATCH_CAPTURE;
+}
+
+bool AP_InertialSensor_Batch::get_result(struct result &r)
+{
+    if (_state != BATCH_DONE) {
+        return false;
+    }
+    r = _result;
+    _state = BATCH_IDLE;
+    return true;
+}
+
+void AP_InertialSensor_Batch::sample(const Vector3f &gyro, const Vector3f &accel)
+{
+    if (_state != BATCH_CAPTURE) {
+        return;
+    }
+    const Vector3f &v = (_sensor == BATCH_GYRO) ? gyro : accel;
+    _data[0][_count] = v.x;
+    _data[1][_count] = v.y;
+    _data[2][_count] = v.z;
+    if (_count == 0) {
+        _start_us = hal.scheduler->micros();
+    }
+    _count++;
+    if (_count == INS_BATCH_SAMPLES) {
+        _end_us = hal.scheduler->micros();
+        _state = BATCH_FULL;
+    }
+}
+
+void AP_InertialSensor_Batch::analyse(void)
+{
+    if (_state != BATCH_FULL) {
+        return;
+    }
+    const uint16_t n = INS_BATCH_SAMPLES;
+
+    _result.sensor = _sensor;
+    _result.sample_hz = 0;
+    if (_end_us != _start_us) {
+        _result.sample_hz = (n - 1) * 1.0e6f / (uint32_t)(_end_us - _start_us);
+    }
+
+    for (uint8_t axis=0; axis<3; axis++) {
+        float *re = _data[axis];
+
+        // take out the mean, and apply a Hann window so that a peak
+        // between bins doesn't leak across the whole spectrum
+        float mean = 0;
+        for (uint16_t i=0; i<n; i++) {
+            mean += re[i];
+        }
+        mean /= n;
+        for (uint16_t i=0; i<n; i++) {
+            float w = 0.5f - 0.5f * cosf(2 * PI * i / n);
+            re[i] = (re[i] - mean) * w;
+            _im[i] = 0;
+        }
+
+        _fft(re, _im, n);
+
+        // power of each bin up to the Nyquist frequency, in re[]
+        uint16_t peak = 1;
+        for (uint16_t k=1; k<n/2; k++) {
+            re[k] = re[k]*re[k] + _im[k]*_im[k];
+            if (re[k] > re[peak]) {
+                peak = k;
+            }
+        }
+
+        // the Hann window spreads a tone over three bins. A parabola
+        // through them places the peak between bins
+        float offset = 0;
+        float energy = re[peak];
+        if (peak > 1 && peak < n/2 - 1) {
+            float a = sqrtf(re[peak-1]), b = sqrtf(re[peak]), c = sqrtf(re[peak+1]);
+            float d = a - 2*b + c;
+            if (d < 0) {
+                offset = 0.5f * (a - c) / d;
+            }
+            energy += re[peak-1] + re[peak+1];
+        }
+        _result.peak_hz[axis] = (peak + offset) * _result.sample_hz / n;
+
+        // a sine of amplitude A gives bins summing to A^2 n^2 3/32
+        // with the window, against a mean square of A^2/2
+        _result.peak_energy[axis] = energy * (16.0f / 3.0f) / ((float)n * n);
+    }
+
+    _state = BATCH_DONE;
+}
+
+void AP_InertialSensor_Batch::_fft(float *re, float *im, uint16_t n)
+{
+    // bit reversed reordering
+    for (uint16_t i=1, j=0; i<n; i++) {
+        uint16_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    // butterflies, with the twiddle factor stepped by rotation
+    for (uint16_t len=2; len<=n; len<<=1) {
+        float angle = -2 * PI / len;
+        float wr_step = cosf(angle), wi_step = sinf(angle);
+        for (uint16_t i=0; i<n; i+=len) {
+            float wr = 1, wi = 0;
+            for (uint16_t j=0; j<len/2; j++) {
+                uint16_t a = i + j, b = i + j + len/2;
+                float tr = re[b]*wr - im[b]*wi;
+                float ti = re[b]*wi + im[b]*wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+                float t = wr*wr_step - wi*wi_step;
+                wi = wr*wi_step + wi*wr_step;
+                wr = t;
+            }
+        }
+    }
+}
+
+#endif // AP_INERTIAL_SENSOR_BATCH
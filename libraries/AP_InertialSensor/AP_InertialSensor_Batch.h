@@ -0,0 +1,73 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#ifndef __AP_INERTIAL_SENSOR_BATCH_H__
+#define __AP_INERTIAL_SENSOR_BATCH_H__
+
+#include <AP_Math.h>
+
+#define INS_BATCH_SAMPLES       256     // samples of each axis in a capture, a power of two
+
+/*
+  captures a batch of raw gyro or accel samples at the full sensor
+  rate, as the driver reads them and before any filtering, then finds
+  the strongest vibration on each axis with an FFT.
+
+  The work is handed between threads by the state: the main thread
+  starts a capture, the timer process fills the buffer, the IO
+  process runs the FFT, and the main thread picks up the result. Each
+  only touches the buffer in its own state, so there are no locks
+ */
+class AP_InertialSensor_Batch
+{
+public:
+    enum batch_sensor {
+        BATCH_NONE = 0,
+        BATCH_GYRO,
+        BATCH_ACCEL
+    };
+
+    struct result {
+        uint8_t sensor;             // batch_sensor
+        float sample_hz;            // measured over the capture
+        float peak_hz[3];           // frequency of the largest peak on each axis
+        float peak_energy[3];       // mean square of the peak, in (rad/s)^2 or (m/s/s)^2
+    };
+
+    AP_InertialSensor_Batch();
+
+    // start a capture of one sensor if none is in progress. From the
+    // main thread
+    void start(uint8_t sensor);
+
+    // fetch the result of a finished capture, leaving the way clear
+    // for the next. From the main thread
+    bool get_result(struct result &r);
+
+    // add one sample, in radians/sec and m/s/s. From the timer process
+    void sample(const Vector3f &gyro, const Vector3f &accel);
+
+    // analyse a full capture. From the IO process
+    void analyse(void);
+
+private:
+    enum batch_state {
+        BATCH_IDLE = 0,
+        BATCH_CAPTURE,
+        BATCH_FULL,
+        BATCH_DONE
+    };
+
+    // in place radix-2 FFT of n points, n a power of two
+    static void _fft(float *re, float *im, uint16_t n);
+
+    volatile uint8_t _state;
+    uint8_t _sensor;
+    uint16_t _count;
+    uint32_t _start_us;
+    uint32_t _end_us;
+    float _data[3][INS_BATCH_SAMPLES];
+    float _im[INS_BATCH_SAMPLES];
+    struct result _result;
+};
+
+#endif // __AP_INERTIAL_SENSOR_BATCH_H__
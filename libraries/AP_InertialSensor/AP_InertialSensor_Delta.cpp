@@ -0,0 +1,37 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include "AP_InertialSensor_Delta.h"
+
+void AP_InertialSensor_Delta::reset(void)
+{
+    _alpha.zero();
+    _coning.zero();
+    _last_dalpha.zero();
+    _vel.zero();
+    _sculling.zero();
+    _last_dvel.zero();
+    _dt = 0;
+}
+
+void AP_InertialSensor_Delta::accumulate(const Vector3f &gyro, const Vector3f &accel, float dt)
+{
+    Vector3f dalpha = gyro * dt;
+    Vector3f dvel   = accel * dt;
+
+    // the corrections use the sums before this sample
+    _coning   += ((_alpha + _last_dalpha * (1.0f/6.0f)) % dalpha) * 0.5f;
+    _sculling += ((_alpha + _last_dalpha * (1.0f/6.0f)) % dvel +
+                  (_vel + _last_dvel * (1.0f/6.0f)) % dalpha) * 0.5f;
+
+    _alpha += dalpha;
+    _vel   += dvel;
+    _last_dalpha = dalpha;
+    _last_dvel   = dvel;
+    _dt += dt;
+}
+
+Vector3f AP_InertialSensor_Delta::delta_velocity(void) const
+{
+    // add the rotation of the velocity increments over the interval
+    return _vel + (_alpha % _vel) * 0.5f + _sculling;
+}
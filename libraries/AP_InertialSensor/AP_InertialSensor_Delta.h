@@ -0,0 +1,49 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#ifndef __AP_INERTIAL_SENSOR_DELTA_H__
+#define __AP_INERTIAL_SENSOR_DELTA_H__
+
+#include <AP_Math.h>
+
+/*
+  integrates individual gyro and accel samples into a delta angle and
+  delta velocity, with coning and sculling correction, so that motion
+  faster than the application rate is not lost to averaging.
+
+  Both results are in the sensor frame at the start of the interval.
+  The corrections follow the two sample algorithms in Savage,
+  "Strapdown Inertial Navigation Integration Algorithm Design",
+  using the previous sample as the second one.
+ */
+class AP_InertialSensor_Delta
+{
+public:
+    AP_InertialSensor_Delta() { reset(); }
+
+    // start a new interval
+    void reset(void);
+
+    // add one sample. gyro is in radians/sec, accel in m/s/s and dt
+    // in seconds
+    void accumulate(const Vector3f &gyro, const Vector3f &accel, float dt);
+
+    // the rotation in radians since reset()
+    Vector3f delta_angle(void) const { return _alpha + _coning; }
+
+    // the change in velocity in m/s since reset()
+    Vector3f delta_velocity(void) const;
+
+    // the time in seconds since reset()
+    float delta_time(void) const { return _dt; }
+
+private:
+    Vector3f _alpha;            // summed angle increments
+    Vector3f _coning;           // coning correction
+    Vector3f _last_dalpha;      // previous angle increment
+    Vector3f _vel;              // summed velocity increments
+    Vector3f _sculling;         // sculling correction
+    Vector3f _last_dvel;        // previous velocity increment
+    float _dt;
+};
+
+#endif // __AP_INERTIAL_SENSOR_DELTA_H__
@@ -0,0 +1,48 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include "AP_InertialSensor_Filters.h"
+
+AP_InertialSensor_Filters::AP_InertialSensor_Filters() :
+    _sample_hz(0),
+    _notch_hz(0),
+    _notch_bw_hz(0),
+    _lowpass_hz(0),
+    _notch_enabled(false),
+    _lowpass_enabled(false)
+{
+}
+
+void AP_InertialSensor_Filters::configure(float sample_hz, float notch_hz, float notch_bw_hz, float lowpass_hz)
+{
+    if (sample_hz == _sample_hz && notch_hz == _notch_hz &&
+        notch_bw_hz == _notch_bw_hz && lowpass_hz == _lowpass_hz) {
+        return;
+    }
+    _sample_hz   = sample_hz;
+    _notch_hz    = notch_hz;
+    _notch_bw_hz = notch_bw_hz;
+    _lowpass_hz  = lowpass_hz;
+
+    float nyquist = sample_hz * 0.5f;
+    _notch_enabled   = notch_hz > 0 && notch_hz < nyquist && notch_bw_hz > 0;
+    _lowpass_enabled = lowpass_hz > 0 && lowpass_hz < nyquist;
+
+    if (_notch_enabled) {
+        _gyro_notch.set_notch(sample_hz, notch_hz, notch_bw_hz);
+        _accel_notch.set_notch(sample_hz, notch_hz, notch_bw_hz);
+    }
+    if (_lowpass_enabled) {
+        _gyro_lowpass.set_lowpass(sample_hz, lowpass_hz);
+        _accel_lowpass.set_lowpass(sample_hz, lowpass_hz);
+    }
+}
+
+void AP_InertialSensor_Filters::_apply(BiquadFilterVector3f &notch, BiquadFilterVector3f &lowpass, Vector3f &v)
+{
+    if (_notch_enabled) {
+        v = notch.apply(v);
+    }
+    if (_lowpass_enabled) {
+        v = lowpass.apply(v);
+    }
+}
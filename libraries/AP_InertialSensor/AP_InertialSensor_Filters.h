@@ -0,0 +1,49 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#ifndef __AP_INERTIAL_SENSOR_FILTERS_H__
+#define __AP_INERTIAL_SENSOR_FILTERS_H__
+
+#include <AP_Math.h>
+#include <BiquadFilter.h>
+
+/*
+  software notch and low pass filters run on every raw gyro and accel
+  sample, before the driver averages them down to the application
+  rate. This removes vibration that would otherwise alias into the
+  averaged result
+ */
+class AP_InertialSensor_Filters
+{
+public:
+    AP_InertialSensor_Filters();
+
+    // set the sample rate and filter frequencies. A frequency of 0,
+    // or one at or above the Nyquist frequency, disables that filter.
+    // Does nothing if nothing has changed. Must not run at the same
+    // time as apply_gyro() or apply_accel()
+    void configure(float sample_hz, float notch_hz, float notch_bw_hz, float lowpass_hz);
+
+    // true if any filter is active
+    bool enabled(void) const { return _notch_enabled || _lowpass_enabled; }
+
+    // filter one sample in place
+    void apply_gyro(Vector3f &gyro)   { _apply(_gyro_notch, _gyro_lowpass, gyro); }
+    void apply_accel(Vector3f &accel) { _apply(_accel_notch, _accel_lowpass, accel); }
+
+private:
+    void _apply(BiquadFilterVector3f &notch, BiquadFilterVector3f &lowpass, Vector3f &v);
+
+    BiquadFilterVector3f _gyro_notch;
+    BiquadFilterVector3f _gyro_lowpass;
+    BiquadFilterVector3f _accel_notch;
+    BiquadFilterVector3f _accel_lowpass;
+
+    float _sample_hz;
+    float _notch_hz;
+    float _notch_bw_hz;
+    float _lowpass_hz;
+    bool _notch_enabled;
+    bool _lowpass_enabled;
+};
+
+#endif // __AP_INERTIAL_SENSOR_FILTERS_H__
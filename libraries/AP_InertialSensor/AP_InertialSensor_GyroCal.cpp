@@ -0,0 +1,51 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include "AP_InertialSensor_GyroCal.h"
+
+void AP_InertialSensor_GyroCal::reset(void)
+{
+    _mean.zero();
+    _m2.zero();
+    _count = 0;
+}
+
+bool AP_InertialSensor_GyroCal::add(const Vector3f &gyro)
+{
+    Vector3f delta = gyro - _mean;
+
+    // a few samples are needed before the mean means anything
+    if (_count >= 10 &&
+        (fabsf(delta.x) > AP_GYROCAL_MOTION_LIMIT ||
+         fabsf(delta.y) > AP_GYROCAL_MOTION_LIMIT ||
+         fabsf(delta.z) > AP_GYROCAL_MOTION_LIMIT)) {
+        reset();
+        return false;
+    }
+
+    if (_count == 0xFFFF) {
+        // long enough; keep the estimate as it is
+        return true;
+    }
+    _count++;
+    _mean += delta / _count;
+    Vector3f delta2 = gyro - _mean;
+    _m2.x += delta.x * delta2.x;
+    _m2.y += delta.y * delta2.y;
+    _m2.z += delta.z * delta2.z;
+    return true;
+}
+
+float AP_InertialSensor_GyroCal::max_error(void) const
+{
+    if (_count < 2) {
+        return 1.0e6f;
+    }
+    // variance/n is m2/((n-1)*n)
+    float m2 = max(_m2.x, max(_m2.y, _m2.z));
+    return safe_sqrt(m2 / ((float)(_count - 1) * _count));
+}
+
+bool AP_InertialSensor_GyroCal::converged(float bound) const
+{
+    return _count >= AP_GYROCAL_MIN_SAMPLES && max_error() < bound;
+}
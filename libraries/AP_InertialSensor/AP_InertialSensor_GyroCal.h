@@ -0,0 +1,51 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#ifndef __AP_INERTIAL_SENSOR_GYROCAL_H__
+#define __AP_INERTIAL_SENSOR_GYROCAL_H__
+
+#include <AP_Math.h>
+
+// least samples before the mean is trusted
+#define AP_GYROCAL_MIN_SAMPLES      50
+
+// a sample further than this from the mean on any axis means the
+// vehicle moved, in radians/sec
+#define AP_GYROCAL_MOTION_LIMIT     ToRad(1.0f)
+
+/*
+  running mean and variance of the gyro on each axis, using Welford's
+  method, for finding the gyro offsets while the vehicle is still.
+
+  The mean has converged once the standard error on every axis,
+  sqrt(variance/n), is below a bound, so a quiet sensor finishes in a
+  fraction of a second while a noisy one takes as long as it needs.
+  Any sample showing motion starts the estimate again.
+ */
+class AP_InertialSensor_GyroCal
+{
+public:
+    AP_InertialSensor_GyroCal() { reset(); }
+
+    void reset(void);
+
+    // add one sample in radians/sec. Returns false, having restarted
+    // the estimate, if the sample shows the vehicle moving
+    bool add(const Vector3f &gyro);
+
+    // true if there are enough samples and the standard error of the
+    // mean is below bound on every axis, in radians/sec
+    bool converged(float bound) const;
+
+    // the largest standard error of the mean over the axes
+    float max_error(void) const;
+
+    const Vector3f &mean(void) const { return _mean; }
+    uint16_t count(void) const { return _count; }
+
+private:
+    Vector3f _mean;
+    Vector3f _m2;               // summed squared differences from the mean
+    uint16_t _count;
+};
+
+#endif // __AP_INERTIAL_SENSOR_GYROCAL_H__
@@ -52,6 +52,12 @@ extern const AP_HAL::HAL& hal;
 #define MPUREG_ZRMOT_THR                                0x21    // detection threshold for Zero Motion interrupt generation.
 #define MPUREG_ZRMOT_DUR                                0x22    // duration counter threshold for Zero Motion interrupt generation. The duration counter ticks at 16 Hz, therefore ZRMOT_DUR has a unit of 1 LSB = 64 ms.
 #define MPUREG_FIFO_EN                                  0x23
+// bit definitions for MPUREG_FIFO_EN
+#       define BIT_FIFO_EN_ACCEL                                0x08
+#       define BIT_FIFO_EN_ZG                                   0x10
+#       define BIT_FIFO_EN_YG                                   0x20
+#       define BIT_FIFO_EN_XG                                   0x40
+#       define BIT_FIFO_EN_TEMP                                 0x80
 #define MPUREG_INT_PIN_CFG                              0x37
 #       define BIT_INT_RD_CLEAR                                 0x10    // clear the interrupt when any read occurs
 #       define BIT_LATCH_INT_EN                                 0x20    // latch data ready pin 
@@ -163,6 +169,12 @@ extern const AP_HAL::HAL& hal;
 // Default gain for accel fusion (with gyros)
 #define DEFAULT_ACCEL_FUSION_GAIN       0x80
 
+// raw FIFO constants
+#define MPU6000_FIFO_SIZE 1024
+// accel, temperature and gyro, the same layout as a read from
+// MPUREG_ACCEL_XOUT_H
+#define MPU6000_FIFO_SAMPLE_SIZE 14
+
 /*
  *  RM-MPU-6000A-00.pdf, page 33, section 4.25 lists LSB sensitivity of
  *  gyro as 16.4 LSB/DPS at scale factor of +/- 2000dps (FS_SEL==3)
@@ -194,14 +206,26 @@ AP_HAL::DigitalSource *AP_InertialSensor_MPU6000::_drdy_pin = NULL;
 // time latest sample was collected
 static volatile uint32_t _last_sample_time_micros = 0;
 
+// time between hardware samples
+static uint16_t _sample_period_us = 5000;
+
+#if MPU6000_FIFO_MODE
+// time the FIFO was last drained
+static uint32_t _last_fifo_poll_us;
+#endif
+
 // DMP related static variables
 bool AP_InertialSensor_MPU6000::_dmp_initialised = false;
 // high byte of number of elements in fifo buffer
 uint8_t AP_InertialSensor_MPU6000::_fifoCountH;
 // low byte of number of elements in fifo buffer
 uint8_t AP_InertialSensor_MPU6000::_fifoCountL;
-// holds the 4 quaternions representing attitude taken directly from the DMP
+// attitude from the DMP as of the last update()
 Quaternion AP_InertialSensor_MPU6000::quaternion;
+// the newest attitude read by the timer process, and how many packets
+// it has read since the last update()
+static Quaternion _dmp_quaternion;
+static volatile uint8_t _dmp_packets;
 
 /* Static SPI device driver */
 AP_HAL::SPIDeviceDriver* AP_InertialSensor_MPU6000::_spi = NULL;
@@ -220,6 +244,7 @@ AP_InertialSensor_MPU6000::AP_InertialSensor_MPU6000() : AP_InertialSensor()
     _temp = 0;
     _initialised = false;
     _dmp_initialised = false;
+    _dmp_count = 0;
 }
 
 uint16_t AP_InertialSensor_MPU6000::_init_sensor( Sample_rate sample_rate )
@@ -235,6 +260,11 @@ uint16_t AP_InertialSensor_MPU6000::_init_sensor( Sample_rate sample_rate )
        (It is not a valid pin under Arduino.) */
     _drdy_pin = hal.gpio->channel(70);
 
+#if AP_INERTIAL_SENSOR_RAW_LOG
+    // log the sensor's own counts
+    _raw_log.set_scale(_gyro_scale, MPU6000_ACCEL_SCALE_1G);
+#endif
+
     hal.scheduler->suspend_timer_procs();
 
     uint8_t tries = 0;
@@ -257,11 +287,17 @@ uint16_t AP_InertialSensor_MPU6000::_init_sensor( Sample_rate sample_rate )
     hal.scheduler->resume_timer_procs();
     
 
+#if MPU6000_FIFO_MODE
+    // the FIFO was started by hardware_init(), and the first lot of
+    // samples is read by the timer process
+    _last_fifo_poll_us = hal.scheduler->micros();
+#else
     /* read the first lot of data.
      * _read_data_transaction requires the spi semaphore to be taken by
      * its caller. */
     _last_sample_time_micros = hal.scheduler->micros();
     _read_data_transaction();
+#endif
 
     // start the timer process to read samples
     hal.scheduler->register_timer_process(_poll_data);
@@ -279,6 +315,74 @@ static volatile int32_t _sum[7];
 // how many values we've accumulated since last read
 static volatile uint16_t _count;
 
+#if AP_INERTIAL_SENSOR_DELTAS
+// integrated motion since last read
+static AP_InertialSensor_Delta _delta;
+#endif
+
+#if AP_INERTIAL_SENSOR_FILTERS
+// software filters, and the sums of filtered samples since last read.
+// _filtering only changes between reads
+static AP_InertialSensor_Filters _filters;
+static bool _filtering;
+static Vector3f _gyro_filtered_sum;
+static Vector3f _accel_filtered_sum;
+#endif
+
+/*
+  add one sample, in MPUREG_ACCEL_XOUT_H register order, to _sum[]
+ */
+void AP_InertialSensor_MPU6000::_accumulate_sample(const uint8_t *data)
+{
+    int16_t v[7];
+    for (uint8_t i = 0; i < 7; i++) {
+        v[i] = (int16_t)(((uint16_t)data[2*i] << 8) | data[2*i+1]);
+        _sum[i] += v[i];
+    }
+
+#if AP_INERTIAL_SENSOR_DELTAS || AP_INERTIAL_SENSOR_FILTERS || AP_INERTIAL_SENSOR_BATCH || AP_INERTIAL_SENSOR_RAW_LOG
+    Vector3f gyro(_gyro_data_sign[0] * v[_gyro_data_index[0]],
+                  _gyro_data_sign[1] * v[_gyro_data_index[1]],
+                  _gyro_data_sign[2] * v[_gyro_data_index[2]]);
+    Vector3f accel(_accel_data_sign[0] * v[_accel_data_index[0]],
+                   _accel_data_sign[1] * v[_accel_data_index[1]],
+                   _accel_data_sign[2] * v[_accel_data_index[2]]);
+    gyro  *= _gyro_scale;
+    accel *= MPU6000_ACCEL_SCALE_1G;
+#endif
+
+#if AP_INERTIAL_SENSOR_BATCH
+    _batch.sample(gyro, accel);
+#endif
+
+#if AP_INERTIAL_SENSOR_RAW_LOG
+    _raw_log.sample(gyro, accel, hal.scheduler->micros());
+#endif
+
+#if AP_INERTIAL_SENSOR_FILTERS
+    if (_filtering) {
+        _filters.apply_gyro(gyro);
+        _filters.apply_accel(accel);
+        _gyro_filtered_sum  += gyro;
+        _accel_filtered_sum += accel;
+    }
+#endif
+
+#if AP_INERTIAL_SENSOR_DELTAS
+    _delta.accumulate(gyro, accel, _sample_period_us * 1.0e-6f);
+#endif
+
+    _count++;
+    if (_count == 0) {
+        // rollover - v unlikely
+        memset((void*)_sum, 0, sizeof(_sum));
+    }
+
+    if (hal.scheduler->in_timerprocess()) {
+        hal.scheduler->signal_main();
+    }
+}
+
 /*================ AP_INERTIALSENSOR PUBLIC INTERFACE ==================== */
 
 void AP_InertialSensor_MPU6000::wait_for_sample()
@@ -292,6 +396,8 @@ void AP_InertialSensor_MPU6000::wait_for_sample()
                     PSTR("PANIC: AP_InertialSensor_MPU6000::update "
                         "waited 50ms for data from interrupt"));
         }
+        // sleep until the timer process has read a sample
+        hal.scheduler->wait_for_signal(1000);
     }
 }
 
@@ -300,6 +406,13 @@ bool AP_InertialSensor_MPU6000::update( void )
     int32_t sum[7];
     float count_scale;
     Vector3f accel_scale = _accel_scale.get();
+#if AP_INERTIAL_SENSOR_DELTAS
+    AP_InertialSensor_Delta delta;
+#endif
+#if AP_INERTIAL_SENSOR_FILTERS
+    bool filtered;
+    Vector3f gyro_filtered_sum, accel_filtered_sum;
+#endif
 
     // wait for at least 1 sample
     wait_for_sample();
@@ -315,23 +428,60 @@ bool AP_InertialSensor_MPU6000::update( void )
 
         _num_samples = _count;
         _count = 0;
+        _last_sample_us = _last_sample_time_micros;
+        quaternion = _dmp_quaternion;
+        _dmp_count = _dmp_packets;
+        _dmp_packets = 0;
+#if AP_INERTIAL_SENSOR_DELTAS
+        delta = _delta;
+        _delta.reset();
+#endif
+#if AP_INERTIAL_SENSOR_FILTERS
+        filtered = _filtering;
+        gyro_filtered_sum  = _gyro_filtered_sum;
+        accel_filtered_sum = _accel_filtered_sum;
+        _gyro_filtered_sum.zero();
+        _accel_filtered_sum.zero();
+
+        // pick up any parameter change for the next lot of samples
+        _configure_filters(_filters, 1.0e6f / _sample_period_us);
+        _filtering = _filters.enabled();
+#endif
     }
     hal.scheduler->resume_timer_procs();
 
+#if AP_INERTIAL_SENSOR_DELTAS
+    _set_deltas(delta);
+#endif
+
     count_scale = 1.0f / _num_samples;
 
-    _gyro  = Vector3f(_gyro_data_sign[0] * sum[_gyro_data_index[0]],
+    Vector3f gyro_sum(_gyro_data_sign[0] * sum[_gyro_data_index[0]],
                       _gyro_data_sign[1] * sum[_gyro_data_index[1]],
                       _gyro_data_sign[2] * sum[_gyro_data_index[2]]);
+    Vector3f accel_sum(_accel_data_sign[0] * sum[_accel_data_index[0]],
+                       _accel_data_sign[1] * sum[_accel_data_index[1]],
+                       _accel_data_sign[2] * sum[_accel_data_index[2]]);
+    float gyro_scale = _gyro_scale;
+    float accel_scale_1g = MPU6000_ACCEL_SCALE_1G;
+#if AP_INERTIAL_SENSOR_FILTERS
+    if (filtered) {
+        // the filtered sums are already scaled
+        gyro_sum = gyro_filtered_sum;
+        accel_sum = accel_filtered_sum;
+        gyro_scale = 1;
+        accel_scale_1g = 1;
+    }
+#endif
+
+    _gyro  = gyro_sum;
     _gyro.rotate(_board_orientation);
-    _gyro *= _gyro_scale * count_scale;
+    _gyro *= gyro_scale * count_scale;
     _gyro -= _gyro_offset;
 
-    _accel   = Vector3f(_accel_data_sign[0] * sum[_accel_data_index[0]],
-                        _accel_data_sign[1] * sum[_accel_data_index[1]],
-                        _accel_data_sign[2] * sum[_accel_data_index[2]]);
+    _accel   = accel_sum;
     _accel.rotate(_board_orientation);
-    _accel *= count_scale * MPU6000_ACCEL_SCALE_1G;
+    _accel *= count_scale * accel_scale_1g;
     _accel.x *= accel_scale.x;
     _accel.y *= accel_scale.y;
     _accel.z *= accel_scale.z;
@@ -392,6 +542,29 @@ bool AP_InertialSensor_MPU6000::_data_ready()
  */
 void AP_InertialSensor_MPU6000::_poll_data(uint32_t now)
 {
+#if MPU6000_FIFO_MODE
+    if (hal.scheduler->in_timerprocess()) {
+        if (now - _last_fifo_poll_us < MPU6000_FIFO_POLL_US ||
+            !_spi_sem->take_nonblocking()) {
+            return;
+        }
+    } else {
+        // synchronous read from num_samples_available(). Don't
+        // bother the sensor until at least one sample is due
+        now = hal.scheduler->micros();
+        if (now - _last_fifo_poll_us < _sample_period_us) {
+            return;
+        }
+        if (!_spi_sem->take(10)) {
+            hal.scheduler->panic(
+                    PSTR("PANIC: AP_InertialSensor_MPU6000::_poll_data "
+                         "failed to take SPI semaphore synchronously"));
+        }
+    }
+    _last_fifo_poll_us = now;
+    _read_fifo(now);
+    _spi_sem->give();
+#else
     if (_data_ready()) {
         if (hal.scheduler->in_timerprocess()) {
             _read_data_from_timerprocess();
@@ -409,6 +582,7 @@ void AP_InertialSensor_MPU6000::_poll_data(uint32_t now)
             }
         }
     }
+#endif
 }
 
 /*
@@ -441,29 +615,76 @@ void AP_InertialSensor_MPU6000::_read_data_from_timerprocess()
 
 void AP_InertialSensor_MPU6000::_read_data_transaction() {
     /* one resister address followed by seven 2-byte registers */
-    uint8_t tx[15];
-    uint8_t rx[15];
-    memset(tx,0,15);
-    tx[0] = MPUREG_ACCEL_XOUT_H | 0x80;
-    _spi->transaction(tx, rx, 15);
+    uint8_t addr = MPUREG_ACCEL_XOUT_H | 0x80;
+    uint8_t rx[14];
+    const AP_HAL::SPISegment segs[2] = {
+        { &addr, NULL, 1 },
+        { NULL, rx, sizeof(rx) }
+    };
+    _spi->transfer_segments(segs, 2, NULL, NULL);
 
-    for (uint8_t i = 0; i < 7; i++) {
-        _sum[i] += (int16_t)(((uint16_t)rx[2*i+1] << 8) | rx[2*i+2]);
-    }   
-    
-    _count++;
-    if (_count == 0) {
-        // rollover - v unlikely
-        memset((void*)_sum, 0, sizeof(_sum));
-    }
+    _accumulate_sample(rx);
 
     // should also read FIFO data if enabled
     if( _dmp_initialised ) {
-        if( FIFO_ready() ) {
-            FIFO_getPacket();
+        FIFO_getPacket();
+    }
+}
+
+#if MPU6000_FIFO_MODE
+/*
+  discard the FIFO contents and start filling it again. Assumes
+  caller has taken semaphore
+ */
+void AP_InertialSensor_MPU6000::_fifo_restart()
+{
+    register_write(MPUREG_USER_CTRL, BIT_USER_CTRL_I2C_IF_DIS);
+    register_write(MPUREG_USER_CTRL, BIT_USER_CTRL_I2C_IF_DIS | BIT_USER_CTRL_FIFO_RESET);
+    register_write(MPUREG_USER_CTRL, BIT_USER_CTRL_I2C_IF_DIS | BIT_USER_CTRL_FIFO_EN);
+}
+
+/*
+  read all complete samples waiting in the FIFO into _sum[]. The
+  sensor gives no timestamps, so they are reconstructed from the
+  sample rate taking the newest sample as arriving at now. Assumes
+  caller has taken semaphore
+ */
+void AP_InertialSensor_MPU6000::_read_fifo(uint32_t now)
+{
+    uint8_t addr = MPUREG_FIFO_COUNTH | 0x80;
+    uint8_t count[2];
+    const AP_HAL::SPISegment count_segs[2] = {
+        { &addr, NULL, 1 },
+        { NULL, count, sizeof(count) }
+    };
+    _spi->transfer_segments(count_segs, 2, NULL, NULL);
+
+    uint16_t bytes = ((uint16_t)count[0] << 8) | count[1];
+    if (bytes > MPU6000_FIFO_SIZE - MPU6000_FIFO_SAMPLE_SIZE) {
+        // the FIFO has overflowed, or is about to, and we can no
+        // longer tell where samples start
+        _fifo_restart();
+        return;
+    }
+
+    uint16_t n = bytes / MPU6000_FIFO_SAMPLE_SIZE;
+    uint8_t rx[MPU6000_FIFO_BURST * MPU6000_FIFO_SAMPLE_SIZE];
+    addr = MPUREG_FIFO_R_W | 0x80;
+    while (n > 0) {
+        uint8_t burst = n > MPU6000_FIFO_BURST ? MPU6000_FIFO_BURST : n;
+        const AP_HAL::SPISegment segs[2] = {
+            { &addr, NULL, 1 },
+            { NULL, rx, (uint16_t)(burst * MPU6000_FIFO_SAMPLE_SIZE) }
+        };
+        _spi->transfer_segments(segs, 2, NULL, NULL);
+        for (uint8_t i = 0; i < burst; i++) {
+            n--;
+            _last_sample_time_micros = now - (uint32_t)n * _sample_period_us;
+            _accumulate_sample(&rx[i * MPU6000_FIFO_SAMPLE_SIZE]);
         }
     }
 }
+#endif // MPU6000_FIFO_MODE
 
 uint8_t AP_InertialSensor_MPU6000::_register_read( uint8_t reg )
 {
@@ -562,6 +783,7 @@ bool AP_InertialSensor_MPU6000::hardware_init(Sample_rate sample_rate)
     hal.scheduler->delay(1);
 
     uint8_t default_filter;
+    uint8_t rate_hz;
 
     // sample rate and filtering
     // to minimise the effects of aliasing we choose a filter
@@ -572,24 +794,34 @@ bool AP_InertialSensor_MPU6000::hardware_init(Sample_rate sample_rate)
         // more important than update rate. Tests on an aerobatic plane
         // show that 10Hz is fine, and makes it very noise resistant
         default_filter = BITS_DLPF_CFG_10HZ;
-        _sample_shift = 2;
+        rate_hz = 50;
         break;
     case RATE_100HZ:
         default_filter = BITS_DLPF_CFG_20HZ;
-        _sample_shift = 1;
+        rate_hz = 100;
         break;
     case RATE_200HZ:
     default:
         default_filter = BITS_DLPF_CFG_20HZ;
-        _sample_shift = 0;
+        rate_hz = 200;
         break;
     }
 
     _set_filter_register(_mpu6000_filter, default_filter);
 
+#if MPU6000_FIFO_MODE
+    // sample at MPU6000_FIFO_RATE_HZ. The gyro output rate is 1kHz
+    // with the DLPF enabled
+    register_write(MPUREG_SMPLRT_DIV, (1000 / MPU6000_FIFO_RATE_HZ) - 1);
+    _sample_period_us = 1000000UL / MPU6000_FIFO_RATE_HZ;
+    _sample_divider = MPU6000_FIFO_RATE_HZ / rate_hz;
+#else
     // set sample rate to 200Hz, and use _sample_divider to give
     // the requested rate to the application
     register_write(MPUREG_SMPLRT_DIV, MPUREG_SMPLRT_200HZ);
+    _sample_period_us = 5000;
+    _sample_divider = 200 / rate_hz;
+#endif
     hal.scheduler->delay(1);
 
     register_write(MPUREG_GYRO_CONFIG, BITS_GYRO_FS_2000DPS);  // Gyro scale 2000º/s
@@ -619,6 +851,14 @@ bool AP_InertialSensor_MPU6000::hardware_init(Sample_rate sample_rate)
     register_write(MPUREG_INT_PIN_CFG, BIT_INT_RD_CLEAR | BIT_LATCH_INT_EN);
     hal.scheduler->delay(1);
 
+#if MPU6000_FIFO_MODE
+    // queue accel, temperature and gyro. The FIFO keeps register
+    // order, so each sample has the layout of a direct read
+    register_write(MPUREG_FIFO_EN, BIT_FIFO_EN_ACCEL | BIT_FIFO_EN_TEMP |
+                   BIT_FIFO_EN_XG | BIT_FIFO_EN_YG | BIT_FIFO_EN_ZG);
+    _fifo_restart();
+#endif
+
     _spi_sem->give();
 
     return true;
@@ -642,7 +882,7 @@ float AP_InertialSensor_MPU6000::get_gyro_drift_rate(void)
 uint16_t AP_InertialSensor_MPU6000::num_samples_available()
 {
     _poll_data(0);
-    return _count >> _sample_shift;
+    return _count / _sample_divider;
 }
 
 
@@ -666,8 +906,7 @@ void AP_InertialSensor_MPU6000::_dump_registers(void)
 // get_delta_time returns the time period in seconds overwhich the sensor data was collected
 float AP_InertialSensor_MPU6000::get_delta_time() 
 {
-    // the sensor runs at 200Hz
-    return 0.005 * _num_samples;
+    return _sample_period_us * 1.0e-6f * _num_samples;
 }
 
 // Update gyro offsets with new values.  Offsets provided in as scaled deg/sec values
@@ -779,6 +1018,12 @@ void AP_InertialSensor_MPU6000::dmp_register_write(uint8_t bank, uint8_t address
 // this should be called after hardware_init if you wish to enable the dmp
 void AP_InertialSensor_MPU6000::dmp_init()
 {
+#if MPU6000_FIFO_MODE
+    // the raw sample stream owns the FIFO
+    hal.console->println_P(PSTR("MPU6000: DMP not available in FIFO mode"));
+    return;
+#endif
+
     uint8_t regs[4];    // for writing to dmp
 
     // ensure we only initialise once
@@ -870,20 +1115,44 @@ void AP_InertialSensor_MPU6000::FIFO_reset()
     register_write(MPUREG_USER_CTRL, temp);
 }
 
-// FIFO_getPacket - read an attitude packet from FIFO buffer
-// TO-DO: interpret results instead of just dumping into a buffer
+// FIFO_getPacket - read the attitude packets waiting in the FIFO
+// buffer and keep the newest, with one SPI transaction for the count
+// and one for the packets. Called from the timer process with the
+// semaphore taken
 void AP_InertialSensor_MPU6000::FIFO_getPacket()
 {
-    uint8_t i;
     int16_t q_data[4];
-    uint8_t addr = MPUREG_FIFO_R_W | 0x80;      // Set most significant bit to indicate a read
-    uint8_t received_packet[DMP_FIFO_BUFFER_SIZE];    // FIFO packet buffer
-    _spi->cs_assert();
-    _spi->transfer(addr);                                 // send address we want to read from
-    for(i = 0; i < _fifoCountL; i++) {
-        received_packet[i] = _spi->transfer(0);          // request value
+    uint8_t addr = MPUREG_FIFO_COUNTH | 0x80;
+    uint8_t count[2];
+    const AP_HAL::SPISegment count_segs[2] = {
+        { &addr, NULL, 1 },
+        { NULL, count, sizeof(count) }
+    };
+    _spi->transfer_segments(count_segs, 2, NULL, NULL);
+    _fifoCountH = count[0];
+    _fifoCountL = count[1];
+
+    uint16_t bytes = ((uint16_t)count[0] << 8) | count[1];
+    if (bytes == 0) {
+        return;
     }
-    _spi->cs_release();
+    if (bytes % FIFO_PACKET_SIZE != 0 || bytes > DMP_FIFO_BUFFER_SIZE) {
+        // we can no longer tell where packets start, or have fallen
+        // so far behind that the FIFO may have overflowed
+        FIFO_reset();
+        return;
+    }
+
+    uint8_t packets[DMP_FIFO_BUFFER_SIZE];
+    addr = MPUREG_FIFO_R_W | 0x80;
+    const AP_HAL::SPISegment segs[2] = {
+        { &addr, NULL, 1 },
+        { NULL, packets, bytes }
+    };
+    _spi->transfer_segments(segs, 2, NULL, NULL);
+
+    // each packet is a whole attitude, so the older ones add nothing
+    const uint8_t *received_packet = &packets[bytes - FIFO_PACKET_SIZE];
 
     // we are using 16 bits resolution
     q_data[0] = (int16_t) ((((uint16_t) received_packet[0]) << 8) + ((uint16_t) received_packet[1]));
@@ -891,10 +1160,11 @@ void AP_InertialSensor_MPU6000::FIFO_getPacket()
     q_data[2] = (int16_t) ((((uint16_t) received_packet[8]) << 8) + ((uint16_t) received_packet[9]));
     q_data[3] = (int16_t) ((((uint16_t) received_packet[12]) << 8) + ((uint16_t) received_packet[13]));
 
-    quaternion.q1 = ((float)q_data[0]) / 16384.0f;       // convert from fixed point to float
-    quaternion.q2 = ((float)q_data[2]) / 16384.0f;       // convert from fixed point to float
-    quaternion.q3 = ((float)q_data[1]) / 16384.0f;       // convert from fixed point to float
-    quaternion.q4 = ((float)-q_data[3]) / 16384.0f;       // convert from fixed point to float
+    _dmp_quaternion.q1 = ((float)q_data[0]) / 16384.0f;       // convert from fixed point to float
+    _dmp_quaternion.q2 = ((float)q_data[2]) / 16384.0f;       // convert from fixed point to float
+    _dmp_quaternion.q3 = ((float)q_data[1]) / 16384.0f;       // convert from fixed point to float
+    _dmp_quaternion.q4 = ((float)-q_data[3]) / 16384.0f;       // convert from fixed point to float
+    _dmp_packets++;
 }
 
 // dmp_set_gyro_calibration - apply default gyro calibration FS=2000dps and default orientation
@@ -15,6 +15,18 @@
 // enable debug to see a register dump on startup
 #define MPU6000_DEBUG 0
 
+// read raw samples through the hardware FIFO in bursts, rather than
+// with one SPI transaction per data ready interrupt. This lets the
+// sensor sample at MPU6000_FIFO_RATE_HZ for less SPI load than the
+// 200Hz direct read. The DMP needs the FIFO, so it is unavailable in
+// this mode
+#ifndef MPU6000_FIFO_MODE
+#define MPU6000_FIFO_MODE 0
+#endif
+#define MPU6000_FIFO_RATE_HZ 1000       // sensor sample rate in FIFO mode
+#define MPU6000_FIFO_POLL_US 5000       // how often the timer drains the FIFO
+#define MPU6000_FIFO_BURST   8          // samples read per SPI transaction
+
 // DMP memory
 extern const uint8_t        dmpMem[8][16][16] PROGMEM;
 
@@ -45,6 +57,10 @@ public:
     // get_delta_time returns the time period in seconds overwhich the sensor data was collected
     float            	get_delta_time();
 
+    // dmp_packets - the DMP attitude packets read from the FIFO in the
+    // time update() covered. quaternion is the newest of them
+    uint8_t             dmp_packets() const { return _dmp_count; }
+
 protected:
     uint16_t                    _init_sensor( Sample_rate sample_rate );
 
@@ -52,8 +68,13 @@ private:
 
     static void                 _read_data_from_timerprocess();
     static void                 _read_data_transaction();
+    static void                 _accumulate_sample(const uint8_t *data) HOT_FUNC;
     static bool                 _data_ready();
     static void                 _poll_data(uint32_t now);
+#if MPU6000_FIFO_MODE
+    static void                 _fifo_restart();
+    static void                 _read_fifo(uint32_t now);
+#endif
     static AP_HAL::DigitalSource *_drdy_pin;
     static uint8_t              _register_read( uint8_t reg );
     static bool _register_read_from_timerprocess( uint8_t reg, uint8_t *val );
@@ -65,6 +86,7 @@ private:
     static AP_HAL::Semaphore *_spi_sem;
 
     uint16_t					_num_samples;
+    uint8_t                     _dmp_count;
 
     float                       _temp;
 
@@ -89,7 +111,7 @@ private:
     static void                 dmp_set_rate(uint8_t rate); // set DMP output rate (see constants)
 
     // how many hardware samples before we report a sample to the caller
-    uint8_t _sample_shift;
+    uint8_t _sample_divider;
 
     // support for updating filter at runtime
     uint8_t _last_filter_hz;
@@ -97,11 +119,11 @@ private:
     void _set_filter_register(uint8_t filter_hz, uint8_t default_filter);
 
 public:
-    static Quaternion           quaternion;             // holds the 4 quaternions representing attitude taken directly from the DMP
+    static Quaternion           quaternion;             // attitude from the DMP as of the last update()
 
     static bool                 FIFO_ready();                   // returns true if new attitude data is available in FIFO buffer
     static void                 FIFO_reset();                   // clear attitude data from FIFO buffer
-    static void                 FIFO_getPacket();       // get latest attitude data from FIFO buffer
+    static void                 FIFO_getPacket();       // read the attitude packets waiting in the FIFO buffer, from the timer process
     static void                 dmp_set_gyro_calibration();
     static void                 dmp_set_accel_calibration();
     static void                 dmp_apply_endian_accel();
@@ -116,7 +138,6 @@ public:
     static void                 dmp_set_sensor_fusion_accel_gain(uint8_t gain); // This function defines the weight of the accel on the sensor fusion. Default value is 0x80. The official invensense name is inv_key_0_96 (?)
     static void                 dmp_load_mem();                 // Load initial memory values into DMP memory banks
 
-    static uint8_t              _received_packet[DMP_FIFO_BUFFER_SIZE]; // FIFO packet buffer
     static uint8_t              _fifoCountH;                    // high byte of number of elements in fifo buffer
     static uint8_t              _fifoCountL;                    // low byte of number of elements in fifo buffer
 
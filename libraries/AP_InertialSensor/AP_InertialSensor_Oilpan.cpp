@@ -4,6 +4,8 @@
 #if CONFIG_HAL_BOARD == HAL_BOARD_APM1
 #include "AP_InertialSensor_Oilpan.h"
 
+extern const AP_HAL::HAL& hal;
+
 // ADC channel mappings on for the APM Oilpan
 // Sensors: GYROX, GYROY, GYROZ, ACCELX, ACCELY, ACCELZ
 const uint8_t AP_InertialSensor_Oilpan::_sensors[6] = { 1, 2, 0, 4, 5, 6 };
@@ -78,6 +80,8 @@ bool AP_InertialSensor_Oilpan::update()
 
 
     _delta_time_micros = _adc->Ch6(_sensors, adc_values);
+    // the ADC averages up to now, so its samples are as new as this
+    _last_sample_us = hal.scheduler->micros();
     _temp = _adc->Ch(_gyro_temp_ch);
 
     _gyro   = Vector3f(_sensor_signs[0] * ( adc_values[0] - OILPAN_RAW_GYRO_OFFSET ),
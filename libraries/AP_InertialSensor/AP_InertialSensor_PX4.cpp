@@ -10,62 +10,108 @@ const extern AP_HAL::HAL& hal;
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
 
 #include <drivers/drv_accel.h>
 #include <drivers/drv_gyro.h>
-
-Vector3f AP_InertialSensor_PX4::_accel_sum;
-uint32_t AP_InertialSensor_PX4::_accel_sum_count;
-Vector3f AP_InertialSensor_PX4::_gyro_sum;
-uint32_t AP_InertialSensor_PX4::_gyro_sum_count;
+#include <drivers/drv_hrt.h>
+
+uint8_t AP_InertialSensor_PX4::_num_accel;
+uint8_t AP_InertialSensor_PX4::_num_gyro;
+Vector3f AP_InertialSensor_PX4::_accel_sum[INS_PX4_MAX_INSTANCES];
+uint32_t AP_InertialSensor_PX4::_accel_sum_count[INS_PX4_MAX_INSTANCES];
+Vector3f AP_InertialSensor_PX4::_gyro_sum[INS_PX4_MAX_INSTANCES];
+uint32_t AP_InertialSensor_PX4::_gyro_sum_count[INS_PX4_MAX_INSTANCES];
 volatile bool AP_InertialSensor_PX4::_in_accumulate;
-uint64_t AP_InertialSensor_PX4::_last_accel_timestamp;
-uint64_t AP_InertialSensor_PX4::_last_gyro_timestamp;
-int AP_InertialSensor_PX4::_accel_fd;
-int AP_InertialSensor_PX4::_gyro_fd;
+uint64_t AP_InertialSensor_PX4::_last_accel_timestamp[INS_PX4_MAX_INSTANCES];
+uint64_t AP_InertialSensor_PX4::_last_gyro_timestamp[INS_PX4_MAX_INSTANCES];
+int AP_InertialSensor_PX4::_accel_fd[INS_PX4_MAX_INSTANCES];
+int AP_InertialSensor_PX4::_gyro_fd[INS_PX4_MAX_INSTANCES];
+Vector3f AP_InertialSensor_PX4::_last_accel[INS_PX4_MAX_INSTANCES];
+AP_InertialSensor_Delta AP_InertialSensor_PX4::_delta[INS_PX4_MAX_INSTANCES];
+AP_InertialSensor_Filters AP_InertialSensor_PX4::_filters[INS_PX4_MAX_INSTANCES];
+Vector3f AP_InertialSensor_PX4::_batch_accel;
+SensorVote AP_InertialSensor_PX4::_accel_vote(INS_PX4_ACCEL_ERROR_MAX, INS_PX4_TIMEOUT_US);
+SensorVote AP_InertialSensor_PX4::_gyro_vote(INS_PX4_GYRO_ERROR_MAX, INS_PX4_TIMEOUT_US);
+
+// a whole queue of reports from one device, for a single read(). The
+// primary accel's are kept, with their filtered values, until the gyros
+// have been paired with them
+static struct accel_report accel_reports[INS_PX4_QUEUE_DEPTH];
+static struct accel_report spare_accel_reports[INS_PX4_QUEUE_DEPTH];
+static struct gyro_report gyro_reports[INS_PX4_QUEUE_DEPTH];
+static Vector3f filtered_accel[INS_PX4_QUEUE_DEPTH];
+
+// the first instance is required, the others are used if present
+static const char *accel_device_path[INS_PX4_MAX_INSTANCES] = {
+    ACCEL_DEVICE_PATH, ACCEL_DEVICE_PATH "1", ACCEL_DEVICE_PATH "2"
+};
+static const char *gyro_device_path[INS_PX4_MAX_INSTANCES] = {
+    GYRO_DEVICE_PATH, GYRO_DEVICE_PATH "1", GYRO_DEVICE_PATH "2"
+};
 
 uint16_t AP_InertialSensor_PX4::_init_sensor( Sample_rate sample_rate ) 
 {
     switch (sample_rate) {
     case RATE_50HZ:
-        _sample_divider = 4;
+        _sample_divider = INS_PX4_SAMPLE_RATE_HZ / 50;
         _default_filter_hz = 10;
         break;
     case RATE_100HZ:
-        _sample_divider = 2;
+        _sample_divider = INS_PX4_SAMPLE_RATE_HZ / 100;
         _default_filter_hz = 20;
         break;
     case RATE_200HZ:
     default:
-        _sample_divider = 1;
+        _sample_divider = INS_PX4_SAMPLE_RATE_HZ / 200;
         _default_filter_hz = 20;
         break;
     }
 
 	// init accelerometers
-	_accel_fd = open(ACCEL_DEVICE_PATH, O_RDONLY);
-	if (_accel_fd < 0) {
+	_accel_fd[0] = open(ACCEL_DEVICE_PATH, O_RDONLY);
+	if (_accel_fd[0] < 0) {
         hal.scheduler->panic("Unable to open accel device " ACCEL_DEVICE_PATH);
     }
 
-	_gyro_fd = open(GYRO_DEVICE_PATH, O_RDONLY);
-	if (_gyro_fd < 0) {
+	_gyro_fd[0] = open(GYRO_DEVICE_PATH, O_RDONLY);
+	if (_gyro_fd[0] < 0) {
         hal.scheduler->panic("Unable to open gyro device " GYRO_DEVICE_PATH);
     }
 
+    // any spares
+    for (_num_accel=1; _num_accel<INS_PX4_MAX_INSTANCES; _num_accel++) {
+        _accel_fd[_num_accel] = open(accel_device_path[_num_accel], O_RDONLY);
+        if (_accel_fd[_num_accel] < 0) {
+            break;
+        }
+    }
+    for (_num_gyro=1; _num_gyro<INS_PX4_MAX_INSTANCES; _num_gyro++) {
+        _gyro_fd[_num_gyro] = open(gyro_device_path[_num_gyro], O_RDONLY);
+        if (_gyro_fd[_num_gyro] < 0) {
+            break;
+        }
+    }
+
     /* 
-     * set the accel and gyro sampling rate. We always set these to
-     * 200 then average in this driver
+     * set the accel and gyro sampling rate. We always sample at the
+     * full rate, integrate every sample and average down to the
+     * loop rate in this driver
      */
-    ioctl(_accel_fd, ACCELIOCSSAMPLERATE, 200);
-    ioctl(_accel_fd, SENSORIOCSPOLLRATE,  200);
-    ioctl(_gyro_fd,  GYROIOCSSAMPLERATE,  200);
-    ioctl(_gyro_fd,  SENSORIOCSPOLLRATE,  200);
+    for (uint8_t i=0; i<_num_accel; i++) {
+        ioctl(_accel_fd[i], ACCELIOCSSAMPLERATE, INS_PX4_SAMPLE_RATE_HZ);
+        ioctl(_accel_fd[i], SENSORIOCSPOLLRATE,  INS_PX4_SAMPLE_RATE_HZ);
+        ioctl(_accel_fd[i], SENSORIOCSQUEUEDEPTH, INS_PX4_QUEUE_DEPTH);
+    }
+    for (uint8_t i=0; i<_num_gyro; i++) {
+        ioctl(_gyro_fd[i],  GYROIOCSSAMPLERATE,  INS_PX4_SAMPLE_RATE_HZ);
+        ioctl(_gyro_fd[i],  SENSORIOCSPOLLRATE,  INS_PX4_SAMPLE_RATE_HZ);
+        ioctl(_gyro_fd[i],  SENSORIOCSQUEUEDEPTH, INS_PX4_QUEUE_DEPTH);
+    }
 
-    // ask for a 10 sample buffer. The mpu6000 PX4 driver doesn't
-    // support this yet, but when it does we want to use it
-    ioctl(_accel_fd, SENSORIOCSQUEUEDEPTH, 10);
-    ioctl(_gyro_fd,  SENSORIOCSQUEUEDEPTH, 10);
+    uint32_t now = hal.scheduler->micros();
+    _accel_vote.set_count(_num_accel, now);
+    _gyro_vote.set_count(_num_gyro, now);
 
     // register a 1kHz timer to read from PX4 sensor drivers
     hal.scheduler->register_timer_process(_ins_timer);
@@ -83,8 +129,12 @@ void AP_InertialSensor_PX4::_set_filter_frequency(uint8_t filter_hz)
     if (filter_hz == 0) {
         filter_hz = _default_filter_hz;
     }
-    ioctl(_gyro_fd,  GYROIOCSLOWPASS,  filter_hz);
-    ioctl(_accel_fd, ACCELIOCSLOWPASS, filter_hz);
+    for (uint8_t i=0; i<_num_gyro; i++) {
+        ioctl(_gyro_fd[i],  GYROIOCSLOWPASS,  filter_hz);
+    }
+    for (uint8_t i=0; i<_num_accel; i++) {
+        ioctl(_accel_fd[i], ACCELIOCSLOWPASS, filter_hz);
+    }
 }
 
 /*================ AP_INERTIALSENSOR PUBLIC INTERFACE ==================== */
@@ -92,27 +142,49 @@ void AP_InertialSensor_PX4::_set_filter_frequency(uint8_t filter_hz)
 bool AP_InertialSensor_PX4::update(void) 
 {
     while (num_samples_available() == 0) {
-        hal.scheduler->delay(1);
+        // sleep until the timer process has read a sample
+        hal.scheduler->wait_for_signal(2000);
     }
     Vector3f accel_scale = _accel_scale.get();
 
     hal.scheduler->suspend_timer_procs();
 
+    // take the samples of the primaries, and throw away the others',
+    // which have only been kept for their health
+    uint8_t accel = _accel_vote.primary();
+    uint8_t gyro = _gyro_vote.primary();
+
     // base the time on the gyro timestamp, as that is what is
     // multiplied by time to integrate in DCM
-    _delta_time = (_last_gyro_timestamp - _last_update_usec) * 1.0e-6f;
-    _last_update_usec = _last_gyro_timestamp;
+    _delta_time = (_last_gyro_timestamp[gyro] - _last_update_usec) * 1.0e-6f;
+    _last_update_usec = _last_gyro_timestamp[gyro];
+    // micros() counts from the sketch start, so go by the age of the sample
+    _last_sample_us = hal.scheduler->micros() - (uint32_t)(hrt_absolute_time() - _last_update_usec);
+
+    _accel = _accel_sum[accel] / _accel_sum_count[accel];
+    _gyro = _gyro_sum[gyro] / _gyro_sum_count[gyro];
 
-    _accel = _accel_sum / _accel_sum_count;
-    _accel_sum.zero();
-    _accel_sum_count = 0;
+    AP_InertialSensor_Delta delta = _delta[gyro];
 
-    _gyro = _gyro_sum / _gyro_sum_count;
-    _gyro_sum.zero();
-    _gyro_sum_count = 0;
+    for (uint8_t i=0; i<_num_accel; i++) {
+        _accel_sum[i].zero();
+        _accel_sum_count[i] = 0;
+    }
+    for (uint8_t i=0; i<_num_gyro; i++) {
+        _gyro_sum[i].zero();
+        _gyro_sum_count[i] = 0;
+        _delta[i].reset();
+    }
+
+    // pick up any parameter change for the next lot of samples
+    for (uint8_t i=0; i<INS_PX4_MAX_INSTANCES; i++) {
+        _configure_filters(_filters[i], INS_PX4_SAMPLE_RATE_HZ);
+    }
 
     hal.scheduler->resume_timer_procs();
 
+    _set_deltas(delta);
+
     // add offsets and rotation
     _accel.rotate(_board_orientation);
     _accel.x *= accel_scale.x;
@@ -136,11 +208,6 @@ float AP_InertialSensor_PX4::get_delta_time(void)
     return _delta_time;
 }
 
-uint32_t AP_InertialSensor_PX4::get_last_sample_time_micros(void) 
-{
-    return _last_update_usec;
-}
-
 float AP_InertialSensor_PX4::get_gyro_drift_rate(void) 
 {
     // 0.5 degrees/second/minute
@@ -149,27 +216,143 @@ float AP_InertialSensor_PX4::get_gyro_drift_rate(void)
 
 void AP_InertialSensor_PX4::_accumulate(void)
 {
-    struct accel_report	accel_report;
-    struct gyro_report	gyro_report;
-
     if (_in_accumulate) {
         return;
     }
     _in_accumulate = true;
 
-    if (::read(_accel_fd, &accel_report, sizeof(accel_report)) == sizeof(accel_report) &&
-        accel_report.timestamp != _last_accel_timestamp) {        
-        _accel_sum += Vector3f(accel_report.x, accel_report.y, accel_report.z);
-        _accel_sum_count++;
-        _last_accel_timestamp = accel_report.timestamp;
-	}
+    uint32_t now = hal.scheduler->micros();
+    uint64_t hrt_now = hrt_absolute_time();
+    bool new_sample = false;
+
+    // one syscall finds which instances have a report, so the
+    // calls from the main thread while it waits for a sample, and the
+    // timer ticks between reports, don't read every device
+    struct pollfd fds[2*INS_PX4_MAX_INSTANCES];
+    for (uint8_t i=0; i<_num_accel; i++) {
+        fds[i].fd = _accel_fd[i];
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+    for (uint8_t i=0; i<_num_gyro; i++) {
+        fds[_num_accel+i].fd = _gyro_fd[i];
+        fds[_num_accel+i].events = POLLIN;
+        fds[_num_accel+i].revents = 0;
+    }
+    if (::poll(fds, _num_accel+_num_gyro, 0) <= 0) {
+        // nothing new, but still time out a silent instance
+        _accel_vote.update(now);
+        _gyro_vote.update(now);
+        _in_accumulate = false;
+        return;
+    }
+
+    // the primary accel as it was before these reports, for the gyro
+    // samples that came before its first
+    uint8_t primary_accel = _accel_vote.primary();
+    const Vector3f accel_before = _last_accel[primary_accel];
+    const Vector3f raw_accel_before = _batch_accel;
+    uint8_t num_primary_reports = 0;
+
+    // each read() takes the whole queue of a device
+    for (uint8_t i=0; i<_num_accel; i++) {
+        if (!(fds[i].revents & POLLIN)) {
+            continue;
+        }
+        struct accel_report *reports = (i == primary_accel) ? accel_reports : spare_accel_reports;
+        ssize_t ret = ::read(_accel_fd[i], reports, sizeof(accel_reports));
+        uint8_t n = ret > 0 ? ret / sizeof(struct accel_report) : 0;
+        bool got_sample = false;
+        for (uint8_t r=0; r<n; r++) {
+            if (reports[r].timestamp > _last_accel_timestamp[i]) {
+                _last_accel[i] = Vector3f(reports[r].x, reports[r].y, reports[r].z);
+                if (i == primary_accel) {
+                    _batch_accel = _last_accel[i];
+                }
+                _filters[i].apply_accel(_last_accel[i]);
+                _accel_sum[i] += _last_accel[i];
+                _accel_sum_count[i]++;
+                _last_accel_timestamp[i] = reports[r].timestamp;
+                got_sample = true;
+            }
+            if (i == primary_accel) {
+                // a stale report keeps the value from before it
+                filtered_accel[r] = _last_accel[i];
+            }
+        }
+        if (got_sample) {
+            _accel_vote.sample(i, _last_accel[i], now);
+        }
+        if (i == primary_accel) {
+            num_primary_reports = n;
+        }
+    }
 
-    if (::read(_gyro_fd, &gyro_report, sizeof(gyro_report)) == sizeof(gyro_report) &&
-        gyro_report.timestamp != _last_gyro_timestamp) {        
-        _gyro_sum += Vector3f(gyro_report.x, gyro_report.y, gyro_report.z);
-        _gyro_sum_count++;
-        _last_gyro_timestamp = gyro_report.timestamp;
-	}
+    for (uint8_t i=0; i<_num_gyro; i++) {
+        if (!(fds[_num_accel+i].revents & POLLIN)) {
+            continue;
+        }
+        ssize_t ret = ::read(_gyro_fd[i], gyro_reports, sizeof(gyro_reports));
+        uint8_t n = ret > 0 ? ret / sizeof(struct gyro_report) : 0;
+        bool got_sample = false;
+        Vector3f gyro;
+
+        // integrate each gyro sample with the primary accel sample
+        // that was current at its timestamp
+        Vector3f accel = accel_before;
+        Vector3f raw_accel = raw_accel_before;
+        uint8_t a = 0;
+
+        for (uint8_t r=0; r<n; r++) {
+            const struct gyro_report &report = gyro_reports[r];
+            if (report.timestamp <= _last_gyro_timestamp[i]) {
+                continue;
+            }
+            while (a < num_primary_reports && accel_reports[a].timestamp <= report.timestamp) {
+                raw_accel = Vector3f(accel_reports[a].x, accel_reports[a].y, accel_reports[a].z);
+                accel = filtered_accel[a];
+                a++;
+            }
+            gyro = Vector3f(report.x, report.y, report.z);
+            if (i == _gyro_vote.primary()) {
+                // the batch is paced by the primary gyro, with the
+                // unfiltered accel sample of the time
+                _batch.sample(gyro, raw_accel);
+#if AP_INERTIAL_SENSOR_RAW_LOG
+                // as is the raw log, timed from the report
+                _raw_log.sample(gyro, raw_accel, now - (uint32_t)(hrt_now - report.timestamp));
+#endif
+            }
+            _filters[i].apply_gyro(gyro);
+            _gyro_sum[i] += gyro;
+            _gyro_sum_count[i]++;
+            // over the time since the last gyro sample
+            if (_last_gyro_timestamp[i] != 0) {
+                float dt = (report.timestamp - _last_gyro_timestamp[i]) * 1.0e-6f;
+                if (dt < 0.1f) {
+                    _delta[i].accumulate(gyro, accel, dt);
+                }
+            }
+            _last_gyro_timestamp[i] = report.timestamp;
+            got_sample = true;
+        }
+        if (got_sample) {
+            _gyro_vote.sample(i, gyro, now);
+            if (i == _gyro_vote.primary()) {
+                new_sample = true;
+            }
+        }
+    }
+
+    // score the new samples, and fail over before the next update()
+    // if a primary has gone bad
+    _accel_vote.update(now);
+    _gyro_vote.update(now);
+
+    // wake the main loop if it is waiting for the sample
+    if (new_sample && hal.scheduler->in_timerprocess()) {
+        hal.scheduler->signal_main();
+    }
 
     _in_accumulate = false;
 }
@@ -182,7 +365,7 @@ void AP_InertialSensor_PX4::_ins_timer(uint32_t now)
 uint16_t AP_InertialSensor_PX4::num_samples_available(void)
 {
     _accumulate();
-    return min(_accel_sum_count, _gyro_sum_count) / _sample_divider;
+    return min(_accel_sum_count[_accel_vote.primary()], _gyro_sum_count[_gyro_vote.primary()]) / _sample_divider;
 }
 
 #endif // CONFIG_HAL_BOARD
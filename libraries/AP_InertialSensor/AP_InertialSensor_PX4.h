@@ -13,6 +13,20 @@
 #include <uORB/uORB.h>
 #include <uORB/topics/sensor_combined.h>
 
+// the most accelerometers and gyros used, and the differences between
+// them which are still agreement
+#define INS_PX4_MAX_INSTANCES       3
+#define INS_PX4_ACCEL_ERROR_MAX     3.0f    // m/s/s
+#define INS_PX4_GYRO_ERROR_MAX      0.5f    // rad/s
+#define INS_PX4_TIMEOUT_US          10000   // ten missed samples at 1kHz
+
+// the rate the sensor drivers sample at, and the reports they queue
+// for us, enough for the timer to run 20ms late without losing any
+#ifndef INS_PX4_SAMPLE_RATE_HZ
+# define INS_PX4_SAMPLE_RATE_HZ     1000
+#endif
+#define INS_PX4_QUEUE_DEPTH         20
+
 class AP_InertialSensor_PX4 : public AP_InertialSensor
 {
 public:
@@ -22,23 +36,38 @@ public:
     /* Concrete implementation of AP_InertialSensor functions: */
     bool            update();
     float        	get_delta_time();
-    uint32_t        get_last_sample_time_micros();
     float           get_gyro_drift_rate();
     uint16_t        num_samples_available();
 
+    // the instances in use, for logging. The accel and gyro may not be
+    // on the same chip
+    uint8_t         get_primary_accel() const { return _accel_vote.primary(); }
+    uint8_t         get_primary_gyro() const { return _gyro_vote.primary(); }
+
 private:
     uint16_t        _init_sensor( Sample_rate sample_rate );
     static		    void _ins_timer(uint32_t now);
-    static          void _accumulate(void);
+    static          void _accumulate(void) HOT_FUNC;
     uint64_t        _last_update_usec;
     float           _delta_time;
-    static Vector3f	_accel_sum;
-    static uint32_t _accel_sum_count;
-    static Vector3f	_gyro_sum;
-    static uint32_t _gyro_sum_count;
+
+    // the state of each instance. The timer accumulates all of them,
+    // so a backup is up to date the moment it becomes the primary
+    static uint8_t  _num_accel;
+    static uint8_t  _num_gyro;
+    static Vector3f	_accel_sum[INS_PX4_MAX_INSTANCES];
+    static uint32_t _accel_sum_count[INS_PX4_MAX_INSTANCES];
+    static Vector3f	_gyro_sum[INS_PX4_MAX_INSTANCES];
+    static uint32_t _gyro_sum_count[INS_PX4_MAX_INSTANCES];
     static volatile bool _in_accumulate;
-    static uint64_t _last_accel_timestamp;
-    static uint64_t _last_gyro_timestamp;
+    static uint64_t _last_accel_timestamp[INS_PX4_MAX_INSTANCES];
+    static uint64_t _last_gyro_timestamp[INS_PX4_MAX_INSTANCES];
+    static Vector3f _last_accel[INS_PX4_MAX_INSTANCES];
+    static AP_InertialSensor_Delta _delta[INS_PX4_MAX_INSTANCES];
+    static AP_InertialSensor_Filters _filters[INS_PX4_MAX_INSTANCES];
+    static Vector3f _batch_accel;
+    static SensorVote _accel_vote;
+    static SensorVote _gyro_vote;
     uint8_t  _sample_divider;
 
     // support for updating filter at runtime
@@ -48,8 +77,8 @@ private:
     void _set_filter_frequency(uint8_t filter_hz);
 
     // accelerometer and gyro driver handles
-    static int _accel_fd;
-    static int _gyro_fd;
+    static int _accel_fd[INS_PX4_MAX_INSTANCES];
+    static int _gyro_fd[INS_PX4_MAX_INSTANCES];
 };
 #endif
 #endif // __AP_INERTIAL_SENSOR_PX4_H__
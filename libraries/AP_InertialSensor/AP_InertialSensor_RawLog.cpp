@@ -0,0 +1,90 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include "AP_InertialSensor.h"
+
+#if AP_INERTIAL_SENSOR_RAW_LOG
+
+// the default scale is the resolution of the common 2000 degrees/sec
+// and 16g ranges
+AP_InertialSensor_RawLog::AP_InertialSensor_RawLog() :
+    _enabled(false),
+    _head(0),
+    _tail(0),
+    _count(0),
+    _dropped(0)
+{
+    set_scale(ToRad(2000.0f) / 32768, 16 * GRAVITY_MSS / 32768);
+}
+
+void AP_InertialSensor_RawLog::set_scale(float gyro_scale, float accel_scale)
+{
+    _gyro_scale = gyro_scale;
+    _accel_scale = accel_scale;
+    _gyro_inv_scale = 1.0f / gyro_scale;
+    _accel_inv_scale = 1.0f / accel_scale;
+}
+
+void AP_InertialSensor_RawLog::enable(bool on)
+{
+    if (on && !_enabled) {
+        _tail = _head;
+    }
+    _enabled = on;
+}
+
+const struct AP_InertialSensor_RawLog::block *AP_InertialSensor_RawLog::peek(void) const
+{
+    if (_tail == _head) {
+        return NULL;
+    }
+    return &_blocks[_tail % INS_RAW_LOG_BLOCKS];
+}
+
+void AP_InertialSensor_RawLog::pop(void)
+{
+    if (_tail != _head) {
+        // done with the block before it is handed back
+        __asm__ __volatile__("" ::: "memory");
+        _tail++;
+    }
+}
+
+int16_t AP_InertialSensor_RawLog::_quantise(float v, float inv_scale)
+{
+    return constrain_float(v * inv_scale + (v < 0 ? -0.5f : 0.5f), -32767, 32767);
+}
+
+void AP_InertialSensor_RawLog::sample(const Vector3f &gyro, const Vector3f &accel, uint32_t time_us)
+{
+    if (!_enabled) {
+        _count = 0;
+        return;
+    }
+    if ((uint8_t)(_head - _tail) >= INS_RAW_LOG_BLOCKS) {
+        // the main thread is behind
+        _count = 0;
+        _dropped++;
+        return;
+    }
+
+    struct block &b = _blocks[_head % INS_RAW_LOG_BLOCKS];
+    if (_count == 0) {
+        b.start_us = time_us;
+    }
+    b.gyro[0][_count]  = _quantise(gyro.x,  _gyro_inv_scale);
+    b.gyro[1][_count]  = _quantise(gyro.y,  _gyro_inv_scale);
+    b.gyro[2][_count]  = _quantise(gyro.z,  _gyro_inv_scale);
+    b.accel[0][_count] = _quantise(accel.x, _accel_inv_scale);
+    b.accel[1][_count] = _quantise(accel.y, _accel_inv_scale);
+    b.accel[2][_count] = _quantise(accel.z, _accel_inv_scale);
+    _count++;
+    if (_count == INS_RAW_LOG_SAMPLES) {
+        b.end_us = time_us;
+        _count = 0;
+        // the block is complete before the main thread can see it
+        __asm__ __volatile__("" ::: "memory");
+        _head++;
+    }
+}
+
+#endif // AP_INERTIAL_SENSOR_RAW_LOG
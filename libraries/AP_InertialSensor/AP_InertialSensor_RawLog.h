@@ -0,0 +1,70 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#ifndef __AP_INERTIAL_SENSOR_RAWLOG_H__
+#define __AP_INERTIAL_SENSOR_RAWLOG_H__
+
+#include <AP_Math.h>
+
+#define INS_RAW_LOG_SAMPLES     32      // samples of each axis in a block, as many as a log record holds
+#define INS_RAW_LOG_BLOCKS      4
+
+/*
+  raw gyro and accel samples at the full sensor rate, for logging,
+  quantised to 16 bit counts of a fixed scale.
+
+  The timer process fills blocks of consecutive samples, and the main
+  thread takes the full ones to log, each with the times of its first
+  and last sample so the interval between samples is known without a
+  time for each. When there is no free block the one being filled is
+  started again, so a block never has a gap in it. The timer process
+  only advances _head and the main thread only _tail, so there are no
+  locks
+ */
+class AP_InertialSensor_RawLog
+{
+public:
+    struct block {
+        uint32_t start_us;          // time of the first sample
+        uint32_t end_us;            // and of the last
+        int16_t gyro[3][INS_RAW_LOG_SAMPLES];
+        int16_t accel[3][INS_RAW_LOG_SAMPLES];
+    };
+
+    AP_InertialSensor_RawLog();
+
+    // the size of a count, in radians/sec and m/s/s. From the driver
+    // initialisation, before any samples
+    void set_scale(float gyro_scale, float accel_scale);
+    float gyro_scale(void) const { return _gyro_scale; }
+    float accel_scale(void) const { return _accel_scale; }
+
+    // start or stop the capture. Starting drops any blocks left from
+    // before. From the main thread
+    void enable(bool on);
+
+    // the oldest full block, or NULL if there is none. It stays valid
+    // until pop(). From the main thread
+    const struct block *peek(void) const;
+    void pop(void);
+
+    // samples dropped for want of a free block
+    uint32_t dropped(void) const { return _dropped; }
+
+    // add one sample, in radians/sec and m/s/s, taken at time_us.
+    // From the timer process
+    void sample(const Vector3f &gyro, const Vector3f &accel, uint32_t time_us);
+
+private:
+    static int16_t _quantise(float v, float inv_scale);
+
+    volatile bool _enabled;
+    volatile uint8_t _head;         // blocks filled
+    volatile uint8_t _tail;         // blocks taken
+    uint8_t _count;                 // samples in the block being filled
+    uint32_t _dropped;
+    float _gyro_scale, _accel_scale;
+    float _gyro_inv_scale, _accel_inv_scale;
+    struct block _blocks[INS_RAW_LOG_BLOCKS];
+};
+
+#endif // __AP_INERTIAL_SENSOR_RAWLOG_H__
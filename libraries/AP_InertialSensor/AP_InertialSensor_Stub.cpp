@@ -31,15 +31,13 @@ bool AP_InertialSensor_Stub::update( void ) {
     uint32_t now = hal.scheduler->millis();
     _delta_time_usec = (now - _last_update_ms) * 1000;
     _last_update_ms = now;
+    _last_sample_us = hal.scheduler->micros();
     return true;
 }
 
 float AP_InertialSensor_Stub::get_delta_time() {
     return _delta_time_usec * 1.0e-6;
 }
-uint32_t AP_InertialSensor_Stub::get_last_sample_time_micros() {
-    return _last_update_ms * 1000;
-}
 float AP_InertialSensor_Stub::get_gyro_drift_rate(void) {
     // 0.5 degrees/second/minute
     return ToRad(0.5/60);
@@ -15,7 +15,6 @@ public:
     /* Concrete implementation of AP_InertialSensor functions: */
     bool            update();
     float	        get_delta_time();
-    uint32_t        get_last_sample_time_micros();
     float           get_gyro_drift_rate();
     uint16_t        num_samples_available();
 
@@ -10,19 +10,18 @@ extern const AP_HAL::HAL& hal;
 uint8_t AP_InertialSensor_UserInteract_MAVLink::blocking_read(void) 
 {
     uint32_t start_ms = hal.scheduler->millis();
+    /* a parser on the stack for the length of the wait, rather than
+     * mavlink_parse_char() and its static buffer for each channel */
+    MAVLink_parser parser;
+    mavlink_message_t msg;
     /* Wait for a COMMAND_ACK message to be received from the ground station */
     while (hal.scheduler->millis() - start_ms < 30000U) {
-        while (!comm_get_available(_chan)) {
-            hal.scheduler->delay(1);
-        }
-        uint8_t c = comm_receive_ch(_chan);
-        mavlink_message_t msg;
-        mavlink_status_t status;
-        if (mavlink_parse_char(_chan, c, &msg, &status)) {
+        while (parser.receive(comm_get_port(_chan), msg)) {
             if (msg.msgid == MAVLINK_MSG_ID_COMMAND_ACK) {
                 return 0;
             }
         }
+        hal.scheduler->delay(1);
     }
     hal.console->println_P(PSTR("Timed out waiting for user response"));
     return 0;
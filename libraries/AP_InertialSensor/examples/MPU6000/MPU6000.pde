@@ -14,6 +14,7 @@
 #include <AP_Math.h>
 #include <AP_Param.h>
 #include <AP_ADC.h>
+#include <Filter.h>
 #include <AP_InertialSensor.h>
 #include <GCS_MAVLink.h>
 
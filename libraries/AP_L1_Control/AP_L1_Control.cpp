@@ -74,25 +74,46 @@ float AP_L1_Control::crosstrack_error(void)
 	return _crosstrack_error;
 }
 
+// the gains only depend on the parameters, so are worked out when
+// they change rather than on every update
+void AP_L1_Control::_update_gains(void)
+{
+	if (_L1_period == _gain_period && _L1_damping == _gain_damping) {
+		return;
+	}
+	_gain_period = _L1_period;
+	_gain_damping = _L1_damping;
+
+	// L1 gain required for specified damping
+	_K_L1 = 4.0f * _gain_damping * _gain_damping;
+
+	// the L1 length required for specified period is this times the
+	// groundspeed. 0.3183099 = 1/pi
+	_L1_dist_per_gs = 0.3183099f * _gain_damping * _gain_period;
+
+	// guidance gains used by PD loop (used during circle tracking)
+	float omega = (6.2832f / _gain_period);
+	_Kx = omega * omega;
+	_Kv = 2.0f * _gain_damping * omega;
+
+	// normalised frequency for heading hold tracking loop
+	_omegaA = 4.4428f/_gain_period; // sqrt(2)*pi/period
+}
+
 // update L1 control for waypoint navigation
-// this function costs about 3.5 milliseconds on a AVR2560
-void AP_L1_Control::update_waypoint(const struct Location &prev_WP, const struct Location &next_WP)
+void AP_L1_Control::update_waypoint(const struct Position &prev_WP, const struct Position &next_WP)
 {
 
-	struct Location _current_loc;
+	struct Position _current_loc;
 	float Nu;
 	float xtrackVel;
 	float ltrackVel;
 	
-	// Calculate L1 gain required for specified damping
-	float K_L1 = 4.0f * _L1_damping * _L1_damping;
+	_update_gains();
 
 	// Get current position and velocity
     _ahrs->get_position(&_current_loc);
 
-	// update _target_bearing_cd
-	_target_bearing_cd = get_bearing_cd(&_current_loc, &next_WP);
-
 	Vector2f _groundspeed_vector = _ahrs->groundspeed_vector();
 	
 	//Calculate groundspeed
@@ -100,26 +121,39 @@ void AP_L1_Control::update_waypoint(const struct Location &prev_WP, const struct
 
 	// Calculate time varying control parameters
 	// Calculate the L1 length required for specified period
-	// 0.3183099 = 1/1/pipi
-	_L1_dist = 0.3183099f * _L1_damping * _L1_period * groundSpeed;
+	_L1_dist = _L1_dist_per_gs * groundSpeed;
 	
-	//Convert current location and WP positions to 2D vectors in lat and long
-    Vector2f A_air((_current_loc.lat*1.0e-7f), (_current_loc.lng*1.0e-7f));
-    Vector2f A_v((prev_WP.lat*1.0e-7f), (prev_WP.lng*1.0e-7f));
-    Vector2f B_v((next_WP.lat*1.0e-7f), (next_WP.lng*1.0e-7f));
+	// Use a local frame centred on WP A. WP B and the direction of
+	// the leg are only worked out when the waypoints change
+	_frame.set_origin(prev_WP);
+	if (!_leg_valid ||
+	    prev_WP.lat != _leg_prev_lat || prev_WP.lng != _leg_prev_lng ||
+	    next_WP.lat != _leg_next_lat || next_WP.lng != _leg_next_lng) {
+		_leg_prev_lat = prev_WP.lat;
+		_leg_prev_lng = prev_WP.lng;
+		_leg_next_lat = next_WP.lat;
+		_leg_next_lng = next_WP.lng;
+		_leg_B = _frame.location_to_ne_cm(next_WP) * 0.01f;
+		if (_leg_B.length() < 1.0e-6f) {
+			_leg_AB = Vector2f(0, 0);
+		} else {
+			_leg_AB = _leg_B.normalized();
+		}
+		_leg_valid = true;
+	}
+
+	// Calculate the NE position in meters of the aircraft relative to WP A
+    Vector2f A_air = _frame.location_to_ne_cm(_current_loc) * 0.01f;
+
+	// update _target_bearing_cd
+	_target_bearing_cd = _bearing_cd(A_air, _leg_B);
 
-	// Calculate the NE position of WP B relative to WP A
-    Vector2f AB = _geo2planar(A_v, B_v);
-	
 	// Check for AB zero length and track directly to the destination
 	// if too small
-	if (AB.length() < 1.0e-6f) {
-		AB = _geo2planar(A_air, B_v);
+    Vector2f AB = _leg_AB;
+	if (AB == Vector2f(0, 0)) {
+		AB = (_leg_B - A_air).normalized();
 	}
-	AB.normalize();
-
-	// Calculate the NE position of the aircraft relative to WP A
-    A_air = _geo2planar(A_v, A_air);
 
 	// calculate distance to target track, for reporting
 	_crosstrack_error = AB % A_air;
@@ -135,15 +169,15 @@ void AP_L1_Control::update_waypoint(const struct Location &prev_WP, const struct
 		Vector2f A_air_unit = (A_air).normalized(); // Unit vector from WP A to aircraft
 		xtrackVel = _groundspeed_vector % (-A_air_unit); // Velocity across line
 		ltrackVel = _groundspeed_vector * (-A_air_unit); // Velocity along line
-		Nu = atan2f(xtrackVel,ltrackVel);
-		_nav_bearing = atan2f(-A_air_unit.y , -A_air_unit.x); // bearing (radians) from AC to L1 point
+		Nu = fast_atan2(xtrackVel,ltrackVel);
+		_nav_bearing = fast_atan2(-A_air_unit.y , -A_air_unit.x); // bearing (radians) from AC to L1 point
 		
 	} else { //Calc Nu to fly along AB line
 			
 		//Calculate Nu2 angle (angle of velocity vector relative to line connecting waypoints)
 		xtrackVel = _groundspeed_vector % AB; // Velocity cross track
 		ltrackVel = _groundspeed_vector * AB; // Velocity along track
-		float Nu2 = atan2f(xtrackVel,ltrackVel);
+		float Nu2 = fast_atan2(xtrackVel,ltrackVel);
 		//Calculate Nu1 angle (Angle to L1 reference point)
 		float xtrackErr = A_air % AB;
 		float sine_Nu1 = xtrackErr/_maxf(_L1_dist , 0.1f);
@@ -151,12 +185,12 @@ void AP_L1_Control::update_waypoint(const struct Location &prev_WP, const struct
 		sine_Nu1 = constrain_float(sine_Nu1, -0.7854f, 0.7854f);
 		float Nu1 = asinf(sine_Nu1);
 		Nu = Nu1 + Nu2;
-		_nav_bearing = atan2f(AB.y, AB.x) + Nu1; // bearing (radians) from AC to L1 point		
+		_nav_bearing = fast_atan2(AB.y, AB.x) + Nu1; // bearing (radians) from AC to L1 point		
 	}	
 			
 	//Limit Nu to +-pi
 	Nu = constrain_float(Nu, -1.5708f, +1.5708f);
-	_latAccDem = K_L1 * groundSpeed * groundSpeed / _L1_dist * sinf(Nu);
+	_latAccDem = _K_L1 * groundSpeed * groundSpeed / _L1_dist * fast_sin(Nu);
 	
 	// Waypoint capture status is always false during waypoint following
 	_WPcircle = false;
@@ -165,28 +199,19 @@ void AP_L1_Control::update_waypoint(const struct Location &prev_WP, const struct
 }
 
 // update L1 control for loitering
-void AP_L1_Control::update_loiter(const struct Location &center_WP, float radius, int8_t loiter_direction)
+void AP_L1_Control::update_loiter(const struct Position &center_WP, float radius, int8_t loiter_direction)
 {
-	struct Location _current_loc;
+	struct Position _current_loc;
 
     // scale loiter radius with square of EAS2TAS to allow us to stay
     // stable at high altitude
     radius *= sq(_ahrs->get_EAS2TAS());
 
-	// Calculate guidance gains used by PD loop (used during circle tracking)
-	float omega = (6.2832f / _L1_period);
-	float Kx = omega * omega;
-	float Kv = 2.0f * _L1_damping * omega;
-
-	// Calculate L1 gain required for specified damping (used during waypoint capture)
-	float K_L1 = 4.0f * _L1_damping * _L1_damping;
+	_update_gains();
 
 	//Get current position and velocity
     _ahrs->get_position(&_current_loc);
 
-	// update _target_bearing_cd
-	_target_bearing_cd = get_bearing_cd(&_current_loc, &center_WP);
-
 	Vector2f _groundspeed_vector = _ahrs->groundspeed_vector();
 
 	//Calculate groundspeed
@@ -194,15 +219,14 @@ void AP_L1_Control::update_loiter(const struct Location &center_WP, float radius
 
 	// Calculate time varying control parameters
 	// Calculate the L1 length required for specified period
-	// 0.3183099 = 1/pi
-	_L1_dist = 0.3183099f * _L1_damping * _L1_period * groundSpeed;
+	_L1_dist = _L1_dist_per_gs * groundSpeed;
 
-	//Convert current location and WP positionsto 2D vectors in lat and long
-    Vector2f A_air((_current_loc.lat*1.0e-7f), (_current_loc.lng*1.0e-7f));
-    Vector2f A_v((center_WP.lat*1.0e-7f), (center_WP.lng*1.0e-7f));
+	//Calculate the NE position in meters of the aircraft relative to WP A, in a local frame centred on it
+	_frame.set_origin(center_WP);
+    Vector2f A_air = _frame.location_to_ne_cm(_current_loc) * 0.01f;
 
-	//Calculate the NE position of the aircraft relative to WP A
-    A_air = _geo2planar(A_v, A_air);
+	// update _target_bearing_cd
+	_target_bearing_cd = _bearing_cd(A_air, Vector2f(0, 0));
 	
     //Calculate the unit vector from WP A to aircraft
     Vector2f A_air_unit = (A_air).normalized();
@@ -210,11 +234,11 @@ void AP_L1_Control::update_loiter(const struct Location &center_WP, float radius
 	//Calculate Nu to capture center_WP
 	float xtrackVelCap = A_air_unit % _groundspeed_vector; // Velocity across line - perpendicular to radial inbound to WP
 	float ltrackVelCap = - (_groundspeed_vector * A_air_unit); // Velocity along line - radial inbound to WP
-	float Nu = atan2f(xtrackVelCap,ltrackVelCap);
+	float Nu = fast_atan2(xtrackVelCap,ltrackVelCap);
 	Nu = constrain_float(Nu, -1.5708f, +1.5708f); //Limit Nu to +- Pi/2
 
 	//Calculate lat accln demand to capture center_WP (use L1 guidance law)
-	float latAccDemCap = K_L1 * groundSpeed * groundSpeed / _L1_dist * sinf(Nu);
+	float latAccDemCap = _K_L1 * groundSpeed * groundSpeed / _L1_dist * fast_sin(Nu);
 	
 	//Calculate radial position and velocity errors
 	float xtrackVelCirc = -ltrackVelCap; // Radial outbound velocity - reuse previous radial inbound velocity
@@ -224,7 +248,7 @@ void AP_L1_Control::update_loiter(const struct Location &center_WP, float radius
 	_crosstrack_error = xtrackErrCirc;
 	
 	//Calculate PD control correction to circle waypoint
-	float latAccDemCircPD = (xtrackErrCirc * Kx + xtrackVelCirc * Kv);
+	float latAccDemCircPD = (xtrackErrCirc * _Kx + xtrackVelCirc * _Kv);
 	
 	//Calculate tangential velocity
 	float velTangent = xtrackVelCap * float(loiter_direction);
@@ -246,12 +270,12 @@ void AP_L1_Control::update_loiter(const struct Location &center_WP, float radius
 		_latAccDem = latAccDemCap;
 		_WPcircle = false;
 		_bearing_error = Nu; // angle between demanded and achieved velocity vector, +ve to left of track
-		_nav_bearing = atan2f(-A_air_unit.y , -A_air_unit.x); // bearing (radians) from AC to L1 point
+		_nav_bearing = fast_atan2(-A_air_unit.y , -A_air_unit.x); // bearing (radians) from AC to L1 point
 	} else {
 		_latAccDem = latAccDemCirc;
 		_WPcircle = true;
 		_bearing_error = 0.0f; // bearing error (radians), +ve to left of track
-		_nav_bearing = atan2f(-A_air_unit.y , -A_air_unit.x); // bearing (radians)from AC to L1 point
+		_nav_bearing = fast_atan2(-A_air_unit.y , -A_air_unit.x); // bearing (radians)from AC to L1 point
 	}
 }
 
@@ -259,9 +283,7 @@ void AP_L1_Control::update_loiter(const struct Location &center_WP, float radius
 // update L1 control for heading hold navigation
 void AP_L1_Control::update_heading_hold(int32_t navigation_heading_cd)
 {
-	// Calculate normalised frequency for tracking loop						   
-	const float omegaA = 4.4428f/_L1_period; // sqrt(2)*pi/period
-	// Calculate additional damping gain
+	_update_gains();
 
 	int32_t Nu_cd;
 	float Nu;
@@ -280,8 +302,8 @@ void AP_L1_Control::update_heading_hold(int32_t navigation_heading_cd)
 	float groundSpeed = _groundspeed_vector.length();
 
 	// Calculate time varying control parameters
-	_L1_dist = groundSpeed / omegaA; // L1 distance is adjusted to maintain a constant tracking loop frequency
-	float VomegaA = groundSpeed * omegaA;
+	_L1_dist = groundSpeed / _omegaA; // L1 distance is adjusted to maintain a constant tracking loop frequency
+	float VomegaA = groundSpeed * _omegaA;
 	
 	// Waypoint capture status is always false during heading hold
 	_WPcircle = false;
@@ -292,7 +314,7 @@ void AP_L1_Control::update_heading_hold(int32_t navigation_heading_cd)
 
 	// Limit Nu to +-pi
 	Nu = constrain_float(Nu, -1.5708f, +1.5708f);
-	_latAccDem = 2.0f*sinf(Nu)*VomegaA;
+	_latAccDem = 2.0f*fast_sin(Nu)*VomegaA;
 }
 
 // update L1 control for level flight on current heading
@@ -311,14 +333,10 @@ void AP_L1_Control::update_level_flight(void)
 }
 
 
-Vector2f AP_L1_Control::_geo2planar(const Vector2f &ref, const Vector2f &wp) const
+int32_t AP_L1_Control::_bearing_cd(const Vector2f &from, const Vector2f &to) const
 {
-    Vector2f out;
-
-    out.x=radians((wp.x-ref.x));
-    out.y=radians((wp.y-ref.y)*cosf(radians(ref.x)));
-
-    return out * RADIUS_OF_EARTH;
+    Vector2f d = to - from;
+    return wrap_360_cd(RadiansToCentiDegrees(fast_atan2(d.y, d.x)));
 }
 
 float AP_L1_Control::_maxf(const float &num1, const float &num2) const
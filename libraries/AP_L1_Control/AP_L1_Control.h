@@ -24,7 +24,9 @@
 class AP_L1_Control : public AP_Navigation {
 public:
 	AP_L1_Control(AP_AHRS *ahrs) :
-		_ahrs(ahrs)
+		_ahrs(ahrs),
+		_gain_period(-1),
+		_leg_valid(false)
 		{
 			AP_Param::setup_object_defaults(this, var_info);
 		}
@@ -43,8 +45,8 @@ public:
 
 	int32_t target_bearing_cd(void);
 	float turn_distance(float wp_radius);
-	void update_waypoint(const struct Location &prev_WP, const struct Location &next_WP);
-	void update_loiter(const struct Location &center_WP, float radius, int8_t loiter_direction);
+	void update_waypoint(const struct Position &prev_WP, const struct Position &next_WP);
+	void update_loiter(const struct Position &center_WP, float radius, int8_t loiter_direction);
 	void update_heading_hold(int32_t navigation_heading_cd);
 	void update_level_flight(void);
 	bool reached_loiter_target(void);
@@ -83,9 +85,30 @@ private:
 	// L1 tracking loop damping ratio
 	AP_Float _L1_damping;
 	
-    // Convert a 2D vector from latitude and longitude to planar
-    // coordinates based on a reference point
-	Vector2f _geo2planar(const Vector2f &ref, const Vector2f &wp) const;
+	// bearing in centi-degrees between two NE positions
+	int32_t _bearing_cd(const Vector2f &from, const Vector2f &to) const;
+
+	// local frame centred on the waypoint being navigated relative to
+	LocalFrame _frame;
+
+	// work out the gains again if the parameters have changed
+	void _update_gains(void);
+
+	// gains from _L1_period and _L1_damping, and the values they are for
+	float _gain_period;
+	float _gain_damping;
+	float _K_L1;            // L1 gain for the damping ratio
+	float _L1_dist_per_gs;  // L1 distance per m/s of groundspeed
+	float _Kx;              // circle tracking PD gains
+	float _Kv;
+	float _omegaA;          // heading hold loop frequency
+
+	// the leg of the last update_waypoint(), kept until the waypoints change
+	int32_t _leg_prev_lat, _leg_prev_lng;
+	int32_t _leg_next_lat, _leg_next_lng;
+	Vector2f _leg_B;        // WP B relative to WP A in meters
+	Vector2f _leg_AB;       // unit vector from WP A to WP B, zero for a zero length leg
+	bool _leg_valid;
 
 	//Calculate the maximum of two floating point numbers
 	float _maxf(const float &num1, const float &num2) const;
@@ -46,7 +46,7 @@ const AP_Param::GroupInfo AP_Limit_Altitude::var_info[] PROGMEM = {
 };
 
 AP_Limit_Altitude::AP_Limit_Altitude(const struct Location *current_loc) :
-    AP_Limit_Module(AP_LIMITS_ALTITUDE),     // enabled and required
+    AP_Limit_Module(AP_LIMITS_ALTITUDE, AP_LIMITS_INPUT_ALTITUDE),     // enabled and required
     _current_loc(current_loc)
 {
     AP_Param::setup_object_defaults(this, var_info);
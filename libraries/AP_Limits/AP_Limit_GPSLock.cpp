@@ -29,7 +29,7 @@ const AP_Param::GroupInfo AP_Limit_GPSLock::var_info[] PROGMEM = {
 };
 
 AP_Limit_GPSLock::AP_Limit_GPSLock(GPS *&gps) :
-    AP_Limit_Module(AP_LIMITS_GPSLOCK),     // enabled and required
+    AP_Limit_Module(AP_LIMITS_GPSLOCK, AP_LIMITS_INPUT_GPS),     // enabled and required
     _gps(gps)
 {
     AP_Param::setup_object_defaults(this, var_info);
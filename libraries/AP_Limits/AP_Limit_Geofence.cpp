@@ -58,14 +58,18 @@ const AP_Param::GroupInfo AP_Limit_Geofence::var_info[] PROGMEM = {
 AP_Limit_Geofence::AP_Limit_Geofence(uint16_t efs, uint8_t f_wp_s,
         uint8_t max_fp, GPS *&gps, const struct Location *h_loc,
         const struct Location *c_loc) :
-    AP_Limit_Module(AP_LIMITS_GEOFENCE),
+    AP_Limit_Module(AP_LIMITS_GEOFENCE,
+            AP_LIMITS_INPUT_POSITION | AP_LIMITS_INPUT_HOME | AP_LIMITS_INPUT_GPS),
     _gps(gps),
     _current_loc(c_loc),
     _home(h_loc),
     _eeprom_fence_start(efs),
     _fence_wp_size(f_wp_s),
     _max_fence_points(max_fp),
-    _boundary_uptodate(false)
+    _boundary_uptodate(false),
+    _boundary_ok(false),
+    _boundary_points(0),
+    _boundary_fence_total(0)
 {
     AP_Param::setup_object_defaults(this, var_info);
     update_boundary();
@@ -104,19 +108,20 @@ bool AP_Limit_Geofence::triggered() {
 
         // COMPLEX GEOFENCE  mode
 
-        // check boundary and update if necessary
-        if (!_boundary_uptodate) {
+        // check boundary and update if necessary, including when the
+        // number of points has been changed
+        if (!_boundary_uptodate || _boundary_fence_total != _fence_total) {
             update_boundary();
         }
 
         // if boundary is correct, and current_loc exists check if we
         // are inside the fence.
-        if (boundary_correct() && _current_loc) {
+        if (_boundary_ok && _current_loc) {
             Vector2l location;
             location.x = _current_loc->lat;
             location.y = _current_loc->lng;
             // trigger if outside
-            if (Polygon_outside(location, &_boundary[1], _fence_total-1)) {
+            if (_polygon.outside(location)) {
                 // TRIGGER
                 _triggered = true;
             }
@@ -154,6 +159,7 @@ void AP_Limit_Geofence::set_fence_point_with_index(Vector2l &point, uint8_t i)
     hal.storage->write_dword(mem, point.y);
 
     _boundary_uptodate = false;
+    invalidate();
 }
 
 /*
@@ -177,21 +183,35 @@ Vector2l AP_Limit_Geofence::get_fence_point_with_index(uint8_t i)
 }
 
 void AP_Limit_Geofence::update_boundary() {
-    if (!_simple && _fence_total > 0) {
+    _boundary_fence_total = _fence_total;
+    _boundary_points = 0;
+    if (_fence_total > 0) {
+        _boundary_points = _fence_total < MAX_FENCEPOINTS ? _fence_total : MAX_FENCEPOINTS;
+    }
+    _boundary_ok = false;
+
+    if (!_simple && _boundary_points > 0) {
 
-        for (uint8_t i = 0; i < (uint8_t) _fence_total; i++) {
+        for (uint8_t i = 0; i < _boundary_points; i++) {
             _boundary[i] = get_fence_point_with_index(i);
         }
 
         _boundary_uptodate = true;
 
+        // the check is done once here rather than on every trigger
+        // check, and the edges are prepared for the repeated tests
+        _boundary_ok = boundary_correct();
+        if (_boundary_ok) {
+            _polygon.set(&_boundary[1], _boundary_points - 1);
+        }
     }
 }
 
 bool AP_Limit_Geofence::boundary_correct() {
 
-    if (Polygon_complete(&_boundary[1], _fence_total - 1) &&
-        !Polygon_outside(_boundary[0], &_boundary[1], _fence_total - 1)) {
+    if (_boundary_points > 1 &&
+        Polygon_complete(&_boundary[1], _boundary_points - 1) &&
+        !Polygon_outside(_boundary[0], &_boundary[1], _boundary_points - 1)) {
         return true;
     } else return false;
 }
@@ -55,7 +55,11 @@ private:
     const unsigned          _fence_wp_size;
     const unsigned          _max_fence_points;
     bool                    _boundary_uptodate;
+    bool                    _boundary_ok;                    // boundary_correct() when the boundary was read
+    uint8_t                 _boundary_points;                // points read, at most MAX_FENCEPOINTS
+    int8_t                  _boundary_fence_total;           // _fence_total when the boundary was read
     Vector2l                _boundary[MAX_FENCEPOINTS];      // complex mode fence
+    PolygonFence            _polygon;                        // _boundary[1..] prepared for the inside test
 
 };
 
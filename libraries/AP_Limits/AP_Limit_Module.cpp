@@ -28,14 +28,17 @@ extern const prog_char_t *get_module_name(enum moduleid i) {
     }
 }
 
-AP_Limit_Module::AP_Limit_Module(enum moduleid i) {
+AP_Limit_Module::AP_Limit_Module(enum moduleid i, uint8_t inputs) {
     _id = i;
+    _inputs = inputs;
+    _stale = true;
     _next = NULL;
 }
 
 bool AP_Limit_Module::init() {
 
     _triggered = false;
+    _stale = true;
     return true;
 };
 
@@ -63,6 +66,11 @@ bool AP_Limit_Module::triggered() {
     return(_triggered);
 }
 
+bool AP_Limit_Module::check() {
+    _stale = false;
+    return triggered();
+}
+
 void AP_Limit_Module::action() {
     // do nothing
 }
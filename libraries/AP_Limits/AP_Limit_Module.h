@@ -25,6 +25,16 @@ enum moduleid {
     AP_LIMITS_ALTITUDE   = (1 << 2)
 };
 
+// The inputs a module's check depends on, also as a bit-field. AP_Limits
+// only checks a module again when one of its inputs has changed
+enum limit_input {
+    AP_LIMITS_INPUT_POSITION = (1 << 0),   // current latitude and longitude
+    AP_LIMITS_INPUT_ALTITUDE = (1 << 1),   // current altitude
+    AP_LIMITS_INPUT_HOME     = (1 << 2),   // home location
+    AP_LIMITS_INPUT_GPS      = (1 << 3),   // the GPS driver and its fix
+    AP_LIMITS_INPUT_ALL      = 0xFF
+};
+
 extern const prog_char_t *get_module_name(enum moduleid i);
 
 // an integer type big enough to fit a bit field for all modules.
@@ -34,11 +44,22 @@ typedef uint8_t LimitModuleBits;
 class AP_Limit_Module {
 
 public:
-    // initialize a new module
-    AP_Limit_Module(enum moduleid id);
+    // initialize a new module, which depends on the given inputs
+    AP_Limit_Module(enum moduleid id, uint8_t inputs = AP_LIMITS_INPUT_ALL);
     // initialize self
     bool        init();
 
+    // bit-field of the limit_input values the check depends on
+    uint8_t                         inputs() const { return _inputs; }
+
+    // force the check to run next time, for a change that isn't one of
+    // the inputs, such as new fence points
+    void                            invalidate() { _stale = true; }
+    bool                            stale() const { return _stale; }
+
+    // the result of the last check, without checking again
+    bool                            last_triggered() const { return _triggered; }
+
     virtual moduleid                get_module_id();
     virtual bool                    enabled();
     virtual bool                    required();
@@ -49,8 +70,10 @@ public:
     // link the next module in the linked list
     virtual void                    link(AP_Limit_Module *m);
 
-    // trigger check function
+    // trigger check function. AP_Limits calls this through check(),
+    // which clears the stale flag
     virtual bool                    triggered();
+    bool                            check();
 
     // recovery action
     virtual void                    action();
@@ -64,6 +87,8 @@ protected:
 
 private:
     enum moduleid                   _id;
+    uint8_t                         _inputs;
+    bool                            _stale;
     AP_Limit_Module *               _next;
 };
 
@@ -56,11 +56,38 @@ const AP_Param::GroupInfo AP_Limits::var_info[] PROGMEM = {
     AP_GROUPEND
 };
 
-AP_Limits::AP_Limits() {
+AP_Limits::AP_Limits() :
+    mods_enabled(0),
+    mods_required(0),
+    mods_triggered(0),
+    _modules_head(NULL),
+    _modules_current(NULL),
+    _modules_count(0),
+    _gps(NULL),
+    _current_loc(NULL),
+    _home(NULL),
+    _refresh_index(0)
+{
     AP_Param::setup_object_defaults(this, var_info);
     _state = LIMITS_INIT;
 }
 
+void AP_Limits::inputs(GPS **gps, const struct Location *current_loc, const struct Location *home_loc)
+{
+    _gps = gps;
+    _current_loc = current_loc;
+    _home = home_loc;
+    _last_gps = NULL;
+    _last_fix = 0;
+    _last_lat = _last_lng = _last_alt = 0;
+    _last_home_lat = _last_home_lng = 0;
+
+    // nothing can be trusted from before
+    for (AP_Limit_Module *m = _modules_head; m; m = m->next()) {
+        m->invalidate();
+    }
+}
+
 void AP_Limits::modules(AP_Limit_Module *m)
 {
     _modules_head = m;
@@ -147,10 +174,47 @@ bool AP_Limits::check_required() {
     return check_triggered(true);
 }
 
+uint8_t AP_Limits::inputs_changed() {
+    if (_gps == NULL || _current_loc == NULL || _home == NULL) {
+        // we can't tell
+        return AP_LIMITS_INPUT_ALL;
+    }
+
+    uint8_t changed = 0;
+    GPS *gps = *_gps;
+    uint8_t fix = gps ? (uint8_t)gps->fix : 0;
+
+    if (gps != _last_gps || fix != _last_fix) {
+        changed |= AP_LIMITS_INPUT_GPS;
+        _last_gps = gps;
+        _last_fix = fix;
+    }
+    if (_current_loc->lat != _last_lat || _current_loc->lng != _last_lng) {
+        changed |= AP_LIMITS_INPUT_POSITION;
+        _last_lat = _current_loc->lat;
+        _last_lng = _current_loc->lng;
+    }
+    if (_current_loc->alt != _last_alt) {
+        changed |= AP_LIMITS_INPUT_ALTITUDE;
+        _last_alt = _current_loc->alt;
+    }
+    if (_home->lat != _last_home_lat || _home->lng != _last_home_lng) {
+        changed |= AP_LIMITS_INPUT_HOME;
+        _last_home_lat = _home->lat;
+        _last_home_lng = _home->lng;
+    }
+    return changed;
+}
+
 bool AP_Limits::check_triggered(bool only_required) {
 
-    // check all enabled modules for triggered limits
+    uint8_t changed = inputs_changed();
+
+    // check the enabled modules whose inputs have changed, and one
+    // module in turn whatever its inputs. The rest keep their last result
     AP_Limit_Module *mod = _modules_head;
+    LimitModuleBits was_enabled = mods_enabled;
+    uint8_t index = 0;
 
     // reset bit fields
     mods_triggered = 0;
@@ -168,10 +232,23 @@ bool AP_Limits::check_triggered(bool only_required) {
             mods_enabled |= module_id;
 
             if (mod->required()) mods_required |= module_id;
-            if (mod->triggered()) mods_triggered |= module_id;
+
+            bool triggered;
+            if ((mod->inputs() & changed) || mod->stale() ||
+                !(was_enabled & module_id) || index == _refresh_index) {
+                triggered = mod->check();
+            } else {
+                triggered = mod->last_triggered();
+            }
+            if (triggered) mods_triggered |= module_id;
         }
 
         mod = mod->next();
+        index++;
+    }
+
+    if (++_refresh_index >= index) {
+        _refresh_index = 0;
     }
 
     if (only_required) {
@@ -56,6 +56,13 @@ public:
     void                    modules_add(AP_Limit_Module *m);
     uint8_t                 modules_count();
 
+    // where the module inputs come from. Once these are set a module is
+    // only checked when one of the inputs it depends on has changed,
+    // when it becomes enabled or is invalidated, or when its turn comes
+    // round to be checked anyway, which picks up parameter changes.
+    // Without them every enabled module is checked every time
+    void                    inputs(GPS **gps, const struct Location *current_loc, const struct Location *home_loc);
+
     // main limit methods
     // initialize self and all modules
     bool                    init(); 
@@ -67,6 +74,9 @@ public:
     bool                    check_required();
     // the function that does the checking for the two above
     bool                    check_triggered(bool required);
+    // bit-field of the limit_input values that have changed since the
+    // last check
+    uint8_t                 inputs_changed();
 
     // time of last limit breach (trigger)
     uint32_t                last_trigger;
@@ -116,6 +126,20 @@ private:
     AP_Limit_Module *       _modules_current;
     uint8_t                 _modules_count;
 
+    // the inputs, and their values at the last check
+    GPS **                  _gps;
+    const struct Location * _current_loc;
+    const struct Location * _home;
+    GPS *                   _last_gps;
+    uint8_t                 _last_fix;
+    int32_t                 _last_lat;
+    int32_t                 _last_lng;
+    int32_t                 _last_alt;
+    int32_t                 _last_home_lat;
+    int32_t                 _last_home_lng;
+
+    // position in the list of the module checked whatever its inputs
+    uint8_t                 _refresh_index;
 };
 
 
@@ -17,6 +17,7 @@
 #include "vector3.h"
 #include "matrix3.h"
 #include "quaternion.h"
+#include "fixed.h"
 #include "polygon.h"
 
 #ifndef PI
@@ -43,6 +44,10 @@
 #define LATLON_TO_M  0.01113195f
 #define LATLON_TO_CM 1.113195f
 
+#include "local_frame.h"
+#include "sensor_vote.h"
+#include "orbit.h"
+
 // define AP_Param types AP_Vector3f and Ap_Matrix3f
 AP_PARAMDEFV(Matrix3f, Matrix3f, AP_PARAM_MATRIX3F);
 AP_PARAMDEFV(Vector3f, Vector3f, AP_PARAM_VECTOR3F);
@@ -56,6 +61,18 @@ float           safe_sqrt(float v);
 // a faster varient of atan.  accurate to 6 decimal places for values between -1 ~ 1 but then diverges quickly
 float           fast_atan(float v);
 
+// faster varients of atan2, sin, cos and 1/sqrt for the hot paths.
+// Their maximum errors are
+//   fast_atan2     2e-5 radians
+//   fast_sin/cos   1e-4 on AVR. Elsewhere 4e-6 for |x| < 10, growing
+//                  to 6e-5 at |x| = 1000 from rounding of the argument
+//   fast_inv_sqrt  5e-6 relative on AVR, 1e-7 elsewhere. Returns 0
+//                  for x <= 0
+float           fast_atan2(float y, float x);
+float           fast_sin(float x);
+float           fast_cos(float x);
+float           fast_inv_sqrt(float x);
+
 #if ROTATION_COMBINATION_SUPPORT
 // find a rotation that is the combination of two other
 // rotations. This is used to allow us to add an overall board
@@ -65,31 +82,31 @@ enum Rotation           rotation_combination(enum Rotation r1, enum Rotation r2,
 
 // longitude_scale - returns the scaler to compensate for shrinking longitude as you move north or south from the equator
 // Note: this does not include the scaling to convert longitude/latitude points to meters or centimeters
-float                   longitude_scale(const struct Location *loc);
+float                   longitude_scale(const struct Position *loc);
 
 // return distance in meters between two locations
-float                   get_distance(const struct Location *loc1, const struct Location *loc2);
+float                   get_distance(const struct Position *loc1, const struct Position *loc2);
 
 // return distance in centimeters between two locations
-uint32_t                get_distance_cm(const struct Location *loc1, const struct Location *loc2);
+uint32_t                get_distance_cm(const struct Position *loc1, const struct Position *loc2);
 
 // return bearing in centi-degrees between two locations
-int32_t                 get_bearing_cd(const struct Location *loc1, const struct Location *loc2);
+int32_t                 get_bearing_cd(const struct Position *loc1, const struct Position *loc2);
 
 // see if location is past a line perpendicular to
 // the line between point1 and point2. If point1 is
 // our previous waypoint and point2 is our target waypoint
 // then this function returns true if we have flown past
 // the target waypoint
-bool        location_passed_point(const struct Location & location,
-                                  const struct Location & point1,
-                                  const struct Location & point2);
+bool        location_passed_point(const struct Position & location,
+                                  const struct Position & point1,
+                                  const struct Position & point2);
 
 //  extrapolate latitude/longitude given bearing and distance
-void        location_update(struct Location *loc, float bearing, float distance);
+void        location_update(struct Position *loc, float bearing, float distance);
 
 // extrapolate latitude/longitude given distances north and east
-void        location_offset(struct Location *loc, float ofs_north, float ofs_east);
+void        location_offset(struct Position *loc, float ofs_north, float ofs_east);
 
 /*
   wrap an angle in centi-degrees
@@ -0,0 +1,186 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Timings of the AP_Math primitives, as a baseline for changes to
+// them. Each result is one line of
+//
+//   BENCH name calls total_us ns_per_call
+//
+// in the same form as Tools/LoopBench, so the results of APM2, PX4 and
+// SITL can be put side by side. The "empty" line is the cost of the
+// loop and its inputs, which is included in all the others
+//
+
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+#include <AP_Math.h>
+#include <AP_HAL.h>
+// for the SITL HAL
+#include <AP_Baro.h>
+#include <AP_ADC.h>
+#include <GCS_MAVLink.h>
+#include <AP_Compass.h>
+#include <AP_Declination.h>
+#include <SITL.h>
+#include <Filter.h>
+
+#include <AP_HAL_AVR.h>
+#include <AP_HAL_AVR_SITL.h>
+#include <AP_HAL_PX4.h>
+#include <AP_HAL_Empty.h>
+
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+#define NUM_CALLS 500
+
+// stops the compiler throwing the result of a timed operation away, or
+// moving the operation out of the loop
+#define KEEP(x) asm volatile("" : : "g"(&(x)) : "memory")
+
+#define BENCH(name, op) do { \
+    uint32_t t0 = hal.scheduler->micros(); \
+    for (uint16_t i=0; i<NUM_CALLS; i++) { \
+        op; \
+    } \
+    show_result(PSTR(name), hal.scheduler->micros() - t0); \
+} while (0)
+
+// inputs, picked with i & 7 so each call sees different data
+static Vector3f vec[8];
+static Matrix3f mat[8];
+static Quaternion quat[8];
+static float angle[8];
+static struct Position loc[8];
+
+static const Vector2l OBC_boundary[] = {
+    Vector2l(-265695640, 1518373730),
+    Vector2l(-265699560, 1518394050),
+    Vector2l(-265768230, 1518411420),
+    Vector2l(-265773080, 1518403440),
+    Vector2l(-265815110, 1518419500),
+    Vector2l(-265784860, 1518474690),
+    Vector2l(-265994890, 1518528860),
+    Vector2l(-266092110, 1518747420),
+    Vector2l(-266454780, 1518820530),
+    Vector2l(-266435720, 1518303500),
+    Vector2l(-265875990, 1518344050),
+    Vector2l(-265695640, 1518373730)
+};
+#define OBC_BOUNDARY_SIZE (sizeof(OBC_boundary)/sizeof(OBC_boundary[0]))
+
+// points along a track across the boundary
+static Vector2l track[8];
+
+static PolygonFence fence;
+
+static void show_result(const prog_char_t *name, uint32_t us)
+{
+    hal.console->printf_P(PSTR("BENCH %S %u %lu %.1f\n"),
+                          name, (unsigned)NUM_CALLS, (unsigned long)us,
+                          us * 1000.0f / NUM_CALLS);
+}
+
+static void setup_inputs(void)
+{
+    for (uint8_t i=0; i<8; i++) {
+        float r = 0.1f + 0.2f * i;
+        angle[i] = 0.12f * i - 0.4f;
+        vec[i] = Vector3f(1.0f + i, 2.0f - r, 0.5f * r - 3.0f);
+        mat[i].from_euler(0.3f * r, -0.2f * r, 0.7f * r);
+        quat[i].from_euler(0.3f * r, -0.2f * r, 0.7f * r);
+        loc[i].lat = -353629380 + 12345L * i;
+        loc[i].lng = 1491650850 - 23456L * i;
+        loc[i].alt = 58400;
+        track[i] = Vector2l(-266398870 + 50000L * i, 1518220000 + 100000L * i);
+    }
+    fence.set(OBC_boundary, OBC_BOUNDARY_SIZE);
+}
+
+static void bench_vector(void)
+{
+    Vector3f v;
+    float f;
+
+    BENCH("empty", v = vec[i & 7]; KEEP(v));
+    BENCH("vector3f_add", v = vec[i & 7] + vec[(i+1) & 7]; KEEP(v));
+    BENCH("vector3f_add_scaled", v = vec[i & 7]; v += vec[(i+1) & 7] * angle[i & 7]; KEEP(v));
+    BENCH("vector3f_multiply_add", v = vec[i & 7]; v.multiply_add(vec[(i+1) & 7], angle[i & 7]); KEEP(v));
+    BENCH("vector3f_dot", f = vec[i & 7] * vec[(i+1) & 7]; KEEP(f));
+    BENCH("vector3f_cross", v = vec[i & 7] % vec[(i+1) & 7]; KEEP(v));
+    BENCH("vector3f_length", f = vec[i & 7].length(); KEEP(f));
+    BENCH("vector3f_normalize", v = vec[i & 7]; v.normalize(); KEEP(v));
+    BENCH("vector3f_rotate", v = vec[i & 7]; v.rotate((enum Rotation)(i % ROTATION_MAX)); KEEP(v));
+}
+
+static void bench_matrix(void)
+{
+    Vector3f v;
+    Matrix3f m;
+    float roll, pitch, yaw;
+
+    BENCH("matrix3f_mul_vector", v = mat[i & 7] * vec[i & 7]; KEEP(v));
+    BENCH("matrix3f_mul_transpose", v = mat[i & 7].mul_transpose(vec[i & 7]); KEEP(v));
+    BENCH("matrix3f_add_mul_scaled", v = vec[(i+1) & 7]; v += (mat[i & 7] * vec[i & 7]) * angle[i & 7]; KEEP(v));
+    BENCH("matrix3f_multiply_add", v = vec[(i+1) & 7]; mat[i & 7].multiply_add(vec[i & 7], angle[i & 7], v); KEEP(v));
+    BENCH("matrix3f_transpose_multiply_add", v = vec[(i+1) & 7]; mat[i & 7].transpose_multiply_add(vec[i & 7], angle[i & 7], v); KEEP(v));
+    BENCH("matrix3f_mul_matrix", m = mat[i & 7] * mat[(i+1) & 7]; KEEP(m));
+    BENCH("matrix3f_rotate", m = mat[i & 7]; m.rotate(vec[i & 7] * 0.001f); KEEP(m));
+    BENCH("matrix3f_from_euler", m.from_euler(angle[i & 7], angle[(i+1) & 7], angle[(i+2) & 7]); KEEP(m));
+    BENCH("matrix3f_to_euler", m = mat[i & 7]; m.to_euler(&roll, &pitch, &yaw); KEEP(roll); KEEP(pitch); KEEP(yaw));
+}
+
+static void bench_quaternion(void)
+{
+    Vector3f v;
+    Matrix3f m;
+    Quaternion q;
+    float roll, pitch, yaw;
+
+    BENCH("quaternion_from_euler", q.from_euler(angle[i & 7], angle[(i+1) & 7], angle[(i+2) & 7]); KEEP(q));
+    BENCH("quaternion_to_euler", q = quat[i & 7]; q.to_euler(&roll, &pitch, &yaw); KEEP(roll); KEEP(pitch); KEEP(yaw));
+    BENCH("quaternion_rotation_matrix", q = quat[i & 7]; q.rotation_matrix(m); KEEP(m));
+    BENCH("quaternion_earth_to_body", q = quat[i & 7]; v = vec[i & 7]; q.earth_to_body(v); KEEP(v));
+    BENCH("quaternion_normalize", q = quat[i & 7]; q.normalize(); KEEP(q));
+}
+
+static void bench_location(void)
+{
+    float f;
+    int32_t bearing;
+    bool b;
+    struct Position l;
+
+    BENCH("safe_asin", f = safe_asin(angle[i & 7]); KEEP(f));
+    BENCH("get_distance", f = get_distance(&loc[i & 7], &loc[(i+3) & 7]); KEEP(f));
+    BENCH("get_bearing_cd", bearing = get_bearing_cd(&loc[i & 7], &loc[(i+3) & 7]); KEEP(bearing));
+    BENCH("location_passed_point", b = location_passed_point(loc[i & 7], loc[(i+3) & 7], loc[(i+5) & 7]); KEEP(b));
+    BENCH("location_update", l = loc[i & 7]; location_update(&l, 45.0f * (i & 7), 100.0f); KEEP(l));
+    BENCH("location_offset", l = loc[i & 7]; location_offset(&l, 30.0f, -20.0f); KEEP(l));
+}
+
+static void bench_polygon(void)
+{
+    bool b;
+
+    BENCH("polygon_outside", b = Polygon_outside(track[i & 7], OBC_boundary, OBC_BOUNDARY_SIZE); KEEP(b));
+    BENCH("polygon_fence_outside", b = fence.outside(track[(i >> 6) & 7]); KEEP(b));
+}
+
+void setup(void)
+{
+    hal.console->println_P(PSTR("AP_Math benchmarks"));
+    setup_inputs();
+}
+
+void loop(void)
+{
+    bench_vector();
+    bench_matrix();
+    bench_quaternion();
+    bench_location();
+    bench_polygon();
+    hal.console->println_P(PSTR("BENCH DONE"));
+    hal.scheduler->delay(1000);
+}
+
+AP_HAL_MAIN();
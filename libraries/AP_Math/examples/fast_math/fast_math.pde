@@ -0,0 +1,120 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Accuracy checks and timings for the AP_Math fast_* functions
+//
+
+#include <stdlib.h>
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+#include <AP_Math.h>
+#include <AP_HAL.h>
+
+#include <AP_HAL_AVR.h>
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+#define NUM_TIMING_CALLS 500
+
+// stops the compiler throwing the timed calls away
+static volatile float sink;
+
+// test inputs, spread over the ranges the callers use
+static float input(uint16_t i, float range)
+{
+    return range * ((float)(i % 1001) / 500.0f - 1.0f);
+}
+
+static void show_timing(const prog_char_t *name, uint32_t libm_us, uint32_t fast_us)
+{
+    hal.console->printf_P(PSTR("%S: libm %.1fus fast %.1fus\n"),
+                          name,
+                          libm_us / (float)NUM_TIMING_CALLS,
+                          fast_us / (float)NUM_TIMING_CALLS);
+}
+
+static void test_accuracy(void)
+{
+    float err_atan2 = 0, err_sin = 0, err_cos = 0, err_inv_sqrt = 0;
+
+    for (uint16_t i=0; i<10000; i++) {
+        float x = input(i, 100.0f);
+        float y = input(i * 7 + 3, 100.0f);
+        float a = input(i, 10.0f);
+        float s = (i + 1) * 0.37f;
+
+        float e;
+        e = fabsf(fast_atan2(y, x) - atan2f(y, x));
+        err_atan2 = max(err_atan2, e);
+        e = fabsf(fast_sin(a) - sinf(a));
+        err_sin = max(err_sin, e);
+        e = fabsf(fast_cos(a) - cosf(a));
+        err_cos = max(err_cos, e);
+        e = fabsf(fast_inv_sqrt(s) * sqrtf(s) - 1.0f);
+        err_inv_sqrt = max(err_inv_sqrt, e);
+    }
+
+    hal.console->printf_P(PSTR("max errors: atan2 %.7f sin %.7f cos %.7f inv_sqrt %.7f\n"),
+                          err_atan2, err_sin, err_cos, err_inv_sqrt);
+}
+
+static void test_timing(void)
+{
+    uint32_t t0, libm_us, fast_us;
+    uint16_t i;
+
+    t0 = hal.scheduler->micros();
+    for (i=0; i<NUM_TIMING_CALLS; i++) {
+        sink = atan2f(input(i * 7 + 3, 100.0f), input(i, 100.0f));
+    }
+    libm_us = hal.scheduler->micros() - t0;
+    t0 = hal.scheduler->micros();
+    for (i=0; i<NUM_TIMING_CALLS; i++) {
+        sink = fast_atan2(input(i * 7 + 3, 100.0f), input(i, 100.0f));
+    }
+    fast_us = hal.scheduler->micros() - t0;
+    show_timing(PSTR("atan2"), libm_us, fast_us);
+
+    t0 = hal.scheduler->micros();
+    for (i=0; i<NUM_TIMING_CALLS; i++) {
+        sink = sinf(input(i, 10.0f));
+    }
+    libm_us = hal.scheduler->micros() - t0;
+    t0 = hal.scheduler->micros();
+    for (i=0; i<NUM_TIMING_CALLS; i++) {
+        sink = fast_sin(input(i, 10.0f));
+    }
+    fast_us = hal.scheduler->micros() - t0;
+    show_timing(PSTR("sin"), libm_us, fast_us);
+
+    t0 = hal.scheduler->micros();
+    for (i=0; i<NUM_TIMING_CALLS; i++) {
+        sink = 1.0f / sqrtf((i + 1) * 0.37f);
+    }
+    libm_us = hal.scheduler->micros() - t0;
+    t0 = hal.scheduler->micros();
+    for (i=0; i<NUM_TIMING_CALLS; i++) {
+        sink = fast_inv_sqrt((i + 1) * 0.37f);
+    }
+    fast_us = hal.scheduler->micros() - t0;
+    show_timing(PSTR("inv_sqrt"), libm_us, fast_us);
+
+    // the cost of generating the inputs, to subtract from the above
+    t0 = hal.scheduler->micros();
+    for (i=0; i<NUM_TIMING_CALLS; i++) {
+        sink = input(i * 7 + 3, 100.0f) + input(i, 100.0f);
+    }
+    fast_us = hal.scheduler->micros() - t0;
+    hal.console->printf_P(PSTR("loop overhead %.1fus\n"), fast_us / (float)NUM_TIMING_CALLS);
+}
+
+void setup(void)
+{
+    hal.console->println("fast math tests\n");
+    test_accuracy();
+    test_timing();
+    hal.console->println("tests done\n");
+}
+
+void loop(void){}
+
+AP_HAL_MAIN();
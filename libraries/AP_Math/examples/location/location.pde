@@ -41,9 +41,9 @@ static const struct {
 
 #define ARRAY_LENGTH(x) (sizeof((x))/sizeof((x)[0]))
 
-static struct Location location_from_point(Vector2f pt)
+static struct Position position_from_point(Vector2f pt)
 {
-    struct Location loc = {0};
+    struct Position loc = {0};
     loc.lat = pt.x * 1.0e7;
     loc.lng = pt.y * 1.0e7;
     return loc;
@@ -53,9 +53,9 @@ static void test_passed_waypoint(void)
 {
     hal.console->println("waypoint tests starting");
     for (uint8_t i=0; i<ARRAY_LENGTH(test_points); i++) {
-        struct Location loc = location_from_point(test_points[i].location);
-        struct Location wp1 = location_from_point(test_points[i].wp1);
-        struct Location wp2 = location_from_point(test_points[i].wp2);
+        struct Position loc = position_from_point(test_points[i].location);
+        struct Position wp1 = position_from_point(test_points[i].wp1);
+        struct Position wp2 = position_from_point(test_points[i].wp2);
         if (location_passed_point(loc, wp1, wp2) != test_points[i].passed) {
             hal.console->printf("Failed waypoint test %u\n", (unsigned)i);
             return;
@@ -64,11 +64,11 @@ static void test_passed_waypoint(void)
     hal.console->println("waypoint tests OK");
 }
 
-static void test_one_offset(const struct Location &loc,
+static void test_one_offset(const struct Position &loc,
                             float ofs_north, float ofs_east,
                             float dist, float bearing)
 {
-    struct Location loc2;
+    struct Position loc2;
     float dist2, bearing2;
 
     loc2 = loc;
@@ -103,7 +103,7 @@ static const struct {
 
 static void test_offset(void)
 {
-    struct Location loc;
+    struct Position loc;
 
     loc.lat = -35*1.0e7;
     loc.lng = 149*1.0e7;
@@ -0,0 +1,156 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+// approximate versions of the libm functions for the hot paths. The
+// maximum errors given in AP_Math.h are checked by the fast_math
+// example sketch, which also times them against libm
+
+#include "AP_Math.h"
+#include <AP_Progmem.h>
+
+// atan(0..1) to 1e-5, from Abramowitz and Stegun 4.4.49
+static float atan_unit(float v)
+{
+    float v2 = v*v;
+    return v*(0.9998660f + v2*(-0.3302995f + v2*(0.1801410f + v2*(-0.0851330f + v2*0.0208351f))));
+}
+
+// a faster varient of atan2. The argument is reduced to 0 ~ 1 and
+// the octant put back afterwards
+float fast_atan2(float y, float x)
+{
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float angle;
+
+    if (ax >= ay) {
+        if (ax == 0) {
+            // atan2(0,0) is 0 in libm too
+            return 0;
+        }
+        angle = atan_unit(ay / ax);
+    } else {
+        angle = M_PI_2 - atan_unit(ax / ay);
+    }
+    if (x < 0) {
+        angle = PI - angle;
+    }
+    if (y < 0) {
+        angle = -angle;
+    }
+    return angle;
+}
+
+#ifdef __AVR__
+// with no FPU a short table is cheaper than a polynomial. This is a
+// quarter wave of sin() in FAST_SIN_STEPS steps, interpolated linearly
+#define FAST_SIN_STEPS 64
+
+static const float sin_table[FAST_SIN_STEPS+1] PROGMEM = {
+    0.00000000f, 0.02454123f, 0.04906767f, 0.07356456f, 0.09801714f,
+    0.12241068f, 0.14673047f, 0.17096189f, 0.19509032f, 0.21910124f,
+    0.24298018f, 0.26671276f, 0.29028468f, 0.31368174f, 0.33688985f,
+    0.35989504f, 0.38268343f, 0.40524131f, 0.42755509f, 0.44961133f,
+    0.47139674f, 0.49289819f, 0.51410274f, 0.53499762f, 0.55557023f,
+    0.57580819f, 0.59569930f, 0.61523159f, 0.63439328f, 0.65317284f,
+    0.67155895f, 0.68954054f, 0.70710678f, 0.72424708f, 0.74095113f,
+    0.75720885f, 0.77301045f, 0.78834643f, 0.80320753f, 0.81758481f,
+    0.83146961f, 0.84485357f, 0.85772861f, 0.87008699f, 0.88192126f,
+    0.89322430f, 0.90398929f, 0.91420976f, 0.92387953f, 0.93299280f,
+    0.94154407f, 0.94952818f, 0.95694034f, 0.96377607f, 0.97003125f,
+    0.97570213f, 0.98078528f, 0.98527764f, 0.98917651f, 0.99247953f,
+    0.99518473f, 0.99729046f, 0.99879546f, 0.99969882f, 1.00000000f,
+};
+
+// sin() of an angle given in table steps, plus a whole number of
+// quarter turns so that cos() can share it
+static float sin_steps(float steps, uint8_t quarters)
+{
+    int32_t i = (int32_t)steps;
+    if (steps < i) {
+        // round towards minus infinity
+        i--;
+    }
+    float frac = steps - i;
+    uint8_t step = i & (FAST_SIN_STEPS-1);
+    // unsigned so negative steps divide towards minus infinity too
+    uint8_t quadrant = (((uint32_t)i / FAST_SIN_STEPS) + quarters) & 3;
+    float s0, s1;
+
+    if (quadrant & 1) {
+        // falling quarter, read the table backwards
+        s0 = pgm_read_float(&sin_table[FAST_SIN_STEPS - step]);
+        s1 = pgm_read_float(&sin_table[FAST_SIN_STEPS - step - 1]);
+    } else {
+        s0 = pgm_read_float(&sin_table[step]);
+        s1 = pgm_read_float(&sin_table[step + 1]);
+    }
+    float ret = s0 + (s1 - s0) * frac;
+    if (quadrant & 2) {
+        ret = -ret;
+    }
+    return ret;
+}
+
+float fast_sin(float x)
+{
+    return sin_steps(x * (FAST_SIN_STEPS / M_PI_2), 0);
+}
+
+float fast_cos(float x)
+{
+    return sin_steps(x * (FAST_SIN_STEPS / M_PI_2), 1);
+}
+
+// the well known bit level first guess, then two Newton-Raphson steps
+float fast_inv_sqrt(float x)
+{
+    if (x <= 0) {
+        return 0;
+    }
+    union {
+        float f;
+        int32_t i;
+    } u;
+    u.f = x;
+    u.i = 0x5f3759df - (u.i >> 1);
+    float half_x = 0.5f * x;
+    u.f *= 1.5f - half_x * u.f * u.f;
+    u.f *= 1.5f - half_x * u.f * u.f;
+    return u.f;
+}
+
+#else // __AVR__
+
+// with an FPU multiplies are cheap and table reads are not, so use a
+// polynomial. The argument is reduced to -pi/2 ~ pi/2 and the Taylor
+// series taken to x^9
+float fast_sin(float x)
+{
+    // nearest whole number of half turns
+    float n = x * (1.0f / PI);
+    int32_t half_turns = (int32_t)(n < 0 ? n - 0.5f : n + 0.5f);
+    x -= half_turns * PI;
+
+    float x2 = x * x;
+    float ret = x * (1.0f + x2 * (-1.0f/6 + x2 * (1.0f/120 + x2 * (-1.0f/5040 + x2 * (1.0f/362880)))));
+    if (half_turns & 1) {
+        ret = -ret;
+    }
+    return ret;
+}
+
+float fast_cos(float x)
+{
+    return fast_sin(x + M_PI_2);
+}
+
+// the FPU has a square root instruction, which beats any approximation
+float fast_inv_sqrt(float x)
+{
+    if (x <= 0) {
+        return 0;
+    }
+    return 1.0f / sqrtf(x);
+}
+
+#endif // __AVR__
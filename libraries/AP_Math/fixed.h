@@ -0,0 +1,196 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+//	This library is free software; you can redistribute it and / or
+//	modify it under the terms of the GNU Lesser General Public
+//	License as published by the Free Software Foundation; either
+//	version 2.1 of the License, or (at your option) any later version.
+
+// Fixed point numbers for use as the element type of Vector3 and
+// Matrix3 on CPUs without floating point hardware.
+//
+// A Fixed<FRAC> holds a signed 32 bit value with FRAC fraction bits.
+// Fixed30 (Q2.30) covers -2 to 2 with a resolution of about 1e-9 and
+// suits rotation matrices and small angles. Fixed16 (Q16.16) covers
+// -32768 to 32768 and suits sensor values such as accelerations.
+//
+// Products are truncated towards minus infinity and saturate at the
+// limits of the result type instead of wrapping. Sums do not check for
+// overflow, so keep the operands within range.
+
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+// INT32_MAX and friends need __STDC_LIMIT_MACROS in C++
+#define FIXED_RAW_MAX ((int32_t)0x7FFFFFFF)
+#define FIXED_RAW_MIN (-FIXED_RAW_MAX - 1)
+
+// (a * b) >> SHIFT, saturated to 32 bits
+template <uint8_t SHIFT>
+static inline int32_t fixed_mul_raw(int32_t a, int32_t b)
+{
+#ifdef __AVR__
+    // a 64 bit multiply is a library call costing more than a float
+    // multiply on the 8 bit CPUs, so build the product from the four
+    // 16 bit partial products, which map onto the hardware multiplier
+    int16_t ah = a >> 16, bh = b >> 16;
+    uint16_t al = a, bl = b;
+    int32_t hh = (int32_t)ah * bh;
+    int32_t x = (int32_t)ah * bl;
+    int32_t y = (int32_t)bh * al;
+    uint32_t ll = (uint32_t)al * bl;
+
+    // add the middle terms into the top 32 bits, carrying out of
+    // their low halves
+    uint32_t s = (uint16_t)x + (uint32_t)(uint16_t)y + (ll >> 16);
+    int32_t hi = hh + (x >> 16) + (y >> 16) + (int32_t)(s >> 16);
+    uint32_t lo = (s << 16) | (uint16_t)ll;
+
+    if (hi >= ((int32_t)1 << (SHIFT-1))) {
+        return FIXED_RAW_MAX;
+    }
+    if (hi < -((int32_t)1 << (SHIFT-1))) {
+        return FIXED_RAW_MIN;
+    }
+    return (int32_t)(((uint32_t)hi << (32-SHIFT)) + (lo >> SHIFT));
+#else
+    int64_t p = ((int64_t)a * b) >> SHIFT;
+    if (p > FIXED_RAW_MAX) {
+        return FIXED_RAW_MAX;
+    }
+    if (p < FIXED_RAW_MIN) {
+        return FIXED_RAW_MIN;
+    }
+    return (int32_t)p;
+#endif
+}
+
+template <uint8_t FRAC>
+class Fixed
+{
+public:
+    // uninitialised, like a float
+    Fixed() {
+    }
+
+    // from an integer. Lets Vector3 and Matrix3 use 0 and 1
+    Fixed(int i) : _v((int32_t)i << FRAC) {
+    }
+
+    // from a float, saturating at the limits of the range
+    Fixed(float f) {
+        f *= (float)((uint32_t)1 << FRAC);
+        if (f >= 2147483647.0f) {
+            _v = FIXED_RAW_MAX;
+        } else if (f <= -2147483648.0f) {
+            _v = FIXED_RAW_MIN;
+        } else {
+            _v = (int32_t)f;
+        }
+    }
+
+    static Fixed from_raw(int32_t v) {
+        Fixed r;
+        r._v = v;
+        return r;
+    }
+
+    int32_t raw(void) const {
+        return _v;
+    }
+
+    float to_float(void) const {
+        return _v * (1.0f / (float)((uint32_t)1 << FRAC));
+    }
+
+    Fixed operator +(const Fixed &v) const {
+        return from_raw(_v + v._v);
+    }
+    Fixed operator -(const Fixed &v) const {
+        return from_raw(_v - v._v);
+    }
+    Fixed operator -(void) const {
+        return from_raw(-_v);
+    }
+    Fixed &operator +=(const Fixed &v) {
+        _v += v._v;
+        return *this;
+    }
+    Fixed &operator -=(const Fixed &v) {
+        _v -= v._v;
+        return *this;
+    }
+
+    // divide by a power of two
+    Fixed operator >>(uint8_t n) const {
+        return from_raw(_v >> n);
+    }
+
+    // the result has the format of the right hand side, so a Fixed30
+    // rotation times a Fixed16 acceleration is a Fixed16 acceleration
+    template <uint8_t FRAC2>
+    Fixed<FRAC2> operator *(const Fixed<FRAC2> &v) const {
+        return Fixed<FRAC2>::from_raw(fixed_mul_raw<FRAC>(_v, v.raw()));
+    }
+    Fixed &operator *=(const Fixed &v) {
+        return *this = *this * v;
+    }
+
+    bool operator ==(const Fixed &v) const {
+        return _v == v._v;
+    }
+    bool operator !=(const Fixed &v) const {
+        return _v != v._v;
+    }
+    bool operator <(const Fixed &v) const {
+        return _v < v._v;
+    }
+    bool operator >(const Fixed &v) const {
+        return _v > v._v;
+    }
+
+private:
+    int32_t _v;
+};
+
+typedef Fixed<16>                       Fixed16;
+typedef Fixed<30>                       Fixed30;
+typedef Vector3<Fixed16>                Vector3q16;
+typedef Vector3<Fixed30>                Vector3q30;
+typedef Matrix3<Fixed30>                Matrix3q30;
+
+// multiply a Fixed30 matrix, such as a rotation, by a vector of any
+// fixed point format, giving a result in the vector's format
+template <uint8_t FRAC>
+static inline Vector3<Fixed<FRAC> > fixed_mul(const Matrix3q30 &m, const Vector3<Fixed<FRAC> > &v)
+{
+    return Vector3<Fixed<FRAC> >(m.a.x * v.x + m.a.y * v.y + m.a.z * v.z,
+                                 m.b.x * v.x + m.b.y * v.y + m.b.z * v.z,
+                                 m.c.x * v.x + m.c.y * v.y + m.c.z * v.z);
+}
+
+// conversions to and from float vectors and matrices
+template <uint8_t FRAC>
+static inline Vector3<Fixed<FRAC> > to_fixed(const Vector3f &v)
+{
+    return Vector3<Fixed<FRAC> >(v.x, v.y, v.z);
+}
+
+template <uint8_t FRAC>
+static inline Vector3f to_float(const Vector3<Fixed<FRAC> > &v)
+{
+    return Vector3f(v.x.to_float(), v.y.to_float(), v.z.to_float());
+}
+
+static inline Matrix3q30 to_fixed(const Matrix3f &m)
+{
+    return Matrix3q30(to_fixed<30>(m.a), to_fixed<30>(m.b), to_fixed<30>(m.c));
+}
+
+static inline Matrix3f to_float(const Matrix3q30 &m)
+{
+    return Matrix3f(to_float(m.a), to_float(m.b), to_float(m.c));
+}
+
+#endif // FIXED_H
@@ -0,0 +1,22 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include "AP_Math.h"
+
+// only a change of latitude needs a new cos()
+void LocalFrame::set_origin(int32_t lat, int32_t lng)
+{
+    if (lat != _lat) {
+        _scale_down = cosf(radians(labs(lat) * 1.0e-7f));
+        _scale_up = 1.0f / _scale_down;
+    }
+    _lat = lat;
+    _lng = lng;
+}
+
+Vector2f LocalFrame::rebase(int32_t lat, int32_t lng)
+{
+    // measured in the old frame, as that is the one the offsets are in
+    Vector2f shift = location_to_ne_cm(lat, lng);
+    set_origin(lat, lng);
+    return shift;
+}
@@ -0,0 +1,75 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+//	This library is free software; you can redistribute it and / or
+//	modify it under the terms of the GNU Lesser General Public
+//	License as published by the Free Software Foundation; either
+//	version 2.1 of the License, or (at your option) any later version.
+
+// A flat local frame around an origin such as home or a waypoint, for
+// converting locations to and from offsets in cm north and east.
+//
+// The longitude scaling, cos() of the origin's latitude, is worked out
+// when the origin moves to a new latitude and kept, so each conversion
+// is a couple of multiplies. Like the rest of the location code this
+// does not take account of the curvature of the earth, so keep to
+// within a few tens of km of the origin.
+//
+// The origin is held exactly as integers, and a location is converted
+// by differencing the integers before anything becomes a float, so the
+// precision of an offset depends on its size, not on where the origin
+// is. On a long flight the origin can be moved nearer the vehicle with
+// rebase(), which returns the shift to apply to the offsets already
+// held, so they describe the same places as before.
+
+#ifndef LOCAL_FRAME_H
+#define LOCAL_FRAME_H
+
+class LocalFrame
+{
+public:
+    LocalFrame() : _lat(0), _lng(0), _scale_down(1), _scale_up(1) {
+    }
+
+    // move the origin. Cheap if it has not changed
+    void set_origin(int32_t lat, int32_t lng);
+    void set_origin(const struct Position &loc) {
+        set_origin(loc.lat, loc.lng);
+    }
+
+    // move the origin to lat, lng, returning where the new origin was in
+    // cm north and east of the old one. Offsets from the old origin are
+    // offsets from the new one once this is taken away from them
+    Vector2f rebase(int32_t lat, int32_t lng);
+
+    int32_t get_origin_lat() const { return _lat; }
+    int32_t get_origin_lng() const { return _lng; }
+
+    // the factor which shrinks a longitude difference to a distance
+    // at the origin's latitude, and its inverse
+    float get_scale_down() const { return _scale_down; }
+    float get_scale_up() const { return _scale_up; }
+
+    // offset of a location from the origin in cm north and east
+    Vector2f location_to_ne_cm(int32_t lat, int32_t lng) const {
+        return Vector2f((lat - _lat) * LATLON_TO_CM,
+                        (lng - _lng) * LATLON_TO_CM * _scale_down);
+    }
+    Vector2f location_to_ne_cm(const struct Position &loc) const {
+        return location_to_ne_cm(loc.lat, loc.lng);
+    }
+
+    // latitude and longitude of an offset in cm north and east of the origin
+    int32_t ne_cm_to_lat(const Vector2f &ne) const {
+        return _lat + (int32_t)(ne.x * (1.0f / LATLON_TO_CM));
+    }
+    int32_t ne_cm_to_lng(const Vector2f &ne) const {
+        return _lng + (int32_t)(ne.y * (1.0f / LATLON_TO_CM) * _scale_up);
+    }
+
+private:
+    int32_t     _lat, _lng;             // origin in degrees * 1e7
+    float       _scale_down;            // cos(origin latitude)
+    float       _scale_up;              // 1 / _scale_down
+};
+
+#endif // LOCAL_FRAME_H
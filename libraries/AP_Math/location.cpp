@@ -18,7 +18,7 @@
  */
 
 /*
- *  this module deals with calculations involving struct Location
+ *  this module deals with calculations involving struct Position
  */
 #include <stdlib.h>
 #include "AP_Math.h"
@@ -26,7 +26,7 @@
 // radius of earth in meters
 #define RADIUS_OF_EARTH 6378100
 
-float longitude_scale(const struct Location *loc)
+float longitude_scale(const struct Position *loc)
 {
     static int32_t last_lat;
     static float scale = 1.0;
@@ -44,7 +44,7 @@ float longitude_scale(const struct Location *loc)
 
 
 // return distance in meters between two locations
-float get_distance(const struct Location *loc1, const struct Location *loc2)
+float get_distance(const struct Position *loc1, const struct Position *loc2)
 {
     float dlat              = (float)(loc2->lat - loc1->lat);
     float dlong             = ((float)(loc2->lng - loc1->lng)) * longitude_scale(loc2);
@@ -52,13 +52,13 @@ float get_distance(const struct Location *loc1, const struct Location *loc2)
 }
 
 // return distance in centimeters to between two locations
-uint32_t get_distance_cm(const struct Location *loc1, const struct Location *loc2)
+uint32_t get_distance_cm(const struct Position *loc1, const struct Position *loc2)
 {
     return get_distance(loc1, loc2) * 100;
 }
 
 // return bearing in centi-degrees between two locations
-int32_t get_bearing_cd(const struct Location *loc1, const struct Location *loc2)
+int32_t get_bearing_cd(const struct Position *loc1, const struct Position *loc2)
 {
     int32_t off_x = loc2->lng - loc1->lng;
     int32_t off_y = (loc2->lat - loc1->lat) / longitude_scale(loc2);
@@ -72,9 +72,9 @@ int32_t get_bearing_cd(const struct Location *loc1, const struct Location *loc2)
 // our previous waypoint and point2 is our target waypoint
 // then this function returns true if we have flown past
 // the target waypoint
-bool location_passed_point(const struct Location &location,
-                           const struct Location &point1,
-                           const struct Location &point2)
+bool location_passed_point(const struct Position &location,
+                           const struct Position &point1,
+                           const struct Position &point2)
 {
     // the 3 points form a triangle. If the angle between lines
     // point1->point2 and location->point2 is greater than 90
@@ -112,7 +112,7 @@ bool location_passed_point(const struct Location &location,
  *
  *  This function is precise, but costs about 1.7 milliseconds on an AVR2560
  */
-void location_update(struct Location *loc, float bearing, float distance)
+void location_update(struct Position *loc, float bearing, float distance)
 {
     float lat1 = radians(loc->lat*1.0e-7f);
     float lon1 = radians(loc->lng*1.0e-7f);
@@ -131,7 +131,7 @@ void location_update(struct Location *loc, float bearing, float distance)
  *  extrapolate latitude/longitude given distances north and east
  *  This function costs about 80 usec on an AVR2560
  */
-void location_offset(struct Location *loc, float ofs_north, float ofs_east)
+void location_offset(struct Position *loc, float ofs_north, float ofs_east)
 {
     if (ofs_north != 0 || ofs_east != 0) {
         float dlat = ofs_north * 89.831520982f;
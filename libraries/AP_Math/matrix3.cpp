@@ -175,22 +175,21 @@ void Matrix3<T>::to_euler(float *roll, float *pitch, float *yaw)
 }
 
 // apply an additional rotation from a body frame gyro vector
-// to a rotation matrix.
+// to a rotation matrix. Each row only depends on its old self, so
+// the rows are updated in place rather than through a temporary matrix
 template <typename T>
 void Matrix3<T>::rotate(const Vector3<T> &g)
 {
-    Matrix3f temp_matrix;
-    temp_matrix.a.x = a.y * g.z - a.z * g.y;
-    temp_matrix.a.y = a.z * g.x - a.x * g.z;
-    temp_matrix.a.z = a.x * g.y - a.y * g.x;
-    temp_matrix.b.x = b.y * g.z - b.z * g.y;
-    temp_matrix.b.y = b.z * g.x - b.x * g.z;
-    temp_matrix.b.z = b.x * g.y - b.y * g.x;
-    temp_matrix.c.x = c.y * g.z - c.z * g.y;
-    temp_matrix.c.y = c.z * g.x - c.x * g.z;
-    temp_matrix.c.z = c.x * g.y - c.y * g.x;
-
-    (*this) += temp_matrix;
+    Vector3<T> *rows[3] = { &a, &b, &c };
+    for (uint8_t i=0; i<3; i++) {
+        Vector3<T> &r = *rows[i];
+        T dx = r.y * g.z - r.z * g.y;
+        T dy = r.z * g.x - r.x * g.z;
+        T dz = r.x * g.y - r.y * g.x;
+        r.x += dx;
+        r.y += dy;
+        r.z += dz;
+    }
 }
 
 // apply an additional rotation from a body frame gyro vector
@@ -198,18 +197,16 @@ void Matrix3<T>::rotate(const Vector3<T> &g)
 template <typename T>
 void Matrix3<T>::rotateXY(const Vector3<T> &g)
 {
-    Matrix3f temp_matrix;
-    temp_matrix.a.x = -a.z * g.y;
-    temp_matrix.a.y = a.z * g.x;
-    temp_matrix.a.z = a.x * g.y - a.y * g.x;
-    temp_matrix.b.x = -b.z * g.y;
-    temp_matrix.b.y = b.z * g.x;
-    temp_matrix.b.z = b.x * g.y - b.y * g.x;
-    temp_matrix.c.x = -c.z * g.y;
-    temp_matrix.c.y = c.z * g.x;
-    temp_matrix.c.z = c.x * g.y - c.y * g.x;
-
-    (*this) += temp_matrix;
+    Vector3<T> *rows[3] = { &a, &b, &c };
+    for (uint8_t i=0; i<3; i++) {
+        Vector3<T> &r = *rows[i];
+        T dx = -r.z * g.y;
+        T dy = r.z * g.x;
+        T dz = r.x * g.y - r.y * g.x;
+        r.x += dx;
+        r.y += dy;
+        r.z += dz;
+    }
 }
 
 // multiplication by a vector
@@ -238,6 +235,24 @@ Vector3<T> Matrix3<T>::mul_transpose(const Vector3<T> &v) const
                       a.z * v.x + b.z * v.y + c.z * v.z);
 }
 
+// out += (*this * v) * k
+template <typename T>
+void Matrix3<T>::multiply_add(const Vector3<T> &v, const T k, Vector3<T> &out) const
+{
+    out.x += (a.x * v.x + a.y * v.y + a.z * v.z) * k;
+    out.y += (b.x * v.x + b.y * v.y + b.z * v.z) * k;
+    out.z += (c.x * v.x + c.y * v.y + c.z * v.z) * k;
+}
+
+// out += (transpose * v) * k
+template <typename T>
+void Matrix3<T>::transpose_multiply_add(const Vector3<T> &v, const T k, Vector3<T> &out) const
+{
+    out.x += (a.x * v.x + b.x * v.y + c.x * v.z) * k;
+    out.y += (a.y * v.x + b.y * v.y + c.y * v.z) * k;
+    out.z += (a.z * v.x + b.z * v.y + c.z * v.z) * k;
+}
+
 // multiplication by another Matrix3<T>
 template <typename T>
 Matrix3<T> Matrix3<T>::operator *(const Matrix3<T> &m) const
@@ -280,6 +295,12 @@ template void Matrix3<float>::from_euler(float roll, float pitch, float yaw);
 template void Matrix3<float>::to_euler(float *roll, float *pitch, float *yaw);
 template Vector3<float> Matrix3<float>::operator *(const Vector3<float> &v) const;
 template Vector3<float> Matrix3<float>::mul_transpose(const Vector3<float> &v) const;
+template void Matrix3<float>::multiply_add(const Vector3<float> &v, const float k, Vector3<float> &out) const;
+template void Matrix3<float>::transpose_multiply_add(const Vector3<float> &v, const float k, Vector3<float> &out) const;
 template Matrix3<float> Matrix3<float>::operator *(const Matrix3<float> &m) const;
 template Matrix3<float> Matrix3<float>::transposed(void) const;
 template Vector2<float> Matrix3<float>::mulXY(const Vector3<float> &v) const;
+
+// and for the fixed point DCM on the 8 bit boards
+template void Matrix3<Fixed30>::rotate(const Vector3<Fixed30> &g);
+template void Matrix3<Fixed30>::rotateXY(const Vector3<Fixed30> &g);
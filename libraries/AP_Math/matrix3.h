@@ -122,6 +122,13 @@ public:
     // multiplication of transpose by a vector
     Vector3<T>                  mul_transpose(const Vector3<T> &v) const;
 
+    // add the product with a vector scaled by k to out, without the
+    // temporaries of out += (*this * v) * k
+    void                        multiply_add(const Vector3<T> &v, const T k, Vector3<T> &out) const;
+
+    // as multiply_add(), with the transpose, which is not formed
+    void                        transpose_multiply_add(const Vector3<T> &v, const T k, Vector3<T> &out) const;
+
     // multiplication by a vector giving a Vector2 result (XY components)
     Vector2<T> mulXY(const Vector3<T> &v) const;
 
@@ -187,10 +194,10 @@ public:
 
     // apply an additional rotation from a body frame gyro vector
     // to a rotation matrix.
-    void        rotate(const Vector3<T> &g);
-
-    // apply an additional rotation from a body frame gyro vector
-    // to a rotation matrix but only use X, Y elements from gyro vector
+    void        rotate(const Vector3<T> &g);
+
+    // apply an additional rotation from a body frame gyro vector
+    // to a rotation matrix but only use X, Y elements from gyro vector
     void        rotateXY(const Vector3<T> &g);
 };
 
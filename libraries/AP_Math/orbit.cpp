@@ -0,0 +1,62 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include "AP_Math.h"
+
+Orbit::Orbit() :
+    _offset(0, 0),
+    _radius(0),
+    _step(0),
+    _cos_step(1),
+    _sin_step(0),
+    _steps(0)
+{
+}
+
+void Orbit::start(float radius, float angle)
+{
+    _radius = radius;
+    _offset.x = radius * cosf(angle);
+    _offset.y = radius * sinf(angle);
+    _steps = 0;
+}
+
+void Orbit::set_radius(float radius)
+{
+    if (radius != _radius) {
+        _radius = radius;
+        _normalise();
+    }
+}
+
+void Orbit::advance(float angle)
+{
+    if (angle != _step) {
+        _step = angle;
+        if (fabsf(angle) <= ORBIT_SERIES_MAX_STEP) {
+            // series to the 5th power of the angle, good to a few parts in 1e5
+            float a2 = angle * angle;
+            _cos_step = 1.0f - a2 * 0.5f * (1.0f - a2 * (1.0f/12.0f));
+            _sin_step = angle * (1.0f - a2 * (1.0f/6.0f) * (1.0f - a2 * 0.05f));
+        } else {
+            _cos_step = cosf(angle);
+            _sin_step = sinf(angle);
+        }
+    }
+
+    float x = _offset.x;
+    _offset.x = x * _cos_step - _offset.y * _sin_step;
+    _offset.y = x * _sin_step + _offset.y * _cos_step;
+
+    if (++_steps >= ORBIT_NORMALISE_STEPS) {
+        _normalise();
+    }
+}
+
+void Orbit::_normalise()
+{
+    _steps = 0;
+    float length = _offset.length();
+    if (length > 0) {
+        _offset *= fabsf(_radius) / length;
+    }
+}
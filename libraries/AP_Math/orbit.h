@@ -0,0 +1,54 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+//	This library is free software; you can redistribute it and / or
+//	modify it under the terms of the GNU Lesser General Public
+//	License as published by the Free Software Foundation; either
+//	version 2.1 of the License, or (at your option) any later version.
+
+// A point going round a circle, for the targets of orbits.
+//
+// The point is kept as its offset from the centre and moved by
+// rotating the offset, so only start() needs trig. The rotation for a
+// step is worked out from a short series, and kept while the steps
+// are the same size. Rounding slowly changes the length of the offset,
+// so every ORBIT_NORMALISE_STEPS steps it is scaled back to the radius.
+// Each step is however large the caller asks, so the speed round the
+// circle doesn't depend on how often it is stepped.
+
+#ifndef ORBIT_H
+#define ORBIT_H
+
+#define ORBIT_NORMALISE_STEPS   16
+#define ORBIT_SERIES_MAX_STEP   0.5f    // larger steps, in radians, use sinf() and cosf()
+
+class Orbit
+{
+public:
+    Orbit();
+
+    // start at angle radians round a circle of radius. The offset is
+    // radius * (cos(angle), sin(angle))
+    void start(float radius, float angle);
+
+    // change the radius, keeping the angle
+    void set_radius(float radius);
+    float radius() const { return _radius; }
+
+    // move round by angle radians, positive from x towards y
+    void advance(float angle);
+
+    // where the point is, from the centre
+    const Vector2f &offset() const { return _offset; }
+
+private:
+    void _normalise();
+
+    Vector2f _offset;
+    float    _radius;
+    float    _step;                             // the angle of the rotation below
+    float    _cos_step;
+    float    _sin_step;
+    uint8_t  _steps;                            // since the last normalise
+};
+
+#endif // ORBIT_H
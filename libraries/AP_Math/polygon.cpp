@@ -35,6 +35,42 @@
  *  expect that to be very small over the distances involved in the
  *  fence boundary
  */
+/*
+ *  test if a horizontal line to the right of P crosses the edge
+ *  V[i] to V[j]. Only valid for edges which span P.y
+ */
+static bool Polygon_edge_crossed(const Vector2l &P, const Vector2l &Vi, const Vector2l &Vj)
+{
+    int32_t dx1, dx2, dy1, dy2;
+    dx1 = P.x - Vi.x;
+    dx2 = Vj.x - Vi.x;
+    dy1 = P.y - Vi.y;
+    dy2 = Vj.y - Vi.y;
+    int8_t dx1s, dx2s, dy1s, dy2s, m1, m2;
+#define sign(x) ((x)<0 ? -1 : 1)
+    dx1s = sign(dx1);
+    dx2s = sign(dx2);
+    dy1s = sign(dy1);
+    dy2s = sign(dy2);
+    m1 = dx1s * dy2s;
+    m2 = dx2s * dy1s;
+    // we avoid the 64 bit multiplies if we can based on sign checks.
+    if (dy2 < 0) {
+        if (m1 > m2) {
+            return true;
+        } else if (m1 < m2) {
+            return false;
+        }
+        return dx1 * (int64_t)dy2 > dx2 * (int64_t)dy1;
+    }
+    if (m1 < m2) {
+        return true;
+    } else if (m1 > m2) {
+        return false;
+    }
+    return dx1 * (int64_t)dy2 < dx2 * (int64_t)dy1;
+}
+
 bool Polygon_outside(const Vector2l &P, const Vector2l *V, unsigned n)
 {
     unsigned i, j;
@@ -43,36 +79,8 @@ bool Polygon_outside(const Vector2l &P, const Vector2l *V, unsigned n)
         if ((V[i].y > P.y) == (V[j].y > P.y)) {
             continue;
         }
-        int32_t dx1, dx2, dy1, dy2;
-        dx1 = P.x - V[i].x;
-        dx2 = V[j].x - V[i].x;
-        dy1 = P.y - V[i].y;
-        dy2 = V[j].y - V[i].y;
-        int8_t dx1s, dx2s, dy1s, dy2s, m1, m2;
-#define sign(x) ((x)<0 ? -1 : 1)
-        dx1s = sign(dx1);
-        dx2s = sign(dx2);
-        dy1s = sign(dy1);
-        dy2s = sign(dy2);
-        m1 = dx1s * dy2s;
-        m2 = dx2s * dy1s;
-        // we avoid the 64 bit multiplies if we can based on sign checks.
-        if (dy2 < 0) {
-            if (m1 > m2) {
-                outside = !outside;
-            } else if (m1 < m2) {
-                continue;
-            } else if ( dx1 * (int64_t)dy2 > dx2 * (int64_t)dy1 ) {
-                outside = !outside;
-            }
-        } else {
-            if (m1 < m2) {
-                outside = !outside;
-            } else if (m1 > m2) {
-                continue;
-            } else if ( dx1 * (int64_t)dy2 < dx2 * (int64_t)dy1 ) {
-                outside = !outside;
-            }
+        if (Polygon_edge_crossed(P, V[i], V[j])) {
+            outside = !outside;
         }
     }
     return outside;
@@ -89,3 +97,87 @@ bool Polygon_complete(const Vector2l *V, unsigned n)
 {
     return (n >= 4 && V[n-1].x == V[0].x && V[n-1].y == V[0].y);
 }
+
+/*
+ *  PolygonFence: set up a polygon for repeated tests
+ */
+void PolygonFence::set(const Vector2l *V, uint8_t n)
+{
+    _V = V;
+    _n = n;
+    _band_valid = false;
+    if (n == 0) {
+        return;
+    }
+    _min = _max = V[0];
+    for (uint8_t i = 1; i < n; i++) {
+        if (V[i].x < _min.x) _min.x = V[i].x;
+        if (V[i].x > _max.x) _max.x = V[i].x;
+        if (V[i].y < _min.y) _min.y = V[i].y;
+        if (V[i].y > _max.y) _max.y = V[i].y;
+    }
+}
+
+/*
+ *  find the band between vertex y values that P is in, and the edges
+ *  which cross it. For any y in the band the vertices above it are
+ *  the same ones, so the set of edges Polygon_outside() tests is too
+ */
+void PolygonFence::update_band(const Vector2l &P)
+{
+    uint8_t i, j;
+
+    // the band is inside the bounding box, which P.y is in
+    _band_low = _min.y;
+    _band_high = _max.y;
+    for (i = 0; i < _n; i++) {
+        int32_t y = _V[i].y;
+        if (y <= P.y) {
+            if (y > _band_low) _band_low = y;
+        } else {
+            if (y < _band_high) _band_high = y;
+        }
+    }
+
+    _num_band_edges = 0;
+    _band_edges_full = false;
+    for (i = 0, j = _n-1; i < _n; j = i++) {
+        if ((_V[i].y > P.y) == (_V[j].y > P.y)) {
+            continue;
+        }
+        if (_num_band_edges == POLYGON_FENCE_BAND_EDGES) {
+            _band_edges_full = true;
+            break;
+        }
+        _band_edges[_num_band_edges++] = i;
+    }
+    _band_valid = true;
+}
+
+bool PolygonFence::outside(const Vector2l &P)
+{
+    if (_n == 0 ||
+        P.x < _min.x || P.x > _max.x ||
+        P.y < _min.y || P.y >= _max.y) {
+        // no vertex is above P.y at the top of the box, so no edge
+        // spans it and Polygon_outside() would say outside too
+        return true;
+    }
+
+    if (!_band_valid || P.y < _band_low || P.y >= _band_high) {
+        update_band(P);
+    }
+    if (_band_edges_full) {
+        return Polygon_outside(P, _V, _n);
+    }
+
+    bool outside = true;
+    for (uint8_t k = 0; k < _num_band_edges; k++) {
+        uint8_t i = _band_edges[k];
+        uint8_t j = (i == 0) ? _n-1 : i-1;
+        if (Polygon_edge_crossed(P, _V[i], _V[j])) {
+            outside = !outside;
+        }
+    }
+    return outside;
+}
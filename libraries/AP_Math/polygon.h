@@ -20,3 +20,52 @@
 bool        Polygon_outside(const Vector2l &P, const Vector2l *V, unsigned n);
 bool        Polygon_complete(const Vector2l *V, unsigned n);
 
+// the most edges a PolygonFence remembers for one band
+#define POLYGON_FENCE_BAND_EDGES 8
+
+/*
+ *  a polygon prepared for repeated Polygon_outside() tests of a point
+ *  which moves a little between calls, such as a vehicle against its
+ *  fence.
+ *
+ *  Points outside the bounding box are rejected straight away. Points
+ *  inside it are tested against the edges which cross the horizontal
+ *  band between two vertex y values that the last point was in. Until
+ *  the point leaves that band no other edge can change the answer, so
+ *  most tests look at two or four edges rather than all of them
+ */
+class PolygonFence
+{
+public:
+    PolygonFence() : _V(NULL), _n(0) {
+    }
+
+    // use the n vertices in V[], with V[n-1]==V[0] as for
+    // Polygon_outside(). V[] is not copied, so must stay valid, and
+    // set() must be called again if it changes
+    void        set(const Vector2l *V, uint8_t n);
+
+    // the same result as Polygon_outside(P, V, n)
+    bool        outside(const Vector2l &P);
+
+    // bounding box of the vertices
+    const Vector2l &get_min() const { return _min; }
+    const Vector2l &get_max() const { return _max; }
+
+private:
+    void        update_band(const Vector2l &P);
+
+    const Vector2l *_V;
+    uint8_t     _n;
+    Vector2l    _min, _max;                     // bounding box
+
+    // edges crossing the band _band_low <= y < _band_high. If there
+    // are too many to remember _band_edges_full is set and all edges
+    // are tested while the point stays in the band
+    int32_t     _band_low, _band_high;
+    bool        _band_valid;
+    bool        _band_edges_full;
+    uint8_t     _num_band_edges;
+    uint8_t     _band_edges[POLYGON_FENCE_BAND_EDGES];
+};
+
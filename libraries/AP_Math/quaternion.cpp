@@ -87,3 +87,63 @@ void Quaternion::to_euler(float *roll, float *pitch, float *yaw)
                       1 - 2.0f*(q3*q3 + q4*q4));
     }
 }
+
+// apply an additional rotation from a body frame rotation vector.
+// The rotation quaternion uses second order series for the cos and
+// sin of the half angle, which is accurate to well under a
+// microradian for the angles seen between updates and needs no trig
+void Quaternion::rotate(const Vector3f &v)
+{
+    float theta_sq = v.x*v.x + v.y*v.y + v.z*v.z;
+    float r1 = 1.0f - theta_sq * (1.0f/8);
+    float rs = 0.5f - theta_sq * (1.0f/48);
+    float r2 = v.x * rs;
+    float r3 = v.y * rs;
+    float r4 = v.z * rs;
+
+    float t1 = q1*r1 - q2*r2 - q3*r3 - q4*r4;
+    float t2 = q1*r2 + q2*r1 + q3*r4 - q4*r3;
+    float t3 = q1*r3 - q2*r4 + q3*r1 + q4*r2;
+    float t4 = q1*r4 + q2*r3 - q3*r2 + q4*r1;
+    q1 = t1; q2 = t2; q3 = t3; q4 = t4;
+}
+
+// the rotation from q to this quaternion is the vector part of
+// conj(q) * this, which is the sine of the half angle times the
+// axis. The angle comes from a series for asin(), to the same order
+// as rotate() uses
+Vector3f Quaternion::rotation_from(const Quaternion &q) const
+{
+    float d1 = q.q1*q1 + q.q2*q2 + q.q3*q3 + q.q4*q4;
+    float d2 = q.q1*q2 - q.q2*q1 - q.q3*q4 + q.q4*q3;
+    float d3 = q.q1*q3 + q.q2*q4 - q.q3*q1 - q.q4*q2;
+    float d4 = q.q1*q4 - q.q2*q3 + q.q3*q2 - q.q4*q1;
+
+    float sin_sq = d2*d2 + d3*d3 + d4*d4;
+    float scale = 2.0f + sin_sq * (1.0f/3);
+
+    // q and -q are the same attitude, so take the short way round
+    if (d1 < 0) {
+        scale = -scale;
+    }
+    return Vector3f(d2 * scale, d3 * scale, d4 * scale);
+}
+
+// the length of the quaternion
+float Quaternion::length(void) const
+{
+    return sqrtf(q1*q1 + q2*q2 + q3*q3 + q4*q4);
+}
+
+// scale to unit length
+void Quaternion::normalize(void)
+{
+    float len = length();
+    if (len != 0.0f) {
+        float inv = 1.0f / len;
+        q1 *= inv;
+        q2 *= inv;
+        q3 *= inv;
+        q4 *= inv;
+    }
+}
@@ -51,5 +51,21 @@ public:
 
     // create eulers from a quaternion
     void        to_euler(float *roll, float *pitch, float *yaw);
+
+    // apply an additional rotation from a body frame rotation
+    // vector, in radians. This is the quaternion equivalent of
+    // Matrix3f::rotate()
+    void        rotate(const Vector3f &v);
+
+    // the body frame rotation vector, in radians, that takes q to
+    // this quaternion. The inverse of rotate() for the small
+    // rotations seen between updates
+    Vector3f    rotation_from(const Quaternion &q) const;
+
+    // the length of the quaternion, 1 for a pure rotation
+    float       length(void) const;
+
+    // scale to unit length
+    void        normalize(void);
 };
 #endif // QUATERNION_H
@@ -0,0 +1,74 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include "AP_Math.h"
+
+SensorVote::SensorVote(float max_error, uint32_t timeout_us) :
+    _max_error_sq(max_error * max_error),
+    _timeout_us(timeout_us),
+    _count(0),
+    _primary(0),
+    _fresh(0)
+{
+}
+
+void SensorVote::set_count(uint8_t count, uint32_t now_us)
+{
+    _count = min(count, SENSOR_VOTE_MAX_INSTANCES);
+    _primary = 0;
+    _fresh = 0;
+    for (uint8_t i=0; i<_count; i++) {
+        _score[i] = SENSOR_VOTE_SCORE_MAX;
+        _last_us[i] = now_us;
+    }
+}
+
+void SensorVote::sample(uint8_t instance, const Vector3f &v, uint32_t now_us)
+{
+    _last[instance] = v;
+    _last_us[instance] = now_us;
+    _fresh |= 1U<<instance;
+}
+
+void SensorVote::update(uint32_t now_us)
+{
+    for (uint8_t i=0; i<_count; i++) {
+        if (_timed_out(i, now_us)) {
+            _score[i] = 0;
+            continue;
+        }
+        if (!(_fresh & (1U<<i))) {
+            continue;
+        }
+
+        // an instance is only outvoted if there are at least two
+        // others to compare with, and it agrees with neither
+        uint8_t compared = 0, agreed = 0;
+        for (uint8_t j=0; j<_count; j++) {
+            if (j == i || _timed_out(j, now_us)) {
+                continue;
+            }
+            compared++;
+            if ((_last[i] - _last[j]).length_squared() <= _max_error_sq) {
+                agreed++;
+            }
+        }
+        if (compared < 2 || agreed > 0) {
+            if (_score[i] < SENSOR_VOTE_SCORE_MAX) {
+                _score[i] += SENSOR_VOTE_SCORE_GAIN;
+            }
+        } else if (_score[i] > SENSOR_VOTE_SCORE_LOSS) {
+            _score[i] -= SENSOR_VOTE_SCORE_LOSS;
+        } else {
+            _score[i] = 0;
+        }
+    }
+    _fresh = 0;
+
+    if (!healthy(_primary)) {
+        for (uint8_t i=0; i<_count; i++) {
+            if (_score[i] > _score[_primary]) {
+                _primary = i;
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+//	This library is free software; you can redistribute it and / or
+//	modify it under the terms of the GNU Lesser General Public
+//	License as published by the Free Software Foundation; either
+//	version 2.1 of the License, or (at your option) any later version.
+
+// Health scoring of several instances of the same kind of sensor, so a
+// driver can hand its users the samples of one good instance and move
+// to another as soon as that one goes bad.
+//
+// Each instance gets a score which is lost when its samples stop, or
+// when it disagrees with the others while they agree with each other,
+// and slowly won back while it behaves. With two instances a
+// disagreement can't say which one is wrong, so only timeouts count.
+// The driver records samples and calls update() from its timer, and
+// reads from primary() at its next read, so a failed instance is left
+// behind by the next read after it fails.
+
+#ifndef SENSOR_VOTE_H
+#define SENSOR_VOTE_H
+
+#define SENSOR_VOTE_MAX_INSTANCES   3
+
+#define SENSOR_VOTE_SCORE_MAX       100
+#define SENSOR_VOTE_SCORE_HEALTHY   50      // at or above this an instance is healthy
+#define SENSOR_VOTE_SCORE_GAIN      1       // won back for each consistent sample
+#define SENSOR_VOTE_SCORE_LOSS      10      // lost for each inconsistent sample
+
+class SensorVote
+{
+public:
+    // max_error is the largest difference between instances which is
+    // still agreement, timeout_us the longest gap between samples
+    SensorVote(float max_error, uint32_t timeout_us);
+
+    // set the number of instances. Their samples have timeout_us from
+    // now to start arriving
+    void set_count(uint8_t count, uint32_t now_us);
+    uint8_t get_count() const { return _count; }
+
+    // record the latest sample of an instance
+    void sample(uint8_t instance, const Vector3f &v, uint32_t now_us);
+
+    // score the new samples, and move to the best instance if the
+    // primary is no longer healthy
+    void update(uint32_t now_us);
+
+    // the instance to use
+    uint8_t primary() const { return _primary; }
+
+    bool healthy(uint8_t instance) const {
+        return _score[instance] >= SENSOR_VOTE_SCORE_HEALTHY;
+    }
+    uint8_t score(uint8_t instance) const { return _score[instance]; }
+
+private:
+    bool _timed_out(uint8_t instance, uint32_t now_us) const {
+        return now_us - _last_us[instance] > _timeout_us;
+    }
+
+    float    _max_error_sq;
+    uint32_t _timeout_us;
+    uint8_t  _count;
+    uint8_t  _primary;
+    uint8_t  _fresh;                                // a bit per instance with an unscored sample
+    uint8_t  _score[SENSOR_VOTE_MAX_INSTANCES];
+    uint32_t _last_us[SENSOR_VOTE_MAX_INSTANCES];
+    Vector3f _last[SENSOR_VOTE_MAX_INSTANCES];
+};
+
+#endif // SENSOR_VOTE_H
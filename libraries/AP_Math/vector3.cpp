@@ -312,3 +312,14 @@ template bool Vector3<float>::operator !=(const Vector3<float> &v) const;
 template bool Vector3<float>::is_nan(void) const;
 template bool Vector3<float>::is_inf(void) const;
 template float Vector3<float>::angle(const Vector3<float> &v) const;
+
+// and the subset the fixed point DCM uses on the 8 bit boards
+template Vector3<Fixed30> Vector3<Fixed30>::operator %(const Vector3<Fixed30> &v) const;
+template Fixed30 Vector3<Fixed30>::operator *(const Vector3<Fixed30> &v) const;
+template Vector3<Fixed30> &Vector3<Fixed30>::operator *=(const Fixed30 num);
+template Vector3<Fixed30> &Vector3<Fixed30>::operator -=(const Vector3<Fixed30> &v);
+template Vector3<Fixed30> &Vector3<Fixed30>::operator +=(const Vector3<Fixed30> &v);
+template Vector3<Fixed30> Vector3<Fixed30>::operator *(const Fixed30 num) const;
+template Vector3<Fixed30> Vector3<Fixed30>::operator +(const Vector3<Fixed30> &v) const;
+template Vector3<Fixed30> Vector3<Fixed30>::operator -(const Vector3<Fixed30> &v) const;
+template Vector3<Fixed30> Vector3<Fixed30>::operator -(void) const;
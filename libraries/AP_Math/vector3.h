@@ -102,6 +102,15 @@ public:
     // uniform scaling
     Vector3<T> &operator /=(const T num);
 
+    // add v scaled by k, without the temporary of *this += v * k
+    Vector3<T> &multiply_add(const Vector3<T> &v, const T k)
+    {
+        x += v.x * k;
+        y += v.y * k;
+        z += v.z * k;
+        return *this;
+    }
+
     // dot product
     T operator *(const Vector3<T> &v) const;
 
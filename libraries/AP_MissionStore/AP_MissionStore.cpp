@@ -0,0 +1,415 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_MissionStore.cpp
+/// @brief	Packed storage of the mission commands in the EEPROM.
+
+#include <AP_HAL.h>
+#include <GCS_MAVLink.h>
+#include "AP_MissionStore.h"
+
+extern const AP_HAL::HAL& hal;
+
+/*
+  The area starts with the header. The records follow it, and the
+  index entries are stored from the end of the area down, entry i
+  holding the offset from the start of the area of the record of
+  command i, or AP_MISSIONSTORE_EMPTY.
+
+  A record is the command id, a format byte, the options, then the
+  fields which the format byte says are there, little endian:
+
+    bit 0       p1 follows the options
+    bits 1-2    size code of alt
+    bits 3-4    size code of lat
+    bits 5-6    size code of lng
+    bit 7       lat and lng are the difference from the origin
+
+  where a size code of 0 means the field is zero and takes no bytes,
+  and 1, 2 and 3 mean it takes 2, 3 or 4 bytes. The origin is the
+  first position written after the area is emptied, so every
+  position within 90km or so of it takes 3 bytes each way.
+ */
+
+#define AP_MISSIONSTORE_EMPTY       0xFFFF
+
+#define FMT_P1                      0x01
+#define FMT_ALT_SHIFT               1
+#define FMT_LAT_SHIFT               3
+#define FMT_LNG_SHIFT               5
+#define FMT_DELTA                   0x80
+#define FMT_FULL                    0x7F
+
+struct PACKED header {
+    uint16_t magic;
+    uint16_t num_entries;
+    uint16_t data_end;
+    int32_t origin_lat;
+    int32_t origin_lng;
+};
+
+// bytes taken by each size code
+static const uint8_t field_size[4] = { 0, 2, 3, 4 };
+
+// put_field - stores the low bytes of v that its size code says
+static uint8_t put_field(uint8_t *buf, int32_t v, uint8_t code)
+{
+    uint8_t n = field_size[code & 3];
+    for (uint8_t i=0; i<n; i++) {
+        buf[i] = v & 0xFF;
+        v >>= 8;
+    }
+    return n;
+}
+
+// get_field - reads back a field, extending its sign
+static uint8_t get_field(const uint8_t *buf, int32_t &v, uint8_t code)
+{
+    uint8_t n = field_size[code & 3];
+    uint32_t u = 0;
+    for (uint8_t i=n; i>0; i--) {
+        u = (u << 8) | buf[i-1];
+    }
+    if (n != 0 && n < 4 && (u & (1UL << (8*n-1)))) {
+        u |= 0xFFFFFFFFUL << (8*n);
+    }
+    v = (int32_t)u;
+    return n;
+}
+
+AP_MissionStore::AP_MissionStore(uint16_t start, uint16_t end) :
+    _start(start),
+    _end(end),
+    _num_entries(0),
+    _data_end(AP_MISSIONSTORE_HEADER_SIZE),
+    _origin_lat(0),
+    _origin_lng(0)
+{
+    memset(_nav_map, 0, sizeof(_nav_map));
+    reset_jumps();
+}
+
+bool AP_MissionStore::init()
+{
+    struct header hdr;
+    hal.storage->read_block(&hdr, _start, sizeof(hdr));
+    if (hdr.magic == AP_MISSIONSTORE_MAGIC &&
+        hdr.data_end >= AP_MISSIONSTORE_HEADER_SIZE &&
+        hdr.data_end + AP_MISSIONSTORE_INDEX_SIZE * (uint32_t)hdr.num_entries <= (uint16_t)(_end - _start)) {
+        _num_entries = hdr.num_entries;
+        _data_end = hdr.data_end;
+        _origin_lat = hdr.origin_lat;
+        _origin_lng = hdr.origin_lng;
+        for (uint16_t i=0; i<_num_entries && i<AP_MISSIONSTORE_NAV_MAP; i++) {
+            set_nav(i, read_id(i) < MAV_CMD_NAV_LAST);
+        }
+        reset_jumps();
+        return true;
+    }
+
+    // an old layout, or never used
+    _num_entries = 0;
+    _data_end = AP_MISSIONSTORE_HEADER_SIZE;
+    _origin_lat = _origin_lng = 0;
+    write_header();
+    return false;
+}
+
+void AP_MissionStore::write_header()
+{
+    struct header hdr;
+    hdr.magic = AP_MISSIONSTORE_MAGIC;
+    hdr.num_entries = _num_entries;
+    hdr.data_end = _data_end;
+    hdr.origin_lat = _origin_lat;
+    hdr.origin_lng = _origin_lng;
+    hal.storage->write_block(_start, &hdr, sizeof(hdr));
+}
+
+uint8_t AP_MissionStore::size_code(int32_t v)
+{
+    if (v == 0) {
+        return 0;
+    }
+    if (v >= -32768L && v <= 32767L) {
+        return 1;
+    }
+    if (v >= -8388608L && v <= 8388607L) {
+        return 2;
+    }
+    return 3;
+}
+
+uint8_t AP_MissionStore::record_length(uint8_t fmt)
+{
+    return 3 + (fmt & FMT_P1) +
+        field_size[(fmt >> FMT_ALT_SHIFT) & 3] +
+        field_size[(fmt >> FMT_LAT_SHIFT) & 3] +
+        field_size[(fmt >> FMT_LNG_SHIFT) & 3];
+}
+
+uint8_t AP_MissionStore::encode(uint16_t i, const struct Location &cmd, uint8_t *buf)
+{
+    int32_t lat = cmd.lat;
+    int32_t lng = cmd.lng;
+    uint8_t fmt;
+
+    if (i == 0) {
+        fmt = FMT_FULL;
+    } else {
+        fmt = (cmd.p1 != 0 ? FMT_P1 : 0) |
+            (size_code(cmd.alt) << FMT_ALT_SHIFT) |
+            (size_code(lat) << FMT_LAT_SHIFT) |
+            (size_code(lng) << FMT_LNG_SHIFT);
+
+        // the first full sized position becomes the origin. Non-nav
+        // commands keep small numbers in lat and lng, which are best
+        // left as they are
+        if (_origin_lat == 0 && _origin_lng == 0 &&
+            size_code(lat) == 3 && size_code(lng) == 3) {
+            _origin_lat = lat;
+            _origin_lng = lng;
+            write_header();
+        }
+
+        if (_origin_lat != 0 || _origin_lng != 0) {
+            // the differences wrap, so they are exact for any position
+            int32_t dlat = (int32_t)((uint32_t)lat - (uint32_t)_origin_lat);
+            int32_t dlng = (int32_t)((uint32_t)lng - (uint32_t)_origin_lng);
+            uint8_t dfmt = (fmt & (FMT_P1 | (3 << FMT_ALT_SHIFT))) | FMT_DELTA |
+                (size_code(dlat) << FMT_LAT_SHIFT) |
+                (size_code(dlng) << FMT_LNG_SHIFT);
+            if (record_length(dfmt) < record_length(fmt)) {
+                fmt = dfmt;
+                lat = dlat;
+                lng = dlng;
+            }
+        }
+    }
+
+    buf[0] = cmd.id;
+    buf[1] = fmt;
+    buf[2] = cmd.options;
+    uint8_t n = 3;
+    if (fmt & FMT_P1) {
+        buf[n++] = cmd.p1;
+    }
+    n += put_field(&buf[n], cmd.alt, fmt >> FMT_ALT_SHIFT);
+    n += put_field(&buf[n], lat, fmt >> FMT_LAT_SHIFT);
+    n += put_field(&buf[n], lng, fmt >> FMT_LNG_SHIFT);
+    return n;
+}
+
+bool AP_MissionStore::read(uint16_t i, struct Location &cmd)
+{
+    if (i >= _num_entries) {
+        return false;
+    }
+    uint16_t ofs = hal.storage->read_word(index_addr(i));
+    if (ofs == AP_MISSIONSTORE_EMPTY || ofs < AP_MISSIONSTORE_HEADER_SIZE || ofs + 3 > _data_end) {
+        return false;
+    }
+
+    // read as much as the longest record, without going past the data
+    uint8_t buf[AP_MISSIONSTORE_MAX_RECORD];
+    uint16_t len = _data_end - ofs;
+    if (len > sizeof(buf)) {
+        len = sizeof(buf);
+    }
+    hal.storage->read_block(buf, _start + ofs, len);
+    uint8_t fmt = buf[1];
+    if (record_length(fmt) > len) {
+        return false;
+    }
+
+    cmd.id = buf[0];
+    cmd.options = buf[2];
+    uint8_t n = 3;
+    cmd.p1 = (fmt & FMT_P1) ? buf[n++] : 0;
+    n += get_field(&buf[n], cmd.alt, fmt >> FMT_ALT_SHIFT);
+    n += get_field(&buf[n], cmd.lat, fmt >> FMT_LAT_SHIFT);
+    n += get_field(&buf[n], cmd.lng, fmt >> FMT_LNG_SHIFT);
+    if (fmt & FMT_DELTA) {
+        cmd.lat = (int32_t)((uint32_t)cmd.lat + (uint32_t)_origin_lat);
+        cmd.lng = (int32_t)((uint32_t)cmd.lng + (uint32_t)_origin_lng);
+    }
+    return true;
+}
+
+bool AP_MissionStore::write(uint16_t i, const struct Location &cmd)
+{
+    uint8_t buf[AP_MISSIONSTORE_MAX_RECORD];
+    uint8_t len = encode(i, cmd, buf);
+    uint16_t num_entries = i < _num_entries ? _num_entries : i+1;
+
+    // the record may go back in its old place if it fits there, or
+    // if it was the last of the data
+    uint16_t ofs = _data_end;
+    if (i < _num_entries) {
+        uint16_t old_ofs = hal.storage->read_word(index_addr(i));
+        if (old_ofs != AP_MISSIONSTORE_EMPTY && old_ofs < _data_end) {
+            uint8_t old_len = record_length(hal.storage->read_byte(_start + old_ofs + 1));
+            if (len <= old_len || old_ofs + old_len == _data_end) {
+                ofs = old_ofs;
+            }
+        }
+    }
+
+    if ((uint32_t)ofs + len + AP_MISSIONSTORE_INDEX_SIZE * (uint32_t)num_entries > (uint16_t)(_end - _start)) {
+        return false;
+    }
+
+    // write the record before anything points at it, and the index
+    // before the header counts it, so a reset part way through leaves
+    // at worst some lost space
+    hal.storage->write_block(_start + ofs, buf, len);
+    if (ofs + len > _data_end) {
+        _data_end = ofs + len;
+        write_header();
+    }
+    for (uint16_t j=_num_entries; j<i; j++) {
+        hal.storage->write_word(index_addr(j), AP_MISSIONSTORE_EMPTY);
+        set_nav(j, true);
+    }
+    hal.storage->write_word(index_addr(i), ofs);
+    set_nav(i, cmd.id < MAV_CMD_NAV_LAST);
+    int8_t k = find_jump(i);
+    if (k >= 0) {
+        // a new repeat count
+        _jumps[k].index = 0;
+    }
+    if (num_entries != _num_entries) {
+        _num_entries = num_entries;
+        write_header();
+    }
+    return true;
+}
+
+uint16_t AP_MissionStore::data_end(uint16_t count)
+{
+    uint16_t end = AP_MISSIONSTORE_HEADER_SIZE;
+    for (uint16_t j=0; j<count; j++) {
+        uint16_t ofs = hal.storage->read_word(index_addr(j));
+        if (ofs != AP_MISSIONSTORE_EMPTY && ofs < _data_end) {
+            uint16_t rec_end = ofs + record_length(hal.storage->read_byte(_start + ofs + 1));
+            if (rec_end > end) {
+                end = rec_end;
+            }
+        }
+    }
+    return end;
+}
+
+void AP_MissionStore::truncate(uint16_t count)
+{
+    if (count < _num_entries) {
+        _num_entries = count;
+        _data_end = data_end(count);
+    }
+    for (uint8_t k=0; k<AP_MISSIONSTORE_JUMPS; k++) {
+        if (_jumps[k].index >= count) {
+            _jumps[k].index = 0;
+        }
+    }
+    if (count <= 1) {
+        // command 0 is never relative to the origin, so a new one can
+        // be chosen
+        _origin_lat = _origin_lng = 0;
+    }
+    write_header();
+}
+
+uint16_t AP_MissionStore::bytes_free() const
+{
+    return (_end - _start) - AP_MISSIONSTORE_INDEX_SIZE * _num_entries - _data_end;
+}
+
+uint8_t AP_MissionStore::read_id(uint16_t i)
+{
+    uint16_t ofs = hal.storage->read_word(index_addr(i));
+    if (ofs == AP_MISSIONSTORE_EMPTY || ofs < AP_MISSIONSTORE_HEADER_SIZE || ofs + 3 > _data_end) {
+        // reads as a blank command
+        return 0;
+    }
+    return hal.storage->read_byte(_start + ofs);
+}
+
+void AP_MissionStore::set_nav(uint16_t i, bool nav)
+{
+    if (i >= AP_MISSIONSTORE_NAV_MAP) {
+        return;
+    }
+    if (nav) {
+        _nav_map[i>>3] |= (1U << (i & 7));
+    } else {
+        _nav_map[i>>3] &= ~(1U << (i & 7));
+    }
+}
+
+uint16_t AP_MissionStore::next_nav(uint16_t i)
+{
+    if (i >= _num_entries) {
+        return i;
+    }
+    while (i < _num_entries) {
+        if (i >= AP_MISSIONSTORE_NAV_MAP) {
+            // past the map, so look at the command itself
+            if (read_id(i) < MAV_CMD_NAV_LAST) {
+                return i;
+            }
+            i++;
+        } else if ((i & 7) == 0 && _nav_map[i>>3] == 0) {
+            // eight non-nav commands
+            i += 8;
+        } else if (_nav_map[i>>3] & (1U << (i & 7))) {
+            return i;
+        } else {
+            i++;
+        }
+    }
+    return _num_entries;
+}
+
+int8_t AP_MissionStore::find_jump(uint16_t i) const
+{
+    for (uint8_t k=0; k<AP_MISSIONSTORE_JUMPS; k++) {
+        if (_jumps[k].index == i) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+int16_t AP_MissionStore::jumps_left(uint16_t i, int16_t repeat) const
+{
+    int8_t k = i != 0 ? find_jump(i) : -1;
+    return k >= 0 ? _jumps[k].left : repeat;
+}
+
+bool AP_MissionStore::count_jump(uint16_t i, int16_t repeat)
+{
+    if (i == 0) {
+        return false;
+    }
+    int8_t k = find_jump(i);
+    if (k < 0) {
+        if (repeat < 0) {
+            // for ever, nothing to count
+            return true;
+        }
+        k = find_jump(0);
+        if (k < 0) {
+            return false;
+        }
+        _jumps[k].index = i;
+        _jumps[k].left = repeat;
+    }
+    if (_jumps[k].left > 0) {
+        _jumps[k].left--;
+    }
+    return true;
+}
+
+void AP_MissionStore::reset_jumps()
+{
+    memset(_jumps, 0, sizeof(_jumps));
+}
@@ -0,0 +1,166 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_MissionStore.h
+/// @brief	Packed storage of the mission commands in the EEPROM.
+
+#ifndef __AP_MISSIONSTORE_H__
+#define __AP_MISSIONSTORE_H__
+
+#include <AP_Common.h>
+#include <AP_HAL.h>
+
+// the magic number at the start of the area, which holds the version of
+// the layout in its low byte. The index is found from the end of the
+// area, so this also changes when the vehicles move the end
+#define AP_MISSIONSTORE_MAGIC       0x4D02
+
+// the longest encoding of a command
+#define AP_MISSIONSTORE_MAX_RECORD  16
+
+// size of the area header, and of an index entry
+#define AP_MISSIONSTORE_HEADER_SIZE 14
+#define AP_MISSIONSTORE_INDEX_SIZE  2
+
+// the most bytes of storage that writing a command changes, when it
+// follows the last command: the record, its index entry, and the
+// header fields
+#define AP_MISSIONSTORE_MAX_WRITE   30
+
+// the most commands that can fit in the storage from start to end,
+// if they are all of the shortest encoding
+#define AP_MISSIONSTORE_MAX_COMMANDS(start, end) \
+    (((end) - (start) - AP_MISSIONSTORE_HEADER_SIZE) / (AP_MISSIONSTORE_INDEX_SIZE + 3))
+
+// the commands covered by the map of which are nav commands, and the
+// DO_JUMP commands that can be counting down at once
+#ifndef AP_MISSIONSTORE_NAV_MAP
+ #if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+  #define AP_MISSIONSTORE_NAV_MAP   512
+  #define AP_MISSIONSTORE_JUMPS     8
+ #else
+  #define AP_MISSIONSTORE_NAV_MAP   2048
+  #define AP_MISSIONSTORE_JUMPS     32
+ #endif
+#endif
+
+/// @class	AP_MissionStore
+/// @brief	Keeps the mission commands in an area of the storage, packed
+///         so that no field takes more bytes than its value needs, and
+///         with positions stored as the difference from a point that
+///         is fixed for the mission. An index of the commands grows down
+///         from the end of the area, and the commands, in any order,
+///         grow up from the start, so reading a command takes two reads
+///         of the storage however long the mission.
+///
+///         A command that is written again goes back in its old place
+///         if it fits, otherwise it goes at the end of the data and its
+///         old place is lost until the commands are truncated. Command 0,
+///         the home position, is rewritten often so it always takes the
+///         longest encoding to keep its place.
+///
+///         A bitmap in RAM says which commands are nav commands, so the
+///         next one is found without reading the storage, and the
+///         repeat counts of DO_JUMP commands are counted down in RAM
+///         rather than by rewriting the commands.
+class AP_MissionStore {
+public:
+    /// @param  start, end  the area of the storage to use
+    AP_MissionStore(uint16_t start, uint16_t end);
+
+    /// Check the header of the area, and clear it if it doesn't hold a
+    /// mission in this layout
+    ///
+    /// @returns    false if the area was cleared
+    ///
+    bool        init();
+
+    /// Read a command
+    ///
+    /// @returns    false if command i has never been written
+    ///
+    bool        read(uint16_t i, struct Location &cmd);
+
+    /// Write a command. Any commands between the last one and i that
+    /// haven't been written are left empty
+    ///
+    /// @returns    false if there is no room for it
+    ///
+    bool        write(uint16_t i, const struct Location &cmd);
+
+    /// Forget the commands from count on. Truncating to one command or
+    /// none frees all the space, ready for a new mission
+    void        truncate(uint16_t count);
+
+    /// the number of commands, including empty ones
+    uint16_t    num_commands() const { return _num_entries; }
+
+    /// the bytes free for new commands and their index entries
+    uint16_t    bytes_free() const;
+
+    /// The first command from i on that isn't a non-nav command. The
+    /// commands past the last read as blank, which counts as nav, so
+    /// this is at most num_commands() unless i is beyond it
+    uint16_t    next_nav(uint16_t i);
+
+    /// The jumps the DO_JUMP command i has left, from the repeat count
+    /// it holds: that count until the jump has been taken, then what it
+    /// has been counted down to. A negative count repeats for ever
+    int16_t     jumps_left(uint16_t i, int16_t repeat) const;
+
+    /// Count down the jumps left of the DO_JUMP command i
+    ///
+    /// @returns    false if there is no room for another count, and
+    ///             the caller has to store the new count in the command
+    ///
+    bool        count_jump(uint16_t i, int16_t repeat);
+
+    /// Forget the counts, so every DO_JUMP has its full repeat count
+    void        reset_jumps();
+
+private:
+    /// encode cmd into buf, returning its length
+    uint8_t     encode(uint16_t i, const struct Location &cmd, uint8_t *buf);
+
+    /// length of a record from its format byte
+    static uint8_t record_length(uint8_t fmt);
+
+    /// the smallest field size code of a value
+    static uint8_t size_code(int32_t v);
+
+    /// storage address of an index entry
+    uint16_t    index_addr(uint16_t i) const { return _end - AP_MISSIONSTORE_INDEX_SIZE * (i+1); }
+
+    /// offset of the end of the last record of the first count commands
+    uint16_t    data_end(uint16_t count);
+
+    void        write_header();
+
+    /// the id of command i, from the storage
+    uint8_t     read_id(uint16_t i);
+
+    void        set_nav(uint16_t i, bool nav);
+
+    /// the slot counting the jumps of command i, or -1
+    int8_t      find_jump(uint16_t i) const;
+
+    uint16_t    _start;
+    uint16_t    _end;
+
+    // copy of the header
+    uint16_t    _num_entries;                   ///< index entries in use
+    uint16_t    _data_end;                      ///< offset of the first free byte of the data
+    int32_t     _origin_lat;                    ///< the position that positions are relative to, or 0,0 if unset
+    int32_t     _origin_lng;
+
+    // a bit for each command, set if it is a nav command
+    uint8_t     _nav_map[AP_MISSIONSTORE_NAV_MAP/8];
+
+    // the jumps taken so far, by command. A command of 0 is a free
+    // slot, as command 0 is always home
+    struct jump_count {
+        uint16_t    index;
+        int16_t     left;
+    } _jumps[AP_MISSIONSTORE_JUMPS];
+};
+
+#endif // __AP_MISSIONSTORE_H__
@@ -322,46 +322,10 @@ void AP_MotorsHeli::reset_swash()
     _servo_3->radio_min = 1000;
     _servo_3->radio_max = 2000;
 
-    if( swash_type == AP_MOTORS_HELI_SWASH_CCPM ) {                     //CCPM Swashplate, perform servo control mixing
-
-        // roll factors
-        _rollFactor[CH_1] = cosf(radians(servo1_pos + 90 - phase_angle));
-        _rollFactor[CH_2] = cosf(radians(servo2_pos + 90 - phase_angle));
-        _rollFactor[CH_3] = cosf(radians(servo3_pos + 90 - phase_angle));
-
-        // pitch factors
-        _pitchFactor[CH_1] = cosf(radians(servo1_pos - phase_angle));
-        _pitchFactor[CH_2] = cosf(radians(servo2_pos - phase_angle));
-        _pitchFactor[CH_3] = cosf(radians(servo3_pos - phase_angle));
-
-        // collective factors
-        _collectiveFactor[CH_1] = 1;
-        _collectiveFactor[CH_2] = 1;
-        _collectiveFactor[CH_3] = 1;
-
-    }else{                                                                      //H1 Swashplate, keep servo outputs seperated
-
-        // roll factors
-        _rollFactor[CH_1] = 1;
-        _rollFactor[CH_2] = 0;
-        _rollFactor[CH_3] = 0;
-
-        // pitch factors
-        _pitchFactor[CH_1] = 0;
-        _pitchFactor[CH_2] = 1;
-        _pitchFactor[CH_3] = 0;
-
-        // collective factors
-        _collectiveFactor[CH_1] = 0;
-        _collectiveFactor[CH_2] = 0;
-        _collectiveFactor[CH_3] = 1;
-    }
-
     // set roll, pitch and throttle scaling
-    _roll_scaler = 1.0f;
-    _pitch_scaler = 1.0f;
-    _collective_scalar = ((float)(_rc_throttle->radio_max - _rc_throttle->radio_min))/1000.0f;
-	_stab_throttle_scalar = 1.0f;
+    calculate_swash_factors(1.0f, 1.0f);
+    _collective_scalar = ((int32_t)(_rc_throttle->radio_max - _rc_throttle->radio_min) << AP_MOTORS_HELI_FACTOR_BITS) / 1000;
+	_stab_throttle_scalar = 1<<AP_MOTORS_HELI_FACTOR_BITS;
 
     // we must be in set-up mode so mark swash as uninitialised
     _swash_initialised = false;
@@ -389,56 +353,72 @@ void AP_MotorsHeli::init_swash()
     throttle_mid = ((float)(collective_mid-collective_min))/((float)(collective_max-collective_min))*1000.0f;
 
     // determine roll, pitch and throttle scaling
-    _roll_scaler = (float)roll_max/4500.0f;
-    _pitch_scaler = (float)pitch_max/4500.0f;
-    _collective_scalar = ((float)(collective_max-collective_min))/1000.0f;
-	_stab_throttle_scalar = ((float)(stab_col_max - stab_col_min))/100.0f;
+    calculate_swash_factors((float)roll_max/4500.0f, (float)pitch_max/4500.0f);
+    _collective_scalar = ((int32_t)(collective_max-collective_min) << AP_MOTORS_HELI_FACTOR_BITS) / 1000;
+	_stab_throttle_scalar = ((int32_t)(stab_col_max - stab_col_min) << AP_MOTORS_HELI_FACTOR_BITS) / 100;
+
+    // servo min/max values
+    _servo_1->radio_min = 1000;
+    _servo_1->radio_max = 2000;
+    _servo_2->radio_min = 1000;
+    _servo_2->radio_max = 2000;
+    _servo_3->radio_min = 1000;
+    _servo_3->radio_max = 2000;
+
+    // mark swash as initialised
+    _swash_initialised = true;
+    _swash_params = AP_Param::change_count();
+}
+
+// calculate_swash_factors - work out the servo mixing factors for the swash type
+void AP_MotorsHeli::calculate_swash_factors(float roll_scaler, float pitch_scaler)
+{
+    float roll_factor[AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS];
+    float pitch_factor[AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS];
+    float collective_factor[AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS];
 
     if( swash_type == AP_MOTORS_HELI_SWASH_CCPM ) {                     //CCPM Swashplate, perform control mixing
 
         // roll factors
-        _rollFactor[CH_1] = cosf(radians(servo1_pos + 90 - phase_angle));
-        _rollFactor[CH_2] = cosf(radians(servo2_pos + 90 - phase_angle));
-        _rollFactor[CH_3] = cosf(radians(servo3_pos + 90 - phase_angle));
+        roll_factor[CH_1] = cosf(radians(servo1_pos + 90 - phase_angle));
+        roll_factor[CH_2] = cosf(radians(servo2_pos + 90 - phase_angle));
+        roll_factor[CH_3] = cosf(radians(servo3_pos + 90 - phase_angle));
 
         // pitch factors
-        _pitchFactor[CH_1] = cosf(radians(servo1_pos - phase_angle));
-        _pitchFactor[CH_2] = cosf(radians(servo2_pos - phase_angle));
-        _pitchFactor[CH_3] = cosf(radians(servo3_pos - phase_angle));
+        pitch_factor[CH_1] = cosf(radians(servo1_pos - phase_angle));
+        pitch_factor[CH_2] = cosf(radians(servo2_pos - phase_angle));
+        pitch_factor[CH_3] = cosf(radians(servo3_pos - phase_angle));
 
         // collective factors
-        _collectiveFactor[CH_1] = 1;
-        _collectiveFactor[CH_2] = 1;
-        _collectiveFactor[CH_3] = 1;
+        collective_factor[CH_1] = 1;
+        collective_factor[CH_2] = 1;
+        collective_factor[CH_3] = 1;
 
     }else{              //H1 Swashplate, keep servo outputs seperated
 
         // roll factors
-        _rollFactor[CH_1] = 1;
-        _rollFactor[CH_2] = 0;
-        _rollFactor[CH_3] = 0;
+        roll_factor[CH_1] = 1;
+        roll_factor[CH_2] = 0;
+        roll_factor[CH_3] = 0;
 
         // pitch factors
-        _pitchFactor[CH_1] = 0;
-        _pitchFactor[CH_2] = 1;
-        _pitchFactor[CH_3] = 0;
+        pitch_factor[CH_1] = 0;
+        pitch_factor[CH_2] = 1;
+        pitch_factor[CH_3] = 0;
 
         // collective factors
-        _collectiveFactor[CH_1] = 0;
-        _collectiveFactor[CH_2] = 0;
-        _collectiveFactor[CH_3] = 1;
+        collective_factor[CH_1] = 0;
+        collective_factor[CH_2] = 0;
+        collective_factor[CH_3] = 1;
     }
 
-    // servo min/max values
-    _servo_1->radio_min = 1000;
-    _servo_1->radio_max = 2000;
-    _servo_2->radio_min = 1000;
-    _servo_2->radio_max = 2000;
-    _servo_3->radio_min = 1000;
-    _servo_3->radio_max = 2000;
-
-    // mark swash as initialised
-    _swash_initialised = true;
+    // to fixed point, with the roll and pitch scaling and the division by 10 of their inputs
+    const float one = 1<<AP_MOTORS_HELI_FACTOR_BITS;
+    for (uint8_t i=0; i<AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS; i++) {
+        _rollFactor[i] = roundf(roll_factor[i] * roll_scaler * 0.1f * one);
+        _pitchFactor[i] = roundf(pitch_factor[i] * pitch_scaler * 0.1f * one);
+        _collectiveFactor[i] = roundf(collective_factor[i] * one);
+    }
 }
 
 //
@@ -459,31 +439,29 @@ void AP_MotorsHeli::move_swash(int16_t roll_out, int16_t pitch_out, int16_t coll
         if( _swash_initialised ) {
             reset_swash();
         }
-        coll_out_scaled = coll_in * _collective_scalar + _rc_throttle->radio_min - 1000;
+        coll_out_scaled = (((int32_t)coll_in * _collective_scalar) >> AP_MOTORS_HELI_FACTOR_BITS) + _rc_throttle->radio_min - 1000;
     }else{      // regular flight mode
 
-        // check if we need to reinitialise the swash
-        if( !_swash_initialised ) {
+        // check if we need to reinitialise the swash, including after a parameter change
+        if( !_swash_initialised || _swash_params != AP_Param::change_count() ) {
             init_swash();
         }
 
-        // rescale roll_out and pitch-out into the min and max ranges to provide linear motion
-        // across the input range instead of stopping when the input hits the constrain value
+        // limit roll_out and pitch_out to the input range. The factors scale them into the
+        // min and max ranges to provide linear motion across the input range instead of
+        // stopping when the input hits the constrain value.
         // these calculations are based on an assumption of the user specified roll_max and pitch_max
         // coming into this equation at 4500 or less, and based on the original assumption of the
         // total _servo_x.servo_out range being -4500 to 4500.
-        roll_out = roll_out * _roll_scaler;
-        roll_out = constrain_int16(roll_out, (int16_t)-roll_max, (int16_t)roll_max);
-
-        pitch_out = pitch_out * _pitch_scaler;
-        pitch_out = constrain_int16(pitch_out, (int16_t)-pitch_max, (int16_t)pitch_max);
+        roll_out = constrain_int16(roll_out, -4500, 4500);
+        pitch_out = constrain_int16(pitch_out, -4500, 4500);
 
         // scale collective pitch
         coll_out = constrain_int16(coll_in, 0, 1000);
 		if (stab_throttle){
-			coll_out = coll_out * _stab_throttle_scalar + stab_col_min*10;
+			coll_out = (((int32_t)coll_out * _stab_throttle_scalar) >> AP_MOTORS_HELI_FACTOR_BITS) + stab_col_min*10;
 		}
-        coll_out_scaled = coll_out * _collective_scalar + collective_min - 1000;
+        coll_out_scaled = (((int32_t)coll_out * _collective_scalar) >> AP_MOTORS_HELI_FACTOR_BITS) + collective_min - 1000;
 		
         // rudder feed forward based on collective
         if( !ext_gyro_enabled ) {
@@ -492,13 +470,17 @@ void AP_MotorsHeli::move_swash(int16_t roll_out, int16_t pitch_out, int16_t coll
     }
 
     // swashplate servos
-    _servo_1->servo_out = (_rollFactor[CH_1] * roll_out + _pitchFactor[CH_1] * pitch_out)/10 + _collectiveFactor[CH_1] * coll_out_scaled + (_servo_1->radio_trim-1500);
-    _servo_2->servo_out = (_rollFactor[CH_2] * roll_out + _pitchFactor[CH_2] * pitch_out)/10 + _collectiveFactor[CH_2] * coll_out_scaled + (_servo_2->radio_trim-1500);
+    RC_Channel *servos[AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS] = { _servo_1, _servo_2, _servo_3 };
+    for (uint8_t i=0; i<AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS; i++) {
+        int32_t out = (int32_t)_rollFactor[i] * roll_out +
+                      (int32_t)_pitchFactor[i] * pitch_out +
+                      (int32_t)_collectiveFactor[i] * coll_out_scaled;
+        servos[i]->servo_out = ((out + (1<<(AP_MOTORS_HELI_FACTOR_BITS-1))) >> AP_MOTORS_HELI_FACTOR_BITS) + (servos[i]->radio_trim-1500);
+    }
     if( swash_type == AP_MOTORS_HELI_SWASH_H1 ) {
         _servo_1->servo_out += 500;
         _servo_2->servo_out += 500;
     }
-    _servo_3->servo_out = (_rollFactor[CH_3] * roll_out + _pitchFactor[CH_3] * pitch_out)/10 + _collectiveFactor[CH_3] * coll_out_scaled + (_servo_3->radio_trim-1500);
     _servo_4->servo_out = yaw_out + yaw_offset;
 
     // use servo_out to calculate pwm_out and radio_out
@@ -507,22 +489,24 @@ void AP_MotorsHeli::move_swash(int16_t roll_out, int16_t pitch_out, int16_t coll
     _servo_3->calc_pwm();
     _servo_4->calc_pwm();
 
-    // actually move the servos
+    // actually move the servos, all together
+    hal.rcout->cork();
     hal.rcout->write(_motor_to_channel_map[AP_MOTORS_MOT_1], _servo_1->radio_out);
     hal.rcout->write(_motor_to_channel_map[AP_MOTORS_MOT_2], _servo_2->radio_out);
     hal.rcout->write(_motor_to_channel_map[AP_MOTORS_MOT_3], _servo_3->radio_out);
     hal.rcout->write(_motor_to_channel_map[AP_MOTORS_MOT_4], _servo_4->radio_out);
 
+    // output gyro value
+    if( ext_gyro_enabled ) {
+        hal.rcout->write(AP_MOTORS_HELI_EXT_GYRO, ext_gyro_gain);
+    }
+    hal.rcout->push();
+
     // to be compatible with other frame types
     motor_out[AP_MOTORS_MOT_1] = _servo_1->radio_out;
     motor_out[AP_MOTORS_MOT_2] = _servo_2->radio_out;
     motor_out[AP_MOTORS_MOT_3] = _servo_3->radio_out;
     motor_out[AP_MOTORS_MOT_4] = _servo_4->radio_out;
-
-    // output gyro value
-    if( ext_gyro_enabled ) {
-        hal.rcout->write(AP_MOTORS_HELI_EXT_GYRO, ext_gyro_gain);
-    }
 }
 
 static long map(long x, long in_min, long in_max, long out_min, long out_max)
@@ -18,6 +18,10 @@
 
 #define AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS 3
 
+// the swash mixing factors and scalars are fixed point with this many
+// fractional bits
+#define AP_MOTORS_HELI_FACTOR_BITS 12
+
 // tail servo uses channel 7
 #define AP_MOTORS_HELI_EXT_GYRO CH_7
 
@@ -63,10 +67,8 @@ public:
     {
 		AP_Param::setup_object_defaults(this, var_info);
         throttle_mid = 0;
-        _roll_scaler = 1;
-        _pitch_scaler = 1;
-        _collective_scalar = 1;
-		_stab_throttle_scalar = 1;
+        _collective_scalar = 1<<AP_MOTORS_HELI_FACTOR_BITS;
+		_stab_throttle_scalar = 1<<AP_MOTORS_HELI_FACTOR_BITS;
         _swash_initialised = false;
 		stab_throttle = false;
         motor_runup_complete = false;
@@ -139,19 +141,24 @@ protected:
 
     void rsc_control();
 
-    float _rollFactor[AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS];
-    float _pitchFactor[AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS];
-    float _collectiveFactor[AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS];
+    // calculate_swash_factors - work out the servo mixing factors for the swash type,
+    // with the scaling of roll and pitch input (i.e. -4500 ~ 4500) to their max ranges
+    void calculate_swash_factors(float roll_scaler, float pitch_scaler);
+
+    // the servo mixing factors. The roll and pitch factors include the roll and pitch scaling
+    // and the division by 10 of the roll and pitch inputs
+    int16_t _rollFactor[AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS];
+    int16_t _pitchFactor[AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS];
+    int16_t _collectiveFactor[AP_MOTORS_HELI_NUM_SWASHPLATE_SERVOS];
 
 
 
     // internally used variables
 
-    float _roll_scaler;                         // scaler to convert roll input from radio (i.e. -4500 ~ 4500) to max roll range
-    float _pitch_scaler;                        // scaler to convert pitch input from radio (i.e. -4500 ~ 4500) to max pitch range
-    float _collective_scalar;                   // throttle scalar to convert pwm form (i.e. 0 ~ 1000) passed in to actual servo range (i.e 1250~1750 would be 500)
-	float _stab_throttle_scalar;				// throttle scalar to reduce the range of the collective movement in stabilize mode
+    int16_t _collective_scalar;                 // throttle scalar to convert pwm form (i.e. 0 ~ 1000) passed in to actual servo range (i.e 1250~1750 would be 500)
+	int16_t _stab_throttle_scalar;				// throttle scalar to reduce the range of the collective movement in stabilize mode
     bool _swash_initialised;                    // true if swash has been initialised
+    uint16_t _swash_params;                     // AP_Param::change_count() when the swash was initialised
     int16_t rsc_output;                         // final output to the external motor governor 1000-2000
     int16_t rsc_ramp;                           // current state of ramping
     int16_t motor_runup_timer;                  // timer to determine if motor has run up fully
@@ -11,6 +11,26 @@
 
 #include "AP_MotorsHexa.h"
 
+// plus frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors hexa_plus_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1,  0.0000,  1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1),  // 0 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2,  0.0000, -1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4),  // 180 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3,  0.8660, -0.5000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  5),  // -120 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4, -0.8660,  0.5000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2),  // 60 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_5,  0.8660,  0.5000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 6),  // -60 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_6, -0.8660, -0.5000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3),  // 120 degrees
+};
+
+// X frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors hexa_x_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1, -1.0000,  0.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  2),  // 90 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2,  1.0000,  0.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 5),  // -90 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3,  0.5000,  0.8660, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  6),  // -30 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4, -0.5000, -0.8660, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 3),  // 150 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_5, -0.5000,  0.8660, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 1),  // 30 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_6,  0.5000, -0.8660, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  4),  // -150 degrees
+};
+
 // setup_motors - configures the motors for a hexa
 void AP_MotorsHexa::setup_motors()
 {
@@ -20,19 +40,9 @@ void AP_MotorsHexa::setup_motors()
     // hard coded config for supported frames
     if( _frame_orientation == AP_MOTORS_PLUS_FRAME ) {
         // plus frame set-up
-        add_motor(AP_MOTORS_MOT_1,   0, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1);
-        add_motor(AP_MOTORS_MOT_2, 180, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4);
-        add_motor(AP_MOTORS_MOT_3,-120, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  5);
-        add_motor(AP_MOTORS_MOT_4,  60, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2);
-        add_motor(AP_MOTORS_MOT_5, -60, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 6);
-        add_motor(AP_MOTORS_MOT_6, 120, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3);
+        add_motors_P(hexa_plus_frame, sizeof(hexa_plus_frame)/sizeof(hexa_plus_frame[0]));
     }else{
         // X frame set-up
-        add_motor(AP_MOTORS_MOT_1,  90, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  2);
-        add_motor(AP_MOTORS_MOT_2, -90, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 5);
-        add_motor(AP_MOTORS_MOT_3, -30, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  6);
-        add_motor(AP_MOTORS_MOT_4, 150, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 3);
-        add_motor(AP_MOTORS_MOT_5,  30, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 1);
-        add_motor(AP_MOTORS_MOT_6,-150, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  4);
+        add_motors_P(hexa_x_frame, sizeof(hexa_x_frame)/sizeof(hexa_x_frame[0]));
     }
 }
\ No newline at end of file
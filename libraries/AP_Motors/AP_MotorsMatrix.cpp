@@ -42,6 +42,9 @@ void AP_MotorsMatrix::set_update_rate( uint16_t speed_hz )
         }
     }
     hal.rcout->set_freq( mask, _speed_hz );
+
+    // short pulse ESCs, if the board can drive them
+    hal.rcout->set_oneshot( _oneshot ? mask : 0 );
 }
 
 // set frame orientation (normally + or X)
@@ -81,31 +84,23 @@ void AP_MotorsMatrix::output_min()
     int8_t i;
 
     // fill the motor_out[] array for HIL use and send minimum value to each motor
+    hal.rcout->cork();
     for( i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++ ) {
         if( motor_enabled[i] ) {
             motor_out[i] = _rc_throttle->radio_min;
             hal.rcout->write(_motor_to_channel_map[i], motor_out[i]);
         }
     }
+    hal.rcout->push();
 }
 
 // output_armed - sends commands to the motors
-// includes new scaling stability patch
+// using either the scaling stability patch or the priority mixer
 void AP_MotorsMatrix::output_armed()
 {
     int8_t i;
     int16_t out_min = _rc_throttle->radio_min + _min_throttle;
     int16_t out_max = _rc_throttle->radio_max;
-    int16_t out_mid = (out_min+out_max)/2;
-    int16_t out_max_range; // the is the allowable throttle out setting that allowes maximum roll, pitch and yaw range
-    float rpy_scale = 1.0; // this is used to scale the roll, pitch and yaw to fit within the motor limits
-
-    int16_t rpy_out[AP_MOTORS_MAX_NUM_MOTORS]; // buffer so we don't have to multiply coefficients multiple times.
-
-    int16_t rpy_low = 0;    // lowest motor value
-    int16_t rpy_high = 0;   // highest motor value
-    int16_t yaw_allowed;    // amount of yaw we can fit in
-    int16_t thr_adj;        // how far we move the throttle point from out_max_range
 
     // initialize limits flag
     limit.roll_pitch = false;
@@ -150,131 +145,255 @@ void AP_MotorsMatrix::output_armed()
             limit.throttle = true;
         }
 
-        // calculate roll and pitch for each motor
+        if (_mix_mode == AP_MOTORS_MIX_PRIORITY) {
+            mix_priority(out_min, out_max);
+        } else {
+            mix_stability_patch(out_min, out_max);
+        }
+
+        // adjust for battery voltage and throttle curve
+        for (i=0; i<_num_motors; i++) {
+            uint8_t m = _mix[i].motor_num;
+            motor_out[m] = linearise_output(motor_out[m]);
+        }
+        // clip motor output if required (shouldn't be)
         for (i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++) {
             if (motor_enabled[i]) {
-                rpy_out[i] = _rc_roll->pwm_out * _roll_factor[i] +
-                             _rc_pitch->pwm_out * _pitch_factor[i];
-
-                // record lowest roll pitch command
-                if (rpy_out[i] < rpy_low) {
-                    rpy_low = rpy_out[i];
-                }
-                // record highest roll pich command
-                if (rpy_out[i] > rpy_high) {
-                    rpy_high = rpy_out[i];
-                }
+                motor_out[i] = constrain_int16(motor_out[i], out_min, out_max);
             }
         }
+    }
 
-        // calculate throttle that gives most possible room for yaw (range 1000 ~ 2000)
-        // this value is either:
-        //      mid throttle - average of highest and lowest motor
-        //      the higher of the pilot's throttle input or hover-throttle -- this ensure we never increase the throttle above hover throttle unless the pilot has commanded that
-        int16_t motor_mid = (rpy_low+rpy_high)/2;
-        out_max_range = min(out_mid - motor_mid, max(_rc_throttle->radio_out, (_rc_throttle->radio_out+_hover_out)/2));
-
-        // calculate amount of yaw we can fit into the throttle range
-        // this is always equal to or less than the requested yaw from the pilot or rate controller
-        yaw_allowed = min(out_max - out_max_range, out_max_range - out_min) - (rpy_high-rpy_low)/2;
-        yaw_allowed = max(yaw_allowed, AP_MOTORS_MATRIX_YAW_LOWER_LIMIT_PWM);
-
-        if (_rc_yaw->pwm_out >= 0) {
-            // if yawing right
-            if (yaw_allowed > _rc_yaw->pwm_out) {
-                yaw_allowed = _rc_yaw->pwm_out; // to-do: this is bad form for yaw_allows to change meaning to become the amount that we are going to output
-            }else{
-                limit.yaw = true;
-            }
-        }else{
-            // if yawing left
-            yaw_allowed = -yaw_allowed;
-            if( yaw_allowed < _rc_yaw->pwm_out ) {
-                yaw_allowed = _rc_yaw->pwm_out; // to-do: this is bad form for yaw_allows to change meaning to become the amount that we are going to output
-            }else{
-                limit.yaw = true;
-            }
+    // send output to each motor, latched so they all change together
+    // and go out now rather than at the next output tick
+    hal.rcout->cork();
+    for( i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++ ) {
+        if( motor_enabled[i] ) {
+            hal.rcout->write(_motor_to_channel_map[i], motor_out[i]);
         }
+    }
+    hal.rcout->push();
+}
 
-        // add yaw to intermediate numbers for each motor
-        for (i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++) {
-            if (motor_enabled[i]) {
-                rpy_out[i] =    rpy_out[i] +
-                                yaw_allowed * _yaw_factor[i];
+// mix_stability_patch - mixes roll, pitch, yaw and throttle into motor_out[]
+// with the scaling stability patch, moving the throttle to make room for roll and pitch
+void AP_MotorsMatrix::mix_stability_patch(int16_t out_min, int16_t out_max)
+{
+    int8_t i;
+    int16_t out_mid = (out_min+out_max)/2;
+    int16_t out_max_range; // the is the allowable throttle out setting that allowes maximum roll, pitch and yaw range
+    float rpy_scale = 1.0; // this is used to scale the roll, pitch and yaw to fit within the motor limits
 
-                // record lowest roll+pitch+yaw command
-                if( rpy_out[i] < rpy_low ) {
-                    rpy_low = rpy_out[i];
-                }
-                // record highest roll+pitch+yaw command
-                if( rpy_out[i] > rpy_high) {
-                    rpy_high = rpy_out[i];
-                }
-            }
-        }
+    int16_t rpy_out[AP_MOTORS_MAX_NUM_MOTORS]; // buffer so we don't have to multiply coefficients multiple times.
 
-        // check everything fits
-        thr_adj = _rc_throttle->radio_out - out_max_range;
+    int16_t rpy_low = 0;    // lowest motor value
+    int16_t rpy_high = 0;   // highest motor value
+    int16_t yaw_allowed;    // amount of yaw we can fit in
+    int16_t thr_adj;        // how far we move the throttle point from out_max_range
 
-        if (thr_adj > 0) {
-            // increase throttle as close as possible to requested throttle
-            // without going over out_max
-            if (thr_adj > out_max-(rpy_high+out_max_range)){
-                thr_adj = out_max-(rpy_high+out_max_range);
-                // we haven't even been able to apply full throttle command
-                limit.throttle = true;
-            }
-        }else if(thr_adj < 0){
-            // decrease throttle as close as possible to requested throttle
-            // without going under out_min or over out_max
-            // earlier code ensures we can't break both boundaryies
-            thr_adj = max(min(thr_adj,out_max-(rpy_high+out_max_range)), min(out_min-(rpy_low+out_max_range),0));
+    // calculate roll and pitch for each motor
+    int16_t roll_pwm = _rc_roll->pwm_out;
+    int16_t pitch_pwm = _rc_pitch->pwm_out;
+    for (i=0; i<_num_motors; i++) {
+        rpy_out[i] = ((int32_t)roll_pwm * _mix[i].roll +
+                      (int32_t)pitch_pwm * _mix[i].pitch) >> AP_MOTORS_MATRIX_FACTOR_SHIFT;
+
+        // record lowest roll pitch command
+        if (rpy_out[i] < rpy_low) {
+            rpy_low = rpy_out[i];
         }
+        // record highest roll pich command
+        if (rpy_out[i] > rpy_high) {
+            rpy_high = rpy_out[i];
+        }
+    }
 
-        // do we need to reduce roll, pitch, yaw command
-        // earlier code does not allow both limit's to be passed simultainiously with abs(_yaw_factor)<1
-        if ((rpy_low+out_max_range)+thr_adj < out_min){
-            rpy_scale = (float)(out_min-thr_adj-out_max_range)/rpy_low;
-            // we haven't even been able to apply full roll, pitch and minimal yaw without scaling
-            limit.roll_pitch = true;
+    // calculate throttle that gives most possible room for yaw (range 1000 ~ 2000)
+    // this value is either:
+    //      mid throttle - average of highest and lowest motor
+    //      the higher of the pilot's throttle input or hover-throttle -- this ensure we never increase the throttle above hover throttle unless the pilot has commanded that
+    int16_t motor_mid = (rpy_low+rpy_high)/2;
+    out_max_range = min(out_mid - motor_mid, max(_rc_throttle->radio_out, (_rc_throttle->radio_out+_hover_out)/2));
+
+    // calculate amount of yaw we can fit into the throttle range
+    // this is always equal to or less than the requested yaw from the pilot or rate controller
+    yaw_allowed = min(out_max - out_max_range, out_max_range - out_min) - (rpy_high-rpy_low)/2;
+    yaw_allowed = max(yaw_allowed, AP_MOTORS_MATRIX_YAW_LOWER_LIMIT_PWM);
+
+    if (_rc_yaw->pwm_out >= 0) {
+        // if yawing right
+        if (yaw_allowed > _rc_yaw->pwm_out) {
+            yaw_allowed = _rc_yaw->pwm_out; // to-do: this is bad form for yaw_allows to change meaning to become the amount that we are going to output
+        }else{
             limit.yaw = true;
-        }else if((rpy_high+out_max_range)+thr_adj > out_max){
-            rpy_scale = (float)(out_max-thr_adj-out_max_range)/rpy_high;
-            // we haven't even been able to apply full roll, pitch and minimal yaw without scaling
-            limit.roll_pitch = true;
+        }
+    }else{
+        // if yawing left
+        yaw_allowed = -yaw_allowed;
+        if( yaw_allowed < _rc_yaw->pwm_out ) {
+            yaw_allowed = _rc_yaw->pwm_out; // to-do: this is bad form for yaw_allows to change meaning to become the amount that we are going to output
+        }else{
             limit.yaw = true;
         }
+    }
 
-        // add scaled roll, pitch, constrained yaw and throttle for each motor
-        for (i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++) {
-            if (motor_enabled[i]) {
-                motor_out[i] = out_max_range+thr_adj +
-                               rpy_scale*rpy_out[i];
-            }
+    // add yaw to intermediate numbers for each motor
+    for (i=0; i<_num_motors; i++) {
+        rpy_out[i] =    rpy_out[i] +
+                        (((int32_t)yaw_allowed * _mix[i].yaw) >> AP_MOTORS_MATRIX_FACTOR_SHIFT);
+
+        // record lowest roll+pitch+yaw command
+        if( rpy_out[i] < rpy_low ) {
+            rpy_low = rpy_out[i];
         }
+        // record highest roll+pitch+yaw command
+        if( rpy_out[i] > rpy_high) {
+            rpy_high = rpy_out[i];
+        }
+    }
 
-        // adjust for throttle curve
-        if (_throttle_curve_enabled) {
-            for (i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++) {
-                if (motor_enabled[i]) {
-                    motor_out[i] = _throttle_curve.get_y(motor_out[i]);
-                }
-            }
+    // check everything fits
+    thr_adj = _rc_throttle->radio_out - out_max_range;
+
+    if (thr_adj > 0) {
+        // increase throttle as close as possible to requested throttle
+        // without going over out_max
+        if (thr_adj > out_max-(rpy_high+out_max_range)){
+            thr_adj = out_max-(rpy_high+out_max_range);
+            // we haven't even been able to apply full throttle command
+            limit.throttle = true;
         }
-        // clip motor output if required (shouldn't be)
-        for (i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++) {
-            if (motor_enabled[i]) {
-                motor_out[i] = constrain_int16(motor_out[i], out_min, out_max);
+    }else if(thr_adj < 0){
+        // decrease throttle as close as possible to requested throttle
+        // without going under out_min or over out_max
+        // earlier code ensures we can't break both boundaryies
+        thr_adj = max(min(thr_adj,out_max-(rpy_high+out_max_range)), min(out_min-(rpy_low+out_max_range),0));
+    }
+
+    // do we need to reduce roll, pitch, yaw command
+    // earlier code does not allow both limit's to be passed simultainiously with abs(_yaw_factor)<1
+    if ((rpy_low+out_max_range)+thr_adj < out_min){
+        rpy_scale = (float)(out_min-thr_adj-out_max_range)/rpy_low;
+        // we haven't even been able to apply full roll, pitch and minimal yaw without scaling
+        limit.roll_pitch = true;
+        limit.yaw = true;
+    }else if((rpy_high+out_max_range)+thr_adj > out_max){
+        rpy_scale = (float)(out_max-thr_adj-out_max_range)/rpy_high;
+        // we haven't even been able to apply full roll, pitch and minimal yaw without scaling
+        limit.roll_pitch = true;
+        limit.yaw = true;
+    }
+
+    // add scaled roll, pitch, constrained yaw and throttle for each motor
+    if (rpy_scale < 1.0) {
+        for (i=0; i<_num_motors; i++) {
+            motor_out[_mix[i].motor_num] = out_max_range+thr_adj +
+                                           rpy_scale*rpy_out[i];
+        }
+    } else {
+        for (i=0; i<_num_motors; i++) {
+            motor_out[_mix[i].motor_num] = out_max_range+thr_adj + rpy_out[i];
+        }
+    }
+}
+
+// mix_priority - mixes roll, pitch, yaw and throttle into motor_out[]
+// giving up throttle before yaw and yaw before roll and pitch when the
+// motors saturate, and setting the limit flags for the axes which did not
+// get all they asked for, so the rate controllers can stop their integrators
+void AP_MotorsMatrix::mix_priority(int16_t out_min, int16_t out_max)
+{
+    int8_t i;
+    int16_t range = out_max - out_min;  // the spread the motors can take
+    int16_t rp_out[AP_MOTORS_MAX_NUM_MOTORS];   // roll and pitch for each motor
+    int16_t yaw_out[AP_MOTORS_MAX_NUM_MOTORS];  // requested yaw for each motor
+    int16_t low, high;
+
+    if (_num_motors == 0) {
+        return;
+    }
+
+    // roll and pitch come first: if they don't fit on their own, scale them
+    // down to exactly the range of the motors
+    int16_t roll_pwm = _rc_roll->pwm_out;
+    int16_t pitch_pwm = _rc_pitch->pwm_out;
+    int16_t yaw_pwm = _rc_yaw->pwm_out;
+    for (i=0; i<_num_motors; i++) {
+        rp_out[i] = ((int32_t)roll_pwm * _mix[i].roll +
+                     (int32_t)pitch_pwm * _mix[i].pitch) >> AP_MOTORS_MATRIX_FACTOR_SHIFT;
+        yaw_out[i] = ((int32_t)yaw_pwm * _mix[i].yaw) >> AP_MOTORS_MATRIX_FACTOR_SHIFT;
+    }
+    low = high = rp_out[0];
+    for (i=1; i<_num_motors; i++) {
+        low = min(low, rp_out[i]);
+        high = max(high, rp_out[i]);
+    }
+    if (high - low > range) {
+        int16_t span = high - low;
+        for (i=0; i<_num_motors; i++) {
+            rp_out[i] = (int32_t)rp_out[i] * range / span;
+        }
+        limit.roll_pitch = true;
+    }
+
+    // then as much yaw as fits alongside roll and pitch. The spread of the
+    // outputs grows with the yaw, so a bisection over a fixed number of steps
+    // finds the largest yaw scale, out of 256, for which it is still in range
+    uint16_t yaw_scale = 256;
+    if (mix_spread(rp_out, yaw_out, yaw_scale) > range) {
+        uint16_t lo = 0, hi = yaw_scale;
+        for (uint8_t step=0; step<AP_MOTORS_MATRIX_DESAT_STEPS; step++) {
+            uint16_t mid = (lo + hi) / 2;
+            if (mix_spread(rp_out, yaw_out, mid) > range) {
+                hi = mid;
+            } else {
+                lo = mid;
             }
         }
+        yaw_scale = lo;
+        limit.yaw = true;
     }
 
-    // send output to each motor
-    for( i=0; i<AP_MOTORS_MAX_NUM_MOTORS; i++ ) {
-        if( motor_enabled[i] ) {
-            hal.rcout->write(_motor_to_channel_map[i], motor_out[i]);
+    // combine them, and find the span that is left for throttle
+    for (i=0; i<_num_motors; i++) {
+        rp_out[i] += ((int32_t)yaw_out[i] * yaw_scale) >> 8;
+    }
+    low = high = rp_out[0];
+    for (i=1; i<_num_motors; i++) {
+        low = min(low, rp_out[i]);
+        high = max(high, rp_out[i]);
+    }
+
+    // throttle last, moved as little as possible off the pilot's request
+    int16_t thr = _rc_throttle->radio_out;
+    if (thr < out_min - low) {
+        thr = out_min - low;
+        limit.throttle = true;
+    } else if (thr > out_max - high) {
+        thr = out_max - high;
+        limit.throttle = true;
+    }
+
+    for (i=0; i<_num_motors; i++) {
+        motor_out[_mix[i].motor_num] = thr + rp_out[i];
+    }
+}
+
+// mix_spread - the difference between the highest and lowest motor with the
+// roll and pitch plus yaw_scale/256 of the yaw
+int16_t AP_MotorsMatrix::mix_spread(const int16_t *rp_out, const int16_t *yaw_out, uint16_t yaw_scale) const
+{
+    int16_t low = 0, high = 0;
+    for (int8_t i=0; i<_num_motors; i++) {
+        int16_t out = rp_out[i] + (((int32_t)yaw_out[i] * yaw_scale) >> 8);
+        if (i == 0 || out < low) {
+            low = out;
+        }
+        if (i == 0 || out > high) {
+            high = out;
         }
     }
+    return high - low;
 }
 
 // output_disarmed - sends commands to the motors
@@ -325,26 +444,58 @@ void AP_MotorsMatrix::output_test()
 
 // add_motor
 void AP_MotorsMatrix::add_motor_raw(int8_t motor_num, float roll_fac, float pitch_fac, float yaw_fac, uint8_t testing_order)
+{
+    add_motor_fixed(
+        motor_num,
+        AP_MOTORS_MATRIX_FACTOR(roll_fac),
+        AP_MOTORS_MATRIX_FACTOR(pitch_fac),
+        AP_MOTORS_MATRIX_FACTOR(yaw_fac),
+        testing_order);
+}
+
+// add_motor_fixed - adds a motor with factors already scaled by AP_MOTORS_MATRIX_FACTOR_SCALE
+void AP_MotorsMatrix::add_motor_fixed(int8_t motor_num, int16_t roll_fac, int16_t pitch_fac, int16_t yaw_fac, uint8_t testing_order)
 {
     // ensure valid motor number is provided
     if( motor_num >= 0 && motor_num < AP_MOTORS_MAX_NUM_MOTORS ) {
 
-        // increment number of motors if this motor is being newly motor_enabled
-        if( !motor_enabled[motor_num] ) {
+        // find the motor's mix entry, or add one if this motor is being newly motor_enabled
+        int8_t i;
+        for( i=0; i<_num_motors; i++ ) {
+            if( _mix[i].motor_num == motor_num ) {
+                break;
+            }
+        }
+        if( i == _num_motors ) {
             motor_enabled[motor_num] = true;
             _num_motors++;
         }
 
         // set roll, pitch, thottle factors and opposite motor (for stability patch)
-        _roll_factor[motor_num] = roll_fac;
-        _pitch_factor[motor_num] = pitch_fac;
-        _yaw_factor[motor_num] = yaw_fac;
+        _mix[i].motor_num = motor_num;
+        _mix[i].roll = roll_fac;
+        _mix[i].pitch = pitch_fac;
+        _mix[i].yaw = yaw_fac;
 
         // set order that motor appears in test
         _test_order[motor_num] = testing_order;
     }
 }
 
+// add_motors_P - adds all the motors of a frame table in PROGMEM, so
+// loading a frame costs no trigonometry
+void AP_MotorsMatrix::add_motors_P(const struct MotorFactors *frame, uint8_t num_motors)
+{
+    for( uint8_t i=0; i<num_motors; i++ ) {
+        add_motor_fixed(
+            (int8_t)pgm_read_byte(&frame[i].motor_num),
+            (int16_t)pgm_read_word(&frame[i].roll),
+            (int16_t)pgm_read_word(&frame[i].pitch),
+            (int16_t)pgm_read_word(&frame[i].yaw),
+            pgm_read_byte(&frame[i].testing_order));
+    }
+}
+
 // add_motor using just position and prop direction
 void AP_MotorsMatrix::add_motor(int8_t motor_num, float angle_degrees, float yaw_factor, uint8_t testing_order)
 {
@@ -364,15 +515,19 @@ void AP_MotorsMatrix::remove_motor(int8_t motor_num)
     // ensure valid motor number is provided
     if( motor_num >= 0 && motor_num < AP_MOTORS_MAX_NUM_MOTORS ) {
 
-        // if the motor was enabled decrement the number of motors
-        if( motor_enabled[motor_num] )
-            _num_motors--;
+        // if the motor was enabled remove its mix entry, keeping the rest packed
+        for( int8_t i=0; i<_num_motors; i++ ) {
+            if( _mix[i].motor_num == motor_num ) {
+                _num_motors--;
+                for( ; i<_num_motors; i++ ) {
+                    _mix[i] = _mix[i+1];
+                }
+                break;
+            }
+        }
 
-        // disable the motor, set all factors to zero
+        // disable the motor
         motor_enabled[motor_num] = false;
-        _roll_factor[motor_num] = 0;
-        _pitch_factor[motor_num] = 0;
-        _yaw_factor[motor_num] = 0;
     }
 }
 
@@ -16,10 +16,30 @@
 
 #define AP_MOTORS_MATRIX_YAW_LOWER_LIMIT_PWM    200
 
+// bisection steps of the priority mixer when yaw has to be cut back,
+// which finds the yaw scale to 1/64
+#define AP_MOTORS_MATRIX_DESAT_STEPS    6
+
+// the mixer factors are fixed point, with 1.0 as 1<<AP_MOTORS_MATRIX_FACTOR_SHIFT
+#define AP_MOTORS_MATRIX_FACTOR_SHIFT   12
+#define AP_MOTORS_MATRIX_FACTOR_SCALE   (1<<AP_MOTORS_MATRIX_FACTOR_SHIFT)
+#define AP_MOTORS_MATRIX_FACTOR(f)      ((int16_t)((f)*AP_MOTORS_MATRIX_FACTOR_SCALE + ((f) < 0 ? -0.5 : 0.5)))
+
+// a row of a frame table, from the roll, pitch and yaw factors of a motor
+#define AP_MOTORS_MATRIX_MOTOR(motor_num, roll_fac, pitch_fac, yaw_fac, testing_order) \
+    { motor_num, AP_MOTORS_MATRIX_FACTOR(roll_fac), AP_MOTORS_MATRIX_FACTOR(pitch_fac), AP_MOTORS_MATRIX_FACTOR(yaw_fac), testing_order }
+
 /// @class      AP_MotorsMatrix
 class AP_MotorsMatrix : public AP_Motors {
 public:
 
+    // one motor of a frame table, which the frames keep in PROGMEM
+    struct MotorFactors {
+        int8_t  motor_num;
+        int16_t roll, pitch, yaw;       // scaled by AP_MOTORS_MATRIX_FACTOR_SCALE
+        uint8_t testing_order;
+    };
+
     /// Constructor
     AP_MotorsMatrix( RC_Channel* rc_roll, RC_Channel* rc_pitch, RC_Channel* rc_throttle, RC_Channel* rc_yaw, uint16_t speed_hz = AP_MOTORS_SPEED_DEFAULT) :
         AP_Motors(rc_roll, rc_pitch, rc_throttle, rc_yaw, speed_hz),
@@ -61,16 +81,30 @@ public:
 
 protected:
     // output - sends commands to the motors
-    virtual void        output_armed();
+    virtual void        output_armed() HOT_FUNC;
     virtual void        output_disarmed();
 
     // add_motor using raw roll, pitch, throttle and yaw factors
     void                add_motor_raw(int8_t motor_num, float roll_fac, float pitch_fac, float yaw_fac, uint8_t testing_order);
 
-    int8_t              _num_motors; // not a very useful variable as you really need to check the motor_enabled array to see which motors are enabled
-    float               _roll_factor[AP_MOTORS_MAX_NUM_MOTORS]; // each motors contribution to roll
-    float               _pitch_factor[AP_MOTORS_MAX_NUM_MOTORS]; // each motors contribution to pitch
-    float               _yaw_factor[AP_MOTORS_MAX_NUM_MOTORS];  // each motors contribution to yaw (normally 1 or -1)
+    // mixers, which fill motor_out[] from the roll, pitch, yaw and throttle pwm
+    void                mix_stability_patch(int16_t out_min, int16_t out_max);
+    void                mix_priority(int16_t out_min, int16_t out_max);
+    int16_t             mix_spread(const int16_t *rp_out, const int16_t *yaw_out, uint16_t yaw_scale) const;
+
+    // add_motors_P - adds the motors of a frame table in PROGMEM
+    void                add_motors_P(const struct MotorFactors *frame, uint8_t num_motors);
+
+    // add_motor_fixed - adds a motor with fixed point factors
+    void                add_motor_fixed(int8_t motor_num, int16_t roll_fac, int16_t pitch_fac, int16_t yaw_fac, uint8_t testing_order);
+
+    int8_t              _num_motors; // number of enabled motors, which is the number of entries in _mix
+
+    // the factors of the enabled motors, packed so the mixer only visits those
+    struct {
+        uint8_t         motor_num;
+        int16_t         roll, pitch, yaw;   // each motors contribution to roll, pitch and yaw (normally 1 or -1), scaled by AP_MOTORS_MATRIX_FACTOR_SCALE
+    }                   _mix[AP_MOTORS_MAX_NUM_MOTORS];
     uint8_t             _test_order[AP_MOTORS_MAX_NUM_MOTORS];  // order of the motors in the test sequence
 };
 
@@ -11,6 +11,42 @@
 
 #include "AP_MotorsOcta.h"
 
+// plus frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors octa_plus_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1,  0.0000,  1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1),  // 0 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2,  0.0000, -1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  5),  // 180 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3, -0.7071,  0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2),  // 45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4, -0.7071, -0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4),  // 135 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_5,  0.7071,  0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 8),  // -45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_6,  0.7071, -0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 6),  // -135 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_7,  1.0000,  0.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  7),  // -90 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_8, -1.0000,  0.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3),  // 90 degrees
+};
+
+// V frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors octa_v_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1,  1.0000,  0.3400, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  7),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2, -1.0000, -0.3200, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3,  1.0000, -0.3200, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 6),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4, -0.5000, -1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_5,  1.0000,  1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 8),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_6, -1.0000,  0.3400, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_7, -1.0000,  1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_8,  0.5000, -1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  5),
+};
+
+// X frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors octa_x_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1, -0.3827,  0.9239, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1),  // 22.5 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2,  0.3827, -0.9239, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  5),  // -157.5 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3, -0.9239,  0.3827, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2),  // 67.5 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4, -0.3827, -0.9239, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4),  // 157.5 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_5,  0.3827,  0.9239, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 8),  // -22.5 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_6,  0.9239, -0.3827, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 6),  // -112.5 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_7,  0.9239,  0.3827, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  7),  // -67.5 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_8, -0.9239, -0.3827, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3),  // 112.5 degrees
+};
+
 // setup_motors - configures the motors for a octa
 void AP_MotorsOcta::setup_motors()
 {
@@ -20,35 +56,14 @@ void AP_MotorsOcta::setup_motors()
     // hard coded config for supported frames
     if( _frame_orientation == AP_MOTORS_PLUS_FRAME ) {
         // plus frame set-up
-        add_motor(AP_MOTORS_MOT_1,    0,  AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1);
-        add_motor(AP_MOTORS_MOT_2,  180,  AP_MOTORS_MATRIX_YAW_FACTOR_CW,  5);
-        add_motor(AP_MOTORS_MOT_3,   45,  AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2);
-        add_motor(AP_MOTORS_MOT_4,  135,  AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4);
-        add_motor(AP_MOTORS_MOT_5,  -45,  AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 8);
-        add_motor(AP_MOTORS_MOT_6, -135,  AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 6);
-        add_motor(AP_MOTORS_MOT_7,  -90,  AP_MOTORS_MATRIX_YAW_FACTOR_CW,  7);
-        add_motor(AP_MOTORS_MOT_8,   90,  AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3);
+        add_motors_P(octa_plus_frame, sizeof(octa_plus_frame)/sizeof(octa_plus_frame[0]));
 
     }else if( _frame_orientation == AP_MOTORS_V_FRAME ) {
         // V frame set-up
-        add_motor_raw(AP_MOTORS_MOT_1,  1.0,  0.34, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  7);
-        add_motor_raw(AP_MOTORS_MOT_2, -1.0, -0.32, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3);
-        add_motor_raw(AP_MOTORS_MOT_3,  1.0, -0.32, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 6);
-        add_motor_raw(AP_MOTORS_MOT_4, -0.5,  -1.0, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4);
-        add_motor_raw(AP_MOTORS_MOT_5,  1.0,   1.0, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 8);
-        add_motor_raw(AP_MOTORS_MOT_6, -1.0,  0.34, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2);
-        add_motor_raw(AP_MOTORS_MOT_7, -1.0,   1.0, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1);
-        add_motor_raw(AP_MOTORS_MOT_8,  0.5,  -1.0, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  5);
+        add_motors_P(octa_v_frame, sizeof(octa_v_frame)/sizeof(octa_v_frame[0]));
 
     }else {
         // X frame set-up
-        add_motor(AP_MOTORS_MOT_1,   22.5, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1);
-        add_motor(AP_MOTORS_MOT_2, -157.5, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  5);
-        add_motor(AP_MOTORS_MOT_3,   67.5, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2);
-        add_motor(AP_MOTORS_MOT_4,  157.5, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4);
-        add_motor(AP_MOTORS_MOT_5,  -22.5, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 8);
-        add_motor(AP_MOTORS_MOT_6, -112.5, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 6);
-        add_motor(AP_MOTORS_MOT_7,  -67.5, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  7);
-        add_motor(AP_MOTORS_MOT_8,  112.5, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3);
+        add_motors_P(octa_x_frame, sizeof(octa_x_frame)/sizeof(octa_x_frame[0]));
     }
 }
\ No newline at end of file
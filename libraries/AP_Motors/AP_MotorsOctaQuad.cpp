@@ -11,6 +11,30 @@
 
 #include "AP_MotorsOctaQuad.h"
 
+// plus frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors octaquad_plus_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1,  0.0000,  1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 1),  // 0 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2,  1.0000,  0.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  7),  // -90 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3,  0.0000, -1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 5),  // 180 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4, -1.0000,  0.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3),  // 90 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_5,  1.0000,  0.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 8),  // -90 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_6,  0.0000,  1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  2),  // 0 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_7, -1.0000,  0.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4),  // 90 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_8,  0.0000, -1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  6),  // 180 degrees
+};
+
+// X frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors octaquad_x_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1, -0.7071,  0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 1),  // 45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2,  0.7071,  0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  7),  // -45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3,  0.7071, -0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 5),  // -135 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4, -0.7071, -0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3),  // 135 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_5,  0.7071,  0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 8),  // -45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_6, -0.7071,  0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  2),  // 45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_7, -0.7071, -0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4),  // 135 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_8,  0.7071, -0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  6),  // -135 degrees
+};
+
 // setup_motors - configures the motors for a octa
 void AP_MotorsOctaQuad::setup_motors()
 {
@@ -20,23 +44,9 @@ void AP_MotorsOctaQuad::setup_motors()
     // hard coded config for supported frames
     if( _frame_orientation == AP_MOTORS_PLUS_FRAME ) {
         // plus frame set-up
-        add_motor(AP_MOTORS_MOT_1,    0, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 1);
-        add_motor(AP_MOTORS_MOT_2,  -90, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  7);
-        add_motor(AP_MOTORS_MOT_3,  180, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 5);
-        add_motor(AP_MOTORS_MOT_4,   90, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3);
-        add_motor(AP_MOTORS_MOT_5,  -90, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 8);
-        add_motor(AP_MOTORS_MOT_6,    0, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  2);
-        add_motor(AP_MOTORS_MOT_7,   90, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4);
-        add_motor(AP_MOTORS_MOT_8,  180, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  6);
+        add_motors_P(octaquad_plus_frame, sizeof(octaquad_plus_frame)/sizeof(octaquad_plus_frame[0]));
     }else{
         // X frame set-up
-        add_motor(AP_MOTORS_MOT_1,   45, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 1);
-        add_motor(AP_MOTORS_MOT_2,  -45, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  7);
-        add_motor(AP_MOTORS_MOT_3, -135, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 5);
-        add_motor(AP_MOTORS_MOT_4,  135, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3);
-        add_motor(AP_MOTORS_MOT_5,  -45, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 8);
-        add_motor(AP_MOTORS_MOT_6,   45, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  2);
-        add_motor(AP_MOTORS_MOT_7,  135, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4);
-        add_motor(AP_MOTORS_MOT_8, -135, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  6);
+        add_motors_P(octaquad_x_frame, sizeof(octaquad_x_frame)/sizeof(octaquad_x_frame[0]));
     }
 }
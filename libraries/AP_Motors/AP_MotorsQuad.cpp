@@ -11,6 +11,38 @@
 
 #include "AP_MotorsQuad.h"
 
+// plus frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors quad_plus_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1, -1.0000,  0.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2),  // 90 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2,  1.0000,  0.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4),  // -90 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3,  0.0000,  1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1),  // 0 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4,  0.0000, -1.0000, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3),  // 180 degrees
+};
+
+// V frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors quad_v_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1, -0.7071,  0.7071,  0.7981, 1),  // 45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2,  0.7071, -0.7071,  1.0000, 3),  // -135 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3,  0.7071,  0.7071, -0.7981, 4),  // -45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4, -0.7071, -0.7071, -1.0000, 2),  // 135 degrees
+};
+
+// H frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors quad_h_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1, -0.7071,  0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1),  // 45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2,  0.7071, -0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3),  // -135 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3,  0.7071,  0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4),  // -45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4, -0.7071, -0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2),  // 135 degrees
+};
+
+// X frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors quad_x_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1, -0.7071,  0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 1),  // 45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2,  0.7071, -0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 3),  // -135 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3,  0.7071,  0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  4),  // -45 degrees
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4, -0.7071, -0.7071, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  2),  // 135 degrees
+};
+
 // setup_motors - configures the motors for a quad
 void AP_MotorsQuad::setup_motors()
 {
@@ -20,30 +52,18 @@ void AP_MotorsQuad::setup_motors()
     // hard coded config for supported frames
     if( _frame_orientation == AP_MOTORS_PLUS_FRAME ) {
         // plus frame set-up
-        add_motor(AP_MOTORS_MOT_1,  90, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2);
-        add_motor(AP_MOTORS_MOT_2, -90, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4);
-        add_motor(AP_MOTORS_MOT_3,   0, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1);
-        add_motor(AP_MOTORS_MOT_4, 180, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3);
+        add_motors_P(quad_plus_frame, sizeof(quad_plus_frame)/sizeof(quad_plus_frame[0]));
 
     }else if( _frame_orientation == AP_MOTORS_V_FRAME ) {
         // V frame set-up
-        add_motor(AP_MOTORS_MOT_1,   45,  0.7981,  1);
-        add_motor(AP_MOTORS_MOT_2, -135,  1.0000,  3);
-        add_motor(AP_MOTORS_MOT_3,  -45, -0.7981,  4);
-        add_motor(AP_MOTORS_MOT_4,  135, -1.0000,  2);
+        add_motors_P(quad_v_frame, sizeof(quad_v_frame)/sizeof(quad_v_frame[0]));
 
     }else if( _frame_orientation == AP_MOTORS_H_FRAME ) {
         // H frame set-up - same as X but motors spin in opposite directiSons
-        add_motor(AP_MOTORS_MOT_1,   45, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1);
-        add_motor(AP_MOTORS_MOT_2, -135, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  3);
-        add_motor(AP_MOTORS_MOT_3,  -45, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 4);
-        add_motor(AP_MOTORS_MOT_4,  135, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2);
+        add_motors_P(quad_h_frame, sizeof(quad_h_frame)/sizeof(quad_h_frame[0]));
 
     }else{
         // X frame set-up
-        add_motor(AP_MOTORS_MOT_1,   45, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 1);
-        add_motor(AP_MOTORS_MOT_2, -135, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 3);
-        add_motor(AP_MOTORS_MOT_3,  -45, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  4);
-        add_motor(AP_MOTORS_MOT_4,  135, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  2);
+        add_motors_P(quad_x_frame, sizeof(quad_x_frame)/sizeof(quad_x_frame[0]));
     }
 }
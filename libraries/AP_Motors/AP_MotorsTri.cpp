@@ -41,6 +41,9 @@ void AP_MotorsTri::set_update_rate( uint16_t speed_hz )
 	    1U << _motor_to_channel_map[AP_MOTORS_MOT_2] |
 	    1U << _motor_to_channel_map[AP_MOTORS_MOT_4];
     hal.rcout->set_freq(mask, _speed_hz);
+
+    // short pulse ESCs, if the board can drive them
+    hal.rcout->set_oneshot(_oneshot ? mask : 0);
 }
 
 // enable - starts allowing signals to be sent to motors
@@ -125,12 +128,10 @@ void AP_MotorsTri::output_armed()
             motor_out[AP_MOTORS_MOT_4] = out_max;
         }
 
-        // adjust for throttle curve
-        if( _throttle_curve_enabled ) {
-            motor_out[AP_MOTORS_MOT_1] = _throttle_curve.get_y(motor_out[AP_MOTORS_MOT_1]);
-            motor_out[AP_MOTORS_MOT_2] = _throttle_curve.get_y(motor_out[AP_MOTORS_MOT_2]);
-            motor_out[AP_MOTORS_MOT_4] = _throttle_curve.get_y(motor_out[AP_MOTORS_MOT_4]);
-        }
+        // adjust for battery voltage and throttle curve
+        motor_out[AP_MOTORS_MOT_1] = linearise_output(motor_out[AP_MOTORS_MOT_1]);
+        motor_out[AP_MOTORS_MOT_2] = linearise_output(motor_out[AP_MOTORS_MOT_2]);
+        motor_out[AP_MOTORS_MOT_4] = linearise_output(motor_out[AP_MOTORS_MOT_4]);
 
         // ensure motors don't drop below a minimum value and stop
         motor_out[AP_MOTORS_MOT_1] = max(motor_out[AP_MOTORS_MOT_1],    out_min);
@@ -138,7 +139,8 @@ void AP_MotorsTri::output_armed()
         motor_out[AP_MOTORS_MOT_4] = max(motor_out[AP_MOTORS_MOT_4],    out_min);
     }
 
-    // send output to each motor
+    // send output to each motor, latched so they all change together
+    hal.rcout->cork();
     hal.rcout->write(_motor_to_channel_map[AP_MOTORS_MOT_1], motor_out[AP_MOTORS_MOT_1]);
     hal.rcout->write(_motor_to_channel_map[AP_MOTORS_MOT_2], motor_out[AP_MOTORS_MOT_2]);
     hal.rcout->write(_motor_to_channel_map[AP_MOTORS_MOT_4], motor_out[AP_MOTORS_MOT_4]);
@@ -152,6 +154,7 @@ void AP_MotorsTri::output_armed()
     }else{
         hal.rcout->write(AP_MOTORS_CH_TRI_YAW, _rc_yaw->radio_out);
     }
+    hal.rcout->push();
 }
 
 // output_disarmed - sends commands to the motors
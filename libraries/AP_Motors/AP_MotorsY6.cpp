@@ -11,6 +11,16 @@
 
 #include "AP_MotorsY6.h"
 
+// MultiWii Y6 frame: motor, roll, pitch and yaw factors, test order
+static const AP_MotorsMatrix::MotorFactors y6_frame[] PROGMEM = {
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_1, -1.0000,  0.6660, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_2,  1.0000,  0.6660, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  5),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_3,  1.0000,  0.6660, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 6),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_4,  0.0000, -1.3330, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  4),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_5, -1.0000,  0.6660, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1),
+    AP_MOTORS_MATRIX_MOTOR(AP_MOTORS_MOT_6,  0.0000, -1.3330, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 3),
+};
+
 // setup_motors - configures the motors for a hexa
 void AP_MotorsY6::setup_motors()
 {
@@ -18,10 +28,5 @@ void AP_MotorsY6::setup_motors()
     AP_MotorsMatrix::setup_motors();
 
     // MultiWii set-up
-    add_motor_raw(AP_MOTORS_MOT_1, -1.0,  0.666, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 2);
-    add_motor_raw(AP_MOTORS_MOT_2,  1.0,  0.666, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  5);
-    add_motor_raw(AP_MOTORS_MOT_3,  1.0,  0.666, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 6);
-    add_motor_raw(AP_MOTORS_MOT_4,  0.0, -1.333, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  4);
-    add_motor_raw(AP_MOTORS_MOT_5, -1.0,  0.666, AP_MOTORS_MATRIX_YAW_FACTOR_CW,  1);
-    add_motor_raw(AP_MOTORS_MOT_6,  0.0, -1.333, AP_MOTORS_MATRIX_YAW_FACTOR_CCW, 3);
+    add_motors_P(y6_frame, sizeof(y6_frame)/sizeof(y6_frame[0]));
 }
\ No newline at end of file
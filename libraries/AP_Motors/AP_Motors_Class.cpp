@@ -41,6 +41,32 @@ const AP_Param::GroupInfo AP_Motors::var_info[] PROGMEM = {
     // @Values: 0:Do Not Spin,50:Slow,85:Medium,120:Fast
     AP_GROUPINFO("SPIN_ARMED", 4, AP_Motors, _spin_when_armed, AP_MOTORS_SPIN_WHEN_ARMED),
 
+    // @Param: ONESHOT
+    // @DisplayName: OneShot125 ESCs
+    // @Description: Drive the motors with OneShot125 pulses of 125 to 250us, started as soon as the outputs are updated. Only for ESCs which support it, and only on boards which can output it. Takes effect after a reboot
+    // @Values: 0:Disabled,1:Enabled
+    AP_GROUPINFO("ONESHOT", 5, AP_Motors, _oneshot, AP_MOTORS_ONESHOT),
+
+    // @Param: MIX_MODE
+    // @DisplayName: Matrix mixer
+    // @Description: How multicopter frames share out the motors when they saturate. The stability patch moves the throttle to make room for roll, pitch and yaw. Priority keeps roll and pitch first, then yaw, then throttle, and tells the rate controllers which axes were cut so their integrators stop winding up
+    // @Values: 0:Stability patch,1:Priority
+    AP_GROUPINFO("MIX_MODE", 6, AP_Motors, _mix_mode, AP_MOTORS_MIX_STABILITY_PATCH),
+
+    // @Param: BAT_VOLT_MAX
+    // @DisplayName: Battery voltage compensation maximum voltage
+    // @Description: Voltage of a full battery. As the battery sags the motor outputs are raised by BAT_VOLT_MAX over the battery voltage, so the thrust for a given demand, and so the tuning, stays the same. 0 disables the compensation
+    // @Range: 0 35
+    // @Units: Volts
+    AP_GROUPINFO("BAT_VOLT_MAX", 7, AP_Motors, _batt_voltage_max, AP_MOTORS_BAT_VOLT_MAX_DEFAULT),
+
+    // @Param: BAT_VOLT_MIN
+    // @DisplayName: Battery voltage compensation minimum voltage
+    // @Description: Voltage of an empty battery, below which the compensation stops rising. Must be below BAT_VOLT_MAX
+    // @Range: 0 35
+    // @Units: Volts
+    AP_GROUPINFO("BAT_VOLT_MIN", 8, AP_Motors, _batt_voltage_min, AP_MOTORS_BAT_VOLT_MIN_DEFAULT),
+
     AP_GROUPEND
 };
 
@@ -55,7 +81,11 @@ AP_Motors::AP_Motors( RC_Channel* rc_roll, RC_Channel* rc_pitch, RC_Channel* rc_
     _frame_orientation(0),
     _min_throttle(AP_MOTORS_DEFAULT_MIN_THROTTLE),
     _max_throttle(AP_MOTORS_DEFAULT_MAX_THROTTLE),
-    _hover_out(AP_MOTORS_DEFAULT_MID_THROTTLE)
+    _hover_out(AP_MOTORS_DEFAULT_MID_THROTTLE),
+    _batt_voltage_filt(0),
+    _batt_gain(1U<<AP_MOTORS_BAT_GAIN_SHIFT),
+    _sample_time_us(0),
+    _output_latency_us(0)
 {
     uint8_t i;
 
@@ -87,6 +117,19 @@ void AP_Motors::set_min_throttle(uint16_t min_throttle)
     _min_throttle = (float)min_throttle * (_rc_throttle->radio_max - _rc_throttle->radio_min) / 1000.0f;
 }
 
+// output - sends commands to the motors. The time from the IMU
+// samples to the armed output having been pushed out is the latency
+// of the control loop
+void AP_Motors::output()
+{
+    if( _armed ) {
+        output_armed();
+        _output_latency_us = hal.scheduler->micros() - _sample_time_us;
+    }else{
+        output_disarmed();
+    }
+}
+
 // set_mid_throttle - sets the mid throttle which is close to the hover throttle of the copter
 // this is used to limit the amount that the stability patch will increase the throttle to give more room for roll, pitch and yaw control
 void AP_Motors::set_mid_throttle(uint16_t mid_throttle)
@@ -94,6 +137,42 @@ void AP_Motors::set_mid_throttle(uint16_t mid_throttle)
     _hover_out = _rc_throttle->radio_min + (float)(_rc_throttle->radio_max - _rc_throttle->radio_min) * mid_throttle / 1000.0f;
 }
 
+// set_voltage - feeds the battery voltage to the output compensation,
+// which works out its gain here so the per motor cost is one multiply
+void AP_Motors::set_voltage(float volts)
+{
+    if (_batt_voltage_max <= 0 || _batt_voltage_min >= _batt_voltage_max || volts <= 0) {
+        // compensation disabled, or no battery monitor
+        _batt_voltage_filt = 0;
+        _batt_gain = 1U<<AP_MOTORS_BAT_GAIN_SHIFT;
+        return;
+    }
+
+    volts = constrain_float(volts, _batt_voltage_min, _batt_voltage_max);
+    if (_batt_voltage_filt <= 0) {
+        _batt_voltage_filt = volts;
+    }else{
+        _batt_voltage_filt += (volts - _batt_voltage_filt) * AP_MOTORS_BAT_VOLT_FILT;
+    }
+    _batt_gain = (_batt_voltage_max / _batt_voltage_filt) * (1U<<AP_MOTORS_BAT_GAIN_SHIFT);
+}
+
+// linearise_output - maps a motor's thrust demand in pwm to the pwm to send
+int16_t AP_Motors::linearise_output(int16_t pwm)
+{
+    // raise the demand above the bottom of the throttle range as the battery sags
+    if (_batt_gain != (1U<<AP_MOTORS_BAT_GAIN_SHIFT)) {
+        int16_t min_pwm = _rc_throttle->radio_min;
+        pwm = min_pwm + (((int32_t)(pwm - min_pwm) * _batt_gain) >> AP_MOTORS_BAT_GAIN_SHIFT);
+    }
+
+    // then straighten the thrust of the motors with the throttle curve lookup
+    if (_throttle_curve_enabled) {
+        pwm = _throttle_curve.get_y(pwm);
+    }
+    return pwm;
+}
+
 // throttle_pass_through - passes pilot's throttle input directly to all motors - dangerous but used for initialising ESCs
 void AP_Motors::throttle_pass_through()
 {
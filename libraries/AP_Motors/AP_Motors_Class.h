@@ -47,6 +47,18 @@
 
 #define AP_MOTORS_SPIN_WHEN_ARMED   0   // spin motors when armed disabled by default
 
+#define AP_MOTORS_ONESHOT           0   // normal PWM to the ESCs by default
+
+// mixers of the matrix frames
+#define AP_MOTORS_MIX_STABILITY_PATCH   0   // moves the throttle to make room for roll, pitch and yaw
+#define AP_MOTORS_MIX_PRIORITY          1   // gives up throttle, then yaw, before roll and pitch
+
+// battery voltage compensation
+#define AP_MOTORS_BAT_VOLT_MAX_DEFAULT  0       // voltage of a full battery, 0 disables the compensation
+#define AP_MOTORS_BAT_VOLT_MIN_DEFAULT  0       // voltage below which the compensation stops rising
+#define AP_MOTORS_BAT_VOLT_FILT         0.1f    // low pass filter on the voltage, about 1s at 10hz
+#define AP_MOTORS_BAT_GAIN_SHIFT        12      // the gain is fixed point, with 1.0 as 1<<AP_MOTORS_BAT_GAIN_SHIFT
+
 // bit mask for recording which limits we have reached when outputting to motors
 #define AP_MOTOR_NO_LIMITS_REACHED  0x00
 #define AP_MOTOR_ROLLPITCH_LIMIT    0x01
@@ -97,9 +109,13 @@ public:
     void                set_mid_throttle(uint16_t mid_throttle);
 
     // output - sends commands to the motors
-    void        output() {
-        if( _armed ) { output_armed(); }else{ output_disarmed(); }
-    };
+    void        output();
+
+    // set_sample_time - the micros() capture time of the IMU samples the next output is worked out from
+    void        set_sample_time(uint32_t sample_us) { _sample_time_us = sample_us; }
+
+    // get_output_latency - micros from the capture of the IMU samples to the last armed output being sent
+    uint32_t    get_output_latency() const { return _output_latency_us; }
 
     // output_min - sends minimum values out to the motors
     virtual void        output_min() = 0;
@@ -110,6 +126,9 @@ public:
     // throttle_pass_through - passes pilot's throttle input directly to all motors - dangerous but used for initialising ESCs
     virtual void        throttle_pass_through();
 
+    // set_voltage - feeds the battery voltage to the output compensation, expected at around 10hz
+    void                set_voltage(float volts);
+
 	// setup_throttle_curve - used to linearlise thrust output by motors
     //      returns true if curve is created successfully
 	bool                setup_throttle_curve();
@@ -138,6 +157,10 @@ protected:
     virtual void        output_disarmed() {
     };
 
+    // linearise_output - the output stage, which maps a motor's thrust demand in pwm to the pwm to send: the battery voltage
+    // compensation followed by the throttle curve, both cheap enough to run on every motor every loop
+    int16_t             linearise_output(int16_t pwm);
+
     RC_Channel*         _rc_roll, *_rc_pitch, *_rc_throttle, *_rc_yaw;  // input in from users
     uint8_t             _motor_to_channel_map[AP_MOTORS_MAX_NUM_MOTORS];        // mapping of motor number (as received from upper APM code) to RC channel output - used to account for differences between APM1 and APM2
     uint16_t            _speed_hz;                      // speed in hz to send updates to motors
@@ -154,5 +177,13 @@ protected:
     int16_t             _hover_out;                     // the estimated hover throttle in pwm (i.e. 1000 ~ 2000).  calculated from the THR_MID parameter
 
     AP_Int8             _spin_when_armed;       // used to control whether the motors always spin when armed.  pwm value above radio_min 
+    AP_Int8             _oneshot;               // 1 if the ESCs take OneShot125 pulses
+    AP_Int8             _mix_mode;              // AP_MOTORS_MIX_STABILITY_PATCH or AP_MOTORS_MIX_PRIORITY
+    AP_Float            _batt_voltage_max;      // voltage of a full battery, at which the compensation does nothing
+    AP_Float            _batt_voltage_min;      // voltage at which the compensation is largest
+    float               _batt_voltage_filt;     // filtered battery voltage
+    uint16_t            _batt_gain;             // voltage compensation gain, 1.0 is 1<<AP_MOTORS_BAT_GAIN_SHIFT
+    uint32_t            _sample_time_us;        // capture time of the IMU samples behind the next output
+    uint32_t            _output_latency_us;     // from the samples to the last armed output
 };
 #endif  // __AP_MOTORS_CLASS_H__
@@ -216,7 +216,7 @@ const AP_Param::GroupInfo AP_Mount::var_info[] PROGMEM = {
     AP_GROUPEND
 };
 
-AP_Mount::AP_Mount(const struct Location *current_loc, GPS *&gps, AP_AHRS *ahrs, uint8_t id) :
+AP_Mount::AP_Mount(const struct Position *current_loc, GPS *&gps, AP_AHRS *ahrs, uint8_t id) :
     _gps(gps)
 {
 	AP_Param::setup_object_defaults(this, var_info);
@@ -231,6 +231,10 @@ AP_Mount::AP_Mount(const struct Location *current_loc, GPS *&gps, AP_AHRS *ahrs,
     // default unknown mount type
     _mount_type = k_unknown;
 
+    _roi_valid = false;
+    _cam_valid = false;
+    _servo_out_valid = 0;
+
 #if MNT_MOUNT2_OPTION == ENABLED
     if (id == 0) {
 #endif
@@ -268,6 +272,10 @@ AP_Mount::update_mount_type()
     if (have_pan && have_tilt && have_roll) {
         _mount_type = k_pan_tilt_roll;
     }
+
+    // the servo functions or ranges may have changed, so write all the
+    // outputs again
+    _servo_out_valid = 0;
 }
 
 /// sets the servo angles for retraction, note angles are in degrees
@@ -292,6 +300,7 @@ void AP_Mount::set_control_angles(float roll, float tilt, float pan)
 void AP_Mount::set_GPS_target_location(Location targetGPSLocation)
 {
     _target_GPS_location=targetGPSLocation;
+    _roi_valid = false;
 }
 
 /// This one should be called periodically
@@ -404,9 +413,9 @@ void AP_Mount::update_mount_position()
 #endif
 
     // write the results to the servos
-    move_servo(_roll_idx, _roll_angle*10, _roll_angle_min*0.1f, _roll_angle_max*0.1f);
-    move_servo(_tilt_idx, _tilt_angle*10, _tilt_angle_min*0.1f, _tilt_angle_max*0.1f);
-    move_servo(_pan_idx,  _pan_angle*10,  _pan_angle_min*0.1f,  _pan_angle_max*0.1f);
+    update_servo(0, _roll_idx, _roll_angle, _roll_angle_min, _roll_angle_max);
+    update_servo(1, _tilt_idx, _tilt_angle, _tilt_angle_min, _tilt_angle_max);
+    update_servo(2, _pan_idx,  _pan_angle,  _pan_angle_min,  _pan_angle_max);
 }
 
 void AP_Mount::set_mode(enum MAV_MOUNT_MODE mode)
@@ -537,6 +546,7 @@ void AP_Mount::set_roi_cmd(const struct Location *target_loc)
 #if MNT_GPSPOINT_OPTION == ENABLED
     // set the target gps location
     _target_GPS_location = *target_loc;
+    _roi_valid = false;
 
     // set the mode to GPS tracking mode
     set_mode(MAV_MOUNT_MODE_GPS_POINT);
@@ -570,8 +580,22 @@ AP_Mount::angle_input_rad(RC_Channel* rc, int16_t angle_min, int16_t angle_max)
 }
 
 void
-AP_Mount::calc_GPS_target_angle(const struct Location *target)
+AP_Mount::calc_GPS_target_angle(const struct Position *target)
 {
+    // the angles only change when the vehicle or the target move
+    if (_roi_valid &&
+        _roi_vehicle_loc.lat == _current_loc->lat &&
+        _roi_vehicle_loc.lng == _current_loc->lng &&
+        _roi_vehicle_loc.alt == _current_loc->alt &&
+        _roi_target_loc.lat == target->lat &&
+        _roi_target_loc.lng == target->lng &&
+        _roi_target_loc.alt == target->alt) {
+        return;
+    }
+    _roi_vehicle_loc = *_current_loc;
+    _roi_target_loc = *target;
+    _roi_valid = true;
+
     float GPS_vector_x = (target->lng-_current_loc->lng)*cosf(ToRad((_current_loc->lat+target->lat)*0.00000005f))*0.01113195f;
     float GPS_vector_y = (target->lat-_current_loc->lat)*0.01113195f;
     float GPS_vector_z = (target->alt-_current_loc->alt);                 // baro altitude(IN CM) should be adjusted to known home elevation before take off (Set altimeter).
@@ -597,17 +621,36 @@ AP_Mount::stabilize()
     if (_ahrs) {
         // only do the full 3D frame transform if we are doing pan control
         if (_stab_pan) {
-            Matrix3f m;                         ///< holds 3 x 3 matrix, var is used as temp in calcs
-            Matrix3f cam;                       ///< Rotation matrix earth to camera. Desired camera from input.
-            Matrix3f gimbal_target;             ///< Rotation matrix from plane to camera. Then Euler angles to the servos.
-            m = _ahrs->get_dcm_matrix();
-            m.transpose();
-            cam.from_euler(_roll_control_angle, _tilt_control_angle, _pan_control_angle);
-            gimbal_target = m * cam;
-            gimbal_target.to_euler(&_roll_angle, &_tilt_angle, &_pan_angle);
-            _roll_angle  = _stab_roll ? degrees(_roll_angle) : degrees(_roll_control_angle);
-            _tilt_angle  = _stab_tilt ? degrees(_tilt_angle) : degrees(_tilt_control_angle);
-            _pan_angle   = degrees(_pan_angle);
+            // the rotation from the vehicle to the camera is the
+            // transposed DCM times the earth to camera rotation. Only
+            // the elements the euler angles need are worked out, each
+            // a column of the DCM dotted with a column of the camera
+            // rotation, which is only rebuilt when the requested
+            // angles change
+            Vector3f angles(_roll_control_angle, _tilt_control_angle, _pan_control_angle);
+            if (!_cam_valid || angles != _cam_angles) {
+                Matrix3f cam;
+                cam.from_euler(angles.x, angles.y, angles.z);
+                _cam_t = cam.transposed();
+                _cam_angles = angles;
+                _cam_valid = true;
+            }
+            const Matrix3f &m = _ahrs->get_dcm_matrix();
+            Vector3f m_col0(m.a.x, m.b.x, m.c.x);
+            Vector3f m_col1(m.a.y, m.b.y, m.c.y);
+            Vector3f m_col2(m.a.z, m.b.z, m.c.z);
+            float c_x = m_col2 * _cam_t.a;
+            if (_stab_roll) {
+                _roll_angle = degrees(atan2f(m_col2 * _cam_t.b, m_col2 * _cam_t.c));
+            } else {
+                _roll_angle = degrees(_roll_control_angle);
+            }
+            if (_stab_tilt) {
+                _tilt_angle = degrees(-safe_asin(c_x));
+            } else {
+                _tilt_angle = degrees(_tilt_control_angle);
+            }
+            _pan_angle   = degrees(atan2f(m_col1 * _cam_t.a, m_col0 * _cam_t.a));
         } else {
             // otherwise base mount roll and tilt on the ahrs
             // roll/tilt attitude, plus any requested angle
@@ -693,6 +736,21 @@ AP_Mount::closest_limit(int16_t angle, int16_t* angle_min, int16_t* angle_max)
     return angle;
 }
 
+/// write a servo output if it has changed since it was last written.
+/// angle is in degrees, the limits in degrees * 100
+void
+AP_Mount::update_servo(uint8_t axis, uint8_t function_idx, float angle, int16_t angle_min, int16_t angle_max)
+{
+    int16_t out = angle*10;
+    uint8_t bit = 1<<axis;
+    if ((_servo_out_valid & bit) && out == _servo_out[axis]) {
+        return;
+    }
+    _servo_out[axis] = out;
+    _servo_out_valid |= bit;
+    move_servo(function_idx, out, angle_min*0.1f, angle_max*0.1f);
+}
+
 /// all angles are degrees * 10 units
 void
 AP_Mount::move_servo(uint8_t function_idx, int16_t angle, int16_t angle_min, int16_t angle_max)
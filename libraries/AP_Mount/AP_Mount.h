@@ -32,7 +32,7 @@ class AP_Mount
 {
 public:
     //Constructor
-    AP_Mount(const struct Location *current_loc, GPS *&gps, AP_AHRS *ahrs, uint8_t id);
+    AP_Mount(const struct Position *current_loc, GPS *&gps, AP_AHRS *ahrs, uint8_t id);
 
     //enums
     enum MountType {
@@ -72,17 +72,18 @@ private:
     void                            set_GPS_target_location(Location targetGPSLocation); ///< used to tell the mount to track GPS location
 
     // internal methods
-    void                            calc_GPS_target_angle(const struct Location *target);
+    void                            calc_GPS_target_angle(const struct Position *target);
     void                            stabilize();
     int16_t                         closest_limit(int16_t angle, int16_t* angle_min, int16_t* angle_max);
     void                            move_servo(uint8_t rc, int16_t angle, int16_t angle_min, int16_t angle_max);
+    void                            update_servo(uint8_t axis, uint8_t function_idx, float angle, int16_t angle_min, int16_t angle_max);
     int32_t                         angle_input(RC_Channel* rc, int16_t angle_min, int16_t angle_max);
     float                           angle_input_rad(RC_Channel* rc, int16_t angle_min, int16_t angle_max);
 
     //members
     AP_AHRS *                       _ahrs; ///< Rotation matrix from earth to plane.
     GPS *&                          _gps;
-    const struct Location *         _current_loc;
+    const struct Position *         _current_loc;
     struct Location                 _target_GPS_location;
     MountType                       _mount_type;
 
@@ -99,6 +100,22 @@ private:
     float                           _tilt_angle; ///< degrees
     float                           _pan_angle;  ///< degrees
 
+    // the vehicle and target locations the GPS point angles were worked out for
+    struct Position                 _roi_vehicle_loc;
+    struct Position                 _roi_target_loc;
+    bool                            _roi_valid;
+
+    // transpose of the earth to camera rotation for the control angles,
+    // kept until they change
+    Matrix3f                        _cam_t;
+    Vector3f                        _cam_angles; ///< radians, roll tilt pan
+    bool                            _cam_valid;
+
+    // servo outputs in degrees * 10 as last written, a bit per axis in
+    // _servo_out_valid. Outputs are only written when they change
+    int16_t                         _servo_out[3];
+    uint8_t                         _servo_out_valid;
+
     // EEPROM parameters
     AP_Int8                         _stab_roll; ///< (1 = yes, 0 = no)
     AP_Int8                         _stab_tilt; ///< (1 = yes, 0 = no)
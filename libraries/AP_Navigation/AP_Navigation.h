@@ -57,7 +57,7 @@ public:
 	// main flight code will call an output function (such as
 	// nav_roll_cd()) after this function to ask for the new required
 	// navigation attitude/steering.
-	virtual void update_waypoint(const struct Location &prev_WP, const struct Location &next_WP) = 0;
+	virtual void update_waypoint(const struct Position &prev_WP, const struct Position &next_WP) = 0;
 
 	// update the internal state of the navigation controller for when
 	// the vehicle has been commanded to circle about a point.  This
@@ -66,7 +66,7 @@ public:
 	// main flight code will call an output function (such as
 	// nav_roll_cd()) after this function to ask for the new required
 	// navigation attitude/steering.
-	virtual void update_loiter(const struct Location &center_WP, float radius, int8_t loiter_direction) = 0;
+	virtual void update_loiter(const struct Position &center_WP, float radius, int8_t loiter_direction) = 0;
 
 	// update the internal state of the navigation controller, given a
 	// fixed heading. This is the step function for navigation control
@@ -88,12 +88,16 @@ void AP_OpticalFlow::update_conversion_factors()
     // 162.99
 }
 
-// updates internal lon and lat with estimation based on optical flow
-void AP_OpticalFlow::update_position(float roll, float pitch,
-        float sin_yaw, float cos_yaw, float altitude)
+// updates the body frame movement and velocity over the ground from
+// the latest reading. The earth frame is left to the caller, which
+// already has the yaw rotation to hand
+void AP_OpticalFlow::update_velocity(float roll, float pitch, float altitude)
 {
     float diff_roll     = roll  - _last_roll;
     float diff_pitch    = pitch - _last_pitch;
+    float dt = (last_update - _last_velocity_update) * 0.001f;
+
+    vel_ok = false;
 
     // only update position if surface quality is good and angle is not
     // over 45 degrees
@@ -118,12 +122,17 @@ void AP_OpticalFlow::update_position(float roll, float pitch,
         // appear farther away and motion from opt flow sensor will be less
         y_cm = -change_y * avg_altitude * conv_factor;
 
-        // convert x/y movements into lon/lat movement
-        vlon = x_cm * cos_yaw + y_cm * sin_yaw;
-        vlat = y_cm * cos_yaw - x_cm * sin_yaw;
+        // x is to the right and y forward. Readings more than a few
+        // updates apart can't give a velocity
+        if( dt > 0 && dt < 0.2f ) {
+            vel_forward = y_cm / dt;
+            vel_right = x_cm / dt;
+            vel_ok = true;
+        }
     }
 
     _last_altitude = altitude;
     _last_roll = roll;
     _last_pitch = pitch;
+    _last_velocity_update = last_update;
 }
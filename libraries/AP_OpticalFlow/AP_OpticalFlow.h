@@ -54,8 +54,9 @@ public:
     // read latest values from sensor and fill in x,y and totals.
     virtual void    update(uint32_t now);
 
-    // updates internal lon and lat with estimation based on optical flow
-    virtual void    update_position(float roll, float pitch, float sin_yaw, float cos_yaw, float altitude);
+    // updates the body frame movement and velocity over the ground from
+    // the latest reading. roll and pitch are in radians, altitude in cm
+    virtual void    update_velocity(float roll, float pitch, float altitude);
 
     // public variables
     int16_t  raw_dx;            // raw sensor change in x and y position (i.e. unrotated)
@@ -63,7 +64,9 @@ public:
     uint8_t  surface_quality;   // image quality (below 15 you really can't trust the x,y values returned)
     int16_t  x,y;               // total x,y position
     int16_t  dx,dy;             // rotated change in x and y position
-    float    vlon, vlat;        // position as offsets from original position
+    float    vel_forward;       // velocity over the ground in cm/s, forward in the body frame
+    float    vel_right;         // velocity over the ground in cm/s, right in the body frame
+    bool     vel_ok;            // true if the last update's velocity can be trusted
     uint32_t last_update;       // millis() time of last update
     float    field_of_view;     // field of view in Radians
     float    scaler;            // number returned from sensor when moved one pixel
@@ -86,6 +89,7 @@ protected:
     float _last_roll;
     float _last_pitch;
     float _last_altitude;
+    uint32_t _last_velocity_update;     // last_update of the reading the velocity was found from
     // rotate raw values to arrive at final x,y,dx and dy values
     virtual void apply_orientation_matrix();
     virtual void update_conversion_factors();
@@ -167,6 +167,45 @@ void AP_OpticalFlow_ADNS3080::write_register(uint8_t address, uint8_t value)
     spi_sem->give();
 }
 
+// read_motion_burst - reads the motion, delta x, delta y and squal
+// registers in one motion burst, which needs only one wait for the
+// sensor where reading them separately needs one each. Returns false if
+// the bus was busy
+bool AP_OpticalFlow_ADNS3080::read_motion_burst(uint8_t *buf)
+{
+    AP_HAL::Semaphore *spi_sem;
+
+    // check that we have an spi bus
+    if (_spi == NULL) {
+        return false;
+    }
+
+    // get spi bus semaphore
+    spi_sem = _spi->get_semaphore();
+
+    // try to get control of the spi bus
+    if (spi_sem == NULL || !spi_sem->take_nonblocking()) {
+        return false;
+    }
+
+    _spi->cs_assert();
+    _spi->transfer(ADNS3080_MOTION_BURST);
+    // the sensor needs 75us before the first byte. The burst can't be
+    // made as one batch of segments as the wait has to be inside it
+    hal.scheduler->delay_microseconds(75);
+    for (uint8_t i=0; i<ADNS3080_MOTION_BURST_LEN; i++) {
+        buf[i] = _spi->transfer(0x00);
+    }
+    // raising chip select ends the burst early, before the shutter
+    // and maximum pixel registers
+    _spi->cs_release();
+
+    // release the spi bus
+    spi_sem->give();
+
+    return true;
+}
+
 // reset sensor by holding a pin high (or is it low?) for 10us.
 void
 AP_OpticalFlow_ADNS3080::reset()
@@ -186,18 +225,23 @@ AP_OpticalFlow_ADNS3080::reset()
 void
 AP_OpticalFlow_ADNS3080::update(uint32_t now)
 {
-    uint8_t motion_reg;
-    surface_quality = read_register(ADNS3080_SQUAL);
-    hal.scheduler->delay_microseconds(50);
+    uint8_t buf[ADNS3080_MOTION_BURST_LEN];
+
+    if (!read_motion_burst(buf)) {
+        // the bus was busy, try again on the next update
+        return;
+    }
+
+    uint8_t motion_reg = buf[0];
+    surface_quality = buf[3];
 
-    // check for movement, update x,y values
-    motion_reg = read_register(ADNS3080_MOTION);
     // check if we've had an overflow
     _overflow = ((motion_reg & 0x10) != 0);
+
+    // check for movement, update x,y values
     if( (motion_reg & 0x80) != 0 ) {
-        raw_dx = ((int8_t)read_register(ADNS3080_DELTA_X));
-        hal.scheduler->delay_microseconds(50);
-        raw_dy = ((int8_t)read_register(ADNS3080_DELTA_Y));
+        raw_dx = (int8_t)buf[1];
+        raw_dy = (int8_t)buf[2];
         _motion = true;
     }else{
         raw_dx = 0;
@@ -429,6 +473,54 @@ void AP_OpticalFlow_ADNS3080::clear_motion()
     _motion = false;
 }
 
+// capture_frame - captures an image from the sensor into pixels, which
+// must hold ADNS3080_PIXELS_X * ADNS3080_PIXELS_Y bytes, reading it in
+// one pixel burst. The sensor is reset afterwards. Returns false if the
+// bus was busy or the image didn't start at the first pixel
+bool AP_OpticalFlow_ADNS3080::capture_frame(uint8_t *pixels)
+{
+    AP_HAL::Semaphore *spi_sem;
+    bool first_pixel_ok;
+
+    // check that we have an spi bus
+    if (_spi == NULL) {
+        return false;
+    }
+
+    // write to frame capture register to force capture of frame
+    write_register(ADNS3080_FRAME_CAPTURE,0x83);
+
+    // wait 3 frame periods + 10 microseconds for frame to be captured
+    hal.scheduler->delay_microseconds(1510);
+
+    spi_sem = _spi->get_semaphore();
+    if (spi_sem == NULL || !spi_sem->take_nonblocking()) {
+        return false;
+    }
+
+    _spi->cs_assert();
+    _spi->transfer(ADNS3080_PIXEL_BURST);
+    hal.scheduler->delay_microseconds(50);
+    for (uint16_t i=0; i<ADNS3080_PIXELS_X * ADNS3080_PIXELS_Y; i++) {
+        pixels[i] = _spi->transfer(0x00);
+    }
+    _spi->cs_release();
+
+    spi_sem->give();
+
+    // the first pixel is marked by bit 6. Pixel values are the low 6
+    // bits, which are scaled to the full byte
+    first_pixel_ok = (pixels[0] & 0x40) != 0;
+    for (uint16_t i=0; i<ADNS3080_PIXELS_X * ADNS3080_PIXELS_Y; i++) {
+        pixels[i] <<= 2;
+    }
+
+    // hardware reset to restore sensor to normal operation
+    reset();
+
+    return first_pixel_ok;
+}
+
 // get_pixel_data - captures an image from the sensor and stores it to the
 // pixe_data array
 void AP_OpticalFlow_ADNS3080::print_pixel_data()
@@ -58,6 +58,9 @@
 #define ADNS3080_MOTION_BURST          0x50
 #define ADNS3080_SROM_LOAD             0x60
 
+// bytes read in a motion burst: motion, delta x, delta y and squal
+#define ADNS3080_MOTION_BURST_LEN      4
+
 // Configuration Bits
 #define ADNS3080_LED_MODE_ALWAYS_ON        0x00
 #define ADNS3080_LED_MODE_WHEN_REQUIRED    0x01
@@ -152,10 +155,18 @@ public:
     // be cleared
     void     clear_motion();
 
+    // captures a 30x30 image into pixels, which must hold
+    // ADNS3080_PIXELS_X * ADNS3080_PIXELS_Y bytes. Returns true on success
+    bool     capture_frame(uint8_t *pixels);
+
     // dumps a 30x30 image to the Serial port
     void     print_pixel_data();
 
 private:
+    // read the motion registers in one burst into buf, which holds
+    // ADNS3080_MOTION_BURST_LEN bytes
+    bool    read_motion_burst(uint8_t *buf);
+
     // pin used for chip reset
     uint8_t _reset_pin;
     // true if there has been motion
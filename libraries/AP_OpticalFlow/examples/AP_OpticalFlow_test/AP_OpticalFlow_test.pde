@@ -300,7 +300,7 @@ void display_motion()
 
     while( !hal.console->available() ) {
         //flowSensor.update();
-        flowSensor.update_position(0,0,0,1,100);
+        flowSensor.update_velocity(0,0,100);
 
         // check for errors
         if( flowSensor.overflow() )
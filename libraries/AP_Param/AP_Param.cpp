@@ -67,6 +67,23 @@ uint8_t AP_Param::_num_vars;
 // storage and naming information about all types that can be saved
 const AP_Param::Info *AP_Param::_var_info;
 
+// parameter changes, see change_count()
+uint16_t AP_Param::_change_count;
+
+// EEPROM offset cache
+AP_Param::OffsetCache AP_Param::_offset_cache[AP_PARAM_OFFSET_CACHE_SIZE];
+uint16_t AP_Param::_sentinal_ofs;
+bool AP_Param::_offset_cache_complete;
+
+// the last variable found by find_by_index()
+struct AP_Param::FindIndex AP_Param::_find_index;
+
+#if AP_PARAM_NAME_INDEX
+// index of parameter names, built on the first find()
+AP_Param::NameIndex *AP_Param::_name_index;
+uint16_t AP_Param::_name_index_count;
+#endif
+
 // write to EEPROM
 void AP_Param::eeprom_write_check(const void *ptr, uint16_t ofs, uint8_t size)
 {
@@ -100,6 +117,69 @@ void AP_Param::erase_all(void)
 
     // add a sentinal directly after the header
     write_sentinal(sizeof(struct EEPROM_header));
+
+    // an empty EEPROM is fully cached
+    cache_reset();
+    _sentinal_ofs = sizeof(struct EEPROM_header);
+    _offset_cache_complete = true;
+}
+
+// the 32 bits of a header as one value
+uint32_t AP_Param::header_key(const struct Param_header &phdr)
+{
+    uint32_t key;
+    memcpy(&key, &phdr, sizeof(key));
+    return key;
+}
+
+// look up the EEPROM offset of a variable in the cache
+bool AP_Param::cache_lookup(const struct Param_header &phdr, uint16_t *pofs)
+{
+    uint32_t key = header_key(phdr);
+    uint16_t slot = (phdr.key ^ (phdr.group_element * 37U) ^ phdr.type) % AP_PARAM_OFFSET_CACHE_SIZE;
+    for (uint8_t i=0; i<AP_PARAM_OFFSET_CACHE_PROBES; i++) {
+        const struct OffsetCache &c = _offset_cache[(slot+i) % AP_PARAM_OFFSET_CACHE_SIZE];
+        if (c.ofs == 0) {
+            return false;
+        }
+        if (c.hdr == key) {
+            *pofs = c.ofs;
+            return true;
+        }
+    }
+    return false;
+}
+
+// add a variable location to the cache. If all the probed slots are
+// taken the first is replaced, and the cache is no longer complete.
+// Variables never move in EEPROM, and scan() returns the first copy
+// of a duplicated header, so an existing entry is kept
+void AP_Param::cache_offset(const struct Param_header &phdr, uint16_t ofs)
+{
+    uint32_t key = header_key(phdr);
+    uint16_t slot = (phdr.key ^ (phdr.group_element * 37U) ^ phdr.type) % AP_PARAM_OFFSET_CACHE_SIZE;
+    for (uint8_t i=0; i<AP_PARAM_OFFSET_CACHE_PROBES; i++) {
+        struct OffsetCache &c = _offset_cache[(slot+i) % AP_PARAM_OFFSET_CACHE_SIZE];
+        if (c.ofs != 0 && c.hdr == key) {
+            return;
+        }
+        if (c.ofs == 0) {
+            c.hdr = key;
+            c.ofs = ofs;
+            return;
+        }
+    }
+    _offset_cache[slot].hdr = key;
+    _offset_cache[slot].ofs = ofs;
+    _offset_cache_complete = false;
+}
+
+// forget all cached locations
+void AP_Param::cache_reset(void)
+{
+    memset(_offset_cache, 0, sizeof(_offset_cache));
+    _sentinal_ofs = 0;
+    _offset_cache_complete = false;
 }
 
 // validate a group info table
@@ -147,24 +227,16 @@ bool AP_Param::check_group_info(const struct AP_Param::GroupInfo *  group_info,
     return true;
 }
 
-// check for duplicate key values
-bool AP_Param::duplicate_key(uint8_t vindex, uint8_t key)
-{
-    for (uint8_t i=vindex+1; i<_num_vars; i++) {
-        uint8_t key2 = PGM_UINT8(&_var_info[i].key);
-        if (key2 == key) {
-            // no duplicate keys allowed
-            return true;
-        }
-    }
-    return false;
-}
-
 // validate the _var_info[] table
 bool AP_Param::check_var_info(void)
 {
     uint16_t total_size = sizeof(struct EEPROM_header);
 
+    // the keys seen so far, one bit per key, so that the duplicate
+    // check is a single pass over the table
+    uint8_t seen_keys[256/8];
+    memset(seen_keys, 0, sizeof(seen_keys));
+
     for (uint8_t i=0; i<_num_vars; i++) {
         uint8_t type = PGM_UINT8(&_var_info[i].type);
         uint8_t key = PGM_UINT8(&_var_info[i].key);
@@ -187,9 +259,11 @@ bool AP_Param::check_var_info(void)
             }
             total_size += size + sizeof(struct Param_header);
         }
-        if (duplicate_key(i, key)) {
+        if (seen_keys[key>>3] & (1U<<(key&7))) {
+            // no duplicate keys allowed
             return false;
         }
+        seen_keys[key>>3] |= 1U<<(key&7);
     }
 
     // we no longer check if total_size is larger than _eeprom_size,
@@ -447,6 +521,15 @@ uint8_t AP_Param::type_size(enum ap_var_type type)
 // if the sentinal isn't found either, the offset is set to 0xFFFF
 bool AP_Param::scan(const AP_Param::Param_header *target, uint16_t *pofs)
 {
+    if (cache_lookup(*target, pofs)) {
+        return true;
+    }
+    if (_offset_cache_complete && _sentinal_ofs != 0) {
+        // not stored, new variables go at the sentinal
+        *pofs = _sentinal_ofs;
+        return false;
+    }
+
     struct Param_header phdr;
     uint16_t ofs = sizeof(AP_Param::EEPROM_header);
     while (ofs < _eeprom_size) {
@@ -455,6 +538,7 @@ bool AP_Param::scan(const AP_Param::Param_header *target, uint16_t *pofs)
             phdr.key == target->key &&
             phdr.group_element == target->group_element) {
             // found it
+            cache_offset(*target, ofs);
             *pofs = ofs;
             return true;
         }
@@ -464,6 +548,7 @@ bool AP_Param::scan(const AP_Param::Param_header *target, uint16_t *pofs)
             phdr.key == _sentinal_key ||
             phdr.group_element == _sentinal_group) {
             // we've reached the sentinal
+            _sentinal_ofs = ofs;
             *pofs = ofs;
             return false;
         }
@@ -574,6 +659,14 @@ AP_Param::find_group(const char *name, uint8_t vindex, const struct GroupInfo *g
 AP_Param *
 AP_Param::find(const char *name, enum ap_var_type *ptype)
 {
+#if AP_PARAM_NAME_INDEX
+    // the index only holds scalars, so whole vectors and unknown
+    // names still need the walk below
+    AP_Param *ap = find_indexed(name, ptype);
+    if (ap != NULL) {
+        return ap;
+    }
+#endif
     for (uint8_t i=0; i<_num_vars; i++) {
         uint8_t type = PGM_UINT8(&_var_info[i].type);
         if (type == AP_PARAM_GROUP) {
@@ -597,6 +690,97 @@ AP_Param::find(const char *name, enum ap_var_type *ptype)
     return NULL;
 }
 
+#if AP_PARAM_NAME_INDEX
+// case insensitive FNV-1a hash of a parameter name, folded to 16 bits
+uint16_t AP_Param::name_hash(const char *name)
+{
+    uint32_t h = 2166136261UL;
+    for (uint8_t i=0; i<AP_MAX_NAME_SIZE && name[i]; i++) {
+        char c = name[i];
+        if (c >= 'a' && c <= 'z') {
+            c -= 'a' - 'A';
+        }
+        h = (h ^ (uint8_t)c) * 16777619UL;
+    }
+    return (uint16_t)(h ^ (h >> 16));
+}
+
+// build the name index. Entries are insertion sorted by hash, which
+// keeps entries with equal hashes in table order so the index finds
+// the same variable as the walk in find()
+void AP_Param::build_name_index(void)
+{
+    ParamToken token;
+    AP_Param *ap;
+    enum ap_var_type type;
+    uint16_t count = 0;
+
+    for (ap=first(&token, &type); ap; ap=next_scalar(&token, &type)) {
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+    _name_index = new NameIndex[count];
+    if (_name_index == NULL) {
+        return;
+    }
+    for (ap=first(&token, &type); ap; ap=next_scalar(&token, &type)) {
+        char name[AP_MAX_NAME_SIZE+1];
+        ap->copy_name_token(token, name, sizeof(name), true);
+        name[AP_MAX_NAME_SIZE] = 0;
+        uint16_t hash = name_hash(name);
+        uint16_t i = _name_index_count;
+        while (i > 0 && _name_index[i-1].hash > hash) {
+            _name_index[i] = _name_index[i-1];
+            i--;
+        }
+        _name_index[i].hash  = hash;
+        _name_index[i].type  = type;
+        _name_index[i].token = token;
+        _name_index[i].ap    = ap;
+        _name_index_count++;
+    }
+}
+
+// find a scalar variable using the name index
+AP_Param *
+AP_Param::find_indexed(const char *name, enum ap_var_type *ptype)
+{
+    if (_name_index == NULL) {
+        if (!initialised()) {
+            return NULL;
+        }
+        build_name_index();
+        if (_name_index == NULL) {
+            return NULL;
+        }
+    }
+    uint16_t hash = name_hash(name);
+    uint16_t lo = 0, hi = _name_index_count;
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+        if (_name_index[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    // check the name, as different names can share a hash
+    for (; lo < _name_index_count && _name_index[lo].hash == hash; lo++) {
+        const struct NameIndex &e = _name_index[lo];
+        char ename[AP_MAX_NAME_SIZE+1];
+        e.ap->copy_name_token(e.token, ename, sizeof(ename), true);
+        ename[AP_MAX_NAME_SIZE] = 0;
+        if (strcasecmp(name, ename) == 0) {
+            *ptype = (enum ap_var_type)e.type;
+            return e.ap;
+        }
+    }
+    return NULL;
+}
+#endif // AP_PARAM_NAME_INDEX
+
 // Find a variable by name.
 //
 AP_Param *
@@ -608,18 +792,39 @@ AP_Param::find_P(const prog_char_t *name, enum ap_var_type *ptype)
     return find(param_name, ptype);
 }
 
-// Find a variable by index. Note that this is quite slow.
+// Find a variable by index. This walks the table from the start, or
+// from the last variable found if idx is at or after it, so a GCS
+// fetching missing parameters in order doesn't walk the table for
+// each one
 //
 AP_Param *
 AP_Param::find_by_index(uint16_t idx, enum ap_var_type *ptype, ParamToken *token)
 {
     AP_Param *ap;
-    uint16_t count=0;
-    for (ap=AP_Param::first(token, ptype);
-         ap && count < idx;
-         ap=AP_Param::next_scalar(token, ptype)) {
+    enum ap_var_type type;
+    uint16_t count;
+    if (_find_index.ap != NULL && idx >= _find_index.count) {
+        ap = _find_index.ap;
+        type = (enum ap_var_type)_find_index.type;
+        *token = _find_index.token;
+        count = _find_index.count;
+    } else {
+        ap = AP_Param::first(token, &type);
+        count = 0;
+    }
+    for (; ap && count < idx;
+         ap=AP_Param::next_scalar(token, &type)) {
         count++;
     }
+    _find_index.ap = ap;
+    if (ap != NULL) {
+        _find_index.count = count;
+        _find_index.type = type;
+        _find_index.token = *token;
+    }
+    if (ptype != NULL) {
+        *ptype = type;
+    }
     return ap;    
 }
 
@@ -713,6 +918,8 @@ bool AP_Param::save(bool force_save)
     write_sentinal(ofs + sizeof(phdr) + type_size((enum ap_var_type)phdr.type));
     eeprom_write_check(ap, ofs+sizeof(phdr), type_size((enum ap_var_type)phdr.type));
     eeprom_write_check(&phdr, ofs, sizeof(phdr));
+    _sentinal_ofs = ofs + sizeof(phdr) + type_size((enum ap_var_type)phdr.type);
+    cache_offset(phdr, ofs);
     return true;
 }
 
@@ -767,11 +974,20 @@ bool AP_Param::load(void)
 
     // found it
     hal.storage->read_block(ap, ofs+sizeof(phdr), type_size((enum ap_var_type)phdr.type));
+    _change_count++;
     return true;
 }
 
 // set a AP_Param variable to a specified value
 void AP_Param::set_value(enum ap_var_type type, void *ptr, float value)
+{
+    _change_count++;
+    set_default(type, ptr, value);
+}
+
+// set a variable without counting a change, for the defaults, which
+// count as one change however many there are
+void AP_Param::set_default(enum ap_var_type type, void *ptr, float value)
 {
     switch (type) {
     case AP_PARAM_INT8:
@@ -798,12 +1014,13 @@ void AP_Param::setup_object_defaults(const void *object_pointer, const struct Gr
 {
     uintptr_t base = (uintptr_t)object_pointer;
     uint8_t type;
+    _change_count++;
     for (uint8_t i=0;
          (type=PGM_UINT8(&group_info[i].type)) != AP_PARAM_NONE;
          i++) {
         if (type <= AP_PARAM_FLOAT) {
             void *ptr = (void *)(base + PGM_UINT16(&group_info[i].offset));
-            set_value((enum ap_var_type)type, ptr, PGM_FLOAT(&group_info[i].def_value));
+            set_default((enum ap_var_type)type, ptr, PGM_FLOAT(&group_info[i].def_value));
         }
     }
 }
@@ -814,46 +1031,91 @@ void AP_Param::setup_object_defaults(const void *object_pointer, const struct Gr
 void AP_Param::setup_sketch_defaults(void)
 {
     setup();
+    _change_count++;
     for (uint8_t i=0; i<_num_vars; i++) {
         uint8_t type = PGM_UINT8(&_var_info[i].type);
         if (type <= AP_PARAM_FLOAT) {
             void *ptr = (void*)PGM_POINTER(&_var_info[i].ptr);
-            set_value((enum ap_var_type)type, ptr, PGM_FLOAT(&_var_info[i].def_value));
+            set_default((enum ap_var_type)type, ptr, PGM_FLOAT(&_var_info[i].def_value));
         }
     }
 }
 
 
+// the end of a chunk of EEPROM read from ofs by load_all()
+uint16_t AP_Param::chunk_end(uint16_t ofs)
+{
+    if (_eeprom_size - ofs < AP_PARAM_LOAD_CHUNK) {
+        return _eeprom_size;
+    }
+    return ofs + AP_PARAM_LOAD_CHUNK;
+}
+
 // Load all variables from EEPROM
 //
+// The EEPROM is read AP_PARAM_LOAD_CHUNK bytes at a time and the
+// headers and values are taken from the buffer, as the storage
+// drivers are much slower at many small reads than at a few big ones
 bool AP_Param::load_all(void)
 {
     struct Param_header phdr;
     uint16_t ofs = sizeof(AP_Param::EEPROM_header);
+    uint8_t buf[AP_PARAM_LOAD_CHUNK];
+    uint16_t buf_start = ofs;   // EEPROM offset of buf[0]
+    uint16_t buf_end = ofs;     // and of the byte after the last read
+
+    // rebuild the offset cache as we go
+    cache_reset();
+    _offset_cache_complete = true;
 
     while (ofs < _eeprom_size) {
-        hal.storage->read_block(&phdr, ofs, sizeof(phdr));
+        if (ofs + sizeof(phdr) > buf_end) {
+            buf_start = ofs;
+            buf_end = chunk_end(ofs);
+            hal.storage->read_block(buf, buf_start, buf_end - buf_start);
+        }
+        if (ofs + sizeof(phdr) > buf_end) {
+            // a header cut off by the end of the EEPROM
+            break;
+        }
+        memcpy(&phdr, &buf[ofs - buf_start], sizeof(phdr));
         // note that this is an || not an && for robustness
         // against power off while adding a variable
         if (phdr.type == _sentinal_type ||
             phdr.key == _sentinal_key ||
             phdr.group_element == _sentinal_group) {
             // we've reached the sentinal
+            _sentinal_ofs = ofs;
+            _change_count++;
             return true;
         }
+        cache_offset(phdr, ofs);
 
         const struct AP_Param::Info *info;
         void *ptr;
 
+        uint8_t size = type_size((enum ap_var_type)phdr.type);
         info = find_by_header(phdr, &ptr);
         if (info != NULL) {
-            hal.storage->read_block(ptr, ofs+sizeof(phdr), type_size((enum ap_var_type)phdr.type));
+            uint16_t value_ofs = ofs + sizeof(phdr);
+            if (value_ofs + size > buf_end) {
+                buf_start = ofs;
+                buf_end = chunk_end(ofs);
+                hal.storage->read_block(buf, buf_start, buf_end - buf_start);
+            }
+            if (value_ofs + size <= buf_end) {
+                memcpy(ptr, &buf[value_ofs - buf_start], size);
+            } else {
+                hal.storage->read_block(ptr, value_ofs, size);
+            }
         }
 
-        ofs += type_size((enum ap_var_type)phdr.type) + sizeof(phdr);
+        ofs += size + sizeof(phdr);
     }
 
     // we didn't find the sentinal
+    _offset_cache_complete = false;
+    _change_count++;
     serialDebug("no sentinal in load_all");
     return false;
 }
@@ -22,6 +22,40 @@
 #define AP_MAX_NAME_SIZE 16
 #define AP_NESTED_GROUPS_ENABLED
 
+// use a hash index of parameter names in find(). This costs about
+// 12 bytes of RAM per parameter, which the AVR boards can't spare
+#ifndef AP_PARAM_NAME_INDEX
+ #if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+  #define AP_PARAM_NAME_INDEX 0
+ #else
+  #define AP_PARAM_NAME_INDEX 1
+ #endif
+#endif
+
+// size of the cache of EEPROM offsets used by save() and load(), and
+// how many slots are probed for a variable. The AVR boards get a
+// small direct mapped cache, the others one big enough to hold every
+// variable
+#ifndef AP_PARAM_OFFSET_CACHE_SIZE
+ #if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+  #define AP_PARAM_OFFSET_CACHE_SIZE   16
+  #define AP_PARAM_OFFSET_CACHE_PROBES 1
+ #else
+  #define AP_PARAM_OFFSET_CACHE_SIZE   1024
+  #define AP_PARAM_OFFSET_CACHE_PROBES 8
+ #endif
+#endif
+
+// bytes of EEPROM read at a time by load_all(). It must hold a header
+// and the largest variable, a Matrix3f
+#ifndef AP_PARAM_LOAD_CHUNK
+ #if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+  #define AP_PARAM_LOAD_CHUNK 64
+ #else
+  #define AP_PARAM_LOAD_CHUNK 512
+ #endif
+#endif
+
 // a variant of offsetof() to work around C++ restrictions.
 // this can only be used when the offset of a variable in a object
 // is constant and known at compile time
@@ -236,6 +270,19 @@ public:
     /// cast a variable to a float given its type
     float                   cast_to_float(enum ap_var_type type) const;
 
+    /// A count of the changes to parameters made from outside their
+    /// objects: by load(), load_all(), set_and_save() and set_value(),
+    /// such as a GCS or the CLI setting them, and notify_change()
+    /// calls. An object that works out constants from its parameters
+    /// can keep the count it last saw and redo them when it differs.
+    /// A plain set() does not count, so an object setting its own
+    /// parameters should update what it derives from them itself
+    static uint16_t         change_count(void) { return _change_count; }
+
+    /// Count a change made by plain set() calls, such as tuning
+    /// from a transmitter knob
+    static void             notify_change(void) { _change_count++; }
+
 private:
     /// EEPROM header
     ///
@@ -274,8 +321,27 @@ private:
     static const uint8_t        _sentinal_type  = 0x3F;
     static const uint8_t        _sentinal_group = 0xFF;
 
+    // a cached EEPROM location. ofs is zero for an empty slot, as
+    // the EEPROM header is at offset zero
+    struct OffsetCache {
+        uint32_t hdr;
+        uint16_t ofs;
+    };
+    static struct OffsetCache   _offset_cache[AP_PARAM_OFFSET_CACHE_SIZE];
+
+    // offset of the sentinal, or zero if not known
+    static uint16_t             _sentinal_ofs;
+
+    // true when every variable in EEPROM is in the cache, so a miss
+    // means the variable isn't stored
+    static bool                 _offset_cache_complete;
+
+    static uint32_t             header_key(const struct Param_header &phdr);
+    static bool                 cache_lookup(const struct Param_header &phdr, uint16_t *pofs);
+    static void                 cache_offset(const struct Param_header &phdr, uint16_t ofs);
+    static void                 cache_reset(void);
+
     static bool                 check_group_info(const struct GroupInfo *group_info, uint16_t *total_size, uint8_t max_bits);
-    static bool                 duplicate_key(uint8_t vindex, uint8_t key);
     static bool                 check_var_info(void);
     const struct Info *         find_var_info_group(
                                     const struct GroupInfo *    group_info,
@@ -316,6 +382,8 @@ private:
                                     const struct Param_header *phdr,
                                     uint16_t *pofs);
     static uint8_t				type_size(enum ap_var_type type);
+    static void                 set_default(enum ap_var_type type, void *ptr, float value);
+    static uint16_t             chunk_end(uint16_t ofs);
     static void                 eeprom_write_check(
                                     const void *ptr,
                                     uint16_t ofs,
@@ -332,6 +400,32 @@ private:
     static uint16_t             _eeprom_size;
     static uint8_t              _num_vars;
     static const struct Info *  _var_info;
+    static uint16_t             _change_count;
+
+    // where find_by_index() ended, for the next call to carry on from
+    struct FindIndex {
+        AP_Param *ap;
+        ParamToken token;
+        uint16_t count;
+        uint8_t type; // AP_PARAM_*
+    };
+    static struct FindIndex     _find_index;
+
+#if AP_PARAM_NAME_INDEX
+    // an entry in the name index, which holds every scalar
+    // parameter sorted by the hash of its name
+    struct NameIndex {
+        uint16_t hash;
+        uint8_t type; // AP_PARAM_*
+        ParamToken token;
+        AP_Param *ap;
+    };
+    static struct NameIndex *   _name_index;
+    static uint16_t             _name_index_count;
+    static uint16_t             name_hash(const char *name);
+    static void                 build_name_index(void);
+    static AP_Param *           find_indexed(const char *name, enum ap_var_type *ptype);
+#endif
 
     // values filled into the EEPROM header
     static const uint8_t        k_EEPROM_magic0      = 0x50;
@@ -372,6 +466,9 @@ public:
     ///
     bool set_and_save(const T &v) {
         bool force = (_value != v);
+        if (force) {
+            notify_change();
+        }
         set(v);
         return save(force);
     }
@@ -385,6 +482,7 @@ public:
         if (v == _value) {
             return true;
         }
+        notify_change();
         set(v);
         return save(true);
     }
@@ -468,6 +566,9 @@ public:
     ///
     bool set_and_save(const T &v) {
         bool force = (_value != v);
+        if (force) {
+            notify_change();
+        }
         set(v);
         return save(force);
     }
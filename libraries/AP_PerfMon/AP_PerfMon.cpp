@@ -1,216 +1,116 @@
-#include "AP_PerfMon.h"
-
-extern const AP_HAL::HAL& hal;
-
-// static class variable definitions
-uint8_t AP_PerfMon::nextFuncNum;
-char AP_PerfMon::functionNames[PERFMON_MAX_FUNCTIONS][PERFMON_FUNCTION_NAME_LENGTH];
-uint32_t AP_PerfMon::time[PERFMON_MAX_FUNCTIONS];
-uint32_t AP_PerfMon::maxTime[PERFMON_MAX_FUNCTIONS];
-uint32_t AP_PerfMon::numCalls[PERFMON_MAX_FUNCTIONS];
-uint32_t AP_PerfMon::allStartTime;
-uint32_t AP_PerfMon::allEndTime;
-AP_PerfMon* AP_PerfMon::lastCreated = NULL;
-bool AP_PerfMon::_enabled = true;
-
-// constructor
-AP_PerfMon::AP_PerfMon(uint8_t funcNum) : _funcNum(funcNum), _time_this_iteration(0)
-{
-    // exit immediately if we are disabled
-    if( !_enabled ) {
-        return;
-    }
-
-    // check global start time
-    if( allStartTime == 0 ) {
-        allStartTime = hal.scheduler->micros();
-    }
-
-    // stop recording time from parent
-    _parent = lastCreated;  // add pointer to parent
-	if( _parent != NULL ) {
-        _parent->stop();
-    }
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
 
-    // record myself as the last created instance
-    lastCreated = this;
+#include "AP_PerfMon.h"
+#include <string.h>
 
-    numCalls[_funcNum]++;   // record that this function has been called
-    start();  				// start recording time spent in this function
-}
+AP_PerfMon::Probe *AP_PerfMon::_probes;
+const AP_PerfMon::Info *AP_PerfMon::_info;
+uint8_t AP_PerfMon::_num_probes;
+uint32_t AP_PerfMon::_start_time;
 
-// destructor
-AP_PerfMon::~AP_PerfMon()
+void AP_PerfMon::init(Probe *probes, const Info *info, uint8_t num_probes)
 {
-    // exit immediately if we are disabled
-    if( !_enabled ) {
-        return;
-    }
-
-    stop();   // stop recording time spent in this function
-    lastCreated = _parent;  // make my parent the last created instance
-
-    // calculate max time spent in this function
-    if( _time_this_iteration > maxTime[_funcNum] ) {
-        maxTime[_funcNum] = _time_this_iteration;
-    }
-
-    // restart recording time for parent
-    if( _parent != NULL )
-        _parent->start();
+#if AP_PERFMON_CYCLES
+    // turn on the trace block and its cycle counter
+    *(volatile uint32_t *)0xE000EDFC |= (1UL<<24);  // DEMCR TRCENA
+    *(volatile uint32_t *)0xE0001004 = 0;           // DWT_CYCCNT
+    *(volatile uint32_t *)0xE0001000 |= 1;          // DWT_CTRL CYCCNTENA
+#endif
+    _probes = probes;
+    _info = info;
+    _num_probes = num_probes;
+    clear();
 }
 
-// record function name in static list
-uint8_t AP_PerfMon::recordFunctionName(const char funcName[])
+void AP_PerfMon::clear(void)
 {
-    uint8_t nextNum = nextFuncNum++;
-    uint8_t i;
-
-    // clear existing function name (if any)
-    functionNames[nextNum][0] = 0;
-
-    // store function name
-    for( i=0; i<PERFMON_FUNCTION_NAME_LENGTH-1 && funcName[i] != 0; i++ ) {
-        functionNames[nextNum][i] = funcName[i];
+    irq_state_t s = irq_disable();
+    for (uint8_t i=0; i<_num_probes; i++) {
+        _probes[i].count = 0;
+        _probes[i].min = 0xFFFFFFFF;
+        _probes[i].max = 0;
+        _probes[i].total = 0;
     }
-    functionNames[nextNum][i] = 0;
-
-    return nextNum;
+    _start_time = now();
+    irq_restore(s);
 }
 
-// stop recording time
-void AP_PerfMon::start()
+void AP_PerfMon::_report(uint8_t id, struct Report &r)
 {
-    _startTime = hal.scheduler->micros();  // start recording time spent in this function
+    r.id = id;
+    r.parent = pgm_read_byte(&_info[id].parent);
+    irq_state_t s = irq_disable();
+    r.count = _probes[id].count;
+    r.min = r.count ? _probes[id].min : 0;
+    r.max = _probes[id].max;
+    r.total = _probes[id].total;
+    irq_restore(s);
 }
 
-// stop recording time
-void AP_PerfMon::stop()
+uint8_t AP_PerfMon::pack(uint8_t &next, uint8_t *buf, uint8_t size)
 {
-    uint32_t temp_time = hal.scheduler->micros()-_startTime;
-    _time_this_iteration += temp_time;
-    time[_funcNum] += temp_time;
-}
-
-// ClearAll - clears all data from static members
-void AP_PerfMon::ClearAll()
-{
-    uint8_t i;
-    AP_PerfMon *p = lastCreated;
-
-    for(i=0; i<PERFMON_MAX_FUNCTIONS; i++) {
-        time[i] = 0;        // reset times
-        numCalls[i] = 0;    // reset num times called
-        maxTime[i] = 0;     // reset maximum time
+    uint8_t len = 0;
+    while (next < _num_probes && len + sizeof(struct Report) <= size) {
+        struct Report r;
+        _report(next, r);
+        memcpy(&buf[len], &r, sizeof(r));
+        len += sizeof(r);
+        next++;
     }
-
-    // reset start time to now
-    allStartTime = hal.scheduler->micros();
-    allEndTime = 0;
-
-    // reset start times of any active counters
-    while( p != NULL ) {
-        p->_startTime = allStartTime;
-        p = p->_parent;
+    if (next >= _num_probes) {
+        next = 0;
     }
+    return len;
 }
 
-// DisplayResults - displays table of timing results
-void AP_PerfMon::DisplayResults()
+void AP_PerfMon::_print_probe(AP_HAL::BetterStream *s, uint8_t id, uint8_t depth, uint32_t elapsed)
 {
-    uint8_t i,j,changed;
-    float hz;
-    float pct;
-    uint32_t totalTime;
-    uint32_t avgTime;
-    uint32_t sumOfTime = 0;
-    uint32_t unExplainedTime;
-    uint8_t order[PERFMON_MAX_FUNCTIONS];
-    bool blocking_writes;
-
-    // record end time
-    if( allEndTime == 0 ) {
-        allEndTime = hal.scheduler->micros();
-    }
-
-    // turn off any time recording
-    if( lastCreated != NULL ) {
-        lastCreated->stop();
+    struct Report r;
+    _report(id, r);
+
+    // the time spent outside the children
+    uint32_t self = r.total;
+    for (uint8_t i=0; i<_num_probes; i++) {
+        if (pgm_read_byte(&_info[i].parent) == id) {
+            self -= _probes[i].total;
+        }
     }
-    _enabled = false;
 
-    // reorder results
-    for(i=0; i<nextFuncNum; i++) {
-        order[i] = i;
+    for (uint8_t i=0; i<depth; i++) {
+        s->print_P(PSTR("  "));
     }
-    changed=0;
-    do{
-        changed = 0;
-        for(i=0; i<nextFuncNum-1; i++)
-            if(time[order[i]]<time[order[i+1]]) {
-                j = order[i];
-                order[i] = order[i+1];
-                order[i+1] = j;
-                changed = 1;
-            }
-	}while(changed != 0);
-
-    // calculate time elapsed
-    totalTime = allEndTime - allStartTime;
-
-    // ensure serial is blocking
-    //blocking_writes = hal.console->get_blocking_writes();
-    //hal.console->set_blocking_writes(true);
-
-    // print table of results
-    hal.console->printf_P(PSTR("\nPerfMon elapsed:%lu(ms)\n"),(unsigned long)totalTime/1000);
-    hal.console->printf_P(PSTR("Fn:\t\tcpu\ttot(ms)\tavg(ms)\tmax(ms)\t#calls\tHz\n"));
-    for( i=0; i<nextFuncNum; i++ ) {
-        j=order[i];
-        sumOfTime += time[j];
-
-        // calculate average execution time
-        if( numCalls[j] > 0 ) {
-            avgTime = time[j] / numCalls[j];
-        }else{
-            avgTime = 0;
+    // a copy in RAM, as not all the HALs take a width with %S
+    char name[AP_PERFMON_NAME_LENGTH];
+    strncpy_P(name, (const prog_char_t *)_info[id].name, sizeof(name));
+    name[sizeof(name)-1] = 0;
+    s->printf_P(PSTR("%-16s %6.2f%% %6.2f%% %8lu %8lu %8lu %8lu\n"),
+                name,
+                elapsed ? r.total * 100.0f / elapsed : 0.0f,
+                elapsed ? self * 100.0f / elapsed : 0.0f,
+                (unsigned long)r.count,
+                (unsigned long)r.min,
+                (unsigned long)(r.count ? r.total / r.count : 0),
+                (unsigned long)r.max);
+
+    for (uint8_t i=0; i<_num_probes; i++) {
+        if (pgm_read_byte(&_info[i].parent) == id) {
+            _print_probe(s, i, depth+1, elapsed);
         }
-
-        hz = numCalls[j]/(totalTime/1000000);
-        pct = ((float)time[j] / (float)totalTime) * 100.0;
-        hal.console->printf_P(PSTR("%-10s\t%4.2f\t%lu\t%4.3f\t%4.3f\t%lu\t%4.1f\n"),
-            functionNames[j],
-            pct,
-            (unsigned long)time[j]/1000,
-            (float)avgTime/1000.0,
-            (float)maxTime[j]/1000.0,
-            numCalls[j],
-            hz);
     }
-    // display unexplained time
-    if( sumOfTime >= totalTime ) {
-        unExplainedTime = 0;
-    } else {
-        unExplainedTime = totalTime - sumOfTime;
-    }
-    pct = ((float)unExplainedTime / (float)totalTime) * 100.0;
-    hal.console->printf_P(PSTR("unexpl:\t\t%4.2f\t%lu\n"),pct,(unsigned long)unExplainedTime/1000);
-
-    // restore to blocking writes if necessary
-    //hal.console->set_blocking_writes(blocking_writes);
-
-    // turn back on any time recording
-    if( lastCreated != NULL ) {
-        lastCreated->start();
-    }
-    _enabled = true;
 }
 
-// DisplayAndClear - will display results after this many milliseconds.  should be called regularly
-void AP_PerfMon::DisplayAndClear(uint32_t display_after_seconds)
+void AP_PerfMon::print(AP_HAL::BetterStream *s)
 {
-    if( (hal.scheduler->micros() - allStartTime) > (uint32_t)(display_after_seconds * 1000000) ) {
-        DisplayResults();
-        ClearAll();
+    uint32_t t = elapsed();
+#if AP_PERFMON_CYCLES
+    s->printf_P(PSTR("PerfMon elapsed %lu cycles, times in cycles\n"), (unsigned long)t);
+#else
+    s->printf_P(PSTR("PerfMon elapsed %lums, times in us\n"), (unsigned long)t/1000);
+#endif
+    s->println_P(PSTR("probe               total    self    count      min      avg      max"));
+    for (uint8_t i=0; i<_num_probes; i++) {
+        if (pgm_read_byte(&_info[i].parent) == PERF_NONE) {
+            _print_probe(s, i, 0, t);
+        }
     }
 }
@@ -1,48 +1,244 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
 #ifndef AP_PERFMON_H
 #define AP_PERFMON_H
 
-// macros to make integrating into code easier
-#define AP_PERFMON_REGISTER static uint8_t myFunc = AP_PerfMon::recordFunctionName(__func__); AP_PerfMon perfMon(myFunc);
-#define AP_PERFMON_REGISTER_NAME(functionName) static uint8_t myFunc = AP_PerfMon::recordFunctionName(functionName); AP_PerfMon perfMon(myFunc);
+// as in DataFlash.h
+#ifndef DATAFLASH_TIMESTAMPS
+ # define DATAFLASH_TIMESTAMPS 1
+#endif
 
-#define PERFMON_MAX_FUNCTIONS 11
-#define PERFMON_FUNCTION_NAME_LENGTH 10
+/*
+  AP_PerfMon - timing of probe points in the code
 
+  The probes are listed at compile time by the sketch, each with a
+  parent so the report can show a tree and the time a probe spends
+  outside its children. A list looks like
+
+    #define PERFMON_PROBES(P) \
+        P(FAST_LOOP, NONE,      "fast_loop") \
+        P(AHRS,      FAST_LOOP, "ahrs")
+
+    AP_PERFMON_REGISTRY(PERFMON_PROBES);
+
+  and a probe times the rest of the scope it is in with
+
+    AP_PERFMON_SCOPE(AHRS);
+
+  AP_PERFMON_INIT() in setup() starts the timing. Each probe keeps
+  count, min, max and total, updated with interrupts off so probes can
+  be used in timer processes too. There is no parent chain at run time,
+  a probe only keeps its start time on the stack.
+
+  On Cortex-M boards times are in cycles from DWT_CYCCNT, elsewhere in
+  microseconds. Totals are 32 bits, so clear() should be called more
+  often than every 25 seconds at 168MHz.
+
+  Unless AP_PERFMON_ENABLED is defined to 1 before this header is
+  included the macros are empty, and the probes cost nothing.
+ */
+
+#include <AP_Common.h>
+#include <AP_Progmem.h>
 #include <AP_HAL.h>
-#include <AP_Math.h>
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+ # include <avr/io.h>
+ # include <avr/interrupt.h>
+#endif
+
+#ifndef AP_PERFMON_ENABLED
+ # define AP_PERFMON_ENABLED 0
+#endif
+
+#define AP_PERFMON_NAME_LENGTH 16
+
+// the parent of a top level probe
+#define PERF_NONE 0xFF
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_PX4 || CONFIG_HAL_BOARD == HAL_BOARD_SMACCM
+ # define AP_PERFMON_CYCLES 1
+#else
+ # define AP_PERFMON_CYCLES 0
+#endif
+
+extern const AP_HAL::HAL& hal;
 
 class AP_PerfMon
 {
-    public:
-		// static methods
-        static uint8_t recordFunctionName(const char funcName[]);
-        static void DisplayResults();
-		static void ClearAll();
-        static void DisplayAndClear(uint32_t display_after_seconds);  // will display results after this many milliseconds.  should be called regularly
-
-		// public methods
-		AP_PerfMon(uint8_t funcNum);    // Constructor - records function start time
-		~AP_PerfMon();                  // Destructor - records function end time
-		void stop();                    // stops recording time spent in this function - meant to be called by a child.
-		void start();                   // restarts recording time spent in this function
+public:
+    struct Probe {
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+        uint32_t total;
+    };
 
+    struct Info {
+        char name[AP_PERFMON_NAME_LENGTH];
+        uint8_t parent;
+    };
+
+    // one probe in a binary dump
+    struct PACKED Report {
+        uint8_t id;
+        uint8_t parent;
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+        uint32_t total;
+    };
+
+    // times the rest of the scope it is declared in
+    class Scope {
+    public:
+        Scope(uint8_t id) : _id(id), _start(now()) {}
+        ~Scope() { record(_id, now() - _start); }
     private:
-        // static variables
-        static uint8_t nextFuncNum;
-		static char functionNames[PERFMON_MAX_FUNCTIONS][PERFMON_FUNCTION_NAME_LENGTH];
-        static uint32_t time[PERFMON_MAX_FUNCTIONS];
-		static uint32_t numCalls[PERFMON_MAX_FUNCTIONS];
-        static uint32_t maxTime[PERFMON_MAX_FUNCTIONS];
-		static uint32_t allStartTime;
-		static uint32_t allEndTime;
-		static AP_PerfMon* lastCreated;
-        static bool _enabled;
-
-        // instance variables
-        uint8_t _funcNum;
-        unsigned long _startTime;
-        unsigned long _time_this_iteration;
-		AP_PerfMon* _parent;
+        uint8_t _id;
+        uint32_t _start;
+    };
+
+    // use the probes and info[] in PROGMEM given by AP_PERFMON_REGISTRY
+    static void init(Probe *probes, const Info *info, uint8_t num_probes);
+
+    // the clock the probes use
+    static inline uint32_t now(void) {
+#if AP_PERFMON_CYCLES
+        return *(volatile uint32_t *)0xE0001004; // DWT_CYCCNT
+#else
+        return hal.scheduler->micros();
+#endif
+    }
+
+    static inline void record(uint8_t id, uint32_t t) {
+        if (id >= _num_probes) {
+            return;
+        }
+        Probe &p = _probes[id];
+        irq_state_t s = irq_disable();
+        p.count++;
+        p.total += t;
+        if (t > p.max) {
+            p.max = t;
+        }
+        if (t < p.min) {
+            p.min = t;
+        }
+        irq_restore(s);
+    }
+
+    // reset all probes and the elapsed time
+    static void clear(void);
+
+    // a table of the probes in tree order, with the share of the
+    // elapsed time each took
+    static void print(AP_HAL::BetterStream *s);
+
+    // pack the reports of probes from next onwards into buf, as many
+    // as fit. Returns the bytes used, and moves next on. next comes
+    // back to 0 once all probes have been packed
+    static uint8_t pack(uint8_t &next, uint8_t *buf, uint8_t size);
+
+    static uint8_t num_probes(void) { return _num_probes; }
+
+    // a DataFlash record of one probe, written by log_write(). The
+    // header is LOG_PACKET_HEADER, spelt out so this doesn't need
+    // DataFlash.h, which fills in time_delta
+    struct PACKED log_Perf {
+        uint8_t head1, head2, msgid;
+#if DATAFLASH_TIMESTAMPS
+        uint16_t time_delta;
+#endif
+        struct Report r;
+    };
+
+    // write a log_Perf record for each probe. DataFlash_Class is a
+    // template argument so only sketches which log need DataFlash
+    template <class DataFlash_Class>
+    static void log_write(DataFlash_Class &dataflash, uint8_t msgid) {
+        for (uint8_t i=0; i<_num_probes; i++) {
+            struct log_Perf pkt;
+            pkt.head1 = 0xA3; // HEAD_BYTE1
+            pkt.head2 = 0x95; // HEAD_BYTE2
+            pkt.msgid = msgid;
+            _report(i, pkt.r);
+            dataflash.WriteBlock(&pkt, sizeof(pkt));
+        }
+    }
+
+    // time since clear(), in the units of the probes
+    static uint32_t elapsed(void) { return now() - _start_time; }
+
+private:
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+    typedef uint8_t irq_state_t;
+    static inline irq_state_t irq_disable(void) {
+        uint8_t sreg = SREG;
+        cli();
+        return sreg;
+    }
+    static inline void irq_restore(irq_state_t s) { SREG = s; }
+#elif AP_PERFMON_CYCLES
+    typedef uint32_t irq_state_t;
+    static inline irq_state_t irq_disable(void) {
+        uint32_t primask;
+        asm volatile("mrs %0, primask\n\tcpsid i" : "=r"(primask) : : "memory");
+        return primask;
+    }
+    static inline void irq_restore(irq_state_t s) {
+        asm volatile("msr primask, %0" : : "r"(s) : "memory");
+    }
+#else
+    typedef uint8_t irq_state_t;
+    static inline irq_state_t irq_disable(void) { return 0; }
+    static inline void irq_restore(irq_state_t s) {}
+#endif
+
+    static void _report(uint8_t id, struct Report &r);
+    static void _print_probe(AP_HAL::BetterStream *s, uint8_t id, uint8_t depth, uint32_t elapsed);
+
+    static Probe *_probes;
+    static const Info *_info;
+    static uint8_t _num_probes;
+    static uint32_t _start_time;
 };
 
-#endif  // AP_PERFMON_H
\ No newline at end of file
+#if AP_PERFMON_ENABLED
+ # define AP_PERFMON_ENUM(id, parent, name) PERF_ ## id,
+ # define AP_PERFMON_INFO(id, parent, name) { name, PERF_ ## parent },
+ # define AP_PERFMON_REGISTRY(list) \
+    enum { list(AP_PERFMON_ENUM) PERF_NUM_PROBES }; \
+    static AP_PerfMon::Probe perfmon_probes[PERF_NUM_PROBES]; \
+    static const AP_PerfMon::Info perfmon_info[PERF_NUM_PROBES] PROGMEM = { list(AP_PERFMON_INFO) }
+ # define AP_PERFMON_INIT() AP_PerfMon::init(perfmon_probes, perfmon_info, PERF_NUM_PROBES)
+ # define AP_PERFMON_SCOPE(id) AP_PerfMon::Scope perfmon_scope_ ## id(PERF_ ## id)
+#else
+ # define AP_PERFMON_REGISTRY(list) typedef void perfmon_registry_unused
+ # define AP_PERFMON_INIT()
+ # define AP_PERFMON_SCOPE(id)
+#endif
+
+// for the LogStructure table of a sketch which calls log_write()
+#define AP_PERFMON_LOG_STRUCTURE(msgid) \
+    { msgid, sizeof(AP_PerfMon::log_Perf), \
+      "PERF", "BBIIII", "Id,Parent,Count,Min,Max,Total" }
+
+#ifdef MAVLINK_MSG_ID_DATA96
+// the type of the DATA96 messages carrying packed Reports
+ # define AP_PERFMON_DATA96_TYPE 0x50
+
+// send all the probes over MAVLink, as many reports to a DATA96 as fit
+static inline void perfmon_send_mavlink(mavlink_channel_t chan)
+{
+    uint8_t next = 0;
+    do {
+        uint8_t buf[96];
+        uint8_t len = AP_PerfMon::pack(next, buf, sizeof(buf));
+        if (len == 0) {
+            break;
+        }
+        mavlink_msg_data96_send(chan, AP_PERFMON_DATA96_TYPE, len, buf);
+    } while (next != 0);
+}
+#endif
+
+#endif  // AP_PERFMON_H
@@ -9,44 +9,62 @@
 #include <AP_Math.h>
 #include <AP_HAL.h>
 #include <AP_HAL_AVR.h>
+#include <AP_HAL_PX4.h>
+
+#define AP_PERFMON_ENABLED 1
 #include <AP_PerfMon.h>        // PerfMonitor library
 
 const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
 
-void setup()
-{
-  AP_PERFMON_REGISTER_NAME("setupA")
+#define PERFMON_PROBES(P) \
+    P(LOOP,     NONE, "loop")     \
+    P(TEST_FN,  LOOP, "testFn")   \
+    P(TEST_FN2, TEST_FN, "testFn2") \
+    P(TIMER,    NONE, "timer")
 
-  hal.console->print_P(PSTR("Performance Monitor test v1.1\n"));
-}
+AP_PERFMON_REGISTRY(PERFMON_PROBES);
 
-void loop()
+// probes are safe to use in timer processes
+static void timer_proc(uint32_t now)
 {
-    AP_PERFMON_REGISTER
-
-    int16_t i = 0;
-
-    for( i=0; i<10; i++ ) {
-        testFn();
-    }
+    AP_PERFMON_SCOPE(TIMER);
+    hal.scheduler->delay_microseconds(20);
+}
 
-    //AP_PerfMon::DisplayAndClear(5);
-    AP_PerfMon::DisplayResults();
-    AP_PerfMon::ClearAll();
+void setup()
+{
+    hal.console->print_P(PSTR("Performance Monitor test v2.0\n"));
+    AP_PERFMON_INIT();
+    hal.scheduler->register_timer_process(timer_proc);
+}
 
-    hal.scheduler->delay(10000);
+static void testFn2()
+{
+    AP_PERFMON_SCOPE(TEST_FN2);
+    hal.scheduler->delay(10);
 }
 
-void testFn()
+static void testFn()
 {
-    AP_PERFMON_REGISTER
+    AP_PERFMON_SCOPE(TEST_FN);
     hal.scheduler->delay(10);
     testFn2();
     hal.scheduler->delay(10);
 }
 
-void testFn2()
+void loop()
 {
-    AP_PERFMON_REGISTER
-    hal.scheduler->delay(10);
+    {
+        AP_PERFMON_SCOPE(LOOP);
+        for (int16_t i=0; i<10; i++) {
+            testFn();
+        }
+    }
+
+    AP_PerfMon::print(hal.console);
+    AP_PerfMon::clear();
+
+    hal.scheduler->delay(10000);
 }
+
+AP_HAL_MAIN();
@@ -0,0 +1,244 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_Rally.cpp
+/// @brief	Rally points to return to instead of home, with an index for
+///         finding the nearest one quickly.
+
+#include <AP_HAL.h>
+#include "AP_Rally.h"
+
+extern const AP_HAL::HAL& hal;
+
+// the index of no point, in a cell with fewer than it has room for
+#define AP_RALLY_NO_POINT 0xFF
+
+const AP_Param::GroupInfo AP_Rally::var_info[] PROGMEM = {
+    // @Param: TOTAL
+    // @DisplayName: Rally Total
+    // @Description: Number of rally points currently loaded
+    // @User: Advanced
+    AP_GROUPINFO("TOTAL",    0, AP_Rally, _total, 0),
+
+    // @Param: LIMIT_KM
+    // @DisplayName: Rally Limit
+    // @Description: Maximum distance to a rally point. Beyond this the vehicle returns home instead, as the points are likely to be for another field. Zero for no limit
+    // @Units: kilometers
+    // @Increment: 0.1
+    // @User: Advanced
+    AP_GROUPINFO("LIMIT_KM", 1, AP_Rally, _limit_km, 0),
+
+    AP_GROUPEND
+};
+
+AP_Rally::AP_Rally(uint16_t start, uint8_t max_points) :
+    _start(start),
+    _max_points(max_points),
+    _state(INDEX_DIRTY),
+    _build_row(0),
+    _indexed_total(0),
+    _min_lat(0),
+    _min_lng(0),
+    _cell_lat(1),
+    _cell_lng(1),
+    _lng_scale(1)
+{
+    AP_Param::setup_object_defaults(this, var_info);
+}
+
+uint8_t AP_Rally::get_rally_total() const
+{
+    int16_t total = _total;
+    if (total <= 0) {
+        return 0;
+    }
+    return min(total, _max_points);
+}
+
+bool AP_Rally::get_rally_point_with_index(uint8_t i, struct RallyLocation &ret) const
+{
+    if (i >= get_rally_total()) {
+        return false;
+    }
+    hal.storage->read_block(&ret, _start + i * AP_RALLY_POINT_SIZE, AP_RALLY_POINT_SIZE);
+    return true;
+}
+
+bool AP_Rally::set_rally_point_with_index(uint8_t i, const struct RallyLocation &rally_loc)
+{
+    if (i >= get_rally_total()) {
+        return false;
+    }
+    hal.storage->write_block(_start + i * AP_RALLY_POINT_SIZE, &rally_loc, AP_RALLY_POINT_SIZE);
+    _state = INDEX_DIRTY;
+    return true;
+}
+
+uint8_t AP_Rally::cell_row(int32_t lat) const
+{
+    if (lat <= _min_lat) {
+        return 0;
+    }
+    return min((lat - _min_lat) / _cell_lat, AP_RALLY_GRID - 1);
+}
+
+uint8_t AP_Rally::cell_col(int32_t lng) const
+{
+    if (lng <= _min_lng) {
+        return 0;
+    }
+    return min((lng - _min_lng) / _cell_lng, AP_RALLY_GRID - 1);
+}
+
+float AP_Rally::distance_sq(int32_t lat1, int32_t lng1, int32_t lat2, int32_t lng2, float lng_scale) const
+{
+    float dlat = (lat1 - lat2) * LATLON_TO_CM;
+    float dlng = (lng1 - lng2) * LATLON_TO_CM * lng_scale;
+    return dlat*dlat + dlng*dlng;
+}
+
+bool AP_Rally::find_nearest_rally_point(const struct Position &loc, const struct Position &home,
+                                        struct Position &ret) const
+{
+    uint8_t total = get_rally_total();
+    if (total == 0) {
+        return false;
+    }
+
+    // the candidates: those of the location's cell, or every point
+    // while the index is being built
+    const uint8_t *candidates = NULL;
+    uint8_t count = total;
+    if (_state == INDEX_VALID) {
+        candidates = _cell[cell_row(loc.lat)][cell_col(loc.lng)];
+        count = AP_RALLY_CELL_POINTS;
+    }
+
+    float lng_scale = longitude_scale(&loc);
+    struct RallyLocation best;
+    float best_dist_sq = -1;
+    for (uint8_t i=0; i<count; i++) {
+        uint8_t idx = candidates ? candidates[i] : i;
+        struct RallyLocation point;
+        if (idx == AP_RALLY_NO_POINT || !get_rally_point_with_index(idx, point)) {
+            continue;
+        }
+        float d = distance_sq(loc.lat, loc.lng, point.lat, point.lng, lng_scale);
+        if (best_dist_sq < 0 || d < best_dist_sq) {
+            best_dist_sq = d;
+            best = point;
+        }
+    }
+    if (best_dist_sq < 0) {
+        return false;
+    }
+
+    // home if it is nearer, or the point is too far away to be meant
+    // for here
+    if (distance_sq(loc.lat, loc.lng, home.lat, home.lng, lng_scale) <= best_dist_sq) {
+        return false;
+    }
+    float limit_cm = _limit_km * 100000.0f;
+    if (limit_cm > 0 && best_dist_sq > limit_cm * limit_cm) {
+        return false;
+    }
+
+    ret.lat = best.lat;
+    ret.lng = best.lng;
+    ret.alt = home.alt + best.alt * 100L;
+    return true;
+}
+
+/*
+  the bounding box of the points, and the scaling of longitude at its
+  middle
+ */
+void AP_Rally::build_box()
+{
+    uint8_t total = get_rally_total();
+    int32_t max_lat = 0, max_lng = 0;
+    for (uint8_t i=0; i<total; i++) {
+        struct RallyLocation point;
+        get_rally_point_with_index(i, point);
+        if (i == 0 || point.lat < _min_lat) _min_lat = point.lat;
+        if (i == 0 || point.lng < _min_lng) _min_lng = point.lng;
+        if (i == 0 || point.lat > max_lat)  max_lat = point.lat;
+        if (i == 0 || point.lng > max_lng)  max_lng = point.lng;
+    }
+    _cell_lat = (max_lat - _min_lat) / AP_RALLY_GRID + 1;
+    _cell_lng = (max_lng - _min_lng) / AP_RALLY_GRID + 1;
+
+    struct Position middle;
+    middle.lat = _min_lat + (max_lat - _min_lat) / 2;
+    middle.lng = _min_lng + (max_lng - _min_lng) / 2;
+    middle.alt = 0;
+    _lng_scale = longitude_scale(&middle);
+}
+
+/*
+  the points nearest the centre of each cell of a row, with the points
+  read once for the whole row
+ */
+void AP_Rally::build_row(uint8_t row)
+{
+    uint8_t total = get_rally_total();
+    float dist_sq[AP_RALLY_GRID][AP_RALLY_CELL_POINTS];
+    int32_t centre_lat = _min_lat + _cell_lat * row + _cell_lat / 2;
+
+    memset(_cell[row], AP_RALLY_NO_POINT, sizeof(_cell[row]));
+
+    for (uint8_t i=0; i<total; i++) {
+        struct RallyLocation point;
+        get_rally_point_with_index(i, point);
+        for (uint8_t col=0; col<AP_RALLY_GRID; col++) {
+            int32_t centre_lng = _min_lng + _cell_lng * col + _cell_lng / 2;
+            float d = distance_sq(centre_lat, centre_lng, point.lat, point.lng, _lng_scale);
+            uint8_t *cell = _cell[row][col];
+            float *cell_dist = dist_sq[col];
+
+            // insert it in order of distance, dropping the furthest
+            int8_t j = AP_RALLY_CELL_POINTS - 1;
+            if (cell[j] != AP_RALLY_NO_POINT && cell_dist[j] <= d) {
+                continue;
+            }
+            while (j > 0 && (cell[j-1] == AP_RALLY_NO_POINT || cell_dist[j-1] > d)) {
+                cell[j] = cell[j-1];
+                cell_dist[j] = cell_dist[j-1];
+                j--;
+            }
+            cell[j] = i;
+            cell_dist[j] = d;
+        }
+    }
+}
+
+void AP_Rally::update()
+{
+    uint8_t total = get_rally_total();
+    if (total != _indexed_total) {
+        _indexed_total = total;
+        _state = INDEX_DIRTY;
+    }
+
+    switch (_state) {
+    case INDEX_DIRTY:
+        if (total == 0) {
+            _state = INDEX_VALID;
+            memset(_cell, AP_RALLY_NO_POINT, sizeof(_cell));
+            break;
+        }
+        build_box();
+        _build_row = 0;
+        _state = INDEX_BUILDING;
+        break;
+
+    case INDEX_BUILDING:
+        build_row(_build_row);
+        if (++_build_row == AP_RALLY_GRID) {
+            _state = INDEX_VALID;
+        }
+        break;
+
+    case INDEX_VALID:
+        break;
+    }
+}
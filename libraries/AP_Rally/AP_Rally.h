@@ -0,0 +1,127 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_Rally.h
+/// @brief	Rally points to return to instead of home, with an index for
+///         finding the nearest one quickly.
+
+#ifndef __AP_RALLY_H__
+#define __AP_RALLY_H__
+
+#include <AP_Common.h>
+#include <AP_HAL.h>
+#include <AP_Param.h>
+#include <AP_Math.h>
+
+// the index is a grid of AP_RALLY_GRID by AP_RALLY_GRID cells over the
+// points, each holding the AP_RALLY_CELL_POINTS points nearest its centre
+#ifndef AP_RALLY_GRID
+ #if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+  #define AP_RALLY_GRID         4
+  #define AP_RALLY_CELL_POINTS  2
+ #else
+  #define AP_RALLY_GRID         16
+  #define AP_RALLY_CELL_POINTS  4
+ #endif
+#endif
+
+// bits of the flags of a rally point
+#define AP_RALLY_FLAG_LAND      (1U<<0)     ///< land at the point once there
+#define AP_RALLY_FLAG_BREAK_ALT (1U<<1)     ///< descend to the break altitude before landing
+
+/// a rally point as it is kept in the storage
+struct PACKED RallyLocation {
+    int32_t     lat;                        ///< degrees * 1e7
+    int32_t     lng;
+    int16_t     alt;                        ///< transit and loiter altitude, m above home
+    int16_t     break_alt;                  ///< m above home
+    uint16_t    land_dir;                   ///< heading to land on, centi-degrees
+    uint8_t     flags;
+};
+
+// the storage a number of rally points takes
+#define AP_RALLY_POINT_SIZE     sizeof(RallyLocation)
+#define AP_RALLY_STORAGE_SIZE(max_points) ((max_points) * AP_RALLY_POINT_SIZE)
+
+/*
+  The points are uploaded by the GCS like the fence, and kept one after
+  the other in an area of the storage. Finding the nearest of them has
+  to fit in a scheduler slot even with hundreds, so it is looked up in
+  a grid over their bounding box: the location's cell, or the nearest
+  edge cell for a location outside the box, gives a few candidates, and
+  the nearest of those is at most the diagonal of a cell further away
+  than the nearest of all the points.
+
+  The grid is rebuilt a row of cells at a time by update() after the
+  points change, and until it is complete the points are searched one
+  by one.
+ */
+class AP_Rally
+{
+public:
+    /// @param  start       the first byte of the storage for the points
+    /// @param  max_points  how many it has room for
+    AP_Rally(uint16_t start, uint8_t max_points);
+
+    /// the number of points set by the GCS, if no more than fit
+    uint8_t     get_rally_total() const;
+    uint8_t     get_rally_max() const { return _max_points; }
+
+    bool        get_rally_point_with_index(uint8_t i, struct RallyLocation &ret) const;
+    bool        set_rally_point_with_index(uint8_t i, const struct RallyLocation &rally_loc);
+
+    /// Where to return to from loc: the nearest rally point, unless home
+    /// is nearer or the point is further than the limit
+    ///
+    /// @param  ret     the point, with its altitude in cm on the same
+    ///                 datum as home's
+    /// @returns        false if it is to be home
+    ///
+    bool        find_nearest_rally_point(const struct Position &loc, const struct Position &home,
+                                         struct Position &ret) const;
+
+    /// Build the index a row at a time after the points have changed.
+    /// Call at a few Hz
+    void        update();
+
+    static const struct AP_Param::GroupInfo var_info[];
+
+private:
+    enum index_state {
+        INDEX_DIRTY = 0,                    ///< the points changed, start again
+        INDEX_BUILDING,                     ///< the box is known, _build_row is next
+        INDEX_VALID
+    };
+
+    // the cell holding a location, clamped to the grid
+    uint8_t     cell_row(int32_t lat) const;
+    uint8_t     cell_col(int32_t lng) const;
+
+    // square of the distance in cm between two locations, near enough
+    // to each other for a flat earth
+    float       distance_sq(int32_t lat1, int32_t lng1, int32_t lat2, int32_t lng2, float lng_scale) const;
+
+    void        build_box();
+    void        build_row(uint8_t row);
+
+    AP_Int16    _total;
+    AP_Float    _limit_km;
+
+    uint16_t    _start;
+    uint8_t     _max_points;
+
+    enum index_state _state;
+    uint8_t     _build_row;
+    uint8_t     _indexed_total;
+
+    // the bounding box of the points, the size of its cells, and the
+    // longitude scaling at its middle
+    int32_t     _min_lat, _min_lng;
+    int32_t     _cell_lat, _cell_lng;
+    float       _lng_scale;
+
+    // indices of the candidates of each cell, 0xFF where there are
+    // fewer points than places
+    uint8_t     _cell[AP_RALLY_GRID][AP_RALLY_GRID][AP_RALLY_CELL_POINTS];
+};
+
+#endif // __AP_RALLY_H__
@@ -35,6 +35,7 @@ AP_RangeFinder_MaxsonarXL::AP_RangeFinder_MaxsonarXL(AP_HAL::AnalogSource *sourc
 {
     max_distance = AP_RANGEFINDER_MAXSONARXL_MAX_DISTANCE;
     min_distance = AP_RANGEFINDER_MAXSONARXL_MIN_DISTANCE;
+    sample_interval_ms = AP_RANGEFINDER_MAXSONARXL_SAMPLE_MS;
 }
 
 // Public Methods //////////////////////////////////////////////////////////////
@@ -46,21 +47,25 @@ float AP_RangeFinder_MaxsonarXL::calculate_scaler(int sonar_type, float adc_refe
         type_scaler = AP_RANGEFINDER_MAXSONARXL_SCALER;
         min_distance = AP_RANGEFINDER_MAXSONARXL_MIN_DISTANCE;
         max_distance = AP_RANGEFINDER_MAXSONARXL_MAX_DISTANCE;
+        sample_interval_ms = AP_RANGEFINDER_MAXSONARXL_SAMPLE_MS;
         break;
     case AP_RANGEFINDER_MAXSONARLV:
         type_scaler = AP_RANGEFINDER_MAXSONARLV_SCALER;
         min_distance = AP_RANGEFINDER_MAXSONARLV_MIN_DISTANCE;
         max_distance = AP_RANGEFINDER_MAXSONARLV_MAX_DISTANCE;
+        sample_interval_ms = AP_RANGEFINDER_MAXSONARLV_SAMPLE_MS;
         break;
     case AP_RANGEFINDER_MAXSONARXLL:
         type_scaler = AP_RANGEFINDER_MAXSONARXLL_SCALER;
         min_distance = AP_RANGEFINDER_MAXSONARXLL_MIN_DISTANCE;
         max_distance = AP_RANGEFINDER_MAXSONARXLL_MAX_DISTANCE;
+        sample_interval_ms = AP_RANGEFINDER_MAXSONARXLL_SAMPLE_MS;
         break;
     case AP_RANGEFINDER_MAXSONARHRLV:
         type_scaler = AP_RANGEFINDER_MAXSONARHRLV_SCALER;
         min_distance = AP_RANGEFINDER_MAXSONARHRLV_MIN_DISTANCE;
         max_distance = AP_RANGEFINDER_MAXSONARHRLV_MAX_DISTANCE;
+        sample_interval_ms = AP_RANGEFINDER_MAXSONARHRLV_SAMPLE_MS;
         break;
     }
     _scaler = type_scaler * adc_refence_voltage / 5.0f;
@@ -8,24 +8,28 @@
 #define AP_RANGEFINDER_MAXSONARXL_SCALER 1.0
 #define AP_RANGEFINDER_MAXSONARXL_MIN_DISTANCE 20
 #define AP_RANGEFINDER_MAXSONARXL_MAX_DISTANCE 765
+#define AP_RANGEFINDER_MAXSONARXL_SAMPLE_MS 100
 
 // LV-EZ0 (aka LV)
 #define AP_RANGEFINDER_MAXSONARLV 1
 #define AP_RANGEFINDER_MAXSONARLV_SCALER (2.54/2.0)
 #define AP_RANGEFINDER_MAXSONARLV_MIN_DISTANCE 15
 #define AP_RANGEFINDER_MAXSONARLV_MAX_DISTANCE 645
+#define AP_RANGEFINDER_MAXSONARLV_SAMPLE_MS 50
 
 // XL-EZL0 (aka XLL)
 #define AP_RANGEFINDER_MAXSONARXLL 2
 #define AP_RANGEFINDER_MAXSONARXLL_SCALER 2.0
 #define AP_RANGEFINDER_MAXSONARXLL_MIN_DISTANCE 20
 #define AP_RANGEFINDER_MAXSONARXLL_MAX_DISTANCE 1068
+#define AP_RANGEFINDER_MAXSONARXLL_SAMPLE_MS 100
 
 // HRLV-MaxSonar-EZ0 (aka HRLV)
 #define AP_RANGEFINDER_MAXSONARHRLV 3
 #define AP_RANGEFINDER_MAXSONARHRLV_SCALER 0.512
 #define AP_RANGEFINDER_MAXSONARHRLV_MIN_DISTANCE 30
 #define AP_RANGEFINDER_MAXSONARHRLV_MAX_DISTANCE 500
+#define AP_RANGEFINDER_MAXSONARHRLV_SAMPLE_MS 100
 
 class AP_RangeFinder_MaxsonarXL : public RangeFinder
 {
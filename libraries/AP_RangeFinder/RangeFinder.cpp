@@ -13,6 +13,10 @@
  */
 #include "RangeFinder.h"
 
+extern const AP_HAL::HAL& hal;
+
+RangeFinder *RangeFinder::_instance;
+
 // Public Methods //////////////////////////////////////////////////////////////
 
 void RangeFinder::set_orientation(int x, int y, int z)
@@ -24,6 +28,14 @@ void RangeFinder::set_orientation(int x, int y, int z)
 
 // Read Sensor data - only the raw_value is filled in by this parent class
 int RangeFinder::read()
+{
+    if (_timer_started) {
+        return distance;
+    }
+    return sample();
+}
+
+int RangeFinder::sample()
 {
     int temp_dist;
 
@@ -38,3 +50,42 @@ int RangeFinder::read()
     return distance;
 }
 
+void RangeFinder::start_timer()
+{
+    if (_timer_started) {
+        return;
+    }
+    _instance = this;
+    _timer_started = true;
+    // the source averages over each interval, and the timer takes each
+    // average once, as soon as it is made
+    _analog_source->set_sample_rate(1000 / sample_interval_ms);
+    hal.scheduler->register_timer_process(_timer);
+}
+
+bool RangeFinder::new_reading(int &dist)
+{
+    if (!_new_reading) {
+        return false;
+    }
+    hal.scheduler->suspend_timer_procs();
+    dist = distance;
+    _new_reading = false;
+    hal.scheduler->resume_timer_procs();
+    return true;
+}
+
+/*
+  called at 1kHz. A reading is only taken once the sensor has had time
+  to make a new one, so the mode filter sees each measurement once
+ */
+void RangeFinder::_timer(uint32_t now_us)
+{
+    RangeFinder *rf = _instance;
+    uint32_t sample_ms;
+    if (!rf->_analog_source->sample_ready(sample_ms)) {
+        return;
+    }
+    rf->sample();
+    rf->_new_reading = true;
+}
@@ -5,6 +5,9 @@
 #include <AP_HAL.h>
 #include <Filter.h> // Filter library
 
+// default time between readings taken by the timer process, in milliseconds
+#define AP_RANGEFINDER_SAMPLE_INTERVAL_MS 50
+
 /*
  * #define AP_RANGEFINDER_ORIENTATION_FRONT		  0, 10,  0
  * #define AP_RANGEFINDER_ORIENTATION_RIGHT		-10,  0,  0
@@ -22,8 +25,11 @@ class RangeFinder
 {
 protected:
     RangeFinder(AP_HAL::AnalogSource * source, FilterInt16 *filter) :
+        sample_interval_ms(AP_RANGEFINDER_SAMPLE_INTERVAL_MS),
         _analog_source(source),
-        _mode_filter(filter) {
+        _mode_filter(filter),
+        _timer_started(false),
+        _new_reading(false) {
     }
 public:
     // raw_value: read the sensor
@@ -48,11 +54,43 @@ public:
     }
     /**
      * read:
-     * read value from sensor and return distance in cm
+     * read value from sensor and return distance in cm. Once the timer
+     * process is sampling the sensor this returns its latest reading
      */
     virtual int read();
 
+    /**
+     * start_timer:
+     * take readings of an analog rangefinder from the timer process,
+     * each the average of sample_interval_ms of the source, so readings
+     * are taken at the rate the sensor makes them however often they
+     * are asked for. Only one
+     * rangefinder can be sampled this way
+     */
+    void start_timer();
+
+    /**
+     * new_reading:
+     * true once for each reading taken by the timer process, with the
+     * distance in cm
+     */
+    bool new_reading(int &dist);
+
+    // time between readings taken by the timer process, in milliseconds
+    uint16_t sample_interval_ms;
+
     AP_HAL::AnalogSource*       _analog_source;
     FilterInt16 *           _mode_filter;
+
+protected:
+    // read the analog source, convert and filter it
+    int sample();
+
+private:
+    static void _timer(uint32_t now_us);
+
+    static RangeFinder *_instance;
+    bool _timer_started;
+    volatile bool _new_reading;
 };
 #endif // __RANGEFINDER_H__
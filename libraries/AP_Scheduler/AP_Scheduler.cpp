@@ -23,6 +23,20 @@ const AP_Param::GroupInfo AP_Scheduler::var_info[] PROGMEM = {
     // @Values: 0:Disabled,1:ShowSlipe,2:ShowOverruns
     // @User: Advanced
     AP_GROUPINFO("DEBUG",    0, AP_Scheduler, _debug, 0),
+
+    // @Param: MODE
+    // @DisplayName: Scheduler mode
+    // @Description: Selects how due tasks are ordered. TableOrder runs due tasks in the order of the task table. Deadline runs the most overdue task that fits in the remaining time first
+    // @Values: 0:TableOrder,1:Deadline
+    // @User: Advanced
+    AP_GROUPINFO("MODE",     1, AP_Scheduler, _mode, SCHED_MODE_TABLE),
+
+    // @Param: ADAPT
+    // @DisplayName: Scheduler adaptive budgets
+    // @Description: When enabled, a due task is run if the 95th percentile of its run times measured on this board fits in the time left in the loop, instead of its time allowance from the task table. The table allowance stays the upper limit, and is still what an overrun is counted against
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("ADAPT",    2, AP_Scheduler, _adapt, 0),
     AP_GROUPEND
 };
 
@@ -33,13 +47,163 @@ void AP_Scheduler::init(const AP_Scheduler::Task *tasks, uint8_t num_tasks)
     _num_tasks = num_tasks;
     _last_run = new uint16_t[_num_tasks];
     memset(_last_run, 0, sizeof(_last_run[0]) * _num_tasks);
+    _offload_busy = new bool[_num_tasks];
+    for (uint8_t i=0; i<_num_tasks; i++) {
+        _offload_busy[i] = false;
+    }
+    _task_stats = new struct TaskStats[_num_tasks];
+    reset_task_stats();
+    _learned_time = new uint16_t[_num_tasks];
+    memset(_learned_time, 0, sizeof(_learned_time[0]) * _num_tasks);
+    _learned_spread = new uint16_t[_num_tasks];
+    memset(_learned_spread, 0, sizeof(_learned_spread[0]) * _num_tasks);
+    _learned_runs = new uint8_t[_num_tasks];
+    memset(_learned_runs, 0, sizeof(_learned_runs[0]) * _num_tasks);
     _tick_counter = 0;
+    _loops_per_tick = 1;
+    _loop_counter = 0;
+}
+
+// set the number of sketch loops per table tick
+void AP_Scheduler::set_loops_per_tick(uint8_t loops_per_tick)
+{
+    _loops_per_tick = loops_per_tick > 0 ? loops_per_tick : 1;
+    _loop_counter = 0;
+}
+
+// set the table of microsecond scheduled tasks
+void AP_Scheduler::init_fast(const AP_Scheduler::FastTask *tasks, uint8_t num_tasks)
+{
+    _fast_tasks = tasks;
+    _num_fast_tasks = num_tasks;
+    _fast_next_run = new uint32_t[_num_fast_tasks];
+    uint32_t now = hal.scheduler->micros();
+    for (uint8_t i=0; i<_num_fast_tasks; i++) {
+        _fast_next_run[i] = now;
+    }
+    _fast_overruns = 0;
 }
 
 // one tick has passed
 void AP_Scheduler::tick(void)
 {
-    _tick_counter++;
+    uint32_t now = hal.scheduler->micros();
+    if (_last_tick_usec != 0) {
+        update_loop_stats(now - _last_tick_usec, _tick_slack_usec);
+    }
+    _last_tick_usec = now;
+    _tick_slack_usec = 0;
+
+    if (++_loop_counter >= _loops_per_tick) {
+        _loop_counter = 0;
+        _tick_counter++;
+    }
+}
+
+/*
+  the time allowance of a task, scaled for the loop rate
+ */
+uint16_t AP_Scheduler::task_time_allowed(uint8_t i) const
+{
+    return pgm_read_word(&_tasks[i].max_time_micros) / _loops_per_tick;
+}
+
+/*
+  the time a task needs left in the tick to be run. A learned run time
+  doesn't depend on the loop rate, so it isn't scaled
+ */
+uint16_t AP_Scheduler::task_admission_micros(uint8_t i) const
+{
+    uint16_t allowed = task_time_allowed(i);
+    if (!_adapt) {
+        return allowed;
+    }
+    uint16_t learned = task_learned_micros(i);
+    if (learned == 0 || learned > allowed) {
+        return allowed;
+    }
+    return learned;
+}
+
+/*
+  run a single task, updating its statistics. Returns false if the
+  task overran its time allowance
+ */
+bool AP_Scheduler::run_task(uint8_t i, uint16_t &time_available)
+{
+    _task_time_allowed = task_time_allowed(i);
+
+    uint16_t dt = _tick_counter - _last_run[i];
+    uint16_t interval_ticks = pgm_read_word(&_tasks[i].interval_ticks);
+    if (dt >= interval_ticks*2) {
+        // we've slipped a whole run of this task!
+        if (_debug != 0) {
+            hal.console->printf_P(PSTR("Scheduler slip task[%u] (%u/%u/%u)\n"), 
+                                  (unsigned)i, 
+                                  (unsigned)dt,
+                                  (unsigned)interval_ticks,
+                                  (unsigned)_task_time_allowed);
+        }
+    }
+
+    task_fn_t func = (task_fn_t)pgm_read_pointer(&_tasks[i].function);
+
+    if (pgm_read_byte(&_tasks[i].flags) & AP_SCHEDULER_FLAG_OFF_MAIN) {
+        _offload_busy[i] = true;
+        if (hal.scheduler->queue_worker_proc(func, &_offload_busy[i])) {
+            // the worker thread will run it. It costs the main
+            // thread nothing, so no statistics are kept
+            _last_run[i] = _tick_counter;
+            return true;
+        }
+        // no worker thread, run it here
+        _offload_busy[i] = false;
+    }
+
+    _task_time_started = hal.scheduler->micros();
+    func();
+
+    // record the tick counter when we ran. This drives
+    // when we next run the event
+    _last_run[i] = _tick_counter;
+
+    // work out how long the event actually took
+    uint32_t time_taken = hal.scheduler->micros() - _task_time_started;
+    update_task_stats(i, time_taken);
+    learn_task_time(i, time_taken);
+
+    if (time_taken > _task_time_allowed) {
+        _task_stats[i].overrun_count++;
+        // the event overran!
+        if (_debug > 1) {
+            hal.console->printf_P(PSTR("Scheduler overrun task[%u] (%u/%u)\n"), 
+                                  (unsigned)i, 
+                                  (unsigned)time_taken,
+                                  (unsigned)_task_time_allowed);
+        }
+        return false;
+    }
+    time_available -= time_taken;
+    return true;
+}
+
+/*
+  check if task i is due, returning how many ticks it is late by, or
+  -1 if it isn't due yet
+ */
+int16_t AP_Scheduler::task_lateness(uint8_t i) const
+{
+    if (_offload_busy[i]) {
+        // still running on the worker thread from a previous tick
+        return -1;
+    }
+    uint16_t dt = _tick_counter - _last_run[i];
+    uint16_t interval_ticks = pgm_read_word(&_tasks[i].interval_ticks);
+    if (dt < interval_ticks) {
+        return -1;
+    }
+    uint16_t late = dt - interval_ticks;
+    return late > 0x7FFF ? 0x7FFF : (int16_t)late;
 }
 
 /*
@@ -48,55 +212,19 @@ void AP_Scheduler::tick(void)
  */
 void AP_Scheduler::run(uint16_t time_available)
 {
-    for (uint8_t i=0; i<_num_tasks; i++) {
-        uint16_t dt = _tick_counter - _last_run[i];
-        uint16_t interval_ticks = pgm_read_word(&_tasks[i].interval_ticks);
-        if (dt >= interval_ticks) {
-            // this task is due to run. Do we have enough time to run it?
-            _task_time_allowed = pgm_read_word(&_tasks[i].max_time_micros);
-
-            if (dt >= interval_ticks*2) {
-                // we've slipped a whole run of this task!
-                if (_debug != 0) {
-                    hal.console->printf_P(PSTR("Scheduler slip task[%u] (%u/%u/%u)\n"), 
-                                          (unsigned)i, 
-                                          (unsigned)dt,
-                                          (unsigned)interval_ticks,
-                                          (unsigned)_task_time_allowed);
-                }
-            }
-            if (_task_time_allowed <= time_available) {
-                // run it
-                _task_time_started = hal.scheduler->micros();
-                task_fn_t func = (task_fn_t)pgm_read_pointer(&_tasks[i].function);
-                func();
-                
-                // record the tick counter when we ran. This drives
-                // when we next run the event
-                _last_run[i] = _tick_counter;
-                
-                // work out how long the event actually took
-                uint32_t time_taken = hal.scheduler->micros() - _task_time_started;
-                
-                if (time_taken > _task_time_allowed) {
-                    // the event overran!
-                    if (_debug > 1) {
-                        hal.console->printf_P(PSTR("Scheduler overrun task[%u] (%u/%u)\n"), 
-                                              (unsigned)i, 
-                                              (unsigned)time_taken,
-                                              (unsigned)_task_time_allowed);
-                    }
-                    goto update_spare_ticks;
-                }
-                time_available -= time_taken;
-            }
-        }
+    bool overrun;
+    if (_mode == SCHED_MODE_DEADLINE) {
+        overrun = !run_deadline(time_available);
+    } else {
+        overrun = !run_table_order(time_available);
     }
 
-    // update number of spare microseconds
-    _spare_micros += time_available;
+    if (!overrun) {
+        // update number of spare microseconds
+        _spare_micros += time_available;
+    }
+    _tick_slack_usec = overrun ? 0 : time_available;
 
-update_spare_ticks:
     _spare_ticks++;
     if (_spare_ticks == 32) {
         _spare_ticks /= 2;
@@ -104,6 +232,277 @@ update_spare_ticks:
     }
 }
 
+/*
+  run due tasks in the order they appear in the task table. Returns
+  false if a task overran
+ */
+bool AP_Scheduler::run_table_order(uint16_t &time_available)
+{
+    for (uint8_t i=0; i<_num_tasks; i++) {
+        if (task_lateness(i) < 0) {
+            continue;
+        }
+        // this task is due to run. Do we have enough time to run it?
+        if (task_admission_micros(i) > time_available) {
+            // not enough time left in this tick, try again next tick
+            _task_stats[i].skip_count++;
+            continue;
+        }
+        if (!run_task(i, time_available)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+  earliest deadline first: repeatedly run the most overdue task whose
+  time allowance fits in the remaining time. Ties go to the task
+  earliest in the table. Returns false if a task overran
+ */
+bool AP_Scheduler::run_deadline(uint16_t &time_available)
+{
+    for (;;) {
+        int16_t best_lateness = -1;
+        uint8_t best = 0;
+        for (uint8_t i=0; i<_num_tasks; i++) {
+            int16_t lateness = task_lateness(i);
+            if (lateness > best_lateness &&
+                task_admission_micros(i) <= time_available) {
+                best_lateness = lateness;
+                best = i;
+            }
+        }
+        if (best_lateness < 0) {
+            break;
+        }
+        if (!run_task(best, time_available)) {
+            return false;
+        }
+    }
+
+    // anything still due didn't fit in this tick
+    for (uint8_t i=0; i<_num_tasks; i++) {
+        if (task_lateness(i) >= 0) {
+            _task_stats[i].skip_count++;
+        }
+    }
+    return true;
+}
+
+/*
+  run the microsecond scheduled tasks that are due. Each task's next
+  deadline is advanced by its interval so the average rate is exact
+  even when the interval is not a multiple of the caller's loop
+  period. If a task has fallen more than a whole interval behind it
+  is rescheduled relative to now rather than run repeatedly to catch
+  up
+ */
+uint8_t AP_Scheduler::run_fast(void)
+{
+    uint8_t num_run = 0;
+    for (uint8_t i=0; i<_num_fast_tasks; i++) {
+        uint32_t now = hal.scheduler->micros();
+        if ((int32_t)(now - _fast_next_run[i]) < 0) {
+            continue;
+        }
+        uint32_t interval = pgm_read_dword(&_fast_tasks[i].interval_micros);
+        _fast_next_run[i] += interval;
+        if ((int32_t)(now - _fast_next_run[i]) >= 0) {
+            _fast_next_run[i] = now + interval;
+        }
+
+        task_fn_t func = (task_fn_t)pgm_read_pointer(&_fast_tasks[i].function);
+        func();
+        num_run++;
+
+        uint32_t time_taken = hal.scheduler->micros() - now;
+        uint16_t time_allowed = pgm_read_word(&_fast_tasks[i].max_time_micros);
+        if (time_taken > time_allowed) {
+            _fast_overruns++;
+            if (_debug > 1) {
+                hal.console->printf_P(PSTR("Scheduler overrun fast task[%u] (%u/%u)\n"), 
+                                      (unsigned)i, 
+                                      (unsigned)time_taken,
+                                      (unsigned)time_allowed);
+            }
+        }
+    }
+    return num_run;
+}
+
+/*
+  record the execution time of one run of a task
+ */
+void AP_Scheduler::update_task_stats(uint8_t i, uint32_t time_taken)
+{
+    struct TaskStats &st = _task_stats[i];
+    uint16_t t = time_taken > 0xFFFF ? 0xFFFF : (uint16_t)time_taken;
+    if (st.run_count == 0 || t < st.min_time_micros) {
+        st.min_time_micros = t;
+    }
+    if (t > st.max_time_micros) {
+        st.max_time_micros = t;
+    }
+    if (st.run_count < 0xFFFF) {
+        st.run_count++;
+        st.total_time_micros += t;
+    }
+}
+
+/*
+  update the estimate of the 95th percentile run time of a task. It
+  steps up 19 times as far for a longer run as it steps down for a
+  shorter one, so it settles where one run in 20 is longer. The step is
+  a small part of the spread of the run times, so the estimate follows
+  both steady and noisy tasks without wandering far from the
+  percentile. Times are in quarter microseconds, so up to 16ms
+ */
+void AP_Scheduler::learn_task_time(uint8_t i, uint32_t time_taken)
+{
+    uint16_t t = time_taken > 0x3FFF ? 0xFFFF : (uint16_t)(time_taken * 4);
+    uint16_t &q = _learned_time[i];
+    uint16_t &spread = _learned_spread[i];
+    if (_learned_runs[i] == 0) {
+        q = t;
+        spread = 0;
+    }
+    if (_learned_runs[i] < AP_SCHEDULER_LEARN_RUNS) {
+        _learned_runs[i]++;
+    }
+
+    uint16_t d = t > q ? t - q : q - t;
+    if (d >= spread) {
+        spread += (d - spread) / 16;
+    } else {
+        spread -= (spread - d + 15) / 16;
+    }
+
+    uint16_t step = spread / 32 + 1;
+    if (t > q) {
+        uint32_t up = (uint32_t)q + 19U*step;
+        q = up > 0xFFFF ? 0xFFFF : (uint16_t)up;
+    } else if (q - t > step) {
+        q -= step;
+    } else {
+        q = t;
+    }
+}
+
+uint16_t AP_Scheduler::task_learned_micros(uint8_t i) const
+{
+    if (i >= _num_tasks || _learned_runs[i] < AP_SCHEDULER_LEARN_RUNS) {
+        return 0;
+    }
+    // never 0 once learned
+    return _learned_time[i] / 4 + 1;
+}
+
+/*
+  return the statistics for one task
+ */
+const struct AP_Scheduler::TaskStats *AP_Scheduler::task_stats(uint8_t i) const
+{
+    if (i >= _num_tasks) {
+        return NULL;
+    }
+    return &_task_stats[i];
+}
+
+/*
+  return the mean execution time of a task in microseconds
+ */
+uint16_t AP_Scheduler::task_mean_micros(uint8_t i) const
+{
+    if (i >= _num_tasks || _task_stats[i].run_count == 0) {
+        return 0;
+    }
+    return _task_stats[i].total_time_micros / _task_stats[i].run_count;
+}
+
+/*
+  reset the per-task statistics, typically called after they have
+  been logged
+ */
+void AP_Scheduler::reset_task_stats(void)
+{
+    memset(_task_stats, 0, sizeof(_task_stats[0]) * _num_tasks);
+    memset(&_loop_stats, 0, sizeof(_loop_stats));
+}
+
+/*
+  the histogram bucket of a loop time, a quarter of a doubling wide
+ */
+static uint8_t loop_bucket(uint32_t loop_time)
+{
+    if (loop_time < 1024) {
+        return 0;
+    }
+    uint8_t msb = 10;
+    while (msb < 31 && (loop_time >> (msb+1)) != 0) {
+        msb++;
+    }
+    uint16_t b = 1 + (msb - 10) * 4 + ((loop_time >> (msb-2)) & 3);
+    return b < AP_SCHEDULER_LOOP_BUCKETS ? b : AP_SCHEDULER_LOOP_BUCKETS-1;
+}
+
+uint32_t AP_Scheduler::loop_bucket_micros(uint8_t b)
+{
+    if (b == 0) {
+        return 0;
+    }
+    uint8_t msb = 10 + (b-1) / 4;
+    return (1UL << msb) + ((b-1) % 4) * (1UL << (msb-2));
+}
+
+/*
+  record one main loop
+ */
+void AP_Scheduler::update_loop_stats(uint32_t loop_time, uint16_t slack)
+{
+    struct LoopStats &st = _loop_stats;
+    if (st.count == 0xFFFF) {
+        return;
+    }
+    if (st.count == 0 || slack < st.min_slack_micros) {
+        st.min_slack_micros = slack;
+    }
+    st.count++;
+    st.total_slack_micros += slack;
+    if (loop_time > st.max_micros) {
+        st.max_micros = loop_time;
+    }
+    if (_loop_period_usec != 0 && loop_time > _loop_period_usec + _loop_period_usec/20) {
+        st.long_count++;
+    }
+    st.hist[loop_bucket(loop_time)]++;
+}
+
+uint16_t AP_Scheduler::loop_mean_slack_micros(void) const
+{
+    if (_loop_stats.count == 0) {
+        return 0;
+    }
+    return _loop_stats.total_slack_micros / _loop_stats.count;
+}
+
+uint32_t AP_Scheduler::loop_percentile_micros(uint8_t percent) const
+{
+    uint32_t target = ((uint32_t)_loop_stats.count * percent + 99) / 100;
+    uint32_t total = 0;
+    if (target == 0) {
+        return 0;
+    }
+    for (uint8_t b=0; b<AP_SCHEDULER_LOOP_BUCKETS-1; b++) {
+        total += _loop_stats.hist[b];
+        if (total >= target) {
+            uint32_t top = loop_bucket_micros(b+1);
+            return top < _loop_stats.max_micros ? top : _loop_stats.max_micros;
+        }
+    }
+    return _loop_stats.max_micros;
+}
+
 /*
   return number of micros until the current task reaches its deadline
  */
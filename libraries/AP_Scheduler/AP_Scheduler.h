@@ -15,6 +15,25 @@
 
 #include <AP_Param.h>
 
+// Task flags
+// the task may be run by the HAL worker thread instead of the main
+// thread, on boards that have one (currently PX4). See the data
+// ownership notes below before setting this on a task
+#define AP_SCHEDULER_FLAG_OFF_MAIN 1
+
+// values for the SCHED_MODE parameter
+#define SCHED_MODE_TABLE    0
+#define SCHED_MODE_DEADLINE 1
+
+// buckets of the loop time histogram. Each doubling of the time from
+// 1024us is split into four, so bucket b > 0 starts at
+// 2^(10+(b-1)/4) * (1 + ((b-1)%4)/4) microseconds. Bucket 0 takes any
+// shorter loop, and the last, from 49152us, any longer one
+#define AP_SCHEDULER_LOOP_BUCKETS 24
+
+// runs of a task that are timed before its learned budget is used
+#define AP_SCHEDULER_LEARN_RUNS 64
+
 /*
   A task scheduler for APM main loops
 
@@ -23,6 +42,28 @@
 
   To run tasks use scheduler.run(), passing the amount of time that
   the scheduler is allowed to use before it must return
+
+  Tasks that need to run faster than the tick rate, or at rates that
+  are not a whole number of ticks, can be given in a separate
+  microsecond based FastTask table with init_fast(). Those are run by
+  run_fast(), which should be called as often as possible from the
+  sketch loop
+
+  Data ownership for tasks flagged AP_SCHEDULER_FLAG_OFF_MAIN:
+
+  - the main thread owns all vehicle state. An off-main task may read
+    it, but must tolerate seeing values that are being updated (eg. a
+    Vector3f with only some of its elements written) and must not
+    write it
+  - a device or buffer that an off-main task writes (a GCS link, the
+    DataFlash log) is owned by that task while offloading is enabled,
+    and the main thread must not write to it at the same time
+  - an off-main task is never queued again until its previous run has
+    completed, so it does not need to be re-entrant
+  - time_available_usec() has no meaning when called from an off-main
+    task
+  - on boards without a worker thread the task just runs on the main
+    thread as usual
  */
 
 class AP_Scheduler
@@ -34,14 +75,41 @@ public:
 		task_fn_t function;
 		uint16_t interval_ticks;
 		uint16_t max_time_micros;
+		uint8_t flags;
+	};
+
+	// a task scheduled on the microsecond clock rather than on ticks
+	struct FastTask {
+		task_fn_t function;
+		uint32_t interval_micros;
+		uint16_t max_time_micros;
 	};
 
 	// initialise scheduler
 	void init(const Task *tasks, uint8_t num_tasks);
 
+	// set the table of microsecond scheduled tasks
+	void init_fast(const FastTask *tasks, uint8_t num_tasks);
+
+	// run any microsecond scheduled tasks that are due, returning
+	// the number of tasks run
+	uint8_t run_fast(void);
+
+	// number of fast task overruns since startup
+	uint16_t fast_overruns(void) const { return _fast_overruns; }
+
 	// call when one tick has passed
 	void tick(void);
 
+	// run the task table from a sketch loop that is loops_per_tick
+	// times faster than the tick rate the table is written for. Only
+	// every loops_per_tick'th call to tick() then advances the table,
+	// so the tasks keep their rates, and the time allowances are
+	// divided by loops_per_tick to fit the shorter gaps between loops.
+	// Only boards that run the tasks that much faster than the board
+	// the allowances were measured on should use a faster loop
+	void set_loops_per_tick(uint8_t loops_per_tick);
+
 	// run the tasks. Call this once per 'tick'. 
 	// time_available is the amount of time available to run 
 	// tasks in microseconds
@@ -58,11 +126,75 @@ public:
     // end of a run()
     float load_average(uint32_t tick_time_usec) const;
 
+    // per-task runtime statistics, accumulated by run() between
+    // calls to reset_task_stats()
+    struct TaskStats {
+        uint16_t min_time_micros;
+        uint16_t max_time_micros;
+        uint32_t total_time_micros;
+        uint16_t run_count;
+        uint16_t overrun_count;
+        uint16_t skip_count;
+    };
+
+    // number of tasks in the task table
+    uint8_t num_tasks(void) const { return _num_tasks; }
+
+    // return statistics for task i, or NULL if out of range
+    const struct TaskStats *task_stats(uint8_t i) const;
+
+    // return mean execution time for task i in microseconds
+    uint16_t task_mean_micros(uint8_t i) const;
+
+    // the 95th percentile of the run times of task i on this board,
+    // as learned since startup, or 0 until it has run
+    // AP_SCHEDULER_LEARN_RUNS times on the main thread. With SCHED_ADAPT
+    // set, run() admits the task when this fits in the time left,
+    // rather than its time allowance from the table, if it is less
+    uint16_t task_learned_micros(uint8_t i) const;
+
+    // reset the per-task and loop statistics
+    void reset_task_stats(void);
+
+    // set the period the sketch loop is meant to run at. A loop more
+    // than 5% longer is counted as long running
+    void set_loop_period(uint32_t period_usec) { _loop_period_usec = period_usec; }
+
+    // main loop timing, accumulated by tick() and run() between calls
+    // to reset_task_stats(). The slack is the time the last run()
+    // before each tick had left over, so how long the loop waited
+    // for the next sample
+    struct LoopStats {
+        uint16_t count;
+        uint16_t long_count;
+        uint32_t max_micros;
+        uint16_t min_slack_micros;
+        uint32_t total_slack_micros;
+        uint16_t hist[AP_SCHEDULER_LOOP_BUCKETS];
+    };
+    const struct LoopStats &loop_stats(void) const { return _loop_stats; }
+
+    // mean slack in microseconds
+    uint16_t loop_mean_slack_micros(void) const;
+
+    // the loop time that percent percent of loops were within, as the
+    // top of the histogram bucket it falls in
+    uint32_t loop_percentile_micros(uint8_t percent) const;
+
+    // the first loop time in microseconds of histogram bucket b
+    static uint32_t loop_bucket_micros(uint8_t b);
+
 	static const struct AP_Param::GroupInfo var_info[];
 
 private:
 	// used to enable scheduler debugging
 	AP_Int8 _debug;
+
+	// task ordering mode, one of SCHED_MODE_*
+	AP_Int8 _mode;
+
+	// admit tasks on their learned run times
+	AP_Int8 _adapt;
 	
 	// progmem list of tasks to run
 	const struct Task *_tasks;
@@ -74,9 +206,58 @@ private:
 	// tick() has been called
 	uint16_t _tick_counter;
 
+	// sketch loops per table tick, and the count of them since the
+	// last table tick
+	uint8_t _loops_per_tick;
+	uint8_t _loop_counter;
+
+	// time allowance of task i, for the current loop rate
+	uint16_t task_time_allowed(uint8_t i) const;
+
+	// the time left in the tick that task i needs to be run
+	uint16_t task_admission_micros(uint8_t i) const;
+
+	// running estimate of the 95th percentile run time of each task
+	// and of the mean distance of its runs from it, in quarter
+	// microseconds, and the runs they are from, up to
+	// AP_SCHEDULER_LEARN_RUNS
+	uint16_t *_learned_time;
+	uint16_t *_learned_spread;
+	uint8_t *_learned_runs;
+
+	// take one run of task i into its estimate
+	void learn_task_time(uint8_t i, uint32_t time_taken);
+
 	// tick counter at the time we last ran each task
 	uint16_t *_last_run;
 
+	// set while an off-main task is queued or running on the worker
+	volatile bool *_offload_busy;
+
+	// runtime statistics for each task, indexed as _tasks
+	struct TaskStats *_task_stats;
+
+	// record one completed run of task i
+	void update_task_stats(uint8_t i, uint32_t time_taken);
+
+	// record the time since the last tick
+	void update_loop_stats(uint32_t loop_time, uint16_t slack);
+
+	uint32_t _loop_period_usec;
+	uint32_t _last_tick_usec;
+	uint16_t _tick_slack_usec;          // left over by the last run() in this tick
+	struct LoopStats _loop_stats;
+
+	// ticks that task i is overdue by, or -1 if not due
+	int16_t task_lateness(uint8_t i) const;
+
+	// run task i, returning false on overrun
+	bool run_task(uint8_t i, uint16_t &time_available);
+
+	// the two task ordering policies
+	bool run_table_order(uint16_t &time_available);
+	bool run_deadline(uint16_t &time_available);
+
 	// number of microseconds allowed for the current task
 	uint16_t _task_time_allowed;
 
@@ -88,6 +269,18 @@ private:
 
     // number of ticks that _spare_micros is counted over
     uint8_t _spare_ticks;
+
+	// progmem list of microsecond scheduled tasks
+	const struct FastTask *_fast_tasks;
+
+	// number of tasks in _fast_tasks list
+	uint8_t _num_fast_tasks;
+
+	// time in microseconds each fast task is next due
+	uint32_t *_fast_next_run;
+
+	// number of fast task runs that took longer than max_time_micros
+	uint16_t _fast_overruns;
 };
 
 #endif // AP_SCHEDULER_H
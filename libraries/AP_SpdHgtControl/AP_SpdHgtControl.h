@@ -39,7 +39,8 @@ public:
 	// Should be called at 50Hz or faster
 	virtual void update_50hz(float height_above_field) = 0;
 
-	// Update of the pitch and throttle demands
+	// Update of the speed and height demands. The pitch and throttle
+	// demands may be updated here or by update_50hz()
 	// Should be called at 10Hz or faster
 	virtual void update_pitch_throttle( int32_t hgt_dem_cm,
 										int32_t EAS_dem_cm,
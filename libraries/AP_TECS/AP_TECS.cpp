@@ -183,6 +183,11 @@ void AP_TECS::update_50hz(float hgt_afe)
        _vel_dot = 0.0f;
     }
 
+	// run the throttle and pitch loops at this rate, once the
+	// planner in update_pitch_throttle() is running
+	if (now - _update_pitch_throttle_last_usec < 1000000UL) {
+		_update_control();
+	}
 }
 
 void AP_TECS::_update_speed(void)
@@ -192,12 +197,7 @@ void AP_TECS::_update_speed(void)
 	float DT = max((now - _update_speed_last_usec),0)*1.0e-6f;
 	_update_speed_last_usec = now;	
 
-    // Convert equivalent airspeeds to true airspeeds
-
     float EAS2TAS = _ahrs->get_EAS2TAS();
-    _TAS_dem  = _EAS_dem * EAS2TAS;
-    _TASmax   = aparm.airspeed_max * EAS2TAS;
-    _TASmin   = aparm.airspeed_min * EAS2TAS;
 
     // Reset states of time since last update is too large
     if (DT > 1.0) {
@@ -319,7 +319,7 @@ void AP_TECS::_detect_underspeed(void)
     }
 }
 
-void AP_TECS::_update_energies(void) 
+void AP_TECS::_update_energy_demands(void) 
 {
     // Calculate specific energy demands
     _SPE_dem = _hgt_dem_adj * GRAVITY_MSS;
@@ -328,7 +328,10 @@ void AP_TECS::_update_energies(void)
     // Calculate specific energy rate demands
     _SPEdot_dem = _hgt_rate_dem * GRAVITY_MSS;
     _SKEdot_dem = _integ5_state * _TAS_rate_dem;
+}
 
+void AP_TECS::_update_energies(void) 
+{
     // Calculate specific energy
     _SPE_est = _integ3_state * GRAVITY_MSS;
     _SKE_est = 0.5f * _integ5_state * _integ5_state;
@@ -347,7 +350,9 @@ void AP_TECS::_update_throttle(void)
 
 	// Apply 0.5 second first order filter to STEdot_error
 	// This is required to remove accelerometer noise from the  measurement
-	STEdot_error = 0.2f*STEdot_error + 0.8f*_STEdotErrLast;
+	// The coefficient is 0.2 at 10Hz
+	float alpha = _DT / (_DT + 0.4f);
+	STEdot_error = alpha*STEdot_error + (1.0f - alpha)*_STEdotErrLast;
 	_STEdotErrLast = STEdot_error;
 
     // Calculate throttle demand
@@ -358,12 +363,8 @@ void AP_TECS::_update_throttle(void)
     }
     else
     {
-		// Calculate gain scaler from specific energy error to throttle
-		float K_STE2Thr = 1 / (_timeConst * (_STEdot_max - _STEdot_min));
-
         // Calculate feed-forward throttle
         float ff_throttle = 0;
-		float nomThr = aparm.throttle_cruise * 0.01f;
 		const Matrix3f &rotMat = _ahrs->get_dcm_matrix();
 		// Use the demanded rate of change of total energy as the feed-forward demand, but add
 		// additional component which scales with (1/cos(bank angle) - 1) to compensate for induced
@@ -372,20 +373,20 @@ void AP_TECS::_update_throttle(void)
 		STEdot_dem = STEdot_dem + _rollComp * (1.0f/constrain_float(cosPhi * cosPhi , 0.1f, 1.0f) - 1.0f);
 		if (STEdot_dem >= 0)
 		{
-			ff_throttle = nomThr + STEdot_dem / _STEdot_max * (1.0f - nomThr);
+			ff_throttle = _nomThr + STEdot_dem / _STEdot_max * (1.0f - _nomThr);
 		}
 		else
 		{
-			ff_throttle = nomThr - STEdot_dem / _STEdot_min * nomThr;
+			ff_throttle = _nomThr - STEdot_dem / _STEdot_min * _nomThr;
 		}
 
 		// Calculate PD + FF throttle
-		_throttle_dem = (_STE_error + STEdot_error * _thrDamp) * K_STE2Thr + ff_throttle;
+		_throttle_dem = (_STE_error + STEdot_error * _thrDamp) * _K_STE2Thr + ff_throttle;
 
 		// Rate limit PD + FF throttle
 	    // Calculate the throttle increment from the specified slew time
 		if (aparm.throttle_slewrate != 0) {
-			float thrRateIncr = _DT * (_THRmaxf - _THRminf) * aparm.throttle_slewrate * 0.01f;
+			float thrRateIncr = _DT * _thrSlewRate;
 
 			_throttle_dem = constrain_float(_throttle_dem, 
 											_last_throttle_dem - thrRateIncr, 
@@ -401,7 +402,7 @@ void AP_TECS::_update_throttle(void)
 
   		// Calculate integrator state, constraining state
 		// Set integrator to a max throttle value dduring climbout
-        _integ6_state = _integ6_state + (_STE_error * _integGain) * _DT * K_STE2Thr;
+        _integ6_state = _integ6_state + (_STE_error * _integGain) * _DT * _K_STE2Thr;
 		if (_climbOutDem)
 		{
 			_integ6_state = integ_max;
@@ -534,10 +535,10 @@ void AP_TECS::_update_pitch(void)
 	_last_pitch_dem = _pitch_dem;
 }
 
-void AP_TECS::_initialise_states(int32_t ptchMinCO_cd, float hgt_afe) 
+void AP_TECS::_initialise_states(int32_t ptchMinCO_cd, float hgt_afe, float DT) 
 {
 	// Initialise states and variables if DT > 1 second or in climbout
-	if (_DT > 1.0)
+	if (DT > 1.0)
 	{
 		_integ6_state      = 0.0f;
 		_integ7_state      = 0.0f;
@@ -551,8 +552,6 @@ void AP_TECS::_initialise_states(int32_t ptchMinCO_cd, float hgt_afe)
         _TAS_dem_adj       = _TAS_dem;
 		_underspeed        = false;
 		_badDescent        = false;
-		_DT                = 0.1f; // when first starting TECS, use a
-								   // small time constant
 	}
 	else if (_climbOutDem)
 	{
@@ -576,6 +575,49 @@ void AP_TECS::_update_STE_rate_lim(void)
     _STEdot_min = - _minSinkRate * GRAVITY_MSS;
 }
 
+void AP_TECS::_update_gains(void) 
+{
+	// Calculate gain scaler from specific energy error to throttle
+	_K_STE2Thr = 1 / (_timeConst * (_STEdot_max - _STEdot_min));
+
+	// Nominal throttle, for the feed-forward
+	_nomThr = aparm.throttle_cruise * 0.01f;
+}
+
+void AP_TECS::_update_control(void)
+{
+    // Calculate time in seconds since last update
+    uint32_t now = hal.scheduler->micros();
+	_DT = max((now - _update_control_last_usec),0)*1.0e-6f;
+	_update_control_last_usec = now;
+	if (_DT > 1.0f) {
+		_DT = 0.02f; // the planner has just (re)started, so the states
+					 // are initialised. Use a small time step
+	}
+
+    // Update the speed estimate using a 2nd order complementary filter
+    _update_speed();
+
+    // Detect underspeed condition
+    _detect_underspeed();
+
+    // Calculate specific energy quantitiues
+    _update_energies();
+
+    // Calculate throttle demand - use simple pitch to throttle if no airspeed sensor
+	if (_ahrs->airspeed_sensor_enabled()) {
+        _update_throttle();
+	} else {
+        _update_throttle_option(_throttle_nudge);
+	}
+
+    // Detect bad descent due to demanded airspeed being too high
+	_detect_bad_descent();
+
+	// Calculate pitch demand
+	_update_pitch();
+}
+
 void AP_TECS::update_pitch_throttle(int32_t hgt_dem_cm,
 									int32_t EAS_dem_cm, 
 									bool climbOutDem, 
@@ -585,12 +627,9 @@ void AP_TECS::update_pitch_throttle(int32_t hgt_dem_cm,
 {
     // Calculate time in seconds since last update
     uint32_t now = hal.scheduler->micros();
-	_DT = max((now - _update_pitch_throttle_last_usec),0)*1.0e-6f;
+	float DT = max((now - _update_pitch_throttle_last_usec),0)*1.0e-6f;
 	_update_pitch_throttle_last_usec = now;	
 
-    // Update the speed estimate using a 2nd order complementary filter
-    _update_speed();
-
 	// Convert inputs
     _hgt_dem = hgt_dem_cm * 0.01f;
 	_EAS_dem = EAS_dem_cm * 0.01f;
@@ -599,12 +638,24 @@ void AP_TECS::update_pitch_throttle(int32_t hgt_dem_cm,
 	_PITCHmaxf = 0.000174533f * aparm.pitch_limit_max_cd;
 	_PITCHminf = 0.000174533f * aparm.pitch_limit_min_cd;
 	_climbOutDem = climbOutDem;
+	_throttle_nudge = throttle_nudge;
 
-	// initialise selected states and variables if DT > 1 second or in climbout
-	_initialise_states(ptchMinCO_cd, hgt_afe);
+    // Convert equivalent airspeeds to true airspeeds
+    float EAS2TAS = _ahrs->get_EAS2TAS();
+    _TAS_dem  = _EAS_dem * EAS2TAS;
+    _TASmax   = aparm.airspeed_max * EAS2TAS;
+    _TASmin   = aparm.airspeed_min * EAS2TAS;
 
-    // Calculate Specific Total Energy Rate Limits
-	_update_STE_rate_lim();
+	// initialise selected states and variables if DT > 1 second or in climbout
+	_initialise_states(ptchMinCO_cd, hgt_afe, DT);
+
+    // Calculate Specific Total Energy Rate Limits and the gains from
+    // them, when the parameters they come from have changed
+	if (_gain_params != AP_Param::change_count()) {
+		_gain_params = AP_Param::change_count();
+		_update_STE_rate_lim();
+		_update_gains();
+	}
 
     // Calculate the speed demand
     _update_speed_demand();
@@ -612,24 +663,12 @@ void AP_TECS::update_pitch_throttle(int32_t hgt_dem_cm,
 	// Calculate the height demand
 	_update_height_demand();
 
-    // Detect underspeed condition
-    _detect_underspeed();
-
-    // Calculate specific energy quantitiues
-    _update_energies();
-
-    // Calculate throttle demand - use simple pitch to throttle if no airspeed sensor
-	if (_ahrs->airspeed_sensor_enabled()) {
-        _update_throttle();
-	} else {
-        _update_throttle_option(throttle_nudge);
-	}
-
-    // Detect bad descent due to demanded airspeed being too high
-	_detect_bad_descent();
+    // Calculate specific energy demands
+    _update_energy_demands();
 
-	// Calculate pitch demand
-	_update_pitch();
+	// Throttle change per second allowed by the slew rate. The
+	// throttle range can be narrowed by _initialise_states()
+	_thrSlewRate = (_THRmaxf - _THRminf) * aparm.throttle_slewrate * 0.01f;
 
     // Write internal variables to the log_tuning structure. This
     // structure will be logged in dataflash at 10Hz
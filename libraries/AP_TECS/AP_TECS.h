@@ -32,18 +32,23 @@ class AP_TECS : public AP_SpdHgtControl {
 public:
 	AP_TECS(AP_AHRS *ahrs, const AP_SpdHgtControl::AircraftParameters &parms) :
 		_ahrs(ahrs),
-		aparm(parms)
+		aparm(parms),
+		_gain_params(AP_Param::change_count() - 1)   // so the first update works them out
 		{
 			AP_Param::setup_object_defaults(this, var_info);
 		}
 
 	// Update of the estimated height and height rate internal state
 	// Update of the inertial speed rate internal state
-	// Should be called at 50Hz or greater
+	// Once update_pitch_throttle() is being called this also runs the
+	// speed, throttle and pitch tracking loops
+	// Should be called at 50Hz or greater, at the control rate
 	// hgt_afe is the height above field elevation (takeoff height)
 	void update_50hz(float hgt_afe);
 
-	// Update the control loop calculations
+	// Update the speed and height demands, the energy demands the
+	// tracking loops follow, and the gains they use. Called at the
+	// navigation rate, 10Hz
     void update_pitch_throttle(int32_t hgt_dem_cm, 
                                int32_t EAS_dem_cm, 
                                bool climbOutDem, 
@@ -94,6 +99,9 @@ private:
     // Last time update_pitch_throttle was called
     uint32_t _update_pitch_throttle_last_usec;
 
+    // Last time the tracking loops ran
+    uint32_t _update_control_last_usec;
+
 	// pointer to the AHRS object
     AP_AHRS *_ahrs;
 
@@ -222,9 +230,21 @@ private:
 	// Specific energy error quantities
 	float _STE_error;
 
-	// Time since last update of main TECS loop (seconds)
+	// Time since last update of the tracking loops (seconds)
 	float _DT;
 
+	// throttle nudge from the last update_pitch_throttle()
+	int16_t _throttle_nudge;
+
+	// gains for the tracking loops, worked out by the planner
+	float _K_STE2Thr;       // specific energy error to throttle
+	float _nomThr;          // nominal throttle for the feed-forward
+	float _thrSlewRate;     // largest throttle change per second
+
+	// AP_Param::change_count() when the rate limits and gains were
+	// last worked out
+	uint16_t _gain_params;
+
     // Update the airspeed internal state using a second order complementary filter
     void _update_speed(void);
 
@@ -237,6 +257,9 @@ private:
 	// Detect an underspeed condition
 	void _detect_underspeed(void);
 
+	// Update Specific Energy Demands
+	void _update_energy_demands(void);
+
 	// Update Specific Energy Quantities
 	void _update_energies(void);
 
@@ -252,12 +275,18 @@ private:
 	// Update Demanded Pitch Angle
 	void _update_pitch(void);
 
-	// Initialise states and variables
-	void _initialise_states(int32_t ptchMinCO_cd, float hgt_afe);
+	// Initialise states and variables, DT is the time since the last planner update
+	void _initialise_states(int32_t ptchMinCO_cd, float hgt_afe, float DT);
 
 	// Calculate specific total energy rate limits
 	void _update_STE_rate_lim(void);
 
+	// Calculate the tracking loop gains that only depend on parameters
+	void _update_gains(void);
+
+	// Run the speed, throttle and pitch tracking loops
+	void _update_control(void);
+
     // declares a 5point average filter using floats
 	AverageFilterFloat_Size5 _vdot_filter;
 };
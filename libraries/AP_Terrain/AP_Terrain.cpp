@@ -0,0 +1,389 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_Terrain.cpp
+/// @brief	Terrain heights from a grid of elevation tiles, sent by the
+///         GCS and kept on the SD card.
+
+#include <AP_HAL.h>
+#include <GCS_MAVLink.h>
+#include "AP_Terrain.h"
+
+#if AP_TERRAIN_AVAILABLE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+extern const AP_HAL::HAL& hal;
+
+// the magic number of a tile in the file, which holds the version of
+// the layout in its low byte
+#define TERRAIN_BLOCK_MAGIC     0x5401
+
+// bitmask of the half tiles of a whole tile
+#define TERRAIN_HALF_ROWS_ALL   ((1U << (TERRAIN_TILE_POINTS / TERRAIN_TILE_HALF_ROWS)) - 1)
+
+const AP_Param::GroupInfo AP_Terrain::var_info[] PROGMEM = {
+    // @Param: ENABLE
+    // @DisplayName: Terrain data enable
+    // @Description: Enable the terrain database, which asks the GCS for terrain heights around the vehicle and along its mission and keeps them on the SD card
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("ENABLE",  0, AP_Terrain, _enabled, 0),
+
+    // @Param: SPACING
+    // @DisplayName: Terrain grid spacing
+    // @Description: Distance between the terrain grid points. Changing it throws away the terrain already held
+    // @Units: meters
+    // @Range: 30 1000
+    // @Increment: 1
+    // @User: Advanced
+    AP_GROUPINFO("SPACING", 1, AP_Terrain, _spacing, TERRAIN_SPACING_DEFAULT),
+
+    // @Param: FOLLOW
+    // @DisplayName: Terrain following
+    // @Description: Hold mission altitudes above the terrain rather than above home, where the terrain is known. The altitudes become heights above the ground as it is at home
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("FOLLOW",  2, AP_Terrain, _follow, 0),
+
+    AP_GROUPEND
+};
+
+AP_Terrain *AP_Terrain::_instance;
+
+AP_Terrain::AP_Terrain(const char *filename) :
+    _filename(filename),
+    _fd(-1),
+    _file_failed(false),
+    _grid_spacing(0),
+    _grid_step(0),
+    _access_count(0),
+    _request_tile(-1)
+{
+    AP_Param::setup_object_defaults(this, var_info);
+    memset(_cache, 0, sizeof(_cache));
+}
+
+void AP_Terrain::init()
+{
+    _instance = this;
+    hal.scheduler->register_io_process(_io_timer);
+}
+
+/*
+  a change of spacing makes all the tiles in memory wrong. Tiles the IO
+  process is working on are left to it, and their spacing won't match
+  when they are next looked up
+ */
+void AP_Terrain::update_spacing()
+{
+    if (_spacing == _grid_spacing) {
+        return;
+    }
+    uint16_t spacing = constrain_int16(_spacing, 30, 1000);
+    _grid_spacing = _spacing;
+    // one grid step north to south, in degrees * 1e7
+    _grid_step = spacing * 100 / LATLON_TO_CM;
+    for (uint8_t i=0; i<TERRAIN_CACHE_SIZE; i++) {
+        if (_cache[i].state == TILE_VALID) {
+            _cache[i].state = TILE_FREE;
+        }
+    }
+    _request_tile = -1;
+}
+
+bool AP_Terrain::tile_index(int32_t lat, int32_t lng, uint32_t &index_lat, uint32_t &index_lng, float &frac_lat, float &frac_lng) const
+{
+    if (_grid_step <= 0 || lat < -900000000L || lat > 900000000L) {
+        return false;
+    }
+    uint32_t width = (uint32_t)_grid_step * (TERRAIN_TILE_POINTS-1);
+    // both fit in a uint32_t, and the longitude wraps correctly
+    uint32_t ulat = (uint32_t)(lat + 900000000L);
+    uint32_t ulng = (uint32_t)lng + 1800000000UL;
+    index_lat = ulat / width;
+    index_lng = ulng / width;
+    frac_lat = (ulat - index_lat * width) / (float)_grid_step;
+    frac_lng = (ulng - index_lng * width) / (float)_grid_step;
+    return true;
+}
+
+/*
+  look for a tile in memory. If it isn't there and allocate is set,
+  the least recently used tile that isn't busy gives up its place and
+  the IO process is asked to look for it in the file
+ */
+struct AP_Terrain::tile *AP_Terrain::find_tile(uint32_t index_lat, uint32_t index_lng, bool allocate)
+{
+    int8_t oldest = -1;
+    for (uint8_t i=0; i<TERRAIN_CACHE_SIZE; i++) {
+        struct tile &t = _cache[i];
+        uint8_t state = t.state;
+        if (state != TILE_FREE && t.index_lat == index_lat && t.index_lng == index_lng) {
+            t.last_access = ++_access_count;
+            return &t;
+        }
+        if (state == TILE_FREE || state == TILE_VALID) {
+            if (oldest == -1 || (_cache[oldest].state != TILE_FREE &&
+                (state == TILE_FREE || t.last_access < _cache[oldest].last_access))) {
+                oldest = i;
+            }
+        }
+    }
+    if (!allocate || oldest == -1) {
+        return NULL;
+    }
+
+    struct tile &t = _cache[oldest];
+    if (_request_tile == oldest) {
+        _request_tile = -1;
+    }
+    uint32_t width = (uint32_t)_grid_step * (TERRAIN_TILE_POINTS-1);
+    t.index_lat = index_lat;
+    t.index_lng = index_lng;
+    t.last_access = ++_access_count;
+    t.last_request_ms = 0;
+    t.block.spacing = _grid_spacing;
+    t.block.lat = (int32_t)(index_lat * width - 900000000UL);
+    t.block.lng = (int32_t)(index_lng * width - 1800000000UL);
+    t.state = TILE_DISK_READ;
+    return &t;
+}
+
+bool AP_Terrain::height_amsl(const struct Position &loc, float &height)
+{
+    if (!_enabled) {
+        return false;
+    }
+    update_spacing();
+
+    uint32_t index_lat, index_lng;
+    float frac_lat, frac_lng;
+    if (!tile_index(loc.lat, loc.lng, index_lat, index_lng, frac_lat, frac_lng)) {
+        return false;
+    }
+    struct tile *t = find_tile(index_lat, index_lng, false);
+    if (t == NULL || t->state == TILE_DISK_READ) {
+        return false;
+    }
+
+    // the four points around the location, which must all be present
+    uint8_t x = frac_lat;
+    uint8_t y = frac_lng;
+    if (x > TERRAIN_TILE_POINTS-2) x = TERRAIN_TILE_POINTS-2;
+    if (y > TERRAIN_TILE_POINTS-2) y = TERRAIN_TILE_POINTS-2;
+    uint8_t need = (1U << (x / TERRAIN_TILE_HALF_ROWS)) | (1U << ((x+1) / TERRAIN_TILE_HALF_ROWS));
+    if ((t->block.half_rows & need) != need) {
+        return false;
+    }
+    float fx = frac_lat - x;
+    float fy = frac_lng - y;
+    const struct tile_block &b = t->block;
+    float south = b.height[x][y] + (b.height[x][y+1] - b.height[x][y]) * fy;
+    float north = b.height[x+1][y] + (b.height[x+1][y+1] - b.height[x+1][y]) * fy;
+    height = south + (north - south) * fx;
+    return true;
+}
+
+bool AP_Terrain::height_above_home(const struct Position &loc, const struct Position &home, float &height)
+{
+    float h_loc, h_home;
+    if (!height_amsl(loc, h_loc) || !height_amsl(home, h_home)) {
+        return false;
+    }
+    height = h_loc - h_home;
+    return true;
+}
+
+/*
+  ask for the tile under the vehicle, then the tiles at steps of half a
+  tile along the path to the next waypoint, and choose the first that
+  is incomplete for the next request. The tile at home is kept too, as
+  the heights are relative to it
+ */
+bool AP_Terrain::update(const struct Position &current_loc, const struct Position &next_wp)
+{
+    if (!_enabled) {
+        return false;
+    }
+    update_spacing();
+
+    uint32_t now = hal.scheduler->millis();
+    Vector2f path((next_wp.lat - current_loc.lat) * LATLON_TO_CM,
+                  (next_wp.lng - current_loc.lng) * LATLON_TO_CM);
+    float step_cm = _grid_spacing * 100.0f * (TERRAIN_TILE_POINTS-1) * 0.5f;
+    uint8_t steps = path.length() / step_cm;
+    if (steps > TERRAIN_PREFETCH_TILES*2) {
+        steps = TERRAIN_PREFETCH_TILES*2;
+    }
+
+    _request_tile = -1;
+    uint8_t asked = 0;
+    for (uint8_t i=0; i<=steps && asked <= TERRAIN_PREFETCH_TILES; i++) {
+        int32_t lat = current_loc.lat;
+        int32_t lng = current_loc.lng;
+        if (i > 0) {
+            float f = (i == steps) ? 1.0f : i * step_cm / path.length();
+            lat += (next_wp.lat - current_loc.lat) * f;
+            lng += (next_wp.lng - current_loc.lng) * f;
+        }
+        uint32_t index_lat, index_lng;
+        float frac_lat, frac_lng;
+        if (!tile_index(lat, lng, index_lat, index_lng, frac_lat, frac_lng)) {
+            continue;
+        }
+        struct tile *t = find_tile(index_lat, index_lng, true);
+        if (t == NULL) {
+            break;
+        }
+        asked++;
+        if (_request_tile == -1 && t->state == TILE_VALID &&
+            t->block.half_rows != TERRAIN_HALF_ROWS_ALL &&
+            now - t->last_request_ms >= TERRAIN_REQUEST_MS) {
+            _request_tile = t - _cache;
+        }
+    }
+    return _request_tile != -1;
+}
+
+void AP_Terrain::send_request(mavlink_channel_t chan)
+{
+    if (_request_tile == -1) {
+        return;
+    }
+    struct tile &t = _cache[_request_tile];
+    if (t.state != TILE_VALID) {
+        _request_tile = -1;
+        return;
+    }
+    uint8_t data[16];
+    memset(data, 0, sizeof(data));
+    memcpy(&data[0], &t.block.lat, 4);
+    memcpy(&data[4], &t.block.lng, 4);
+    memcpy(&data[8], &t.block.spacing, 2);
+    data[10] = TERRAIN_HALF_ROWS_ALL & ~t.block.half_rows;
+    mavlink_msg_data16_send(chan, MAVLINK_DATA_TYPE_TERRAIN_REQUEST, TERRAIN_REQUEST_LEN, data);
+    t.last_request_ms = hal.scheduler->millis();
+}
+
+void AP_Terrain::handle_data(const uint8_t *data, uint8_t len)
+{
+    if (!_enabled || len < TERRAIN_DATA_LEN) {
+        return;
+    }
+    int32_t lat, lng;
+    uint16_t spacing;
+    memcpy(&lat, &data[0], 4);
+    memcpy(&lng, &data[4], 4);
+    memcpy(&spacing, &data[8], 2);
+    uint8_t first_row = data[10];
+    if (spacing != _grid_spacing || first_row % TERRAIN_TILE_HALF_ROWS != 0 ||
+        first_row >= TERRAIN_TILE_POINTS) {
+        return;
+    }
+
+    // the corner is inside the tile, so this finds it whatever the rounding
+    uint32_t index_lat, index_lng;
+    float frac_lat, frac_lng;
+    if (!tile_index(lat + _grid_step/2, lng + _grid_step/2, index_lat, index_lng, frac_lat, frac_lng)) {
+        return;
+    }
+    struct tile *t = find_tile(index_lat, index_lng, false);
+    if (t == NULL || t->state != TILE_VALID) {
+        return;
+    }
+
+    const uint8_t *p = &data[TERRAIN_DATA_HEADER_LEN];
+    for (uint8_t x=first_row; x<first_row+TERRAIN_TILE_HALF_ROWS; x++) {
+        for (uint8_t y=0; y<TERRAIN_TILE_POINTS; y++) {
+            memcpy(&t->block.height[x][y], p, 2);
+            p += 2;
+        }
+    }
+    t->block.half_rows |= 1U << (first_row / TERRAIN_TILE_HALF_ROWS);
+    if (t->block.half_rows == TERRAIN_HALF_ROWS_ALL) {
+        t->block.magic = TERRAIN_BLOCK_MAGIC;
+        t->block.crc = block_crc(t->block);
+        t->state = TILE_DISK_WRITE;
+    }
+}
+
+uint16_t AP_Terrain::block_crc(const struct tile_block &block) const
+{
+    return crc_calculate((const uint8_t *)&block, sizeof(block) - sizeof(block.crc));
+}
+
+void AP_Terrain::_io_timer(uint32_t now)
+{
+    if (_instance != NULL) {
+        _instance->io_timer();
+    }
+}
+
+bool AP_Terrain::open_file()
+{
+    if (_fd != -1) {
+        return true;
+    }
+    if (_file_failed) {
+        return false;
+    }
+    _fd = ::open(_filename, O_RDWR|O_CREAT, 0644);
+    if (_fd == -1) {
+        _file_failed = true;
+        hal.console->printf_P(PSTR("Terrain: failed to open %s\n"), _filename);
+        return false;
+    }
+    return true;
+}
+
+/*
+  the tile file is direct mapped, each tile having one place in it by
+  its index, so neighbouring tiles never clash and a tile far away
+  just replaces the one in its place. A tile is checked when it is read
+  back, so anything else in its place is ignored
+ */
+void AP_Terrain::io_timer()
+{
+    // one read or write each time, so the IO process isn't held up
+    for (uint8_t i=0; i<TERRAIN_CACHE_SIZE; i++) {
+        struct tile &t = _cache[i];
+        uint8_t state = t.state;
+        if (state != TILE_DISK_READ && state != TILE_DISK_WRITE) {
+            continue;
+        }
+        uint32_t slot = (t.index_lat % TERRAIN_FILE_SLOTS) * TERRAIN_FILE_SLOTS + (t.index_lng % TERRAIN_FILE_SLOTS);
+        off_t ofs = slot * sizeof(struct tile_block);
+        bool file_ok = open_file() && ::lseek(_fd, ofs, SEEK_SET) == ofs;
+
+        if (state == TILE_DISK_READ) {
+            struct tile_block block;
+            if (file_ok &&
+                ::read(_fd, &block, sizeof(block)) == (ssize_t)sizeof(block) &&
+                block.magic == TERRAIN_BLOCK_MAGIC &&
+                block.spacing == t.block.spacing &&
+                block.lat == t.block.lat &&
+                block.lng == t.block.lng &&
+                block.crc == block_crc(block)) {
+                t.block = block;
+            } else {
+                // not there, so it comes from the GCS
+                t.block.half_rows = 0;
+            }
+            t.state = TILE_VALID;
+        } else {
+            if (file_ok) {
+                ::write(_fd, &t.block, sizeof(t.block));
+#if CONFIG_HAL_BOARD == HAL_BOARD_PX4
+                ::fsync(_fd);
+#endif
+            }
+            t.state = TILE_VALID;
+        }
+        return;
+    }
+}
+
+#endif // AP_TERRAIN_AVAILABLE
@@ -0,0 +1,163 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AP_Terrain.h
+/// @brief	Terrain heights from a grid of elevation tiles, sent by the
+///         GCS and kept on the SD card.
+
+#ifndef __AP_TERRAIN_H__
+#define __AP_TERRAIN_H__
+
+#include <AP_Common.h>
+#include <AP_HAL.h>
+#include <AP_Param.h>
+#include <AP_Math.h>
+#include <GCS_MAVLink.h>
+
+// the tiles need a file system, and more memory than the APM1/APM2 can spare
+#ifndef AP_TERRAIN_AVAILABLE
+ #if CONFIG_HAL_BOARD == HAL_BOARD_PX4 || CONFIG_HAL_BOARD == HAL_BOARD_AVR_SITL
+  #define AP_TERRAIN_AVAILABLE 1
+ #else
+  #define AP_TERRAIN_AVAILABLE 0
+ #endif
+#endif
+
+#if AP_TERRAIN_AVAILABLE
+
+#define TERRAIN_TILE_POINTS     8       // points along each side of a tile
+#define TERRAIN_TILE_HALF_ROWS  4       // rows of points sent in each DATA96 message
+#define TERRAIN_CACHE_SIZE      12      // tiles held in memory
+#define TERRAIN_PREFETCH_TILES  6       // most tiles along the path to the next waypoint asked for on each update
+#define TERRAIN_REQUEST_MS      500     // least time between requests to the GCS for the same tile
+#define TERRAIN_FILE_SLOTS      64      // the tile file holds a square of this many tiles each way, wrapping around
+#define TERRAIN_SPACING_DEFAULT 100     // metres between grid points
+
+// the first bytes of the data field of the DATA16 and DATA96 messages
+// that carry terrain, after the type and len fields
+//   request (DATA16, to the GCS):  int32 lat, int32 lng, uint16 spacing, uint8 half row mask
+//   data (DATA96, from the GCS):   int32 lat, int32 lng, uint16 spacing, uint8 first row,
+//                                  then TERRAIN_TILE_HALF_ROWS rows of int16 heights in metres
+#define TERRAIN_REQUEST_LEN     11
+#define TERRAIN_DATA_HEADER_LEN 11
+#define TERRAIN_DATA_LEN        (TERRAIN_DATA_HEADER_LEN + TERRAIN_TILE_HALF_ROWS*TERRAIN_TILE_POINTS*2)
+
+/*
+  The world is divided into square tiles of TERRAIN_TILE_POINTS by
+  TERRAIN_TILE_POINTS heights on a grid of equal steps of latitude and
+  longitude, TERRAIN_SPACING metres apart north to south. Neighbouring
+  tiles share their edge points, so a location is always surrounded by
+  four points of one tile and its height is interpolated within it.
+
+  The tiles near the vehicle and along its path are kept in memory,
+  the least recently used making way for new ones. A tile not in
+  memory is looked for in the tile file by the IO process, and if it
+  isn't there it is asked for from the GCS, half a tile at a time.
+  Complete tiles are written back to the file, also by the IO process,
+  so the main loop never waits for the card.
+ */
+class AP_Terrain
+{
+public:
+    /// @param  filename    the tile file, under a directory that exists
+    AP_Terrain(const char *filename);
+
+    /// Start the IO process
+    void        init();
+
+    /// Ask for the tiles at the current location and along the path to
+    /// the next waypoint. Call at a few Hz
+    ///
+    /// @returns    true if the GCS should be sent a request
+    ///
+    bool        update(const struct Position &current_loc, const struct Position &next_wp);
+
+    /// Height above mean sea level of a location, in metres
+    ///
+    /// @returns    false if it isn't known
+    ///
+    bool        height_amsl(const struct Position &loc, float &height);
+
+    /// Height of the terrain at loc above the terrain at home, in metres
+    ///
+    /// @returns    false if either isn't known
+    ///
+    bool        height_above_home(const struct Position &loc, const struct Position &home, float &height);
+
+    /// true if mission altitudes should follow the terrain
+    bool        follow_enabled() const { return _enabled && _follow; }
+
+    /// Send the request for missing terrain, if any, as a DATA16
+    /// message. The caller must have checked there is room for it
+    void        send_request(mavlink_channel_t chan);
+
+    /// Take in the data field of a DATA96 message of terrain
+    void        handle_data(const uint8_t *data, uint8_t len);
+
+    static const struct AP_Param::GroupInfo var_info[];
+
+private:
+    enum tile_state {
+        TILE_FREE = 0,
+        TILE_DISK_READ,                     ///< the IO process is to look for it in the file
+        TILE_VALID,                         ///< in memory, whole or in part
+        TILE_DISK_WRITE,                    ///< whole, and the IO process is to write it to the file
+    };
+
+    // a tile as it is stored in the file
+    struct PACKED tile_block {
+        uint16_t    magic;
+        uint16_t    spacing;
+        int32_t     lat;                    ///< south west corner
+        int32_t     lng;
+        uint8_t     half_rows;              ///< bitmask of the half tiles present
+        int16_t     height[TERRAIN_TILE_POINTS][TERRAIN_TILE_POINTS];   ///< [north][east] in metres
+        uint16_t    crc;
+    };
+
+    struct tile {
+        volatile uint8_t state;
+        uint32_t    last_access;
+        uint32_t    index_lat;              ///< tile index north from the south pole
+        uint32_t    index_lng;              ///< tile index east from 180 west
+        uint32_t    last_request_ms;
+        struct tile_block block;
+    };
+
+    /// the tile holding a location, and where in it the location is in grid steps
+    bool        tile_index(int32_t lat, int32_t lng, uint32_t &index_lat, uint32_t &index_lng, float &frac_lat, float &frac_lng) const;
+
+    /// the tile at an index, allocating and loading it if asked
+    struct tile *find_tile(uint32_t index_lat, uint32_t index_lng, bool allocate);
+
+    /// recalculate the grid steps if the spacing has changed
+    void        update_spacing();
+
+    uint16_t    block_crc(const struct tile_block &block) const;
+
+    static void _io_timer(uint32_t now);
+    void        io_timer();
+    bool        open_file();
+
+    AP_Int8     _enabled;
+    AP_Int16    _spacing;
+    AP_Int8     _follow;
+
+    const char *_filename;
+    int         _fd;
+    bool        _file_failed;
+
+    // grid step in degrees * 1e7 for the current spacing
+    uint16_t    _grid_spacing;
+    int32_t     _grid_step;
+
+    struct tile _cache[TERRAIN_CACHE_SIZE];
+    uint32_t    _access_count;
+
+    // the tile the next request is for
+    int8_t      _request_tile;
+
+    static AP_Terrain *_instance;
+};
+
+#endif // AP_TERRAIN_AVAILABLE
+#endif // __AP_TERRAIN_H__
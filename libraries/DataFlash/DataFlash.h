@@ -11,11 +11,37 @@
 #include <AP_GPS.h>
 #include <AP_InertialSensor.h>
 #include <AP_AHRS.h>
+#include <AP_Scheduler.h>
 #include <stdint.h>
 
+/*
+  With timestamps, every record other than FMT has the microseconds
+  since the previous record in its header, filled in by WriteBlock().
+  A TIME record with the absolute time comes first in each log, and
+  whenever the gap is too long for the delta. A reader tells which
+  types have the field by the length in their FMT being 2 bytes more
+  than their format accounts for
+ */
+#ifndef DATAFLASH_TIMESTAMPS
+ # define DATAFLASH_TIMESTAMPS 1
+#endif
+
 class DataFlash_Class
 {
 public:
+    DataFlash_Class() :
+        _rate_limits(NULL),
+        _num_rate_limits(0),
+#if DATAFLASH_TIMESTAMPS
+        _last_record_us(0),
+        _have_record_time(false),
+#endif
+#if AP_INERTIAL_SENSOR_RAW_LOG
+        _imu_raw_scale_logged(false),
+#endif
+        _print_time_us(0)
+    {}
+
     // initialisation
     virtual void Init(void) = 0;
     virtual bool CardInserted(void) = 0;
@@ -24,9 +50,56 @@ public:
     virtual bool NeedErase(void) = 0;
     virtual void EraseAll() = 0;
 
+    /*
+      background erase. EraseStart() begins an erase which each call
+      to EraseUpdate() advances, so the caller isn't held up for the
+      whole of it. EraseProgress() is the percentage done, and 100
+      when no erase is running. Logs may be started while the erase
+      runs. Backends which erase quickly just erase in EraseStart()
+     */
+    virtual void EraseStart() { EraseAll(); }
+    virtual void EraseUpdate() {}
+    virtual uint8_t EraseProgress() { return 100; }
+
     /* Write a block of data at current offset */
     virtual void WriteBlock(const void *pBuffer, uint16_t size) = 0;
 
+    /*
+      reserve size bytes of contiguous log space so a record can be
+      filled in place, avoiding the copy made by WriteBlock(). Returns
+      NULL if the backend can't do that right now (the record would
+      straddle a page or the end of the buffer, or there is no RAM
+      buffer), in which case the caller should fall back to
+      WriteBlock(). A successful reservation must be followed by
+      CommitBlock() with the same size before any other write
+     */
+    virtual void *ReserveBlock(uint16_t size) { return NULL; }
+    virtual void CommitBlock(uint16_t size) {}
+
+    /*
+      start and finish a record of the given size filled in place.
+      BeginRecord() returns the reserved space, or buf when there is
+      none, or NULL if the type is being rate limited and the record
+      should be skipped. EndRecord() is given what BeginRecord()
+      returned, and commits the space or writes buf. Used by the
+      writers of LogMessage.h
+     */
+    void *BeginRecord(uint8_t msg_type, void *buf, uint16_t size);
+    void EndRecord(void *pkt, const void *buf, uint16_t size);
+
+    // how full the backend write buffer is, 0 to 100. Used to decide
+    // when to decimate low priority messages
+    virtual uint8_t buffer_used_percent(void) const { return 0; }
+
+    // enable or disable compression of log records, returning false
+    // if the backend doesn't support it or is out of memory
+    virtual bool set_compression(bool enable) { return false; }
+
+    // keep at most max_logs logs taking at most max_mb megabytes, by
+    // deleting the oldest ahead of each new log, on backends that can.
+    // 0 for no limit
+    virtual void set_retention(uint16_t max_logs, uint16_t max_mb) {}
+
     // high level interface
     virtual uint16_t find_last_log(void) = 0;
     virtual void get_log_boundaries(uint16_t log_num, uint16_t & start_page, uint16_t & end_page) = 0;
@@ -41,13 +114,31 @@ public:
     virtual void ShowDeviceInfo(AP_HAL::BetterStream *port) = 0;
     virtual void ListAvailableLogs(AP_HAL::BetterStream *port) = 0;
 
+    /*
+      raw log data, for transfer to a GCS. get_log_info() gives the
+      size of a log in bytes and its time, or 0 if unknown.
+      get_log_data() copies up to len bytes from offset ofs in the
+      log, where page is the start page from get_log_boundaries(). It
+      returns the number of bytes copied, 0 at the end of the log, or
+      -1 if the data isn't ready yet and should be asked for again
+     */
+    virtual void get_log_info(uint16_t log_num, uint32_t &size, uint32_t &time_utc) = 0;
+    virtual int16_t get_log_data(uint16_t log_num, uint16_t page, uint32_t ofs, uint16_t len, uint8_t *data) = 0;
+
     /* logging methods common to all vehicles */
     uint16_t StartNewLog(uint8_t num_types,
                          const struct LogStructure *structure);
     void Log_Write_Format(const struct LogStructure *structure);
     void Log_Write_Parameter(const char *name, float value);
     void Log_Write_GPS(const GPS *gps, int32_t relative_alt);
-    void Log_Write_IMU(const AP_InertialSensor *ins);
+    void Log_Write_IMU(AP_InertialSensor *ins);
+#if AP_INERTIAL_SENSOR_RAW_LOG
+    void Log_Write_IMU_Raw(AP_InertialSensor_RawLog &raw);
+#endif
+#if AP_INERTIAL_SENSOR_BATCH
+    void Log_Write_Vibe(const AP_InertialSensor_Batch::result &vibe);
+#endif
+    void Log_Write_Loop(const AP_Scheduler &scheduler);
     void Log_Write_Message(const char *message);
     void Log_Write_Message_P(const prog_char_t *message);
 
@@ -67,6 +158,13 @@ protected:
                           const struct LogStructure *structure,
                           void (*print_mode)(AP_HAL::BetterStream *port, uint8_t mode),
                           AP_HAL::BetterStream *port);
+    void _print_log_packet(const struct LogStructure *s,
+                           const uint8_t *pkt, uint8_t msg_len,
+                           void (*print_mode)(AP_HAL::BetterStream *port, uint8_t mode),
+                           AP_HAL::BetterStream *port);
+    static const struct LogStructure *_find_structure(uint8_t msg_type,
+                                                      uint8_t num_types,
+                                                      const struct LogStructure *structure);
     
     void Log_Write_Parameter(const AP_Param *ap, const AP_Param::ParamToken &token, 
                              enum ap_var_type type);
@@ -78,20 +176,84 @@ protected:
     */
     virtual void ReadBlock(void *pkt, uint16_t size) = 0;
 
+    /*
+      per message type rate limiting, set up from the rate_hz and
+      priority fields of the structure table in StartNewLog(). Only
+      types that are limited or not of normal priority get an entry
+     */
+    struct LogRateLimit {
+        uint8_t msg_type;
+        uint8_t priority;
+        uint16_t interval_ms;
+        uint16_t next_ms;
+    };
+    struct LogRateLimit *_rate_limits;
+    uint8_t _num_rate_limits;
+
+    void _setup_rate_limits(uint8_t num_types, const struct LogStructure *structures);
+
+    // backends call this before writing a record, and discard it if
+    // it returns false
+    bool _log_allowed(uint8_t msg_type);
+    uint8_t _log_priority(uint8_t msg_type) const;
+
+    // message type of a record, or 0 for data without a header
+    static uint8_t _msg_type(const void *pBuffer, uint16_t size);
+
+    // true if records of a type have a time_delta in their header
+    static bool _has_time(uint8_t msg_type);
+
+#if DATAFLASH_TIMESTAMPS
+    /*
+      header timestamps. Before accepting a record with a time_delta a
+      backend calls _time_needed(), and writes a TIME record first with
+      _write_time() if it returns true. _stamp() then gives the bytes
+      to write, with the time_delta filled in, and must only be called
+      for records that go into the log, as the next delta counts from
+      it
+     */
+    uint32_t _last_record_us;
+    bool _have_record_time;
+
+    bool _time_needed(void) const;
+    void _write_time(void);
+    uint16_t _time_delta(uint8_t msg_type, const void *pBuffer);
+    const void *_stamp(uint8_t msg_type, const void *pBuffer, uint16_t size, uint8_t *copy);
+#endif
+
+#if AP_INERTIAL_SENSOR_RAW_LOG
+    // the IMU raw sample scale has been logged in this log
+    bool _imu_raw_scale_logged;
+#endif
+
+    // the time of the record being printed by a log dump
+    uint32_t _print_time_us;
 };
 
 /*
   unfortunately these need to be macros because of a limitation of
   named member structure initialisation in g++
  */
-#define LOG_PACKET_HEADER	       uint8_t head1, head2, msgid;
-#define LOG_PACKET_HEADER_INIT(id) head1 : HEAD_BYTE1, head2 : HEAD_BYTE2, msgid : id
+#define LOG_PLAIN_HEADER	       uint8_t head1, head2, msgid;
+#define LOG_PLAIN_HEADER_INIT(id)  head1 : HEAD_BYTE1, head2 : HEAD_BYTE2, msgid : id
+#if DATAFLASH_TIMESTAMPS
+#define LOG_PACKET_HEADER	       LOG_PLAIN_HEADER uint16_t time_delta;
+#define LOG_PACKET_HEADER_INIT(id) LOG_PLAIN_HEADER_INIT(id), time_delta : 0
+#else
+#define LOG_PACKET_HEADER	       LOG_PLAIN_HEADER
+#define LOG_PACKET_HEADER_INIT(id) LOG_PLAIN_HEADER_INIT(id)
+#endif
+
+#include "LogMessage.h"
 
 // once the logging code is all converted we will remove these from
 // this header
 #define HEAD_BYTE1  0xA3    // Decimal 163
 #define HEAD_BYTE2  0x95    // Decimal 149
 
+// second header byte of a delta compressed record in DataFlash_Block
+#define HEAD_BYTE2_DELTA 0x96
+
 /*
 Format characters in the format string for binary log messages
   b   : int8_t
@@ -104,6 +266,7 @@ Format characters in the format string for binary log messages
   n   : char[4]
   N   : char[16]
   Z   : char[64]
+  a   : int16_t[32]
   c   : int16_t * 100
   C   : uint16_t * 100
   e   : int32_t * 100
@@ -112,6 +275,40 @@ Format characters in the format string for binary log messages
   M   : uint8_t flight mode
  */
 
+// values in an 'a' field
+#define LOG_ARRAY_VALUES 32
+
+// bytes taken by a field of a format character, 0 if it is unknown
+static inline uint8_t log_field_size(char type)
+{
+    switch (type) {
+    case 'b':
+    case 'B':
+    case 'M':
+        return 1;
+    case 'h':
+    case 'H':
+    case 'c':
+    case 'C':
+        return 2;
+    case 'i':
+    case 'I':
+    case 'f':
+    case 'e':
+    case 'E':
+    case 'L':
+    case 'n':
+        return 4;
+    case 'N':
+        return 16;
+    case 'Z':
+        return 64;
+    case 'a':
+        return LOG_ARRAY_VALUES * sizeof(int16_t);
+    }
+    return 0;
+}
+
 // structure used to define logging format
 struct LogStructure {
     uint8_t msg_type;
@@ -119,13 +316,29 @@ struct LogStructure {
     const char name[5];
     const char format[16];
     const char labels[64];
+    uint8_t rate_hz;     // maximum logging rate, 0 for no limit
+    uint8_t priority;    // LOG_PRIORITY_*
 };
 
+/*
+  priority classes for log messages. When the backend write buffer
+  is more than LOG_CONGESTED_PERCENT full, low priority messages are
+  cut to a quarter of their rate_hz, or dropped if they have no
+  rate_hz. Critical messages are needed to decode the log and are
+  never rate limited
+ */
+#define LOG_PRIORITY_NORMAL   0
+#define LOG_PRIORITY_LOW      1
+#define LOG_PRIORITY_CRITICAL 2
+
+#define LOG_CONGESTED_PERCENT    50
+#define LOG_CONGESTED_DECIMATION 4
+
 /*
   log structures common to all vehicle types
  */
 struct PACKED log_Format {
-    LOG_PACKET_HEADER;
+    LOG_PLAIN_HEADER;
     uint8_t type;
     uint8_t length;
     char name[4];
@@ -133,48 +346,144 @@ struct PACKED log_Format {
     char labels[64];
 };
 
+/*
+  bytes before the fields of records of a type. 5 if they have a
+  time_delta, so the FMT length has 2 more bytes than the format,
+  otherwise 3
+ */
+static inline uint8_t log_header_length(const struct log_Format &f)
+{
+    uint16_t fields = 0;
+    for (uint8_t i=0; i<sizeof(f.format) && f.format[i] != 0; i++) {
+        fields += log_field_size(f.format[i]);
+    }
+    if (fields + 5 == f.length) {
+        return 5;
+    }
+    return 3;
+}
+
 struct PACKED log_Parameter {
     LOG_PACKET_HEADER;
     char name[16];
     float value;
 };
 
-struct PACKED log_GPS {
-    LOG_PACKET_HEADER;
-    uint8_t  status;
-    uint32_t gps_time;
-    uint8_t  num_sats;
-    int16_t  hdop;
-    int32_t  latitude;
-    int32_t  longitude;
-    int32_t  rel_altitude;
-    int32_t  altitude;
-    uint32_t ground_speed;
-    int32_t  ground_course;
-};
+#define LOG_GPS_FIELDS(F, S) \
+    F(B, status,        "Status") S \
+    F(I, gps_time,      "Time")   S \
+    F(B, num_sats,      "NSats")  S \
+    F(c, hdop,          "HDop")   S \
+    F(L, latitude,      "Lat")    S \
+    F(L, longitude,     "Lng")    S \
+    F(e, rel_altitude,  "RelAlt") S \
+    F(e, altitude,      "Alt")    S \
+    F(E, ground_speed,  "Spd")    S \
+    F(e, ground_course, "GCrs")   S \
+    F(I, sample_us,     "TimeUS")       // micros() time the fix was parsed
+LOG_MESSAGE_STRUCT(log_GPS, LOG_GPS_FIELDS);
+
+#define LOG_TIME_FIELDS(F, S) \
+    F(I, time_us, "TimeUS")
+LOG_MESSAGE_STRUCT(log_Time, LOG_TIME_FIELDS);
 
 struct PACKED log_Message {
     LOG_PACKET_HEADER;
     char msg[64];
 };
 
-struct PACKED log_IMU {
+#define LOG_IMU_FIELDS(F, S) \
+    F(I, time_us, "TimeUS") S \
+    F(f, gyro_x,  "GyrX")   S \
+    F(f, gyro_y,  "GyrY")   S \
+    F(f, gyro_z,  "GyrZ")   S \
+    F(f, accel_x, "AccX")   S \
+    F(f, accel_y, "AccY")   S \
+    F(f, accel_z, "AccZ")
+LOG_MESSAGE_STRUCT(log_IMU, LOG_IMU_FIELDS);
+
+#define LOG_DSTATS_FIELDS(F, S) \
+    F(I, time_ms,            "TimeMS") S \
+    F(H, buf_size,           "BufSz")  S \
+    F(H, high_water,         "HiWat")  S \
+    F(I, dropped_bytes,      "DrpByt") S \
+    F(H, dropped_records,    "DrpRec") S \
+    F(B, worst_type,         "WType")  S \
+    F(H, worst_type_dropped, "WDrp")   S \
+    F(I, write_rate,         "WRate")  S \
+    F(I, write_max_us,       "WMax")
+LOG_MESSAGE_STRUCT(log_DSTATS, LOG_DSTATS_FIELDS);
+
+#define LOG_VIBE_FIELDS(F, S) \
+    F(I, time_ms,   "TimeMS") S \
+    F(B, sensor,    "Sensor") S \
+    F(H, sample_hz, "Rate")   S \
+    F(H, peak_x,    "PkX")    S \
+    F(H, peak_y,    "PkY")    S \
+    F(H, peak_z,    "PkZ")    S \
+    F(f, energy_x,  "EnX")    S \
+    F(f, energy_y,  "EnY")    S \
+    F(f, energy_z,  "EnZ")
+LOG_MESSAGE_STRUCT(log_Vibe, LOG_VIBE_FIELDS);
+
+#define LOG_LOOP_FIELDS(F, S) \
+    F(I, time_ms,    "TimeMS") S \
+    F(H, count,      "NLoop")  S \
+    F(H, long_count, "NLon")   S \
+    F(I, max_time,   "MaxT")   S \
+    F(I, p50,        "P50")    S \
+    F(I, p95,        "P95")    S \
+    F(I, p99,        "P99")    S \
+    F(H, slack_min,  "SlkMin") S \
+    F(H, slack_mean, "SlkAvg")
+LOG_MESSAGE_STRUCT(log_Loop, LOG_LOOP_FIELDS);
+
+// the size of a count of the IRAW records that follow, in rad/s and
+// m/s/s
+#define LOG_IMU_RAW_SCALE_FIELDS(F, S) \
+    F(f, gyro_scale,  "GyrMul") S \
+    F(f, accel_scale, "AccMul")
+LOG_MESSAGE_STRUCT(log_IMU_Raw_Scale, LOG_IMU_RAW_SCALE_FIELDS);
+
+// a block of consecutive raw samples of one sensor, at the full
+// sensor rate
+struct PACKED log_IMU_Raw {
+    LOG_PACKET_HEADER;
+    uint32_t time_us;           // of the first sample
+    float    interval_us;       // between samples
+    uint8_t  sensor;            // 0 for the gyro, 1 for the accel
+    int16_t  x[LOG_ARRAY_VALUES];
+    int16_t  y[LOG_ARRAY_VALUES];
+    int16_t  z[LOG_ARRAY_VALUES];
+};
+
+// the loop time histogram, 8 buckets of AP_Scheduler's at a time
+#define LOG_LOOP_HIST_BUCKETS 8
+struct PACKED log_LoopHist {
     LOG_PACKET_HEADER;
-    float gyro_x, gyro_y, gyro_z;
-    float accel_x, accel_y, accel_z;
+    uint32_t time_ms;
+    uint8_t  first;
+    uint16_t count[LOG_LOOP_HIST_BUCKETS];
 };
 
 #define LOG_COMMON_STRUCTURES \
     { LOG_FORMAT_MSG, sizeof(log_Format), \
-      "FMT", "BBnNZ",      "Type,Length,Name,Format" },    \
+      "FMT", "BBnNZ",      "Type,Length,Name,Format", 0, LOG_PRIORITY_CRITICAL }, \
     { LOG_PARAMETER_MSG, sizeof(log_Parameter), \
-      "PARM", "Nf",        "Name,Value" },    \
-    { LOG_GPS_MSG, sizeof(log_GPS), \
-      "GPS",  "BIBcLLeeEe", "Status,Time,NSats,HDop,Lat,Lng,RelAlt,Alt,Spd,GCrs" }, \
-    { LOG_IMU_MSG, sizeof(log_IMU), \
-      "IMU",  "ffffff",     "GyrX,GyrY,GyrZ,AccX,AccY,AccZ" }, \
+      "PARM", "Nf",        "Name,Value", 0, LOG_PRIORITY_CRITICAL }, \
+    { LOG_MESSAGE_STRUCTURE(LOG_GPS_MSG, log_GPS, "GPS", LOG_GPS_FIELDS) }, \
+    { LOG_MESSAGE_STRUCTURE(LOG_IMU_MSG, log_IMU, "IMU", LOG_IMU_FIELDS), 200, LOG_PRIORITY_LOW }, \
     { LOG_MESSAGE_MSG, sizeof(log_Message), \
-      "MSG",  "Z",     "Message" }
+      "MSG",  "Z",     "Message", 0, LOG_PRIORITY_CRITICAL }, \
+    { LOG_MESSAGE_STRUCTURE(LOG_DSTATS_MSG, log_DSTATS, "DSTA", LOG_DSTATS_FIELDS) }, \
+    { LOG_MESSAGE_STRUCTURE(LOG_VIBE_MSG, log_Vibe, "VIBE", LOG_VIBE_FIELDS) }, \
+    { LOG_MESSAGE_STRUCTURE(LOG_LOOP_MSG, log_Loop, "LOOP", LOG_LOOP_FIELDS) }, \
+    { LOG_LOOP_HIST_MSG, sizeof(log_LoopHist), \
+      "LHST", "IBHHHHHHHH", "TimeMS,First,B0,B1,B2,B3,B4,B5,B6,B7" }, \
+    { LOG_MESSAGE_STRUCTURE(LOG_TIME_MSG, log_Time, "TIME", LOG_TIME_FIELDS), 0, LOG_PRIORITY_CRITICAL }, \
+    { LOG_MESSAGE_STRUCTURE(LOG_IMU_RAW_SCALE_MSG, log_IMU_Raw_Scale, "IRSC", LOG_IMU_RAW_SCALE_FIELDS), 0, LOG_PRIORITY_CRITICAL }, \
+    { LOG_IMU_RAW_MSG, sizeof(log_IMU_Raw), \
+      "IRAW", "IfBaaa", "TimeUS,Intv,Sensor,X,Y,Z", 0, LOG_PRIORITY_LOW }
 
 // message types for common messages
 #define LOG_FORMAT_MSG	  128
@@ -182,6 +491,13 @@ struct PACKED log_IMU {
 #define LOG_GPS_MSG		  130
 #define LOG_IMU_MSG		  131
 #define LOG_MESSAGE_MSG	  132
+#define LOG_DSTATS_MSG	  133
+#define LOG_VIBE_MSG	  134
+#define LOG_LOOP_MSG	  135
+#define LOG_LOOP_HIST_MSG 136
+#define LOG_TIME_MSG	  137
+#define LOG_IMU_RAW_SCALE_MSG 138
+#define LOG_IMU_RAW_MSG	  139
 
 #include "DataFlash_Block.h"
 #include "DataFlash_File.h"
@@ -36,6 +36,7 @@ private:
     // start of the page
     bool 		    BlockRead(uint8_t BufferNum, uint16_t IntPageAdr, 
                               void *pBuffer, uint16_t size);
+    bool                    ArrayRead(uint16_t PageAdr, uint16_t IntPageAdr, void *pBuffer, uint16_t size);
     
     AP_HAL::SPIDeviceDriver *_spi;
     AP_HAL::Semaphore *_spi_sem;
@@ -56,6 +56,7 @@ extern const AP_HAL::HAL& hal;
 #define DF_BUFFER_1_TO_PAGE_WITH_ERASE   0x83
 #define DF_BUFFER_2_TO_PAGE_WITH_ERASE   0x86
 #define DF_PAGE_ERASE   0x81
+#define DF_CONTINUOUS_ARRAY_READ   0xE8
 #define DF_BLOCK_ERASE   0x50
 #define DF_SECTOR_ERASE   0x7C
 #define DF_CHIP_ERASE_0   0xC7
@@ -322,6 +323,42 @@ uint8_t DataFlash_APM2::BufferRead (uint8_t BufferNum, uint16_t IntPageAdr)
 }
 
 
+// read from the flash array with the continuous read command, which
+// doesn't disturb the buffers
+bool DataFlash_APM2::ArrayRead(uint16_t PageAdr, uint16_t IntPageAdr, void *pBuffer, uint16_t size)
+{
+    if (!_sem_take(1))
+        return false;
+
+    // activate dataflash command decoder
+    _spi->cs_assert();
+
+    uint8_t cmd[8];
+    cmd[0] = DF_CONTINUOUS_ARRAY_READ;
+    if(df_PageSize==512) {
+        cmd[1] = (uint8_t)(PageAdr >> 7);
+        cmd[2] = (uint8_t)((PageAdr << 1) | (IntPageAdr >> 8));
+    }else{
+        cmd[1] = (uint8_t)(PageAdr >> 6);
+        cmd[2] = (uint8_t)((PageAdr << 2) | (IntPageAdr >> 8));
+    }
+    cmd[3] = (uint8_t)IntPageAdr;
+    // don't cares
+    cmd[4] = cmd[5] = cmd[6] = cmd[7] = 0;
+    _spi->transfer(cmd, sizeof(cmd));
+
+    uint8_t *pData = (uint8_t *)pBuffer;
+    while (size--) {
+        *pData++ = _spi->transfer(0x00);
+    }
+
+    // release SPI bus for use by other sensors
+    _spi->cs_release();
+
+    _spi_sem->give();
+    return true;
+}
+
 // *** END OF INTERNAL FUNCTIONS ***
 
 void DataFlash_APM2::PageErase (uint16_t PageAdr)
@@ -373,9 +410,8 @@ void DataFlash_APM2::BlockErase(uint16_t BlockAdr)
     _spi->transfer(0x00);
     //serialDebug("BL Erase, %d\n", BlockAdr);
 
-    //initiate flash page erase
+    //initiate flash page erase. The caller waits for it to finish
     _spi->cs_release();
-    while(!ReadStatus()) ;
 
     // release SPI bus for use by other sensors
     _spi_sem->give();
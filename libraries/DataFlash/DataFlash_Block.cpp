@@ -12,19 +12,32 @@ extern AP_HAL::HAL& hal;
 // this if (and only if!) the low level format changes
 #define DF_LOGGING_FORMAT    0x28122013
 
+DataFlash_Block *DataFlash_Block::_instance;
+
 // *** DATAFLASH PUBLIC FUNCTIONS ***
 void DataFlash_Block::StartWrite(uint16_t PageAdr)
 {
+    if (_instance == NULL) {
+        _instance = this;
+        hal.scheduler->register_timer_process(_page_timer);
+    }
+    _page_flush();
     df_BufferIdx  = 0;
     df_BufferNum  = 0;
     df_PageAdr    = PageAdr;
-    WaitReady();
 }
 
 void DataFlash_Block::FinishWrite(void)
 {
-    // Write Buffer to flash, NO WAIT
-    BufferToPage(df_BufferNum, df_PageAdr, 0);      
+    // the chip ignores a page write while it is busy with the last
+    // one or erasing, so then leave the buffer for the timer to start
+    if (ReadStatus()) {
+        BufferToPage(df_BufferNum, df_PageAdr, 0);
+    } else {
+        _pending_buffer = df_BufferNum;
+        _pending_page   = df_PageAdr;
+        _page_pending   = true;
+    }
     df_PageAdr++;
     // If we reach the end of the memory, start from the begining    
     if (df_PageAdr > df_NumPages)
@@ -40,12 +53,38 @@ void DataFlash_Block::WriteBlock(const void *pBuffer, uint16_t size)
     if (!CardInserted() || !log_write_started) {
         return;
     }
+    uint8_t msg_type = _msg_type(pBuffer, size);
+    if (!_log_allowed(msg_type)) {
+        return;
+    }
+#if DATAFLASH_TIMESTAMPS
+    if (_has_time(msg_type) && msg_type != LOG_TIME_MSG && _time_needed()) {
+        _write_time();
+    }
+    uint8_t stamped[_has_time(msg_type) ? size : 1];
+    pBuffer = _stamp(msg_type, pBuffer, size, stamped);
+#endif
+    if (_delta != NULL && msg_type != 0 &&
+        size > sizeof(struct log_Header) &&
+        size - sizeof(struct log_Header) <= DATAFLASH_DELTA_MAX_LEN) {
+        _write_delta(msg_type, (const uint8_t *)pBuffer, size);
+        return;
+    }
+    _write_bytes(pBuffer, size);
+}
+
+/*
+  write raw bytes to the page buffers
+ */
+void DataFlash_Block::_write_bytes(const void *pBuffer, uint16_t size)
+{
     while (size > 0) {
         uint16_t n = df_PageSize - df_BufferIdx;
         if (n > size) {
             n = size;
         }
 
+        _page_wait();
         if (df_BufferIdx == 0) {
             // if we are at the start of a page we need to insert a
             // page header
@@ -70,6 +109,201 @@ void DataFlash_Block::WriteBlock(const void *pBuffer, uint16_t size)
     }
 }
 
+/*
+  write a record delta compressed against the last record of the
+  same type. The body is XORed with the reference, then written as a
+  bitmap of the non-zero bytes followed by those bytes. Slowly
+  changing values leave most bytes zero, so a few bytes of bitmap
+  replace most of the record
+
+  A plain record is written instead if there is no reference, the
+  keyframe count is reached, or the delta would be no smaller. Either
+  way the record becomes the new reference
+ */
+void DataFlash_Block::_write_delta(uint8_t msg_type, const uint8_t *pkt, uint16_t size)
+{
+    uint8_t len = size - sizeof(struct log_Header);
+    const uint8_t *body = pkt + sizeof(struct log_Header);
+    struct DeltaSlot *slot = _delta_find(_delta, msg_type);
+    if (slot != NULL && slot->len == len && slot->count < DATAFLASH_DELTA_KEYFRAME) {
+        uint8_t out[sizeof(struct log_Header) + (DATAFLASH_DELTA_MAX_LEN+7)/8 + DATAFLASH_DELTA_MAX_LEN];
+        uint8_t nbitmap = (len+7)/8;
+        uint8_t *bitmap = &out[sizeof(struct log_Header)];
+        uint8_t n = sizeof(struct log_Header) + nbitmap;
+        out[0] = HEAD_BYTE1;
+        out[1] = HEAD_BYTE2_DELTA;
+        out[2] = msg_type;
+        memset(bitmap, 0, nbitmap);
+        for (uint8_t i=0; i<len; i++) {
+            uint8_t x = body[i] ^ slot->data[i];
+            if (x != 0) {
+                bitmap[i/8] |= 1U<<(i&7);
+                out[n++] = x;
+            }
+        }
+        if (n < size) {
+            _write_bytes(out, n);
+            memcpy(slot->data, body, len);
+            slot->count++;
+            return;
+        }
+    }
+    _write_bytes(pkt, size);
+    _delta_store(_delta, slot, msg_type, body, len);
+}
+
+/*
+  find the reference slot for a message type
+ */
+DataFlash_Block::DeltaSlot *DataFlash_Block::_delta_find(struct DeltaState *st, uint8_t msg_type)
+{
+    for (uint8_t i=0; i<DATAFLASH_DELTA_SLOTS; i++) {
+        if (st->slot[i].len != 0 && st->slot[i].msg_type == msg_type) {
+            return &st->slot[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+  make a plain record the reference for its type, taking over the
+  oldest slot if the type has none
+ */
+void DataFlash_Block::_delta_store(struct DeltaState *st, struct DeltaSlot *slot,
+                                   uint8_t msg_type, const uint8_t *body, uint8_t len)
+{
+    if (slot == NULL) {
+        slot = &st->slot[st->next_slot];
+        st->next_slot = (st->next_slot + 1) % DATAFLASH_DELTA_SLOTS;
+    }
+    slot->msg_type = msg_type;
+    slot->len = len;
+    slot->count = 0;
+    memcpy(slot->data, body, len);
+}
+
+/*
+  enable or disable delta compression. The state costs about 200
+  bytes of RAM, so it is only allocated while enabled
+ */
+bool DataFlash_Block::set_compression(bool enable)
+{
+    if (!enable) {
+        delete _delta;
+        _delta = NULL;
+        return true;
+    }
+    if (_delta == NULL) {
+        _delta = new DeltaState;
+        if (_delta == NULL) {
+            return false;
+        }
+        memset(_delta, 0, sizeof(*_delta));
+    }
+    return true;
+}
+
+/*
+  reserve space for a record in the current page buffer. This only
+  works for backends with a RAM page buffer, and only when the record
+  fits in the rest of the current page
+ */
+void *DataFlash_Block::ReserveBlock(uint16_t size)
+{
+    if (!CardInserted() || !log_write_started) {
+        return NULL;
+    }
+    if (_delta != NULL) {
+        // records have to go through the compressor
+        return NULL;
+    }
+#if DATAFLASH_TIMESTAMPS
+    if (_time_needed()) {
+        // WriteBlock() puts a TIME record first
+        return NULL;
+    }
+#endif
+    _page_wait();
+    uint16_t idx = df_BufferIdx;
+    if (idx == 0) {
+        idx = sizeof(struct PageHeader);
+    }
+    if (idx + size > df_PageSize) {
+        // would straddle a page
+        return NULL;
+    }
+    uint8_t *p = BufferPointer(df_BufferNum, idx);
+    if (p == NULL) {
+        return NULL;
+    }
+    if (df_BufferIdx == 0) {
+        // start of a page, so put the page header in first
+        struct PageHeader ph = { df_FileNumber, df_FilePage };
+        BlockWrite(df_BufferNum, 0, &ph, sizeof(ph), NULL, 0);
+        df_BufferIdx = sizeof(ph);
+    }
+    return p;
+}
+
+/*
+  finish a record written with ReserveBlock()
+ */
+void DataFlash_Block::CommitBlock(uint16_t size)
+{
+#if DATAFLASH_TIMESTAMPS
+    uint8_t *pkt = BufferPointer(df_BufferNum, df_BufferIdx);
+    uint8_t msg_type = _msg_type(pkt, size);
+    if (_has_time(msg_type) && size >= sizeof(struct log_Header) + sizeof(uint16_t)) {
+        ((struct log_Time *)pkt)->time_delta = _time_delta(msg_type, pkt);
+    }
+#endif
+    df_BufferIdx += size;
+    if (df_BufferIdx == df_PageSize) {
+        FinishWrite();
+        df_FilePage++;
+    }
+}
+
+/*
+  start the pending page if the chip has finished the last one
+ */
+void DataFlash_Block::_page_start(void)
+{
+    if (_page_pending && ReadStatus()) {
+        BufferToPage(_pending_buffer, _pending_page, 0);
+        _page_pending = false;
+    }
+}
+
+void DataFlash_Block::_page_timer(uint32_t now)
+{
+    if (_instance != NULL) {
+        _instance->_page_start();
+    }
+}
+
+/*
+  wait until the writer's buffer is free. It is only still being
+  programmed while the other buffer is pending behind it
+ */
+void DataFlash_Block::_page_wait(void)
+{
+    while (_page_pending) {
+        hal.scheduler->suspend_timer_procs();
+        _page_start();
+        hal.scheduler->resume_timer_procs();
+    }
+}
+
+/*
+  wait for all page writes to finish, before using the buffer the
+  writer isn't filling or reading the flash
+ */
+void DataFlash_Block::_page_flush(void)
+{
+    _page_wait();
+    WaitReady();
+}
 
 // Get the last page written to
 uint16_t DataFlash_Block::GetWritePage()
@@ -85,56 +319,71 @@ uint16_t DataFlash_Block::GetPage()
 
 void DataFlash_Block::StartRead(uint16_t PageAdr)
 {
-    df_Read_BufferNum = 0;
     df_Read_PageAdr   = PageAdr;
+    _read_page_header();
+}
 
-    WaitReady();
-
-    // copy flash page to buffer
-    PageToBuffer(df_Read_BufferNum, df_Read_PageAdr);
-
-    // We are starting a new page - read FileNumber and FilePage
+/*
+  start reading the page at df_Read_PageAdr, with its FileNumber and
+  FilePage
+ */
+void DataFlash_Block::_read_page_header(void)
+{
     struct PageHeader ph;
-    BlockRead(df_Read_BufferNum, 0, &ph, sizeof(ph));
+    _page_flush();
+    ArrayRead(df_Read_PageAdr, 0, &ph, sizeof(ph));
     df_FileNumber = ph.FileNumber;
     df_FilePage   = ph.FilePage;
     df_Read_BufferIdx = sizeof(ph);
+    _read_len = 0;
+    _read_ofs = 0;
 }
 
+/*
+  read from the log a chunk at a time into _read_cache, which saves a
+  flash command for each of the many small reads of a log dump
+ */
 void DataFlash_Block::ReadBlock(void *pBuffer, uint16_t size)
 {
     while (size > 0) {
-        uint16_t n = df_PageSize - df_Read_BufferIdx;
+        if (_read_ofs == _read_len) {
+            uint16_t n = df_PageSize - df_Read_BufferIdx;
+            if (n > DATAFLASH_READ_CHUNK) {
+                n = DATAFLASH_READ_CHUNK;
+            }
+            // the flash can't be read while a page is programmed
+            _page_flush();
+            ArrayRead(df_Read_PageAdr, df_Read_BufferIdx, _read_cache, n);
+            df_Read_BufferIdx += n;
+            _read_len = n;
+            _read_ofs = 0;
+        }
+
+        uint16_t n = _read_len - _read_ofs;
         if (n > size) {
             n = size;
         }
-
-        WaitReady();
-
-        BlockRead(df_Read_BufferNum, df_Read_BufferIdx, pBuffer, n);
+        memcpy(pBuffer, &_read_cache[_read_ofs], n);
         size -= n;
         pBuffer = (void *)(n + (uintptr_t)pBuffer);
-        
-        df_Read_BufferIdx += n;
+        _read_ofs += n;
 
-        if (df_Read_BufferIdx == df_PageSize) {
+        if (_read_ofs == _read_len && df_Read_BufferIdx == df_PageSize) {
             df_Read_PageAdr++;
             if (df_Read_PageAdr > df_NumPages) {
                 df_Read_PageAdr = 1;
             }
-            PageToBuffer(df_Read_BufferNum, df_Read_PageAdr);
-
-            // We are starting a new page - read FileNumber and FilePage
-            struct PageHeader ph;
-            BlockRead(df_Read_BufferNum, 0, &ph, sizeof(ph));
-            df_FileNumber = ph.FileNumber;
-            df_FilePage   = ph.FilePage;
-
-            df_Read_BufferIdx = sizeof(ph);
+            _read_page_header();
         }
     }
 }
 
+bool DataFlash_Block::ArrayRead(uint16_t PageAdr, uint16_t IntPageAdr, void *pBuffer, uint16_t size)
+{
+    PageToBuffer(0, PageAdr);
+    return BlockRead(0, IntPageAdr, pBuffer, size);
+}
+
 void DataFlash_Block::SetFileNumber(uint16_t FileNumber)
 {
     df_FileNumber = FileNumber;
@@ -153,21 +402,73 @@ uint16_t DataFlash_Block::GetFilePage()
 
 void DataFlash_Block::EraseAll()
 {
-    for (uint16_t j = 1; j <= (df_NumPages+1)/8; j++) {
-        BlockErase(j);
-        if (j%6 == 0) {
-            hal.scheduler->delay(6);
+    EraseStart();
+    while (_erase_block != 0) {
+        hal.scheduler->delay(1);
+        EraseUpdate();
+    }
+}
+
+/*
+  start a background erase. Any log being written is stopped, and the
+  next one starts from page 1 on the blocks erased so far
+ */
+void DataFlash_Block::EraseStart()
+{
+    if (log_write_started) {
+        FlushLog();
+    }
+    log_write_started = false;
+    _erase_block = 1;
+}
+
+/*
+  start erasing the next blocks that the chip is ready for. Blocks a
+  new log has already reached are skipped, as each page write erases
+  its page first anyway. When the last block is started the logging
+  format is written in the last page
+ */
+void DataFlash_Block::EraseUpdate()
+{
+    if (_erase_block == 0 || _page_pending) {
+        // a pending page goes before more erasing
+        return;
+    }
+    uint16_t num_blocks = (df_NumPages+1)/8;
+    for (uint8_t i=0; i<DATAFLASH_ERASE_MAX_BLOCKS; i++) {
+        if (log_write_started && _erase_block <= df_PageAdr/8) {
+            _erase_block = df_PageAdr/8 + 1;
+        }
+        if (_erase_block > num_blocks) {
+            break;
         }
+        if (!ReadStatus()) {
+            return;
+        }
+        BlockErase(_erase_block++);
+    }
+    if (_erase_block <= num_blocks) {
+        return;
+    }
+
+    // the page writer may be filling one buffer, so use the other
+    if (!ReadStatus()) {
+        return;
     }
-    // write the logging format in the last page
-    hal.scheduler->delay(100);
-    StartWrite(df_NumPages+1);
+    uint8_t buffer_num = df_BufferNum ^ 1;
+    struct PageHeader ph = { df_FileNumber, df_FilePage };
     uint32_t version = DF_LOGGING_FORMAT;
-    log_write_started = true;
-    WriteBlock(&version, sizeof(version));
-    log_write_started = false;
-    FinishWrite();
-    hal.scheduler->delay(100);
+    BlockWrite(buffer_num, 0, &ph, sizeof(ph), &version, sizeof(version));
+    BufferToPage(buffer_num, df_NumPages+1, 1);
+    _erase_block = 0;
+}
+
+uint8_t DataFlash_Block::EraseProgress()
+{
+    if (_erase_block == 0) {
+        return 100;
+    }
+    return (uint32_t)(_erase_block - 1) * 100 / ((df_NumPages+1)/8 + 1);
 }
 
 /*
@@ -175,6 +476,9 @@ void DataFlash_Block::EraseAll()
  */
 bool DataFlash_Block::NeedErase(void)
 {
+    if (_erase_block != 0) {
+        return false;
+    }
     uint32_t version = 0;
     StartRead(df_NumPages+1);
     ReadBlock(&version, sizeof(version));
@@ -9,9 +9,37 @@
 
 #include <stdint.h>
 
+/*
+  delta compression limits. Records with bodies longer than
+  DATAFLASH_DELTA_MAX_LEN are always written plain, and a plain
+  record is forced every DATAFLASH_DELTA_KEYFRAME records of a type
+  so a reader can recover from a lost reference
+ */
+#define DATAFLASH_DELTA_SLOTS    4
+#define DATAFLASH_DELTA_MAX_LEN  48
+#define DATAFLASH_DELTA_KEYFRAME 32
+
+// most blocks a background erase starts per EraseUpdate(). A real
+// chip is busy for tens of milliseconds erasing each one, so this
+// only matters for the simulated flash
+#define DATAFLASH_ERASE_MAX_BLOCKS 8
+
+// bytes the log reader fetches from the flash at a time
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+#define DATAFLASH_READ_CHUNK 32
+#else
+#define DATAFLASH_READ_CHUNK 128
+#endif
+
 class DataFlash_Block : public DataFlash_Class
 {
 public:
+    DataFlash_Block() :
+        _erase_block(0),
+        _page_pending(false),
+        _delta(NULL)
+    {}
+
     // initialisation
     virtual void Init(void) = 0;
     virtual bool CardInserted(void) = 0;
@@ -19,9 +47,17 @@ public:
     // erase handling
     bool NeedErase(void);
     void EraseAll();
+    void EraseStart();
+    void EraseUpdate();
+    uint8_t EraseProgress();
 
     /* Write a block of data at current offset */
     void WriteBlock(const void *pBuffer, uint16_t size);
+    void *ReserveBlock(uint16_t size);
+    void CommitBlock(uint16_t size);
+
+    // delta compression of log records, see _write_delta()
+    bool set_compression(bool enable);
 
     // high level interface
     uint16_t find_last_log(void);
@@ -37,6 +73,8 @@ public:
     void DumpPageInfo(AP_HAL::BetterStream *port);
     void ShowDeviceInfo(AP_HAL::BetterStream *port);
     void ListAvailableLogs(AP_HAL::BetterStream *port);
+    void get_log_info(uint16_t log_num, uint32_t &size, uint32_t &time_utc);
+    int16_t get_log_data(uint16_t log_num, uint16_t page, uint32_t ofs, uint16_t len, uint8_t *data);
 
 private:
     struct PageHeader {
@@ -46,7 +84,6 @@ private:
 
     // DataFlash Log variables...
     uint8_t df_BufferNum;
-    uint8_t df_Read_BufferNum;
     uint16_t df_BufferIdx;
     uint16_t df_Read_BufferIdx;
     uint16_t df_PageAdr;
@@ -55,10 +92,69 @@ private:
     uint16_t df_FilePage;
     bool log_write_started;
 
+    // the reader's copy of the flash after df_Read_BufferIdx-_read_len
+    uint8_t _read_cache[DATAFLASH_READ_CHUNK];
+    uint8_t _read_len;
+    uint8_t _read_ofs;
+
+    // the next block of a background erase, 0 when none is running.
+    // Blocks below it are erased, and while it runs there is at most
+    // one log, which starts at page 1
+    uint16_t _erase_block;
+
+    /*
+      page write pipeline. While the chip programs one buffer into
+      flash the writer fills the other. A buffer filled before the
+      chip is ready becomes the pending page, which the timer process
+      starts once it is, so the writer only waits if it catches up
+      with the buffer being programmed
+     */
+    volatile bool _page_pending;
+    uint8_t _pending_buffer;
+    uint16_t _pending_page;
+    static DataFlash_Block *_instance;
+    static void _page_timer(uint32_t now);
+    void _page_start(void);
+    void _page_wait(void);
+    void _page_flush(void);
+
+    /*
+      delta compression state. Each slot holds the body of the last
+      record written (or read) for one message type. The reader
+      keeps its own copy so that dumping a log doesn't disturb the
+      writer
+     */
+    struct DeltaSlot {
+        uint8_t msg_type;
+        uint8_t len;        // body length, 0 for an unused slot
+        uint8_t count;      // delta records since the last plain one
+        uint8_t data[DATAFLASH_DELTA_MAX_LEN];
+    };
+    struct DeltaState {
+        struct DeltaSlot slot[DATAFLASH_DELTA_SLOTS];
+        uint8_t next_slot;
+    };
+    struct DeltaState *_delta;
+
+    void _write_bytes(const void *pBuffer, uint16_t size);
+    void _write_delta(uint8_t msg_type, const uint8_t *pkt, uint16_t size);
+    static struct DeltaSlot *_delta_find(struct DeltaState *st, uint8_t msg_type);
+    static void _delta_store(struct DeltaState *st, struct DeltaSlot *slot,
+                             uint8_t msg_type, const uint8_t *body, uint8_t len);
+    void _print_plain_entry(struct DeltaState *st, uint8_t msg_type,
+                            uint8_t num_types, const struct LogStructure *structure,
+                            void (*print_mode)(AP_HAL::BetterStream *port, uint8_t mode),
+                            AP_HAL::BetterStream *port);
+    void _print_delta_entry(struct DeltaState *st, uint8_t msg_type,
+                            uint8_t num_types, const struct LogStructure *structure,
+                            void (*print_mode)(AP_HAL::BetterStream *port, uint8_t mode),
+                            AP_HAL::BetterStream *port);
+
     /*
       functions implemented by the board specific backends
      */
     virtual void WaitReady() = 0;
+    virtual uint8_t ReadStatus() = 0;
     virtual void BufferToPage (uint8_t BufferNum, uint16_t PageAdr, uint8_t wait) = 0;
     virtual void PageToBuffer(uint8_t BufferNum, uint16_t PageAdr) = 0;
     virtual void PageErase(uint16_t PageAdr) = 0;
@@ -77,8 +173,23 @@ private:
     // start of the page
     virtual bool BlockRead(uint8_t BufferNum, uint16_t IntPageAdr, void *pBuffer, uint16_t size) = 0;
 
+    // read size bytes of a flash page straight from the flash,
+    // without using a buffer. The caller must ensure that the data
+    // fits within the page. By default the page is loaded into
+    // buffer 0
+    virtual bool ArrayRead(uint16_t PageAdr, uint16_t IntPageAdr, void *pBuffer, uint16_t size);
+
+    // return a pointer into the page buffer if the backend keeps it
+    // in RAM, or NULL if the buffer is only reachable over the bus
+    virtual uint8_t *BufferPointer(uint8_t BufferNum, uint16_t IntPageAdr) { return NULL; }
+
+    // make the pages written so far durable, for a backend that
+    // caches the flash. Called as a log is closed
+    virtual void FlushLog(void) {}
+
     // internal high level functions
     void StartRead(uint16_t PageAdr);
+    void _read_page_header(void);
     uint16_t find_last_page(void);
     uint16_t find_last_page_of_log(uint16_t log_number);
     bool check_wrapped(void);
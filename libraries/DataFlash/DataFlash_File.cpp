@@ -28,22 +28,83 @@ extern const AP_HAL::HAL& hal;
 #define MAX_LOG_FILES 500U
 #define DATAFLASH_PAGE_SIZE 1024UL
 
+// buffer space kept back from normal records so that the records
+// needed to decode a log can still be written when the card stalls
+#define DATAFLASH_CRITICAL_RESERVE 512
+
+// longest time we will wait for a stalled card before dropping a
+// critical record
+#define DATAFLASH_CRITICAL_WAIT_MS 20
+
+// how often to write a DSTATS record
+#define DATAFLASH_STATS_INTERVAL_MS 1000
+
+// log index file layout, and the number of time sync markers kept
+// for each log
+#define DATAFLASH_INDEX_MAGIC   0x5844494CUL // "LIDX"
+#define DATAFLASH_INDEX_VERSION 1
+#define DATAFLASH_INDEX_MAX_SYNCS 128
+#define DATAFLASH_INDEX_SYNC_INTERVAL_MS 1000
+
+// the size of the reads made ahead for a log transfer
+#define DATAFLASH_XFER_BUFSIZE 512
+
+// the card's sector size. The IO process writes whole, aligned
+// sectors so the card doesn't have to read and rewrite part filled
+// ones, except after the log has been quiet for
+// DATAFLASH_WRITE_TIMEOUT_US
+#define DATAFLASH_SECTOR_SIZE 512
+#define DATAFLASH_WRITE_TIMEOUT_US 2000000UL
+
+// how often the written data is flushed to the card
+#define DATAFLASH_FSYNC_INTERVAL_US 500000UL
+
+// longest time starting a log waits for the IO process to finish
+// preparing for it
+#define DATAFLASH_PREPARE_WAIT_MS 100
+
 int DataFlash_File::_write_fd = -1;
 volatile bool DataFlash_File::_initialised = false;
 
-uint8_t *DataFlash_File::_writebuf = NULL;
-const uint16_t DataFlash_File::_writebuf_size = 4096;
-volatile uint16_t DataFlash_File::_writebuf_head = 0;
-volatile uint16_t DataFlash_File::_writebuf_tail = 0;
+RingBuffer<uint8_t> DataFlash_File::_writebuf;
+uint16_t DataFlash_File::_writebuf_size = 4096;
 uint32_t DataFlash_File::_last_write_time = 0;
+uint32_t DataFlash_File::_last_sync_time = 0;
+uint32_t DataFlash_File::_write_offset = 0;
+volatile uint32_t DataFlash_File::_write_total = 0;
+volatile uint32_t DataFlash_File::_write_max_us = 0;
+uint8_t DataFlash_File::_sector_buf[DATAFLASH_SECTOR_SIZE];
+int DataFlash_File::_xfer_fd = -1;
+uint8_t *DataFlash_File::_xfer_buf;
+uint32_t DataFlash_File::_xfer_ofs;
+uint16_t DataFlash_File::_xfer_len;
+volatile bool DataFlash_File::_xfer_pending;
+DataFlash_File *DataFlash_File::_instance;
+volatile uint8_t DataFlash_File::_prepare_request;
+volatile uint8_t DataFlash_File::_prepare_done;
 
 /*
   constructor
  */
-DataFlash_File::DataFlash_File(const char *log_directory) :
+DataFlash_File::DataFlash_File(const char *log_directory, uint16_t buffer_size) :
     _read_fd(-1),
-    _log_directory(log_directory)
-{}
+    _log_directory(log_directory),
+    _high_water(0),
+    _dropped_bytes(0),
+    _dropped_records(0),
+    _last_stats_ms(0),
+    _stats_write_total(0),
+    _log_num(0),
+    _syncs(NULL),
+    _xfer_log_num(0),
+    _retain_logs(0),
+    _retain_mb(0),
+    _prep_state(PREPARE_START)
+{
+    _writebuf_size = buffer_size;
+    memset(_dropped_by_type, 0, sizeof(_dropped_by_type));
+    _index_reset();
+}
 
 
 // initialisation
@@ -56,14 +117,16 @@ void DataFlash_File::Init(void)
         hal.console->printf("Failed to create log directory %s", _log_directory);
         return;
     }
-    if (_writebuf != NULL) {
-        free(_writebuf);
-    }
-    _writebuf = (uint8_t *)malloc(_writebuf_size);
-    if (_writebuf == NULL) {
+    if (!_writebuf.set_size(_writebuf_size)) {
         return;
     }
-    _writebuf_head = _writebuf_tail = 0;
+    if (_syncs == NULL) {
+        // without this the index just has no time sync markers
+        _syncs = new log_index_sync[DATAFLASH_INDEX_MAX_SYNCS];
+    }
+    _writebuf.clear();
+    _instance = this;
+    _prepare_request++;
     _initialised = true;
     hal.scheduler->register_io_process(_io_timer);
 }
@@ -93,6 +156,28 @@ char *DataFlash_File::_log_file_name(uint16_t log_num)
     return buf;
 }
 
+/*
+  construct the index file name for a log number.
+  Note: Caller must free.
+ */
+char *DataFlash_File::_index_file_name(uint16_t log_num)
+{
+    char *buf = NULL;
+    asprintf(&buf, "%s/%u.idx", _log_directory, (unsigned)log_num);
+    return buf;
+}
+
+/*
+  return path name of the empty file the next log is renamed from
+  Note: Caller must free.
+ */
+char *DataFlash_File::_next_file_name(void)
+{
+    char *buf = NULL;
+    asprintf(&buf, "%s/next.tmp", _log_directory);
+    return buf;
+}
+
 /*
   return path name of the lastlog.txt marker file
   Note: Caller must free.
@@ -109,6 +194,9 @@ char *DataFlash_File::_lastlog_file_name(void)
 void DataFlash_File::EraseAll()
 {
     uint16_t log_num;
+
+    _xfer_close();
+    _prepare_wait();
     for (log_num=0; log_num<MAX_LOG_FILES; log_num++) {
         char *fname = _log_file_name(log_num);
         if (fname == NULL) {
@@ -116,6 +204,11 @@ void DataFlash_File::EraseAll()
         }
         unlink(fname);
         free(fname);
+        fname = _index_file_name(log_num);
+        if (fname != NULL) {
+            unlink(fname);
+            free(fname);
+        }
     }
     char *fname = _lastlog_file_name();
     if (fname != NULL) {
@@ -124,49 +217,166 @@ void DataFlash_File::EraseAll()
     }
 }
 
-/*
-  buffer handling macros
- */
-#define BUF_AVAILABLE(buf) ((buf##_head > (_tail=buf##_tail))? (buf##_size - buf##_head) + _tail: _tail - buf##_head)
-#define BUF_SPACE(buf) (((_head=buf##_head) > buf##_tail)?(_head - buf##_tail) - 1:((buf##_size - buf##_tail) + _head) - 1)
-#define BUF_EMPTY(buf) (buf##_head == buf##_tail)
-#define BUF_ADVANCETAIL(buf, n) buf##_tail = (buf##_tail + n) % buf##_size
-#define BUF_ADVANCEHEAD(buf, n) buf##_head = (buf##_head + n) % buf##_size
-
-
 /* Write a block of data at current offset */
 void DataFlash_File::WriteBlock(const void *pBuffer, uint16_t size)
 {
     if (_write_fd == -1 || !_initialised) {
         return;
     }
-    uint16_t _head;
-    uint16_t space = BUF_SPACE(_writebuf);
-    if (space < size) {
-        // discard the whole write, to keep the log consistent
+    const uint8_t *bytes = (const uint8_t *)pBuffer;
+    uint8_t msg_type = _msg_type(pBuffer, size);
+    if (!_log_allowed(msg_type)) {
+        // decimated, not counted as a drop
         return;
     }
+#if DATAFLASH_TIMESTAMPS
+    if (_has_time(msg_type) && msg_type != LOG_TIME_MSG && _time_needed()) {
+        _write_time();
+    }
+#endif
 
-    if (_writebuf_tail < _head) {
-        // perform as single memcpy
-        assert(_writebuf_tail+size <= _writebuf_size);
-        memcpy(&_writebuf[_writebuf_tail], pBuffer, size);
-        BUF_ADVANCETAIL(_writebuf, size);
+    bool drop;
+    if (_critical_type(msg_type)) {
+        // these are needed to decode the log, so wait a short while
+        // for a stalled card before giving up
+        uint32_t start_ms = hal.scheduler->millis();
+        while (_writebuf.space() < size &&
+               !hal.scheduler->in_timerprocess() &&
+               hal.scheduler->millis() - start_ms < DATAFLASH_CRITICAL_WAIT_MS) {
+            hal.scheduler->delay(1);
+        }
+        drop = _writebuf.space() < size;
     } else {
-        // perform as two memcpy calls
-        uint16_t n = _writebuf_size - _writebuf_tail;
-        if (n > size) n = size;
-        assert(_writebuf_tail+n <= _writebuf_size);
-        memcpy(&_writebuf[_writebuf_tail], pBuffer, n);
-        BUF_ADVANCETAIL(_writebuf, n);
-        pBuffer = (const void *)(((const uint8_t *)pBuffer) + n);
-        n = size - n;
-        if (n > 0) {
-            assert(_writebuf_tail+n <= _writebuf_size);
-            memcpy(&_writebuf[_writebuf_tail], pBuffer, n);
-            BUF_ADVANCETAIL(_writebuf, n);
+        drop = _writebuf.space() < size + DATAFLASH_CRITICAL_RESERVE;
+    }
+    if (drop) {
+        // discard the whole write, to keep the log consistent
+        _dropped_bytes += size;
+        if (_dropped_records < 0xFFFF) {
+            _dropped_records++;
+        }
+        if (_dropped_by_type[msg_type] < 0xFFFF) {
+            _dropped_by_type[msg_type]++;
+        }
+    } else {
+        _index_record(msg_type, size);
+#if DATAFLASH_TIMESTAMPS
+        uint8_t stamped[_has_time(msg_type) ? size : 1];
+        bytes = (const uint8_t *)_stamp(msg_type, pBuffer, size, stamped);
+#endif
+        _writebuf.write(bytes, size);
+        uint16_t used = _writebuf.available();
+        if (used > _high_water) {
+            _high_water = used;
+        }
+    }
+
+    if (msg_type != LOG_DSTATS_MSG && 
+        hal.scheduler->millis() - _last_stats_ms >= DATAFLASH_STATS_INTERVAL_MS) {
+        _write_stats();
+    }
+}
+
+/*
+  records that are never dropped to make buffer space for others
+ */
+bool DataFlash_File::_critical_type(uint8_t msg_type) const
+{
+    return _log_priority(msg_type) == LOG_PRIORITY_CRITICAL;
+}
+
+/*
+  how full the write buffer is
+ */
+uint8_t DataFlash_File::buffer_used_percent(void) const
+{
+    uint16_t size = _writebuf.size();
+    if (size == 0) {
+        return 0;
+    }
+    return (uint32_t)_writebuf.available() * 100 / size;
+}
+
+/*
+  write a DSTATS record, so log analysis can see how much was lost
+ */
+void DataFlash_File::_write_stats(void)
+{
+    uint32_t now = hal.scheduler->millis();
+    uint32_t total = _write_total;
+    uint32_t rate = 0;
+    if (now != _last_stats_ms) {
+        rate = (total - _stats_write_total) * 1000UL / (now - _last_stats_ms);
+    }
+    _stats_write_total = total;
+    _last_stats_ms = now;
+    uint8_t worst = 0;
+    for (uint16_t i=1; i<256; i++) {
+        if (_dropped_by_type[i] > _dropped_by_type[worst]) {
+            worst = i;
         }
     }
+    struct log_DSTATS pkt = {
+        LOG_PACKET_HEADER_INIT(LOG_DSTATS_MSG),
+        time_ms            : _last_stats_ms,
+        buf_size           : _writebuf.size(),
+        high_water         : _high_water,
+        dropped_bytes      : _dropped_bytes,
+        dropped_records    : _dropped_records,
+        worst_type         : worst,
+        worst_type_dropped : _dropped_by_type[worst],
+        write_rate         : rate,
+        write_max_us       : _write_max_us
+    };
+    WriteBlock(&pkt, sizeof(pkt));
+}
+
+/*
+  reserve space for a record directly in the write buffer
+ */
+void *DataFlash_File::ReserveBlock(uint16_t size)
+{
+    if (_write_fd == -1 || !_initialised) {
+        return NULL;
+    }
+    if (_writebuf.space() < size + DATAFLASH_CRITICAL_RESERVE) {
+        // let WriteBlock() account for the drop
+        return NULL;
+    }
+#if DATAFLASH_TIMESTAMPS
+    if (_time_needed()) {
+        // WriteBlock() puts a TIME record first
+        return NULL;
+    }
+#endif
+    uint16_t n;
+    uint8_t *p = _writebuf.writable_span(n);
+    if (n < size) {
+        // not enough contiguous space before the buffer wraps
+        return NULL;
+    }
+    return p;
+}
+
+/*
+  make a reserved record visible to the IO process
+ */
+void DataFlash_File::CommitBlock(uint16_t size)
+{
+    uint16_t n;
+    uint8_t *pkt = _writebuf.writable_span(n);
+    uint8_t msg_type = _msg_type(pkt, size);
+    _index_record(msg_type, size);
+#if DATAFLASH_TIMESTAMPS
+    if (_has_time(msg_type) && size >= sizeof(struct log_Header) + sizeof(uint16_t)) {
+        ((struct log_Time *)pkt)->time_delta = _time_delta(msg_type, pkt);
+    }
+#endif
+    _writebuf.advance_write(size);
+    uint16_t used = _writebuf.available();
+    if (used > _high_water) {
+        _high_water = used;
+    }
 }
 
 /*
@@ -260,6 +470,7 @@ uint16_t DataFlash_File::start_new_log(void)
         int fd = _write_fd;
         _write_fd = -1;
         ::close(fd);
+        _write_index();
     }
 
     uint16_t log_num = find_last_log();
@@ -271,6 +482,23 @@ uint16_t DataFlash_File::start_new_log(void)
         log_num = 1;
     }
     char *fname = _log_file_name(log_num);
+    if (fname == NULL) {
+        return 0xFFFF;
+    }
+    if (_initialised && _prepare_wait()) {
+        // take the file made ahead. A log left from before the
+        // numbers wrapped, or an empty one being reused, is in the way
+        char *next = _next_file_name();
+        if (next != NULL) {
+            if (::rename(next, fname) != 0) {
+                ::unlink(fname);
+                ::rename(next, fname);
+            }
+            free(next);
+        }
+    }
+    _write_offset = 0;
+    _write_max_us = 0;
     _write_fd = ::open(fname, O_WRONLY|O_CREAT|O_TRUNC, 0666);
     free(fname);
     if (_write_fd == -1) {
@@ -278,6 +506,15 @@ uint16_t DataFlash_File::start_new_log(void)
         return 0xFFFF;
     }
 
+    // hold off the first DSTATS record until the FMT records for
+    // this log have gone out
+    _last_stats_ms = hal.scheduler->millis();
+    _stats_write_total = _write_total;
+
+    _log_num = log_num;
+    _index_reset();
+    _start_ms = _last_stats_ms;
+
     // now update lastlog.txt with the new log number
     fname = _lastlog_file_name();
     FILE *f = ::fopen(fname, "w");
@@ -285,6 +522,9 @@ uint16_t DataFlash_File::start_new_log(void)
     fclose(f);    
     free(fname);
 
+    // and get ready for the one after
+    _prepare_request++;
+
     return log_num;
 }
 
@@ -316,7 +556,14 @@ void DataFlash_File::LogReadProcess(uint16_t log_num,
     }
     _read_offset = 0;
     if (start_page != 0) {
-        ::lseek(_read_fd, start_page * DATAFLASH_PAGE_SIZE, SEEK_SET);
+        // start on a record boundary if the index has one nearby
+        uint32_t offset = start_page * DATAFLASH_PAGE_SIZE;
+        uint32_t sync_offset;
+        if (_find_sync(log_num, false, offset, sync_offset)) {
+            offset = sync_offset;
+        }
+        ::lseek(_read_fd, offset, SEEK_SET);
+        _read_offset = offset;
     }
 
     while (true) {
@@ -397,10 +644,18 @@ void DataFlash_File::ListAvailableLogs(AP_HAL::BetterStream *port)
         if (filename != NULL) {
             size = _get_log_size(log_num);
             if (size != 0) {
-                port->printf_P(PSTR("Log %u in %s of size %u\n"), 
+                port->printf_P(PSTR("Log %u in %s of size %u"), 
                                (unsigned)log_num, 
                                filename,
                                (unsigned)size);
+                struct log_index_header hdr;
+                int fd = _open_index(log_num, hdr);
+                if (fd != -1) {
+                    ::close(fd);
+                    port->printf_P(PSTR(", %u seconds"),
+                                   (unsigned)((hdr.end_ms - hdr.start_ms) / 1000));
+                }
+                port->println();
             }
             free(filename);
         }
@@ -409,40 +664,423 @@ void DataFlash_File::ListAvailableLogs(AP_HAL::BetterStream *port)
 }
 
 
+/*
+  a log's size, and the time it was last written to
+ */
+void DataFlash_File::get_log_info(uint16_t log_num, uint32_t &size, uint32_t &time_utc)
+{
+    size = 0;
+    time_utc = 0;
+    char *fname = _log_file_name(log_num);
+    if (fname == NULL) {
+        return;
+    }
+    struct stat st;
+    if (::stat(fname, &st) == 0) {
+        size = st.st_size;
+        time_utc = st.st_mtime;
+    }
+    free(fname);
+}
+
+/*
+  copy log data from the read ahead buffer, or ask the IO process to
+  fill it
+ */
+int16_t DataFlash_File::get_log_data(uint16_t log_num, uint16_t page, uint32_t ofs, uint16_t len, uint8_t *data)
+{
+    if (!_initialised || _xfer_pending) {
+        return -1;
+    }
+    if (_xfer_buf == NULL) {
+        _xfer_buf = new uint8_t[DATAFLASH_XFER_BUFSIZE];
+        if (_xfer_buf == NULL) {
+            return 0;
+        }
+    }
+
+    if (log_num != _xfer_log_num) {
+        _xfer_close();
+        char *fname = _log_file_name(log_num);
+        if (fname == NULL) {
+            return 0;
+        }
+        _xfer_fd = ::open(fname, O_RDONLY);
+        free(fname);
+        if (_xfer_fd == -1) {
+            return 0;
+        }
+        _xfer_log_num = log_num;
+    } else if (ofs >= _xfer_ofs && ofs - _xfer_ofs < _xfer_len) {
+        uint16_t n = min(len, _xfer_ofs + _xfer_len - ofs);
+        memcpy(data, &_xfer_buf[ofs - _xfer_ofs], n);
+        return n;
+    } else if (ofs == _xfer_ofs) {
+        // the last read ahead found nothing there
+        return 0;
+    }
+
+    _xfer_ofs = ofs;
+    _xfer_len = 0;
+    _xfer_pending = true;
+    return -1;
+}
+
+/*
+  close the log being transferred, once the IO process is done with it
+ */
+void DataFlash_File::_xfer_close(void)
+{
+    for (uint8_t i=0; i<100 && _xfer_pending; i++) {
+        hal.scheduler->delay(1);
+    }
+    if (_xfer_fd != -1) {
+        ::close(_xfer_fd);
+        _xfer_fd = -1;
+    }
+    _xfer_log_num = 0;
+    _xfer_pending = false;
+}
+
+/*
+  set the retention limits, and apply them now rather than at the
+  next log
+ */
+void DataFlash_File::set_retention(uint16_t max_logs, uint16_t max_mb)
+{
+    if (max_logs == _retain_logs && max_mb == _retain_mb) {
+        return;
+    }
+    _prepare_wait();
+    _retain_logs = max_logs;
+    _retain_mb = max_mb;
+    _prepare_request++;
+}
+
+/*
+  wait for the IO process to finish preparing for the next log,
+  returning false if it is taking too long
+ */
+bool DataFlash_File::_prepare_wait(void)
+{
+    for (uint8_t i=0; i<DATAFLASH_PREPARE_WAIT_MS && _prepare_done != _prepare_request; i++) {
+        hal.scheduler->delay(1);
+    }
+    return _prepare_done == _prepare_request;
+}
+
+/*
+  one step of preparing for the next log, called by the IO process.
+  Each step makes at most one change to the directory, so the log
+  writes are not held up for long
+ */
+void DataFlash_File::_prepare_update(void)
+{
+    switch (_prep_state) {
+    case PREPARE_START:
+        _prep_request = _prepare_request;
+        _prep_last = find_last_log();
+        _prep_log = _prep_last;
+        _prep_count = 0;
+        _prep_bytes = 0;
+        _prep_reserve = 0;
+        _prep_state = (_retain_logs != 0 || _retain_mb != 0) ? PREPARE_SCAN : PREPARE_CREATE;
+        break;
+
+    case PREPARE_SCAN: {
+        // count back from the newest log to the first that is over
+        // the limits
+        uint32_t size = _get_log_size(_prep_log);
+        bool writing = (_write_fd != -1 && _prep_log == _log_num);
+        if (_prep_log == 0 || (size == 0 && !writing)) {
+            _prep_state = PREPARE_CREATE;
+            break;
+        }
+        if (_prep_reserve == 0 && !writing) {
+            _prep_reserve = size;
+        }
+        _prep_count++;
+        _prep_bytes += size;
+        if (_prep_log != _prep_last && !writing &&
+            ((_retain_logs != 0 && _prep_count > _retain_logs) ||
+             (_retain_mb != 0 && (_prep_bytes + _prep_reserve) >> 20 >= _retain_mb))) {
+            _prep_state = PREPARE_DELETE;
+            break;
+        }
+        _prep_log--;
+        break;
+    }
+
+    case PREPARE_DELETE: {
+        // delete from there down to the oldest log
+        char *fname = _index_file_name(_prep_log);
+        if (fname != NULL) {
+            ::unlink(fname);
+            free(fname);
+        }
+        fname = _log_file_name(_prep_log);
+        if (fname == NULL || ::unlink(fname) != 0 || --_prep_log == 0) {
+            _prep_state = PREPARE_CREATE;
+        }
+        free(fname);
+        break;
+    }
+
+    case PREPARE_CREATE: {
+        char *fname = _next_file_name();
+        if (fname != NULL) {
+            int fd = ::open(fname, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+            if (fd != -1) {
+                ::close(fd);
+            }
+            free(fname);
+        }
+        _prep_state = PREPARE_START;
+        _prepare_done = _prep_request;
+        break;
+    }
+    }
+}
+
+/*
+  start a fresh index for a new log
+ */
+void DataFlash_File::_index_reset(void)
+{
+    _log_offset = 0;
+    _fmt_end = 0;
+    _start_ms = 0;
+    memset(_count_by_type, 0, sizeof(_count_by_type));
+    memset(_first_by_type, 0, sizeof(_first_by_type));
+    _num_syncs = 0;
+    _sync_interval_ms = DATAFLASH_INDEX_SYNC_INTERVAL_MS;
+}
+
+/*
+  note a record that has been accepted into the write buffer
+ */
+void DataFlash_File::_index_record(uint8_t msg_type, uint16_t size)
+{
+    if (msg_type != 0) {
+        if (_count_by_type[msg_type] == 0) {
+            _first_by_type[msg_type] = _log_offset;
+        }
+        _count_by_type[msg_type]++;
+        if (msg_type == LOG_FORMAT_MSG) {
+            _fmt_end = _log_offset + size;
+        }
+        uint32_t now = hal.scheduler->millis();
+        if (_syncs != NULL &&
+            (_num_syncs == 0 ||
+             now - _syncs[_num_syncs-1].time_ms >= _sync_interval_ms)) {
+            if (_num_syncs == DATAFLASH_INDEX_MAX_SYNCS) {
+                // keep every other marker
+                for (uint16_t i=0; i<DATAFLASH_INDEX_MAX_SYNCS/2; i++) {
+                    _syncs[i] = _syncs[i*2];
+                }
+                _num_syncs = DATAFLASH_INDEX_MAX_SYNCS/2;
+                _sync_interval_ms *= 2;
+            }
+            _syncs[_num_syncs].time_ms = now;
+            _syncs[_num_syncs].offset = _log_offset;
+            _num_syncs++;
+        }
+    }
+    _log_offset += size;
+}
+
+/*
+  write the index for the log just closed
+ */
+void DataFlash_File::_write_index(void)
+{
+    if (_log_num == 0) {
+        return;
+    }
+    char *fname = _index_file_name(_log_num);
+    if (fname == NULL) {
+        return;
+    }
+    int fd = ::open(fname, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    free(fname);
+    if (fd == -1) {
+        return;
+    }
+    struct log_index_header hdr;
+    hdr.magic     = DATAFLASH_INDEX_MAGIC;
+    hdr.version   = DATAFLASH_INDEX_VERSION;
+    hdr.num_types = 0;
+    hdr.num_syncs = _num_syncs;
+    hdr.log_size  = _log_offset;
+    hdr.fmt_end   = _fmt_end;
+    hdr.start_ms  = _start_ms;
+    hdr.end_ms    = hal.scheduler->millis();
+    for (uint16_t i=1; i<256; i++) {
+        if (_count_by_type[i] != 0) {
+            hdr.num_types++;
+        }
+    }
+    ::write(fd, &hdr, sizeof(hdr));
+    for (uint16_t i=1; i<256; i++) {
+        if (_count_by_type[i] != 0) {
+            struct log_index_type t;
+            t.msg_type     = i;
+            t.count        = _count_by_type[i];
+            t.first_offset = _first_by_type[i];
+            ::write(fd, &t, sizeof(t));
+        }
+    }
+    if (_num_syncs != 0) {
+        ::write(fd, _syncs, _num_syncs * sizeof(_syncs[0]));
+    }
+    ::close(fd);
+}
+
+/*
+  open the index for a log and read its header. Returns the file
+  descriptor positioned at the type table, or -1
+ */
+int DataFlash_File::_open_index(uint16_t log_num, struct log_index_header &hdr)
+{
+    char *fname = _index_file_name(log_num);
+    if (fname == NULL) {
+        return -1;
+    }
+    int fd = ::open(fname, O_RDONLY);
+    free(fname);
+    if (fd == -1) {
+        return -1;
+    }
+    if (::read(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+        hdr.magic != DATAFLASH_INDEX_MAGIC ||
+        hdr.version != DATAFLASH_INDEX_VERSION) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+  find the offset of a record logged at or just before time_ms
+ */
+bool DataFlash_File::find_log_time(uint16_t log_num, uint32_t time_ms, uint32_t &offset)
+{
+    return _find_sync(log_num, true, time_ms, offset);
+}
+
+/*
+  find the latest time sync marker at or before a time (by_time) or a
+  file offset. Falls back to the start of the log
+ */
+bool DataFlash_File::_find_sync(uint16_t log_num, bool by_time, uint32_t value, uint32_t &offset)
+{
+    struct log_index_header hdr;
+    int fd = _open_index(log_num, hdr);
+    if (fd == -1) {
+        return false;
+    }
+    ::lseek(fd, hdr.num_types * sizeof(struct log_index_type), SEEK_CUR);
+    offset = 0;
+    for (uint16_t i=0; i<hdr.num_syncs; i++) {
+        struct log_index_sync sync;
+        if (::read(fd, &sync, sizeof(sync)) != sizeof(sync) ||
+            (by_time ? sync.time_ms : sync.offset) > value) {
+            break;
+        }
+        offset = sync.offset;
+    }
+    ::close(fd);
+    return true;
+}
+
+/*
+  get the number of records of a type in a log, and where the first
+  one is
+ */
+bool DataFlash_File::find_log_type(uint16_t log_num, uint8_t msg_type, uint32_t &count, uint32_t &first_offset)
+{
+    struct log_index_header hdr;
+    int fd = _open_index(log_num, hdr);
+    if (fd == -1) {
+        return false;
+    }
+    count = 0;
+    first_offset = 0;
+    for (uint16_t i=0; i<hdr.num_types; i++) {
+        struct log_index_type t;
+        if (::read(fd, &t, sizeof(t)) != sizeof(t)) {
+            break;
+        }
+        if (t.msg_type == msg_type) {
+            count = t.count;
+            first_offset = t.first_offset;
+            break;
+        }
+    }
+    ::close(fd);
+    return true;
+}
+
 void DataFlash_File::_io_timer(uint32_t tnow)
 {
-    uint16_t _tail;
+    if (_xfer_pending) {
+        ssize_t n = -1;
+        if (::lseek(_xfer_fd, _xfer_ofs, SEEK_SET) == (off_t)_xfer_ofs) {
+            n = ::read(_xfer_fd, _xfer_buf, DATAFLASH_XFER_BUFSIZE);
+        }
+        _xfer_len = n > 0 ? n : 0;
+        _xfer_pending = false;
+    }
+
+    if (_instance != NULL && _initialised && _prepare_done != _prepare_request) {
+        _instance->_prepare_update();
+    }
+
     if (_write_fd == -1 || !_initialised) {
         return;
     }
-    uint16_t nbytes = BUF_AVAILABLE(_writebuf);
+    uint16_t nbytes = _writebuf.available();
     if (nbytes == 0) {
         return;
     }
-    if (nbytes < 512 && 
-        tnow - _last_write_time < 2000000UL) {
-        // write in 512 byte chunks, but always write at least once
-        // per 2 seconds if data is available
+    // write up to the end of the file's current sector, which is a
+    // whole sector unless the last write was cut short by the timeout
+    uint16_t to_boundary = DATAFLASH_SECTOR_SIZE - (_write_offset % DATAFLASH_SECTOR_SIZE);
+    if (nbytes < to_boundary &&
+        tnow - _last_write_time < DATAFLASH_WRITE_TIMEOUT_US) {
         return;
     }
     _last_write_time = tnow;
-    if (nbytes > 512) {
-        // be kind to the FAT PX4 filesystem
-        nbytes = 512;
+    if (nbytes > to_boundary) {
+        nbytes = to_boundary;
     }
-    if (_writebuf_head > _tail) {
-        // only write to the end of the buffer
-        nbytes = min(nbytes, _writebuf_size - _writebuf_head);
+    uint16_t n;
+    const uint8_t *p = _writebuf.readable_span(n);
+    if (n < nbytes) {
+        // the sector wraps around the end of the buffer
+        nbytes = _writebuf.peek(_sector_buf, nbytes);
+        p = _sector_buf;
     }
-    assert(_writebuf_head+nbytes <= _writebuf_size);
-    ssize_t nwritten = ::write(_write_fd, &_writebuf[_writebuf_head], nbytes);
+    uint32_t t0 = hal.scheduler->micros();
+    ssize_t nwritten = ::write(_write_fd, p, nbytes);
     if (nwritten <= 0) {
         close(_write_fd);
         _write_fd = -1;
         _initialised = false;
-    } else {
+        return;
+    }
+    _writebuf.advance_read(nwritten);
+    _write_offset += nwritten;
+    _write_total += nwritten;
+    if (tnow - _last_sync_time >= DATAFLASH_FSYNC_INTERVAL_US) {
         ::fsync(_write_fd);
-        BUF_ADVANCEHEAD(_writebuf, nwritten);
+        _last_sync_time = tnow;
+    }
+
+    // a batched fsync counts towards the write it followed
+    uint32_t dt = hal.scheduler->micros() - t0;
+    if (dt > _write_max_us) {
+        _write_max_us = dt;
     }
 }
 
@@ -14,7 +14,7 @@ class DataFlash_File : public DataFlash_Class
 {
 public:
     // constructor
-    DataFlash_File(const char *log_directory);
+    DataFlash_File(const char *log_directory, uint16_t buffer_size=4096);
 
     // initialisation
     void Init(void);
@@ -26,6 +26,10 @@ public:
 
     /* Write a block of data at current offset */
     void WriteBlock(const void *pBuffer, uint16_t size);
+    void *ReserveBlock(uint16_t size);
+    void CommitBlock(uint16_t size);
+    uint8_t buffer_used_percent(void) const;
+    void set_retention(uint16_t max_logs, uint16_t max_mb);
 
     // high level interface
     uint16_t find_last_log(void);
@@ -41,6 +45,23 @@ public:
     void DumpPageInfo(AP_HAL::BetterStream *port);
     void ShowDeviceInfo(AP_HAL::BetterStream *port);
     void ListAvailableLogs(AP_HAL::BetterStream *port);
+    void get_log_info(uint16_t log_num, uint32_t &size, uint32_t &time_utc);
+    int16_t get_log_data(uint16_t log_num, uint16_t page, uint32_t ofs, uint16_t len, uint8_t *data);
+
+    // write buffer statistics, for post-flight checks of how
+    // complete the log is
+    uint16_t buffer_high_water(void) const { return _high_water; }
+    uint32_t dropped_bytes(void) const { return _dropped_bytes; }
+    uint16_t dropped_records(void) const { return _dropped_records; }
+    uint16_t dropped_records(uint8_t msg_type) const { return _dropped_by_type[msg_type]; }
+
+    /*
+      lookups in the index written alongside each closed log. These
+      return false if the log has no index, in which case the log
+      has to be scanned
+     */
+    bool find_log_time(uint16_t log_num, uint32_t time_ms, uint32_t &offset);
+    bool find_log_type(uint16_t log_num, uint8_t msg_type, uint32_t &count, uint32_t &first_offset);
 
 private:
     static int _write_fd;
@@ -54,12 +75,23 @@ private:
     */
     void ReadBlock(void *pkt, uint16_t size);
 
-    // write buffer
-    static uint8_t *_writebuf;
-    static const uint16_t _writebuf_size;
-    static volatile uint16_t _writebuf_head;
-    static volatile uint16_t _writebuf_tail;
+    // write buffer, filled by WriteBlock() and drained by the IO
+    // process
+    static RingBuffer<uint8_t> _writebuf;
+    static uint16_t _writebuf_size;
     static uint32_t _last_write_time;
+    static uint32_t _last_sync_time;
+
+    // the IO process's offset in the log file, and a sector sized
+    // copy for writes that wrap round the end of the write buffer
+    static uint32_t _write_offset;
+    static uint8_t _sector_buf[];
+
+    // write statistics for the DSTATS record. The IO process counts
+    // the bytes written and the slowest write of the log
+    static volatile uint32_t _write_total;
+    static volatile uint32_t _write_max_us;
+    uint32_t _stats_write_total;
 
     /* construct a file name given a log number. Caller must free. */
     char *_log_file_name(uint16_t log_num);
@@ -67,6 +99,108 @@ private:
     uint32_t _get_log_size(uint16_t log_num);
 
     static void _io_timer(uint32_t now);
+
+    /*
+      log transfer read ahead. The main thread opens the log and asks
+      for an offset by setting _xfer_pending, then the IO process
+      reads the data into _xfer_buf and clears it, so the main thread
+      never waits on the card. Each side only touches the buffer
+      while the flag is its own
+     */
+    uint16_t _xfer_log_num;
+    static int _xfer_fd;
+    static uint8_t *_xfer_buf;
+    static uint32_t _xfer_ofs;
+    static uint16_t _xfer_len;
+    static volatile bool _xfer_pending;
+    void _xfer_close(void);
+
+    /*
+      log retention. Each time a log starts the main thread bumps
+      _prepare_request, then the IO process deletes the oldest logs
+      over the limits, leaving room for the new log to grow to the
+      size of the one before, and creates the empty file that the
+      next log is renamed from, so starting it doesn't search the
+      directory for a free entry. It then sets _prepare_done to
+      match. The main thread leaves the log files alone until then.
+      The newest log and the one being written are never deleted
+     */
+    static DataFlash_File *_instance;
+    uint16_t _retain_logs;
+    uint16_t _retain_mb;
+    static volatile uint8_t _prepare_request;
+    static volatile uint8_t _prepare_done;
+    enum prepare_state {
+        PREPARE_START,
+        PREPARE_SCAN,
+        PREPARE_DELETE,
+        PREPARE_CREATE
+    };
+    enum prepare_state _prep_state;
+    uint8_t _prep_request;
+    uint16_t _prep_last;
+    uint16_t _prep_log;
+    uint16_t _prep_count;
+    uint32_t _prep_bytes;
+    uint32_t _prep_reserve;
+
+    char *_next_file_name(void);
+    bool _prepare_wait(void);
+    void _prepare_update(void);
+
+    // drop accounting, all updated from the main thread only
+    uint16_t _high_water;
+    uint32_t _dropped_bytes;
+    uint16_t _dropped_records;
+    uint16_t _dropped_by_type[256];
+    uint32_t _last_stats_ms;
+
+    bool _critical_type(uint8_t msg_type) const;
+    void _write_stats(void);
+
+    /*
+      index of the log being written, saved to NN.idx when the log
+      is closed. Offsets count the bytes accepted into the write
+      buffer since the log was opened. Time sync markers are kept at
+      a fixed count by halving them and doubling the interval when
+      the table fills
+     */
+    struct PACKED log_index_header {
+        uint32_t magic;
+        uint8_t  version;
+        uint8_t  num_types;
+        uint16_t num_syncs;
+        uint32_t log_size;
+        uint32_t fmt_end;
+        uint32_t start_ms;
+        uint32_t end_ms;
+    };
+    struct PACKED log_index_type {
+        uint8_t  msg_type;
+        uint32_t count;
+        uint32_t first_offset;
+    };
+    struct PACKED log_index_sync {
+        uint32_t time_ms;
+        uint32_t offset;
+    };
+
+    uint16_t _log_num;
+    uint32_t _log_offset;
+    uint32_t _fmt_end;
+    uint32_t _start_ms;
+    uint32_t _count_by_type[256];
+    uint32_t _first_by_type[256];
+    struct log_index_sync *_syncs;
+    uint16_t _num_syncs;
+    uint32_t _sync_interval_ms;
+
+    char *_index_file_name(uint16_t log_num);
+    void _index_reset(void);
+    void _index_record(uint8_t msg_type, uint16_t size);
+    void _write_index(void);
+    int _open_index(uint16_t log_num, struct log_index_header &hdr);
+    bool _find_sync(uint16_t log_num, bool by_time, uint32_t value, uint32_t &offset);
 };
 
 
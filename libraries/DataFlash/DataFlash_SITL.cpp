@@ -13,28 +13,53 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <stdint.h>
+#include <sys/mman.h>
 #include "DataFlash.h"
 
 #define DF_PAGE_SIZE 512
 #define DF_NUM_PAGES 4096
 
+// the AT45DB takes a few milliseconds to program a page, so the
+// simulated chip is busy as long, to exercise the page pipeline
+#define DF_PAGE_PROGRAM_US 3000
+
 extern const AP_HAL::HAL& hal;
 
-static int flash_fd;
+// pages and erase blocks are numbered from 1, so the config page and
+// the last block of 8 pages lie past DF_NUM_PAGES pages
+#define DF_FLASH_SIZE (DF_PAGE_SIZE*(DF_NUM_PAGES+8))
+
+// the flash image, mapped from dataflash.bin so that page transfers
+// and erases are plain memory operations
+static uint8_t *flash;
 static uint8_t buffer[2][DF_PAGE_SIZE];
+static uint32_t busy_start_us;
 
 // Public Methods //////////////////////////////////////////////////////////////
 void DataFlash_SITL::Init(void)
 {
-	if (flash_fd == 0) {
-		flash_fd = open("dataflash.bin", O_RDWR, 0777);
-		if (flash_fd == -1) {
-			uint8_t *fill;
-			fill = (uint8_t *)malloc(DF_PAGE_SIZE*DF_NUM_PAGES);
-			flash_fd = open("dataflash.bin", O_RDWR | O_CREAT, 0777);
-			memset(fill, 0xFF, DF_PAGE_SIZE*DF_NUM_PAGES);
-			write(flash_fd, fill, DF_PAGE_SIZE*DF_NUM_PAGES);
-			free(fill);
+	if (flash == NULL) {
+		int fd = open("dataflash.bin", O_RDWR | O_CREAT, 0777);
+		if (fd == -1) {
+			hal.scheduler->panic(PSTR("Failed to open dataflash.bin"));
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			st.st_size = 0;
+		}
+		if (st.st_size != DF_FLASH_SIZE && ftruncate(fd, DF_FLASH_SIZE) != 0) {
+			hal.scheduler->panic(PSTR("Failed to size dataflash.bin"));
+		}
+		void *p = mmap(NULL, DF_FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		// the mapping keeps the file open
+		close(fd);
+		if (p == MAP_FAILED) {
+			hal.scheduler->panic(PSTR("Failed to map dataflash.bin"));
+		}
+		flash = (uint8_t *)p;
+		if (st.st_size < DF_FLASH_SIZE) {
+			// erased flash reads as 0xFF
+			memset(&flash[st.st_size], 0xFF, DF_FLASH_SIZE - st.st_size);
 		}
 	}
 	df_PageSize = DF_PAGE_SIZE;
@@ -65,7 +90,7 @@ uint8_t DataFlash_SITL::ReadStatusReg()
 inline
 uint8_t DataFlash_SITL::ReadStatus()
 {
-	return 1;
+	return hal.scheduler->micros() - busy_start_us >= DF_PAGE_PROGRAM_US;
 }
 
 
@@ -84,12 +109,16 @@ void DataFlash_SITL::WaitReady()
 
 void DataFlash_SITL::PageToBuffer(unsigned char BufferNum, uint16_t PageAdr)
 {
-	pread(flash_fd, buffer[BufferNum], DF_PAGE_SIZE, PageAdr*DF_PAGE_SIZE);
+	memcpy(buffer[BufferNum], &flash[PageAdr*DF_PAGE_SIZE], DF_PAGE_SIZE);
 }
 
 void DataFlash_SITL::BufferToPage (unsigned char BufferNum, uint16_t PageAdr, unsigned char wait)
 {
-	pwrite(flash_fd, buffer[BufferNum], DF_PAGE_SIZE, PageAdr*DF_PAGE_SIZE);
+	memcpy(&flash[PageAdr*DF_PAGE_SIZE], buffer[BufferNum], DF_PAGE_SIZE);
+	busy_start_us = hal.scheduler->micros();
+	if (wait) {
+		WaitReady();
+	}
 }
 
 void DataFlash_SITL::BufferWrite (unsigned char BufferNum, uint16_t IntPageAdr, unsigned char Data)
@@ -111,6 +140,11 @@ void DataFlash_SITL::BlockWrite(uint8_t BufferNum, uint16_t IntPageAdr,
            size);
 }
 
+uint8_t *DataFlash_SITL::BufferPointer(uint8_t BufferNum, uint16_t IntPageAdr)
+{
+    return &buffer[BufferNum][IntPageAdr];
+}
+
 unsigned char DataFlash_SITL::BufferRead (unsigned char BufferNum, uint16_t IntPageAdr)
 {
 	return (unsigned char)buffer[BufferNum][IntPageAdr];
@@ -126,29 +160,33 @@ bool DataFlash_SITL::BlockRead(uint8_t BufferNum, uint16_t IntPageAdr, void *pBu
 }
 
 
+bool DataFlash_SITL::ArrayRead(uint16_t PageAdr, uint16_t IntPageAdr, void *pBuffer, uint16_t size)
+{
+	memcpy(pBuffer, &flash[PageAdr*DF_PAGE_SIZE + IntPageAdr], size);
+	return true;
+}
+
 // *** END OF INTERNAL FUNCTIONS ***
 
 void DataFlash_SITL::PageErase (uint16_t PageAdr)
 {
-	uint8_t fill[DF_PAGE_SIZE];
-	memset(fill, 0xFF, sizeof(fill));
-	pwrite(flash_fd, fill, DF_PAGE_SIZE, PageAdr*DF_PAGE_SIZE);
+	memset(&flash[PageAdr*DF_PAGE_SIZE], 0xFF, DF_PAGE_SIZE);
 }
 
 void DataFlash_SITL::BlockErase (uint16_t BlockAdr)
 {
-	uint8_t fill[DF_PAGE_SIZE*8];
-	memset(fill, 0xFF, sizeof(fill));
-	pwrite(flash_fd, fill, DF_PAGE_SIZE*8, BlockAdr*DF_PAGE_SIZE*8);
+	memset(&flash[BlockAdr*DF_PAGE_SIZE*8], 0xFF, DF_PAGE_SIZE*8);
 }
 
 
 void DataFlash_SITL::ChipErase()
 {
-	for (int i=0; i<DF_NUM_PAGES; i++) {
-		PageErase(i);
-        hal.scheduler->delay(1);
-	}
+	memset(flash, 0xFF, DF_FLASH_SIZE);
+}
+
+void DataFlash_SITL::FlushLog(void)
+{
+	msync(flash, DF_FLASH_SIZE, MS_ASYNC);
 }
 
 
@@ -37,7 +37,14 @@ private:
     // the data fits within the page, otherwise it will wrap to the
     // start of the page
     bool 		    BlockRead(uint8_t BufferNum, uint16_t IntPageAdr, void *pBuffer, uint16_t size);
-    
+    bool            ArrayRead(uint16_t PageAdr, uint16_t IntPageAdr, void *pBuffer, uint16_t size);
+
+    // the SITL page buffers are plain memory
+    uint8_t          *BufferPointer(uint8_t BufferNum, uint16_t IntPageAdr);
+
+    // the flash image is mapped, so only needs syncing at a log's end
+    void              FlushLog(void);
+
     AP_HAL::SPIDeviceDriver *_spi;
     AP_HAL::Semaphore *_spi_sem;
 public:
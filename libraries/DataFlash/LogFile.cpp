@@ -16,6 +16,11 @@ uint16_t DataFlash_Block::get_num_logs(void)
     uint16_t last;
     uint16_t first;
 
+    if (_erase_block != 0) {
+        // the blocks not yet erased still hold the old logs
+        return log_write_started ? 1 : 0;
+    }
+
     if (find_last_page() == 1) {
         return 0;
     }
@@ -47,8 +52,32 @@ uint16_t DataFlash_Block::get_num_logs(void)
 // This function starts a new log file in the DataFlash
 uint16_t DataFlash_Block::start_new_log(void)
 {
+    if (_erase_block != 0) {
+        // a background erase is running, so the only log is the one
+        // from page 1. Carry on with it if it has been started
+        if (!log_write_started) {
+            if (_delta != NULL) {
+                memset(_delta, 0, sizeof(*_delta));
+            }
+            SetFileNumber(1);
+            StartWrite(1);
+            log_write_started = true;
+        }
+        return df_FileNumber;
+    }
+
+    if (log_write_started) {
+        // the log being written is closed by starting the next
+        FlushLog();
+    }
+
     uint16_t last_page = find_last_page();
 
+    if (_delta != NULL) {
+        // start each log without references, as the reader does
+        memset(_delta, 0, sizeof(*_delta));
+    }
+
     StartRead(last_page);
     //Serial.print("last page: ");	Serial.println(last_page);
     //Serial.print("file #: ");	Serial.println(GetFileNumber());
@@ -94,6 +123,12 @@ void DataFlash_Block::get_log_boundaries(uint16_t log_num, uint16_t & start_page
         FinishWrite();
     }
 
+    if (_erase_block != 0) {
+        start_page = 1;
+        end_page = df_PageAdr > 1 ? df_PageAdr - 1 : 1;
+        return;
+    }
+
     if(num == 1)
     {
         StartRead(df_NumPages);
@@ -135,6 +170,60 @@ void DataFlash_Block::get_log_boundaries(uint16_t log_num, uint16_t & start_page
     }
 }
 
+/*
+  the size of a log is all of its pages less their headers, so it
+  includes the unused end of the last page. The boards with block
+  logs have no clock, so there is no time
+ */
+void DataFlash_Block::get_log_info(uint16_t log_num, uint32_t &size, uint32_t &time_utc)
+{
+    uint16_t start_page, end_page, num_pages;
+
+    get_log_boundaries(log_num, start_page, end_page);
+    if (end_page >= start_page) {
+        num_pages = end_page - start_page + 1;
+    } else {
+        // the log wraps around the end of the chip
+        num_pages = (df_NumPages - start_page + 1) + end_page;
+    }
+    size = num_pages * (uint32_t)(df_PageSize - sizeof(struct PageHeader));
+    time_utc = 0;
+}
+
+/*
+  read log data for a transfer. This reads the flash directly, so it
+  can be used while logging, and doesn't move the read position used
+  by LogReadProcess()
+ */
+int16_t DataFlash_Block::get_log_data(uint16_t log_num, uint16_t page, uint32_t ofs, uint16_t len, uint8_t *data)
+{
+    uint16_t data_page_size = df_PageSize - sizeof(struct PageHeader);
+    uint32_t page_adr = page + ofs / data_page_size;
+    uint16_t idx = sizeof(struct PageHeader) + ofs % data_page_size;
+
+    if (page_adr > df_NumPages) {
+        page_adr -= df_NumPages;
+        if (page_adr > df_NumPages) {
+            return 0;
+        }
+    }
+
+    _page_flush();
+
+    // the log ends at the first page of another log
+    struct PageHeader ph;
+    ArrayRead(page_adr, 0, &ph, sizeof(ph));
+    if (ph.FileNumber != log_num) {
+        return 0;
+    }
+
+    if (len > df_PageSize - idx) {
+        len = df_PageSize - idx;
+    }
+    ArrayRead(page_adr, idx, data, len);
+    return len;
+}
+
 bool DataFlash_Block::check_wrapped(void)
 {
     StartRead(df_NumPages);
@@ -148,6 +237,9 @@ bool DataFlash_Block::check_wrapped(void)
 // This funciton finds the last log number
 uint16_t DataFlash_Block::find_last_log(void)
 {
+    if (_erase_block != 0) {
+        return log_write_started ? df_FileNumber : 0;
+    }
     uint16_t last_page = find_last_page();
     StartRead(last_page);
     return GetFileNumber();
@@ -258,22 +350,58 @@ void DataFlash_Class::_print_log_entry(uint8_t msg_type,
                                        void (*print_mode)(AP_HAL::BetterStream *port, uint8_t mode),
                                        AP_HAL::BetterStream *port)
 {
-    uint8_t i;
-    for (i=0; i<num_types; i++) {
-        if (msg_type == PGM_UINT8(&structure[i].msg_type)) {
-            break;
-        }
-    }
-    if (i == num_types) {
+    const struct LogStructure *s = _find_structure(msg_type, num_types, structure);
+    if (s == NULL) {
         port->printf_P(PSTR("UNKN, %u\n"), (unsigned)msg_type);
         return;
     }
-    uint8_t msg_len = PGM_UINT8(&structure[i].msg_len) - 3;
+    uint8_t msg_len = PGM_UINT8(&s->msg_len) - 3;
     uint8_t pkt[msg_len];
     ReadBlock(pkt, msg_len);
-    port->printf_P(PSTR("%S, "), structure[i].name);
-    for (uint8_t ofs=0, fmt_ofs=0; ofs<msg_len; fmt_ofs++) {
-        char fmt = PGM_UINT8(&structure[i].format[fmt_ofs]);
+    _print_log_packet(s, pkt, msg_len, print_mode, port);
+}
+
+/*
+  find the structure for a message type, or NULL
+ */
+const struct LogStructure *DataFlash_Class::_find_structure(uint8_t msg_type,
+                                                            uint8_t num_types,
+                                                            const struct LogStructure *structure)
+{
+    for (uint8_t i=0; i<num_types; i++) {
+        if (msg_type == PGM_UINT8(&structure[i].msg_type)) {
+            return &structure[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+  print the body of a log entry, minus its header bytes
+ */
+void DataFlash_Class::_print_log_packet(const struct LogStructure *s,
+                                        const uint8_t *pkt, uint8_t msg_len,
+                                        void (*print_mode)(AP_HAL::BetterStream *port, uint8_t mode),
+                                        AP_HAL::BetterStream *port)
+{
+    port->printf_P(PSTR("%S, "), s->name);
+    uint8_t msg_type = PGM_UINT8(&s->msg_type);
+    uint8_t start = 0;
+    if (_has_time(msg_type) && msg_len >= sizeof(uint16_t)) {
+        // print the time of the record first, from the delta in its
+        // header or the TIME record itself
+        uint16_t delta;
+        memcpy(&delta, pkt, sizeof(delta));
+        start = sizeof(delta);
+        if (msg_type == LOG_TIME_MSG && msg_len >= start + sizeof(uint32_t)) {
+            memcpy(&_print_time_us, &pkt[start], sizeof(_print_time_us));
+        } else {
+            _print_time_us += delta;
+        }
+        port->printf_P(PSTR("%lu, "), (unsigned long)_print_time_us);
+    }
+    for (uint8_t ofs=start, fmt_ofs=0; ofs<msg_len; fmt_ofs++) {
+        char fmt = PGM_UINT8(&s->format[fmt_ofs]);
         switch (fmt) {
         case 'b': {
             port->printf_P(PSTR("%d"), (int)pkt[ofs]);
@@ -379,6 +507,15 @@ void DataFlash_Class::_print_log_entry(uint8_t msg_type,
             ofs += sizeof(v)-1;
             break;
         }
+        case 'a': {
+            for (uint8_t i=0; i<LOG_ARRAY_VALUES; i++) {
+                int16_t v;
+                memcpy(&v, &pkt[ofs], sizeof(v));
+                port->printf_P(i == 0 ? PSTR("%d") : PSTR(" %d"), (int)v);
+                ofs += sizeof(v);
+            }
+            break;
+        }
         case 'M': {
             print_mode(port, pkt[ofs]);
             ofs += 1;
@@ -407,11 +544,19 @@ void DataFlash_Block::LogReadProcess(uint16_t log_num,
 {
     uint8_t log_step = 0;
     uint16_t page = start_page;
+    bool delta = false;
 
     if (df_BufferIdx != 0) {
         FinishWrite();
     }
 
+    // references for decoding delta records. If this can't be
+    // allocated the delta records are skipped
+    struct DeltaState *st = new DeltaState;
+    if (st != NULL) {
+        memset(st, 0, sizeof(*st));
+    }
+
     StartRead(start_page);
 
 	while (true) {
@@ -427,7 +572,8 @@ void DataFlash_Block::LogReadProcess(uint16_t log_num,
 				break;
 
 			case 1:
-				if (data == HEAD_BYTE2) {
+				if (data == HEAD_BYTE2 || data == HEAD_BYTE2_DELTA) {
+                    delta = (data == HEAD_BYTE2_DELTA);
 					log_step++;
                 } else {
 					log_step = 0;
@@ -436,17 +582,89 @@ void DataFlash_Block::LogReadProcess(uint16_t log_num,
 
 			case 2:
 				log_step = 0;
-                _print_log_entry(data, num_types, structure, print_mode, port);
+                if (delta) {
+                    _print_delta_entry(st, data, num_types, structure, print_mode, port);
+                } else {
+                    _print_plain_entry(st, data, num_types, structure, print_mode, port);
+                }
                 break;
 		}
         uint16_t new_page = GetPage();
         if (new_page != page) {
             if (new_page == end_page || new_page == start_page) {
-                return;
+                break;
             }
             page = new_page;
         }
 	}
+    delete st;
+}
+
+/*
+  print a plain record, keeping it as the reference for any delta
+  records of the same type that follow
+ */
+void DataFlash_Block::_print_plain_entry(struct DeltaState *st, uint8_t msg_type,
+                                         uint8_t num_types, const struct LogStructure *structure,
+                                         void (*print_mode)(AP_HAL::BetterStream *port, uint8_t mode),
+                                         AP_HAL::BetterStream *port)
+{
+    const struct LogStructure *s = _find_structure(msg_type, num_types, structure);
+    if (s == NULL) {
+        port->printf_P(PSTR("UNKN, %u\n"), (unsigned)msg_type);
+        return;
+    }
+    uint8_t msg_len = PGM_UINT8(&s->msg_len) - 3;
+    uint8_t pkt[msg_len];
+    ReadBlock(pkt, msg_len);
+    if (st != NULL && msg_len != 0 && msg_len <= DATAFLASH_DELTA_MAX_LEN) {
+        _delta_store(st, _delta_find(st, msg_type), msg_type, pkt, msg_len);
+    }
+    _print_log_packet(s, pkt, msg_len, print_mode, port);
+}
+
+/*
+  decode and print a delta record, see _write_delta()
+ */
+void DataFlash_Block::_print_delta_entry(struct DeltaState *st, uint8_t msg_type,
+                                         uint8_t num_types, const struct LogStructure *structure,
+                                         void (*print_mode)(AP_HAL::BetterStream *port, uint8_t mode),
+                                         AP_HAL::BetterStream *port)
+{
+    const struct LogStructure *s = _find_structure(msg_type, num_types, structure);
+    if (s == NULL) {
+        port->printf_P(PSTR("UNKN, %u\n"), (unsigned)msg_type);
+        return;
+    }
+    uint8_t msg_len = PGM_UINT8(&s->msg_len) - 3;
+    if (msg_len == 0 || msg_len > DATAFLASH_DELTA_MAX_LEN) {
+        port->printf_P(PSTR("UNKN, %u\n"), (unsigned)msg_type);
+        return;
+    }
+    uint8_t bitmap[(DATAFLASH_DELTA_MAX_LEN+7)/8];
+    ReadBlock(bitmap, (msg_len+7)/8);
+    struct DeltaSlot *slot = NULL;
+    if (st != NULL) {
+        slot = _delta_find(st, msg_type);
+    }
+    if (slot != NULL && slot->len != msg_len) {
+        slot = NULL;
+    }
+    uint8_t pkt[msg_len];
+    for (uint8_t i=0; i<msg_len; i++) {
+        uint8_t x = 0;
+        if (bitmap[i/8] & (1U<<(i&7))) {
+            ReadBlock(&x, 1);
+        }
+        pkt[i] = (slot != NULL ? slot->data[i] : 0) ^ x;
+    }
+    if (slot == NULL) {
+        // the reference was lost, skip until the next plain record
+        return;
+    }
+    memcpy(slot->data, pkt, msg_len);
+    slot->count++;
+    _print_log_packet(s, pkt, msg_len, print_mode, port);
 }
 
 /*
@@ -519,6 +737,17 @@ uint16_t DataFlash_Class::StartNewLog(uint8_t num_types, const struct LogStructu
     uint16_t ret;
     ret = start_new_log();
 
+    _setup_rate_limits(num_types, structures);
+
+#if DATAFLASH_TIMESTAMPS
+    // the first timestamped record of the log comes after a TIME
+    _have_record_time = false;
+#endif
+
+#if AP_INERTIAL_SENSOR_RAW_LOG
+    _imu_raw_scale_logged = false;
+#endif
+
     // write log formats so the log is self-describing
     for (uint8_t i=0; i<num_types; i++) {
         Log_Write_Format(&structures[i]);
@@ -531,13 +760,211 @@ uint16_t DataFlash_Class::StartNewLog(uint8_t num_types, const struct LogStructu
     return ret;
 }
 
+/*
+  build the rate limit table from the structure table. Only types
+  with a rate limit or a non-default priority get an entry, to keep
+  the per-write search short
+ */
+void DataFlash_Class::_setup_rate_limits(uint8_t num_types, const struct LogStructure *structures)
+{
+    uint8_t count = 0;
+    for (uint8_t i=0; i<num_types; i++) {
+        if (PGM_UINT8(&structures[i].rate_hz) != 0 ||
+            PGM_UINT8(&structures[i].priority) != LOG_PRIORITY_NORMAL) {
+            count++;
+        }
+    }
+    if (count != _num_rate_limits) {
+        delete[] _rate_limits;
+        _rate_limits = NULL;
+        _num_rate_limits = 0;
+        if (count != 0) {
+            _rate_limits = new LogRateLimit[count];
+            if (_rate_limits == NULL) {
+                return;
+            }
+            _num_rate_limits = count;
+        }
+    }
+    uint8_t n = 0;
+    for (uint8_t i=0; i<num_types && n<count; i++) {
+        uint8_t rate_hz = PGM_UINT8(&structures[i].rate_hz);
+        uint8_t priority = PGM_UINT8(&structures[i].priority);
+        if (rate_hz == 0 && priority == LOG_PRIORITY_NORMAL) {
+            continue;
+        }
+        struct LogRateLimit &r = _rate_limits[n++];
+        r.msg_type = PGM_UINT8(&structures[i].msg_type);
+        r.priority = priority;
+        r.interval_ms = rate_hz ? 1000 / rate_hz : 0;
+        r.next_ms = 0;
+    }
+}
+
+/*
+  decide if a record of the given type should be written now. This
+  consumes the rate limit slot, so call it once per record
+ */
+bool DataFlash_Class::_log_allowed(uint8_t msg_type)
+{
+    for (uint8_t i=0; i<_num_rate_limits; i++) {
+        struct LogRateLimit &r = _rate_limits[i];
+        if (r.msg_type != msg_type) {
+            continue;
+        }
+        if (r.priority == LOG_PRIORITY_CRITICAL) {
+            return true;
+        }
+        uint16_t interval_ms = r.interval_ms;
+        if (r.priority == LOG_PRIORITY_LOW &&
+            buffer_used_percent() >= LOG_CONGESTED_PERCENT) {
+            if (interval_ms == 0) {
+                return false;
+            }
+            interval_ms *= LOG_CONGESTED_DECIMATION;
+        }
+        if (interval_ms == 0) {
+            return true;
+        }
+        uint16_t now = hal.scheduler->millis();
+        if ((int16_t)(now - r.next_ms) < 0) {
+            return false;
+        }
+        // keep the average rate when calls jitter around the
+        // interval, but don't try to catch up after a long gap
+        r.next_ms += interval_ms;
+        if ((int16_t)(now - r.next_ms) >= 0) {
+            r.next_ms = now + interval_ms;
+        }
+        return true;
+    }
+    return true;
+}
+
+/*
+  priority class of a message type
+ */
+uint8_t DataFlash_Class::_log_priority(uint8_t msg_type) const
+{
+    for (uint8_t i=0; i<_num_rate_limits; i++) {
+        if (_rate_limits[i].msg_type == msg_type) {
+            return _rate_limits[i].priority;
+        }
+    }
+    return LOG_PRIORITY_NORMAL;
+}
+
+/*
+  start a record to be filled in place, see DataFlash.h
+ */
+void *DataFlash_Class::BeginRecord(uint8_t msg_type, void *buf, uint16_t size)
+{
+    void *pkt = ReserveBlock(size);
+    if (pkt == NULL) {
+        // WriteBlock() checks the rate limit on this path
+        return buf;
+    }
+    if (!_log_allowed(msg_type)) {
+        return NULL;
+    }
+    return pkt;
+}
+
+void DataFlash_Class::EndRecord(void *pkt, const void *buf, uint16_t size)
+{
+    if (pkt == buf) {
+        WriteBlock(buf, size);
+    } else {
+        CommitBlock(size);
+    }
+}
+
+uint8_t DataFlash_Class::_msg_type(const void *pBuffer, uint16_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)pBuffer;
+    if (size >= sizeof(struct log_Header) &&
+        bytes[0] == HEAD_BYTE1 && bytes[1] == HEAD_BYTE2) {
+        return bytes[2];
+    }
+    return 0;
+}
+
+bool DataFlash_Class::_has_time(uint8_t msg_type)
+{
+    return DATAFLASH_TIMESTAMPS && msg_type != 0 && msg_type != LOG_FORMAT_MSG;
+}
+
+#if DATAFLASH_TIMESTAMPS
+/*
+  true if the time since the last record is unknown or too long for a
+  time_delta, so a TIME record has to come next
+ */
+bool DataFlash_Class::_time_needed(void) const
+{
+    return !_have_record_time || hal.scheduler->micros() - _last_record_us > 0xFFFF;
+}
+
+/*
+  write a TIME record, giving the absolute time the deltas of the
+  records after it count from
+ */
+void DataFlash_Class::_write_time(void)
+{
+    struct log_Time pkt = {
+        LOG_PACKET_HEADER_INIT(LOG_TIME_MSG),
+        time_us : hal.scheduler->micros()
+    };
+    WriteBlock(&pkt, sizeof(pkt));
+}
+
+/*
+  the time_delta of a record going into the log
+ */
+uint16_t DataFlash_Class::_time_delta(uint8_t msg_type, const void *pBuffer)
+{
+    if (msg_type == LOG_TIME_MSG) {
+        _last_record_us = ((const struct log_Time *)pBuffer)->time_us;
+        _have_record_time = true;
+        return 0;
+    }
+    if (!_have_record_time) {
+        // the TIME record was dropped, so the time of this one is
+        // unknown until the next TIME
+        return 0;
+    }
+    uint32_t delta = hal.scheduler->micros() - _last_record_us;
+    if (delta > 0xFFFF) {
+        // only just too long since _time_needed() was checked. Count
+        // from where the reader will think this record is
+        delta = 0xFFFF;
+    }
+    _last_record_us += delta;
+    return delta;
+}
+
+/*
+  the bytes of a record to write, which are a copy with the
+  time_delta filled in if its type has one. copy has room for size
+  bytes when it does
+ */
+const void *DataFlash_Class::_stamp(uint8_t msg_type, const void *pBuffer, uint16_t size, uint8_t *copy)
+{
+    if (!_has_time(msg_type) || size < sizeof(struct log_Header) + sizeof(uint16_t)) {
+        return pBuffer;
+    }
+    memcpy(copy, pBuffer, size);
+    ((struct log_Time *)copy)->time_delta = _time_delta(msg_type, pBuffer);
+    return copy;
+}
+#endif // DATAFLASH_TIMESTAMPS
+
 /*
   write a structure format to the log
  */
 void DataFlash_Class::Log_Write_Format(const struct LogStructure *s)
 {
     struct log_Format pkt = {
-        LOG_PACKET_HEADER_INIT(LOG_FORMAT_MSG),
+        LOG_PLAIN_HEADER_INIT(LOG_FORMAT_MSG),
         type   : PGM_UINT8(&s->msg_type),
         length : PGM_UINT8(&s->msg_len),
         name   : {},
@@ -598,41 +1025,138 @@ void DataFlash_Class::Log_Write_Parameters(void)
 
 
 
+LOG_MESSAGE_WRITER(log_write_gps, LOG_GPS_MSG, log_GPS, LOG_GPS_FIELDS)
+LOG_MESSAGE_WRITER(log_write_imu, LOG_IMU_MSG, log_IMU, LOG_IMU_FIELDS)
+#if AP_INERTIAL_SENSOR_RAW_LOG
+LOG_MESSAGE_WRITER(log_write_imu_raw_scale, LOG_IMU_RAW_SCALE_MSG, log_IMU_Raw_Scale, LOG_IMU_RAW_SCALE_FIELDS)
+#endif
+#if AP_INERTIAL_SENSOR_BATCH
+LOG_MESSAGE_WRITER(log_write_vibe, LOG_VIBE_MSG, log_Vibe, LOG_VIBE_FIELDS)
+#endif
+LOG_MESSAGE_WRITER(log_write_loop, LOG_LOOP_MSG, log_Loop, LOG_LOOP_FIELDS)
+
 // Write an GPS packet
 void DataFlash_Class::Log_Write_GPS(const GPS *gps, int32_t relative_alt)
 {
-    struct log_GPS pkt = {
-        LOG_PACKET_HEADER_INIT(LOG_GPS_MSG),
-    	status        : (uint8_t)gps->status(),
-    	gps_time      : gps->time,
-        num_sats      : gps->num_sats,
-        hdop          : gps->hdop,
-        latitude      : gps->latitude,
-        longitude     : gps->longitude,
-        rel_altitude  : relative_alt,
-        altitude      : gps->altitude_cm,
-        ground_speed  : gps->ground_speed_cm,
-        ground_course : gps->ground_course_cd
-    };
-    WriteBlock(&pkt, sizeof(pkt));
+    log_write_gps(*this,
+                  (uint8_t)gps->status(),
+                  gps->time,
+                  gps->num_sats,
+                  gps->hdop,
+                  gps->latitude,
+                  gps->longitude,
+                  relative_alt,
+                  gps->altitude_cm,
+                  gps->ground_speed_cm,
+                  gps->ground_course_cd,
+                  gps->get_last_sample_time_micros());
 }
 
 
-// Write an raw accel/gyro data packet
-void DataFlash_Class::Log_Write_IMU(const AP_InertialSensor *ins)
+// Write an raw accel/gyro data packet. This is logged at the fast
+// loop rate, so it is filled in place in the backend buffer when it
+// can be. With INS_RAW_LOG set the full rate samples since the last
+// call follow it
+void DataFlash_Class::Log_Write_IMU(AP_InertialSensor *ins)
 {
     Vector3f gyro = ins->get_gyro();
     Vector3f accel = ins->get_accel();
-    struct log_IMU pkt = {
-        LOG_PACKET_HEADER_INIT(LOG_IMU_MSG),
-        gyro_x  : gyro.x,
-        gyro_y  : gyro.y,
-        gyro_z  : gyro.z,
-        accel_x : accel.x,
-        accel_y : accel.y,
-        accel_z : accel.z
-    };
-    WriteBlock(&pkt, sizeof(pkt));
+    log_write_imu(*this,
+                  ins->get_last_sample_time_micros(),
+                  gyro.x, gyro.y, gyro.z,
+                  accel.x, accel.y, accel.z);
+
+#if AP_INERTIAL_SENSOR_RAW_LOG
+    AP_InertialSensor_RawLog *raw = ins->raw_log();
+    if (raw != NULL) {
+        Log_Write_IMU_Raw(*raw);
+    }
+#endif
+}
+
+#if AP_INERTIAL_SENSOR_RAW_LOG
+#if INS_RAW_LOG_SAMPLES != LOG_ARRAY_VALUES
+#error "a block of raw IMU samples must fill the arrays of an IRAW record"
+#endif
+
+// Write the full blocks of raw IMU samples, a record for each sensor,
+// with the scale of their counts ahead of the first in each log
+void DataFlash_Class::Log_Write_IMU_Raw(AP_InertialSensor_RawLog &raw)
+{
+    const struct AP_InertialSensor_RawLog::block *b;
+    while ((b = raw.peek()) != NULL) {
+        if (!_imu_raw_scale_logged) {
+            log_write_imu_raw_scale(*this, raw.gyro_scale(), raw.accel_scale());
+            _imu_raw_scale_logged = true;
+        }
+        struct log_IMU_Raw pkt = {
+            LOG_PACKET_HEADER_INIT(LOG_IMU_RAW_MSG),
+            time_us     : b->start_us,
+            interval_us : (b->end_us - b->start_us) / (float)(INS_RAW_LOG_SAMPLES - 1),
+            sensor      : 0,
+            x           : {},
+            y           : {},
+            z           : {}
+        };
+        memcpy(pkt.x, b->gyro[0], sizeof(pkt.x));
+        memcpy(pkt.y, b->gyro[1], sizeof(pkt.y));
+        memcpy(pkt.z, b->gyro[2], sizeof(pkt.z));
+        WriteBlock(&pkt, sizeof(pkt));
+
+        pkt.sensor = 1;
+        memcpy(pkt.x, b->accel[0], sizeof(pkt.x));
+        memcpy(pkt.y, b->accel[1], sizeof(pkt.y));
+        memcpy(pkt.z, b->accel[2], sizeof(pkt.z));
+        WriteBlock(&pkt, sizeof(pkt));
+        raw.pop();
+    }
+}
+#endif
+
+#if AP_INERTIAL_SENSOR_BATCH
+// Write the vibration analysis of a batch of raw IMU samples
+void DataFlash_Class::Log_Write_Vibe(const AP_InertialSensor_Batch::result &vibe)
+{
+    log_write_vibe(*this,
+                   hal.scheduler->millis(),
+                   vibe.sensor,
+                   (uint16_t)(vibe.sample_hz + 0.5f),
+                   (uint16_t)(vibe.peak_hz[0] + 0.5f),
+                   (uint16_t)(vibe.peak_hz[1] + 0.5f),
+                   (uint16_t)(vibe.peak_hz[2] + 0.5f),
+                   vibe.peak_energy[0],
+                   vibe.peak_energy[1],
+                   vibe.peak_energy[2]);
+}
+#endif
+
+// Write the main loop timing since the scheduler stats were last reset
+void DataFlash_Class::Log_Write_Loop(const AP_Scheduler &scheduler)
+{
+    const AP_Scheduler::LoopStats &st = scheduler.loop_stats();
+    uint32_t now = hal.scheduler->millis();
+    log_write_loop(*this,
+                   now,
+                   st.count,
+                   st.long_count,
+                   st.max_micros,
+                   scheduler.loop_percentile_micros(50),
+                   scheduler.loop_percentile_micros(95),
+                   scheduler.loop_percentile_micros(99),
+                   st.min_slack_micros,
+                   scheduler.loop_mean_slack_micros());
+
+    for (uint8_t b=0; b<AP_SCHEDULER_LOOP_BUCKETS; b+=LOG_LOOP_HIST_BUCKETS) {
+        struct log_LoopHist hist = {
+            LOG_PACKET_HEADER_INIT(LOG_LOOP_HIST_MSG),
+            time_ms : now,
+            first   : b
+        };
+        for (uint8_t i=0; i<LOG_LOOP_HIST_BUCKETS; i++) {
+            hist.count[i] = b+i < AP_SCHEDULER_LOOP_BUCKETS ? st.hist[b+i] : 0;
+        }
+        WriteBlock(&hist, sizeof(hist));
+    }
 }
 
 // Write a text message to the log
@@ -0,0 +1,98 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef __LOG_MESSAGE_H__
+#define __LOG_MESSAGE_H__
+
+/*
+  log messages generated from a single list of their fields, so the
+  struct, the format and labels of the LogStructure entry and the
+  writer can't disagree. A list takes the macro to apply to each
+  field, F, and what goes between fields, S. Each field has its format
+  character, its name in the struct and its label:
+
+    #define LOG_LOOP_FIELDS(F, S) \
+        F(I, time_ms, "TimeMS") S \
+        F(H, count,   "NLoop")  S \
+        ...
+
+  The type of a field comes from its format character, as
+  LOG_TYPE_<c>. Then
+
+    LOG_MESSAGE_STRUCT(log_Loop, LOG_LOOP_FIELDS);
+
+  declares struct log_Loop with the packet header,
+
+    { LOG_MESSAGE_STRUCTURE(LOG_LOOP_MSG, log_Loop, "LOOP", LOG_LOOP_FIELDS) },
+
+  is its entry in a LogStructure table, with an optional rate and
+  priority after it, and
+
+    LOG_MESSAGE_WRITER(log_write_loop, LOG_LOOP_MSG, log_Loop, LOG_LOOP_FIELDS)
+
+  defines
+
+    static void log_write_loop(DataFlash_Class &dataflash, uint32_t time_ms, uint16_t count, ...)
+
+  which fills in the record in the space reserved for it in the log
+  when the backend can do that, and writes it with WriteBlock()
+  otherwise.
+
+  Only scalar fields can be listed. The char arrays of 'n', 'N' and 'Z'
+  have no LOG_TYPE_, so messages with them, or with arrays of values,
+  still need a hand written struct and writer. A format or labels too
+  long for LogStructure fail to compile.
+ */
+
+// the type of the field of each scalar format character
+#define LOG_TYPE_b  int8_t
+#define LOG_TYPE_B  uint8_t
+#define LOG_TYPE_M  uint8_t
+#define LOG_TYPE_h  int16_t
+#define LOG_TYPE_H  uint16_t
+#define LOG_TYPE_c  int16_t
+#define LOG_TYPE_C  uint16_t
+#define LOG_TYPE_i  int32_t
+#define LOG_TYPE_I  uint32_t
+#define LOG_TYPE_e  int32_t
+#define LOG_TYPE_E  uint32_t
+#define LOG_TYPE_L  int32_t
+#define LOG_TYPE_f  float
+
+// what is made of each field, and what goes between them. The
+// parameters of the writer are prefixed so they don't shadow globals
+// of the same name as a field
+#define LOG_FIELD_MEMBER(c, name, label)  LOG_TYPE_##c name;
+#define LOG_FIELD_FORMAT(c, name, label)  #c
+#define LOG_FIELD_LABEL(c, name, label)   label
+#define LOG_FIELD_PARAM(c, name, label)   LOG_TYPE_##c _##name
+#define LOG_FIELD_STORE(c, name, label)   pkt->name = _##name;
+#define LOG_SEP_NONE
+#define LOG_SEP_LABEL  ","
+#define LOG_SEP_COMMA  ,
+
+#define LOG_MESSAGE_STRUCT(sname, FIELDS) \
+    struct PACKED sname { \
+        LOG_PACKET_HEADER; \
+        FIELDS(LOG_FIELD_MEMBER, LOG_SEP_NONE) \
+    }
+
+#define LOG_MESSAGE_STRUCTURE(msg_type, sname, name, FIELDS) \
+    msg_type, sizeof(struct sname), name, \
+    FIELDS(LOG_FIELD_FORMAT, LOG_SEP_NONE), \
+    FIELDS(LOG_FIELD_LABEL, LOG_SEP_LABEL)
+
+#define LOG_MESSAGE_WRITER(func, msg_type, sname, FIELDS) \
+    static void func(DataFlash_Class &dataflash, FIELDS(LOG_FIELD_PARAM, LOG_SEP_COMMA)) \
+    { \
+        struct sname buf; \
+        struct sname *pkt = (struct sname *)dataflash.BeginRecord(msg_type, &buf, sizeof(buf)); \
+        if (pkt == NULL) { \
+            return; \
+        } \
+        pkt->head1 = HEAD_BYTE1; \
+        pkt->head2 = HEAD_BYTE2; \
+        pkt->msgid = msg_type; \
+        FIELDS(LOG_FIELD_STORE, LOG_SEP_NONE) \
+        dataflash.EndRecord(pkt, &buf, sizeof(buf)); \
+    }
+
+#endif // __LOG_MESSAGE_H__
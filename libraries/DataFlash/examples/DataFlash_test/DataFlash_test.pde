@@ -26,7 +26,9 @@
 #include <AP_InertialSensor.h>
 #include <AP_GPS.h>
 #include <DataFlash.h>
+#include <AP_Scheduler.h>
 #include <GCS_MAVLink.h>
+#include <SITL.h>
 
 
 
@@ -36,22 +38,29 @@ const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
 DataFlash_APM2 DataFlash;
 #elif CONFIG_HAL_BOARD == HAL_BOARD_APM1
 DataFlash_APM1 DataFlash;
+#elif CONFIG_HAL_BOARD == HAL_BOARD_AVR_SITL
+DataFlash_SITL DataFlash;
 #else
 DataFlash_Empty DataFlash;
 #endif
 
 #define LOG_TEST_MSG 1
 
-struct PACKED log_Test {
-    LOG_PACKET_HEADER;
-    uint16_t v1, v2, v3, v4;
-    int32_t  l1, l2;
-};
+// the struct, format and writer of the test message all come from
+// this list, see LogMessage.h
+#define LOG_TEST_FIELDS(F, S) \
+    F(H, v1, "V1") S \
+    F(H, v2, "V2") S \
+    F(H, v3, "V3") S \
+    F(H, v4, "V4") S \
+    F(i, l1, "L1") S \
+    F(i, l2, "L2")
+LOG_MESSAGE_STRUCT(log_Test, LOG_TEST_FIELDS);
+LOG_MESSAGE_WRITER(log_write_test, LOG_TEST_MSG, log_Test, LOG_TEST_FIELDS)
 
 static const struct LogStructure log_structure[] PROGMEM = {
     LOG_COMMON_STRUCTURES,
-    { LOG_TEST_MSG, sizeof(log_Test),       
-      "TEST", "HHHHii",        "V1,V2,V3,V4,L1,L2" }
+    { LOG_MESSAGE_STRUCTURE(LOG_TEST_MSG, log_Test, "TEST", LOG_TEST_FIELDS) }
 };
 
 #define NUM_PACKETS 500
@@ -88,18 +97,9 @@ void setup()
 
     for (i = 0; i < NUM_PACKETS; i++) {
         uint32_t start = hal.scheduler->micros();
-        // note that we use g++ style initialisers to make larger
-        // structures easier to follow        
-        struct log_Test pkt = {
-            LOG_PACKET_HEADER_INIT(LOG_TEST_MSG),
-            v1    : 2000 + i,
-            v2    : 2001 + i,
-            v3    : 2002 + i,
-            v4    : 2003 + i,
-            l1    : (long)i * 5000,
-            l2    : (long)i * 16268
-        };
-        DataFlash.WriteBlock(&pkt, sizeof(pkt));
+        log_write_test(DataFlash,
+                       2000 + i, 2001 + i, 2002 + i, 2003 + i,
+                       (long)i * 5000, (long)i * 16268);
         total_micros += hal.scheduler->micros() - start;
         hal.scheduler->delay(20);
     }
@@ -7,7 +7,8 @@
 //
 
 /// @file	AverageFilter.h
-/// @brief	A class to provide the average of a number of samples
+/// @brief	A class to provide the average of a number of samples, kept as
+///         a running sum so each sample costs the same whatever the size
 
 #ifndef __AVERAGE_FILTER_H__
 #define __AVERAGE_FILTER_H__
@@ -23,7 +24,7 @@ class AverageFilter : public FilterWithBuffer<T,FILTER_SIZE>
 {
 public:
     // constructor
-    AverageFilter() : FilterWithBuffer<T,FILTER_SIZE>(), _num_samples(0) {
+    AverageFilter() : FilterWithBuffer<T,FILTER_SIZE>(), _num_samples(0), _sum(0) {
     };
 
     // apply - Add a new raw value to the filter, retrieve the filtered result
@@ -34,6 +35,7 @@ public:
 
 private:
     uint8_t        _num_samples; // the number of samples in the filter, maxes out at size of the filter
+    U              _sum;         // sum of the samples in the filter
 };
 
 // Typedef for convenience (1st argument is the data type, 2nd is a larger datatype to handle overflows, 3rd is buffer size)
@@ -71,21 +73,33 @@ typedef AverageFilter<float,float,5> AverageFilterFloat_Size5;
 template <class T, class U, uint8_t FILTER_SIZE>
 T AverageFilter<T,U,FILTER_SIZE>::        apply(T sample)
 {
-    U        result = 0;
+    // once the buffer is full, the sample about to be overwritten
+    // leaves the sum
+    if (_num_samples == FILTER_SIZE) {
+        _sum -= FilterWithBuffer<T,FILTER_SIZE>::samples[FilterWithBuffer<T,FILTER_SIZE>::sample_index];
+    }
 
     // call parent's apply function to get the sample into the array
     FilterWithBuffer<T,FILTER_SIZE>::apply(sample);
 
-    // increment the number of samples so far
-    _num_samples++;
-    if( _num_samples > FILTER_SIZE || _num_samples == 0 )
-        _num_samples = FILTER_SIZE;
+    // there is a risk of overflow here that we ignore
+    _sum += sample;
 
-    // get sum of all values - there is a risk of overflow here that we ignore
-    for(uint8_t i=0; i<FILTER_SIZE; i++)
-        result += FilterWithBuffer<T,FILTER_SIZE>::samples[i];
+    if (_num_samples < FILTER_SIZE) {
+        _num_samples++;
+        return (T)(_sum / _num_samples);
+    }
 
-    return (T)(result / _num_samples);
+    // once a lap of the buffer, sum it afresh so that rounding in a
+    // float sum can't build up
+    if (FilterWithBuffer<T,FILTER_SIZE>::sample_index == 0) {
+        _sum = 0;
+        for(uint8_t i=0; i<FILTER_SIZE; i++)
+            _sum += FilterWithBuffer<T,FILTER_SIZE>::samples[i];
+    }
+
+    // dividing by the constant size is a shift for power of two sizes
+    return (T)(_sum / FILTER_SIZE);
 }
 
 // reset - clear all samples
@@ -95,8 +109,9 @@ void AverageFilter<T,U,FILTER_SIZE>::        reset()
     // call parent's apply function to get the sample into the array
     FilterWithBuffer<T,FILTER_SIZE>::reset();
 
-    // clear our variable
+    // clear our variables
     _num_samples = 0;
+    _sum = 0;
 }
 
 #endif // __AVERAGE_FILTER_H__
@@ -0,0 +1,89 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// This is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; either version 2.1 of the License, or (at
+// your option) any later version.
+//
+
+/// @file	BiquadFilter.h
+/// @brief	A second order IIR filter with coefficients set at runtime,
+///         for notch and low pass filtering of high rate sensor data.
+///         Coefficients are from the RBJ audio EQ cookbook. The
+///         Vector3f form filters all three axes in one pass sharing
+///         one set of coefficients
+
+#ifndef __BIQUAD_FILTER_H__
+#define __BIQUAD_FILTER_H__
+
+#include <AP_Math.h>
+
+template <class T>
+class BiquadFilter
+{
+public:
+    // constructor. The filter starts as a pass through
+    BiquadFilter() :
+        _b0(1), _b1(0), _b2(0), _a1(0), _a2(0)
+    {
+        reset();
+    }
+
+    // set_notch - reject a band bandwidth_hz wide around center_hz
+    void set_notch(float sample_hz, float center_hz, float bandwidth_hz) {
+        float w0 = 2*PI*center_hz/sample_hz;
+        float alpha = sinf(w0) * bandwidth_hz / (2*center_hz);
+        float cosw0 = cosf(w0);
+        _set(1, -2*cosw0, 1, 1+alpha, -2*cosw0, 1-alpha);
+    }
+
+    // set_lowpass - second order Butterworth low pass
+    void set_lowpass(float sample_hz, float cutoff_hz) {
+        float w0 = 2*PI*cutoff_hz/sample_hz;
+        float alpha = sinf(w0) * 0.70710678f;  // sin(w0)/(2Q), Q = 1/sqrt(2)
+        float cosw0 = cosf(w0);
+        _set((1-cosw0)/2, 1-cosw0, (1-cosw0)/2, 1+alpha, -2*cosw0, 1-alpha);
+    }
+
+    // reset - clear the filter - next sample added is taken as the
+    // steady state input
+    void reset() {
+        _state_set = false;
+    }
+
+    // apply - Add a new raw value to the filter, retrieve the filtered result
+    T apply(const T &sample) {
+        if (!_state_set) {
+            // settle the filter on the first sample so a DC input
+            // gives no transient. The DC gain is 1 for both types
+            _z1 = sample * (1 - _b0);
+            _z2 = sample * (_b2 - _a2);
+            _state_set = true;
+        }
+        // transposed direct form II
+        T out = sample*_b0 + _z1;
+        _z1 = sample*_b1 - out*_a1 + _z2;
+        _z2 = sample*_b2 - out*_a2;
+        return out;
+    }
+
+private:
+    void _set(float b0, float b1, float b2, float a0, float a1, float a2) {
+        _b0 = b0/a0;
+        _b1 = b1/a0;
+        _b2 = b2/a0;
+        _a1 = a1/a0;
+        _a2 = a2/a0;
+        reset();
+    }
+
+    float _b0, _b1, _b2, _a1, _a2;
+    T _z1, _z2;
+    bool _state_set;
+};
+
+// Typedef for convenience
+typedef BiquadFilter<float> BiquadFilterFloat;
+typedef BiquadFilter<Vector3f> BiquadFilterVector3f;
+
+#endif // __BIQUAD_FILTER_H__
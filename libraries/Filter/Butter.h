@@ -3,15 +3,20 @@
 #define __FILTER_BUTTER_H__
 
 #include <AP_HAL.h>
+#include <AP_Math.h>
 
 template <typename Coefficients>
 class Butter2
 {
 public:
+  Butter2() { reset(); }
+
+  void reset() { hist[0] = hist[1] = 0; }
+
   float filter(float input)
   {
         float newhist = input + Coefficients::A1*hist[1] + Coefficients::A2*hist[0];
-        float ret = (newhist + 2*hist[1] + hist[0])/Coefficients::GAIN;
+        float ret = (newhist + 2*hist[1] + hist[0]) * (1.0f/Coefficients::GAIN);
         hist[0] = hist[1]; hist[1] = newhist;
         return ret;
   }
@@ -19,6 +24,38 @@ private:
     float hist[2];
 };
 
+/*
+  Butter2 run on all three axes of a Vector3f in one pass. The
+  history is stored per tap rather than per axis, so the loop body is
+  the same straight line of multiply-adds for each axis and the
+  compiler can unroll it without any reloads of the coefficients,
+  which are compile time constants
+ */
+template <typename Coefficients>
+class Butter2Vector3f
+{
+public:
+  Butter2Vector3f() { reset(); }
+
+  void reset() { memset(hist, 0, sizeof(hist)); }
+
+  Vector3f filter(const Vector3f &input)
+  {
+        const float in[3] = { input.x, input.y, input.z };
+        float ret[3];
+        for (uint8_t i=0; i<3; i++) {
+            float newhist = in[i] + Coefficients::A1*hist[1][i] + Coefficients::A2*hist[0][i];
+            ret[i] = (newhist + 2*hist[1][i] + hist[0][i]) * (1.0f/Coefficients::GAIN);
+            hist[0][i] = hist[1][i];
+            hist[1][i] = newhist;
+        }
+        return Vector3f(ret[0], ret[1], ret[2]);
+  }
+private:
+    // hist[tap][axis]
+    float hist[2][3];
+};
+
 struct butter100_025_coeffs
 {
   static constexpr float A1 = 1.9777864838;
@@ -14,21 +14,25 @@
 #define __DERIVATIVE_FILTER_H__
 
 #include "FilterClass.h"
-#include "FilterWithBuffer.h"
 
 // 1st parameter <T> is the type of data being filtered.
 // 2nd parameter <FILTER_SIZE> is the number of elements in the filter
 template <class T, uint8_t FILTER_SIZE>
-class DerivativeFilter : public FilterWithBuffer<T,FILTER_SIZE>
+class DerivativeFilter : public Filter<T>
 {
 public:
     // constructor
-    DerivativeFilter() : FilterWithBuffer<T,FILTER_SIZE>() {
+    DerivativeFilter() {
+        reset();
     };
 
     // update - Add a new raw value to the filter, but don't recalculate
     virtual void        update(T sample, uint32_t timestamp);
 
+    // apply - Add a new raw value, taking the samples as one time unit
+    // apart, and return the derivative
+    virtual T           apply(T sample);
+
     // return the derivative value
     virtual float        slope(void);
 
@@ -39,9 +43,17 @@ private:
     bool            _new_data;
     float           _last_slope;
 
+    // the window is kept twice over, each sample written at its slot
+    // and FILTER_SIZE further on, so that the FILTER_SIZE samples from
+    // _sample_index are always in order without wrapping
+    T               _samples[2*FILTER_SIZE];
+
     // microsecond timestamps for samples. This is needed
     // to cope with non-uniform time spacing of the data
-    uint32_t        _timestamps[FILTER_SIZE];
+    uint32_t        _timestamps[2*FILTER_SIZE];
+
+    uint8_t         _sample_index;              // the oldest sample, and the next to be replaced
+    uint8_t         _num_samples;               // maxes out at the size of the filter
 };
 
 typedef DerivativeFilter<float,5> DerivativeFilterFloat_Size5;
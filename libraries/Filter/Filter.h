@@ -10,7 +10,9 @@
 #include "FilterWithBuffer.h"
 #include "LowPassFilter.h"
 #include "ModeFilter.h"
+#include "MedianFilter.h"
 #include "Butter.h"
+#include "BiquadFilter.h"
 
 #endif //__FILTER_H__
 
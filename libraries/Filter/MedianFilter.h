@@ -0,0 +1,143 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// This is free software; you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; either version 2.1 of the License, or (at
+// your option) any later version.
+//
+
+/// @file	MedianFilter.h
+/// @brief	A sliding window median filter. The last FILTER_SIZE samples are
+///         kept in arrival order in the FilterWithBuffer buffer and also in
+///         a second, sorted array. Each new sample replaces the oldest one
+///         in the sorted array, found by binary search, and is moved into
+///         place by shifting only the elements between the old and new
+///         values, so the cost per sample no longer grows with a full sort
+///         of the window
+
+#ifndef __MEDIAN_FILTER_H__
+#define __MEDIAN_FILTER_H__
+
+#include <inttypes.h>
+#include "FilterClass.h"
+#include "FilterWithBuffer.h"
+
+template <class T, uint8_t FILTER_SIZE>
+class MedianFilter : public FilterWithBuffer<T,FILTER_SIZE>
+{
+public:
+    // return_element selects which element of the sorted window is
+    // returned once it is full. Out of range values give the median
+    MedianFilter(uint8_t return_element = FILTER_SIZE / 2);
+
+    // apply - Add a new raw value to the filter, retrieve the filtered result
+    virtual T        apply(T sample);
+
+    // reset - clear the filter
+    virtual void     reset();
+
+private:
+    uint8_t         _find(T value) const;
+
+    uint8_t         _return_element;
+    uint8_t         _count;                     // number of samples in the window
+    T               _sorted[FILTER_SIZE];       // window contents in ascending order
+};
+
+// Typedef for convenience
+typedef MedianFilter<int16_t,3> MedianFilterInt16_Size3;
+typedef MedianFilter<int16_t,5> MedianFilterInt16_Size5;
+typedef MedianFilter<int16_t,7> MedianFilterInt16_Size7;
+typedef MedianFilter<int16_t,9> MedianFilterInt16_Size9;
+typedef MedianFilter<int16_t,15> MedianFilterInt16_Size15;
+typedef MedianFilter<uint16_t,3> MedianFilterUInt16_Size3;
+typedef MedianFilter<uint16_t,5> MedianFilterUInt16_Size5;
+typedef MedianFilter<uint16_t,7> MedianFilterUInt16_Size7;
+typedef MedianFilter<uint16_t,9> MedianFilterUInt16_Size9;
+typedef MedianFilter<uint16_t,15> MedianFilterUInt16_Size15;
+typedef MedianFilter<float,5> MedianFilterFloat_Size5;
+typedef MedianFilter<float,9> MedianFilterFloat_Size9;
+
+// Constructor    //////////////////////////////////////////////////////////////
+
+template <class T, uint8_t FILTER_SIZE>
+MedianFilter<T,FILTER_SIZE>::MedianFilter(uint8_t return_element) :
+    FilterWithBuffer<T,FILTER_SIZE>(),
+    _return_element(return_element),
+    _count(0)
+{
+    // ensure we have a valid return_element value.  if not, revert to median
+    if( _return_element >= FILTER_SIZE )
+        _return_element = FILTER_SIZE / 2;
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+template <class T, uint8_t FILTER_SIZE>
+void MedianFilter<T,FILTER_SIZE>::        reset()
+{
+    FilterWithBuffer<T,FILTER_SIZE>::reset();
+    _count = 0;
+}
+
+template <class T, uint8_t FILTER_SIZE>
+T MedianFilter<T,FILTER_SIZE>::        apply(T sample)
+{
+    T *samples = FilterWithBuffer<T,FILTER_SIZE>::samples;
+    uint8_t &sample_index = FilterWithBuffer<T,FILTER_SIZE>::sample_index;
+    uint8_t i;
+
+    if( _count < FILTER_SIZE ) {
+        // still filling - insert from the top
+        i = _count++;
+        while( i > 0 && _sorted[i-1] > sample ) {
+            _sorted[i] = _sorted[i-1];
+            i--;
+        }
+    }else{
+        // reuse the slot holding the oldest sample, then move it up
+        // or down until the window is sorted again
+        i = _find(samples[sample_index]);
+        while( i < FILTER_SIZE-1 && _sorted[i+1] < sample ) {
+            _sorted[i] = _sorted[i+1];
+            i++;
+        }
+        while( i > 0 && _sorted[i-1] > sample ) {
+            _sorted[i] = _sorted[i-1];
+            i--;
+        }
+    }
+    _sorted[i] = sample;
+
+    // keep the samples in arrival order in the base class buffer
+    samples[sample_index++] = sample;
+    if( sample_index >= FILTER_SIZE )
+        sample_index = 0;
+
+    if( _count < FILTER_SIZE ) {
+        // middle sample if buffer is not yet full
+        return _sorted[_count / 2];
+    }
+    return _sorted[_return_element];
+}
+
+// Private Methods //////////////////////////////////////////////////////////////
+
+// _find - binary search of the full sorted window for an element
+// equal to value. Any of several equal elements will do
+template <class T, uint8_t FILTER_SIZE>
+uint8_t MedianFilter<T,FILTER_SIZE>::        _find(T value) const
+{
+    uint8_t lo = 0, hi = FILTER_SIZE - 1;
+    while( lo < hi ) {
+        uint8_t mid = (lo + hi) / 2;
+        if( _sorted[mid] < value ) {
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+#endif // __MEDIAN_FILTER_H__
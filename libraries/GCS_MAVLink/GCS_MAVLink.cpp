@@ -52,9 +52,20 @@ uint8_t mav_var_type(enum ap_var_type t)
 
 
 /*
-  send a buffer out a MAVLink channel
+  the message being collected by comm_send_start() and comm_send_end().
+  Messages are sent one at a time from the main loop, so one buffer
+  does for both channels
  */
-void comm_send_buffer(mavlink_channel_t chan, const uint8_t *buf, uint8_t len)
+static struct {
+    bool active;
+    uint8_t len;
+    uint8_t buf[MAVLINK_MAX_PAYLOAD_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES];
+} comm_send_message;
+
+/*
+  write a buffer to the port of a MAVLink channel
+ */
+static void comm_write(mavlink_channel_t chan, const uint8_t *buf, uint8_t len)
 {
     switch(chan) {
 	case MAVLINK_COMM_0:
@@ -68,22 +79,48 @@ void comm_send_buffer(mavlink_channel_t chan, const uint8_t *buf, uint8_t len)
 	}
 }
 
-static const uint8_t mavlink_message_crc_progmem[256] PROGMEM = MAVLINK_MESSAGE_CRCS;
-
-// return CRC byte for a mavlink message ID
-uint8_t mavlink_get_message_crc(uint8_t msgid)
+/*
+  send a buffer out a MAVLink channel, or add it to the message being
+  collected
+ */
+void comm_send_buffer(mavlink_channel_t chan, const uint8_t *buf, uint8_t len)
 {
-	return pgm_read_byte(&mavlink_message_crc_progmem[msgid]);
+    if (comm_send_message.active) {
+        memcpy(&comm_send_message.buf[comm_send_message.len], buf, len);
+        comm_send_message.len += len;
+        return;
+    }
+    comm_write(chan, buf, len);
 }
 
-extern const AP_HAL::HAL& hal;
+/*
+  start collecting a message of length bytes. Anything too long to
+  collect is sent in pieces as before
+ */
+void comm_send_start(mavlink_channel_t chan, uint16_t length)
+{
+    if (length <= sizeof(comm_send_message.buf)) {
+        comm_send_message.active = true;
+        comm_send_message.len = 0;
+    }
+}
 
 /*
-  return true if the MAVLink parser is idle, so there is no partly parsed
-  MAVLink message being processed
+  send the collected message
  */
-bool comm_is_idle(mavlink_channel_t chan)
+void comm_send_end(mavlink_channel_t chan)
+{
+    if (comm_send_message.active) {
+        comm_send_message.active = false;
+        comm_write(chan, comm_send_message.buf, comm_send_message.len);
+    }
+}
+
+static const uint8_t mavlink_message_crc_progmem[256] PROGMEM = MAVLINK_MESSAGE_CRCS;
+
+// return CRC byte for a mavlink message ID
+uint8_t mavlink_get_message_crc(uint8_t msgid)
 {
-	mavlink_status_t *status = mavlink_get_channel_status(chan);
-	return status == NULL || status->parse_state <= MAVLINK_PARSE_STATE_IDLE;
+	return pgm_read_byte(&mavlink_message_crc_progmem[msgid]);
 }
+
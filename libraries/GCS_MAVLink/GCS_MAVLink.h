@@ -7,7 +7,7 @@
 #define GCS_MAVLink_h
 
 #include <AP_HAL.h>
-#include <AP_Param.h>
+#include <AP_Param.h>
 #include <AP_Math.h>
 
 // we have separate helpers disabled to make it possible
@@ -16,6 +16,12 @@
 
 #define MAVLINK_SEND_UART_BYTES(chan, buf, len) comm_send_buffer(chan, buf, len)
 
+// the MAVLink helpers send each message as three pieces, the header,
+// the payload and the checksum. These collect the pieces so the port
+// gets the whole message in one write
+#define MAVLINK_START_UART_SEND(chan, length) comm_send_start(chan, length)
+#define MAVLINK_END_UART_SEND(chan, length) comm_send_end(chan)
+
 // define our own MAVLINK_MESSAGE_CRC() macro to allow it to be put
 // into progmem
 #define MAVLINK_MESSAGE_CRC(msgid) mavlink_get_message_crc(msgid)
@@ -64,6 +70,8 @@ static inline void comm_send_ch(mavlink_channel_t chan, uint8_t ch)
 }
 
 void comm_send_buffer(mavlink_channel_t chan, const uint8_t *buf, uint8_t len);
+void comm_send_start(mavlink_channel_t chan, uint16_t length);
+void comm_send_end(mavlink_channel_t chan);
 
 /// Read a byte from the nominated MAVLink channel
 ///
@@ -87,6 +95,15 @@ static inline uint8_t comm_receive_ch(mavlink_channel_t chan)
     return data;
 }
 
+/// The port of a MAVLink channel
+static inline AP_HAL::BetterStream *comm_get_port(mavlink_channel_t chan)
+{
+    if (chan == MAVLINK_COMM_1) {
+        return mavlink_comm_1_port;
+    }
+    return mavlink_comm_0_port;
+}
+
 /// Check for available data on the nominated MAVLink channel
 ///
 /// @param chan		Channel to check
@@ -143,11 +160,8 @@ static inline void crc_accumulate(uint8_t data, uint16_t *crcAccum)
 }
 #endif
 
-/*
-  return true if the MAVLink parser is idle, so there is no partly parsed
-  MAVLink message being processed
- */
-bool comm_is_idle(mavlink_channel_t chan);
+// crc_calculate() and friends, for callers framing their own data
+#include "include/mavlink/v1.0/checksum.h"
 
 #define MAVLINK_USE_CONVENIENCE_FUNCTIONS
 #include "include/mavlink/v1.0/ardupilotmega/mavlink.h"
@@ -160,6 +174,41 @@ uint8_t mav_var_type(enum ap_var_type t);
 // return CRC byte for a mavlink message ID
 uint8_t mavlink_get_message_crc(uint8_t msgid);
 
+#include "MAVLink_routing.h"
+#include "MAVLink_statustext.h"
+#include "MAVLink_parser.h"
+#include "MAVLink_framecache.h"
+
+// the type field of DATA16, DATA32 and DATA64 messages carrying data
+// to be passed unchanged to the GPS, such as RTCM corrections
+#define MAVLINK_DATA_TYPE_GPS_INJECT 1
+
+// the type field of a DATA16 asking the GCS for terrain heights, and
+// of the DATA96 messages carrying them, laid out as in AP_Terrain.h
+#define MAVLINK_DATA_TYPE_TERRAIN_REQUEST 2
+#define MAVLINK_DATA_TYPE_TERRAIN 3
+
+// the type field of DATA32 and DATA64 messages carrying raw simulated
+// sensors for HIL_MODE_SENSORS, laid out as mavlink_hil_sensors. This
+// is much shorter than HIL_STATE, so it can come at the IMU rate
+#define MAVLINK_DATA_TYPE_HIL_SENSORS 4
+
+struct PACKED mavlink_hil_sensors {
+    uint32_t time_ms;
+    int16_t gyro[3];        // body rates in mrad/s
+    int16_t accel[3];       // cm/s/s
+    int16_t mag[3];         // body field in milligauss
+    int32_t baro_alt_cm;    // above mean sea level
+    // the GPS fix, only when the data is long enough for it, so in a
+    // DATA64. A DATA32 carries the rest
+    int32_t lat;            // degrees * 1e7
+    int32_t lng;
+    int32_t gps_alt_cm;
+    int16_t vel_north;      // cm/s
+    int16_t vel_east;
+};
+#define MAVLINK_HIL_SENSORS_GPS_OFS 26  // offset of lat
+
 // severity levels used in STATUSTEXT messages
 enum gcs_severity {
     SEVERITY_LOW=1,
@@ -0,0 +1,164 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	MAVLink_framecache.cpp
+
+/*
+This firmware is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+*/
+
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <GCS_MAVLink.h>
+
+static uint32_t framecache_hits;
+static uint32_t framecache_misses;
+
+#if MAVLINK_FRAMECACHE_SLOTS > 0
+
+#define FRAMECACHE_CHANNELS 2
+
+/*
+  a frame as last sent, with sequence number 0 and the checksum for
+  that
+ */
+static struct framecache_slot {
+    uint8_t frame[MAVLINK_FRAMECACHE_PAYLOAD + MAVLINK_NUM_NON_PAYLOAD_BYTES];
+    uint16_t seq_crc[8];        // what each bit of the sequence number changes the checksum by
+    uint8_t used;               // order of use, for replacing the oldest
+    bool valid;
+} framecache[FRAMECACHE_CHANNELS][MAVLINK_FRAMECACHE_SLOTS];
+
+static uint8_t framecache_use[FRAMECACHE_CHANNELS];
+
+/*
+  the checksum of a frame, from the length byte to the end of the
+  payload, and the extra byte
+ */
+static uint16_t frame_crc(const uint8_t *frame, uint8_t crc_extra)
+{
+    uint16_t checksum = crc_calculate(&frame[1], MAVLINK_CORE_HEADER_LEN + frame[1]);
+    crc_accumulate(crc_extra, &checksum);
+    return checksum;
+}
+
+static void frame_put_crc(uint8_t *frame, uint16_t checksum)
+{
+    frame[MAVLINK_NUM_HEADER_BYTES + frame[1]]     = (uint8_t)(checksum & 0xFF);
+    frame[MAVLINK_NUM_HEADER_BYTES + frame[1] + 1] = (uint8_t)(checksum >> 8);
+}
+
+static uint16_t frame_get_crc(const uint8_t *frame)
+{
+    return frame[MAVLINK_NUM_HEADER_BYTES + frame[1]] |
+        (frame[MAVLINK_NUM_HEADER_BYTES + frame[1] + 1] << 8);
+}
+
+/*
+  the slot holding a frame to send, or the one it should go into
+ */
+static struct framecache_slot *framecache_find(uint8_t c, uint8_t msgid, bool &found)
+{
+    struct framecache_slot *best = NULL;
+    uint8_t best_age = 0;
+    for (uint8_t i=0; i<MAVLINK_FRAMECACHE_SLOTS; i++) {
+        struct framecache_slot *s = &framecache[c][i];
+        if (s->valid && s->frame[5] == msgid) {
+            found = true;
+            return s;
+        }
+        uint8_t age = s->valid ? (uint8_t)(framecache_use[c] - s->used) : 0xFF;
+        if (best == NULL || age > best_age) {
+            best = s;
+            best_age = age;
+        }
+    }
+    found = false;
+    return best;
+}
+
+void mavlink_send_cached(mavlink_channel_t chan, uint8_t msgid,
+                         const void *payload, uint8_t length, uint8_t crc_extra)
+{
+    uint8_t c = (uint8_t)chan;
+    if (c >= FRAMECACHE_CHANNELS || length > MAVLINK_FRAMECACHE_PAYLOAD) {
+        _mav_finalize_message_chan_send(chan, msgid, (const char *)payload, length, crc_extra);
+        return;
+    }
+
+    bool found;
+    struct framecache_slot *s = framecache_find(c, msgid, found);
+    uint8_t *frame = s->frame;
+    if (found &&
+        frame[1] == length &&
+        frame[3] == mavlink_system.sysid &&
+        frame[4] == mavlink_system.compid &&
+        memcmp(&frame[MAVLINK_NUM_HEADER_BYTES], payload, length) == 0) {
+        framecache_hits++;
+    } else {
+        if (!found || frame[1] != length) {
+            // the checksum changes of the sequence bits depend only
+            // on how many bytes follow it
+            frame[1] = length;
+            frame[2] = 0;
+            memset(&frame[3], 0, MAVLINK_CORE_HEADER_LEN - 2 + length);
+            uint16_t crc0 = frame_crc(frame, 0);
+            for (uint8_t b=0; b<8; b++) {
+                frame[2] = 1U << b;
+                s->seq_crc[b] = frame_crc(frame, 0) ^ crc0;
+            }
+        }
+        frame[0] = MAVLINK_STX;
+        frame[1] = length;
+        frame[2] = 0;
+        frame[3] = mavlink_system.sysid;
+        frame[4] = mavlink_system.compid;
+        frame[5] = msgid;
+        memcpy(&frame[MAVLINK_NUM_HEADER_BYTES], payload, length);
+        frame_put_crc(frame, frame_crc(frame, crc_extra));
+        s->valid = true;
+        framecache_misses++;
+    }
+    s->used = framecache_use[c]++;
+
+    // send it with this channel's sequence number
+    mavlink_status_t *status = mavlink_get_channel_status(chan);
+    uint8_t seq = status->current_tx_seq++;
+    uint16_t crc0 = frame_get_crc(frame);
+    uint16_t checksum = crc0;
+    for (uint8_t b=0; b<8; b++) {
+        if (seq & (1U << b)) {
+            checksum ^= s->seq_crc[b];
+        }
+    }
+    uint16_t total = MAVLINK_NUM_NON_PAYLOAD_BYTES + length;
+    frame[2] = seq;
+    frame_put_crc(frame, checksum);
+    MAVLINK_START_UART_SEND(chan, total);
+    MAVLINK_SEND_UART_BYTES(chan, frame, total);
+    MAVLINK_END_UART_SEND(chan, total);
+    frame[2] = 0;
+    frame_put_crc(frame, crc0);
+}
+
+#else // MAVLINK_FRAMECACHE_SLOTS
+
+void mavlink_send_cached(mavlink_channel_t chan, uint8_t msgid,
+                         const void *payload, uint8_t length, uint8_t crc_extra)
+{
+    _mav_finalize_message_chan_send(chan, msgid, (const char *)payload, length, crc_extra);
+}
+
+#endif // MAVLINK_FRAMECACHE_SLOTS
+
+uint32_t mavlink_framecache_hits(void)
+{
+    return framecache_hits;
+}
+
+uint32_t mavlink_framecache_misses(void)
+{
+    return framecache_misses;
+}
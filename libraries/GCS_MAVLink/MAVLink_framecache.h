@@ -0,0 +1,96 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	MAVLink_framecache.h
+/// @brief	cache of whole frames of messages that are sent often but rarely change
+
+#ifndef MAVLINK_FRAMECACHE_H
+#define MAVLINK_FRAMECACHE_H
+
+// frames kept for each channel. The AVR boards can't spare the RAM, so
+// they pack every message as before
+#ifndef MAVLINK_FRAMECACHE_SLOTS
+# if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+#  define MAVLINK_FRAMECACHE_SLOTS 0
+# else
+#  define MAVLINK_FRAMECACHE_SLOTS 4
+# endif
+#endif
+
+// the longest payload that is cached. Longer messages are sent as usual
+#define MAVLINK_FRAMECACHE_PAYLOAD  32
+
+/*
+  A message sent through the cache is looked for among the frames last
+  sent on its channel with the same id, length, system and component,
+  comparing the payload itself. When it is there only the sequence
+  number of the frame is changed, and the checksum is patched for it
+  from the change each bit of the sequence number makes, which is
+  worked out once per slot. The checksum is linear in the bytes, so
+  that doesn't depend on the rest of the frame. Otherwise the frame is
+  built and checksummed as usual and replaces the oldest one.
+
+  The payload is given as the message's struct, which is the wire
+  layout on the little endian boards we run on.
+ */
+void mavlink_send_cached(mavlink_channel_t chan, uint8_t msgid,
+                         const void *payload, uint8_t length, uint8_t crc_extra);
+
+// frames sent from the cache, and frames that had to be built
+uint32_t mavlink_framecache_hits(void);
+uint32_t mavlink_framecache_misses(void);
+
+/*
+  the messages sent through the cache, with the arguments of their
+  mavlink_msg_*_send() functions
+ */
+static inline void mavlink_msg_heartbeat_send_cached(mavlink_channel_t chan, uint8_t type, uint8_t autopilot,
+                                                     uint8_t base_mode, uint32_t custom_mode, uint8_t system_status)
+{
+#if MAVLINK_FRAMECACHE_SLOTS > 0 && !MAVLINK_NEED_BYTE_SWAP
+    mavlink_heartbeat_t packet;
+    packet.custom_mode = custom_mode;
+    packet.type = type;
+    packet.autopilot = autopilot;
+    packet.base_mode = base_mode;
+    packet.system_status = system_status;
+    packet.mavlink_version = 3;
+    mavlink_send_cached(chan, MAVLINK_MSG_ID_HEARTBEAT, &packet,
+                        MAVLINK_MSG_ID_HEARTBEAT_LEN, MAVLINK_MSG_ID_HEARTBEAT_CRC);
+#else
+    mavlink_msg_heartbeat_send(chan, type, autopilot, base_mode, custom_mode, system_status);
+#endif
+}
+
+static inline void mavlink_msg_sys_status_send_cached(mavlink_channel_t chan, uint32_t onboard_control_sensors_present,
+                                                      uint32_t onboard_control_sensors_enabled, uint32_t onboard_control_sensors_health,
+                                                      uint16_t load, uint16_t voltage_battery, int16_t current_battery,
+                                                      int8_t battery_remaining, uint16_t drop_rate_comm, uint16_t errors_comm,
+                                                      uint16_t errors_count1, uint16_t errors_count2, uint16_t errors_count3,
+                                                      uint16_t errors_count4)
+{
+#if MAVLINK_FRAMECACHE_SLOTS > 0 && !MAVLINK_NEED_BYTE_SWAP
+    mavlink_sys_status_t packet;
+    packet.onboard_control_sensors_present = onboard_control_sensors_present;
+    packet.onboard_control_sensors_enabled = onboard_control_sensors_enabled;
+    packet.onboard_control_sensors_health = onboard_control_sensors_health;
+    packet.load = load;
+    packet.voltage_battery = voltage_battery;
+    packet.current_battery = current_battery;
+    packet.drop_rate_comm = drop_rate_comm;
+    packet.errors_comm = errors_comm;
+    packet.errors_count1 = errors_count1;
+    packet.errors_count2 = errors_count2;
+    packet.errors_count3 = errors_count3;
+    packet.errors_count4 = errors_count4;
+    packet.battery_remaining = battery_remaining;
+    mavlink_send_cached(chan, MAVLINK_MSG_ID_SYS_STATUS, &packet,
+                        MAVLINK_MSG_ID_SYS_STATUS_LEN, MAVLINK_MSG_ID_SYS_STATUS_CRC);
+#else
+    mavlink_msg_sys_status_send(chan, onboard_control_sensors_present, onboard_control_sensors_enabled,
+                                onboard_control_sensors_health, load, voltage_battery, current_battery,
+                                battery_remaining, drop_rate_comm, errors_comm,
+                                errors_count1, errors_count2, errors_count3, errors_count4);
+#endif
+}
+
+#endif // MAVLINK_FRAMECACHE_H
@@ -0,0 +1,172 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	MAVLink_parser.cpp
+
+/*
+This firmware is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+*/
+
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <GCS_MAVLink.h>
+
+/*
+  the X.25 CRC of each byte value, so that
+  crc = (crc >> 8) ^ table[(crc ^ byte) & 0xFF]
+  gives the same result as crc_accumulate()
+ */
+static const uint16_t crc_x25_table[256] PROGMEM = {
+    0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+    0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+    0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+    0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+    0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+    0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+    0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+    0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+    0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+    0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+    0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+    0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+    0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+    0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+    0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+    0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+    0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+    0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+    0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+    0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+    0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+    0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+    0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+    0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+    0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+    0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+    0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+    0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+    0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+    0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+    0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+    0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+};
+
+// offsets of the header fields in a frame
+#define FRAME_STX       0
+#define FRAME_LEN       1
+#define FRAME_SEQ       2
+#define FRAME_SYSID     3
+#define FRAME_COMPID    4
+#define FRAME_MSGID     5
+
+MAVLink_parser::MAVLink_parser() :
+    _start(0),
+    _len(0),
+    _crlf_count(0),
+    _errors(0)
+{
+}
+
+uint16_t MAVLink_parser::crc_x25(const uint8_t *buf, uint8_t len, uint16_t crc)
+{
+    while (len--) {
+        crc = (crc >> 8) ^ pgm_read_word(&crc_x25_table[(uint8_t)(crc ^ *buf++)]);
+    }
+    return crc;
+}
+
+uint16_t MAVLink_parser::take_errors(void)
+{
+    uint16_t ret = _errors;
+    _errors = 0;
+    return ret;
+}
+
+/*
+  move _start to the next STX, or the end of the buffer if there is
+  none, counting the line endings passed over
+ */
+void MAVLink_parser::skip_to_stx(void)
+{
+    const uint8_t *p = &_buf[_start];
+    uint8_t n = _len - _start;
+    const uint8_t *stx = (const uint8_t *)memchr(p, MAVLINK_STX, n);
+    uint8_t end = stx ? stx - _buf : _len;
+    for (uint8_t i=_start; i<end; i++) {
+        if (_buf[i] == '\r' || _buf[i] == '\n') {
+            if (_crlf_count < 255) {
+                _crlf_count++;
+            }
+        } else {
+            _crlf_count = 0;
+        }
+    }
+    _start = end;
+}
+
+/*
+  move what is left to the front of the buffer and read as much as fits
+  behind it. Returns false if nothing more came
+ */
+bool MAVLink_parser::top_up(AP_HAL::Stream *port)
+{
+    if (_start != 0) {
+        memmove(_buf, &_buf[_start], _len - _start);
+        _len -= _start;
+        _start = 0;
+    }
+    uint16_t n = port->read(&_buf[_len], sizeof(_buf) - _len);
+    _len += n;
+    return n != 0;
+}
+
+bool MAVLink_parser::receive(AP_HAL::Stream *port, mavlink_message_t &msg)
+{
+    for (;;) {
+        skip_to_stx();
+
+        uint8_t avail = _len - _start;
+        if (avail > FRAME_LEN) {
+            const uint8_t *frame = &_buf[_start];
+            uint8_t len = frame[FRAME_LEN];
+            if (len > MAVLINK_MAX_PAYLOAD_LEN) {
+                // can't be a frame we take, so the STX was data
+                _errors++;
+                _start++;
+                continue;
+            }
+            if (avail >= len + MAVLINK_NUM_NON_PAYLOAD_BYTES) {
+                uint16_t crc = crc_x25(&frame[FRAME_LEN], len + MAVLINK_CORE_HEADER_LEN, X25_INIT_CRC);
+#if MAVLINK_CRC_EXTRA
+                uint8_t crc_extra = MAVLINK_MESSAGE_CRC(frame[FRAME_MSGID]);
+                crc = crc_x25(&crc_extra, 1, crc);
+#endif
+                const uint8_t *ck = &frame[MAVLINK_NUM_HEADER_BYTES + len];
+                if (ck[0] != (crc & 0xFF) || ck[1] != (crc >> 8)) {
+                    _errors++;
+                    _start++;
+                    continue;
+                }
+                msg.magic    = MAVLINK_STX;
+                msg.len      = len;
+                msg.seq      = frame[FRAME_SEQ];
+                msg.sysid    = frame[FRAME_SYSID];
+                msg.compid   = frame[FRAME_COMPID];
+                msg.msgid    = frame[FRAME_MSGID];
+                msg.checksum = crc;
+                // the checksum bytes follow the payload, as mavlink_parse_char() leaves them
+                memcpy(_MAV_PAYLOAD_NON_CONST(&msg), &frame[MAVLINK_NUM_HEADER_BYTES], len + MAVLINK_NUM_CHECKSUM_BYTES);
+                _start += len + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+                _crlf_count = 0;
+                return true;
+            }
+        }
+
+        // not a whole frame yet
+        if (!top_up(port)) {
+            return false;
+        }
+    }
+}
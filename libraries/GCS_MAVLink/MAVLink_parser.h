@@ -0,0 +1,63 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	MAVLink_parser.h
+/// @brief	parser of whole MAVLink frames from a buffer of received bytes
+
+#ifndef MAVLINK_PARSER_H
+#define MAVLINK_PARSER_H
+
+#define MAVLINK_PARSER_FRAME_LEN (MAVLINK_MAX_PAYLOAD_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES)
+
+// bytes held between calls. At least one frame, so any frame fits
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+# define MAVLINK_PARSER_BUFFER  MAVLINK_PARSER_FRAME_LEN
+#else
+# define MAVLINK_PARSER_BUFFER  (2*MAVLINK_PARSER_FRAME_LEN)
+#endif
+
+/*
+  Bytes are read from the port into a buffer a block at a time. The
+  start of a frame is found with memchr(), its length checked, and
+  once the whole frame is in the buffer its checksum is calculated in
+  one pass with a table of the X.25 CRC. A frame with a bad length or
+  checksum is skipped a byte at a time to find the next start.
+
+  This does the job of mavlink_parse_char() for the GCS links, which
+  handle each byte with a read() call and a step of a state machine.
+ */
+class MAVLink_parser
+{
+public:
+    MAVLink_parser();
+
+    /*
+      take in what is waiting on the port and return the next whole
+      message, if any. Call until it returns false
+     */
+    bool receive(AP_HAL::Stream *port, mavlink_message_t &msg);
+
+    // bad frames since the last call
+    uint16_t take_errors(void);
+
+    /*
+      number of CR or LF bytes in a row received outside frames, so a
+      user pressing enter can be told from MAVLink traffic
+     */
+    uint8_t crlf_count(void) const { return _crlf_count; }
+    void reset_crlf_count(void) { _crlf_count = 0; }
+
+    // the X.25 CRC of a buffer, carried on from crc
+    static uint16_t crc_x25(const uint8_t *buf, uint8_t len, uint16_t crc);
+
+private:
+    uint8_t _buf[MAVLINK_PARSER_BUFFER];
+    uint8_t _start;                 // the first byte not yet parsed
+    uint8_t _len;                   // bytes in _buf
+    uint8_t _crlf_count;
+    uint16_t _errors;
+
+    void skip_to_stx(void);
+    bool top_up(AP_HAL::Stream *port);
+};
+
+#endif // MAVLINK_PARSER_H
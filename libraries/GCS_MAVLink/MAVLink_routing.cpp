@@ -0,0 +1,197 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	MAVLink_routing.cpp
+
+/*
+This firmware is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+*/
+
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <GCS_MAVLink.h>
+
+/*
+  the payload offsets of the target_system and target_component fields
+  of the messages which have them, from the message definitions in
+  include/mavlink/v1.0. 0xFF for no target_component. This needs
+  updating when messages with targets are added
+ */
+static const struct target_offsets {
+    uint8_t msgid;
+    uint8_t target_system;
+    uint8_t target_component;
+} target_offsets[] PROGMEM = {
+    { MAVLINK_MSG_ID_PING,                              12, 13 },
+    { MAVLINK_MSG_ID_CHANGE_OPERATOR_CONTROL,            0, 0xFF },
+    { MAVLINK_MSG_ID_SET_MODE,                           4, 0xFF },
+    { MAVLINK_MSG_ID_PARAM_REQUEST_READ,                 2, 3 },
+    { MAVLINK_MSG_ID_PARAM_REQUEST_LIST,                 0, 1 },
+    { MAVLINK_MSG_ID_PARAM_SET,                          4, 5 },
+    { MAVLINK_MSG_ID_MISSION_REQUEST_PARTIAL_LIST,       4, 5 },
+    { MAVLINK_MSG_ID_MISSION_WRITE_PARTIAL_LIST,         4, 5 },
+    { MAVLINK_MSG_ID_MISSION_ITEM,                      32, 33 },
+    { MAVLINK_MSG_ID_MISSION_REQUEST,                    2, 3 },
+    { MAVLINK_MSG_ID_MISSION_SET_CURRENT,                2, 3 },
+    { MAVLINK_MSG_ID_MISSION_REQUEST_LIST,               0, 1 },
+    { MAVLINK_MSG_ID_MISSION_COUNT,                      2, 3 },
+    { MAVLINK_MSG_ID_MISSION_CLEAR_ALL,                  0, 1 },
+    { MAVLINK_MSG_ID_MISSION_ACK,                        0, 1 },
+    { MAVLINK_MSG_ID_SET_GPS_GLOBAL_ORIGIN,             12, 0xFF },
+    { MAVLINK_MSG_ID_SET_LOCAL_POSITION_SETPOINT,       16, 17 },
+    { MAVLINK_MSG_ID_SAFETY_SET_ALLOWED_AREA,           24, 25 },
+    { MAVLINK_MSG_ID_SET_ROLL_PITCH_YAW_THRUST,         16, 17 },
+    { MAVLINK_MSG_ID_SET_ROLL_PITCH_YAW_SPEED_THRUST,   16, 17 },
+    { MAVLINK_MSG_ID_SET_QUAD_MOTORS_SETPOINT,           8, 0xFF },
+    { MAVLINK_MSG_ID_REQUEST_DATA_STREAM,                2, 3 },
+    { MAVLINK_MSG_ID_RC_CHANNELS_OVERRIDE,              16, 17 },
+    { MAVLINK_MSG_ID_COMMAND_LONG,                      30, 31 },
+    { MAVLINK_MSG_ID_SETPOINT_8DOF,                     32, 0xFF },
+    { MAVLINK_MSG_ID_SETPOINT_6DOF,                     24, 0xFF },
+    { MAVLINK_MSG_ID_SET_MAG_OFFSETS,                    6, 7 },
+    { MAVLINK_MSG_ID_DIGICAM_CONFIGURE,                  6, 7 },
+    { MAVLINK_MSG_ID_DIGICAM_CONTROL,                    4, 5 },
+    { MAVLINK_MSG_ID_MOUNT_CONFIGURE,                    0, 1 },
+    { MAVLINK_MSG_ID_MOUNT_CONTROL,                     12, 13 },
+    { MAVLINK_MSG_ID_MOUNT_STATUS,                      12, 13 },
+    { MAVLINK_MSG_ID_FENCE_POINT,                        8, 9 },
+    { MAVLINK_MSG_ID_FENCE_FETCH_POINT,                  0, 1 },
+};
+
+// the slot a system and component hash to
+#define ROUTE_HASH(sysid, compid) (((sysid) * 31U + (compid)) & (MAVLINK_MAX_ROUTES-1))
+
+MAVLink_routing::MAVLink_routing() :
+    active_channels(0)
+{
+    memset(routes, 0, sizeof(routes));
+}
+
+/*
+  find the target of a message. Returns false for messages without one,
+  which go to everyone
+ */
+static bool get_targets(const mavlink_message_t *msg, uint8_t &sysid, uint8_t &compid)
+{
+    // the table is sorted by message id
+    uint8_t low = 0, high = sizeof(target_offsets)/sizeof(target_offsets[0]);
+    while (low < high) {
+        uint8_t mid = (low + high) / 2;
+        uint8_t msgid = pgm_read_byte(&target_offsets[mid].msgid);
+        if (msgid < msg->msgid) {
+            low = mid + 1;
+        } else if (msgid > msg->msgid) {
+            high = mid;
+        } else {
+            const uint8_t *payload = (const uint8_t *)_MAV_PAYLOAD(msg);
+            uint8_t ofs = pgm_read_byte(&target_offsets[mid].target_system);
+            uint8_t cofs = pgm_read_byte(&target_offsets[mid].target_component);
+            if (ofs >= msg->len) {
+                return false;
+            }
+            sysid = payload[ofs];
+            compid = (cofs < msg->len) ? payload[cofs] : 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+  remember which channel the sender of a message is on
+ */
+void MAVLink_routing::learn_route(mavlink_channel_t in_channel, const mavlink_message_t *msg)
+{
+    if (msg->sysid == 0 || msg->sysid == mavlink_system.sysid) {
+        // not a system we can route to
+        return;
+    }
+    active_channels |= 1U << in_channel;
+
+    // open addressing with linear probing. When the table is full the
+    // hashed slot is reused
+    uint8_t h = ROUTE_HASH(msg->sysid, msg->compid);
+    for (uint8_t i=0; i<MAVLINK_MAX_ROUTES; i++) {
+        struct route &r = routes[(h + i) & (MAVLINK_MAX_ROUTES-1)];
+        if (r.sysid == 0 || (r.sysid == msg->sysid && r.compid == msg->compid)) {
+            r.sysid = msg->sysid;
+            r.compid = msg->compid;
+            r.channel = in_channel;
+            return;
+        }
+    }
+    struct route &r = routes[h];
+    r.sysid = msg->sysid;
+    r.compid = msg->compid;
+    r.channel = in_channel;
+}
+
+/*
+  return a bitmask of the channels a system and component are on. A
+  compid of 0 means every component of the system
+ */
+uint8_t MAVLink_routing::find_channels(uint8_t sysid, uint8_t compid) const
+{
+    uint8_t ret = 0;
+    if (compid == 0) {
+        for (uint8_t i=0; i<MAVLINK_MAX_ROUTES; i++) {
+            if (routes[i].sysid == sysid) {
+                ret |= 1U << routes[i].channel;
+            }
+        }
+        return ret;
+    }
+    uint8_t h = ROUTE_HASH(sysid, compid);
+    for (uint8_t i=0; i<MAVLINK_MAX_ROUTES; i++) {
+        const struct route &r = routes[(h + i) & (MAVLINK_MAX_ROUTES-1)];
+        if (r.sysid == 0) {
+            break;
+        }
+        if (r.sysid == sysid && r.compid == compid) {
+            ret = 1U << r.channel;
+            break;
+        }
+    }
+    return ret;
+}
+
+/*
+  send a message on as it arrived, if there is room for all of it
+ */
+void MAVLink_routing::forward(mavlink_channel_t out_channel, const mavlink_message_t *msg) const
+{
+    if (comm_get_txspace(out_channel) >= msg->len + MAVLINK_NUM_NON_PAYLOAD_BYTES) {
+        _mavlink_resend_uart(out_channel, msg);
+    }
+}
+
+bool MAVLink_routing::check_and_forward(mavlink_channel_t in_channel, const mavlink_message_t *msg)
+{
+    learn_route(in_channel, msg);
+
+    uint8_t target_sysid, target_compid;
+    uint8_t out_channels;
+    bool local;
+    if (!get_targets(msg, target_sysid, target_compid) || target_sysid == 0) {
+        // a broadcast goes to every channel with other systems on it
+        out_channels = active_channels;
+        local = true;
+    } else if (target_sysid == mavlink_system.sysid) {
+        out_channels = 0;
+        local = true;
+    } else {
+        out_channels = find_channels(target_sysid, target_compid);
+        local = false;
+    }
+
+    // never send a message back the way it came
+    out_channels &= ~(1U << in_channel);
+    for (uint8_t chan=0; chan<MAVLINK_COMM_NUM_BUFFERS; chan++) {
+        if (out_channels & (1U << chan)) {
+            forward((mavlink_channel_t)chan, msg);
+        }
+    }
+    return local;
+}
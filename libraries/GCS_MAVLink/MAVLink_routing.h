@@ -0,0 +1,47 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	MAVLink_routing.h
+/// @brief	forwarding of MAVLink messages between the MAVLink channels
+
+#ifndef MAVLINK_ROUTING_H
+#define MAVLINK_ROUTING_H
+
+// number of systems and components we can remember. Must be a power of two
+#define MAVLINK_MAX_ROUTES 16
+
+/*
+  The router learns which channel each system and component talks on
+  from the messages it receives, and passes on messages meant for
+  systems on other channels, such as a gimbal or companion computer
+  on a second port. Messages are sent on as they arrived, without
+  being unpacked and packed again.
+ */
+class MAVLink_routing
+{
+public:
+    MAVLink_routing();
+
+    /*
+      learn the sender of a message received on in_channel and forward
+      the message to any other channels it is for. Returns true if the
+      message is also for this system, so should be handled locally
+     */
+    bool check_and_forward(mavlink_channel_t in_channel, const mavlink_message_t *msg);
+
+private:
+    // a system and component seen on a channel. sysid 0 marks an empty slot
+    struct route {
+        uint8_t sysid;
+        uint8_t compid;
+        uint8_t channel;
+    } routes[MAVLINK_MAX_ROUTES];
+
+    // bitmask of the channels on which we have seen other systems
+    uint8_t active_channels;
+
+    void learn_route(mavlink_channel_t in_channel, const mavlink_message_t *msg);
+    uint8_t find_channels(uint8_t sysid, uint8_t compid) const;
+    void forward(mavlink_channel_t out_channel, const mavlink_message_t *msg) const;
+};
+
+#endif // MAVLINK_ROUTING_H
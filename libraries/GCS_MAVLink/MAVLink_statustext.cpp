@@ -0,0 +1,161 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	MAVLink_statustext.cpp
+
+/*
+This firmware is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+*/
+
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <GCS_MAVLink.h>
+
+extern const AP_HAL::HAL& hal;
+
+/*
+  the least time between texts on a channel for each severity, in
+  16ms ticks, indexed by gcs_severity
+ */
+static const uint8_t send_interval_ticks[] PROGMEM = {
+    0,
+    6,      // SEVERITY_LOW
+    3,      // SEVERITY_MEDIUM
+    0,      // SEVERITY_HIGH
+    0,      // SEVERITY_CRITICAL
+    0,      // SEVERITY_USER_RESPONSE
+};
+
+MAVLink_statustext::MAVLink_statustext() :
+    _next_seq(0),
+    _suppressed(0),
+    _dropped(0)
+{
+    memset(_entries, 0, sizeof(_entries));
+    memset(_last_send_tick, 0, sizeof(_last_send_tick));
+}
+
+/*
+  the slot for a new text: the oldest free one, or else the oldest
+  waiting text of lower severity. Returns -1 if there is none
+ */
+int8_t MAVLink_statustext::find_slot(uint8_t severity) const
+{
+    int8_t best = -1;
+    uint8_t best_age = 0;
+    bool best_free = false;
+    for (uint8_t i=0; i<MAVLINK_STATUSTEXT_QUEUE; i++) {
+        const struct entry &e = _entries[i];
+        bool is_free = (e.waiting == 0);
+        if (!is_free && e.severity >= severity) {
+            continue;
+        }
+        uint8_t age = _next_seq - e.seq;
+        if (best == -1 || (is_free && !best_free) ||
+            (is_free == best_free && age > best_age)) {
+            best = i;
+            best_age = age;
+            best_free = is_free;
+        }
+    }
+    return best;
+}
+
+bool MAVLink_statustext::queue(mavlink_channel_t chan, uint8_t severity, const char *text)
+{
+    uint8_t bit = 1U << (uint8_t)chan;
+    uint16_t tick = hal.scheduler->millis() >> 4;
+
+    for (uint8_t i=0; i<MAVLINK_STATUSTEXT_QUEUE; i++) {
+        struct entry &e = _entries[i];
+        if (e.seen == 0 ||
+            (uint16_t)(tick - e.tick) >= MAVLINK_STATUSTEXT_DUP_TICKS ||
+            strncmp(e.text, text, sizeof(e.text)) != 0) {
+            continue;
+        }
+        if (e.seen & bit) {
+            // a repeat
+            _suppressed++;
+            return false;
+        }
+        // the same text for another channel, which shares the slot
+        e.seen |= bit;
+        e.waiting |= bit;
+        if (severity > e.severity) {
+            e.severity = severity;
+        }
+        return true;
+    }
+
+    int8_t slot = find_slot(severity);
+    if (slot == -1) {
+        _dropped++;
+        return false;
+    }
+    struct entry &e = _entries[slot];
+    if (e.waiting != 0) {
+        // pushing out a less important text
+        _dropped++;
+    }
+    e.waiting = bit;
+    e.seen = bit;
+    e.severity = severity;
+    e.seq = _next_seq++;
+    e.tick = tick;
+    strncpy(e.text, text, sizeof(e.text));
+    return true;
+}
+
+bool MAVLink_statustext::pending(mavlink_channel_t chan) const
+{
+    uint8_t bit = 1U << (uint8_t)chan;
+    for (uint8_t i=0; i<MAVLINK_STATUSTEXT_QUEUE; i++) {
+        if (_entries[i].waiting & bit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+  of the texts whose rate allows them to go now, the most severe goes
+  first, and the oldest of those
+ */
+void MAVLink_statustext::send(mavlink_channel_t chan)
+{
+    uint8_t bit = 1U << (uint8_t)chan;
+    uint16_t tick = hal.scheduler->millis() >> 4;
+    uint16_t since_last = tick - _last_send_tick[(uint8_t)chan];
+    int8_t best = -1;
+    uint8_t best_age = 0;
+
+    for (uint8_t i=0; i<MAVLINK_STATUSTEXT_QUEUE; i++) {
+        const struct entry &e = _entries[i];
+        if ((e.waiting & bit) == 0) {
+            continue;
+        }
+        uint8_t interval = 0;
+        if (e.severity < sizeof(send_interval_ticks)) {
+            interval = pgm_read_byte(&send_interval_ticks[e.severity]);
+        }
+        if (since_last < interval) {
+            continue;
+        }
+        uint8_t age = _next_seq - e.seq;
+        if (best == -1 || e.severity > _entries[best].severity ||
+            (e.severity == _entries[best].severity && age > best_age)) {
+            best = i;
+            best_age = age;
+        }
+    }
+    if (best == -1) {
+        return;
+    }
+
+    struct entry &e = _entries[best];
+    mavlink_msg_statustext_send(chan, e.severity, e.text);
+    e.waiting &= ~bit;
+    _last_send_tick[(uint8_t)chan] = tick;
+}
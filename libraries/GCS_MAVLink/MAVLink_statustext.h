@@ -0,0 +1,77 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	MAVLink_statustext.h
+/// @brief	queue of STATUSTEXT messages waiting to be sent on the MAVLink channels
+
+#ifndef MAVLINK_STATUSTEXT_H
+#define MAVLINK_STATUSTEXT_H
+
+// number of texts that can wait at once, shared by the channels
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+# define MAVLINK_STATUSTEXT_QUEUE   3
+#else
+# define MAVLINK_STATUSTEXT_QUEUE   8
+#endif
+
+#define MAVLINK_STATUSTEXT_CHANNELS     2
+#define MAVLINK_STATUSTEXT_LEN          50      // the text field of STATUSTEXT
+#define MAVLINK_STATUSTEXT_DUP_TICKS    128     // a repeat of a text within this many 16ms ticks is suppressed
+
+/*
+  Texts are queued for the channels they are meant for and sent one at
+  a time from the deferred message handling, when there is room on the
+  link. A text that is the same as one sent or waiting in the last two
+  seconds is counted and thrown away, so a warning repeated every loop
+  goes out once every two seconds. Low severity texts go out no faster
+  than one every 100ms on each channel, leaving the link to telemetry.
+  When the queue is full a text replaces the oldest waiting text of
+  lower severity, or is counted and thrown away if there is none.
+ */
+class MAVLink_statustext
+{
+public:
+    MAVLink_statustext();
+
+    /*
+      queue a text for a channel. Returns false if it was suppressed
+      as a repeat or dropped for lack of room
+     */
+    bool queue(mavlink_channel_t chan, uint8_t severity, const char *text);
+
+    // true if any text is waiting for the channel
+    bool pending(mavlink_channel_t chan) const;
+
+    /*
+      send the oldest text waiting for the channel, if its severity's
+      rate allows. The caller must have checked there is room for a
+      STATUSTEXT message
+     */
+    void send(mavlink_channel_t chan);
+
+    // texts thrown away as repeats
+    uint16_t suppressed() const { return _suppressed; }
+
+    // texts thrown away because the queue was full
+    uint16_t dropped() const { return _dropped; }
+
+private:
+    // a text, which stays after it is sent to catch repeats. Slots
+    // with no waiting channels are free
+    struct entry {
+        uint8_t waiting;        // bitmask of the channels it is still to go to
+        uint8_t seen;           // bitmask of the channels it has been queued for
+        uint8_t severity;
+        uint8_t seq;            // order of queuing
+        uint16_t tick;          // when it was queued, in 16ms ticks
+        char text[MAVLINK_STATUSTEXT_LEN];
+    } _entries[MAVLINK_STATUSTEXT_QUEUE];
+
+    uint8_t _next_seq;
+    uint16_t _last_send_tick[MAVLINK_STATUSTEXT_CHANNELS];
+    uint16_t _suppressed;
+    uint16_t _dropped;
+
+    int8_t find_slot(uint8_t severity) const;
+};
+
+#endif // MAVLINK_STATUSTEXT_H
@@ -84,6 +84,7 @@ RC_Channel::set_range(int16_t low, int16_t high)
     _low            = low;
     _high_out       = high;
     _low_out        = low;
+    _scaling_valid  = false;
 }
 
 void
@@ -91,6 +92,7 @@ RC_Channel::set_range_out(int16_t low, int16_t high)
 {
     _high_out       = high;
     _low_out        = low;
+    _scaling_valid  = false;
 }
 
 void
@@ -98,6 +100,7 @@ RC_Channel::set_angle(int16_t angle)
 {
     _type   = RC_CHANNEL_TYPE_ANGLE;
     _high   = angle;
+    _scaling_valid = false;
 }
 
 void
@@ -126,6 +129,7 @@ void
 RC_Channel::set_type(uint8_t t)
 {
     _type = t;
+    _scaling_valid = false;
 }
 
 // call after first read
@@ -178,24 +182,98 @@ RC_Channel::get_failsafe(void)
     return (radio_in < (radio_min - 50));
 }
 
+// the Q16 scale of span/den, rounded up so a product with it is the
+// quotient of the division or one more
+static int32_t output_scale(int16_t span, int16_t den)
+{
+    if (den == 0) {
+        return 0;
+    }
+    int32_t num = (int32_t)span << 16;
+    return num >= 0 ? (num + den - 1) / den : (num - den + 1) / den;
+}
+
+// v * span / den, rounded towards zero as the divisions of
+// range_to_pwm() and angle_to_pwm() are, from the Q16 scale of
+// span/den. The product with the scale can be one over, which a
+// multiply checks for
+static inline int16_t scale_servo_out(int16_t v, int32_t scale, int16_t span, int16_t den)
+{
+    int32_t a = abs(v);
+    int32_t p = (a * scale) >> 16;
+    if (span > 0 && p * den > a * span) {
+        p--;
+    }
+    return v < 0 ? -p : p;
+}
+
+/*
+  work out the calc_pwm() scaling from the type, ranges and radio
+  parameters. The parameters can be set directly, so they are compared
+  on each call rather than relying on the setters
+ */
+void
+RC_Channel::update_output_scaling(void)
+{
+    _scaled_min     = radio_min;
+    _scaled_trim    = radio_trim;
+    _scaled_max     = radio_max;
+    _scaled_reverse = _reverse;
+
+    if(_type == RC_CHANNEL_TYPE_RANGE) {
+        _span_pos = _span_neg = _scaled_max - _scaled_min;
+        _scale_den = _high_out - _low_out;
+
+    }else if(_type == RC_CHANNEL_TYPE_ANGLE_RAW) {
+        _span_pos = _span_neg = 1;
+        _scale_den = 10;
+
+    }else{     // RC_CHANNEL_TYPE_ANGLE
+        _span_pos = _scaled_max - _scaled_trim;
+        _span_neg = _scaled_trim - _scaled_min;
+        _scale_den = _high;
+    }
+    if (_scale_den < 0) {
+        _span_pos = -_span_pos;
+        _span_neg = -_span_neg;
+        _scale_den = -_scale_den;
+    }
+    _scale_pos = output_scale(_span_pos, _scale_den);
+    _scale_neg = output_scale(_span_neg, _scale_den);
+    _scaling_valid = true;
+}
+
 // returns just the PWM without the offset from radio_min
 void
 RC_Channel::calc_pwm(void)
 {
+    if (!_scaling_valid ||
+        _scaled_min != radio_min ||
+        _scaled_trim != radio_trim ||
+        _scaled_max != radio_max ||
+        _scaled_reverse != _reverse) {
+        update_output_scaling();
+    }
+
     if(_type == RC_CHANNEL_TYPE_RANGE) {
-        pwm_out         = range_to_pwm();
-        radio_out       = (_reverse >= 0) ? (radio_min + pwm_out) : (radio_max - pwm_out);
+        pwm_out         = scale_servo_out(servo_out - _low_out, _scale_pos, _span_pos, _scale_den);
+        radio_out       = (_scaled_reverse >= 0) ? (_scaled_min + pwm_out) : (_scaled_max - pwm_out);
 
     }else if(_type == RC_CHANNEL_TYPE_ANGLE_RAW) {
-        pwm_out         = (float)servo_out * 0.1f;
-        radio_out       = (pwm_out * _reverse) + radio_trim;
+        pwm_out         = scale_servo_out(servo_out, _scale_pos, _span_pos, _scale_den);
+        radio_out       = (pwm_out * _scaled_reverse) + _scaled_trim;
 
     }else{     // RC_CHANNEL_TYPE_ANGLE
-        pwm_out         = angle_to_pwm();
-        radio_out       = pwm_out + radio_trim;
+        int16_t out     = servo_out * _scaled_reverse;
+        if (out > 0) {
+            pwm_out     = scale_servo_out(out, _scale_pos, _span_pos, _scale_den);
+        } else {
+            pwm_out     = scale_servo_out(out, _scale_neg, _span_neg, _scale_den);
+        }
+        radio_out       = pwm_out + _scaled_trim;
     }
 
-    radio_out = constrain_int16(radio_out, radio_min.get(), radio_max.get());
+    radio_out = constrain_int16(radio_out, _scaled_min, _scaled_max);
 }
 
 // ------------------------------------------
@@ -353,6 +431,24 @@ void RC_Channel::output_trim() const
     hal.rcout->write(_ch_out, radio_trim);
 }
 
+void RC_Channel::output_all(RC_Channel *const *channels, uint8_t count)
+{
+    uint16_t period[NUM_CHANNELS];
+    uint8_t i = 0;
+
+    hal.rcout->cork();
+    while (i < count) {
+        // gather the run of channels with consecutive outputs
+        uint8_t first = channels[i]->_ch_out;
+        uint8_t len = 0;
+        while (i < count && len < NUM_CHANNELS && channels[i]->_ch_out == first + len) {
+            period[len++] = channels[i++]->radio_out;
+        }
+        hal.rcout->write(first, period, len);
+    }
+    hal.rcout->push();
+}
+
 void
 RC_Channel::input()
 {
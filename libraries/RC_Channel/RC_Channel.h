@@ -28,7 +28,8 @@ public:
     ///
     RC_Channel(uint8_t ch_out) :
         _high(1),
-        _ch_out(ch_out) {
+        _ch_out(ch_out),
+        _scaling_valid(false) {
 		AP_Param::setup_object_defaults(this, var_info);
         rc_ch[ch_out] = this;
     }
@@ -97,6 +98,10 @@ public:
 
     void                                            output() const;
     void                                            output_trim() const;
+
+    // write the radio_out of a set of channels together, runs of
+    // consecutive output channels in one hal.rcout write
+    static void                                     output_all(RC_Channel *const *channels, uint8_t count);
     uint16_t                                        read() const;
     void                                            input();
     void                                            enable_out();
@@ -115,6 +120,23 @@ private:
     int16_t         _low_out;
     uint8_t         _ch_out;
 
+    // calc_pwm() scaling of servo_out, worked out again by
+    // update_output_scaling() when the values it came from change.
+    // The scales are span/den pwm per unit of servo_out in Q16,
+    // _pos for outputs above trim and _neg below
+    int32_t         _scale_pos;
+    int32_t         _scale_neg;
+    int16_t         _span_pos;
+    int16_t         _span_neg;
+    int16_t         _scale_den;
+    int16_t         _scaled_min;
+    int16_t         _scaled_trim;
+    int16_t         _scaled_max;
+    int8_t          _scaled_reverse;
+    bool            _scaling_valid;
+
+    void            update_output_scaling(void);
+
     static RC_Channel *rc_ch[8];
 };
 
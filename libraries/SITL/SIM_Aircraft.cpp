@@ -0,0 +1,137 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+  parent class for the in-process SITL flight models
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public License
+    as published by the Free Software Foundation; either version 2.1
+    of the License, or (at your option) any later version.
+*/
+
+#include <AP_HAL.h>
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_AVR_SITL
+
+#include "SIM_Aircraft.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+extern const AP_HAL::HAL& hal;
+
+const float Aircraft::gravity = GRAVITY_MSS;
+
+Aircraft::Aircraft(const char *home_str) :
+    ground_level(0),
+    frame_height(0),
+    airspeed(0),
+    mass(0),
+    delta_time(0),
+    _last_time_us(0),
+    _turbulance_mul(1)
+{
+    float yaw_degrees;
+    if (sscanf(home_str, "%lf,%lf,%f,%f",
+               &home_latitude, &home_longitude, &home_altitude, &yaw_degrees) != 4) {
+        fprintf(stderr, "SITL: home should be lat,lng,alt,hdg not '%s'\n", home_str);
+        exit(1);
+    }
+    ground_level = home_altitude;
+    dcm.from_euler(0, 0, ToRad(yaw_degrees));
+}
+
+void Aircraft::update_time(void)
+{
+    uint32_t now = hal.scheduler->micros();
+    if (_last_time_us == 0) {
+        delta_time = 0;
+    } else {
+        delta_time = (now - _last_time_us) * 1.0e-6f;
+    }
+    _last_time_us = now;
+}
+
+bool Aircraft::on_ground(const Vector3f &pos) const
+{
+    // relative to home, as a float altitude AMSL is too coarse to
+    // see the first millimeters of a takeoff
+    return -pos.z <= (ground_level - home_altitude) + frame_height;
+}
+
+Vector3f Aircraft::wind_ef(const struct sitl_input &input)
+{
+    // the gusts are a random walk in a multiplier on the wind speed,
+    // pulled back towards 1 with a 5 second time constant
+    float w_delta = sqrtf(delta_time) * (1.0f - rand_normal(1.0f, input.wind.turbulance));
+    w_delta -= (_turbulance_mul - 1.0f) * (delta_time / 5.0f);
+    _turbulance_mul += w_delta;
+    float speed = input.wind.speed * fabsf(_turbulance_mul);
+    float direction = ToRad(input.wind.direction);
+
+    // the same vector as pysim's util.toVec()
+    return Vector3f(speed * cosf(direction), -speed * sinf(direction), 0);
+}
+
+void Aircraft::normalise_dcm(void)
+{
+    float error = dcm.a * dcm.b;
+    Vector3f t0 = dcm.a - (dcm.b * (0.5f * error));
+    Vector3f t1 = dcm.b - (dcm.a * (0.5f * error));
+    Vector3f t2 = t0 % t1;
+    dcm.a = t0 * (1.0f / t0.length());
+    dcm.b = t1 * (1.0f / t1.length());
+    dcm.c = t2 * (1.0f / t2.length());
+}
+
+// Box-Muller, good enough for sensor and wind noise
+float Aircraft::rand_normal(float mean, float stddev)
+{
+    float u1 = (random() + 1.0f) / (RAND_MAX + 2.0f);
+    float u2 = random() / (RAND_MAX + 1.0f);
+    return mean + stddev * sqrtf(-2.0f * logf(u1)) * cosf(2 * PI * u2);
+}
+
+void Aircraft::fill_fdm(struct sitl_fdm &fdm) const
+{
+    float roll, pitch, yaw;
+    Matrix3f m = dcm;
+    m.to_euler(&roll, &pitch, &yaw);
+
+    // latitude and longitude from the distance and bearing from
+    // home, in double as the float DEG_TO_RAD costs centimeters
+    double bearing = atan2(position.y, position.x);
+    double dr = sqrt(position.x*position.x + position.y*position.y) / RADIUS_OF_EARTH;
+    double lat1 = home_latitude * (M_PI/180.0);
+    double lat2 = asin(sin(lat1)*cos(dr) + cos(lat1)*sin(dr)*cos(bearing));
+    double dlon = atan2(sin(bearing)*sin(dr)*cos(lat1), cos(dr) - sin(lat1)*sin(lat2));
+
+    // body rates to euler angle rates
+    float sin_roll = sinf(roll), cos_roll = cosf(roll);
+    float cos_pitch = cosf(pitch);
+    if (fabsf(cos_pitch) < 1.0e-20f) {
+        cos_pitch = 1.0e-20f;
+    }
+    float roll_rate = gyro.x + tanf(pitch) * (gyro.y * sin_roll + gyro.z * cos_roll);
+    float pitch_rate = gyro.y * cos_roll - gyro.z * sin_roll;
+    float yaw_rate = (gyro.y * sin_roll + gyro.z * cos_roll) / cos_pitch;
+
+    fdm.latitude  = lat2 * (180.0/M_PI);
+    fdm.longitude = home_longitude + dlon * (180.0/M_PI);
+    fdm.altitude  = home_altitude - position.z;
+    fdm.heading   = ToDeg(yaw);
+    fdm.speedN    = velocity_ef.x;
+    fdm.speedE    = velocity_ef.y;
+    fdm.speedD    = velocity_ef.z;
+    fdm.xAccel    = accel_body.x;
+    fdm.yAccel    = accel_body.y;
+    fdm.zAccel    = accel_body.z;
+    fdm.rollRate  = ToDeg(roll_rate);
+    fdm.pitchRate = ToDeg(pitch_rate);
+    fdm.yawRate   = ToDeg(yaw_rate);
+    fdm.rollDeg   = ToDeg(roll);
+    fdm.pitchDeg  = ToDeg(pitch);
+    fdm.yawDeg    = ToDeg(yaw);
+    fdm.airspeed  = airspeed;
+    fdm.magic     = 0x4c56414f;
+}
+
+#endif // CONFIG_HAL_BOARD
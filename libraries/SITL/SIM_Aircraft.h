@@ -0,0 +1,77 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+  parent class for the in-process SITL flight models. These are ports
+  of the Tools/autotest/pysim models, run inside the SITL executable
+  in place of the UDP round trip to an external simulator
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public License
+    as published by the Free Software Foundation; either version 2.1
+    of the License, or (at your option) any later version.
+*/
+
+#ifndef __SIM_AIRCRAFT_H__
+#define __SIM_AIRCRAFT_H__
+
+#include <AP_Math.h>
+#include "SITL.h"
+
+class Aircraft
+{
+public:
+    // home_str is "lat,lng,alt,hdg" in degrees and meters AMSL
+    Aircraft(const char *home_str);
+
+    // inputs to the model for one step
+    struct sitl_input {
+        uint16_t servos[11];
+        struct {
+            float speed;      // m/s
+            float direction;  // degrees, as SIM_WIND_DIR
+            float turbulance; // standard deviation of the gusts
+        } wind;
+    };
+
+    // step the model to the current time
+    virtual void update(const struct sitl_input &input) = 0;
+
+    // the model state in the form the external simulators send it
+    void fill_fdm(struct sitl_fdm &fdm) const;
+
+protected:
+    double home_latitude, home_longitude; // degrees
+    float home_altitude;                  // meters AMSL
+    float ground_level;
+    float frame_height;
+
+    Matrix3f dcm;          // body to earth
+    Vector3f gyro;         // rad/s in body frame
+    Vector3f velocity_ef;  // m/s, north, east, down
+    Vector3f position;     // m from home, north, east, down
+    Vector3f accel_body;   // what the accelerometers see, m/s/s
+    float airspeed;        // m/s
+    float mass;            // kg
+    float delta_time;      // seconds since the last update
+
+    static const float gravity;
+
+    // work out delta_time from the scheduler clock
+    void update_time(void);
+
+    bool on_ground(const Vector3f &pos) const;
+
+    // the wind velocity in earth frame, with the turbulance random
+    // walk of pysim's util.Wind
+    Vector3f wind_ef(const struct sitl_input &input);
+
+    // re-orthonormalise dcm after a rotate()
+    void normalise_dcm(void);
+
+    static float rand_normal(float mean, float stddev);
+
+private:
+    uint32_t _last_time_us;
+    float _turbulance_mul;
+};
+
+#endif // __SIM_AIRCRAFT_H__
@@ -0,0 +1,188 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+  multicopter simulator class
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public License
+    as published by the Free Software Foundation; either version 2.1
+    of the License, or (at your option) any later version.
+*/
+
+#include <AP_HAL.h>
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_AVR_SITL
+
+#include "SIM_Multicopter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const MultiCopter::motor quad_plus_motors[] = {
+    {  90, false, 1 },
+    { 270, false, 2 },
+    {   0, true,  3 },
+    { 180, true,  4 }
+};
+
+static const MultiCopter::motor quad_x_motors[] = {
+    {  45, false, 1 },
+    { 225, false, 2 },
+    { -45, true,  3 },
+    { 135, true,  4 }
+};
+
+static const MultiCopter::motor y6_motors[] = {
+    {  60, false, 1 },
+    {  60, true,  7 },
+    { 180, true,  4 },
+    { 180, false, 8 },
+    { -60, true,  2 },
+    { -60, false, 3 }
+};
+
+static const MultiCopter::motor hexa_motors[] = {
+    {   0, true,  1 },
+    {  60, false, 4 },
+    { 120, true,  8 },
+    { 180, false, 2 },
+    { 240, true,  3 },
+    { 300, false, 7 }
+};
+
+static const MultiCopter::motor hexax_motors[] = {
+    {  30, false, 7 },
+    {  90, true,  1 },
+    { 150, false, 4 },
+    { 210, true,  8 },
+    { 270, false, 2 },
+    { 330, true,  3 }
+};
+
+static const MultiCopter::motor octa_motors[] = {
+    {    0, true,  1 },
+    {  180, true,  2 },
+    {   45, false, 3 },
+    {  135, false, 4 },
+    {  -45, false, 7 },
+    { -135, false, 8 },
+    {  270, true, 10 },
+    {   90, true, 11 }
+};
+
+static const MultiCopter::motor octax_motors[] = {
+    {   22.5f, true,  1 },
+    {  202.5f, true,  2 },
+    {   67.5f, false, 3 },
+    {  157.5f, false, 4 },
+    {  -22.5f, false, 7 },
+    { -112.5f, false, 8 },
+    {  292.5f, true, 10 },
+    {  112.5f, true, 11 }
+};
+
+static const struct {
+    const char *name;
+    const MultiCopter::motor *motors;
+    uint8_t num_motors;
+} frames[] = {
+    { "+",     quad_plus_motors, 4 },
+    { "quad",  quad_plus_motors, 4 },
+    { "x",     quad_x_motors,    4 },
+    { "y6",    y6_motors,        6 },
+    { "hexa",  hexa_motors,      6 },
+    { "hexax", hexax_motors,     6 },
+    { "octa",  octa_motors,      8 },
+    { "octax", octax_motors,     8 }
+};
+
+MultiCopter::MultiCopter(const char *home_str, const char *frame_str) :
+    Aircraft(home_str),
+    _motors(NULL),
+    _hover_throttle(0.45f),
+    _terminal_velocity(15.0f),
+    _terminal_rotation_rate(4*radians(360.0f))
+{
+    for (uint8_t i=0; i<sizeof(frames)/sizeof(frames[0]); i++) {
+        if (strcasecmp(frame_str, frames[i].name) == 0) {
+            _motors = frames[i].motors;
+            _num_motors = frames[i].num_motors;
+        }
+    }
+    if (_motors == NULL) {
+        fprintf(stderr, "SITL: unknown multicopter frame type '%s'\n", frame_str);
+        exit(1);
+    }
+    mass = 1.5f;
+    frame_height = 0.1f;
+
+    // scaling from total motor power to Newtons. Allows the copter
+    // to hover against gravity when each motor is at hover_throttle
+    _thrust_scale = (mass * gravity) / (_num_motors * _hover_throttle);
+}
+
+void MultiCopter::update(const struct sitl_input &input)
+{
+    update_time();
+
+    // rotational acceleration, in rad/s/s, in body frame
+    Vector3f rot_accel;
+    float thrust = 0; // newtons
+
+    for (uint8_t i=0; i<_num_motors; i++) {
+        float m = constrain_float((input.servos[_motors[i].servo-1] - 1000) / 1000.0f, 0, 1);
+        float angle = radians(_motors[i].angle);
+        rot_accel.x += -radians(5000.0f) * sinf(angle) * m;
+        rot_accel.y +=  radians(5000.0f) * cosf(angle) * m;
+        if (_motors[i].clockwise) {
+            rot_accel.z -= m * radians(400.0f);
+        } else {
+            rot_accel.z += m * radians(400.0f);
+        }
+        thrust += m * _thrust_scale;
+    }
+
+    // rotational air resistance
+    rot_accel.x -= gyro.x * radians(5000.0f) / _terminal_rotation_rate;
+    rot_accel.y -= gyro.y * radians(5000.0f) / _terminal_rotation_rate;
+    rot_accel.z -= gyro.z * radians(400.0f)  / _terminal_rotation_rate;
+
+    // update rotational rates in body frame
+    gyro += rot_accel * delta_time;
+
+    // update attitude
+    dcm.rotate(gyro * delta_time);
+    normalise_dcm();
+
+    // air resistance, linear in the speed through the air
+    Vector3f air_velocity = velocity_ef - wind_ef(input);
+    Vector3f air_resistance = air_velocity * (-gravity / _terminal_velocity);
+    airspeed = air_velocity.length();
+
+    Vector3f accel_earth = dcm * Vector3f(0, 0, -thrust / mass);
+    accel_earth += Vector3f(0, 0, gravity);
+    accel_earth += air_resistance;
+
+    // if we're on the ground, then our vertical acceleration is limited
+    // to zero. This effectively adds the force of the ground on the aircraft
+    if (on_ground(position) && accel_earth.z > 0) {
+        accel_earth.z = 0;
+    }
+
+    // the accelerometers see the kinematic acceleration plus gravity
+    accel_body = dcm.mul_transpose(accel_earth + Vector3f(0, 0, -gravity));
+
+    velocity_ef += accel_earth * delta_time;
+    position += velocity_ef * delta_time;
+
+    // constrain height to the ground
+    if (on_ground(position)) {
+        velocity_ef.zero();
+        // zero roll/pitch, but keep yaw
+        float roll, pitch, yaw;
+        dcm.to_euler(&roll, &pitch, &yaw);
+        dcm.from_euler(0, 0, yaw);
+        position.z = -((ground_level - home_altitude) + frame_height);
+    }
+}
+
+#endif // CONFIG_HAL_BOARD
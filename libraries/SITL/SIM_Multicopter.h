@@ -0,0 +1,39 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+  multicopter simulator class, a port of pysim's multicopter.py
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public License
+    as published by the Free Software Foundation; either version 2.1
+    of the License, or (at your option) any later version.
+*/
+
+#ifndef __SIM_MULTICOPTER_H__
+#define __SIM_MULTICOPTER_H__
+
+#include "SIM_Aircraft.h"
+
+class MultiCopter : public Aircraft
+{
+public:
+    // frame_str is one of +, x, y6, hexa, hexax, octa or octax
+    MultiCopter(const char *home_str, const char *frame_str);
+
+    void update(const struct sitl_input &input);
+
+    struct motor {
+        float angle;    // degrees from the front
+        bool clockwise;
+        uint8_t servo;  // servo output driving the motor, from 1
+    };
+
+private:
+    const struct motor *_motors;
+    uint8_t _num_motors;
+    float _hover_throttle;
+    float _terminal_velocity;
+    float _terminal_rotation_rate;
+    float _thrust_scale;
+};
+
+#endif // __SIM_MULTICOPTER_H__
@@ -0,0 +1,93 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+  rover simulator class
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public License
+    as published by the Free Software Foundation; either version 2.1
+    of the License, or (at your option) any later version.
+*/
+
+#include <AP_HAL.h>
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_AVR_SITL
+
+#include "SIM_Rover.h"
+
+Rover::Rover(const char *home_str, bool skid_steering) :
+    Aircraft(home_str),
+    _max_speed(20),
+    _max_accel(30),
+    _turning_circle(1.8f),
+    _skid_steering(skid_steering)
+{
+}
+
+// turning circle diameter in meters for a steering proportion of
+// the 35 degree maximum wheel angle
+float Rover::turn_circle(float steering) const
+{
+    if (fabsf(steering) < 1.0e-6f) {
+        return 0;
+    }
+    return _turning_circle * sinf(radians(35)) / sinf(radians(steering*35));
+}
+
+// yaw rate in degrees/second
+float Rover::yaw_rate(float steering, float speed) const
+{
+    if (fabsf(steering) < 1.0e-6f || fabsf(speed) < 1.0e-6f) {
+        return 0;
+    }
+    float d = turn_circle(steering);
+    float c = PI * d;
+    float t = c / speed;
+    return 360.0f / t;
+}
+
+void Rover::update(const struct sitl_input &input)
+{
+    float steering = (input.servos[0] - 1500) / 500.0f;
+    float throttle = (input.servos[2] - 1500) / 500.0f;
+
+    if (_skid_steering) {
+        // steering and throttle are the left and right motors
+        float motor1 = steering;
+        float motor2 = throttle;
+        steering = motor1 - motor2;
+        throttle = 0.5f*(motor1 + motor2);
+    }
+
+    update_time();
+
+    // speed along the x axis, +ve is forward
+    float speed = dcm.mul_transpose(velocity_ef).x;
+
+    float rate = yaw_rate(steering, speed);
+
+    // linear acceleration towards the speed for this throttle, a very
+    // crude model
+    float target_speed = throttle * _max_speed;
+    float accel = _max_accel * (target_speed - speed) / _max_speed;
+
+    gyro = Vector3f(0, 0, radians(rate));
+
+    // update attitude
+    dcm.rotate(gyro * delta_time);
+    normalise_dcm();
+
+    // the motor plus the acceleration of the change in direction
+    Vector3f accel_earth = dcm * Vector3f(accel, radians(rate) * speed, 0);
+
+    // the ground holds us up
+    accel_earth.z = 0;
+
+    // the accelerometers see the kinematic acceleration plus gravity
+    accel_body = dcm.mul_transpose(accel_earth + Vector3f(0, 0, -gravity));
+
+    velocity_ef += accel_earth * delta_time;
+    position += velocity_ef * delta_time;
+    airspeed = velocity_ef.length();
+}
+
+#endif // CONFIG_HAL_BOARD
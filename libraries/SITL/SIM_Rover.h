@@ -0,0 +1,34 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+  rover simulator class, a port of pysim's rover.py
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public License
+    as published by the Free Software Foundation; either version 2.1
+    of the License, or (at your option) any later version.
+*/
+
+#ifndef __SIM_ROVER_H__
+#define __SIM_ROVER_H__
+
+#include "SIM_Aircraft.h"
+
+class Rover : public Aircraft
+{
+public:
+    // with skid steering servos 1 and 3 drive the left and right motors
+    Rover(const char *home_str, bool skid_steering);
+
+    void update(const struct sitl_input &input);
+
+private:
+    float _max_speed;       // m/s
+    float _max_accel;       // m/s/s
+    float _turning_circle;  // m, at full steering
+    bool _skid_steering;
+
+    float turn_circle(float steering) const;
+    float yaw_rate(float steering, float speed) const;
+};
+
+#endif // __SIM_ROVER_H__
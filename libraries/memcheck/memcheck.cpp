@@ -7,7 +7,25 @@
 
 #include <stdlib.h>
 #include <stdint.h>
-#include <AP_HAL_Boards.h>
+#include <string.h>
+#include <AP_HAL.h>
+#include "memcheck.h"
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+#include <avr/io.h>
+
+// the avr-libc malloc free list
+struct __freelist {
+    size_t sz;
+    struct __freelist *nx;
+};
+extern struct __freelist *__flp;
+extern char *__malloc_heap_start;
+#elif CONFIG_HAL_BOARD == HAL_BOARD_PX4
+#include <malloc.h>
+#endif
+
+extern const AP_HAL::HAL& hal;
 
 static const uint32_t *stack_low;
 extern unsigned __brkval;
@@ -68,3 +86,73 @@ unsigned memcheck_available_memory(void)
     return 0x1000;
 #endif
 }
+
+/*
+ *  the high water mark of the main stack, from the lowest sentinel
+ *  overwritten
+ */
+unsigned memcheck_stack_used(void)
+{
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+    memcheck_available_memory();
+    return (RAMEND+1) - (uintptr_t)stack_low;
+#else
+    return 0;
+#endif
+}
+
+/*
+ *  the heap in use, and how much of it is in freed blocks that
+ *  malloc can only reuse for requests that fit them
+ */
+void memcheck_heap_stats(struct memcheck_heap *heap)
+{
+    memset(heap, 0, sizeof(*heap));
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+    if (__brkval == 0) {
+        // nothing allocated yet
+        return;
+    }
+    for (const struct __freelist *fp = __flp; fp != NULL; fp = fp->nx) {
+        uint32_t sz = fp->sz + sizeof(size_t);
+        heap->free += sz;
+        if (sz > heap->largest_free) {
+            heap->largest_free = sz;
+        }
+        heap->free_blocks++;
+    }
+    heap->used = (__brkval - (uintptr_t)__malloc_heap_start) - heap->free;
+#elif CONFIG_HAL_BOARD == HAL_BOARD_PX4
+    struct mallinfo mem = mallinfo();
+    heap->used = mem.uordblks;
+    heap->free = mem.fordblks;
+    heap->largest_free = mem.mxordblk;
+    heap->free_blocks = mem.ordblks;
+#endif
+}
+
+/*
+ *  fill in a report of all the memory use we can measure
+ */
+void memcheck_report(struct memcheck_report *report)
+{
+    struct memcheck_heap heap;
+    memset(report, 0, sizeof(*report));
+
+    report->free_memory = memcheck_available_memory();
+    report->stack_used = memcheck_stack_used();
+
+    memcheck_heap_stats(&heap);
+    report->heap_used = heap.used;
+    report->heap_free = heap.free;
+    report->heap_largest_free = heap.largest_free;
+    report->heap_free_blocks = heap.free_blocks;
+
+    AP_HAL::Util::ThreadStack st;
+    for (uint8_t i=0; i<MEMCHECK_MAX_THREADS && hal.util->thread_stack(i, st); i++) {
+        report->thread_stack_free[i] = st.free;
+    }
+
+    report->arena_used = arena_used();
+    report->arena_late_allocs = arena_late_allocs();
+}
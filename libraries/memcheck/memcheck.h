@@ -1,6 +1,58 @@
 /// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef __MEMCHECK_H__
+#define __MEMCHECK_H__
+
+#include <stdint.h>
+#include <AP_Common.h>
 
 unsigned        memcheck_available_memory(void);
 void            memcheck_init(void);
 void            memcheck_update_stackptr(void);
 
+// the most stack the main thread has used since memcheck_init()
+unsigned        memcheck_stack_used(void);
+
+struct memcheck_heap {
+    uint32_t used;          // bytes allocated
+    uint32_t free;          // bytes in freed blocks below the heap top
+    uint32_t largest_free;  // the largest freed block
+    uint16_t free_blocks;   // number of freed blocks, a measure of fragmentation
+};
+void            memcheck_heap_stats(struct memcheck_heap *heap);
+
+// the number of HAL thread stacks in a report
+#define MEMCHECK_MAX_THREADS 4
+
+/*
+  a snapshot of memory use in bytes, with 0 for what the board can't
+  measure. It is the payload of the DataFlash MEM message and of the
+  DATA32 messages from memcheck_send_mavlink()
+ */
+struct PACKED memcheck_report {
+    uint16_t free_memory;
+    uint16_t stack_used;
+    uint32_t heap_used;
+    uint32_t heap_free;
+    uint32_t heap_largest_free;
+    uint16_t heap_free_blocks;
+    // the least free stack seen in each of the HAL threads
+    uint16_t thread_stack_free[MEMCHECK_MAX_THREADS];
+    // the arena, see AP_Common.h
+    uint16_t arena_used;
+    uint16_t arena_late_allocs;
+};
+void            memcheck_report(struct memcheck_report *report);
+
+#ifdef MAVLINK_MSG_ID_DATA32
+// the type of the DATA32 messages carrying a memcheck_report
+ # define MEMCHECK_DATA32_TYPE 0x51
+
+static inline void memcheck_send_mavlink(mavlink_channel_t chan)
+{
+    struct memcheck_report report;
+    memcheck_report(&report);
+    mavlink_msg_data32_send(chan, MEMCHECK_DATA32_TYPE, sizeof(report), (const uint8_t *)&report);
+}
+#endif
+
+#endif // __MEMCHECK_H__
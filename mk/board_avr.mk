@@ -134,6 +134,9 @@ SKETCHEEP		=	$(BUILDROOT)/$(SKETCH).eep
 # Map file
 SKETCHMAP		=	$(BUILDROOT)/$(SKETCH).map
 
+# Static RAM table
+SKETCHRAM		=	$(BUILDROOT)/$(SKETCH).ram
+
 # All of the objects that may be built
 ALLOBJS			=	$(SKETCHOBJS) $(LIBOBJS)
 
@@ -144,7 +147,7 @@ ALLDEPS			=	$(ALLOBJS:%.o=%.d)
 # Targets
 #
 
-all: $(SKETCHELF) $(SKETCHEEP) $(SKETCHHEX)
+all: $(SKETCHELF) $(SKETCHEEP) $(SKETCHHEX) $(SKETCHRAM)
 
 print-%:
 	echo "$*=$($*)"
@@ -180,6 +183,12 @@ $(SKETCHHEX):	$(SKETCHELF)
 	$(RULEHDR)
 	$(v)$(OBJCOPY) -O ihex -R .eeprom $< $@
 
+# Create the table of static RAM use by each library. It is only a
+# report, so a build without python still succeeds
+$(SKETCHRAM):	$(SKETCHELF)
+	$(RULEHDR)
+	$(v)python $(SKETCHBOOK)/Tools/scripts/ram_budget.py $(SKETCHMAP) > $@ || true
+
 # Create the eep file
 $(SKETCHEEP):	$(SKETCHELF)
 	$(RULEHDR)